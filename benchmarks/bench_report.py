@@ -0,0 +1,140 @@
+#===- bench_report.py ----------------------------------------*- Python -*-===#
+#
+# Copyright 2024 Intel Corporation
+# This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+# See https:#llvm.org/LICENSE.txt for license information.
+# SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#
+#===----------------------------------------------------------------------===#
+#
+# This file summarizes the timings collected by bench_imex.
+#
+#===----------------------------------------------------------------------===#
+
+"""
+Summarize raw timings collected by bench_imex into machine-readable
+results and optionally compare them against a baseline.
+
+The raw input has one line per run of a test case: `<mlir file>,<time in ms>`,
+where the time is the sum of the kernel execution times of the run.
+Test cases are named `opname_shape_dtype.mlir`. If a test case starts with
+`// FLOP: <n>` or `// BYTES: <n>` comments, TFLOPS or effective GB/s get
+computed from the median time.
+
+With --baseline, results get compared against a previously saved JSON file.
+The script exits with 1 if the median time of any test case got slower than
+the baseline by more than --threshold percent.
+"""
+
+import argparse
+import csv
+import json
+import os
+import re
+import statistics
+import sys
+
+FIELDS = ["name", "op", "shape", "dtype", "runtime", "pipeline", "runs",
+          "median_ms", "p90_ms", "gbps", "tflops"]
+
+
+def percentile(values, p):
+    """Nearest-rank percentile of the given values."""
+    values = sorted(values)
+    rank = max(0, -(-len(values) * p // 100) - 1)
+    return values[int(rank)]
+
+
+def annotations(path):
+    """Read `// KEY: <n>` comments at the beginning of a test case."""
+    res = {}
+    with open(path) as f:
+        for line in f:
+            m = re.match(r"^// (\w+): (\d+)$", line.strip())
+            if not m:
+                break
+            res[m.group(1)] = int(m.group(2))
+    return res
+
+
+def summarize(raw, runtime, pipeline):
+    times = {}
+    with open(raw) as f:
+        for path, time in csv.reader(f):
+            times.setdefault(path, []).append(float(time))
+
+    results = []
+    for path, runs in times.items():
+        name = os.path.splitext(os.path.basename(path))[0]
+        m = re.match(r"^(.+)_(\d+(?:x\d+)*)_(\w+)$", name)
+        op, shape, dtype = m.groups() if m else (name, "", "")
+        median = statistics.median(runs)
+        res = {
+            "name": name,
+            "op": op,
+            "shape": shape,
+            "dtype": dtype,
+            "runtime": runtime,
+            "pipeline": pipeline,
+            "runs": len(runs),
+            "median_ms": median,
+            "p90_ms": percentile(runs, 90),
+            "gbps": None,
+            "tflops": None,
+        }
+        work = annotations(path)
+        if median > 0 and "BYTES" in work:
+            res["gbps"] = work["BYTES"] / (median * 1e6)
+        if median > 0 and "FLOP" in work:
+            res["tflops"] = work["FLOP"] / (median * 1e9)
+        results.append(res)
+    return sorted(results, key=lambda r: r["name"])
+
+
+def compare(results, baseline, threshold):
+    """Print regressions against the baseline, return True if there are any."""
+    with open(baseline) as f:
+        base = {(r["name"], r["runtime"]): r for r in json.load(f)}
+    regressed = False
+    for res in results:
+        ref = base.get((res["name"], res["runtime"]))
+        if ref is None:
+            print(f"{res['name']}: no baseline")
+            continue
+        change = 100 * (res["median_ms"] / ref["median_ms"] - 1)
+        status = "ok"
+        if change > threshold:
+            status = "REGRESSION"
+            regressed = True
+        print(f"{res['name']}: {ref['median_ms']:.4f} ms -> "
+              f"{res['median_ms']:.4f} ms ({change:+.1f}%) {status}")
+    return regressed
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--raw", required=True, help="raw timings")
+    parser.add_argument("--runtime", required=True, help="runtime name")
+    parser.add_argument("--pipeline", required=True, help="pipeline file")
+    parser.add_argument("--json", help="write results as JSON to this file")
+    parser.add_argument("--csv", help="write results as CSV to this file")
+    parser.add_argument("--baseline", help="JSON results to compare against")
+    parser.add_argument("--threshold", type=float, default=5.0,
+                        help="allowed slowdown in percent (default: 5)")
+    args = parser.parse_args()
+
+    results = summarize(args.raw, args.runtime, args.pipeline)
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump(results, f, indent=2)
+    if args.csv:
+        with open(args.csv, "w", newline="") as f:
+            writer = csv.DictWriter(f, fieldnames=FIELDS)
+            writer.writeheader()
+            writer.writerows(results)
+    if args.baseline and compare(results, args.baseline, args.threshold):
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
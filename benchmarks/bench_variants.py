@@ -0,0 +1,133 @@
+#===- bench_variants.py --------------------------------------*- Python -*-===#
+#
+# Copyright 2024 Intel Corporation
+# This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+# See https:#llvm.org/LICENSE.txt for license information.
+# SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#
+#===----------------------------------------------------------------------===#
+#
+# This file selects the best variant per shape from bench_imex results.
+#
+#===----------------------------------------------------------------------===#
+
+"""
+Select the fastest kernel variant for each shape from the results.json of a
+bench_imex run over generated variants, e.g. spirv/variants.
+
+Variants are named `opname.param<n>...[.access]_shape_dtype.mlir`, e.g.
+`relu.seq2.simd16.block_512x640x20x15_f32.mlir`. Parameters are a name
+followed by an integer; any other component is the access pattern, recorded as
+`block=1` for block accesses and `block=0` otherwise.
+
+For every (op, shape, dtype) this prints all variants ordered by median time
+and the best one, and optionally writes the best variants as JSON. With
+--tuning-db, the parameters of the best variants get merged into the tuning
+database used by the XeTile blocking tuner, one entry per parameter:
+
+    <arch> TAB <op> : (memref<shapexdtype>) -> memref<shapexdtype> TAB <param>=<value>
+
+Existing entries for the same (arch, signature, param) get replaced, all other
+lines are kept.
+"""
+
+import argparse
+import json
+import re
+
+
+def parse_variant(op):
+    """Split `relu.seq2.simd16.block` into ('relu', {seq: 2, simd: 16, block: 1})."""
+    base, *parts = op.split(".")
+    params = {}
+    for part in parts:
+        m = re.match(r"^([a-z_]+)(\d+)$", part)
+        if m:
+            params[m.group(1)] = int(m.group(2))
+        else:
+            params["block"] = int(part == "block")
+    return base, params
+
+
+def select(results):
+    """Group results by (op, shape, dtype), fastest variant first."""
+    groups = {}
+    for res in results:
+        if not res["shape"] or not res["median_ms"]:
+            continue
+        base, params = parse_variant(res["op"])
+        if not params:
+            continue
+        groups.setdefault((base, res["shape"], res["dtype"]), []).append(
+            dict(res, params=params))
+    for variants in groups.values():
+        variants.sort(key=lambda r: r["median_ms"])
+    return groups
+
+
+def signature(base, shape, dtype):
+    ty = f"memref<{shape}x{dtype}>"
+    return f"{base} : ({ty}) -> {ty}"
+
+
+def update_tuning_db(path, arch, groups):
+    entries = {}
+    for (base, shape, dtype), variants in groups.items():
+        sig = signature(base, shape, dtype)
+        for param, value in variants[0]["params"].items():
+            entries[(arch, sig, param)] = value
+
+    lines = []
+    try:
+        with open(path) as f:
+            for line in f:
+                fields = line.rstrip("\n").split("\t")
+                if not line.startswith("#") and len(fields) == 3:
+                    key = (fields[0], fields[1], fields[2].split("=")[0])
+                    if key in entries:
+                        continue
+                lines.append(line.rstrip("\n"))
+    except FileNotFoundError:
+        pass
+    for (entry_arch, sig, param), value in sorted(entries.items()):
+        lines.append(f"{entry_arch}\t{sig}\t{param}={value}")
+    with open(path, "w") as f:
+        f.write("\n".join(lines) + "\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("results", nargs="?", default="results.json",
+                        help="results of bench_imex (default: results.json)")
+    parser.add_argument("--json", help="write the best variant per shape to this file")
+    parser.add_argument("--tuning-db", help="merge the best variants into this tuning database")
+    parser.add_argument("--arch", default="pvc",
+                        help="architecture of the tuning database entries (default: pvc)")
+    args = parser.parse_args()
+
+    with open(args.results) as f:
+        groups = select(json.load(f))
+
+    best = []
+    for (base, shape, dtype), variants in sorted(groups.items()):
+        print(f"\n{base} {shape} {dtype}:")
+        for res in variants:
+            gbps = f"{res['gbps']:8.1f} GB/s" if res.get("gbps") else ""
+            print(f"  {res['op']:40} {res['median_ms']:10.4f} ms {gbps}")
+        winner = variants[0]
+        speedup = variants[-1]["median_ms"] / winner["median_ms"]
+        print(f"  best: {winner['op']} ({speedup:.2f}x over the slowest variant)")
+        best.append({"op": base, "shape": shape, "dtype": dtype,
+                     "variant": winner["op"], "params": winner["params"],
+                     "median_ms": winner["median_ms"], "gbps": winner.get("gbps")})
+
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump(best, f, indent=2)
+    if args.tuning_db:
+        update_tuning_db(args.tuning_db, args.arch, groups)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,169 @@
+//===- idtr-timer.cpp - Timing of the IDTR runtime calls --------*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file times every `_idtr_*` call made by code compiled through
+// lower-distruntime-to-idtr. It is passed to the runner before any other
+// shared library, so it provides the `_idtr_*` symbols; each of them forwards
+// to the IDTR runtime loaded from IMEX_IDTR_LIB and records how long the call
+// took. At exit the calls are written to IMEX_IDTR_TIMING_OUTPUT.<pid> as CSV
+// (op,call,us), one line per call in the order of the calls of each op.
+//
+// Unranked memrefs get passed as (rank, descriptor) pairs and all other
+// arguments are integers, so the wrappers only need the number of arguments.
+//
+//===----------------------------------------------------------------------===//
+
+#include <dlfcn.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace {
+
+class Timings {
+public:
+  static Timings &get() {
+    static Timings timings;
+    return timings;
+  }
+
+  ~Timings() {
+    auto prefix = getenv("IMEX_IDTR_TIMING_OUTPUT");
+    if (!prefix)
+      return;
+    auto path = std::string(prefix) + "." + std::to_string(getpid());
+    auto file = fopen(path.c_str(), "w");
+    if (!file) {
+      fprintf(stderr, "Cannot open IDTR timing output %s\n", path.c_str());
+      return;
+    }
+    fprintf(file, "op,call,us\n");
+    for (auto &[op, samples] : calls_)
+      for (size_t i = 0; i < samples.size(); ++i)
+        fprintf(file, "%s,%zu,%.3f\n", op.c_str(), i, samples[i]);
+    fclose(file);
+  }
+
+  /// Returns \p name from the IDTR runtime, exits if it is missing.
+  void *lookup(const char *name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!lib_) {
+      auto path = getenv("IMEX_IDTR_LIB");
+      lib_ = path ? dlopen(path, RTLD_NOW | RTLD_GLOBAL) : nullptr;
+      if (!lib_) {
+        fprintf(stderr, "Cannot load the IDTR runtime (IMEX_IDTR_LIB): %s\n",
+                path ? dlerror() : "not set");
+        exit(1);
+      }
+    }
+    auto sym = dlsym(lib_, name);
+    if (!sym) {
+      fprintf(stderr, "IDTR runtime has no %s\n", name);
+      exit(1);
+    }
+    return sym;
+  }
+
+  void record(const char *op, double us) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    calls_[op].push_back(us);
+  }
+
+private:
+  Timings() = default;
+
+  std::mutex mutex_;
+  void *lib_ = nullptr;
+  std::map<std::string, std::vector<double>> calls_;
+};
+
+using Clock = std::chrono::steady_clock;
+
+// Calls \p name of the IDTR runtime with \p args and records the time under
+// \p op, which is the name without the element type suffix.
+template <typename Ret, typename... Args>
+Ret timed(const char *op, const char *name, Args... args) {
+  using Fn = Ret (*)(Args...);
+  static thread_local std::map<const char *, Fn> cache;
+  auto &fn = cache[name];
+  if (!fn)
+    fn = reinterpret_cast<Fn>(Timings::get().lookup(name));
+  auto start = Clock::now();
+  if constexpr (std::is_void_v<Ret>) {
+    fn(args...);
+    Timings::get().record(
+        op,
+        std::chrono::duration<double, std::micro>(Clock::now() - start)
+            .count());
+  } else {
+    auto ret = fn(args...);
+    Timings::get().record(
+        op,
+        std::chrono::duration<double, std::micro>(Clock::now() - start)
+            .count());
+    return ret;
+  }
+}
+
+} // namespace
+
+using I = int64_t;
+using P = void *;
+
+extern "C" {
+
+I _idtr_nprocs(I team) { return timed<I>("_idtr_nprocs", __func__, team); }
+I _idtr_prank(I team) { return timed<I>("_idtr_prank", __func__, team); }
+void _idtr_wait(I handle) { timed<void>("_idtr_wait", __func__, handle); }
+
+// One set of wrappers per element type, see RuntimePrototypes in
+// DistRuntimeToIDTR.cpp for the arguments.
+#define IDTR_TYPED(T)                                                          \
+  I _idtr_reduce_all_async_##T(I r, P d, int32_t op) {                         \
+    return timed<I>("_idtr_reduce_all_async", __func__, r, d, op);             \
+  }                                                                            \
+  I _idtr_reduce_all_hier_async_##T(I r, P d, int32_t op, I ranksPerNode) {    \
+    return timed<I>("_idtr_reduce_all_hier_async", __func__, r, d, op,        \
+                    ranksPerNode);                                             \
+  }                                                                            \
+  I _idtr_copy_reshape_##T(I team, I r0, P d0, I r1, P d1, I r2, P d2, I r3,   \
+                           P d3, I r4, P d4, I r5, P d5) {                     \
+    return timed<I>("_idtr_copy_reshape", __func__, team, r0, d0, r1, d1, r2, \
+                    d2, r3, d3, r4, d4, r5, d5);                               \
+  }                                                                            \
+  I _idtr_copy_permute_##T(I team, I r0, P d0, I r1, P d1, I r2, P d2, I r3,   \
+                           P d3, I r4, P d4, I r5, P d5) {                     \
+    return timed<I>("_idtr_copy_permute", __func__, team, r0, d0, r1, d1, r2, \
+                    d2, r3, d3, r4, d4, r5, d5);                               \
+  }                                                                            \
+  I _idtr_update_halo_##T(I team, I r0, P d0, I r1, P d1, I r2, P d2, I r3,    \
+                          P d3, I r4, P d4, I r5, P d5, I r6, P d6, I key) {   \
+    return timed<I>("_idtr_update_halo", __func__, team, r0, d0, r1, d1, r2,  \
+                    d2, r3, d3, r4, d4, r5, d5, r6, d6, key);                  \
+  }
+
+IDTR_TYPED(f64)
+IDTR_TYPED(f32)
+IDTR_TYPED(i64)
+IDTR_TYPED(i32)
+IDTR_TYPED(i16)
+IDTR_TYPED(i8)
+IDTR_TYPED(i1)
+
+#undef IDTR_TYPED
+
+} // extern "C"
@@ -0,0 +1,39 @@
+// linalg dialect to vectorized and multi-threaded cpu code lowering pipeline
+// Innermost loops get vectorized with 16 lanes (one AVX-512 register of f32),
+// including reductions, and the outermost parallel loops run on OpenMP threads.
+// The OpenMP runtime (libomp) needs to be passed to the runner as shared lib.
+builtin.module(convert-tensor-to-linalg
+    arith-bufferize
+    func.func(empty-tensor-to-alloc-tensor
+          // eliminate-empty-tensors
+          scf-bufferize
+          shape-bufferize
+          linalg-bufferize
+          bufferization-bufferize
+          tensor-bufferize)
+    func-bufferize
+    func.func(finalizing-bufferize
+          convert-linalg-to-affine-loops
+          affine-loop-normalize
+          affine-super-vectorize{virtual-vector-size=16 vectorize-reductions=true}
+          affine-parallelize{max-nested=1 parallel-reductions=true})
+    lower-affine
+    convert-scf-to-openmp
+    canonicalize
+    convert-vector-to-scf
+    convert-scf-to-cf
+    convert-vector-to-llvm{enable-x86vector=true}
+    convert-linalg-to-llvm
+    convert-cf-to-llvm
+    convert-arith-to-llvm
+    convert-math-to-llvm
+    convert-math-to-libm
+    convert-complex-to-llvm
+    convert-index-to-llvm
+    expand-strided-metadata
+    lower-affine
+    finalize-memref-to-llvm
+    convert-func-to-llvm
+    convert-openmp-to-llvm
+    reconcile-unrealized-casts)
+// End
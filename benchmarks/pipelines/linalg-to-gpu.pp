@@ -1,6 +1,7 @@
 // linalg dialect to gpu dialect lowering pipeline
 // Ready for vulkan runner or narrow scope l0/sycl runner starting from GPU dialect.
 builtin.module(convert-tensor-to-linalg
+    func.func(imex-fuse-sibling-reductions)
     arith-bufferize
     func.func(empty-tensor-to-alloc-tensor
           // eliminate-empty-tensors
@@ -11,6 +12,8 @@ builtin.module(convert-tensor-to-linalg
           tensor-bufferize)
     func-bufferize
     func.func(finalizing-bufferize
+          imex-fill-to-memset
+          imex-transpose-to-gpu
           convert-linalg-to-parallel-loops
           imex-add-outer-parallel-loop
           gpu-map-parallel-loops
@@ -23,6 +26,8 @@ builtin.module(convert-tensor-to-linalg
 //  func.func(unstride-memrefs)
     func.func(lower-affine)
     gpu-kernel-outlining
+// cost estimates for the roofline report of the profiler
+    gpu.module(imex-estimate-kernel-cost)
     canonicalize
     cse
 // The following set-spirv-* passes can have client-api = opencl or vulkan args
@@ -35,7 +40,9 @@ builtin.module(convert-tensor-to-linalg
              spirv-update-vce)
     func.func(llvm-request-c-wrappers)
     serialize-spirv
+    func.func(gpu-async-region)
     convert-gpu-to-gpux
+    func.func(insert-gpux-memory-hints)
     convert-scf-to-cf
     convert-func-to-llvm
     convert-math-to-llvm
@@ -0,0 +1,39 @@
+// Kernels used by runtime-bench, serialized to SPIR-V at build time.
+// - empty: launch overhead
+// - copy:  dst[i] = src[i]              (STREAM copy)
+// - triad: a[i] = b[i] + scalar * c[i]  (STREAM triad)
+module {
+  spirv.module Physical64 OpenCL requires #spirv.vce<v1.0, [Int64, Addresses, Kernel], []> {
+    spirv.GlobalVariable @__builtin_var_GlobalInvocationId__ built_in("GlobalInvocationId") : !spirv.ptr<vector<3xi64>, Input>
+    spirv.func @empty() "None" {
+      spirv.Return
+    }
+    spirv.func @copy(%dst: !spirv.ptr<f32, CrossWorkgroup>, %src: !spirv.ptr<f32, CrossWorkgroup>) "None" {
+      %addr = spirv.mlir.addressof @__builtin_var_GlobalInvocationId__ : !spirv.ptr<vector<3xi64>, Input>
+      %0 = spirv.Load "Input" %addr : vector<3xi64>
+      %1 = spirv.CompositeExtract %0[0 : i32] : vector<3xi64>
+      %2 = spirv.InBoundsPtrAccessChain %src[%1] : !spirv.ptr<f32, CrossWorkgroup>, i64 -> !spirv.ptr<f32, CrossWorkgroup>
+      %3 = spirv.Load "CrossWorkgroup" %2 ["Aligned", 4] : f32
+      %4 = spirv.InBoundsPtrAccessChain %dst[%1] : !spirv.ptr<f32, CrossWorkgroup>, i64 -> !spirv.ptr<f32, CrossWorkgroup>
+      spirv.Store "CrossWorkgroup" %4, %3 ["Aligned", 4] : f32
+      spirv.Return
+    }
+    spirv.func @triad(%a: !spirv.ptr<f32, CrossWorkgroup>, %b: !spirv.ptr<f32, CrossWorkgroup>, %c: !spirv.ptr<f32, CrossWorkgroup>, %scalar: f32) "None" {
+      %addr = spirv.mlir.addressof @__builtin_var_GlobalInvocationId__ : !spirv.ptr<vector<3xi64>, Input>
+      %0 = spirv.Load "Input" %addr : vector<3xi64>
+      %1 = spirv.CompositeExtract %0[0 : i32] : vector<3xi64>
+      %2 = spirv.InBoundsPtrAccessChain %b[%1] : !spirv.ptr<f32, CrossWorkgroup>, i64 -> !spirv.ptr<f32, CrossWorkgroup>
+      %3 = spirv.Load "CrossWorkgroup" %2 ["Aligned", 4] : f32
+      %4 = spirv.InBoundsPtrAccessChain %c[%1] : !spirv.ptr<f32, CrossWorkgroup>, i64 -> !spirv.ptr<f32, CrossWorkgroup>
+      %5 = spirv.Load "CrossWorkgroup" %4 ["Aligned", 4] : f32
+      %6 = spirv.FMul %scalar, %5 : f32
+      %7 = spirv.FAdd %3, %6 : f32
+      %8 = spirv.InBoundsPtrAccessChain %a[%1] : !spirv.ptr<f32, CrossWorkgroup>, i64 -> !spirv.ptr<f32, CrossWorkgroup>
+      spirv.Store "CrossWorkgroup" %8, %7 ["Aligned", 4] : f32
+      spirv.Return
+    }
+    spirv.EntryPoint "Kernel" @empty
+    spirv.EntryPoint "Kernel" @copy, @__builtin_var_GlobalInvocationId__
+    spirv.EntryPoint "Kernel" @triad, @__builtin_var_GlobalInvocationId__
+  }
+}
@@ -0,0 +1,328 @@
+//===- runtime-bench.cpp - GPU runtime wrapper microbenchmarks --*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file measures the overhead of the Level Zero and SYCL runtime wrappers
+// themselves (stream creation, module load, kernel lookup, empty launches,
+// allocations) and the copy and STREAM bandwidth reached through them. It is
+// built once per runtime and calls the wrappers directly, the same way
+// compiled code does.
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// Wrapper entry points, with runtime specific handles passed as void *.
+extern "C" {
+void *gpuCreateStream(void *device, void *context);
+void gpuStreamDestroy(void *queue);
+void *gpuMemAlloc(void *queue, size_t size, size_t alignment, bool isShared);
+void gpuMemFree(void *queue, void *ptr);
+void gpuMemCopy(void *queue, void *dstPtr, void *srcPtr, size_t size);
+void *gpuModuleLoad(void *queue, const void *data, size_t dataSize);
+void gpuModuleUnload(void *module);
+void *gpuKernelGet(void *queue, void *module, const char *name);
+void *gpuLaunchKernel(void *queue, void *kernel, size_t gridX, size_t gridY,
+                      size_t gridZ, size_t blockX, size_t blockY,
+                      size_t blockZ, size_t sharedMemBytes, void *params,
+                      void *depEvents);
+void gpuWait(void *queue);
+}
+
+namespace {
+
+// Kernel arguments as expected by gpuLaunchKernel, terminated by {nullptr, 0}.
+struct ParamDesc {
+  void *data;
+  size_t size;
+};
+
+struct Result {
+  std::string name;
+  double value;
+  const char *unit;
+};
+
+struct Options {
+  const char *kernels = IMEX_BENCH_KERNELS;
+  const char *json = nullptr;
+  int reps = 100;
+  size_t bytes = size_t(256) << 20;
+};
+
+using Clock = std::chrono::steady_clock;
+
+double elapsedUs(Clock::time_point start) {
+  return std::chrono::duration<double, std::micro>(Clock::now() - start)
+      .count();
+}
+
+double median(std::vector<double> samples) {
+  std::sort(samples.begin(), samples.end());
+  return samples[samples.size() / 2];
+}
+
+// Median time of one call of \p fn in microseconds, after one warm-up call.
+template <typename Fn> double timeUs(int reps, Fn &&fn) {
+  fn();
+  std::vector<double> samples;
+  samples.reserve(reps);
+  for (int i = 0; i < reps; ++i) {
+    auto start = Clock::now();
+    fn();
+    samples.push_back(elapsedUs(start));
+  }
+  return median(samples);
+}
+
+std::string sizeName(size_t bytes) {
+  if (bytes >= (1 << 20))
+    return std::to_string(bytes >> 20) + "MB";
+  if (bytes >= (1 << 10))
+    return std::to_string(bytes >> 10) + "KB";
+  return std::to_string(bytes) + "B";
+}
+
+class Bench {
+public:
+  Bench(const Options &options) : options_(options) {}
+
+  void run() {
+    streams();
+    auto spirv = readKernels();
+    queue_ = gpuCreateStream(nullptr, nullptr);
+    modules(spirv);
+    launches();
+    allocations();
+    copies();
+    stream();
+    gpuModuleUnload(module_);
+    gpuStreamDestroy(queue_);
+  }
+
+  void print() const {
+    std::printf("\n================ Runtime overhead (%s) ================\n\n",
+                IMEX_BENCH_RUNTIME);
+    for (auto &res : results_)
+      std::printf("%-40s %12.3f %s\n", res.name.c_str(), res.value, res.unit);
+  }
+
+  void writeJson(const char *path) const {
+    std::ofstream out(path);
+    out << "[\n";
+    for (size_t i = 0; i < results_.size(); ++i) {
+      auto &res = results_[i];
+      out << "  {\"name\": \"" << res.name << "\", \"runtime\": \""
+          << IMEX_BENCH_RUNTIME << "\", \"value\": " << res.value
+          << ", \"unit\": \"" << res.unit << "\"}"
+          << (i + 1 < results_.size() ? ",\n" : "\n");
+    }
+    out << "]\n";
+  }
+
+private:
+  void report(std::string name, double value, const char *unit) {
+    results_.push_back({std::move(name), value, unit});
+  }
+
+  std::vector<char> readKernels() {
+    std::ifstream in(options_.kernels, std::ios::binary);
+    if (!in) {
+      std::fprintf(stderr, "Cannot open kernels %s\n", options_.kernels);
+      std::exit(1);
+    }
+    return {std::istreambuf_iterator<char>(in),
+            std::istreambuf_iterator<char>()};
+  }
+
+  void streams() {
+    // Creating a stream is expensive, fewer repetitions are enough.
+    report("gpuCreateStream", timeUs(std::max(options_.reps / 10, 1), [] {
+             gpuStreamDestroy(gpuCreateStream(nullptr, nullptr));
+           }),
+           "us");
+  }
+
+  void modules(const std::vector<char> &spirv) {
+    // Unloading evicts the module from the module cache, so every load in the
+    // first loop builds the module; the second loop hits the cache.
+    report("gpuModuleLoad (build)",
+           timeUs(std::max(options_.reps / 10, 1),
+                  [&] {
+                    gpuModuleUnload(
+                        gpuModuleLoad(queue_, spirv.data(), spirv.size()));
+                  }),
+           "us");
+    module_ = gpuModuleLoad(queue_, spirv.data(), spirv.size());
+    report("gpuModuleLoad (cached)", timeUs(options_.reps, [&] {
+             gpuModuleLoad(queue_, spirv.data(), spirv.size());
+           }),
+           "us");
+    report("gpuKernelGet", timeUs(options_.reps, [&] {
+             gpuKernelGet(queue_, module_, "empty");
+           }),
+           "us");
+  }
+
+  void launches() {
+    auto kernel = gpuKernelGet(queue_, module_, "empty");
+    ParamDesc params[] = {{nullptr, 0}};
+    auto launch = [&] {
+      gpuLaunchKernel(queue_, kernel, 1, 1, 1, 1, 1, 1, 0, params, nullptr);
+    };
+    // Round trip of a single launch, and the host cost of one launch when
+    // many are submitted before waiting.
+    report("gpuLaunchKernel + gpuWait (empty)", timeUs(options_.reps, [&] {
+             launch();
+             gpuWait(queue_);
+           }),
+           "us");
+    report("gpuLaunchKernel (empty, submit)", timeUs(1, [&] {
+             for (int i = 0; i < options_.reps; ++i)
+               launch();
+             gpuWait(queue_);
+           }) / options_.reps,
+           "us");
+  }
+
+  void allocations() {
+    for (bool isShared : {false, true}) {
+      for (size_t size : {size_t(64), size_t(4) << 10, size_t(256) << 10,
+                          size_t(16) << 20, size_t(256) << 20}) {
+        report(std::string("gpuMemAlloc + gpuMemFree (") +
+                   (isShared ? "shared, " : "device, ") + sizeName(size) + ")",
+               timeUs(options_.reps, [&] {
+                 gpuMemFree(queue_, gpuMemAlloc(queue_, size, 64, isShared));
+               }),
+               "us");
+      }
+    }
+  }
+
+  void copies() {
+    auto size = options_.bytes;
+    std::vector<char> host(size, 1);
+    auto src = gpuMemAlloc(queue_, size, 64, false);
+    auto dst = gpuMemAlloc(queue_, size, 64, false);
+    auto gbps = [&](double us) { return size / (us * 1e3); };
+    auto reps = std::max(options_.reps / 10, 1);
+    gpuMemCopy(queue_, src, host.data(), size);
+    report("gpuMemCopy H2D (" + sizeName(size) + ")", gbps(timeUs(reps, [&] {
+             gpuMemCopy(queue_, dst, host.data(), size);
+           })),
+           "GB/s");
+    report("gpuMemCopy D2H (" + sizeName(size) + ")", gbps(timeUs(reps, [&] {
+             gpuMemCopy(queue_, host.data(), src, size);
+           })),
+           "GB/s");
+    report("gpuMemCopy D2D (" + sizeName(size) + ")",
+           gbps(timeUs(reps, [&] { gpuMemCopy(queue_, dst, src, size); })),
+           "GB/s");
+    gpuMemFree(queue_, src);
+    gpuMemFree(queue_, dst);
+  }
+
+  // STREAM copy and triad; bandwidth counts every byte read and written.
+  void stream() {
+    constexpr size_t block = 256;
+    size_t count = options_.bytes / sizeof(float) / block * block;
+    size_t size = count * sizeof(float);
+    std::vector<float> init(count, 1.0f);
+    void *a = gpuMemAlloc(queue_, size, 64, false);
+    void *b = gpuMemAlloc(queue_, size, 64, false);
+    void *c = gpuMemAlloc(queue_, size, 64, false);
+    gpuMemCopy(queue_, b, init.data(), size);
+    gpuMemCopy(queue_, c, init.data(), size);
+    float scalar = 3.0f;
+    auto reps = std::max(options_.reps / 10, 1);
+
+    auto copy = gpuKernelGet(queue_, module_, "copy");
+    ParamDesc copyParams[] = {{&a, sizeof(a)}, {&b, sizeof(b)}, {nullptr, 0}};
+    auto copyUs = timeUs(reps, [&] {
+      gpuLaunchKernel(queue_, copy, count / block, 1, 1, block, 1, 1, 0,
+                      copyParams, nullptr);
+      gpuWait(queue_);
+    });
+    report("STREAM copy (" + sizeName(size) + ")", 2 * size / (copyUs * 1e3),
+           "GB/s");
+
+    auto triad = gpuKernelGet(queue_, module_, "triad");
+    ParamDesc triadParams[] = {{&a, sizeof(a)},
+                               {&b, sizeof(b)},
+                               {&c, sizeof(c)},
+                               {&scalar, sizeof(scalar)},
+                               {nullptr, 0}};
+    auto triadUs = timeUs(reps, [&] {
+      gpuLaunchKernel(queue_, triad, count / block, 1, 1, block, 1, 1, 0,
+                      triadParams, nullptr);
+      gpuWait(queue_);
+    });
+    report("STREAM triad (" + sizeName(size) + ")", 3 * size / (triadUs * 1e3),
+           "GB/s");
+
+    gpuMemFree(queue_, a);
+    gpuMemFree(queue_, b);
+    gpuMemFree(queue_, c);
+  }
+
+  const Options &options_;
+  void *queue_ = nullptr;
+  void *module_ = nullptr;
+  std::vector<Result> results_;
+};
+
+void usage(const char *name) {
+  std::printf("Usage: %s [--reps <n>] [--size <MB>] [--kernels <spv>] "
+              "[--json <file>]\n"
+              "  --reps:    repetitions of each latency measurement "
+              "(default: 100)\n"
+              "  --size:    buffer size of the bandwidth measurements in MB "
+              "(default: 256)\n"
+              "  --kernels: SPIR-V binary of the benchmark kernels\n"
+              "  --json:    also write the results as JSON to this file\n",
+              name);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    auto arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (!std::strcmp(arg, "--reps") && hasValue)
+      options.reps = std::max(std::atoi(argv[++i]), 1);
+    else if (!std::strcmp(arg, "--size") && hasValue)
+      options.bytes = std::max(std::atoll(argv[++i]), 1LL) << 20;
+    else if (!std::strcmp(arg, "--kernels") && hasValue)
+      options.kernels = argv[++i];
+    else if (!std::strcmp(arg, "--json") && hasValue)
+      options.json = argv[++i];
+    else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  Bench bench(options);
+  bench.run();
+  bench.print();
+  if (options.json)
+    bench.writeJson(options.json);
+  return 0;
+}
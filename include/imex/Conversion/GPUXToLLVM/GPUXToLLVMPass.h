@@ -15,6 +15,8 @@
 #ifndef IMEX_GPUXTOLLVM_PASS_H_
 #define IMEX_GPUXTOLLVM_PASS_H_
 
+#include <llvm/ADT/StringRef.h>
+
 #include <memory>
 namespace mlir {
 
@@ -37,10 +39,26 @@ namespace imex {
 /// It performs Type conversion from illegal given GPUX types like DeviceType,
 /// ContextType, StreamType, etc. to legal mlir::Type It inserts conversion
 /// patterns to legalize GPUX ops, AllocOp, DeallocOp, StreamCreate and
-/// StreamDestroy
+/// StreamDestroy. If \p moduleStreams is set, streams are created lazily once
+/// per module and destroyed at module destruction instead of per function call.
+/// If \p packedKernelArgs is set, kernels are launched with
+/// gpuLaunchKernelPacked. If \p batchKernelLaunches is set, consecutive
+/// synchronous launches are submitted together with gpuLaunchKernels. If
+/// \p allocSiteTags is set, allocations pass the name of the allocating
+/// function to gpuMemAllocTagged. If \p preloadModules is set, the modules of
+/// the launched kernels are handed to gpuModulePreload by a module
+/// constructor. If \p streamGetter is not empty, streams are returned by calls
+/// to the function of that name, which has no arguments, and are never
+/// destroyed; it takes precedence over \p moduleStreams.
 void populateGpuxToLLVMPatternsAndLegality(mlir::LLVMTypeConverter &converter,
                                            mlir::RewritePatternSet &patterns,
-                                           mlir::ConversionTarget &target);
+                                           mlir::ConversionTarget &target,
+                                           bool moduleStreams = false,
+                                           bool packedKernelArgs = false,
+                                           bool batchKernelLaunches = false,
+                                           bool allocSiteTags = false,
+                                           bool preloadModules = false,
+                                           llvm::StringRef streamGetter = "");
 /// Creates a pass to convert a GPU operations into a sequence of GPU runtime
 /// calls.
 ///
@@ -49,6 +67,8 @@ void populateGpuxToLLVMPatternsAndLegality(mlir::LLVMTypeConverter &converter,
 /// typed ABI on top of GPU runtimes such as Level-Zero or SYCL
 std::unique_ptr<::mlir::OperationPass<::mlir::ModuleOp>>
 createConvertGPUXToLLVMPass();
+std::unique_ptr<::mlir::OperationPass<::mlir::ModuleOp>>
+createConvertGPUXToLLVMPass(const ConvertGPUXToLLVMOptions &options);
 
 } // namespace imex
 
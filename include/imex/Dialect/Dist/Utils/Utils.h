@@ -18,6 +18,7 @@
 #include <imex/Dialect/Dist/IR/DistOps.h>
 #include <imex/Dialect/DistRuntime/IR/DistRuntimeOps.h>
 #include <imex/Dialect/NDArray/IR/NDArrayOps.h>
+#include <llvm/ADT/STLExtras.h>
 #include <mlir/IR/Builders.h>
 #include <mlir/IR/Dominance.h>
 
@@ -64,6 +65,30 @@ getDistEnv(const ::imex::ndarray::NDArrayType &t) {
   return {};
 }
 
+/// @return true if any value is computed by a default_partition whose grid
+/// splits a dimension other than the first
+inline bool isGridPartitioned(::mlir::ValueRange vals) {
+  for (auto v : vals) {
+    auto defOp = v.getDefiningOp<::imex::dist::DefaultPartitionOp>();
+    if (!defOp || !defOp.getGrid()) {
+      continue;
+    }
+    auto grid = *defOp.getGrid();
+    if (grid.size() > 1 &&
+        llvm::any_of(grid.drop_front(), [](int64_t g) { return g != 1; })) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/// @return true if the local offsets of the distributed array come from a
+/// grid partition which splits a dimension other than the first
+inline bool hasGridPartition(::mlir::Value ary) {
+  auto initOp = ary.getDefiningOp<::imex::dist::InitDistArrayOp>();
+  return initOp && isGridPartitioned(initOp.getLOffset());
+}
+
 /// @return return NDArray's env attributes except DistEnvAttrs
 inline ::mlir::SmallVector<::mlir::Attribute>
 getNonDistEnvs(const ::imex::ndarray::NDArrayType &t) {
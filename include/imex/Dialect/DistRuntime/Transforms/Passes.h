@@ -35,9 +35,11 @@ namespace imex {
 std::unique_ptr<::mlir::Pass> createDistRuntimeToIDTRPass();
 std::unique_ptr<::mlir::Pass> createOverlapCommAndComputePass();
 std::unique_ptr<::mlir::Pass> createAddCommCacheKeysPass();
+std::unique_ptr<::mlir::Pass> createBatchAllReducesPass();
 
 #define GEN_PASS_DECL_OVERLAPCOMMANDCOMPUTE
 #define GEN_PASS_DECL_ADDCOMMCACHEKEYS
+#define GEN_PASS_DECL_BATCHALLREDUCES
 #define GEN_PASS_DECL_LOWERDISTRUNTIMETOIDTR
 #include <imex/Dialect/DistRuntime/Transforms/Passes.h.inc>
 
@@ -8,6 +8,7 @@
 
 #include <llvm/ADT/SetVector.h>
 
+#include "imex/Dialect/XeTile/Transforms/BlockingTuning.h"
 #include "imex/Utils/XeArch.h"
 
 namespace imex {
@@ -43,8 +44,12 @@ llvm::raw_ostream &operator<<(llvm::raw_ostream &os, Block blk);
 
 class BlockingAnalysis {
 public:
-  explicit BlockingAnalysis(std::shared_ptr<XeuArchInterface> uArch) {
+  /// If \p tuner is given, the tunable block sizes are selected by it
+  /// instead of the fixed heuristics.
+  explicit BlockingAnalysis(std::shared_ptr<XeuArchInterface> uArch,
+                            BlockingTuner *tuner = nullptr) {
     this->uArch = uArch;
+    this->tuner = tuner;
     this->target = nullptr;
   };
 
@@ -57,6 +62,7 @@ public:
 private:
   mlir::DataFlowSolver solver;
   std::shared_ptr<XeuArchInterface> uArch;
+  BlockingTuner *tuner;
   mlir::Operation *target;
 };
 
@@ -0,0 +1,78 @@
+//===- BlockingTuning.h - Tuning database for XeTile blocking ---*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file declares the tuning support of the xetile-blocking pass. The
+/// blocking analysis enumerates the legal candidates of its tunable parameters
+/// (the MMA sub-tile height of xetile.tile_mma and the block height of global
+/// xetile.load_tile) and asks the tuner to select one. The tuner returns the
+/// value recorded in its database for the op signature and architecture if
+/// there is one, the cheapest candidate according to the analysis' cost model
+/// in cost-model mode (recording it), and the heuristic choice otherwise.
+///
+/// The database is a text file with one entry per line:
+///   <arch> TAB <op signature> TAB <param>=<value>
+/// Lines starting with '#' are ignored. Entries can be written by an external
+/// benchmarking driver; values that are not legal candidates are ignored.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef IMEX_BLOCKING_TUNING_H
+#define IMEX_BLOCKING_TUNING_H
+
+#include <mlir/IR/Operation.h>
+#include <mlir/Support/LogicalResult.h>
+
+#include <llvm/ADT/STLFunctionalExtras.h>
+
+#include <map>
+#include <string>
+#include <tuple>
+
+namespace imex {
+
+class BlockingTuner {
+public:
+  enum class Mode {
+    // Use database entries, fall back to the heuristic.
+    Database,
+    // Use database entries, select and record the cheapest candidate for the
+    // others.
+    CostModel,
+  };
+
+  BlockingTuner(llvm::StringRef arch, Mode mode) : arch(arch), mode(mode) {}
+
+  /// Reads the entries of the database at \p path. A missing file is an empty
+  /// database.
+  mlir::LogicalResult load(llvm::StringRef path);
+
+  /// Writes all entries to the database at \p path.
+  mlir::LogicalResult save(llvm::StringRef path) const;
+
+  /// Selects the value of parameter \p param of the op with signature \p sig
+  /// among \p candidates. \p cost returns the estimated cost of a candidate.
+  int64_t select(llvm::StringRef sig, llvm::StringRef param,
+                 llvm::ArrayRef<int64_t> candidates, int64_t heuristic,
+                 llvm::function_ref<double(int64_t)> cost);
+
+  /// Returns the signature of \p op used as database key: the op name and
+  /// its operand and result types.
+  static std::string getSignature(mlir::Operation *op);
+
+private:
+  std::string arch;
+  Mode mode;
+  // Values keyed by (arch, signature, param).
+  std::map<std::tuple<std::string, std::string, std::string>, int64_t> entries;
+};
+
+} // namespace imex
+
+#endif // IMEX_BLOCKING_TUNING_H
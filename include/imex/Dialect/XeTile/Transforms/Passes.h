@@ -42,12 +42,24 @@ std::unique_ptr<mlir::Pass> createXeTileWgToSgPass();
 std::unique_ptr<mlir::Pass> createXeTileCanonicalizationPass();
 std::unique_ptr<mlir::Pass>
 createXeTileBlockOpFallbackPass(const std::string &device = "pvc");
+std::unique_ptr<mlir::Pass> createXeTileLoopPipeliningPass();
+std::unique_ptr<mlir::Pass> createXeTileSplitKPass();
+std::unique_ptr<mlir::Pass> createXeTileEpilogueFusionPass();
+std::unique_ptr<mlir::Pass> createXeTilePersistentKernelPass();
+std::unique_ptr<mlir::Pass> createXeTileProducerConsumerPass();
+std::unique_ptr<mlir::Pass> createXeTileCacheHintsPass();
 
 #define GEN_PASS_DECL_XETILEBLOCKING
 #define GEN_PASS_DECL_XETILECANONICALIZATION
 #define GEN_PASS_DECL_XETILEINITDUPLICATE
 #define GEN_PASS_DECL_XETILEWGTOSG
 #define GEN_PASS_DECL_XETILEBLOCKOPFALLBACK
+#define GEN_PASS_DECL_XETILELOOPPIPELINING
+#define GEN_PASS_DECL_XETILESPLITK
+#define GEN_PASS_DECL_XETILEEPILOGUEFUSION
+#define GEN_PASS_DECL_XETILEPERSISTENTKERNEL
+#define GEN_PASS_DECL_XETILEPRODUCERCONSUMER
+#define GEN_PASS_DECL_XETILECACHEHINTS
 #include <imex/Dialect/XeTile/Transforms/Passes.h.inc>
 
 //===----------------------------------------------------------------------===//
@@ -0,0 +1,31 @@
+//===- RegisterPressure.h - Register pressure of XeTile kernels -*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file declares the live-register estimator of blocked XeTile kernels,
+/// which is used by the xetile-blocking pass to select the GRF mode of each
+/// kernel.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef IMEX_REGISTER_PRESSURE_H
+#define IMEX_REGISTER_PRESSURE_H
+
+#include <mlir/IR/Operation.h>
+
+namespace imex {
+
+/// Returns the estimated peak number of GRFs of \p grfBits bits that are live
+/// at the same time in \p func. Vectors occupy the GRFs holding their data and
+/// tiles one GRF for their block descriptor; scalars are not counted.
+int64_t estimateRegisterPressure(mlir::Operation *func, unsigned grfBits);
+
+} // namespace imex
+
+#endif // IMEX_REGISTER_PRESSURE_H
@@ -0,0 +1,190 @@
+//===- DeviceProbe.h - GPU device capability queries ------------*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file implements the queries of the capabilities of a GPU that the
+/// compiler cares about, built on the Level Zero device properties: the
+/// architecture name used by the `device` option of the XeTile and XeGPU
+/// passes, the supported subgroup sizes, the number of EUs, the size of the
+/// shared local memory, the GRF modes, and the support of DPAS, bf16 and
+/// fp64.
+///
+/// The device probed is the one a stream of the runtime wrappers would use,
+/// see DeviceSelection.h.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef IMEX_EXECUTIONENGINE_DEVICEPROBE_H
+#define IMEX_EXECUTIONENGINE_DEVICEPROBE_H
+
+#include "imex/ExecutionEngine/DeviceSelection.h"
+
+#include <level_zero/ze_api.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace imex {
+
+struct DeviceCapabilities {
+  std::string name;
+  /// Architecture name as used by XeArch, e.g. "pvc", or empty if unknown.
+  std::string arch;
+  uint32_t deviceId = 0;
+  std::vector<uint32_t> subgroupSizes;
+  uint32_t numEUs = 0;
+  uint32_t slmSize = 0;
+  /// Number of GRF registers per thread of the supported GRF modes.
+  std::vector<uint32_t> grfModes;
+  bool hasDpas = false;
+  bool hasBF16 = false;
+  bool hasFP64 = false;
+};
+
+/// Returns the architecture name of the GPU with PCI device id \p deviceId,
+/// or an empty string if it is unknown.
+inline std::string getDeviceArch(uint32_t deviceId) {
+  switch (deviceId) {
+  case 0x0BD0:
+  case 0x0BD5: // Intel Data Center GPU Max 1550
+  case 0x0BD6:
+  case 0x0BD7:
+  case 0x0BD9:
+  case 0x0BDA: // Intel Data Center GPU Max 1100
+  case 0x0BDB:
+    return "pvc";
+  case 0x56A0: // Intel Arc A770
+  case 0x56A1: // Intel Arc A750
+  case 0x56C0: // Intel Data Center GPU Flex 170
+  case 0x56C1: // Intel Data Center GPU Flex 140
+    return "acm";
+  case 0x6420:
+  case 0x64A0: // Intel Arc 140V (Lunar Lake)
+    return "lnl";
+  case 0xE202:
+  case 0xE20B: // Intel Arc B580
+  case 0xE20C: // Intel Arc B570
+  case 0xE20D:
+  case 0xE212:
+    return "bmg";
+  default:
+    return "";
+  }
+}
+
+namespace detail {
+inline void checkZeResult(ze_result_t result, const char *call) {
+  if (result != ZE_RESULT_SUCCESS)
+    throw std::runtime_error(std::string(call) + " failed with " +
+                             std::to_string(result));
+}
+} // namespace detail
+
+#define IMEX_PROBE_ZE_CALL(call) imex::detail::checkZeResult(call, #call)
+
+/// Returns the capabilities of \p device.
+inline DeviceCapabilities probeDevice(ze_device_handle_t device) {
+  DeviceCapabilities caps;
+  ze_device_properties_t deviceProperties = {};
+  deviceProperties.stype = ZE_STRUCTURE_TYPE_DEVICE_PROPERTIES;
+  IMEX_PROBE_ZE_CALL(zeDeviceGetProperties(device, &deviceProperties));
+  caps.name = deviceProperties.name;
+  caps.deviceId = deviceProperties.deviceId;
+  caps.arch = getDeviceArch(caps.deviceId);
+  caps.numEUs = deviceProperties.numSlices *
+                deviceProperties.numSubslicesPerSlice *
+                deviceProperties.numEUsPerSubslice;
+
+  ze_device_compute_properties_t computeProperties = {};
+  computeProperties.stype = ZE_STRUCTURE_TYPE_DEVICE_COMPUTE_PROPERTIES;
+  IMEX_PROBE_ZE_CALL(zeDeviceGetComputeProperties(device, &computeProperties));
+  caps.subgroupSizes.assign(computeProperties.subGroupSizes,
+                            computeProperties.subGroupSizes +
+                                computeProperties.numSubGroupSizes);
+  caps.slmSize = computeProperties.maxSharedLocalMemory;
+
+  ze_device_module_properties_t moduleProperties = {};
+  moduleProperties.stype = ZE_STRUCTURE_TYPE_DEVICE_MODULE_PROPERTIES;
+  IMEX_PROBE_ZE_CALL(zeDeviceGetModuleProperties(device, &moduleProperties));
+  caps.hasFP64 = moduleProperties.fp64flags != 0;
+
+  // Level Zero has no core query for the matrix engine and the GRF modes;
+  // they follow from the architecture. Devices with DPAS also convert and
+  // multiply bf16.
+  caps.hasDpas = !caps.arch.empty();
+  caps.hasBF16 = caps.hasDpas;
+  caps.grfModes = {128};
+  if (caps.arch == "pvc" || caps.arch == "lnl" || caps.arch == "bmg")
+    caps.grfModes.push_back(256);
+  return caps;
+}
+
+/// Returns the capabilities of the GPU a stream would be created on.
+inline DeviceCapabilities probeDefaultDevice() {
+  IMEX_PROBE_ZE_CALL(zeInit(ZE_INIT_FLAG_GPU_ONLY));
+  uint32_t driverCount = 0;
+  IMEX_PROBE_ZE_CALL(zeDriverGet(&driverCount, nullptr));
+  std::vector<ze_driver_handle_t> drivers(driverCount);
+  IMEX_PROBE_ZE_CALL(zeDriverGet(&driverCount, drivers.data()));
+
+  std::vector<ze_device_handle_t> gpus;
+  std::vector<uint32_t> subDeviceCounts;
+  for (auto driver : drivers) {
+    uint32_t deviceCount = 0;
+    IMEX_PROBE_ZE_CALL(zeDeviceGet(driver, &deviceCount, nullptr));
+    std::vector<ze_device_handle_t> devices(deviceCount);
+    IMEX_PROBE_ZE_CALL(zeDeviceGet(driver, &deviceCount, devices.data()));
+    for (auto device : devices) {
+      ze_device_properties_t deviceProperties = {};
+      deviceProperties.stype = ZE_STRUCTURE_TYPE_DEVICE_PROPERTIES;
+      IMEX_PROBE_ZE_CALL(zeDeviceGetProperties(device, &deviceProperties));
+      if (deviceProperties.type != ZE_DEVICE_TYPE_GPU)
+        continue;
+      uint32_t subDeviceCount = 0;
+      IMEX_PROBE_ZE_CALL(
+          zeDeviceGetSubDevices(device, &subDeviceCount, nullptr));
+      gpus.push_back(device);
+      subDeviceCounts.push_back(subDeviceCount);
+    }
+  }
+
+  // Sub-devices of a device share its capabilities.
+  auto selection = resolveDeviceSelection({}, subDeviceCounts);
+  return probeDevice(gpus[selection.device]);
+}
+
+#undef IMEX_PROBE_ZE_CALL
+
+/// Prints \p caps as "key=value" lines, lists are comma separated.
+inline void printDeviceCapabilities(FILE *file,
+                                    const DeviceCapabilities &caps) {
+  auto join = [](const std::vector<uint32_t> &values) {
+    std::string str;
+    for (auto value : values)
+      str += (str.empty() ? "" : ",") + std::to_string(value);
+    return str;
+  };
+  fprintf(file, "name=%s\n", caps.name.c_str());
+  fprintf(file, "arch=%s\n", caps.arch.c_str());
+  fprintf(file, "device_id=0x%04x\n", caps.deviceId);
+  fprintf(file, "subgroup_sizes=%s\n", join(caps.subgroupSizes).c_str());
+  fprintf(file, "eu_count=%u\n", caps.numEUs);
+  fprintf(file, "slm_size=%u\n", caps.slmSize);
+  fprintf(file, "grf_modes=%s\n", join(caps.grfModes).c_str());
+  fprintf(file, "dpas=%d\n", caps.hasDpas);
+  fprintf(file, "bf16=%d\n", caps.hasBF16);
+  fprintf(file, "fp64=%d\n", caps.hasFP64);
+}
+
+} // namespace imex
+
+#endif // IMEX_EXECUTIONENGINE_DEVICEPROBE_H
@@ -0,0 +1,124 @@
+//===- DeviceSelection.h - GPU device and tile selection --------*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file implements the device selection policy shared by the Level Zero
+/// and SYCL runtime wrappers. A stream is created on a device and optionally
+/// on one of its sub-devices (tiles, e.g. the two stacks of a PVC card).
+///
+/// The selection is controlled by the stream-creation API and by environment
+/// variables:
+///   IMEX_DEVICE       - "<device>[.<sub-device>]", used when the API does not
+///                       request a device.
+///   IMEX_SCALING_MODE - "implicit" (default) uses whole devices and lets the
+///                       driver spread work over their tiles; "explicit" binds
+///                       each stream to a single tile. Without a requested
+///                       device, the tile is chosen from the node-local rank
+///                       set by the MPI launcher so that each rank of a
+///                       distributed program gets its own tile.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef IMEX_EXECUTIONENGINE_DEVICESELECTION_H
+#define IMEX_EXECUTIONENGINE_DEVICESELECTION_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace imex {
+
+/// Device requested for a new stream.
+struct DeviceSelection {
+  /// Index of the device, or -1 for the default device.
+  int64_t device = -1;
+  /// Index of the sub-device of the device, or -1 for the whole device.
+  int64_t subDevice = -1;
+};
+
+enum class ScalingMode { Implicit, Explicit };
+
+inline ScalingMode getScalingMode() {
+  auto mode = getenv("IMEX_SCALING_MODE");
+  if (!mode || !strcmp(mode, "implicit"))
+    return ScalingMode::Implicit;
+  if (!strcmp(mode, "explicit"))
+    return ScalingMode::Explicit;
+  throw std::runtime_error(std::string("Invalid IMEX_SCALING_MODE: ") + mode);
+}
+
+/// Returns the node-local rank of the process set by common MPI launchers, or
+/// 0 if there is none.
+inline int64_t getLocalRank() {
+  for (auto name : {"MPI_LOCALRANKID", "PMI_LOCAL_RANK", "PALS_LOCAL_RANKID",
+                    "OMPI_COMM_WORLD_LOCAL_RANK", "SLURM_LOCALID"}) {
+    if (auto rank = getenv(name))
+      return std::strtoll(rank, nullptr, 10);
+  }
+  return 0;
+}
+
+/// Resolves \p selection to concrete indices, given the number of sub-devices
+/// of each available device (0 for devices that cannot be partitioned). The
+/// returned sub-device is -1 if the whole device is to be used.
+inline DeviceSelection
+resolveDeviceSelection(DeviceSelection selection,
+                       const std::vector<uint32_t> &subDeviceCounts) {
+  if (subDeviceCounts.empty())
+    throw std::runtime_error("No device found");
+
+  if (selection.device < 0 && selection.subDevice < 0) {
+    if (auto env = getenv("IMEX_DEVICE")) {
+      char *end = nullptr;
+      selection.device = std::strtoll(env, &end, 10);
+      if (*end == '.')
+        selection.subDevice = std::strtoll(end + 1, nullptr, 10);
+    }
+  }
+
+  if (getScalingMode() == ScalingMode::Explicit && selection.subDevice < 0) {
+    auto rank = getLocalRank();
+    if (selection.device >= 0) {
+      // Bind to one tile of the requested device.
+      auto device = static_cast<size_t>(selection.device);
+      if (device < subDeviceCounts.size() && subDeviceCounts[device])
+        selection.subDevice = rank % subDeviceCounts[device];
+    } else {
+      // Bind to one tile of all tiles of the node.
+      std::vector<DeviceSelection> tiles;
+      for (size_t d = 0; d < subDeviceCounts.size(); ++d) {
+        auto device = static_cast<int64_t>(d);
+        if (!subDeviceCounts[d])
+          tiles.push_back({device, -1});
+        for (uint32_t s = 0; s < subDeviceCounts[d]; ++s)
+          tiles.push_back({device, static_cast<int64_t>(s)});
+      }
+      selection = tiles[rank % tiles.size()];
+    }
+  }
+
+  if (selection.device < 0)
+    selection.device = 0;
+  if (static_cast<size_t>(selection.device) >= subDeviceCounts.size())
+    throw std::runtime_error("Invalid device index " +
+                             std::to_string(selection.device));
+  if (selection.subDevice >= 0 &&
+      static_cast<uint32_t>(selection.subDevice) >=
+          subDeviceCounts[selection.device])
+    throw std::runtime_error("Invalid sub-device index " +
+                             std::to_string(selection.subDevice));
+  return selection;
+}
+
+} // namespace imex
+
+#endif // IMEX_EXECUTIONENGINE_DEVICESELECTION_H
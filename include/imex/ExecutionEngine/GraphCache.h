@@ -0,0 +1,159 @@
+//===- GraphCache.h - Deferred execution of recorded graphs -----*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file declares the deferred execution mode for front-ends that drive
+/// IMEX one NDArray operation at a time, e.g. from a Python array API. A
+/// GraphRecorder collects the operations into one function until a value
+/// leaves the NDArrays and becomes host visible, then the whole function gets
+/// compiled at once, so the pipeline can fuse across the recorded operations.
+/// Compiled graphs are cached by their chain of operations and types, which
+/// include the shapes of the arrays, so recording the same operations again
+/// only costs the lookup.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef IMEX_EXECUTIONENGINE_GRAPHCACHE_H
+#define IMEX_EXECUTIONENGINE_GRAPHCACHE_H
+
+#include "imex/ExecutionEngine/Session.h"
+
+#include <mlir/Dialect/Func/IR/FuncOps.h>
+#include <mlir/IR/Builders.h>
+#include <mlir/IR/BuiltinOps.h>
+#include <mlir/IR/OwningOpRef.h>
+
+#include <llvm/ADT/SetVector.h>
+#include <llvm/Support/Error.h>
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace imex {
+
+/// Returns the key under which the graph \p func is cached: the chain of its
+/// operations, each with its name, attributes, operands numbered by position
+/// and result types, after the types of the arguments. Locations and value
+/// names are not part of it, so graphs recorded from the same operations on
+/// arrays of the same types share their key.
+std::string getGraphKey(mlir::func::FuncOp func);
+
+/// A function of a compiled graph. It keeps the session of the graph alive,
+/// also after the graph was evicted from its cache.
+struct CompiledGraph {
+  std::shared_ptr<Session> session;
+  Session::Function function;
+
+  /// Calls the function, see Session::Function::invoke.
+  void invoke(llvm::MutableArrayRef<void *> args) const {
+    function.invoke(args);
+  }
+};
+
+/// Sessions compiled from recorded graphs, keyed by getGraphKey. Graphs are
+/// compiled outside of the lock of the cache, concurrent requests for the
+/// same graph wait for a single compilation. The least recently used graphs
+/// are evicted once there are more than the maximum number of graphs.
+class GraphCache {
+public:
+  /// \p options set up the compilation of the graphs, its buildPipeline
+  /// lowers them to the LLVM dialect. At most \p maxGraphs graphs are cached,
+  /// 0 means no limit.
+  explicit GraphCache(SessionOptions options, size_t maxGraphs = 64)
+      : options_(std::move(options)), maxGraphs_(maxGraphs) {}
+
+  /// Returns the function \p name of the session compiled from \p module,
+  /// compiling a copy of the module if \p key is new. Failed compilations are
+  /// not cached.
+  llvm::Expected<CompiledGraph> getOrCompile(const std::string &key,
+                                             mlir::ModuleOp module,
+                                             llvm::StringRef name);
+
+  /// Returns the number of cached graphs.
+  size_t size() const;
+
+private:
+  struct Entry {
+    std::mutex mutex;
+    std::shared_ptr<Session> session;
+  };
+  using LRUList = std::list<std::string>;
+
+  SessionOptions options_;
+  size_t maxGraphs_;
+  // Guards entries_ and lru_, not the compilation of the entries.
+  mutable std::mutex mutex_;
+  std::unordered_map<std::string,
+                     std::pair<std::shared_ptr<Entry>, LRUList::iterator>>
+      entries_;
+  // Keys of the entries, the most recently used first.
+  LRUList lru_;
+};
+
+/// Records NDArray operations into the function of a graph and compiles it
+/// through a GraphCache when its results are needed. Operations with NDArray
+/// operands and results of other types, e.g. ndarray.dim or ndarray.load,
+/// make their results host visible. The results of a graph are its host
+/// visible values, followed by the arrays it produced which were not
+/// released.
+class GraphRecorder : private mlir::OpBuilder::Listener {
+public:
+  /// Name of the function of the recorded graphs.
+  static constexpr llvm::StringLiteral functionName = "graph";
+
+  GraphRecorder(mlir::MLIRContext &context, GraphCache &cache);
+
+  /// Returns a builder appending operations to the graph.
+  mlir::OpBuilder &getBuilder() { return builder_; }
+
+  /// Adds an input of type \p type to the graph and returns its value.
+  mlir::Value addInput(mlir::Type type);
+
+  /// Makes \p value a result of the graph, as if it was host visible.
+  void markHostVisible(mlir::Value value) { hostVisible_.insert(value); }
+
+  /// Notes that the front-end dropped the array \p value, which thus is no
+  /// result of the graph unless it is host visible.
+  void release(mlir::Value value) { liveArrays_.remove(value); }
+
+  /// Returns whether a recorded value became host visible, so the graph has
+  /// to run before the front-end can return it.
+  bool needsFlush() const { return !hostVisible_.empty(); }
+
+  /// Returns the results the graph would have if flushed now.
+  llvm::SmallVector<mlir::Value> getResults() const;
+
+  /// Ends the graph with getResults(), returns its compiled function and
+  /// starts recording a new graph. The function takes the inputs in the order
+  /// they were added, followed by the storage of the results, as for
+  /// Session::Function::invoke.
+  llvm::Expected<CompiledGraph> flush();
+
+private:
+  void notifyOperationInserted(mlir::Operation *op,
+                               mlir::OpBuilder::InsertPoint previous) override;
+
+  void reset();
+
+  mlir::MLIRContext &context_;
+  GraphCache &cache_;
+  mlir::OwningOpRef<mlir::ModuleOp> module_;
+  mlir::func::FuncOp func_;
+  mlir::OpBuilder builder_;
+  llvm::SetVector<mlir::Value> hostVisible_;
+  llvm::SetVector<mlir::Value> liveArrays_;
+};
+
+} // namespace imex
+
+#endif // IMEX_EXECUTIONENGINE_GRAPHCACHE_H
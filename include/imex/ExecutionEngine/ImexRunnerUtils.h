@@ -48,16 +48,28 @@ template <typename T>
 void _mlir_ciface_fillResource1DRandom(UnrankedMemRefType<T> *ptr,
                                        const float lower, const float upper,
                                        const bool genInt);
+template <typename T>
+void _mlir_ciface_fillResourceRandom(UnrankedMemRefType<T> *ptr,
+                                     const float lower, const float upper,
+                                     const bool genInt, const int64_t seed);
 
 template <typename T> void _mlir_ciface_printMemref(UnrankedMemRefType<T> *M);
 
 template <typename T>
 bool _mlir_ciface_allclose(UnrankedMemRefType<T> *M,
                            UnrankedMemRefType<float> *N);
+template <typename T>
+bool _mlir_ciface_allclose(UnrankedMemRefType<T> *M,
+                           UnrankedMemRefType<float> *N, float rtol,
+                           float atol);
 
 template <typename T>
 void _mlir_ciface_printAllclose(UnrankedMemRefType<T> *M,
                                 UnrankedMemRefType<float> *N);
+template <typename T>
+void _mlir_ciface_printAllclose(UnrankedMemRefType<T> *M,
+                                UnrankedMemRefType<float> *N, float rtol,
+                                float atol);
 
 template <typename T>
 void _mlir_ciface_printMaxError(UnrankedMemRefType<T> *M,
@@ -77,6 +89,19 @@ _mlir_ciface_fillResource1DRandomF32(UnrankedMemRefType<float> *ptr,
                                      const float lower, const float upper,
                                      const bool genInt);
 
+extern "C" IMEX_RUNNERUTILS_EXPORT void
+_mlir_ciface_fillResourceRandomBF16(UnrankedMemRefType<bf16> *ptr,
+                                    const float lower, const float upper,
+                                    const bool genInt, const int64_t seed);
+extern "C" IMEX_RUNNERUTILS_EXPORT void
+_mlir_ciface_fillResourceRandomF16(UnrankedMemRefType<f16> *ptr,
+                                   const float lower, const float upper,
+                                   const bool genInt, const int64_t seed);
+extern "C" IMEX_RUNNERUTILS_EXPORT void
+_mlir_ciface_fillResourceRandomF32(UnrankedMemRefType<float> *ptr,
+                                   const float lower, const float upper,
+                                   const bool genInt, const int64_t seed);
+
 extern "C" IMEX_RUNNERUTILS_EXPORT void
 _mlir_ciface_printMemrefBF16(UnrankedMemRefType<bf16> *m);
 extern "C" IMEX_RUNNERUTILS_EXPORT void
@@ -96,6 +121,19 @@ extern "C" IMEX_RUNNERUTILS_EXPORT bool
 _mlir_ciface_allcloseF32(UnrankedMemRefType<float> *M,
                          UnrankedMemRefType<float> *N);
 
+extern "C" IMEX_RUNNERUTILS_EXPORT bool
+_mlir_ciface_allcloseTolBF16(UnrankedMemRefType<bf16> *M,
+                             UnrankedMemRefType<float> *N, float rtol,
+                             float atol);
+extern "C" IMEX_RUNNERUTILS_EXPORT bool
+_mlir_ciface_allcloseTolF16(UnrankedMemRefType<f16> *M,
+                            UnrankedMemRefType<float> *N, float rtol,
+                            float atol);
+extern "C" IMEX_RUNNERUTILS_EXPORT bool
+_mlir_ciface_allcloseTolF32(UnrankedMemRefType<float> *M,
+                            UnrankedMemRefType<float> *N, float rtol,
+                            float atol);
+
 extern "C" IMEX_RUNNERUTILS_EXPORT void
 _mlir_ciface_printAllcloseBF16(UnrankedMemRefType<bf16> *M,
                                UnrankedMemRefType<float> *N);
@@ -106,6 +144,19 @@ extern "C" IMEX_RUNNERUTILS_EXPORT void
 _mlir_ciface_printAllcloseF32(UnrankedMemRefType<float> *M,
                               UnrankedMemRefType<float> *N);
 
+extern "C" IMEX_RUNNERUTILS_EXPORT void
+_mlir_ciface_printAllcloseTolBF16(UnrankedMemRefType<bf16> *M,
+                                  UnrankedMemRefType<float> *N, float rtol,
+                                  float atol);
+extern "C" IMEX_RUNNERUTILS_EXPORT void
+_mlir_ciface_printAllcloseTolF16(UnrankedMemRefType<f16> *M,
+                                 UnrankedMemRefType<float> *N, float rtol,
+                                 float atol);
+extern "C" IMEX_RUNNERUTILS_EXPORT void
+_mlir_ciface_printAllcloseTolF32(UnrankedMemRefType<float> *M,
+                                 UnrankedMemRefType<float> *N, float rtol,
+                                 float atol);
+
 extern "C" IMEX_RUNNERUTILS_EXPORT void
 _mlir_ciface_printMaxErrorF16(UnrankedMemRefType<f16> *M,
                               UnrankedMemRefType<f16> *N);
@@ -118,4 +169,20 @@ extern "C" IMEX_RUNNERUTILS_EXPORT void
 _mlir_ciface_printMaxErrorF32(UnrankedMemRefType<float> *M,
                               UnrankedMemRefType<float> *N);
 
+extern "C" IMEX_RUNNERUTILS_EXPORT void
+_mlir_ciface_loadExternalDataF32(UnrankedMemRefType<float> *M,
+                                 UnrankedMemRefType<int8_t> *P);
+extern "C" IMEX_RUNNERUTILS_EXPORT void
+_mlir_ciface_loadExternalDataF16(UnrankedMemRefType<f16> *M,
+                                 UnrankedMemRefType<int8_t> *P);
+extern "C" IMEX_RUNNERUTILS_EXPORT void
+_mlir_ciface_loadExternalDataBF16(UnrankedMemRefType<bf16> *M,
+                                  UnrankedMemRefType<int8_t> *P);
+extern "C" IMEX_RUNNERUTILS_EXPORT void
+_mlir_ciface_loadExternalDataI32(UnrankedMemRefType<int32_t> *M,
+                                 UnrankedMemRefType<int8_t> *P);
+extern "C" IMEX_RUNNERUTILS_EXPORT void
+_mlir_ciface_loadExternalDataI8(UnrankedMemRefType<int8_t> *M,
+                                UnrankedMemRefType<int8_t> *P);
+
 #endif // IMEX_EXECUTIONENGINE_IMEXRUNNERUTILS_H
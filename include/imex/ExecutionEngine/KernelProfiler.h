@@ -0,0 +1,297 @@
+//===- KernelProfiler.h - Per-kernel launch profiling -----------*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file implements the launch profiler shared by the Level Zero and SYCL
+/// runtime wrappers. When IMEX_PROFILING_OUTPUT is set, the device execution
+/// time of every kernel launch of the program is recorded, keyed by kernel
+/// name, grid and block size. At exit a summary with count, total, mean,
+/// median, p90, p99, min, max and standard deviation per key is written to
+/// the given file, as CSV if its name ends in ".csv" and as JSON otherwise;
+/// "-" writes JSON to stdout.
+///
+/// Unlike IMEX_ENABLE_PROFILING, which re-runs each launch many times in
+/// isolation, this profiles the real launches of a whole program.
+///
+/// Kernels compiled with imex-estimate-kernel-cost also report the bytes and
+/// flops of a launch, derived from the estimates per work item and the launch
+/// size, and the achieved GB/s and GFLOP/s at the median time. If the peaks
+/// of the device are given in IMEX_PEAK_GBPS and IMEX_PEAK_GFLOPS, the
+/// percentage of the roofline, i.e. of the attainable FLOP rate at the
+/// arithmetic intensity of the kernel (or of the peak bandwidth for kernels
+/// without flops), is reported as well.
+///
+/// Runtimes that can read hardware counters (Level Zero, with
+/// IMEX_PROFILING_METRICS naming a metric group) also report the mean EU
+/// active and stall percentages, L3 hit rate and GTI bandwidth of each key.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef IMEX_EXECUTIONENGINE_KERNELPROFILER_H
+#define IMEX_EXECUTIONENGINE_KERNELPROFILER_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace imex {
+
+class KernelProfiler {
+public:
+  struct Key {
+    std::string name;
+    uint32_t grid[3];
+    uint32_t block[3];
+
+    bool operator<(const Key &rhs) const {
+      return std::tie(name, grid[0], grid[1], grid[2], block[0], block[1],
+                      block[2]) < std::tie(rhs.name, rhs.grid[0], rhs.grid[1],
+                                           rhs.grid[2], rhs.block[0],
+                                           rhs.block[1], rhs.block[2]);
+    }
+  };
+
+  /// Returns the process-wide profiler, or null if profiling is disabled.
+  static KernelProfiler *get() {
+    static std::unique_ptr<KernelProfiler> profiler(
+        getenv("IMEX_PROFILING_OUTPUT")
+            ? new KernelProfiler(getenv("IMEX_PROFILING_OUTPUT"))
+            : nullptr);
+    return profiler.get();
+  }
+
+  KernelProfiler(const KernelProfiler &) = delete;
+  KernelProfiler &operator=(const KernelProfiler &) = delete;
+
+  ~KernelProfiler() { write(); }
+
+  /// Associates a kernel handle with its name.
+  void registerKernel(const void *kernel, const std::string &name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    names_[kernel] = name;
+  }
+
+  /// Sets the estimated bytes moved and flops executed per work item of a
+  /// kernel.
+  void setCost(const void *kernel, int64_t bytesPerItem, int64_t flopsPerItem) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = names_.find(kernel);
+    if (it != names_.end())
+      costs_[it->second] = {bytesPerItem, flopsPerItem};
+  }
+
+  Key getKey(const void *kernel, size_t gridX, size_t gridY, size_t gridZ,
+             size_t blockX, size_t blockY, size_t blockZ) {
+    auto cast = [](size_t val) { return static_cast<uint32_t>(val); };
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = names_.find(kernel);
+    return {it != names_.end() ? it->second : "<unknown>",
+            {cast(gridX), cast(gridY), cast(gridZ)},
+            {cast(blockX), cast(blockY), cast(blockZ)}};
+  }
+
+  /// Hardware counters of one launch, negative if not available.
+  struct Metrics {
+    double euActive = -1, euStall = -1, l3Hit = -1, gtiGbps = -1;
+  };
+
+  /// Records one launch of \p key that took \p ns nanoseconds on the device.
+  void record(const Key &key, uint64_t ns) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    samples_[key].push_back(ns);
+  }
+
+  /// Records the hardware counters of one launch of \p key.
+  void recordMetrics(const Key &key, const Metrics &metrics) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto &sums = metrics_[key];
+    double values[] = {metrics.euActive, metrics.euStall, metrics.l3Hit,
+                       metrics.gtiGbps};
+    for (int i = 0; i < 4; ++i) {
+      if (values[i] < 0)
+        continue;
+      sums.sum[i] += values[i];
+      ++sums.count[i];
+    }
+  }
+
+private:
+  explicit KernelProfiler(std::string path) : path_(std::move(path)) {
+    if (auto peak = getenv("IMEX_PEAK_GBPS"))
+      peakGbps_ = atof(peak);
+    if (auto peak = getenv("IMEX_PEAK_GFLOPS"))
+      peakGflops_ = atof(peak);
+  }
+
+  struct Summary {
+    size_t count;
+    double total, mean, median, p90, p99, min, max, stddev;
+  };
+
+  struct Cost {
+    int64_t bytesPerItem, flopsPerItem;
+  };
+
+  // Sums and counts of the known values of each Metrics field.
+  struct MetricSums {
+    double sum[4] = {};
+    size_t count[4] = {};
+
+    double mean(int i) const { return count[i] ? sum[i] / count[i] : -1; }
+  };
+
+  // Roofline figures of one key at the median time, negative if unknown.
+  struct Roofline {
+    double bytes = -1, flops = -1, gbps = -1, gflops = -1, percent = -1;
+  };
+
+  Roofline getRoofline(const Key &key, double medianMs) const {
+    Roofline res;
+    auto it = costs_.find(key.name);
+    if (it == costs_.end() || medianMs <= 0)
+      return res;
+    double items = 1;
+    for (int i = 0; i < 3; ++i)
+      items *= static_cast<double>(key.grid[i]) * key.block[i];
+    res.bytes = items * it->second.bytesPerItem;
+    res.flops = items * it->second.flopsPerItem;
+    res.gbps = res.bytes / (medianMs * 1e6);
+    res.gflops = res.flops / (medianMs * 1e6);
+    if (peakGbps_ <= 0)
+      return res;
+    if (res.flops > 0 && peakGflops_ > 0) {
+      auto intensity = res.bytes > 0 ? res.flops / res.bytes : INFINITY;
+      res.percent =
+          100 * res.gflops / std::min(peakGflops_, intensity * peakGbps_);
+    } else if (res.flops == 0) {
+      res.percent = 100 * res.gbps / peakGbps_;
+    }
+    return res;
+  }
+
+  // Prints \p val or, if it is negative, an empty CSV field or JSON null.
+  static void printOptional(FILE *file, const char *key, double val, bool csv) {
+    if (csv)
+      val < 0 ? fprintf(file, ",") : fprintf(file, ",%f", val);
+    else if (val < 0)
+      fprintf(file, ", \"%s\": null", key);
+    else
+      fprintf(file, ", \"%s\": %f", key, val);
+  }
+
+  // Computes the summary of the given samples in milliseconds. Percentiles
+  // use the nearest-rank method.
+  static Summary summarize(std::vector<uint64_t> samples) {
+    std::sort(samples.begin(), samples.end());
+    auto ms = [](uint64_t ns) { return static_cast<double>(ns) / 1e6; };
+    auto percentile = [&](double p) {
+      auto rank = static_cast<size_t>(std::ceil(p * samples.size()));
+      return ms(samples[std::max<size_t>(rank, 1) - 1]);
+    };
+
+    Summary summary = {};
+    summary.count = samples.size();
+    for (auto sample : samples)
+      summary.total += ms(sample);
+    summary.mean = summary.total / summary.count;
+    for (auto sample : samples)
+      summary.stddev += std::pow(ms(sample) - summary.mean, 2);
+    summary.stddev = std::sqrt(summary.stddev / summary.count);
+    summary.median = percentile(0.5);
+    summary.p90 = percentile(0.9);
+    summary.p99 = percentile(0.99);
+    summary.min = ms(samples.front());
+    summary.max = ms(samples.back());
+    return summary;
+  }
+
+  void write() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    bool csv = path_.size() >= 4 && path_.substr(path_.size() - 4) == ".csv";
+    auto file = path_ == "-" ? stdout : fopen(path_.c_str(), "w");
+    if (!file) {
+      fprintf(stderr, "Cannot open profiling output %s\n", path_.c_str());
+      return;
+    }
+
+    if (csv)
+      fprintf(file, "kernel,grid_x,grid_y,grid_z,block_x,block_y,block_z,"
+                    "count,total_ms,mean_ms,median_ms,p90_ms,p99_ms,min_ms,"
+                    "max_ms,stddev_ms,bytes,flops,gbps,gflops,roofline_pct,"
+                    "eu_active_pct,eu_stall_pct,l3_hit_pct,gti_gbps\n");
+    else
+      fprintf(file, "{\n  \"kernels\": [");
+    bool first = true;
+    for (auto &[key, samples] : samples_) {
+      auto s = summarize(samples);
+      auto r = getRoofline(key, s.median);
+      if (csv) {
+        fprintf(file, "%s,%u,%u,%u,%u,%u,%u,%zu,%f,%f,%f,%f,%f,%f,%f,%f",
+                key.name.c_str(), key.grid[0], key.grid[1], key.grid[2],
+                key.block[0], key.block[1], key.block[2], s.count, s.total,
+                s.mean, s.median, s.p90, s.p99, s.min, s.max, s.stddev);
+      } else {
+        fprintf(file,
+                "%s\n    {\"kernel\": \"%s\", \"grid\": [%u, %u, %u], "
+                "\"block\": [%u, %u, %u], \"count\": %zu, \"total_ms\": %f, "
+                "\"mean_ms\": %f, \"median_ms\": %f, \"p90_ms\": %f, "
+                "\"p99_ms\": %f, \"min_ms\": %f, \"max_ms\": %f, "
+                "\"stddev_ms\": %f",
+                first ? "" : ",", key.name.c_str(), key.grid[0], key.grid[1],
+                key.grid[2], key.block[0], key.block[1], key.block[2],
+                s.count, s.total, s.mean, s.median, s.p90, s.p99, s.min, s.max,
+                s.stddev);
+        first = false;
+      }
+      printOptional(file, "bytes", r.bytes, csv);
+      printOptional(file, "flops", r.flops, csv);
+      printOptional(file, "gbps", r.gbps, csv);
+      printOptional(file, "gflops", r.gflops, csv);
+      printOptional(file, "roofline_pct", r.percent, csv);
+      auto m = metrics_.find(key);
+      auto metric = [&](int i) {
+        return m != metrics_.end() ? m->second.mean(i) : -1.0;
+      };
+      printOptional(file, "eu_active_pct", metric(0), csv);
+      printOptional(file, "eu_stall_pct", metric(1), csv);
+      printOptional(file, "l3_hit_pct", metric(2), csv);
+      printOptional(file, "gti_gbps", metric(3), csv);
+      fprintf(file, csv ? "\n" : "}");
+    }
+    if (!csv)
+      fprintf(file, "\n  ]\n}\n");
+
+    if (file == stdout)
+      fflush(file);
+    else
+      fclose(file);
+  }
+
+  std::string path_;
+  std::mutex mutex_;
+  std::map<const void *, std::string> names_;
+  std::map<std::string, Cost> costs_;
+  double peakGbps_ = 0;
+  double peakGflops_ = 0;
+  std::map<Key, std::vector<uint64_t>> samples_;
+  std::map<Key, MetricSums> metrics_;
+};
+
+} // namespace imex
+
+#endif // IMEX_EXECUTIONENGINE_KERNELPROFILER_H
@@ -0,0 +1,206 @@
+//===- MemoryTracker.h - Memory footprint of a stream -----------*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file implements the memory accounting shared by the Level Zero and
+/// SYCL runtime wrappers. When IMEX_MEMORY_STATS is set, every stream tracks
+/// the allocations made through gpuMemAlloc and released through gpuMemFree:
+/// current and peak bytes of device and shared memory, the number of
+/// allocations per size class, and the lifetime of the allocations, grouped
+/// by call site. When the stream is destroyed a summary is appended to the
+/// file named by IMEX_MEMORY_STATS; "-" prints it to stdout.
+///
+/// The call site is the function that allocated, passed by code compiled with
+/// convert-gpux-to-llvm{alloc-site-tags=1}; other allocations are reported
+/// under "<unknown>".
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef IMEX_EXECUTIONENGINE_MEMORYTRACKER_H
+#define IMEX_EXECUTIONENGINE_MEMORYTRACKER_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace imex {
+
+class MemoryTracker {
+public:
+  /// Returns a tracker for a new stream, or null if tracking is disabled.
+  static std::unique_ptr<MemoryTracker> create() {
+    auto path = getenv("IMEX_MEMORY_STATS");
+    return path ? std::unique_ptr<MemoryTracker>(new MemoryTracker(path))
+                : nullptr;
+  }
+
+  MemoryTracker(const MemoryTracker &) = delete;
+  MemoryTracker &operator=(const MemoryTracker &) = delete;
+
+  ~MemoryTracker() { write(); }
+
+  /// Records an allocation of \p size bytes at \p ptr made by \p site, which
+  /// may be null.
+  void recordAlloc(void *ptr, size_t size, bool isShared, const char *site) {
+    if (!ptr)
+      return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto &kind = kinds_[isShared];
+    kind.current += size;
+    kind.peak = std::max(kind.peak, kind.current);
+    ++kind.allocs;
+    peak_ = std::max(peak_, kinds_[0].current + kinds_[1].current);
+    ++sizeClasses_[getSizeClass(size)];
+    live_[ptr] = {size, isShared, site ? site : "<unknown>", now()};
+  }
+
+  /// Records the release of \p ptr; pointers not allocated through the
+  /// tracker are ignored.
+  void recordFree(void *ptr) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = live_.find(ptr);
+    if (it == live_.end())
+      return;
+    auto &alloc = it->second;
+    auto &kind = kinds_[alloc.isShared];
+    kind.current -= alloc.size;
+    ++kind.frees;
+    addLifetime(alloc, now() - alloc.startNs, /*live=*/false);
+    live_.erase(it);
+  }
+
+private:
+  explicit MemoryTracker(std::string path) : path_(std::move(path)) {}
+
+  struct Kind {
+    size_t current = 0, peak = 0;
+    size_t allocs = 0, frees = 0;
+  };
+
+  struct Allocation {
+    size_t size;
+    bool isShared;
+    std::string site;
+    uint64_t startNs;
+  };
+
+  struct Site {
+    size_t allocs = 0, live = 0;
+    size_t bytes = 0;
+    uint64_t totalNs = 0, maxNs = 0;
+    size_t maxBytes = 0;
+  };
+
+  static uint64_t now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  // Size classes are powers of 16 from 4KB to 256MB.
+  static constexpr size_t numSizeClasses = 6;
+  static size_t getSizeClass(size_t size) {
+    size_t sizeClass = 0;
+    for (size_t limit = size_t(4) << 10;
+         size > limit && sizeClass + 1 < numSizeClasses; limit <<= 4)
+      ++sizeClass;
+    return sizeClass;
+  }
+
+  static const char *getSizeClassName(size_t sizeClass) {
+    static const char *names[numSizeClasses] = {
+        "<= 4KB", "<= 64KB", "<= 1MB", "<= 16MB", "<= 256MB", "> 256MB"};
+    return names[sizeClass];
+  }
+
+  void addLifetime(const Allocation &alloc, uint64_t ns, bool live) {
+    auto &site = sites_[alloc.site];
+    ++site.allocs;
+    site.live += live;
+    site.bytes += alloc.size;
+    site.totalNs += ns;
+    if (ns >= site.maxNs) {
+      site.maxNs = ns;
+      site.maxBytes = alloc.size;
+    }
+  }
+
+  static double toMB(size_t bytes) { return bytes / double(1 << 20); }
+
+  void write() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Allocations never freed count as living until the stream is destroyed.
+    auto end = now();
+    for (auto &[ptr, alloc] : live_)
+      addLifetime(alloc, end - alloc.startNs, /*live=*/true);
+
+    auto file = path_ == "-" ? stdout : fopen(path_.c_str(), "a");
+    if (!file) {
+      fprintf(stderr, "Cannot open memory stats output %s\n", path_.c_str());
+      return;
+    }
+
+    fprintf(file, "\n================ Memory footprint ================\n");
+    fprintf(file, "%-8s %12s %12s %10s %10s\n", "memory", "peak MB",
+            "live MB", "allocs", "frees");
+    const char *kindNames[] = {"device", "shared"};
+    for (int i = 0; i < 2; ++i)
+      fprintf(file, "%-8s %12.3f %12.3f %10zu %10zu\n", kindNames[i],
+              toMB(kinds_[i].peak), toMB(kinds_[i].current), kinds_[i].allocs,
+              kinds_[i].frees);
+    fprintf(file, "%-8s %12.3f %12.3f\n", "total", toMB(peak_),
+            toMB(kinds_[0].current + kinds_[1].current));
+
+    fprintf(file, "\nallocations by size\n");
+    for (size_t i = 0; i < numSizeClasses; ++i)
+      if (sizeClasses_[i])
+        fprintf(file, "  %-10s %10zu\n", getSizeClassName(i), sizeClasses_[i]);
+
+    // Call sites holding memory the longest first.
+    std::vector<std::pair<std::string, Site>> sites(sites_.begin(),
+                                                    sites_.end());
+    std::sort(sites.begin(), sites.end(), [](auto &a, auto &b) {
+      return a.second.maxNs > b.second.maxNs;
+    });
+    fprintf(file, "\nlongest-lived allocations by call site\n");
+    fprintf(file, "  %-40s %8s %6s %10s %14s %14s %12s\n", "site", "allocs",
+            "live", "MB", "mean life ms", "max life ms", "max MB");
+    for (auto &[name, site] : sites)
+      fprintf(file, "  %-40s %8zu %6zu %10.3f %14.3f %14.3f %12.3f\n",
+              name.c_str(), site.allocs, site.live, toMB(site.bytes),
+              site.totalNs / 1e6 / site.allocs, site.maxNs / 1e6,
+              toMB(site.maxBytes));
+
+    if (file == stdout)
+      fflush(file);
+    else
+      fclose(file);
+  }
+
+  std::string path_;
+  std::mutex mutex_;
+  // Indexed by isShared.
+  Kind kinds_[2];
+  size_t peak_ = 0;
+  size_t sizeClasses_[numSizeClasses] = {};
+  std::unordered_map<void *, Allocation> live_;
+  std::map<std::string, Site> sites_;
+};
+
+} // namespace imex
+
+#endif // IMEX_EXECUTIONENGINE_MEMORYTRACKER_H
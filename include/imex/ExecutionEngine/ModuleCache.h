@@ -0,0 +1,228 @@
+//===- ModuleCache.h - Content keyed GPU module cache -----------*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file implements the thread-safe module cache used by the Level Zero
+/// and SYCL runtime wrappers. Modules are keyed by a hash of their SPIR-V
+/// content and build flags together with the context and device they are
+/// built for, so identical modules loaded from different places (e.g. several
+/// JIT sessions of the same model) share one compiled module.
+///
+/// gpuModuleLoad is called for every kernel launch, so the address of the
+/// binary is remembered as an alias of the cache entry together with a copy of
+/// the content. A load from a known address only compares the content with
+/// the copy, which is cheaper than hashing it; the whole content is hashed for
+/// a new address, or when the memory now holds another binary. Aliases are
+/// dropped when their module is evicted.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef IMEX_EXECUTIONENGINE_MODULECACHE_H
+#define IMEX_EXECUTIONENGINE_MODULECACHE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace imex {
+
+/// Returns the 64-bit FNV-1a hash of \p size bytes at \p data, continuing
+/// from \p seed.
+inline uint64_t hashBytes(const void *data, size_t size,
+                          uint64_t seed = 0xcbf29ce484222325ULL) {
+  auto bytes = static_cast<const uint8_t *>(data);
+  for (size_t i = 0; i < size; ++i) {
+    seed ^= bytes[i];
+    seed *= 0x100000001b3ULL;
+  }
+  return seed;
+}
+
+/// Identifies a compiled module: the SPIR-V content and build flags and the
+/// context/device it is built for.
+struct ModuleKey {
+  const void *context;
+  const void *device;
+  uint64_t hash;
+  size_t size;
+  std::string buildFlags;
+
+  bool operator<(const ModuleKey &rhs) const {
+    return std::tie(context, device, hash, size, buildFlags) <
+           std::tie(rhs.context, rhs.device, rhs.hash, rhs.size,
+                    rhs.buildFlags);
+  }
+};
+
+/// Cache of modules of type \p ModuleT, which must be default constructible
+/// and have a `module` member holding the native module handle. Lookups and
+/// insertions are atomic; the maps are split into shards with separate locks
+/// so that concurrent loads of unrelated modules do not serialize.
+template <typename ModuleT> class ModuleCache {
+public:
+  using Handle = decltype(ModuleT::module);
+
+  /// Returns the module built from the \p size bytes at \p data, calling
+  /// \p create (which returns a new handle) if there is no cached module with
+  /// the same content, build flags, context and device.
+  template <typename CreateFn>
+  Handle getOrCreate(const void *context, const void *device, const void *data,
+                     size_t size, const std::string &buildFlags,
+                     CreateFn &&create) {
+    AliasKey alias{data, size, context, device, buildFlags};
+    auto &aliasShard = aliases_[shardIndex(data)];
+    {
+      std::lock_guard<std::mutex> lock(aliasShard.mutex);
+      auto it = aliasShard.map.find(alias);
+      // Sizes are part of the key, so the contents have the same size.
+      if (it != aliasShard.map.end() &&
+          !std::memcmp(it->second.content.data(), data, size))
+        return it->second.entry->module;
+    }
+
+    ModuleKey key{context, device, hashBytes(data, size), size, buildFlags};
+    std::shared_ptr<ModuleT> entry;
+    {
+      auto &shard = modules_[key.hash % numShards];
+      // The module is created under the shard lock so that concurrent loads
+      // of the same content build it only once.
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      auto it = shard.map.find(key);
+      if (it != shard.map.end()) {
+        entry = it->second;
+      } else {
+        entry = std::make_shared<ModuleT>();
+        entry->module = create();
+        shard.map.emplace(key, entry);
+        auto &handleShard = handles_[shardIndex(entry->module)];
+        std::lock_guard<std::mutex> handleLock(handleShard.mutex);
+        handleShard.map[entry->module] = entry;
+      }
+      // Still under the shard lock, so that a concurrent eviction of the
+      // entry also drops the new alias.
+      auto bytes = static_cast<const uint8_t *>(data);
+      std::lock_guard<std::mutex> aliasLock(aliasShard.mutex);
+      aliasShard.map[alias] = {entry, {bytes, bytes + size}};
+    }
+    return entry->module;
+  }
+
+  /// Returns the cache entry of \p module, or null if it is not cached.
+  std::shared_ptr<ModuleT> lookup(Handle module) {
+    auto &shard = handles_[shardIndex(module)];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.map.find(module);
+    return it == shard.map.end() ? nullptr : it->second;
+  }
+
+  /// Removes \p module from the cache. The module is destroyed once the last
+  /// reference to its entry is released.
+  void evict(Handle module) {
+    evictIf(
+        [&](const ModuleKey &, Handle handle) { return handle == module; });
+  }
+
+  /// Removes all modules built for \p context.
+  void evictContext(const void *context) {
+    evictIf(
+        [&](const ModuleKey &key, Handle) { return key.context == context; });
+  }
+
+  /// Removes all modules.
+  void clear() {
+    evictIf([](const ModuleKey &, Handle) { return true; });
+  }
+
+private:
+  static constexpr size_t numShards = 16;
+
+  struct AliasKey {
+    const void *data;
+    size_t size;
+    const void *context;
+    const void *device;
+    std::string buildFlags;
+
+    bool operator<(const AliasKey &rhs) const {
+      return std::tie(data, size, context, device, buildFlags) <
+             std::tie(rhs.data, rhs.size, rhs.context, rhs.device,
+                      rhs.buildFlags);
+    }
+  };
+
+  // The entry an address was last loaded as, and the content it had then.
+  struct Alias {
+    std::shared_ptr<ModuleT> entry;
+    std::vector<uint8_t> content;
+  };
+
+  template <typename K, typename V> struct Shard {
+    std::mutex mutex;
+    std::map<K, V> map;
+  };
+
+  static size_t shardIndex(const void *ptr) {
+    // Drop the low bits, which are mostly zero due to alignment.
+    return (reinterpret_cast<uintptr_t>(ptr) >> 4) % numShards;
+  }
+
+  // Removes the entries for which pred(key, handle) holds from all maps. Locks
+  // are taken in the same order as in getOrCreate: module shard, then handle
+  // and alias shards.
+  template <typename Pred> void evictIf(Pred pred) {
+    std::vector<std::shared_ptr<ModuleT>> evicted;
+    for (auto &shard : modules_) {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      for (auto it = shard.map.begin(); it != shard.map.end();) {
+        if (!pred(it->first, it->second->module)) {
+          ++it;
+          continue;
+        }
+        auto module = it->second->module;
+        {
+          auto &handleShard = handles_[shardIndex(module)];
+          std::lock_guard<std::mutex> handleLock(handleShard.mutex);
+          handleShard.map.erase(module);
+        }
+        evicted.push_back(std::move(it->second));
+        it = shard.map.erase(it);
+      }
+    }
+    if (evicted.empty())
+      return;
+
+    for (auto &shard : aliases_) {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      for (auto it = shard.map.begin(); it != shard.map.end();) {
+        if (std::find(evicted.begin(), evicted.end(), it->second.entry) !=
+            evicted.end())
+          it = shard.map.erase(it);
+        else
+          ++it;
+      }
+    }
+    // The modules are destroyed here, outside of the shard locks, unless
+    // they are still referenced by a concurrent lookup.
+  }
+
+  Shard<ModuleKey, std::shared_ptr<ModuleT>> modules_[numShards];
+  Shard<Handle, std::shared_ptr<ModuleT>> handles_[numShards];
+  Shard<AliasKey, Alias> aliases_[numShards];
+};
+
+} // namespace imex
+
+#endif // IMEX_EXECUTIONENGINE_MODULECACHE_H
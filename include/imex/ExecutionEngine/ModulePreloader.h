@@ -0,0 +1,264 @@
+//===- ModulePreloader.h - Background GPU module compilation ----*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file implements the module preloader shared by the Level Zero and
+/// SYCL runtime wrappers. Programs compiled with
+/// convert-gpux-to-llvm{preload-modules=1} call gpuModulePreload for each of
+/// their GPU modules from a global constructor. The preloader compiles the
+/// SPIR-V to a native binary for the default device on a pool of background
+/// threads, in a context of its own, so that compilation overlaps with the
+/// start of the program and modules compile in parallel.
+///
+/// gpuModuleLoad looks the module up by content and build flags. If it was
+/// preloaded, the load waits for that module only, if it is still being
+/// compiled, and creates the module from the native binary, which is cheap.
+/// Modules that were not preloaded, or that are loaded on another device,
+/// are compiled as before.
+///
+/// IMEX_MODULE_PRELOAD_THREADS sets the number of threads, by default the
+/// number of hardware threads; 0 disables preloading.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef IMEX_EXECUTIONENGINE_MODULEPRELOADER_H
+#define IMEX_EXECUTIONENGINE_MODULEPRELOADER_H
+
+#include "imex/ExecutionEngine/ModuleCache.h"
+#include "imex/ExecutionEngine/NativeBinaryCache.h"
+
+#include <level_zero/ze_api.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <future>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace imex {
+
+class ModulePreloader {
+public:
+  /// Returns the driver and device modules are preloaded for.
+  using DeviceFn =
+      std::function<std::pair<ze_driver_handle_t, ze_device_handle_t>()>;
+
+  /// Returns the process-wide preloader configured from the environment.
+  static ModulePreloader &get() {
+    static ModulePreloader preloader;
+    return preloader;
+  }
+
+  ModulePreloader(const ModulePreloader &) = delete;
+  ModulePreloader &operator=(const ModulePreloader &) = delete;
+
+  ~ModulePreloader() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+      // Modules nobody waits for at exit are not worth compiling.
+      for (auto &task : tasks_)
+        task.result.set_value({});
+      tasks_.clear();
+    }
+    tasksCond_.notify_all();
+    for (auto &thread : threads_)
+      thread.join();
+    for (auto &[driver, context] : contexts_)
+      zeContextDestroy(context);
+  }
+
+  /// Queues the compilation of the \p size bytes of SPIR-V at \p data with
+  /// \p buildFlags for the device returned by \p getDevice, which is called
+  /// on a background thread. \p data and \p aotBinaries must stay valid for
+  /// the lifetime of the program.
+  void preload(DeviceFn getDevice, const void *data, size_t size,
+               std::string buildFlags, const void *aotBinaries) {
+    if (!numThreads_)
+      return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopping_)
+      return;
+    if (!getDevice_)
+      getDevice_ = std::move(getDevice);
+    // The key has no device; the result records the one it was built for.
+    Task task{{nullptr, nullptr, hashBytes(data, size), size,
+               std::move(buildFlags)},
+              data,
+              aotBinaries,
+              {}};
+    if (entries_.count(task.key))
+      return;
+    entries_.emplace(task.key, task.result.get_future().share());
+    tasks_.push_back(std::move(task));
+    if (threads_.size() < numThreads_)
+      threads_.emplace_back([this]() { run(); });
+    tasksCond_.notify_one();
+  }
+
+  /// Creates a module for the SPIR-V \p desc in \p context. If the module was
+  /// preloaded for \p device, waits for its compilation to finish and creates
+  /// it from the native binary, otherwise compiles it, see NativeBinaryCache.
+  ze_result_t createModule(ze_context_handle_t context,
+                           ze_device_handle_t device,
+                           const ze_module_desc_t &desc,
+                           ze_module_handle_t *module,
+                           const void *aotBinaries = nullptr) {
+    if (auto result = lookup(desc)) {
+      auto &preloaded = result->get();
+      if (preloaded.device == device && !preloaded.binary.empty()) {
+        ze_module_desc_t nativeDesc = desc;
+        nativeDesc.format = ZE_MODULE_FORMAT_NATIVE;
+        nativeDesc.inputSize = preloaded.binary.size();
+        nativeDesc.pInputModule = preloaded.binary.data();
+        if (zeModuleCreate(context, device, &nativeDesc, module, nullptr) ==
+            ZE_RESULT_SUCCESS)
+          return ZE_RESULT_SUCCESS;
+      }
+    }
+    return NativeBinaryCache::get().createModule(context, device, desc, module,
+                                                 aotBinaries);
+  }
+
+private:
+  struct Result {
+    ze_device_handle_t device = nullptr;
+    std::vector<uint8_t> binary;
+  };
+
+  struct Task {
+    ModuleKey key;
+    const void *data;
+    const void *aotBinaries;
+    std::promise<Result> result;
+  };
+
+  ModulePreloader() {
+    numThreads_ = std::thread::hardware_concurrency();
+    if (auto threads = getenv("IMEX_MODULE_PRELOAD_THREADS"))
+      numThreads_ = std::strtoul(threads, nullptr, 10);
+  }
+
+  // Returns the result of the preload of the module of \p desc, if any. A
+  // preload that has not started yet is dropped rather than waited for behind
+  // the others, the module is then compiled by the caller.
+  const std::shared_future<Result> *lookup(const ze_module_desc_t &desc) {
+    if (desc.format != ZE_MODULE_FORMAT_IL_SPIRV)
+      return nullptr;
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Skip hashing in programs that preload nothing.
+    if (entries_.empty())
+      return nullptr;
+    ModuleKey key{nullptr, nullptr,
+                  hashBytes(desc.pInputModule, desc.inputSize),
+                  desc.inputSize,
+                  desc.pBuildFlags ? desc.pBuildFlags : ""};
+    auto it = entries_.find(key);
+    if (it == entries_.end())
+      return nullptr;
+    for (auto task = tasks_.begin(); task != tasks_.end(); ++task) {
+      if (task->key.hash == key.hash && !(task->key < key) &&
+          !(key < task->key)) {
+        task->result.set_value({});
+        tasks_.erase(task);
+        return nullptr;
+      }
+    }
+    // Entries are never removed, so the future outlives the lock.
+    return &it->second;
+  }
+
+  void run() {
+    while (true) {
+      std::unique_lock<std::mutex> lock(mutex_);
+      tasksCond_.wait(lock, [&]() { return stopping_ || !tasks_.empty(); });
+      if (tasks_.empty())
+        return;
+      auto task = std::move(tasks_.front());
+      tasks_.pop_front();
+      lock.unlock();
+
+      Result result;
+      try {
+        result = compile(task);
+      } catch (...) {
+        // The module is compiled again when it is loaded.
+        result = {};
+      }
+      task.result.set_value(std::move(result));
+    }
+  }
+
+  Result compile(const Task &task) {
+    auto [driver, device] = getDriverAndDevice();
+    ze_module_desc_t desc = {};
+    desc.stype = ZE_STRUCTURE_TYPE_MODULE_DESC;
+    desc.format = ZE_MODULE_FORMAT_IL_SPIRV;
+    desc.inputSize = task.key.size;
+    desc.pInputModule = static_cast<const uint8_t *>(task.data);
+    desc.pBuildFlags = task.key.buildFlags.c_str();
+    ze_module_handle_t module;
+    Result result;
+    if (NativeBinaryCache::get().createModule(getContext(driver), device, desc,
+                                              &module, task.aotBinaries) !=
+        ZE_RESULT_SUCCESS)
+      return result;
+    size_t size = 0;
+    if (zeModuleGetNativeBinary(module, &size, nullptr) == ZE_RESULT_SUCCESS &&
+        size) {
+      result.binary.resize(size);
+      if (zeModuleGetNativeBinary(module, &size, result.binary.data()) !=
+          ZE_RESULT_SUCCESS)
+        result.binary.clear();
+    }
+    zeModuleDestroy(module);
+    result.device = device;
+    return result;
+  }
+
+  std::pair<ze_driver_handle_t, ze_device_handle_t> getDriverAndDevice() {
+    std::call_once(deviceOnce_, [&]() { device_ = getDevice_(); });
+    return device_;
+  }
+
+  ze_context_handle_t getContext(ze_driver_handle_t driver) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto &context = contexts_[driver];
+    if (!context) {
+      ze_context_desc_t desc = {ZE_STRUCTURE_TYPE_CONTEXT_DESC, nullptr, 0};
+      if (zeContextCreate(driver, &desc, &context) != ZE_RESULT_SUCCESS)
+        context = nullptr;
+    }
+    return context;
+  }
+
+  size_t numThreads_ = 0;
+  std::mutex mutex_;
+  std::condition_variable tasksCond_;
+  std::deque<Task> tasks_;
+  std::vector<std::thread> threads_;
+  bool stopping_ = false;
+  std::map<ModuleKey, std::shared_future<Result>> entries_;
+  DeviceFn getDevice_;
+  std::once_flag deviceOnce_;
+  std::pair<ze_driver_handle_t, ze_device_handle_t> device_;
+  std::map<ze_driver_handle_t, ze_context_handle_t> contexts_;
+};
+
+} // namespace imex
+
+#endif // IMEX_EXECUTIONENGINE_MODULEPRELOADER_H
@@ -0,0 +1,400 @@
+//===- NativeBinaryCache.h - On-disk native binary cache --------*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file implements a persistent on-disk cache of device native binaries
+/// shared by the Level Zero and SYCL runtime wrappers. Compiling SPIR-V to
+/// native ISA is done by the driver on every zeModuleCreate call; with the
+/// cache enabled the native binary of a module is stored after the first
+/// compilation and loaded with ZE_MODULE_FORMAT_NATIVE on later runs.
+///
+/// The cache is disabled by default and is controlled by environment
+/// variables:
+///   IMEX_NATIVE_BINARY_CACHE_DIR  - cache directory, enables the cache.
+///   IMEX_NATIVE_BINARY_CACHE_SIZE - size limit in bytes (default 1 GiB).
+///                                   Least recently used entries are evicted
+///                                   when the limit is exceeded.
+///
+/// Entries are named by a 64-bit hash of the SPIR-V, build flags and device.
+/// Their header holds the size of the SPIR-V and a SHA-256 digest of all of
+/// them, which a load compares before using the entry, so colliding names are
+/// treated as misses.
+///
+/// Modules compiled with serialize-spirv{aot-devices=...} come with native
+/// binaries built ahead of time, passed to gpuModuleLoadWithOptions as a
+/// table of little-endian records
+///   uint32_t deviceId; uint64_t size; uint8_t binary[size];
+/// ending with a device ID of 0. The binary for the device, if any, is loaded
+/// before looking at the cache.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef IMEX_EXECUTIONENGINE_NATIVEBINARYCACHE_H
+#define IMEX_EXECUTIONENGINE_NATIVEBINARYCACHE_H
+
+#include "imex/ExecutionEngine/ModuleCache.h"
+
+#include <level_zero/ze_api.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace imex {
+
+class NativeBinaryCache {
+public:
+  /// Returns the process-wide cache configured from the environment.
+  static NativeBinaryCache &get() {
+    static NativeBinaryCache cache;
+    return cache;
+  }
+
+  bool enabled() const { return !dir_.empty(); }
+
+  /// Creates a module for the given SPIR-V \p desc. If \p aotBinaries holds
+  /// a native binary for the device, or a native binary for the same SPIR-V,
+  /// build flags and device is cached, it is loaded instead of compiling the
+  /// SPIR-V, otherwise the compiled module is added to the cache.
+  ze_result_t createModule(ze_context_handle_t context,
+                           ze_device_handle_t device,
+                           const ze_module_desc_t &desc,
+                           ze_module_handle_t *module,
+                           const void *aotBinaries = nullptr) {
+    if (aotBinaries && desc.format == ZE_MODULE_FORMAT_IL_SPIRV) {
+      ze_device_properties_t props = {};
+      props.stype = ZE_STRUCTURE_TYPE_DEVICE_PROPERTIES;
+      size_t size = 0;
+      const uint8_t *binary = nullptr;
+      if (zeDeviceGetProperties(device, &props) == ZE_RESULT_SUCCESS &&
+          (binary = findAOTBinary(aotBinaries, props.deviceId, size))) {
+        ze_module_desc_t nativeDesc = desc;
+        nativeDesc.format = ZE_MODULE_FORMAT_NATIVE;
+        nativeDesc.inputSize = size;
+        nativeDesc.pInputModule = binary;
+        if (zeModuleCreate(context, device, &nativeDesc, module, nullptr) ==
+            ZE_RESULT_SUCCESS)
+          return ZE_RESULT_SUCCESS;
+        // Built for another driver or stepping, compile the SPIR-V instead.
+      }
+    }
+
+    if (!enabled() || desc.format != ZE_MODULE_FORMAT_IL_SPIRV)
+      return zeModuleCreate(context, device, &desc, module, nullptr);
+
+    ze_device_properties_t props = {};
+    props.stype = ZE_STRUCTURE_TYPE_DEVICE_PROPERTIES;
+    if (zeDeviceGetProperties(device, &props) != ZE_RESULT_SUCCESS)
+      return zeModuleCreate(context, device, &desc, module, nullptr);
+
+    auto header = getHeader(desc, props);
+    auto path = getEntryPath(desc, props);
+    std::vector<uint8_t> binary;
+    if (read(path, header, binary)) {
+      ze_module_desc_t nativeDesc = desc;
+      nativeDesc.format = ZE_MODULE_FORMAT_NATIVE;
+      nativeDesc.inputSize = binary.size();
+      nativeDesc.pInputModule = binary.data();
+      if (zeModuleCreate(context, device, &nativeDesc, module, nullptr) ==
+          ZE_RESULT_SUCCESS)
+        return ZE_RESULT_SUCCESS;
+      // The binary is stale (e.g. after a driver update), rebuild it below.
+    }
+
+    auto res = zeModuleCreate(context, device, &desc, module, nullptr);
+    if (res != ZE_RESULT_SUCCESS)
+      return res;
+
+    size_t size = 0;
+    if (zeModuleGetNativeBinary(*module, &size, nullptr) != ZE_RESULT_SUCCESS ||
+        size == 0)
+      return res;
+    binary.resize(size);
+    if (zeModuleGetNativeBinary(*module, &size, binary.data()) ==
+        ZE_RESULT_SUCCESS)
+      write(path, header, binary);
+    return res;
+  }
+
+private:
+  // Returns the SHA-256 digest of \p size bytes at \p data.
+  static std::array<uint8_t, 32> sha256(const void *data, size_t size) {
+    static constexpr uint32_t k[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+        0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+        0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+        0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+        0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+        0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+        0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+        0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+        0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+    uint32_t h[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                     0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    auto rotr = [](uint32_t x, unsigned n) {
+      return (x >> n) | (x << (32 - n));
+    };
+    auto compress = [&](const uint8_t *block) {
+      uint32_t w[64];
+      for (unsigned i = 0; i < 16; ++i)
+        w[i] = uint32_t(block[4 * i]) << 24 | uint32_t(block[4 * i + 1]) << 16 |
+               uint32_t(block[4 * i + 2]) << 8 | uint32_t(block[4 * i + 3]);
+      for (unsigned i = 16; i < 64; ++i) {
+        auto s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        auto s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+      }
+      uint32_t v[8];
+      std::copy(h, h + 8, v);
+      for (unsigned i = 0; i < 64; ++i) {
+        auto s1 = rotr(v[4], 6) ^ rotr(v[4], 11) ^ rotr(v[4], 25);
+        auto ch = (v[4] & v[5]) ^ (~v[4] & v[6]);
+        auto t1 = v[7] + s1 + ch + k[i] + w[i];
+        auto s0 = rotr(v[0], 2) ^ rotr(v[0], 13) ^ rotr(v[0], 22);
+        auto maj = (v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2]);
+        std::copy_backward(v, v + 7, v + 8);
+        v[4] += t1;
+        v[0] = t1 + s0 + maj;
+      }
+      for (unsigned i = 0; i < 8; ++i)
+        h[i] += v[i];
+    };
+
+    auto bytes = static_cast<const uint8_t *>(data);
+    size_t full = size / 64 * 64;
+    for (size_t i = 0; i < full; i += 64)
+      compress(bytes + i);
+    // Pad the rest with a one bit, zeros and the size in bits.
+    uint8_t tail[128] = {};
+    size_t rest = size - full;
+    if (rest)
+      memcpy(tail, bytes + full, rest);
+    tail[rest] = 0x80;
+    size_t tailSize = rest < 56 ? 64 : 128;
+    uint64_t bits = uint64_t(size) * 8;
+    for (unsigned i = 0; i < 8; ++i)
+      tail[tailSize - 1 - i] = uint8_t(bits >> (8 * i));
+    for (size_t i = 0; i < tailSize; i += 64)
+      compress(tail + i);
+
+    std::array<uint8_t, 32> digest;
+    for (unsigned i = 0; i < 32; ++i)
+      digest[i] = uint8_t(h[i / 4] >> (24 - 8 * (i % 4)));
+    return digest;
+  }
+
+  // Stored in front of the native binary of each entry, identifying the
+  // SPIR-V, build flags and device it was built from.
+  struct Header {
+    char magic[8];
+    uint64_t sourceSize;
+    std::array<uint8_t, 32> digest;
+  };
+  static constexpr char magic[8] = {'I', 'M', 'E', 'X', 'N', 'B', 'C', '1'};
+
+  // Returns the binary for \p deviceId in the table \p aotBinaries.
+  static const uint8_t *findAOTBinary(const void *aotBinaries,
+                                      uint32_t deviceId, size_t &size) {
+    auto record = static_cast<const uint8_t *>(aotBinaries);
+    while (true) {
+      uint32_t id;
+      uint64_t recordSize;
+      memcpy(&id, record, sizeof(id));
+      if (!id)
+        return nullptr;
+      memcpy(&recordSize, record + sizeof(id), sizeof(recordSize));
+      record += sizeof(id) + sizeof(recordSize);
+      if (id == deviceId) {
+        size = recordSize;
+        return record;
+      }
+      record += recordSize;
+    }
+  }
+
+  NativeBinaryCache() {
+    if (auto dir = getenv("IMEX_NATIVE_BINARY_CACHE_DIR")) {
+      std::error_code ec;
+      std::filesystem::create_directories(dir, ec);
+      if (ec) {
+        fprintf(stderr, "Native binary cache disabled, cannot create %s: %s\n",
+                dir, ec.message().c_str());
+        return;
+      }
+      dir_ = dir;
+    }
+    if (auto limit = getenv("IMEX_NATIVE_BINARY_CACHE_SIZE"))
+      maxSize_ = std::strtoull(limit, nullptr, 10);
+  }
+
+  static Header getHeader(const ze_module_desc_t &desc,
+                          const ze_device_properties_t &props) {
+    std::vector<uint8_t> key(desc.inputSize);
+    if (desc.inputSize)
+      memcpy(key.data(), desc.pInputModule, desc.inputSize);
+    auto append = [&](const void *data, size_t size) {
+      auto bytes = static_cast<const uint8_t *>(data);
+      key.insert(key.end(), bytes, bytes + size);
+    };
+    // The flags are terminated so they cannot run into the device IDs.
+    if (desc.pBuildFlags)
+      append(desc.pBuildFlags, strlen(desc.pBuildFlags));
+    key.push_back(0);
+    append(&props.vendorId, sizeof(props.vendorId));
+    append(&props.deviceId, sizeof(props.deviceId));
+
+    Header header;
+    memcpy(header.magic, magic, sizeof(magic));
+    header.sourceSize = desc.inputSize;
+    header.digest = sha256(key.data(), key.size());
+    return header;
+  }
+
+  std::filesystem::path
+  getEntryPath(const ze_module_desc_t &desc,
+               const ze_device_properties_t &props) const {
+    auto h = hashBytes(desc.pInputModule, desc.inputSize);
+    if (desc.pBuildFlags)
+      h = hashBytes(desc.pBuildFlags, strlen(desc.pBuildFlags), h);
+    h = hashBytes(&props.vendorId, sizeof(props.vendorId), h);
+    h = hashBytes(&props.deviceId, sizeof(props.deviceId), h);
+
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.bin",
+             static_cast<unsigned long long>(h));
+    return dir_ / name;
+  }
+
+  // Reads the binary of the entry at \p path if its header is \p header.
+  static bool read(const std::filesystem::path &path, const Header &header,
+                   std::vector<uint8_t> &binary) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+      return false;
+    Header stored;
+    if (!in.read(reinterpret_cast<char *>(&stored), sizeof(stored)) ||
+        memcmp(stored.magic, header.magic, sizeof(magic)) ||
+        stored.sourceSize != header.sourceSize ||
+        stored.digest != header.digest)
+      return false;
+    binary.assign(std::istreambuf_iterator<char>(in),
+                  std::istreambuf_iterator<char>());
+    if (binary.empty())
+      return false;
+    // Mark the entry as recently used for eviction.
+    std::error_code ec;
+    std::filesystem::last_write_time(
+        path, std::filesystem::file_time_type::clock::now(), ec);
+    return true;
+  }
+
+  void write(const std::filesystem::path &path, const Header &header,
+             const std::vector<uint8_t> &binary) {
+    // Write to a temporary file first so that concurrent processes never
+    // observe a partially written entry.
+    auto tmp = path;
+    tmp += ".tmp" + std::to_string(std::random_device{}());
+    {
+      std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+      if (!out)
+        return;
+      out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+      out.write(reinterpret_cast<const char *>(binary.data()), binary.size());
+      if (!out) {
+        out.close();
+        std::error_code ec;
+        std::filesystem::remove(tmp, ec);
+        return;
+      }
+    }
+    std::error_code ec;
+    auto replaced = std::filesystem::file_size(path, ec);
+    if (ec)
+      replaced = 0;
+    std::filesystem::rename(tmp, path, ec);
+    if (ec) {
+      std::filesystem::remove(tmp, ec);
+      return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    // The size of the directory is only scanned for the first write and when
+    // it exceeds the limit, and tracked in between.
+    if (!scanned_) {
+      scan();
+      scanned_ = true;
+    } else {
+      totalSize_ += sizeof(header) + binary.size() - replaced;
+    }
+    if (totalSize_ > maxSize_)
+      evict();
+  }
+
+  // Removes least recently used entries until the cache fits in maxSize_.
+  // Rescans the directory, which other processes may have changed as well.
+  void evict() {
+    auto entries = scan();
+    std::sort(entries.begin(), entries.end(),
+              [](const Entry &a, const Entry &b) { return a.time < b.time; });
+    std::error_code ec;
+    for (auto &entry : entries) {
+      if (totalSize_ <= maxSize_)
+        break;
+      if (std::filesystem::remove(entry.path, ec))
+        totalSize_ -= entry.size;
+    }
+  }
+
+  struct Entry {
+    std::filesystem::path path;
+    std::filesystem::file_time_type time;
+    uintmax_t size;
+  };
+
+  // Returns the entries in the directory and sets totalSize_ to their size.
+  std::vector<Entry> scan() {
+    std::vector<Entry> entries;
+    totalSize_ = 0;
+    std::error_code ec;
+    for (auto &file : std::filesystem::directory_iterator(dir_, ec)) {
+      if (!file.is_regular_file(ec) || file.path().extension() != ".bin")
+        continue;
+      auto size = file.file_size(ec);
+      if (ec)
+        continue;
+      entries.push_back({file.path(), file.last_write_time(ec), size});
+      totalSize_ += size;
+    }
+    return entries;
+  }
+
+  std::filesystem::path dir_;
+  uintmax_t maxSize_ = 1ULL << 30;
+  // Guards scanned_ and totalSize_, the size of the entries as of the last
+  // scan plus the entries written since.
+  std::mutex mutex_;
+  bool scanned_ = false;
+  uintmax_t totalSize_ = 0;
+};
+
+} // namespace imex
+
+#endif // IMEX_EXECUTIONENGINE_NATIVEBINARYCACHE_H
@@ -0,0 +1,196 @@
+//===- RandomFill.h - Reproducible parallel random fills --------*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file implements the random fills shared by imex_runner_utils and the
+/// GPU runtime wrappers. Values come from the counter-based Philox4x32-10
+/// generator: element i of a fill with seed s is computed from s and i alone,
+/// so a buffer gets the same values however many threads or work-items fill
+/// it, and on the host and the GPU alike.
+///
+/// Every Philox evaluation yields the values of four consecutive elements.
+/// Values are uniform in [lower, upper), truncated towards zero if integers
+/// are asked for, and rounded to nearest even for f16 and bf16.
+///
+/// The generator and the conversions are plain integer code, usable in SYCL
+/// kernels.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef IMEX_EXECUTIONENGINE_RANDOMFILL_H
+#define IMEX_EXECUTIONENGINE_RANDOMFILL_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace imex {
+
+/// Element types of a random fill, as passed to gpuFillRandom.
+enum class RandomFillType : int32_t { F32 = 0, F16 = 1, BF16 = 2 };
+
+inline size_t getElementSize(RandomFillType type) {
+  return type == RandomFillType::F32 ? 4 : 2;
+}
+
+struct RandomFillParams {
+  uint64_t seed;
+  float lower, upper;
+  bool genInt;
+};
+
+/// Computes the Philox4x32-10 block \p counter under \p key into \p out.
+inline void philox4x32(uint64_t counter, uint64_t key, uint32_t out[4]) {
+  uint32_t c0 = static_cast<uint32_t>(counter);
+  uint32_t c1 = static_cast<uint32_t>(counter >> 32);
+  uint32_t c2 = 0, c3 = 0;
+  uint32_t k0 = static_cast<uint32_t>(key);
+  uint32_t k1 = static_cast<uint32_t>(key >> 32);
+  for (int round = 0; round < 10; ++round) {
+    if (round) {
+      k0 += 0x9E3779B9;
+      k1 += 0xBB67AE85;
+    }
+    uint64_t p0 = uint64_t(0xD2511F53) * c0;
+    uint64_t p1 = uint64_t(0xCD9E8D57) * c2;
+    uint32_t n0 = static_cast<uint32_t>(p1 >> 32) ^ c1 ^ k0;
+    uint32_t n2 = static_cast<uint32_t>(p0 >> 32) ^ c3 ^ k1;
+    c1 = static_cast<uint32_t>(p1);
+    c3 = static_cast<uint32_t>(p0);
+    c0 = n0;
+    c2 = n2;
+  }
+  out[0] = c0;
+  out[1] = c1;
+  out[2] = c2;
+  out[3] = c3;
+}
+
+/// Computes the values of the elements 4 * \p group to 4 * \p group + 3.
+inline void getRandomValues(const RandomFillParams &params, uint64_t group,
+                            float values[4]) {
+  uint32_t bits[4];
+  philox4x32(group, params.seed, bits);
+  for (int i = 0; i < 4; ++i) {
+    // The upper 24 bits, which a float holds exactly, scaled to [0, 1).
+    float unit = static_cast<float>(bits[i] >> 8) * (1.0f / (1 << 24));
+    float value = params.lower + unit * (params.upper - params.lower);
+    values[i] = params.genInt ? static_cast<float>(static_cast<int>(value))
+                              : value;
+  }
+}
+
+inline uint32_t getFloatBits(float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+/// Rounds \p value to the nearest even bf16, keeping NaNs quiet.
+inline uint16_t floatToBF16Bits(float value) {
+  uint32_t bits = getFloatBits(value);
+  if ((bits & 0x7FFFFFFF) > 0x7F800000)
+    return static_cast<uint16_t>((bits >> 16) | 0x40);
+  bits += 0x7FFF + ((bits >> 16) & 1);
+  return static_cast<uint16_t>(bits >> 16);
+}
+
+/// Rounds \p value to the nearest even f16, including subnormals.
+inline uint16_t floatToHalfBits(float value) {
+  uint32_t bits = getFloatBits(value);
+  uint32_t sign = (bits >> 16) & 0x8000;
+  uint32_t absBits = bits & 0x7FFFFFFF;
+  // Infinity and NaN.
+  if (absBits >= 0x7F800000)
+    return sign | 0x7C00 | (absBits > 0x7F800000 ? 0x200 : 0);
+  // At least 65520, which rounds to infinity.
+  if (absBits >= 0x477FF000)
+    return sign | 0x7C00;
+  uint32_t half, rem, mid;
+  if (absBits >= 0x38800000) {
+    // Normal: rebias the exponent and drop 13 mantissa bits.
+    half = (absBits - 0x38000000) >> 13;
+    rem = absBits & 0x1FFF;
+    mid = 0x1000;
+  } else {
+    // Subnormal, in units of 2^-24.
+    uint32_t shift = 126 - (absBits >> 23);
+    if (shift > 24)
+      return sign;
+    uint32_t mant = (absBits & 0x7FFFFF) | 0x800000;
+    half = mant >> shift;
+    rem = mant & ((1u << shift) - 1);
+    mid = 1u << (shift - 1);
+  }
+  if (rem > mid || (rem == mid && (half & 1)))
+    ++half;
+  return static_cast<uint16_t>(sign | half);
+}
+
+/// Stores \p value as element \p idx of the \p type buffer \p dst.
+inline void storeRandomValue(void *dst, RandomFillType type, uint64_t idx,
+                             float value) {
+  switch (type) {
+  case RandomFillType::F32:
+    static_cast<float *>(dst)[idx] = value;
+    break;
+  case RandomFillType::F16:
+    static_cast<uint16_t *>(dst)[idx] = floatToHalfBits(value);
+    break;
+  case RandomFillType::BF16:
+    static_cast<uint16_t *>(dst)[idx] = floatToBF16Bits(value);
+    break;
+  }
+}
+
+/// Calls \p fn(idx, value) for the elements [begin, end).
+template <typename Fn>
+void generateRandomValues(const RandomFillParams &params, uint64_t begin,
+                          uint64_t end, Fn fn) {
+  float values[4];
+  for (uint64_t idx = begin; idx < end; ++idx) {
+    if (idx == begin || idx % 4 == 0)
+      getRandomValues(params, idx / 4, values);
+    fn(idx, values[idx % 4]);
+  }
+}
+
+/// Splits [0, count) into chunks of at least 64K elements and calls
+/// \p fn(begin, end) for each on its own thread.
+template <typename Fn> void parallelForRange(uint64_t count, Fn fn) {
+  constexpr uint64_t minChunkSize = uint64_t(1) << 16;
+  uint64_t numThreads = std::max<uint64_t>(
+      1, std::min<uint64_t>(std::thread::hardware_concurrency(),
+                            count / minChunkSize));
+  uint64_t chunkSize = (count + numThreads - 1) / numThreads;
+  std::vector<std::thread> threads;
+  for (uint64_t t = 1; t < numThreads; ++t)
+    threads.emplace_back(fn, t * chunkSize,
+                         std::min(count, (t + 1) * chunkSize));
+  fn(0, std::min(count, chunkSize));
+  for (auto &thread : threads)
+    thread.join();
+}
+
+/// Fills the \p count elements of the contiguous \p type buffer \p dst on the
+/// host with all threads.
+inline void fillRandomHost(void *dst, RandomFillType type, uint64_t count,
+                           const RandomFillParams &params) {
+  parallelForRange(count, [&](uint64_t begin, uint64_t end) {
+    generateRandomValues(params, begin, end, [&](uint64_t idx, float value) {
+      storeRandomValue(dst, type, idx, value);
+    });
+  });
+}
+
+} // namespace imex
+
+#endif // IMEX_EXECUTIONENGINE_RANDOMFILL_H
@@ -0,0 +1,152 @@
+//===- Session.h - Compiled functions for embedding IMEX --------*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file declares the session API for processes that embed IMEX, e.g. to
+/// serve a model. A session lowers and JIT-compiles a module once and hands
+/// out functions that can be called any number of times, from any number of
+/// threads at once, without per-call setup.
+///
+/// GPU code has to be lowered with
+/// convert-gpux-to-llvm{stream-getter=imexSessionGetStream}. The session then
+/// gives every calling thread a stream of its own, created on its first call
+/// and kept until the session is destroyed. The streams share one context,
+/// so GPU modules and kernels are loaded once for all of them, while each
+/// keeps its own command lists and memory pool.
+///
+/// Optionally, functions get specialized for the shapes of their memref
+/// arguments: the first calls with a new shape signature start compiling a
+/// version of the function in the background, with the shapes folded to
+/// constants, and run the generic version until the specialized one is ready.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef IMEX_EXECUTIONENGINE_SESSION_H
+#define IMEX_EXECUTIONENGINE_SESSION_H
+
+#include <mlir/ExecutionEngine/ExecutionEngine.h>
+#include <mlir/IR/BuiltinOps.h>
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/Error.h>
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace mlir {
+class DialectRegistry;
+class OpPassManager;
+} // namespace mlir
+
+namespace imex {
+
+struct SessionOptions {
+  /// Adds the passes lowering the module to the LLVM dialect, if it is not
+  /// already.
+  std::function<void(mlir::OpPassManager &)> buildPipeline;
+  /// Shared libraries the compiled code calls into, e.g. the Level Zero
+  /// runtime wrappers and imex_runner_utils.
+  llvm::SmallVector<std::string> sharedLibPaths;
+  /// Optimization level of the host code.
+  unsigned optLevel = 3;
+  /// Maximal number of shape signatures each function gets specialized for,
+  /// 0 disables the specialization.
+  unsigned maxSpecializations = 0;
+};
+
+class Session {
+public:
+  /// Name of the stream getter the session defines, to be passed to the
+  /// stream-getter option of convert-gpux-to-llvm.
+  static constexpr llvm::StringLiteral streamGetterName =
+      "imexSessionGetStream";
+
+  /// A function of a session. It is only valid as long as the session.
+  class Function {
+  public:
+    /// Calls the function with \p args, which point to the arguments and to
+    /// the storage of the results, as for mlir::ExecutionEngine::invokePacked.
+    void invoke(llvm::MutableArrayRef<void *> args) const;
+
+  private:
+    friend class Session;
+    using PackedFn = void (*)(void **);
+    class Specializer;
+    Function(PackedFn fn, Specializer *specializer)
+        : fn_(fn), specializer_(specializer) {}
+    PackedFn fn_;
+    Specializer *specializer_;
+  };
+
+  /// Lowers \p module in place as set up by \p options and compiles it. Runs
+  /// the global constructors of the module, e.g. the preloading of its GPU
+  /// modules.
+  static llvm::Expected<std::unique_ptr<Session>>
+  create(mlir::ModuleOp module, const SessionOptions &options);
+
+  Session(const Session &) = delete;
+  Session &operator=(const Session &) = delete;
+
+  /// Waits for the specializations being compiled, destroys the streams of
+  /// all threads, then the compiled code. No function may be running.
+  ~Session();
+
+  /// Returns the function \p name of the module.
+  llvm::Expected<Function> lookup(llvm::StringRef name) const;
+
+  /// Returns the stream of the calling thread, creating it on first use.
+  void *getStream();
+
+private:
+  using CreateStreamFn = void *(*)(void *, void *);
+  using CreateStreamSharingFn = void *(*)(void *);
+  using StreamDestroyFn = void (*)(void *);
+
+  Session() = default;
+
+  /// Creates a session whose code uses the streams of \p streamOwner if it
+  /// is not null.
+  static llvm::Expected<std::unique_ptr<Session>>
+  create(mlir::ModuleOp module, const SessionOptions &options,
+         Session *streamOwner);
+
+  llvm::Error bindStreams();
+
+  std::unique_ptr<mlir::ExecutionEngine> engine_;
+  SessionOptions options_;
+  // The module before lowering, printed if functions get specialized.
+  std::string source_;
+  std::unique_ptr<mlir::DialectRegistry> registry_;
+  mutable std::mutex specializersMutex_;
+  mutable std::map<std::string, std::unique_ptr<Function::Specializer>>
+      specializers_;
+  // The specializations use the streams of the session they belong to.
+  Session *streamOwner_ = nullptr;
+  // Distinguishes sessions in the per-thread stream caches, since a new
+  // session may reuse the address of a destroyed one.
+  uint64_t id_ = 0;
+  CreateStreamFn createStream_ = nullptr;
+  CreateStreamSharingFn createStreamSharing_ = nullptr;
+  StreamDestroyFn streamDestroy_ = nullptr;
+  std::mutex mutex_;
+  // The stream created first owns the context the others share.
+  void *firstStream_ = nullptr;
+  std::map<std::thread::id, void *> streams_;
+};
+
+} // namespace imex
+
+#endif // IMEX_EXECUTIONENGINE_SESSION_H
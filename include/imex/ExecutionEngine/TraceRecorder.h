@@ -0,0 +1,251 @@
+//===- TraceRecorder.h - Whole-program timeline tracing ---------*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file implements the timeline trace shared by the Level Zero and SYCL
+/// runtime wrappers. When IMEX_TRACE_OUTPUT is set, every call of a runtime
+/// wrapper is recorded on the host timeline of its thread, and every kernel
+/// launch, memory copy and memory fill on the device timeline, with the
+/// device timestamps of the command mapped to the host clock. Nothing is
+/// re-executed, so the trace shows the program as it runs.
+///
+/// At exit the trace is written as Chrome trace JSON, which can be opened in
+/// Perfetto (ui.perfetto.dev) or chrome://tracing. Host time spent outside the
+/// runtime (in the compiled code) between two wrapper calls shows up as "host
+/// gap" slices, and "otherData" holds a summary: wall time, time in the
+/// runtime and in host gaps, and busy and idle time of the device between its
+/// first and last command.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef IMEX_EXECUTIONENGINE_TRACERECORDER_H
+#define IMEX_EXECUTIONENGINE_TRACERECORDER_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace imex {
+
+class TraceRecorder {
+public:
+  /// Returns the process-wide recorder, or null if tracing is disabled.
+  static TraceRecorder *get() {
+    static std::unique_ptr<TraceRecorder> recorder(
+        getenv("IMEX_TRACE_OUTPUT")
+            ? new TraceRecorder(getenv("IMEX_TRACE_OUTPUT"))
+            : nullptr);
+    return recorder.get();
+  }
+
+  TraceRecorder(const TraceRecorder &) = delete;
+  TraceRecorder &operator=(const TraceRecorder &) = delete;
+
+  ~TraceRecorder() { write(); }
+
+  /// Nanoseconds on the host clock of the trace.
+  static uint64_t now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  /// Associates a kernel handle with its name.
+  void registerKernel(const void *kernel, const std::string &name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    names_[kernel] = name;
+  }
+
+  std::string getKernelName(const void *kernel) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = names_.find(kernel);
+    return it != names_.end() ? it->second : "<unknown>";
+  }
+
+  /// Records a runtime wrapper call on the host timeline of the calling
+  /// thread.
+  void recordHost(const char *name, uint64_t startNs, uint64_t endNs) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto tid = threads_.emplace(std::this_thread::get_id(), threads_.size())
+                   .first->second;
+    host_.push_back({name, "runtime", startNs, endNs, tid, 0});
+  }
+
+  /// Records a command executed on the device between \p startNs and
+  /// \p endNs on the host clock. \p category is "kernel", "memcpy" or
+  /// "memset"; \p bytes is the size of memory commands.
+  void recordDevice(const char *category, std::string name, uint64_t startNs,
+                    uint64_t endNs, size_t bytes = 0) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    device_.push_back(
+        {std::move(name), category, startNs, std::max(startNs, endNs), 0,
+         bytes});
+  }
+
+private:
+  explicit TraceRecorder(std::string path)
+      : path_(std::move(path)), start_(now()) {}
+
+  struct Slice {
+    std::string name;
+    const char *category;
+    uint64_t startNs, endNs;
+    size_t tid;
+    size_t bytes;
+  };
+
+  // Device commands are shown on one track per engine kind.
+  static size_t getDeviceTrack(const Slice &slice) {
+    return std::string(slice.category) == "memcpy" ? 1 : 0;
+  }
+
+  void printSlice(FILE *file, const Slice &slice, int pid, size_t tid) {
+    fprintf(file,
+            ",\n    {\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", "
+            "\"pid\": %d, \"tid\": %zu, \"ts\": %.3f, \"dur\": %.3f",
+            slice.name.c_str(), slice.category, pid, tid,
+            (static_cast<double>(slice.startNs) - start_) / 1e3,
+            (slice.endNs - slice.startNs) / 1e3);
+    if (slice.bytes)
+      fprintf(file, ", \"args\": {\"bytes\": %zu}", slice.bytes);
+    fprintf(file, "}");
+  }
+
+  static void printName(FILE *file, const char *kind, int pid, size_t tid,
+                        const std::string &name) {
+    fprintf(file,
+            ",\n    {\"name\": \"%s\", \"ph\": \"M\", \"pid\": %d, "
+            "\"tid\": %zu, \"args\": {\"name\": \"%s\"}}",
+            kind, pid, tid, name.c_str());
+  }
+
+  // Total time covered by the given intervals.
+  static uint64_t getCoveredNs(std::vector<std::pair<uint64_t, uint64_t>> iv) {
+    std::sort(iv.begin(), iv.end());
+    uint64_t covered = 0, end = 0;
+    for (auto [s, e] : iv) {
+      s = std::max(s, end);
+      if (e > s)
+        covered += e - s;
+      end = std::max(end, e);
+    }
+    return covered;
+  }
+
+  void write() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto file = path_ == "-" ? stdout : fopen(path_.c_str(), "w");
+    if (!file) {
+      fprintf(stderr, "Cannot open trace output %s\n", path_.c_str());
+      return;
+    }
+    constexpr int hostPid = 1, devicePid = 2;
+
+    fprintf(file, "{\n  \"displayTimeUnit\": \"ns\",\n  \"traceEvents\": [\n");
+    fprintf(file, "    {\"name\": \"process_name\", \"ph\": \"M\", \"pid\": "
+                  "%d, \"args\": {\"name\": \"host\"}}",
+            hostPid);
+    fprintf(file,
+            ",\n    {\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %d, "
+            "\"args\": {\"name\": \"device\"}}",
+            devicePid);
+    printName(file, "thread_name", devicePid, 0, "compute");
+    printName(file, "thread_name", devicePid, 1, "copy");
+    for (size_t tid = 0; tid < threads_.size(); ++tid)
+      printName(file, "thread_name", hostPid, tid,
+                "thread " + std::to_string(tid));
+
+    // Host slices of each thread in order, with the gaps between them.
+    std::stable_sort(host_.begin(), host_.end(),
+                     [](const Slice &a, const Slice &b) {
+                       return std::make_pair(a.tid, a.startNs) <
+                              std::make_pair(b.tid, b.startNs);
+                     });
+    uint64_t runtimeNs = 0, gapNs = 0;
+    for (size_t i = 0; i < host_.size(); ++i) {
+      auto &slice = host_[i];
+      printSlice(file, slice, hostPid, slice.tid);
+      runtimeNs += slice.endNs - slice.startNs;
+      if (i + 1 < host_.size() && host_[i + 1].tid == slice.tid &&
+          host_[i + 1].startNs > slice.endNs) {
+        Slice gap = {"host gap", "host", slice.endNs, host_[i + 1].startNs,
+                     slice.tid, 0};
+        printSlice(file, gap, hostPid, gap.tid);
+        gapNs += gap.endNs - gap.startNs;
+      }
+    }
+
+    uint64_t first = UINT64_MAX, last = 0;
+    std::vector<std::pair<uint64_t, uint64_t>> busy;
+    for (auto &slice : device_) {
+      printSlice(file, slice, devicePid, getDeviceTrack(slice));
+      first = std::min(first, slice.startNs);
+      last = std::max(last, slice.endNs);
+      busy.emplace_back(slice.startNs, slice.endNs);
+    }
+    auto busyNs = getCoveredNs(std::move(busy));
+    auto spanNs = device_.empty() ? 0 : last - first;
+
+    fprintf(file,
+            "\n  ],\n  \"otherData\": {\"wall_ms\": %f, \"runtime_ms\": %f, "
+            "\"host_gap_ms\": %f, \"device_busy_ms\": %f, "
+            "\"device_idle_ms\": %f, \"kernels\": %zu}\n}\n",
+            (now() - start_) / 1e6, runtimeNs / 1e6, gapNs / 1e6,
+            busyNs / 1e6, (spanNs - busyNs) / 1e6,
+            static_cast<size_t>(std::count_if(
+                device_.begin(), device_.end(), [](const Slice &slice) {
+                  return std::string(slice.category) == "kernel";
+                })));
+
+    if (file == stdout)
+      fflush(file);
+    else
+      fclose(file);
+  }
+
+  std::string path_;
+  uint64_t start_;
+  std::mutex mutex_;
+  std::map<const void *, std::string> names_;
+  std::map<std::thread::id, size_t> threads_;
+  std::vector<Slice> host_;
+  std::vector<Slice> device_;
+};
+
+/// Records the enclosing runtime wrapper call on the host timeline if tracing
+/// is enabled.
+class TraceScope {
+public:
+  explicit TraceScope(const char *name)
+      : recorder_(TraceRecorder::get()), name_(name),
+        startNs_(recorder_ ? TraceRecorder::now() : 0) {}
+
+  ~TraceScope() {
+    if (recorder_)
+      recorder_->recordHost(name_, startNs_, TraceRecorder::now());
+  }
+
+private:
+  TraceRecorder *recorder_;
+  const char *name_;
+  uint64_t startNs_;
+};
+
+} // namespace imex
+
+#endif // IMEX_EXECUTIONENGINE_TRACERECORDER_H
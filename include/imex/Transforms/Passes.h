@@ -25,7 +25,12 @@ namespace imex {
 std::unique_ptr<mlir::Pass> createSerializeSPIRVPass();
 std::unique_ptr<mlir::Pass>
 createInsertGPUAllocsPass(const char *clientAPI = "vulkan");
+std::unique_ptr<mlir::Pass> createPackGPUAllocsPass();
+std::unique_ptr<mlir::Pass> createHoistGPUAllocsPass();
 std::unique_ptr<mlir::Pass> createInsertGPUCopyPass();
+std::unique_ptr<mlir::Pass> createRemoveRedundantGPUCopiesPass();
+std::unique_ptr<mlir::Pass> createInsertGPUXMemoryHintsPass();
+std::unique_ptr<mlir::Pass> createAssignGPUXStreamsPass();
 std::unique_ptr<mlir::Pass> createSetSPIRVCapabilitiesPass();
 std::unique_ptr<mlir::Pass>
 createSetSPIRVAbiAttributePass(const char *clientAPI = "vulkan");
@@ -34,14 +39,24 @@ std::unique_ptr<mlir::Pass> createLowerMemRefCopyPass();
 std::unique_ptr<mlir::Pass> createBF16ToGPUPass();
 std::unique_ptr<mlir::Pass> createCastIndexPass();
 std::unique_ptr<mlir::Pass> createRemoveTemporariesPass();
+std::unique_ptr<mlir::Pass> createFuseGeneratorsPass();
+std::unique_ptr<mlir::Pass> createFuseSiblingReductionsPass();
 std::unique_ptr<mlir::Pass> createVectorLinearizePass();
 std::unique_ptr<mlir::Pass> createRemoveSingleElemVectorPass();
 std::unique_ptr<mlir::Pass>
 createOptimizeTransposePass(const std::string &device = "pvc");
 std::unique_ptr<mlir::Pass> createHoistTransposePass();
+std::unique_ptr<mlir::Pass>
+createMergeBlockLoadsPass(const std::string &device = "pvc");
 std::unique_ptr<mlir::Pass> createVnniTransformationPass();
 std::unique_ptr<mlir::Pass> createEmulateNonNativeBF16Pass();
 std::unique_ptr<mlir::Pass> createTileLoopsPass();
+std::unique_ptr<mlir::Pass> createMatmulToCoopMatrixPass();
+std::unique_ptr<mlir::Pass> createTransposeToGPUPass();
+std::unique_ptr<mlir::Pass> createFillToMemsetPass();
+std::unique_ptr<mlir::Pass> createEstimateKernelCostPass();
+std::unique_ptr<mlir::Pass> createGroupSizeAgnosticPass();
+std::unique_ptr<mlir::Pass> createLoadExternalGlobalsPass();
 
 #define GEN_PASS_DECL
 #include "imex/Transforms/Passes.h.inc"
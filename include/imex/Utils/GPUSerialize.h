@@ -13,6 +13,32 @@
 
 namespace imex {
 static constexpr const char *gpuBinaryAttrName = "gpu.binary";
+// GPU module attribute holding native binaries compiled ahead of time from
+// the SPIR-V in gpuBinaryAttrName, a dictionary from the PCI device ID the
+// binary was compiled for to the binary, see serialize-spirv.
+static constexpr const char *gpuNativeBinariesAttrName =
+    "imex.native_binaries";
+// Kernel attribute holding the number of GRFs per thread the module of the
+// kernel is to be compiled for.
+static constexpr const char *gpuGRFSizeAttrName = "imex.grf_size";
+// Kernel attribute holding the subgroup size the kernel is to be compiled
+// for, see imex-convert-gpu-to-spirv.
+static constexpr const char *gpuSubgroupSizeAttrName = "imex.subgroup_size";
+// Kernel attribute marking kernels to be compiled with the vector backend of
+// IGC (-vc-codegen), set by imex-convert-gpu-to-spirv.
+static constexpr const char *gpuVectorBackendAttrName = "imex.vector_backend";
+// Kernel attributes holding the estimated bytes moved and floating point
+// operations executed by one work item, see imex-estimate-kernel-cost.
+static constexpr const char *gpuBytesPerItemAttrName = "imex.bytes_per_item";
+static constexpr const char *gpuFlopsPerItemAttrName = "imex.flops_per_item";
+// Kernel attribute marking kernels that may be launched with any split of
+// their global size into groups, see imex-group-size-agnostic.
+static constexpr const char *gpuGroupSizeAgnosticAttrName =
+    "imex.group_size_agnostic";
+// gpu.alloc and gpux.alloc attribute naming the constant memref.global the
+// buffer holds a device copy of, see insert-gpu-allocs. The runtime uploads
+// the global once per stream instead of on every allocation.
+static constexpr const char *gpuConstantDataAttrName = "imex.constant_data";
 } // namespace imex
 
 #endif // _IMEX_GPUSERIALIZE_H_
@@ -0,0 +1,61 @@
+//===- Remarks.h - Missed Optimization Remarks ------------------*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This header file defines a utility for passes to report missed
+// optimizations, e.g. ops falling back to a slower lowering.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef _IMEX_REMARKS_H_
+#define _IMEX_REMARKS_H_
+
+#include <llvm/ADT/StringRef.h>
+#include <llvm/ADT/Twine.h>
+#include <mlir/IR/Operation.h>
+
+#include <string>
+
+namespace imex {
+
+/// Reports the missed optimizations of a pass, such as an op falling back
+/// to a slower lowering, with the reason and the location of the op.
+/// The output is given by the `remarks` option of the pass:
+///   - "": remarks are disabled.
+///   - "-": remarks are emitted as diagnostics attached to the op.
+///   - otherwise: remarks are appended to the file as YAML documents in the
+///     format of LLVM optimization records, e.g.
+///       --- !Missed
+///       Pass:            'imex-vector-linearize'
+///       Name:            'UnrolledLoad'
+///       DebugLoc:        { File: 'kernel.mlir', Line: 12, Column: 10 }
+///       Function:        'test_kernel'
+///       Args:
+///         - String:          'unrolled into 8 row loads'
+///       ...
+/// Emitting is thread-safe, such that remarks can be emitted by passes
+/// running in parallel.
+class MissedOptRemarks {
+public:
+  MissedOptRemarks(llvm::StringRef passName, llvm::StringRef output)
+      : passName(passName), output(output) {}
+
+  bool isEnabled() const { return !output.empty(); }
+
+  /// Reports that op missed the optimization identified by name for reason.
+  void emit(mlir::Operation *op, llvm::StringRef name,
+            const llvm::Twine &reason) const;
+
+private:
+  std::string passName;
+  std::string output;
+};
+
+} // namespace imex
+
+#endif // _IMEX_REMARKS_H_
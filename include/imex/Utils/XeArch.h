@@ -27,6 +27,8 @@
 #include "imex/Utils/DebugUtils.h"
 #include "imex/Utils/XeCommon.h"
 
+#include <memory>
+
 namespace imex {
 
 struct Range {
@@ -71,10 +73,23 @@ public:
     this->gpuArch = uArch;
 
     oneGRFSizeBits = 512;
+    // Register file sizes of the small and large GRF modes
+    numGRFs = 128;
+    numLargeGRFs = 256;
     // DPAS related params - default to PVC
     repeatCount = 8;
     sDepth = 8;
     execSize = 16;
+    // Device size - default to PVC (Data Center GPU Max 1550)
+    numXeCores = 128;
+    numEUsPerXeCore = 8;
+    // Hardware bf16 <-> f32 conversions - default to PVC
+    nativeBF16Conversion = true;
+    // LSC float atomics on f16 data - default to PVC
+    nativeF16Atomics = true;
+    // Shared local memory and named barriers per workgroup - default to PVC
+    slmSize = 128 * 1024;
+    numNamedBarriers = 32;
   }
 
   virtual mlir::LogicalResult checkSupportedDpasTypes(mlir::Operation *op,
@@ -116,14 +131,36 @@ public:
 
   mlir::LogicalResult isLegalPrefetch2dOp(mlir::Operation *op);
   unsigned int getOneGRFSizeBits() const { return oneGRFSizeBits; };
+  unsigned int getNumGRFs(bool largeGRF = false) const {
+    return largeGRF ? numLargeGRFs : numGRFs;
+  };
+  unsigned int getNumXeCores() const { return numXeCores; };
+  unsigned int getNumEUs() const { return numXeCores * numEUsPerXeCore; };
+  unsigned int getSubgroupSize() const { return execSize; };
+  bool hasNativeBF16Conversion() const { return nativeBF16Conversion; };
+  unsigned int getSLMSize() const { return slmSize; };
+  unsigned int getNumNamedBarriers() const { return numNamedBarriers; };
+
+  /// Returns true if an LSC atomic performs \p kind on \p elemTy data, else
+  /// the update has to be emulated with a compare-and-swap loop.
+  bool hasNativeAtomic(mlir::arith::AtomicRMWKind kind,
+                       mlir::Type elemTy) const;
 
 protected:
   ~XeuArchInterface() {}
   unsigned int oneGRFSizeBits;
+  unsigned int numGRFs;      // GRFs per thread in the default mode
+  unsigned int numLargeGRFs; // GRFs per thread in the large GRF mode
   unsigned int repeatCount;
   unsigned int sDepth;
   unsigned int execSize; // Maximum number of channels allowed. Number of
                          // Channels operating in parallel for dpas instruction
+  unsigned int numXeCores;      // Number of Xe cores of the device
+  unsigned int numEUsPerXeCore; // Number of vector engines (EUs) per Xe core
+  bool nativeBF16Conversion;    // Converts between bf16 and f32 in hardware
+  bool nativeF16Atomics;        // fadd, fmin and fmax atomics on f16
+  unsigned int slmSize;          // Bytes of SLM available to a workgroup
+  unsigned int numNamedBarriers; // Named barriers available to a workgroup
 
   /// D (MxN) = C (MxN) + A (MxK) x B (KxN)
   /// M = Repeat Count
@@ -200,8 +237,29 @@ public:
   }
   virtual mlir::FailureOr<LoadStore2DConfig>
   get2DStoreConfig(int element_data_size) override;
+
+protected:
+  XePVCuArch(mlir::StringRef uArch) : XeuArchInterface(uArch) {}
 };
 
+/// This class defines the Xe2 GPU Architecture of the client and workstation
+/// GPUs, Lunar Lake ("lnl") and Battlemage ("bmg"). Xe2 keeps the dpas shapes
+/// with subgroup size 16 and the 2D block message limits of PVC, so only the
+/// size of the device differs.
+class XeXe2uArch : public XePVCuArch {
+
+public:
+  XeXe2uArch(mlir::StringRef uArch, unsigned int numXeCores)
+      : XePVCuArch(uArch) {
+    this->numXeCores = numXeCores;
+  }
+  virtual ~XeXe2uArch() {}
+};
+
+/// Returns the uArch definition of \p device, e.g. "pvc", or null if the
+/// device is not supported.
+std::shared_ptr<XeuArchInterface> getXeuArch(mlir::StringRef device);
+
 } // namespace imex
 
 #endif
@@ -377,6 +377,20 @@ llvm::SmallVector<mlir::Value> getStridesOrOffsetsOrShapesInValueType(
     mlir::PatternRewriter &rewriter,
     ::llvm::SmallVector<mlir::OpFoldResult> mixedOSS, mlir::Location loc);
 
+// The role of a subgroup in a named barrier. By default, every participant
+// of a barrier created by xegpu.init_nbarrier is both a producer and a
+// consumer. A subgroup that only signals (producer) or only waits (consumer)
+// is marked with the discardable nbarrierRoleAttrName attribute on its
+// xegpu.init_nbarrier, and nbarrierProducersAttrName then gives how many of
+// the participants are producers.
+enum class NbarrierRole : uint8_t {
+  ProducerConsumer = 0,
+  Producer = 1,
+  Consumer = 2
+};
+constexpr llvm::StringLiteral nbarrierRoleAttrName = "nbarrier_role";
+constexpr llvm::StringLiteral nbarrierProducersAttrName = "num_producers";
+
 } // namespace imex
 
 #endif
@@ -45,12 +45,87 @@ namespace {
 // Get the VC intrinsic name for the given arith operation
 template <typename MOp> std::string getVCIntrinsicName() {
   constexpr bool isFMaxOp = std::is_same_v<MOp, arith::MaximumFOp>;
+  constexpr bool isFMinOp = std::is_same_v<MOp, arith::MinimumFOp>;
+  constexpr bool isFPToSIOp = std::is_same_v<MOp, arith::FPToSIOp>;
+  constexpr bool isFPToUIOp = std::is_same_v<MOp, arith::FPToUIOp>;
   if (isFMaxOp)
     return "llvm.genx.fmax.";
+  else if (isFMinOp)
+    return "llvm.genx.fmin.";
+  else if (isFPToSIOp)
+    return "llvm.genx.fptosi.sat.";
+  else if (isFPToUIOp)
+    return "llvm.genx.fptoui.sat.";
   else
     assert(0 && "Unsupported arith Op. Add more support!");
 }
 
+// Get the overloaded type suffix of an intrinsic for the given vector type,
+// e.g. v16f32 for vector<16xf32>
+std::string getVectorTypeSuffix(VectorType vecTy) {
+  auto elementType = vecTy.getElementType();
+  return llvm::formatv("v{0}{1}{2}", vecTy.getNumElements(),
+                       isa<FloatType>(elementType) ? 'f' : 'i',
+                       elementType.getIntOrFloatBitWidth())
+      .str();
+}
+
+// Returns true if the elementwise min/max op is converted to a vc-intrinsic:
+// "llvm.genx.fmax" and "llvm.genx.fmin" do not propagate NaNs, so the op
+// needs fastmath flags, unless SPIR-V does not support its vector size.
+template <typename MOp> bool isConvertibleMinMaxOp(MOp op, VectorType vecTy) {
+  bool isVectorAnyINTELType = imex::isVectorAnyINTELType(vecTy);
+  bool isFastmath =
+      (op.getFastmathAttr().getValue() != arith::FastMathFlags::none);
+  return isVectorAnyINTELType || isFastmath;
+}
+
+// Returns true if the fastmath flags allow to fuse the op with another op
+bool hasContractFlag(arith::FastMathFlags flags) {
+  return arith::bitEnumContainsAll(flags, arith::FastMathFlags::contract);
+}
+
+// Returns the arith.mulf operand of the arith.addf op on a 1-D vector of f16
+// or f32 that can be fused into an fma, i.e. that has no other use and both
+// ops allow contraction
+arith::MulFOp getFusableMulFOp(arith::AddFOp op) {
+  auto vecTy = dyn_cast<VectorType>(op.getType());
+  if (!vecTy || vecTy.getRank() != 1 || vecTy.getElementType().isBF16() ||
+      !hasContractFlag(op.getFastmath()))
+    return nullptr;
+  for (auto operand : op->getOperands()) {
+    auto mulOp = operand.getDefiningOp<arith::MulFOp>();
+    if (mulOp && mulOp->hasOneUse() && hasContractFlag(mulOp.getFastmath()))
+      return mulOp;
+  }
+  return nullptr;
+}
+
+// Returns true if the extf/truncf op converts between vectors of bf16 and f32
+bool isBF16Conversion(Operation *op) {
+  auto srcTy = dyn_cast<VectorType>(op->getOperand(0).getType());
+  auto dstTy = dyn_cast<VectorType>(op->getResult(0).getType());
+  if (!srcTy || !dstTy)
+    return false;
+  auto srcElementType = srcTy.getElementType();
+  auto dstElementType = dstTy.getElementType();
+  return (srcElementType.isBF16() && dstElementType.isF32()) ||
+         (srcElementType.isF32() && dstElementType.isBF16());
+}
+
+// Returns true if the fptosi/fptoui op converts a vector of f16 or f32 to a
+// vector of 8, 16 or 32 bit integers
+bool isSaturableFPToIntOp(Operation *op) {
+  auto srcTy = dyn_cast<VectorType>(op->getOperand(0).getType());
+  auto dstTy = dyn_cast<VectorType>(op->getResult(0).getType());
+  if (!srcTy || !dstTy)
+    return false;
+  auto srcElementType = srcTy.getElementType();
+  auto dstBitWidth = dstTy.getElementType().getIntOrFloatBitWidth();
+  return (srcElementType.isF16() || srcElementType.isF32()) &&
+         (dstBitWidth == 8 || dstBitWidth == 16 || dstBitWidth == 32);
+}
+
 //===----------------------------------------------------------------------===//
 // Operation conversion
 //===----------------------------------------------------------------------===//
@@ -72,10 +147,7 @@ struct ElementwiseArithOpPattern final : public OpConversionPattern<MOp> {
     auto loc = op.getLoc();
     auto args = adaptor.getOperands();
 
-    bool isVectorAnyINTELType = imex::isVectorAnyINTELType(vecTy);
-    bool isFastmath =
-        (op.getFastmathAttr().getValue() != arith::FastMathFlags::none);
-    if (!isVectorAnyINTELType && !isFastmath)
+    if (!isConvertibleMinMaxOp(op, vecTy))
       return failure();
     // for large vectors, generate the corresponding VC intrinsic.
     auto funcName = getVCIntrinsicName<MOp>();
@@ -86,6 +158,109 @@ struct ElementwiseArithOpPattern final : public OpConversionPattern<MOp> {
   }
 };
 
+// Fuses arith.mulf and arith.addf with the contract fastmath flag into a
+// single "llvm.fma" call, which the VC compiler emits as a mad instruction
+struct FMAOpPattern final : public OpConversionPattern<arith::AddFOp> {
+  using OpConversionPattern<arith::AddFOp>::OpConversionPattern;
+  LogicalResult
+  matchAndRewrite(arith::AddFOp op, OpAdaptor adaptor,
+                  ConversionPatternRewriter &rewriter) const override {
+    auto mulOp = getFusableMulFOp(op);
+    if (!mulOp)
+      return failure();
+
+    // The addend is the other operand of arith.addf
+    auto loc = op.getLoc();
+    auto addend = op.getLhs().getDefiningOp() == mulOp ? adaptor.getRhs()
+                                                       : adaptor.getLhs();
+    SmallVector<Value> args;
+    for (auto operand : mulOp->getOperands())
+      args.push_back(rewriter.getRemappedValue(operand));
+    args.push_back(addend);
+    auto vecTy = cast<VectorType>(op.getType());
+    auto funcName = "llvm.fma." + getVectorTypeSuffix(vecTy);
+    auto callOp = createFuncCall(rewriter, loc, funcName, {vecTy}, args, false);
+    rewriter.replaceOp(op, callOp);
+    rewriter.eraseOp(mulOp);
+    return success();
+  }
+};
+
+// arith.fptosi and arith.fptoui to saturating vc-intrinsics conversion
+// pattern. Out of range inputs are poison for arith, so saturating them to the
+// range of the integer type, as used for quantized outputs, is valid.
+template <typename MOp>
+struct SaturatingFPToIntOpPattern final : public OpConversionPattern<MOp> {
+  using OpConversionPattern<MOp>::OpConversionPattern;
+  LogicalResult
+  matchAndRewrite(MOp op, typename MOp::Adaptor adaptor,
+                  ConversionPatternRewriter &rewriter) const override {
+    auto *converter = this->getTypeConverter();
+    auto vecTy = dyn_cast<VectorType>(converter->convertType(op.getType()));
+    auto inVecTy = dyn_cast<VectorType>(adaptor.getIn().getType());
+    if (!vecTy || vecTy.getRank() != 1 || !inVecTy ||
+        !isSaturableFPToIntOp(op))
+      return failure();
+
+    auto funcName = getVCIntrinsicName<MOp>() + getVectorTypeSuffix(vecTy) +
+                    "." + getVectorTypeSuffix(inVecTy);
+    auto callOp = createFuncCall(rewriter, op.getLoc(), funcName, {vecTy},
+                                 {adaptor.getIn()}, false);
+    rewriter.replaceOp(op, callOp);
+    return success();
+  }
+};
+
+// bf16 arith.extf and arith.truncf conversion pattern. The conversions are
+// done on whole vectors with integer ops on the bits of the values: bf16 is
+// the upper half of f32, and f32 is rounded to nearest even on truncation with
+// NaNs mapped to the quiet NaN 0x7FC0.
+template <typename MOp>
+struct BF16ConversionOpPattern final : public OpConversionPattern<MOp> {
+  using OpConversionPattern<MOp>::OpConversionPattern;
+  LogicalResult
+  matchAndRewrite(MOp op, typename MOp::Adaptor adaptor,
+                  ConversionPatternRewriter &rewriter) const override {
+    auto *converter = this->getTypeConverter();
+    auto vecTy = dyn_cast<VectorType>(converter->convertType(op.getType()));
+    if (!vecTy || vecTy.getRank() != 1 || !isBF16Conversion(op))
+      return failure();
+
+    auto loc = op.getLoc();
+    auto i16VecTy = VectorType::get(vecTy.getShape(), rewriter.getI16Type());
+    auto i32VecTy = VectorType::get(vecTy.getShape(), rewriter.getI32Type());
+    auto createConstant = [&](int64_t value) {
+      return rewriter.create<arith::ConstantOp>(
+          loc, DenseElementsAttr::get(i32VecTy,
+                                      rewriter.getI32IntegerAttr(value)));
+    };
+    auto in = adaptor.getIn();
+    auto sixteen = createConstant(16);
+    if (vecTy.getElementType().isF32()) {
+      auto bits = rewriter.create<arith::BitcastOp>(loc, i16VecTy, in);
+      auto ext = rewriter.create<arith::ExtUIOp>(loc, i32VecTy, bits);
+      auto shl = rewriter.create<arith::ShLIOp>(loc, ext, sixteen);
+      rewriter.replaceOpWithNewOp<arith::BitcastOp>(op, vecTy, shl);
+      return success();
+    }
+
+    auto bits = rewriter.create<arith::BitcastOp>(loc, i32VecTy, in);
+    auto upper = rewriter.create<arith::ShRUIOp>(loc, bits, sixteen);
+    auto lsb = rewriter.create<arith::AndIOp>(loc, upper, createConstant(1));
+    auto bias =
+        rewriter.create<arith::AddIOp>(loc, lsb, createConstant(0x7FFF));
+    auto rounded = rewriter.create<arith::AddIOp>(loc, bits, bias);
+    auto roundedUpper = rewriter.create<arith::ShRUIOp>(loc, rounded, sixteen);
+    auto isNaN =
+        rewriter.create<arith::CmpFOp>(loc, arith::CmpFPredicate::UNO, in, in);
+    auto result = rewriter.create<arith::SelectOp>(
+        loc, isNaN, createConstant(0x7FC0), roundedUpper);
+    auto trunc = rewriter.create<arith::TruncIOp>(loc, i16VecTy, result);
+    rewriter.replaceOpWithNewOp<arith::BitcastOp>(op, vecTy, trunc);
+    return success();
+  }
+};
+
 } // namespace
 
 //===----------------------------------------------------------------------===//
@@ -96,7 +271,12 @@ void imex::populateArithToVCPatterns(
     ::mlir::TypeConverter &typeConverter, ::mlir::RewritePatternSet &patterns,
     bool enableHighPrecisionInterimCalculation) {
   // Add patterns
-  patterns.add<ElementwiseArithOpPattern<arith::MaximumFOp>>(
+  patterns.add<ElementwiseArithOpPattern<arith::MaximumFOp>,
+               ElementwiseArithOpPattern<arith::MinimumFOp>, FMAOpPattern,
+               SaturatingFPToIntOpPattern<arith::FPToSIOp>,
+               SaturatingFPToIntOpPattern<arith::FPToUIOp>,
+               BF16ConversionOpPattern<arith::ExtFOp>,
+               BF16ConversionOpPattern<arith::TruncFOp>>(
       typeConverter, patterns.getContext());
 }
 
@@ -107,19 +287,27 @@ void imex::configureArithToVCConversionLegality(
     ::mlir::ConversionTarget &target) {
   // Add legal dialects
   target.addLegalDialect<func::FuncDialect, arith::ArithDialect>();
-  // arith.maximumf is converted if they are vectors
-  target.addDynamicallyLegalOp<arith::MaximumFOp>([&](arith::MaximumFOp op) {
-    if (auto vecTy = dyn_cast<VectorType>(op.getType())) {
-      vecTy = VectorType::get(vecTy.getNumElements(), vecTy.getElementType());
-      bool isVectorAnyINTELType = imex::isVectorAnyINTELType(vecTy);
-      bool isFastmath =
-          (op.getFastmathAttr().getValue() != arith::FastMathFlags::none);
-      if (!isVectorAnyINTELType && !isFastmath)
-        return true;
-      return false;
-    }
-    return true;
-  });
+  // arith.maximumf and arith.minimumf are converted if they are vectors
+  auto isLegalMinMaxOp = [&](auto op) {
+    auto vecTy = dyn_cast<VectorType>(op.getType());
+    if (!vecTy)
+      return true;
+    vecTy = VectorType::get(vecTy.getNumElements(), vecTy.getElementType());
+    return !isConvertibleMinMaxOp(op, vecTy);
+  };
+  target.addDynamicallyLegalOp<arith::MaximumFOp>(
+      [=](arith::MaximumFOp op) { return isLegalMinMaxOp(op); });
+  target.addDynamicallyLegalOp<arith::MinimumFOp>(
+      [=](arith::MinimumFOp op) { return isLegalMinMaxOp(op); });
+  // arith.addf is fused with arith.mulf on vectors if both allow contraction
+  target.addDynamicallyLegalOp<arith::AddFOp>(
+      [&](arith::AddFOp op) { return !getFusableMulFOp(op); });
+  // Vector fptosi and fptoui are converted to saturating conversions
+  target.addDynamicallyLegalOp<arith::FPToSIOp, arith::FPToUIOp>(
+      [&](Operation *op) { return !isSaturableFPToIntOp(op); });
+  // Vector bf16 extf and truncf are converted to integer ops
+  target.addDynamicallyLegalOp<arith::ExtFOp, arith::TruncFOp>(
+      [&](Operation *op) { return !isBF16Conversion(op); });
 }
 
 //===----------------------------------------------------------------------===//
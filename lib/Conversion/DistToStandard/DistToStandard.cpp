@@ -267,23 +267,28 @@ struct DeleteOpConverter
   }
 };
 
-// extract RankedTensor and create ::imex::dist::AllReduceOp
-inline ::imex::distruntime::AllReduceOp
-createAllReduce(::mlir::Location &loc, ::mlir::OpBuilder &builder,
-                ::mlir::Attribute op, ::mlir::Value ndArray) {
-  auto arType = mlir::dyn_cast<::imex::ndarray::NDArrayType>(ndArray.getType());
-  assert(arType);
-  auto lArray = builder.create<::imex::ndarray::ToTensorOp>(loc, ndArray);
-  auto lMRef = createToMemRef(loc, builder, lArray, arType.getMemRefType());
-  return builder.create<::imex::distruntime::AllReduceOp>(loc, op, lMRef);
+// create ::imex::distruntime::AllReduceOp and wait for it
+// The wait can be pushed down to the first use of the result later
+inline ::mlir::Value createAllReduce(::mlir::Location &loc,
+                                     ::mlir::OpBuilder &builder,
+                                     ::mlir::Attribute op,
+                                     ::mlir::Value ndArray) {
+  assert(mlir::isa<::imex::ndarray::NDArrayType>(ndArray.getType()));
+  auto allReduce =
+      builder.create<::imex::distruntime::AllReduceOp>(loc, op, ndArray);
+  (void)builder.create<::imex::distruntime::WaitOp>(loc,
+                                                    allReduce.getHandle());
+  return allReduce.getResult();
 }
 
 /// Rewrite ::imex::ndarray::ReductionOp to get a distributed
 /// reduction if operand is distributed.
-/// Create global, distributed 0d output array.
-/// The local partitions of operand (e.g. RankedTensor) is wrapped in
+/// The local partition of operand (e.g. RankedTensor) is wrapped in
 /// non-distributed NDArray and re-applied to reduction.
-/// The result is then applied to a distributed allreduce.
+/// Arrays are split along the first dimension only. If it gets reduced, the
+/// local result is applied to a distributed allreduce and the output array
+/// is replicated on all team members. Otherwise the local results already
+/// are the partitions of the output, distributed like the operand.
 /// op gets replaced with global distributed array
 struct ReductionOpConverter
     : public ::mlir::OpConversionPattern<::imex::ndarray::ReductionOp> {
@@ -294,7 +299,6 @@ struct ReductionOpConverter
   matchAndRewrite(::imex::ndarray::ReductionOp op,
                   ::imex::ndarray::ReductionOp::Adaptor adaptor,
                   ::mlir::ConversionPatternRewriter &rewriter) const override {
-    // FIXME reduction over individual dimensions is not supported
     auto loc = op.getLoc();
     auto inp = op.getInput();
     auto inpDistTyp =
@@ -303,21 +307,42 @@ struct ReductionOpConverter
     if (!inpDistTyp || !isDist(inpDistTyp))
       return ::mlir::failure();
 
+    auto redDims = op.getReducedDims();
+    bool splitReduced = !redDims.empty() && redDims.front() == 0;
+    auto resDistTyp = mlir::cast<::imex::ndarray::NDArrayType>(op.getType());
+    auto resRank = resDistTyp.getRank();
+
     // Local reduction
     auto parts = createPartsOf(loc, rewriter, inp);
     auto local = parts.size() == 1 ? parts[0] : parts[1];
-    auto retArType = cloneAsNonDist(op.getType());
+    auto retArType = splitReduced ? cloneAsNonDist(resDistTyp)
+                                  : cloneAsDynNonDist(resDistTyp);
     auto redArray = rewriter.create<::imex::ndarray::ReductionOp>(
-        loc, retArType, op.getOp(), local);
-    // global reduction
-    (void)createAllReduce(loc, rewriter, op.getOp(), redArray);
+        loc, retArType, op.getOp(), local, op.getDimsAttr(),
+        op.getKeepdimsAttr());
+
+    ::imex::ValVec lOffs;
+    ::mlir::Value lRes = redArray;
+    if (splitReduced) {
+      // global reduction, the result is replicated
+      lRes = createAllReduce(loc, rewriter, op.getOp(), redArray);
+      lOffs.assign(resRank, createIndex(loc, rewriter, 0));
+    } else {
+      // keep the offsets of the dimensions not reduced
+      auto inpOffs = createLocalOffsetsOf(loc, rewriter, inp);
+      for (auto [i, off] : llvm::enumerate(inpOffs)) {
+        if (!llvm::is_contained(redDims, static_cast<int64_t>(i)))
+          lOffs.emplace_back(off);
+        else if (op.getKeepdims())
+          lOffs.emplace_back(createIndex(loc, rewriter, 0));
+      }
+    }
 
     // init our new dist array
-    // FIXME result shape is 0d always
     rewriter.replaceOp(op, createDistArray(loc, rewriter,
                                            getDistEnv(inpDistTyp).getTeam(),
-                                           ::mlir::SmallVector<int64_t>(), {},
-                                           redArray.getResult()));
+                                           resDistTyp.getShape(), lOffs,
+                                           lRes));
     return ::mlir::success();
   }
 };
@@ -727,6 +752,42 @@ struct EWBinOpConverter
     ++i;
   };
 
+  // operands of lower rank are broadcasted along the split dimension of the
+  // result and are replicated: their parts together hold the entire array.
+  // Returns a local array holding all parts, which is then broadcasted by
+  // each local ewbinop; only the (small) broadcasted operand gets copied.
+  ::mlir::Value getReplicated(::mlir::OpBuilder &builder, ::mlir::Location loc,
+                              ::imex::ndarray::NDArrayType distType,
+                              const EasyIdx &zero, ::mlir::ValueRange parts,
+                              const ::mlir::SmallVector<::imex::ValVec> &shapes,
+                              const ::imex::ValVec &unitStrides) const {
+    if (parts.size() == 1) {
+      return parts.front();
+    }
+    auto shape = shapes.front();
+    auto sz = zero;
+    for (auto &shp : shapes) {
+      sz = sz + easyIdx(loc, builder, shp[0]);
+    }
+    shape[0] = sz.get();
+    ::mlir::Value res =
+        builder
+            .create<::imex::ndarray::CreateOp>(
+                loc, shape,
+                ::imex::ndarray::fromMLIR(distType.getElementType()), nullptr,
+                getNonDistEnvs(distType))
+            .getResult();
+    ::imex::ValVec offs(distType.getRank(), zero.get());
+    auto off = zero;
+    for (auto [part, shp] : llvm::zip(parts, shapes)) {
+      offs[0] = off.get();
+      res = builder.create<::imex::ndarray::ImmutableInsertSliceOp>(
+          loc, res, part, offs, shp, unitStrides);
+      off = off + easyIdx(loc, builder, shp[0]);
+    }
+    return res;
+  }
+
   ::mlir::LogicalResult
   matchAndRewrite(::imex::dist::EWBinOp op,
                   ::imex::dist::EWBinOp::Adaptor adaptor,
@@ -755,6 +816,10 @@ struct EWBinOpConverter
         !(lhsDistType.hasUnitSize() || lhsDistType.hasZeroSize());
     auto rhsNeedsView =
         !(rhsDistType.hasUnitSize() || rhsDistType.hasZeroSize());
+    // the split dimension of the result is not a dimension of operands with
+    // lower rank; they are broadcasted and replicated
+    auto lhsIsBcast = lhsRank && lhsRank < rank && lhsNeedsView;
+    auto rhsIsBcast = rhsRank && rhsRank < rank && rhsNeedsView;
     auto resArType = cloneAsDynNonDist(resDistType);
     // auto core = adaptor.getCore();
 
@@ -823,7 +888,7 @@ struct EWBinOpConverter
     if (lhsRank) { // insert bounds of lhs
       for (auto p : lhsParts) {
         auto shp = createShapeOf(loc, rewriter, p);
-        if (shp.size() && !lhsDistType.hasUnitSize()) {
+        if (shp.size() && !lhsDistType.hasUnitSize() && !lhsIsBcast) {
           loopStarts.emplace_back(loopStarts.back() +
                                   easyIdx(loc, rewriter, shp[0]));
         }
@@ -836,7 +901,7 @@ struct EWBinOpConverter
       auto prev = zero;
       for (auto p : rhsParts) {
         auto shp = createShapeOf(loc, rewriter, p);
-        if (shp.size() && !rhsDistType.hasUnitSize()) {
+        if (shp.size() && !rhsDistType.hasUnitSize() && !rhsIsBcast) {
           loopStarts.emplace_back(prev + easyIdx(loc, rewriter, shp[0]));
         }
         prev = loopStarts.back();
@@ -883,7 +948,6 @@ struct EWBinOpConverter
       }
     }
 
-    // FIXME broadcasting
     ::imex::ValVec resShape;
     for (unsigned i = 0; i < rank; ++i) {
       auto d = resGShape[i];
@@ -903,6 +967,19 @@ struct EWBinOpConverter
     ::imex::ValVec resOffs(rank, zero.get());
     ::imex::ValVec unitStrides(rank, createIndex(loc, rewriter, 1));
 
+    // broadcasted operands are the same for all loop slices
+    ::mlir::Value lhsBcast, rhsBcast;
+    if (lhsIsBcast) {
+      lhsBcast = getReplicated(rewriter, loc, lhsDistType, zero, lhsParts,
+                               lhsShapes,
+                               ::imex::ValVec(lhsRank, unitStrides[0]));
+    }
+    if (rhsIsBcast) {
+      rhsBcast = getReplicated(rewriter, loc, rhsDistType, zero, rhsParts,
+                               rhsShapes,
+                               ::imex::ValVec(rhsRank, unitStrides[0]));
+    }
+
     // for each loop slice, determine overlap with lhs and rhs
     // apply to ndarray::ewbinop and insert into result array
     auto createLoop = [&](const std::pair<EasyIdx, EasyIdx> &lp,
@@ -955,7 +1032,9 @@ struct EWBinOpConverter
             };
 
             ::mlir::Value lhsView = lhsParts.back();
-            if (lhsRank && lhsNeedsView) {
+            if (lhsIsBcast) {
+              lhsView = lhsBcast;
+            } else if (lhsRank && lhsNeedsView) {
               getPart(builder, loc, rank, zero, unitStrides, lhsParts,
                       lhsShapes, slcOff, slcSz, zero, 0, lhsView);
             } else if (lhsDistType.hasUnitSize()) {
@@ -966,7 +1045,9 @@ struct EWBinOpConverter
             }
 
             ::mlir::Value rhsView = rhsParts.back();
-            if (rhsRank && rhsNeedsView) {
+            if (rhsIsBcast) {
+              rhsView = rhsBcast;
+            } else if (rhsRank && rhsNeedsView) {
               getPart(builder, loc, rank, zero, unitStrides, rhsParts,
                       rhsShapes, slcOff, slcSz, zero, 0, rhsView);
             } else if (rhsDistType.hasUnitSize()) {
@@ -1230,6 +1311,8 @@ struct LocalOffsetsOfOpConverter
 /// We currently assume evenly split data.
 /// We back-fill partitions if partitions are uneven (increase last to first
 /// partition in prank-order by one additional item)
+/// With a grid, each dimension is split this way among the blocks of the
+/// grid in that dimension, at the grid coordinate of the process.
 struct DefaultPartitionOpConverter
     : public ::mlir::OpConversionPattern<::imex::dist::DefaultPartitionOp> {
   using ::mlir::OpConversionPattern<
@@ -1239,7 +1322,7 @@ struct DefaultPartitionOpConverter
   matchAndRewrite(::imex::dist::DefaultPartitionOp op,
                   ::imex::dist::DefaultPartitionOp::Adaptor adaptor,
                   ::mlir::ConversionPatternRewriter &rewriter) const override {
-    // FIXME: non-even partitions, ndims
+    // FIXME: non-even partitions
     auto gShape = adaptor.getGShape();
     int64_t rank = static_cast<int64_t>(gShape.size());
 
@@ -1249,22 +1332,99 @@ struct DefaultPartitionOpConverter
     }
 
     auto loc = op.getLoc();
-    auto sz = easyIdx(loc, rewriter, gShape.front());
-    auto np = easyIdx(loc, rewriter, adaptor.getNumProcs());
     auto pr = easyIdx(loc, rewriter, adaptor.getPRank());
     auto one = easyIdx(loc, rewriter, 1);
     auto zero = easyIdx(loc, rewriter, 0);
 
-    // compute tile size and local size (which can be greater)
-    auto rem = sz % np;
-    auto tSz = sz / np;
-    auto lSz = tSz + (pr + rem).sge(np).select(one, zero);
-    auto lOff = (pr * tSz) + zero.max(rem - (np - pr));
+    ::imex::ValVec res(2 * rank, zero.get());
+    // cut dimension i into np parts and store part gr in result range
+    auto cut = [&](int64_t i, const EasyIdx &np, const EasyIdx &gr) {
+      auto sz = easyIdx(loc, rewriter, gShape[i]);
+      // compute tile size and local size (which can be greater)
+      auto rem = sz % np;
+      auto tSz = sz / np;
+      auto lSz = tSz + (gr + rem).sge(np).select(one, zero);
+      auto lOff = (gr * tSz) + zero.max(rem - (np - gr));
+      res[i] = lOff.get();
+      res[rank + i] = lSz.max(zero).get();
+    };
+
+    if (auto grid = op.getGrid()) {
+      // the grid is row-major, the last dimension changes fastest
+      for (int64_t i = rank - 1; i > 0; --i) {
+        auto np = easyIdx(loc, rewriter, (*grid)[i]);
+        cut(i, np, pr % np);
+        pr = pr / np;
+      }
+      cut(0, easyIdx(loc, rewriter, grid->front()), pr);
+    } else {
+      cut(0, easyIdx(loc, rewriter, adaptor.getNumProcs()), pr);
+      for (int64_t i = 1; i < rank; ++i) {
+        res[rank + i] = gShape[i];
+      }
+    }
+
+    rewriter.replaceOp(op, res);
+    return ::mlir::success();
+  }
+};
+
+/// Convert ::imex::dist::WeightedPartitionOp into arith ops.
+/// The prefix sum of the weights up to p_rank and the total weight get
+/// accumulated in a loop over all team members, dim 0 gets cut accordingly.
+struct WeightedPartitionOpConverter
+    : public ::mlir::OpConversionPattern<::imex::dist::WeightedPartitionOp> {
+  using ::mlir::OpConversionPattern<
+      ::imex::dist::WeightedPartitionOp>::OpConversionPattern;
+
+  ::mlir::LogicalResult
+  matchAndRewrite(::imex::dist::WeightedPartitionOp op,
+                  ::imex::dist::WeightedPartitionOp::Adaptor adaptor,
+                  ::mlir::ConversionPatternRewriter &rewriter) const override {
+    auto gShape = adaptor.getGShape();
+    int64_t rank = static_cast<int64_t>(gShape.size());
+
+    if (rank == 0) {
+      rewriter.eraseOp(op);
+      return ::mlir::success();
+    }
+
+    auto loc = op.getLoc();
+    auto weights = adaptor.getWeights();
+    auto pr = easyIdx(loc, rewriter, adaptor.getPRank());
+    auto zero = easyIdx(loc, rewriter, 0);
+    auto one = easyIdx(loc, rewriter, 1);
+    auto np = easyIdx(loc, rewriter,
+                      rewriter.create<::mlir::memref::DimOp>(loc, weights, 0));
+
+    // sum of weights of members before pr and sum of all weights
+    auto sums = rewriter.create<::mlir::scf::ForOp>(
+        loc, zero.get(), np.get(), one.get(),
+        ::mlir::ValueRange{zero.get(), zero.get()},
+        [&](::mlir::OpBuilder &builder, ::mlir::Location loc,
+            ::mlir::Value iv, ::mlir::ValueRange args) {
+          auto i = easyIdx(loc, builder, iv);
+          auto w = easyIdx(loc, builder,
+                           builder.create<::mlir::memref::LoadOp>(
+                               loc, weights, ::mlir::ValueRange{iv}));
+          auto pre = easyIdx(loc, builder, args[0]);
+          auto tot = easyIdx(loc, builder, args[1]);
+          (void)builder.create<::mlir::scf::YieldOp>(
+              loc, ::mlir::ValueRange{i.slt(pr).select(pre + w, pre).get(),
+                                      (tot + w).get()});
+        });
+    auto pre = easyIdx(loc, rewriter, sums.getResult(0));
+    auto tot = easyIdx(loc, rewriter, sums.getResult(1));
+    auto w = easyIdx(loc, rewriter,
+                     rewriter.create<::mlir::memref::LoadOp>(
+                         loc, weights, adaptor.getPRank()));
 
-    // store in result range
     ::imex::ValVec res(2 * rank, zero.get());
+    auto sz = easyIdx(loc, rewriter, gShape[0]);
+    auto lOff = (sz * pre) / tot;
+    auto lEnd = (sz * (pre + w)) / tot;
     res[0] = lOff.get();
-    res[rank] = lSz.max(zero).get();
+    res[rank] = (lEnd - lOff).get();
     for (int64_t i = 1; i < rank; ++i) {
       res[rank + i] = gShape[i];
     }
@@ -1343,6 +1503,12 @@ struct LocalBoundingBoxOpConverter
                   ::imex::dist::LocalBoundingBoxOp::Adaptor adaptor,
                   ::mlir::ConversionPatternRewriter &rewriter) const override {
 
+    // the bounding box is computed for a split of dim 0 only
+    if (isGridPartitioned(op.getTargetOffsets()) ||
+        isGridPartitioned(op.getBBOffsets())) {
+      return ::mlir::failure();
+    }
+
     auto loc = op.getLoc();
     auto inner = op.getInner();
     assert(!inner);
@@ -1418,6 +1584,9 @@ struct LocalCoreOpConverter
     auto distType = mlir::dyn_cast<::imex::ndarray::NDArrayType>(src.getType());
     if (!distType || !isDist(distType))
       return ::mlir::failure();
+    // local core is computed for a split of dim 0 only
+    if (hasGridPartition(src) || isGridPartitioned(op.getTargetOffsets()))
+      return ::mlir::failure();
 
     auto rank = distType.getRank();
     if (rank == 0) {
@@ -1509,6 +1678,9 @@ struct RePartitionOpConverter
         mlir::dyn_cast<::imex::ndarray::NDArrayType>(base.getType());
     if (!distType || !isDist(distType))
       return ::mlir::failure();
+    // halos are exchanged along dim 0 only
+    if (hasGridPartition(base) || isGridPartitioned(op.getTargetOffsets()))
+      return ::mlir::failure();
 
     auto loc = op.getLoc();
     auto rank = distType.getRank();
@@ -1676,7 +1848,7 @@ struct PermuteDimsOpConverter
 struct ConvertDistToStandardPass
     : public ::imex::impl::ConvertDistToStandardBase<
           ConvertDistToStandardPass> {
-  ConvertDistToStandardPass() = default;
+  using ConvertDistToStandardBase::ConvertDistToStandardBase;
 
   void runOnOperation() override {
     auto &ctxt = getContext();
@@ -1777,8 +1949,9 @@ struct ConvertDistToStandardPass
         LocalBoundingBoxOpConverter, LocalCoreOpConverter,
         RePartitionOpConverter, ReshapeOpConverter,
         LocalTargetOfSliceOpConverter, DefaultPartitionOpConverter,
-        LocalOffsetsOfOpConverter, PartsOfOpConverter, DeleteOpConverter,
-        CastElemTypeOpConverter, PermuteDimsOpConverter>(typeConverter, &ctxt);
+        WeightedPartitionOpConverter, LocalOffsetsOfOpConverter,
+        PartsOfOpConverter, DeleteOpConverter, CastElemTypeOpConverter,
+        PermuteDimsOpConverter>(typeConverter, &ctxt);
     mlir::scf::populateSCFStructuralTypeConversionsAndLegality(
         typeConverter, patterns, target);
     ::imex::populateRegionTypeConversionPatterns(patterns, typeConverter);
@@ -1792,6 +1965,25 @@ struct ConvertDistToStandardPass
     // now remove all InitDistArrayOps
     getOperation()->walk(
         [&](::imex::dist::InitDistArrayOp op) { op->erase(); });
+
+    // specialize for the team if requested
+    if (nProcs > 0 || pRank >= 0) {
+      getOperation()->walk([&](::mlir::Operation *op) {
+        int64_t val = -1;
+        if (::mlir::isa<::imex::distruntime::TeamSizeOp>(op) && nProcs > 0)
+          val = nProcs;
+        else if (::mlir::isa<::imex::distruntime::TeamMemberOp>(op) &&
+                 pRank >= 0)
+          val = pRank;
+        else
+          return;
+        ::mlir::OpBuilder builder(op);
+        auto cst = builder.create<::mlir::arith::ConstantIndexOp>(
+            op->getLoc(), val);
+        op->replaceAllUsesWith(cst);
+        op->erase();
+      });
+    }
   }
 };
 
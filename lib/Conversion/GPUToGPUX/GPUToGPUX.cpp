@@ -15,6 +15,7 @@
 
 #include <imex/Conversion/GPUToGPUX/GPUToGPUX.h>
 #include <imex/Dialect/GPUX/IR/GPUXOps.h>
+#include <imex/Utils/GPUSerialize.h>
 #include <imex/Utils/PassWrapper.h>
 #include <mlir/Dialect/Func/IR/FuncOps.h>
 #include <mlir/Dialect/GPU/IR/GPUDialect.h>
@@ -74,9 +75,12 @@ struct ConvertAllocOp : public mlir::OpRewritePattern<mlir::gpu::AllocOp> {
     auto hostShared = op.getHostShared();
     mlir::Type token =
         op.getAsyncToken() ? op.getAsyncToken().getType() : nullptr;
-    rewriter.replaceOpWithNewOp<imex::gpux::AllocOp>(
+    auto constantData = op->getAttr(imex::gpuConstantDataAttrName);
+    auto alloc = rewriter.replaceOpWithNewOp<imex::gpux::AllocOp>(
         op, op.getType(), token, op.getAsyncDependencies(), stream,
         op.getDynamicSizes(), op.getSymbolOperands(), hostShared);
+    if (constantData)
+      alloc->setAttr(imex::gpuConstantDataAttrName, constantData);
 
     return mlir::success();
   }
@@ -14,12 +14,15 @@
 ///
 //===----------------------------------------------------------------------===//
 #include "imex/Conversion/GPUToSPIRV/GPUToSPIRVPass.h"
+#include "imex/Utils/GPUSerialize.h"
 
 #include "mlir/Dialect/Vector/IR/VectorOps.h"
 #include "mlir/IR/BuiltinTypes.h"
 
 #include "mlir/Dialect/UB/IR/UBOps.h"
 #include <llvm/ADT/ArrayRef.h>
+#include <llvm/Support/MathExtras.h>
+#include <llvm/ADT/StringMap.h>
 #include <llvm/Support/Debug.h>
 #include <mlir/Conversion/ArithToSPIRV/ArithToSPIRV.h>
 #include <mlir/Conversion/ControlFlowToSPIRV/ControlFlowToSPIRV.h>
@@ -32,18 +35,30 @@
 #include <mlir/Conversion/VectorToSPIRV/VectorToSPIRV.h>
 #include <mlir/Dialect/Arith/IR/Arith.h>
 #include <mlir/Dialect/GPU/IR/GPUDialect.h>
+#include <mlir/Dialect/MemRef/IR/MemRef.h>
+#include <mlir/Dialect/SCF/IR/SCF.h>
 #include <mlir/Dialect/SPIRV/IR/SPIRVDialect.h>
 #include <mlir/Dialect/SPIRV/IR/SPIRVOps.h>
 #include <mlir/Dialect/SPIRV/IR/SPIRVTypes.h>
+#include <mlir/Dialect/SPIRV/IR/TargetAndABI.h>
 #include <mlir/Dialect/SPIRV/Transforms/SPIRVConversion.h>
 #include <mlir/Dialect/XeGPU/IR/XeGPU.h>
+#include <mlir/IR/OperationSupport.h>
 #include <mlir/IR/BuiltinOps.h>
 #include <mlir/IR/Matchers.h>
+#include <mlir/Interfaces/CallInterfaces.h>
+#include <mlir/IR/OwningOpRef.h>
+#include <mlir/IR/SymbolTable.h>
+#include <mlir/IR/Threading.h>
 #include <mlir/Support/LLVM.h>
 #include <mlir/Transforms/DialectConversion.h>
+#include <mlir/Transforms/GreedyPatternRewriteDriver.h>
 
 #include <mlir/Pass/Pass.h>
 
+#include <functional>
+#include <map>
+
 namespace imex {
 #define GEN_PASS_DEF_CONVERTGPUXTOSPIRV
 #include "imex/Conversion/Passes.h.inc"
@@ -60,6 +75,17 @@ namespace imex {
 /// replace it).
 ///
 /// 2) Lower the body of the spirv::ModuleOp.
+///
+/// Kernel modules are lowered in parallel. With deduplicate-kernels, kernel
+/// modules that only differ in names from an earlier one are replaced by it
+/// before, so that they are lowered, serialized and loaded only once. With
+/// merge-modules, all kernel modules are merged into one before, which gets
+/// one SPIR-V module with an entry point per kernel.
+///
+/// Kernels are annotated with the options the runtimes compile them with
+/// (subgroup size, vector backend) and kernel modules mixing kernels with
+/// different options get split, so that each module is built with the
+/// options of its kernels.
 class GPUXToSPIRVPass : public impl::ConvertGPUXToSPIRVBase<GPUXToSPIRVPass> {
 public:
   explicit GPUXToSPIRVPass(bool mapMemorySpace)
@@ -67,6 +93,9 @@ public:
   void runOnOperation() override;
 
 private:
+  // Converts the kernel module \p gpuModule to a SPIR-V module.
+  mlir::LogicalResult convertModule(mlir::gpu::GPUModuleOp gpuModule);
+
   bool mapMemorySpace;
 };
 
@@ -303,6 +332,324 @@ void populateUBToSPIRVConversionPatterns(
   patterns.add<PoisonOpLowering>(converter, patterns.getContext());
 }
 
+using CombineFn = std::function<mlir::Value(
+    mlir::OpBuilder &, mlir::Location, mlir::Value, mlir::Value)>;
+
+// Returns a function combining two SPIR-V values of \p elementType (or
+// vectors of it) with \p kind, or null if \p kind is not supported.
+static CombineFn getCombineFn(mlir::vector::CombiningKind kind,
+                              mlir::Type elementType) {
+  using mlir::vector::CombiningKind;
+  auto make = [](auto opTag) -> CombineFn {
+    using OpTy = decltype(opTag);
+    return [](mlir::OpBuilder &builder, mlir::Location loc, mlir::Value lhs,
+              mlir::Value rhs) -> mlir::Value {
+      return builder.create<OpTy>(loc, lhs, rhs);
+    };
+  };
+  bool isFloat = mlir::isa<mlir::FloatType>(elementType);
+  bool isBool = elementType.isInteger(1);
+  if (isFloat) {
+    switch (kind) {
+    case CombiningKind::ADD:
+      return make(mlir::spirv::FAddOp());
+    case CombiningKind::MUL:
+      return make(mlir::spirv::FMulOp());
+    case CombiningKind::MINNUMF:
+      return make(mlir::spirv::CLFMinOp());
+    case CombiningKind::MAXNUMF:
+      return make(mlir::spirv::CLFMaxOp());
+    default:
+      return nullptr;
+    }
+  }
+  if (isBool) {
+    switch (kind) {
+    case CombiningKind::AND:
+      return make(mlir::spirv::LogicalAndOp());
+    case CombiningKind::OR:
+      return make(mlir::spirv::LogicalOrOp());
+    case CombiningKind::XOR:
+      return make(mlir::spirv::LogicalNotEqualOp());
+    default:
+      return nullptr;
+    }
+  }
+  if (!mlir::isa<mlir::IntegerType>(elementType))
+    return nullptr;
+  switch (kind) {
+  case CombiningKind::ADD:
+    return make(mlir::spirv::IAddOp());
+  case CombiningKind::MUL:
+    return make(mlir::spirv::IMulOp());
+  case CombiningKind::MINSI:
+    return make(mlir::spirv::CLSMinOp());
+  case CombiningKind::MAXSI:
+    return make(mlir::spirv::CLSMaxOp());
+  case CombiningKind::MINUI:
+    return make(mlir::spirv::CLUMinOp());
+  case CombiningKind::MAXUI:
+    return make(mlir::spirv::CLUMaxOp());
+  case CombiningKind::AND:
+    return make(mlir::spirv::BitwiseAndOp());
+  case CombiningKind::OR:
+    return make(mlir::spirv::BitwiseOrOp());
+  case CombiningKind::XOR:
+    return make(mlir::spirv::BitwiseXorOp());
+  default:
+    return nullptr;
+  }
+}
+
+// This op:
+//   %r = vector.reduction <add>, %v : vector<8xf32> into f32
+// is lowered to a tree of vector ops instead of a chain of scalar ops:
+//   %lo = spirv.VectorShuffle [0, 1, 2, 3] %v, %v
+//   %hi = spirv.VectorShuffle [4, 5, 6, 7] %v, %v
+//   %s4 = spirv.FAdd %lo, %hi : vector<4xf32>
+//   ... halved again down to two elements, which get extracted and combined
+// so the reduction takes log2(n) dependent ops instead of n - 1.
+class VectorReductionTreeConversionPattern final
+    : public mlir::OpConversionPattern<mlir::vector::ReductionOp> {
+public:
+  using OpConversionPattern<mlir::vector::ReductionOp>::OpConversionPattern;
+
+  mlir::LogicalResult
+  matchAndRewrite(mlir::vector::ReductionOp reductionOp, OpAdaptor adaptor,
+                  mlir::ConversionPatternRewriter &rewriter) const override {
+    auto vecTy = reductionOp.getSourceVectorType();
+    int64_t numElements = vecTy.getNumElements();
+    // Two elements gain nothing over the scalar lowering.
+    if (vecTy.getRank() != 1 || numElements < 4 ||
+        !llvm::isPowerOf2_64(numElements))
+      return rewriter.notifyMatchFailure(reductionOp, "unsupported vector");
+
+    auto vector = adaptor.getVector();
+    auto spirvVecTy = mlir::dyn_cast<mlir::VectorType>(vector.getType());
+    if (!spirvVecTy)
+      return rewriter.notifyMatchFailure(reductionOp, "unconverted vector");
+    auto elementType = spirvVecTy.getElementType();
+    auto combine = getCombineFn(reductionOp.getKind(), elementType);
+    if (!combine)
+      return rewriter.notifyMatchFailure(reductionOp, "unsupported kind");
+
+    auto loc = reductionOp.getLoc();
+    for (int64_t n = numElements; n > 2; n /= 2) {
+      llvm::SmallVector<int32_t> lower, upper;
+      for (int32_t i = 0; i < n / 2; ++i) {
+        lower.push_back(i);
+        upper.push_back(i + n / 2);
+      }
+      auto halfTy = mlir::VectorType::get({n / 2}, elementType);
+      mlir::Value lo = rewriter.create<mlir::spirv::VectorShuffleOp>(
+          loc, halfTy, vector, vector, rewriter.getI32ArrayAttr(lower));
+      mlir::Value hi = rewriter.create<mlir::spirv::VectorShuffleOp>(
+          loc, halfTy, vector, vector, rewriter.getI32ArrayAttr(upper));
+      vector = combine(rewriter, loc, lo, hi);
+    }
+    mlir::Value first = rewriter.create<mlir::spirv::CompositeExtractOp>(
+        loc, vector, llvm::ArrayRef<int32_t>{0});
+    mlir::Value second = rewriter.create<mlir::spirv::CompositeExtractOp>(
+        loc, vector, llvm::ArrayRef<int32_t>{1});
+    mlir::Value result = combine(rewriter, loc, first, second);
+    if (auto acc = adaptor.getAcc())
+      result = combine(rewriter, loc, result, acc);
+    rewriter.replaceOp(reductionOp, result);
+    return mlir::success();
+  }
+};
+
+void populateVectorReductionToSPIRVPatterns(
+    mlir::SPIRVTypeConverter &typeConverter,
+    mlir::RewritePatternSet &patterns) {
+  // Takes precedence over the upstream lowering to a chain of scalar ops.
+  patterns.add<VectorReductionTreeConversionPattern>(
+      typeConverter, patterns.getContext(), /*benefit=*/2);
+}
+
+// The patterns below rewrite vector ops without a SPIR-V lowering into ops
+// that have one before the conversion.
+
+// This op:
+//   %r = vector.multi_reduction <add>, %v, %acc [0] : vector<16xf32> to f32
+// is rewritten to:
+//   %r = vector.reduction <add>, %v, %acc : vector<16xf32> into f32
+struct MultiReductionToReductionPattern final
+    : public mlir::OpRewritePattern<mlir::vector::MultiDimReductionOp> {
+  using OpRewritePattern<mlir::vector::MultiDimReductionOp>::OpRewritePattern;
+
+  mlir::LogicalResult
+  matchAndRewrite(mlir::vector::MultiDimReductionOp reductionOp,
+                  mlir::PatternRewriter &rewriter) const override {
+    if (reductionOp.getSourceVectorType().getRank() != 1 ||
+        !reductionOp.isReducedDim(0))
+      return rewriter.notifyMatchFailure(reductionOp, "not a 1-D reduction");
+    rewriter.replaceOpWithNewOp<mlir::vector::ReductionOp>(
+        reductionOp, reductionOp.getKind(), reductionOp.getSource(),
+        reductionOp.getAcc());
+    return mlir::success();
+  }
+};
+
+// This op:
+//   %v = vector.maskedload %base[%i], %mask, %passthru
+// is rewritten to a block read if all lanes are enabled, and a load of every
+// enabled lane otherwise:
+//   %all = vector.reduction <and>, %mask
+//   %v = scf.if %all {
+//     vector.load %base[%i]
+//   } else {
+//     scf.if %mask[0] { memref.load %base[%i] } ... one per lane
+//   }
+struct MaskedLoadLoweringPattern final
+    : public mlir::OpRewritePattern<mlir::vector::MaskedLoadOp> {
+  using OpRewritePattern<mlir::vector::MaskedLoadOp>::OpRewritePattern;
+
+  mlir::LogicalResult
+  matchAndRewrite(mlir::vector::MaskedLoadOp loadOp,
+                  mlir::PatternRewriter &rewriter) const override {
+    auto vecTy = loadOp.getVectorType();
+    if (vecTy.getRank() != 1 || vecTy.isScalable())
+      return rewriter.notifyMatchFailure(loadOp, "unsupported vector");
+
+    auto loc = loadOp.getLoc();
+    auto base = loadOp.getBase();
+    auto mask = loadOp.getMask();
+    auto allEnabled = rewriter.create<mlir::vector::ReductionOp>(
+        loc, mlir::vector::CombiningKind::AND, mask);
+    auto ifOp = rewriter.create<mlir::scf::IfOp>(
+        loc, allEnabled,
+        [&](mlir::OpBuilder &builder, mlir::Location loc) {
+          mlir::Value vector = builder.create<mlir::vector::LoadOp>(
+              loc, vecTy, base, loadOp.getIndices());
+          builder.create<mlir::scf::YieldOp>(loc, vector);
+        },
+        [&](mlir::OpBuilder &builder, mlir::Location loc) {
+          mlir::Value vector = loadOp.getPassThru();
+          llvm::SmallVector<mlir::Value> indices(loadOp.getIndices());
+          auto last = indices.back();
+          for (int64_t i = 0; i < vecTy.getNumElements(); ++i) {
+            auto enabled =
+                builder.create<mlir::vector::ExtractOp>(loc, mask, i);
+            auto offset = builder.create<mlir::arith::ConstantIndexOp>(loc, i);
+            indices.back() =
+                builder.create<mlir::arith::AddIOp>(loc, last, offset);
+            auto laneIf = builder.create<mlir::scf::IfOp>(
+                loc, enabled,
+                [&](mlir::OpBuilder &builder, mlir::Location loc) {
+                  mlir::Value element =
+                      builder.create<mlir::memref::LoadOp>(loc, base, indices);
+                  mlir::Value inserted =
+                      builder.create<mlir::vector::InsertOp>(loc, element,
+                                                             vector, i);
+                  builder.create<mlir::scf::YieldOp>(loc, inserted);
+                },
+                [&](mlir::OpBuilder &builder, mlir::Location loc) {
+                  builder.create<mlir::scf::YieldOp>(loc, vector);
+                });
+            vector = laneIf.getResult(0);
+          }
+          builder.create<mlir::scf::YieldOp>(loc, vector);
+        });
+    rewriter.replaceOp(loadOp, ifOp.getResults());
+    return mlir::success();
+  }
+};
+
+// This op:
+//   vector.maskedstore %base[%i], %mask, %v
+// is rewritten to a block write if all lanes are enabled, and a store of
+// every enabled lane otherwise, as for vector.maskedload.
+struct MaskedStoreLoweringPattern final
+    : public mlir::OpRewritePattern<mlir::vector::MaskedStoreOp> {
+  using OpRewritePattern<mlir::vector::MaskedStoreOp>::OpRewritePattern;
+
+  mlir::LogicalResult
+  matchAndRewrite(mlir::vector::MaskedStoreOp storeOp,
+                  mlir::PatternRewriter &rewriter) const override {
+    auto vecTy = storeOp.getVectorType();
+    if (vecTy.getRank() != 1 || vecTy.isScalable())
+      return rewriter.notifyMatchFailure(storeOp, "unsupported vector");
+
+    auto loc = storeOp.getLoc();
+    auto base = storeOp.getBase();
+    auto mask = storeOp.getMask();
+    auto vector = storeOp.getValueToStore();
+    auto allEnabled = rewriter.create<mlir::vector::ReductionOp>(
+        loc, mlir::vector::CombiningKind::AND, mask);
+    rewriter.create<mlir::scf::IfOp>(
+        loc, allEnabled,
+        [&](mlir::OpBuilder &builder, mlir::Location loc) {
+          builder.create<mlir::vector::StoreOp>(loc, vector, base,
+                                                storeOp.getIndices());
+          builder.create<mlir::scf::YieldOp>(loc);
+        },
+        [&](mlir::OpBuilder &builder, mlir::Location loc) {
+          llvm::SmallVector<mlir::Value> indices(storeOp.getIndices());
+          auto last = indices.back();
+          for (int64_t i = 0; i < vecTy.getNumElements(); ++i) {
+            auto enabled =
+                builder.create<mlir::vector::ExtractOp>(loc, mask, i);
+            auto offset = builder.create<mlir::arith::ConstantIndexOp>(loc, i);
+            indices.back() =
+                builder.create<mlir::arith::AddIOp>(loc, last, offset);
+            builder.create<mlir::scf::IfOp>(
+                loc, enabled,
+                [&](mlir::OpBuilder &builder, mlir::Location loc) {
+                  auto element =
+                      builder.create<mlir::vector::ExtractOp>(loc, vector, i);
+                  builder.create<mlir::memref::StoreOp>(loc, element, base,
+                                                        indices);
+                  builder.create<mlir::scf::YieldOp>(loc);
+                });
+          }
+          builder.create<mlir::scf::YieldOp>(loc);
+        });
+    rewriter.eraseOp(storeOp);
+    return mlir::success();
+  }
+};
+
+// This op:
+//   %r = gpu.subgroup_reduce add %v : (vector<2xf32>) -> vector<2xf32>
+// is rewritten to one subgroup reduction per element, which upstream lowers
+// to OpGroupNonUniform* ops:
+//   %r0 = gpu.subgroup_reduce add %v[0] : (f32) -> f32
+//   %r1 = gpu.subgroup_reduce add %v[1] : (f32) -> f32
+//   %r = vector.from_elements %r0, %r1 : vector<2xf32>
+struct SubgroupReduceUnrollPattern final
+    : public mlir::OpRewritePattern<mlir::gpu::SubgroupReduceOp> {
+  using OpRewritePattern<mlir::gpu::SubgroupReduceOp>::OpRewritePattern;
+
+  mlir::LogicalResult
+  matchAndRewrite(mlir::gpu::SubgroupReduceOp reduceOp,
+                  mlir::PatternRewriter &rewriter) const override {
+    auto vecTy = mlir::dyn_cast<mlir::VectorType>(reduceOp.getType());
+    if (!vecTy || vecTy.getRank() != 1 || vecTy.isScalable())
+      return rewriter.notifyMatchFailure(reduceOp, "not a 1-D vector");
+
+    auto loc = reduceOp.getLoc();
+    llvm::SmallVector<mlir::Value> elements;
+    for (int64_t i = 0; i < vecTy.getNumElements(); ++i) {
+      auto element =
+          rewriter.create<mlir::vector::ExtractOp>(loc, reduceOp.getValue(), i);
+      auto *scalarOp = rewriter.clone(*reduceOp);
+      scalarOp->setOperand(0, element);
+      scalarOp->getResult(0).setType(vecTy.getElementType());
+      elements.push_back(scalarOp->getResult(0));
+    }
+    rewriter.replaceOpWithNewOp<mlir::vector::FromElementsOp>(reduceOp, vecTy,
+                                                              elements);
+    return mlir::success();
+  }
+};
+
+void populateVectorPreSPIRVPatterns(mlir::RewritePatternSet &patterns) {
+  patterns.add<MultiReductionToReductionPattern, MaskedLoadLoweringPattern,
+               MaskedStoreLoweringPattern, SubgroupReduceUnrollPattern>(
+      patterns.getContext());
+}
+
 static bool isGenericVectorTy(mlir::Type type) {
   if (mlir::isa<mlir::spirv::ScalarType>(type))
     return true;
@@ -311,116 +658,470 @@ static bool isGenericVectorTy(mlir::Type type) {
          vecSize == 16;
 }
 
-void GPUXToSPIRVPass::runOnOperation() {
-  mlir::MLIRContext *context = &getContext();
-  mlir::ModuleOp module = getOperation();
+// Returns the symbols defined in the body of \p moduleOp in order.
+static llvm::SmallVector<mlir::StringAttr>
+getSymbolNames(mlir::gpu::GPUModuleOp moduleOp) {
+  llvm::SmallVector<mlir::StringAttr> names;
+  for (auto &op : moduleOp.getBody()->getOperations())
+    if (auto name = op.getAttrOfType<mlir::StringAttr>(
+            mlir::SymbolTable::getSymbolAttrName()))
+      names.push_back(name);
+  return names;
+}
 
-  llvm::SmallVector<mlir::Operation *, 1> gpuModules;
-  mlir::OpBuilder builder(context);
-  module.walk([&](mlir::gpu::GPUModuleOp moduleOp) {
-    // For each kernel module (should be only 1 for now, but that is not a
-    // requirement here), clone the module for conversion because the
-    // gpu.launch function still needs the kernel module.
-    builder.setInsertionPoint(moduleOp.getOperation());
-    gpuModules.push_back(builder.clone(*moduleOp.getOperation()));
+// Prints \p moduleOp with its name and the names of the symbols it defines
+// replaced by their position, so that modules differing only in names print
+// the same.
+static std::string getCanonicalForm(mlir::gpu::GPUModuleOp moduleOp) {
+  auto clone = moduleOp.clone();
+  auto *context = clone.getContext();
+  mlir::SymbolTable::setSymbolName(clone, "__imex_kernels");
+  unsigned index = 0;
+  for (auto &op : clone.getBody()->getOperations()) {
+    if (!mlir::isa<mlir::SymbolOpInterface>(op))
+      continue;
+    auto name = mlir::StringAttr::get(
+        context, "__imex_symbol_" + llvm::Twine(index++));
+    (void)mlir::SymbolTable::replaceAllSymbolUses(&op, name, clone);
+    mlir::SymbolTable::setSymbolName(&op, name);
+  }
+  std::string str;
+  llvm::raw_string_ostream os(str);
+  clone->print(os);
+  clone->erase();
+  return str;
+}
+
+namespace {
+// The kernel module and its symbols references to an erased kernel module get
+// redirected to. Symbols not in the map keep their name.
+struct ModuleReplacement {
+  mlir::StringAttr module;
+  llvm::DenseMap<mlir::StringAttr, mlir::StringAttr> symbols;
+};
+} // namespace
+
+// Replaces the symbol references in \p module for which \p getReplacement
+// returns a reference.
+static void replaceSymbolRefs(
+    mlir::ModuleOp module,
+    llvm::function_ref<mlir::SymbolRefAttr(mlir::SymbolRefAttr)>
+        getReplacement) {
+  module.walk([&](mlir::Operation *op) {
+    for (auto attr : op->getAttrDictionary()) {
+      auto ref = mlir::dyn_cast<mlir::SymbolRefAttr>(attr.getValue());
+      if (!ref)
+        continue;
+      if (auto replacement = getReplacement(ref))
+        op->setAttr(attr.getName(), replacement);
+    }
   });
+}
+
+// Redirects the symbol references in \p module rooted at the kernel modules
+// in \p replacements.
+static void redirectSymbolRefs(
+    mlir::ModuleOp module,
+    const llvm::DenseMap<mlir::StringAttr, ModuleReplacement> &replacements) {
+  replaceSymbolRefs(module, [&](mlir::SymbolRefAttr ref) {
+    auto it = replacements.find(ref.getRootReference());
+    if (it == replacements.end())
+      return mlir::SymbolRefAttr();
+    llvm::SmallVector<mlir::FlatSymbolRefAttr> nested;
+    for (auto name : ref.getNestedReferences()) {
+      auto to = it->second.symbols.lookup(name.getAttr());
+      nested.push_back(to ? mlir::FlatSymbolRefAttr::get(to) : name);
+    }
+    return mlir::SymbolRefAttr::get(it->second.module, nested);
+  });
+}
 
-  for (auto gpuModule : gpuModules) {
+// The options the runtimes compile a kernel with: its number of GRFs per
+// thread (0 for the default) and whether it needs the vector backend.
+using CompileOptions = std::pair<int64_t, bool>;
 
-    // Map MemRef memory space to SPIR-V storage class first if requested.
-    if (mapMemorySpace) {
-      std::unique_ptr<mlir::ConversionTarget> target =
-          mlir::spirv::getMemorySpaceToStorageClassTarget(*context);
-      mlir::spirv::MemorySpaceToStorageClassMap memorySpaceMap =
-          mlir::spirv::mapMemorySpaceToOpenCLStorageClass;
-      mlir::spirv::MemorySpaceToStorageClassConverter converter(memorySpaceMap);
+static CompileOptions getCompileOptions(mlir::gpu::GPUFuncOp func) {
+  auto grfSize =
+      func->getAttrOfType<mlir::IntegerAttr>(imex::gpuGRFSizeAttrName);
+  return {grfSize ? grfSize.getInt() : 0,
+          func->hasAttr(imex::gpuVectorBackendAttrName)};
+}
 
-      mlir::RewritePatternSet patterns(context);
-      mlir::spirv::convertMemRefTypesAndAttrs(gpuModule, converter);
+// Returns the options the kernels of \p moduleOp get compiled with, the
+// largest register file and the vector backend if one of them needs it.
+static CompileOptions getCompileOptions(mlir::gpu::GPUModuleOp moduleOp) {
+  CompileOptions options;
+  for (auto func : moduleOp.getOps<mlir::gpu::GPUFuncOp>()) {
+    auto [grfSize, vectorBackend] = getCompileOptions(func);
+    options.first = std::max(options.first, grfSize);
+    options.second |= vectorBackend;
+  }
+  return options;
+}
 
-      if (failed(applyFullConversion(gpuModule, *target, std::move(patterns))))
-        return signalPassFailure();
+// Marks the kernels calling VC intrinsics, which only the vector backend of
+// IGC compiles, with imex.vector_backend. The other kernels get the subgroup
+// size from their imex.subgroup_size attribute, their workgroup size if they
+// compute on cooperative matrices, or \p subgroupSize if not 0, set in their
+// entry point ABI, which becomes their SubgroupSize execution mode.
+static void annotateKernels(mlir::ModuleOp module, int subgroupSize) {
+  auto *context = module.getContext();
+  module.walk([&](mlir::gpu::GPUFuncOp func) {
+    if (!mlir::gpu::GPUDialect::isKernel(func))
+      return;
+    bool usesVC = false;
+    func.walk([&](mlir::CallOpInterface call) {
+      auto callee = mlir::dyn_cast_if_present<mlir::SymbolRefAttr>(
+          call.getCallableForCallee());
+      if (callee &&
+          callee.getLeafReference().getValue().starts_with("llvm.genx."))
+        usesVC = true;
+    });
+    if (usesVC) {
+      func->setAttr(imex::gpuVectorBackendAttrName,
+                    mlir::UnitAttr::get(context));
+      return;
     }
 
-    auto targetAttr = mlir::spirv::lookupTargetEnvOrDefault(gpuModule);
-    std::unique_ptr<mlir::ConversionTarget> target =
-        mlir::SPIRVConversionTarget::get(targetAttr);
+    auto abi = func->getAttrOfType<mlir::spirv::EntryPointABIAttr>(
+        mlir::spirv::getEntryPointABIAttrName());
+    int size = subgroupSize;
+    // Kernels on cooperative matrices run workgroups of one subgroup.
+    bool usesCoopMatrix = false;
+    func.walk([&](mlir::gpu::SubgroupMmaComputeOp) { usesCoopMatrix = true; });
+    auto blockSize =
+        func->getAttrOfType<mlir::DenseI32ArrayAttr>("known_block_size");
+    if (usesCoopMatrix && blockSize)
+      size = blockSize[0];
+    if (auto attr = func->getAttrOfType<mlir::IntegerAttr>(
+            imex::gpuSubgroupSizeAttrName))
+      size = attr.getInt();
+    if (!abi || !size || abi.getSubgroupSize())
+      return;
+    auto workgroupSize = abi.getWorkgroupSize();
+    func->setAttr(mlir::spirv::getEntryPointABIAttrName(),
+                  mlir::spirv::getEntryPointABIAttr(
+                      context,
+                      workgroupSize ? workgroupSize.asArrayRef()
+                                    : llvm::ArrayRef<int32_t>(),
+                      size));
+  });
+}
+
+// Splits the kernel modules whose kernels get compiled with different
+// options into one module per set of options, so that every module can be
+// built with the options of all its kernels.
+static void splitKernelModules(mlir::ModuleOp module) {
+  mlir::SymbolTable symbolTable(module);
+  llvm::DenseMap<mlir::Attribute, mlir::SymbolRefAttr> replacements;
+  for (auto moduleOp :
+       llvm::make_early_inc_range(module.getOps<mlir::gpu::GPUModuleOp>())) {
+    std::map<CompileOptions, llvm::SmallVector<mlir::StringAttr>> groups;
+    for (auto func : moduleOp.getOps<mlir::gpu::GPUFuncOp>())
+      if (mlir::gpu::GPUDialect::isKernel(func))
+        groups[getCompileOptions(func)].push_back(func.getNameAttr());
+    if (groups.size() < 2)
+      continue;
+
+    // Each module keeps the kernels of one set of options and all other
+    // symbols.
+    auto keepKernels = [](mlir::gpu::GPUModuleOp kernelModule,
+                          const CompileOptions &options) {
+      for (auto func : llvm::make_early_inc_range(
+               kernelModule.getOps<mlir::gpu::GPUFuncOp>()))
+        if (mlir::gpu::GPUDialect::isKernel(func) &&
+            getCompileOptions(func) != options)
+          func->erase();
+    };
+    mlir::OpBuilder builder(moduleOp);
+    builder.setInsertionPointAfter(moduleOp);
+    for (auto &[options, kernels] : llvm::drop_begin(groups)) {
+      auto clone =
+          mlir::cast<mlir::gpu::GPUModuleOp>(builder.clone(*moduleOp));
+      auto name = symbolTable.insert(clone);
+      keepKernels(clone, options);
+      for (auto kernel : kernels) {
+        auto kernelRef = mlir::FlatSymbolRefAttr::get(kernel);
+        replacements[mlir::SymbolRefAttr::get(moduleOp.getSymNameAttr(),
+                                              kernelRef)] =
+            mlir::SymbolRefAttr::get(name, kernelRef);
+      }
+    }
+    keepKernels(moduleOp, groups.begin()->first);
+  }
+  if (replacements.empty())
+    return;
+
+  replaceSymbolRefs(module, [&](mlir::SymbolRefAttr ref) {
+    return replacements.lookup(ref);
+  });
+}
+
+// Erases the kernel modules that are structurally identical to an earlier
+// one and redirects the references to them, e.g. of the launches, to the
+// earlier module.
+static void deduplicateKernelModules(mlir::ModuleOp module) {
+  llvm::SmallVector<mlir::gpu::GPUModuleOp> gpuModules(
+      module.getOps<mlir::gpu::GPUModuleOp>());
+  std::vector<std::string> forms(gpuModules.size());
+  mlir::parallelFor(module.getContext(), 0, gpuModules.size(), [&](size_t i) {
+    forms[i] = getCanonicalForm(gpuModules[i]);
+  });
+
+  llvm::DenseMap<mlir::StringAttr, ModuleReplacement> replacements;
+  llvm::StringMap<mlir::gpu::GPUModuleOp> unique;
+  llvm::SmallVector<mlir::gpu::GPUModuleOp> duplicates;
+  for (auto [moduleOp, form] : llvm::zip(gpuModules, forms)) {
+    auto [it, inserted] = unique.try_emplace(form, moduleOp);
+    if (inserted)
+      continue;
+    auto &replacement = replacements[moduleOp.getSymNameAttr()];
+    replacement.module = it->second.getSymNameAttr();
+    for (auto [from, to] :
+         llvm::zip(getSymbolNames(moduleOp), getSymbolNames(it->second)))
+      replacement.symbols[from] = to;
+    duplicates.push_back(moduleOp);
+  }
+  if (duplicates.empty())
+    return;
+
+  redirectSymbolRefs(module, replacements);
+  for (auto moduleOp : duplicates)
+    moduleOp->erase();
+}
+
+// Moves the symbols of every kernel module into the first kernel module with
+// the same attributes and compile options, renaming symbols whose names are
+// taken, so that the kernels get compiled and loaded together.
+static void mergeKernelModules(mlir::ModuleOp module) {
+  // Modules built for different targets or with different options stay
+  // apart: the key is the attributes of the module with the options added.
+  auto getKey = [](mlir::gpu::GPUModuleOp moduleOp) -> mlir::Attribute {
+    auto *context = moduleOp.getContext();
+    mlir::NamedAttrList attrs(moduleOp->getAttrDictionary());
+    attrs.erase(mlir::SymbolTable::getSymbolAttrName());
+    auto [grfSize, vectorBackend] = getCompileOptions(moduleOp);
+    attrs.set(imex::gpuGRFSizeAttrName,
+              mlir::IntegerAttr::get(mlir::IntegerType::get(context, 64),
+                                     grfSize));
+    attrs.set(imex::gpuVectorBackendAttrName,
+              mlir::BoolAttr::get(context, vectorBackend));
+    return attrs.getDictionary(context);
+  };
+
+  llvm::DenseMap<mlir::Attribute, mlir::gpu::GPUModuleOp> targets;
+  llvm::DenseMap<mlir::StringAttr, ModuleReplacement> replacements;
+  llvm::SmallVector<mlir::gpu::GPUModuleOp> merged;
+  for (auto moduleOp :
+       llvm::make_early_inc_range(module.getOps<mlir::gpu::GPUModuleOp>())) {
+    auto [it, inserted] = targets.try_emplace(getKey(moduleOp), moduleOp);
+    if (inserted)
+      continue;
+    auto target = it->second;
+    mlir::SymbolTable targetTable(target);
+    auto &replacement = replacements[moduleOp.getSymNameAttr()];
+    replacement.module = target.getSymNameAttr();
+
+    auto *body = moduleOp.getBody();
+    for (auto &op : llvm::make_early_inc_range(body->getOperations())) {
+      if (op.hasTrait<mlir::OpTrait::IsTerminator>())
+        continue;
+      auto name = op.getAttrOfType<mlir::StringAttr>(
+          mlir::SymbolTable::getSymbolAttrName());
+      if (name && targetTable.lookup(name)) {
+        mlir::StringAttr newName;
+        for (unsigned i = 0;; ++i) {
+          newName = mlir::StringAttr::get(module.getContext(),
+                                          name.getValue() + "_" +
+                                              llvm::Twine(i));
+          if (!targetTable.lookup(newName) &&
+              !mlir::SymbolTable::lookupSymbolIn(moduleOp, newName))
+            break;
+        }
+        (void)mlir::SymbolTable::replaceAllSymbolUses(&op, newName, moduleOp);
+        mlir::SymbolTable::setSymbolName(&op, newName);
+        replacement.symbols[name] = newName;
+      }
+      op.remove();
+      if (name) {
+        targetTable.insert(&op);
+      } else {
+        auto *targetBody = target.getBody();
+        if (!targetBody->empty() &&
+            targetBody->back().hasTrait<mlir::OpTrait::IsTerminator>())
+          targetBody->getOperations().insert(
+              mlir::Block::iterator(&targetBody->back()), &op);
+        else
+          targetBody->push_back(&op);
+      }
+    }
+    merged.push_back(moduleOp);
+  }
+  if (merged.empty())
+    return;
+
+  redirectSymbolRefs(module, replacements);
+  for (auto moduleOp : merged)
+    moduleOp->erase();
+}
 
+mlir::LogicalResult
+GPUXToSPIRVPass::convertModule(mlir::gpu::GPUModuleOp gpuModule) {
+  mlir::MLIRContext *context = &getContext();
+
+  // Rewrite vector ops without a SPIR-V lowering first.
+  {
     mlir::RewritePatternSet patterns(context);
-    mlir::SPIRVConversionOptions options;
-    options.use64bitIndex = true;
-    options.emulateLT32BitScalarTypes = false;
-
-    mlir::SPIRVTypeConverter typeConverter(targetAttr, options);
-
-    target->addDynamicallyLegalOp<mlir::spirv::INTELConvertBF16ToFOp>(
-        [](mlir::spirv::INTELConvertBF16ToFOp) { return true; });
-    target->addDynamicallyLegalOp<mlir::spirv::INTELConvertFToBF16Op>(
-        [](mlir::spirv::INTELConvertFToBF16Op) { return true; });
-
-    // SPIR-V elementwise arith/math ops require special handling if they
-    // operate on large vectors. We dynamically legalize these ops based on
-    // the vector size they consume.
-    // FIXME: this is not an exhaustive list of arith/math ops that need
-    // special handling.
-    target->addDynamicallyLegalOp<mlir::spirv::CLExpOp>(
-        [&](mlir::spirv::CLExpOp op) {
-          return isGenericVectorTy(op.getType());
-        });
-    target->addDynamicallyLegalOp<mlir::spirv::CLFMaxOp>(
-        [&](mlir::spirv::CLFMaxOp op) {
-          return isGenericVectorTy(op.getType());
-        });
+    imex::populateVectorPreSPIRVPatterns(patterns);
+    if (mlir::failed(
+            mlir::applyPatternsGreedily(gpuModule, std::move(patterns))))
+      return mlir::failure();
+  }
 
-    // Upstream SPIRVTypeConverter does not add conversion for
-    // UnrankedMemRefType.
-    // Conversion logic is the same as ranked dynamic memref type for OpenCL
-    // Kernel. unranked memref type is converted to a spirv pointer type
-    // with converted spirv scalar element type and spirv storage class.
-    // Only scalar element type is currently supported.
-    // Also vulkan should be handled differently but out of scope since this
-    // conversion pass is for lowering to OpenCL spirv kernel only.
-    typeConverter.addConversion(
-        [&](mlir::UnrankedMemRefType type) -> std::optional<mlir::Type> {
-          auto attr = mlir::dyn_cast_or_null<mlir::spirv::StorageClassAttr>(
-              type.getMemorySpace());
-          if (!attr)
-            return nullptr;
-          mlir::spirv::StorageClass storageClass = attr.getValue();
-
-          mlir::Type elementType = type.getElementType();
-          auto scalarType =
-              mlir::dyn_cast<mlir::spirv::ScalarType>(elementType);
-          if (!scalarType)
-            return nullptr;
-          mlir::Type arrayElemType = typeConverter.convertType(scalarType);
-          return mlir::spirv::PointerType::get(arrayElemType, storageClass);
-        });
+  // Map MemRef memory space to SPIR-V storage class first if requested.
+  if (mapMemorySpace) {
+    std::unique_ptr<mlir::ConversionTarget> target =
+        mlir::spirv::getMemorySpaceToStorageClassTarget(*context);
+    mlir::spirv::MemorySpaceToStorageClassMap memorySpaceMap =
+        mlir::spirv::mapMemorySpaceToOpenCLStorageClass;
+    mlir::spirv::MemorySpaceToStorageClassConverter converter(memorySpaceMap);
 
-    imex::populateBF16ArithToSPIRVPatterns(typeConverter, patterns);
-    //------- Upstream Conversion------------
-    mlir::populateGPUToSPIRVPatterns(typeConverter, patterns);
-    mlir::arith::populateArithToSPIRVPatterns(typeConverter, patterns);
-    mlir::populateBuiltinFuncToSPIRVPatterns(typeConverter, patterns);
-    mlir::populateVectorToSPIRVPatterns(typeConverter, patterns);
-    mlir::populateMathToSPIRVPatterns(typeConverter, patterns);
-    mlir::index::populateIndexToSPIRVPatterns(typeConverter, patterns);
-    mlir::populateMemRefToSPIRVPatterns(typeConverter, patterns);
-    mlir::populateFuncToSPIRVPatterns(typeConverter, patterns);
-    // ---------------------------------------
-
-    // IMEX GPUToSPIRV extension
-    mlir::ScfToSPIRVContext scfToSpirvCtx;
-    mlir::populateSCFToSPIRVPatterns(typeConverter, scfToSpirvCtx, patterns);
-    mlir::cf::populateControlFlowToSPIRVPatterns(typeConverter, patterns);
-    mlir::populateMathToSPIRVPatterns(typeConverter, patterns);
-    // for ub.poison op with vector operand
-    imex::populateUBToSPIRVConversionPatterns(typeConverter, patterns);
-    imex::populateVectorToSPIRVPatterns(typeConverter, patterns);
+    mlir::RewritePatternSet patterns(context);
+    mlir::spirv::convertMemRefTypesAndAttrs(gpuModule, converter);
 
     if (failed(applyFullConversion(gpuModule, *target, std::move(patterns))))
-      return signalPassFailure();
+      return mlir::failure();
   }
+
+  auto targetAttr = mlir::spirv::lookupTargetEnvOrDefault(gpuModule);
+  std::unique_ptr<mlir::ConversionTarget> target =
+      mlir::SPIRVConversionTarget::get(targetAttr);
+
+  mlir::RewritePatternSet patterns(context);
+  mlir::SPIRVConversionOptions options;
+  options.use64bitIndex = true;
+  options.emulateLT32BitScalarTypes = false;
+
+  mlir::SPIRVTypeConverter typeConverter(targetAttr, options);
+
+  target->addDynamicallyLegalOp<mlir::spirv::INTELConvertBF16ToFOp>(
+      [](mlir::spirv::INTELConvertBF16ToFOp) { return true; });
+  target->addDynamicallyLegalOp<mlir::spirv::INTELConvertFToBF16Op>(
+      [](mlir::spirv::INTELConvertFToBF16Op) { return true; });
+
+  // SPIR-V elementwise arith/math ops require special handling if they
+  // operate on large vectors. We dynamically legalize these ops based on
+  // the vector size they consume.
+  // FIXME: this is not an exhaustive list of arith/math ops that need
+  // special handling.
+  target->addDynamicallyLegalOp<mlir::spirv::CLExpOp>(
+      [&](mlir::spirv::CLExpOp op) {
+        return isGenericVectorTy(op.getType());
+      });
+  target->addDynamicallyLegalOp<mlir::spirv::CLFMaxOp>(
+      [&](mlir::spirv::CLFMaxOp op) {
+        return isGenericVectorTy(op.getType());
+      });
+
+  // Upstream SPIRVTypeConverter does not add conversion for
+  // UnrankedMemRefType.
+  // Conversion logic is the same as ranked dynamic memref type for OpenCL
+  // Kernel. unranked memref type is converted to a spirv pointer type
+  // with converted spirv scalar element type and spirv storage class.
+  // Only scalar element type is currently supported.
+  // Also vulkan should be handled differently but out of scope since this
+  // conversion pass is for lowering to OpenCL spirv kernel only.
+  typeConverter.addConversion(
+      [&](mlir::UnrankedMemRefType type) -> std::optional<mlir::Type> {
+        auto attr = mlir::dyn_cast_or_null<mlir::spirv::StorageClassAttr>(
+            type.getMemorySpace());
+        if (!attr)
+          return nullptr;
+        mlir::spirv::StorageClass storageClass = attr.getValue();
+
+        mlir::Type elementType = type.getElementType();
+        auto scalarType =
+            mlir::dyn_cast<mlir::spirv::ScalarType>(elementType);
+        if (!scalarType)
+          return nullptr;
+        mlir::Type arrayElemType = typeConverter.convertType(scalarType);
+        return mlir::spirv::PointerType::get(arrayElemType, storageClass);
+      });
+
+  // gpu.subgroup_mma_* ops, e.g. from imex-matmul-to-coop-matrix, become
+  // SPV_KHR_cooperative_matrix ops.
+  typeConverter.addConversion([](mlir::gpu::MMAMatrixType type) -> mlir::Type {
+    return mlir::convertMMAToSPIRVCoopMatrixType(type);
+  });
+
+  imex::populateBF16ArithToSPIRVPatterns(typeConverter, patterns);
+  //------- Upstream Conversion------------
+  mlir::populateGPUToSPIRVPatterns(typeConverter, patterns);
+  mlir::populateGpuWMMAToSPIRVCoopMatrixKHRConversionPatterns(typeConverter,
+                                                             patterns);
+  mlir::arith::populateArithToSPIRVPatterns(typeConverter, patterns);
+  mlir::populateBuiltinFuncToSPIRVPatterns(typeConverter, patterns);
+  mlir::populateVectorToSPIRVPatterns(typeConverter, patterns);
+  mlir::populateMathToSPIRVPatterns(typeConverter, patterns);
+  mlir::index::populateIndexToSPIRVPatterns(typeConverter, patterns);
+  mlir::populateMemRefToSPIRVPatterns(typeConverter, patterns);
+  mlir::populateFuncToSPIRVPatterns(typeConverter, patterns);
+  // ---------------------------------------
+
+  // IMEX GPUToSPIRV extension
+  mlir::ScfToSPIRVContext scfToSpirvCtx;
+  mlir::populateSCFToSPIRVPatterns(typeConverter, scfToSpirvCtx, patterns);
+  mlir::cf::populateControlFlowToSPIRVPatterns(typeConverter, patterns);
+  mlir::populateMathToSPIRVPatterns(typeConverter, patterns);
+  // for ub.poison op with vector operand
+  imex::populateUBToSPIRVConversionPatterns(typeConverter, patterns);
+  imex::populateVectorToSPIRVPatterns(typeConverter, patterns);
+  imex::populateVectorReductionToSPIRVPatterns(typeConverter, patterns);
+
+  return applyFullConversion(gpuModule, *target, std::move(patterns));
+}
+
+void GPUXToSPIRVPass::runOnOperation() {
+  mlir::MLIRContext *context = &getContext();
+  mlir::ModuleOp module = getOperation();
+
+  annotateKernels(module, subgroupSize);
+  splitKernelModules(module);
+  if (deduplicateKernels)
+    deduplicateKernelModules(module);
+  if (mergeModules)
+    mergeKernelModules(module);
+
+  // For each kernel module, clone the module for conversion because the
+  // gpu.launch function still needs the kernel module. The clones are
+  // converted in parallel, each in a module of its own so that the threads do
+  // not modify the same block, and the resulting SPIR-V modules are moved
+  // in front of the kernel modules afterwards.
+  llvm::SmallVector<mlir::gpu::GPUModuleOp> gpuModules;
+  module.walk(
+      [&](mlir::gpu::GPUModuleOp moduleOp) { gpuModules.push_back(moduleOp); });
+  llvm::SmallVector<mlir::OwningOpRef<mlir::ModuleOp>> containers;
+  llvm::SmallVector<mlir::gpu::GPUModuleOp> clones;
+  for (auto moduleOp : gpuModules) {
+    auto &container = containers.emplace_back(
+        mlir::ModuleOp::create(moduleOp.getLoc()));
+    (*container)->setAttr(mlir::spirv::getTargetEnvAttrName(),
+                          mlir::spirv::lookupTargetEnvOrDefault(moduleOp));
+    auto builder = mlir::OpBuilder::atBlockEnd(container->getBody());
+    clones.push_back(
+        mlir::cast<mlir::gpu::GPUModuleOp>(builder.clone(*moduleOp)));
+  }
+
+  if (mlir::failed(mlir::failableParallelForEach(
+          context, clones, [&](mlir::gpu::GPUModuleOp gpuModule) {
+            return convertModule(gpuModule);
+          })))
+    return signalPassFailure();
+
+  for (auto [moduleOp, container] : llvm::zip(gpuModules, containers))
+    for (auto &op :
+         llvm::make_early_inc_range(container->getBody()->getOperations()))
+      op.moveBefore(moduleOp);
 }
 
 std::unique_ptr<::mlir::OperationPass<::mlir::ModuleOp>>
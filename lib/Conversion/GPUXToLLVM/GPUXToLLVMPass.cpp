@@ -38,11 +38,14 @@
 #include "mlir/Conversion/VectorToLLVM/ConvertVectorToLLVM.h"
 #include "mlir/Dialect/GPU/IR/GPUDialect.h"
 #include "mlir/Dialect/GPU/Transforms/Passes.h"
+#include "mlir/Dialect/MemRef/IR/MemRef.h"
 #include "mlir/Dialect/LLVMIR/LLVMDialect.h"
 #include "mlir/IR/Attributes.h"
 #include "mlir/IR/Builders.h"
 #include "mlir/IR/BuiltinOps.h"
 #include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/Matchers.h"
+#include "mlir/Interfaces/DataLayoutInterfaces.h"
 
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/Support/Casting.h"
@@ -58,6 +61,7 @@ namespace imex {
 namespace {
 
 static constexpr const char *kGpuBinaryStorageSuffix = "_spirv_binary";
+static constexpr const char *kModulePreloadCtorName = "gpux_preload_modules";
 
 struct FunctionCallBuilder {
   FunctionCallBuilder(mlir::StringRef functionName, mlir::Type returnType,
@@ -125,6 +129,39 @@ protected:
           llvmIndexType    /* size*/
       }};
 
+  FunctionCallBuilder moduleLoadWithGRFSizeCallBuilder = {
+      "gpuModuleLoadWithGRFSize",
+      llvmPointerType /* void *module */,
+      {
+          llvmPointerType, /* void *stream */
+          llvmPointerType, /* void *spirv*/
+          llvmIndexType,   /* size*/
+          llvmInt32Type    /* GRFs per thread */
+      }};
+
+  FunctionCallBuilder moduleLoadWithOptionsCallBuilder = {
+      "gpuModuleLoadWithOptions",
+      llvmPointerType /* void *module */,
+      {
+          llvmPointerType, /* void *stream */
+          llvmPointerType, /* void *spirv*/
+          llvmIndexType,   /* size*/
+          llvmInt32Type,   /* GRFs per thread */
+          llvmInt32Type,   /* vector backend */
+          llvmPointerType  /* void *native binaries */
+      }};
+
+  FunctionCallBuilder modulePreloadCallBuilder = {
+      "gpuModulePreload",
+      llvmVoidType,
+      {
+          llvmPointerType, /* void *spirv*/
+          llvmIndexType,   /* size*/
+          llvmInt32Type,   /* GRFs per thread */
+          llvmInt32Type,   /* vector backend */
+          llvmPointerType  /* void *native binaries */
+      }};
+
   FunctionCallBuilder moduleUnloadCallBuilder = {
       "gpuModuleUnload",
       llvmVoidType,
@@ -141,6 +178,25 @@ protected:
           llvmPointerType  /* char *name   */
       }};
 
+  FunctionCallBuilder kernelSetCostCallBuilder = {
+      "gpuKernelSetCost",
+      llvmVoidType,
+      {
+          llvmPointerType, /* void* stream */
+          llvmPointerType, /* void *function */
+          llvmInt64Type,   /* bytes per work item */
+          llvmInt64Type    /* flops per work item */
+      }};
+
+  FunctionCallBuilder kernelSetGroupSizeAgnosticCallBuilder = {
+      "gpuKernelSetGroupSizeAgnostic",
+      llvmVoidType,
+      {
+          llvmPointerType, /* void* stream */
+          llvmPointerType, /* void *function */
+          llvmInt32Type    /* GRFs per thread */
+      }};
+
   FunctionCallBuilder launchKernelCallBuilder = {
       "gpuLaunchKernel",
       llvmEventsPointerType /* void *event */,
@@ -158,6 +214,34 @@ protected:
           llvmEventsPointerType /* Events */
       }};
 
+  FunctionCallBuilder launchKernelPackedCallBuilder = {
+      "gpuLaunchKernelPacked",
+      llvmPointerType, /* void* */
+      {
+          llvmPointerType,      /* void* stream */
+          llvmPointerType,      /* void* f */
+          llvmIndexType,        /* intptr_t gridXDim */
+          llvmIndexType,        /* intptr_t gridyDim */
+          llvmIndexType,        /* intptr_t gridZDim */
+          llvmIndexType,        /* intptr_t blockXDim */
+          llvmIndexType,        /* intptr_t blockYDim */
+          llvmIndexType,        /* intptr_t blockZDim */
+          llvmInt32Type,        /* unsigned int sharedMemBytes */
+          llvmPointerType,      /* void *args */
+          llvmPointerType,      /* const int64_t *layout */
+          llvmEventsPointerType /* Events */
+      }};
+
+  FunctionCallBuilder launchKernelsCallBuilder = {
+      "gpuLaunchKernels",
+      llvmPointerType, /* void* */
+      {
+          llvmPointerType,      /* void* stream */
+          llvmPointerType,      /* LaunchDesc *launches */
+          llvmIndexType,        /* size_t count */
+          llvmEventsPointerType /* Events */
+      }};
+
   FunctionCallBuilder streamCreateCallBuilder = {
       "gpuCreateStream",
       llvmPointerType, /* void *stream */
@@ -173,6 +257,14 @@ protected:
           llvmPointerType /* void *stream */
       }};
 
+  FunctionCallBuilder streamGetSubstreamCallBuilder = {
+      "gpuStreamGetSubstream",
+      llvmPointerType, /* void *substream */
+      {
+          llvmPointerType, /* void *stream */
+          llvmInt64Type    /* int64_t index */
+      }};
+
   FunctionCallBuilder waitCallBuilder = {"gpuWait",
                                          llvmVoidType,
                                          {
@@ -189,6 +281,27 @@ protected:
           llvmInt32Type    /* unsigned int shared */
       }};
 
+  FunctionCallBuilder allocTaggedCallBuilder = {
+      "gpuMemAllocTagged",
+      llvmPointerType /* void * */,
+      {
+          llvmPointerType, /* void *stream */
+          llvmIndexType,   /* intptr_t size */
+          llvmIndexType,   /* intptr_t alignment */
+          llvmInt32Type,   /* unsigned int shared */
+          llvmPointerType  /* const char *site */
+      }};
+
+  FunctionCallBuilder allocConstantCallBuilder = {
+      "gpuMemAllocConstant",
+      llvmPointerType /* void * */,
+      {
+          llvmPointerType, /* void *stream */
+          llvmPointerType, /* const void *hostPtr */
+          llvmIndexType,   /* intptr_t size */
+          llvmIndexType    /* intptr_t alignment */
+      }};
+
   FunctionCallBuilder deallocCallBuilder = {
       "gpuMemFree",
       llvmVoidType,
@@ -197,6 +310,35 @@ protected:
           llvmPointerType  /* void *ptr */
       }};
 
+  FunctionCallBuilder deallocAsyncCallBuilder = {
+      "gpuMemFreeAsync",
+      llvmVoidType,
+      {
+          llvmPointerType,      /* void *stream */
+          llvmPointerType,      /* void *ptr */
+          llvmEventsPointerType /* Events */
+      }};
+
+  FunctionCallBuilder prefetchCallBuilder = {
+      "gpuMemPrefetch",
+      llvmPointerType, /* void *event */
+      {
+          llvmPointerType,      /* void *stream */
+          llvmPointerType,      /* void *ptr */
+          llvmIndexType,        /* intptr_t size */
+          llvmEventsPointerType /* Events */
+      }};
+
+  FunctionCallBuilder memAdviseCallBuilder = {
+      "gpuMemAdvise",
+      llvmVoidType,
+      {
+          llvmPointerType, /* void *stream */
+          llvmPointerType, /* void *ptr */
+          llvmIndexType,   /* intptr_t size */
+          llvmInt32Type    /* int32_t advice */
+      }};
+
   FunctionCallBuilder memcpyCallBuilder = {
       "gpuMemCopy",
       llvmVoidType,
@@ -206,10 +348,175 @@ protected:
           llvmPointerType, /* void *ptr src */
           llvmIndexType    /* intptr_t size */
       }};
+
+  FunctionCallBuilder memcpyAsyncCallBuilder = {
+      "gpuMemCopyAsync",
+      llvmEventsPointerType /* void *event */,
+      {
+          llvmPointerType,      /* void *stream */
+          llvmPointerType,      /* void *ptr dst */
+          llvmPointerType,      /* void *ptr src */
+          llvmIndexType,        /* intptr_t size */
+          llvmEventsPointerType /* Events */
+      }};
+
+  FunctionCallBuilder memsetCallBuilder = {
+      "gpuMemset",
+      llvmEventsPointerType /* void *event */,
+      {
+          llvmPointerType,      /* void *stream */
+          llvmPointerType,      /* void *ptr dst */
+          llvmPointerType,      /* void *pattern */
+          llvmIndexType,        /* intptr_t pattern size */
+          llvmIndexType,        /* intptr_t size */
+          llvmEventsPointerType /* Events */
+      }};
+
+  FunctionCallBuilder graphBeginCallBuilder = {
+      "gpuGraphBegin",
+      llvmVoidType,
+      {
+          llvmPointerType, /* void *stream */
+          llvmPointerType  /* void *graph id */
+      }};
+
+  FunctionCallBuilder graphEndCallBuilder = {
+      "gpuGraphEnd",
+      llvmVoidType,
+      {
+          llvmPointerType /* void *stream */
+      }};
+
+  FunctionCallBuilder barrierCallBuilder = {
+      "gpuBarrier",
+      llvmPointerType, /* void *event */
+      {
+          llvmPointerType,      /* void *stream */
+          llvmEventsPointerType /* Events */
+      }};
+
+  // Returns an event signaled once all \p events are, to stand for the async
+  // token of an op whose own work is done on the host. A single event is
+  // forwarded, otherwise a barrier joining the events is enqueued.
+  mlir::Value joinEvents(mlir::Operation *op, mlir::OpBuilder &builder,
+                         mlir::Value stream, mlir::ValueRange events) const {
+    if (events.size() == 1)
+      return events.front();
+
+    imex::AllocaInsertionPoint allocaHelper(op);
+    auto loc = op->getLoc();
+    auto eventsArrayPtr = createEventsArray(loc, builder, allocaHelper, events);
+    return barrierCallBuilder.create(loc, builder, {stream, eventsArrayPtr})
+        ->getResult(0);
+  }
+
+  // Creates an array of struct containing all events on the stack and
+  // returns a pointer to it. The array is terminated by a null event.
+  // Generated code is essentially as follows:
+  //
+  // 1. %eventsArrayPtr = alloca((NumEvents + 1) * sizeof(struct{event}))
+  // 2. for (i : [0, NumEvents))
+  //       %struct = llvm.insertvalue %event, undef
+  //       %eventsArray = llvm.insertvalue %struct, %eventsArray[i]
+  // 3. //Add null event to indicate eventsArray termination
+  //    %struct = llvm.insertvalue %null_event, undef
+  //    %eventsArray = llvm.insertvalue %struct, %eventsArray[NumEvents]
+  // 4. llvm.store %eventsArray, %eventsArrayPtr
+  mlir::Value createEventsArray(mlir::Location loc, mlir::OpBuilder &builder,
+                                imex::AllocaInsertionPoint &allocaHelper,
+                                mlir::ValueRange events) const {
+    auto eventsCount = static_cast<unsigned>(events.size());
+    auto eventsArrayType =
+        mlir::LLVM::LLVMArrayType::get(llvmEventType, eventsCount + 1);
+
+    auto eventsArrayPtr = allocaHelper.insert(builder, [&]() {
+      auto size = builder.create<mlir::LLVM::ConstantOp>(
+          loc, llvmInt64Type, builder.getI64IntegerAttr(1));
+      return builder.create<mlir::LLVM::AllocaOp>(loc, llvmPointerType,
+                                                  eventsArrayType, size, 0);
+    });
+
+    mlir::Value eventsArray =
+        builder.create<mlir::LLVM::UndefOp>(loc, eventsArrayType);
+
+    for (auto i : llvm::seq(0u, eventsCount)) {
+      mlir::Value evt = builder.create<mlir::LLVM::UndefOp>(loc, llvmEventType);
+      evt = builder.create<mlir::LLVM::InsertValueOp>(loc, evt, events[i], 0);
+      eventsArray =
+          builder.create<mlir::LLVM::InsertValueOp>(loc, eventsArray, evt, i);
+    }
+
+    auto nullEvent = [&]() {
+      auto nullPtr = builder.create<mlir::LLVM::ZeroOp>(loc, llvmPointerType);
+      mlir::Value evt = builder.create<mlir::LLVM::UndefOp>(loc, llvmEventType);
+      return builder.create<mlir::LLVM::InsertValueOp>(loc, evt, nullPtr, 0);
+    }();
+
+    eventsArray = builder.create<mlir::LLVM::InsertValueOp>(
+        loc, eventsArray, nullEvent, eventsCount);
+    builder.create<mlir::LLVM::StoreOp>(loc, eventsArray, eventsArrayPtr);
+    return eventsArrayPtr;
+  }
+
+  // Computes the pointer to the first element of a memref.
+  mlir::Value getDataPtr(mlir::Location loc, mlir::OpBuilder &builder,
+                         mlir::MemRefType memRefType,
+                         mlir::Value convertedMemRef) const {
+    mlir::Type elementType =
+        this->getTypeConverter()->convertType(memRefType.getElementType());
+    mlir::MemRefDescriptor desc(convertedMemRef);
+    mlir::Value basePtr = desc.alignedPtr(builder, loc);
+    mlir::Value offset = desc.offset(builder, loc);
+    return builder.create<mlir::LLVM::GEPOp>(loc, basePtr.getType(),
+                                             elementType, basePtr, offset);
+  }
+
+  // Computes the total size in bytes of a memref.
+  mlir::Value getTotalSize(mlir::Location loc,
+                           mlir::ConversionPatternRewriter &rewriter,
+                           mlir::MemRefType memRefType,
+                           mlir::Value convertedMemRef) const {
+    mlir::MemRefDescriptor desc(convertedMemRef);
+
+    // Compute number of elements.
+    mlir::Value numElements = rewriter.create<mlir::LLVM::ConstantOp>(
+        loc, this->getIndexType(), rewriter.getIndexAttr(1));
+    for (int pos = 0; pos < memRefType.getRank(); ++pos) {
+      auto size = desc.size(rewriter, loc, pos);
+      numElements = rewriter.create<mlir::LLVM::MulOp>(loc, numElements, size);
+    }
+
+    // Get element size.
+    auto sizeInBytes =
+        this->getSizeInBytes(loc, memRefType.getElementType(), rewriter);
+    // Compute total.
+    return rewriter.create<mlir::LLVM::MulOp>(loc, numElements, sizeInBytes);
+  }
 };
 
+/// Returns whether the elements of memrefs of type \p type are contiguous in
+/// row-major order, so they span the size of the memref from its first one.
+static bool isContiguous(mlir::MemRefType type) {
+  if (type.getLayout().isIdentity())
+    return true;
+  llvm::SmallVector<int64_t> strides;
+  int64_t offset;
+  if (mlir::failed(type.getStridesAndOffset(strides, offset)))
+    return false;
+  int64_t expected = 1;
+  for (auto dim : llvm::reverse(llvm::seq<int64_t>(0, type.getRank()))) {
+    if (type.getDimSize(dim) == 1)
+      continue;
+    if (strides[dim] != expected || type.isDynamicDim(dim))
+      return false;
+    expected *= type.getDimSize(dim);
+  }
+  return true;
+}
+
 /// A rewrite pattern to convert gpux.memcpy operations into a GPU runtime
-/// call.
+/// call. The runtime copies one contiguous range, so memrefs with gaps
+/// between their elements are rejected.
 class ConvertMemcpyOpToGpuRuntimeCallPattern
     : public ConvertOpToGpuRuntimeCallPattern<imex::gpux::MemcpyOp> {
 public:
@@ -224,41 +531,196 @@ private:
     auto loc = memcpyOp.getLoc();
     mlir::MemRefType srcMemRefType =
         llvm::dyn_cast<mlir::MemRefType>(memcpyOp.getSrc().getType());
-    mlir::MemRefDescriptor srcDesc(adaptor.getSrc());
+    auto dstMemRefType =
+        mlir::cast<mlir::MemRefType>(memcpyOp.getDst().getType());
+    if (!isContiguous(srcMemRefType) || !isContiguous(dstMemRefType))
+      return rewriter.notifyMatchFailure(memcpyOp,
+                                         "memrefs must be contiguous");
+    mlir::Value totalSize =
+        getTotalSize(loc, rewriter, srcMemRefType, adaptor.getSrc());
+    mlir::Value srcPtr =
+        getDataPtr(loc, rewriter, srcMemRefType, adaptor.getSrc());
+    mlir::Value dstPtr =
+        getDataPtr(loc, rewriter, srcMemRefType, adaptor.getDst());
 
-    // Compute number of elements.
-    mlir::Value numElements = rewriter.create<mlir::LLVM::ConstantOp>(
-        loc, getIndexType(), rewriter.getIndexAttr(1));
-    for (int pos = 0; pos < srcMemRefType.getRank(); ++pos) {
-      auto size = srcDesc.size(rewriter, loc, pos);
-      numElements = rewriter.create<mlir::LLVM::MulOp>(loc, numElements, size);
+    auto asyncToken = memcpyOp.getAsyncToken();
+    auto events = adaptor.getAsyncDependencies();
+    if (!asyncToken && events.empty()) {
+      memcpyCallBuilder.create(
+          loc, rewriter, {adaptor.getGpuxStream(), dstPtr, srcPtr, totalSize});
+      rewriter.eraseOp(memcpyOp);
+      return mlir::success();
     }
 
-    // Get element size.
-    auto sizeInBytes =
-        getSizeInBytes(loc, srcMemRefType.getElementType(), rewriter);
-    // Compute total.
+    // The copy is enqueued without blocking the host and signals an event
+    // which replaces the async token.
+    imex::AllocaInsertionPoint allocaHelper(memcpyOp);
+    auto eventsArrayPtr =
+        createEventsArray(loc, rewriter, allocaHelper, events);
+    auto event = memcpyAsyncCallBuilder.create(
+        loc, rewriter,
+        {adaptor.getGpuxStream(), dstPtr, srcPtr, totalSize, eventsArrayPtr});
+    if (!asyncToken) {
+      waitCallBuilder.create(loc, rewriter, adaptor.getGpuxStream());
+      rewriter.eraseOp(memcpyOp);
+    } else {
+      rewriter.replaceOp(memcpyOp, event->getResult(0));
+    }
+    return mlir::success();
+  }
+};
+
+/// Returns the byte \p value consists of if it is a constant repeating a
+/// single byte, e.g. zero.
+static std::optional<uint8_t> getRepeatedByte(mlir::Value value) {
+  mlir::Attribute attr;
+  if (!mlir::matchPattern(value, mlir::m_Constant(&attr)))
+    return std::nullopt;
+  llvm::APInt bits;
+  if (auto intAttr = mlir::dyn_cast<mlir::IntegerAttr>(attr))
+    bits = intAttr.getValue();
+  else if (auto floatAttr = mlir::dyn_cast<mlir::FloatAttr>(attr))
+    bits = floatAttr.getValue().bitcastToAPInt();
+  else
+    return std::nullopt;
+  if (bits.getBitWidth() % 8)
+    return std::nullopt;
+  auto byte = bits.trunc(8);
+  if (bits != llvm::APInt::getSplat(bits.getBitWidth(), byte))
+    return std::nullopt;
+  return static_cast<uint8_t>(byte.getZExtValue());
+}
+
+/// A rewrite pattern to convert gpux.memset operations into a GPU runtime
+/// call. The value is stored to the stack and passed as the fill pattern.
+/// Constants repeating a single byte are passed as a one byte pattern, which
+/// the copy engines fill at their full rate. As for gpux.memcpy, the memref
+/// must be contiguous.
+class ConvertMemsetOpToGpuRuntimeCallPattern
+    : public ConvertOpToGpuRuntimeCallPattern<imex::gpux::MemsetOp> {
+public:
+  ConvertMemsetOpToGpuRuntimeCallPattern(mlir::LLVMTypeConverter &typeConverter)
+      : ConvertOpToGpuRuntimeCallPattern<imex::gpux::MemsetOp>(typeConverter) {}
+
+private:
+  mlir::LogicalResult
+  matchAndRewrite(imex::gpux::MemsetOp memsetOp, OpAdaptor adaptor,
+                  mlir::ConversionPatternRewriter &rewriter) const override {
+    auto loc = memsetOp.getLoc();
+    mlir::MemRefType dstMemRefType =
+        llvm::dyn_cast<mlir::MemRefType>(memsetOp.getDst().getType());
+    auto valueType = memsetOp.getValue().getType();
+    if (valueType != dstMemRefType.getElementType())
+      return rewriter.notifyMatchFailure(
+          memsetOp, "value type must match the memref element type");
+    if (!isContiguous(dstMemRefType))
+      return rewriter.notifyMatchFailure(memsetOp,
+                                         "memref must be contiguous");
+
     mlir::Value totalSize =
-        rewriter.create<mlir::LLVM::MulOp>(loc, numElements, sizeInBytes);
+        getTotalSize(loc, rewriter, dstMemRefType, adaptor.getDst());
+    mlir::Value dstPtr =
+        getDataPtr(loc, rewriter, dstMemRefType, adaptor.getDst());
+
+    imex::AllocaInsertionPoint allocaHelper(memsetOp);
+    auto value = adaptor.getValue();
+    mlir::Type patternType = valueType;
+    if (auto byte = getRepeatedByte(memsetOp.getValue())) {
+      patternType = rewriter.getI8Type();
+      value = rewriter.create<mlir::LLVM::ConstantOp>(
+          loc, patternType, rewriter.getI8IntegerAttr(*byte));
+    }
+    auto patternPtr = allocaHelper.insert(rewriter, [&]() {
+      auto size = rewriter.create<mlir::LLVM::ConstantOp>(
+          loc, llvmInt64Type, rewriter.getI64IntegerAttr(1));
+      return rewriter.create<mlir::LLVM::AllocaOp>(loc, llvmPointerType,
+                                                   value.getType(), size, 0);
+    });
+    rewriter.create<mlir::LLVM::StoreOp>(loc, value, patternPtr);
+    auto patternSize = getSizeInBytes(loc, patternType, rewriter);
 
-    mlir::Type elementType =
-        typeConverter->convertType(srcMemRefType.getElementType());
-
-    mlir::Value srcBasePtr = srcDesc.alignedPtr(rewriter, loc);
-    mlir::Value srcOffset = srcDesc.offset(rewriter, loc);
-    mlir::Value srcPtr = rewriter.create<mlir::LLVM::GEPOp>(
-        loc, srcBasePtr.getType(), elementType, srcBasePtr, srcOffset);
-    mlir::MemRefDescriptor dstDesc(adaptor.getDst());
-    mlir::Value dstBasePtr = dstDesc.alignedPtr(rewriter, loc);
-    mlir::Value dstOffset = dstDesc.offset(rewriter, loc);
-    mlir::Value dstPtr = rewriter.create<mlir::LLVM::GEPOp>(
-        loc, dstBasePtr.getType(), elementType, dstBasePtr, dstOffset);
+    auto eventsArrayPtr = createEventsArray(loc, rewriter, allocaHelper,
+                                            adaptor.getAsyncDependencies());
+    auto event = memsetCallBuilder.create(
+        loc, rewriter,
+        {adaptor.getGpuxStream(), dstPtr, patternPtr, patternSize, totalSize,
+         eventsArrayPtr});
 
-    // Allocate the underlying buffer and store a pointer to it in the MemRef
-    // descriptor.
-    memcpyCallBuilder.create(
-        loc, rewriter, {adaptor.getGpuxStream(), dstPtr, srcPtr, totalSize});
-    rewriter.eraseOp(memcpyOp);
+    // Like kernel launches, a memset without an async token blocks the host
+    // until it has completed.
+    if (!memsetOp.getAsyncToken()) {
+      waitCallBuilder.create(loc, rewriter, adaptor.getGpuxStream());
+      rewriter.eraseOp(memsetOp);
+    } else {
+      rewriter.replaceOp(memsetOp, event->getResult(0));
+    }
+    return mlir::success();
+  }
+};
+
+/// A rewrite pattern to convert gpux.prefetch operations into a GPU runtime
+/// call. The prefetch is a hint, so the host never waits for it.
+class ConvertPrefetchOpToGpuRuntimeCallPattern
+    : public ConvertOpToGpuRuntimeCallPattern<imex::gpux::PrefetchOp> {
+public:
+  ConvertPrefetchOpToGpuRuntimeCallPattern(
+      mlir::LLVMTypeConverter &typeConverter)
+      : ConvertOpToGpuRuntimeCallPattern<imex::gpux::PrefetchOp>(
+            typeConverter) {}
+
+private:
+  mlir::LogicalResult
+  matchAndRewrite(imex::gpux::PrefetchOp prefetchOp, OpAdaptor adaptor,
+                  mlir::ConversionPatternRewriter &rewriter) const override {
+    auto loc = prefetchOp.getLoc();
+    auto memRefType =
+        mlir::cast<mlir::MemRefType>(prefetchOp.getMemref().getType());
+    mlir::Value totalSize =
+        getTotalSize(loc, rewriter, memRefType, adaptor.getMemref());
+    mlir::Value ptr =
+        getDataPtr(loc, rewriter, memRefType, adaptor.getMemref());
+
+    imex::AllocaInsertionPoint allocaHelper(prefetchOp);
+    auto eventsArrayPtr = createEventsArray(loc, rewriter, allocaHelper,
+                                            adaptor.getAsyncDependencies());
+    auto event = prefetchCallBuilder.create(
+        loc, rewriter,
+        {adaptor.getGpuxStream(), ptr, totalSize, eventsArrayPtr});
+    if (!prefetchOp.getAsyncToken())
+      rewriter.eraseOp(prefetchOp);
+    else
+      rewriter.replaceOp(prefetchOp, event->getResult(0));
+    return mlir::success();
+  }
+};
+
+/// A rewrite pattern to convert gpux.mem_advise operations into a GPU runtime
+/// call. The advice is passed as the index of the runtime's GpuMemAdvice.
+class ConvertMemAdviseOpToGpuRuntimeCallPattern
+    : public ConvertOpToGpuRuntimeCallPattern<imex::gpux::MemAdviseOp> {
+public:
+  ConvertMemAdviseOpToGpuRuntimeCallPattern(
+      mlir::LLVMTypeConverter &typeConverter)
+      : ConvertOpToGpuRuntimeCallPattern<imex::gpux::MemAdviseOp>(
+            typeConverter) {}
+
+private:
+  mlir::LogicalResult
+  matchAndRewrite(imex::gpux::MemAdviseOp adviseOp, OpAdaptor adaptor,
+                  mlir::ConversionPatternRewriter &rewriter) const override {
+    auto loc = adviseOp.getLoc();
+    auto memRefType =
+        mlir::cast<mlir::MemRefType>(adviseOp.getMemref().getType());
+    mlir::Value totalSize =
+        getTotalSize(loc, rewriter, memRefType, adaptor.getMemref());
+    mlir::Value ptr =
+        getDataPtr(loc, rewriter, memRefType, adaptor.getMemref());
+    int32_t advice = adviseOp.getAdvice() == "read_mostly" ? 0 : 1;
+    auto adviceValue = rewriter.create<mlir::LLVM::ConstantOp>(
+        loc, llvmInt32Type, rewriter.getI32IntegerAttr(advice));
+    memAdviseCallBuilder.create(
+        loc, rewriter, {adaptor.getGpuxStream(), ptr, totalSize, adviceValue});
+    rewriter.eraseOp(adviseOp);
     return mlir::success();
   }
 };
@@ -268,10 +730,52 @@ private:
 class ConvertAllocOpToGpuRuntimeCallPattern
     : public ConvertOpToGpuRuntimeCallPattern<imex::gpux::AllocOp> {
 public:
-  ConvertAllocOpToGpuRuntimeCallPattern(mlir::LLVMTypeConverter &typeConverter)
-      : ConvertOpToGpuRuntimeCallPattern<imex::gpux::AllocOp>(typeConverter) {}
+  ConvertAllocOpToGpuRuntimeCallPattern(mlir::LLVMTypeConverter &typeConverter,
+                                        bool allocSiteTags)
+      : ConvertOpToGpuRuntimeCallPattern<imex::gpux::AllocOp>(typeConverter),
+        allocSiteTags(allocSiteTags) {}
 
 private:
+  bool allocSiteTags;
+
+  // Returns a pointer to the name of the function enclosing \p op as a C
+  // string, emitted once per function:
+  //
+  // llvm.mlir.global internal constant @func_alloc_site("func\00")
+  mlir::Value getSiteName(mlir::Operation *op,
+                          mlir::OpBuilder &builder) const {
+    auto loc = op->getLoc();
+    auto func = op->getParentOfType<mlir::FunctionOpInterface>();
+    auto name = func ? func.getName() : mlir::StringRef("<unknown>");
+    std::string globalName = (name + "_alloc_site").str();
+    auto module = op->getParentOfType<mlir::ModuleOp>();
+    if (auto global = module.lookupSymbol<mlir::LLVM::GlobalOp>(globalName))
+      return builder.create<mlir::LLVM::AddressOfOp>(loc, llvmPointerType,
+                                                     global.getSymNameAttr());
+    std::string value = (name + llvm::StringRef("\0", 1)).str();
+    return mlir::LLVM::createGlobalString(loc, builder, globalName, value,
+                                          mlir::LLVM::Linkage::Internal);
+  }
+
+  // Returns the address of the data of the memref.global \p global. The
+  // global is lowered by finalize-memref-to-llvm, so its address is taken
+  // through memref ops lowered along with it.
+  mlir::Value getGlobalPtr(mlir::Location loc, mlir::OpBuilder &builder,
+                           mlir::MemRefType memRefType,
+                           mlir::FlatSymbolRefAttr global) const {
+    auto hostMemref = builder.create<mlir::memref::GetGlobalOp>(
+        loc, memRefType, global.getValue());
+    mlir::Value index =
+        builder.create<mlir::memref::ExtractAlignedPointerAsIndexOp>(
+            loc, hostMemref);
+    auto intPtr = builder
+                      .create<mlir::UnrealizedConversionCastOp>(
+                          loc, llvmIndexType, index)
+                      .getResult(0);
+    return builder.create<mlir::LLVM::IntToPtrOp>(loc, llvmPointerType,
+                                                  intPtr);
+  }
+
   mlir::LogicalResult
   matchAndRewrite(imex::gpux::AllocOp allocOp, OpAdaptor adaptor,
                   mlir::ConversionPatternRewriter &rewriter) const override {
@@ -306,12 +810,32 @@ private:
         loc, llvmInt32Type, rewriter.getI32IntegerAttr(isShared));
 
     // Allocate the underlying buffer and store a pointer to it in the MemRef
-    // descriptor.
-    mlir::Value allocatedPtr =
-        allocCallBuilder
-            .create(loc, rewriter,
-                    {adaptor.getGpuxStream(), sizeBytes, alignmentVar, typeVar})
-            ->getResult(0);
+    // descriptor. Device copies of constant globals are made by the runtime,
+    // from the address of the global.
+    mlir::Value allocatedPtr;
+    if (auto global = allocOp->getAttrOfType<mlir::FlatSymbolRefAttr>(
+            imex::gpuConstantDataAttrName)) {
+      allocatedPtr =
+          allocConstantCallBuilder
+              .create(loc, rewriter,
+                      {adaptor.getGpuxStream(),
+                       getGlobalPtr(loc, rewriter, memRefType, global),
+                       sizeBytes, alignmentVar})
+              ->getResult(0);
+    } else {
+      allocatedPtr =
+          allocSiteTags
+              ? allocTaggedCallBuilder
+                    .create(loc, rewriter,
+                            {adaptor.getGpuxStream(), sizeBytes, alignmentVar,
+                             typeVar, getSiteName(allocOp, rewriter)})
+                    ->getResult(0)
+              : allocCallBuilder
+                    .create(loc, rewriter,
+                            {adaptor.getGpuxStream(), sizeBytes, alignmentVar,
+                             typeVar})
+                    ->getResult(0);
+    }
 
     // Create the MemRef descriptor.
     auto memrefDesc = mlir::MemRefDescriptor::undef(rewriter, loc, dstType);
@@ -333,8 +857,16 @@ private:
     }
 
     mlir::Value resMemref = memrefDesc;
-    rewriter.replaceOp(allocOp, resMemref);
+    if (!allocOp.getAsyncToken()) {
+      rewriter.replaceOp(allocOp, resMemref);
+      return mlir::success();
+    }
 
+    // The allocation itself is done by the host, so the token only carries
+    // the dependencies.
+    auto token = joinEvents(allocOp, rewriter, adaptor.getGpuxStream(),
+                            adaptor.getAsyncDependencies());
+    rewriter.replaceOp(allocOp, {resMemref, token});
     return mlir::success();
   }
 };
@@ -359,9 +891,53 @@ private:
         mlir::MemRefDescriptor(adaptor.getMemref()).allocatedPtr(rewriter, loc);
     auto casted =
         rewriter.create<mlir::LLVM::BitcastOp>(loc, llvmPointerType, pointer);
-    auto res = deallocCallBuilder.create(loc, rewriter,
-                                         {adaptor.getGpuxStream(), casted});
-    rewriter.replaceOp(deallocOp, res.getResults());
+    auto stream = adaptor.getGpuxStream();
+    auto events = adaptor.getAsyncDependencies();
+
+    // The runtime releases the memory once the work using it is done: the
+    // dependencies if there are any, all work on the stream otherwise.
+    if (!events.empty()) {
+      imex::AllocaInsertionPoint allocaHelper(deallocOp);
+      auto eventsArrayPtr =
+          createEventsArray(loc, rewriter, allocaHelper, events);
+      deallocAsyncCallBuilder.create(loc, rewriter,
+                                     {stream, casted, eventsArrayPtr});
+    } else {
+      deallocCallBuilder.create(loc, rewriter, {stream, casted});
+    }
+
+    if (!deallocOp.getAsyncToken()) {
+      rewriter.eraseOp(deallocOp);
+      return mlir::success();
+    }
+    rewriter.replaceOp(deallocOp,
+                       joinEvents(deallocOp, rewriter, stream, events));
+    return mlir::success();
+  }
+};
+
+/// A rewrite pattern to convert gpux.wait operations into GPU runtime calls.
+/// A synchronous wait blocks the host until all work on the stream is done,
+/// an async wait returns an event joining its dependencies.
+class ConvertWaitOpToGpuRuntimeCallPattern
+    : public ConvertOpToGpuRuntimeCallPattern<imex::gpux::WaitOp> {
+public:
+  ConvertWaitOpToGpuRuntimeCallPattern(mlir::LLVMTypeConverter &typeConverter)
+      : ConvertOpToGpuRuntimeCallPattern<imex::gpux::WaitOp>(typeConverter) {}
+
+private:
+  mlir::LogicalResult
+  matchAndRewrite(imex::gpux::WaitOp waitOp, OpAdaptor adaptor,
+                  mlir::ConversionPatternRewriter &rewriter) const override {
+    auto stream = adaptor.getGpuxStream();
+    if (!waitOp.getAsyncToken()) {
+      waitCallBuilder.create(waitOp.getLoc(), rewriter, stream);
+      rewriter.eraseOp(waitOp);
+      return mlir::success();
+    }
+
+    rewriter.replaceOp(waitOp, joinEvents(waitOp, rewriter, stream,
+                                          adaptor.getAsyncDependencies()));
     return mlir::success();
   }
 };
@@ -371,7 +947,8 @@ private:
 /// In essence, a gpux.launch_func operations gets compiled into the following
 /// sequence of runtime calls:
 ///
-/// * moduleLoad        -- loads the module given the spirv data
+/// * moduleLoad        -- loads the module given the spirv data and native
+///                        binaries compiled ahead of time, if any
 /// * KernelGetFunction -- gets a handle to the actual kernel function
 /// * launchKernel      -- launches the kernel on a stream
 /// * gpuWait           -- waits for operations on the stream to finish
@@ -382,13 +959,20 @@ class ConvertLaunchFuncOpToGpuRuntimeCallPattern
 public:
   ConvertLaunchFuncOpToGpuRuntimeCallPattern(
       mlir::LLVMTypeConverter &typeConverter,
-      mlir::StringRef gpuBinaryAnnotation)
+      mlir::StringRef gpuBinaryAnnotation, bool packedKernelArgs,
+      bool batchKernelLaunches, bool preloadModules)
       : ConvertOpToGpuRuntimeCallPattern<imex::gpux::LaunchFuncOp>(
             typeConverter),
-        gpuBinaryAnnotation(gpuBinaryAnnotation) {}
+        gpuBinaryAnnotation(gpuBinaryAnnotation),
+        packedKernelArgs(packedKernelArgs),
+        batchKernelLaunches(batchKernelLaunches),
+        preloadModules(preloadModules) {}
 
 private:
   llvm::SmallString<32> gpuBinaryAnnotation;
+  bool packedKernelArgs;
+  bool batchKernelLaunches;
+  bool preloadModules;
 
   // Given a global op that contains the name of a kernel function,
   // this function returns a pointer to the beginning on the global op.
@@ -450,10 +1034,100 @@ private:
         mlir::LLVM::Linkage::Internal);
   }
 
+  // Lowers the launch to gpuLaunchKernelPacked. The kernel parameters are
+  // stored back to back in one packed struct on the stack, described by a
+  // constant layout emitted once per kernel: the number of parameters
+  // followed by the size of each.
+  //
+  // llvm.mlir.global internal constant @module_kernel_arg_layout(
+  //     dense<[N, size0, ...]> : tensor<N+1xi64>) : !llvm.array<N+1 x i64>
+  // %args = alloca(struct<packed (Parameters...)>)
+  // for (i : [0, NumParameters))
+  //   llvm.store parameters[i], %args[0, i] {alignment = 1}
+  // gpuLaunchKernelPacked(..., %args, @module_kernel_arg_layout, %events)
   mlir::LogicalResult
-  matchAndRewrite(imex::gpux::LaunchFuncOp launchOp, OpAdaptor adaptor,
-                  mlir::ConversionPatternRewriter &rewriter) const override {
+  lowerPackedLaunch(imex::gpux::LaunchFuncOp launchOp, OpAdaptor adaptor,
+                    mlir::ConversionPatternRewriter &rewriter,
+                    mlir::Value kernel) const {
+    auto loc = launchOp.getLoc();
+    llvm::SmallVector<mlir::Value> params;
+    llvm::SmallVector<mlir::Type> paramTypes;
+    for (auto [operand, param] : llvm::zip(launchOp.getKernelOperands(),
+                                           adaptor.getKernelOperands())) {
+      mlir::Value value = param;
+      if (mlir::isa<mlir::MemRefType>(operand.getType()))
+        value = mlir::MemRefDescriptor(param).alignedPtr(rewriter, loc);
+      params.push_back(value);
+      paramTypes.push_back(value.getType());
+    }
+
+    auto dataLayout = mlir::DataLayout::closest(launchOp);
+    llvm::SmallVector<int64_t> layout = {static_cast<int64_t>(params.size())};
+    for (auto type : paramTypes)
+      layout.push_back(static_cast<int64_t>(dataLayout.getTypeSize(type)));
+
+    auto layoutName = std::string(llvm::formatv(
+        "{0}_{1}_arg_layout", launchOp.getKernelModuleName().getValue(),
+        launchOp.getKernelName().getValue()));
+    auto mod = launchOp->getParentOfType<mlir::ModuleOp>();
+    auto layoutGlobal = mod.lookupSymbol<mlir::LLVM::GlobalOp>(layoutName);
+    if (!layoutGlobal) {
+      mlir::OpBuilder::InsertionGuard guard(rewriter);
+      rewriter.setInsertionPointToStart(mod.getBody());
+      layoutGlobal = rewriter.create<mlir::LLVM::GlobalOp>(
+          loc, mlir::LLVM::LLVMArrayType::get(llvmInt64Type, layout.size()),
+          /*isConstant=*/true, mlir::LLVM::Linkage::Internal, layoutName,
+          rewriter.getI64TensorAttr(layout));
+    }
+    auto layoutPtr =
+        rewriter.create<mlir::LLVM::AddressOfOp>(loc, layoutGlobal);
+
+    auto argsType = mlir::LLVM::LLVMStructType::getLiteral(
+        context, paramTypes, /*isPacked=*/true);
+    imex::AllocaInsertionPoint allocaHelper(launchOp);
+    auto argsPtr = allocaHelper.insert(rewriter, [&]() {
+      auto size = rewriter.create<mlir::LLVM::ConstantOp>(
+          loc, llvmInt64Type, rewriter.getI64IntegerAttr(1));
+      return rewriter.create<mlir::LLVM::AllocaOp>(loc, llvmPointerType,
+                                                   argsType, size, 0);
+    });
+    for (auto [i, param] : llvm::enumerate(params)) {
+      auto fieldPtr = rewriter.create<mlir::LLVM::GEPOp>(
+          loc, llvmPointerType, argsType, argsPtr,
+          llvm::ArrayRef<mlir::LLVM::GEPArg>{0, static_cast<int32_t>(i)});
+      rewriter.create<mlir::LLVM::StoreOp>(loc, param, fieldPtr,
+                                           /*alignment=*/1);
+    }
+
+    auto eventsArrayPtr = createEventsArray(loc, rewriter, allocaHelper,
+                                            adaptor.getAsyncDependencies());
+    mlir::Value dynamicSharedMemorySize = adaptor.getDynamicSharedMemorySize();
+    if (!dynamicSharedMemorySize)
+      dynamicSharedMemorySize = rewriter.create<mlir::LLVM::ConstantOp>(
+          loc, llvmInt32Type, rewriter.getI32IntegerAttr(0));
+
+    auto event = launchKernelPackedCallBuilder.create(
+        loc, rewriter,
+        {adaptor.getGpuxStream(), kernel, adaptor.getGridSizeX(),
+         adaptor.getGridSizeY(), adaptor.getGridSizeZ(),
+         adaptor.getBlockSizeX(), adaptor.getBlockSizeY(),
+         adaptor.getBlockSizeZ(), dynamicSharedMemorySize, argsPtr, layoutPtr,
+         eventsArrayPtr});
+
+    if (!launchOp.getAsyncToken()) {
+      waitCallBuilder.create(loc, rewriter, adaptor.getGpuxStream());
+      rewriter.eraseOp(launchOp);
+    } else {
+      rewriter.replaceOp(launchOp, event->getResult(0));
+    }
+    return mlir::success();
+  }
 
+  // Emits the calls loading the module of the launched kernel and getting
+  // the kernel from it, and returns the kernel.
+  mlir::FailureOr<mlir::Value>
+  getKernel(imex::gpux::LaunchFuncOp launchOp, OpAdaptor adaptor,
+            mlir::ConversionPatternRewriter &rewriter) const {
     mlir::Location loc = launchOp.getLoc();
 
     // Create an LLVM global with SPIRV extracted from the kernel annotation
@@ -501,9 +1175,42 @@ private:
         mlir::IntegerAttr::get(llvmIndexType,
                                static_cast<int64_t>(spirvBlob.size())));
 
-    // loads the GPU module given the spirv data
-    auto module = moduleLoadCallBuilder.create(
-        loc, rewriter, {adaptor.getGpuxStream(), data, size});
+    // loads the GPU module given the spirv data, with the largest register
+    // file requested by one of its kernels and the vector backend if one of
+    // them needs it
+    int32_t grfSize = 0, vectorBackend = 0;
+    for (auto func : kernelModule.getOps<mlir::gpu::GPUFuncOp>()) {
+      if (auto attr =
+              func->getAttrOfType<mlir::IntegerAttr>(imex::gpuGRFSizeAttrName))
+        grfSize = std::max(grfSize, static_cast<int32_t>(attr.getInt()));
+      if (func->hasAttr(imex::gpuVectorBackendAttrName))
+        vectorBackend = 1;
+    }
+    mlir::LLVM::CallOp module;
+    auto binaries = getNativeBinaries(kernelModule, loc, rewriter);
+    if (preloadModules)
+      addModulePreload(compModule, nameBuffer, spirvBlob.size(), grfSize,
+                       vectorBackend, kernelModule, loc, rewriter);
+    if (binaries || vectorBackend) {
+      if (!binaries)
+        binaries = rewriter.create<mlir::LLVM::ZeroOp>(loc, llvmPointerType);
+      auto grfSizeConst = rewriter.create<mlir::LLVM::ConstantOp>(
+          loc, llvmInt32Type, rewriter.getI32IntegerAttr(grfSize));
+      auto vectorBackendConst = rewriter.create<mlir::LLVM::ConstantOp>(
+          loc, llvmInt32Type, rewriter.getI32IntegerAttr(vectorBackend));
+      module = moduleLoadWithOptionsCallBuilder.create(
+          loc, rewriter,
+          {adaptor.getGpuxStream(), data, size, grfSizeConst,
+           vectorBackendConst, binaries});
+    } else if (grfSize) {
+      auto grfSizeConst = rewriter.create<mlir::LLVM::ConstantOp>(
+          loc, llvmInt32Type, rewriter.getI32IntegerAttr(grfSize));
+      module = moduleLoadWithGRFSizeCallBuilder.create(
+          loc, rewriter, {adaptor.getGpuxStream(), data, size, grfSizeConst});
+    } else {
+      module = moduleLoadCallBuilder.create(
+          loc, rewriter, {adaptor.getGpuxStream(), data, size});
+    }
 
     // Get the function from the module. The name corresponds to the name of
     // the kernel function.
@@ -514,6 +1221,157 @@ private:
         loc, rewriter,
         {adaptor.getGpuxStream(), module->getResult(0), kernelName});
 
+    // Pass the cost estimates of the kernel on to the runtime profiler.
+    auto kernelFunc =
+        mlir::SymbolTable::lookupNearestSymbolFrom<mlir::gpu::GPUFuncOp>(
+            launchOp, launchOp.getKernel());
+    mlir::IntegerAttr bytes, flops;
+    if (kernelFunc) {
+      bytes = kernelFunc->getAttrOfType<mlir::IntegerAttr>(
+          imex::gpuBytesPerItemAttrName);
+      flops = kernelFunc->getAttrOfType<mlir::IntegerAttr>(
+          imex::gpuFlopsPerItemAttrName);
+    }
+    if (bytes && flops) {
+      auto bytesConst = rewriter.create<mlir::LLVM::ConstantOp>(
+          loc, llvmInt64Type, rewriter.getI64IntegerAttr(bytes.getInt()));
+      auto flopsConst = rewriter.create<mlir::LLVM::ConstantOp>(
+          loc, llvmInt64Type, rewriter.getI64IntegerAttr(flops.getInt()));
+      kernelSetCostCallBuilder.create(
+          loc, rewriter,
+          {adaptor.getGpuxStream(), function->getResult(0), bytesConst,
+           flopsConst});
+    }
+
+    // Let the runtime choose the group size of kernels that do not depend
+    // on it, see imex-group-size-agnostic.
+    if (kernelFunc && kernelFunc->hasAttr(imex::gpuGroupSizeAgnosticAttrName)) {
+      auto grfSizeConst = rewriter.create<mlir::LLVM::ConstantOp>(
+          loc, llvmInt32Type, rewriter.getI32IntegerAttr(grfSize));
+      kernelSetGroupSizeAgnosticCallBuilder.create(
+          loc, rewriter,
+          {adaptor.getGpuxStream(), function->getResult(0), grfSizeConst});
+    }
+    return function->getResult(0);
+  }
+
+  // Adds a gpuModulePreload call for the SPIR-V of \p kernelModule, stored
+  // in \p dataGlobal, to the module constructor, creating it if needed. The
+  // arguments are those of the gpuModuleLoadWithOptions call of the launches:
+  //
+  // llvm.func internal @gpux_preload_modules() {
+  //   llvm.call @gpuModulePreload(@Kernels_spirv_binary, size, grfSize,
+  //                               vectorBackend, @Kernels_native_binaries)
+  // }
+  // llvm.mlir.global_ctors {ctors = [@gpux_preload_modules], ...}
+  void addModulePreload(mlir::ModuleOp mod, mlir::StringRef dataGlobal,
+                        int64_t size, int32_t grfSize, int32_t vectorBackend,
+                        mlir::gpu::GPUModuleOp kernelModule,
+                        mlir::Location loc,
+                        mlir::ConversionPatternRewriter &rewriter) const {
+    mlir::OpBuilder::InsertionGuard guard(rewriter);
+    auto ctor =
+        mod.lookupSymbol<mlir::LLVM::LLVMFuncOp>(kModulePreloadCtorName);
+    if (ctor) {
+      for (auto addr :
+           ctor.getBody().front().getOps<mlir::LLVM::AddressOfOp>())
+        if (addr.getGlobalName() == dataGlobal)
+          return;
+    } else {
+      rewriter.setInsertionPointToEnd(mod.getBody());
+      ctor = rewriter.create<mlir::LLVM::LLVMFuncOp>(
+          loc, kModulePreloadCtorName,
+          mlir::LLVM::LLVMFunctionType::get(llvmVoidType, {}),
+          mlir::LLVM::Linkage::Internal);
+      rewriter.createBlock(&ctor.getBody());
+      rewriter.create<mlir::LLVM::ReturnOp>(loc, mlir::ValueRange{});
+
+      // Register the constructor, keeping the ones already in the module.
+      llvm::SmallVector<mlir::Attribute> ctors;
+      llvm::SmallVector<int32_t> priorities;
+      for (auto op : llvm::make_early_inc_range(
+               mod.getOps<mlir::LLVM::GlobalCtorsOp>())) {
+        llvm::append_range(ctors, op.getCtors());
+        for (auto priority : op.getPriorities())
+          priorities.push_back(
+              mlir::cast<mlir::IntegerAttr>(priority).getInt());
+        rewriter.eraseOp(op);
+      }
+      ctors.push_back(mlir::FlatSymbolRefAttr::get(ctor));
+      priorities.push_back(65535);
+      rewriter.setInsertionPointAfter(ctor);
+      rewriter.create<mlir::LLVM::GlobalCtorsOp>(
+          loc, rewriter.getArrayAttr(ctors),
+          rewriter.getI32ArrayAttr(priorities));
+    }
+
+    rewriter.setInsertionPoint(ctor.getBody().front().getTerminator());
+    mlir::Value data = rewriter.create<mlir::LLVM::AddressOfOp>(
+        loc, llvmPointerType, dataGlobal);
+    auto sizeConst = rewriter.create<mlir::LLVM::ConstantOp>(
+        loc, llvmIndexType, mlir::IntegerAttr::get(llvmIndexType, size));
+    auto grfSizeConst = rewriter.create<mlir::LLVM::ConstantOp>(
+        loc, llvmInt32Type, rewriter.getI32IntegerAttr(grfSize));
+    auto vectorBackendConst = rewriter.create<mlir::LLVM::ConstantOp>(
+        loc, llvmInt32Type, rewriter.getI32IntegerAttr(vectorBackend));
+    mlir::Value binaries = getNativeBinaries(kernelModule, loc, rewriter);
+    if (!binaries)
+      binaries = rewriter.create<mlir::LLVM::ZeroOp>(loc, llvmPointerType);
+    modulePreloadCallBuilder.create(
+        loc, rewriter,
+        {data, sizeConst, grfSizeConst, vectorBackendConst, binaries});
+  }
+
+  // Returns a pointer to the table of the native binaries compiled ahead of
+  // time for \p kernelModule, or null if there are none. The table is laid out
+  // as expected by the runtimes, see NativeBinaryCache.h:
+  //
+  // llvm.mlir.global internal constant @Kernels_native_binaries(
+  //     "<u32 device ID><u64 size><binary>...<u32 0>")
+  mlir::Value getNativeBinaries(mlir::gpu::GPUModuleOp kernelModule,
+                                mlir::Location loc,
+                                mlir::OpBuilder &builder) const {
+    auto binaries = kernelModule->getAttrOfType<mlir::DictionaryAttr>(
+        imex::gpuNativeBinariesAttrName);
+    if (!binaries || binaries.empty())
+      return {};
+
+    std::string globalName =
+        (kernelModule.getName() + "_native_binaries").str();
+    auto module =
+        builder.getBlock()->getParent()->getParentOfType<mlir::ModuleOp>();
+    if (auto global = module.lookupSymbol<mlir::LLVM::GlobalOp>(globalName))
+      return builder.create<mlir::LLVM::AddressOfOp>(loc, llvmPointerType,
+                                                     global.getSymNameAttr());
+
+    std::string table;
+    auto append = [&](auto value) {
+      for (size_t i = 0; i < sizeof(value); ++i)
+        table.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+    };
+    for (auto binary : binaries) {
+      uint32_t deviceId = 0;
+      auto data = mlir::dyn_cast<mlir::StringAttr>(binary.getValue());
+      if (binary.getName().getValue().getAsInteger(0, deviceId) || !deviceId ||
+          !data)
+        continue;
+      append(deviceId);
+      append(static_cast<uint64_t>(data.getValue().size()));
+      table += data.getValue();
+    }
+    append(uint32_t(0));
+    return mlir::LLVM::createGlobalString(loc, builder, globalName, table,
+                                          mlir::LLVM::Linkage::Internal);
+  }
+
+  // Creates the null terminated array of {pointer, size} descriptors of the
+  // kernel parameters of \p launchOp on the stack and returns a pointer to it.
+  mlir::Value
+  createParamsArray(imex::gpux::LaunchFuncOp launchOp, OpAdaptor adaptor,
+                    mlir::ConversionPatternRewriter &rewriter,
+                    imex::AllocaInsertionPoint &allocaHelper) const {
+    mlir::Location loc = launchOp.getLoc();
+
     /////////////////////////////////////////////////////////////////////////
     // Create an array of struct containing all kernel parameters and inserts
     // these type-erased pointers to the fields of the struct. The array of
@@ -528,7 +1386,6 @@ private:
     //    %elementPtr = llvm.getelementptr %array[i]
     // 5. llvm.store %fieldPtr, %elementPtr
 
-    imex::AllocaInsertionPoint allocaHelper(launchOp);
     auto kernelParams = adaptor.getKernelOperands();
     auto paramsCount = static_cast<unsigned>(kernelParams.size());
     auto paramsArrayType =
@@ -615,57 +1472,139 @@ private:
     paramsArray = rewriter.create<mlir::LLVM::InsertValueOp>(
         loc, paramsArray, nullRange, paramsCount);
     rewriter.create<mlir::LLVM::StoreOp>(loc, paramsArray, paramsArrayPtr);
+    return paramsArrayPtr;
+  }
 
-    /////////////////////////////////////////////////////////////////////
-    // Create an array of struct containing all events and insert
-    // these type-erased pointers to the fields of the struct. The array of
-    // struct is then passed to Runtime wrapper Kernel launch call. Generated
-    // code is essentially as follows:
-    //
-    // 1. %eventsArrayPtr = alloca(sizeof(struct{event}*))
-    // 2. %eventsArray = alloca((NumEvents + 1) * sizeof(void *))
-    // 3. for (i : [0, NumEvents))
-    //       %struct = alloca(sizeof(struct { events... }))
-    //       llvm.insertvalue %event, %struct
-    //       llvm.insertvalue %struct, %eventsArray
-    // 4. //Add null event to indicate eventsArray termination
-    //    %struct = alloca(sizeof(struct { events... }))
-    //    llvm.insertvalue %null_event, %struct
-    //    llvm.insertvalue %struct, %eventsArray
-    // 5. llvm.store %eventsArray, %eventsArrayPtr
-
-    auto events = adaptor.getAsyncDependencies();
-    auto eventsCount = static_cast<unsigned>(events.size());
-
-    auto eventsArrayType =
-        mlir::LLVM::LLVMArrayType::get(llvmEventType, eventsCount + 1);
+  // Returns the run of launches starting at \p launchOp that can be submitted
+  // with one gpuLaunchKernels call: consecutive synchronous launches on the
+  // same stream, with no other op in between.
+  llvm::SmallVector<imex::gpux::LaunchFuncOp>
+  getLaunchBatch(imex::gpux::LaunchFuncOp launchOp) const {
+    auto isSync = [](imex::gpux::LaunchFuncOp op) {
+      return !op.getAsyncToken() && op.getAsyncDependencies().empty();
+    };
+    llvm::SmallVector<imex::gpux::LaunchFuncOp> batch;
+    if (!isSync(launchOp))
+      return batch;
+    batch.push_back(launchOp);
+    for (auto *op = launchOp->getNextNode(); op; op = op->getNextNode()) {
+      auto next = mlir::dyn_cast<imex::gpux::LaunchFuncOp>(op);
+      if (!next || !isSync(next) ||
+          next.getGpuxStream() != launchOp.getGpuxStream())
+        break;
+      batch.push_back(next);
+    }
+    return batch;
+  }
 
-    auto eventsArrayPtr = allocaHelper.insert(rewriter, [&]() {
+  // Lowers \p batch to one gpuLaunchKernels call with an array of launch
+  // descriptors, followed by a single wait for the whole batch:
+  //
+  // %descs = alloca(array<N x struct<(ptr kernel, index grid[3],
+  //                                   index block[3], index sharedMemBytes,
+  //                                   ptr params)>>)
+  // gpuLaunchKernels(%stream, %descs, N, null)
+  // gpuWait(%stream)
+  mlir::LogicalResult
+  lowerLaunchBatch(llvm::ArrayRef<imex::gpux::LaunchFuncOp> batch,
+                   OpAdaptor firstAdaptor,
+                   mlir::ConversionPatternRewriter &rewriter) const {
+    auto loc = batch.front().getLoc();
+    auto descType = mlir::LLVM::LLVMStructType::getLiteral(
+        context, {llvmPointerType, llvmIndexType, llvmIndexType, llvmIndexType,
+                  llvmIndexType, llvmIndexType, llvmIndexType, llvmIndexType,
+                  llvmPointerType});
+    auto descsType = mlir::LLVM::LLVMArrayType::get(descType, batch.size());
+
+    imex::AllocaInsertionPoint allocaHelper(batch.front());
+    auto descsPtr = allocaHelper.insert(rewriter, [&]() {
+      auto size = rewriter.create<mlir::LLVM::ConstantOp>(
+          loc, llvmInt64Type, rewriter.getI64IntegerAttr(1));
       return rewriter.create<mlir::LLVM::AllocaOp>(loc, llvmPointerType,
-                                                   eventsArrayType, size, 0);
+                                                   descsType, size, 0);
     });
 
-    mlir::Value eventsArray =
-        rewriter.create<mlir::LLVM::UndefOp>(loc, eventsArrayType);
+    mlir::Value descs = rewriter.create<mlir::LLVM::UndefOp>(loc, descsType);
+    for (auto [i, launchOp] : llvm::enumerate(batch)) {
+      // The operands of the launches after the first are not converted yet.
+      llvm::SmallVector<mlir::Value> operands;
+      if (i == 0) {
+        operands.assign(firstAdaptor.getOperands().begin(),
+                        firstAdaptor.getOperands().end());
+      } else if (mlir::failed(rewriter.getRemappedValues(
+                     launchOp->getOperands(), operands))) {
+        return mlir::failure();
+      }
+      OpAdaptor adaptor(operands, launchOp);
+
+      auto kernel = getKernel(launchOp, adaptor, rewriter);
+      if (mlir::failed(kernel))
+        return mlir::failure();
+      auto params = createParamsArray(launchOp, adaptor, rewriter,
+                                      allocaHelper);
+      mlir::Value sharedMemBytes = rewriter.create<mlir::LLVM::ConstantOp>(
+          loc, llvmIndexType, rewriter.getIntegerAttr(llvmIndexType, 0));
+      if (auto size = adaptor.getDynamicSharedMemorySize())
+        sharedMemBytes =
+            rewriter.create<mlir::LLVM::ZExtOp>(loc, llvmIndexType, size);
+
+      mlir::Value desc = rewriter.create<mlir::LLVM::UndefOp>(loc, descType);
+      mlir::Value fields[] = {*kernel,
+                              adaptor.getGridSizeX(),
+                              adaptor.getGridSizeY(),
+                              adaptor.getGridSizeZ(),
+                              adaptor.getBlockSizeX(),
+                              adaptor.getBlockSizeY(),
+                              adaptor.getBlockSizeZ(),
+                              sharedMemBytes,
+                              params};
+      for (auto [pos, field] : llvm::enumerate(fields))
+        desc = rewriter.create<mlir::LLVM::InsertValueOp>(loc, desc, field,
+                                                          pos);
+      descs = rewriter.create<mlir::LLVM::InsertValueOp>(loc, descs, desc, i);
+    }
+    rewriter.create<mlir::LLVM::StoreOp>(loc, descs, descsPtr);
 
-    for (auto i : llvm::seq(0u, eventsCount)) {
-      mlir::Value evt =
-          rewriter.create<mlir::LLVM::UndefOp>(loc, llvmEventType);
-      evt = rewriter.create<mlir::LLVM::InsertValueOp>(loc, evt, events[i], 0);
-      eventsArray =
-          rewriter.create<mlir::LLVM::InsertValueOp>(loc, eventsArray, evt, i);
+    auto stream = firstAdaptor.getGpuxStream();
+    auto count = rewriter.create<mlir::LLVM::ConstantOp>(
+        loc, llvmIndexType,
+        rewriter.getIntegerAttr(llvmIndexType, batch.size()));
+    auto noEvents = rewriter.create<mlir::LLVM::ZeroOp>(loc, llvmPointerType);
+    launchKernelsCallBuilder.create(loc, rewriter,
+                                    {stream, descsPtr, count, noEvents});
+    waitCallBuilder.create(loc, rewriter, stream);
+    for (auto launchOp : batch)
+      rewriter.eraseOp(launchOp);
+    return mlir::success();
+  }
+
+  mlir::LogicalResult
+  matchAndRewrite(imex::gpux::LaunchFuncOp launchOp, OpAdaptor adaptor,
+                  mlir::ConversionPatternRewriter &rewriter) const override {
+    mlir::Location loc = launchOp.getLoc();
+
+    if (batchKernelLaunches) {
+      auto batch = getLaunchBatch(launchOp);
+      if (batch.size() > 1)
+        return lowerLaunchBatch(batch, adaptor, rewriter);
     }
 
-    auto nullEvent = [&]() {
-      auto nullPtr = rewriter.create<mlir::LLVM::ZeroOp>(loc, llvmPointerType);
-      mlir::Value evt =
-          rewriter.create<mlir::LLVM::UndefOp>(loc, llvmEventType);
-      return rewriter.create<mlir::LLVM::InsertValueOp>(loc, evt, nullPtr, 0);
-    }();
+    auto kernel = getKernel(launchOp, adaptor, rewriter);
+    if (mlir::failed(kernel))
+      return mlir::failure();
 
-    eventsArray = rewriter.create<mlir::LLVM::InsertValueOp>(
-        loc, eventsArray, nullEvent, eventsCount);
-    rewriter.create<mlir::LLVM::StoreOp>(loc, eventsArray, eventsArrayPtr);
+    if (packedKernelArgs)
+      return lowerPackedLaunch(launchOp, adaptor, rewriter, *kernel);
+
+    imex::AllocaInsertionPoint allocaHelper(launchOp);
+    auto paramsArrayPtr =
+        createParamsArray(launchOp, adaptor, rewriter, allocaHelper);
+
+    /////////////////////////////////////////////////////////////////////
+    // Create an array of struct containing all events and pass it to the
+    // Runtime wrapper Kernel launch call.
+    auto eventsArrayPtr = createEventsArray(loc, rewriter, allocaHelper,
+                                            adaptor.getAsyncDependencies());
 
     /////////////////////////////////////////////////////////////////////////
 
@@ -681,8 +1620,8 @@ private:
 
     auto event = launchKernelCallBuilder.create(
         loc, rewriter,
-        {adaptor.getGpuxStream(), function->getResult(0),
-         adaptor.getGridSizeX(), adaptor.getGridSizeY(), adaptor.getGridSizeZ(),
+        {adaptor.getGpuxStream(), *kernel, adaptor.getGridSizeX(),
+         adaptor.getGridSizeY(), adaptor.getGridSizeZ(),
          adaptor.getBlockSizeX(), adaptor.getBlockSizeY(),
          adaptor.getBlockSizeZ(), dynamicSharedMemorySize, paramsArrayVoidPtr,
          eventsArrayPtr});
@@ -718,14 +1657,100 @@ public:
   }
 };
 
+/// A rewrite pattern to convert gpux.graph operations into a pair of GPU
+/// runtime calls around the inlined body of the region:
+///
+/// * gpuGraphBegin -- starts recording or replaying the graph identified by
+///                    the address of a module global unique to the op
+/// * gpuGraphEnd   -- submits the graph and waits for it
+class ConvertGraphOpToGpuRuntimeCallPattern
+    : public ConvertOpToGpuRuntimeCallPattern<imex::gpux::GraphOp> {
+public:
+  ConvertGraphOpToGpuRuntimeCallPattern(mlir::LLVMTypeConverter &converter)
+      : ConvertOpToGpuRuntimeCallPattern<imex::gpux::GraphOp>(converter) {}
+
+private:
+  mlir::LogicalResult
+  matchAndRewrite(imex::gpux::GraphOp op, imex::gpux::GraphOp::Adaptor adaptor,
+                  mlir::ConversionPatternRewriter &rewriter) const override {
+    auto mod = op->getParentOfType<mlir::ModuleOp>();
+    if (!mod)
+      return mlir::failure();
+
+    auto loc = op.getLoc();
+    std::string name;
+    unsigned index = 0;
+    do {
+      name = "gpux_graph_id_" + std::to_string(index++);
+    } while (mod.lookupSymbol(name));
+
+    mlir::LLVM::GlobalOp global;
+    {
+      mlir::OpBuilder::InsertionGuard guard(rewriter);
+      rewriter.setInsertionPointToStart(mod.getBody());
+      global = rewriter.create<mlir::LLVM::GlobalOp>(
+          loc, rewriter.getI8Type(), /*isConstant=*/true,
+          mlir::LLVM::Linkage::Internal, name, rewriter.getI8IntegerAttr(0));
+    }
+    auto id = rewriter.create<mlir::LLVM::AddressOfOp>(loc, global);
+
+    auto stream = adaptor.getGpuxStream();
+    graphBeginCallBuilder.create(loc, rewriter, {stream, id});
+    rewriter.inlineBlockBefore(op.getBody(), op);
+    graphEndCallBuilder.create(loc, rewriter, {stream});
+    rewriter.eraseOp(op);
+    return mlir::success();
+  }
+};
+
+/// A rewrite pattern to convert gpux.substream operations into a GPU runtime
+/// call.
+class ConvertSubstreamOpToGpuRuntimeCallPattern
+    : public ConvertOpToGpuRuntimeCallPattern<imex::gpux::SubstreamOp> {
+public:
+  ConvertSubstreamOpToGpuRuntimeCallPattern(
+      mlir::LLVMTypeConverter &converter)
+      : ConvertOpToGpuRuntimeCallPattern<imex::gpux::SubstreamOp>(converter) {}
+
+private:
+  mlir::LogicalResult
+  matchAndRewrite(imex::gpux::SubstreamOp op, OpAdaptor adaptor,
+                  mlir::ConversionPatternRewriter &rewriter) const override {
+    auto loc = op.getLoc();
+    auto index = rewriter.create<mlir::LLVM::ConstantOp>(
+        loc, llvmInt64Type,
+        rewriter.getI64IntegerAttr(static_cast<int64_t>(op.getIndex())));
+    auto res = streamGetSubstreamCallBuilder.create(
+        loc, rewriter, {adaptor.getGpuxStream(), index});
+    rewriter.replaceOp(op, res.getResults());
+    return mlir::success();
+  }
+};
+
+static constexpr const char *kModuleStreamName = "gpux_module_stream";
+static constexpr const char *kModuleStreamGetterName = "gpux_get_module_stream";
+static constexpr const char *kModuleStreamDtorName =
+    "gpux_destroy_module_stream";
+
 /// A rewrite pattern to convert gpux.create_stream operations into a GPU
 /// runtime call.
+///
+/// With module streams enabled, the stream is instead created once per module
+/// on first use and kept in a module global, so that functions called many
+/// times do not pay for the runtime initialization on every call. The stream
+/// is destroyed by a global destructor of the module.
+///
+/// With a stream getter, the stream is returned by a call to the function of
+/// that name, defined by the embedder of the module.
 class ConvertGpuStreamCreatePattern
     : public ConvertOpToGpuRuntimeCallPattern<imex::gpux::CreateStreamOp> {
 public:
-  ConvertGpuStreamCreatePattern(mlir::LLVMTypeConverter &converter)
+  ConvertGpuStreamCreatePattern(mlir::LLVMTypeConverter &converter,
+                                bool moduleStreams,
+                                llvm::StringRef streamGetter)
       : ConvertOpToGpuRuntimeCallPattern<imex::gpux::CreateStreamOp>(
-            converter) {}
+            converter),
+        moduleStreams(moduleStreams), streamGetter(streamGetter) {}
 
 private:
   mlir::LogicalResult
@@ -738,6 +1763,20 @@ private:
 
     auto loc = op.getLoc();
 
+    if (!streamGetter.empty()) {
+      FunctionCallBuilder getterCallBuilder(streamGetter, llvmPointerType, {});
+      auto res = getterCallBuilder.create(loc, rewriter, {});
+      rewriter.replaceOp(op, res.getResults());
+      return mlir::success();
+    }
+
+    if (moduleStreams) {
+      auto getter = getModuleStreamGetter(mod, loc, rewriter);
+      rewriter.replaceOpWithNewOp<mlir::LLVM::CallOp>(op, getter,
+                                                      mlir::ValueRange{});
+      return mlir::success();
+    }
+
     // TODO: Pass nullptrs now for the current workflow where user is
     // not passing device and context. Add different streambuilders
     // later.
@@ -747,35 +1786,167 @@ private:
     rewriter.replaceOp(op, res.getResults());
     return mlir::success();
   }
+
+  // Returns the function returning the module stream, creating it together
+  // with the stream global and its destructor if needed. Concurrent first
+  // calls may both create a stream; the one that loses the compare-exchange
+  // destroys its stream again.
+  mlir::LLVM::LLVMFuncOp
+  getModuleStreamGetter(mlir::ModuleOp mod, mlir::Location loc,
+                        mlir::ConversionPatternRewriter &rewriter) const {
+    if (auto getter =
+            mod.lookupSymbol<mlir::LLVM::LLVMFuncOp>(kModuleStreamGetterName))
+      return getter;
+
+    mlir::OpBuilder::InsertionGuard guard(rewriter);
+    rewriter.setInsertionPointToStart(mod.getBody());
+    auto global = rewriter.create<mlir::LLVM::GlobalOp>(
+        loc, llvmPointerType, /*isConstant=*/false,
+        mlir::LLVM::Linkage::Internal, kModuleStreamName, mlir::Attribute());
+    rewriter.createBlock(&global.getInitializerRegion());
+    rewriter.create<mlir::LLVM::ReturnOp>(
+        loc, rewriter.create<mlir::LLVM::ZeroOp>(loc, llvmPointerType)
+                 .getResult());
+
+    auto alignment = getTypeConverter()->getPointerBitwidth(0) / 8;
+
+    // llvm.func internal @gpux_get_module_stream() -> !llvm.ptr
+    rewriter.setInsertionPointAfter(global);
+    auto getter = rewriter.create<mlir::LLVM::LLVMFuncOp>(
+        loc, kModuleStreamGetterName,
+        mlir::LLVM::LLVMFunctionType::get(llvmPointerType, {}),
+        mlir::LLVM::Linkage::Internal);
+    auto &body = getter.getBody();
+    auto *entry = rewriter.createBlock(&body);
+    auto *done = rewriter.createBlock(&body, body.end(), {llvmPointerType},
+                                      {loc});
+    auto *race = rewriter.createBlock(done);
+    auto *create = rewriter.createBlock(race);
+
+    rewriter.setInsertionPointToStart(entry);
+    auto addr = rewriter.create<mlir::LLVM::AddressOfOp>(loc, global);
+    auto stream =
+        rewriter.create<mlir::LLVM::LoadOp>(loc, llvmPointerType, addr);
+    stream.setOrdering(mlir::LLVM::AtomicOrdering::acquire);
+    stream.setAlignment(alignment);
+    auto null = rewriter.create<mlir::LLVM::ZeroOp>(loc, llvmPointerType);
+    auto isNull = rewriter.create<mlir::LLVM::ICmpOp>(
+        loc, mlir::LLVM::ICmpPredicate::eq, stream, null);
+    rewriter.create<mlir::LLVM::CondBrOp>(loc, isNull, create,
+                                          mlir::ValueRange{}, done,
+                                          mlir::ValueRange{stream});
+
+    rewriter.setInsertionPointToStart(create);
+    mlir::Value newStream =
+        streamCreateCallBuilder.create(loc, rewriter, {null, null})
+            ->getResult(0);
+    auto exchange = rewriter.create<mlir::LLVM::AtomicCmpXchgOp>(
+        loc, addr, null, newStream, mlir::LLVM::AtomicOrdering::acq_rel,
+        mlir::LLVM::AtomicOrdering::acquire);
+    auto existing = rewriter.create<mlir::LLVM::ExtractValueOp>(loc, exchange,
+                                                                0);
+    auto stored = rewriter.create<mlir::LLVM::ExtractValueOp>(loc, exchange, 1);
+    rewriter.create<mlir::LLVM::CondBrOp>(loc, stored, done,
+                                          mlir::ValueRange{newStream}, race,
+                                          mlir::ValueRange{});
+
+    rewriter.setInsertionPointToStart(race);
+    streamDestroyCallBuilder.create(loc, rewriter, {newStream});
+    rewriter.create<mlir::LLVM::BrOp>(loc, mlir::ValueRange{existing}, done);
+
+    rewriter.setInsertionPointToStart(done);
+    rewriter.create<mlir::LLVM::ReturnOp>(loc, done->getArgument(0));
+
+    // llvm.func internal @gpux_destroy_module_stream()
+    rewriter.setInsertionPointAfter(getter);
+    auto dtor = rewriter.create<mlir::LLVM::LLVMFuncOp>(
+        loc, kModuleStreamDtorName,
+        mlir::LLVM::LLVMFunctionType::get(llvmVoidType, {}),
+        mlir::LLVM::Linkage::Internal);
+    auto &dtorBody = dtor.getBody();
+    entry = rewriter.createBlock(&dtorBody);
+    done = rewriter.createBlock(&dtorBody, dtorBody.end());
+    auto *destroy = rewriter.createBlock(done);
+
+    rewriter.setInsertionPointToStart(entry);
+    addr = rewriter.create<mlir::LLVM::AddressOfOp>(loc, global);
+    stream = rewriter.create<mlir::LLVM::LoadOp>(loc, llvmPointerType, addr);
+    null = rewriter.create<mlir::LLVM::ZeroOp>(loc, llvmPointerType);
+    isNull = rewriter.create<mlir::LLVM::ICmpOp>(
+        loc, mlir::LLVM::ICmpPredicate::eq, stream, null);
+    rewriter.create<mlir::LLVM::CondBrOp>(loc, isNull, done, destroy);
+
+    rewriter.setInsertionPointToStart(destroy);
+    streamDestroyCallBuilder.create(loc, rewriter, {stream});
+    rewriter.create<mlir::LLVM::StoreOp>(loc, null, addr);
+    rewriter.create<mlir::LLVM::BrOp>(loc, done);
+
+    rewriter.setInsertionPointToStart(done);
+    rewriter.create<mlir::LLVM::ReturnOp>(loc, mlir::ValueRange{});
+
+    // Register the destructor, keeping the ones already in the module.
+    llvm::SmallVector<mlir::Attribute> dtors;
+    llvm::SmallVector<int32_t> priorities;
+    for (auto op : llvm::make_early_inc_range(
+             mod.getOps<mlir::LLVM::GlobalDtorsOp>())) {
+      llvm::append_range(dtors, op.getDtors());
+      for (auto priority : op.getPriorities())
+        priorities.push_back(
+            mlir::cast<mlir::IntegerAttr>(priority).getInt());
+      rewriter.eraseOp(op);
+    }
+    dtors.push_back(mlir::FlatSymbolRefAttr::get(dtor));
+    priorities.push_back(65535);
+    rewriter.setInsertionPointAfter(dtor);
+    auto dtorsAttr = rewriter.getArrayAttr(dtors);
+    auto prioritiesAttr = rewriter.getI32ArrayAttr(priorities);
+    rewriter.create<mlir::LLVM::GlobalDtorsOp>(loc, dtorsAttr, prioritiesAttr);
+    return getter;
+  }
+
+  bool moduleStreams;
+  std::string streamGetter;
 };
 
 /// A rewrite pattern to convert gpux.destroy_stream operations into a GPU
-/// runtime call.
+/// runtime call. Module streams live until the module is destroyed and
+/// streams of a stream getter belong to the embedder, so with either enabled
+/// the op is removed.
 class ConvertGpuStreamDestroyPattern
     : public ConvertOpToGpuRuntimeCallPattern<imex::gpux::DestroyStreamOp> {
 public:
-  ConvertGpuStreamDestroyPattern(mlir::LLVMTypeConverter &converter)
+  ConvertGpuStreamDestroyPattern(mlir::LLVMTypeConverter &converter,
+                                 bool moduleStreams,
+                                 llvm::StringRef streamGetter)
       : ConvertOpToGpuRuntimeCallPattern<imex::gpux::DestroyStreamOp>(
-            converter) {}
+            converter),
+        moduleStreams(moduleStreams || !streamGetter.empty()) {}
 
 private:
   mlir::LogicalResult
   matchAndRewrite(imex::gpux::DestroyStreamOp op,
                   imex::gpux::DestroyStreamOp::Adaptor adaptor,
                   mlir::ConversionPatternRewriter &rewriter) const override {
+    if (moduleStreams) {
+      rewriter.eraseOp(op);
+      return mlir::success();
+    }
+
     auto loc = op.getLoc();
     auto res =
         streamDestroyCallBuilder.create(loc, rewriter, adaptor.getGpuxStream());
     rewriter.replaceOp(op, res.getResults());
     return mlir::success();
   }
+
+  bool moduleStreams;
 };
 } // namespace
 
 class GPUXToLLVMPass
     : public imex::impl::ConvertGPUXToLLVMBase<GPUXToLLVMPass> {
 public:
-  explicit GPUXToLLVMPass() {}
+  using ConvertGPUXToLLVMBase::ConvertGPUXToLLVMBase;
   void runOnOperation() override;
 };
 
@@ -787,7 +1958,11 @@ void GPUXToLLVMPass::runOnOperation() {
 
   mlir::populateGpuToLLVMConversionPatterns(converter, patterns);
 
-  imex::populateGpuxToLLVMPatternsAndLegality(converter, patterns, target);
+  imex::populateGpuxToLLVMPatternsAndLegality(converter, patterns, target,
+                                              moduleStreams, packedKernelArgs,
+                                              batchKernelLaunches,
+                                              allocSiteTags, preloadModules,
+                                              streamGetter);
 
   if (mlir::failed(mlir::applyPartialConversion(getOperation(), target,
                                                 std::move(patterns))))
@@ -796,7 +1971,9 @@ void GPUXToLLVMPass::runOnOperation() {
 
 void imex::populateGpuxToLLVMPatternsAndLegality(
     mlir::LLVMTypeConverter &converter, mlir::RewritePatternSet &patterns,
-    mlir::ConversionTarget &target) {
+    mlir::ConversionTarget &target, bool moduleStreams, bool packedKernelArgs,
+    bool batchKernelLaunches, bool allocSiteTags, bool preloadModules,
+    llvm::StringRef streamGetter) {
   auto context = patterns.getContext();
   auto llvmPointerType = mlir::LLVM::LLVMPointerType::get(context);
   converter.addConversion(
@@ -818,17 +1995,24 @@ void imex::populateGpuxToLLVMPatternsAndLegality(
 
   patterns.insert<
       // clang-format off
-      ConvertGpuStreamCreatePattern,
-      ConvertGpuStreamDestroyPattern,
-      ConvertAllocOpToGpuRuntimeCallPattern,
       ConvertDeallocOpToGpuRuntimeCallPattern,
       RemoveGPUModulePattern,
-      ConvertMemcpyOpToGpuRuntimeCallPattern
+      ConvertMemcpyOpToGpuRuntimeCallPattern,
+      ConvertMemsetOpToGpuRuntimeCallPattern,
+      ConvertPrefetchOpToGpuRuntimeCallPattern,
+      ConvertMemAdviseOpToGpuRuntimeCallPattern,
+      ConvertWaitOpToGpuRuntimeCallPattern,
+      ConvertGraphOpToGpuRuntimeCallPattern,
+      ConvertSubstreamOpToGpuRuntimeCallPattern
       // clang-format on
       >(converter);
 
+  patterns.add<ConvertGpuStreamCreatePattern, ConvertGpuStreamDestroyPattern>(
+      converter, moduleStreams, streamGetter);
+  patterns.add<ConvertAllocOpToGpuRuntimeCallPattern>(converter, allocSiteTags);
   patterns.add<ConvertLaunchFuncOpToGpuRuntimeCallPattern>(
-      converter, imex::gpuBinaryAttrName);
+      converter, imex::gpuBinaryAttrName, packedKernelArgs,
+      batchKernelLaunches, preloadModules);
 
   target.addIllegalDialect<mlir::gpu::GPUDialect>();
   target.addIllegalDialect<imex::gpux::GPUXDialect>();
@@ -838,3 +2022,8 @@ std::unique_ptr<::mlir::OperationPass<::mlir::ModuleOp>>
 imex::createConvertGPUXToLLVMPass() {
   return std::make_unique<GPUXToLLVMPass>();
 }
+
+std::unique_ptr<::mlir::OperationPass<::mlir::ModuleOp>>
+imex::createConvertGPUXToLLVMPass(const ConvertGPUXToLLVMOptions &options) {
+  return std::make_unique<GPUXToLLVMPass>(options);
+}
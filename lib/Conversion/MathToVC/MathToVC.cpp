@@ -47,12 +47,28 @@ template <typename MOp> std::string getVCIntrinsicName() {
   constexpr bool isFloorOp = std::is_same_v<MOp, math::FloorOp>;
   constexpr bool isExpOp = std::is_same_v<MOp, math::ExpOp>;
   constexpr bool isExp2Op = std::is_same_v<MOp, math::Exp2Op>;
+  constexpr bool isLogOp = std::is_same_v<MOp, math::LogOp>;
+  constexpr bool isLog2Op = std::is_same_v<MOp, math::Log2Op>;
+  constexpr bool isSqrtOp = std::is_same_v<MOp, math::SqrtOp>;
+  constexpr bool isRsqrtOp = std::is_same_v<MOp, math::RsqrtOp>;
+  constexpr bool isSinOp = std::is_same_v<MOp, math::SinOp>;
+  constexpr bool isCosOp = std::is_same_v<MOp, math::CosOp>;
   if (isCeilOp)
     return "llvm.genx.rndu.";
   else if (isFloorOp)
     return "llvm.genx.rndd.";
   else if (isExpOp || isExp2Op)
     return "llvm.genx.exp.";
+  else if (isLogOp || isLog2Op)
+    return "llvm.genx.log.";
+  else if (isSqrtOp)
+    return "llvm.genx.sqrt.";
+  else if (isRsqrtOp)
+    return "llvm.genx.rsqrt.";
+  else if (isSinOp)
+    return "llvm.genx.sin.";
+  else if (isCosOp)
+    return "llvm.genx.cos.";
   else
     assert(0 && "Unsupported math Op. Add more support!");
 }
@@ -109,6 +125,69 @@ SmallVector<Value> convertFloatArgsType(SmallVector<Value> args,
   }
   return newArgs;
 }
+
+// Returns the type the math operations of vecTy are computed in: f32 for bf16,
+// which has no native math, and for f16 if
+// enableHighPrecisionInterimCalculation is set, vecTy otherwise.
+VectorType getInterimType(VectorType vecTy,
+                          bool enableHighPrecisionInterimCalculation) {
+  auto elementType = vecTy.getElementType();
+  if (elementType.isBF16() ||
+      (enableHighPrecisionInterimCalculation && elementType.isF16()))
+    return VectorType::get(vecTy.getShape(),
+                           Float32Type::get(vecTy.getContext()));
+  return vecTy;
+}
+
+// Creates a constant vector of vecTy with all elements set to value
+Value createConstantVector(ConversionPatternRewriter &rewriter, Location loc,
+                           VectorType vecTy, double value) {
+  auto vecAttr = DenseElementsAttr::get(
+      vecTy, rewriter.getFloatAttr(vecTy.getElementType(), value));
+  return rewriter.create<arith::ConstantOp>(loc, vecTy, vecAttr);
+}
+
+// Evaluates the polynomial with coefficients coeffs, in increasing degree
+// order, at x using Horner's scheme
+Value createPolynomial(ConversionPatternRewriter &rewriter, Location loc,
+                       VectorType vecTy, Value x, ArrayRef<double> coeffs) {
+  Value result = createConstantVector(rewriter, loc, vecTy, coeffs.back());
+  for (auto coeff : llvm::reverse(coeffs.drop_back())) {
+    auto mul = rewriter.create<arith::MulFOp>(loc, result, x);
+    result = rewriter.create<arith::AddFOp>(
+        loc, mul, createConstantVector(rewriter, loc, vecTy, coeff));
+  }
+  return result;
+}
+
+// Creates a call to the VC intrinsic funcName for vecTy
+Value createVCIntrinsicCall(ConversionPatternRewriter &rewriter, Location loc,
+                            std::string funcName, VectorType vecTy,
+                            ValueRange args) {
+  funcName += encodeVectorType(rewriter, vecTy, false, false, true).first;
+  auto callOp = createFuncCall(rewriter, loc, funcName, {vecTy}, args, false);
+  return callOp.getResult(0);
+}
+
+// Creates the base e exponentiation of x, "llvm.genx.exp" returns the base 2
+// exponentiation of its input
+Value createExp(ConversionPatternRewriter &rewriter, Location loc,
+                VectorType vecTy, Value x) {
+  auto log2e = createConstantVector(rewriter, loc, vecTy, 1.442695040888963);
+  auto scaled = rewriter.create<arith::MulFOp>(loc, x, log2e);
+  return createVCIntrinsicCall(rewriter, loc, "llvm.genx.exp.", vecTy,
+                               {scaled});
+}
+
+// Returns value with the sign of x
+Value createCopySign(ConversionPatternRewriter &rewriter, Location loc,
+                     VectorType vecTy, Value value, Value x) {
+  auto zero = createConstantVector(rewriter, loc, vecTy, 0.0);
+  auto isNegative =
+      rewriter.create<arith::CmpFOp>(loc, arith::CmpFPredicate::OLT, x, zero);
+  auto negated = rewriter.create<arith::NegFOp>(loc, value);
+  return rewriter.create<arith::SelectOp>(loc, isNegative, negated, value);
+}
 //===----------------------------------------------------------------------===//
 // Operation conversion
 //===----------------------------------------------------------------------===//
@@ -244,6 +323,139 @@ private:
   const bool enableHighPrecisionInterimCalculation;
 };
 
+// Base of the patterns of math ops computed with VC intrinsics and arith ops
+// in the interim type of getInterimType. Only ops of 1-D vectors of f16, bf16
+// and f32 are converted.
+template <typename MOp>
+struct InterimMathOpPattern : public OpConversionPattern<MOp> {
+  InterimMathOpPattern(const TypeConverter &converter, MLIRContext *ctx,
+                       bool enableHighPrecisionInterimCalculation)
+      : OpConversionPattern<MOp>(converter, ctx),
+        enableHighPrecisionInterimCalculation(
+            enableHighPrecisionInterimCalculation) {}
+  LogicalResult
+  matchAndRewrite(MOp op, typename MOp::Adaptor adaptor,
+                  ConversionPatternRewriter &rewriter) const override {
+    auto *converter = this->getTypeConverter();
+    auto vecTy = dyn_cast<VectorType>(converter->convertType(op.getType()));
+    if (!vecTy || vecTy.getRank() != 1 ||
+        vecTy.getElementType().getIntOrFloatBitWidth() > 32)
+      return failure();
+
+    auto loc = op.getLoc();
+    auto interimTy =
+        getInterimType(vecTy, this->enableHighPrecisionInterimCalculation);
+    auto input = convertFloatArgsType({adaptor.getOperand()},
+                                      interimTy.getElementType(), rewriter);
+    auto result = compute(rewriter, loc, interimTy, input[0]);
+    auto originalResult =
+        convertFloatArgsType({result}, vecTy.getElementType(), rewriter);
+    rewriter.replaceOp(op, originalResult);
+    return success();
+  }
+
+  // Computes the op on x of vecTy
+  virtual Value compute(ConversionPatternRewriter &rewriter, Location loc,
+                        VectorType vecTy, Value x) const = 0;
+
+private:
+  const bool enableHighPrecisionInterimCalculation;
+};
+
+// Math ops with a native VC intrinsic: sqrt, rsqrt, sin, cos, log2 and log,
+// computed as log2(x) * ln(2)
+template <typename MOp>
+struct NativeMathOpPattern final : public InterimMathOpPattern<MOp> {
+  using InterimMathOpPattern<MOp>::InterimMathOpPattern;
+  Value compute(ConversionPatternRewriter &rewriter, Location loc,
+                VectorType vecTy, Value x) const override {
+    auto result = createVCIntrinsicCall(
+        rewriter, loc, getVCIntrinsicName<MOp>(), vecTy, {x});
+    if (std::is_same_v<MOp, math::LogOp>) {
+      auto ln2 = createConstantVector(rewriter, loc, vecTy, 0.6931471805599453);
+      result = rewriter.create<arith::MulFOp>(loc, result, ln2);
+    }
+    return result;
+  }
+};
+
+// TanhOp conversion pattern. For |x| < 0.5, tanh(x) is computed with its
+// Taylor series, else as 1 - 2 / (exp(2|x|) + 1) with the sign of x. With f32,
+// the error is within 3 ulp in addition to the error of "llvm.genx.exp".
+struct TanhOpPattern final : public InterimMathOpPattern<math::TanhOp> {
+  using InterimMathOpPattern<math::TanhOp>::InterimMathOpPattern;
+  Value compute(ConversionPatternRewriter &rewriter, Location loc,
+                VectorType vecTy, Value x) const override {
+    auto absX = rewriter.create<math::AbsFOp>(loc, x);
+    auto x2 = rewriter.create<arith::MulFOp>(loc, x, x);
+    auto poly = createPolynomial(rewriter, loc, vecTy, x2,
+                                 {-1.0 / 3, 2.0 / 15, -17.0 / 315, 62.0 / 2835,
+                                  -1382.0 / 155925, 21844.0 / 6081075});
+    auto x3 = rewriter.create<arith::MulFOp>(loc, x, x2);
+    auto small = rewriter.create<arith::AddFOp>(
+        loc, x, rewriter.create<arith::MulFOp>(loc, x3, poly));
+
+    auto one = createConstantVector(rewriter, loc, vecTy, 1.0);
+    auto two = createConstantVector(rewriter, loc, vecTy, 2.0);
+    auto exp = createExp(rewriter, loc, vecTy,
+                         rewriter.create<arith::MulFOp>(loc, absX, two));
+    auto div = rewriter.create<arith::DivFOp>(
+        loc, two, rewriter.create<arith::AddFOp>(loc, exp, one));
+    auto large = createCopySign(rewriter, loc, vecTy,
+                                rewriter.create<arith::SubFOp>(loc, one, div),
+                                x);
+
+    auto isSmall = rewriter.create<arith::CmpFOp>(
+        loc, arith::CmpFPredicate::OLT, absX,
+        createConstantVector(rewriter, loc, vecTy, 0.5));
+    return rewriter.create<arith::SelectOp>(loc, isSmall, small, large);
+  }
+};
+
+// ErfOp conversion pattern. For |x| < 0.5, erf(x) is computed with its Taylor
+// series, else as 1 - erfc(|x|) with the sign of x, where erfc is the
+// Chebyshev approximation of Numerical Recipes (erfcc), whose fractional error
+// is below 1.2e-7. With f32, the error is within 3 ulp in addition to the
+// error of "llvm.genx.exp".
+struct ErfOpPattern final : public InterimMathOpPattern<math::ErfOp> {
+  using InterimMathOpPattern<math::ErfOp>::InterimMathOpPattern;
+  Value compute(ConversionPatternRewriter &rewriter, Location loc,
+                VectorType vecTy, Value x) const override {
+    auto absX = rewriter.create<math::AbsFOp>(loc, x);
+    auto x2 = rewriter.create<arith::MulFOp>(loc, x, x);
+    // 2 / sqrt(pi) * (-1)^n / (n! * (2n + 1))
+    auto poly = createPolynomial(
+        rewriter, loc, vecTy, x2,
+        {1.1283791670955126, -0.3761263890318375, 0.11283791670955126,
+         -0.02686617064513125, 0.005223977625442188, -8.548327023450852e-4});
+    auto small = rewriter.create<arith::MulFOp>(loc, x, poly);
+
+    auto one = createConstantVector(rewriter, loc, vecTy, 1.0);
+    auto two = createConstantVector(rewriter, loc, vecTy, 2.0);
+    auto t = rewriter.create<arith::DivFOp>(
+        loc, two, rewriter.create<arith::AddFOp>(loc, two, absX));
+    auto tPoly = createPolynomial(
+        rewriter, loc, vecTy, t,
+        {1.00002368, 0.37409196, 0.09678418, -0.18628806, 0.27886807,
+         -1.13520398, 1.48851587, -0.82215223, 0.17087277});
+    auto negX2 = rewriter.create<arith::NegFOp>(loc, x2);
+    auto c0 = createConstantVector(rewriter, loc, vecTy, -1.26551223);
+    auto arg = rewriter.create<arith::AddFOp>(
+        loc, rewriter.create<arith::AddFOp>(loc, negX2, c0),
+        rewriter.create<arith::MulFOp>(loc, t, tPoly));
+    auto erfc = rewriter.create<arith::MulFOp>(
+        loc, t, createExp(rewriter, loc, vecTy, arg));
+    auto large = createCopySign(rewriter, loc, vecTy,
+                                rewriter.create<arith::SubFOp>(loc, one, erfc),
+                                x);
+
+    auto isSmall = rewriter.create<arith::CmpFOp>(
+        loc, arith::CmpFPredicate::OLT, absX,
+        createConstantVector(rewriter, loc, vecTy, 0.5));
+    return rewriter.create<arith::SelectOp>(loc, isSmall, small, large);
+  }
+};
+
 } // namespace
 
 //===----------------------------------------------------------------------===//
@@ -260,6 +472,14 @@ void imex::populateMathToVCPatterns(
   patterns.add<ExpOpPattern<math::ExpOp>, ExpOpPattern<math::Exp2Op>>(
       typeConverter, patterns.getContext(),
       enableHighPrecisionInterimCalculation);
+  patterns.add<NativeMathOpPattern<math::LogOp>,
+               NativeMathOpPattern<math::Log2Op>,
+               NativeMathOpPattern<math::SqrtOp>,
+               NativeMathOpPattern<math::RsqrtOp>,
+               NativeMathOpPattern<math::SinOp>,
+               NativeMathOpPattern<math::CosOp>, TanhOpPattern, ErfOpPattern>(
+      typeConverter, patterns.getContext(),
+      enableHighPrecisionInterimCalculation);
 }
 
 //===----------------------------------------------------------------------===//
@@ -274,6 +494,14 @@ void imex::configureMathToVCConversionLegality(
     auto vecTy = dyn_cast<VectorType>(op->getResult(0).getType());
     return !vecTy;
   });
+  // The other math ops are converted if they are working on vectors of f16,
+  // bf16 or f32
+  target.addDynamicallyLegalOp<math::LogOp, math::Log2Op, math::SqrtOp,
+                               math::RsqrtOp, math::SinOp, math::CosOp,
+                               math::TanhOp, math::ErfOp>([&](Operation *op) {
+    auto vecTy = dyn_cast<VectorType>(op->getResult(0).getType());
+    return !vecTy || vecTy.getElementType().getIntOrFloatBitWidth() > 32;
+  });
 }
 
 //===----------------------------------------------------------------------===//
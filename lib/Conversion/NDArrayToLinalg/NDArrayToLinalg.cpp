@@ -37,6 +37,7 @@
 #include <mlir/Dialect/Bufferization/IR/Bufferization.h>
 #include <mlir/Dialect/Func/IR/FuncOps.h>
 #include <mlir/Dialect/Func/Transforms/FuncConversions.h>
+#include <mlir/Dialect/GPU/IR/GPUDialect.h>
 #include <mlir/Dialect/LLVMIR/LLVMDialect.h>
 #include <mlir/Dialect/Linalg/IR/Linalg.h>
 #include <mlir/Dialect/Linalg/Utils/Utils.h>
@@ -45,6 +46,7 @@
 #include <mlir/Dialect/Shape/IR/Shape.h>
 #include <mlir/Dialect/Tensor/IR/Tensor.h>
 #include <mlir/Dialect/Tosa/IR/TosaOps.h>
+#include <mlir/Dialect/Utils/ReshapeOpsUtils.h>
 #include <mlir/Pass/Pass.h>
 
 #include <optional>
@@ -293,6 +295,48 @@ struct LoadOpLowering
   }
 };
 
+/// Copy the tensor src into the slice of the tensor dst, in place.
+/// 0d sources get broadcasted to the slice.
+static void
+createInsertSlice(::mlir::Location loc, ::mlir::OpBuilder &builder,
+                  ::imex::ndarray::NDArrayType srcArType,
+                  ::imex::ndarray::NDArrayType dstArType, ::mlir::Value src,
+                  ::mlir::Value dst,
+                  ::mlir::ArrayRef<::mlir::OpFoldResult> slcOffs,
+                  ::mlir::ArrayRef<::mlir::OpFoldResult> slcSizes,
+                  ::mlir::ArrayRef<::mlir::OpFoldResult> slcStrides) {
+  auto srcMRTyp = srcArType.getMemRefType(src);
+  auto dstMRTyp = dstArType.getMemRefType(dst);
+  mlir::Value srcMR = createToMemRef(loc, builder, src, srcMRTyp);
+  auto dstMR = createToMemRef(loc, builder, dst, dstMRTyp);
+
+  auto view = builder.create<::mlir::memref::SubViewOp>(
+      loc, dstMR, slcOffs, slcSizes, slcStrides);
+
+  auto srcRank = srcMRTyp.getRank();
+  auto dstRank = dstMRTyp.getRank();
+  // FIXME properly handle broadcasting
+  if (srcRank == 0) {
+    // emit a loop that broadcasts a scalar to dst shape
+    // construct broadcasting affine map; srcRank==0 case is simple
+    auto srcMap =
+        ::mlir::AffineMap::get(dstRank, srcRank, {}, builder.getContext());
+    auto dstMap = builder.getMultiDimIdentityMap(dstRank);
+    ::mlir::SmallVector<mlir::utils::IteratorType> iterators(
+        dstRank, ::mlir::utils::IteratorType::parallel);
+    (void)builder.create<::mlir::linalg::GenericOp>(
+        loc, srcMR, view.getResult(), ::mlir::ArrayRef({srcMap, dstMap}),
+        iterators,
+        [](::mlir::OpBuilder &b, ::mlir::Location loc,
+           ::mlir::ValueRange args) {
+          b.create<::mlir::linalg::YieldOp>(loc, args.front());
+        });
+    return;
+  }
+
+  (void)builder.create<::mlir::memref::CopyOp>(loc, srcMR, view);
+}
+
 /// Convert NDArray's insert_slice to memref
 struct InsertSliceLowering
     : public ::mlir::OpConversionPattern<::imex::ndarray::InsertSliceOp> {
@@ -317,11 +361,6 @@ struct InsertSliceLowering
     auto dstArType =
         mlir::cast<imex::ndarray::NDArrayType>(op.getDestination().getType());
 
-    auto srcMRTyp = srcArType.getMemRefType(src);
-    auto dstMRTyp = dstArType.getMemRefType(dst);
-    mlir::Value srcMR = createToMemRef(loc, rewriter, src, srcMRTyp);
-    auto dstMR = createToMemRef(loc, rewriter, dst, dstMRTyp);
-
     auto slcOffs = ::mlir::getMixedValues(adaptor.getStaticOffsets(),
                                           adaptor.getOffsets(), rewriter);
     auto slcSizes = ::mlir::getMixedValues(adaptor.getStaticSizes(),
@@ -329,37 +368,31 @@ struct InsertSliceLowering
     auto slcStrides = ::mlir::getMixedValues(adaptor.getStaticStrides(),
                                              adaptor.getStrides(), rewriter);
 
-    auto view = rewriter.create<::mlir::memref::SubViewOp>(
-        loc, dstMR, slcOffs, slcSizes, slcStrides);
-
-    auto srcRank = srcMRTyp.getRank();
-    auto dstRank = dstMRTyp.getRank();
-    // FIXME properly handle broadcasting
-    if (srcRank == 0) {
-      // emit a loop that broadcasts a scalar to dst shape
-      // construct broadcasting affine map; srcRank==0 case is simple
-      auto srcMap =
-          ::mlir::AffineMap::get(dstRank, srcRank, {}, rewriter.getContext());
-      auto dstMap = rewriter.getMultiDimIdentityMap(dstRank);
-      ::mlir::SmallVector<mlir::utils::IteratorType> iterators(
-          dstRank, ::mlir::utils::IteratorType::parallel);
-      auto copyOp = rewriter.create<::mlir::linalg::GenericOp>(
-          loc, srcMR, view.getResult(), ::mlir::ArrayRef({srcMap, dstMap}),
-          iterators,
-          [](::mlir::OpBuilder &b, ::mlir::Location loc,
-             ::mlir::ValueRange args) {
-            b.create<::mlir::linalg::YieldOp>(loc, args.front());
-          });
-      rewriter.replaceOp(op, copyOp);
-      return ::mlir::success();
-    }
-
-    rewriter.replaceOpWithNewOp<::mlir::memref::CopyOp>(op, srcMR, view);
+    createInsertSlice(loc, rewriter, srcArType, dstArType, src, dst, slcOffs,
+                      slcSizes, slcStrides);
+    rewriter.eraseOp(op);
     return ::mlir::success();
   }
 };
 
-/// Convert immutable_insert_slice to tensor
+/// Return true if ary is the only reference to a newly allocated array and
+/// ary has no other users than the single one. Views and function arguments
+/// might share their memory with other arrays and are rejected.
+static bool isExclusiveTemporary(::mlir::Value ary) {
+  if (!ary.hasOneUse())
+    return false;
+  auto defOp = ary.getDefiningOp();
+  return defOp &&
+         ::mlir::isa<::imex::ndarray::CreateOp, ::imex::ndarray::LinSpaceOp,
+                     ::imex::ndarray::CopyOp, ::imex::ndarray::EWBinOp,
+                     ::imex::ndarray::EWUnyOp,
+                     ::imex::ndarray::ImmutableInsertSliceOp>(defOp);
+}
+
+/// Convert immutable_insert_slice to tensor.
+/// If the destination is an exclusive temporary nobody else can observe its
+/// update, so the slice gets copied in place like for insert_slice instead of
+/// materializing a new array.
 struct ImmutableInsertSliceLowering
     : public ::mlir::OpConversionPattern<
           ::imex::ndarray::ImmutableInsertSliceOp> {
@@ -382,6 +415,20 @@ struct ImmutableInsertSliceLowering
     auto strides = ::mlir::getMixedValues(adaptor.getStaticStrides(),
                                           adaptor.getStrides(), rewriter);
 
+    auto srcArType =
+        mlir::dyn_cast<imex::ndarray::NDArrayType>(op.getSource().getType());
+    auto dstArType = mlir::dyn_cast<imex::ndarray::NDArrayType>(
+        op.getDestination().getType());
+    if (srcArType && dstArType &&
+        mlir::isa<::mlir::RankedTensorType>(src.getType()) &&
+        mlir::isa<::mlir::RankedTensorType>(dst.getType()) &&
+        isExclusiveTemporary(op.getDestination())) {
+      createInsertSlice(loc, rewriter, srcArType, dstArType, src, dst, offsets,
+                        sizes, strides);
+      rewriter.replaceOp(op, dst);
+      return ::mlir::success();
+    }
+
     auto slice = rewriter.create<::mlir::tensor::InsertSliceOp>(
         loc, src, dst, offsets, sizes, strides);
     rewriter.replaceOp(op, slice.getResult());
@@ -491,7 +538,8 @@ struct CreateLowering
   }
 };
 
-/// Convert ndarray.copy and its return type to memref.alloc + memref.copy.
+/// Convert ndarray.copy and its return type to memref.alloc + memref.copy,
+/// or to gpu.alloc + gpu.memcpy for contiguous copies involving the GPU.
 struct CopyLowering
     : public ::mlir::OpConversionPattern<::imex::ndarray::CopyOp> {
   using OpConversionPattern::OpConversionPattern;
@@ -521,18 +569,25 @@ struct CopyLowering
             rewriter.createOrFold<::mlir::tensor::DimOp>(loc, src, i));
       }
     }
-    // alloc memref
     auto mrTyp =
         ::mlir::MemRefType::get(tTyp.getShape(), tTyp.getElementType());
+    auto srcMRTyp = srcArTyp.getMemRefType(src);
+    bool hasGPUEnv = ::imex::ndarray::hasGPUEnv(srcArTyp) ||
+                     ::imex::ndarray::hasGPUEnv(retArTyp);
+    // contiguous copies involving the GPU are a single transfer, which
+    // runs on the copy engine instead of as a kernel or host loop
+    if (hasGPUEnv && !retArTyp.hasZeroSize() &&
+        srcMRTyp.getLayout().isIdentity())
+      return lowerToMemcpy(op, createToMemRef(loc, rewriter, src, srcMRTyp),
+                           mrTyp, dynDims, rewriter);
+
+    // alloc memref
     auto mr = rewriter.create<::mlir::memref::AllocOp>(
         loc, mrTyp, dynDims, rewriter.getI64IntegerAttr(8));
     // and copy if not zero sized
     if (!retArTyp.hasZeroSize()) {
-      auto srcMR =
-          createToMemRef(loc, rewriter, src, srcArTyp.getMemRefType(src));
+      auto srcMR = createToMemRef(loc, rewriter, src, srcMRTyp);
       // wrap copy in a region to mark it non-deletable or a gpu copy
-      bool hasGPUEnv = ::imex::ndarray::hasGPUEnv(srcArTyp) ||
-                       ::imex::ndarray::hasGPUEnv(retArTyp);
       std::string regName = hasGPUEnv ? "gpu_copy_op" : "protect_copy_op";
       auto env = rewriter.getStringAttr(regName);
       rewriter.create<::imex::region::EnvironmentRegionOp>(
@@ -550,6 +605,48 @@ struct CopyLowering
 
     return ::mlir::success();
   }
+
+  /// Copies \p srcMR into a new buffer of type \p mrTyp with gpu.memcpy. The
+  /// buffer is host shared memory, since the host may read the result, which
+  /// unlike pageable memory the copy engine accesses directly. The copy is
+  /// not waited for here but right before the first later use of its source
+  /// or result, so it overlaps with the ops in between.
+  static ::mlir::LogicalResult
+  lowerToMemcpy(::imex::ndarray::CopyOp op, ::mlir::Value srcMR,
+                ::mlir::MemRefType mrTyp, ::mlir::ValueRange dynDims,
+                ::mlir::ConversionPatternRewriter &rewriter) {
+    auto loc = op.getLoc();
+    auto block = op->getBlock();
+    ::mlir::Operation *consumer = block->getTerminator();
+    ::mlir::Value values[] = {op.getSource(), op.getResult()};
+    for (auto value : values) {
+      for (auto user : value.getUsers()) {
+        auto ancestor = block->findAncestorOpInBlock(*user);
+        if (ancestor && op->isBeforeInBlock(ancestor) &&
+            ancestor->isBeforeInBlock(consumer))
+          consumer = ancestor;
+      }
+    }
+
+    auto tokenTyp = rewriter.getType<::mlir::gpu::AsyncTokenType>();
+    auto start = rewriter.create<::mlir::gpu::WaitOp>(loc, tokenTyp,
+                                                      ::mlir::ValueRange{});
+    auto alloc = rewriter.create<::mlir::gpu::AllocOp>(
+        loc, mrTyp, tokenTyp, start.getAsyncToken(), dynDims,
+        ::mlir::ValueRange{}, /*hostShared=*/true);
+    auto copy = rewriter.create<::mlir::gpu::MemcpyOp>(
+        loc, tokenTyp, alloc.getAsyncToken(), alloc.getMemref(), srcMR);
+    auto retArTyp = mlir::cast<::imex::ndarray::NDArrayType>(op.getType());
+    auto res = rewriter.create<::mlir::bufferization::ToTensorOp>(
+        loc, retArTyp.getTensorType(), alloc.getMemref(), /*restrict=*/true,
+        /*writable=*/true);
+    rewriter.replaceOp(op, res);
+
+    rewriter.setInsertionPoint(consumer);
+    (void)rewriter.create<::mlir::gpu::WaitOp>(loc, ::mlir::Type{},
+                                               copy.getAsyncToken());
+    return ::mlir::success();
+  }
 };
 
 /// Convert ndarray.delete and its return type to memref.dealloc.
@@ -643,6 +740,10 @@ struct CastElemTypeLowering
 
 /// Convert NDArray's ReshapeOp and its return type to Linalg/tensor.
 /// Optionally creates a copy first.
+/// Reshapes between static shapes which only merge or split dimensions become
+/// tensor.collapse_shape/expand_shape, which bufferize to views of
+/// contiguous memrefs. Bufferization only copies if the layout of the source
+/// does not allow a view. All other reshapes use tensor.reshape.
 struct ReshapeLowering
     : public ::mlir::OpConversionPattern<::imex::ndarray::ReshapeOp> {
   using OpConversionPattern::OpConversionPattern;
@@ -673,6 +774,22 @@ struct ReshapeLowering
       src = toTensorOp.getResult();
     }
 
+    auto srcTyp = mlir::cast<::mlir::RankedTensorType>(src.getType());
+    if (srcTyp.hasStaticShape() && outTyp.hasStaticShape() &&
+        srcTyp.getRank() != outTyp.getRank()) {
+      auto reassoc = ::mlir::getReassociationIndicesForReshape(srcTyp, outTyp);
+      if (reassoc) {
+        if (srcTyp.getRank() > outTyp.getRank()) {
+          rewriter.replaceOpWithNewOp<::mlir::tensor::CollapseShapeOp>(
+              op, outTyp, src, *reassoc);
+        } else {
+          rewriter.replaceOpWithNewOp<::mlir::tensor::ExpandShapeOp>(
+              op, outTyp, src, *reassoc);
+        }
+        return ::mlir::success();
+      }
+    }
+
     auto shapeT = rewriter.create<::mlir::tensor::FromElementsOp>(loc, shape);
     rewriter.replaceOpWithNewOp<::mlir::tensor::ReshapeOp>(op, outTyp, src,
                                                            shapeT);
@@ -750,6 +867,18 @@ static BodyType buildNegative(::mlir::Type typ) {
   };
 }
 
+static BodyType buildLogicalNot(::mlir::Type typ) {
+  return [typ](mlir::OpBuilder &builder, ::mlir::Location loc,
+               ::mlir::ValueRange args) -> void {
+    assert(typ.isInteger(1) && "Only booleans are supported in logical not");
+    // Emit a xor with a constant true
+    auto scalar = builder.create<::mlir::arith::ConstantOp>(
+        loc, typ, builder.getIntegerAttr(typ, 1));
+    auto xorOp = buildTrivialBinary<mlir::arith::XOrIOp>(typ);
+    xorOp(builder, loc, {args[0], scalar});
+  };
+}
+
 /// Trivial unary op builders have simple equivalents in Math.
 /// The Math ops are accepted as template arguments, one for ints and one for
 /// floats. Currently only integers and floats are supported.
@@ -787,6 +916,19 @@ static BodyType getBodyBuilder(::imex::ndarray::EWBinOpId binOp,
   switch (binOp) {
   case ndarray::ADD:
     return buildTrivialBinary<mlir::arith::AddIOp, mlir::arith::AddFOp>(typ);
+  case ndarray::BITWISE_AND:
+  case ndarray::LOGICAL_AND:
+    return buildTrivialBinary<mlir::arith::AndIOp>(typ);
+  case ndarray::BITWISE_OR:
+  case ndarray::LOGICAL_OR:
+    return buildTrivialBinary<mlir::arith::OrIOp>(typ);
+  case ndarray::BITWISE_XOR:
+  case ndarray::LOGICAL_XOR:
+    return buildTrivialBinary<mlir::arith::XOrIOp>(typ);
+  case ndarray::BITWISE_LEFT_SHIFT:
+    return buildTrivialBinary<mlir::arith::ShLIOp>(typ);
+  case ndarray::BITWISE_RIGHT_SHIFT:
+    return buildTrivialBinary<mlir::arith::ShRSIOp>(typ);
   case ndarray::ATAN2:
     return buildTrivialBinary<void, mlir::math::Atan2Op>(typ);
   case ndarray::FLOOR_DIVIDE:
@@ -810,8 +952,6 @@ static BodyType getBodyBuilder(::imex::ndarray::EWBinOpId binOp,
   case ndarray::TRUE_DIVIDE:
     return buildTrivialBinary<::mlir::arith::DivSIOp, ::mlir::arith::DivFOp>(
         typ);
-  // case ndarray::BITWISE_LEFT_SHIFT] =
-  // case ndarray::BITWISE_RIGHT_SHIFT] =
 
   // case ndarray::EQUAL] =
   // case ndarray::GREATER] =
@@ -824,6 +964,25 @@ static BodyType getBodyBuilder(::imex::ndarray::EWBinOpId binOp,
   };
 }
 
+/// Bitwise ops on integers and logical ops on booleans are lowered to
+/// linalg.generic like the arithmetic ops, such that chains of elementwise
+/// ops fuse into a single linalg.generic also for dynamic shapes.
+/// @return true if `binOpId` needs TOSA for element type `typ`
+static bool needsTosa(::imex::ndarray::EWBinOpId binOpId, ::mlir::Type typ) {
+  switch (binOpId) {
+  case ndarray::BITWISE_AND:
+  case ndarray::BITWISE_OR:
+  case ndarray::BITWISE_XOR:
+    return !typ.isIntOrIndex();
+  case ndarray::LOGICAL_AND:
+  case ndarray::LOGICAL_OR:
+  case ndarray::LOGICAL_XOR:
+    return !typ.isInteger(1);
+  default:
+    return false;
+  };
+}
+
 ::mlir::Value createTosaOp(::mlir::Location loc,
                            ::imex::ndarray::EWBinOpId binOpId,
                            ::mlir::ConversionPatternRewriter &rewriter,
@@ -903,33 +1062,51 @@ struct EWBinOpLowering
             adaptor.getOp())
             .getInt();
 
-    ::mlir::Value newOp =
-        createTosaOp(loc, binOpId, rewriter, resType, lhs, rhs);
+    ::mlir::Value newOp;
+    if (needsTosa(binOpId, elTyp)) {
+      newOp = createTosaOp(loc, binOpId, rewriter, resType, lhs, rhs);
+    }
     if (!newOp) {
       // generate linalg.generic loop
 
+      // The body casts its arguments to the result element type, so casts to
+      // it feeding the operation are applied there instead of materializing
+      // the cast arrays.
+      auto absorbCast = [&](::mlir::Value arg,
+                            ::mlir::Value converted) -> ::mlir::Value {
+        auto castOp = arg.getDefiningOp<::imex::ndarray::CastElemTypeOp>();
+        if (!castOp || castOp.getType().getElementType() != elTyp)
+          return converted;
+        auto src = rewriter.getRemappedValue(castOp.getInput());
+        return src && mlir::isa<::mlir::RankedTensorType>(src.getType())
+                   ? src
+                   : converted;
+      };
+      lhs = absorbCast(op.getLhs(), lhs);
+      rhs = absorbCast(op.getRhs(), rhs);
+
       // create output tensor with right dimensions
       auto tensor = createEmptyTensor(rewriter, loc, resType, {lhs, rhs});
 
       // we need affine maps for linalg::generic
-      // as long as we have no proper support for rank-reduced sizes above
-      // Linalg, we can handle only
-      //   - explicitly rank-reduced inputs (such as explicit 0d tensors)
+      // broadcasting happens through the maps, operands are never expanded
+      // to the full shape. As long as we have no proper support for
+      // rank-reduced sizes above Linalg, we can handle only
+      //   - inputs of lower rank, aligned with the trailing dimensions
+      //     (such as explicit 0d tensors or a row vector)
       //   - shapes with static dim-sizes of 1
-      ::mlir::SmallVector<::mlir::AffineExpr> lhsExprs, rhsExprs, resExprs;
-      for (int i = 0; i < lhsRank; ++i) {
-        lhsExprs.emplace_back(lhsTnsr.getDimSize(i) == 1
-                                  ? rewriter.getAffineConstantExpr(0)
-                                  : rewriter.getAffineDimExpr(i));
-      }
-      for (int i = 0; i < rhsRank; ++i) {
-        rhsExprs.emplace_back(rhsTnsr.getDimSize(i) == 1
-                                  ? rewriter.getAffineConstantExpr(0)
-                                  : rewriter.getAffineDimExpr(i));
-      }
-      for (unsigned i = 0; i < rank; ++i) {
-        resExprs.emplace_back(rewriter.getAffineDimExpr(i));
-      }
+      auto getExprs = [&](::mlir::TensorType tnsr) {
+        ::mlir::SmallVector<::mlir::AffineExpr> exprs;
+        auto off = rank - tnsr.getRank();
+        for (int i = 0; i < tnsr.getRank(); ++i) {
+          exprs.emplace_back(tnsr.getDimSize(i) == 1
+                                 ? rewriter.getAffineConstantExpr(0)
+                                 : rewriter.getAffineDimExpr(off + i));
+        }
+        return exprs;
+      };
+      auto lhsExprs = getExprs(lhsTnsr);
+      auto rhsExprs = getExprs(rhsTnsr);
       auto lhsMap = ::mlir::AffineMap::get(resType.getRank(), /*symbolCount=*/0,
                                            lhsExprs, rewriter.getContext());
       auto rhsMap = ::mlir::AffineMap::get(resType.getRank(), /*symbolCount=*/0,
@@ -1001,6 +1178,8 @@ static BodyType getBodyBuilder(::imex::ndarray::EWUnyOpId binOp,
     return buildTrivialUnary<void, ::mlir::math::TruncOp>(typ);
   case ndarray::NEGATIVE:
     return buildNegative(typ);
+  case ndarray::LOGICAL_NOT:
+    return buildLogicalNot(typ);
   default:
     assert(0 && "unsupported elementwise binary operation");
   };
@@ -1097,8 +1276,11 @@ struct EWUnyOpLowering
       auto elTyp = srcTnsr.getElementType();
       auto rank = srcTnsr.getRank();
 
-      // try to lower to TOSA
-      newOp = createUnaryTosaOp(loc, unyOpId, rewriter, resType, src);
+      // try to lower to TOSA, booleans are negated by linalg.generic to
+      // fuse with other elementwise ops
+      if (!(unyOpId == ::imex::ndarray::LOGICAL_NOT && elTyp.isInteger(1))) {
+        newOp = createUnaryTosaOp(loc, unyOpId, rewriter, resType, src);
+      }
 
       if (!newOp) { // still not lowered: generate linalg.generic loop
         // create output tensor with right dimensions
@@ -1154,7 +1336,6 @@ static BodyType getBodyBuilder(::imex::ndarray::ReduceOpId redOp,
 /// Linalg/tensor. The given op's type is expected to convert to the appropriate
 /// type (shape and element-type). Also needs some arith and affine (for
 /// linalg::genericop).
-// FIXME reduction over a subset of dimensionsstruct ReductionOpLowering
 struct ReductionOpLowering
     : public ::mlir::OpConversionPattern<::imex::ndarray::ReductionOp> {
   using OpConversionPattern::OpConversionPattern;
@@ -1187,27 +1368,42 @@ struct ReductionOpLowering
     auto elTyp = retTyp.getElementType();
     auto sElTyp = makeSignlessType(elTyp);
 
-    // build tensor using the resulting element type and shape
-    // FIXME support reduction dimensions
-    auto rank = static_cast<unsigned>(retTyp.getRank());
-    assert(rank == 0);
-    auto zeroI = createIndex(loc, rewriter, 0);
-    ::imex::ValVec shapeVVec(rank, zeroI);
-    // create new tensor
-    auto zero = createInt(loc, rewriter, 0);
-    auto tensor = createEmptyTensor(rewriter, loc, sElTyp, shapeVVec);
-    auto tnsr = rewriter.create<::mlir::linalg::FillOp>(loc, zero, tensor);
-
     // rank/num-dims of input
     auto inpRank = static_cast<unsigned>(inpTnsrTyp.getRank());
-    // input maps are identity maps
+    auto redDims = op.getReducedDims();
+    bool keepdims = op.getKeepdims();
+
+    // Reduced dimensions iterate as reductions and are dropped from the
+    // output (or mapped to 0 with keepdims), all others are parallel.
+    // Input map is the identity map.
     auto inpMap = ::mlir::AffineMap::getMultiDimIdentityMap(
         inpRank, rewriter.getContext());
-    // output map is "*->()"
-    auto omap = ::mlir::AffineMap::get(inpRank, 0, rewriter.getContext());
+    ::imex::ValVec shapeVVec;
+    ::mlir::SmallVector<::mlir::AffineExpr> oExprs;
+    ::mlir::SmallVector<mlir::utils::IteratorType> iterators;
+    for (unsigned i = 0; i < inpRank; ++i) {
+      if (llvm::is_contained(redDims, static_cast<int64_t>(i))) {
+        iterators.emplace_back(mlir::utils::IteratorType::reduction);
+        if (keepdims) {
+          shapeVVec.emplace_back(createIndex(loc, rewriter, 1));
+          oExprs.emplace_back(rewriter.getAffineConstantExpr(0));
+        }
+      } else {
+        iterators.emplace_back(mlir::utils::IteratorType::parallel);
+        shapeVVec.emplace_back(
+            rewriter.createOrFold<::mlir::tensor::DimOp>(loc, inpTnsr, i));
+        oExprs.emplace_back(rewriter.getAffineDimExpr(i));
+      }
+    }
+    assert(shapeVVec.size() == static_cast<size_t>(retTyp.getRank()));
+    auto omap =
+        ::mlir::AffineMap::get(inpRank, 0, oExprs, rewriter.getContext());
     const ::mlir::AffineMap maps[] = {inpMap, omap};
-    ::mlir::SmallVector<mlir::utils::IteratorType> iterators(
-        inpRank, mlir::utils::IteratorType::reduction);
+
+    // build tensor using the resulting element type and shape
+    auto zero = createInt(loc, rewriter, 0);
+    auto tensor = createEmptyTensor(rewriter, loc, sElTyp, shapeVVec);
+    auto tnsr = rewriter.create<::mlir::linalg::FillOp>(loc, zero, tensor);
 
     // create reduction op as linalg::generic
     const ::imex::ndarray::ReduceOpId ropid =
@@ -1218,7 +1414,12 @@ struct ReductionOpLowering
     auto resTnsr = rewriter.create<::mlir::linalg::GenericOp>(
         loc, tnsr.getType(0), oprnds, tnsr.getResult(0), maps, iterators,
         bodyBuilder);
-    rewriter.replaceOp(op, resTnsr.getResult(0));
+    // the result shape might be more static than the converted type
+    ::mlir::Value res = resTnsr.getResult(0);
+    auto resTyp = retTyp.clone(sElTyp);
+    if (res.getType() != resTyp)
+      res = rewriter.create<::mlir::tensor::CastOp>(loc, resTyp, res);
+    rewriter.replaceOp(op, res);
 
     return ::mlir::success();
   }
@@ -1342,7 +1543,7 @@ struct ConvertNDArrayToLinalgPass
         ::mlir::arith::ArithDialect, ::mlir::math::MathDialect,
         ::mlir::memref::MemRefDialect, ::mlir::tensor::TensorDialect,
         ::mlir::tosa::TosaDialect, ::mlir::shape::ShapeDialect,
-        ::mlir::bufferization::BufferizationDialect,
+        ::mlir::bufferization::BufferizationDialect, ::mlir::gpu::GPUDialect,
         ::imex::region::RegionDialect>();
     target.addLegalOp<::mlir::UnrealizedConversionCastOp>(); // FIXME
 
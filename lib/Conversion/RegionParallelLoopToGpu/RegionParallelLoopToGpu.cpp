@@ -10,14 +10,18 @@
 /// \file
 /// This file extends upstream ParallelLoopToGpuPass by applying the transform
 /// only if the parallel loop is within a GPU region
-/// (`region.env_region #region.gpu_env<...>`).
+/// (`region.env_region #region.gpu_env<...>`). Sibling parallel loops with the
+/// same iteration space within a GPU region are fused first, so that they
+/// become one kernel.
 ///
 //===----------------------------------------------------------------------===//
 
 #include <imex/Conversion/RegionParallelLoopToGpu/RegionParallelLoopToGpu.h>
 #include <imex/Dialect/Region/RegionUtils.h>
+#include <mlir/Analysis/AliasAnalysis.h>
 #include <mlir/Conversion/SCFToGPU/SCFToGPU.h>
 #include <mlir/Dialect/Affine/IR/AffineOps.h>
+#include <mlir/Dialect/SCF/Transforms/Transforms.h>
 #include <mlir/IR/PatternMatch.h>
 #include <mlir/Pass/Pass.h>
 #include <mlir/Transforms/DialectConversion.h>
@@ -51,6 +55,17 @@ struct ConvertRegionParallelLoopToGpuPass
       return ::mlir::WalkResult::advance();
     });
 
+    // fuse sibling parallel loops within the gpu regions, where the
+    // dependencies between them allow
+    if (fuseParallelLoops) {
+      auto &aliasAnalysis = getAnalysis<::mlir::AliasAnalysis>();
+      auto mayAlias = [&](::mlir::Value lhs, ::mlir::Value rhs) {
+        return !aliasAnalysis.alias(lhs, rhs).isNo();
+      };
+      for (auto *op : ops)
+        ::mlir::scf::naivelyFuseParallelOps(op->getRegion(0), mayAlias);
+    }
+
     // apply par-loop to gpu conversion to collected gpu regions
     if (::mlir::failed(
             ::mlir::applyPartialConversion(ops, target, std::move(patterns)))) {
@@ -23,7 +23,9 @@
 
 #include "mlir/Dialect/Func/IR/FuncOps.h"
 #include "mlir/Dialect/MemRef/IR/MemRef.h"
+#include "mlir/Dialect/SCF/IR/SCF.h"
 #include "mlir/Dialect/UB/IR/UBOps.h"
+#include "mlir/IR/Matchers.h"
 #include "mlir/Transforms/DialectConversion.h"
 #include "llvm/Support/FormatVariadic.h"
 #include <mlir/Dialect/SPIRV/IR/SPIRVDialect.h>
@@ -31,9 +33,11 @@
 
 #include "LscIntrinsicEnums.h"
 #include "imex/Utils/VCUtils.h"
+#include "imex/Utils/XeArch.h"
 
 using namespace mlir;
 using mlir::xegpu::AtomicRMWOp;
+using mlir::xegpu::CreateDescOp;
 using mlir::xegpu::FenceOp;
 using mlir::xegpu::LoadGatherOp;
 using mlir::xegpu::LoadNdOp;
@@ -41,6 +45,7 @@ using mlir::xegpu::PrefetchNdOp;
 using mlir::xegpu::PrefetchOp;
 using mlir::xegpu::StoreNdOp;
 using mlir::xegpu::StoreScatterOp;
+using mlir::xegpu::UpdateOffsetOp;
 
 namespace imex {
 
@@ -1021,6 +1026,305 @@ class StoreNdPattern : public OpConversionPattern<StoreNdOp> {
   }
 };
 
+// Returns the strides of the integer vector \p value as an affine function of
+// the lane indices, i.e. value[i] = c + sum_d(strides[d] * i[d]) with c the
+// same for all lanes, or std::nullopt if \p value is not known to be one.
+static std::optional<SmallVector<int64_t>> getLaneStrides(Value value) {
+  auto vecTy = dyn_cast<VectorType>(value.getType());
+  if (!vecTy || !vecTy.getElementType().isIntOrIndex())
+    return std::nullopt;
+  auto shape = vecTy.getShape();
+  int64_t rank = vecTy.getRank();
+  SmallVector<int64_t> uniform(rank, 0);
+
+  DenseIntElementsAttr attr;
+  if (matchPattern(value, m_Constant(&attr))) {
+    if (attr.isSplat())
+      return uniform;
+    SmallVector<int64_t> values;
+    for (const APInt &v : attr.getValues<APInt>())
+      values.push_back(v.getSExtValue());
+    // distance between consecutive indices of each dim, in row-major order.
+    SmallVector<int64_t> steps(rank, 1);
+    for (int64_t d = rank - 2; d >= 0; --d)
+      steps[d] = steps[d + 1] * shape[d + 1];
+    SmallVector<int64_t> strides(rank, 0);
+    for (int64_t d = 0; d < rank; ++d)
+      if (shape[d] > 1)
+        strides[d] = values[steps[d]] - values[0];
+    for (auto [i, v] : llvm::enumerate(values)) {
+      int64_t expected = values[0];
+      for (int64_t d = 0; d < rank; ++d)
+        expected += strides[d] * (int64_t(i) / steps[d] % shape[d]);
+      if (v != expected)
+        return std::nullopt;
+    }
+    return strides;
+  }
+
+  auto *op = value.getDefiningOp();
+  if (!op)
+    return std::nullopt;
+
+  if (isa<vector::StepOp>(op))
+    return SmallVector<int64_t>{1};
+
+  if (isa<vector::SplatOp>(op))
+    return uniform;
+
+  if (auto bcast = dyn_cast<vector::BroadcastOp>(op)) {
+    auto srcTy = dyn_cast<VectorType>(bcast.getSourceType());
+    if (!srcTy)
+      return uniform;
+    auto src = getLaneStrides(bcast.getSource());
+    if (!src)
+      return std::nullopt;
+    // source dims are aligned with the trailing dims of the result, and the
+    // ones stretched from size 1 are uniform.
+    SmallVector<int64_t> strides(rank, 0);
+    auto lead = rank - srcTy.getRank();
+    for (int64_t d = 0; d < srcTy.getRank(); ++d)
+      if (srcTy.getDimSize(d) == shape[lead + d])
+        strides[lead + d] = (*src)[d];
+    return strides;
+  }
+
+  if (isa<arith::IndexCastOp, arith::IndexCastUIOp, arith::ExtSIOp,
+          arith::ExtUIOp>(op))
+    return getLaneStrides(op->getOperand(0));
+
+  if (isa<arith::AddIOp, arith::SubIOp>(op)) {
+    auto lhs = getLaneStrides(op->getOperand(0));
+    auto rhs = getLaneStrides(op->getOperand(1));
+    if (!lhs || !rhs)
+      return std::nullopt;
+    int64_t sign = isa<arith::SubIOp>(op) ? -1 : 1;
+    for (int64_t d = 0; d < rank; ++d)
+      (*lhs)[d] += sign * (*rhs)[d];
+    return lhs;
+  }
+
+  if (isa<arith::MulIOp>(op)) {
+    for (unsigned i = 0; i < 2; ++i) {
+      APInt factor;
+      if (!matchPattern(op->getOperand(1 - i), m_ConstantInt(&factor)))
+        continue;
+      auto strides = getLaneStrides(op->getOperand(i));
+      if (!strides)
+        return std::nullopt;
+      for (auto &stride : *strides)
+        stride *= factor.getSExtValue();
+      return strides;
+    }
+    // the product of two uniform values is uniform as well.
+    auto lhs = getLaneStrides(op->getOperand(0));
+    auto rhs = getLaneStrides(op->getOperand(1));
+    auto isUniform = [](const SmallVector<int64_t> &strides) {
+      return llvm::all_of(strides, [](int64_t s) { return s == 0; });
+    };
+    if (lhs && rhs && isUniform(*lhs) && isUniform(*rhs))
+      return uniform;
+    return std::nullopt;
+  }
+
+  if (auto extract = dyn_cast<vector::ExtractOp>(op)) {
+    auto src = getLaneStrides(extract.getVector());
+    if (!src)
+      return std::nullopt;
+    auto dropped = extract.getStaticPosition().size();
+    return SmallVector<int64_t>(src->begin() + dropped, src->end());
+  }
+
+  if (auto slice = dyn_cast<vector::ExtractStridedSliceOp>(op)) {
+    auto src = getLaneStrides(slice.getVector());
+    if (!src)
+      return std::nullopt;
+    for (auto [d, step] : llvm::enumerate(
+             slice.getStrides().getAsValueRange<IntegerAttr>()))
+      (*src)[d] *= step.getSExtValue();
+    return src;
+  }
+
+  if (auto shapeCast = dyn_cast<vector::ShapeCastOp>(op)) {
+    auto srcTy = shapeCast.getSourceVectorType();
+    auto src = getLaneStrides(shapeCast.getSource());
+    if (!src)
+      return std::nullopt;
+    // sizes and strides of the non-unit dims of the source.
+    SmallVector<std::pair<int64_t, int64_t>> srcDims;
+    for (int64_t d = 0; d < srcTy.getRank(); ++d)
+      if (srcTy.getDimSize(d) != 1)
+        srcDims.push_back({srcTy.getDimSize(d), (*src)[d]});
+    SmallVector<int64_t> dims;
+    for (int64_t d = 0; d < rank; ++d)
+      if (shape[d] != 1)
+        dims.push_back(d);
+
+    SmallVector<int64_t> strides(rank, 0);
+    // unit dims added or dropped.
+    if (dims.size() == srcDims.size() &&
+        llvm::all_of(llvm::enumerate(dims), [&](auto it) {
+          return shape[it.value()] == srcDims[it.index()].first;
+        })) {
+      for (auto [i, d] : llvm::enumerate(dims))
+        strides[d] = srcDims[i].second;
+      return strides;
+    }
+    // flattening, which is affine only if the rows continue each other.
+    if (dims.size() == 1) {
+      for (size_t i = 0; i + 1 < srcDims.size(); ++i)
+        if (srcDims[i].second != srcDims[i + 1].second * srcDims[i + 1].first)
+          return std::nullopt;
+      strides[dims[0]] = srcDims.back().second;
+      return strides;
+    }
+    return std::nullopt;
+  }
+
+  return std::nullopt;
+}
+
+// The block message a gather or scatter can be promoted to, based on the
+// addresses of its lanes.
+enum class GatherPromotion {
+  // the lanes access arbitrary elements, a scattered message is needed.
+  None,
+  // the lanes access consecutive elements, starting from the first lane.
+  Contiguous,
+  // all the lanes access the element of the first lane.
+  Uniform
+};
+
+// Analyzes the offsets \p tdesc was created and updated with. The analysis
+// is local: descriptors carried by loops are not promoted.
+static GatherPromotion getGatherPromotion(Value tdesc) {
+  auto isUniform = [](const std::optional<SmallVector<int64_t>> &strides) {
+    return strides &&
+           llvm::all_of(*strides, [](int64_t stride) { return stride == 0; });
+  };
+  while (auto updateOp = tdesc.getDefiningOp<UpdateOffsetOp>()) {
+    // the same update for all lanes keeps the lanes relative to each other.
+    if (!isUniform(getLaneStrides(updateOp.getOffsets())))
+      return GatherPromotion::None;
+    tdesc = updateOp.getTensorDesc();
+  }
+  auto createOp = tdesc.getDefiningOp<CreateDescOp>();
+  if (!createOp)
+    return GatherPromotion::None;
+  auto strides = getLaneStrides(createOp.getOffsets());
+  if (!strides || strides->size() != 1)
+    return GatherPromotion::None;
+  if ((*strides)[0] == 1)
+    return GatherPromotion::Contiguous;
+  if ((*strides)[0] == 0)
+    return GatherPromotion::Uniform;
+  return GatherPromotion::None;
+}
+
+// Describes the 1D block message a promoted gather or scatter uses: the
+// lanes of 8/16-bit data are packed into 32-bit elements, since 1D block
+// messages only take 32/64-bit data.
+struct GatherBlockSetup {
+  GatherPromotion promotion = GatherPromotion::None;
+  Type elemTy;
+  int elems = 0;
+  bool packed = false;
+};
+
+static GatherBlockSetup
+getGatherBlockSetup(Value tdesc, bool isLoad, Location &loc,
+                    ConversionPatternRewriter &rewriter) {
+  GatherBlockSetup setup;
+  auto tdescTy = cast<TensorDescType>(tdesc.getType());
+  if (tdescTy.getChunkSize() != 1)
+    return setup;
+  auto promotion = getGatherPromotion(tdesc);
+  // a uniform scatter would have to store the last active lane only.
+  if (promotion == GatherPromotion::None ||
+      (promotion == GatherPromotion::Uniform && !isLoad))
+    return setup;
+
+  auto elemTy = tdescTy.getElementType();
+  auto bitWidth = elemTy.getIntOrFloatBitWidth();
+  int elems =
+      promotion == GatherPromotion::Uniform ? 1 : tdescTy.getShape()[0];
+  setup.elemTy = elemTy;
+  setup.elems = elems;
+  if (bitWidth < 32) {
+    if (promotion == GatherPromotion::Uniform || elems * bitWidth % 32)
+      return setup;
+    setup.elemTy = rewriter.getI32Type();
+    setup.elems = elems * bitWidth / 32;
+    setup.packed = true;
+  }
+  if (failed(isValid1DBlockSetup(setup.elemTy, setup.elems, loc, rewriter)))
+    return setup;
+  setup.promotion = promotion;
+  return setup;
+}
+
+// Returns the condition under which the block message of \p setup accesses
+// the same memory as the gather or scatter with \p mask and \p addresses,
+// or null if it always does: a contiguous access needs all its lanes, so
+// that the block does not run past a tail, and a uniform one any of them.
+// Packed data also needs a 4-byte aligned address.
+static Value genBlockCondition(const GatherBlockSetup &setup, Value mask,
+                               Value addresses, Location &loc,
+                               ConversionPatternRewriter &rewriter) {
+  Value cond;
+  if (!matchPattern(mask, m_One())) {
+    auto kind = setup.promotion == GatherPromotion::Uniform
+                    ? vector::CombiningKind::OR
+                    : vector::CombiningKind::AND;
+    cond = rewriter.create<vector::ReductionOp>(loc, kind, mask);
+  }
+  if (setup.packed) {
+    auto addrTy = cast<VectorType>(addresses.getType()).getElementType();
+    Value first = rewriter.create<vector::ExtractOp>(loc, addresses, 0);
+    Value rem = rewriter.create<arith::AndIOp>(loc, first,
+                                               integer_val(3, addrTy));
+    Value aligned = rewriter.create<arith::CmpIOp>(
+        loc, arith::CmpIPredicate::eq, rem, integer_val(0, addrTy));
+    cond = cond ? Value(rewriter.create<arith::AndIOp>(loc, cond, aligned))
+                : aligned;
+  }
+  return cond;
+}
+
+// Returns the 1D block payload addressing the first lane of \p addresses.
+static Value genFirstLanePayload(Value addresses, Location &loc,
+                                 ConversionPatternRewriter &rewriter) {
+  auto addrTy = cast<VectorType>(addresses.getType()).getElementType();
+  Value first = rewriter.create<vector::ExtractOp>(loc, addresses, 0);
+  return rewriter.create<vector::BroadcastOp>(loc, vecTy(1, addrTy), first);
+}
+
+// Generates \p genBlock if \p cond is null, or else an scf.if running it when
+// \p cond holds and \p genScattered otherwise. Both return the loaded value,
+// of type \p resultTy, or null for stores.
+static Value genGuardedBlock(Value cond, Type resultTy,
+                             function_ref<Value()> genBlock,
+                             function_ref<Value()> genScattered, Location &loc,
+                             ConversionPatternRewriter &rewriter) {
+  if (!cond)
+    return genBlock();
+  SmallVector<Type> resultTypes;
+  if (resultTy)
+    resultTypes.push_back(resultTy);
+  auto ifOp = rewriter.create<scf::IfOp>(loc, resultTypes, cond,
+                                         /*withElseRegion=*/true);
+  rewriter.setInsertionPointToStart(ifOp.thenBlock());
+  auto blockValue = genBlock();
+  if (resultTy)
+    rewriter.create<scf::YieldOp>(loc, blockValue);
+  rewriter.setInsertionPointToStart(ifOp.elseBlock());
+  auto scatteredValue = genScattered();
+  if (resultTy)
+    rewriter.create<scf::YieldOp>(loc, scatteredValue);
+  rewriter.setInsertionPointAfter(ifOp);
+  return resultTy ? ifOp.getResult(0) : Value();
+}
+
 // A pattern lowering xegpu.load_gather to lsc.load.* intrinsic.
 // For global memory access, it is lowered to lsc.load.stateless.*
 // For shared memory access, it is lowered to lsc.load.slm.*
@@ -1034,9 +1338,15 @@ class StoreNdPattern : public OpConversionPattern<StoreNdOp> {
 // or TensorDesc<32x4xf32, #scattered>, but not TensorDesc<16x6xf32,
 // #scattered>. (invalid chunk size) nor TensorDesc<32x8xf32, #scattered>
 // (exceeds 512bytes).
+// If promoteGathers is set, gathers whose lanes load consecutive elements or
+// the same element are lowered to a 1D block load instead, guarded by their
+// mask when it is not known to be all set.
 class LoadGatherPattern : public OpConversionPattern<LoadGatherOp> {
 public:
-  using OpConversionPattern<LoadGatherOp>::OpConversionPattern;
+  LoadGatherPattern(TypeConverter &converter, MLIRContext *context,
+                    bool promoteGathers)
+      : OpConversionPattern<LoadGatherOp>(converter, context),
+        promoteGathers(promoteGathers) {}
 
   LogicalResult
   matchAndRewrite(LoadGatherOp op, OpAdaptor adaptor,
@@ -1058,13 +1368,47 @@ public:
     auto l3hint = op.getL3Hint();
 
     auto resultTy = cast<VectorType>(op.getType());
-    auto newValue = genLoadIntrinsicCallWithC32BConversion(
-        rewriter, loc, resultTy, simd_lanes, op.getMask(), l1hint, l3hint,
-        elemTy, chunkSize, tdescTy.getMemorySpace(), adaptor.getTensorDesc());
-    rewriter.replaceOp(op, newValue);
+    auto genScattered = [&]() -> Value {
+      return genLoadIntrinsicCallWithC32BConversion(
+          rewriter, loc, resultTy, simd_lanes, op.getMask(), l1hint,
+          l3hint, elemTy, chunkSize, tdescTy.getMemorySpace(),
+          adaptor.getTensorDesc());
+    };
+
+    GatherBlockSetup setup;
+    if (promoteGathers)
+      setup = getGatherBlockSetup(op.getTensorDesc(), /*isLoad=*/true, loc,
+                                  rewriter);
+    if (setup.promotion == GatherPromotion::None) {
+      rewriter.replaceOp(op, genScattered());
+      return success();
+    }
 
+    auto genBlock = [&]() -> Value {
+      auto payload =
+          genFirstLanePayload(adaptor.getTensorDesc(), loc, rewriter);
+      auto blockTy = VectorType::get(setup.elems, setup.elemTy);
+      Value value =
+          gen1DLoadInstrinsicCall(rewriter, loc, blockTy, l1hint, l3hint,
+                                  setup.elemTy, setup.elems,
+                                  tdescTy.getMemorySpace(), payload);
+      if (setup.promotion == GatherPromotion::Uniform) {
+        value = rewriter.create<vector::ExtractOp>(loc, value, 0);
+        return rewriter.create<vector::BroadcastOp>(loc, resultTy, value);
+      }
+      if (setup.packed)
+        value = rewriter.create<vector::BitCastOp>(loc, resultTy, value);
+      return value;
+    };
+    auto cond = genBlockCondition(setup, op.getMask(), adaptor.getTensorDesc(),
+                                  loc, rewriter);
+    rewriter.replaceOp(op, genGuardedBlock(cond, resultTy, genBlock,
+                                           genScattered, loc, rewriter));
     return success();
   }
+
+private:
+  bool promoteGathers;
 };
 
 class PrefetchPattern : public OpConversionPattern<PrefetchOp> {
@@ -1120,9 +1464,15 @@ public:
 // or TensorDesc<32x4xf32, #scattered>, but not TensorDesc<16x6xf32,
 // #scattered>. (invalid chunk size) nor TensorDesc<32x8xf32, #scattered>
 // (exceeds 512bytes).
+// If promoteGathers is set, scatters whose lanes store consecutive elements
+// are lowered to a 1D block store instead, guarded by their mask when it is
+// not known to be all set.
 class StoreScatterPattern : public OpConversionPattern<StoreScatterOp> {
 public:
-  using OpConversionPattern<xegpu::StoreScatterOp>::OpConversionPattern;
+  StoreScatterPattern(TypeConverter &converter, MLIRContext *context,
+                      bool promoteGathers)
+      : OpConversionPattern<StoreScatterOp>(converter, context),
+        promoteGathers(promoteGathers) {}
 
   LogicalResult
   matchAndRewrite(xegpu::StoreScatterOp op, OpAdaptor adaptor,
@@ -1142,19 +1492,187 @@ public:
     auto l1hint = op.getL1Hint();
     // auto l2hint = op.getL2Hint();
     auto l3hint = op.getL3Hint();
-    auto callOp = genStoreIntrinsicCallWithC32BConversion(
-        rewriter, loc, simd_lanes, op.getMask(), l1hint, l3hint, elemTy,
-        chunkSize, tdescTy.getMemorySpace(), adaptor.getTensorDesc(),
-        adaptor.getValue());
+    auto genScattered = [&]() -> Value {
+      genStoreIntrinsicCallWithC32BConversion(
+          rewriter, loc, simd_lanes, op.getMask(), l1hint, l3hint, elemTy,
+          chunkSize, tdescTy.getMemorySpace(), adaptor.getTensorDesc(),
+          adaptor.getValue());
+      return {};
+    };
 
-    rewriter.replaceOp(op, callOp);
+    GatherBlockSetup setup;
+    if (promoteGathers)
+      setup = getGatherBlockSetup(op.getTensorDesc(), /*isLoad=*/false, loc,
+                                  rewriter);
+    if (setup.promotion == GatherPromotion::None) {
+      genScattered();
+      rewriter.eraseOp(op);
+      return success();
+    }
+
+    auto genBlock = [&]() -> Value {
+      auto payload =
+          genFirstLanePayload(adaptor.getTensorDesc(), loc, rewriter);
+      Value data = adaptor.getValue();
+      if (setup.packed)
+        data = rewriter.create<vector::BitCastOp>(
+            loc, VectorType::get(setup.elems, setup.elemTy), data);
+      gen1DStoreInstrinsicCall(rewriter, loc, l1hint, l3hint, setup.elemTy,
+                               setup.elems, tdescTy.getMemorySpace(), payload,
+                               data);
+      return {};
+    };
+    auto cond = genBlockCondition(setup, op.getMask(), adaptor.getTensorDesc(),
+                                  loc, rewriter);
+    genGuardedBlock(cond, Type(), genBlock, genScattered, loc, rewriter);
+    rewriter.eraseOp(op);
     return success();
   }
+
+private:
+  bool promoteGathers;
 };
 
+// Generates a call to lsc.xatomic.* performing \p opCode on one element of
+// type \p elemTy per lane at \p addresses, for the lanes set in \p pred.
+// \p src0 and \p src1 are the operands of the atomic, of type
+// vector<simd_lanes x elemTy>, or null if it takes fewer. Like loads and
+// stores, 16-bit data is held in 32-bit containers (u16c32b). Returns the
+// values in memory before the update.
+static Value genAtomicIntrinsicCall(ConversionPatternRewriter &rewriter,
+                                    Location &loc, int simd_lanes,
+                                    enum LSC_OP opCode, Type elemTy,
+                                    xegpu::MemorySpace scope, Value pred,
+                                    Value addresses, Value src0 = {},
+                                    Value src1 = {}) {
+  auto bitWidth = elemTy.getIntOrFloatBitWidth();
+  auto intTy = VectorType::get(simd_lanes, rewriter.getIntegerType(bitWidth));
+  auto dataTy = VectorType::get(simd_lanes, bitWidth == 64 ? i64Ty : i32Ty);
+  auto dataum = bitWidth == 16   ? LSC_DATA_SIZE_16c32b
+                : bitWidth == 64 ? LSC_DATA_SIZE_64b
+                                 : LSC_DATA_SIZE_32b;
+
+  auto kind = scope == xegpu::MemorySpace::SLM ? "slm" : "stateless";
+  auto addrBits = scope == xegpu::MemorySpace::SLM ? 32 : 64;
+  auto funcName =
+      llvm::formatv("llvm.genx.lsc.xatomic.{0}.{1}.v{2}i1.v{2}i{3}", kind,
+                    convertVectorType(dataTy).first, simd_lanes, addrBits)
+          .str();
+
+  auto opCodeEncode = i8_val(opCode);
+  auto cacheEncode = i8_val(LSC_CACHING_UNCACHED);
+  auto addrScaleEncode = i16_val(1);
+  auto immOffsetEncode = i32_val(0);
+  auto dataumEncode = i8_val(dataum);
+  auto vectSizeEncode = i8_val(LSC_DATA_ELEMS_1);
+  auto transposeEncode = i8_val(LSC_DATA_ORDER_NONTRANSPOSE);
+  Value undef = rewriter.create<mlir::ub::PoisonOp>(loc, dataTy);
+
+  auto toContainer = [&](Value value) -> Value {
+    if (!value)
+      return undef;
+    if (value.getType() != intTy)
+      value = rewriter.create<vector::BitCastOp>(loc, intTy, value);
+    if (intTy != dataTy)
+      value = rewriter.create<arith::ExtUIOp>(loc, dataTy, value);
+    return value;
+  };
+  auto data0 = toContainer(src0);
+  auto data1 = toContainer(src1);
+
+  auto surfaceEncode = i32_val(0);
+  SmallVector<Value> args{pred,        opCodeEncode,    cacheEncode,
+                          cacheEncode, addrScaleEncode, immOffsetEncode,
+                          dataumEncode, vectSizeEncode, transposeEncode,
+                          pred,        addresses,       data0,
+                          data1,       surfaceEncode,   undef};
+  Value result =
+      createFuncCall(rewriter, loc, funcName, TypeRange{dataTy}, args, false)
+          ->getResult(0);
+
+  if (intTy != dataTy)
+    result = rewriter.create<arith::TruncIOp>(loc, intTy, result);
+  auto resultTy = VectorType::get(simd_lanes, elemTy);
+  if (resultTy != intTy)
+    result = rewriter.create<vector::BitCastOp>(loc, resultTy, result);
+  return result;
+}
+
+// Emulates the atomic \p kind with \p value at \p addresses, for the lanes
+// set in \p mask, by a compare-and-swap loop: each lane computes its update
+// from the value it last saw in memory, and retries with the value found
+// instead until the swap succeeds. The loop takes one iteration when lanes
+// do not contend. Returns the values the updates were applied to.
+static Value genAtomicCASLoop(ConversionPatternRewriter &rewriter,
+                              Location &loc, int simd_lanes,
+                              arith::AtomicRMWKind kind,
+                              std::optional<xegpu::CachePolicy> l1,
+                              std::optional<xegpu::CachePolicy> l3,
+                              xegpu::MemorySpace scope, Value mask,
+                              Value addresses, Value value) {
+  auto valueTy = cast<VectorType>(value.getType());
+  auto elemTy = valueTy.getElementType();
+  auto intTy = VectorType::get(
+      simd_lanes, rewriter.getIntegerType(elemTy.getIntOrFloatBitWidth()));
+  auto toBits = [&](Value v) -> Value {
+    if (v.getType() == intTy)
+      return v;
+    return rewriter.create<vector::BitCastOp>(loc, intTy, v);
+  };
+
+  auto expected = genLoadIntrinsicCallWithC32BConversion(
+      rewriter, loc, valueTy, simd_lanes, mask, l1, l3, elemTy, 1, scope,
+      addresses);
+
+  // loop-carried values: the lanes still to update, the values they expect
+  // in memory, and the results of the lanes done.
+  SmallVector<Type> types{mask.getType(), valueTy, valueTy};
+  SmallVector<Location> locs(types.size(), loc);
+  auto whileOp = rewriter.create<scf::WhileOp>(
+      loc, types, ValueRange{mask, expected, expected});
+
+  auto *before = rewriter.createBlock(&whileOp.getBefore(), {}, types, locs);
+  Value any = rewriter.create<vector::ReductionOp>(
+      loc, vector::CombiningKind::OR, before->getArgument(0));
+  rewriter.create<scf::ConditionOp>(loc, any, before->getArguments());
+
+  auto *after = rewriter.createBlock(&whileOp.getAfter(), {}, types, locs);
+  Value active = after->getArgument(0);
+  Value old = after->getArgument(1);
+  Value result = after->getArgument(2);
+  Value desired = kind == arith::AtomicRMWKind::assign
+                      ? value
+                      : arith::getReductionOp(kind, rewriter, loc, old, value);
+  auto found =
+      genAtomicIntrinsicCall(rewriter, loc, simd_lanes, LSC_ATOMIC_ICAS,
+                             elemTy, scope, active, addresses, old, desired);
+  // compare bits rather than values, so that NaNs and signed zeros are
+  // matched exactly.
+  Value swapped = rewriter.create<arith::CmpIOp>(
+      loc, arith::CmpIPredicate::eq, toBits(found), toBits(old));
+  Value done = rewriter.create<arith::AndIOp>(loc, active, swapped);
+  result = rewriter.create<arith::SelectOp>(loc, done, old, result);
+  Value retry = rewriter.create<arith::CmpIOp>(loc, arith::CmpIPredicate::ne,
+                                               toBits(found), toBits(old));
+  active = rewriter.create<arith::AndIOp>(loc, active, retry);
+  rewriter.create<scf::YieldOp>(loc, ValueRange{active, found, result});
+
+  rewriter.setInsertionPointAfter(whileOp);
+  return whileOp.getResult(2);
+}
+
+// A pattern lowering xegpu.atomic_rmw to lsc.xatomic.* intrinsic. Kinds the
+// target performs natively, see XeuArchInterface::hasNativeAtomic, e.g.
+// fadd, fmin and fmax on f32 and f16, map to a single message. The others,
+// e.g. bf16 data or mulf, are emulated with a compare-and-swap loop, which
+// is only supported for TensorDescs without chunk_size.
 class AtomicPattern : public OpConversionPattern<AtomicRMWOp> {
 public:
-  using OpConversionPattern<AtomicRMWOp>::OpConversionPattern;
+  AtomicPattern(TypeConverter &converter, MLIRContext *context,
+                std::shared_ptr<XeuArchInterface> uArch)
+      : OpConversionPattern<AtomicRMWOp>(converter, context),
+        uArch(std::move(uArch)) {}
+
   LogicalResult
   matchAndRewrite(AtomicRMWOp op, OpAdaptor adaptor,
                   ConversionPatternRewriter &rewriter) const override {
@@ -1162,6 +1680,35 @@ public:
     auto rank = tileType.getRank();
     assert(rank <= 2 && "only support 1d/2d for now");
     auto loc = op->getLoc();
+    auto elemTy = tileType.getElementType();
+    auto simd_lanes = tileType.getShape()[0];
+    auto scope = tileType.getMemorySpace();
+    auto kind = op.getKind();
+
+    if (rank == 1 && !uArch->hasNativeAtomic(kind, elemTy)) {
+      auto bitWidth = elemTy.getIntOrFloatBitWidth();
+      if (bitWidth != 16 && bitWidth != 32 && bitWidth != 64)
+        return rewriter.notifyMatchFailure(
+            op, "only 16/32/64-bit data can be updated atomically.");
+      auto value = rewriter.create<vector::ShapeCastOp>(
+          loc, VectorType::get(simd_lanes, elemTy), adaptor.getValue());
+      auto result = genAtomicCASLoop(
+          rewriter, loc, simd_lanes, kind, xegpu::CachePolicy::UNCACHED,
+          xegpu::CachePolicy::UNCACHED, scope, adaptor.getMask(),
+          adaptor.getTensorDesc(), value);
+      rewriter.replaceOp(op, result);
+      return success();
+    }
+
+    if (rank == 1) {
+      auto result = genAtomicIntrinsicCall(
+          rewriter, loc, simd_lanes,
+          static_cast<LSC_OP>(encodeOpcode(kind)), elemTy, scope,
+          adaptor.getMask(), adaptor.getTensorDesc(), adaptor.getValue());
+      rewriter.replaceOp(op, result);
+      return success();
+    }
+
     auto createIntConstant = [&](Type type, unsigned value) {
       auto attr = rewriter.getIntegerAttr(type, value);
       return rewriter.create<arith::ConstantOp>(loc, type, attr);
@@ -1229,6 +1776,9 @@ public:
     rewriter.replaceOp(op, cast);
     return success();
   }
+
+private:
+  std::shared_ptr<XeuArchInterface> uArch;
 };
 
 class FencePattern : public OpConversionPattern<FenceOp> {
@@ -1296,17 +1846,21 @@ public:
 
 } // namespace LSC
 
-void populateAtomicAndFenceLSCPatterns(TypeConverter &converter,
-                                       RewritePatternSet &patterns) {
-  patterns.add<LSC::AtomicPattern, LSC::FencePattern>(converter,
-                                                      patterns.getContext());
+void populateAtomicAndFenceLSCPatterns(
+    TypeConverter &converter, RewritePatternSet &patterns,
+    std::shared_ptr<XeuArchInterface> uArch) {
+  patterns.add<LSC::AtomicPattern>(converter, patterns.getContext(),
+                                   std::move(uArch));
+  patterns.add<LSC::FencePattern>(converter, patterns.getContext());
 }
 
 void populateLoadStoreLSCPatterns(TypeConverter &converter,
-                                  RewritePatternSet &patterns) {
+                                  RewritePatternSet &patterns,
+                                  bool promoteGathers) {
   patterns.add<LSC::LoadNdPattern, LSC::StoreNdPattern, LSC::PrefetchNdPattern,
-               LSC::LoadGatherPattern, LSC::StoreScatterPattern,
                LSC::PrefetchPattern>(converter, patterns.getContext());
+  patterns.add<LSC::LoadGatherPattern, LSC::StoreScatterPattern>(
+      converter, patterns.getContext(), promoteGathers);
 }
 
 } // namespace imex
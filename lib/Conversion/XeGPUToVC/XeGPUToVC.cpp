@@ -17,6 +17,7 @@
 #include "imex/Conversion/ArithToVC/ArithToVC.h"
 #include "imex/Conversion/MathToVC/MathToVC.h"
 #include "imex/Utils/VCUtils.h"
+#include "imex/Utils/XeArch.h"
 #include "imex/Utils/XeCommon.h"
 #include "mlir/Conversion/LLVMCommon/TypeConverter.h"
 #include "mlir/Dialect/Arith/IR/Arith.h"
@@ -62,10 +63,13 @@ using mlir::xegpu::UpdateOffsetOp;
 
 namespace imex {
 
-extern void populateAtomicAndFenceLSCPatterns(TypeConverter &converter,
-                                              RewritePatternSet &patterns);
+extern void
+populateAtomicAndFenceLSCPatterns(TypeConverter &converter,
+                                  RewritePatternSet &patterns,
+                                  std::shared_ptr<XeuArchInterface> uArch);
 extern void populateLoadStoreLSCPatterns(TypeConverter &converter,
-                                         RewritePatternSet &patterns);
+                                         RewritePatternSet &patterns,
+                                         bool promoteGathers);
 
 static bool isZero(OpFoldResult ofr) { return isConstantIntValue(ofr, 0); }
 
@@ -484,6 +488,10 @@ public:
         return (uint8_t)GenPrecision::FP16;
       else if (type.isTF32())
         return (uint8_t)GenPrecision::TF32;
+      // signless integers are treated as signed, as in arith.
+      else if (type.isInteger(8))
+        return (uint8_t)(type.isUnsignedInteger() ? GenPrecision::U8
+                                                  : GenPrecision::S8);
       else {
         assert(0 && "add more support");
         return (uint8_t)GenPrecision::INVALID;
@@ -525,9 +533,13 @@ public:
       auto prec2Arg = createIntConstant(i32Type, prec2);
       auto sdArg = createIntConstant(i32Type, sd);
       auto rcArg = createIntConstant(i32Type, rc);
-      auto signless = createIntConstant(i32Type, 0);
+      // the signedness of the result and of the accumulator, only
+      // meaningful for integer dpas.
+      auto elemTy = resultType.getElementType();
+      auto isSigned = createIntConstant(
+          i32Type, elemTy.isInteger() && !elemTy.isUnsignedInteger());
       args.assign({adaptor.getAcc(), rhs, lhs, prec1Arg, prec2Arg, sdArg, rcArg,
-                   signless, signless});
+                   isSigned, isSigned});
     }
     funcName += resultName;
     funcName += ".";
@@ -580,11 +592,26 @@ public:
     auto loc = op.getLoc();
     auto nbarrier_id = op.getNbarrierId();
 
-    // a participant is both a producer or a consumer (0)
+    // a participant is both a producer or a consumer (0), unless its role
+    // is given, in which case the participants are split in producers and
+    // consumers.
     auto nbarrier_role = i8_val(0);
     auto num_participants = op.getParticipantThreadNum();
     Value num_producers = num_participants;
     Value num_consumers = num_participants;
+    auto roleAttr = op->getAttrOfType<IntegerAttr>(nbarrierRoleAttrName);
+    auto producersAttr =
+        op->getAttrOfType<IntegerAttr>(nbarrierProducersAttrName);
+    if (roleAttr && roleAttr.getInt() !=
+                        static_cast<int64_t>(NbarrierRole::ProducerConsumer)) {
+      if (!producersAttr)
+        return rewriter.notifyMatchFailure(
+            op, "number of producers is required with a nbarrier role");
+      nbarrier_role = i8_val(roleAttr.getInt());
+      num_producers = i8_val(producersAttr.getInt());
+      num_consumers = rewriter.createOrFold<arith::SubIOp>(
+          loc, num_participants, num_producers);
+    }
 
     auto nbarrier = rewriter.create<::mlir::UnrealizedConversionCastOp>(
         loc, ::mlir::TypeRange{op.getType()},
@@ -678,6 +705,11 @@ struct XeGPUToVCPass : public imex::impl::ConvertXeGPUToVCBase<XeGPUToVCPass> {
 
   void runOnOperation() override {
     gpu::GPUModuleOp m = getOperation();
+    auto uArch = getXeuArch(device);
+    if (!uArch) {
+      m.emitOpError("Invalid device: ") << device;
+      return signalPassFailure();
+    }
     TypeConverter typeConverter;
     RewritePatternSet patterns(&getContext());
     ConversionTarget target(getContext());
@@ -754,9 +786,9 @@ struct XeGPUToVCPass : public imex::impl::ConvertXeGPUToVCBase<XeGPUToVCPass> {
         typeConverter, patterns.getContext());
 
     // Ops to LSC only patterns
-    populateAtomicAndFenceLSCPatterns(typeConverter, patterns);
+    populateAtomicAndFenceLSCPatterns(typeConverter, patterns, uArch);
 
-    populateLoadStoreLSCPatterns(typeConverter, patterns);
+    populateLoadStoreLSCPatterns(typeConverter, patterns, promoteGathers);
 
     populateArithToVCPatterns(typeConverter, patterns);
 
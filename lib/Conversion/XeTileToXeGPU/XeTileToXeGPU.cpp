@@ -28,6 +28,7 @@
 #include "imex/Utils/XeArch.h"
 #include "imex/Utils/XeCommon.h"
 #include "mlir/Dialect/MemRef/IR/MemRef.h"
+#include "llvm/ADT/DenseMap.h"
 
 #include <memory>
 
@@ -894,6 +895,75 @@ private:
   std::shared_ptr<XeuArchInterface> uArchInterface = nullptr;
 };
 
+// Returns the ancestor of \p op in \p block, or null if there is none.
+static Operation *getAncestorInBlock(Operation *op, Block &block) {
+  while (op && op->getBlock() != &block)
+    op = op->getParentOp();
+  return op;
+}
+
+// Reorders the dpas ops of \p block whose repeat count is the one of the DPAS
+// config of \p uArch. Through their accumulators, these ops form chains, one
+// per accumulator sub-tile along K, which stays in registers. Blocking emits
+// each chain back to back, so every dpas waits for the result of the previous
+// one. The ops are instead issued in rounds taking the next op of every chain,
+// and the ops of a round sharing the B operand are issued back to back, so the
+// systolic pipeline reuses it:
+//
+//   for i, j, k: C[i][j] += A[i][k] * B[k][j]
+//     =>
+//   for k, j, i: C[i][j] += A[i][k] * B[k][j]
+//
+// The dpas ops are moved after the last of them, so the block is left as is
+// if their results are used before.
+static void scheduleDpasOps(Block &block, XeuArchInterface &uArch) {
+  llvm::SmallVector<xegpu::DpasOp> ops;
+  for (auto op : block.getOps<xegpu::DpasOp>()) {
+    auto lhsTy = op.getLhsType();
+    auto config = uArch.getDPASConfig(
+        lhsTy.getElementTypeBitWidth(),
+        op.getRhsType().getElementTypeBitWidth(),
+        op.getAcc() ? op.getAcc().getType().getElementTypeBitWidth()
+                    : op.getResultType().getElementTypeBitWidth(),
+        op.getResultType().getElementTypeBitWidth());
+    if (lhsTy.getShape()[0] == static_cast<int64_t>(config.m))
+      ops.push_back(op);
+  }
+  if (ops.size() < 2)
+    return;
+
+  // The position of each op in its chain and the first use of each B operand.
+  llvm::DenseMap<Operation *, size_t> depths;
+  llvm::DenseMap<Value, size_t> rhsOrder;
+  for (auto op : ops) {
+    auto prev = op.getAcc() ? op.getAcc().getDefiningOp<xegpu::DpasOp>()
+                            : nullptr;
+    auto it = prev ? depths.find(prev) : depths.end();
+    depths[op] = it != depths.end() && prev->hasOneUse() ? it->second + 1 : 0;
+    rhsOrder.try_emplace(op.getRhs(), rhsOrder.size());
+  }
+
+  auto last = ops.back();
+  for (auto op : ops) {
+    for (auto *user : op->getUsers()) {
+      if (depths.count(user))
+        continue;
+      auto *ancestor = getAncestorInBlock(user, block);
+      if (!ancestor || !last->isBeforeInBlock(ancestor))
+        return;
+    }
+  }
+
+  llvm::SmallVector<xegpu::DpasOp> schedule(ops);
+  llvm::stable_sort(schedule, [&](xegpu::DpasOp lhs, xegpu::DpasOp rhs) {
+    return std::make_pair(depths[lhs], rhsOrder[lhs.getRhs()]) <
+           std::make_pair(depths[rhs], rhsOrder[rhs.getRhs()]);
+  });
+  auto *anchor = last->getNextNode();
+  for (auto op : schedule)
+    op->moveBefore(anchor);
+}
+
 // Full Pass
 struct ConvertXeTileToXeGPUPass // convert XeTile to XeGPU
     : public imex::impl::ConvertXeTileToXeGPUBase<ConvertXeTileToXeGPUPass> {
@@ -903,9 +973,7 @@ struct ConvertXeTileToXeGPUPass // convert XeTile to XeGPU
     if (this->device.getNumOccurrences() == 0) {
       this->device = deviceName;
 
-      if (deviceName == "pvc") {
-        uArchInterface = std::make_shared<XePVCuArch>();
-      }
+      uArchInterface = imex::getXeuArch(deviceName);
     }
   }
 
@@ -914,9 +982,8 @@ struct ConvertXeTileToXeGPUPass // convert XeTile to XeGPU
       function_ref<LogicalResult(const llvm::Twine &)> errorHandler) override {
     if (failed(Pass::initializeOptions(options, errorHandler)))
       return failure();
-    if (device == "pvc")
-      uArchInterface = std::make_shared<imex::XePVCuArch>();
-    else
+    uArchInterface = imex::getXeuArch(device);
+    if (!uArchInterface)
       return errorHandler(llvm::Twine("Invalid device: ") + device);
     return success();
   }
@@ -1055,6 +1122,13 @@ struct ConvertXeTileToXeGPUPass // convert XeTile to XeGPU
 
     if (failed(applyPartialConversion(mod, target, std::move(patterns))))
       return signalPassFailure();
+
+    if (scheduleDpas) {
+      llvm::SmallVector<Block *> blocks;
+      mod.walk([&](Block *block) { blocks.push_back(block); });
+      for (auto *block : blocks)
+        scheduleDpasOps(*block, *uArchInterface);
+    }
   }
 
 private:
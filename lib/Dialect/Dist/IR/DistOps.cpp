@@ -16,6 +16,7 @@
 #include <imex/Dialect/Dist/Utils/Utils.h>
 #include <imex/Dialect/NDArray/IR/NDArrayOps.h>
 #include <imex/Utils/PassUtils.h>
+#include <llvm/ADT/STLExtras.h>
 #include <llvm/ADT/TypeSwitch.h>
 #include <mlir/IR/Builders.h>
 #include <mlir/IR/DialectImplementation.h>
@@ -218,6 +219,47 @@ void PartsOfOp::build(::mlir::OpBuilder &odsBuilder,
   return ::mlir::failure();
 }
 
+::mlir::LogicalResult DefaultPartitionOp::verify() {
+  auto grid = getGrid();
+  if (!grid) {
+    return ::mlir::success();
+  }
+  if (grid->size() != getGShape().size()) {
+    return emitOpError("expected one grid entry per dimension");
+  }
+  if (llvm::any_of(*grid, [](int64_t g) { return g <= 0; })) {
+    return emitOpError("grid entries must be positive");
+  }
+  return ::mlir::success();
+}
+
+::mlir::LogicalResult LocalBoundingBoxOp::verify() {
+  if (isGridPartitioned(getTargetOffsets()) ||
+      isGridPartitioned(getTargetSizes()) ||
+      isGridPartitioned(getBBOffsets()) || isGridPartitioned(getBBSizes())) {
+    return emitOpError("grid partitions are not supported");
+  }
+  return ::mlir::success();
+}
+
+::mlir::LogicalResult LocalCoreOp::verify() {
+  if (hasGridPartition(getArray()) || isGridPartitioned(getTargetOffsets()) ||
+      isGridPartitioned(getTargetSizes()) ||
+      isGridPartitioned(getCoreOffsets()) ||
+      isGridPartitioned(getCoreSizes())) {
+    return emitOpError("grid partitions are not supported");
+  }
+  return ::mlir::success();
+}
+
+::mlir::LogicalResult RePartitionOp::verify() {
+  if (hasGridPartition(getArray()) || isGridPartitioned(getTargetOffsets()) ||
+      isGridPartitioned(getTargetSizes())) {
+    return emitOpError("grid partitions are not supported");
+  }
+  return ::mlir::success();
+}
+
 ::mlir::LogicalResult EWBinOp::verify() {
   if (isDist(getResult()) && isDist(getLhs()) && isDist(getRhs())) {
     return ::mlir::success();
@@ -31,6 +31,21 @@
 /// e.g. those which come from one EWBinOp and have only one use and that in a
 /// another EWBinOp get simply erased.
 ///
+/// Before all of this, partitions get propagated forward from creators and
+/// RePartitionOps through copies, identity views and elementwise ops.
+/// RePartitionOps whose input provably has the requested partition already,
+/// e.g. operands of elementwise ops which are default-partitioned like the
+/// result, get erased.
+///
+/// Optionally (batch-exchanges), RePartitionOps of different arrays of the
+/// same team finally get moved next to each other. Their halo exchanges then
+/// get started back-to-back and are in flight at the same time, instead of
+/// waiting for the previous exchange to complete.
+///
+/// Optionally (halo-depth), views of results of elementwise operations first
+/// get recomputed from views of the operations' inputs. This trades redundant
+/// computation for fewer, but wider halo exchanges in chains of stencils.
+///
 //===----------------------------------------------------------------------===//
 
 #include <imex/Dialect/Dist/IR/DistOps.h>
@@ -45,6 +60,9 @@
 #include <mlir/Dialect/Func/IR/FuncOps.h>
 #include <mlir/IR/BuiltinTypes.h>
 #include <mlir/Interfaces/ShapedOpInterfaces.h>
+#include <mlir/Interfaces/SideEffectInterfaces.h>
+
+#include <llvm/ADT/SmallPtrSet.h>
 
 #include <iostream>
 #include <set>
@@ -359,6 +377,325 @@ struct DistCoalescePass
                  : n;
   }
 
+  /// Move RePartitionOps with target parts of different arrays of the same
+  /// team in the same block up to the previous one, together with the
+  /// computation of their target parts. InsertSliceOps and dependencies with
+  /// side effects act as barriers.
+  void batchRePartitions(::mlir::DominanceInfo &dom, ::mlir::Operation *root) {
+    ::mlir::SmallVector<::imex::dist::RePartitionOp> rpOps;
+    root->walk([&](::imex::dist::RePartitionOp op) {
+      if (!op.getTargetOffsets().empty()) {
+        rpOps.emplace_back(op);
+      }
+    });
+
+    auto getTeam = [](::mlir::Value val) {
+      return getDistEnv(mlir::cast<::imex::ndarray::NDArrayType>(val.getType()))
+          .getTeam();
+    };
+
+    ::imex::dist::RePartitionOp prev;
+    for (auto rp : rpOps) {
+      if (!prev || prev->getBlock() != rp->getBlock() ||
+          prev.getArray() == rp.getArray() ||
+          getTeam(prev.getArray()) != getTeam(rp.getArray())) {
+        prev = rp;
+        continue;
+      }
+
+      // we must not move across writes
+      bool canMove = true;
+      for (auto op = prev->getNextNode(); op != rp && canMove;
+           op = op->getNextNode()) {
+        op->walk([&](::imex::ndarray::InsertSliceOp) { canMove = false; });
+      }
+
+      ::mlir::SmallVector<::mlir::Operation *> toBeMoved;
+      if (canMove && canMoveAfter(dom, rp, prev, toBeMoved)) {
+        // the same op might be required by several operands
+        ::mlir::SmallVector<::mlir::Operation *> deps;
+        ::llvm::SmallPtrSet<::mlir::Operation *, 8> seen;
+        for (auto dop : toBeMoved) {
+          if (seen.insert(dop).second) {
+            deps.emplace_back(dop);
+          }
+        }
+        for (auto dop : deps) {
+          if (dop != rp && !::mlir::isMemoryEffectFree(dop)) {
+            canMove = false;
+            break;
+          }
+        }
+        if (canMove) {
+          ::mlir::Operation *curr = prev;
+          for (auto dop : deps) {
+            dop->moveAfter(curr);
+            curr = dop;
+          }
+        }
+      }
+      prev = rp;
+    }
+  }
+
+  /// Compose the view \p offs, \p strides of the SubviewOp \p sv into a view
+  /// of the source of \p sv.
+  static void composeView(const ::mlir::Location &loc,
+                          ::mlir::OpBuilder &builder,
+                          ::imex::dist::SubviewOp sv, ::imex::ValVec &offs,
+                          ::imex::ValVec &strides) {
+    auto svOffs =
+        getMixedAsValues(loc, builder, sv.getOffsets(), sv.getStaticOffsets());
+    auto svStrides =
+        getMixedAsValues(loc, builder, sv.getStrides(), sv.getStaticStrides());
+    for (size_t i = 0; i < offs.size(); ++i) {
+      auto stride = easyIdx(loc, builder, svStrides[i]);
+      offs[i] = (easyIdx(loc, builder, svOffs[i]) +
+                 easyIdx(loc, builder, offs[i]) * stride)
+                    .get();
+      strides[i] = (easyIdx(loc, builder, strides[i]) * stride).get();
+    }
+  }
+
+  /// Recompute the view \p sv of the result of an EWBinOp or EWUnyOp from
+  /// views of the op's inputs. Repartitioning the result is no longer needed,
+  /// the halo of the inputs grows by the halo of the view instead.
+  /// Inputs must be default-repartitioned arrays of the same shape as the
+  /// result (or 0d arrays). InsertSliceOps between the elementwise op and the
+  /// view act as barriers.
+  /// @return recomputed view or null if not possible
+  ::mlir::Value recomputeView(::mlir::IRRewriter &builder,
+                              ::imex::dist::SubviewOp sv) {
+    auto ewOp = sv.getSource().getDefiningOp();
+    if (!ewOp || !::mlir::isa<::imex::dist::EWBinOp, ::imex::dist::EWUnyOp>(
+                     ewOp)) {
+      return {};
+    }
+    auto nInputs = ::mlir::isa<::imex::dist::EWBinOp>(ewOp) ? 2u : 1u;
+    if (ewOp->getNumOperands() > nInputs ||
+        ewOp->getBlock() != sv->getBlock() || !sv.getTargetOffsets().empty()) {
+      return {};
+    }
+
+    auto resTyp =
+        mlir::cast<::imex::ndarray::NDArrayType>(ewOp->getResult(0).getType());
+    for (auto input : ewOp->getOperands()) {
+      if (mlir::cast<::imex::ndarray::NDArrayType>(input.getType())
+              .getRank() == 0) {
+        continue;
+      }
+      auto rp = input.getDefiningOp<::imex::dist::RePartitionOp>();
+      if (!rp || !rp.getTargetOffsets().empty() ||
+          mlir::cast<::imex::ndarray::NDArrayType>(rp.getArray().getType())
+                  .getShape() != resTyp.getShape()) {
+        return {};
+      }
+    }
+
+    // we must not read inputs after they got written to
+    for (auto op = ewOp->getNextNode(); op != sv.getOperation();
+         op = op->getNextNode()) {
+      bool written = false;
+      op->walk([&](::imex::ndarray::InsertSliceOp) { written = true; });
+      if (written) {
+        return {};
+      }
+    }
+
+    auto loc = sv.getLoc();
+    auto svTyp = mlir::cast<::imex::ndarray::NDArrayType>(sv.getType());
+    auto rank = svTyp.getRank();
+    ::mlir::SmallVector<int64_t> dynIdx(rank, ::mlir::ShapedType::kDynamic);
+    builder.setInsertionPoint(sv);
+    auto offs =
+        getMixedAsValues(loc, builder, sv.getOffsets(), sv.getStaticOffsets());
+    auto strides =
+        getMixedAsValues(loc, builder, sv.getStrides(), sv.getStaticStrides());
+
+    ::imex::ValVec nOprnds;
+    for (auto input : ewOp->getOperands()) {
+      auto rp = input.getDefiningOp<::imex::dist::RePartitionOp>();
+      if (!rp) {
+        nOprnds.emplace_back(input);
+        continue;
+      }
+      ::mlir::Value src = rp.getArray();
+      auto vOffs = offs;
+      auto vStrides = strides;
+      auto srcSv = src.getDefiningOp<::imex::dist::SubviewOp>();
+      if (srcSv && srcSv.getTargetOffsets().empty()) {
+        composeView(loc, builder, srcSv, vOffs, vStrides);
+        src = srcSv.getSource();
+      }
+      auto elTyp = mlir::cast<::imex::ndarray::NDArrayType>(src.getType())
+                       .getElementType();
+      auto vTyp = mlir::cast<::imex::ndarray::NDArrayType>(svTyp.clone(elTyp));
+      auto view = builder.create<::imex::dist::SubviewOp>(
+          loc, vTyp, src, vOffs, sv.getSizes(), vStrides, dynIdx,
+          sv.getStaticSizes(), dynIdx, ::mlir::ValueRange{},
+          ::mlir::ValueRange{});
+      nOprnds.emplace_back(createRePartition(loc, builder, view));
+    }
+
+    auto nOp = builder.clone(*ewOp);
+    nOp->setOperands(nOprnds);
+    nOp->getResult(0).setType(svTyp);
+    return nOp->getResult(0);
+  }
+
+  /// Deep halos: Views of results of elementwise operations get recomputed
+  /// from views of their inputs, up to \p depth dependent steps. A single,
+  /// wider halo exchange of the inputs then replaces the exchanges of the
+  /// intermediate results, at the cost of redundant computation.
+  void deepenHalos(::mlir::IRRewriter &builder, ::mlir::Operation *root,
+                   unsigned depth) {
+    mlir::OpBuilder::InsertionGuard guard(builder);
+    for (unsigned i = 1; i < depth; ++i) {
+      ::mlir::SmallVector<::imex::dist::SubviewOp> svOps;
+      root->walk([&](::imex::dist::SubviewOp op) { svOps.emplace_back(op); });
+
+      bool changed = false;
+      for (auto sv : svOps) {
+        if (auto nVal = recomputeView(builder, sv)) {
+          builder.replaceAllUsesWith(sv.getResult(), nVal);
+          changed = true;
+        }
+      }
+      if (!changed) {
+        break;
+      }
+    }
+
+    // erase what is no longer used, users before their producers
+    root->walk<::mlir::WalkOrder::PostOrder, ::mlir::ReverseIterator>(
+        [&](::mlir::Operation *op) {
+          if (op->use_empty() &&
+              ::mlir::isa<::imex::dist::SubviewOp, ::imex::dist::RePartitionOp,
+                          ::imex::dist::EWBinOp, ::imex::dist::EWUnyOp>(op)) {
+            builder.eraseOp(op);
+          }
+        });
+  }
+
+  /// Symbolic partition of an array: the local part given by explicit
+  /// target offsets and sizes, or the default partition of its global shape
+  /// if they are empty. The global shape is kept as it is known at the
+  /// origin of the partition, as RePartitionOps return dynamic shapes.
+  struct PartDesc {
+    ::imex::ValVec tOffs, tSizes;
+    ::mlir::SmallVector<int64_t> gShape;
+    bool isDefault() const { return tOffs.empty(); }
+    bool operator==(const PartDesc &other) const {
+      return tOffs == other.tOffs && tSizes == other.tSizes;
+    }
+  };
+
+  /// return true if the partition of val can be described by a PartDesc.
+  /// Unit-sized arrays get replicated instead of default-partitioned by
+  /// RePartitionOps.
+  static bool hasPartDesc(::mlir::Value val) {
+    auto arType = ::mlir::dyn_cast<::imex::ndarray::NDArrayType>(val.getType());
+    return arType && isDist(arType) && arType.getRank() > 0 &&
+           !arType.hasUnitSize();
+  }
+
+  /// return true if op is a SubviewOp without target part which views all
+  /// of its statically shaped source.
+  static bool isIdentityView(::imex::dist::SubviewOp op) {
+    auto srcType =
+        ::mlir::cast<::imex::ndarray::NDArrayType>(op.getSource().getType());
+    return op.getTargetOffsets().empty() && op.getOffsets().empty() &&
+           op.getSizes().empty() && op.getStrides().empty() &&
+           srcType.hasStaticShape() &&
+           op.getStaticSizes() == srcType.getShape() &&
+           ::llvm::all_of(op.getStaticOffsets(),
+                          [](int64_t o) { return o == 0; }) &&
+           ::llvm::all_of(op.getStaticStrides(),
+                          [](int64_t s) { return s == 1; });
+  }
+
+  /// Forward propagation of partitions, starting at creators and
+  /// RePartitionOps, through identity views, copies and elementwise ops.
+  /// RePartitionOps to the partition their input already has are no-ops and
+  /// get replaced by their input.
+  void elimIdentityRePartitions(::mlir::IRRewriter &builder,
+                                ::mlir::Operation *root) {
+    ::llvm::DenseMap<::mlir::Value, PartDesc> parts;
+    auto getPart = [&](::mlir::Value val) -> const PartDesc * {
+      auto it = parts.find(val);
+      return it == parts.end() ? nullptr : &it->second;
+    };
+
+    // elementwise ops without target part produce the default partition of
+    // their result. It matches the local data only if all operands which
+    // are not broadcasted have the same shape and the default partition.
+    auto isDefaultEW = [&](::mlir::Operation *op, ::mlir::ValueRange tOffs,
+                           ::imex::ValVec operands) {
+      auto resType =
+          ::mlir::cast<::imex::ndarray::NDArrayType>(op->getResultTypes()[0]);
+      if (!tOffs.empty() || !resType.hasStaticShape()) {
+        return false;
+      }
+      for (auto val : operands) {
+        auto arType = ::mlir::cast<::imex::ndarray::NDArrayType>(val.getType());
+        if (arType.getRank() < resType.getRank()) {
+          continue;
+        }
+        auto part = getPart(val);
+        if (!part || !part->isDefault() ||
+            ::llvm::ArrayRef(part->gShape) != resType.getShape()) {
+          return false;
+        }
+      }
+      return true;
+    };
+
+    ::mlir::SmallVector<::imex::dist::RePartitionOp> toElim;
+    root->walk([&](::mlir::Operation *op) {
+      if (op->getNumResults() != 1 || !hasPartDesc(op->getResult(0))) {
+        return;
+      }
+      auto res = op->getResult(0);
+      auto getShape = [](::mlir::Value val) {
+        auto arType = ::mlir::cast<::imex::ndarray::NDArrayType>(val.getType());
+        return ::mlir::SmallVector<int64_t>(arType.getShape());
+      };
+      if (isCreator(op)) {
+        parts[res] = PartDesc{{}, {}, getShape(res)};
+      } else if (auto rp = ::mlir::dyn_cast<::imex::dist::RePartitionOp>(op)) {
+        auto inPart = getPart(rp.getArray());
+        PartDesc part{rp.getTargetOffsets(), rp.getTargetSizes(),
+                      inPart ? inPart->gShape : getShape(rp.getArray())};
+        if (inPart && *inPart == part) {
+          toElim.emplace_back(rp);
+        }
+        parts[res] = std::move(part);
+      } else if (auto sv = ::mlir::dyn_cast<::imex::dist::SubviewOp>(op)) {
+        auto srcPart = getPart(sv.getSource());
+        if (srcPart && isIdentityView(sv)) {
+          parts[res] = *srcPart;
+        }
+      } else if (auto cp = ::mlir::dyn_cast<::imex::ndarray::CopyOp>(op)) {
+        if (auto srcPart = getPart(cp.getSource())) {
+          parts[res] = *srcPart;
+        }
+      } else if (auto ew = ::mlir::dyn_cast<::imex::dist::EWBinOp>(op)) {
+        if (isDefaultEW(op, ew.getTargetOffsets(),
+                        {ew.getLhs(), ew.getRhs()})) {
+          parts[res] = PartDesc{{}, {}, getShape(res)};
+        }
+      } else if (auto ew = ::mlir::dyn_cast<::imex::dist::EWUnyOp>(op)) {
+        if (isDefaultEW(op, ew.getTargetOffsets(), {ew.getSrc()})) {
+          parts[res] = PartDesc{{}, {}, getShape(res)};
+        }
+      }
+    });
+
+    for (auto rp : toElim) {
+      builder.replaceOp(rp, rp.getArray());
+    }
+  }
+
   // This pass tries to combine multiple RePartitionOps into one.
   // Dependent operations (like SubviewOp) get adequately annotated.
   //
@@ -375,6 +712,13 @@ struct DistCoalescePass
     auto root = this->getOperation();
     ::mlir::IRRewriter builder(&getContext());
 
+    if (halo_depth > 1) {
+      deepenHalos(builder, root, halo_depth);
+    }
+
+    // drop RePartitionOps which keep the partition of their input
+    elimIdentityRePartitions(builder, root);
+
     // back-propagate targets from RePartitionOps
 
     ::std::set<::imex::dist::RePartitionOp> rpToElimNew;
@@ -652,6 +996,10 @@ struct DistCoalescePass
       }     // for (auto grpP : opsGroups)
     }       // !rpOps.empty()
 
+    if (batch_exchanges) {
+      batchRePartitions(this->getAnalysis<::mlir::DominanceInfo>(), root);
+    }
+
     // Get rid of dummy casts
     for (auto op : dummyCasts) {
       op.getResult(0).replaceAllUsesWith(op->getOperand(0));
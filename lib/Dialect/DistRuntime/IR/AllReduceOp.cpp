@@ -0,0 +1,33 @@
+//===- AllReduceOp.cpp - distruntime dialect  -------------------*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file implements the AllReduceOp of the DistRuntime dialect.
+///
+//===----------------------------------------------------------------------===//
+
+#include <imex/Dialect/DistRuntime/IR/DistRuntimeOps.h>
+
+namespace imex {
+namespace distruntime {
+
+void AllReduceOp::build(::mlir::OpBuilder &odsBuilder,
+                        ::mlir::OperationState &odsState, ::mlir::Attribute op,
+                        ::mlir::Value data) {
+  build(odsBuilder, odsState,
+        ::imex::distruntime::AsyncHandleType::get(data.getContext()),
+        data.getType(), op, data);
+}
+
+::mlir::SmallVector<::mlir::Value> AllReduceOp::getDependent() {
+  return {getResult()};
+}
+
+} // namespace distruntime
+} // namespace imex
@@ -14,7 +14,10 @@
 
 #include <imex/Dialect/DistRuntime/IR/DistRuntimeOps.h>
 #include <imex/Dialect/NDArray/IR/NDArrayOps.h>
+#include <imex/Dialect/NDArray/Utils/Utils.h>
 #include <imex/Utils/PassUtils.h>
+#include <mlir/Dialect/Arith/IR/Arith.h>
+#include <mlir/Dialect/Utils/StaticValueUtils.h>
 
 namespace imex {
 namespace distruntime {
@@ -172,9 +175,101 @@ public:
   }
 };
 
+/// Returns true if \p a and \p b are the same index on every team member.
+static bool isSameIndex(::mlir::Value a, ::mlir::Value b) {
+  if (a == b)
+    return true;
+  auto cA = ::mlir::getConstantIntValue(a);
+  auto cB = ::mlir::getConstantIntValue(b);
+  return cA && cB && *cA == *cB;
+}
+
+/// Pattern to remove GetHaloOps which provably need no data from other team
+/// members, e.g. because the requested bounding box is the locally owned
+/// part. The halos get replaced by empty arrays and the waits for the
+/// exchange are removed. All team members run the same program, so the proof
+/// holds for all of them: no member skips an exchange that another one
+/// takes part in.
+class GetHaloOpLocalFolder final
+    : public mlir::OpRewritePattern<::imex::distruntime::GetHaloOp> {
+public:
+  using mlir::OpRewritePattern<
+      ::imex::distruntime::GetHaloOp>::OpRewritePattern;
+
+  mlir::LogicalResult
+  matchAndRewrite(::imex::distruntime::GetHaloOp op,
+                  ::mlir::PatternRewriter &rewriter) const override {
+    auto lData = op.getLocal();
+    auto lType = mlir::dyn_cast<::imex::ndarray::NDArrayType>(lData.getType());
+    if (!lType || lType.getRank() == 0)
+      return ::mlir::failure();
+    // unit-sized arrays get one-element halos from neighbors
+    auto gShape = ::imex::getShapeFromValues(op.getGShape());
+    if (!::mlir::ShapedType::isDynamicShape(gShape) &&
+        ::imex::ndarray::isUnitShape(gShape))
+      return ::mlir::failure();
+    // the exchange may only be waited for
+    for (auto user : op.getHandle().getUsers())
+      if (!mlir::isa<::imex::distruntime::WaitOp>(user))
+        return ::mlir::failure();
+
+    // we split dim 0 only
+    auto lOff = op.getLOffsets()[0];
+    auto bbOff = op.getBbOffsets()[0];
+    auto bbSize = op.getBbSizes()[0];
+    if (auto defOp = lData.getDefiningOp<::imex::ndarray::CastOp>())
+      lData = defOp.getSource();
+    auto lSize =
+        mlir::cast<::imex::ndarray::NDArrayType>(lData.getType()).getDimSize(0);
+    auto sLOff = ::mlir::getConstantIntValue(lOff);
+    auto sBbOff = ::mlir::getConstantIntValue(bbOff);
+    auto sBbSize = ::mlir::getConstantIntValue(bbSize);
+    bool sLSize = !::mlir::ShapedType::isDynamic(lSize);
+
+    // the halos are empty if the bounding box is within the local data
+    bool isLocal = false;
+    if (sBbSize && *sBbSize == 0) {
+      isLocal = true;
+    } else if (sLOff && sBbOff && sBbSize && sLSize) {
+      isLocal = *sBbOff >= *sLOff && *sBbOff + *sBbSize <= *sLOff + lSize;
+    } else if (isSameIndex(bbOff, lOff)) {
+      if (auto dimOp = bbSize.getDefiningOp<::imex::ndarray::DimOp>())
+        isLocal = (dimOp.getSource() == op.getLocal() ||
+                   dimOp.getSource() == lData) &&
+                  dimOp.getConstantIndex() == 0;
+      else
+        isLocal = sBbSize && sLSize && *sBbSize <= lSize;
+    }
+    if (!isLocal)
+      return ::mlir::failure();
+
+    auto loc = op.getLoc();
+    auto mkEmptyHalo = [&](::mlir::Value halo) -> ::mlir::Value {
+      auto hType = mlir::cast<::imex::ndarray::NDArrayType>(halo.getType());
+      ::imex::ValVec shape(op.getBbSizes());
+      shape[0] = rewriter.create<::mlir::arith::ConstantIndexOp>(loc, 0);
+      ::mlir::Value empty = rewriter.create<::imex::ndarray::CreateOp>(
+          loc, shape, ::imex::ndarray::fromMLIR(hType.getElementType()),
+          nullptr, hType.getEnvironments());
+      if (empty.getType() != hType)
+        empty = rewriter.create<::imex::ndarray::CastOp>(loc, hType, empty);
+      return empty;
+    };
+    auto lHalo = mkEmptyHalo(op.getLHalo());
+    auto rHalo = mkEmptyHalo(op.getRHalo());
+    for (auto user :
+         ::llvm::make_early_inc_range(op.getHandle().getUsers()))
+      rewriter.eraseOp(user);
+    rewriter.replaceAllUsesWith(op.getLHalo(), lHalo);
+    rewriter.replaceAllUsesWith(op.getRHalo(), rHalo);
+    rewriter.eraseOp(op);
+    return ::mlir::success();
+  }
+};
+
 } // namespace
 
 void imex::distruntime::GetHaloOp::getCanonicalizationPatterns(
     mlir::RewritePatternSet &results, mlir::MLIRContext *context) {
-  results.add<GetHaloOpResultCanonicalizer>(context);
+  results.add<GetHaloOpResultCanonicalizer, GetHaloOpLocalFolder>(context);
 }
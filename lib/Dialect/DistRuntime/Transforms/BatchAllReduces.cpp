@@ -0,0 +1,195 @@
+//===- BatchAllReduces.cpp - BatchAllReduces Transform ----------*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file implements batching independent allreduces of scalars, such as
+/// the 0-d results of dot products, norms and sums. Allreduces in the same
+/// block with the same reduction operation and element type, which are all
+/// in flight at the same time, get packed into a small buffer which is
+/// reduced by a single allreduce. The reduced values are unpacked into the
+/// original arrays where the first of their waits was. A latency-bound
+/// collective per value becomes one per batch.
+///
+//===----------------------------------------------------------------------===//
+
+#include <imex/Dialect/DistRuntime/IR/DistRuntimeOps.h>
+#include <imex/Dialect/DistRuntime/Transforms/Passes.h>
+#include <imex/Dialect/NDArray/IR/NDArrayOps.h>
+#include <imex/Utils/PassUtils.h>
+#include <mlir/Dialect/Arith/IR/Arith.h>
+#include <mlir/Dialect/Bufferization/IR/Bufferization.h>
+#include <mlir/Dialect/MemRef/IR/MemRef.h>
+
+#include <llvm/ADT/MapVector.h>
+
+namespace imex {
+#define GEN_PASS_DEF_BATCHALLREDUCES
+#include "imex/Dialect/DistRuntime/Transforms/Passes.h.inc"
+} // namespace imex
+
+namespace imex {
+namespace distruntime {
+
+namespace {
+
+/// @return the wait of op if it is the only user of its handle and in the
+/// same block, nullptr otherwise
+static ::imex::distruntime::WaitOp
+getWait(::imex::distruntime::AllReduceOp op) {
+  auto handle = op.getHandle();
+  if (!handle.hasOneUse())
+    return nullptr;
+  auto wait =
+      ::mlir::dyn_cast<::imex::distruntime::WaitOp>(*handle.user_begin());
+  return wait && wait->getBlock() == op->getBlock() ? wait : nullptr;
+}
+
+/// @return the element type of the data of op if it is a scalar on the
+/// host, a 0-d array without environments or 0-d memref, null otherwise
+static ::mlir::Type getScalarType(::imex::distruntime::AllReduceOp op) {
+  auto type = op.getData().getType();
+  if (auto arType = ::mlir::dyn_cast<::imex::ndarray::NDArrayType>(type)) {
+    if (arType.getRank() == 0 && arType.getEnvironments().empty())
+      return arType.getElementType();
+  } else if (auto mrType = ::mlir::dyn_cast<::mlir::MemRefType>(type)) {
+    if (mrType.getRank() == 0 && !mrType.getMemorySpace())
+      return mrType.getElementType();
+  }
+  return {};
+}
+
+/// @return the first of the waits of ops
+static ::mlir::Operation *
+getFirstWait(::mlir::ArrayRef<::imex::distruntime::AllReduceOp> ops) {
+  ::mlir::Operation *first = getWait(ops.front());
+  for (auto op : ops.drop_front()) {
+    auto wait = getWait(op);
+    if (wait->isBeforeInBlock(first))
+      first = wait;
+  }
+  return first;
+}
+
+/// @return true if ops can be reduced together: all of them are started
+/// before the first wait, and their data is not accessed while in flight,
+/// i.e. between the allreduce and the first wait, other than by the wait.
+static bool canBatch(::mlir::ArrayRef<::imex::distruntime::AllReduceOp> ops) {
+  auto last = ops.back();
+  auto firstWait = getFirstWait(ops);
+  if (firstWait->isBeforeInBlock(last))
+    return false;
+  auto *block = last->getBlock();
+  for (auto op : ops) {
+    for (auto val : {op.getData(), op.getResult()}) {
+      for (auto *user : val.getUsers()) {
+        if (user == op)
+          continue;
+        auto *anc = block->findAncestorOpInBlock(*user);
+        if (!anc ||
+            (op->isBeforeInBlock(anc) && anc->isBeforeInBlock(firstWait)))
+          return false;
+      }
+    }
+  }
+  return true;
+}
+
+struct BatchAllReducesPass
+    : public imex::impl::BatchAllReducesBase<BatchAllReducesPass> {
+
+  BatchAllReducesPass() = default;
+
+  void runOnOperation() override {
+    ::mlir::SmallVector<::mlir::SmallVector<AllReduceOp>> batches;
+    this->getOperation()->walk([&](::mlir::Block *block) {
+      // the open batch per reduction operation and element type
+      ::llvm::MapVector<std::pair<::mlir::Attribute, ::mlir::Type>,
+                        ::mlir::SmallVector<AllReduceOp>>
+          open;
+      for (auto op : block->getOps<AllReduceOp>()) {
+        auto elType = getScalarType(op);
+        if (!elType || !getWait(op))
+          continue;
+        auto &batch = open[{op.getOp(), elType}];
+        batch.emplace_back(op);
+        if (canBatch(batch))
+          continue;
+        batch.pop_back();
+        if (batch.size() > 1)
+          batches.emplace_back(std::move(batch));
+        batch.assign({op});
+      }
+      for (auto &entry : open)
+        if (entry.second.size() > 1)
+          batches.emplace_back(std::move(entry.second));
+    });
+
+    for (auto &batch : batches)
+      batchAllReduces(batch);
+  }
+
+  /// Replace ops by a single allreduce of a buffer holding their values,
+  /// started at the last of them and waited for at the first wait.
+  static void batchAllReduces(::mlir::ArrayRef<AllReduceOp> ops) {
+    auto last = ops.back();
+    auto firstWait = getFirstWait(ops);
+    auto loc = last.getLoc();
+    auto elType = getScalarType(last);
+    ::mlir::OpBuilder builder(last);
+
+    auto toMemRef = [&](::mlir::Value data) -> ::mlir::Value {
+      auto arType =
+          ::mlir::dyn_cast<::imex::ndarray::NDArrayType>(data.getType());
+      if (!arType)
+        return data;
+      auto tnsr = builder.create<::imex::ndarray::ToTensorOp>(loc, data);
+      return createToMemRef(loc, builder, tnsr, arType.getMemRefType());
+    };
+
+    // pack the values
+    auto bufType =
+        ::mlir::MemRefType::get({static_cast<int64_t>(ops.size())}, elType);
+    auto buf = builder.create<::mlir::memref::AllocOp>(loc, bufType);
+    ::mlir::SmallVector<::mlir::Value> mRefs, idxs;
+    for (auto op : ops) {
+      auto mRef = toMemRef(op.getData());
+      auto idx = createIndex(loc, builder, idxs.size());
+      auto val = builder.create<::mlir::memref::LoadOp>(loc, mRef);
+      builder.create<::mlir::memref::StoreOp>(loc, val, buf, idx);
+      mRefs.emplace_back(mRef);
+      idxs.emplace_back(idx);
+    }
+    auto allReduce = builder.create<AllReduceOp>(loc, last.getOp(), buf);
+
+    // unpack the reduced values
+    builder.setInsertionPoint(firstWait);
+    builder.create<WaitOp>(loc, allReduce.getHandle());
+    for (auto [mRef, idx] : ::llvm::zip(mRefs, idxs)) {
+      auto val = builder.create<::mlir::memref::LoadOp>(loc, buf, idx);
+      builder.create<::mlir::memref::StoreOp>(loc, val, mRef);
+    }
+    builder.create<::mlir::memref::DeallocOp>(loc, buf);
+
+    for (auto op : ops) {
+      op.getResult().replaceAllUsesWith(op.getData());
+      getWait(op)->erase();
+      op->erase();
+    }
+  }
+};
+
+} // namespace
+} // namespace distruntime
+
+/// Create a pass to batch allreduces of scalars
+std::unique_ptr<::mlir::Pass> createBatchAllReducesPass() {
+  return std::make_unique<::imex::distruntime::BatchAllReducesPass>();
+}
+
+} // namespace imex
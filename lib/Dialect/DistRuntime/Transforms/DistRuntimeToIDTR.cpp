@@ -16,11 +16,13 @@
 #include <imex/Dialect/DistRuntime/Transforms/Passes.h>
 #include <imex/Dialect/NDArray/IR/NDArrayOps.h>
 #include <imex/Dialect/NDArray/Utils/Utils.h>
+#include <imex/Dialect/Region/IR/RegionOps.h>
 #include <imex/Utils/PassUtils.h>
 #include <imex/Utils/PassWrapper.h>
 #include <mlir/Dialect/Bufferization/IR/Bufferization.h>
 #include <mlir/Dialect/Func/IR/FuncOps.h>
 #include <mlir/Dialect/MemRef/IR/MemRef.h>
+#include <mlir/Dialect/SCF/IR/SCF.h>
 #include <mlir/IR/PatternMatch.h>
 #include <mlir/Rewrite/FrozenRewritePatternSet.h>
 
@@ -98,8 +100,8 @@ struct RuntimePrototypes {
     requireFunc(loc, builder, module, "printMemrefInd", {idxMRType}, {});
     requireFunc(loc, builder, module, "_idtr_nprocs", {i64Type}, {indexType});
     requireFunc(loc, builder, module, "_idtr_prank", {i64Type}, {indexType});
-    requireFunc(loc, builder, module, "_idtr_reduce_all", {dataMRType, opType},
-                {});
+    requireFunc(loc, builder, module, "_idtr_reduce_all_async",
+                {dataMRType, opType}, {i64Type});
     requireFunc(loc, builder, module, "_idtr_copy_reshape",
                 // team, gshape, loffs, lPart, ngshape, nloffs, nPart
                 {i64Type, idxMRType, idxMRType, dataMRType, idxMRType,
@@ -162,10 +164,47 @@ struct TeamMemberOpPattern
   }
 };
 
+/// Create the buffers and the runtime call of a data exchange with \p body.
+/// With a GPU environment, they get created in a GPU region yielding the
+/// results of \p body, which must be of the given types. The buffers then get
+/// allocated on the device and IDTR receives device pointers, which requires
+/// a GPU-aware runtime (e.g. GPU-aware MPI or oneCCL).
+static ::mlir::SmallVector<::mlir::Value> createExchange(
+    ::mlir::OpBuilder &builder, ::mlir::Location loc,
+    ::imex::region::GPUEnvAttr env, ::mlir::TypeRange types,
+    ::llvm::function_ref<::mlir::SmallVector<::mlir::Value>(
+        ::mlir::OpBuilder &)>
+        body) {
+  if (!env) {
+    return body(builder);
+  }
+  auto envOp = builder.create<::imex::region::EnvironmentRegionOp>(
+      loc, env, std::nullopt, types,
+      [&](::mlir::OpBuilder &b, ::mlir::Location l) {
+        (void)b.create<::imex::region::EnvironmentRegionYieldOp>(l, body(b));
+      });
+  return envOp.getResults();
+}
+
+/// Base for patterns lowering communication ops which, with gpuAware, keep
+/// the communication buffers of arrays with a GPU environment on the device.
+template <typename OP>
+struct ExchangeOpPattern : public ::mlir::OpRewritePattern<OP> {
+  ExchangeOpPattern(::mlir::MLIRContext *ctx, bool gpuAware)
+      : ::mlir::OpRewritePattern<OP>(ctx), gpuAware(gpuAware) {}
+
+  /// @return the GPU environment to communicate in, if any
+  ::imex::region::GPUEnvAttr getExchangeEnv(::mlir::Type arType) const {
+    return gpuAware ? ::imex::ndarray::getGPUEnv(arType)
+                    : ::imex::region::GPUEnvAttr{};
+  }
+
+  bool gpuAware;
+};
+
 struct CopyReshapeOpPattern
-    : public ::mlir::OpRewritePattern<::imex::distruntime::CopyReshapeOp> {
-  using ::mlir::OpRewritePattern<
-      ::imex::distruntime::CopyReshapeOp>::OpRewritePattern;
+    : public ExchangeOpPattern<::imex::distruntime::CopyReshapeOp> {
+  using ExchangeOpPattern::ExchangeOpPattern;
 
   ::mlir::LogicalResult
   matchAndRewrite(::imex::distruntime::CopyReshapeOp op,
@@ -188,42 +227,84 @@ struct CopyReshapeOpPattern
     auto nlOffs = op.getNlOffsets();
     auto nlShape = op.getNlShape();
 
-    // create output array with target size
-    auto nlArray = rewriter.create<::imex::ndarray::CreateOp>(
-        loc, nlShape, ::imex::ndarray::fromMLIR(elType), nullptr,
-        resType.getEnvironments());
-
     auto idxType = rewriter.getIndexType();
     auto teamC = rewriter.create<::mlir::arith::ConstantOp>(
         loc, mlir::cast<::mlir::IntegerAttr>(team));
     auto gShapeMR = createURMemRefFromElements(rewriter, loc, idxType, gShape);
     auto lOffsMR = createURMemRefFromElements(rewriter, loc, idxType, lOffs);
-    auto lArrayMR = ::imex::ndarray::mkURMemRef(loc, rewriter, lArray);
     auto ngShapeMR =
         createURMemRefFromElements(rewriter, loc, idxType, ngShape);
     auto nlOffsMR = createURMemRefFromElements(rewriter, loc, idxType, nlOffs);
-    auto nlArrayMR = ::imex::ndarray::mkURMemRef(loc, rewriter, nlArray);
 
-    auto fun =
-        rewriter.getStringAttr(mkTypedFunc("_idtr_copy_reshape", elType));
-    auto handle = rewriter.create<::mlir::func::CallOp>(
-        loc, fun, rewriter.getI64Type(),
-        ::mlir::ValueRange{teamC, gShapeMR, lOffsMR, lArrayMR, ngShapeMR,
-                           nlOffsMR, nlArrayMR});
-    rewriter.replaceOp(op, {handle.getResult(0), nlArray});
+    auto nlType = ::imex::ndarray::NDArrayType::get(
+        getShapeFromValues(nlShape), elType, resType.getEnvironments());
+    auto res = createExchange(
+        rewriter, loc, getExchangeEnv(resType),
+        {rewriter.getI64Type(), nlType}, [&](::mlir::OpBuilder &builder) {
+          // create output array with target size
+          auto nlArray = builder.create<::imex::ndarray::CreateOp>(
+              loc, nlShape, ::imex::ndarray::fromMLIR(elType), nullptr,
+              resType.getEnvironments());
+          auto lArrayMR = ::imex::ndarray::mkURMemRef(loc, builder, lArray);
+          auto nlArrayMR = ::imex::ndarray::mkURMemRef(loc, builder, nlArray);
+
+          auto fun =
+              builder.getStringAttr(mkTypedFunc("_idtr_copy_reshape", elType));
+          auto handle = builder.create<::mlir::func::CallOp>(
+              loc, fun, builder.getI64Type(),
+              ::mlir::ValueRange{teamC, gShapeMR, lOffsMR, lArrayMR, ngShapeMR,
+                                 nlOffsMR, nlArrayMR});
+          return ::mlir::SmallVector<::mlir::Value>{handle.getResult(0),
+                                                    nlArray};
+        });
+    rewriter.replaceOp(op, res);
     return ::mlir::success();
   }
 };
 
+/// Create a 1d UnrankedMemRef holding the index values elts, to be passed as
+/// metadata of the halo exchange with the given cache key. A keyed exchange
+/// gets executed repeatedly, so instead of allocating new memory in each
+/// execution, it uses a module-level buffer per key and argument.
+static ::mlir::Value createHaloMetaData(::mlir::OpBuilder &builder,
+                                        ::mlir::Location loc,
+                                        ::mlir::Operation *op, int64_t key,
+                                        ::llvm::StringRef name,
+                                        ::mlir::ValueRange elts) {
+  auto idxType = builder.getIndexType();
+  if (key < 0) {
+    return createURMemRefFromElements(builder, loc, idxType, elts);
+  }
+
+  auto module = op->getParentOfType<::mlir::ModuleOp>();
+  auto mrType =
+      ::mlir::MemRefType::get({static_cast<int64_t>(elts.size())}, idxType);
+  auto symName =
+      (::llvm::Twine("_idtr_halo") + ::llvm::Twine(key) + "_" + name).str();
+  if (!module.lookupSymbol(symName)) {
+    ::mlir::OpBuilder::InsertionGuard guard(builder);
+    builder.setInsertionPointToStart(module.getBody());
+    builder.create<::mlir::memref::GlobalOp>(
+        loc, symName, builder.getStringAttr("private"), mrType,
+        builder.getUnitAttr(), /*constant=*/false, /*alignment=*/nullptr);
+  }
+  ::mlir::Value mr =
+      builder.create<::mlir::memref::GetGlobalOp>(loc, mrType, symName);
+  for (auto [i, elt] : ::llvm::enumerate(elts)) {
+    builder.create<::mlir::memref::StoreOp>(loc, elt, mr,
+                                            createIndex(loc, builder, i));
+  }
+  return createUnrankedMemRefCast(builder, loc, mr);
+}
+
 /// @brief  lower GetHaloOp
 /// Determine sizes of halos, alloc halos and call idtr.
 /// Before accessing/reading from returned halos, the caller must
 /// call the appropriate wait call in idtr.
 /// @return handle, left halo, right halo
 struct GetHaloOpPattern
-    : public ::mlir::OpRewritePattern<::imex::distruntime::GetHaloOp> {
-  using ::mlir::OpRewritePattern<
-      ::imex::distruntime::GetHaloOp>::OpRewritePattern;
+    : public ExchangeOpPattern<::imex::distruntime::GetHaloOp> {
+  using ExchangeOpPattern::ExchangeOpPattern;
 
   ::mlir::LogicalResult
   matchAndRewrite(::imex::distruntime::GetHaloOp op,
@@ -237,23 +318,23 @@ struct GetHaloOpPattern
 
     auto elType = arTyp.getElementType();
 
-    auto mkHalo = [&](const ::imex::ValVec &szs) {
+    auto mkHalo = [&](::mlir::OpBuilder &builder, const ::imex::ValVec &szs) {
       ::mlir::Value iVal =
 #ifdef DEBUG_HALO
-          createCast(loc, rewriter,
+          createCast(loc, builder,
                      elType.isIntOrIndex()
-                         ? createInt(loc, rewriter, 4711,
+                         ? createInt(loc, builder, 4711,
                                      elType.getIntOrFloatBitWidth())
-                         : createFloat(loc, rewriter, 4711,
+                         : createFloat(loc, builder, 4711,
                                        elType.getIntOrFloatBitWidth()),
                      elType);
 #else
           nullptr;
 #endif
-      auto outPTnsr = rewriter.create<::imex::ndarray::CreateOp>(
+      auto outPTnsr = builder.create<::imex::ndarray::CreateOp>(
           loc, szs, ::imex::ndarray::fromMLIR(elType), iVal,
           ::imex::dist::getNonDistEnvs(arTyp));
-      auto outUMR = ::imex::ndarray::mkURMemRef(loc, rewriter, outPTnsr);
+      auto outUMR = ::imex::ndarray::mkURMemRef(loc, builder, outPTnsr);
       return std::make_pair(outPTnsr, outUMR);
     };
 
@@ -265,14 +346,16 @@ struct GetHaloOpPattern
     ::imex::ValVec bbSizes = op.getBbSizes();
 
     // Prepare args for calling update_halo
-    auto idxType = rewriter.getIndexType();
-    auto gShapeMR = createURMemRefFromElements(rewriter, loc, idxType, gShape);
-    auto lOffsMR = createURMemRefFromElements(rewriter, loc, idxType, lOffsets);
-    // we pass the entire local data to update_halo, not just the subview
-    auto lPart = ::imex::ndarray::mkURMemRef(loc, rewriter, lData);
-    auto bbOffsMR = createURMemRefFromElements(rewriter, loc, idxType, bbOffs);
+    // keyed exchanges reuse their metadata buffers, see GetHaloOp
+    auto cacheKey = op.getKey();
+    auto gShapeMR =
+        createHaloMetaData(rewriter, loc, op, cacheKey, "gshape", gShape);
+    auto lOffsMR =
+        createHaloMetaData(rewriter, loc, op, cacheKey, "loffs", lOffsets);
+    auto bbOffsMR =
+        createHaloMetaData(rewriter, loc, op, cacheKey, "bboffs", bbOffs);
     auto bbSizesMR =
-        createURMemRefFromElements(rewriter, loc, idxType, bbSizes);
+        createHaloMetaData(rewriter, loc, op, cacheKey, "bbsizes", bbSizes);
 
     // determine overlap of new local part, we split dim 0 only
     auto zero = easyIdx(loc, rewriter, 0);
@@ -299,26 +382,43 @@ struct GetHaloOpPattern
       rHSizes[0] = (tEnd - (ownOff + ownSize)).max(zero).get();
     }
 
-    auto lOut = mkHalo(lHSizes);
-    auto rOut = mkHalo(rHSizes);
-    auto key = createInt(loc, rewriter, op.getKey());
-
-    // call our runtime function to redistribute data across processes
-    auto fun = rewriter.getStringAttr(mkTypedFunc("_idtr_update_halo", elType));
-    auto handle = rewriter.create<::mlir::func::CallOp>(
-        loc, fun, rewriter.getI64Type(),
-        ::mlir::ValueRange{createInt(loc, rewriter, 0), gShapeMR, lOffsMR,
-                           lPart, bbOffsMR, bbSizesMR, lOut.second, rOut.second,
-                           key});
-
-    rewriter.replaceOp(op, {handle.getResult(0), lOut.first, rOut.first});
+    auto key = createInt(loc, rewriter, cacheKey);
+    auto team = createInt(loc, rewriter, 0);
+
+    auto haloEnvs = ::imex::dist::getNonDistEnvs(arTyp);
+    auto lHType = ::imex::ndarray::NDArrayType::get(
+        getShapeFromValues(lHSizes), elType, haloEnvs);
+    auto rHType = ::imex::ndarray::NDArrayType::get(
+        getShapeFromValues(rHSizes), elType, haloEnvs);
+    auto res = createExchange(
+        rewriter, loc, getExchangeEnv(arTyp),
+        {rewriter.getI64Type(), lHType, rHType},
+        [&](::mlir::OpBuilder &builder) {
+          auto lOut = mkHalo(builder, lHSizes);
+          auto rOut = mkHalo(builder, rHSizes);
+          // we pass the entire local data to update_halo, not just the
+          // subview
+          auto lPart = ::imex::ndarray::mkURMemRef(loc, builder, lData);
+
+          // call our runtime function to redistribute data across processes
+          auto fun =
+              builder.getStringAttr(mkTypedFunc("_idtr_update_halo", elType));
+          auto handle = builder.create<::mlir::func::CallOp>(
+              loc, fun, builder.getI64Type(),
+              ::mlir::ValueRange{team, gShapeMR, lOffsMR, lPart, bbOffsMR,
+                                 bbSizesMR, lOut.second, rOut.second, key});
+          return ::mlir::SmallVector<::mlir::Value>{
+              handle.getResult(0), lOut.first, rOut.first};
+        });
+
+    rewriter.replaceOp(op, res);
     return ::mlir::success();
   }
 };
 
 /// Convert ::imex::distruntime::AllReduceOp into runtime call to
-/// "_idtr_reduce_all". Pass local RankedTensor as argument. Replaces op with
-/// new distributed array.
+/// "_idtr_reduce_all_async". Pass local data as argument, which gets reduced
+/// in-place. Replaces op with the returned handle and the local data.
 struct AllReduceOpPattern
     : public ::mlir::OpRewritePattern<::imex::distruntime::AllReduceOp> {
   using ::mlir::OpRewritePattern<
@@ -329,20 +429,30 @@ struct AllReduceOpPattern
                   ::mlir::PatternRewriter &rewriter) const override {
     // get guid and rank and call runtime function
     auto loc = op.getLoc();
-    auto mRef = op.getData();
-    auto mRefType = mlir::dyn_cast<::mlir::MemRefType>(mRef.getType());
-    if (!mRefType)
+    auto data = op.getData();
+    ::mlir::Value dataUMR;
+    ::mlir::Type elType;
+    if (auto arType =
+            mlir::dyn_cast<::imex::ndarray::NDArrayType>(data.getType())) {
+      elType = arType.getElementType();
+      dataUMR = ::imex::ndarray::mkURMemRef(loc, rewriter, data);
+    } else if (auto mRefType =
+                   mlir::dyn_cast<::mlir::MemRefType>(data.getType())) {
+      elType = mRefType.getElementType();
+      dataUMR = createUnrankedMemRefCast(rewriter, loc, data);
+    } else {
       return ::mlir::failure();
+    }
 
     auto opV = rewriter.create<::mlir::arith::ConstantOp>(
         loc, ::mlir::cast<::mlir::TypedAttr>(op.getOp()));
-    auto elType = mRefType.getElementType();
 
-    auto fsa = rewriter.getStringAttr(mkTypedFunc("_idtr_reduce_all", elType));
-    auto dataUMR = createUnrankedMemRefCast(rewriter, loc, mRef);
+    auto fsa =
+        rewriter.getStringAttr(mkTypedFunc("_idtr_reduce_all_async", elType));
+    auto handle = rewriter.create<::mlir::func::CallOp>(
+        loc, fsa, rewriter.getI64Type(), ::mlir::ValueRange({dataUMR, opV}));
 
-    rewriter.replaceOpWithNewOp<::mlir::func::CallOp>(
-        op, fsa, ::mlir::TypeRange(), ::mlir::ValueRange({dataUMR, opV}));
+    rewriter.replaceOp(op, {handle.getResult(0), data});
     return ::mlir::success();
   }
 };
@@ -364,9 +474,111 @@ struct WaitOpPattern
 };
 
 struct CopyPermuteOpPattern
-    : public ::mlir::OpRewritePattern<::imex::distruntime::CopyPermuteOp> {
-  using ::mlir::OpRewritePattern<
-      ::imex::distruntime::CopyPermuteOp>::OpRewritePattern;
+    : public ExchangeOpPattern<::imex::distruntime::CopyPermuteOp> {
+  CopyPermuteOpPattern(::mlir::MLIRContext *ctx, bool gpuAware,
+                       int64_t chunkSize)
+      : ExchangeOpPattern(ctx, gpuAware), chunkSize(chunkSize) {}
+
+  /// Copy in chunks of at most chunkSize elements of the global input, cut
+  /// along its first dimension. Each chunk is a separate _idtr_copy_permute
+  /// on views of the local input and output, at most two chunks are in
+  /// flight at a time. This bounds the memory the runtime needs for packing
+  /// and lets packing of one chunk overlap the transfer of the previous.
+  /// @return handle of the last chunk
+  ::mlir::Value createChunks(::mlir::OpBuilder &builder, ::mlir::Location loc,
+                             ::imex::distruntime::CopyPermuteOp op,
+                             ::mlir::Value nlArray, ::mlir::StringAttr fun,
+                             ::mlir::Value teamC, ::mlir::Value axesMR) const {
+    ::imex::ValVec gShape = op.getGShape();
+    ::imex::ValVec lOffs = op.getLOffsets();
+    ::imex::ValVec nlOffs = op.getNlOffsets();
+    ::imex::ValVec nlShape = op.getNlShape();
+    auto axes = op.getAxes();
+    auto idxType = builder.getIndexType();
+    // the output dimension holding the first input dimension
+    auto oDim = std::distance(axes.begin(), ::llvm::find(axes, 0));
+
+    auto toMemRef = [&](::mlir::Value ary) {
+      auto arType = mlir::cast<::imex::ndarray::NDArrayType>(ary.getType());
+      auto tnsr = builder.create<::imex::ndarray::ToTensorOp>(loc, ary);
+      return createToMemRef(loc, builder, tnsr, arType.getMemRefType());
+    };
+    auto lMR = toMemRef(op.getLArray());
+    auto nlMR = toMemRef(nlArray);
+
+    // number of rows of the input per chunk and number of chunks
+    auto one = easyIdx(loc, builder, 1);
+    auto rowSz = one;
+    for (size_t i = 1; i < gShape.size(); ++i) {
+      rowSz = rowSz * easyIdx(loc, builder, gShape[i]);
+    }
+    auto gSz = easyIdx(loc, builder, gShape[0]);
+    auto rows = (easyIdx(loc, builder, chunkSize) / rowSz.max(one)).max(one);
+    auto nChunks = ((gSz + rows - one) / rows).max(one);
+    auto lSz = builder.createOrFold<::mlir::memref::DimOp>(loc, lMR, 0);
+
+    // view of mr cut to [off, off+sz) in dimension dim
+    auto mkView = [&](::mlir::OpBuilder &b, ::mlir::Value mr, int64_t dim,
+                      ::mlir::Value off, ::mlir::Value sz) {
+      auto rank = mlir::cast<::mlir::MemRefType>(mr.getType()).getRank();
+      ::mlir::SmallVector<::mlir::OpFoldResult> offs(rank, b.getIndexAttr(0));
+      ::mlir::SmallVector<::mlir::OpFoldResult> strides(rank,
+                                                        b.getIndexAttr(1));
+      ::mlir::SmallVector<::mlir::OpFoldResult> szs;
+      for (int64_t i = 0; i < rank; ++i) {
+        szs.emplace_back(b.createOrFold<::mlir::memref::DimOp>(loc, mr, i));
+      }
+      offs[dim] = off;
+      szs[dim] = sz;
+      auto view =
+          b.create<::mlir::memref::SubViewOp>(loc, mr, offs, szs, strides);
+      return createUnrankedMemRefCast(b, loc, view);
+    };
+
+    // start the exchange of chunk k
+    auto issue = [&](::mlir::OpBuilder &b, ::mlir::Value k) {
+      auto c0 = easyIdx(loc, b, k) * easyIdx(loc, b, rows.get());
+      auto c1 = (c0 + easyIdx(loc, b, rows.get())).min(
+          easyIdx(loc, b, gSz.get()));
+      auto lOff = easyIdx(loc, b, lOffs[0]);
+      auto lo = lOff.max(c0).min(c1);
+      auto hi = (lOff + easyIdx(loc, b, lSz)).max(c0).min(c1);
+      auto nlOff = easyIdx(loc, b, nlOffs[oDim]);
+      auto nlo = nlOff.max(c0).min(c1);
+      auto nhi = (nlOff + easyIdx(loc, b, nlShape[oDim])).max(c0).min(c1);
+
+      ::imex::ValVec gChunk(gShape), lOffsChunk(lOffs), nlOffsChunk(nlOffs);
+      gChunk[0] = (c1 - c0).get();
+      lOffsChunk[0] = (lo - c0).get();
+      nlOffsChunk[oDim] = (nlo - c0).get();
+      auto gShapeMR = createURMemRefFromElements(b, loc, idxType, gChunk);
+      auto lOffsMR = createURMemRefFromElements(b, loc, idxType, lOffsChunk);
+      auto nlOffsMR =
+          createURMemRefFromElements(b, loc, idxType, nlOffsChunk);
+      auto lView = mkView(b, lMR, 0, (lo - lOff).get(), (hi - lo).get());
+      auto nlView =
+          mkView(b, nlMR, oDim, (nlo - nlOff).get(), (nhi - nlo).get());
+      return b
+          .create<::mlir::func::CallOp>(
+              loc, fun, b.getI64Type(),
+              ::mlir::ValueRange{teamC, gShapeMR, lOffsMR, lView, nlOffsMR,
+                                 nlView, axesMR})
+          .getResult(0);
+    };
+
+    auto first = issue(builder, easyIdx(loc, builder, 0).get());
+    auto loop = builder.create<::mlir::scf::ForOp>(
+        loc, one.get(), nChunks.get(), one.get(), ::mlir::ValueRange{first},
+        [&](::mlir::OpBuilder &b, ::mlir::Location, ::mlir::Value iv,
+            ::mlir::ValueRange args) {
+          auto handle = issue(b, iv);
+          (void)b.create<::mlir::func::CallOp>(
+              loc, b.getStringAttr("_idtr_wait"), ::mlir::TypeRange(),
+              ::mlir::ValueRange{args[0]});
+          (void)b.create<::mlir::scf::YieldOp>(loc, handle);
+        });
+    return loop.getResult(0);
+  }
 
   ::mlir::LogicalResult
   matchAndRewrite(::imex::distruntime::CopyPermuteOp op,
@@ -396,31 +608,49 @@ struct CopyPermuteOpPattern
           rewriter.create<::mlir::arith::ConstantIndexOp>(loc, axis));
     }
 
-    // create output array with target size
-    auto nlArray = rewriter.create<::imex::ndarray::CreateOp>(
-        loc, nlShape, ::imex::ndarray::fromMLIR(elType), nullptr,
-        resType.getEnvironments());
-
     auto idxType = rewriter.getIndexType();
     auto teamC = rewriter.create<::mlir::arith::ConstantOp>(
         loc, mlir::cast<::mlir::IntegerAttr>(team));
-    auto gShapeMR = createURMemRefFromElements(rewriter, loc, idxType, gShape);
-    auto lOffsMR = createURMemRefFromElements(rewriter, loc, idxType, lOffs);
-    auto lArrayMR = ::imex::ndarray::mkURMemRef(loc, rewriter, lArray);
-    auto nlOffsMR = createURMemRefFromElements(rewriter, loc, idxType, nlOffs);
-    auto nlArrayMR = ::imex::ndarray::mkURMemRef(loc, rewriter, nlArray);
     auto axesMR =
         createURMemRefFromElements(rewriter, loc, idxType, axesValues);
 
-    auto fun =
-        rewriter.getStringAttr(mkTypedFunc("_idtr_copy_permute", elType));
-    auto handle = rewriter.create<::mlir::func::CallOp>(
-        loc, fun, rewriter.getI64Type(),
-        ::mlir::ValueRange{teamC, gShapeMR, lOffsMR, lArrayMR, nlOffsMR,
-                           nlArrayMR, axesMR});
-    rewriter.replaceOp(op, {handle.getResult(0), nlArray});
+    auto nlType = ::imex::ndarray::NDArrayType::get(
+        getShapeFromValues(nlShape), elType, resType.getEnvironments());
+    auto res = createExchange(
+        rewriter, loc, getExchangeEnv(resType),
+        {rewriter.getI64Type(), nlType}, [&](::mlir::OpBuilder &builder) {
+          // create output array with target size
+          auto nlArray = builder.create<::imex::ndarray::CreateOp>(
+              loc, nlShape, ::imex::ndarray::fromMLIR(elType), nullptr,
+              resType.getEnvironments());
+          auto fun =
+              builder.getStringAttr(mkTypedFunc("_idtr_copy_permute", elType));
+          if (chunkSize > 0) {
+            auto handle =
+                createChunks(builder, loc, op, nlArray, fun, teamC, axesMR);
+            return ::mlir::SmallVector<::mlir::Value>{handle, nlArray};
+          }
+
+          auto gShapeMR =
+              createURMemRefFromElements(builder, loc, idxType, gShape);
+          auto lOffsMR =
+              createURMemRefFromElements(builder, loc, idxType, lOffs);
+          auto nlOffsMR =
+              createURMemRefFromElements(builder, loc, idxType, nlOffs);
+          auto lArrayMR = ::imex::ndarray::mkURMemRef(loc, builder, lArray);
+          auto nlArrayMR = ::imex::ndarray::mkURMemRef(loc, builder, nlArray);
+          auto handle = builder.create<::mlir::func::CallOp>(
+              loc, fun, builder.getI64Type(),
+              ::mlir::ValueRange{teamC, gShapeMR, lOffsMR, lArrayMR, nlOffsMR,
+                                 nlArrayMR, axesMR});
+          return ::mlir::SmallVector<::mlir::Value>{handle.getResult(0),
+                                                    nlArray};
+        });
+    rewriter.replaceOp(op, res);
     return ::mlir::success();
   }
+
+  int64_t chunkSize;
 };
 
 struct DistRuntimeToIDTRPass
@@ -433,11 +663,15 @@ struct DistRuntimeToIDTRPass
     ::mlir::OpBuilder builder(&getContext());
     RuntimePrototypes::add_prototypes(builder, this->getOperation());
 
-    ::mlir::FrozenRewritePatternSet patterns;
-    insertPatterns<CopyReshapeOpPattern, TeamSizeOpPattern, TeamMemberOpPattern,
-                   GetHaloOpPattern, AllReduceOpPattern, WaitOpPattern,
-                   CopyPermuteOpPattern>(getContext(), patterns);
-    (void)::mlir::applyPatternsGreedily(this->getOperation(), patterns);
+    ::mlir::RewritePatternSet patterns(&getContext());
+    patterns.insert<TeamSizeOpPattern, TeamMemberOpPattern, AllReduceOpPattern,
+                    WaitOpPattern>(&getContext());
+    patterns.insert<CopyReshapeOpPattern, GetHaloOpPattern>(
+        &getContext(), gpuAware.getValue());
+    patterns.insert<CopyPermuteOpPattern>(&getContext(), gpuAware.getValue(),
+                                          copyChunkSize.getValue());
+    (void)::mlir::applyPatternsGreedily(this->getOperation(),
+                                        std::move(patterns));
   }; // runOnOperation()
 
 }; // DistRuntimeToIDTRPass
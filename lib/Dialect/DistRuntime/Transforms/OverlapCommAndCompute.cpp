@@ -14,7 +14,13 @@
 /// other so that asynchronous operations can effectively operate in the
 /// background. For this, the pass pushes down WaitOps to the first use of the
 /// data they protect. It is also necessary to push down SubViewOps to their
-/// first use.
+/// first use. Ops after a WaitOp which do not depend on the halos it
+/// protects, such as the interior of a stencil, are moved before it, and
+/// only the boundary part remains after the WaitOp.
+/// GPU regions (env_region ops with a GPU environment) are treated as single
+/// ops. GPU kernels on the interior therefore get launched before the host
+/// blocks in the WaitOp, and the device computes while the halos are being
+/// exchanged.
 ///
 //===----------------------------------------------------------------------===//
 
@@ -22,8 +28,13 @@
 #include <imex/Dialect/DistRuntime/Transforms/Passes.h>
 #include <imex/Dialect/NDArray/IR/NDArrayOps.h>
 #include <imex/Dialect/NDArray/Transforms/Utils.h>
+#include <imex/Dialect/Region/RegionUtils.h>
 #include <imex/Utils/PassUtils.h>
 #include <mlir/Dialect/Func/IR/FuncOps.h>
+#include <mlir/Interfaces/SideEffectInterfaces.h>
+
+#include <llvm/ADT/DenseSet.h>
+#include <llvm/ADT/STLExtras.h>
 
 #include <algorithm>
 #include <vector>
@@ -104,10 +115,21 @@ struct OverlapCommAndComputePass
     }
   }
 
+  // Replace users by their ancestors in block, e.g. the GPU regions they
+  // are in, and drop those which are not in block.
+  template <typename T>
+  static void toAncestorsIn(::mlir::Block *block, T &users) {
+    for (auto &user : users) {
+      user = block->findAncestorOpInBlock(*user);
+    }
+    users.erase(std::remove(users.begin(), users.end(), nullptr), users.end());
+  }
+
   // push operation down to first use
   void pushDefiningOp(::mlir::Operation *op) {
     auto &dom = this->getAnalysis<::mlir::DominanceInfo>();
     auto users = getSortedUsers(dom, op);
+    toAncestorsIn(op->getBlock(), users);
     if (!users.empty()) {
       op->moveBefore(users.front());
     }
@@ -141,6 +163,7 @@ struct OverlapCommAndComputePass
     for (auto d : asyncOp.getDependent()) {
       appendUsers(d, users);
     }
+    toAncestorsIn(op->getBlock(), users);
 
     // sort
     auto &dom = this->getAnalysis<::mlir::DominanceInfo>();
@@ -153,6 +176,60 @@ struct OverlapCommAndComputePass
     // if there is no user, we still need the wait call.
   }
 
+  // Ops which can be moved across WaitOps: ewops and side-effect free ops,
+  // and GPU regions which contain only such ops.
+  static bool isMovable(::mlir::Operation *op) {
+    if (auto envOp =
+            ::mlir::dyn_cast<::imex::region::EnvironmentRegionOp>(op)) {
+      return ::imex::region::isGpuRegion(envOp) &&
+             ::llvm::all_of(envOp.getRegion().getOps(),
+                            [](::mlir::Operation &inner) {
+                              return inner.hasTrait<
+                                         ::mlir::OpTrait::IsTerminator>() ||
+                                     isMovable(&inner);
+                            });
+    }
+    return ::mlir::isa<::imex::ndarray::EWBinOp, ::imex::ndarray::EWUnyOp>(
+               op) ||
+           (op->getNumRegions() == 0 && ::mlir::isMemoryEffectFree(op));
+  }
+
+  // Split the ops following a WaitOp into the interior part, which does not
+  // depend on the halos, and the boundary part, which does. The interior
+  // part, e.g. the core loop of a stencil, is moved before the WaitOp such
+  // that it overlaps with the halo exchange. Stops at the first op which
+  // cannot be moved.
+  void hoistInterior(::mlir::Operation *op) {
+    auto waitOp = ::mlir::cast<::imex::distruntime::WaitOp>(op);
+    auto asyncOp = waitOp.getHandle().getDefiningOp<::mlir::AsyncOpInterface>();
+    assert(asyncOp);
+
+    // all ops using the halos, directly or indirectly, are boundary ops;
+    // a GPU region is a boundary op if any op in it uses them
+    auto block = op->getBlock();
+    ::llvm::DenseSet<::mlir::Operation *> boundary;
+    ::mlir::SmallVector<::mlir::Value> worklist(asyncOp.getDependent());
+    while (!worklist.empty()) {
+      for (auto *user : worklist.pop_back_val().getUsers()) {
+        auto *ancestor = block->findAncestorOpInBlock(*user);
+        if (ancestor && boundary.insert(ancestor).second) {
+          worklist.append(ancestor->result_begin(), ancestor->result_end());
+        }
+      }
+    }
+
+    for (auto *curr = op->getNextNode(); curr;) {
+      auto *next = curr->getNextNode();
+      if (!isMovable(curr)) {
+        break;
+      }
+      if (!boundary.contains(curr)) {
+        curr->moveBefore(op);
+      }
+      curr = next;
+    }
+  }
+
   /// @brief group ewops, push out SubviewOps and WaitOps as much as possible.
   /// Do not pull ewops over InsertSliceOps
   void runOnOperation() override {
@@ -162,8 +239,12 @@ struct OverlapCommAndComputePass
 
     // find all ewops, WaitOps and Subviewops
     // create groups of ewops separated by InsertSliceOps
+    // ewops in GPU regions get moved with their regions
     root->walk([&](::mlir::Operation *op) {
       if (::mlir::isa<::imex::ndarray::EWBinOp, ::imex::ndarray::EWUnyOp>(op)) {
+        if (::imex::region::isInGpuRegion(op)) {
+          return;
+        }
         ewops.emplace_back(op);
       } else if (::mlir::isa<::imex::ndarray::SubviewOp>(op)) {
         svops.emplace_back(op);
@@ -193,8 +274,10 @@ struct OverlapCommAndComputePass
     svops.clear();
 
     // push down WaitOps to the first use of the data they protect
+    // and compute what does not need the halos while waiting
     for (auto op : waitops) {
       pushWaitOp(op);
+      hoistInterior(op);
     }
     waitops.clear();
   }
@@ -21,6 +21,7 @@
 #include <mlir/IR/DialectImplementation.h>
 #include <mlir/IR/OpImplementation.h>
 #include <mlir/IR/PatternMatch.h>
+#include <mlir/Interfaces/SideEffectInterfaces.h>
 #include <mlir/Transforms/InliningUtils.h>
 
 #include <optional>
@@ -87,6 +88,48 @@ mlir::StringAttr LaunchFuncOp::getKernelName() {
   return getKernel().getLeafReference();
 }
 
+mlir::LogicalResult SubstreamOp::verify() {
+  auto index = static_cast<int64_t>(getIndex());
+  if (index < 0)
+    return emitOpError("negative substream index ") << index;
+  return mlir::success();
+}
+
+mlir::LogicalResult MemAdviseOp::verify() {
+  auto advice = getAdvice();
+  if (advice != "read_mostly" && advice != "preferred_location")
+    return emitOpError("unknown advice ") << advice;
+  return mlir::success();
+}
+
+mlir::LogicalResult GraphOp::verify() {
+  auto stream = getGpuxStream();
+  auto res = getBody()->walk([&](mlir::Operation *op) {
+    if (auto launch = mlir::dyn_cast<LaunchFuncOp>(op)) {
+      if (launch.getGpuxStream() != stream) {
+        emitOpError("launches must use the stream of the graph");
+        return mlir::WalkResult::interrupt();
+      }
+      return mlir::WalkResult::advance();
+    }
+    if (mlir::isa<GPUXDialect>(op->getDialect())) {
+      emitOpError("only kernel launches can be recorded, found ")
+          << op->getName();
+      return mlir::WalkResult::interrupt();
+    }
+    // The launches only run at the end of the region, so host code in it
+    // would not be ordered with them if it accessed memory. Ops with regions
+    // are checked through their nested ops.
+    if (op->getNumRegions() == 0 && !mlir::isMemoryEffectFree(op)) {
+      emitOpError("only kernel launches may access memory, found ")
+          << op->getName();
+      return mlir::WalkResult::interrupt();
+    }
+    return mlir::WalkResult::advance();
+  });
+  return mlir::failure(res.wasInterrupted());
+}
+
 } // namespace gpux
 } // namespace imex
 
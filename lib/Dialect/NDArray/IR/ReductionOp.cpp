@@ -0,0 +1,62 @@
+//===- ReductionOp.cpp - NDArray dialect  -----------------------*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file implements the ReductionOp of the NDArray dialect.
+///
+//===----------------------------------------------------------------------===//
+
+#include <imex/Dialect/NDArray/IR/NDArrayOps.h>
+#include <mlir/IR/BuiltinTypes.h>
+#include <mlir/IR/OpDefinition.h>
+
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/SmallVector.h>
+
+#include <algorithm>
+
+::mlir::SmallVector<int64_t> imex::ndarray::ReductionOp::getReducedDims() {
+  auto rank = mlir::cast<::mlir::ShapedType>(getInput().getType()).getRank();
+  ::mlir::SmallVector<int64_t> res;
+  if (auto dims = getDims()) {
+    for (auto d : *dims)
+      res.emplace_back(d < 0 ? d + rank : d);
+    llvm::sort(res);
+  } else {
+    for (int64_t i = 0; i < rank; ++i)
+      res.emplace_back(i);
+  }
+  return res;
+}
+
+mlir::LogicalResult imex::ndarray::ReductionOp::verify() {
+  auto inpType = mlir::dyn_cast<NDArrayType>(getInput().getType());
+  if (!inpType)
+    return mlir::success();
+  auto rank = inpType.getRank();
+
+  if (auto dims = getDims()) {
+    for (auto d : *dims) {
+      if (d < -rank || d >= rank)
+        return emitOpError("reduction dimension ")
+               << d << " out of range for rank " << rank;
+    }
+  }
+  auto redDims = getReducedDims();
+  if (std::adjacent_find(redDims.begin(), redDims.end()) != redDims.end())
+    return emitOpError("reduction dimensions must be unique");
+
+  auto retType = mlir::cast<NDArrayType>(getResult().getType());
+  auto expRank =
+      getKeepdims() ? rank : rank - static_cast<int64_t>(redDims.size());
+  if (retType.getRank() != expRank)
+    return emitOpError("expected result of rank ") << expRank;
+
+  return mlir::success();
+}
@@ -18,10 +18,12 @@
 #include <imex/Dialect/Region/IR/RegionOps.h>
 #include <imex/Dialect/Region/RegionUtils.h>
 #include <imex/Utils/PassUtils.h>
-#include <imex/Utils/PassWrapper.h>
 
 #include <mlir/IR/PatternMatch.h>
-#include <mlir/Rewrite/FrozenRewritePatternSet.h>
+#include <mlir/Transforms/GreedyPatternRewriteDriver.h>
+
+#include <algorithm>
+#include <optional>
 
 namespace imex {
 #define GEN_PASS_DEF_ADDGPUREGIONS
@@ -44,11 +46,31 @@ struct RecOpRewritePattern : public ::mlir::OpRewritePattern<T> {
   }
 };
 
+/// Return the number of elements of the largest NDArray operand or result
+/// of op, std::nullopt if any of them is not statically shaped.
+static std::optional<int64_t> getMaxNumElements(::mlir::Operation *op) {
+  int64_t res = 0;
+  for (auto types : {::mlir::TypeRange(op->getOperandTypes()),
+                     ::mlir::TypeRange(op->getResultTypes())}) {
+    for (auto t : types) {
+      auto arType = ::mlir::dyn_cast<::imex::ndarray::NDArrayType>(t);
+      if (!arType)
+        continue;
+      if (!arType.hasStaticShape())
+        return std::nullopt;
+      res = std::max(res, arType.getNumElements());
+    }
+  }
+  return res;
+}
+
 /// If given NDArray operation operates on or returns a NDArray with an
 /// GPUEnvironment, create GPU region operation which yields the operation.
+/// Compute operations touching less than minElements elements stay on the
+/// host, their work does not amortize a kernel launch.
 static ::mlir::LogicalResult
 matchAndRewritePTOP(::mlir::Operation *op, ::mlir::PatternRewriter &rewriter,
-                    bool checkOprnds) {
+                    bool checkOprnds, int64_t minElements) {
   auto parent = op->getParentOp();
   if (!parent) {
     return ::mlir::failure();
@@ -79,6 +101,17 @@ matchAndRewritePTOP(::mlir::Operation *op, ::mlir::PatternRewriter &rewriter,
     return ::mlir::failure();
   }
 
+  // small compute ops are not worth the launch
+  if (minElements > 0 &&
+      ::mlir::isa<::imex::ndarray::EWBinOp, ::imex::ndarray::EWUnyOp,
+                  ::imex::ndarray::ReductionOp,
+                  ::imex::ndarray::CastElemTypeOp,
+                  ::imex::ndarray::LinSpaceOp>(op)) {
+    auto numElements = getMaxNumElements(op);
+    if (numElements && *numElements < minElements)
+      return ::mlir::failure();
+  }
+
   // create a region with given env and clone creator op within and yield it
   auto rOp = rewriter.create<::imex::region::EnvironmentRegionOp>(
       op->getLoc(), env, std::nullopt, op->getResultTypes(),
@@ -96,54 +129,58 @@ matchAndRewritePTOP(::mlir::Operation *op, ::mlir::PatternRewriter &rewriter,
 // The matchAndWrite method simply calls matchAndRewritePTOP
 template <typename PTOP, bool CHECK_OPERANDS = true>
 struct NDArrayOpRWP : public RecOpRewritePattern<PTOP> {
-  using RecOpRewritePattern<PTOP>::RecOpRewritePattern;
+  NDArrayOpRWP(::mlir::MLIRContext *ctx, int64_t minElements)
+      : RecOpRewritePattern<PTOP>(ctx), minElements(minElements) {}
 
   ::mlir::LogicalResult
   matchAndRewrite(PTOP op, ::mlir::PatternRewriter &rewriter) const override {
-    return matchAndRewritePTOP(op, rewriter, CHECK_OPERANDS);
+    return matchAndRewritePTOP(op, rewriter, CHECK_OPERANDS, minElements);
   }
+
+  int64_t minElements;
 };
 
 struct AddGPURegionsPass
     : public ::imex::impl::AddGPURegionsBase<AddGPURegionsPass> {
-
-  AddGPURegionsPass() = default;
+  using AddGPURegionsBase::AddGPURegionsBase;
 
   void runOnOperation() override {
-    ::mlir::FrozenRewritePatternSet patterns;
+    ::mlir::RewritePatternSet patterns(&getContext());
     // It would be nicer to have a single rewrite-pattern which covers all
     // NDArrayOps
-    insertPatterns<NDArrayOpRWP<::imex::ndarray::ToTensorOp>,
-                   NDArrayOpRWP<::imex::ndarray::FromMemRefOp>,
-                   NDArrayOpRWP<::imex::ndarray::DeleteOp>,
-                   NDArrayOpRWP<::imex::ndarray::DimOp>,
-                   NDArrayOpRWP<::imex::ndarray::SubviewOp>,
-                   NDArrayOpRWP<::imex::ndarray::ExtractSliceOp>,
-                   NDArrayOpRWP<::imex::ndarray::InsertSliceOp>,
-                   NDArrayOpRWP<::imex::ndarray::ImmutableInsertSliceOp>,
-                   NDArrayOpRWP<::imex::ndarray::LoadOp>,
-                   NDArrayOpRWP<::imex::ndarray::CopyOp, false>,
-                   NDArrayOpRWP<::imex::ndarray::CastOp>,
-                   NDArrayOpRWP<::imex::ndarray::CastElemTypeOp>,
-                   NDArrayOpRWP<::imex::ndarray::LinSpaceOp>,
-                   NDArrayOpRWP<::imex::ndarray::CreateOp>,
-                   NDArrayOpRWP<::imex::ndarray::ReshapeOp>,
-                   NDArrayOpRWP<::imex::ndarray::EWBinOp>,
-                   NDArrayOpRWP<::imex::ndarray::EWUnyOp>,
-                   NDArrayOpRWP<::imex::ndarray::ReductionOp>,
-                   NDArrayOpRWP<::imex::ndarray::PermuteDimsOp>,
-                   NDArrayOpRWP<::imex::dist::InitDistArrayOp>,
-                   NDArrayOpRWP<::imex::dist::LocalOffsetsOfOp>,
-                   NDArrayOpRWP<::imex::dist::PartsOfOp>,
-                   NDArrayOpRWP<::imex::dist::DefaultPartitionOp>,
-                   NDArrayOpRWP<::imex::dist::LocalTargetOfSliceOp>,
-                   NDArrayOpRWP<::imex::dist::LocalBoundingBoxOp>,
-                   NDArrayOpRWP<::imex::dist::LocalCoreOp>,
-                   NDArrayOpRWP<::imex::dist::RePartitionOp>,
-                   NDArrayOpRWP<::imex::dist::SubviewOp>,
-                   NDArrayOpRWP<::imex::dist::EWBinOp>,
-                   NDArrayOpRWP<::imex::dist::EWUnyOp>>(getContext(), patterns);
-    (void)::mlir::applyPatternsGreedily(this->getOperation(), patterns);
+    patterns.insert<NDArrayOpRWP<::imex::ndarray::ToTensorOp>,
+                    NDArrayOpRWP<::imex::ndarray::FromMemRefOp>,
+                    NDArrayOpRWP<::imex::ndarray::DeleteOp>,
+                    NDArrayOpRWP<::imex::ndarray::DimOp>,
+                    NDArrayOpRWP<::imex::ndarray::SubviewOp>,
+                    NDArrayOpRWP<::imex::ndarray::ExtractSliceOp>,
+                    NDArrayOpRWP<::imex::ndarray::InsertSliceOp>,
+                    NDArrayOpRWP<::imex::ndarray::ImmutableInsertSliceOp>,
+                    NDArrayOpRWP<::imex::ndarray::LoadOp>,
+                    NDArrayOpRWP<::imex::ndarray::CopyOp, false>,
+                    NDArrayOpRWP<::imex::ndarray::CastOp>,
+                    NDArrayOpRWP<::imex::ndarray::CastElemTypeOp>,
+                    NDArrayOpRWP<::imex::ndarray::LinSpaceOp>,
+                    NDArrayOpRWP<::imex::ndarray::CreateOp>,
+                    NDArrayOpRWP<::imex::ndarray::ReshapeOp>,
+                    NDArrayOpRWP<::imex::ndarray::EWBinOp>,
+                    NDArrayOpRWP<::imex::ndarray::EWUnyOp>,
+                    NDArrayOpRWP<::imex::ndarray::ReductionOp>,
+                    NDArrayOpRWP<::imex::ndarray::PermuteDimsOp>,
+                    NDArrayOpRWP<::imex::dist::InitDistArrayOp>,
+                    NDArrayOpRWP<::imex::dist::LocalOffsetsOfOp>,
+                    NDArrayOpRWP<::imex::dist::PartsOfOp>,
+                    NDArrayOpRWP<::imex::dist::DefaultPartitionOp>,
+                    NDArrayOpRWP<::imex::dist::LocalTargetOfSliceOp>,
+                    NDArrayOpRWP<::imex::dist::LocalBoundingBoxOp>,
+                    NDArrayOpRWP<::imex::dist::LocalCoreOp>,
+                    NDArrayOpRWP<::imex::dist::RePartitionOp>,
+                    NDArrayOpRWP<::imex::dist::SubviewOp>,
+                    NDArrayOpRWP<::imex::dist::EWBinOp>,
+                    NDArrayOpRWP<::imex::dist::EWUnyOp>>(&getContext(),
+                                                          minGPUElements);
+    (void)::mlir::applyPatternsGreedily(this->getOperation(),
+                                        std::move(patterns));
   }
 };
 
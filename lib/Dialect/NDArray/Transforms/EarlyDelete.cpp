@@ -0,0 +1,101 @@
+//===- EarlyDelete.cpp - NDArray EarlyDelete Transform ----------*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file This file implements inserting ndarray.delete right after the last
+///       use of arrays and their views.
+///
+//===----------------------------------------------------------------------===//
+
+#include <imex/Dialect/NDArray/IR/NDArrayOps.h>
+#include <imex/Dialect/NDArray/Transforms/Passes.h>
+
+#include <mlir/IR/Builders.h>
+#include <mlir/Interfaces/CallInterfaces.h>
+
+namespace imex {
+#define GEN_PASS_DEF_EARLYDELETE
+#include <imex/Dialect/NDArray/Transforms/Passes.h.inc>
+} // namespace imex
+
+namespace imex {
+namespace {
+
+/// Return true if the results of op never alias its operands.
+static bool hasFreshResults(::mlir::Operation *op) {
+  return ::mlir::isa<::imex::ndarray::CopyOp, ::imex::ndarray::EWBinOp,
+                     ::imex::ndarray::EWUnyOp, ::imex::ndarray::ReductionOp>(
+      op);
+}
+
+/// Return true if type can hold a reference to the memory of an array.
+static bool mayReference(::mlir::Type type) {
+  return ::mlir::isa<::imex::ndarray::NDArrayType, ::mlir::ShapedType>(type);
+}
+
+/// Return the operation in the block of array after which array can be
+/// deleted, nullptr if it cannot be deleted. Every value which might share
+/// the memory of array holds a reference to it, the last use of all of them
+/// releases the memory.
+static ::mlir::Operation *getLastUse(::mlir::Value array) {
+  auto block = array.getParentBlock();
+  ::mlir::Operation *last = array.getDefiningOp();
+  ::mlir::SmallVector<::mlir::Value> refs = {array};
+  while (!refs.empty()) {
+    auto ref = refs.pop_back_val();
+    for (auto user : ref.getUsers()) {
+      // the array is already deleted or escapes
+      if (::mlir::isa<::imex::ndarray::DeleteOp, ::mlir::CallOpInterface>(
+              user) ||
+          user->hasTrait<::mlir::OpTrait::IsTerminator>() ||
+          user->getNumRegions() > 0)
+        return nullptr;
+      auto op = block->findAncestorOpInBlock(*user);
+      if (!op)
+        return nullptr;
+      if (last->isBeforeInBlock(op))
+        last = op;
+      if (hasFreshResults(user))
+        continue;
+      for (auto res : user->getResults())
+        if (mayReference(res.getType()))
+          refs.emplace_back(res);
+    }
+  }
+  return last->hasTrait<::mlir::OpTrait::IsTerminator>() ? nullptr : last;
+}
+
+struct EarlyDeletePass
+    : public ::imex::impl::EarlyDeleteBase<EarlyDeletePass> {
+  using EarlyDeleteBase::EarlyDeleteBase;
+
+  void runOnOperation() override {
+    ::mlir::SmallVector<::mlir::Value> arrays;
+    this->getOperation()->walk([&](::mlir::Operation *op) {
+      if (::mlir::isa<::imex::ndarray::CreateOp, ::imex::ndarray::LinSpaceOp,
+                      ::imex::ndarray::CopyOp>(op))
+        arrays.emplace_back(op->getResult(0));
+    });
+
+    for (auto array : arrays) {
+      if (auto last = getLastUse(array)) {
+        ::mlir::OpBuilder builder(last->getContext());
+        builder.setInsertionPointAfter(last);
+        builder.create<::imex::ndarray::DeleteOp>(array.getLoc(), array);
+      }
+    }
+  }
+};
+
+} // namespace
+
+std::unique_ptr<::mlir::Pass> createEarlyDeletePass() {
+  return std::make_unique<::imex::EarlyDeletePass>();
+}
+
+} // namespace imex
@@ -170,17 +170,26 @@ struct DistEWBinOpRWP : public DistOpRWP<::imex::ndarray::EWBinOp> {
         mlir::dyn_cast<::imex::ndarray::NDArrayType>(op.getType());
 
     // Repartition if necessary
+    // Operands of lower rank get broadcasted along the split dimension of the
+    // result, so every process needs all of them; they get replicated instead
+    // of partitioned like the result.
     // FIXME: this breaks with dim-sizes==1, even if statically known
-    auto rbLhs =
-        rhs == lhs || lhsDistTyp.getRank() == 0
-            ? lhs
-            : createRePartition(loc, rewriter, lhs); //, tOffs, tSizes);
+    auto repartition = [&](::mlir::Value ary,
+                           ::imex::ndarray::NDArrayType arTyp) {
+      if (arTyp.getRank() == outDistTyp.getRank()) {
+        return createRePartition(loc, rewriter, ary); //, tOffs, tSizes);
+      }
+      auto gShape = createGlobalShapeOf(loc, rewriter, ary);
+      ::imex::ValVec tOffs(arTyp.getRank(), createIndex(loc, rewriter, 0));
+      return createRePartition(loc, rewriter, ary, tOffs, gShape);
+    };
+    auto rbLhs = rhs == lhs || lhsDistTyp.getRank() == 0
+                     ? lhs
+                     : repartition(lhs, lhsDistTyp);
     auto rbRhs =
         rhs == lhs
             ? rbLhs
-            : (rhsDistTyp.getRank() == 0
-                   ? rhs
-                   : createRePartition(loc, rewriter, rhs)); //, tOffs, tSizes);
+            : (rhsDistTyp.getRank() == 0 ? rhs : repartition(rhs, rhsDistTyp));
 
     auto empty = ::mlir::ValueRange{};
     rewriter.replaceOpWithNewOp<::imex::dist::EWBinOp>(
@@ -20,6 +20,7 @@
 #include <mlir/IR/DialectImplementation.h>
 #include <mlir/IR/PatternMatch.h>
 #include <mlir/Interfaces/ControlFlowInterfaces.h>
+#include <mlir/Interfaces/SideEffectInterfaces.h>
 
 namespace imex {
 namespace region {
@@ -161,7 +162,79 @@ struct MergeAdjacentRegions
   }
 };
 
-/// Remove duplicated and unused env region yield args.
+/// Move side-effect free ops between an env region and a later env region
+/// with the same environment before the first one, so that the regions become
+/// adjacent and get merged.
+struct HoistOpsBetweenRegions
+    : public mlir::OpRewritePattern<EnvironmentRegionOp> {
+  using OpRewritePattern::OpRewritePattern;
+
+  mlir::LogicalResult
+  matchAndRewrite(EnvironmentRegionOp op,
+                  mlir::PatternRewriter &rewriter) const override {
+    llvm::SmallVector<mlir::Operation *> toHoist;
+    auto *block = op->getBlock();
+    for (auto it = std::next(op->getIterator()); it != block->end(); ++it) {
+      mlir::Operation *current = &*it;
+      if (auto nextOp = mlir::dyn_cast<EnvironmentRegionOp>(current)) {
+        if (toHoist.empty() || nextOp.getEnvironment() != op.getEnvironment() ||
+            nextOp.getArgs() != op.getArgs())
+          return mlir::failure();
+
+        for (auto *hoisted : toHoist)
+          rewriter.moveOpBefore(hoisted, op);
+        return mlir::success();
+      }
+
+      // Only ops without regions, which do not use the results of the first
+      // region, can be moved.
+      if (current->hasTrait<mlir::OpTrait::IsTerminator>() ||
+          current->getNumRegions() != 0 || !mlir::isMemoryEffectFree(current))
+        return mlir::failure();
+      for (auto operand : current->getOperands())
+        if (operand.getDefiningOp() == op)
+          return mlir::failure();
+      toHoist.push_back(current);
+    }
+    return mlir::failure();
+  }
+};
+
+/// Move side-effect free scalar computations, which only use values defined
+/// above the env region, out of the region, so that they run on the host and
+/// can be shared with other regions.
+struct HoistScalarOpsFromRegion
+    : public mlir::OpRewritePattern<EnvironmentRegionOp> {
+  using OpRewritePattern::OpRewritePattern;
+
+  mlir::LogicalResult
+  matchAndRewrite(EnvironmentRegionOp op,
+                  mlir::PatternRewriter &rewriter) const override {
+    mlir::Region &region = op.getRegion();
+    bool changed = false;
+    for (auto &inner :
+         llvm::make_early_inc_range(region.front().without_terminator())) {
+      if (inner.getNumResults() == 0 || inner.getNumRegions() != 0 ||
+          !mlir::isMemoryEffectFree(&inner))
+        continue;
+      if (!llvm::all_of(inner.getResultTypes(), [](mlir::Type type) {
+            return type.isIntOrIndexOrFloat();
+          }))
+        continue;
+      // Operands hoisted before are defined above the region by now.
+      if (llvm::any_of(inner.getOperands(), [&](mlir::Value operand) {
+            return region.isAncestor(operand.getParentRegion());
+          }))
+        continue;
+      rewriter.moveOpBefore(&inner, op);
+      changed = true;
+    }
+    return mlir::success(changed);
+  }
+};
+
+/// Remove duplicated and unused env region yield args, and yield args defined
+/// above the region, whose results are replaced by the args themselves.
 struct CleanupRegionYieldArgs
     : public mlir::OpRewritePattern<EnvironmentRegionOp> {
   using OpRewritePattern::OpRewritePattern;
@@ -180,6 +253,7 @@ struct CleanupRegionYieldArgs
     // Build new yield args list, and mapping between old and new results
     llvm::SmallVector<mlir::Value> newYieldArgs;
     llvm::SmallVector<int> newResultsMapping(count, -1);
+    llvm::SmallVector<mlir::Value> forwardedArgs(count);
     llvm::SmallDenseMap<mlir::Value, int> argsMap;
     for (auto i : llvm::seq(0u, count)) {
       auto res = results[i];
@@ -188,7 +262,13 @@ struct CleanupRegionYieldArgs
       if (res.getUses().empty())
         continue;
 
+      // Value defined above the region, use it directly.
       auto arg = yieldArgs[i];
+      if (!op.getRegion().isAncestor(arg.getParentRegion())) {
+        forwardedArgs[i] = arg;
+        continue;
+      }
+
       auto it = argsMap.find_as(arg);
       if (it == argsMap.end()) {
         // Add new result, compute index mapping for it.
@@ -226,6 +306,8 @@ struct CleanupRegionYieldArgs
       auto mapInd = newResultsMapping[i];
       if (mapInd != -1)
         newResultsToTeplace[i] = newResults[mapInd];
+      else
+        newResultsToTeplace[i] = forwardedArgs[i];
     }
 
     rewriter.replaceOp(op, newResultsToTeplace);
@@ -235,7 +317,8 @@ struct CleanupRegionYieldArgs
 
 void EnvironmentRegionOp::getCanonicalizationPatterns(
     mlir::RewritePatternSet &results, mlir::MLIRContext *context) {
-  results.insert<MergeAdjacentRegions, CleanupRegionYieldArgs>(context);
+  results.insert<MergeAdjacentRegions, HoistOpsBetweenRegions,
+                 HoistScalarOpsFromRegion, CleanupRegionYieldArgs>(context);
 }
 
 } // namespace region
@@ -39,6 +39,12 @@ convertToBuffers(::mlir::ValueRange values,
 
 /// Bufferization of region.env_region op. Replaced with a new
 /// op that takes and returns memrefs.
+///
+/// The region accesses tensors defined above directly, so its ops take part
+/// in the analysis like any other op. The arguments only describe the
+/// environment and are read, but not written, by the op itself. Each result
+/// is equivalent to the value yielded for it, so tensors updated in place
+/// within the region are neither allocated nor copied at the region edge.
 struct EnvironmentRegionOpInterface
     : public ::mlir::bufferization::BufferizableOpInterface::ExternalModel<
           EnvironmentRegionOpInterface, region::EnvironmentRegionOp> {
@@ -56,17 +62,31 @@ struct EnvironmentRegionOpInterface
       const ::mlir::bufferization::AnalysisState &state) const {
     assert(::mlir::isa<::mlir::RankedTensorType>(opOperand.get().getType()) &&
            "only tensor types expected");
-    // Assume all operands are written to.
-    return true;
+    // Writes happen in the ops of the region, not through the arguments.
+    return false;
   }
 
   ::mlir::bufferization::AliasingValueList
   getAliasingValues(::mlir::Operation *op, ::mlir::OpOperand &opOperand,
                     const ::mlir::bufferization::AnalysisState &state) const {
-    // Assume no aliasing.
+    // Arguments are not returned.
     return {};
   }
 
+  ::mlir::bufferization::AliasingOpOperandList
+  getAliasingOpOperands(
+      ::mlir::Operation *op, ::mlir::Value value,
+      const ::mlir::bufferization::AnalysisState &state) const {
+    // A result is the value yielded for it. Considering them aliasing allows
+    // the analysis to follow use-def chains through the region.
+    auto envOp = ::mlir::cast<region::EnvironmentRegionOp>(op);
+    auto result = ::mlir::cast<::mlir::OpResult>(value);
+    auto *term = envOp.getBody()->getTerminator();
+    return {{&term->getOpOperand(result.getResultNumber()),
+             ::mlir::bufferization::BufferRelation::Equivalent,
+             /*isDefinite=*/true}};
+  }
+
   ::mlir::LogicalResult
   bufferize(::mlir::Operation *op, ::mlir::RewriterBase &rewriter,
             const ::mlir::bufferization::BufferizationOptions &options) const {
@@ -19,9 +19,11 @@
 
 #include "imex/Dialect/XeTile/IR/XeTileOps.h"
 #include "imex/Dialect/XeTile/Transforms/Passes.h"
+#include "imex/Utils/Remarks.h"
 #include "imex/Utils/XeArch.h"
 #include "imex/Utils/XeCommon.h"
 #include "mlir/Dialect/Arith/IR/Arith.h"
+#include "mlir/Dialect/GPU/IR/GPUDialect.h"
 #include "mlir/Dialect/Index/IR/IndexDialect.h"
 #include "mlir/Dialect/Index/IR/IndexOps.h"
 #include "mlir/Dialect/MemRef/IR/MemRef.h"
@@ -29,6 +31,7 @@
 #include "mlir/Dialect/Vector/IR/VectorOps.h"
 #include "mlir/IR/BuiltinAttributes.h"
 #include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/IRMapping.h"
 #include "mlir/IR/Operation.h"
 #include "mlir/IR/PatternMatch.h"
 #include "mlir/IR/Value.h"
@@ -36,6 +39,7 @@
 #include "mlir/Pass/Pass.h"
 #include "mlir/Support/LLVM.h"
 #include "mlir/Transforms/GreedyPatternRewriteDriver.h"
+#include "llvm/Support/FormatVariadic.h"
 
 namespace imex {
 #define GEN_PASS_DEF_XETILEBLOCKOPFALLBACK
@@ -44,8 +48,10 @@ namespace imex {
 
 //
 // Limitations and future plan:
-// Currently limited to 2D static shaped source memref of row major order.
-// Dynamic shape with known pitch value will be supported in the future.
+// Currently limited to 2D source memref of row or column major order.
+// Tiles whose pitch is only known at runtime are versioned at the kernel
+// level, tiles defined in nested regions of the pitch definition and kernels
+// with multiple blocks always fall back.
 // Scattered offset is calculated by generated code sequence but will be
 // using constant immediate values for static shapes in the future.
 // Current code sequence is not optimal for supporting blocking pass and
@@ -79,63 +85,141 @@ static imex::xetile::TileType addScatterAttr(imex::xetile::TileType tileTy) {
                                      scatterTileAttr);
 }
 
+static bool isColMajor(imex::xetile::TileType tileTy) {
+  return tileTy.getOrder().asArrayRef() == llvm::ArrayRef<int32_t>{0, 1};
+}
+
+// Returns true if initTileOp creates a 2D block tile of a 2D memref in row or
+// column major order, the tiles handled by the fallback.
+static bool isFallbackCandidate(imex::xetile::InitTileOp initTileOp) {
+  auto tileTy = initTileOp.getType();
+  // Skip if tile is scattered or 1D
+  if (tileTy.getScatterAttr() || tileTy.getRank() < 2) {
+    return false;
+  }
+  auto order = tileTy.getOrder().asArrayRef();
+  if (order != llvm::ArrayRef<int32_t>{1, 0} && !isColMajor(tileTy)) {
+    return false;
+  }
+  // Currenty only supports 2D memref source
+  if (!initTileOp.isSourceMemRef()) {
+    return false;
+  }
+  return mlir::cast<mlir::MemRefType>(initTileOp.getSourceType()).getRank() ==
+         2;
+}
+
+// Returns the pitch of the 2D block accesses of initTileOp, i.e. the stride
+// of the outer dimension in the tile order, or null if the inner dimension is
+// not contiguous, e.g. for a strided view, which block ops cannot access.
+static mlir::OpFoldResult getBlockPitch(imex::xetile::InitTileOp initTileOp) {
+  bool colMajor = isColMajor(initTileOp.getType());
+  auto strides = initTileOp.getMixedStrides();
+  if (!mlir::isConstantIntValue(strides[colMajor ? 0 : 1], 1)) {
+    return nullptr;
+  }
+  return strides[colMajor ? 1 : 0];
+}
+
+static bool isValidBlockPitch(int64_t pitchNumBytes,
+                              const imex::LoadStore2DConfig &conf) {
+  return (pitchNumBytes >= conf.minPitch) &&
+         (pitchNumBytes % conf.pitchMultiple == 0);
+}
+
+// Returns the offset of memref in its underlying buffer, a runtime value
+// for dynamic offsets, or null if memref does not have a strided layout.
+static mlir::OpFoldResult getSourceOffset(mlir::PatternRewriter &rewriter,
+                                          mlir::Location loc,
+                                          mlir::Value memref) {
+  auto memrefTy = mlir::cast<mlir::MemRefType>(memref.getType());
+  llvm::SmallVector<int64_t> strides;
+  int64_t offset;
+  if (mlir::failed(memrefTy.getStridesAndOffset(strides, offset))) {
+    return nullptr;
+  }
+  if (!mlir::ShapedType::isDynamic(offset)) {
+    return rewriter.getIndexAttr(offset);
+  }
+  return rewriter.create<mlir::memref::ExtractStridedMetadataOp>(loc, memref)
+      .getOffset();
+}
+
+// Returns the number of elements of a flat memref covering the 2D view of
+// sizes and strides at offset.
+static mlir::OpFoldResult
+getFlatSize(mlir::PatternRewriter &rewriter, mlir::Location loc,
+            mlir::OpFoldResult offset,
+            llvm::ArrayRef<mlir::OpFoldResult> sizes,
+            llvm::ArrayRef<mlir::OpFoldResult> strides) {
+  auto staticOffset = mlir::getConstantIntValue(offset);
+  auto staticSizes = mlir::getConstantIntValues(sizes);
+  auto staticStrides = mlir::getConstantIntValues(strides);
+  if (staticOffset && staticSizes && staticStrides) {
+    int64_t flatSize = *staticOffset + 1;
+    for (auto [size, stride] : llvm::zip_equal(*staticSizes, *staticStrides))
+      flatSize += (size - 1) * stride;
+    return rewriter.getIndexAttr(flatSize);
+  }
+  auto toValue = [&](mlir::OpFoldResult ofr) {
+    return imex::getValueOrConstantOp(ofr, loc, rewriter,
+                                      rewriter.getIndexType());
+  };
+  auto one = rewriter.create<mlir::arith::ConstantIndexOp>(loc, 1);
+  mlir::Value flatSize =
+      rewriter.createOrFold<mlir::arith::AddIOp>(loc, toValue(offset), one);
+  for (auto [size, stride] : llvm::zip_equal(sizes, strides)) {
+    auto last =
+        rewriter.createOrFold<mlir::arith::SubIOp>(loc, toValue(size), one);
+    auto extent = rewriter.createOrFold<mlir::arith::MulIOp>(loc, last,
+                                                             toValue(stride));
+    flatSize =
+        rewriter.createOrFold<mlir::arith::AddIOp>(loc, flatSize, extent);
+  }
+  return flatSize;
+}
+
 struct InitTileOpPattern final
     : public mlir::OpRewritePattern<imex::xetile::InitTileOp> {
 public:
-  llvm::DenseSet<mlir::Value> &convertToScatteredType;
+  llvm::DenseMap<mlir::Value, llvm::StringRef> &convertToScatteredType;
+  const imex::MissedOptRemarks &remarks;
 
   InitTileOpPattern(mlir::MLIRContext *context,
                     std::shared_ptr<imex::XeuArchInterface> uArch,
-                    llvm::DenseSet<mlir::Value> &map)
+                    llvm::DenseMap<mlir::Value, llvm::StringRef> &map,
+                    const imex::MissedOptRemarks &remarks)
       : OpRewritePattern<imex::xetile::InitTileOp>(context),
-        convertToScatteredType(map) {
+        convertToScatteredType(map), remarks(remarks) {
     uArchInterface = uArch;
   }
 
   mlir::LogicalResult
   matchAndRewrite(imex::xetile::InitTileOp initTileOp,
                   mlir::PatternRewriter &rewriter) const override {
-    auto tileTy = initTileOp.getType();
-    // Skip if tile is scattered
-    if (tileTy.getScatterAttr()) {
-      return mlir::failure();
-    }
-    // Skip 1D tile
-    if (tileTy.getRank() < 2) {
-      return mlir::failure();
-    }
-    // Skip if tile is column major
-    if (tileTy.getOrder().asArrayRef() != llvm::ArrayRef<int32_t>{1, 0}) {
-      return mlir::failure();
-    }
-    // Currenty only supports memref source
-    if (!initTileOp.isSourceMemRef()) {
-      return mlir::failure();
-    }
-    // Cannot handle non static shape
-    if (!initTileOp.sourceMemRefHasStaticShape()) {
-      return mlir::failure();
-    }
-
-    auto srcShape = initTileOp.getSourceMemrefStaticShape();
-    // Cannot handle non 2D source memref
-    if (srcShape.size() != 2) {
+    if (!isFallbackCandidate(initTileOp)) {
       return mlir::failure();
     }
+    auto tileTy = initTileOp.getType();
+    bool colMajor = isColMajor(tileTy);
     // Check if memspace is SLM
     auto memorySpace = initTileOp.getSourceMemorySpaceAsInt();
     bool isSLM = memorySpace == 3;
-    // Check pitch >= 64bytes and pitch is multiple of 16bytes
-    bool isValidPitch = true;
-    auto pitchNumElems = srcShape[srcShape.size() - 1];
+    // Check the source is contiguous in the inner dimension, pitch >= 64bytes
+    // and pitch is multiple of 16bytes. A pitch only known at runtime is
+    // checked by the kernel versioning of versionRuntimePitches, the tile
+    // is marked for conversion in its scattered version.
+    auto pitch = getBlockPitch(initTileOp);
+    auto staticPitch =
+        pitch ? mlir::getConstantIntValue(pitch) : std::optional<int64_t>();
     auto elemBitwidth =
         initTileOp.getSourceMemrefElemType().getIntOrFloatBitWidth();
-    auto pitchNumBytes = pitchNumElems * elemBitwidth / 8;
     auto config = uArchInterface->get2DPrefetchConfig(initTileOp.getOperation(),
                                                       elemBitwidth);
     auto conf = config.value();
-    isValidPitch = (pitchNumBytes >= conf.minPitch) &&
-                   (pitchNumBytes % conf.pitchMultiple == 0);
+    bool isValidPitch =
+        pitch && (!staticPitch ||
+                  isValidBlockPitch(*staticPitch * elemBitwidth / 8, conf));
 
     bool convertToScatter =
         convertToScatteredType.contains(initTileOp.getResult());
@@ -144,7 +228,8 @@ public:
     if (!isSLM && isValidPitch && !convertToScatter) {
       return mlir::failure();
     }
-    bool mayNeedMask = (pitchNumElems % tileTy.getShape().back() != 0);
+    auto tileWidth = tileTy.getShape()[colMajor ? 0 : 1];
+    bool mayNeedMask = staticPitch && (*staticPitch % tileWidth != 0);
     if (mayNeedMask) {
       return mlir::failure();
     }
@@ -169,25 +254,32 @@ public:
       return mlir::failure();
     }
 
-    // Get flat shape size
-    int64_t flatSize = 1;
-    for (auto dim : srcShape) {
-      flatSize *= dim;
+    auto loc = initTileOp.getLoc();
+    auto srcOffset = getSourceOffset(rewriter, loc, src);
+    if (!srcOffset) {
+      return rewriter.notifyMatchFailure(initTileOp,
+                                         "Source is not a strided memref.");
     }
+    auto sizes = initTileOp.getMixedSizes();
+    auto strides = initTileOp.getMixedStrides();
 
-    // reinterpret_cast to flat memref of flatSize
+    // reinterpret_cast to flat memref covering the source. The flat memref
+    // starts at the base of the source, its offset is added to the indices.
+    auto flatSize = getFlatSize(rewriter, loc, srcOffset, sizes, strides);
+    auto staticFlatSize = mlir::getConstantIntValue(flatSize);
     mlir::MemRefLayoutAttrInterface layout = {};
-    // Is source offset always 0? No API to check.
     auto flatMemref = rewriter.create<mlir::memref::ReinterpretCastOp>(
-        initTileOp.getLoc(),
-        mlir::MemRefType::get({flatSize}, initTileOp.getSourceMemrefElemType(),
-                              layout, initTileOp.getSourceMemorySpace()),
-        initTileOp.getSource(), 0, llvm::ArrayRef<int64_t>{flatSize},
-        llvm::ArrayRef<int64_t>{1});
+        loc,
+        mlir::MemRefType::get(
+            {staticFlatSize.value_or(mlir::ShapedType::kDynamic)},
+            initTileOp.getSourceMemrefElemType(), layout,
+            initTileOp.getSourceMemorySpace()),
+        src, rewriter.getIndexAttr(0),
+        llvm::ArrayRef<mlir::OpFoldResult>{flatSize},
+        llvm::ArrayRef<mlir::OpFoldResult>{rewriter.getIndexAttr(1)});
 
     // Create indices for scatter
     auto offsets = initTileOp.getMixedOffsets();
-    auto loc = initTileOp.getLoc();
     auto offsetX = imex::getValueOrConstantOp(offsets[0], loc, rewriter,
                                               rewriter.getIndexType());
     auto offsetY = imex::getValueOrConstantOp(offsets[1], loc, rewriter,
@@ -248,22 +340,59 @@ public:
           loc, indexVecTy, rowOffsetVec);
     }
 
-    // create [pitchNumElems] splatted to TileShape
-    auto stride = rewriter.createOrFold<mlir::arith::ConstantOp>(
-        loc, rewriter.getIndexType(), rewriter.getIndexAttr(pitchNumElems));
+    // create [stride0] splatted to TileShape
+    auto stride = imex::getValueOrConstantOp(strides[0], loc, rewriter,
+                                             rewriter.getIndexType());
     auto strideTile =
         rewriter.createOrFold<mlir::vector::SplatOp>(loc, indexVecTy, stride);
     // Create a temp with just rowTile * strideTile
     auto rowStrideTile = rewriter.createOrFold<mlir::arith::MulIOp>(
         loc, indexVecTy, rowOffsetTile, strideTile);
+    // Scale step by stride1 for column major and strided sources
+    if (!mlir::isConstantIntValue(strides[1], 1)) {
+      auto colStride = imex::getValueOrConstantOp(strides[1], loc, rewriter,
+                                                  rewriter.getIndexType());
+      auto colStrideTile = rewriter.createOrFold<mlir::vector::SplatOp>(
+          loc, indexVecTy, colStride);
+      stepOffsetTile = rewriter.createOrFold<mlir::arith::MulIOp>(
+          loc, indexVecTy, stepOffsetTile, colStrideTile);
+    }
     // Create scatter indices complete row*stride + step
-    auto indices = mlir::dyn_cast_or_null<mlir::TypedValue<mlir::VectorType>>(
-        rewriter.createOrFold<mlir::arith::AddIOp>(
-            loc, indexVecTy, rowStrideTile, stepOffsetTile));
+    mlir::Value indexTile = rewriter.createOrFold<mlir::arith::AddIOp>(
+        loc, indexVecTy, rowStrideTile, stepOffsetTile);
+    // Add the offset of the source
+    if (!mlir::isConstantIntValue(srcOffset, 0)) {
+      auto offset = imex::getValueOrConstantOp(srcOffset, loc, rewriter,
+                                               rewriter.getIndexType());
+      auto offsetTile =
+          rewriter.createOrFold<mlir::vector::SplatOp>(loc, indexVecTy, offset);
+      indexTile = rewriter.createOrFold<mlir::arith::AddIOp>(
+          loc, indexVecTy, indexTile, offsetTile);
+    }
+    auto indices =
+        mlir::dyn_cast_or_null<mlir::TypedValue<mlir::VectorType>>(indexTile);
     if (!indices) {
       return rewriter.notifyMatchFailure(initTileOp,
                                          "Could not generate scatter indices.");
     }
+    if (remarks.isEnabled()) {
+      std::string reason;
+      if (isSLM)
+        reason = "shared local memory without optimal SLM access";
+      else if (!pitch)
+        reason = "source is not contiguous in the inner dimension";
+      else if (!isValidPitch)
+        reason = llvm::formatv("pitch of {0} bytes is less than {1} bytes or "
+                               "not a multiple of {2} bytes",
+                               *staticPitch * elemBitwidth / 8, conf.minPitch,
+                               conf.pitchMultiple)
+                     .str();
+      else
+        reason = convertToScatteredType.lookup(initTileOp.getResult()).str();
+      remarks.emit(initTileOp, "ScatteredTile",
+                   "falling back to scattered ops: " + reason);
+    }
+
     // Add scatter attribute to tile type
     auto scatterTileTy = addScatterAttr(tileTy);
     // Replace InitTileOp
@@ -400,16 +529,38 @@ struct UpdateTileOffsetOpPattern final
                                          "Source is not a ranked memref.");
     }
     auto baseMemrefTy = mlir::dyn_cast<mlir::MemRefType>(baseMemref.getType());
-    auto baseShape = baseMemrefTy.getShape();
-    auto pitchNumElems = baseShape[baseShape.size() - 1];
+    llvm::SmallVector<int64_t> baseStrides;
+    int64_t baseOffset;
+    if (mlir::failed(
+            baseMemrefTy.getStridesAndOffset(baseStrides, baseOffset))) {
+      return rewriter.notifyMatchFailure(updateTileOffsetOp,
+                                         "Source is not a strided memref.");
+    }
     auto loc = updateTileOffsetOp.getLoc();
-    // Create update indices by doing vector.splat with (offX*stride + offY)
-    auto pitch = rewriter.create<mlir::arith::ConstantOp>(
-        loc, rewriter.getIndexType(), rewriter.getIndexAttr(pitchNumElems));
+    // Dynamic strides are read from the source memref, they are the strides
+    // of the InitTileOp before the fallback.
+    mlir::memref::ExtractStridedMetadataOp metadata;
+    auto getStride = [&](unsigned dim) -> mlir::Value {
+      if (!mlir::ShapedType::isDynamic(baseStrides[dim]))
+        return rewriter.create<mlir::arith::ConstantOp>(
+            loc, rewriter.getIndexType(),
+            rewriter.getIndexAttr(baseStrides[dim]));
+      if (!metadata)
+        metadata = rewriter.create<mlir::memref::ExtractStridedMetadataOp>(
+            loc, baseMemref);
+      return metadata.getStrides()[dim];
+    };
+    // Create update indices by doing vector.splat with
+    // (offX*stride0 + offY*stride1)
+    auto pitch = getStride(0);
     auto offX = updateTileOffsetOp.getOffsetX();
     auto stride = rewriter.createOrFold<mlir::arith::MulIOp>(
         loc, rewriter.getIndexType(), offX, pitch);
-    auto offY = updateTileOffsetOp.getOffsetY();
+    mlir::Value offY = updateTileOffsetOp.getOffsetY();
+    if (baseStrides[1] != 1) {
+      offY = rewriter.createOrFold<mlir::arith::MulIOp>(
+          loc, rewriter.getIndexType(), offY, getStride(1));
+    }
     auto index = rewriter.createOrFold<mlir::arith::AddIOp>(
         loc, rewriter.getIndexType(), stride, offY);
     auto indices = rewriter.createOrFold<mlir::vector::SplatOp>(
@@ -515,9 +666,9 @@ mlir::Operation *findInitializeOp(mlir::Value val) {
   return nullptr;
 }
 
-static void
-analyzeAtomicRMWOp(mlir::Operation *op,
-                   llvm::DenseSet<mlir::Value> &convertToScatteredType) {
+static void analyzeAtomicRMWOp(
+    mlir::Operation *op,
+    llvm::DenseMap<mlir::Value, llvm::StringRef> &convertToScatteredType) {
 
   op->walk([&](imex::xetile::AtomicRMWOp atomicrmwOp) -> mlir::WalkResult {
     auto tileTy = atomicrmwOp.getTile().getType();
@@ -531,23 +682,158 @@ analyzeAtomicRMWOp(mlir::Operation *op,
       return mlir::failure();
 
     // At this point, we have a candidate def-use chain for optimization.
-    convertToScatteredType.insert(initializeOp->getResult(0));
+    convertToScatteredType.insert(
+        {initializeOp->getResult(0), "tile is used by atomic_rmw"});
     return mlir::WalkResult::advance();
   });
 }
 
+// Versions the body of kernels using tiles whose pitch is only known at
+// runtime. The body runs under a check that all these pitches are legal for
+// block ops, and a copy of the body with the tiles marked for the scattered
+// fallback runs otherwise:
+//
+//   scf.if %pitches_are_legal {
+//     body (block ops)
+//   } else {
+//     body (scattered ops)
+//   }
+//
+// Tiles whose pitch is not defined before the part of the body they are
+// used in always fall back.
+static void versionRuntimePitches(
+    mlir::Operation *op, std::shared_ptr<imex::XeuArchInterface> uArchInterface,
+    llvm::DenseMap<mlir::Value, llvm::StringRef> &convertToScatteredType) {
+  op->walk([&](mlir::gpu::GPUFuncOp func) {
+    llvm::SmallVector<std::pair<imex::xetile::InitTileOp, mlir::Value>>
+        runtimeTiles;
+    func.walk([&](imex::xetile::InitTileOp initTileOp) {
+      if (!isFallbackCandidate(initTileOp) ||
+          initTileOp.getSourceMemorySpaceAsInt() == 3)
+        return;
+      auto pitch = getBlockPitch(initTileOp);
+      if (pitch && !mlir::getConstantIntValue(pitch))
+        runtimeTiles.push_back({initTileOp, mlir::cast<mlir::Value>(pitch)});
+    });
+    if (runtimeTiles.empty())
+      return;
+
+    auto &body = func.front();
+    if (!func.getBody().hasOneBlock() ||
+        !mlir::isa<mlir::gpu::ReturnOp>(body.getTerminator())) {
+      for (auto [initTileOp, pitch] : runtimeTiles)
+        convertToScatteredType.insert(
+            {initTileOp.getResult(),
+             "pitch only known at runtime in a kernel with multiple blocks"});
+      return;
+    }
+
+    // The versioned part of the body starts after the ops of the body
+    // defining the pitches.
+    mlir::Operation *versionPoint = nullptr;
+    llvm::SmallVector<std::pair<imex::xetile::InitTileOp, mlir::Value>>
+        versionedTiles;
+    for (auto [initTileOp, pitch] : runtimeTiles) {
+      auto *def = pitch.getDefiningOp();
+      auto *ancestor = def ? body.findAncestorOpInBlock(*def) : nullptr;
+      if (def && (!ancestor || ancestor->isAncestor(initTileOp))) {
+        convertToScatteredType.insert(
+            {initTileOp.getResult(),
+             "pitch only known at runtime and defined in a nested region"});
+        continue;
+      }
+      if (ancestor &&
+          (!versionPoint || versionPoint->isBeforeInBlock(ancestor)))
+        versionPoint = ancestor;
+      versionedTiles.push_back({initTileOp, pitch});
+    }
+    if (versionedTiles.empty())
+      return;
+
+    auto begin = versionPoint ? std::next(versionPoint->getIterator())
+                              : body.begin();
+    llvm::SmallVector<mlir::Operation *> ops;
+    auto end = body.getTerminator()->getIterator();
+    for (auto &op : llvm::make_range(begin, end))
+      ops.push_back(&op);
+    // Tiles created before the version point fall back.
+    llvm::SmallVector<std::pair<imex::xetile::InitTileOp, mlir::Value>>
+        checkedTiles;
+    for (auto &tile : versionedTiles) {
+      if (llvm::any_of(ops, [&](mlir::Operation *op) {
+            return op->isAncestor(tile.first);
+          }))
+        checkedTiles.push_back(tile);
+      else
+        convertToScatteredType.insert(
+            {tile.first.getResult(),
+             "pitch only known at runtime and tile created before it"});
+    }
+    if (checkedTiles.empty())
+      return;
+
+    auto loc = func.getLoc();
+    mlir::OpBuilder builder(ops.front());
+    auto i1Ty = builder.getI1Type();
+    mlir::Value isLegal = builder.create<mlir::arith::ConstantOp>(
+        loc, i1Ty, builder.getIntegerAttr(i1Ty, 1));
+    for (auto [initTileOp, pitch] : checkedTiles) {
+      auto elemBitwidth =
+          initTileOp.getSourceMemrefElemType().getIntOrFloatBitWidth();
+      auto conf = uArchInterface
+                      ->get2DPrefetchConfig(initTileOp.getOperation(),
+                                            elemBitwidth)
+                      .value();
+      auto createIndexConstant = [&](int64_t value) {
+        return builder.create<mlir::arith::ConstantIndexOp>(loc, value);
+      };
+      auto pitchNumBytes = builder.create<mlir::arith::MulIOp>(
+          loc, pitch, createIndexConstant(elemBitwidth / 8));
+      auto isLargeEnough = builder.create<mlir::arith::CmpIOp>(
+          loc, mlir::arith::CmpIPredicate::uge, pitchNumBytes,
+          createIndexConstant(conf.minPitch));
+      auto rem = builder.create<mlir::arith::RemUIOp>(
+          loc, pitchNumBytes, createIndexConstant(conf.pitchMultiple));
+      auto isAligned = builder.create<mlir::arith::CmpIOp>(
+          loc, mlir::arith::CmpIPredicate::eq, rem, createIndexConstant(0));
+      isLegal =
+          builder.create<mlir::arith::AndIOp>(loc, isLegal, isLargeEnough);
+      isLegal = builder.create<mlir::arith::AndIOp>(loc, isLegal, isAligned);
+    }
+
+    auto ifOp = builder.create<mlir::scf::IfOp>(loc, isLegal,
+                                                /*withElseRegion=*/true);
+    mlir::IRMapping mapping;
+    builder.setInsertionPoint(ifOp.elseBlock()->getTerminator());
+    for (auto *op : ops)
+      builder.clone(*op, mapping);
+    for (auto *op : ops)
+      op->moveBefore(ifOp.thenBlock()->getTerminator());
+    for (auto [initTileOp, pitch] : checkedTiles)
+      convertToScatteredType.insert(
+          {mapping.lookup(initTileOp.getResult()),
+           "pitch only known at runtime, version for illegal pitches"});
+    // Tiles that always fall back do so in both versions.
+    for (auto [initTileOp, pitch] : runtimeTiles) {
+      auto scattered = mapping.lookupOrNull(initTileOp.getResult());
+      auto it = convertToScatteredType.find(initTileOp.getResult());
+      if (scattered && it != convertToScatteredType.end())
+        convertToScatteredType.insert({scattered, it->second});
+    }
+  });
+}
+
 class XeTileBlockOpFallbackPass final
     : public imex::impl::XeTileBlockOpFallbackBase<XeTileBlockOpFallbackPass> {
 public:
-  llvm::DenseSet<mlir::Value> convertToScatteredType;
+  // The tiles to convert to scattered tiles and the reason.
+  llvm::DenseMap<mlir::Value, llvm::StringRef> convertToScatteredType;
   XeTileBlockOpFallbackPass() {
     uArchInterface = std::make_shared<imex::XePVCuArch>();
   }
 
   XeTileBlockOpFallbackPass(const std::string &deviceName) {
-    if (deviceName == "pvc") {
-      uArchInterface = std::make_shared<imex::XePVCuArch>();
-    }
+    uArchInterface = imex::getXeuArch(deviceName);
   }
 
   mlir::LogicalResult
@@ -556,9 +842,8 @@ public:
                         errorHandler) override {
     if (failed(Pass::initializeOptions(options, errorHandler)))
       return mlir::failure();
-    if (device == "pvc")
-      uArchInterface = std::make_shared<imex::XePVCuArch>();
-    else
+    uArchInterface = imex::getXeuArch(device);
+    if (!uArchInterface)
       return errorHandler(llvm::Twine("Invalid device: ") + device);
     return mlir::success();
   }
@@ -571,6 +856,8 @@ public:
       op->emitOpError("Can not get GPU Arch Definition for given Arch param");
       return signalPassFailure();
     }
+    imex::MissedOptRemarks missedOpts(getArgument(), remarks);
+    versionRuntimePitches(op, uArchInterface, convertToScatteredType);
     analyzeAtomicRMWOp(op, convertToScatteredType);
     mlir::RewritePatternSet patterns(context);
     mlir::GreedyRewriteConfig config;
@@ -579,7 +866,7 @@ public:
     config.useTopDownTraversal = true;
     config.strictMode = mlir::GreedyRewriteStrictness::ExistingAndNewOps;
     patterns.add<InitTileOpPattern>(context, uArchInterface,
-                                    convertToScatteredType);
+                                    convertToScatteredType, missedOpts);
     patterns.add<LoadTileOpPattern, StoreTileOpPattern,
                  UpdateTileOffsetOpPattern, SCFForOpPattern>(context);
     if (failed(applyPatternsGreedily(op, std::move(patterns), config))) {
@@ -43,11 +43,14 @@
 #include <llvm/ADT/SmallVector.h>
 #include <llvm/Support/Debug.h>
 
+#include <mutex>
 #include <optional>
 #include <tuple>
 
 #include "imex/Dialect/XeTile/Transforms/BlockingAnalysis.h"
 #include "imex/Dialect/XeTile/Transforms/Passes.h"
+#include "imex/Dialect/XeTile/Transforms/RegisterPressure.h"
+#include "imex/Utils/GPUSerialize.h"
 #include "imex/Utils/XeArch.h"
 
 #define DEBUG_TYPE "xetile-blocking"
@@ -1544,9 +1547,7 @@ public:
   }
 
   XeTileBlockingPass(const std::string &deviceName) {
-    if (deviceName == "pvc") {
-      uArchInterface = std::make_shared<imex::XePVCuArch>();
-    }
+    uArchInterface = imex::getXeuArch(deviceName);
   }
 
   LogicalResult initializeOptions(
@@ -1554,9 +1555,8 @@ public:
       function_ref<LogicalResult(const llvm::Twine &)> errorHandler) override {
     if (failed(Pass::initializeOptions(options, errorHandler)))
       return failure();
-    if (device == "pvc")
-      uArchInterface = std::make_shared<imex::XePVCuArch>();
-    else
+    uArchInterface = imex::getXeuArch(device);
+    if (!uArchInterface)
       return errorHandler(llvm::Twine("Invalid device: ") + device);
     return success();
   }
@@ -1575,10 +1575,45 @@ public:
       return signalPassFailure();
     }
 
-    BlockingAnalysis analysis(uArchInterface);
+    // Modules are processed in parallel; in cost-model mode, reading and
+    // updating the database is serialized so that no entries are lost.
+    static std::mutex tuningDbMutex;
+    std::unique_lock<std::mutex> tuningDbLock(tuningDbMutex, std::defer_lock);
+    if (tuningMode == "cost-model")
+      tuningDbLock.lock();
+
+    std::unique_ptr<BlockingTuner> tuner;
+    if (!tuningDb.empty() || tuningMode != "database") {
+      auto mode = BlockingTuner::Mode::Database;
+      if (tuningMode == "cost-model") {
+        mode = BlockingTuner::Mode::CostModel;
+      } else if (tuningMode != "database") {
+        mod.emitOpError("Invalid tuning mode: ") << tuningMode;
+        return signalPassFailure();
+      }
+      tuner = std::make_unique<BlockingTuner>(device, mode);
+      if (!tuningDb.empty() && failed(tuner->load(tuningDb))) {
+        mod.emitOpError("Can not read tuning database ") << tuningDb;
+        return signalPassFailure();
+      }
+    }
+
+    if (grfMode != "none" && grfMode != "auto" && grfMode != "small" &&
+        grfMode != "large") {
+      mod.emitOpError("Invalid GRF mode: ") << grfMode;
+      return signalPassFailure();
+    }
+
+    BlockingAnalysis analysis(uArchInterface, tuner.get());
     if (failed(analysis.run(mod)))
       return signalPassFailure();
 
+    if (tuner && tuningMode == "cost-model" && !tuningDb.empty() &&
+        failed(tuner->save(tuningDb))) {
+      mod.emitOpError("Can not write tuning database ") << tuningDb;
+      return signalPassFailure();
+    }
+
     LLVM_DEBUG(analysis.printAnalysisResult());
 
     MLIRContext &context = getContext();
@@ -1607,9 +1642,38 @@ public:
     // TileType, to simplify the code. It also reorders some constant ops, which
     // make writing test cases easier.
     (void)applyPatternsGreedily(mod, FrozenRewritePatternSet());
+
+    setGRFSize(mod);
   }
 
 private:
+  // GRFs used by the compiler for addresses, message payloads and temporaries
+  // that are not visible in the XeTile IR.
+  static constexpr int64_t reservedGRFs = 16;
+
+  // Records the GRF mode of the kernels of \p mod. In auto mode, kernels
+  // whose estimated register pressure does not fit the default register file
+  // are compiled for the large one.
+  void setGRFSize(gpu::GPUModuleOp mod) {
+    if (grfMode == "none")
+      return;
+    for (auto func : mod.getOps<gpu::GPUFuncOp>()) {
+      if (!func.isKernel())
+        continue;
+      bool largeGRF = grfMode == "large";
+      if (grfMode == "auto") {
+        auto pressure = estimateRegisterPressure(
+            func, uArchInterface->getOneGRFSizeBits());
+        LLVM_DEBUG(llvm::dbgs() << "Register pressure of " << func.getName()
+                                << ": " << pressure << " GRFs\n");
+        largeGRF = pressure + reservedGRFs > uArchInterface->getNumGRFs();
+      }
+      func->setAttr(gpuGRFSizeAttrName,
+                    IntegerAttr::get(IntegerType::get(&getContext(), 32),
+                                     uArchInterface->getNumGRFs(largeGRF)));
+    }
+  }
+
   std::shared_ptr<XeuArchInterface> uArchInterface = nullptr;
 };
 
@@ -228,6 +228,48 @@ static int64_t getDivisorInRange(int64_t v, int64_t l, int64_t h,
   return 0;
 }
 
+// Returns the divisors of v in the range [l, h] that are multiples of u, in
+// decreasing order.
+static llvm::SmallVector<int64_t> getDivisorsInRange(int64_t v, int64_t l,
+                                                     int64_t h,
+                                                     int64_t u = 1) {
+  llvm::SmallVector<int64_t> divisors;
+  for (auto i = h; i >= std::max<int64_t>(l, 1); i--) {
+    if (v % i == 0 && i % u == 0)
+      divisors.push_back(i);
+  }
+  return divisors;
+}
+
+// A rough cost model ranking blocking candidates in the cost-model tuning
+// mode, in issue cycles. Each DPAS costs a fixed issue overhead plus its
+// repeat count; each 2D block load costs a message overhead plus one cycle
+// per GRF of payload, and each GRF of a load block that has to be split for
+// its user costs one move.
+static constexpr double dpasIssueCost = 4;
+static constexpr double loadIssueCost = 16;
+
+static double getMMACost(llvm::ArrayRef<int64_t> aShape,
+                         llvm::ArrayRef<int64_t> bShape,
+                         llvm::ArrayRef<unsigned int> mmaSize, int64_t blkM) {
+  auto ceilDiv = [](int64_t a, int64_t b) { return (a + b - 1) / b; };
+  auto numDpas = aShape[0] / blkM * ceilDiv(bShape[1], mmaSize[2]) *
+                 ceilDiv(aShape[1], mmaSize[1]);
+  return numDpas * (dpasIssueCost + blkM);
+}
+
+static double getLoadCost(llvm::ArrayRef<int64_t> shape, int64_t elemBits,
+                          int64_t grfBits, Block request, int64_t h,
+                          int64_t w) {
+  auto ceilDiv = [](int64_t a, int64_t b) { return (a + b - 1) / b; };
+  auto numLoads = shape[0] / h * (shape[1] / w);
+  double cost = numLoads * (loadIssueCost + ceilDiv(h * w * elemBits, grfBits));
+  if (request[0] && h > request[0])
+    cost += numLoads * (h / request[0]) *
+            ceilDiv(request[0] * w * elemBits, grfBits);
+  return cost;
+}
+
 // TODO: currently, we only support optimal cases for SLM access,
 // and the block width is fixed to 16. That means the shape[1]
 // has to be multiple of 16. The block shape for SLM is [h, 16].
@@ -252,8 +294,10 @@ class BlockingAnalysisImpl
 public:
   BlockingAnalysisImpl(mlir::DataFlowSolver &solver,
                        mlir::SymbolTableCollection &symbolTable,
-                       std::shared_ptr<XeuArchInterface> uArch)
-      : SparseBackwardDataFlowAnalysis(solver, symbolTable), uArch(uArch) {}
+                       std::shared_ptr<XeuArchInterface> uArch,
+                       BlockingTuner *tuner)
+      : SparseBackwardDataFlowAnalysis(solver, symbolTable), uArch(uArch),
+        tuner(tuner) {}
 
   mlir::LogicalResult
   visitOperation(mlir::Operation *op,
@@ -334,8 +378,19 @@ private:
   getMMASize(mlir::Type elemTy, const int APrecision, const int BPrecision,
              const int CPrecision, const int DPrecision);
 
+  // Selects the value of a tunable parameter through the tuner if there is
+  // one, otherwise returns the heuristic choice.
+  int64_t tune(llvm::StringRef sig, llvm::StringRef param,
+               llvm::ArrayRef<int64_t> candidates, int64_t heuristic,
+               llvm::function_ref<double(int64_t)> cost) {
+    if (!tuner)
+      return heuristic;
+    return tuner->select(sig, param, candidates, heuristic, cost);
+  }
+
 private:
   std::shared_ptr<XeuArchInterface> uArch = nullptr;
+  BlockingTuner *tuner = nullptr;
 };
 
 mlir::LogicalResult BlockingAnalysisImpl::visitOperation(
@@ -482,8 +537,18 @@ void BlockingAnalysisImpl::visitLoadTileOp(
     int64_t h = getDivisorInRange(shape[0], minH, maxH, rq[0]);
     // for cases of load+transpose+dpas, the block height should be aligned
     // to minimize the data movement for dpas.
-    if (hasTransposeUser)
+    if (hasTransposeUser) {
       h = std::min<int64_t>(h, rq[0]);
+    } else if (h && w && shape[0] % rq[0] == 0) {
+      std::string sig;
+      llvm::raw_string_ostream os(sig);
+      os << BlockingTuner::getSignature(op) << " request " << rq;
+      auto grfBits = uArch->getOneGRFSizeBits();
+      h = tune(sig, "h", getDivisorsInRange(shape[0], minH, maxH, rq[0]), h,
+               [&](int64_t cand) {
+                 return getLoadCost(shape, elemBits, grfBits, rq, cand, w);
+               });
+    }
     block = Block(h, w);
   }
 
@@ -577,10 +642,12 @@ void BlockingAnalysisImpl::visitAtomicRMWOp(
     xetile::AtomicRMWOp op, mlir::ArrayRef<BlockingLattice *> operands,
     mlir::ArrayRef<const BlockingLattice *> results) {
   auto tileTy = op.getTile().getType();
-  auto elemTy = tileTy.getElementType();
   auto shape = tileTy.getShape();
 
-  auto size = getDefaultSize(elemTy, shape);
+  // an atomic message updates one element per lane, so use one block of
+  // subgroup size per message regardless of the element type.
+  const int64_t lanes = uArch->getSubgroupSize();
+  Block size(1, getDivisorInRange(shape[1], 1, lanes));
   if (!size)
     return;
 
@@ -617,8 +684,14 @@ void BlockingAnalysisImpl::visitTileMMAOp(
 
   auto mmaSize = getMMASize(op.getElementType(), aPrecision, bPrecision,
                             cPrecision, dPrecision);
-  auto M = op.getAType().getShape()[0];
+  auto aShape = op.getAType().getShape();
+  auto bShape = op.getBType().getShape();
+  auto M = aShape[0];
   auto blkM = getDivisorInRange(M, 1, mmaSize[0]);
+  blkM = tune(BlockingTuner::getSignature(op), "m",
+              getDivisorsInRange(M, 1, mmaSize[0]), blkM, [&](int64_t cand) {
+                return getMMACost(aShape, bShape, mmaSize, cand);
+              });
   auto blockSizeForA = BlockingRequests(blkM, mmaSize[1], op->getOpOperand(0));
   auto blockSizeForB =
       BlockingRequests(mmaSize[1], mmaSize[2], op->getOpOperand(1));
@@ -890,7 +963,7 @@ mlir::LogicalResult BlockingAnalysis::run(mlir::Operation *op) {
   // skip analysis on the dead code.
   solver.load<mlir::dataflow::DeadCodeAnalysis>();
   solver.load<mlir::dataflow::SparseConstantPropagation>();
-  solver.load<BlockingAnalysisImpl>(symbolTable, uArch);
+  solver.load<BlockingAnalysisImpl>(symbolTable, uArch, tuner);
   target = op;
   return solver.initializeAndRun(op);
 }
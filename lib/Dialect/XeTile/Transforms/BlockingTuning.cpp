@@ -0,0 +1,104 @@
+//===- BlockingTuning.cpp - Tuning database for XeTile blocking -*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file implements the tuning database of the xetile-blocking pass.
+///
+//===----------------------------------------------------------------------===//
+
+#include <mlir/IR/BuiltinTypes.h>
+
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/Support/Debug.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include "imex/Dialect/XeTile/Transforms/BlockingTuning.h"
+
+#define DEBUG_TYPE "xetile-blocking"
+
+namespace imex {
+
+mlir::LogicalResult BlockingTuner::load(llvm::StringRef path) {
+  if (!llvm::sys::fs::exists(path))
+    return mlir::success();
+  auto buffer = llvm::MemoryBuffer::getFile(path, /*IsText=*/true);
+  if (!buffer)
+    return mlir::failure();
+
+  llvm::SmallVector<llvm::StringRef> lines;
+  (*buffer)->getBuffer().split(lines, '\n', -1, /*KeepEmpty=*/false);
+  for (auto line : lines) {
+    line = line.trim();
+    if (line.empty() || line.starts_with("#"))
+      continue;
+    llvm::SmallVector<llvm::StringRef, 3> fields;
+    line.split(fields, '\t');
+    auto [param, value] = fields.back().split('=');
+    int64_t val;
+    if (fields.size() != 3 || value.trim().getAsInteger(10, val))
+      return mlir::failure();
+    entries[{fields[0].str(), fields[1].str(), param.trim().str()}] = val;
+  }
+  return mlir::success();
+}
+
+mlir::LogicalResult BlockingTuner::save(llvm::StringRef path) const {
+  std::error_code ec;
+  llvm::raw_fd_ostream os(path, ec, llvm::sys::fs::OF_Text);
+  if (ec)
+    return mlir::failure();
+  os << "# xetile-blocking tuning database\n";
+  for (auto &[key, value] : entries)
+    os << std::get<0>(key) << "\t" << std::get<1>(key) << "\t"
+       << std::get<2>(key) << "=" << value << "\n";
+  return mlir::success();
+}
+
+int64_t BlockingTuner::select(llvm::StringRef sig, llvm::StringRef param,
+                              llvm::ArrayRef<int64_t> candidates,
+                              int64_t heuristic,
+                              llvm::function_ref<double(int64_t)> cost) {
+  std::tuple<std::string, std::string, std::string> key(arch, sig.str(),
+                                                        param.str());
+  auto it = entries.find(key);
+  if (it != entries.end() && llvm::is_contained(candidates, it->second))
+    return it->second;
+  if (mode != Mode::CostModel || candidates.empty())
+    return heuristic;
+
+  // Ties are broken in favor of the heuristic choice.
+  auto best =
+      llvm::is_contained(candidates, heuristic) ? heuristic : candidates[0];
+  auto bestCost = cost(best);
+  for (auto candidate : candidates) {
+    auto candidateCost = cost(candidate);
+    LLVM_DEBUG(llvm::dbgs() << "candidate " << sig << " " << param << "="
+                            << candidate << ": cost " << candidateCost
+                            << "\n");
+    if (candidateCost < bestCost) {
+      best = candidate;
+      bestCost = candidateCost;
+    }
+  }
+  entries[key] = best;
+  return best;
+}
+
+std::string BlockingTuner::getSignature(mlir::Operation *op) {
+  std::string sig;
+  llvm::raw_string_ostream os(sig);
+  auto type = mlir::FunctionType::get(op->getContext(), op->getOperandTypes(),
+                                      op->getResultTypes());
+  os << op->getName() << " : " << type;
+  return sig;
+}
+
+} // namespace imex
@@ -0,0 +1,223 @@
+//===- CacheHints.cpp ---------- xetile-cache-hints Pass --------*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains the inference of cache hints of XeTile memory ops. Each
+/// load, prefetch and store is given the L1 and L3 policies of the role of
+/// the memory it accesses:
+///
+///   streaming input: memory only read by loads that do not feed the B
+///                    operand of a tile_mma, e.g. the activations of a GEMM
+///   reused input:    memory read by loads that feed the B operand of a
+///                    tile_mma, e.g. the weights of a GEMM
+///   output:          memory written by stores
+///
+/// Hints already set on an op are kept.
+///
+//===----------------------------------------------------------------------===//
+
+#include <mlir/Dialect/GPU/IR/GPUDialect.h>
+#include <mlir/Dialect/SCF/IR/SCF.h>
+#include <mlir/Interfaces/SideEffectInterfaces.h>
+#include <mlir/Pass/Pass.h>
+
+#include <llvm/ADT/DenseSet.h>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/SetVector.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Support/Debug.h>
+
+#include <optional>
+#include <utility>
+
+#include "imex/Dialect/XeTile/IR/XeTileOps.h"
+#include "imex/Dialect/XeTile/Transforms/Passes.h"
+
+#define DEBUG_TYPE "xetile-cache-hints"
+
+using namespace mlir;
+using namespace imex;
+
+namespace imex {
+#define GEN_PASS_DEF_XETILECACHEHINTS
+#include "imex/Dialect/XeTile/Transforms/Passes.h.inc"
+} // namespace imex
+
+namespace imex {
+
+namespace {
+
+// The L1 and L3 cache policies of a role.
+using CachePolicies = std::pair<xetile::CachePolicy, xetile::CachePolicy>;
+
+// Returns the memory accessed through \p tile: the source of the init_tile
+// op it is derived from through update_tile_offset ops and loop-carried
+// values, or null if it is unknown.
+static Value getTileSource(Value tile) {
+  while (tile) {
+    if (auto init = tile.getDefiningOp<xetile::InitTileOp>())
+      return init.getSource();
+    if (auto update = tile.getDefiningOp<xetile::UpdateTileOffsetOp>()) {
+      tile = update.getTile();
+      continue;
+    }
+    auto arg = dyn_cast<BlockArgument>(tile);
+    auto forOp =
+        arg ? dyn_cast<scf::ForOp>(arg.getOwner()->getParentOp()) : nullptr;
+    if (!forOp || arg.getArgNumber() < forOp.getNumInductionVars())
+      return nullptr;
+    tile = forOp.getTiedLoopInit(arg)->get();
+  }
+  return nullptr;
+}
+
+// Returns true if \p value reaches the B operand of a tile_mma op through
+// compute ops and loop-carried values.
+static bool feedsMMAOperandB(Value value) {
+  llvm::SetVector<Value> worklist;
+  worklist.insert(value);
+  for (size_t i = 0; i < worklist.size(); ++i) {
+    for (auto &use : worklist[i].getUses()) {
+      auto *user = use.getOwner();
+      if (isa<xetile::TileMMAOp>(user)) {
+        if (use.getOperandNumber() == 1)
+          return true;
+      } else if (auto forOp = dyn_cast<scf::ForOp>(user)) {
+        if (auto arg = forOp.getTiedLoopRegionIterArg(&use))
+          worklist.insert(arg);
+      } else if (auto yield = dyn_cast<scf::YieldOp>(user)) {
+        if (auto forOp = dyn_cast<scf::ForOp>(yield->getParentOp())) {
+          auto idx = use.getOperandNumber();
+          worklist.insert(forOp.getRegionIterArgs()[idx]);
+          worklist.insert(forOp.getResult(idx));
+        }
+      } else if (isMemoryEffectFree(user) ||
+                 isa<xetile::TransposeOp, xetile::ConvertLayoutOp>(user)) {
+        for (auto result : user->getResults())
+          worklist.insert(result);
+      }
+    }
+  }
+  return false;
+}
+
+// Parses the policies of option \p option, given as `<l1>,<l3>`, e.g.
+// `cached,streaming`.
+static std::optional<CachePolicies>
+parsePolicies(llvm::ArrayRef<std::string> option) {
+  if (option.size() != 2)
+    return std::nullopt;
+  auto l1 = xetile::symbolizeCachePolicy(option[0]);
+  auto l3 = xetile::symbolizeCachePolicy(option[1]);
+  if (!l1 || !l3)
+    return std::nullopt;
+  return CachePolicies(*l1, *l3);
+}
+
+static bool isReadPolicy(xetile::CachePolicy policy) {
+  return policy != xetile::CachePolicy::WRITE_BACK &&
+         policy != xetile::CachePolicy::WRITE_THROUGH;
+}
+
+static bool isWritePolicy(xetile::CachePolicy policy) {
+  return policy != xetile::CachePolicy::READ_INVALIDATE;
+}
+
+// Sets the L1 and L3 hints of \p op that are not set yet to \p policies.
+template <typename OpTy>
+static void setHints(OpTy op, const CachePolicies &policies) {
+  auto *context = op.getContext();
+  if (!op.getL1HintAttr())
+    op.setL1HintAttr(xetile::CachePolicyAttr::get(context, policies.first));
+  if (!op.getL3HintAttr())
+    op.setL3HintAttr(xetile::CachePolicyAttr::get(context, policies.second));
+}
+
+class XeTileCacheHintsPass
+    : public impl::XeTileCacheHintsBase<XeTileCacheHintsPass> {
+public:
+  using XeTileCacheHintsBase::XeTileCacheHintsBase;
+
+  LogicalResult initialize(MLIRContext *context) override {
+    auto parse = [&](const ListOption<std::string> &option,
+                     CachePolicies &policies, bool isLoad) {
+      if (option.empty())
+        return true;
+      auto parsed = parsePolicies(llvm::to_vector(option));
+      if (!parsed)
+        return false;
+      auto isLegal = isLoad ? isReadPolicy : isWritePolicy;
+      if (!isLegal(parsed->first) || !isLegal(parsed->second))
+        return false;
+      policies = *parsed;
+      return true;
+    };
+    if (!parse(streamingInput, streamingPolicies, /*isLoad=*/true) ||
+        !parse(reusedInput, reusedPolicies, /*isLoad=*/true) ||
+        !parse(output, outputPolicies, /*isLoad=*/false)) {
+      emitError(UnknownLoc::get(context))
+          << "Invalid cache policies, expected `<l1>,<l3>` with policies "
+             "valid for the role";
+      return failure();
+    }
+    return success();
+  }
+
+  void runOnOperation() override {
+    // The memory read by loads feeding the B operand of a tile_mma. Loads of
+    // tiles with an unknown source are recorded themselves.
+    llvm::DenseSet<Value> reused;
+    auto recordReused = [&](Value tile, Value value) {
+      if (!feedsMMAOperandB(value))
+        return;
+      auto source = getTileSource(tile);
+      reused.insert(source ? source : value);
+    };
+    getOperation().walk([&](Operation *op) {
+      if (auto load = dyn_cast<xetile::LoadTileOp>(op))
+        recordReused(load.getSource(), load.getValue());
+      else if (auto load = dyn_cast<xetile::LoadGatherOp>(op))
+        recordReused(load.getTile(), load.getValue());
+    });
+
+    auto getInputPolicies = [&](Value tile, Value value) {
+      auto source = getTileSource(tile);
+      return reused.contains(source ? source : value) ? reusedPolicies
+                                                      : streamingPolicies;
+    };
+    getOperation().walk([&](Operation *op) {
+      if (auto load = dyn_cast<xetile::LoadTileOp>(op))
+        setHints(load, getInputPolicies(load.getSource(), load.getValue()));
+      else if (auto load = dyn_cast<xetile::LoadGatherOp>(op))
+        setHints(load, getInputPolicies(load.getTile(), load.getValue()));
+      else if (auto prefetch = dyn_cast<xetile::PrefetchTileOp>(op))
+        setHints(prefetch, getInputPolicies(prefetch.getTile(), nullptr));
+      else if (auto store = dyn_cast<xetile::StoreTileOp>(op))
+        setHints(store, outputPolicies);
+      else if (auto store = dyn_cast<xetile::StoreScatterOp>(op))
+        setHints(store, outputPolicies);
+    });
+  }
+
+private:
+  CachePolicies streamingPolicies = {xetile::CachePolicy::STREAMING,
+                                     xetile::CachePolicy::UNCACHED};
+  CachePolicies reusedPolicies = {xetile::CachePolicy::CACHED,
+                                  xetile::CachePolicy::CACHED};
+  CachePolicies outputPolicies = {xetile::CachePolicy::STREAMING,
+                                  xetile::CachePolicy::WRITE_BACK};
+};
+
+} // namespace
+
+/// Create a pass
+std::unique_ptr<::mlir::Pass> createXeTileCacheHintsPass() {
+  return std::make_unique<XeTileCacheHintsPass>();
+}
+} // namespace imex
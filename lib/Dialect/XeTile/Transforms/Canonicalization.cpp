@@ -11,8 +11,11 @@
 /// This pass performs a set of canonicalization steps on XeTile ops that
 /// are expected by the downstream passes. First, this will convert certain
 /// vector ops (transpose, broadcast, multi_reduction) to equivalent XeTile
-/// ops. Next, it will convert all XeTile ops consuming or producing
-/// col-major tiles to one with row-major tiles. Finally, it will perform
+/// ops. Next, row-major tiles of col-major memrefs whose loads are followed
+/// by and whose stores are preceded by transposes are made col-major, so
+/// that the transposes fold away. Then, it will convert all XeTile ops
+/// consuming or producing col-major tiles to one with row-major tiles.
+/// Finally, it will perform
 /// cleanup to remove redundant ops that maybe produced by the previous
 /// steps.
 ///
@@ -23,6 +26,7 @@
 #include "mlir/Dialect/Arith/IR/Arith.h"
 #include "mlir/Dialect/MemRef/IR/MemRef.h"
 #include "mlir/Dialect/SCF/IR/SCF.h"
+#include "mlir/Dialect/Utils/StaticValueUtils.h"
 #include "mlir/Dialect/Vector/IR/VectorOps.h"
 #include "mlir/Dialect/Vector/Transforms/LoweringPatterns.h"
 #include "mlir/Dialect/Vector/Transforms/VectorRewritePatterns.h"
@@ -168,6 +172,32 @@ struct LoadTileOpPattern final
   }
 };
 
+// Pattern for rewriting StoreTileOp to consume row-major tiles. The value
+// gets transposed to the shape of the row-major tile.
+struct StoreTileOpPattern final
+    : public mlir::OpConversionPattern<imex::xetile::StoreTileOp> {
+  using OpConversionPattern<imex::xetile::StoreTileOp>::OpConversionPattern;
+  mlir::LogicalResult
+  matchAndRewrite(imex::xetile::StoreTileOp storeOp, OpAdaptor adaptor,
+                  mlir::ConversionPatternRewriter &rewriter) const override {
+    // if the tile type is unchanged, keep the storeOp
+    if (storeOp.getTile().getType() == adaptor.getTile().getType())
+      return mlir::failure();
+    auto newTile = adaptor.getTile();
+    auto newTileTy = llvm::cast<imex::xetile::TileType>(newTile.getType());
+    mlir::VectorType newVecTy =
+        mlir::VectorType::get(newTileTy.getShape(), newTileTy.getElementType());
+    // Transpose the value to the shape of the row-major tile.
+    mlir::Value value = rewriter.create<imex::xetile::TransposeOp>(
+        storeOp.getLoc(), newVecTy, adaptor.getValue(),
+        mlir::ArrayRef<int64_t>({1, 0}));
+    rewriter.replaceOpWithNewOp<imex::xetile::StoreTileOp>(
+        storeOp, value, newTile, storeOp.getL1HintAttr(),
+        storeOp.getL2HintAttr(), storeOp.getL3HintAttr());
+    return mlir::success();
+  }
+};
+
 // If ScfForOp has any col-major tiles as iterArgs, we rewrite it to use
 // row-major tiles.
 struct ScfForOpPattern final
@@ -363,6 +393,88 @@ struct RemoveRedundantTransposeOpPattern
   }
 };
 
+static bool isTranspose2D(mlir::Operation *op) {
+  auto transposeOp = llvm::dyn_cast_if_present<imex::xetile::TransposeOp>(op);
+  return transposeOp &&
+         transposeOp.getPermutation() == llvm::ArrayRef<int64_t>({1, 0});
+}
+
+// Returns true if the memref is stored col-major, i.e. its dim 0 is
+// contiguous.
+static bool isColMajor(imex::xetile::InitTileOp initOp) {
+  auto sourceTy = llvm::dyn_cast<mlir::MemRefType>(initOp.getSourceType());
+  if (!sourceTy)
+    return false;
+  if (sourceTy.hasStaticShape()) {
+    llvm::SmallVector<int64_t> strides;
+    int64_t offset;
+    if (failed(sourceTy.getStridesAndOffset(strides, offset)) ||
+        strides.size() != 2)
+      return false;
+    return strides[0] == 1 && strides[1] != 1;
+  }
+  auto strides = initOp.getMixedStrides();
+  if (strides.size() != 2)
+    return false;
+  auto stride0 = mlir::getConstantIntValue(strides[0]);
+  auto stride1 = mlir::getConstantIntValue(strides[1]);
+  return stride0 && *stride0 == 1 && !(stride1 && *stride1 == 1);
+}
+
+// A row-major tile of a col-major memref whose loads are only used by
+// transposes and whose stores only store transposed values gets made
+// col-major. This does not change the data the tile accesses. The
+// conversion to row-major tiles then adds transposes which cancel out the
+// existing ones, and the tile is accessed by plain 2D block loads and
+// stores of the transposed view of the memref.
+static void foldTransposesIntoColMajorTiles(mlir::Operation *root) {
+  root->walk([](imex::xetile::InitTileOp initOp) {
+    auto tileTy = initOp.getType();
+    if (tileTy.getRank() != 2 || tileTy.getMemorySpaceAsInt() == 3 ||
+        tileTy.getOrder().asArrayRef() != mlir::ArrayRef({1, 0}) ||
+        !isColMajor(initOp))
+      return;
+
+    // The tile values to retype, i.e. the tile and its updated offsets.
+    llvm::SmallVector<mlir::Value> tiles = {initOp.getResult()};
+    bool hasTranspose = false;
+    for (size_t i = 0; i < tiles.size(); ++i) {
+      for (auto &use : tiles[i].getUses()) {
+        auto user = use.getOwner();
+        if (auto loadOp = llvm::dyn_cast<imex::xetile::LoadTileOp>(user)) {
+          auto res = loadOp.getResult();
+          if (!res.hasOneUse() || !isTranspose2D(*res.user_begin()))
+            return;
+          hasTranspose = true;
+        } else if (auto storeOp =
+                       llvm::dyn_cast<imex::xetile::StoreTileOp>(user)) {
+          if (use.get() != storeOp.getTile() ||
+              !isTranspose2D(storeOp.getValue().getDefiningOp()))
+            return;
+          hasTranspose = true;
+        } else if (auto updateOp =
+                       llvm::dyn_cast<imex::xetile::UpdateTileOffsetOp>(
+                           user)) {
+          tiles.push_back(updateOp.getResult());
+        } else if (!llvm::isa<imex::xetile::PrefetchTileOp>(user)) {
+          return;
+        }
+      }
+    }
+    if (!hasTranspose)
+      return;
+
+    auto newAttr = imex::xetile::XeTileAttr::get(
+        tileTy.getContext(), tileTy.getSgMap(), tileTy.getWgMap(),
+        mlir::DenseI32ArrayAttr::get(tileTy.getContext(), {0, 1}),
+        tileTy.getMemorySpace(), tileTy.getScatterAttr());
+    auto newTileTy = imex::xetile::TileType::get(
+        tileTy.getShape(), tileTy.getElementType(), newAttr);
+    for (auto tile : tiles)
+      tile.setType(newTileTy);
+  });
+}
+
 struct XeTileCanonicalizationPass final
     : public imex::impl::XeTileCanonicalizationBase<
           XeTileCanonicalizationPass> {
@@ -388,6 +500,9 @@ struct XeTileCanonicalizationPass final
         return signalPassFailure();
       }
     }
+    // Fold transposes after loads and before stores into the order of the
+    // tiles where they access col-major memrefs.
+    foldTransposesIntoColMajorTiles(getOperation());
     {
       mlir::TypeConverter typeConverter;
       mlir::RewritePatternSet patterns(context);
@@ -447,6 +562,11 @@ struct XeTileCanonicalizationPass final
           [&](imex::xetile::LoadTileOp op) {
             return isValidTile(op.getSource().getType());
           });
+      // StoreTileOp is legal if it does not consume col-major tiles.
+      target.addDynamicallyLegalOp<imex::xetile::StoreTileOp>(
+          [&](imex::xetile::StoreTileOp op) {
+            return isValidTile(op.getTile().getType());
+          });
       // If any iterArg of the forOp is a col-major tile, it is illegal.
       target.addDynamicallyLegalOp<mlir::scf::ForOp>([&](mlir::scf::ForOp op) {
         for (auto arg : op.getRegionIterArgs()) {
@@ -469,9 +589,9 @@ struct XeTileCanonicalizationPass final
             return true;
           });
       patterns
-          .add<InitTileOpPattern, LoadTileOpPattern, UpdateTileOffsetOpPattern,
-               PrefetchTilePattern, ScfForOpPattern, ScfYieldOpPattern>(
-              typeConverter, context);
+          .add<InitTileOpPattern, LoadTileOpPattern, StoreTileOpPattern,
+               UpdateTileOffsetOpPattern, PrefetchTilePattern, ScfForOpPattern,
+               ScfYieldOpPattern>(typeConverter, context);
 
       if (mlir::failed(mlir::applyPartialConversion(getOperation(), target,
                                                     std::move(patterns))))
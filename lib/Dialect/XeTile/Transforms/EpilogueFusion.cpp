@@ -0,0 +1,198 @@
+//===- EpilogueFusion.cpp ----- xetile-epilogue-fusion Pass -----*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains the fusion of elementwise GEMM epilogues. A tile that
+/// is stored, loaded back, transformed by elementwise ops and stored again:
+///
+///   xetile.store_tile %c, %t
+///   %v = xetile.load_tile %t
+///   %r = elementwise(%v)
+///   xetile.store_tile %r, %t
+///
+/// is rewritten so the epilogue is applied to the value in registers and
+/// only the final result is written:
+///
+///   %r = elementwise(%c)
+///   xetile.store_tile %r, %t
+///
+/// When the result is stored to another tile with the same bounds, e.g. after
+/// a dtype cast, only the load is removed.
+///
+//===----------------------------------------------------------------------===//
+
+#include <mlir/Dialect/GPU/IR/GPUDialect.h>
+#include <mlir/Dialect/Utils/StaticValueUtils.h>
+#include <mlir/Interfaces/SideEffectInterfaces.h>
+#include <mlir/Pass/Pass.h>
+
+#include <llvm/ADT/SetVector.h>
+#include <llvm/Support/Debug.h>
+
+#include "imex/Dialect/XeTile/IR/XeTileOps.h"
+#include "imex/Dialect/XeTile/Transforms/Passes.h"
+
+#define DEBUG_TYPE "xetile-epilogue-fusion"
+
+using namespace mlir;
+using namespace imex;
+
+namespace imex {
+#define GEN_PASS_DEF_XETILEEPILOGUEFUSION
+#include "imex/Dialect/XeTile/Transforms/Passes.h.inc"
+} // namespace imex
+
+namespace imex {
+
+namespace {
+
+// Returns true if \p lhs and \p rhs describe the same memory region: the same
+// value or init_tile ops of the same source with equal offsets, shape and
+// strides.
+static bool isSameTile(Value lhs, Value rhs) {
+  if (lhs == rhs)
+    return true;
+  auto lhsInit = lhs.getDefiningOp<xetile::InitTileOp>();
+  auto rhsInit = rhs.getDefiningOp<xetile::InitTileOp>();
+  if (!lhsInit || !rhsInit || lhsInit.getIndices() || rhsInit.getIndices())
+    return false;
+  return lhsInit.getSource() == rhsInit.getSource() &&
+         lhsInit.getType() == rhsInit.getType() &&
+         isEqualConstantIntOrValueArray(lhsInit.getMixedOffsets(),
+                                        rhsInit.getMixedOffsets()) &&
+         isEqualConstantIntOrValueArray(lhsInit.getMixedSizes(),
+                                        rhsInit.getMixedSizes()) &&
+         isEqualConstantIntOrValueArray(lhsInit.getMixedStrides(),
+                                        rhsInit.getMixedStrides());
+}
+
+// Returns true if \p lhs and \p rhs have the same shape and offsets in
+// static memrefs of the same shape, so they have the same out-of-bounds
+// elements.
+static bool hasSameBounds(Value lhs, Value rhs) {
+  if (isSameTile(lhs, rhs))
+    return true;
+  auto lhsInit = lhs.getDefiningOp<xetile::InitTileOp>();
+  auto rhsInit = rhs.getDefiningOp<xetile::InitTileOp>();
+  if (!lhsInit || !rhsInit || lhsInit.getIndices() || rhsInit.getIndices() ||
+      lhsInit.getType().getShape() != rhsInit.getType().getShape())
+    return false;
+  auto lhsTy = dyn_cast<MemRefType>(lhsInit.getSource().getType());
+  auto rhsTy = dyn_cast<MemRefType>(rhsInit.getSource().getType());
+  if (!lhsTy || !rhsTy || !lhsTy.hasStaticShape() ||
+      lhsTy.getShape() != rhsTy.getShape())
+    return false;
+  return isEqualConstantIntOrValueArray(lhsInit.getMixedOffsets(),
+                                        rhsInit.getMixedOffsets());
+}
+
+// Returns true if \p op neither reads nor writes memory.
+static bool isComputeOnly(Operation *op) {
+  return isMemoryEffectFree(op) ||
+         isa<xetile::TileMMAOp, xetile::TransposeOp, xetile::ReductionOp,
+             xetile::BroadcastOp, xetile::UpdateTileOffsetOp>(op);
+}
+
+// Returns true if the ops in (\p begin, \p end) of a block do not access
+// memory.
+static bool isMemoryQuiet(Operation *begin, Operation *end) {
+  for (auto *op = begin->getNextNode(); op != end; op = op->getNextNode()) {
+    if (!isComputeOnly(op))
+      return false;
+  }
+  return true;
+}
+
+// Returns the store of the result of the epilogue applied to the value of
+// \p load, or null if the value has other uses. The epilogue consists of
+// elementwise ops in the block of the load; out-of-bounds elements of the
+// loaded value thus only reach the out-of-bounds elements of the store, which
+// are dropped.
+static xetile::StoreTileOp getEpilogueStore(xetile::LoadTileOp load) {
+  xetile::StoreTileOp store;
+  llvm::SetVector<Value> worklist;
+  worklist.insert(load.getValue());
+  for (size_t i = 0; i < worklist.size(); ++i) {
+    for (auto &use : worklist[i].getUses()) {
+      auto *user = use.getOwner();
+      if (user->getBlock() != load->getBlock())
+        return nullptr;
+      if (auto storeOp = dyn_cast<xetile::StoreTileOp>(user)) {
+        if (use.getOperandNumber() != 0 || (store && store != storeOp))
+          return nullptr;
+        store = storeOp;
+      } else if (user->hasTrait<OpTrait::Elementwise>() &&
+                 isMemoryEffectFree(user)) {
+        for (auto result : user->getResults())
+          worklist.insert(result);
+      } else {
+        return nullptr;
+      }
+    }
+  }
+  return store;
+}
+
+class XeTileEpilogueFusionPass
+    : public impl::XeTileEpilogueFusionBase<XeTileEpilogueFusionPass> {
+public:
+  using XeTileEpilogueFusionBase::XeTileEpilogueFusionBase;
+
+  void runOnOperation() override {
+    llvm::SmallVector<xetile::StoreTileOp> stores;
+    getOperation().walk(
+        [&](xetile::StoreTileOp store) { stores.push_back(store); });
+    for (auto store : stores)
+      fuse(store);
+  }
+
+private:
+  void fuse(xetile::StoreTileOp store);
+};
+
+void XeTileEpilogueFusionPass::fuse(xetile::StoreTileOp store) {
+  // The load of the stored tile, with no access to memory in between.
+  xetile::LoadTileOp load;
+  for (auto *op = store->getNextNode(); op; op = op->getNextNode()) {
+    auto loadOp = dyn_cast<xetile::LoadTileOp>(op);
+    if (loadOp && isSameTile(loadOp.getSource(), store.getTile())) {
+      load = loadOp;
+      break;
+    }
+    if (!isComputeOnly(op))
+      return;
+  }
+  if (!load || load.getType() != store.getValue().getType())
+    return;
+
+  auto epilogueStore = getEpilogueStore(load);
+  if (!epilogueStore ||
+      !hasSameBounds(epilogueStore.getTile(), store.getTile()))
+    return;
+
+  // If the epilogue result overwrites the tile with no access to memory in
+  // between, e.g. there is no dtype cast, the first store is dead.
+  bool isDead = isSameTile(epilogueStore.getTile(), store.getTile()) &&
+                isMemoryQuiet(load, epilogueStore);
+
+  LLVM_DEBUG(llvm::dbgs() << "Fusing the epilogue of " << store << "\n");
+
+  load.getValue().replaceAllUsesWith(store.getValue());
+  load.erase();
+  if (isDead)
+    store.erase();
+}
+
+} // namespace
+
+/// Create a pass
+std::unique_ptr<::mlir::Pass> createXeTileEpilogueFusionPass() {
+  return std::make_unique<XeTileEpilogueFusionPass>();
+}
+} // namespace imex
@@ -0,0 +1,365 @@
+//===- LoopPipelining.cpp ----- xetile-loop-pipelining Pass -----*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains the software pipelining transformation of XeTile
+/// K-loops. Loads of tiles advanced by the loop are issued stages - 1
+/// iterations ahead of their use, with the loaded values rotating through
+/// iter_args, and the tiles are prefetched a configurable number of
+/// iterations ahead of the loads:
+///
+///   prefetch pf_0 .. pf_{P+D-1}
+///   v_0 .. v_{P-1} = load t_0 .. t_{P-1}
+///   scf.for i in [lb, ub - P * step) {
+///     prefetch pf_{i+P+D}
+///     v_{i+P} = load t_{i+P}
+///     compute(v_i)
+///   }
+///   compute(v_{N-P}) .. compute(v_{N-1})
+///
+//===----------------------------------------------------------------------===//
+
+#include <mlir/Dialect/Arith/IR/Arith.h>
+#include <mlir/Dialect/GPU/IR/GPUDialect.h>
+#include <mlir/Dialect/MemRef/IR/MemRef.h>
+#include <mlir/Dialect/SCF/IR/SCF.h>
+#include <mlir/Dialect/Utils/StaticValueUtils.h>
+#include <mlir/IR/IRMapping.h>
+#include <mlir/Interfaces/SideEffectInterfaces.h>
+#include <mlir/Pass/Pass.h>
+
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Support/Debug.h>
+
+#include "imex/Dialect/XeTile/IR/XeTileOps.h"
+#include "imex/Dialect/XeTile/Transforms/Passes.h"
+
+#define DEBUG_TYPE "xetile-loop-pipelining"
+
+using namespace mlir;
+using namespace imex;
+
+namespace imex {
+#define GEN_PASS_DEF_XETILELOOPPIPELINING
+#include "imex/Dialect/XeTile/Transforms/Passes.h.inc"
+} // namespace imex
+
+namespace imex {
+
+namespace {
+
+// A tile carried by the loop that is loaded once per iteration and advanced
+// by a loop invariant offset.
+struct PipelinedTile {
+  unsigned argIndex;
+  xetile::LoadTileOp load;
+  xetile::UpdateTileOffsetOp update;
+  // The op creating the initial tile, cloned for the prefetch chain.
+  xetile::InitTileOp init;
+};
+
+// Returns the memref or address a tile of \p forOp was created from, or null
+// if it is unknown.
+static Value getTileSource(scf::ForOp forOp, Value tile) {
+  while (true) {
+    if (auto update = tile.getDefiningOp<xetile::UpdateTileOffsetOp>()) {
+      tile = update.getTile();
+    } else if (auto arg = dyn_cast<BlockArgument>(tile);
+               arg && arg.getOwner() == forOp.getBody() &&
+               arg.getArgNumber() > 0) {
+      tile = forOp.getInitArgs()[arg.getArgNumber() - 1];
+    } else if (auto init = tile.getDefiningOp<xetile::InitTileOp>()) {
+      return init.getSource();
+    } else {
+      return nullptr;
+    }
+  }
+}
+
+// Returns true if the memory at \p a and \p b may overlap. Distinct values of
+// which one is a new allocation do not.
+static bool mayAlias(Value a, Value b) {
+  if (!a || !b || a == b)
+    return true;
+  auto isAlloc = [](Value value) {
+    return value.getDefiningOp<memref::AllocOp>() ||
+           value.getDefiningOp<memref::AllocaOp>();
+  };
+  return !isAlloc(a) && !isAlloc(b);
+}
+
+// Returns true if \p op may write the memory of \p source, the source of a
+// tile in global memory.
+static bool mayWrite(scf::ForOp forOp, Operation *op, Value source) {
+  auto writesTile = [&](Value tile) {
+    if (cast<xetile::TileType>(tile.getType()).getMemorySpaceAsInt() == 3)
+      return false;
+    return mayAlias(getTileSource(forOp, tile), source);
+  };
+  if (auto store = dyn_cast<xetile::StoreTileOp>(op))
+    return writesTile(store.getTile());
+  if (auto store = dyn_cast<xetile::StoreScatterOp>(op))
+    return writesTile(store.getTile());
+  if (auto atomic = dyn_cast<xetile::AtomicRMWOp>(op))
+    return writesTile(atomic.getTile());
+  auto effectOp = dyn_cast<MemoryEffectOpInterface>(op);
+  if (!effectOp)
+    return false;
+  llvm::SmallVector<MemoryEffects::EffectInstance> effects;
+  effectOp.getEffects(effects);
+  return llvm::any_of(effects, [&](MemoryEffects::EffectInstance &effect) {
+    return isa<MemoryEffects::Write>(effect.getEffect()) &&
+           mayAlias(effect.getValue(), source);
+  });
+}
+
+// Returns the pipelinable tiles of \p forOp. Loading a tile an iteration
+// ahead moves the load before the barriers and stores of the iterations in
+// between, so tiles in shared local memory, whose data other work items
+// write, and tiles the loop may write are not pipelined, nor are the tiles
+// of loops with barriers.
+static llvm::SmallVector<PipelinedTile> getPipelinedTiles(scf::ForOp forOp) {
+  llvm::SmallVector<PipelinedTile> tiles;
+  if (forOp.getBody()
+          ->walk([](gpu::BarrierOp) { return WalkResult::interrupt(); })
+          .wasInterrupted())
+    return tiles;
+
+  auto yield = cast<scf::YieldOp>(forOp.getBody()->getTerminator());
+  for (auto [i, arg] : llvm::enumerate(forOp.getRegionIterArgs())) {
+    auto tileTy = dyn_cast<xetile::TileType>(arg.getType());
+    if (!tileTy || tileTy.getMemorySpaceAsInt() == 3)
+      continue;
+
+    xetile::LoadTileOp load;
+    xetile::UpdateTileOffsetOp update;
+    bool valid = true;
+    for (auto *user : arg.getUsers()) {
+      if (user->getBlock() != forOp.getBody()) {
+        valid = false;
+      } else if (auto loadOp = dyn_cast<xetile::LoadTileOp>(user)) {
+        valid &= !load;
+        load = loadOp;
+      } else if (auto updateOp = dyn_cast<xetile::UpdateTileOffsetOp>(user)) {
+        valid &= !update;
+        update = updateOp;
+      } else {
+        valid = false;
+      }
+    }
+    if (!valid || !load || !update || update.getIndices() ||
+        !update->hasOneUse() ||
+        yield.getOperand(i).getDefiningOp() != update.getOperation())
+      continue;
+    if (!llvm::all_of(update->getOperands().drop_front(), [&](Value v) {
+          return forOp.isDefinedOutsideOfLoop(v);
+        }))
+      continue;
+
+    auto source = getTileSource(forOp, arg);
+    if (forOp.getBody()
+            ->walk([&](Operation *op) {
+              return mayWrite(forOp, op, source) ? WalkResult::interrupt()
+                                                 : WalkResult::advance();
+            })
+            .wasInterrupted())
+      continue;
+
+    auto init = forOp.getInitArgs()[i].getDefiningOp<xetile::InitTileOp>();
+    tiles.push_back({static_cast<unsigned>(i), load, update, init});
+  }
+  return tiles;
+}
+
+class XeTileLoopPipeliningPass
+    : public impl::XeTileLoopPipeliningBase<XeTileLoopPipeliningPass> {
+public:
+  using XeTileLoopPipeliningBase::XeTileLoopPipeliningBase;
+
+  void runOnOperation() override {
+    if (stages == 0) {
+      getOperation().emitOpError("Pipeline needs at least one stage");
+      return signalPassFailure();
+    }
+
+    llvm::SmallVector<scf::ForOp> loops;
+    getOperation().walk([&](scf::ForOp forOp) {
+      if (!llvm::empty(forOp.getOps<xetile::TileMMAOp>()))
+        loops.push_back(forOp);
+    });
+    for (auto forOp : loops)
+      pipeline(forOp);
+  }
+
+private:
+  void pipeline(scf::ForOp forOp);
+};
+
+void XeTileLoopPipeliningPass::pipeline(scf::ForOp forOp) {
+  auto lb = getConstantIntValue(forOp.getLowerBound());
+  auto ub = getConstantIntValue(forOp.getUpperBound());
+  auto step = getConstantIntValue(forOp.getStep());
+  if (!lb || !ub || !step || *step <= 0)
+    return;
+
+  int64_t numAhead = stages - 1;
+  int64_t tripCount = *ub > *lb ? (*ub - *lb + *step - 1) / *step : 0;
+  if (tripCount <= numAhead)
+    return;
+
+  auto tiles = getPipelinedTiles(forOp);
+  if (tiles.empty())
+    return;
+
+  // Prefetch only when the frontend did not already do it.
+  bool prefetch = prefetchDistance > 0 &&
+                  llvm::empty(forOp.getOps<xetile::PrefetchTileOp>());
+  auto prefetchTile = [&](const PipelinedTile &tile) {
+    auto tileTy = tile.load.getSource().getType();
+    return prefetch && tile.init && tileTy.getMemorySpaceAsInt() != 3;
+  };
+
+  LLVM_DEBUG(llvm::dbgs() << "Pipelining " << tiles.size() << " tiles of "
+                          << forOp << "\n");
+
+  auto loc = forOp.getLoc();
+  OpBuilder builder(forOp);
+  auto numArgs = forOp.getNumRegionIterArgs();
+  llvm::SmallVector<Value> inits(forOp.getInitArgs());
+
+  // Prologue: prefetch the first iterations and load the values of the
+  // first numAhead iterations.
+  llvm::SmallVector<Value> slotInits, prefetchInits;
+  for (auto &tile : tiles) {
+    auto advance = [&](Value value) {
+      IRMapping mapping;
+      mapping.map(tile.update.getTile(), value);
+      return builder.clone(*tile.update, mapping)->getResult(0);
+    };
+
+    if (prefetchTile(tile)) {
+      Value pf = builder.clone(*tile.init)->getResult(0);
+      for (int64_t i = 0; i < numAhead + prefetchDistance; ++i) {
+        builder.create<xetile::PrefetchTileOp>(loc, pf, nullptr, nullptr,
+                                               nullptr);
+        pf = advance(pf);
+      }
+      prefetchInits.push_back(pf);
+    }
+
+    auto &cur = inits[tile.argIndex];
+    for (int64_t i = 0; i < numAhead; ++i) {
+      IRMapping mapping;
+      mapping.map(tile.load.getSource(), cur);
+      slotInits.push_back(builder.clone(*tile.load, mapping)->getResult(0));
+      cur = advance(cur);
+    }
+  }
+
+  llvm::SmallVector<Value> newInits(inits);
+  newInits.append(slotInits);
+  newInits.append(prefetchInits);
+
+  // Kernel: values are loaded numAhead iterations ahead of their use.
+  auto newUb = builder.create<arith::ConstantIndexOp>(
+      loc, *lb + (tripCount - numAhead) * *step);
+  auto oldYield = cast<scf::YieldOp>(forOp.getBody()->getTerminator());
+  auto newLoop = builder.create<scf::ForOp>(
+      loc, forOp.getLowerBound(), newUb, forOp.getStep(), newInits,
+      [&](OpBuilder &b, Location loc, Value iv, ValueRange args) {
+        IRMapping mapping;
+        mapping.map(forOp.getInductionVar(), iv);
+        mapping.map(forOp.getRegionIterArgs(), args.take_front(numArgs));
+
+        llvm::SmallVector<Value> nextSlots, nextPrefetches;
+        auto slots = args.slice(numArgs, slotInits.size());
+        auto prefetches = args.take_back(prefetchInits.size());
+        unsigned prefetchIndex = 0;
+        for (auto [i, tile] : llvm::enumerate(tiles)) {
+          if (prefetchTile(tile)) {
+            auto pf = prefetches[prefetchIndex++];
+            b.create<xetile::PrefetchTileOp>(loc, pf, nullptr, nullptr,
+                                             nullptr);
+            IRMapping pfMapping;
+            pfMapping.map(tile.update.getTile(), pf);
+            nextPrefetches.push_back(
+                b.clone(*tile.update, pfMapping)->getResult(0));
+          }
+          if (!numAhead)
+            continue;
+
+          auto tileSlots = slots.slice(i * numAhead, numAhead);
+          auto next = b.clone(*tile.load, mapping)->getResult(0);
+          mapping.map(tile.load.getValue(), tileSlots[0]);
+          nextSlots.append(tileSlots.begin() + 1, tileSlots.end());
+          nextSlots.push_back(next);
+        }
+
+        for (auto &op : forOp.getBody()->without_terminator()) {
+          if (numAhead && llvm::any_of(tiles, [&](const PipelinedTile &tile) {
+                return tile.load.getOperation() == &op;
+              }))
+            continue;
+          b.clone(op, mapping);
+        }
+
+        llvm::SmallVector<Value> yields;
+        for (auto operand : oldYield.getOperands())
+          yields.push_back(mapping.lookupOrDefault(operand));
+        yields.append(nextSlots);
+        yields.append(nextPrefetches);
+        b.create<scf::YieldOp>(loc, yields);
+      });
+
+  // Epilogue: the remaining iterations use the values loaded ahead. The
+  // loaded tiles are already advanced to their final value.
+  builder.setInsertionPointAfter(newLoop);
+  llvm::SmallVector<Value> results(newLoop.getResults().take_front(numArgs));
+  auto slotResults = newLoop.getResults().slice(numArgs, slotInits.size());
+  for (int64_t e = 0; e < numAhead; ++e) {
+    IRMapping mapping;
+    if (!forOp.getInductionVar().use_empty())
+      mapping.map(forOp.getInductionVar(),
+                  builder.create<arith::ConstantIndexOp>(
+                      loc, *lb + (tripCount - numAhead + e) * *step));
+    mapping.map(forOp.getRegionIterArgs(), results);
+    llvm::SmallPtrSet<Operation *, 8> skipped, updates;
+    for (auto [i, tile] : llvm::enumerate(tiles)) {
+      mapping.map(tile.load.getValue(), slotResults[i * numAhead + e]);
+      skipped.insert(tile.load);
+      skipped.insert(tile.update);
+      updates.insert(tile.update);
+    }
+    for (auto &op : forOp.getBody()->without_terminator()) {
+      if (!skipped.contains(&op))
+        builder.clone(op, mapping);
+    }
+
+    llvm::SmallVector<Value> next;
+    for (auto [i, operand] : llvm::enumerate(oldYield.getOperands())) {
+      auto *def = operand.getDefiningOp();
+      next.push_back(def && updates.contains(def)
+                         ? results[i]
+                         : mapping.lookupOrDefault(operand));
+    }
+    results = next;
+  }
+
+  forOp.replaceAllUsesWith(results);
+  forOp.erase();
+}
+
+} // namespace
+
+/// Create a pass
+std::unique_ptr<::mlir::Pass> createXeTileLoopPipeliningPass() {
+  return std::make_unique<XeTileLoopPipeliningPass>();
+}
+} // namespace imex
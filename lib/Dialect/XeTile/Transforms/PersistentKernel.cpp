@@ -0,0 +1,180 @@
+//===- PersistentKernel.cpp ---- xetile-persistent-kernel Pass --*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains the persistent-kernel schedule of XeTile kernels. A
+/// kernel launched on a grid of X x Y workgroups, one per output tile, is
+/// launched on N workgroups instead, that loop over the tiles with a static
+/// round-robin schedule:
+///
+///   kernel<<<(X, Y, 1)>>>             kernel<<<(N, 1, 1)>>>
+///   body(block_id x, block_id y) =>   for t in [block_id x, X * Y) step N
+///                                       body(t % X, t / X)
+///
+//===----------------------------------------------------------------------===//
+
+#include <mlir/Dialect/Arith/IR/Arith.h>
+#include <mlir/Dialect/GPU/IR/GPUDialect.h>
+#include <mlir/Dialect/SCF/IR/SCF.h>
+#include <mlir/Dialect/Utils/StaticValueUtils.h>
+#include <mlir/IR/BuiltinOps.h>
+#include <mlir/IR/SymbolTable.h>
+#include <mlir/Pass/Pass.h>
+
+#include <llvm/ADT/MapVector.h>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Support/Debug.h>
+
+#include "imex/Dialect/XeTile/IR/XeTileOps.h"
+#include "imex/Dialect/XeTile/Transforms/Passes.h"
+#include "imex/Utils/XeArch.h"
+
+#define DEBUG_TYPE "xetile-persistent-kernel"
+
+using namespace mlir;
+using namespace imex;
+
+namespace imex {
+#define GEN_PASS_DEF_XETILEPERSISTENTKERNEL
+#include "imex/Dialect/XeTile/Transforms/Passes.h.inc"
+} // namespace imex
+
+namespace imex {
+
+namespace {
+
+// Returns true if \p func is a GEMM kernel whose body can be wrapped in the
+// tile loop. Barriers stay valid since all subgroups of a workgroup run the
+// same iterations, but the body must not return early.
+static bool canBePersistent(gpu::GPUFuncOp func) {
+  if (!func.getBody().hasOneBlock() ||
+      !isa<gpu::ReturnOp>(func.front().getTerminator()))
+    return false;
+  bool hasTileMMA = false;
+  auto result = func.walk([&](Operation *op) {
+    if (isa<gpu::ReturnOp>(op) && op->getParentOp() != func)
+      return WalkResult::interrupt();
+    hasTileMMA |= isa<xetile::TileMMAOp>(op);
+    return WalkResult::advance();
+  });
+  return !result.wasInterrupted() && hasTileMMA;
+}
+
+// Wraps the body of \p func in a loop over the \p gridX x \p gridY tiles of
+// the original grid, distributed over \p numWorkgroups workgroups.
+static void makePersistent(gpu::GPUFuncOp func, int64_t gridX, int64_t gridY,
+                           int64_t numWorkgroups) {
+  auto &body = func.front();
+  auto loc = func.getLoc();
+  llvm::SmallVector<Operation *> ops;
+  for (auto &op : body.without_terminator())
+    ops.push_back(&op);
+
+  OpBuilder builder = OpBuilder::atBlockBegin(&body);
+  auto createIndexConstant = [&](int64_t value) {
+    return builder.create<arith::ConstantIndexOp>(loc, value);
+  };
+  auto id = builder.create<gpu::BlockIdOp>(loc, gpu::Dimension::x);
+  auto loop = builder.create<scf::ForOp>(loc, id,
+                                         createIndexConstant(gridX * gridY),
+                                         createIndexConstant(numWorkgroups));
+  for (auto *op : ops)
+    op->moveBefore(loop.getBody()->getTerminator());
+
+  // Workgroup ids and grid sizes refer to the tile and the original grid.
+  builder.setInsertionPointToStart(loop.getBody());
+  auto sizeX = createIndexConstant(gridX);
+  Value tileX = builder.create<arith::RemUIOp>(loc, loop.getInductionVar(),
+                                               sizeX);
+  Value tileY = builder.create<arith::DivUIOp>(loc, loop.getInductionVar(),
+                                               sizeX);
+  Value tileZ = createIndexConstant(0);
+  Value sizes[] = {sizeX, createIndexConstant(gridY), createIndexConstant(1)};
+  loop.getBody()->walk([&](Operation *op) {
+    if (auto blockId = dyn_cast<gpu::BlockIdOp>(op)) {
+      auto dim = static_cast<unsigned>(blockId.getDimension());
+      blockId.replaceAllUsesWith(
+          ValueRange{dim == 0 ? tileX : dim == 1 ? tileY : tileZ});
+      blockId.erase();
+    } else if (auto gridDim = dyn_cast<gpu::GridDimOp>(op)) {
+      auto dim = static_cast<unsigned>(gridDim.getDimension());
+      gridDim.replaceAllUsesWith(ValueRange{sizes[dim]});
+      gridDim.erase();
+    }
+  });
+}
+
+class XeTilePersistentKernelPass
+    : public impl::XeTilePersistentKernelBase<XeTilePersistentKernelPass> {
+public:
+  using XeTilePersistentKernelBase::XeTilePersistentKernelBase;
+
+  void runOnOperation() override {
+    auto arch = getXeuArch(device);
+    if (!arch) {
+      getOperation().emitOpError("Invalid device: ") << device;
+      return signalPassFailure();
+    }
+    int64_t maxWorkgroups =
+        numWorkgroups ? numWorkgroups : arch->getNumXeCores();
+
+    // The schedule changes the grid of the launch, so only kernels with a
+    // single launch are considered.
+    llvm::MapVector<Operation *, llvm::SmallVector<gpu::LaunchFuncOp>> launches;
+    getOperation().walk([&](gpu::LaunchFuncOp launch) {
+      if (auto func = SymbolTable::lookupNearestSymbolFrom<gpu::GPUFuncOp>(
+              launch, launch.getKernel()))
+        launches[func].push_back(launch);
+    });
+
+    for (auto &[op, funcLaunches] : launches) {
+      auto func = cast<gpu::GPUFuncOp>(op);
+      if (funcLaunches.size() != 1)
+        continue;
+      auto launch = funcLaunches[0];
+      auto gridX = getConstantIntValue(launch.getGridSizeX());
+      auto gridY = getConstantIntValue(launch.getGridSizeY());
+      auto gridZ = getConstantIntValue(launch.getGridSizeZ());
+      if (!gridX || !gridY || !gridZ || *gridZ != 1)
+        continue;
+
+      // Only grids with more tiles than workgroups benefit.
+      int64_t numTiles = *gridX * *gridY;
+      if (numTiles <= maxWorkgroups || !canBePersistent(func))
+        continue;
+
+      LLVM_DEBUG(llvm::dbgs() << "Scheduling the " << numTiles << " tiles of "
+                              << func.getName() << " on " << maxWorkgroups
+                              << " workgroups\n");
+
+      makePersistent(func, *gridX, *gridY, maxWorkgroups);
+
+      OpBuilder builder(launch);
+      auto loc = launch.getLoc();
+      auto one = builder.create<arith::ConstantIndexOp>(loc, 1);
+      launch.getGridSizeXMutable().assign(
+          builder.create<arith::ConstantIndexOp>(loc, maxWorkgroups));
+      launch.getGridSizeYMutable().assign(one);
+      if (func->hasAttr("known_grid_size"))
+        func->setAttr("known_grid_size",
+                      DenseI32ArrayAttr::get(
+                          &getContext(),
+                          {static_cast<int32_t>(maxWorkgroups), 1, 1}));
+    }
+  }
+};
+
+} // namespace
+
+/// Create a pass
+std::unique_ptr<::mlir::Pass> createXeTilePersistentKernelPass() {
+  return std::make_unique<XeTilePersistentKernelPass>();
+}
+} // namespace imex
@@ -0,0 +1,452 @@
+//===- ProducerConsumer.cpp -- xetile-producer-consumer Pass ----*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains the producer/consumer specialization of XeTile GEMM
+/// kernels launched with one subgroup per workgroup. A second subgroup is
+/// added to every workgroup that streams the tiles of the K-loop from global
+/// memory into a ring of SLM slots, while the original subgroup loads them
+/// from SLM and runs the DPAS. Each slot is guarded by a pair of named
+/// barriers, full and empty:
+///
+///   producer (subgroup 1):            consumer (subgroup 0):
+///   for i in [0, N) {                 for i in [0, N) {
+///     s = i % stages                    s = i % stages
+///     v_i = load t_i                    wait full[s]
+///     if i >= stages: wait empty[s]     v_i = load slm[s]
+///     slm[s] = v_i                      if i + stages < N: signal empty[s]
+///     signal full[s]                    compute(v_i)
+///   }                                 }
+///
+/// Both loops are unrolled by the number of stages, so that the slots and
+/// the barriers are static.
+///
+//===----------------------------------------------------------------------===//
+
+#include <mlir/Dialect/Arith/IR/Arith.h>
+#include <mlir/Dialect/GPU/IR/GPUDialect.h>
+#include <mlir/Dialect/MemRef/IR/MemRef.h>
+#include <mlir/Dialect/SCF/IR/SCF.h>
+#include <mlir/Dialect/Utils/StaticValueUtils.h>
+#include <mlir/Dialect/XeGPU/IR/XeGPU.h>
+#include <mlir/IR/BuiltinOps.h>
+#include <mlir/IR/IRMapping.h>
+#include <mlir/IR/SymbolTable.h>
+#include <mlir/Interfaces/SideEffectInterfaces.h>
+#include <mlir/Pass/Pass.h>
+
+#include <llvm/ADT/MapVector.h>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/SetVector.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Support/Debug.h>
+
+#include "imex/Dialect/XeTile/IR/XeTileOps.h"
+#include "imex/Dialect/XeTile/Transforms/Passes.h"
+#include "imex/Utils/XeArch.h"
+#include "imex/Utils/XeCommon.h"
+
+#define DEBUG_TYPE "xetile-producer-consumer"
+
+using namespace mlir;
+using namespace imex;
+
+namespace imex {
+#define GEN_PASS_DEF_XETILEPRODUCERCONSUMER
+#include "imex/Dialect/XeTile/Transforms/Passes.h.inc"
+} // namespace imex
+
+namespace imex {
+
+namespace {
+
+// A tile carried by the K-loop that is loaded from global memory once per
+// iteration and advanced by a loop invariant offset.
+struct StreamedTile {
+  unsigned argIndex;
+  xetile::LoadTileOp load;
+  xetile::UpdateTileOffsetOp update;
+  xetile::InitTileOp init;
+  // The type of the tile of an SLM slot.
+  xetile::TileType slotTy;
+};
+
+// Returns the tiles of \p forOp that the producer can stream, or an empty
+// list if any load of the loop cannot be moved to the producer.
+static llvm::SmallVector<StreamedTile> getStreamedTiles(scf::ForOp forOp) {
+  llvm::SmallVector<StreamedTile> tiles;
+  auto yield = cast<scf::YieldOp>(forOp.getBody()->getTerminator());
+  for (auto [i, arg] : llvm::enumerate(forOp.getRegionIterArgs())) {
+    auto tileTy = dyn_cast<xetile::TileType>(arg.getType());
+    if (!tileTy)
+      continue;
+
+    xetile::LoadTileOp load;
+    xetile::UpdateTileOffsetOp update;
+    bool valid = true;
+    for (auto *user : arg.getUsers()) {
+      if (user->getBlock() != forOp.getBody()) {
+        valid = false;
+      } else if (auto loadOp = dyn_cast<xetile::LoadTileOp>(user)) {
+        valid &= !load;
+        load = loadOp;
+      } else if (auto updateOp = dyn_cast<xetile::UpdateTileOffsetOp>(user)) {
+        valid &= !update;
+        update = updateOp;
+      } else {
+        valid = false;
+      }
+    }
+    if (!load)
+      continue;
+    if (!valid || !update || update.getIndices() || !update->hasOneUse() ||
+        yield.getOperand(i).getDefiningOp() != update.getOperation())
+      return {};
+    if (!llvm::all_of(update->getOperands().drop_front(), [&](Value v) {
+          return forOp.isDefinedOutsideOfLoop(v);
+        }))
+      return {};
+
+    auto init = forOp.getInitArgs()[i].getDefiningOp<xetile::InitTileOp>();
+    if (!init || init->getBlock() != forOp->getBlock() ||
+        tileTy.getMemorySpaceAsInt() == 3 || tileTy.getWgMap() ||
+        tileTy.getRank() != 2 || isColMajorOrder(tileTy.getOrder()))
+      return {};
+
+    auto slotTy = xetile::TileType::get(
+        tileTy.getShape(), tileTy.getElementType(),
+        xetile::XeTileAttr::get(forOp.getContext(), {1, 0}, 3));
+    if (!isSupportedOptimalSLMAccess(slotTy))
+      return {};
+    tiles.push_back({static_cast<unsigned>(i), load, update, init, slotTy});
+  }
+  return tiles;
+}
+
+// Returns the ops of the block of \p forOp computing the initial tiles and
+// the offsets of \p tiles, in program order, or std::nullopt if they are
+// not all free of side effects.
+static std::optional<llvm::SmallVector<Operation *>>
+getProducerSlice(scf::ForOp forOp, llvm::ArrayRef<StreamedTile> tiles) {
+  llvm::SetVector<Operation *> slice;
+  llvm::SmallVector<Value> worklist;
+  for (auto &tile : tiles) {
+    worklist.push_back(tile.init);
+    llvm::append_range(worklist, tile.update->getOperands().drop_front());
+  }
+  while (!worklist.empty()) {
+    auto *op = worklist.pop_back_val().getDefiningOp();
+    if (!op || slice.contains(op))
+      continue;
+    if (op->getBlock() != forOp->getBlock() || op->getNumRegions() ||
+        !(isPure(op) || isa<xetile::InitTileOp>(op)))
+      return std::nullopt;
+    slice.insert(op);
+    llvm::append_range(worklist, op->getOperands());
+  }
+  auto ops = slice.takeVector();
+  llvm::sort(ops, [](Operation *a, Operation *b) {
+    return a->isBeforeInBlock(b);
+  });
+  return ops;
+}
+
+// Returns true if \p func can be split in a producer and a consumer. Every
+// subgroup must run until the end of the kernel, and the kernel must not
+// synchronize its subgroups by itself.
+static bool canBeSpecialized(gpu::GPUFuncOp func) {
+  if (!func.getBody().hasOneBlock() ||
+      !isa<gpu::ReturnOp>(func.front().getTerminator()))
+    return false;
+  auto result = func.walk([&](Operation *op) {
+    if ((isa<gpu::ReturnOp>(op) && op->getParentOp() != func) ||
+        isa<gpu::BarrierOp, xegpu::AllocNbarrierOp, xegpu::InitNbarrierOp>(
+            op))
+      return WalkResult::interrupt();
+    return WalkResult::advance();
+  });
+  return !result.wasInterrupted();
+}
+
+class XeTileProducerConsumerPass
+    : public impl::XeTileProducerConsumerBase<XeTileProducerConsumerPass> {
+public:
+  using XeTileProducerConsumerBase::XeTileProducerConsumerBase;
+
+  void runOnOperation() override {
+    auto arch = getXeuArch(device);
+    if (!arch) {
+      getOperation().emitOpError("Invalid device: ") << device;
+      return signalPassFailure();
+    }
+    if (stages == 0) {
+      getOperation().emitOpError("SLM ring needs at least one stage");
+      return signalPassFailure();
+    }
+    uArch = arch;
+
+    // The specialization changes the workgroup size of the launch, so only
+    // kernels with a single launch are considered.
+    llvm::MapVector<Operation *, llvm::SmallVector<gpu::LaunchFuncOp>> launches;
+    getOperation().walk([&](gpu::LaunchFuncOp launch) {
+      if (auto func = SymbolTable::lookupNearestSymbolFrom<gpu::GPUFuncOp>(
+              launch, launch.getKernel()))
+        launches[func].push_back(launch);
+    });
+
+    for (auto &[op, funcLaunches] : launches) {
+      auto func = cast<gpu::GPUFuncOp>(op);
+      if (funcLaunches.size() != 1)
+        continue;
+      auto launch = funcLaunches[0];
+      if (!llvm::all_of(ValueRange{launch.getBlockSizeX(),
+                                   launch.getBlockSizeY(),
+                                   launch.getBlockSizeZ()},
+                        [](Value v) { return isConstantIntValue(v, 1); }))
+        continue;
+      if (!canBeSpecialized(func))
+        continue;
+
+      auto loops = func.front().getOps<scf::ForOp>();
+      auto it = llvm::find_if(loops, [](scf::ForOp forOp) {
+        return !llvm::empty(forOp.getOps<xetile::TileMMAOp>());
+      });
+      if (it == loops.end() || !specialize(func, *it))
+        continue;
+
+      OpBuilder builder(launch);
+      launch.getBlockSizeXMutable().assign(
+          builder.create<arith::ConstantIndexOp>(launch.getLoc(), 2));
+      if (func->hasAttr("known_block_size"))
+        func->setAttr("known_block_size",
+                      DenseI32ArrayAttr::get(&getContext(), {2, 1, 1}));
+    }
+  }
+
+private:
+  std::shared_ptr<XeuArchInterface> uArch;
+
+  bool specialize(gpu::GPUFuncOp func, scf::ForOp forOp);
+};
+
+bool XeTileProducerConsumerPass::specialize(gpu::GPUFuncOp func,
+                                            scf::ForOp forOp) {
+  auto lb = getConstantIntValue(forOp.getLowerBound());
+  auto ub = getConstantIntValue(forOp.getUpperBound());
+  auto step = getConstantIntValue(forOp.getStep());
+  if (!lb || !ub || !step || *step <= 0)
+    return false;
+
+  int64_t numStages = stages;
+  int64_t tripCount = *ub > *lb ? (*ub - *lb + *step - 1) / *step : 0;
+  if (tripCount < numStages || tripCount % numStages)
+    return false;
+  int64_t numRounds = tripCount / numStages;
+
+  auto tiles = getStreamedTiles(forOp);
+  if (tiles.empty())
+    return false;
+  auto slice = getProducerSlice(forOp, tiles);
+  if (!slice)
+    return false;
+
+  // Two named barriers per slot, barrier 0 is the workgroup barrier.
+  int64_t numBarriers = 2 * numStages + 1;
+  int64_t slmBytes = 0;
+  for (auto &tile : tiles)
+    slmBytes += numStages * tile.slotTy.getNumElements() *
+                tile.slotTy.getElementType().getIntOrFloatBitWidth() / 8;
+  if (numBarriers > uArch->getNumNamedBarriers() ||
+      slmBytes > uArch->getSLMSize())
+    return false;
+
+  LLVM_DEBUG(llvm::dbgs() << "Streaming " << tiles.size() << " tiles of "
+                          << func.getName() << " through " << numStages
+                          << " SLM slots\n");
+
+  auto loc = forOp.getLoc();
+  auto &body = func.front();
+  llvm::SmallVector<Operation *> ops;
+  for (auto &op : body.without_terminator())
+    ops.push_back(&op);
+
+  OpBuilder builder = OpBuilder::atBlockBegin(&body);
+  auto createIndexConstant = [&](int64_t value) {
+    return builder.create<arith::ConstantIndexOp>(loc, value);
+  };
+  auto createNbarrier = [&](int64_t id, NbarrierRole role) {
+    auto nbarrier = builder.create<xegpu::InitNbarrierOp>(
+        loc, xegpu::NbarrierType::get(builder.getContext()),
+        builder.create<arith::ConstantIntOp>(loc, id, builder.getI8Type()),
+        builder.create<arith::ConstantIntOp>(loc, 2, builder.getI8Type()));
+    nbarrier->setAttr(nbarrierRoleAttrName,
+                      builder.getI8IntegerAttr(static_cast<int8_t>(role)));
+    nbarrier->setAttr(nbarrierProducersAttrName, builder.getI8IntegerAttr(1));
+    return nbarrier.getResult();
+  };
+  auto signal = [&](Value nbarrier) {
+    builder.create<xegpu::FenceOp>(loc, xegpu::MemorySpace::SLM,
+                                   xegpu::FenceScope::Workgroup);
+    builder.create<xegpu::NbarrierArriveOp>(loc, nbarrier);
+  };
+  auto wait = [&](Value nbarrier) {
+    builder.create<xegpu::NbarrierArriveOp>(loc, nbarrier);
+    builder.create<xegpu::NbarrierWaitOp>(loc, nbarrier);
+  };
+
+  // The SLM ring of a tile holds its slots on top of each other.
+  builder.create<xegpu::AllocNbarrierOp>(loc, numBarriers);
+  llvm::SmallVector<Value> rings;
+  for (auto &tile : tiles) {
+    auto shape = tile.slotTy.getShape();
+    auto elemTy = tile.slotTy.getElementType();
+    auto bytes = numStages * tile.slotTy.getNumElements() *
+                 elemTy.getIntOrFloatBitWidth() / 8;
+    auto slm = builder.create<memref::AllocOp>(
+        loc, MemRefType::get(bytes, builder.getI8Type(), {}, 3));
+    auto viewTy =
+        MemRefType::get({numStages * shape[0], shape[1]}, elemTy, {}, 3);
+    rings.push_back(builder.create<memref::ViewOp>(
+        loc, viewTy, slm, createIndexConstant(0), ValueRange()));
+  }
+  auto getSlot = [&](unsigned t, int64_t s) -> Value {
+    auto shape = tiles[t].slotTy.getShape();
+    return builder.create<xetile::InitTileOp>(
+        loc, tiles[t].slotTy, rings[t],
+        llvm::ArrayRef<OpFoldResult>{builder.getIndexAttr(s * shape[0]),
+                                     builder.getIndexAttr(0)});
+  };
+
+  Value sgId = builder.create<gpu::ThreadIdOp>(loc, gpu::Dimension::x);
+  Value isProducer = builder.create<arith::CmpIOp>(
+      loc, arith::CmpIPredicate::eq, sgId, createIndexConstant(1));
+  auto ifOp = builder.create<scf::IfOp>(loc, isProducer,
+                                        /*withElseRegion=*/true);
+  for (auto *op : ops)
+    op->moveBefore(ifOp.elseBlock()->getTerminator());
+
+  // Producer: recompute the initial tiles and stream them to SLM.
+  builder.setInsertionPoint(ifOp.thenBlock()->getTerminator());
+  IRMapping sliceMapping;
+  for (auto *op : *slice)
+    builder.clone(*op, sliceMapping);
+  llvm::SmallVector<Value> full, empty;
+  for (int64_t s = 0; s < numStages; ++s) {
+    full.push_back(createNbarrier(2 * s + 1, NbarrierRole::Producer));
+    empty.push_back(createNbarrier(2 * s + 2, NbarrierRole::Consumer));
+  }
+  llvm::SmallVector<Value> producerInits;
+  for (auto &tile : tiles)
+    producerInits.push_back(sliceMapping.lookup(tile.init.getResult()));
+  builder.create<scf::ForOp>(
+      loc, createIndexConstant(0), createIndexConstant(numRounds),
+      createIndexConstant(1), producerInits,
+      [&](OpBuilder &b, Location loc, Value round, ValueRange args) {
+        OpBuilder::InsertionGuard guard(builder);
+        builder.setInsertionPoint(b.getInsertionBlock(),
+                                  b.getInsertionPoint());
+        auto notFirst = builder.create<arith::CmpIOp>(
+            loc, arith::CmpIPredicate::ugt, round, createIndexConstant(0));
+        llvm::SmallVector<Value> cur(args);
+        for (int64_t s = 0; s < numStages; ++s) {
+          llvm::SmallVector<Value> values;
+          for (auto [t, tile] : llvm::enumerate(tiles)) {
+            IRMapping mapping(sliceMapping);
+            mapping.map(tile.load.getSource(), cur[t]);
+            values.push_back(builder.clone(*tile.load, mapping)->getResult(0));
+          }
+          // The slot is free once the consumer loaded it in the last round.
+          auto ifNotFirst = builder.create<scf::IfOp>(loc, notFirst);
+          builder.setInsertionPoint(ifNotFirst.thenBlock()->getTerminator());
+          wait(empty[s]);
+          builder.setInsertionPointAfter(ifNotFirst);
+          for (auto [t, tile] : llvm::enumerate(tiles)) {
+            builder.create<xetile::StoreTileOp>(loc, values[t], getSlot(t, s),
+                                                nullptr, nullptr, nullptr);
+            IRMapping mapping(sliceMapping);
+            mapping.map(tile.update.getTile(), cur[t]);
+            cur[t] = builder.clone(*tile.update, mapping)->getResult(0);
+          }
+          signal(full[s]);
+        }
+        builder.create<scf::YieldOp>(loc, cur);
+      });
+
+  // Consumer: the original kernel, with the streamed tiles loaded from SLM.
+  builder.setInsertionPoint(forOp);
+  full.clear();
+  empty.clear();
+  for (int64_t s = 0; s < numStages; ++s) {
+    full.push_back(createNbarrier(2 * s + 1, NbarrierRole::Consumer));
+    empty.push_back(createNbarrier(2 * s + 2, NbarrierRole::Producer));
+  }
+  llvm::SmallVector<llvm::SmallVector<Value>> slots(tiles.size());
+  for (auto [t, tile] : llvm::enumerate(tiles))
+    for (int64_t s = 0; s < numStages; ++s)
+      slots[t].push_back(getSlot(t, s));
+
+  auto lastRound =
+      createIndexConstant(*lb + (numRounds - 1) * numStages * *step);
+  auto oldYield = cast<scf::YieldOp>(forOp.getBody()->getTerminator());
+  auto newLoop = builder.create<scf::ForOp>(
+      loc, forOp.getLowerBound(), forOp.getUpperBound(),
+      createIndexConstant(numStages * *step), forOp.getInitArgs(),
+      [&](OpBuilder &b, Location loc, Value iv, ValueRange args) {
+        OpBuilder::InsertionGuard guard(builder);
+        builder.setInsertionPoint(b.getInsertionBlock(),
+                                  b.getInsertionPoint());
+        auto notLast = builder.create<arith::CmpIOp>(
+            loc, arith::CmpIPredicate::ult, iv, lastRound);
+        llvm::SmallVector<Value> cur(args);
+        for (int64_t s = 0; s < numStages; ++s) {
+          IRMapping mapping;
+          Value i = iv;
+          if (s)
+            i = builder.create<arith::AddIOp>(loc, iv,
+                                              createIndexConstant(s * *step));
+          mapping.map(forOp.getInductionVar(), i);
+          mapping.map(forOp.getRegionIterArgs(), cur);
+
+          wait(full[s]);
+          for (auto [t, tile] : llvm::enumerate(tiles)) {
+            auto value = builder.create<xetile::LoadTileOp>(
+                loc, tile.load.getType(), slots[t][s], Attribute(), nullptr,
+                nullptr, nullptr);
+            mapping.map(tile.load.getValue(), value.getResult());
+          }
+          // The last round has no producer waiting for the slot.
+          auto ifNotLast = builder.create<scf::IfOp>(loc, notLast);
+          builder.setInsertionPoint(ifNotLast.thenBlock()->getTerminator());
+          signal(empty[s]);
+          builder.setInsertionPointAfter(ifNotLast);
+
+          for (auto &op : forOp.getBody()->without_terminator()) {
+            if (llvm::none_of(tiles, [&](const StreamedTile &tile) {
+                  return tile.load.getOperation() == &op;
+                }))
+              builder.clone(op, mapping);
+          }
+          for (auto [j, operand] : llvm::enumerate(oldYield.getOperands()))
+            cur[j] = mapping.lookupOrDefault(operand);
+        }
+        builder.create<scf::YieldOp>(loc, cur);
+      });
+
+  forOp.replaceAllUsesWith(newLoop.getResults());
+  forOp.erase();
+  return true;
+}
+
+} // namespace
+
+/// Create a pass
+std::unique_ptr<::mlir::Pass> createXeTileProducerConsumerPass() {
+  return std::make_unique<XeTileProducerConsumerPass>();
+}
+} // namespace imex
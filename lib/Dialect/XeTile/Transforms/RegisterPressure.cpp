@@ -0,0 +1,89 @@
+//===- RegisterPressure.cpp - Register pressure of XeTile kernels --------===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file implements the live-register estimator of blocked XeTile
+/// kernels. The live values at every op are computed with mlir::Liveness.
+/// Values that are live across an op with regions, but not used by it, are
+/// added to the pressure inside its regions.
+///
+//===----------------------------------------------------------------------===//
+
+#include <mlir/Analysis/Liveness.h>
+#include <mlir/IR/BuiltinTypes.h>
+
+#include <llvm/Support/MathExtras.h>
+
+#include <algorithm>
+
+#include "imex/Dialect/XeTile/IR/XeTileOps.h"
+#include "imex/Dialect/XeTile/Transforms/RegisterPressure.h"
+
+namespace imex {
+
+// Returns the number of GRFs holding a value of type \p type.
+static int64_t getNumGRFs(mlir::Type type, unsigned grfBits) {
+  if (auto vecTy = mlir::dyn_cast<mlir::VectorType>(type)) {
+    auto elemTy = vecTy.getElementType();
+    int64_t elemBits = elemTy.isIndex() ? 64 : elemTy.getIntOrFloatBitWidth();
+    return llvm::divideCeil(vecTy.getNumElements() * elemBits, grfBits);
+  }
+  if (mlir::isa<xetile::TileType>(type))
+    return 1;
+  return 0;
+}
+
+static int64_t getNumGRFs(const mlir::Liveness::ValueSetT &values,
+                          unsigned grfBits) {
+  int64_t numGRFs = 0;
+  for (auto value : values)
+    numGRFs += getNumGRFs(value.getType(), grfBits);
+  return numGRFs;
+}
+
+// Returns the peak pressure of \p block, given the pressure of the values
+// live across the op containing it.
+static int64_t getPeakPressure(const mlir::Liveness &liveness,
+                               mlir::Block *block, int64_t outerPressure,
+                               unsigned grfBits) {
+  auto blockInfo = liveness.getLiveness(block);
+  int64_t peak = outerPressure;
+  for (auto &op : *block) {
+    auto live = blockInfo->currentlyLiveValues(&op);
+    peak = std::max(peak, outerPressure + getNumGRFs(live, grfBits));
+
+    for (auto &region : op.getRegions()) {
+      for (auto &nested : region) {
+        // Values used in the nested block are counted by its liveness.
+        auto &liveIn = liveness.getLiveIn(&nested);
+        int64_t across = 0;
+        for (auto value : live) {
+          if (value.getDefiningOp() != &op && !liveIn.count(value) &&
+              !liveness.isDeadAfter(value, &op))
+            across += getNumGRFs(value.getType(), grfBits);
+        }
+        peak = std::max(peak, getPeakPressure(liveness, &nested,
+                                              outerPressure + across, grfBits));
+      }
+    }
+  }
+  return peak;
+}
+
+int64_t estimateRegisterPressure(mlir::Operation *func, unsigned grfBits) {
+  mlir::Liveness liveness(func);
+  int64_t peak = 0;
+  for (auto &region : func->getRegions()) {
+    for (auto &block : region)
+      peak = std::max(peak, getPeakPressure(liveness, &block, 0, grfBits));
+  }
+  return peak;
+}
+
+} // namespace imex
@@ -0,0 +1,296 @@
+//===- SplitK.cpp ----------------- xetile-split-k Pass ---------*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains the split-K decomposition of XeTile GEMM kernels. The
+/// K-loop of a kernel computing C += A * B is split into S equal chunks that
+/// are processed by S workgroups along the z dimension of the grid:
+///
+///   c = load C                      c = 0
+///   for k in [lb, ub)         =>    for k in [lb + z * chunk, ... + chunk)
+///     c = mma(a_k, b_k, c)            c = mma(a_k, b_k, c)
+///   store c, C                      atomic_rmw addf c, C
+///
+/// Since C is only read by the atomic adds, C + sum_z(partial_z) is the same
+/// result as the unsplit kernel up to the order of the additions.
+///
+//===----------------------------------------------------------------------===//
+
+#include <mlir/Dialect/Arith/IR/Arith.h>
+#include <mlir/Dialect/GPU/IR/GPUDialect.h>
+#include <mlir/Dialect/SCF/IR/SCF.h>
+#include <mlir/Dialect/Utils/StaticValueUtils.h>
+#include <mlir/IR/BuiltinOps.h>
+#include <mlir/IR/SymbolTable.h>
+#include <mlir/Pass/Pass.h>
+
+#include <llvm/ADT/MapVector.h>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Support/Debug.h>
+
+#include <optional>
+
+#include "imex/Dialect/XeTile/IR/XeTileOps.h"
+#include "imex/Dialect/XeTile/Transforms/Passes.h"
+#include "imex/Utils/XeArch.h"
+
+#define DEBUG_TYPE "xetile-split-k"
+
+using namespace mlir;
+using namespace imex;
+
+namespace imex {
+#define GEN_PASS_DEF_XETILESPLITK
+#include "imex/Dialect/XeTile/Transforms/Passes.h.inc"
+} // namespace imex
+
+namespace imex {
+
+namespace {
+
+// Minimum number of K-loop iterations of a split.
+constexpr int64_t minItersPerSplit = 2;
+
+// The K-loop of a kernel that can be split.
+struct SplitKLoop {
+  scf::ForOp loop;
+  int64_t tripCount;
+  // The iter_arg accumulating C, and the load and store of C.
+  unsigned accIndex;
+  xetile::LoadTileOp accLoad;
+  xetile::StoreTileOp accStore;
+};
+
+// Returns the tile offset update of a tile carried by \p loop, if the tile is
+// only loaded, prefetched and advanced by loop invariant offsets.
+static xetile::UpdateTileOffsetOp getTileUpdate(scf::ForOp loop,
+                                                BlockArgument arg) {
+  auto yield = loop.getBody()->getTerminator();
+  auto index = arg.getArgNumber() - loop.getNumInductionVars();
+  auto update =
+      yield->getOperand(index).getDefiningOp<xetile::UpdateTileOffsetOp>();
+  if (!update || update.getTile() != arg || update.getIndices() ||
+      !update.getOffsetX() || !update.getOffsetY() ||
+      !loop.isDefinedOutsideOfLoop(update.getOffsetX()) ||
+      !loop.isDefinedOutsideOfLoop(update.getOffsetY()))
+    return nullptr;
+  for (auto user : arg.getUsers()) {
+    if (user != update &&
+        !isa<xetile::LoadTileOp, xetile::PrefetchTileOp>(user))
+      return nullptr;
+  }
+  return update;
+}
+
+// Returns the K-loop of \p func if it can be split.
+static std::optional<SplitKLoop> getSplitKLoop(gpu::GPUFuncOp func) {
+  llvm::SmallVector<scf::ForOp> loops;
+  bool usesBlockIdZ = false;
+  func.walk([&](Operation *op) {
+    if (auto forOp = dyn_cast<scf::ForOp>(op)) {
+      if (!llvm::empty(forOp.getOps<xetile::TileMMAOp>()))
+        loops.push_back(forOp);
+    } else if (auto blockId = dyn_cast<gpu::BlockIdOp>(op)) {
+      usesBlockIdZ |= blockId.getDimension() == gpu::Dimension::z;
+    }
+  });
+  // The partial results of the splits are combined at the end of the kernel,
+  // which needs a single K-loop at the top level of the kernel.
+  if (usesBlockIdZ || loops.size() != 1 || loops[0]->getParentOp() != func)
+    return std::nullopt;
+
+  auto loop = loops[0];
+  auto lb = getConstantIntValue(loop.getLowerBound());
+  auto ub = getConstantIntValue(loop.getUpperBound());
+  auto step = getConstantIntValue(loop.getStep());
+  if (!lb || !ub || !step || *step <= 0 || *ub <= *lb)
+    return std::nullopt;
+
+  SplitKLoop result = {loop, (*ub - *lb + *step - 1) / *step, 0, {}, {}};
+  auto yield = loop.getBody()->getTerminator();
+  for (auto [i, arg] : llvm::enumerate(loop.getRegionIterArgs())) {
+    if (isa<xetile::TileType>(arg.getType())) {
+      if (!getTileUpdate(loop, arg) || !loop.getResult(i).use_empty())
+        return std::nullopt;
+      continue;
+    }
+
+    // The only other value carried by the loop is the C accumulator, loaded
+    // before and stored to the same tile after the loop.
+    auto mma = yield->getOperand(i).getDefiningOp<xetile::TileMMAOp>();
+    auto load = loop.getInitArgs()[i].getDefiningOp<xetile::LoadTileOp>();
+    auto res = loop.getResult(i);
+    auto store = res.hasOneUse()
+                     ? dyn_cast<xetile::StoreTileOp>(*res.getUsers().begin())
+                     : nullptr;
+    if (result.accLoad || !mma || mma.getC() != arg || !arg.hasOneUse() ||
+        !load || !load->hasOneUse() || !store ||
+        store.getTile() != load.getSource() ||
+        !isa<FloatType>(mma.getResult().getType().getElementType()))
+      return std::nullopt;
+    result.accIndex = i;
+    result.accLoad = load;
+    result.accStore = store;
+  }
+  if (!result.accLoad)
+    return std::nullopt;
+  return result;
+}
+
+// Rewrites \p kLoop to process the chunk of \p numSplits selected by the z
+// index of the workgroup, and to atomically add its partial result to C.
+static void splitK(SplitKLoop &kLoop, int64_t numSplits) {
+  auto loop = kLoop.loop;
+  auto loc = loop.getLoc();
+  int64_t lb = *getConstantIntValue(loop.getLowerBound());
+  int64_t step = *getConstantIntValue(loop.getStep());
+  int64_t chunk = kLoop.tripCount / numSplits;
+
+  OpBuilder builder(loop);
+  auto createIndexConstant = [&](int64_t value) {
+    return builder.create<arith::ConstantIndexOp>(loc, value);
+  };
+  auto blockIdZ = builder.create<gpu::BlockIdOp>(loc, gpu::Dimension::z);
+  Value skipped = builder.create<arith::MulIOp>(loc, blockIdZ,
+                                                createIndexConstant(chunk));
+
+  // Advance the tiles to the first iteration of the chunk.
+  for (auto [i, arg] : llvm::enumerate(loop.getRegionIterArgs())) {
+    if (i == kLoop.accIndex)
+      continue;
+    auto update = getTileUpdate(loop, arg);
+    auto offsetX =
+        builder.create<arith::MulIOp>(loc, update.getOffsetX(), skipped);
+    auto offsetY =
+        builder.create<arith::MulIOp>(loc, update.getOffsetY(), skipped);
+    auto init = builder.create<xetile::UpdateTileOffsetOp>(
+        loc, loop.getInitArgs()[i], offsetX, offsetY, nullptr);
+    loop.getInitArgsMutable()[i].set(init);
+  }
+
+  // Each split starts from zero. C is read by the atomic add instead.
+  auto accTy = cast<VectorType>(kLoop.accLoad.getType());
+  auto zeroAttr = builder.getZeroAttr(accTy.getElementType());
+  auto zero = builder.create<arith::ConstantOp>(
+      loc, accTy, DenseElementsAttr::get(accTy, zeroAttr));
+  if (auto wgMap = kLoop.accLoad.getSource().getType().getWgMap())
+    zero->setAttr("map", wgMap);
+  loop.getInitArgsMutable()[kLoop.accIndex].set(zero);
+  kLoop.accLoad->erase();
+
+  auto iv = loop.getInductionVar();
+  if (!iv.use_empty()) {
+    auto offset = builder.create<arith::MulIOp>(loc, skipped,
+                                                createIndexConstant(step));
+    OpBuilder bodyBuilder = OpBuilder::atBlockBegin(loop.getBody());
+    auto k = bodyBuilder.create<arith::AddIOp>(loc, iv, offset);
+    iv.replaceAllUsesExcept(k, k);
+  }
+  loop.setUpperBound(createIndexConstant(lb + chunk * step));
+
+  auto store = kLoop.accStore;
+  builder.setInsertionPoint(store);
+  builder.create<xetile::AtomicRMWOp>(store.getLoc(), accTy,
+                                      arith::AtomicRMWKind::addf,
+                                      store.getValue(), store.getTile());
+  store->erase();
+}
+
+class XeTileSplitKPass : public impl::XeTileSplitKBase<XeTileSplitKPass> {
+public:
+  using XeTileSplitKBase::XeTileSplitKBase;
+
+  void runOnOperation() override {
+    auto arch = getXeuArch(device);
+    if (!arch) {
+      getOperation().emitOpError("Invalid device: ") << device;
+      return signalPassFailure();
+    }
+
+    // Splitting changes the grid of the launch, so only kernels with a single
+    // launch are considered.
+    llvm::MapVector<Operation *, llvm::SmallVector<gpu::LaunchFuncOp>> launches;
+    getOperation().walk([&](gpu::LaunchFuncOp launch) {
+      if (auto func = SymbolTable::lookupNearestSymbolFrom<gpu::GPUFuncOp>(
+              launch, launch.getKernel()))
+        launches[func].push_back(launch);
+    });
+
+    for (auto &[op, funcLaunches] : launches) {
+      auto func = cast<gpu::GPUFuncOp>(op);
+      if (funcLaunches.size() != 1)
+        continue;
+      auto launch = funcLaunches[0];
+      auto gridZ = getConstantIntValue(launch.getGridSizeZ());
+      if (!gridZ || *gridZ != 1)
+        continue;
+
+      auto kLoop = getSplitKLoop(func);
+      if (!kLoop)
+        continue;
+
+      int64_t numSplits = getNumSplits(launch, *kLoop, *arch);
+      LLVM_DEBUG(llvm::dbgs() << "Splitting K of " << func.getName() << " in "
+                              << numSplits << "\n");
+      if (numSplits <= 1)
+        continue;
+
+      splitK(*kLoop, numSplits);
+
+      OpBuilder builder(launch);
+      launch.getGridSizeZMutable().assign(
+          builder.create<arith::ConstantIndexOp>(launch.getLoc(), numSplits));
+      if (auto known =
+              func->getAttrOfType<DenseI32ArrayAttr>("known_grid_size")) {
+        llvm::SmallVector<int32_t> gridSize(known.asArrayRef());
+        gridSize[2] = numSplits;
+        func->setAttr("known_grid_size",
+                      DenseI32ArrayAttr::get(&getContext(), gridSize));
+      }
+    }
+  }
+
+private:
+  // Returns the number of splits of the K-loop of the kernel launched by
+  // \p launch. Without an explicit split-k, kernels are split until their
+  // subgroups occupy every EU once, as long as each split keeps at least
+  // minItersPerSplit iterations.
+  int64_t getNumSplits(gpu::LaunchFuncOp launch, const SplitKLoop &kLoop,
+                       const XeuArchInterface &arch) {
+    auto tripCount = kLoop.tripCount;
+    if (splitK)
+      return tripCount % splitK == 0 ? splitK : 1;
+
+    int64_t numSubgroups = 1;
+    for (auto size : {launch.getGridSizeX(), launch.getGridSizeY(),
+                      launch.getBlockSizeX(), launch.getBlockSizeY(),
+                      launch.getBlockSizeZ()}) {
+      auto value = getConstantIntValue(size);
+      if (!value)
+        return 1;
+      numSubgroups *= *value;
+    }
+
+    int64_t numEUs = arch.getNumEUs();
+    int64_t numSplits = std::min((numEUs + numSubgroups - 1) / numSubgroups,
+                                 tripCount / minItersPerSplit);
+    while (numSplits > 1 && tripCount % numSplits)
+      --numSplits;
+    return numSplits;
+  }
+};
+
+} // namespace
+
+/// Create a pass
+std::unique_ptr<::mlir::Pass> createXeTileSplitKPass() {
+  return std::make_unique<XeTileSplitKPass>();
+}
+} // namespace imex
@@ -25,14 +25,17 @@
 #include <mlir/Dialect/Math/IR/Math.h>
 #include <mlir/Dialect/MemRef/IR/MemRef.h>
 #include <mlir/Dialect/SCF/IR/SCF.h>
+#include <mlir/Dialect/Vector/IR/VectorOps.h>
 #include <mlir/IR/BuiltinAttributes.h>
 #include <mlir/IR/BuiltinTypes.h>
 #include <mlir/IR/PatternMatch.h>
+#include <mlir/Interfaces/LoopLikeInterface.h>
 #include <mlir/Pass/Pass.h>
 #include <mlir/Support/LogicalResult.h>
 #include <mlir/Transforms/DialectConversion.h>
 #include <mlir/Transforms/GreedyPatternRewriteDriver.h>
 
+#include <llvm/ADT/MapVector.h>
 #include <llvm/ADT/SetVector.h>
 #include <llvm/Support/Debug.h>
 
@@ -352,6 +355,24 @@ class WGToSGStoreTileOpPattern : public OpConversionPattern<xetile::StoreTileOp>
   }
 };
 
+class WGToSGAtomicRMWOpPattern : public OpConversionPattern<xetile::AtomicRMWOp> {
+  using OpConversionPattern<xetile::AtomicRMWOp>::OpConversionPattern;
+
+  mlir::LogicalResult
+  matchAndRewrite(xetile::AtomicRMWOp op, OneToNOpAdaptor adaptor,
+                  ConversionPatternRewriter &rewriter) const override {
+
+    llvm::SmallVector<::mlir::Value> newOps;
+    for (auto [value, tile] : llvm::zip(adaptor.getValue(), adaptor.getTile())) {
+      auto newOp = rewriter.create<xetile::AtomicRMWOp>(
+          op.getLoc(), value.getType(), op.getKind(), value, tile);
+      newOps.push_back(newOp);
+    }
+    rewriter.replaceOpWithMultiple(op, {newOps});
+    return mlir::success();
+  }
+};
+
 class WGToSGStoreScatterOpPattern : public OpConversionPattern<xetile::StoreScatterOp> {
   using OpConversionPattern<xetile::StoreScatterOp>::OpConversionPattern;
 
@@ -585,6 +606,51 @@ public:
   }
 };
 
+// Estimated costs, in GRF moves, of the two ways to lower a convert_layout.
+// An SLM round-trip stores and loads every GRF and synchronizes the
+// workgroup twice, a register shuffle selects the result from every
+// candidate slice of the source.
+constexpr int64_t slmAccessCost = 4;
+constexpr int64_t slmBarrierCost = 64;
+constexpr int64_t registerSelectCost = 2;
+
+// Returns, for every subgroup, the offset of its result block in its source
+// block if every subgroup owns a single block of the source and of the result
+// and its result block is part of its source block, i.e. the layout can be
+// converted without exchanging data between subgroups.
+static std::optional<llvm::SmallVector<std::array<int64_t, 2>>>
+getLocalOffsets(llvm::ArrayRef<int64_t> shape, xetile::WorkGroupMapAttr src,
+                xetile::WorkGroupMapAttr dst) {
+  auto srcLayout = src.getSgLayout().asArrayRef();
+  auto srcData = src.getSgData().asArrayRef();
+  auto dstLayout = dst.getSgLayout().asArrayRef();
+  auto dstData = dst.getSgData().asArrayRef();
+  int64_t numSg = srcLayout[0] * srcLayout[1];
+  if (numSg != dstLayout[0] * dstLayout[1])
+    return std::nullopt;
+  for (int d = 0; d < 2; d++) {
+    if (shape[d] % srcData[d] || shape[d] % dstData[d] ||
+        srcLayout[d] * srcData[d] < shape[d] ||
+        dstLayout[d] * dstData[d] < shape[d])
+      return std::nullopt;
+  }
+
+  llvm::SmallVector<std::array<int64_t, 2>> offsets;
+  for (int64_t sg = 0; sg < numSg; sg++) {
+    std::array<int64_t, 2> offset;
+    for (int d = 0; d < 2; d++) {
+      auto srcId = d == 0 ? sg / srcLayout[1] : sg % srcLayout[1];
+      auto dstId = d == 0 ? sg / dstLayout[1] : sg % dstLayout[1];
+      offset[d] = (dstId * dstData[d]) % shape[d] -
+                  (srcId * srcData[d]) % shape[d];
+      if (offset[d] < 0 || offset[d] + dstData[d] > srcData[d])
+        return std::nullopt;
+    }
+    offsets.push_back(offset);
+  }
+  return offsets;
+}
+
 // This pattern transforms the convert layout op in the following manner:
 // 1. Store the original vector to slm using input operand layout
 // 2. Add barrier
@@ -607,6 +673,29 @@ public:
 // If the input value is defined by a transpose op, it also try to fold the transpose effect
 // into the store op to the slm using a transposed view.
 
+// When the source block of a subgroup is replicated in other subgroups, only
+// the first copy is stored.
+
+// If the result block of every subgroup is part of its own source block, the
+// layout can instead be converted in registers: the result is selected among
+// the distinct slices of the source the subgroups extract. This is used when
+// it is estimated cheaper than the SLM round-trip.
+
+// Example:
+// WG IR
+// #wg_map_b = #xetile.wg_map<sg_layout = [1, 4], sg_data = [32, 64]>
+// #wg_map_a = #xetile.wg_map<sg_layout = [4, 1], sg_data = [8, 64]>
+// %vector_a = xetile.convert_layout %vector_b {wg_map_result = #wg_map_a, wg_map_source = #wg_map_b}: vector<32x64xf32>
+
+// SG IR
+// %slice0 = vector.extract_strided_slice %vector_b {offsets = [0, 0], sizes = [8, 64], strides = [1, 1]} : vector<32x64xf32> to vector<8x64xf32>
+// ...
+// %slice3 = vector.extract_strided_slice %vector_b {offsets = [24, 0], sizes = [8, 64], strides = [1, 1]} : vector<32x64xf32> to vector<8x64xf32>
+// %is2 = arith.andi %offset_x_is_16, %offset_y_is_0 : i1
+// %sel2 = arith.select %is2, %slice2, %slice3 : vector<8x64xf32>
+// ...
+// %vector_a = arith.select %is0, %slice0, %sel1 : vector<8x64xf32>
+
 // Example:
 // WG IR
 // #wg_map_c = #xetile.wg_map<sg_layout = [4, 8], sg_data = [64, 32]>
@@ -687,18 +776,56 @@ class WGToSGXeTileConvertLayout
 
     rewriter.setInsertionPoint(op);
 
-    // Allocate SLM
     auto bitWidth = elemTy.getIntOrFloatBitWidth();
+    auto localOffsets =
+        isOneUseTranspose(defOp)
+            ? std::nullopt
+            : getLocalOffsets(resShape, srcMapAttr, dstMapAttr);
+    if (localOffsets) {
+      llvm::SmallVector<std::array<int64_t, 2>> candidates;
+      for (auto offset : *localOffsets) {
+        if (!llvm::is_contained(candidates, offset))
+          candidates.push_back(offset);
+      }
+
+      auto getNumGRFs = [&](xetile::WorkGroupMapAttr mapAttr) {
+        auto sgData = mapAttr.getSgData();
+        return llvm::divideCeil(sgData[0] * sgData[1] * bitWidth, 512);
+      };
+      int64_t srcGRFs = getNumGRFs(srcMapAttr);
+      int64_t dstGRFs = getNumGRFs(dstMapAttr);
+      int64_t registerCost = candidates.size() * dstGRFs * registerSelectCost;
+      int64_t slmCost = (srcGRFs + dstGRFs) * slmAccessCost + slmBarrierCost;
+      if (registerCost <= slmCost) {
+        convertInRegisters(op, adaptor.getSource(), candidates, srcMapAttr,
+                           dstMapAttr, rewriter);
+        return mlir::success();
+      }
+    }
+
+    // Allocate SLM once at the start of the kernel, not in every iteration
+    // of the loops around the op.
     auto flattenFactor = bitWidth / 8;
     auto slmSize = resType.getNumElements() * flattenFactor;
     auto slmTy = MemRefType::get(slmSize, rewriter.getI8Type(), {}, 3);
-    auto slm = rewriter.create<memref::AllocOp>(loc, slmTy);
+    mlir::Value slm;
+    {
+      mlir::OpBuilder::InsertionGuard guard(rewriter);
+      if (auto func = op->getParentOfType<mlir::gpu::GPUFuncOp>())
+        rewriter.setInsertionPointToStart(&func.getBody().front());
+      slm = rewriter.create<memref::AllocOp>(loc, slmTy);
+    }
     auto viewTy = MemRefType::get(resShape, elemTy, {}, 3);
     auto view = rewriter.create<memref::ViewOp>(loc, viewTy, slm, createIndexConstant(0), ValueRange());
 
     // Get SG id
     auto sgId = rewriter.create<mlir::gpu::SubgroupIdOp>(loc, rewriter.getIndexType(), nullptr);
 
+    // Wait for all threads to finish reading the SLM of the previous
+    // iteration before overwriting it, if no other barrier is in between.
+    if (op->hasAttr("slm_barrier"))
+      rewriter.create<mlir::gpu::BarrierOp>(loc);
+
     { // store to slm
       auto sgData = srcMapAttr.getSgData();
       auto sgLayout = srcMapAttr.getSgLayout();
@@ -720,8 +847,31 @@ class WGToSGXeTileConvertLayout
       auto attr = imex::xetile::XeTileAttr::get(ctx, nullptr /*sgMap*/, nullptr /*wgMap*/, order, slmScopeAttr, nullptr /*scatterAttr*/);
       auto tileTy = imex::xetile::TileType::get({sgData[0], sgData[1]}, elemTy, attr);
 
+      // Only the first copy of a replicated source block is stored.
+      mlir::scf::IfOp ifOp;
+      if (!isOneUseTranspose(defOp) &&
+          (sgLayout[0] * sgData[0] > resShape[0] ||
+           sgLayout[1] * sgData[1] > resShape[1])) {
+        auto dimY = createIndexConstant(sgLayout[1]);
+        auto sgIdX = rewriter.create<mlir::index::DivUOp>(loc, sgId, dimY);
+        auto sgIdY = rewriter.create<mlir::index::RemUOp>(loc, sgId, dimY);
+        auto isFirstX = rewriter.create<mlir::arith::CmpIOp>(
+            loc, mlir::arith::CmpIPredicate::ult, sgIdX,
+            createIndexConstant(resShape[0] / sgData[0]));
+        auto isFirstY = rewriter.create<mlir::arith::CmpIOp>(
+            loc, mlir::arith::CmpIPredicate::ult, sgIdY,
+            createIndexConstant(resShape[1] / sgData[1]));
+        auto isFirst =
+            rewriter.create<mlir::arith::AndIOp>(loc, isFirstX, isFirstY);
+        ifOp = rewriter.create<mlir::scf::IfOp>(loc, isFirst,
+                                                /*withElseRegion=*/false);
+        rewriter.setInsertionPointToStart(&ifOp.getThenRegion().front());
+      }
+
       auto tile = rewriter.create<xetile::InitTileOp>(loc, tileTy, stView, llvm::ArrayRef<mlir::OpFoldResult>({offsetX, offsetY}));
       rewriter.create<xetile::StoreTileOp>(loc, data, tile, nullptr, nullptr, nullptr);
+      if (ifOp)
+        rewriter.setInsertionPointAfter(ifOp);
     }
 
     // Add barrier to wait for all threads to finish writing to SLM
@@ -751,6 +901,66 @@ class WGToSGXeTileConvertLayout
 
     return mlir::success();
   }
+
+private:
+  // Replaces \p op by the slice of \p source at the local offset of the
+  // subgroup, selected among \p candidates.
+  void convertInRegisters(xetile::ConvertLayoutOp op, mlir::Value source,
+                          llvm::ArrayRef<std::array<int64_t, 2>> candidates,
+                          xetile::WorkGroupMapAttr srcMapAttr,
+                          xetile::WorkGroupMapAttr dstMapAttr,
+                          ConversionPatternRewriter &rewriter) const {
+    auto loc = op.getLoc();
+    auto shape = op.getResult().getType().getShape();
+    auto createIndexConstant = [&](int64_t value) {
+      return rewriter.create<mlir::arith::ConstantIndexOp>(loc, value);
+    };
+
+    // Origin of the block of the subgroup in the workgroup vector.
+    auto sgId = rewriter.create<mlir::gpu::SubgroupIdOp>(
+        loc, rewriter.getIndexType(), nullptr);
+    auto getOrigin = [&](xetile::WorkGroupMapAttr mapAttr, int dim) {
+      auto sgLayout = mapAttr.getSgLayout();
+      auto sgData = mapAttr.getSgData();
+      auto dimY = createIndexConstant(sgLayout[1]);
+      mlir::Value id;
+      if (dim == 0)
+        id = rewriter.createOrFold<mlir::index::DivUOp>(loc, sgId, dimY);
+      else
+        id = rewriter.createOrFold<mlir::index::RemUOp>(loc, sgId, dimY);
+      auto offset = rewriter.createOrFold<mlir::index::MulOp>(
+          loc, id, createIndexConstant(sgData[dim]));
+      return rewriter.createOrFold<mlir::index::RemUOp>(
+          loc, offset, createIndexConstant(shape[dim]));
+    };
+    mlir::Value localOffset[2];
+    for (int d = 0; d < 2; d++)
+      localOffset[d] = rewriter.createOrFold<mlir::index::SubOp>(
+          loc, getOrigin(dstMapAttr, d), getOrigin(srcMapAttr, d));
+
+    auto sgData = dstMapAttr.getSgData();
+    mlir::Value result;
+    for (auto offset : llvm::reverse(candidates)) {
+      mlir::Value slice = rewriter.create<mlir::vector::ExtractStridedSliceOp>(
+          loc, source, llvm::ArrayRef<int64_t>{offset[0], offset[1]},
+          llvm::ArrayRef<int64_t>{sgData[0], sgData[1]},
+          llvm::ArrayRef<int64_t>{1, 1});
+      if (!result) {
+        result = slice;
+        continue;
+      }
+      auto isX = rewriter.create<mlir::arith::CmpIOp>(
+          loc, mlir::arith::CmpIPredicate::eq, localOffset[0],
+          createIndexConstant(offset[0]));
+      auto isY = rewriter.create<mlir::arith::CmpIOp>(
+          loc, mlir::arith::CmpIPredicate::eq, localOffset[1],
+          createIndexConstant(offset[1]));
+      auto isOffset = rewriter.create<mlir::arith::AndIOp>(loc, isX, isY);
+      result =
+          rewriter.create<mlir::arith::SelectOp>(loc, isOffset, slice, result);
+    }
+    rewriter.replaceOp(op, result);
+  }
 };
 
 class WGToSGVectorBroadcast
@@ -812,6 +1022,191 @@ class WGToSGPrefetchOpPattern : public OpConversionPattern<xetile::PrefetchTileO
   }
 };
 
+// Returns the wg_map of the workgroup level value \p val, from the tile of
+// its load or the map attribute of its defining op.
+static xetile::WorkGroupMapAttr getValueWgMap(mlir::Value val) {
+  auto defOp = val.getDefiningOp();
+  if (!defOp)
+    return nullptr;
+  if (auto load = mlir::dyn_cast<xetile::LoadTileOp>(defOp))
+    return load.getSource().getType().getWgMap();
+  return defOp->getAttrOfType<xetile::WorkGroupMapAttr>("map");
+}
+
+// Returns the identity of the combining \p kind for vectors of type \p type.
+static mlir::Value getReductionIdentity(mlir::vector::CombiningKind kind,
+                                        mlir::VectorType type,
+                                        mlir::OpBuilder &builder,
+                                        mlir::Location loc) {
+  using mlir::arith::AtomicRMWKind;
+  using mlir::vector::CombiningKind;
+  bool isFloat = mlir::isa<mlir::FloatType>(type.getElementType());
+  AtomicRMWKind rmwKind = AtomicRMWKind::addf;
+  switch (kind) {
+  case CombiningKind::ADD:
+    rmwKind = isFloat ? AtomicRMWKind::addf : AtomicRMWKind::addi;
+    break;
+  case CombiningKind::MUL:
+    rmwKind = isFloat ? AtomicRMWKind::mulf : AtomicRMWKind::muli;
+    break;
+  case CombiningKind::MINUI:
+    rmwKind = AtomicRMWKind::minu;
+    break;
+  case CombiningKind::MINSI:
+    rmwKind = AtomicRMWKind::mins;
+    break;
+  case CombiningKind::MAXUI:
+    rmwKind = AtomicRMWKind::maxu;
+    break;
+  case CombiningKind::MAXSI:
+    rmwKind = AtomicRMWKind::maxs;
+    break;
+  case CombiningKind::AND:
+    rmwKind = AtomicRMWKind::andi;
+    break;
+  // Zero is the identity of both.
+  case CombiningKind::OR:
+  case CombiningKind::XOR:
+    rmwKind = AtomicRMWKind::ori;
+    break;
+  case CombiningKind::MINNUMF:
+    rmwKind = AtomicRMWKind::minnumf;
+    break;
+  case CombiningKind::MAXNUMF:
+    rmwKind = AtomicRMWKind::maxnumf;
+    break;
+  case CombiningKind::MINIMUMF:
+    rmwKind = AtomicRMWKind::minimumf;
+    break;
+  case CombiningKind::MAXIMUMF:
+    rmwKind = AtomicRMWKind::maximumf;
+    break;
+  }
+  auto identity = mlir::arith::getIdentityValueAttr(
+      rmwKind, type.getElementType(), builder, loc);
+  return builder.create<mlir::arith::ConstantOp>(
+      loc, mlir::DenseElementsAttr::get(type, identity));
+}
+
+// Reduces \p src, the block of a subgroup of a 2D workgroup vector with
+// wg_map \p mapAttr, along \p dim across the subgroups sharing the dimension.
+// The partial results of the subgroups are combined through SLM in
+// log2(sg_layout[dim]) steps, each followed by a barrier:
+//   partial[i] = reduce(block[i])
+//   for (s = 1; s < n; s *= 2)
+//     if (i % (2 * s) == 0 && i + s < n)
+//       partial[i] = combine(partial[i], partial[i + s])
+//   result = combine(partial[0], acc)
+// Every subgroup gets the result for the columns (rows when reducing dim 1)
+// of its block.
+static mlir::Value
+reduceAcrossSubgroups(mlir::vector::MultiDimReductionOp op, mlir::Value src,
+                      mlir::Value acc, int64_t dim,
+                      xetile::WorkGroupMapAttr mapAttr,
+                      ConversionPatternRewriter &rewriter) {
+  auto loc = op.getLoc();
+  auto ctx = op.getContext();
+  auto kind = op.getKind();
+  auto elemTy = mlir::cast<mlir::VectorType>(src.getType()).getElementType();
+  auto sgLayout = mapAttr.getSgLayout();
+  auto sgData = mapAttr.getSgData();
+  int64_t numSg = sgLayout[dim];
+  int64_t len = sgData[1 - dim];
+  int64_t width = sgLayout[1 - dim] * len;
+  auto partialTy = mlir::VectorType::get(len, elemTy);
+  auto rowTy = mlir::VectorType::get({1, len}, elemTy);
+
+  auto createIndexConstant = [&](int64_t value) {
+    return rewriter.create<mlir::arith::ConstantIndexOp>(loc, value);
+  };
+
+  // Reduce the block of the subgroup.
+  auto identity = getReductionIdentity(kind, partialTy, rewriter, loc);
+  mlir::Value partial = rewriter.create<mlir::vector::MultiDimReductionOp>(
+      loc, partialTy, kind, src, identity, llvm::ArrayRef<int64_t>{dim});
+
+  // SLM holds one row of partial results per subgroup along dim.
+  auto bitWidth = elemTy.getIntOrFloatBitWidth();
+  auto slmTy = mlir::MemRefType::get(numSg * width * bitWidth / 8,
+                                     rewriter.getI8Type(), {}, 3);
+  auto slm = rewriter.create<mlir::memref::AllocOp>(loc, slmTy);
+  auto viewTy = mlir::MemRefType::get({numSg, width}, elemTy, {}, 3);
+  auto view = rewriter.create<mlir::memref::ViewOp>(
+      loc, viewTy, slm, createIndexConstant(0), mlir::ValueRange());
+
+  auto sgId = rewriter.create<mlir::gpu::SubgroupIdOp>(
+      loc, rewriter.getIndexType(), nullptr);
+  auto dimY = createIndexConstant(sgLayout[1]);
+  mlir::Value sgIdX = rewriter.create<mlir::index::DivUOp>(loc, sgId, dimY);
+  mlir::Value sgIdY = rewriter.create<mlir::index::RemUOp>(loc, sgId, dimY);
+  auto idx = dim == 0 ? sgIdX : sgIdY;
+  auto col = rewriter.createOrFold<mlir::index::MulOp>(
+      loc, dim == 0 ? sgIdY : sgIdX, createIndexConstant(len));
+
+  auto order = rewriter.getDenseI32ArrayAttr({1, 0});
+  auto attr = xetile::XeTileAttr::get(ctx, nullptr /*sgMap*/,
+                                      nullptr /*wgMap*/, order,
+                                      rewriter.getI32IntegerAttr(3),
+                                      nullptr /*scatterAttr*/);
+  auto tileTy = xetile::TileType::get({1, len}, elemTy, attr);
+  auto initRowTile = [&](mlir::Value row) {
+    return rewriter.create<xetile::InitTileOp>(
+        loc, tileTy, view, llvm::ArrayRef<mlir::OpFoldResult>({row, col}));
+  };
+  auto storeRow = [&](mlir::Value vec) {
+    auto row = rewriter.create<mlir::vector::ShapeCastOp>(loc, rowTy, vec);
+    rewriter.create<xetile::StoreTileOp>(loc, row, initRowTile(idx), nullptr,
+                                         nullptr, nullptr);
+  };
+  auto loadRow = [&](mlir::Value row) {
+    auto ld = rewriter.create<xetile::LoadTileOp>(
+        loc, rowTy, initRowTile(row), mlir::Attribute(), nullptr, nullptr,
+        nullptr);
+    return rewriter.create<mlir::vector::ShapeCastOp>(loc, partialTy, ld);
+  };
+
+  // In a loop, wait for all threads to finish reading the SLM of the
+  // previous iteration before overwriting it.
+  if (op->getParentOfType<mlir::LoopLikeOpInterface>())
+    rewriter.create<mlir::gpu::BarrierOp>(loc);
+  storeRow(partial);
+
+  for (int64_t s = 1; s < numSg; s *= 2) {
+    rewriter.create<mlir::gpu::BarrierOp>(loc);
+    auto rem = rewriter.create<mlir::index::RemUOp>(
+        loc, idx, createIndexConstant(2 * s));
+    auto isAligned = rewriter.create<mlir::arith::CmpIOp>(
+        loc, mlir::arith::CmpIPredicate::eq, rem, createIndexConstant(0));
+    auto hasPeer = rewriter.create<mlir::arith::CmpIOp>(
+        loc, mlir::arith::CmpIPredicate::ult, idx,
+        createIndexConstant(numSg - s));
+    auto isReceiver =
+        rewriter.create<mlir::arith::AndIOp>(loc, isAligned, hasPeer);
+    auto ifOp = rewriter.create<mlir::scf::IfOp>(
+        loc, mlir::TypeRange{partialTy}, isReceiver, /*withElseRegion=*/true);
+
+    rewriter.setInsertionPointToStart(ifOp.thenBlock());
+    auto peer = rewriter.create<mlir::index::AddOp>(loc, idx,
+                                                    createIndexConstant(s));
+    auto combined =
+        mlir::vector::makeArithReduction(rewriter, loc, kind, partial,
+                                         loadRow(peer));
+    storeRow(combined);
+    rewriter.create<mlir::scf::YieldOp>(loc, combined);
+
+    rewriter.setInsertionPointToStart(ifOp.elseBlock());
+    rewriter.create<mlir::scf::YieldOp>(loc, partial);
+
+    rewriter.setInsertionPointAfter(ifOp);
+    partial = ifOp.getResult(0);
+  }
+
+  // Every subgroup reads the total from the row of the first one.
+  rewriter.create<mlir::gpu::BarrierOp>(loc);
+  auto total = loadRow(createIndexConstant(0));
+  return mlir::vector::makeArithReduction(rewriter, loc, kind, total, acc);
+}
+
 class WGToSGVectorMultiDimReductionOp
     : public OpConversionPattern<mlir::vector::MultiDimReductionOp> {
   using OpConversionPattern<mlir::vector::MultiDimReductionOp>::OpConversionPattern;
@@ -868,6 +1263,22 @@ class WGToSGVectorMultiDimReductionOp
         return mlir::failure();
 
       bool reduceDim = reductionDims[0];
+
+      // The reduced dimension is distributed over several subgroups.
+      auto srcMapAttr = getValueWgMap(op.getSource());
+      if (srcMapAttr && srcMapAttr.getSgLayout()[reduceDim] > 1) {
+        auto shape = op.getSourceVectorType().getShape();
+        for (int d = 0; d < 2; d++) {
+          if (srcMapAttr.getSgLayout()[d] * srcMapAttr.getSgData()[d] !=
+              shape[d])
+            return mlir::failure();
+        }
+        rewriter.replaceOp(op, reduceAcrossSubgroups(
+                                   op, adaptor.getSource(), adaptor.getAcc(),
+                                   reduceDim, srcMapAttr, rewriter));
+        return mlir::success();
+      }
+
       auto outputShape =
           reduceDim == 0 ? srcType.getDimSize(1) : srcType.getDimSize(0);
 
@@ -1271,6 +1682,7 @@ void populateXeTileWgToSgPatterns(mlir::RewritePatternSet &patterns,
                   WGToSGArithSelectOpPattern, WGToSGMathFPowIOpPattern,
                   WGToSGVectorShapeCast, WGToSGVectorMultiDimReductionOp,
                   WGToSGLoadGatherOpPattern, WGToSGStoreScatterOpPattern,
+                  WGToSGAtomicRMWOpPattern,
                   WGToSGVectorCreateMask
                   >(patterns.getContext());
   patterns.insert<WGToSGElementWiseOpSameArgAndResultTypePattern<mlir::math::ExpOp, 1>,
@@ -1293,6 +1705,147 @@ void populateXeTileWgToSgPatterns(mlir::RewritePatternSet &patterns,
                   WGToSGArithConstantOpPattern>(patterns.getContext());
 }
 
+// Returns a wg_map distributing a tile of \p shape over \p numSg subgroups
+// without replication, or null if there is none. Each subgroup gets a block
+// of whole rows where possible, which keeps the cooperative loads contiguous.
+static xetile::WorkGroupMapAttr
+getCooperativeWgMap(mlir::MLIRContext *ctx, llvm::ArrayRef<int64_t> shape,
+                    int64_t numSg) {
+  for (int64_t cols = 1; cols <= numSg; ++cols) {
+    auto rows = numSg / cols;
+    if (numSg % cols || shape[0] % rows || shape[1] % cols)
+      continue;
+    return xetile::WorkGroupMapAttr::get(
+        ctx, {static_cast<int32_t>(rows), static_cast<int32_t>(cols)},
+        {static_cast<int32_t>(shape[0] / rows),
+         static_cast<int32_t>(shape[1] / cols)});
+  }
+  return nullptr;
+}
+
+// Collects the tiles derived from \p init through update_tile_offset and
+// scf.for iter_args, and the loads of them. Fails if one of them has a use
+// that the re-distribution of the tile does not support.
+static mlir::LogicalResult
+getTileChain(xetile::InitTileOp init, llvm::SetVector<mlir::Value> &chain,
+             llvm::SmallVectorImpl<xetile::LoadTileOp> &loads) {
+  llvm::SmallVector<mlir::Value> worklist = {init.getResult()};
+  auto push = [&](mlir::Value val) {
+    if (chain.insert(val))
+      worklist.push_back(val);
+  };
+  chain.insert(init.getResult());
+  while (!worklist.empty()) {
+    auto val = worklist.pop_back_val();
+    for (auto &use : val.getUses()) {
+      auto user = use.getOwner();
+      if (auto load = mlir::dyn_cast<xetile::LoadTileOp>(user)) {
+        loads.push_back(load);
+      } else if (auto update =
+                     mlir::dyn_cast<xetile::UpdateTileOffsetOp>(user)) {
+        push(update.getResult());
+      } else if (auto forOp = mlir::dyn_cast<mlir::scf::ForOp>(user)) {
+        push(forOp.getTiedLoopRegionIterArg(&use));
+        push(forOp.getTiedLoopResult(&use));
+      } else if (auto yield = mlir::dyn_cast<mlir::scf::YieldOp>(user)) {
+        auto forOp = mlir::dyn_cast<mlir::scf::ForOp>(yield->getParentOp());
+        if (!forOp)
+          return mlir::failure();
+        push(forOp.getRegionIterArgs()[use.getOperandNumber()]);
+        push(forOp.getResult(use.getOperandNumber()));
+      } else if (!mlir::isa<xetile::PrefetchTileOp>(user)) {
+        return mlir::failure();
+      }
+    }
+  }
+
+  // All values carried by a loop must be part of the chain.
+  for (auto val : chain) {
+    auto arg = mlir::dyn_cast<mlir::BlockArgument>(val);
+    if (!arg)
+      continue;
+    auto forOp = mlir::cast<mlir::scf::ForOp>(arg.getOwner()->getParentOp());
+    auto yield = forOp.getBody()->getTerminator();
+    auto index = arg.getArgNumber() - forOp.getNumInductionVars();
+    if (!chain.contains(forOp.getInitArgs()[index]) ||
+        !chain.contains(yield->getOperand(index)))
+      return mlir::failure();
+  }
+  return mlir::success();
+}
+
+// Stages the operands that are shared by several subgroups in SLM. A global
+// tile whose wg_map replicates data over subgroups (e.g. the A operand of a
+// GEMM, shared by all subgroups of a row of the C tile) is loaded once per
+// workgroup instead: the subgroups cooperatively load disjoint blocks of it
+// and redistribute them with a convert_layout to the original wg_map, which
+// is lowered to a store to SLM, a barrier and per-subgroup loads from SLM.
+// The SLM buffer of a staged load in a loop is overwritten in the next
+// iteration. If the loop stages several loads, the barrier after the store
+// of each one also waits for the reads of the others, otherwise the
+// convert_layout gets an slm_barrier attribute for a barrier before its
+// store.
+static void
+stageSharedLoadsInSLM(mlir::gpu::GPUModuleOp mod,
+                      llvm::DenseMap<mlir::Value, std::array<int, 2>> &sgLayoutMap) {
+  llvm::MapVector<mlir::Operation *,
+                  llvm::SmallVector<xetile::ConvertLayoutOp>>
+      loopConverts;
+  llvm::SmallVector<xetile::InitTileOp> inits;
+  mod.walk([&](xetile::InitTileOp init) { inits.push_back(init); });
+
+  for (auto init : inits) {
+    auto tileTy = init.getType();
+    auto wgMap = tileTy.getWgMap();
+    if (!wgMap || tileTy.getRank() != 2 || tileTy.getMemorySpaceAsInt() == 3 ||
+        tileTy.getOrder().asArrayRef() != llvm::ArrayRef<int32_t>({1, 0}) ||
+        (tileTy.getScatterAttr() && tileTy.getScatterAttr().getValue()) ||
+        sgLayoutMap.count(init.getResult()))
+      continue;
+
+    auto shape = tileTy.getShape();
+    auto sgLayout = wgMap.getSgLayout().asArrayRef();
+    auto sgData = wgMap.getSgData().asArrayRef();
+    if (shape[0] % sgData[0] || shape[1] % sgData[1])
+      continue;
+    int64_t numSg = sgLayout[0] * sgLayout[1];
+    int64_t numBlocks = (shape[0] / sgData[0]) * (shape[1] / sgData[1]);
+    if (numBlocks >= numSg)
+      continue;
+
+    auto ctx = init.getContext();
+    auto coopMap = getCooperativeWgMap(ctx, shape, numSg);
+    llvm::SetVector<mlir::Value> chain;
+    llvm::SmallVector<xetile::LoadTileOp> loads;
+    if (!coopMap || mlir::failed(getTileChain(init, chain, loads)) ||
+        loads.empty())
+      continue;
+
+    auto attr = xetile::XeTileAttr::get(
+        ctx, tileTy.getSgMap(), coopMap, tileTy.getOrder(),
+        tileTy.getMemorySpace(), tileTy.getScatterAttr());
+    auto coopTy = xetile::TileType::get(shape, tileTy.getElementType(), attr);
+    for (auto val : chain)
+      val.setType(coopTy);
+
+    for (auto load : loads) {
+      mlir::OpBuilder builder(load->getContext());
+      builder.setInsertionPointAfter(load);
+      auto convert = builder.create<xetile::ConvertLayoutOp>(
+          load.getLoc(), load.getType(), load.getValue(), wgMap, coopMap);
+      load.getValue().replaceAllUsesExcept(convert, convert);
+      if (auto loop = convert->getParentOfType<mlir::LoopLikeOpInterface>())
+        loopConverts[loop].push_back(convert);
+    }
+  }
+
+  for (auto &[loop, converts] : loopConverts) {
+    if (converts.size() == 1)
+      converts.front()->setAttr("slm_barrier",
+                                mlir::UnitAttr::get(loop->getContext()));
+  }
+}
+
 // Transforms WG XeTile IR to SG XeTile
 class XeTileWgToSgPass
     : public impl::XeTileWgToSgBase<XeTileWgToSgPass> {
@@ -1331,6 +1884,8 @@ public:
     mlir::Operation *op = getOperation();
     // Run the analysis to find the candidates for the transformation
     analyzeTransposeOps(op, sgLayoutMap);
+    if (slmStaging)
+      stageSharedLoadsInSLM(mod, sgLayoutMap);
     mlir::ConversionTarget target(context);
     mlir::RewritePatternSet patterns(&context);
 
@@ -1384,6 +1939,14 @@ public:
             return false;
         });
 
+    target.addDynamicallyLegalOp<xetile::AtomicRMWOp>(
+        [&](xetile::AtomicRMWOp op) -> bool {
+          if (!op.getTile().getType().getWgMap())
+            return true;
+          else
+            return false;
+        });
+
     target.addDynamicallyLegalOp<xetile::UpdateTileOffsetOp>(
         [&](xetile::UpdateTileOffsetOp op) -> bool {
           if (!op.getType().getWgMap())
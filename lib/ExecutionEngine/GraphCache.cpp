@@ -0,0 +1,158 @@
+//===- GraphCache.cpp - Deferred execution of recorded graphs ---*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file implements the recording and the cache of graphs for the
+/// deferred execution mode. A graph is compiled from a copy of its module,
+/// since sessions lower their module in place.
+///
+//===----------------------------------------------------------------------===//
+
+#include "imex/ExecutionEngine/GraphCache.h"
+
+#include <imex/Dialect/NDArray/IR/NDArrayOps.h>
+
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/Support/raw_ostream.h>
+
+static bool isArray(mlir::Value value) {
+  return mlir::isa<imex::ndarray::NDArrayType>(value.getType());
+}
+
+std::string imex::getGraphKey(mlir::func::FuncOp func) {
+  std::string key;
+  llvm::raw_string_ostream os(key);
+  llvm::DenseMap<mlir::Value, unsigned> ids;
+  for (auto arg : func.getArguments()) {
+    ids.try_emplace(arg, ids.size());
+    os << arg.getType() << ",";
+  }
+  for (auto &op : func.getBody().front()) {
+    os << ";" << op.getName() << "(";
+    for (auto operand : op.getOperands())
+      os << ids.lookup(operand) << ",";
+    os << ")" << op.getAttrDictionary() << "->";
+    for (auto result : op.getResults()) {
+      ids.try_emplace(result, ids.size());
+      os << result.getType() << ",";
+    }
+    // Nested regions, e.g. of linalg.generic, are printed in full.
+    if (op.getNumRegions())
+      op.print(os, mlir::OpPrintingFlags().useLocalScope().enableDebugInfo(
+                       false));
+  }
+  return key;
+}
+
+llvm::Expected<imex::CompiledGraph>
+imex::GraphCache::getOrCompile(const std::string &key, mlir::ModuleOp module,
+                               llvm::StringRef name) {
+  std::shared_ptr<Entry> entry;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(key);
+    if (it == entries_.end()) {
+      lru_.push_front(key);
+      it = entries_
+               .emplace(key, std::make_pair(std::make_shared<Entry>(),
+                                            lru_.begin()))
+               .first;
+    } else {
+      lru_.splice(lru_.begin(), lru_, it->second.second);
+    }
+    entry = it->second.first;
+    // Evicted sessions live on in the graphs returned for them.
+    while (maxGraphs_ && entries_.size() > maxGraphs_) {
+      entries_.erase(lru_.back());
+      lru_.pop_back();
+    }
+  }
+
+  // Only requests for the same graph wait for its compilation.
+  std::lock_guard<std::mutex> entryLock(entry->mutex);
+  if (!entry->session) {
+    mlir::OwningOpRef<mlir::ModuleOp> copy = module.clone();
+    auto created = Session::create(*copy, options_);
+    if (!created) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = entries_.find(key);
+      if (it != entries_.end() && it->second.first == entry) {
+        lru_.erase(it->second.second);
+        entries_.erase(it);
+      }
+      return created.takeError();
+    }
+    entry->session = std::move(*created);
+  }
+  auto fn = entry->session->lookup(name);
+  if (!fn)
+    return fn.takeError();
+  return CompiledGraph{entry->session, *fn};
+}
+
+size_t imex::GraphCache::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+imex::GraphRecorder::GraphRecorder(mlir::MLIRContext &context,
+                                   GraphCache &cache)
+    : context_(context), cache_(cache), builder_(&context, this) {
+  context.getOrLoadDialect<mlir::func::FuncDialect>();
+  context.getOrLoadDialect<imex::ndarray::NDArrayDialect>();
+  reset();
+}
+
+mlir::Value imex::GraphRecorder::addInput(mlir::Type type) {
+  auto index = func_.getNumArguments();
+  func_.insertArgument(index, type, {}, builder_.getUnknownLoc());
+  return func_.getArgument(index);
+}
+
+void imex::GraphRecorder::notifyOperationInserted(
+    mlir::Operation *op, mlir::OpBuilder::InsertPoint) {
+  bool readsArray = llvm::any_of(op->getOperands(), isArray);
+  for (auto result : op->getResults()) {
+    if (isArray(result))
+      liveArrays_.insert(result);
+    else if (readsArray)
+      hostVisible_.insert(result);
+  }
+}
+
+llvm::SmallVector<mlir::Value> imex::GraphRecorder::getResults() const {
+  llvm::SmallVector<mlir::Value> results(hostVisible_.begin(),
+                                         hostVisible_.end());
+  for (auto array : liveArrays_)
+    if (!hostVisible_.contains(array))
+      results.push_back(array);
+  return results;
+}
+
+llvm::Expected<imex::CompiledGraph> imex::GraphRecorder::flush() {
+  auto results = getResults();
+  auto loc = builder_.getUnknownLoc();
+  builder_.create<mlir::func::ReturnOp>(loc, results);
+  func_.setFunctionType(builder_.getFunctionType(
+      func_.getArgumentTypes(), mlir::ValueRange(results).getTypes()));
+  auto fn = cache_.getOrCompile(getGraphKey(func_), *module_, functionName);
+  reset();
+  return fn;
+}
+
+void imex::GraphRecorder::reset() {
+  hostVisible_.clear();
+  liveArrays_.clear();
+  auto loc = mlir::UnknownLoc::get(&context_);
+  module_ = mlir::ModuleOp::create(loc);
+  builder_.setInsertionPointToEnd(module_->getBody());
+  func_ = builder_.create<mlir::func::FuncOp>(
+      loc, functionName, builder_.getFunctionType({}, {}));
+  builder_.setInsertionPointToEnd(func_.addEntryBlock());
+}
@@ -13,11 +13,29 @@
 //===----------------------------------------------------------------------===//
 
 #include "imex/ExecutionEngine/ImexRunnerUtils.h"
+#include "imex/ExecutionEngine/RandomFill.h"
+#include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <cstdlib>
 #include <cstring>
+#include <fstream>
 #include <iostream>
 #include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#endif
 
 // NOLINTBEGIN(*-identifier-naming)
 
@@ -37,13 +55,8 @@ void _mlir_ciface_fillResource1DRandom(UnrankedMemRefType<T> *ptr,
                                        const float lower, const float upper,
                                        const bool genInt) {
   std::random_device rd;
-  std::mt19937 gen(rd());
-  std::uniform_real_distribution<> dist(lower, upper);
-
-  DynamicMemRefType<T> Dptr = DynamicMemRefType<T>(*ptr);
-  for (DynamicMemRefIterator<T> i = Dptr.begin(); i != Dptr.end(); ++i) {
-    *i = T(genInt ? static_cast<int>(dist(gen)) : dist(gen));
-  }
+  int64_t seed = (static_cast<int64_t>(rd()) << 32) | rd();
+  _mlir_ciface_fillResourceRandom(ptr, lower, upper, genInt, seed);
 }
 
 template <typename T> void _mlir_ciface_printMemref(UnrankedMemRefType<T> *M) {
@@ -95,6 +108,27 @@ _mlir_ciface_fillResource1DRandomF32(UnrankedMemRefType<float> *ptr,
   _mlir_ciface_fillResource1DRandom(ptr, lower, upper, genInt);
 }
 
+/// Fills the given bf16 memref of any rank with values computed from seed.
+extern "C" void _mlir_ciface_fillResourceRandomBF16(
+    UnrankedMemRefType<bf16> *ptr, const float lower, const float upper,
+    const bool genInt, const int64_t seed) {
+  _mlir_ciface_fillResourceRandom(ptr, lower, upper, genInt, seed);
+}
+
+/// Fills the given f16 memref of any rank with values computed from seed.
+extern "C" void _mlir_ciface_fillResourceRandomF16(
+    UnrankedMemRefType<f16> *ptr, const float lower, const float upper,
+    const bool genInt, const int64_t seed) {
+  _mlir_ciface_fillResourceRandom(ptr, lower, upper, genInt, seed);
+}
+
+/// Fills the given f32 memref of any rank with values computed from seed.
+extern "C" void _mlir_ciface_fillResourceRandomF32(
+    UnrankedMemRefType<float> *ptr, const float lower, const float upper,
+    const bool genInt, const int64_t seed) {
+  _mlir_ciface_fillResourceRandom(ptr, lower, upper, genInt, seed);
+}
+
 extern "C" void _mlir_ciface_printMemrefBF16(UnrankedMemRefType<bf16> *M) {
   _mlir_ciface_printMemref(M);
 }
@@ -165,78 +199,473 @@ static float bfloat2float(uint16_t bfloatBits) {
   return floatBits.f;
 }
 
-template <typename T> float getFloat(T val) {
+// Number of elements converted to float at a time.
+constexpr int64_t kBlockSize = 256;
+// Minimum number of elements per thread of a check.
+constexpr int64_t kMinChunkSize = int64_t(1) << 16;
+
+static void toFloat(const float *src, int64_t n, float *dst) {
+  std::copy(src, src + n, dst);
+}
+
+static void toFloat(const bf16 *src, int64_t n, float *dst) {
+  // A plain shift, which the compiler vectorizes.
+  for (int64_t i = 0; i < n; ++i)
+    dst[i] = bfloat2float(src[i].bits);
+}
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+__attribute__((target("f16c"))) static void
+toFloatF16C(const f16 *src, int64_t n, float *dst) {
+  int64_t i = 0;
+  for (; i + 8 <= n; i += 8)
+    _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(_mm_loadu_si128(
+                                  reinterpret_cast<const __m128i *>(src + i))));
+  for (; i < n; ++i)
+    dst[i] = half2float(src[i].bits);
+}
+
+static const bool hasF16C = __builtin_cpu_supports("f16c");
+#endif
+
+static void toFloat(const f16 *src, int64_t n, float *dst) {
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+  if (hasF16C)
+    return toFloatF16C(src, n, dst);
+#endif
+  for (int64_t i = 0; i < n; ++i)
+    dst[i] = half2float(src[i].bits);
+}
+
+// Returns the offset of element \p idx, in row-major order, of \p DM.
+template <typename T>
+static int64_t getElementOffset(const DynamicMemRefType<T> &DM, int64_t idx) {
+  int64_t offset = 0;
+  for (int64_t d = DM.rank - 1; d >= 0; --d) {
+    offset += idx % DM.sizes[d] * DM.strides[d];
+    idx /= DM.sizes[d];
+  }
+  return offset;
+}
+
+// Returns the number of elements of \p DM, and whether they are contiguous in
+// row-major order in \p contiguous.
+template <typename T>
+static int64_t getNumElements(const DynamicMemRefType<T> &DM,
+                              bool &contiguous) {
+  contiguous = true;
+  int64_t stride = 1;
+  for (int64_t d = DM.rank - 1; d >= 0; --d) {
+    if (DM.sizes[d] != 1 && DM.strides[d] != stride)
+      contiguous = false;
+    stride *= DM.sizes[d];
+  }
+  return stride;
+}
+
+namespace {
+
+// The elements of a strided memref in row-major order, converted to float a
+// block at a time. Contiguous memrefs are converted in place, the elements of
+// others are gathered first.
+template <typename T> class FloatView {
+public:
+  explicit FloatView(UnrankedMemRefType<T> *M)
+      : DM(*M), size(getNumElements(DM, contiguous)) {}
+
+  int64_t getSize() const { return size; }
+
+  // Converts the elements [begin, begin + n), n <= kBlockSize, into dst.
+  void load(int64_t begin, int64_t n, float *dst) const {
+    const T *base = DM.data + DM.offset;
+    if (contiguous)
+      return toFloat(base + begin, n, dst);
+    T block[kBlockSize];
+    for (int64_t i = 0; i < n; ++i)
+      block[i] = base[getElementOffset(DM, begin + i)];
+    toFloat(block, n, dst);
+  }
+
+private:
+  DynamicMemRefType<T> DM;
+  bool contiguous;
+  int64_t size;
+};
+
+struct Mismatch {
+  int64_t idx;
+  float actual, expected;
+};
+
+} // namespace
+
+template <typename T>
+void _mlir_ciface_fillResourceRandom(UnrankedMemRefType<T> *ptr,
+                                     const float lower, const float upper,
+                                     const bool genInt, const int64_t seed) {
   static_assert(std::is_same_v<T, bf16> || std::is_same_v<T, f16> ||
                 std::is_same_v<T, float>);
-  if constexpr (std::is_same_v<T, bf16>) {
-    return bfloat2float(val.bits);
-  } else if constexpr (std::is_same_v<T, f16>) {
-    return half2float(val.bits);
-  } else if constexpr (std::is_same_v<T, float>) {
-    return val;
+  auto type = std::is_same_v<T, bf16>  ? imex::RandomFillType::BF16
+              : std::is_same_v<T, f16> ? imex::RandomFillType::F16
+                                       : imex::RandomFillType::F32;
+  imex::RandomFillParams params{static_cast<uint64_t>(seed), lower, upper,
+                                genInt};
+  DynamicMemRefType<T> DM = DynamicMemRefType<T>(*ptr);
+  bool contiguous;
+  int64_t size = getNumElements(DM, contiguous);
+  T *base = DM.data + DM.offset;
+  if (contiguous)
+    return imex::fillRandomHost(base, type, size, params);
+  imex::parallelForRange(size, [&](uint64_t begin, uint64_t end) {
+    imex::generateRandomValues(
+        params, begin, end, [&](uint64_t idx, float value) {
+          imex::storeRandomValue(base, type, getElementOffset(DM, idx), value);
+        });
+  });
+}
+
+// Splits [0, size) into chunks of at least kMinChunkSize elements and calls
+// fn(chunk, begin, end) for each on its own thread. Returns the number of
+// chunks.
+template <typename Fn> static int64_t parallelForChunks(int64_t size, Fn fn) {
+  int64_t numChunks = std::max<int64_t>(
+      1, std::min<int64_t>(std::thread::hardware_concurrency(),
+                           size / kMinChunkSize));
+  int64_t chunkSize = (size + numChunks - 1) / numChunks;
+  std::vector<std::thread> threads;
+  for (int64_t c = 1; c < numChunks; ++c)
+    threads.emplace_back(fn, c, c * chunkSize,
+                         std::min(size, (c + 1) * chunkSize));
+  fn(0, 0, std::min(size, chunkSize));
+  for (auto &thread : threads)
+    thread.join();
+  return numChunks;
+}
+
+static float getEnvFloat(const char *name, float defaultValue) {
+  auto value = getenv(name);
+  return value ? std::strtof(value, nullptr) : defaultValue;
+}
+
+namespace {
+
+// A read-only view of the contents of a file, mapped where possible.
+class MappedFile {
+public:
+  explicit MappedFile(const std::string &path) {
+#ifndef _WIN32
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+      return;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+      void *mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (mapping != MAP_FAILED) {
+        madvise(mapping, st.st_size, MADV_SEQUENTIAL);
+        data = static_cast<const char *>(mapping);
+        size = st.st_size;
+      }
+    }
+    close(fd);
+#else
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+      return;
+    buffer.assign(std::istreambuf_iterator<char>(file),
+                  std::istreambuf_iterator<char>());
+    data = buffer.data();
+    size = buffer.size();
+#endif
+  }
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  ~MappedFile() {
+#ifndef _WIN32
+    if (data)
+      munmap(const_cast<char *>(data), size);
+#endif
+  }
+
+  const char *data = nullptr;
+  size_t size = 0;
+
+private:
+#ifdef _WIN32
+  std::vector<char> buffer;
+#endif
+};
+
+} // namespace
+
+// Parses the header of the .npy file \p data of \p size bytes into \p descr,
+// \p fortranOrder and \p shape. Returns the offset of the elements, or 0 if
+// the header is malformed.
+static size_t parseNpyHeader(const char *data, size_t size, std::string &descr,
+                             bool &fortranOrder, std::vector<int64_t> &shape) {
+  // Magic, version, then the length of the header as 2 bytes in version 1
+  // and 4 bytes in later versions, little endian.
+  if (size < 10)
+    return 0;
+  size_t lenBytes = data[6] == 1 ? 2 : 4;
+  size_t headerLen = 0;
+  for (size_t i = 0; i < lenBytes; ++i)
+    headerLen |= static_cast<size_t>(static_cast<uint8_t>(data[8 + i]))
+                 << (8 * i);
+  size_t offset = 8 + lenBytes + headerLen;
+  if (offset > size)
+    return 0;
+  // A Python dict literal, e.g.
+  // {'descr': '<f4', 'fortran_order': False, 'shape': (2, 3), }
+  std::string header(data + 8 + lenBytes, headerLen);
+  auto getValue = [&](const char *key) -> const char * {
+    auto pos = header.find(std::string("'") + key + "':");
+    if (pos == std::string::npos)
+      return nullptr;
+    pos += strlen(key) + 3;
+    while (pos < header.size() && header[pos] == ' ')
+      ++pos;
+    return header.c_str() + pos;
+  };
+  auto descrValue = getValue("descr");
+  auto fortranValue = getValue("fortran_order");
+  auto shapeValue = getValue("shape");
+  if (!descrValue || !fortranValue || !shapeValue || *descrValue != '\'' ||
+      *shapeValue != '(')
+    return 0;
+  auto descrEnd = strchr(descrValue + 1, '\'');
+  if (!descrEnd)
+    return 0;
+  descr.assign(descrValue + 1, descrEnd);
+  fortranOrder = !strncmp(fortranValue, "True", 4);
+  shape.clear();
+  for (auto p = shapeValue + 1; *p && *p != ')';) {
+    char *end;
+    auto dim = std::strtoll(p, &end, 10);
+    if (end == p) {
+      ++p;
+      continue;
+    }
+    shape.push_back(dim);
+    p = end;
+  }
+  return offset;
+}
+
+// Fills \p M with the elements of the file named by the zero terminated \p P,
+// a .npy file with one of the dtypes \p npyDescrs or a raw file holding the
+// elements in row-major order.
+template <typename T>
+static void loadExternalData(UnrankedMemRefType<T> *M,
+                             UnrankedMemRefType<int8_t> *P,
+                             std::initializer_list<const char *> npyDescrs) {
+  DynamicMemRefType<int8_t> DP = DynamicMemRefType<int8_t>(*P);
+  std::string path(reinterpret_cast<const char *>(DP.data + DP.offset));
+  auto fail = [&](const std::string &message) {
+    std::cerr << "loadExternalData: " << path << ": " << message << '\n';
+    std::abort();
+  };
+
+  DynamicMemRefType<T> DM = DynamicMemRefType<T>(*M);
+  bool contiguous;
+  int64_t numElements = getNumElements(DM, contiguous);
+  MappedFile file(path);
+  if (!file.data)
+    fail("cannot read the file");
+  const char *elements = file.data;
+  size_t bytes = file.size;
+  if (bytes >= 6 && !memcmp(file.data, "\x93NUMPY", 6)) {
+    std::string descr;
+    bool fortranOrder;
+    std::vector<int64_t> shape;
+    auto offset =
+        parseNpyHeader(file.data, file.size, descr, fortranOrder, shape);
+    if (!offset)
+      fail("malformed .npy header");
+    if (std::find_if(npyDescrs.begin(), npyDescrs.end(), [&](auto d) {
+          return descr == d;
+        }) == npyDescrs.end())
+      fail("unexpected dtype " + descr);
+    if (fortranOrder)
+      fail("fortran order is not supported");
+    int64_t npyElements = 1;
+    for (auto dim : shape)
+      npyElements *= dim;
+    if (npyElements != numElements)
+      fail("expected " + std::to_string(numElements) + " elements, found " +
+           std::to_string(npyElements));
+    elements += offset;
+    bytes -= offset;
   }
+  if (bytes != numElements * sizeof(T))
+    fail("expected " + std::to_string(numElements * sizeof(T)) +
+         " bytes of elements, found " + std::to_string(bytes));
+
+  auto src = reinterpret_cast<const T *>(elements);
+  T *base = DM.data + DM.offset;
+  parallelForChunks(numElements, [&](int64_t, int64_t begin, int64_t end) {
+    if (contiguous) {
+      std::memcpy(base + begin, src + begin, (end - begin) * sizeof(T));
+      return;
+    }
+    for (int64_t i = begin; i < end; ++i)
+      std::memcpy(base + getElementOffset(DM, i), src + i, sizeof(T));
+  });
+}
+
+// Returns the first \p maxMismatches elements of M that are not close to
+// those of N, in order, stopping at the first one if \p maxMismatches is 0.
+// An element a is close to b if |a - b| <= atol + rtol * |b|, as in
+// numpy.allclose.
+template <typename T>
+static std::vector<Mismatch>
+findMismatches(UnrankedMemRefType<T> *M, UnrankedMemRefType<float> *N,
+               float rtol, float atol, size_t maxMismatches) {
+  FloatView<T> VM(M);
+  FloatView<float> VN(N);
+  int64_t size = std::min(VM.getSize(), VN.getSize());
+  size_t limit = std::max<size_t>(maxMismatches, 1);
+  // Equal infinities are close, NaNs are not.
+  auto isClose = [=](float lhs, float rhs) {
+    return lhs == rhs || std::fabs(lhs - rhs) <= atol + rtol * std::fabs(rhs);
+  };
+  // With a single mismatch asked for, any chunk finding one stops all.
+  std::atomic<bool> found{false};
+  std::vector<std::vector<Mismatch>> chunks(
+      std::max<int64_t>(1, std::thread::hardware_concurrency()));
+  auto numChunks = parallelForChunks(size, [&](int64_t chunk, int64_t begin,
+                                               int64_t end) {
+    auto &mismatches = chunks[chunk];
+    float lhs[kBlockSize], rhs[kBlockSize];
+    for (int64_t i = begin; i < end; i += kBlockSize) {
+      if (maxMismatches == 0 && found.load(std::memory_order_relaxed))
+        return;
+      int64_t n = std::min(kBlockSize, end - i);
+      VM.load(i, n, lhs);
+      VN.load(i, n, rhs);
+      bool close = true;
+      for (int64_t k = 0; k < n; ++k)
+        close &= isClose(lhs[k], rhs[k]);
+      if (close)
+        continue;
+      for (int64_t k = 0; k < n; ++k) {
+        if (!isClose(lhs[k], rhs[k])) {
+          mismatches.push_back({i + k, lhs[k], rhs[k]});
+          if (mismatches.size() == limit) {
+            found = true;
+            return;
+          }
+        }
+      }
+    }
+  });
+  std::vector<Mismatch> mismatches;
+  for (int64_t c = 0; c < numChunks && mismatches.size() < limit; ++c)
+    for (auto &mismatch : chunks[c])
+      if (mismatches.size() < limit)
+        mismatches.push_back(mismatch);
+  return mismatches;
 }
 
 // For information on how to Iterate over UnrankedMemRefType, start with
 // https://github.com/llvm/llvm-project/blob/main/mlir/include/mlir/ExecutionEngine/CRunnerUtils.h
+template <typename T>
+bool _mlir_ciface_allclose(UnrankedMemRefType<T> *M,
+                           UnrankedMemRefType<float> *N, float rtol,
+                           float atol) {
+  return findMismatches(M, N, rtol, atol, 0).empty();
+}
+
 template <typename T>
 bool _mlir_ciface_allclose(UnrankedMemRefType<T> *M,
                            UnrankedMemRefType<float> *N) {
   // atol, rtol values copied from
   // https://numpy.org/doc/stable/reference/generated/numpy.allclose.html
   // values may need to adjusted in the future
-  const float atol = 1e-04;
-  const float rtol = 1e-03;
-  DynamicMemRefType<T> DM = DynamicMemRefType<T>(*M);
-  DynamicMemRefType<float> DN = DynamicMemRefType<float>(*N);
-  DynamicMemRefIterator<T> i = DM.begin();
-  DynamicMemRefIterator<float> j = DN.begin();
-  for (; i != DM.end() && j != DN.end(); ++i, ++j) {
-    float lhs = getFloat(*i);
-    float rhs = *j;
-    if (fabs(lhs - rhs) > atol + rtol * fabs(rhs)) {
-      return false;
-    }
-  }
-  return true;
+  return _mlir_ciface_allclose(M, N, getEnvFloat("IMEX_ALLCLOSE_RTOL", 1e-03),
+                               getEnvFloat("IMEX_ALLCLOSE_ATOL", 1e-04));
 }
 
 template <typename T>
 void _mlir_ciface_printAllclose(UnrankedMemRefType<T> *M,
-                                UnrankedMemRefType<float> *N) {
-  if (_mlir_ciface_allclose(M, N)) {
+                                UnrankedMemRefType<float> *N, float rtol,
+                                float atol) {
+  size_t maxMismatches = 10;
+  if (auto value = getenv("IMEX_ALLCLOSE_MISMATCHES"))
+    maxMismatches = std::strtoul(value, nullptr, 10);
+  auto mismatches = findMismatches(M, N, rtol, atol, maxMismatches);
+  if (mismatches.empty()) {
     std::cout << "[ALLCLOSE: TRUE]\n";
   } else {
     std::cout << "[ALLCLOSE: FALSE]\n";
+    // With IMEX_ALLCLOSE_MISMATCHES=0 only the verdict is printed.
+    for (size_t i = 0; i < std::min(mismatches.size(), maxMismatches); ++i)
+      std::cout << "Mismatch at idx=" << mismatches[i].idx << ": "
+                << mismatches[i].actual << " expected "
+                << mismatches[i].expected << '\n';
   }
 }
 
+template <typename T>
+void _mlir_ciface_printAllclose(UnrankedMemRefType<T> *M,
+                                UnrankedMemRefType<float> *N) {
+  _mlir_ciface_printAllclose(M, N, getEnvFloat("IMEX_ALLCLOSE_RTOL", 1e-03),
+                             getEnvFloat("IMEX_ALLCLOSE_ATOL", 1e-04));
+}
+
 template <typename T>
 void _mlir_ciface_printMaxError(UnrankedMemRefType<T> *M,
                                 UnrankedMemRefType<T> *N) {
-  DynamicMemRefType<T> DM = DynamicMemRefType<T>(*M);
-  DynamicMemRefType<T> DN = DynamicMemRefType<T>(*N);
-  DynamicMemRefIterator<T> i = DM.begin();
-  DynamicMemRefIterator<T> j = DN.begin();
-  std::pair<double, DynamicMemRefIterator<T>> max_rel_err_idx{0.0, DM.begin()};
-  std::pair<double, DynamicMemRefIterator<T>> max_abs_err_idx{0.0, DM.begin()};
-  uint64_t idx = 0;
-  for (; i != DM.end() && j != DN.end(); ++i, ++j, ++idx) {
-    const double i_val = getFloat(*i);
-    const double j_val = getFloat(*j);
-    const double delta = fabs(i_val - j_val);
-    const double rel_error = delta / fmax(fabs(i_val), fabs(j_val));
-    if (delta > max_abs_err_idx.first)
-      max_abs_err_idx = {delta, i};
-    if (rel_error > max_rel_err_idx.first)
-      max_rel_err_idx = {rel_error, i};
+  FloatView<T> VM(M);
+  FloatView<T> VN(N);
+  int64_t size = std::min(VM.getSize(), VN.getSize());
+  struct MaxError {
+    double absErr = 0.0, relErr = 0.0;
+    int64_t absIdx = 0, relIdx = 0;
+  };
+  std::vector<MaxError> chunks(
+      std::max<int64_t>(1, std::thread::hardware_concurrency()));
+  auto numChunks = parallelForChunks(size, [&](int64_t chunk, int64_t begin,
+                                               int64_t end) {
+    auto &maxError = chunks[chunk];
+    float lhs[kBlockSize], rhs[kBlockSize];
+    for (int64_t i = begin; i < end; i += kBlockSize) {
+      int64_t n = std::min(kBlockSize, end - i);
+      VM.load(i, n, lhs);
+      VN.load(i, n, rhs);
+      for (int64_t k = 0; k < n; ++k) {
+        const double i_val = lhs[k];
+        const double j_val = rhs[k];
+        const double delta = fabs(i_val - j_val);
+        const double rel_error = delta / fmax(fabs(i_val), fabs(j_val));
+        if (delta > maxError.absErr) {
+          maxError.absErr = delta;
+          maxError.absIdx = i + k;
+        }
+        if (rel_error > maxError.relErr) {
+          maxError.relErr = rel_error;
+          maxError.relIdx = i + k;
+        }
+      }
+    }
+  });
+  // The first index wins ties, as in a sequential scan.
+  MaxError maxError;
+  for (int64_t c = 0; c < numChunks; ++c) {
+    if (chunks[c].absErr > maxError.absErr) {
+      maxError.absErr = chunks[c].absErr;
+      maxError.absIdx = chunks[c].absIdx;
+    }
+    if (chunks[c].relErr > maxError.relErr) {
+      maxError.relErr = chunks[c].relErr;
+      maxError.relIdx = chunks[c].relIdx;
+    }
   }
-  std::cout << "Max absolute error " << max_abs_err_idx.first
-            << " at idx=" << std::distance(DM.begin(), max_abs_err_idx.second)
-            << '\n';
-  std::cout << "Max relative error " << max_rel_err_idx.first
-            << " at idx=" << std::distance(DM.begin(), max_rel_err_idx.second)
-            << '\n';
+  std::cout << "Max absolute error " << maxError.absErr
+            << " at idx=" << maxError.absIdx << '\n';
+  std::cout << "Max relative error " << maxError.relErr
+            << " at idx=" << maxError.relIdx << '\n';
 }
 
 extern "C" void _mlir_ciface_printMaxErrorF16(UnrankedMemRefType<f16> *M,
@@ -284,4 +713,72 @@ extern "C" void _mlir_ciface_printAllcloseF32(UnrankedMemRefType<float> *M,
   _mlir_ciface_printAllclose(M, N);
 }
 
+extern "C" bool _mlir_ciface_allcloseTolF16(UnrankedMemRefType<f16> *M,
+                                            UnrankedMemRefType<float> *N,
+                                            float rtol, float atol) {
+  return _mlir_ciface_allclose(M, N, rtol, atol);
+}
+
+extern "C" bool _mlir_ciface_allcloseTolBF16(UnrankedMemRefType<bf16> *M,
+                                             UnrankedMemRefType<float> *N,
+                                             float rtol, float atol) {
+  return _mlir_ciface_allclose(M, N, rtol, atol);
+}
+
+extern "C" bool _mlir_ciface_allcloseTolF32(UnrankedMemRefType<float> *M,
+                                            UnrankedMemRefType<float> *N,
+                                            float rtol, float atol) {
+  return _mlir_ciface_allclose(M, N, rtol, atol);
+}
+
+extern "C" void _mlir_ciface_printAllcloseTolF16(UnrankedMemRefType<f16> *M,
+                                                 UnrankedMemRefType<float> *N,
+                                                 float rtol, float atol) {
+  _mlir_ciface_printAllclose(M, N, rtol, atol);
+}
+
+extern "C" void
+_mlir_ciface_printAllcloseTolBF16(UnrankedMemRefType<bf16> *M,
+                                  UnrankedMemRefType<float> *N, float rtol,
+                                  float atol) {
+  _mlir_ciface_printAllclose(M, N, rtol, atol);
+}
+
+extern "C" void
+_mlir_ciface_printAllcloseTolF32(UnrankedMemRefType<float> *M,
+                                 UnrankedMemRefType<float> *N, float rtol,
+                                 float atol) {
+  _mlir_ciface_printAllclose(M, N, rtol, atol);
+}
+
+extern "C" void
+_mlir_ciface_loadExternalDataF32(UnrankedMemRefType<float> *M,
+                                 UnrankedMemRefType<int8_t> *P) {
+  loadExternalData(M, P, {"<f4"});
+}
+
+extern "C" void
+_mlir_ciface_loadExternalDataF16(UnrankedMemRefType<f16> *M,
+                                 UnrankedMemRefType<int8_t> *P) {
+  loadExternalData(M, P, {"<f2"});
+}
+
+// numpy has no bf16; ml_dtypes saves it as void, others save the bits as u2.
+extern "C" void
+_mlir_ciface_loadExternalDataBF16(UnrankedMemRefType<bf16> *M,
+                                  UnrankedMemRefType<int8_t> *P) {
+  loadExternalData(M, P, {"<V2", "|V2", "<u2", "<i2"});
+}
+
+extern "C" void
+_mlir_ciface_loadExternalDataI32(UnrankedMemRefType<int32_t> *M,
+                                 UnrankedMemRefType<int8_t> *P) {
+  loadExternalData(M, P, {"<i4"});
+}
+
+extern "C" void _mlir_ciface_loadExternalDataI8(UnrankedMemRefType<int8_t> *M,
+                                                UnrankedMemRefType<int8_t> *P) {
+  loadExternalData(M, P, {"|i1"});
+}
+
 // NOLINTEND(*-identifier-naming)
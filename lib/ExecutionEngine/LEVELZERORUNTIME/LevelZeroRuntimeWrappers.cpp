@@ -12,19 +12,36 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
-#include <atomic>
+#include "imex/ExecutionEngine/DeviceSelection.h"
+#include "imex/ExecutionEngine/KernelProfiler.h"
+#include "imex/ExecutionEngine/MemoryTracker.h"
+#include "imex/ExecutionEngine/ModuleCache.h"
+#include "imex/ExecutionEngine/ModulePreloader.h"
+#include "imex/ExecutionEngine/NativeBinaryCache.h"
+#include "imex/ExecutionEngine/RandomFill.h"
+#include "imex/ExecutionEngine/TraceRecorder.h"
+
+#include <algorithm>
+#include <array>
 #include <cassert>
 #include <cfloat>
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <initializer_list>
+#include <iterator>
 #include <map>
+#include <memory>
 #include <mutex>
+#include <optional>
 #include <stdexcept>
+#include <tuple>
+#include <unordered_map>
 #include <vector>
 
 #include <level_zero/ze_api.h>
+#include <level_zero/zet_api.h>
 
 #ifdef _WIN32
 #define LEVEL_ZERO_RUNTIME_EXPORT __declspec(dllexport)
@@ -60,19 +77,13 @@ inline void checkResult(ze_result_t res, const char *func) {
 
 struct SpirvModule {
   ze_module_handle_t module = nullptr;
+  // Kernels created from this module, keyed by kernel name. They are
+  // destroyed together with the module.
+  std::map<std::string, ze_kernel_handle_t> kernels;
+  std::mutex kernelsMutex;
   ~SpirvModule();
 };
 
-namespace {
-// Create a Map for the spirv module lookup
-std::map<const void *, SpirvModule> moduleCache;
-std::mutex mutexLock;
-} // namespace
-
-SpirvModule::~SpirvModule() {
-  CHECK_ZE_RESULT(zeModuleDestroy(SpirvModule::module));
-}
-
 struct ParamDesc {
   void *data;
   size_t size;
@@ -84,6 +95,286 @@ struct ParamDesc {
   bool operator!=(const ParamDesc &rhs) const { return !(*this == rhs); }
 };
 
+namespace {
+// Argument values last set on each kernel. Arguments persist on a kernel
+// between launches, so a launch only sets the arguments that changed.
+class KernelArgCache {
+public:
+  // Locks \p kernel. Its arguments and group size are state of the kernel
+  // object, which all streams of a context share, so they are set and the
+  // launch appended under this lock.
+  std::unique_lock<std::mutex> lock(ze_kernel_handle_t kernel) {
+    return std::unique_lock<std::mutex>(getEntry(kernel).mutex);
+  }
+
+  // Sets \p count arguments of \p kernel starting at \p first from \p params,
+  // skipping those that already hold the same value. A param with null data
+  // is a local memory argument of param.size bytes. The caller holds the
+  // lock of the kernel.
+  void set(ze_kernel_handle_t kernel, size_t first, const ParamDesc *params,
+           size_t count) {
+    auto &values = getEntry(kernel).values;
+    if (values.size() < first + count)
+      values.resize(first + count);
+    for (size_t i = first; i < first + count; ++i) {
+      auto &value = values[i];
+      auto data = static_cast<const uint8_t *>(params[i - first].data);
+      auto size = params[i - first].size;
+      if (value.valid && value.size == size &&
+          (data ? value.bytes.size() == size &&
+                      std::equal(data, data + size, value.bytes.begin())
+                : value.bytes.empty()))
+        continue;
+      CHECK_ZE_RESULT(zeKernelSetArgumentValue(
+          kernel, static_cast<uint32_t>(i), size, data));
+      value.valid = true;
+      value.size = size;
+      if (data)
+        value.bytes.assign(data, data + size);
+      else
+        value.bytes.clear();
+    }
+  }
+
+  // Forgets the arguments of \p kernel, e.g. after they were set directly.
+  // The caller holds the lock of the kernel.
+  void invalidate(ze_kernel_handle_t kernel) {
+    getEntry(kernel).values.clear();
+  }
+
+private:
+  struct Value {
+    bool valid = false;
+    size_t size = 0;
+    // Empty for local memory arguments.
+    std::vector<uint8_t> bytes;
+  };
+
+  struct Entry {
+    std::mutex mutex;
+    std::vector<Value> values;
+  };
+
+  // Entries are never erased, and the elements of an unordered_map keep
+  // their address, so they outlive the lock of the map.
+  Entry &getEntry(ze_kernel_handle_t kernel) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_[kernel];
+  }
+
+  std::mutex mutex_;
+  std::unordered_map<ze_kernel_handle_t, Entry> entries_;
+};
+
+// Group sizes chosen at launch time for the kernels marked group size
+// agnostic by gpuKernelSetGroupSizeAgnostic, which may be launched with any
+// split of their global size into groups. Enabled by setting
+// IMEX_ADAPTIVE_GROUP_SIZE: to "occupancy" for the split with the best
+// occupancy in a model of the device, to any other value for the split
+// suggested by zeKernelSuggestGroupSize. The choice is cached per kernel and
+// global size.
+class GroupSizeTuner {
+public:
+  using Dims = std::array<uint32_t, 3>;
+
+  GroupSizeTuner() {
+    if (auto mode = getenv("IMEX_ADAPTIVE_GROUP_SIZE"))
+      mode_ = strcmp(mode, "occupancy") == 0 ? Mode::Occupancy : Mode::Suggest;
+  }
+
+  // Marks \p kernel, compiled for \p grfSize GRFs per thread (0 for the
+  // default), as group size agnostic.
+  void markAgnostic(ze_kernel_handle_t kernel, int32_t grfSize) {
+    if (mode_ == Mode::Disabled)
+      return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    kernels_.try_emplace(kernel).first->second.grfSize = grfSize;
+  }
+
+  // Replaces the grid and block sizes of a launch of a group size agnostic
+  // \p kernel by the chosen split of the same global size.
+  void adapt(ze_device_handle_t device, ze_kernel_handle_t kernel,
+             size_t grid[3], size_t block[3]) {
+    if (mode_ == Mode::Disabled)
+      return;
+    Dims global;
+    for (int d = 0; d < 3; ++d) {
+      auto size = grid[d] * block[d];
+      if (size == 0 || size > UINT32_MAX)
+        return;
+      global[d] = static_cast<uint32_t>(size);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = kernels_.find(kernel);
+    if (it == kernels_.end())
+      return;
+    auto &info = it->second;
+    auto group = info.groups.find(global);
+    if (group == info.groups.end()) {
+      auto size = mode_ == Mode::Suggest
+                      ? suggest(kernel, global)
+                      : model(device, kernel, info.grfSize, global);
+      group = info.groups.emplace(global, size).first;
+    }
+    // An empty choice keeps the sizes of the launch.
+    if (group->second[0] == 0)
+      return;
+    for (int d = 0; d < 3; ++d) {
+      block[d] = group->second[d];
+      grid[d] = global[d] / group->second[d];
+    }
+  }
+
+  // Forgets \p kernel, e.g. when it is destroyed.
+  void invalidate(ze_kernel_handle_t kernel) {
+    if (mode_ == Mode::Disabled)
+      return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    kernels_.erase(kernel);
+  }
+
+private:
+  enum class Mode { Disabled, Suggest, Occupancy };
+
+  struct KernelInfo {
+    int32_t grfSize = 0;
+    // Chosen group sizes, keyed by global size.
+    std::map<Dims, Dims> groups;
+  };
+
+  struct DeviceInfo {
+    uint32_t threadsPerEU;
+    uint32_t eusPerSubslice;
+    uint32_t numSubslices;
+    uint32_t simdWidth;
+    uint32_t maxGroupSize;
+    Dims maxGroupSizes;
+    uint32_t sharedMemory;
+  };
+
+  static Dims suggest(ze_kernel_handle_t kernel, const Dims &global) {
+    Dims group;
+    CHECK_ZE_RESULT(zeKernelSuggestGroupSize(kernel, global[0], global[1],
+                                             global[2], &group[0], &group[1],
+                                             &group[2]));
+    for (int d = 0; d < 3; ++d)
+      if (group[d] == 0 || global[d] % group[d] != 0)
+        return {};
+    return group;
+  }
+
+  const DeviceInfo &getDeviceInfo(ze_device_handle_t device) {
+    auto it = devices_.find(device);
+    if (it != devices_.end())
+      return it->second;
+    ze_device_properties_t props = {};
+    props.stype = ZE_STRUCTURE_TYPE_DEVICE_PROPERTIES;
+    CHECK_ZE_RESULT(zeDeviceGetProperties(device, &props));
+    ze_device_compute_properties_t compute = {};
+    compute.stype = ZE_STRUCTURE_TYPE_DEVICE_COMPUTE_PROPERTIES;
+    CHECK_ZE_RESULT(zeDeviceGetComputeProperties(device, &compute));
+    DeviceInfo info;
+    info.threadsPerEU = std::max(props.numThreadsPerEU, 1u);
+    info.eusPerSubslice = std::max(props.numEUsPerSubslice, 1u);
+    info.numSubslices =
+        std::max(props.numSlices * props.numSubslicesPerSlice, 1u);
+    info.simdWidth = std::max(props.physicalEUSimdWidth, 1u);
+    info.maxGroupSize = compute.maxTotalGroupSize;
+    info.maxGroupSizes = {compute.maxGroupSizeX, compute.maxGroupSizeY,
+                          compute.maxGroupSizeZ};
+    info.sharedMemory = compute.maxSharedLocalMemory;
+    return devices_.emplace(device, info).first->second;
+  }
+
+  // Picks the split of \p global with the best modeled occupancy: the share
+  // of the SIMD lanes of the hardware threads of a group that is used, times
+  // the share of the hardware threads of a subslice that resident groups
+  // occupy, given the register file and the SLM per group, times the share
+  // of the group slots of the device used over all waves of groups. Ties go
+  // to larger groups.
+  Dims model(ze_device_handle_t device, ze_kernel_handle_t kernel,
+             int32_t grfSize, const Dims &global) {
+    auto &dev = getDeviceInfo(device);
+    ze_kernel_properties_t props = {};
+    props.stype = ZE_STRUCTURE_TYPE_KERNEL_PROPERTIES;
+    CHECK_ZE_RESULT(zeKernelGetProperties(kernel, &props));
+    auto simd = props.maxSubgroupSize ? props.maxSubgroupSize : dev.simdWidth;
+    // Kernels compiled for the large register file get half the threads.
+    bool largeGRF = grfSize ? grfSize > 128
+                            : getenv("IMEX_ENABLE_LARGE_REG_FILE") != nullptr;
+    auto threadsPerSubslice = dev.eusPerSubslice * dev.threadsPerEU;
+    if (largeGRF)
+      threadsPerSubslice = std::max(threadsPerSubslice / 2, 1u);
+
+    // Divisors of the global size within the limits, in descending order
+    // such that ties go to larger groups in x.
+    std::array<std::vector<uint32_t>, 3> divisors;
+    for (int d = 0; d < 3; ++d)
+      for (auto i = std::min(global[d], dev.maxGroupSizes[d]); i > 0; --i)
+        if (global[d] % i == 0)
+          divisors[d].push_back(i);
+
+    Dims best = {};
+    double bestScore = -1;
+    uint64_t bestSize = 0;
+    for (auto x : divisors[0]) {
+      for (auto y : divisors[1]) {
+        for (auto z : divisors[2]) {
+          uint64_t size = uint64_t(x) * y * z;
+          if (size > dev.maxGroupSize)
+            continue;
+          auto threads = (size + simd - 1) / simd;
+          auto resident = threadsPerSubslice / threads;
+          if (props.localMemSize)
+            resident = std::min<uint64_t>(
+                resident, dev.sharedMemory / props.localMemSize);
+          if (resident == 0)
+            continue;
+          uint64_t groups =
+              uint64_t(global[0] / x) * (global[1] / y) * (global[2] / z);
+          auto slots = resident * dev.numSubslices;
+          auto waves = (groups + slots - 1) / slots;
+          auto lanes = double(size) / (threads * simd);
+          auto residency = double(resident * threads) / threadsPerSubslice;
+          auto balance = double(groups) / (waves * slots);
+          auto score = lanes * residency * balance;
+          if (score > bestScore + 1e-9 ||
+              (score > bestScore - 1e-9 && size > bestSize)) {
+            best = {x, y, z};
+            bestScore = score;
+            bestSize = size;
+          }
+        }
+      }
+    }
+    return best;
+  }
+
+  Mode mode_ = Mode::Disabled;
+  std::mutex mutex_;
+  std::unordered_map<ze_kernel_handle_t, KernelInfo> kernels_;
+  std::unordered_map<ze_device_handle_t, DeviceInfo> devices_;
+};
+
+KernelArgCache kernelArgCache;
+GroupSizeTuner groupSizeTuner;
+// Modules keyed by SPIR-V content, build flags, context and device. Declared
+// after kernelArgCache and groupSizeTuner, which the modules update when they
+// are destroyed.
+imex::ModuleCache<SpirvModule> moduleCache;
+} // namespace
+
+SpirvModule::~SpirvModule() {
+  for (auto &kernel : kernels) {
+    kernelArgCache.invalidate(kernel.second);
+    groupSizeTuner.invalidate(kernel.second);
+    CHECK_ZE_RESULT(zeKernelDestroy(kernel.second));
+  }
+  if (module)
+    CHECK_ZE_RESULT(zeModuleDestroy(SpirvModule::module));
+}
+
 struct EventDesc {
   void *event;
 
@@ -92,6 +383,15 @@ struct EventDesc {
   bool operator!=(const EventDesc &rhs) const { return !(*this == rhs); }
 };
 
+// One launch of a gpuLaunchKernels batch.
+struct LaunchDesc {
+  void *kernel;
+  size_t grid[3];
+  size_t block[3];
+  size_t sharedMemBytes;
+  ParamDesc *params;
+};
+
 template <typename T> size_t countUntil(T *ptr, T &&elem) {
   assert(ptr);
   auto curr = ptr;
@@ -101,9 +401,49 @@ template <typename T> size_t countUntil(T *ptr, T &&elem) {
   return static_cast<size_t>(curr - ptr);
 }
 
+// Returns the null terminated params of the arguments packed back to back in
+// \p args, as described by \p layout: the number of arguments followed by the
+// size of each. The returned array is reused by the next call on the thread.
+static ParamDesc *unpackParams(void *args, const int64_t *layout) {
+  thread_local std::vector<ParamDesc> params;
+  auto count = static_cast<size_t>(layout[0]);
+  auto data = static_cast<uint8_t *>(args);
+  params.clear();
+  for (size_t i = 0; i < count; ++i) {
+    auto size = static_cast<size_t>(layout[i + 1]);
+    params.push_back({data, size});
+    data += size;
+  }
+  params.push_back({nullptr, 0});
+  return params.data();
+}
+
+// Collect the events of a null terminated EventDesc array.
+static std::vector<ze_event_handle_t> getWaitEvents(EventDesc *depEvents) {
+  std::vector<ze_event_handle_t> waitEvents;
+  if (!depEvents)
+    return waitEvents;
+  auto depEventsCount = countUntil(depEvents, EventDesc{nullptr});
+  waitEvents.reserve(depEventsCount);
+  for (size_t i = 0; i < depEventsCount; i++)
+    waitEvents.push_back(static_cast<ze_event_handle_t>(depEvents[i].event));
+  return waitEvents;
+}
+
+// Returns the driver and the device (or sub-device) of the given type chosen
+// by \p selection, see imex/ExecutionEngine/DeviceSelection.h.
 static std::pair<ze_driver_handle_t, ze_device_handle_t>
-getDriverAndDevice(ze_device_type_t deviceType = ZE_DEVICE_TYPE_GPU) {
+getDriverAndDevice(ze_device_type_t deviceType = ZE_DEVICE_TYPE_GPU,
+                   imex::DeviceSelection selection = {}) {
 
+  // Metric groups are only exposed by the driver if requested before zeInit.
+  if (getenv("IMEX_PROFILING_METRICS") && !getenv("ZET_ENABLE_METRICS")) {
+#ifdef _WIN32
+    _putenv_s("ZET_ENABLE_METRICS", "1");
+#else
+    setenv("ZET_ENABLE_METRICS", "1", /*overwrite=*/0);
+#endif // _WIN32
+  }
   CHECK_ZE_RESULT(zeInit(ZE_INIT_FLAG_GPU_ONLY));
   uint32_t driverCount = 0;
   CHECK_ZE_RESULT(zeDriverGet(&driverCount, nullptr));
@@ -111,7 +451,9 @@ getDriverAndDevice(ze_device_type_t deviceType = ZE_DEVICE_TYPE_GPU) {
   std::vector<ze_driver_handle_t> allDrivers{driverCount};
   CHECK_ZE_RESULT(zeDriverGet(&driverCount, allDrivers.data()));
 
-  // Find a driver instance with a GPU device
+  // Collect the devices of the requested type of all drivers.
+  std::vector<std::pair<ze_driver_handle_t, ze_device_handle_t>> candidates;
+  std::vector<uint32_t> subDeviceCounts;
   std::vector<ze_device_handle_t> devices;
   for (uint32_t i = 0; i < driverCount; ++i) {
     uint32_t deviceCount = 0;
@@ -123,14 +465,28 @@ getDriverAndDevice(ze_device_type_t deviceType = ZE_DEVICE_TYPE_GPU) {
     for (uint32_t d = 0; d < deviceCount; ++d) {
       ze_device_properties_t device_properties = {};
       CHECK_ZE_RESULT(zeDeviceGetProperties(devices[d], &device_properties));
-      if (deviceType == device_properties.type) {
-        auto driver = allDrivers[i];
-        auto device = devices[d];
-        return {driver, device};
-      }
+      if (deviceType != device_properties.type)
+        continue;
+      uint32_t subDeviceCount = 0;
+      CHECK_ZE_RESULT(
+          zeDeviceGetSubDevices(devices[d], &subDeviceCount, nullptr));
+      candidates.emplace_back(allDrivers[i], devices[d]);
+      subDeviceCounts.push_back(subDeviceCount);
     }
   }
-  throw std::runtime_error("getDevice failed");
+  if (candidates.empty())
+    throw std::runtime_error("getDevice failed");
+
+  selection = imex::resolveDeviceSelection(selection, subDeviceCounts);
+  auto [driver, device] = candidates[selection.device];
+  if (selection.subDevice < 0)
+    return {driver, device};
+
+  uint32_t subDeviceCount = subDeviceCounts[selection.device];
+  std::vector<ze_device_handle_t> subDevices(subDeviceCount);
+  CHECK_ZE_RESULT(
+      zeDeviceGetSubDevices(device, &subDeviceCount, subDevices.data()));
+  return {driver, subDevices[selection.subDevice]};
 }
 
 #define _IMEX_PROFILING_TRAITS_SPEC(Desc)                                      \
@@ -144,39 +500,92 @@ _IMEX_PROFILING_TRAITS_SPEC(command_end)
 } // namespace profiling
 } // namespace imex
 
-// A Timestamp event pool management class. It currently simply represents
-// a event pool with fixed 256 slots. Currently for each run we just need
-// one timing event, but we definity need a sophisticated event system in
-// the future for programs with multiple kernels.
-struct EventPool {
-  ze_event_pool_handle_t zeEventPool;
-  const uint32_t maxEvents = 256;
+// A growable event pool management class. Events are created from Level Zero
+// event pools allocated in chunks of eventsPerChunk slots, and released events
+// are reset and recycled instead of being destroyed. Kernel timestamp events
+// are more expensive, so they are only used by the pool created for
+// profiling.
+class EventPool {
+public:
+  static constexpr uint32_t eventsPerChunk = 256;
+
+  EventPool(ze_context_handle_t zeContext, bool timestamps)
+      : zeContext_(zeContext), timestamps_(timestamps) {}
+
+  EventPool(const EventPool &) = delete;
+  EventPool &operator=(const EventPool &) = delete;
+
+  ~EventPool() {
+    for (auto zeEvent : allEvents_)
+      CHECK_ZE_RESULT(zeEventDestroy(zeEvent));
+    for (auto zeEventPool : zeEventPools_)
+      CHECK_ZE_RESULT(zeEventPoolDestroy(zeEventPool));
+  }
+
+  ze_event_handle_t acquire() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!freeEvents_.empty()) {
+      auto zeEvent = freeEvents_.back();
+      freeEvents_.pop_back();
+      return zeEvent;
+    }
+
+    if (zeEventPools_.empty() || nextIndex_ == eventsPerChunk) {
+      ze_event_pool_flags_t flags = ZE_EVENT_POOL_FLAG_HOST_VISIBLE;
+      if (timestamps_)
+        flags |= ZE_EVENT_POOL_FLAG_KERNEL_TIMESTAMP;
+      ze_event_pool_desc_t eventPoolDesc = {ZE_STRUCTURE_TYPE_EVENT_POOL_DESC,
+                                            nullptr, flags, eventsPerChunk};
+      ze_event_pool_handle_t zeEventPool;
+      CHECK_ZE_RESULT(zeEventPoolCreate(zeContext_, &eventPoolDesc, 0, nullptr,
+                                        &zeEventPool));
+      zeEventPools_.push_back(zeEventPool);
+      nextIndex_ = 0;
+    }
 
-  EventPool(ze_context_handle_t zeContext_) {
-    ze_event_pool_desc_t tsEventPoolDesc = {
-        ZE_STRUCTURE_TYPE_EVENT_POOL_DESC, nullptr,
-        ZE_EVENT_POOL_FLAG_KERNEL_TIMESTAMP, maxEvents};
-    CHECK_ZE_RESULT(zeEventPoolCreate(zeContext_, &tsEventPoolDesc, 0, nullptr,
-                                      &zeEventPool));
+    ze_event_desc_t eventDesc = {
+        ZE_STRUCTURE_TYPE_EVENT_DESC, nullptr,
+        nextIndex_++,             // index
+        ZE_EVENT_SCOPE_FLAG_HOST, // make the signal visible to the host
+        ZE_EVENT_SCOPE_FLAG_HOST  // make the host wait coherent
+    };
+    ze_event_handle_t zeEvent;
+    CHECK_ZE_RESULT(zeEventCreate(zeEventPools_.back(), &eventDesc, &zeEvent));
+    allEvents_.push_back(zeEvent);
+    return zeEvent;
   }
 
-  ~EventPool() { CHECK_ZE_RESULT(zeEventPoolDestroy(zeEventPool)); }
+  // Return a completed event to the pool. The event is reset so it can be
+  // signaled again by a later command.
+  void release(ze_event_handle_t zeEvent) {
+    CHECK_ZE_RESULT(zeEventHostReset(zeEvent));
+    std::lock_guard<std::mutex> lock(mutex_);
+    freeEvents_.push_back(zeEvent);
+  }
+
+private:
+  ze_context_handle_t zeContext_;
+  bool timestamps_;
+  std::mutex mutex_;
+  std::vector<ze_event_pool_handle_t> zeEventPools_;
+  std::vector<ze_event_handle_t> allEvents_;
+  std::vector<ze_event_handle_t> freeEvents_;
+  uint32_t nextIndex_ = 0;
 };
 
-// A wrapper to ze_event_handle_t providing timestamp queries
+// A wrapper to ze_event_handle_t providing timestamp queries. The event is
+// taken from the given (timestamp) pool and given back on destruction.
 class Event {
 private:
+  EventPool &pool_;
   uint64_t zeTimestampMaxValue_;
   uint64_t zeTimerResolution_;
 
 public:
   ze_event_handle_t zeEvent;
 
-  Event(ze_context_handle_t zeContext_, ze_device_handle_t zeDevice_) {
-    static EventPool pool(zeContext_);
-
-    static std::atomic<uint32_t> eventIndex{0};
-
+  Event(EventPool &pool, ze_device_handle_t zeDevice_)
+      : pool_(pool), zeEvent(pool.acquire()) {
     // timestamp and timer resolution is a device properties.
     // They are required to compute the final wall time.
     ze_device_properties_t deviceProperties{};
@@ -185,14 +594,6 @@ public:
     zeTimestampMaxValue_ =
         ((1ULL << deviceProperties.kernelTimestampValidBits) - 1ULL);
     zeTimerResolution_ = deviceProperties.timerResolution;
-
-    ze_event_desc_t eventDesc = {
-        ZE_STRUCTURE_TYPE_EVENT_DESC, nullptr,
-        eventIndex++, // index
-        0,            // no additional memory/cache coherency required on signal
-        0             // no additional memory/cache coherency required on wait
-    };
-    CHECK_ZE_RESULT(zeEventCreate(pool.zeEventPool, &eventDesc, &zeEvent));
   }
 
   // query the kernel start or end (specified via Param) timestamp
@@ -219,7 +620,793 @@ public:
     }
   }
 
-  ~Event() { CHECK_ZE_RESULT(zeEventDestroy(zeEvent)); }
+  ~Event() { pool_.release(zeEvent); }
+};
+
+// Reads hardware counters of the launches recorded by the kernel profiler
+// through the event based Level Zero metric group named by
+// IMEX_PROFILING_METRICS, e.g. ComputeBasic or MemoryProfile. The group is
+// activated on the context of the queue and every profiled launch is enclosed
+// in a metric query, taken from query pools allocated in chunks like events.
+// Metric names differ between GPU generations, so each reported counter is
+// looked up under all known names; counters the group does not have are not
+// reported. Launches running concurrently are attributed to each other's
+// queries.
+class MetricCollector {
+public:
+  static constexpr uint32_t queriesPerChunk = 256;
+
+  MetricCollector(ze_context_handle_t zeContext, ze_device_handle_t zeDevice,
+                  const char *groupName)
+      : zeContext_(zeContext), zeDevice_(zeDevice) {
+    uint32_t groupCount = 0;
+    CHECK_ZE_RESULT(zetMetricGroupGet(zeDevice, &groupCount, nullptr));
+    std::vector<zet_metric_group_handle_t> groups(groupCount);
+    CHECK_ZE_RESULT(zetMetricGroupGet(zeDevice, &groupCount, groups.data()));
+    for (auto group : groups) {
+      zet_metric_group_properties_t properties = {};
+      properties.stype = ZET_STRUCTURE_TYPE_METRIC_GROUP_PROPERTIES;
+      CHECK_ZE_RESULT(zetMetricGroupGetProperties(group, &properties));
+      if ((properties.samplingType &
+           ZET_METRIC_GROUP_SAMPLING_TYPE_FLAG_EVENT_BASED) &&
+          !strcmp(properties.name, groupName)) {
+        zetGroup_ = group;
+        break;
+      }
+    }
+    if (!zetGroup_) {
+      fprintf(stderr, "Metric group %s is not available on the device\n",
+              groupName);
+      return;
+    }
+
+    uint32_t metricCount = 0;
+    CHECK_ZE_RESULT(zetMetricGet(zetGroup_, &metricCount, nullptr));
+    std::vector<zet_metric_handle_t> metrics(metricCount);
+    CHECK_ZE_RESULT(zetMetricGet(zetGroup_, &metricCount, metrics.data()));
+    for (auto metric : metrics) {
+      zet_metric_properties_t properties = {};
+      properties.stype = ZET_STRUCTURE_TYPE_METRIC_PROPERTIES;
+      CHECK_ZE_RESULT(zetMetricGetProperties(metric, &properties));
+      names_.emplace_back(properties.name);
+      units_.emplace_back(properties.resultUnits);
+    }
+    euActive_ = find({"XVE_ACTIVE", "EuActive"});
+    euStall_ = find({"XVE_STALL", "EuStall"});
+    l3Hits_ = find({"L3_HIT", "L3Hit"});
+    l3Misses_ = find({"L3_MISS", "L3Miss"});
+    gtiRead_ = find({"GTI_READ_THROUGHPUT", "GtiReadThroughput"});
+    gtiWrite_ = find({"GTI_WRITE_THROUGHPUT", "GtiWriteThroughput"});
+
+    CHECK_ZE_RESULT(
+        zetContextActivateMetricGroups(zeContext_, zeDevice_, 1, &zetGroup_));
+  }
+
+  MetricCollector(const MetricCollector &) = delete;
+  MetricCollector &operator=(const MetricCollector &) = delete;
+
+  ~MetricCollector() {
+    if (!zetGroup_)
+      return;
+    for (auto query : allQueries_)
+      CHECK_ZE_RESULT(zetMetricQueryDestroy(query));
+    for (auto pool : queryPools_)
+      CHECK_ZE_RESULT(zetMetricQueryPoolDestroy(pool));
+    CHECK_ZE_RESULT(
+        zetContextActivateMetricGroups(zeContext_, zeDevice_, 0, nullptr));
+  }
+
+  bool isValid() const { return zetGroup_ != nullptr; }
+
+  zet_metric_query_handle_t acquire() {
+    if (!freeQueries_.empty()) {
+      auto query = freeQueries_.back();
+      freeQueries_.pop_back();
+      return query;
+    }
+
+    if (queryPools_.empty() || nextIndex_ == queriesPerChunk) {
+      zet_metric_query_pool_desc_t desc = {
+          ZET_STRUCTURE_TYPE_METRIC_QUERY_POOL_DESC, nullptr,
+          ZET_METRIC_QUERY_POOL_TYPE_PERFORMANCE, queriesPerChunk};
+      zet_metric_query_pool_handle_t pool;
+      CHECK_ZE_RESULT(zetMetricQueryPoolCreate(zeContext_, zeDevice_,
+                                               zetGroup_, &desc, &pool));
+      queryPools_.push_back(pool);
+      nextIndex_ = 0;
+    }
+
+    zet_metric_query_handle_t query;
+    CHECK_ZE_RESULT(
+        zetMetricQueryCreate(queryPools_.back(), nextIndex_++, &query));
+    allQueries_.push_back(query);
+    return query;
+  }
+
+  // Return a query whose results have been read to the pool.
+  void release(zet_metric_query_handle_t query) {
+    CHECK_ZE_RESULT(zetMetricQueryReset(query));
+    freeQueries_.push_back(query);
+  }
+
+  // Computes the counters of a completed query.
+  imex::KernelProfiler::Metrics read(zet_metric_query_handle_t query) {
+    size_t size = 0;
+    CHECK_ZE_RESULT(zetMetricQueryGetData(query, &size, nullptr));
+    std::vector<uint8_t> data(size);
+    CHECK_ZE_RESULT(zetMetricQueryGetData(query, &size, data.data()));
+    uint32_t valueCount = 0;
+    CHECK_ZE_RESULT(zetMetricGroupCalculateMetricValues(
+        zetGroup_, ZET_METRIC_GROUP_CALCULATION_TYPE_METRIC_VALUES, size,
+        data.data(), &valueCount, nullptr));
+    std::vector<zet_typed_value_t> values(valueCount);
+    CHECK_ZE_RESULT(zetMetricGroupCalculateMetricValues(
+        zetGroup_, ZET_METRIC_GROUP_CALCULATION_TYPE_METRIC_VALUES, size,
+        data.data(), &valueCount, values.data()));
+
+    // A query yields one report with a value per metric of the group.
+    auto value = [&](int index) {
+      if (index < 0 || static_cast<size_t>(index) >= valueCount)
+        return -1.0;
+      auto &val = values[index];
+      switch (val.type) {
+      case ZET_VALUE_TYPE_UINT32:
+        return static_cast<double>(val.value.ui32);
+      case ZET_VALUE_TYPE_UINT64:
+        return static_cast<double>(val.value.ui64);
+      case ZET_VALUE_TYPE_FLOAT32:
+        return static_cast<double>(val.value.fp32);
+      case ZET_VALUE_TYPE_FLOAT64:
+        return val.value.fp64;
+      default:
+        return -1.0;
+      }
+    };
+
+    imex::KernelProfiler::Metrics metrics;
+    metrics.euActive = value(euActive_);
+    metrics.euStall = value(euStall_);
+    auto hits = value(l3Hits_);
+    auto misses = value(l3Misses_);
+    if (hits >= 0 && misses >= 0 && hits + misses > 0)
+      metrics.l3Hit = 100 * hits / (hits + misses);
+    auto read = toGbps(value(gtiRead_), gtiRead_);
+    auto write = toGbps(value(gtiWrite_), gtiWrite_);
+    if (read >= 0 || write >= 0)
+      metrics.gtiGbps = std::max(read, 0.0) + std::max(write, 0.0);
+    return metrics;
+  }
+
+private:
+  // Index of the first metric of the group with one of \p names, or -1.
+  int find(std::initializer_list<const char *> names) const {
+    for (size_t i = 0; i < names_.size(); ++i)
+      for (auto name : names)
+        if (names_[i] == name)
+          return static_cast<int>(i);
+    return -1;
+  }
+
+  // Converts a throughput given in the result units of metric \p index to
+  // GB/s.
+  double toGbps(double val, int index) const {
+    if (val < 0)
+      return val;
+    auto &unit = units_[index];
+    if (unit.rfind("GB", 0) == 0)
+      return val;
+    if (unit.rfind("MB", 0) == 0)
+      return val / 1e3;
+    if (unit.rfind("kB", 0) == 0 || unit.rfind("KB", 0) == 0)
+      return val / 1e6;
+    return val / 1e9;
+  }
+
+  ze_context_handle_t zeContext_;
+  ze_device_handle_t zeDevice_;
+  zet_metric_group_handle_t zetGroup_ = nullptr;
+  std::vector<std::string> names_;
+  std::vector<std::string> units_;
+  int euActive_ = -1, euStall_ = -1, l3Hits_ = -1, l3Misses_ = -1,
+      gtiRead_ = -1, gtiWrite_ = -1;
+  std::vector<zet_metric_query_pool_handle_t> queryPools_;
+  std::vector<zet_metric_query_handle_t> allQueries_;
+  std::vector<zet_metric_query_handle_t> freeQueries_;
+  uint32_t nextIndex_ = 0;
+};
+
+// Alignment of allocations that do not request one, that of the runtime's own
+// buffers.
+static constexpr size_t defaultAlignment = 64;
+
+static ze_result_t tryAllocUSM(ze_context_handle_t zeContext,
+                               ze_device_handle_t zeDevice, size_t size,
+                               size_t alignment, bool isShared, void **ret) {
+  ze_device_mem_alloc_desc_t devDesc = {};
+  devDesc.stype = ZE_STRUCTURE_TYPE_DEVICE_MEM_ALLOC_DESC;
+  if (isShared) {
+    ze_host_mem_alloc_desc_t hostDesc = {};
+    hostDesc.stype = ZE_STRUCTURE_TYPE_HOST_MEM_ALLOC_DESC;
+    return zeMemAllocShared(zeContext, &devDesc, &hostDesc, size, alignment,
+                            zeDevice, ret);
+  }
+  devDesc.flags = ZE_DEVICE_MEM_ALLOC_FLAG_BIAS_INITIAL_PLACEMENT;
+  return zeMemAllocDevice(zeContext, &devDesc, size, alignment, zeDevice, ret);
+}
+
+static void *allocUSM(ze_context_handle_t zeContext,
+                      ze_device_handle_t zeDevice, size_t size,
+                      size_t alignment, bool isShared) {
+  void *ret = nullptr;
+  CHECK_ZE_RESULT(
+      tryAllocUSM(zeContext, zeDevice, size, alignment, isShared, &ret));
+  return ret;
+}
+
+// A size-class caching pool for device and shared USM allocations. Requested
+// sizes are rounded up to the next power of two (with a minimum block size)
+// and freed blocks are kept in per-class free lists, separately for device and
+// shared memory, so that temporaries allocated and freed inside loops can be
+// reused without going through the driver. Requests above the largest class
+// bypass the pool. Freed blocks that would push the cached bytes above
+// IMEX_POOL_MAX_BYTES (1 GiB by default) go back to the driver, and when the
+// device runs out of memory the cached blocks are released before the
+// allocation is retried. All cached blocks are released in bulk when the
+// owning queue is destroyed. The pool can be disabled through the
+// IMEX_DISABLE_MEMORY_POOL environment variable.
+class MemoryPool {
+public:
+  static constexpr size_t minBlockSize = 256;
+  static constexpr unsigned numSizeClasses = 23;
+  static constexpr size_t maxBlockSize = minBlockSize
+                                         << (numSizeClasses - 1);
+
+  MemoryPool() : enabled_(!getenv("IMEX_DISABLE_MEMORY_POOL")) {
+    if (auto maxBytes = getenv("IMEX_POOL_MAX_BYTES"))
+      maxCachedBytes_ = strtoull(maxBytes, nullptr, 10);
+  }
+
+  MemoryPool(const MemoryPool &) = delete;
+  MemoryPool &operator=(const MemoryPool &) = delete;
+
+  void *alloc(ze_context_handle_t zeContext, ze_device_handle_t zeDevice,
+              size_t size, size_t alignment, bool isShared) {
+    if (!enabled_)
+      return allocUSM(zeContext, zeDevice, size, alignment, isShared);
+    if (size > maxBlockSize)
+      return allocOrTrim(zeContext, zeDevice, size, alignment, isShared);
+
+    auto sizeClass = getSizeClass(size);
+    auto blockSize = getBlockSize(sizeClass);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto &freeList = freeLists_[isShared][sizeClass];
+      for (auto it = freeList.begin(); it != freeList.end(); ++it) {
+        if (it->alignment % alignment != 0)
+          continue;
+        auto block = *it;
+        freeList.erase(it);
+        cachedBytes_ -= blockSize;
+        liveBlocks_[block.ptr] = block;
+        ++hits_;
+        return block.ptr;
+      }
+      ++misses_;
+    }
+
+    auto *ptr =
+        allocOrTrim(zeContext, zeDevice, blockSize, alignment, isShared);
+    std::lock_guard<std::mutex> lock(mutex_);
+    liveBlocks_[ptr] = Block{ptr, alignment, sizeClass, isShared};
+    return ptr;
+  }
+
+  void free(ze_context_handle_t zeContext, void *ptr) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = liveBlocks_.find(ptr);
+      if (it != liveBlocks_.end()) {
+        auto block = it->second;
+        liveBlocks_.erase(it);
+        auto blockSize = getBlockSize(block.sizeClass);
+        if (cachedBytes_ + blockSize <= maxCachedBytes_) {
+          freeLists_[block.isShared][block.sizeClass].push_back(block);
+          cachedBytes_ += blockSize;
+          return;
+        }
+      }
+    }
+    // Not allocated through the pool (or the pool is disabled or full).
+    CHECK_ZE_RESULT(zeMemFree(zeContext, ptr));
+  }
+
+  // Release all cached blocks back to the driver.
+  void trim(ze_context_handle_t zeContext) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    trimLocked(zeContext);
+  }
+
+  // Release all cached blocks back to the driver. Blocks that are still in use
+  // are freed as well since the context is about to be destroyed.
+  void release(ze_context_handle_t zeContext) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    trimLocked(zeContext);
+    for (auto &entry : liveBlocks_)
+      CHECK_ZE_RESULT(zeMemFree(zeContext, entry.first));
+    liveBlocks_.clear();
+  }
+
+  void printStatistics() const {
+    if (!enabled_)
+      return;
+    auto total = hits_ + misses_;
+    fprintf(stdout,
+            "the memory pool statistics are (on L0 runtime):"
+            "hits: %zu, misses: %zu, hit rate: %.2f%%, cached: %zu bytes\n",
+            hits_, misses_, total ? 100.0 * hits_ / total : 0.0, cachedBytes_);
+  }
+
+private:
+  struct Block {
+    void *ptr;
+    size_t alignment;
+    unsigned sizeClass;
+    bool isShared;
+  };
+
+  // Allocates from the driver. If the device is out of memory, the cached
+  // blocks are released and the allocation is tried once more.
+  void *allocOrTrim(ze_context_handle_t zeContext, ze_device_handle_t zeDevice,
+                    size_t size, size_t alignment, bool isShared) {
+    void *ptr = nullptr;
+    auto res =
+        tryAllocUSM(zeContext, zeDevice, size, alignment, isShared, &ptr);
+    if (res == ZE_RESULT_ERROR_OUT_OF_DEVICE_MEMORY) {
+      trim(zeContext);
+      res = tryAllocUSM(zeContext, zeDevice, size, alignment, isShared, &ptr);
+    }
+    CHECK_ZE_RESULT(res);
+    return ptr;
+  }
+
+  void trimLocked(ze_context_handle_t zeContext) {
+    for (auto &freeLists : freeLists_)
+      for (auto &freeList : freeLists) {
+        for (auto &block : freeList)
+          CHECK_ZE_RESULT(zeMemFree(zeContext, block.ptr));
+        freeList.clear();
+      }
+    cachedBytes_ = 0;
+  }
+
+  static unsigned getSizeClass(size_t size) {
+    assert(size <= maxBlockSize && "allocation too large for the pool");
+    unsigned sizeClass = 0;
+    while (getBlockSize(sizeClass) < size)
+      ++sizeClass;
+    return sizeClass;
+  }
+
+  static size_t getBlockSize(unsigned sizeClass) {
+    return minBlockSize << sizeClass;
+  }
+
+  bool enabled_;
+  std::mutex mutex_;
+  // Free lists indexed by [isShared][sizeClass].
+  std::vector<Block> freeLists_[2][numSizeClasses];
+  std::unordered_map<void *, Block> liveBlocks_;
+  size_t cachedBytes_ = 0;
+  size_t maxCachedBytes_ = size_t(1) << 30;
+  size_t hits_ = 0;
+  size_t misses_ = 0;
+};
+
+// A sequence of kernel launches recorded into a regular command list between
+// gpuGraphBegin and gpuGraphEnd. The first execution records the launches;
+// later executions of the same region only compare each launch against the
+// recorded one and submit the command list once. Regular command lists bake
+// kernel arguments in at append time. If the driver supports mutable command
+// lists, the arguments, group counts and group sizes of changed launches are
+// patched in the list; otherwise, or if a kernel or the number of launches
+// changed, the list is rebuilt. The list waits for its start event before
+// the first launch and signals its done event after the last one, through
+// which the queue orders it with its other commands.
+class CommandGraph {
+public:
+  CommandGraph(ze_context_handle_t context, ze_device_handle_t device,
+               uint32_t ordinal, EventPool &eventPool, bool isMutable)
+      : zeContext_(context), zeDevice_(device), ordinal_(ordinal),
+        eventPool_(eventPool), mutable_(isMutable),
+        startEvent_(eventPool.acquire()), doneEvent_(eventPool.acquire()) {}
+
+  CommandGraph(const CommandGraph &) = delete;
+  CommandGraph &operator=(const CommandGraph &) = delete;
+
+  ~CommandGraph() {
+    waitDone();
+    if (zeCommandList_)
+      CHECK_ZE_RESULT(zeCommandListDestroy(zeCommandList_));
+    eventPool_.release(startEvent_);
+    eventPool_.release(doneEvent_);
+  }
+
+  void begin() { recorded_.clear(); }
+
+  void record(ze_kernel_handle_t kernel, const ze_group_count_t &groupCount,
+              const uint32_t (&groupSize)[3], size_t sharedMemBytes,
+              ParamDesc *params, size_t paramsCount) {
+    Launch launch{kernel,
+                  groupCount,
+                  {groupSize[0], groupSize[1], groupSize[2]},
+                  sharedMemBytes,
+                  {},
+                  0};
+    launch.args.reserve(paramsCount);
+    for (size_t i = 0; i < paramsCount; ++i) {
+      auto data = static_cast<const uint8_t *>(params[i].data);
+      auto &arg = launch.args.emplace_back(params[i].size,
+                                           std::vector<uint8_t>());
+      if (data)
+        arg.second.assign(data, data + params[i].size);
+    }
+    recorded_.push_back(std::move(launch));
+  }
+
+  // Returns the command list for the launches recorded since begin(), or
+  // null if there are none. If they differ from the previous execution, the
+  // list is patched or rebuilt once that execution is done.
+  ze_command_list_handle_t end() {
+    if (recorded_.empty())
+      return nullptr;
+
+    bool rebuild = !zeCommandList_ || recorded_.size() != launches_.size();
+    std::vector<size_t> changed;
+    for (size_t i = 0; !rebuild && i < recorded_.size(); ++i) {
+      auto &launch = recorded_[i];
+      auto &old = launches_[i];
+      launch.commandId = old.commandId;
+      if (launch == old)
+        continue;
+      if (!mutable_ || launch.kernel != old.kernel ||
+          launch.args.size() != old.args.size() ||
+          (launch.sharedMemBytes == 0) != (old.sharedMemBytes == 0))
+        rebuild = true;
+      changed.push_back(i);
+    }
+    if (!rebuild && changed.empty())
+      return zeCommandList_;
+
+    // The list must not be modified while it executes.
+    waitDone();
+    launches_.swap(recorded_);
+    if (rebuild)
+      build();
+    else
+      update(changed, recorded_);
+    CHECK_ZE_RESULT(zeCommandListClose(zeCommandList_));
+    return zeCommandList_;
+  }
+
+  // The event the list waits for before its first launch.
+  ze_event_handle_t getStartEvent() const { return startEvent_; }
+
+  // The event the list signals after its last launch.
+  ze_event_handle_t getDoneEvent() const { return doneEvent_; }
+
+  // Notes that the list was submitted.
+  void markSubmitted() { submitted_ = true; }
+
+private:
+  struct Launch {
+    ze_kernel_handle_t kernel;
+    ze_group_count_t groupCount;
+    uint32_t groupSize[3];
+    size_t sharedMemBytes;
+    // Size and value of each argument; the value of a local memory argument
+    // is empty.
+    std::vector<std::pair<size_t, std::vector<uint8_t>>> args;
+    // Id of the launch in a mutable command list.
+    uint64_t commandId;
+
+    bool operator==(const Launch &rhs) const {
+      return kernel == rhs.kernel &&
+             groupCount.groupCountX == rhs.groupCount.groupCountX &&
+             groupCount.groupCountY == rhs.groupCount.groupCountY &&
+             groupCount.groupCountZ == rhs.groupCount.groupCountZ &&
+             std::equal(std::begin(groupSize), std::end(groupSize),
+                        std::begin(rhs.groupSize)) &&
+             sharedMemBytes == rhs.sharedMemBytes && args == rhs.args;
+    }
+  };
+
+  // Blocks until the last submission of the list is done. The done event
+  // stays signaled until the next submission resets it.
+  void waitDone() {
+    if (submitted_)
+      CHECK_ZE_RESULT(zeEventHostSynchronize(doneEvent_, UINT64_MAX));
+  }
+
+  // Appends all launches to the list. The start event is reset once waited
+  // for; the done event is reset at the start of every execution, after the
+  // commands waiting for the previous one, since those are ordered before
+  // the start event.
+  void build() {
+    if (zeCommandList_) {
+      CHECK_ZE_RESULT(zeCommandListReset(zeCommandList_));
+    } else {
+      ze_command_list_desc_t desc = {};
+      desc.stype = ZE_STRUCTURE_TYPE_COMMAND_LIST_DESC;
+      desc.commandQueueGroupOrdinal = ordinal_;
+#ifdef ZE_MUTABLE_COMMAND_LIST_EXP_NAME
+      ze_mutable_command_list_exp_desc_t mutableDesc = {};
+      mutableDesc.stype = ZE_STRUCTURE_TYPE_MUTABLE_COMMAND_LIST_EXP_DESC;
+      if (mutable_)
+        desc.pNext = &mutableDesc;
+#endif
+      CHECK_ZE_RESULT(
+          zeCommandListCreate(zeContext_, zeDevice_, &desc, &zeCommandList_));
+    }
+    CHECK_ZE_RESULT(
+        zeCommandListAppendWaitOnEvents(zeCommandList_, 1, &startEvent_));
+    CHECK_ZE_RESULT(zeCommandListAppendEventReset(zeCommandList_, startEvent_));
+    CHECK_ZE_RESULT(zeCommandListAppendEventReset(zeCommandList_, doneEvent_));
+    for (size_t i = 0; i < launches_.size(); ++i) {
+      auto &launch = launches_[i];
+      // Keep the stream order of the recorded launches.
+      if (i != 0)
+        CHECK_ZE_RESULT(
+            zeCommandListAppendBarrier(zeCommandList_, nullptr, 0, nullptr));
+      auto kernelLock = kernelArgCache.lock(launch.kernel);
+      CHECK_ZE_RESULT(zeKernelSetGroupSize(launch.kernel, launch.groupSize[0],
+                                           launch.groupSize[1],
+                                           launch.groupSize[2]));
+      auto argsCount = static_cast<uint32_t>(launch.args.size());
+      for (uint32_t arg = 0; arg < argsCount; ++arg) {
+        auto &[size, value] = launch.args[arg];
+        CHECK_ZE_RESULT(zeKernelSetArgumentValue(
+            launch.kernel, arg, size, value.empty() ? nullptr : value.data()));
+      }
+      if (launch.sharedMemBytes)
+        CHECK_ZE_RESULT(zeKernelSetArgumentValue(
+            launch.kernel, argsCount, launch.sharedMemBytes, nullptr));
+      kernelArgCache.invalidate(launch.kernel);
+#ifdef ZE_MUTABLE_COMMAND_LIST_EXP_NAME
+      if (mutable_) {
+        ze_mutable_command_id_exp_desc_t idDesc = {};
+        idDesc.stype = ZE_STRUCTURE_TYPE_MUTABLE_COMMAND_ID_EXP_DESC;
+        idDesc.flags = ZE_MUTABLE_COMMAND_EXP_FLAG_KERNEL_ARGUMENTS |
+                       ZE_MUTABLE_COMMAND_EXP_FLAG_GROUP_COUNT |
+                       ZE_MUTABLE_COMMAND_EXP_FLAG_GROUP_SIZE;
+        CHECK_ZE_RESULT(zeCommandListGetNextCommandIdExp(
+            zeCommandList_, &idDesc, &launch.commandId));
+      }
+#endif
+      CHECK_ZE_RESULT(zeCommandListAppendLaunchKernel(
+          zeCommandList_, launch.kernel, &launch.groupCount, nullptr, 0,
+          nullptr));
+    }
+    CHECK_ZE_RESULT(
+        zeCommandListAppendBarrier(zeCommandList_, doneEvent_, 0, nullptr));
+  }
+
+  // Patches the launches at \p changed, which differ from \p old in their
+  // arguments, group counts or group sizes only, in the mutable list.
+  void update(const std::vector<size_t> &changed,
+              const std::vector<Launch> &old) {
+#ifdef ZE_MUTABLE_COMMAND_LIST_EXP_NAME
+    // The descriptors are chained through pointers, so their storage must
+    // not move.
+    size_t descsCount = 0;
+    for (auto i : changed)
+      descsCount += launches_[i].args.size() + 1;
+    std::vector<ze_mutable_kernel_argument_exp_desc_t> argDescs;
+    std::vector<ze_mutable_group_count_exp_desc_t> countDescs;
+    std::vector<ze_mutable_group_size_exp_desc_t> sizeDescs;
+    argDescs.reserve(descsCount);
+    countDescs.reserve(changed.size());
+    sizeDescs.reserve(changed.size());
+    const void *next = nullptr;
+    auto addArg = [&](uint64_t commandId, uint32_t index, size_t size,
+                      const void *value) {
+      auto &desc = argDescs.emplace_back();
+      desc.stype = ZE_STRUCTURE_TYPE_MUTABLE_KERNEL_ARGUMENT_EXP_DESC;
+      desc.pNext = next;
+      desc.commandId = commandId;
+      desc.argIndex = index;
+      desc.argSize = size;
+      desc.pArgValue = value;
+      next = &desc;
+    };
+    for (auto i : changed) {
+      auto &launch = launches_[i];
+      auto &prev = old[i];
+      auto argsCount = static_cast<uint32_t>(launch.args.size());
+      for (uint32_t arg = 0; arg < argsCount; ++arg) {
+        auto &[size, value] = launch.args[arg];
+        if (launch.args[arg] != prev.args[arg])
+          addArg(launch.commandId, arg, size,
+                 value.empty() ? nullptr : value.data());
+      }
+      if (launch.sharedMemBytes != prev.sharedMemBytes)
+        addArg(launch.commandId, argsCount, launch.sharedMemBytes, nullptr);
+      if (launch.groupCount.groupCountX != prev.groupCount.groupCountX ||
+          launch.groupCount.groupCountY != prev.groupCount.groupCountY ||
+          launch.groupCount.groupCountZ != prev.groupCount.groupCountZ) {
+        auto &desc = countDescs.emplace_back();
+        desc.stype = ZE_STRUCTURE_TYPE_MUTABLE_GROUP_COUNT_EXP_DESC;
+        desc.pNext = next;
+        desc.commandId = launch.commandId;
+        desc.pGroupCount = &launch.groupCount;
+        next = &desc;
+      }
+      if (!std::equal(std::begin(launch.groupSize), std::end(launch.groupSize),
+                      std::begin(prev.groupSize))) {
+        auto &desc = sizeDescs.emplace_back();
+        desc.stype = ZE_STRUCTURE_TYPE_MUTABLE_GROUP_SIZE_EXP_DESC;
+        desc.pNext = next;
+        desc.commandId = launch.commandId;
+        desc.groupSizeX = launch.groupSize[0];
+        desc.groupSizeY = launch.groupSize[1];
+        desc.groupSizeZ = launch.groupSize[2];
+        next = &desc;
+      }
+    }
+    ze_mutable_commands_exp_desc_t desc = {};
+    desc.stype = ZE_STRUCTURE_TYPE_MUTABLE_COMMANDS_EXP_DESC;
+    desc.pNext = next;
+    CHECK_ZE_RESULT(
+        zeCommandListUpdateMutableCommandsExp(zeCommandList_, &desc));
+#else
+    (void)changed;
+    (void)old;
+    assert(false && "mutable command lists are not supported");
+#endif
+  }
+
+  ze_context_handle_t zeContext_;
+  ze_device_handle_t zeDevice_;
+  uint32_t ordinal_;
+  EventPool &eventPool_;
+  bool mutable_;
+  ze_event_handle_t startEvent_;
+  ze_event_handle_t doneEvent_;
+  ze_command_list_handle_t zeCommandList_ = nullptr;
+  // The launches in the list and the ones recorded since begin().
+  std::vector<Launch> launches_;
+  std::vector<Launch> recorded_;
+  bool submitted_ = false;
+};
+
+// A ring of pinned host buffers through which synchronous copies between
+// pageable host memory and device memory are staged. The driver copies
+// pageable memory through its own staging buffer and serializes the host and
+// device sides of the transfer; staging in chunks lets the host copy of one
+// chunk overlap with the device copy of the previous ones. The buffers are
+// allocated on first use and released with the queue. Staging can be disabled
+// through the IMEX_DISABLE_COPY_STAGING environment variable.
+class StagingRing {
+public:
+  static constexpr size_t chunkSize = 4 << 20;
+  static constexpr size_t numSlots = 3;
+  // Smaller copies are not worth the extra host copy.
+  static constexpr size_t minStagedSize = 1 << 20;
+
+  StagingRing() : enabled_(!getenv("IMEX_DISABLE_COPY_STAGING")) {}
+
+  StagingRing(const StagingRing &) = delete;
+  StagingRing &operator=(const StagingRing &) = delete;
+
+  // Whether a copy of \p size bytes from \p srcPtr to \p dstPtr is between
+  // pageable host memory and device memory and large enough to be staged.
+  bool shouldStage(ze_context_handle_t zeContext, const void *dstPtr,
+                   const void *srcPtr, size_t size) const {
+    if (!enabled_ || size < minStagedSize)
+      return false;
+    auto dstType = getMemoryType(zeContext, dstPtr);
+    auto srcType = getMemoryType(zeContext, srcPtr);
+    return (srcType == ZE_MEMORY_TYPE_UNKNOWN &&
+            dstType == ZE_MEMORY_TYPE_DEVICE) ||
+           (srcType == ZE_MEMORY_TYPE_DEVICE &&
+            dstType == ZE_MEMORY_TYPE_UNKNOWN);
+  }
+
+  // Copies \p size bytes through the ring on \p zeCommandList and waits for
+  // the copy to finish. Either \p dstPtr or \p srcPtr is pageable memory,
+  // the other one device memory.
+  void copy(ze_context_handle_t zeContext,
+            ze_command_list_handle_t zeCommandList, EventPool &eventPool,
+            void *dstPtr, const void *srcPtr, size_t size) {
+    auto dst = static_cast<char *>(dstPtr);
+    auto src = static_cast<const char *>(srcPtr);
+    auto numChunks = (size + chunkSize - 1) / chunkSize;
+    auto chunkBytes = [&](size_t i) {
+      return std::min(chunkSize, size - i * chunkSize);
+    };
+
+    if (getMemoryType(zeContext, srcPtr) == ZE_MEMORY_TYPE_UNKNOWN) {
+      // Upload: fill a slot once its previous chunk has reached the device.
+      for (size_t i = 0; i < numChunks; ++i) {
+        auto &slot = getSlot(zeContext, i % numSlots);
+        wait(eventPool, slot);
+        std::memcpy(slot.buffer, src + i * chunkSize, chunkBytes(i));
+        slot.zeEvent = eventPool.acquire();
+        CHECK_ZE_RESULT(zeCommandListAppendMemoryCopy(
+            zeCommandList, dst + i * chunkSize, slot.buffer, chunkBytes(i),
+            slot.zeEvent, 0, nullptr));
+      }
+    } else {
+      // Download: keep all slots in flight and drain them in order.
+      auto enqueue = [&](size_t i) {
+        if (i >= numChunks)
+          return;
+        auto &slot = getSlot(zeContext, i % numSlots);
+        slot.zeEvent = eventPool.acquire();
+        CHECK_ZE_RESULT(zeCommandListAppendMemoryCopy(
+            zeCommandList, slot.buffer, src + i * chunkSize, chunkBytes(i),
+            slot.zeEvent, 0, nullptr));
+      };
+      for (size_t i = 0; i < numSlots; ++i)
+        enqueue(i);
+      for (size_t i = 0; i < numChunks; ++i) {
+        auto &slot = slots_[i % numSlots];
+        wait(eventPool, slot);
+        std::memcpy(dst + i * chunkSize, slot.buffer, chunkBytes(i));
+        enqueue(i + numSlots);
+      }
+    }
+    for (auto &slot : slots_)
+      wait(eventPool, slot);
+  }
+
+  void release(ze_context_handle_t zeContext) {
+    for (auto &slot : slots_) {
+      if (slot.buffer)
+        CHECK_ZE_RESULT(zeMemFree(zeContext, slot.buffer));
+      slot.buffer = nullptr;
+    }
+  }
+
+  // Returns the type of the allocation holding \p ptr;
+  // ZE_MEMORY_TYPE_UNKNOWN for memory not allocated through Level Zero.
+  static ze_memory_type_t getMemoryType(ze_context_handle_t zeContext,
+                                        const void *ptr) {
+    ze_memory_allocation_properties_t props = {};
+    props.stype = ZE_STRUCTURE_TYPE_MEMORY_ALLOCATION_PROPERTIES;
+    if (zeMemGetAllocProperties(zeContext, ptr, &props, nullptr) !=
+        ZE_RESULT_SUCCESS)
+      return ZE_MEMORY_TYPE_UNKNOWN;
+    return props.type;
+  }
+
+private:
+  struct Slot {
+    void *buffer = nullptr;
+    // Event of the copy in flight from or to the buffer, if any.
+    ze_event_handle_t zeEvent = nullptr;
+  };
+
+  Slot &getSlot(ze_context_handle_t zeContext, size_t index) {
+    auto &slot = slots_[index];
+    if (!slot.buffer) {
+      ze_host_mem_alloc_desc_t hostDesc = {};
+      hostDesc.stype = ZE_STRUCTURE_TYPE_HOST_MEM_ALLOC_DESC;
+      CHECK_ZE_RESULT(zeMemAllocHost(zeContext, &hostDesc, chunkSize,
+                                     defaultAlignment, &slot.buffer));
+    }
+    return slot;
+  }
+
+  static void wait(EventPool &eventPool, Slot &slot) {
+    if (!slot.zeEvent)
+      return;
+    CHECK_ZE_RESULT(zeEventHostSynchronize(slot.zeEvent, UINT64_MAX));
+    eventPool.release(slot.zeEvent);
+    slot.zeEvent = nullptr;
+  }
+
+  bool enabled_;
+  Slot slots_[numSlots];
 };
 
 struct GPUL0QUEUE {
@@ -227,76 +1414,314 @@ struct GPUL0QUEUE {
   ze_driver_handle_t zeDriver_ = nullptr;
   ze_device_handle_t zeDevice_ = nullptr;
   ze_context_handle_t zeContext_ = nullptr;
+  // Whether zeContext_ was created by the queue rather than passed in.
+  bool ownsContext_ = false;
+  // Whether zeContext_ is the one of another queue, which then owns the
+  // modules loaded in it.
+  bool sharesContext_ = false;
   ze_command_list_handle_t zeCommandList_ = nullptr;
+  ze_command_list_handle_t zeCopyCommandList_ = nullptr;
+  MemoryPool memPool_;
+  std::unique_ptr<EventPool> eventPool_;
+  std::unique_ptr<EventPool> timestampEventPool_;
+  // Events signaled by submitted commands that have not been waited on yet.
+  std::vector<ze_event_handle_t> pendingEvents_;
+  // The last event signaled on a command list: the event of a barrier
+  // waiting for all commands appended to the list before it, or null if the
+  // list is idle since the last gpuWait. It is stale once other commands are
+  // appended and refreshed by the next deferFree, which thus waits for one
+  // event per list rather than for all pending events.
+  struct ListTail {
+    ze_event_handle_t zeEvent = nullptr;
+    bool stale = false;
+  };
+  ListTail computeTail_;
+  ListTail copyTail_;
+  uint32_t computeOrdinal_ = 0;
+  // Command queue executing the command lists of replayed graphs, created on
+  // the first replay.
+  ze_command_queue_handle_t zeGraphCommandQueue_ = nullptr;
+  // Recorded graphs, keyed by the id of the region passed to gpuGraphBegin.
+  std::map<const void *, std::unique_ptr<CommandGraph>> graphs_;
+  // The graph being recorded or replayed, if any.
+  CommandGraph *activeGraph_ = nullptr;
+  // A command recorded by the kernel profiler or the trace recorder that has
+  // not been waited on yet: its timestamp event, the profiler key and, in
+  // metrics mode, the metric query of profiled launches, and what to show in
+  // the trace for traced commands.
+  struct PendingProfile {
+    ze_event_handle_t zeEvent = nullptr;
+    std::optional<imex::KernelProfiler::Key> key;
+    zet_metric_query_handle_t zetQuery = nullptr;
+    const char *traceCategory = nullptr;
+    std::string traceName;
+    size_t traceBytes = 0;
+  };
+  std::vector<PendingProfile> pendingProfiles_;
+  // Hardware counter collection, created with the first profiled launch if
+  // IMEX_PROFILING_METRICS is set.
+  std::unique_ptr<MetricCollector> metrics_;
+  uint64_t zeTimestampMaxValue_ = 0;
+  uint64_t zeTimerResolution_ = 0;
+  // Memory released by gpuMemFree, with the event of the barrier ordering the
+  // release after the work using it. The memory goes back to the pool (or the
+  // driver) once the event is signaled.
+  std::vector<std::pair<void *, ze_event_handle_t>> deferredFrees_;
+  // Pinned buffers staging large synchronous copies from pageable memory.
+  StagingRing stagingRing_;
+  // Accounting of gpuMemAlloc and gpuMemFree if IMEX_MEMORY_STATS is set, the
+  // summary is printed when the stream is destroyed.
+  std::unique_ptr<imex::MemoryTracker> memoryTracker_ =
+      imex::MemoryTracker::create();
+  // Device copies of constant globals made by gpuMemAllocConstant, keyed by
+  // the address of the global. They live as long as the queue.
+  std::unordered_map<const void *, void *> constantBuffers_;
+  // Queues returned by gpuStreamGetSubstream, in the context of this one,
+  // indexed by the substream index minus one.
+  std::vector<std::unique_ptr<GPUL0QUEUE>> substreams_;
+
+  // Event pools are created lazily since the context is only known at the end
+  // of the constructors.
+  EventPool &getEventPool(bool timestamps = false) {
+    auto &pool = timestamps ? timestampEventPool_ : eventPool_;
+    if (!pool)
+      pool = std::make_unique<EventPool>(zeContext_, timestamps);
+    return *pool;
+  }
 
-  GPUL0QUEUE() {
-    auto driverAndDevice = getDriverAndDevice();
-    zeDriver_ = driverAndDevice.first;
-    zeDevice_ = driverAndDevice.second;
+  // Take an event from the pool for a command submitted to the queue. The
+  // event is recycled by the next gpuWait.
+  ze_event_handle_t acquirePendingEvent() {
+    auto zeEvent = getEventPool().acquire();
+    pendingEvents_.push_back(zeEvent);
+    return zeEvent;
+  }
 
-    ze_context_desc_t contextDesc = {ZE_STRUCTURE_TYPE_CONTEXT_DESC, nullptr,
-                                     0};
-    CHECK_ZE_RESULT(zeContextCreate(zeDriver_, &contextDesc, &zeContext_));
+  // Take a timestamp event for a command recorded by the kernel profiler or
+  // the trace recorder, as described by \p profile. The command is recorded
+  // and the event recycled by the next gpuWait. In metrics mode, a metric
+  // query is begun on the compute list for profiled launches and returned in
+  // \p zetQuery; the caller ends it after appending the launch.
+  ze_event_handle_t acquireProfiledEvent(PendingProfile profile,
+                                         zet_metric_query_handle_t &zetQuery) {
+    if (!zeTimerResolution_) {
+      ze_device_properties_t deviceProperties{};
+      deviceProperties.stype = ZE_STRUCTURE_TYPE_DEVICE_PROPERTIES;
+      CHECK_ZE_RESULT(zeDeviceGetProperties(zeDevice_, &deviceProperties));
+      zeTimestampMaxValue_ =
+          ((1ULL << deviceProperties.kernelTimestampValidBits) - 1ULL);
+      zeTimerResolution_ = deviceProperties.timerResolution;
+      if (auto groupName = getenv("IMEX_PROFILING_METRICS"))
+        metrics_ =
+            std::make_unique<MetricCollector>(zeContext_, zeDevice_, groupName);
+    }
+    zetQuery = nullptr;
+    if (profile.key && metrics_ && metrics_->isValid()) {
+      zetQuery = metrics_->acquire();
+      CHECK_ZE_RESULT(
+          zetCommandListAppendMetricQueryBegin(zeCommandList_, zetQuery));
+    }
+    profile.zeEvent = getEventPool(/*timestamps=*/true).acquire();
+    profile.zetQuery = zetQuery;
+    pendingProfiles_.push_back(std::move(profile));
+    return pendingProfiles_.back().zeEvent;
+  }
 
-    uint32_t numQueueGroups = 0;
-    CHECK_ZE_RESULT(zeDeviceGetCommandQueueGroupProperties(
-        zeDevice_, &numQueueGroups, nullptr));
+  // Take an event for a memory command of \p bytes, a timestamp event shown
+  // in the trace as \p traceCategory if tracing is enabled.
+  ze_event_handle_t acquireCommandEvent(const char *traceCategory,
+                                        size_t bytes) {
+    if (!imex::TraceRecorder::get())
+      return acquirePendingEvent();
+    PendingProfile profile;
+    profile.traceCategory = traceCategory;
+    profile.traceName = traceCategory;
+    profile.traceBytes = bytes;
+    zet_metric_query_handle_t zetQuery;
+    return acquireProfiledEvent(std::move(profile), zetQuery);
+  }
 
-    std::vector<ze_command_queue_group_properties_t> queueProperties(
-        numQueueGroups);
-    CHECK_ZE_RESULT(zeDeviceGetCommandQueueGroupProperties(
-        zeDevice_, &numQueueGroups, queueProperties.data()));
+  // Notes that a command was appended to \p zeCommandList, one of the lists
+  // of the queue.
+  void markAppended(ze_command_list_handle_t zeCommandList) {
+    auto &tail =
+        zeCommandList == zeCopyCommandList_ ? copyTail_ : computeTail_;
+    tail.stale = true;
+  }
 
-    ze_command_queue_desc_t desc = {};
-    desc.mode = ZE_COMMAND_QUEUE_MODE_SYNCHRONOUS;
-    for (uint32_t i = 0; i < numQueueGroups; i++) {
-      if (queueProperties[i].flags &
-          ZE_COMMAND_QUEUE_GROUP_PROPERTY_FLAG_COMPUTE) {
-        desc.ordinal = i;
-      }
+  // Returns the last event signaled on \p zeCommandList, whose tail is
+  // \p tail, appending a barrier for it if commands were appended since.
+  ze_event_handle_t getTailEvent(ze_command_list_handle_t zeCommandList,
+                                 ListTail &tail) {
+    if (tail.stale) {
+      tail.zeEvent = acquirePendingEvent();
+      CHECK_ZE_RESULT(
+          zeCommandListAppendBarrier(zeCommandList, tail.zeEvent, 0, nullptr));
+      tail.stale = false;
     }
-    CHECK_ZE_RESULT(zeCommandListCreateImmediate(zeContext_, zeDevice_, &desc,
-                                                 &zeCommandList_));
+    return tail.zeEvent;
   }
 
-  GPUL0QUEUE(ze_device_type_t *deviceType, ze_context_handle_t context) {
-    auto driverAndDevice = getDriverAndDevice(*deviceType);
-    zeDriver_ = driverAndDevice.first;
-    zeDevice_ = driverAndDevice.second;
+  // Wait for all pending events and return them to the pool. Events are only
+  // reset once all are signaled, since barriers may still be waiting on them.
+  void synchronize() {
+    // Commands of substreams may wait for events of this queue and the other
+    // way round, so all of them have to be done before any event is reused.
+    for (auto &substream : substreams_)
+      if (substream)
+        substream->waitPendingEvents();
+    reclaimFrees(/*wait=*/true);
+    for (auto zeEvent : pendingEvents_)
+      CHECK_ZE_RESULT(zeEventHostSynchronize(zeEvent, UINT64_MAX));
+    for (auto zeEvent : pendingEvents_)
+      eventPool_->release(zeEvent);
+    pendingEvents_.clear();
+    computeTail_ = {};
+    copyTail_ = {};
+
+    for (auto &profile : pendingProfiles_)
+      CHECK_ZE_RESULT(zeEventHostSynchronize(profile.zeEvent, UINT64_MAX));
+
+    // Device timestamps are mapped to the host clock of the trace through a
+    // pair of host and device timestamps taken now, after the commands, which
+    // holds as long as the device timer did not wrap around since.
+    auto trace = imex::TraceRecorder::get();
+    uint64_t traceHostNs = 0, traceDeviceTicks = 0;
+    if (trace && !pendingProfiles_.empty()) {
+      uint64_t hostTimestamp;
+      CHECK_ZE_RESULT(zeDeviceGetGlobalTimestamps(zeDevice_, &hostTimestamp,
+                                                  &traceDeviceTicks));
+      traceHostNs = imex::TraceRecorder::now();
+    }
+    auto toHostNs = [&](uint64_t ticks) {
+      return traceHostNs -
+             ((traceDeviceTicks - ticks) & zeTimestampMaxValue_) *
+                 zeTimerResolution_;
+    };
 
-    zeContext_ = context;
+    for (auto &profile : pendingProfiles_) {
+      ze_kernel_timestamp_result_t tsResult;
+      CHECK_ZE_RESULT(zeEventQueryKernelTimestamp(profile.zeEvent, &tsResult));
+      uint64_t startTime = tsResult.global.kernelStart & zeTimestampMaxValue_;
+      uint64_t endTime = tsResult.global.kernelEnd & zeTimestampMaxValue_;
+      if (endTime < startTime)
+        endTime += zeTimestampMaxValue_;
+      timestampEventPool_->release(profile.zeEvent);
+      auto durationNs = (endTime - startTime) * zeTimerResolution_;
+      if (profile.traceCategory) {
+        auto startNs = toHostNs(startTime);
+        trace->recordDevice(profile.traceCategory, std::move(profile.traceName),
+                            startNs, startNs + durationNs, profile.traceBytes);
+      }
+      if (!profile.key)
+        continue;
+      auto profiler = imex::KernelProfiler::get();
+      profiler->record(*profile.key, durationNs);
+      if (profile.zetQuery) {
+        profiler->recordMetrics(*profile.key, metrics_->read(profile.zetQuery));
+        metrics_->release(profile.zetQuery);
+      }
+    }
+    pendingProfiles_.clear();
 
-    uint32_t numQueueGroups = 0;
-    CHECK_ZE_RESULT(zeDeviceGetCommandQueueGroupProperties(
-        zeDevice_, &numQueueGroups, nullptr));
+    for (auto &substream : substreams_)
+      if (substream)
+        substream->synchronize();
+  }
 
-    std::vector<ze_command_queue_group_properties_t> queueProperties(
-        numQueueGroups);
-    CHECK_ZE_RESULT(zeDeviceGetCommandQueueGroupProperties(
-        zeDevice_, &numQueueGroups, queueProperties.data()));
+  // Blocks until the commands submitted so far are done, without recording
+  // them or reusing their events.
+  void waitPendingEvents() {
+    for (auto zeEvent : pendingEvents_)
+      CHECK_ZE_RESULT(zeEventHostSynchronize(zeEvent, UINT64_MAX));
+    for (auto &profile : pendingProfiles_)
+      CHECK_ZE_RESULT(zeEventHostSynchronize(profile.zeEvent, UINT64_MAX));
+  }
 
-    ze_command_queue_desc_t desc = {};
-    desc.mode = ZE_COMMAND_QUEUE_MODE_SYNCHRONOUS;
-    for (uint32_t i = 0; i < numQueueGroups; i++) {
-      if (queueProperties[i].flags &
-          ZE_COMMAND_QUEUE_GROUP_PROPERTY_FLAG_COMPUTE) {
-        desc.ordinal = i;
-      }
-    }
-    CHECK_ZE_RESULT(zeCommandListCreateImmediate(zeContext_, zeDevice_, &desc,
-                                                 &zeCommandList_));
+  // Blocks until the commands submitted so far to the queue and its
+  // substreams are done. Unlike synchronize, no event is reused, since the
+  // caller may still hold them as async tokens.
+  void waitSubmitted() {
+    waitPendingEvents();
+    for (auto &substream : substreams_)
+      if (substream)
+        substream->waitSubmitted();
   }
 
-  GPUL0QUEUE(ze_device_type_t *deviceType) {
+  // Returns the substream \p index, 0 being the queue itself, creating it on
+  // first use.
+  GPUL0QUEUE *getSubstream(int64_t index) {
+    if (index <= 0)
+      return this;
+    if (substreams_.size() < static_cast<size_t>(index))
+      substreams_.resize(index);
+    auto &substream = substreams_[index - 1];
+    if (!substream)
+      substream = std::make_unique<GPUL0QUEUE>(this);
+    return substream.get();
+  }
 
-    auto driverAndDevice = getDriverAndDevice(*deviceType);
-    zeDriver_ = driverAndDevice.first;
-    zeDevice_ = driverAndDevice.second;
+  // Appends the last events of the copy list and of the substreams, which
+  // are not ordered with the compute list, to \p events.
+  void addOtherTailEvents(std::vector<ze_event_handle_t> &events) {
+    auto addTail = [&](GPUL0QUEUE &queue, ze_command_list_handle_t list,
+                       ListTail &tail) {
+      if (auto zeEvent = queue.getTailEvent(list, tail))
+        events.push_back(zeEvent);
+    };
+    if (zeCopyCommandList_)
+      addTail(*this, zeCopyCommandList_, copyTail_);
+    for (auto &substream : substreams_) {
+      if (!substream)
+        continue;
+      addTail(*substream, substream->zeCommandList_, substream->computeTail_);
+      if (substream->zeCopyCommandList_)
+        addTail(*substream, substream->zeCopyCommandList_,
+                substream->copyTail_);
+    }
+  }
+
+  // Releases \p ptr once \p depEvents are signaled or, if there are none,
+  // once all work submitted so far is done, without blocking the host.
+  // zeMemFree would wait for outstanding work using the memory.
+  void deferFree(void *ptr, EventDesc *depEvents) {
+    auto waitEvents = getWaitEvents(depEvents);
+    // The barrier follows the commands of the compute list, but the copy
+    // list and the substreams are not ordered with it.
+    if (waitEvents.empty())
+      addOtherTailEvents(waitEvents);
+    auto zeEvent = getEventPool().acquire();
+    CHECK_ZE_RESULT(zeCommandListAppendBarrier(
+        zeCommandList_, zeEvent, static_cast<uint32_t>(waitEvents.size()),
+        waitEvents.data()));
+    deferredFrees_.emplace_back(ptr, zeEvent);
+    reclaimFrees(/*wait=*/false);
+  }
 
-    ze_context_desc_t contextDesc = {ZE_STRUCTURE_TYPE_CONTEXT_DESC, nullptr,
-                                     0};
-    CHECK_ZE_RESULT(zeContextCreate(zeDriver_, &contextDesc, &zeContext_));
+  // Releases the memory of the deferred frees whose event is signaled, or of
+  // all of them if \p wait is set.
+  void reclaimFrees(bool wait) {
+    size_t kept = 0;
+    for (auto &[ptr, zeEvent] : deferredFrees_) {
+      if (wait)
+        CHECK_ZE_RESULT(zeEventHostSynchronize(zeEvent, UINT64_MAX));
+      else if (zeEventQueryStatus(zeEvent) != ZE_RESULT_SUCCESS) {
+        deferredFrees_[kept++] = {ptr, zeEvent};
+        continue;
+      }
+      eventPool_->release(zeEvent);
+      memPool_.free(zeContext_, ptr);
+    }
+    deferredFrees_.resize(kept);
+  }
 
+  // Create the immediate command lists of the queue: one on the compute
+  // engine group used for kernels and fills and, if the device has a copy-only
+  // engine group (the blitter engines on PVC), a second one used for memory
+  // copies so that transfers can overlap with kernels. Ordering between the
+  // two lists is expressed through events. Setting IMEX_DISABLE_COPY_ENGINE
+  // routes copies through the compute list.
+  void createCommandLists() {
     uint32_t numQueueGroups = 0;
     CHECK_ZE_RESULT(zeDeviceGetCommandQueueGroupProperties(
         zeDevice_, &numQueueGroups, nullptr));
@@ -307,170 +1732,475 @@ struct GPUL0QUEUE {
         zeDevice_, &numQueueGroups, queueProperties.data()));
 
     ze_command_queue_desc_t desc = {};
-    desc.mode = ZE_COMMAND_QUEUE_MODE_SYNCHRONOUS;
+    desc.mode = ZE_COMMAND_QUEUE_MODE_ASYNCHRONOUS;
+    int64_t copyOrdinal = -1;
     for (uint32_t i = 0; i < numQueueGroups; i++) {
-      if (queueProperties[i].flags &
-          ZE_COMMAND_QUEUE_GROUP_PROPERTY_FLAG_COMPUTE) {
+      auto flags = queueProperties[i].flags;
+      if (flags & ZE_COMMAND_QUEUE_GROUP_PROPERTY_FLAG_COMPUTE) {
         desc.ordinal = i;
+        computeOrdinal_ = i;
+      } else if ((flags & ZE_COMMAND_QUEUE_GROUP_PROPERTY_FLAG_COPY) &&
+                 copyOrdinal < 0) {
+        copyOrdinal = i;
       }
     }
     CHECK_ZE_RESULT(zeCommandListCreateImmediate(zeContext_, zeDevice_, &desc,
                                                  &zeCommandList_));
+
+    if (copyOrdinal < 0 || getenv("IMEX_DISABLE_COPY_ENGINE"))
+      return;
+
+    desc.ordinal = static_cast<uint32_t>(copyOrdinal);
+    desc.index = 0;
+    CHECK_ZE_RESULT(zeCommandListCreateImmediate(zeContext_, zeDevice_, &desc,
+                                                 &zeCopyCommandList_));
+  }
+
+  void beginGraph(const void *id) {
+    if (activeGraph_)
+      throw std::runtime_error("Nested gpuGraphBegin");
+    auto &graph = graphs_[id];
+    if (!graph)
+      graph = std::make_unique<CommandGraph>(zeContext_, zeDevice_,
+                                             computeOrdinal_, getEventPool(),
+                                             hasMutableCommandLists());
+    activeGraph_ = graph.get();
+    activeGraph_->begin();
   }
 
-  GPUL0QUEUE(ze_context_handle_t context) {
+  // Submits the active graph without waiting for it. The graph command queue
+  // is not ordered with the lists of the queue, so a barrier on the compute
+  // list signals the start of the graph once the work submitted before is
+  // done, and the lists wait for the end of the graph before later commands.
+  void endGraph() {
+    if (!activeGraph_)
+      throw std::runtime_error("gpuGraphEnd without gpuGraphBegin");
+    auto graph = activeGraph_;
+    activeGraph_ = nullptr;
+    auto commandList = graph->end();
+    if (!commandList)
+      return;
+
+    if (!zeGraphCommandQueue_) {
+      ze_command_queue_desc_t desc = {};
+      desc.stype = ZE_STRUCTURE_TYPE_COMMAND_QUEUE_DESC;
+      desc.ordinal = computeOrdinal_;
+      desc.mode = ZE_COMMAND_QUEUE_MODE_ASYNCHRONOUS;
+      CHECK_ZE_RESULT(zeCommandQueueCreate(zeContext_, zeDevice_, &desc,
+                                           &zeGraphCommandQueue_));
+    }
+    std::vector<ze_event_handle_t> waitEvents;
+    addOtherTailEvents(waitEvents);
+    CHECK_ZE_RESULT(zeCommandListAppendBarrier(
+        zeCommandList_, graph->getStartEvent(),
+        static_cast<uint32_t>(waitEvents.size()), waitEvents.data()));
+    CHECK_ZE_RESULT(zeCommandQueueExecuteCommandLists(
+        zeGraphCommandQueue_, 1, &commandList, nullptr));
+    graph->markSubmitted();
+
+    // The pending event lets gpuWait wait for the graph.
+    auto doneEvent = graph->getDoneEvent();
+    CHECK_ZE_RESULT(zeCommandListAppendBarrier(
+        zeCommandList_, acquirePendingEvent(), 1, &doneEvent));
+    markAppended(zeCommandList_);
+    if (zeCopyCommandList_) {
+      CHECK_ZE_RESULT(zeCommandListAppendBarrier(zeCopyCommandList_, nullptr,
+                                                 1, &doneEvent));
+      markAppended(zeCopyCommandList_);
+    }
+  }
 
-    auto driverAndDevice = getDriverAndDevice();
+  // Whether the driver can patch the arguments, group counts and group sizes
+  // of kernels in a command list.
+  bool hasMutableCommandLists() const {
+#ifdef ZE_MUTABLE_COMMAND_LIST_EXP_NAME
+    uint32_t count = 0;
+    CHECK_ZE_RESULT(zeDriverGetExtensionProperties(zeDriver_, &count, nullptr));
+    std::vector<ze_driver_extension_properties_t> extensions(count);
+    CHECK_ZE_RESULT(
+        zeDriverGetExtensionProperties(zeDriver_, &count, extensions.data()));
+    if (std::none_of(extensions.begin(), extensions.end(), [](auto &ext) {
+          return std::strcmp(ext.name, ZE_MUTABLE_COMMAND_LIST_EXP_NAME) == 0;
+        }))
+      return false;
+    ze_mutable_command_list_exp_properties_t mutableProperties = {};
+    mutableProperties.stype =
+        ZE_STRUCTURE_TYPE_MUTABLE_COMMAND_LIST_EXP_PROPERTIES;
+    ze_device_properties_t properties = {};
+    properties.stype = ZE_STRUCTURE_TYPE_DEVICE_PROPERTIES;
+    properties.pNext = &mutableProperties;
+    CHECK_ZE_RESULT(zeDeviceGetProperties(zeDevice_, &properties));
+    auto required = ZE_MUTABLE_COMMAND_EXP_FLAG_KERNEL_ARGUMENTS |
+                    ZE_MUTABLE_COMMAND_EXP_FLAG_GROUP_COUNT |
+                    ZE_MUTABLE_COMMAND_EXP_FLAG_GROUP_SIZE;
+    return (mutableProperties.mutableCommandFlags & required) == required;
+#else
+    return false;
+#endif
+  }
+
+  ze_command_list_handle_t getCopyCommandList() const {
+    return zeCopyCommandList_ ? zeCopyCommandList_ : zeCommandList_;
+  }
+
+  // Creates a queue on the device chosen by deviceType and selection. If no
+  // context is given, the queue creates and owns one.
+  GPUL0QUEUE(ze_device_type_t deviceType = ZE_DEVICE_TYPE_GPU,
+             ze_context_handle_t context = nullptr,
+             imex::DeviceSelection selection = {}) {
+    auto driverAndDevice = getDriverAndDevice(deviceType, selection);
     zeDriver_ = driverAndDevice.first;
     zeDevice_ = driverAndDevice.second;
-    zeContext_ = context;
 
-    uint32_t numQueueGroups = 0;
-    CHECK_ZE_RESULT(zeDeviceGetCommandQueueGroupProperties(
-        zeDevice_, &numQueueGroups, nullptr));
+    if (context) {
+      zeContext_ = context;
+    } else {
+      ze_context_desc_t contextDesc = {ZE_STRUCTURE_TYPE_CONTEXT_DESC,
+                                       nullptr, 0};
+      CHECK_ZE_RESULT(zeContextCreate(zeDriver_, &contextDesc, &zeContext_));
+      ownsContext_ = true;
+    }
 
-    std::vector<ze_command_queue_group_properties_t> queueProperties(
-        numQueueGroups);
-    CHECK_ZE_RESULT(zeDeviceGetCommandQueueGroupProperties(
-        zeDevice_, &numQueueGroups, queueProperties.data()));
+    createCommandLists();
+  }
 
-    ze_command_queue_desc_t desc = {};
-    desc.mode = ZE_COMMAND_QUEUE_MODE_SYNCHRONOUS;
-    for (uint32_t i = 0; i < numQueueGroups; i++) {
-      if (queueProperties[i].flags &
-          ZE_COMMAND_QUEUE_GROUP_PROPERTY_FLAG_COMPUTE) {
-        desc.ordinal = i;
-      }
-    }
-    CHECK_ZE_RESULT(zeCommandListCreateImmediate(zeContext_, zeDevice_, &desc,
-                                                 &zeCommandList_));
+  // Creates a queue on the device and in the context of \p queue, which has
+  // to outlive it.
+  explicit GPUL0QUEUE(const GPUL0QUEUE *queue)
+      : zeDriver_(queue->zeDriver_), zeDevice_(queue->zeDevice_),
+        zeContext_(queue->zeContext_), sharesContext_(true) {
+    createCommandLists();
   }
 
   ~GPUL0QUEUE() {
     // Device and Driver resource management is dony by L0.
     // Just release context and commandList.
     // TODO: Use unique ptrs.
-    if (zeContext_)
-      CHECK_ZE_RESULT(zeContextDestroy(zeContext_));
+    // Wait for outstanding work, which also records pending profiles.
+    synchronize();
+    // Substreams use the context of the queue.
+    substreams_.clear();
+
+    if (getenv("IMEX_ENABLE_PROFILING"))
+      memPool_.printStatistics();
 
     if (zeCommandList_)
       CHECK_ZE_RESULT(zeCommandListDestroy(zeCommandList_));
+
+    if (zeCopyCommandList_)
+      CHECK_ZE_RESULT(zeCommandListDestroy(zeCopyCommandList_));
+
+    graphs_.clear();
+    if (zeGraphCommandQueue_)
+      CHECK_ZE_RESULT(zeCommandQueueDestroy(zeGraphCommandQueue_));
+
+    // Events have to be destroyed before the context they were created in.
+    pendingEvents_.clear();
+    eventPool_.reset();
+    timestampEventPool_.reset();
+    metrics_.reset();
+
+    if (zeContext_) {
+      // Modules have to be destroyed before their context as well.
+      if (!sharesContext_)
+        moduleCache.evictContext(zeContext_);
+      for (auto &[hostPtr, ptr] : constantBuffers_)
+        CHECK_ZE_RESULT(zeMemFree(zeContext_, ptr));
+      stagingRing_.release(zeContext_);
+      memPool_.release(zeContext_);
+      if (ownsContext_)
+        CHECK_ZE_RESULT(zeContextDestroy(zeContext_));
+    }
   }
 };
 
 static void *allocDeviceMemory(GPUL0QUEUE *queue, size_t size, size_t alignment,
                                bool isShared) {
-
-  void *ret = nullptr;
-  ze_device_mem_alloc_desc_t devDesc = {};
-  devDesc.stype = ZE_STRUCTURE_TYPE_DEVICE_MEM_ALLOC_DESC;
-  if (isShared) {
-    ze_host_mem_alloc_desc_t hostDesc = {};
-    hostDesc.stype = ZE_STRUCTURE_TYPE_HOST_MEM_ALLOC_DESC;
-    CHECK_ZE_RESULT(zeMemAllocShared(queue->zeContext_, &devDesc, &hostDesc,
-                                     size, alignment, queue->zeDevice_, &ret));
-  } else {
-    devDesc.flags = ZE_DEVICE_MEM_ALLOC_FLAG_BIAS_INITIAL_PLACEMENT;
-    CHECK_ZE_RESULT(zeMemAllocDevice(queue->zeContext_, &devDesc, size,
-                                     alignment, queue->zeDevice_, &ret));
-  }
-  return ret;
+  return allocUSM(queue->zeContext_, queue->zeDevice_, size, alignment,
+                  isShared);
 }
 
 static void deallocDeviceMemory(GPUL0QUEUE *queue, void *ptr) {
   CHECK_ZE_RESULT(zeMemFree(queue->zeContext_, ptr));
 }
-// @TODO: Add support for async copy
-// Currnetly, we only support synchrnous copy?
+
+// \p site is the calling function if the code was compiled with
+// alloc-site-tags, it is only used by IMEX_MEMORY_STATS.
+static void *allocPooledMemory(GPUL0QUEUE *queue, size_t size,
+                               size_t alignment, bool isShared,
+                               const char *site) {
+  // gpuMemAlloc takes 0 for no alignment requirement, the pool needs one to
+  // match cached blocks against.
+  if (!alignment)
+    alignment = defaultAlignment;
+  // Make the blocks of completed frees available for reuse.
+  queue->reclaimFrees(/*wait=*/false);
+  auto ptr = queue->memPool_.alloc(queue->zeContext_, queue->zeDevice_, size,
+                                   alignment, isShared);
+  if (queue->memoryTracker_)
+    queue->memoryTracker_->recordAlloc(ptr, size, isShared, site);
+  return ptr;
+}
+
+// The block may still be used by submitted commands, so it is only returned
+// to the pool once they are done.
+static void deallocPooledMemory(GPUL0QUEUE *queue, void *ptr,
+                                EventDesc *depEvents) {
+  if (queue->memoryTracker_)
+    queue->memoryTracker_->recordFree(ptr);
+  queue->deferFree(ptr, depEvents);
+}
+
+// The immediate command lists are asynchronous, so copies and fills signal an
+// event from the queue's pool which is returned to the caller. Dependencies
+// are passed as a null terminated array of events. Copies go to the copy
+// engine list when the device has one.
+static ze_event_handle_t memoryCopyAsync(GPUL0QUEUE *queue, void *dstPtr,
+                                         void *srcPtr, size_t size,
+                                         EventDesc *depEvents) {
+  auto waitEvents = getWaitEvents(depEvents);
+  auto zeEvent = queue->acquireCommandEvent("memcpy", size);
+  CHECK_ZE_RESULT(zeCommandListAppendMemoryCopy(
+      queue->getCopyCommandList(), dstPtr, srcPtr, size, zeEvent,
+      static_cast<uint32_t>(waitEvents.size()), waitEvents.data()));
+  queue->markAppended(queue->getCopyCommandList());
+  return zeEvent;
+}
+
 static void memoryCopy(GPUL0QUEUE *queue, void *dstPtr, void *srcPtr,
                        size_t size) {
-  CHECK_ZE_RESULT(zeCommandListAppendMemoryCopy(
-      queue->zeCommandList_, dstPtr, srcPtr, size, nullptr, 0, nullptr));
+  // Synchronous copies observe all previously submitted work. Its events are
+  // only recycled by gpuWait, the caller may still wait on them.
+  queue->waitSubmitted();
+  if (queue->stagingRing_.shouldStage(queue->zeContext_, dstPtr, srcPtr,
+                                      size)) {
+    queue->stagingRing_.copy(queue->zeContext_, queue->getCopyCommandList(),
+                             queue->getEventPool(), dstPtr, srcPtr, size);
+    return;
+  }
+  auto zeEvent = memoryCopyAsync(queue, dstPtr, srcPtr, size, nullptr);
+  CHECK_ZE_RESULT(zeEventHostSynchronize(zeEvent, UINT64_MAX));
 }
-static ze_module_handle_t loadModule(GPUL0QUEUE *queue, const void *data,
-                                     size_t dataSize) {
-  assert(data);
-  auto gpuL0Queue = queue;
-  ze_module_handle_t zeModule;
 
-  auto it = moduleCache.find((const void *)data);
-  // Check the map if the module is present/cached.
-  if (it != moduleCache.end()) {
-    return it->second.module;
+// Returns the device copy of the constant global at \p hostPtr, uploading it
+// on the first call. The copy bypasses the pool and the memory tracker since
+// it is only freed with the queue.
+static void *allocConstantMemory(GPUL0QUEUE *queue, const void *hostPtr,
+                                 size_t size, size_t alignment) {
+  auto &ptr = queue->constantBuffers_[hostPtr];
+  if (!ptr) {
+    ptr = allocDeviceMemory(queue, size, alignment, /*isShared=*/false);
+    memoryCopy(queue, ptr, const_cast<void *>(hostPtr), size);
   }
-  ze_module_desc_t desc = {};
+  return ptr;
+}
+
+static ze_event_handle_t memoryFill(GPUL0QUEUE *queue, void *dstPtr,
+                                    const void *pattern, size_t patternSize,
+                                    size_t size, EventDesc *depEvents) {
+  auto waitEvents = getWaitEvents(depEvents);
+  auto zeEvent = queue->acquireCommandEvent("memset", size);
+  CHECK_ZE_RESULT(zeCommandListAppendMemoryFill(
+      queue->zeCommandList_, dstPtr, pattern, patternSize, size, zeEvent,
+      static_cast<uint32_t>(waitEvents.size()), waitEvents.data()));
+  queue->markAppended(queue->zeCommandList_);
+  return zeEvent;
+}
+
+// Enqueues a migration of the pages of shared memory to the device of the
+// queue. zeCommandListAppendMemoryPrefetch takes no events, so the prefetch
+// is ordered after \p depEvents and signals the returned event through
+// barriers.
+static ze_event_handle_t memoryPrefetch(GPUL0QUEUE *queue, const void *ptr,
+                                        size_t size, EventDesc *depEvents) {
+  auto waitEvents = getWaitEvents(depEvents);
+  auto zeCommandList = queue->zeCommandList_;
+  if (!waitEvents.empty())
+    CHECK_ZE_RESULT(zeCommandListAppendBarrier(
+        zeCommandList, nullptr, static_cast<uint32_t>(waitEvents.size()),
+        waitEvents.data()));
+  CHECK_ZE_RESULT(zeCommandListAppendMemoryPrefetch(zeCommandList, ptr, size));
+  auto zeEvent = queue->acquirePendingEvent();
+  CHECK_ZE_RESULT(
+      zeCommandListAppendBarrier(zeCommandList, zeEvent, 0, nullptr));
+  queue->markAppended(zeCommandList);
+  return zeEvent;
+}
 
+// Memory advice of gpuMemAdvise, the lowering of gpux.mem_advise.
+enum class GpuMemAdvice : int32_t { ReadMostly = 0, PreferredLocation = 1 };
+
+static ze_memory_advice_t getZeMemAdvice(int32_t advice) {
+  switch (static_cast<GpuMemAdvice>(advice)) {
+  case GpuMemAdvice::ReadMostly:
+    return ZE_MEMORY_ADVICE_SET_READ_MOSTLY;
+  case GpuMemAdvice::PreferredLocation:
+    return ZE_MEMORY_ADVICE_SET_PREFERRED_LOCATION;
+  }
+  throw std::runtime_error("Invalid memory advice " + std::to_string(advice));
+}
+
+static void memoryAdvise(GPUL0QUEUE *queue, const void *ptr, size_t size,
+                         int32_t advice) {
+  CHECK_ZE_RESULT(zeCommandListAppendMemAdvise(queue->zeCommandList_,
+                                               queue->zeDevice_, ptr, size,
+                                               getZeMemAdvice(advice)));
+}
+
+// Enqueues a barrier signaled once all \p depEvents are, or once all work
+// previously submitted to the compute list is done if there are none.
+static ze_event_handle_t enqueueBarrier(GPUL0QUEUE *queue,
+                                        EventDesc *depEvents) {
+  auto waitEvents = getWaitEvents(depEvents);
+  auto zeEvent = queue->acquirePendingEvent();
+  CHECK_ZE_RESULT(zeCommandListAppendBarrier(
+      queue->zeCommandList_, zeEvent, static_cast<uint32_t>(waitEvents.size()),
+      waitEvents.data()));
+  queue->markAppended(queue->zeCommandList_);
+  return zeEvent;
+}
+
+// Blocks the host until all \p depEvents are signaled. Unlike gpuWait, the
+// events are not recycled.
+static void waitEvents(EventDesc *depEvents) {
+  for (auto zeEvent : getWaitEvents(depEvents))
+    CHECK_ZE_RESULT(zeEventHostSynchronize(zeEvent, UINT64_MAX));
+}
+
+// Fills \p count elements of \p type at \p dstPtr with random values, see
+// RandomFill.h. The runtime has no compiler for kernels of its own, so the
+// values are generated on the host by all threads, in place for shared and
+// host memory and otherwise in pageable memory copied through the staging
+// ring. The fill is ordered after \p depEvents.
+static ze_event_handle_t fillRandom(GPUL0QUEUE *queue, void *dstPtr,
+                                    imex::RandomFillType type, size_t count,
+                                    const imex::RandomFillParams &params,
+                                    EventDesc *depEvents) {
+  waitEvents(depEvents);
+  if (StagingRing::getMemoryType(queue->zeContext_, dstPtr) ==
+      ZE_MEMORY_TYPE_DEVICE) {
+    std::vector<char> hostBuffer(count * imex::getElementSize(type));
+    imex::fillRandomHost(hostBuffer.data(), type, count, params);
+    memoryCopy(queue, dstPtr, hostBuffer.data(), hostBuffer.size());
+  } else {
+    imex::fillRandomHost(dstPtr, type, count, params);
+  }
+  return enqueueBarrier(queue, nullptr);
+}
+
+// Returns the IGC flags of a module compiled for \p grfSize GRFs per thread,
+// or for the register file selected by IMEX_ENABLE_LARGE_REG_FILE if
+// \p grfSize is 0, with the vector backend if \p vectorBackend is nonzero or
+// IMEX_USE_IGC_VECTOR_BACK_END is set.
+static std::string getBuildFlags(int32_t grfSize, int32_t vectorBackend) {
   std::string build_flags;
   // IGC auto-detection of scalar/vector backend does not work for native BF16
   // data type yet, hence we need to pass this flag explicitly for if native
   // bf16 data type is used and we need to use vector compute.
-  if (getenv("IMEX_USE_IGC_VECTOR_BACK_END")) {
+  if (vectorBackend || getenv("IMEX_USE_IGC_VECTOR_BACK_END")) {
     build_flags += " -vc-codegen ";
   }
   // enable large register file if needed
-  if (getenv("IMEX_ENABLE_LARGE_REG_FILE")) {
+  bool largeGRF =
+      grfSize ? grfSize > 128 : getenv("IMEX_ENABLE_LARGE_REG_FILE") != nullptr;
+  if (largeGRF) {
     build_flags += "-doubleGRF -Xfinalizer -noLocalSplit -Xfinalizer "
                    "-DPASTokenReduction -Xfinalizer -SWSBDepReduction "
                    "-Xfinalizer -printregusage -Xfinalizer -enableBCR";
   }
+  return build_flags;
+}
 
-  desc.format = ZE_MODULE_FORMAT_IL_SPIRV;
-  desc.pInputModule = static_cast<const uint8_t *>(data);
-  desc.inputSize = dataSize;
-  desc.pBuildFlags = build_flags.c_str();
-  CHECK_ZE_RESULT(zeModuleCreate(gpuL0Queue->zeContext_, gpuL0Queue->zeDevice_,
-                                 &desc, &zeModule, nullptr));
-  std::lock_guard<std::mutex> entryLock(mutexLock);
-  moduleCache[(const void *)data].module = zeModule;
-  return zeModule;
+// Loads a module compiled for \p grfSize GRFs per thread, or for the register
+// file selected by IMEX_ENABLE_LARGE_REG_FILE if \p grfSize is 0. Nonzero
+// \p vectorBackend compiles it with the vector backend of IGC, which is
+// otherwise selected by IMEX_USE_IGC_VECTOR_BACK_END. The native binary for
+// the device in \p aotBinaries, if any, is used instead of the SPIR-V.
+static ze_module_handle_t loadModule(GPUL0QUEUE *queue, const void *data,
+                                     size_t dataSize, int32_t grfSize = 0,
+                                     int32_t vectorBackend = 0,
+                                     const void *aotBinaries = nullptr) {
+  assert(data);
+  auto gpuL0Queue = queue;
+
+  auto build_flags = getBuildFlags(grfSize, vectorBackend);
+
+  return moduleCache.getOrCreate(
+      gpuL0Queue->zeContext_, gpuL0Queue->zeDevice_, data, dataSize,
+      build_flags, [&]() {
+        ze_module_desc_t desc = {};
+        desc.format = ZE_MODULE_FORMAT_IL_SPIRV;
+        desc.pInputModule = static_cast<const uint8_t *>(data);
+        desc.inputSize = dataSize;
+        desc.pBuildFlags = build_flags.c_str();
+        ze_module_handle_t zeModule;
+        CHECK_ZE_RESULT(imex::ModulePreloader::get().createModule(
+            gpuL0Queue->zeContext_, gpuL0Queue->zeDevice_, desc, &zeModule,
+            aotBinaries));
+        return zeModule;
+      });
 }
 
+static void unloadModule(ze_module_handle_t module) {
+  assert(module);
+  // Destroys all cached kernels of the module as well.
+  moduleCache.evict(module);
+}
+
+// Kernels are cached per (module, name) so that repeated gpuKernelGet calls
+// for the same kernel return the same handle instead of creating a new kernel
+// object every time.
 static ze_kernel_handle_t
 getKernel(GPUL0QUEUE *queue, ze_module_handle_t module, const char *name) {
   assert(module);
   assert(name);
+  auto entry = moduleCache.lookup(module);
+  std::unique_lock<std::mutex> entryLock;
+  if (entry) {
+    entryLock = std::unique_lock<std::mutex>(entry->kernelsMutex);
+    auto it = entry->kernels.find(name);
+    if (it != entry->kernels.end())
+      return it->second;
+  }
+
   ze_kernel_desc_t desc = {};
   ze_kernel_handle_t zeKernel;
   desc.pKernelName = name;
   CHECK_ZE_RESULT(zeKernelCreate(module, &desc, &zeKernel));
+  if (entry)
+    entry->kernels[name] = zeKernel;
+  if (auto profiler = imex::KernelProfiler::get())
+    profiler->registerKernel(zeKernel, name);
+  if (auto trace = imex::TraceRecorder::get())
+    trace->registerKernel(zeKernel, name);
   return zeKernel;
 }
 
+// The caller holds the lock of \p kernel in kernelArgCache.
 static void enqueueKernel(ze_command_list_handle_t zeCommandList,
                           ze_kernel_handle_t kernel,
                           const ze_group_count_t *pLaunchArgs,
                           ParamDesc *params, size_t sharedMemBytes,
                           ze_event_handle_t waitEvent, EventDesc *depEvents) {
   auto paramsCount = countUntil(params, ParamDesc{nullptr, 0});
-  auto depEventsCount = countUntil(depEvents, EventDesc{nullptr});
 
   // Create handle of events to wait on
-  ze_event_handle_t *phWaitEvents = nullptr;
-  if (depEventsCount) {
-    phWaitEvents = new ze_event_handle_t[depEventsCount];
-    for (size_t i = 0; i < depEventsCount; i++) {
-      phWaitEvents[i] = static_cast<ze_event_handle_t>(depEvents[i].event);
-    }
-  }
+  auto waitEvents = getWaitEvents(depEvents);
 
   if (sharedMemBytes) {
     paramsCount = paramsCount - 1;
   }
 
-  for (size_t i = 0; i < paramsCount; ++i) {
-    auto param = params[i];
-    CHECK_ZE_RESULT(zeKernelSetArgumentValue(kernel, static_cast<uint32_t>(i),
-                                             param.size, param.data));
-  }
+  kernelArgCache.set(kernel, 0, params, paramsCount);
 
   if (sharedMemBytes) {
-    CHECK_ZE_RESULT(
-        zeKernelSetArgumentValue(kernel, paramsCount, sharedMemBytes, nullptr));
+    ParamDesc sharedMem = {nullptr, sharedMemBytes};
+    kernelArgCache.set(kernel, paramsCount, &sharedMem, 1);
   }
 
-  CHECK_ZE_RESULT(
-      zeCommandListAppendLaunchKernel(zeCommandList, kernel, pLaunchArgs,
-                                      waitEvent, depEventsCount, phWaitEvents));
+  CHECK_ZE_RESULT(zeCommandListAppendLaunchKernel(
+      zeCommandList, kernel, pLaunchArgs, waitEvent,
+      static_cast<uint32_t>(waitEvents.size()), waitEvents.data()));
 }
 
 // Utility to discover the Global memory cache (L3) size of the device
@@ -506,11 +2236,36 @@ static ze_event_handle_t launchKernel(GPUL0QUEUE *queue,
                                       EventDesc *depEvents) {
   assert(kernel);
 
+  // Work items of group size agnostic kernels do not depend on the split of
+  // the global size into groups, which may then be chosen here.
+  if (!sharedMemBytes) {
+    size_t grid[3] = {gridX, gridY, gridZ};
+    size_t block[3] = {blockX, blockY, blockZ};
+    groupSizeTuner.adapt(queue->zeDevice_, kernel, grid, block);
+    std::tie(gridX, gridY, gridZ) = std::make_tuple(grid[0], grid[1], grid[2]);
+    std::tie(blockX, blockY, blockZ) =
+        std::make_tuple(block[0], block[1], block[2]);
+  }
+
   auto castSz = [](size_t val) { return static_cast<uint32_t>(val); };
+  ze_group_count_t launchArgs = {castSz(gridX), castSz(gridY), castSz(gridZ)};
+
+  // Inside a graph region the launch is only recorded. Launches in a graph
+  // are ordered by the graph itself, so no event is returned.
+  if (queue->activeGraph_) {
+    auto paramsCount = countUntil(params, ParamDesc{nullptr, 0});
+    if (sharedMemBytes)
+      --paramsCount;
+    queue->activeGraph_->record(
+        kernel, launchArgs, {castSz(blockX), castSz(blockY), castSz(blockZ)},
+        sharedMemBytes, params, paramsCount);
+    return nullptr;
+  }
 
+  // Other streams may launch the kernel concurrently.
+  auto kernelLock = kernelArgCache.lock(kernel);
   CHECK_ZE_RESULT(zeKernelSetGroupSize(kernel, castSz(blockX), castSz(blockY),
                                        castSz(blockZ)));
-  ze_group_count_t launchArgs = {castSz(gridX), castSz(gridY), castSz(gridZ)};
 
   if (getenv("IMEX_ENABLE_PROFILING")) {
     auto executionTime = 0.0f;
@@ -533,7 +2288,8 @@ static ze_event_handle_t launchKernel(GPUL0QUEUE *queue,
     // it to be device-only, it removes the need for extra copy from/to host.
     // More importantly, it removes the possiblity of accidentally doing the
     // flush in the host-side using a host side function.
-    auto *cache = allocDeviceMemory(queue, 2 * cacheSize, 64, false);
+    auto *cache = allocDeviceMemory(queue, 2 * cacheSize, defaultAlignment,
+                                    false);
 
     if (getenv("IMEX_PROFILING_RUNS")) {
       auto runs = strtol(getenv("IMEX_PROFILING_RUNS"), NULL, 10L);
@@ -554,7 +2310,8 @@ static ze_event_handle_t launchKernel(GPUL0QUEUE *queue,
     }
 
     // profiling using timestamp event privided by level-zero
-    Event tstampEvent(queue->zeContext_, queue->zeDevice_);
+    Event tstampEvent(queue->getEventPool(/*timestamps=*/true),
+                      queue->zeDevice_);
     for (int r = 0; r < rounds; r++) {
       // Flush the L3 cache (global memory cache).
       if (getenv("IMEX_ENABLE_CACHE_FLUSHING")) {
@@ -573,6 +2330,7 @@ static ze_event_handle_t launchKernel(GPUL0QUEUE *queue,
           tstampEvent.get_profiling_info<imex::profiling::command_start>();
       auto endTime =
           tstampEvent.get_profiling_info<imex::profiling::command_end>();
+      CHECK_ZE_RESULT(zeEventHostReset(tstampEvent.zeEvent));
       auto duration = float(endTime - startTime) / 1000000.0f;
       executionTime += duration;
       if (duration > maxTime)
@@ -587,65 +2345,271 @@ static ze_event_handle_t launchKernel(GPUL0QUEUE *queue,
             executionTime / rounds, minTime, maxTime, rounds);
   }
 
-  Event *event = new Event(queue->zeContext_, queue->zeDevice_);
+  ze_event_handle_t zeEvent;
+  zet_metric_query_handle_t zetQuery = nullptr;
+  auto profiler = imex::KernelProfiler::get();
+  auto trace = imex::TraceRecorder::get();
+  if (profiler || trace) {
+    GPUL0QUEUE::PendingProfile profile;
+    if (profiler)
+      profile.key =
+          profiler->getKey(kernel, gridX, gridY, gridZ, blockX, blockY, blockZ);
+    if (trace) {
+      profile.traceCategory = "kernel";
+      profile.traceName = trace->getKernelName(kernel);
+    }
+    zeEvent = queue->acquireProfiledEvent(std::move(profile), zetQuery);
+  } else {
+    zeEvent = queue->acquirePendingEvent();
+  }
   enqueueKernel(queue->zeCommandList_, kernel, &launchArgs, params,
-                sharedMemBytes, event->zeEvent, depEvents);
-  return event->zeEvent;
+                sharedMemBytes, zeEvent, depEvents);
+  queue->markAppended(queue->zeCommandList_);
+  // The query end is signaled through a pending event, so gpuWait waits for
+  // its data before reading it.
+  if (zetQuery)
+    CHECK_ZE_RESULT(zetCommandListAppendMetricQueryEnd(
+        queue->zeCommandList_, zetQuery, queue->acquirePendingEvent(), 0,
+        nullptr));
+  return zeEvent;
 }
 
 // Wrappers
 extern "C" LEVEL_ZERO_RUNTIME_EXPORT GPUL0QUEUE *
 gpuCreateStream(void *device, void *context) {
+  imex::TraceScope traceScope(__func__);
   return catchAll([&]() {
-    if (!device && !context) {
-      return new GPUL0QUEUE();
-    } else if (device && context) {
-      // TODO: Check if the pointers/address is valid and holds the correct
-      // device and context
-      return new GPUL0QUEUE(static_cast<ze_device_type_t *>(device),
-                            static_cast<ze_context_handle_t>(context));
-    } else if (device && !context) {
-      return new GPUL0QUEUE(static_cast<ze_device_type_t *>(device));
-    } else {
-      return new GPUL0QUEUE(static_cast<ze_context_handle_t>(context));
-    }
+    // TODO: Check if the pointers/address is valid and holds the correct
+    // device and context
+    auto deviceType = device ? *static_cast<ze_device_type_t *>(device)
+                             : ZE_DEVICE_TYPE_GPU;
+    return new GPUL0QUEUE(deviceType,
+                          static_cast<ze_context_handle_t>(context));
+  });
+}
+
+// Creates a stream on the GPU with the given index and, if subDevice is not
+// negative, on the given sub-device (tile) of it. A negative device index
+// applies the default selection, see imex/ExecutionEngine/DeviceSelection.h.
+extern "C" LEVEL_ZERO_RUNTIME_EXPORT GPUL0QUEUE *
+gpuCreateStreamOnDevice(int64_t device, int64_t subDevice) {
+  imex::TraceScope traceScope(__func__);
+  return catchAll([&]() {
+    return new GPUL0QUEUE(ZE_DEVICE_TYPE_GPU, nullptr, {device, subDevice});
   });
 }
 
+// Creates a stream on the device and in the context of \p queue, which has to
+// outlive it. The streams share the modules and kernels loaded in the context
+// but have their own command lists and memory pool.
+extern "C" LEVEL_ZERO_RUNTIME_EXPORT GPUL0QUEUE *
+gpuCreateStreamSharing(GPUL0QUEUE *queue) {
+  imex::TraceScope traceScope(__func__);
+  return catchAll([&]() { return new GPUL0QUEUE(queue); });
+}
+
+// Returns the substream \p index of \p queue, see GPUL0QUEUE::getSubstream.
+// Substreams have command lists of their own, so that independent launches
+// on different substreams run concurrently, and are destroyed with \p queue.
+extern "C" LEVEL_ZERO_RUNTIME_EXPORT GPUL0QUEUE *
+gpuStreamGetSubstream(GPUL0QUEUE *queue, int64_t index) {
+  imex::TraceScope traceScope(__func__);
+  return catchAll([&]() { return queue->getSubstream(index); });
+}
+
 extern "C" LEVEL_ZERO_RUNTIME_EXPORT void gpuStreamDestroy(GPUL0QUEUE *queue) {
+  imex::TraceScope traceScope(__func__);
   catchAll([&]() { delete queue; });
 }
 
 extern "C" LEVEL_ZERO_RUNTIME_EXPORT void *
 gpuMemAlloc(GPUL0QUEUE *queue, size_t size, size_t alignment, bool isShared) {
-  return catchAll(
-      [&]() { return allocDeviceMemory(queue, size, alignment, isShared); });
+  imex::TraceScope traceScope(__func__);
+  return catchAll([&]() {
+    return allocPooledMemory(queue, size, alignment, isShared, nullptr);
+  });
+}
+
+// gpuMemAlloc of code compiled with alloc-site-tags, \p site names the
+// calling function for IMEX_MEMORY_STATS.
+extern "C" LEVEL_ZERO_RUNTIME_EXPORT void *
+gpuMemAllocTagged(GPUL0QUEUE *queue, size_t size, size_t alignment,
+                  bool isShared, const char *site) {
+  imex::TraceScope traceScope(__func__);
+  return catchAll([&]() {
+    return allocPooledMemory(queue, size, alignment, isShared, site);
+  });
+}
+
+// Returns device memory holding the \p size bytes of the constant global at
+// \p hostPtr, the lowering of gpux.alloc with imex.constant_data. The data is
+// copied once per stream, later calls return the same memory.
+extern "C" LEVEL_ZERO_RUNTIME_EXPORT void *
+gpuMemAllocConstant(GPUL0QUEUE *queue, const void *hostPtr, size_t size,
+                    size_t alignment) {
+  imex::TraceScope traceScope(__func__);
+  return catchAll([&]() {
+    return allocConstantMemory(queue, hostPtr, size, alignment);
+  });
 }
 
 extern "C" LEVEL_ZERO_RUNTIME_EXPORT void gpuMemFree(GPUL0QUEUE *queue,
                                                      void *ptr) {
-  catchAll([&]() { deallocDeviceMemory(queue, ptr); });
+  imex::TraceScope traceScope(__func__);
+  catchAll([&]() { deallocPooledMemory(queue, ptr, nullptr); });
+}
+
+extern "C" LEVEL_ZERO_RUNTIME_EXPORT void
+gpuMemFreeAsync(GPUL0QUEUE *queue, void *ptr, void *depEvents) {
+  imex::TraceScope traceScope(__func__);
+  catchAll([&]() {
+    deallocPooledMemory(queue, ptr, static_cast<EventDesc *>(depEvents));
+  });
+}
+
+extern "C" LEVEL_ZERO_RUNTIME_EXPORT ze_event_handle_t
+gpuMemPrefetch(GPUL0QUEUE *queue, void *ptr, size_t size, void *depEvents) {
+  imex::TraceScope traceScope(__func__);
+  return catchAll([&]() {
+    return memoryPrefetch(queue, ptr, size,
+                          static_cast<EventDesc *>(depEvents));
+  });
+}
+
+extern "C" LEVEL_ZERO_RUNTIME_EXPORT void
+gpuMemAdvise(GPUL0QUEUE *queue, void *ptr, size_t size, int32_t advice) {
+  imex::TraceScope traceScope(__func__);
+  catchAll([&]() { memoryAdvise(queue, ptr, size, advice); });
 }
 
 extern "C" LEVEL_ZERO_RUNTIME_EXPORT void
 gpuMemCopy(GPUL0QUEUE *queue, void *dstPtr, void *srcPtr, size_t size) {
+  imex::TraceScope traceScope(__func__);
   return catchAll([&]() { memoryCopy(queue, dstPtr, srcPtr, size); });
 }
 
+extern "C" LEVEL_ZERO_RUNTIME_EXPORT ze_event_handle_t
+gpuMemCopyAsync(GPUL0QUEUE *queue, void *dstPtr, void *srcPtr, size_t size,
+                void *depEvents) {
+  imex::TraceScope traceScope(__func__);
+  return catchAll([&]() {
+    return memoryCopyAsync(queue, dstPtr, srcPtr, size,
+                           static_cast<EventDesc *>(depEvents));
+  });
+}
+
+extern "C" LEVEL_ZERO_RUNTIME_EXPORT ze_event_handle_t
+gpuMemset(GPUL0QUEUE *queue, void *dstPtr, void *pattern, size_t patternSize,
+          size_t size, void *depEvents) {
+  imex::TraceScope traceScope(__func__);
+  return catchAll([&]() {
+    return memoryFill(queue, dstPtr, pattern, patternSize, size,
+                      static_cast<EventDesc *>(depEvents));
+  });
+}
+
+extern "C" LEVEL_ZERO_RUNTIME_EXPORT ze_event_handle_t
+gpuFillRandom(GPUL0QUEUE *queue, void *dstPtr, int32_t type, size_t count,
+              float lower, float upper, bool genInt, int64_t seed,
+              void *depEvents) {
+  imex::TraceScope traceScope(__func__);
+  imex::RandomFillParams params{static_cast<uint64_t>(seed), lower, upper,
+                                genInt};
+  return catchAll([&]() {
+    return fillRandom(queue, dstPtr, static_cast<imex::RandomFillType>(type),
+                      count, params, static_cast<EventDesc *>(depEvents));
+  });
+}
+
+extern "C" LEVEL_ZERO_RUNTIME_EXPORT ze_event_handle_t
+gpuBarrier(GPUL0QUEUE *queue, void *depEvents) {
+  imex::TraceScope traceScope(__func__);
+  return catchAll([&]() {
+    return enqueueBarrier(queue, static_cast<EventDesc *>(depEvents));
+  });
+}
+
+extern "C" LEVEL_ZERO_RUNTIME_EXPORT void gpuWaitEvents(GPUL0QUEUE *queue,
+                                                        void *depEvents) {
+  imex::TraceScope traceScope(__func__);
+  catchAll([&]() { waitEvents(static_cast<EventDesc *>(depEvents)); });
+}
+
 extern "C" LEVEL_ZERO_RUNTIME_EXPORT ze_module_handle_t
 gpuModuleLoad(GPUL0QUEUE *queue, const void *data, size_t dataSize) {
+  imex::TraceScope traceScope(__func__);
   return catchAll([&]() { return loadModule(queue, data, dataSize); });
 }
 
+extern "C" LEVEL_ZERO_RUNTIME_EXPORT ze_module_handle_t
+gpuModuleLoadWithGRFSize(GPUL0QUEUE *queue, const void *data, size_t dataSize,
+                         int32_t grfSize) {
+  imex::TraceScope traceScope(__func__);
+  return catchAll(
+      [&]() { return loadModule(queue, data, dataSize, grfSize); });
+}
+
+extern "C" LEVEL_ZERO_RUNTIME_EXPORT ze_module_handle_t
+gpuModuleLoadWithOptions(GPUL0QUEUE *queue, const void *data, size_t dataSize,
+                         int32_t grfSize, int32_t vectorBackend,
+                         const void *aotBinaries) {
+  imex::TraceScope traceScope(__func__);
+  return catchAll([&]() {
+    return loadModule(queue, data, dataSize, grfSize, vectorBackend,
+                      aotBinaries);
+  });
+}
+
+// Queues the compilation of the module a later gpuModuleLoadWithOptions with
+// the same arguments loads, for the default device, see ModulePreloader.h.
+// Called by the global constructor of convert-gpux-to-llvm{preload-modules}.
+extern "C" LEVEL_ZERO_RUNTIME_EXPORT void
+gpuModulePreload(const void *data, size_t dataSize, int32_t grfSize,
+                 int32_t vectorBackend, const void *aotBinaries) {
+  imex::TraceScope traceScope(__func__);
+  catchAll([&]() {
+    imex::ModulePreloader::get().preload(
+        []() { return getDriverAndDevice(); }, data, dataSize,
+        getBuildFlags(grfSize, vectorBackend), aotBinaries);
+  });
+}
+
+extern "C" LEVEL_ZERO_RUNTIME_EXPORT void
+gpuModuleUnload(ze_module_handle_t module) {
+  imex::TraceScope traceScope(__func__);
+  catchAll([&]() { unloadModule(module); });
+}
+
 extern "C" LEVEL_ZERO_RUNTIME_EXPORT ze_kernel_handle_t
 gpuKernelGet(GPUL0QUEUE *queue, ze_module_handle_t module, const char *name) {
+  imex::TraceScope traceScope(__func__);
   return catchAll([&]() { return getKernel(queue, module, name); });
 }
 
+// Sets the cost estimates of imex-estimate-kernel-cost for the profiler.
+extern "C" LEVEL_ZERO_RUNTIME_EXPORT void
+gpuKernelSetCost(GPUL0QUEUE *queue, ze_kernel_handle_t kernel,
+                 int64_t bytesPerItem, int64_t flopsPerItem) {
+  imex::TraceScope traceScope(__func__);
+  if (auto profiler = imex::KernelProfiler::get())
+    profiler->setCost(kernel, bytesPerItem, flopsPerItem);
+}
+
+// Marks a kernel compiled for \p grfSize GRFs per thread (0 for the default)
+// as group size agnostic, see imex-group-size-agnostic. With
+// IMEX_ADAPTIVE_GROUP_SIZE set, its group size is chosen at launch time.
+extern "C" LEVEL_ZERO_RUNTIME_EXPORT void
+gpuKernelSetGroupSizeAgnostic(GPUL0QUEUE *queue, ze_kernel_handle_t kernel,
+                              int32_t grfSize) {
+  imex::TraceScope traceScope(__func__);
+  groupSizeTuner.markAgnostic(kernel, grfSize);
+}
+
 extern "C" LEVEL_ZERO_RUNTIME_EXPORT ze_event_handle_t gpuLaunchKernel(
     GPUL0QUEUE *queue, ze_kernel_handle_t kernel, size_t gridX, size_t gridY,
     size_t gridZ, size_t blockX, size_t blockY, size_t blockZ,
     size_t sharedMemBytes, void *params, void *depEvents) {
+  imex::TraceScope traceScope(__func__);
   return catchAll([&]() {
     return launchKernel(queue, kernel, gridX, gridY, gridZ, blockX, blockY,
                         blockZ, sharedMemBytes,
@@ -654,9 +2618,53 @@ extern "C" LEVEL_ZERO_RUNTIME_EXPORT ze_event_handle_t gpuLaunchKernel(
   });
 }
 
-extern "C" LEVEL_ZERO_RUNTIME_EXPORT void gpuWait(GPUL0QUEUE *queue) {
-  catchAll([&]() {
-    // TODO: Find out ze Wait for host.
-    return;
+extern "C" LEVEL_ZERO_RUNTIME_EXPORT ze_event_handle_t gpuLaunchKernelPacked(
+    GPUL0QUEUE *queue, ze_kernel_handle_t kernel, size_t gridX, size_t gridY,
+    size_t gridZ, size_t blockX, size_t blockY, size_t blockZ,
+    size_t sharedMemBytes, void *args, const int64_t *layout,
+    void *depEvents) {
+  imex::TraceScope traceScope(__func__);
+  return catchAll([&]() {
+    return launchKernel(queue, kernel, gridX, gridY, gridZ, blockX, blockY,
+                        blockZ, sharedMemBytes, unpackParams(args, layout),
+                        static_cast<EventDesc *>(depEvents));
+  });
+}
+
+// Launches \p count kernels in order with a single call. The first launch
+// depends on \p depEvents and each following launch on the previous one.
+// Returns the event of the last launch.
+extern "C" LEVEL_ZERO_RUNTIME_EXPORT ze_event_handle_t gpuLaunchKernels(
+    GPUL0QUEUE *queue, LaunchDesc *launches, size_t count, void *depEvents) {
+  imex::TraceScope traceScope(__func__);
+  return catchAll([&]() {
+    auto deps = static_cast<EventDesc *>(depEvents);
+    ze_event_handle_t event = nullptr;
+    for (size_t i = 0; i < count; ++i) {
+      auto &launch = launches[i];
+      EventDesc prev[] = {{event}, {nullptr}};
+      auto kernel = static_cast<ze_kernel_handle_t>(launch.kernel);
+      event = launchKernel(queue, kernel, launch.grid[0], launch.grid[1],
+                           launch.grid[2], launch.block[0], launch.block[1],
+                           launch.block[2], launch.sharedMemBytes,
+                           launch.params, i == 0 ? deps : prev);
+    }
+    return event;
   });
 }
+
+extern "C" LEVEL_ZERO_RUNTIME_EXPORT void gpuGraphBegin(GPUL0QUEUE *queue,
+                                                        const void *id) {
+  imex::TraceScope traceScope(__func__);
+  catchAll([&]() { queue->beginGraph(id); });
+}
+
+extern "C" LEVEL_ZERO_RUNTIME_EXPORT void gpuGraphEnd(GPUL0QUEUE *queue) {
+  imex::TraceScope traceScope(__func__);
+  catchAll([&]() { queue->endGraph(); });
+}
+
+extern "C" LEVEL_ZERO_RUNTIME_EXPORT void gpuWait(GPUL0QUEUE *queue) {
+  imex::TraceScope traceScope(__func__);
+  catchAll([&]() { queue->synchronize(); });
+}
@@ -12,6 +12,15 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include "imex/ExecutionEngine/DeviceSelection.h"
+#include "imex/ExecutionEngine/KernelProfiler.h"
+#include "imex/ExecutionEngine/MemoryTracker.h"
+#include "imex/ExecutionEngine/ModuleCache.h"
+#include "imex/ExecutionEngine/ModulePreloader.h"
+#include "imex/ExecutionEngine/NativeBinaryCache.h"
+#include "imex/ExecutionEngine/RandomFill.h"
+#include "imex/ExecutionEngine/TraceRecorder.h"
+
 #include <cassert>
 #include <cfloat>
 #include <cstdint>
@@ -22,7 +31,10 @@
 
 #include <level_zero/ze_api.h>
 #include <map>
+#include <memory>
 #include <mutex>
+#include <optional>
+#include <string>
 #include <sycl/ext/oneapi/backend/level_zero.hpp>
 #include <sycl/queue.hpp> // for queue
 #include <sycl/sycl.hpp>
@@ -63,17 +75,28 @@ template <typename F> auto catchAll(F &&func) {
 
 struct SpirvModule {
   ze_module_handle_t module = nullptr;
+  // Kernels created from this module, keyed by kernel name. They are
+  // destroyed together with the module.
+  std::map<std::string, std::unique_ptr<sycl::kernel>> kernels;
+  // Interop bundle of the module, created with the first kernel and shared by
+  // all kernels of the module.
+  std::unique_ptr<sycl::kernel_bundle<sycl::bundle_state::executable>> bundle;
+  std::mutex kernelsMutex;
   ~SpirvModule();
 };
 
 namespace {
-// Create a Map for the spirv module lookup
-std::map<void *, SpirvModule> moduleCache;
-std::mutex mutexLock;
+// Modules keyed by SPIR-V content, build flags, context and device.
+imex::ModuleCache<SpirvModule> moduleCache;
 } // namespace
 
 SpirvModule::~SpirvModule() {
-  L0_SAFE_CALL(zeModuleDestroy(SpirvModule::module));
+  // The kernels and the bundle have to be released before the module they
+  // were created from. The bundle does not own the module, see getKernel.
+  kernels.clear();
+  bundle.reset();
+  if (module)
+    L0_SAFE_CALL(zeModuleDestroy(SpirvModule::module));
 }
 
 struct ParamDesc {
@@ -95,6 +118,15 @@ struct EventDesc {
   bool operator!=(const EventDesc &rhs) const { return !(*this == rhs); }
 };
 
+// One launch of a gpuLaunchKernels batch.
+struct LaunchDesc {
+  void *kernel;
+  size_t grid[3];
+  size_t block[3];
+  size_t sharedMemBytes;
+  ParamDesc *params;
+};
+
 template <typename T> size_t countUntil(T *ptr, T &&elem) {
   assert(ptr);
   auto curr = ptr;
@@ -104,7 +136,27 @@ template <typename T> size_t countUntil(T *ptr, T &&elem) {
   return static_cast<size_t>(curr - ptr);
 }
 
-static sycl::device getDefaultDevice() {
+// Returns the null terminated params of the arguments packed back to back in
+// \p args, as described by \p layout: the number of arguments followed by the
+// size of each. The returned array is reused by the next call on the thread.
+static ParamDesc *unpackParams(void *args, const int64_t *layout) {
+  thread_local std::vector<ParamDesc> params;
+  auto count = static_cast<size_t>(layout[0]);
+  auto data = static_cast<uint8_t *>(args);
+  params.clear();
+  for (size_t i = 0; i < count; ++i) {
+    auto size = static_cast<size_t>(layout[i + 1]);
+    params.push_back({data, size});
+    data += size;
+  }
+  params.push_back({nullptr, 0});
+  return params.data();
+}
+
+// Returns the Level Zero device (or sub-device) chosen by selection, see
+// imex/ExecutionEngine/DeviceSelection.h.
+static sycl::device getDevice(imex::DeviceSelection selection = {}) {
+  std::vector<sycl::device> devices;
   auto platformList = sycl::platform::get_platforms();
   for (const auto &platform : platformList) {
     auto platformName = platform.get_info<sycl::info::platform::name>();
@@ -112,8 +164,37 @@ static sycl::device getDefaultDevice() {
     if (!isLevelZero)
       continue;
 
-    return platform.get_devices()[0];
+    devices = platform.get_devices();
+    break;
   }
+
+  std::vector<uint32_t> subDeviceCounts;
+  for (const auto &device : devices)
+    subDeviceCounts.push_back(
+        device.get_info<sycl::info::device::partition_max_sub_devices>());
+  selection = imex::resolveDeviceSelection(selection, subDeviceCounts);
+
+  auto &device = devices[selection.device];
+  if (selection.subDevice < 0)
+    return device;
+  auto subDevices = device.create_sub_devices<
+      sycl::info::partition_property::partition_by_affinity_domain>(
+      sycl::info::partition_affinity_domain::next_partitionable);
+  return subDevices.at(selection.subDevice);
+}
+
+static sycl::device getDefaultDevice() { return getDevice(); }
+
+// IMEX_SYCL_DISCARD_EVENTS opts into an in-order queue with the
+// discard_events property: submissions do not create events, which removes
+// most of the per-launch overhead for chains of small kernels. The runtime
+// then returns null events and relies on the queue order, and gpuWait waits
+// for the whole queue. Substreams are not concurrent in this mode. Profiling
+// and tracing need events and disable the mode.
+static bool discardEventsEnabled() {
+  return getenv("IMEX_SYCL_DISCARD_EVENTS") &&
+         !getenv("IMEX_ENABLE_PROFILING") && !imex::KernelProfiler::get() &&
+         !imex::TraceRecorder::get();
 }
 
 struct GPUSYCLQUEUE {
@@ -121,6 +202,7 @@ struct GPUSYCLQUEUE {
   sycl::device syclDevice_;
   sycl::context syclContext_;
   sycl::queue syclQueue_;
+  bool discardEvents_ = discardEventsEnabled();
 
   GPUSYCLQUEUE(sycl::property_list propList) {
 
@@ -149,8 +231,159 @@ struct GPUSYCLQUEUE {
     syclQueue_ = sycl::queue(syclContext_, syclDevice_, propList);
   }
 
+  ~GPUSYCLQUEUE() {
+    synchronize();
+    for (auto &[hostPtr, ptr] : constantBuffers_)
+      sycl::free(ptr, syclQueue_);
+  }
+
+  // Returns the event of a submission to the caller, or null if events are
+  // discarded.
+  sycl::event *wrapEvent(const sycl::event &event) const {
+    return discardEvents_ ? nullptr : new sycl::event(event);
+  }
+
+  // Launches recorded by the kernel profiler that have not been waited on.
+  std::vector<std::pair<sycl::event, imex::KernelProfiler::Key>>
+      pendingProfiles_;
+
+  // Commands recorded by the trace recorder that have not been waited on,
+  // with the host time right before their submission.
+  struct PendingTrace {
+    sycl::event event;
+    const char *category;
+    std::string name;
+    size_t bytes;
+    uint64_t submitNs;
+  };
+  std::vector<PendingTrace> pendingTraces_;
+
+  // Records \p event in the trace if tracing is enabled. \p submitNs is the
+  // host time taken before the command was submitted.
+  void trace(const sycl::event &event, const char *category, std::string name,
+             size_t bytes, uint64_t submitNs) {
+    if (imex::TraceRecorder::get())
+      pendingTraces_.push_back(
+          {event, category, std::move(name), bytes, submitNs});
+  }
+
+  // Memory released by gpuMemFree, with the event of the barrier ordering the
+  // release after the work using it. sycl::free waits for outstanding work,
+  // so the memory is only freed once the event is complete.
+  std::vector<std::pair<void *, sycl::event>> deferredFrees_;
+  // Accounting of gpuMemAlloc and gpuMemFree if IMEX_MEMORY_STATS is set, the
+  // summary is printed when the stream is destroyed.
+  std::unique_ptr<imex::MemoryTracker> memoryTracker_ =
+      imex::MemoryTracker::create();
+  // Device copies of constant globals made by gpuMemAllocConstant, keyed by
+  // the address of the global. They live as long as the stream.
+  std::map<const void *, void *> constantBuffers_;
+  // Queues returned by gpuStreamGetSubstream, in the context of this one,
+  // indexed by the substream index minus one.
+  std::vector<std::unique_ptr<GPUSYCLQUEUE>> substreams_;
+
+  // Returns the substream \p index, 0 being the queue itself, creating it
+  // with \p propList on first use. Without events, joins across queues and
+  // waits for them cannot be expressed, so in discard_events mode all
+  // substreams are the in-order queue itself.
+  GPUSYCLQUEUE *getSubstream(int64_t index,
+                             const sycl::property_list &propList) {
+    if (index <= 0 || discardEvents_)
+      return this;
+    if (substreams_.size() < static_cast<size_t>(index))
+      substreams_.resize(index);
+    auto &substream = substreams_[index - 1];
+    if (!substream)
+      substream = std::make_unique<GPUSYCLQUEUE>(&syclDevice_, &syclContext_,
+                                                 propList);
+    return substream.get();
+  }
+
+  // Releases \p ptr once \p depEvents are complete or, if there are none,
+  // once all work submitted so far is done, without blocking the host.
+  void deferFree(void *ptr, const std::vector<sycl::event> &depEvents) {
+    // Substreams are not ordered with the queue, so without dependencies
+    // the memory is also kept until their work submitted so far is done.
+    auto events = depEvents;
+    if (events.empty())
+      for (auto &substream : substreams_)
+        if (substream)
+          events.push_back(substream->syclQueue_.ext_oneapi_submit_barrier());
+    auto event = events.empty() ? syclQueue_.ext_oneapi_submit_barrier()
+                                : syclQueue_.ext_oneapi_submit_barrier(events);
+    deferredFrees_.emplace_back(ptr, event);
+    reclaimFrees(/*wait=*/false);
+  }
+
+  // Frees the memory of the deferred frees whose event is complete, or of all
+  // of them if \p wait is set and the queue has been waited for.
+  void reclaimFrees(bool wait) {
+    // Discarded events cannot be queried, the memory is freed by the next
+    // wait.
+    if (!wait && discardEvents_)
+      return;
+    size_t kept = 0;
+    for (auto &[ptr, event] : deferredFrees_) {
+      if (!wait &&
+          event.get_info<sycl::info::event::command_execution_status>() !=
+              sycl::info::event_command_status::complete) {
+        deferredFrees_[kept++] = {ptr, event};
+        continue;
+      }
+      sycl::free(ptr, syclQueue_);
+    }
+    deferredFrees_.erase(deferredFrees_.begin() + kept, deferredFrees_.end());
+  }
+
+  // Wait for all submitted work and record the pending profiles.
+  void synchronize() {
+    for (auto &substream : substreams_)
+      if (substream)
+        substream->synchronize();
+    syclQueue_.wait();
+    for (auto &[event, key] : pendingProfiles_) {
+      auto startTime =
+          event
+              .get_profiling_info<sycl::info::event_profiling::command_start>();
+      auto endTime =
+          event.get_profiling_info<sycl::info::event_profiling::command_end>();
+      imex::KernelProfiler::get()->record(key, endTime - startTime);
+    }
+    pendingProfiles_.clear();
+
+    // The device timestamps of a command are mapped to the host clock
+    // relative to its submission.
+    for (auto &pending : pendingTraces_) {
+      auto &event = pending.event;
+      auto submitTime = event.get_profiling_info<
+          sycl::info::event_profiling::command_submit>();
+      auto startTime =
+          event
+              .get_profiling_info<sycl::info::event_profiling::command_start>();
+      auto endTime =
+          event.get_profiling_info<sycl::info::event_profiling::command_end>();
+      auto startNs = pending.submitNs + (startTime - submitTime);
+      imex::TraceRecorder::get()->recordDevice(
+          pending.category, std::move(pending.name), startNs,
+          startNs + (endTime - startTime), pending.bytes);
+    }
+    pendingTraces_.clear();
+    reclaimFrees(/*wait=*/true);
+  }
+
 }; // end of GPUSYCLQUEUE
 
+static sycl::property_list getQueueProperties() {
+  if (getenv("IMEX_ENABLE_PROFILING") || imex::KernelProfiler::get() ||
+      imex::TraceRecorder::get())
+    return sycl::property_list{sycl::property::queue::enable_profiling()};
+  if (discardEventsEnabled())
+    return sycl::property_list{
+        sycl::property::queue::in_order(),
+        sycl::ext::oneapi::property::queue::discard_events()};
+  return sycl::property_list{};
+}
+
 #if 0
 static std::string getDeviceID(GPUSYCLQUEUE *queue) {
   auto syclDevice = queue->syclDevice_;
@@ -197,84 +430,266 @@ static void deallocDeviceMemory(GPUSYCLQUEUE *queue, void *ptr) {
   sycl::free(ptr, queue->syclQueue_);
 }
 
-// @TODO: Add support for async copy
-// Currnetly, we only support synchrnous copy?
+// Allocates memory for gpuMemAlloc, \p site is the calling function if the
+// code was compiled with alloc-site-tags.
+static void *allocTrackedMemory(GPUSYCLQUEUE *queue, size_t size,
+                                size_t alignment, bool isShared,
+                                const char *site) {
+  queue->reclaimFrees(/*wait=*/false);
+  auto ptr = allocDeviceMemory(queue, size, alignment, isShared);
+  if (queue->memoryTracker_)
+    queue->memoryTracker_->recordAlloc(ptr, size, isShared, site);
+  return ptr;
+}
+
+// Returns the device copy of the constant global at \p hostPtr, uploading it
+// on the first call. The copy is only freed with the stream, so it is not
+// tracked.
+static void *allocConstantMemory(GPUSYCLQUEUE *queue, const void *hostPtr,
+                                 size_t size, size_t alignment) {
+  auto &ptr = queue->constantBuffers_[hostPtr];
+  if (!ptr) {
+    ptr = allocDeviceMemory(queue, size, alignment, /*isShared=*/false);
+    queue->syclQueue_.memcpy(ptr, hostPtr, size).wait();
+  }
+  return ptr;
+}
+
+static void deallocTrackedMemory(GPUSYCLQUEUE *queue, void *ptr,
+                                 const std::vector<sycl::event> &depEvents) {
+  if (queue->memoryTracker_)
+    queue->memoryTracker_->recordFree(ptr);
+  queue->deferFree(ptr, depEvents);
+}
+
+// Memory advice of gpuMemAdvise, the lowering of gpux.mem_advise.
+enum class GpuMemAdvice : int32_t { ReadMostly = 0, PreferredLocation = 1 };
+
+static ze_memory_advice_t getZeMemAdvice(int32_t advice) {
+  switch (static_cast<GpuMemAdvice>(advice)) {
+  case GpuMemAdvice::ReadMostly:
+    return ZE_MEMORY_ADVICE_SET_READ_MOSTLY;
+  case GpuMemAdvice::PreferredLocation:
+    return ZE_MEMORY_ADVICE_SET_PREFERRED_LOCATION;
+  }
+  throw std::runtime_error("Invalid memory advice " + std::to_string(advice));
+}
+
+static std::vector<sycl::event> getDepEvents(EventDesc *depEvents) {
+  std::vector<sycl::event> events;
+  if (!depEvents)
+    return events;
+  auto depEventsCount = countUntil(depEvents, EventDesc{nullptr});
+  for (size_t i = 0; i < depEventsCount; i++)
+    events.push_back(*(static_cast<sycl::event *>(depEvents[i].event)));
+  return events;
+}
+
 static void memoryCopy(GPUSYCLQUEUE *queue, void *dstPtr, void *srcPtr,
                        size_t size) {
-  queue->syclQueue_.memcpy(dstPtr, srcPtr, size).wait();
+  auto submitNs = imex::TraceRecorder::now();
+  auto event = queue->syclQueue_.memcpy(dstPtr, srcPtr, size);
+  queue->trace(event, "memcpy", "memcpy", size, submitNs);
+  if (queue->discardEvents_)
+    queue->syclQueue_.wait();
+  else
+    event.wait();
 }
 
-static ze_module_handle_t loadModule(GPUSYCLQUEUE *queue, const void *data,
-                                     size_t dataSize) {
-  assert(data);
-  auto syclQueue = queue->syclQueue_;
-  ze_module_handle_t zeModule;
+static sycl::event *memoryCopyAsync(GPUSYCLQUEUE *queue, void *dstPtr,
+                                    void *srcPtr, size_t size,
+                                    EventDesc *depEvents) {
+  auto submitNs = imex::TraceRecorder::now();
+  auto event =
+      queue->syclQueue_.memcpy(dstPtr, srcPtr, size, getDepEvents(depEvents));
+  queue->trace(event, "memcpy", "memcpy", size, submitNs);
+  return queue->wrapEvent(event);
+}
 
-  // TODO: Enable this for current Device
-  // query and throw an error for unsupported platforms
-  // getDeviceID(syclQueue);
+template <typename T>
+static sycl::event fillPattern(sycl::queue &queue, void *dstPtr,
+                               const void *pattern, size_t size,
+                               const std::vector<sycl::event> &deps) {
+  auto value = *static_cast<const T *>(pattern);
+  return queue.submit([&](sycl::handler &cgh) {
+    cgh.depends_on(deps);
+    cgh.fill(static_cast<T *>(dstPtr), value, size / sizeof(T));
+  });
+}
 
-  auto it = moduleCache.find((void *)data);
-  // Check the map if the module is present/cached.
-  if (it != moduleCache.end()) {
-    return it->second.module;
+static sycl::event *memoryFill(GPUSYCLQUEUE *queue, void *dstPtr,
+                               const void *pattern, size_t patternSize,
+                               size_t size, EventDesc *depEvents) {
+  auto deps = getDepEvents(depEvents);
+  auto &syclQueue = queue->syclQueue_;
+  auto submitNs = imex::TraceRecorder::now();
+  sycl::event event;
+  switch (patternSize) {
+  case 1:
+    event = fillPattern<uint8_t>(syclQueue, dstPtr, pattern, size, deps);
+    break;
+  case 2:
+    event = fillPattern<uint16_t>(syclQueue, dstPtr, pattern, size, deps);
+    break;
+  case 4:
+    event = fillPattern<uint32_t>(syclQueue, dstPtr, pattern, size, deps);
+    break;
+  case 8:
+    event = fillPattern<uint64_t>(syclQueue, dstPtr, pattern, size, deps);
+    break;
+  default:
+    throw std::runtime_error("unsupported memset pattern size: " +
+                             std::to_string(patternSize));
   }
+  queue->trace(event, "memset", "memset", size, submitNs);
+  return queue->wrapEvent(event);
+}
 
-  ze_module_desc_t desc = {ZE_STRUCTURE_TYPE_MODULE_DESC,
-                           nullptr,
-                           ZE_MODULE_FORMAT_IL_SPIRV,
-                           dataSize,
-                           (const uint8_t *)data,
-                           nullptr,
-                           nullptr};
+// Fills \p count elements of \p type at \p dstPtr with random values, see
+// RandomFill.h. Every work-item computes one Philox block of four elements.
+static sycl::event *fillRandom(GPUSYCLQUEUE *queue, void *dstPtr,
+                               imex::RandomFillType type, size_t count,
+                               const imex::RandomFillParams &params,
+                               EventDesc *depEvents) {
+  auto deps = getDepEvents(depEvents);
+  auto submitNs = imex::TraceRecorder::now();
+  auto event = queue->syclQueue_.submit([&](sycl::handler &cgh) {
+    cgh.depends_on(deps);
+    cgh.parallel_for(sycl::range<1>((count + 3) / 4), [=](sycl::id<1> id) {
+      uint64_t group = id[0];
+      float values[4];
+      imex::getRandomValues(params, group, values);
+      for (uint64_t i = 0; i < 4 && group * 4 + i < count; ++i)
+        imex::storeRandomValue(dstPtr, type, group * 4 + i, values[i]);
+    });
+  });
+  queue->trace(event, "memset", "fill_random",
+               count * imex::getElementSize(type), submitNs);
+  return queue->wrapEvent(event);
+}
 
+// Returns the IGC flags of a module compiled for \p grfSize GRFs per thread,
+// or for the register file selected by IMEX_ENABLE_LARGE_REG_FILE if
+// \p grfSize is 0, with the vector backend if \p vectorBackend is nonzero or
+// IMEX_USE_IGC_VECTOR_BACK_END is set.
+static std::string getBuildFlags(int32_t grfSize, int32_t vectorBackend) {
   std::string build_flags;
   // IGC auto-detection of scalar/vector backend does not work for native BF16
   // data type yet, hence we need to pass this flag explicitly for if native
   // bf16 data type is used and we need to use vector compute.
-  if (getenv("IMEX_USE_IGC_VECTOR_BACK_END")) {
+  if (vectorBackend || getenv("IMEX_USE_IGC_VECTOR_BACK_END")) {
     build_flags += " -vc-codegen ";
   }
   // enable large register file if needed
-  if (getenv("IMEX_ENABLE_LARGE_REG_FILE")) {
+  bool largeGRF =
+      grfSize ? grfSize > 128 : getenv("IMEX_ENABLE_LARGE_REG_FILE") != nullptr;
+  if (largeGRF) {
     build_flags += "-doubleGRF -Xfinalizer -noLocalSplit -Xfinalizer "
                    "-DPASTokenReduction -Xfinalizer -SWSBDepReduction "
                    "-Xfinalizer -printregusage -Xfinalizer -enableBCR";
   }
-  desc.pBuildFlags = build_flags.c_str();
+  return build_flags;
+}
+
+// Loads a module compiled for \p grfSize GRFs per thread, or for the register
+// file selected by IMEX_ENABLE_LARGE_REG_FILE if \p grfSize is 0. Nonzero
+// \p vectorBackend compiles it with the vector backend of IGC, which is
+// otherwise selected by IMEX_USE_IGC_VECTOR_BACK_END. The native binary for
+// the device in \p aotBinaries, if any, is used instead of the SPIR-V.
+static ze_module_handle_t loadModule(GPUSYCLQUEUE *queue, const void *data,
+                                     size_t dataSize, int32_t grfSize = 0,
+                                     int32_t vectorBackend = 0,
+                                     const void *aotBinaries = nullptr) {
+  assert(data);
+  auto &syclQueue = queue->syclQueue_;
+
+  // TODO: Enable this for current Device
+  // query and throw an error for unsupported platforms
+  // getDeviceID(syclQueue);
+
+  auto build_flags = getBuildFlags(grfSize, vectorBackend);
   auto zeDevice = sycl::get_native<sycl::backend::ext_oneapi_level_zero>(
       syclQueue.get_device());
   auto zeContext = sycl::get_native<sycl::backend::ext_oneapi_level_zero>(
       syclQueue.get_context());
-  L0_SAFE_CALL(zeModuleCreate(zeContext, zeDevice, &desc, &zeModule, nullptr));
-  std::lock_guard<std::mutex> entryLock(mutexLock);
-  moduleCache[(void *)data].module = zeModule;
-  return zeModule;
+
+  return moduleCache.getOrCreate(
+      zeContext, zeDevice, data, dataSize, build_flags, [&]() {
+        ze_module_desc_t desc = {ZE_STRUCTURE_TYPE_MODULE_DESC,
+                                 nullptr,
+                                 ZE_MODULE_FORMAT_IL_SPIRV,
+                                 dataSize,
+                                 (const uint8_t *)data,
+                                 build_flags.c_str(),
+                                 nullptr};
+        ze_module_handle_t zeModule;
+        L0_SAFE_CALL(imex::ModulePreloader::get().createModule(
+            zeContext, zeDevice, desc, &zeModule, aotBinaries));
+        return zeModule;
+      });
+}
+
+static void unloadModule(ze_module_handle_t zeModule) {
+  assert(zeModule);
+  // Destroys all cached kernels of the module as well.
+  moduleCache.evict(zeModule);
 }
 
+// Kernels are cached per (module, name) so that repeated gpuKernelGet calls
+// for the same kernel return the same sycl::kernel instead of creating a new
+// one every time.
 static sycl::kernel *getKernel(GPUSYCLQUEUE *queue, ze_module_handle_t zeModule,
                                const char *name) {
   assert(zeModule);
   assert(name);
-  auto syclQueue = queue->syclQueue_;
+  auto entry = moduleCache.lookup(zeModule);
+  std::unique_lock<std::mutex> entryLock;
+  if (entry) {
+    entryLock = std::unique_lock<std::mutex>(entry->kernelsMutex);
+    auto it = entry->kernels.find(name);
+    if (it != entry->kernels.end())
+      return it->second.get();
+  }
+
+  auto &syclQueue = queue->syclQueue_;
   ze_kernel_handle_t zeKernel;
   sycl::kernel *syclKernel;
   ze_kernel_desc_t desc = {};
   desc.pKernelName = name;
 
   L0_SAFE_CALL(zeKernelCreate(zeModule, &desc, &zeKernel));
-  sycl::kernel_bundle<sycl::bundle_state::executable> kernelBundle =
-      sycl::make_kernel_bundle<sycl::backend::ext_oneapi_level_zero,
-                               sycl::bundle_state::executable>(
-          {zeModule}, syclQueue.get_context());
+  // The module stays owned by the module cache, which destroys it on unload.
+  auto makeBundle = [&]() {
+    return sycl::make_kernel_bundle<sycl::backend::ext_oneapi_level_zero,
+                                    sycl::bundle_state::executable>(
+        {zeModule, sycl::ext::oneapi::level_zero::ownership::keep},
+        syclQueue.get_context());
+  };
+  std::optional<sycl::kernel_bundle<sycl::bundle_state::executable>>
+      localBundle;
+  sycl::kernel_bundle<sycl::bundle_state::executable> *kernelBundle;
+  if (entry) {
+    if (!entry->bundle)
+      entry->bundle = std::make_unique<
+          sycl::kernel_bundle<sycl::bundle_state::executable>>(makeBundle());
+    kernelBundle = entry->bundle.get();
+  } else {
+    kernelBundle = &localBundle.emplace(makeBundle());
+  }
 
   auto kernel = sycl::make_kernel<sycl::backend::ext_oneapi_level_zero>(
-      {kernelBundle, zeKernel}, syclQueue.get_context());
+      {*kernelBundle, zeKernel}, syclQueue.get_context());
   syclKernel = new sycl::kernel(kernel);
+  if (entry)
+    entry->kernels[name].reset(syclKernel);
+  if (auto profiler = imex::KernelProfiler::get())
+    profiler->registerKernel(syclKernel, name);
+  if (auto trace = imex::TraceRecorder::get())
+    trace->registerKernel(syclKernel, name);
   return syclKernel;
 }
 
-static sycl::event enqueueKernel(sycl::queue queue, sycl::kernel *kernel,
+static sycl::event enqueueKernel(sycl::queue &queue, sycl::kernel *kernel,
                                  sycl::nd_range<3> NdRange, ParamDesc *params,
                                  size_t sharedMemBytes, EventDesc *depEvents) {
   auto depEventsCount = countUntil(depEvents, EventDesc{nullptr});
@@ -284,6 +699,9 @@ static sycl::event enqueueKernel(sycl::queue queue, sycl::kernel *kernel,
   if (sharedMemBytes) {
     paramsCount = paramsCount - 1;
   }
+  // Local memory is allocated as bytes, so that it is sized exactly whatever
+  // the element type the kernel uses.
+  using local_mem_t = sycl::local_accessor<uint8_t, 1>;
   sycl::event event = queue.submit([&](sycl::handler &cgh) {
     for (size_t i = 0; i < depEventsCount; i++) {
       // Depend on any event that was specified by the caller.
@@ -291,21 +709,19 @@ static sycl::event enqueueKernel(sycl::queue queue, sycl::kernel *kernel,
     }
     for (size_t i = 0; i < paramsCount; i++) {
       auto param = params[i];
-      cgh.set_arg(static_cast<uint32_t>(i),
-                  *(static_cast<void **>(param.data)));
-    }
-    if (sharedMemBytes) {
-      // TODO: Handle other data types
-      using share_mem_t =
-          sycl::accessor<float, 1, sycl::access::mode::read_write,
-                         sycl::access::target::local>;
-      share_mem_t local_buffer =
-          share_mem_t(sharedMemBytes / sizeof(float), cgh);
-      cgh.set_arg(paramsCount, local_buffer);
-      cgh.parallel_for(NdRange, *kernel);
-    } else {
-      cgh.parallel_for(NdRange, *kernel);
+      // A param without data is a local memory argument of param.size bytes,
+      // as in zeKernelSetArgumentValue.
+      if (!param.data)
+        cgh.set_arg(static_cast<uint32_t>(i),
+                    local_mem_t(sycl::range<1>(param.size), cgh));
+      else
+        cgh.set_arg(static_cast<uint32_t>(i),
+                    *(static_cast<void **>(param.data)));
     }
+    if (sharedMemBytes)
+      cgh.set_arg(static_cast<uint32_t>(paramsCount),
+                  local_mem_t(sycl::range<1>(sharedMemBytes), cgh));
+    cgh.parallel_for(NdRange, *kernel);
   });
 
   return event;
@@ -316,7 +732,7 @@ static sycl::event *launchKernel(GPUSYCLQUEUE *queue, sycl::kernel *kernel,
                                  size_t blockX, size_t blockY, size_t blockZ,
                                  size_t sharedMemBytes, ParamDesc *params,
                                  EventDesc *depEvents) {
-  auto syclQueue = queue->syclQueue_;
+  auto &syclQueue = queue->syclQueue_;
   auto syclGlobalRange =
       ::sycl::range<3>(blockZ * gridZ, blockY * gridY, blockX * gridX);
   auto syclLocalRange = ::sycl::range<3>(blockZ, blockY, blockX);
@@ -397,22 +813,25 @@ static sycl::event *launchKernel(GPUSYCLQUEUE *queue, sycl::kernel *kernel,
             executionTime / rounds, minTime, maxTime, rounds);
   }
 
+  auto submitNs = imex::TraceRecorder::now();
   auto event = enqueueKernel(syclQueue, kernel, syclNdRange, params,
                              sharedMemBytes, depEvents);
-
-  sycl::event *syclEvent = new sycl::event(event);
-
-  return syclEvent;
+  if (auto trace = imex::TraceRecorder::get())
+    queue->trace(event, "kernel", trace->getKernelName(kernel), 0, submitNs);
+  if (auto profiler = imex::KernelProfiler::get())
+    queue->pendingProfiles_.emplace_back(
+        event,
+        profiler->getKey(kernel, gridX, gridY, gridZ, blockX, blockY, blockZ));
+
+  return queue->wrapEvent(event);
 }
 
 // Wrappers
 
 extern "C" SYCL_RUNTIME_EXPORT GPUSYCLQUEUE *gpuCreateStream(void *device,
                                                              void *context) {
-  auto propList = sycl::property_list{};
-  if (getenv("IMEX_ENABLE_PROFILING")) {
-    propList = sycl::property_list{sycl::property::queue::enable_profiling()};
-  }
+  imex::TraceScope traceScope(__func__);
+  auto propList = getQueueProperties();
   return catchAll([&]() {
     if (!device && !context) {
       return new GPUSYCLQUEUE(propList);
@@ -429,34 +848,189 @@ extern "C" SYCL_RUNTIME_EXPORT GPUSYCLQUEUE *gpuCreateStream(void *device,
   });
 }
 
+// Creates a stream on the GPU with the given index and, if subDevice is not
+// negative, on the given sub-device (tile) of it. A negative device index
+// applies the default selection, see imex/ExecutionEngine/DeviceSelection.h.
+extern "C" SYCL_RUNTIME_EXPORT GPUSYCLQUEUE *
+gpuCreateStreamOnDevice(int64_t device, int64_t subDevice) {
+  imex::TraceScope traceScope(__func__);
+  auto propList = getQueueProperties();
+  return catchAll([&]() {
+    auto syclDevice = getDevice({device, subDevice});
+    return new GPUSYCLQUEUE(&syclDevice, propList);
+  });
+}
+
+// Creates a stream on the device and in the context of \p queue. The streams
+// share the modules and kernels loaded in the context.
+extern "C" SYCL_RUNTIME_EXPORT GPUSYCLQUEUE *
+gpuCreateStreamSharing(GPUSYCLQUEUE *queue) {
+  imex::TraceScope traceScope(__func__);
+  auto propList = getQueueProperties();
+  return catchAll([&]() {
+    return new GPUSYCLQUEUE(&queue->syclDevice_, &queue->syclContext_,
+                            propList);
+  });
+}
+
+// Returns the substream \p index of \p queue, 0 being \p queue itself.
+// Substreams submit to queues of their own in the same context, so that
+// independent launches on different substreams run concurrently, and are
+// destroyed with \p queue. With IMEX_SYCL_DISCARD_EVENTS, \p queue is
+// returned for all indices.
+extern "C" SYCL_RUNTIME_EXPORT GPUSYCLQUEUE *
+gpuStreamGetSubstream(GPUSYCLQUEUE *queue, int64_t index) {
+  imex::TraceScope traceScope(__func__);
+  auto propList = getQueueProperties();
+  return catchAll([&]() { return queue->getSubstream(index, propList); });
+}
+
 extern "C" SYCL_RUNTIME_EXPORT void gpuStreamDestroy(GPUSYCLQUEUE *queue) {
+  imex::TraceScope traceScope(__func__);
   catchAll([&]() { delete queue; });
 }
 
 extern "C" SYCL_RUNTIME_EXPORT void *
 gpuMemAlloc(GPUSYCLQUEUE *queue, size_t size, size_t alignment, bool isShared) {
+  imex::TraceScope traceScope(__func__);
   return catchAll([&]() {
     if (queue) {
-      return allocDeviceMemory(queue, size, alignment, isShared);
+      return allocTrackedMemory(queue, size, alignment, isShared, nullptr);
     }
   });
 }
 
+// gpuMemAlloc of code compiled with alloc-site-tags, \p site names the
+// calling function for IMEX_MEMORY_STATS.
+extern "C" SYCL_RUNTIME_EXPORT void *
+gpuMemAllocTagged(GPUSYCLQUEUE *queue, size_t size, size_t alignment,
+                  bool isShared, const char *site) {
+  imex::TraceScope traceScope(__func__);
+  return catchAll([&]() {
+    if (queue) {
+      return allocTrackedMemory(queue, size, alignment, isShared, site);
+    }
+  });
+}
+
+// Returns device memory holding the \p size bytes of the constant global at
+// \p hostPtr, the lowering of gpux.alloc with imex.constant_data. The data is
+// copied once per stream, later calls return the same memory.
+extern "C" SYCL_RUNTIME_EXPORT void *
+gpuMemAllocConstant(GPUSYCLQUEUE *queue, const void *hostPtr, size_t size,
+                    size_t alignment) {
+  imex::TraceScope traceScope(__func__);
+  return catchAll([&]() {
+    return allocConstantMemory(queue, hostPtr, size, alignment);
+  });
+}
+
 extern "C" SYCL_RUNTIME_EXPORT void gpuMemFree(GPUSYCLQUEUE *queue, void *ptr) {
+  imex::TraceScope traceScope(__func__);
+  catchAll([&]() {
+    if (queue && ptr) {
+      deallocTrackedMemory(queue, ptr, {});
+    }
+  });
+}
+
+extern "C" SYCL_RUNTIME_EXPORT void
+gpuMemFreeAsync(GPUSYCLQUEUE *queue, void *ptr, void *depEvents) {
+  imex::TraceScope traceScope(__func__);
   catchAll([&]() {
     if (queue && ptr) {
-      deallocDeviceMemory(queue, ptr);
+      deallocTrackedMemory(queue, ptr,
+                           getDepEvents(static_cast<EventDesc *>(depEvents)));
     }
   });
 }
 
+extern "C" SYCL_RUNTIME_EXPORT sycl::event *
+gpuMemPrefetch(GPUSYCLQUEUE *queue, void *ptr, size_t size, void *depEvents) {
+  imex::TraceScope traceScope(__func__);
+  return catchAll([&]() {
+    auto event = queue->syclQueue_.prefetch(
+        ptr, size, getDepEvents(static_cast<EventDesc *>(depEvents)));
+    return queue->wrapEvent(event);
+  });
+}
+
+// The Level Zero backend takes the native advice values.
+extern "C" SYCL_RUNTIME_EXPORT void
+gpuMemAdvise(GPUSYCLQUEUE *queue, void *ptr, size_t size, int32_t advice) {
+  imex::TraceScope traceScope(__func__);
+  catchAll([&]() {
+    queue->syclQueue_.mem_advise(ptr, size,
+                                 static_cast<int>(getZeMemAdvice(advice)));
+  });
+}
+
 extern "C" SYCL_RUNTIME_EXPORT void
 gpuMemCopy(GPUSYCLQUEUE *queue, void *dstPtr, void *srcPtr, size_t size) {
+  imex::TraceScope traceScope(__func__);
   return catchAll([&]() { memoryCopy(queue, dstPtr, srcPtr, size); });
 }
 
+extern "C" SYCL_RUNTIME_EXPORT sycl::event *
+gpuMemCopyAsync(GPUSYCLQUEUE *queue, void *dstPtr, void *srcPtr, size_t size,
+                void *depEvents) {
+  imex::TraceScope traceScope(__func__);
+  return catchAll([&]() {
+    return memoryCopyAsync(queue, dstPtr, srcPtr, size,
+                           static_cast<EventDesc *>(depEvents));
+  });
+}
+
+extern "C" SYCL_RUNTIME_EXPORT sycl::event *
+gpuMemset(GPUSYCLQUEUE *queue, void *dstPtr, void *pattern, size_t patternSize,
+          size_t size, void *depEvents) {
+  imex::TraceScope traceScope(__func__);
+  return catchAll([&]() {
+    return memoryFill(queue, dstPtr, pattern, patternSize, size,
+                      static_cast<EventDesc *>(depEvents));
+  });
+}
+
+extern "C" SYCL_RUNTIME_EXPORT sycl::event *
+gpuFillRandom(GPUSYCLQUEUE *queue, void *dstPtr, int32_t type, size_t count,
+              float lower, float upper, bool genInt, int64_t seed,
+              void *depEvents) {
+  imex::TraceScope traceScope(__func__);
+  imex::RandomFillParams params{static_cast<uint64_t>(seed), lower, upper,
+                                genInt};
+  return catchAll([&]() {
+    return fillRandom(queue, dstPtr, static_cast<imex::RandomFillType>(type),
+                      count, params, static_cast<EventDesc *>(depEvents));
+  });
+}
+
+extern "C" SYCL_RUNTIME_EXPORT sycl::event *gpuBarrier(GPUSYCLQUEUE *queue,
+                                                       void *depEvents) {
+  imex::TraceScope traceScope(__func__);
+  return catchAll([&]() {
+    auto event = queue->syclQueue_.ext_oneapi_submit_barrier(
+        getDepEvents(static_cast<EventDesc *>(depEvents)));
+    return queue->wrapEvent(event);
+  });
+}
+
+extern "C" SYCL_RUNTIME_EXPORT void gpuWaitEvents(GPUSYCLQUEUE *queue,
+                                                  void *depEvents) {
+  imex::TraceScope traceScope(__func__);
+  catchAll([&]() {
+    // Without events, the queue order is all there is to wait for.
+    if (queue->discardEvents_) {
+      queue->syclQueue_.wait();
+      return;
+    }
+    for (auto &event : getDepEvents(static_cast<EventDesc *>(depEvents)))
+      event.wait();
+  });
+}
+
 extern "C" SYCL_RUNTIME_EXPORT ze_module_handle_t
 gpuModuleLoad(GPUSYCLQUEUE *queue, const void *data, size_t dataSize) {
+  imex::TraceScope traceScope(__func__);
   return catchAll([&]() {
     if (queue) {
       return loadModule(queue, data, dataSize);
@@ -464,8 +1038,59 @@ gpuModuleLoad(GPUSYCLQUEUE *queue, const void *data, size_t dataSize) {
   });
 }
 
+extern "C" SYCL_RUNTIME_EXPORT ze_module_handle_t
+gpuModuleLoadWithGRFSize(GPUSYCLQUEUE *queue, const void *data,
+                         size_t dataSize, int32_t grfSize) {
+  imex::TraceScope traceScope(__func__);
+  return catchAll([&]() {
+    if (queue) {
+      return loadModule(queue, data, dataSize, grfSize);
+    }
+  });
+}
+
+extern "C" SYCL_RUNTIME_EXPORT ze_module_handle_t
+gpuModuleLoadWithOptions(GPUSYCLQUEUE *queue, const void *data,
+                         size_t dataSize, int32_t grfSize,
+                         int32_t vectorBackend, const void *aotBinaries) {
+  imex::TraceScope traceScope(__func__);
+  return catchAll([&]() {
+    if (queue) {
+      return loadModule(queue, data, dataSize, grfSize, vectorBackend,
+                        aotBinaries);
+    }
+  });
+}
+
+// Queues the compilation of the module a later gpuModuleLoadWithOptions with
+// the same arguments loads, for the default device, see ModulePreloader.h.
+// Called by the global constructor of convert-gpux-to-llvm{preload-modules}.
+extern "C" SYCL_RUNTIME_EXPORT void
+gpuModulePreload(const void *data, size_t dataSize, int32_t grfSize,
+                 int32_t vectorBackend, const void *aotBinaries) {
+  imex::TraceScope traceScope(__func__);
+  catchAll([&]() {
+    auto getDevice = []() {
+      auto device = getDefaultDevice();
+      return std::make_pair(
+          sycl::get_native<sycl::backend::ext_oneapi_level_zero>(
+              device.get_platform()),
+          sycl::get_native<sycl::backend::ext_oneapi_level_zero>(device));
+    };
+    imex::ModulePreloader::get().preload(getDevice, data, dataSize,
+                                         getBuildFlags(grfSize, vectorBackend),
+                                         aotBinaries);
+  });
+}
+
+extern "C" SYCL_RUNTIME_EXPORT void gpuModuleUnload(ze_module_handle_t module) {
+  imex::TraceScope traceScope(__func__);
+  catchAll([&]() { unloadModule(module); });
+}
+
 extern "C" SYCL_RUNTIME_EXPORT sycl::kernel *
 gpuKernelGet(GPUSYCLQUEUE *queue, ze_module_handle_t module, const char *name) {
+  imex::TraceScope traceScope(__func__);
   return catchAll([&]() {
     if (queue) {
       return getKernel(queue, module, name);
@@ -473,11 +1098,27 @@ gpuKernelGet(GPUSYCLQUEUE *queue, ze_module_handle_t module, const char *name) {
   });
 }
 
+// Sets the cost estimates of imex-estimate-kernel-cost for the profiler.
+extern "C" SYCL_RUNTIME_EXPORT void
+gpuKernelSetCost(GPUSYCLQUEUE *queue, sycl::kernel *kernel,
+                 int64_t bytesPerItem, int64_t flopsPerItem) {
+  imex::TraceScope traceScope(__func__);
+  if (auto profiler = imex::KernelProfiler::get())
+    profiler->setCost(kernel, bytesPerItem, flopsPerItem);
+}
+
+// Marks a kernel as group size agnostic, see imex-group-size-agnostic. The
+// SYCL runtime keeps the group sizes of the launches.
+extern "C" SYCL_RUNTIME_EXPORT void
+gpuKernelSetGroupSizeAgnostic(GPUSYCLQUEUE *queue, sycl::kernel *kernel,
+                              int32_t grfSize) {}
+
 extern "C" SYCL_RUNTIME_EXPORT sycl::event *
 gpuLaunchKernel(GPUSYCLQUEUE *queue, sycl::kernel *kernel, size_t gridX,
                 size_t gridY, size_t gridZ, size_t blockX, size_t blockY,
                 size_t blockZ, size_t sharedMemBytes, void *params,
                 void *depEvents) {
+  imex::TraceScope traceScope(__func__);
   return catchAll([&]() {
     if (queue) {
       return launchKernel(queue, kernel, gridX, gridY, gridZ, blockX, blockY,
@@ -488,11 +1129,58 @@ gpuLaunchKernel(GPUSYCLQUEUE *queue, sycl::kernel *kernel, size_t gridX,
   });
 }
 
+extern "C" SYCL_RUNTIME_EXPORT sycl::event *gpuLaunchKernelPacked(
+    GPUSYCLQUEUE *queue, sycl::kernel *kernel, size_t gridX, size_t gridY,
+    size_t gridZ, size_t blockX, size_t blockY, size_t blockZ,
+    size_t sharedMemBytes, void *args, const int64_t *layout,
+    void *depEvents) {
+  imex::TraceScope traceScope(__func__);
+  return catchAll([&]() {
+    return launchKernel(queue, kernel, gridX, gridY, gridZ, blockX, blockY,
+                        blockZ, sharedMemBytes, unpackParams(args, layout),
+                        static_cast<EventDesc *>(depEvents));
+  });
+}
+
+// Launches \p count kernels in order with a single call. The first launch
+// depends on \p depEvents and each following launch on the previous one.
+// Returns the event of the last launch.
+extern "C" SYCL_RUNTIME_EXPORT sycl::event *gpuLaunchKernels(
+    GPUSYCLQUEUE *queue, LaunchDesc *launches, size_t count, void *depEvents) {
+  imex::TraceScope traceScope(__func__);
+  return catchAll([&]() {
+    auto deps = static_cast<EventDesc *>(depEvents);
+    sycl::event *event = nullptr;
+    for (size_t i = 0; i < count; ++i) {
+      auto &launch = launches[i];
+      EventDesc prev[] = {{event}, {nullptr}};
+      event = launchKernel(queue, static_cast<sycl::kernel *>(launch.kernel),
+                           launch.grid[0], launch.grid[1], launch.grid[2],
+                           launch.block[0], launch.block[1], launch.block[2],
+                           launch.sharedMemBytes, launch.params,
+                           i == 0 ? deps : prev);
+    }
+    return event;
+  });
+}
+
+// Graph capture is only implemented by the Level Zero runtime. Here the
+// launches of a graph region are submitted as usual and the end of the region
+// waits for them, which keeps the same synchronization semantics.
+extern "C" SYCL_RUNTIME_EXPORT void gpuGraphBegin(GPUSYCLQUEUE *queue,
+                                                  const void *id) {}
+
+extern "C" SYCL_RUNTIME_EXPORT void gpuGraphEnd(GPUSYCLQUEUE *queue) {
+  imex::TraceScope traceScope(__func__);
+  catchAll([&]() { queue->syclQueue_.wait(); });
+}
+
 extern "C" SYCL_RUNTIME_EXPORT void gpuWait(GPUSYCLQUEUE *queue) {
+  imex::TraceScope traceScope(__func__);
 
   catchAll([&]() {
     if (queue) {
-      queue->syclQueue_.wait();
+      queue->synchronize();
     }
   });
 }
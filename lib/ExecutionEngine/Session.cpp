@@ -0,0 +1,379 @@
+//===- Session.cpp - Compiled functions for embedding IMEX ------*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file implements the session API. The stream getter of a session is
+/// defined in the module itself: it calls the function stored in one global
+/// with the session stored in another, both set once the module is compiled.
+/// Each thread caches its stream, so a call only takes the session lock the
+/// first time a thread calls into the session.
+///
+/// Specializations are compiled from the printed source of the module in
+/// contexts of their own, so that they do not race with the users of the
+/// original context. They share the streams, and therefore the GPU context
+/// and the memory, of the session they belong to.
+///
+//===----------------------------------------------------------------------===//
+
+#include "imex/ExecutionEngine/Session.h"
+
+#include <mlir/Dialect/Func/IR/FuncOps.h>
+#include <mlir/Dialect/LLVMIR/LLVMDialect.h>
+#include <mlir/Dialect/MemRef/IR/MemRef.h>
+#include <mlir/ExecutionEngine/OptUtils.h>
+#include <mlir/IR/Builders.h>
+#include <mlir/Parser/Parser.h>
+#include <mlir/Pass/PassManager.h>
+#include <mlir/Target/LLVMIR/Dialect/Builtin/BuiltinToLLVMIRTranslation.h>
+#include <mlir/Target/LLVMIR/Dialect/LLVMIR/LLVMToLLVMIRTranslation.h>
+#include <mlir/Transforms/Passes.h>
+
+#include <llvm/Support/TargetSelect.h>
+
+#include <atomic>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+static constexpr llvm::StringLiteral kSessionGlobalName = "imex_session";
+static constexpr llvm::StringLiteral kGetStreamGlobalName =
+    "imex_session_get_stream";
+
+static void *getSessionStream(void *session) {
+  return static_cast<imex::Session *>(session)->getStream();
+}
+
+/// Defines the declaration \p getter emitted by the stream-getter lowering.
+static void defineStreamGetter(mlir::LLVM::LLVMFuncOp getter) {
+  auto loc = getter.getLoc();
+  auto ptrType = mlir::LLVM::LLVMPointerType::get(getter.getContext());
+  mlir::OpBuilder builder(getter);
+  auto createGlobal = [&](llvm::StringRef name) {
+    mlir::OpBuilder::InsertionGuard guard(builder);
+    auto global = builder.create<mlir::LLVM::GlobalOp>(
+        loc, ptrType, /*isConstant=*/false, mlir::LLVM::Linkage::External,
+        name, mlir::Attribute());
+    builder.createBlock(&global.getInitializerRegion());
+    builder.create<mlir::LLVM::ReturnOp>(
+        loc, builder.create<mlir::LLVM::ZeroOp>(loc, ptrType).getResult());
+    return global;
+  };
+  auto sessionGlobal = createGlobal(kSessionGlobalName);
+  auto getStreamGlobal = createGlobal(kGetStreamGlobalName);
+
+  // llvm.func @imexSessionGetStream() -> !llvm.ptr {
+  //   return imex_session_get_stream(imex_session)
+  // }
+  builder.createBlock(&getter.getBody());
+  auto getStream = builder.create<mlir::LLVM::LoadOp>(
+      loc, ptrType,
+      builder.create<mlir::LLVM::AddressOfOp>(loc, getStreamGlobal));
+  auto session = builder.create<mlir::LLVM::LoadOp>(
+      loc, ptrType,
+      builder.create<mlir::LLVM::AddressOfOp>(loc, sessionGlobal));
+  auto stream = builder.create<mlir::LLVM::CallOp>(
+      loc, mlir::LLVM::LLVMFunctionType::get(ptrType, {ptrType}),
+      mlir::ValueRange{getStream, session});
+  builder.create<mlir::LLVM::ReturnOp>(loc, stream->getResult(0));
+}
+
+/// Makes the dynamic sizes of the memref arguments of \p func static as given
+/// by \p shapes, in the order of the arguments and their dimensions. The
+/// arguments are cast to the static types and back, so that the signature
+/// stays the same and canonicalization folds the sizes into their uses.
+static void specializeShapes(mlir::func::FuncOp func,
+                             llvm::ArrayRef<int64_t> shapes) {
+  mlir::OpBuilder builder(func.getBody());
+  for (auto arg : func.getArguments()) {
+    auto type = mlir::dyn_cast<mlir::MemRefType>(arg.getType());
+    if (!type || type.hasStaticShape())
+      continue;
+    llvm::SmallVector<int64_t> shape(type.getShape());
+    for (auto &size : shape)
+      if (mlir::ShapedType::isDynamic(size)) {
+        size = shapes.front();
+        shapes = shapes.drop_front();
+      }
+    auto loc = arg.getLoc();
+    mlir::MemRefType staticType =
+        mlir::MemRefType::Builder(type).setShape(shape);
+    auto staticArg =
+        builder.create<mlir::memref::CastOp>(loc, staticType, arg);
+    auto dynamicArg =
+        builder.create<mlir::memref::CastOp>(loc, type, staticArg);
+    arg.replaceAllUsesExcept(dynamicArg, staticArg);
+  }
+}
+
+/// Compiles and caches the specializations of a function for the shapes of
+/// its memref arguments.
+class imex::Session::Function::Specializer {
+public:
+  /// Returns a specializer for function \p name of \p session, nullptr if
+  /// the function cannot be specialized.
+  static std::unique_ptr<Specializer> create(Session &session,
+                                             llvm::StringRef name) {
+    mlir::MLIRContext context(*session.registry_);
+    auto module =
+        mlir::parseSourceString<mlir::ModuleOp>(session.source_, &context);
+    auto func = module ? module->lookupSymbol<mlir::func::FuncOp>(name)
+                       : mlir::func::FuncOp();
+    if (!func || func.isExternal())
+      return nullptr;
+
+    // The packed arguments are the arguments of the lowered function: the
+    // descriptor of a ranked memref is the allocated and aligned pointers,
+    // the offset, the sizes and the strides.
+    std::unique_ptr<Specializer> specializer(new Specializer(session, name));
+    unsigned slot = 0;
+    for (auto type : func.getArgumentTypes()) {
+      if (auto memrefType = mlir::dyn_cast<mlir::MemRefType>(type)) {
+        for (auto [dim, size] : llvm::enumerate(memrefType.getShape()))
+          if (mlir::ShapedType::isDynamic(size))
+            specializer->sizeSlots_.push_back(slot + 3 + dim);
+        slot += 3 + 2 * memrefType.getRank();
+      } else if (mlir::isa<mlir::UnrankedMemRefType>(type)) {
+        slot += 2;
+      } else if (type.isIntOrIndexOrFloat()) {
+        ++slot;
+      } else {
+        return nullptr;
+      }
+    }
+    if (specializer->sizeSlots_.empty())
+      return nullptr;
+    return specializer;
+  }
+
+  /// Waits for the specializations being compiled.
+  ~Specializer() {
+    for (auto &thread : threads_)
+      thread.join();
+  }
+
+  /// Returns the specialization for the shapes in \p args, nullptr if it is
+  /// not ready. Starts compiling it if it is new and the limit of
+  /// specializations is not reached.
+  PackedFn get(void **args) {
+    std::vector<int64_t> shapes;
+    shapes.reserve(sizeSlots_.size());
+    for (auto slot : sizeSlots_)
+      shapes.push_back(*static_cast<int64_t *>(args[slot]));
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = specializations_.find(shapes);
+    if (it != specializations_.end())
+      return it->second.fn;
+    if (specializations_.size() >= session_.options_.maxSpecializations)
+      return nullptr;
+    specializations_.emplace(shapes, Specialization());
+    threads_.emplace_back([this, shapes]() { compile(shapes); });
+    return nullptr;
+  }
+
+private:
+  struct Specialization {
+    std::unique_ptr<Session> session;
+    PackedFn fn = nullptr;
+  };
+
+  Specializer(Session &session, llvm::StringRef name)
+      : session_(session), name_(name.str()) {}
+
+  /// Compiles the specialization for \p shapes. It stays unavailable if this
+  /// fails, calls then keep using the generic function.
+  void compile(const std::vector<int64_t> &shapes) {
+    mlir::MLIRContext context(*session_.registry_);
+    auto module =
+        mlir::parseSourceString<mlir::ModuleOp>(session_.source_, &context);
+    if (!module)
+      return;
+    context.getOrLoadDialect<mlir::memref::MemRefDialect>();
+    specializeShapes(module->lookupSymbol<mlir::func::FuncOp>(name_), shapes);
+    mlir::PassManager pm(&context);
+    pm.addPass(mlir::createCanonicalizerPass());
+    if (mlir::failed(pm.run(*module)))
+      return;
+
+    auto options = session_.options_;
+    options.maxSpecializations = 0;
+    auto session = Session::create(*module, options, &session_);
+    if (!session) {
+      llvm::consumeError(session.takeError());
+      return;
+    }
+    auto fn = (*session)->engine_->lookupPacked(name_);
+    if (!fn) {
+      llvm::consumeError(fn.takeError());
+      return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto &specialization = specializations_[shapes];
+    specialization.session = std::move(*session);
+    specialization.fn = *fn;
+  }
+
+  Session &session_;
+  std::string name_;
+  // The slots of the packed arguments holding the dynamic sizes.
+  llvm::SmallVector<unsigned> sizeSlots_;
+  std::mutex mutex_;
+  std::map<std::vector<int64_t>, Specialization> specializations_;
+  std::vector<std::thread> threads_;
+};
+
+void imex::Session::Function::invoke(llvm::MutableArrayRef<void *> args) const {
+  if (specializer_)
+    if (auto fn = specializer_->get(args.data()))
+      return fn(args.data());
+  fn_(args.data());
+}
+
+llvm::Expected<std::unique_ptr<imex::Session>>
+imex::Session::create(mlir::ModuleOp module, const SessionOptions &options) {
+  return create(module, options, nullptr);
+}
+
+llvm::Expected<std::unique_ptr<imex::Session>>
+imex::Session::create(mlir::ModuleOp module, const SessionOptions &options,
+                      Session *streamOwner) {
+  static std::once_flag targetOnce;
+  std::call_once(targetOnce, []() {
+    llvm::InitializeNativeTarget();
+    llvm::InitializeNativeTargetAsmPrinter();
+  });
+
+  auto *context = module.getContext();
+  std::string source;
+  if (options.maxSpecializations) {
+    llvm::raw_string_ostream os(source);
+    module->print(os);
+  }
+  if (options.buildPipeline) {
+    mlir::PassManager pm(context);
+    options.buildPipeline(pm);
+    if (mlir::failed(pm.run(module)))
+      return llvm::createStringError("could not lower the module");
+  }
+
+  if (module.lookupSymbol<mlir::LLVM::LLVMFuncOp>("gpuCreateStream"))
+    return llvm::createStringError(
+        "the module creates its own streams, lower it with "
+        "convert-gpux-to-llvm{stream-getter=" +
+        streamGetterName + "}");
+  auto getter = module.lookupSymbol<mlir::LLVM::LLVMFuncOp>(streamGetterName);
+  if (getter) {
+    if (!getter.isExternal())
+      return llvm::createStringError(streamGetterName +
+                                     " is already defined");
+    defineStreamGetter(getter);
+  }
+
+  mlir::registerBuiltinDialectTranslation(*context);
+  mlir::registerLLVMDialectTranslation(*context);
+  llvm::SmallVector<llvm::StringRef> sharedLibPaths(
+      options.sharedLibPaths.begin(), options.sharedLibPaths.end());
+  mlir::ExecutionEngineOptions engineOptions;
+  engineOptions.transformer = mlir::makeOptimizingTransformer(
+      options.optLevel, /*sizeLevel=*/0, /*targetMachine=*/nullptr);
+  engineOptions.jitCodeGenOptLevel =
+      static_cast<llvm::CodeGenOptLevel>(options.optLevel);
+  engineOptions.sharedLibPaths = sharedLibPaths;
+  auto engine = mlir::ExecutionEngine::create(module, engineOptions);
+  if (!engine)
+    return engine.takeError();
+
+  static std::atomic<uint64_t> nextId{1};
+  std::unique_ptr<Session> session(new Session());
+  session->engine_ = std::move(*engine);
+  session->id_ = nextId++;
+  session->options_ = options;
+  session->streamOwner_ = streamOwner;
+  if (options.maxSpecializations) {
+    session->source_ = std::move(source);
+    session->registry_ = std::make_unique<mlir::DialectRegistry>();
+    context->getDialectRegistry().appendTo(*session->registry_);
+  }
+  if (getter)
+    if (auto err = session->bindStreams())
+      return std::move(err);
+  return std::move(session);
+}
+
+imex::Session::~Session() {
+  // the specializations may use the streams while they get compiled
+  specializers_.clear();
+  for (auto &[thread, stream] : streams_)
+    if (stream != firstStream_)
+      streamDestroy_(stream);
+  if (firstStream_)
+    streamDestroy_(firstStream_);
+}
+
+llvm::Expected<imex::Session::Function>
+imex::Session::lookup(llvm::StringRef name) const {
+  auto fn = engine_->lookupPacked(name);
+  if (!fn)
+    return fn.takeError();
+  if (!options_.maxSpecializations)
+    return Function(*fn, nullptr);
+
+  std::lock_guard<std::mutex> lock(specializersMutex_);
+  auto [it, inserted] = specializers_.try_emplace(name.str());
+  if (inserted)
+    it->second =
+        Function::Specializer::create(const_cast<Session &>(*this), name);
+  return Function(*fn, it->second.get());
+}
+
+void *imex::Session::getStream() {
+  // The session and stream of the last call of the thread.
+  thread_local std::pair<uint64_t, void *> cached;
+  if (cached.first == id_)
+    return cached.second;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto &stream = streams_[std::this_thread::get_id()];
+  if (!stream) {
+    stream = firstStream_ ? createStreamSharing_(firstStream_)
+                          : createStream_(nullptr, nullptr);
+    if (!firstStream_)
+      firstStream_ = stream;
+  }
+  cached = {id_, stream};
+  return stream;
+}
+
+/// Resolves the stream functions of the runtime and points the globals read
+/// by the stream getter at this session.
+llvm::Error imex::Session::bindStreams() {
+  auto resolve = [&](llvm::StringRef name, auto &ptr) -> llvm::Error {
+    auto symbol = engine_->lookup(name);
+    if (!symbol)
+      return symbol.takeError();
+    ptr = reinterpret_cast<std::remove_reference_t<decltype(ptr)>>(*symbol);
+    return llvm::Error::success();
+  };
+  void **sessionPtr = nullptr;
+  void **getStreamPtr = nullptr;
+  if (auto err = resolve("gpuCreateStream", createStream_))
+    return err;
+  if (auto err = resolve("gpuCreateStreamSharing", createStreamSharing_))
+    return err;
+  if (auto err = resolve("gpuStreamDestroy", streamDestroy_))
+    return err;
+  if (auto err = resolve(kSessionGlobalName, sessionPtr))
+    return err;
+  if (auto err = resolve(kGetStreamGlobalName, getStreamPtr))
+    return err;
+  *sessionPtr = streamOwner_ ? streamOwner_ : this;
+  *getStreamPtr = reinterpret_cast<void *>(&getSessionStream);
+  return llvm::Error::success();
+}
@@ -10,14 +10,20 @@
 /// \file
 /// When the original func does not have an outer parallel loop, this pass adds
 /// one so that the immediately followed pass gpu-map-parallel-loops can work.
+/// Optionally, the outer loops of perfect scf.for nests whose iterations are
+/// independent are promoted into a multi-dimensional parallel loop instead.
 ///
 //===----------------------------------------------------------------------===//
 
 #include "imex/Dialect/Region/IR/RegionOps.h"
 #include "imex/Transforms/Passes.h"
 #include "mlir/Dialect/Arith/IR/Arith.h"
+#include "mlir/Analysis/AliasAnalysis.h"
 #include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/Dialect/MemRef/IR/MemRef.h"
 #include "mlir/Dialect/SCF/IR/SCF.h"
+#include "mlir/Interfaces/SideEffectInterfaces.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SetVector.h"
 
 namespace imex {
@@ -29,9 +35,117 @@ using namespace mlir;
 using namespace imex;
 
 namespace {
+
+// The maximum number of loops promoted into one parallel loop, matching the
+// number of dimensions of the GPU grid.
+static constexpr unsigned maxParallelDims = 3;
+
+// Returns the loops of the perfect nest rooted at \p forOp.
+static llvm::SmallVector<scf::ForOp> getPerfectNest(scf::ForOp forOp) {
+  llvm::SmallVector<scf::ForOp> nest{forOp};
+  while (true) {
+    auto &ops = nest.back().getBody()->getOperations();
+    auto inner = dyn_cast<scf::ForOp>(ops.front());
+    if (ops.size() != 2 || !inner || !inner.getInitArgs().empty())
+      break;
+    nest.push_back(inner);
+  }
+  return nest;
+}
+
+struct MemAccess {
+  Value memref;
+  ValueRange indices;
+  bool isWrite;
+};
+
+// Collects the memref accesses of \p forOp. Returns failure if it contains
+// ops with other side effects.
+static LogicalResult
+collectAccesses(scf::ForOp forOp, llvm::SmallVectorImpl<MemAccess> &accesses) {
+  auto result = forOp.getBody()->walk([&](Operation *op) {
+    if (auto load = dyn_cast<memref::LoadOp>(op)) {
+      accesses.push_back({load.getMemref(), load.getIndices(), false});
+    } else if (auto store = dyn_cast<memref::StoreOp>(op)) {
+      accesses.push_back({store.getMemref(), store.getIndices(), true});
+    } else if (!isa<scf::ForOp, scf::YieldOp>(op) && !isPure(op)) {
+      return WalkResult::interrupt();
+    }
+    return WalkResult::advance();
+  });
+  return failure(result.wasInterrupted());
+}
+
+// Returns true if the iterations of the loop with induction variable \p iv
+// access disjoint elements of the written memrefs: all accesses to a written
+// memref use the same indices, which include \p iv, and no other access may
+// alias it.
+static bool isParallel(Value iv, llvm::ArrayRef<MemAccess> accesses,
+                       AliasAnalysis &aliasAnalysis) {
+  for (const auto &write : accesses) {
+    if (!write.isWrite)
+      continue;
+    if (!llvm::is_contained(write.indices, iv))
+      return false;
+    for (const auto &access : accesses) {
+      if (access.memref == write.memref) {
+        if (!llvm::equal(access.indices, write.indices))
+          return false;
+      } else if (!aliasAnalysis.alias(access.memref, write.memref).isNo()) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
 struct AddOuterParallelLoopPass
     : public imex::impl::AddOuterParallelLoopBase<AddOuterParallelLoopPass> {
 private:
+  // Promotes the outermost independent loops of the perfect nest rooted at
+  // \p forOp into a parallel loop. Returns failure if the outermost loop is
+  // not independent.
+  LogicalResult promoteLoops(scf::ForOp forOp, OpBuilder &builder) {
+    llvm::SmallVector<MemAccess> accesses;
+    if (failed(collectAccesses(forOp, accesses)))
+      return failure();
+    auto &aliasAnalysis = getAnalysis<AliasAnalysis>();
+    llvm::SmallVector<scf::ForOp> promoted;
+    for (auto loop : getPerfectNest(forOp)) {
+      if (promoted.size() == maxParallelDims ||
+          !isParallel(loop.getInductionVar(), accesses, aliasAnalysis))
+        break;
+      // The bounds of a promoted loop must not depend on the other ones.
+      if (llvm::any_of(promoted, [&](scf::ForOp outer) {
+            return !outer.isDefinedOutsideOfLoop(loop.getLowerBound()) ||
+                   !outer.isDefinedOutsideOfLoop(loop.getUpperBound()) ||
+                   !outer.isDefinedOutsideOfLoop(loop.getStep());
+          }))
+        break;
+      promoted.push_back(loop);
+    }
+    if (promoted.empty())
+      return failure();
+
+    llvm::SmallVector<Value> lbs, ubs, steps;
+    for (auto loop : promoted) {
+      lbs.push_back(loop.getLowerBound());
+      ubs.push_back(loop.getUpperBound());
+      steps.push_back(loop.getStep());
+    }
+    builder.setInsertionPoint(forOp);
+    auto parallel = builder.create<scf::ParallelOp>(forOp.getLoc(), lbs, ubs,
+                                                     steps);
+    auto *body = promoted.back().getBody();
+    auto yieldOp = parallel.getBody()->getTerminator();
+    for (auto &op : llvm::make_early_inc_range(body->without_terminator()))
+      op.moveBefore(yieldOp);
+    for (auto [loop, iv] : llvm::zip(promoted, parallel.getInductionVars()))
+      loop.getInductionVar().replaceAllUsesWith(iv);
+    forOp.erase();
+    return success();
+  }
+
   void runOnBlock(::mlir::Block &block, ::mlir::Operation *parent,
                   mlir::OpBuilder &builder) {
     llvm::SmallVector<llvm::SmallVector<Operation *, 4>, 4> groupedOps;
@@ -50,6 +164,8 @@ private:
       }
       // populate forOp w/o iter_args
       if (forOp.getInitArgs().size() == 0) {
+        if (promote && succeeded(promoteLoops(forOp, builder)))
+          continue;
         groupedOps.push_back({forOp});
         continue;
       }
@@ -0,0 +1,151 @@
+//===- AssignGPUXStreams.cpp - AssignGPUXStreams Pass -----------*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file distributes independent chains of async gpux.launch_func ops
+/// over substreams of their stream, so that the kernels of independent
+/// branches, e.g. attention heads or small GEMMs, run concurrently instead of
+/// one after the other on one command list. Joins stay expressed by the async
+/// tokens, which the runtime turns into event dependencies across substreams.
+///
+//===----------------------------------------------------------------------===//
+
+#include <imex/Dialect/GPUX/IR/GPUXOps.h>
+#include <imex/Transforms/Passes.h>
+
+#include <mlir/Dialect/Func/IR/FuncOps.h>
+#include <mlir/Dialect/GPU/IR/GPUDialect.h>
+#include <mlir/IR/Builders.h>
+#include <mlir/Pass/Pass.h>
+
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/DenseSet.h>
+#include <llvm/ADT/MapVector.h>
+
+#include <optional>
+
+namespace imex {
+#define GEN_PASS_DEF_ASSIGNGPUXSTREAMS
+#include "imex/Transforms/Passes.h.inc"
+} // namespace imex
+
+namespace {
+
+// Returns the stream \p op submits to, if it is a gpux op with one.
+static mlir::Value getStream(mlir::Operation *op) {
+  if (!mlir::isa<imex::gpux::GPUXDialect>(op->getDialect()) ||
+      mlir::isa<imex::gpux::DestroyStreamOp, imex::gpux::SubstreamOp>(op))
+    return {};
+  for (auto operand : op->getOperands())
+    if (mlir::isa<imex::gpux::StreamType>(operand.getType()))
+      return operand;
+  return {};
+}
+
+// Returns true if \p op does not rely on the order of the ops submitted to
+// its stream: it is async, so only ordered through its tokens, or a wait,
+// which waits for the substreams as well, or a hint.
+static bool isTokenOrdered(mlir::Operation *op) {
+  if (mlir::isa<imex::gpux::WaitOp, imex::gpux::MemAdviseOp>(op))
+    return true;
+  auto asyncOp = mlir::dyn_cast<mlir::gpu::AsyncOpInterface>(op);
+  return asyncOp && asyncOp.getAsyncToken();
+}
+
+class AssignGPUXStreamsPass final
+    : public imex::impl::AssignGPUXStreamsBase<AssignGPUXStreamsPass> {
+public:
+  using AssignGPUXStreamsBase::AssignGPUXStreamsBase;
+
+  void runOnOperation() override {
+    if (numStreams < 2)
+      return;
+    substreams.clear();
+    // Substreams are inserted while assigning, so collect the blocks first.
+    llvm::SmallVector<mlir::Block *> blocks;
+    getOperation()->walk([&](mlir::Block *block) { blocks.push_back(block); });
+    for (auto *block : blocks)
+      assignBlock(*block);
+  }
+
+private:
+  // Assigns the async launches of \p block to substreams. Launches on a
+  // stream are only moved if no op of the block on that stream, including
+  // the ones nested in regions, relies on the submission order.
+  void assignBlock(mlir::Block &block) {
+    llvm::MapVector<mlir::Value, llvm::SmallVector<imex::gpux::LaunchFuncOp>>
+        launches;
+    llvm::DenseSet<mlir::Value> ordered;
+    for (auto &op : block) {
+      op.walk([&](mlir::Operation *nested) {
+        auto stream = getStream(nested);
+        if (stream && !isTokenOrdered(nested))
+          ordered.insert(stream);
+      });
+      auto launch = mlir::dyn_cast<imex::gpux::LaunchFuncOp>(op);
+      if (launch && launch.getAsyncToken())
+        launches[launch.getGpuxStream()].push_back(launch);
+    }
+
+    for (auto &[stream, streamLaunches] : launches) {
+      if (ordered.contains(stream))
+        continue;
+      // A launch continues the chain of its first dependency that is the
+      // last launch of a lane so far, or else starts a new chain on the next
+      // lane, round robin. Lane 0 is the stream itself.
+      llvm::DenseMap<mlir::Value, unsigned> tokenLanes;
+      llvm::SmallVector<mlir::Value> laneTails(numStreams);
+      unsigned nextLane = 0;
+      for (auto launch : streamLaunches) {
+        std::optional<unsigned> lane;
+        for (auto dep : launch.getAsyncDependencies()) {
+          auto it = tokenLanes.find(dep);
+          if (it != tokenLanes.end() && laneTails[it->second] == dep) {
+            lane = it->second;
+            break;
+          }
+        }
+        if (!lane) {
+          lane = nextLane;
+          nextLane = (nextLane + 1) % numStreams;
+        }
+        auto token = launch.getAsyncToken();
+        laneTails[*lane] = token;
+        tokenLanes[token] = *lane;
+        if (*lane)
+          launch.getGpuxStreamMutable().assign(getSubstream(stream, *lane));
+      }
+    }
+  }
+
+  // Returns the substream \p lane of \p stream, created right after the
+  // definition of the stream so that it dominates all its uses.
+  mlir::Value getSubstream(mlir::Value stream, unsigned lane) {
+    auto &substream = substreams[{stream, lane}];
+    if (!substream) {
+      mlir::OpBuilder builder(&getContext());
+      builder.setInsertionPointAfterValue(stream);
+      substream = builder.create<imex::gpux::SubstreamOp>(
+          stream.getLoc(), stream.getType(), stream,
+          builder.getI64IntegerAttr(lane));
+    }
+    return substream;
+  }
+
+  // The substreams created in the function, by stream and lane.
+  llvm::DenseMap<std::pair<mlir::Value, unsigned>, mlir::Value> substreams;
+};
+
+} // namespace
+
+namespace imex {
+std::unique_ptr<mlir::Pass> createAssignGPUXStreamsPass() {
+  return std::make_unique<AssignGPUXStreamsPass>();
+}
+} // namespace imex
@@ -13,6 +13,12 @@
 ///     replace bf16 dtype with bitwidth equal i16 type
 ///     rewrite bf16 compute as bf16 extended, f32 compute, f32 truncated
 ///
+/// If a device is given, only what the device lacks is emulated: ops that
+/// merely select bf16 values work on the i16 bits, and bf16 <-> f32
+/// conversions are kept for the hardware unless the device or the SPIR-V
+/// target environment does not support them, in which case they are
+/// emulated with integer ops.
+///
 //===----------------------------------------------------------------------===//
 
 #include "imex/Transforms/Passes.h"
@@ -20,7 +26,11 @@
 #include "mlir/Dialect/Func/IR/FuncOps.h"
 #include "mlir/Dialect/GPU/IR/GPUDialect.h"
 #include "mlir/Dialect/SCF/IR/SCF.h"
+#include "mlir/Dialect/SPIRV/IR/TargetAndABI.h"
+#include "mlir/IR/Threading.h"
 #include "mlir/IR/TypeUtilities.h"
+#include <imex/Utils/Remarks.h>
+#include <imex/Utils/XeArch.h>
 #include <mlir/Dialect/Bufferization/Transforms/BufferViewFlowAnalysis.h>
 #include <mlir/Dialect/MemRef/IR/MemRef.h>
 
@@ -33,315 +43,437 @@ using namespace mlir;
 using namespace imex;
 
 namespace {
+
+// Returns \p type, or the vector \p type, with element type \p elemType.
+static Type cloneWithElementType(Type type, Type elemType) {
+  if (auto vecTy = dyn_cast<VectorType>(type))
+    return vecTy.clone(elemType);
+  return elemType;
+}
+
+// Creates an integer constant of the scalar or vector \p type.
+static Value createIntConstant(OpBuilder &builder, Location loc, Type type,
+                               int64_t value) {
+  auto attr = builder.getIntegerAttr(getElementTypeOrSelf(type), value);
+  if (auto vecTy = dyn_cast<VectorType>(type))
+    return builder.create<arith::ConstantOp>(
+        loc, DenseElementsAttr::get(vecTy, attr));
+  return builder.create<arith::ConstantOp>(loc, attr);
+}
+
+// Replaces the extension of the i16 bits of a bf16 to f32 by shifting the
+// bits into the upper half of the f32.
+static void emulateExtF(OpBuilder &builder, arith::ExtFOp op) {
+  builder.setInsertionPoint(op);
+  auto loc = op.getLoc();
+  auto src = op.getIn();
+  auto i32Ty = cloneWithElementType(src.getType(), builder.getI32Type());
+  auto ext = builder.create<arith::ExtUIOp>(loc, i32Ty, src);
+  auto bits = builder.create<arith::ShLIOp>(
+      loc, ext, createIntConstant(builder, loc, i32Ty, 16));
+  auto res = builder.create<arith::BitcastOp>(loc, op.getType(), bits);
+  op.replaceAllUsesWith(res.getResult());
+  op.erase();
+}
+
+// Replaces the truncation of an f32 to bf16 by rounding the f32 bits to the
+// nearest even upper half. NaNs are replaced by the canonical quiet NaN.
+static void emulateTruncF(OpBuilder &builder, arith::TruncFOp op) {
+  builder.setInsertionPoint(op);
+  auto loc = op.getLoc();
+  auto src = op.getIn();
+  auto i32Ty = cloneWithElementType(src.getType(), builder.getI32Type());
+  auto i16Ty = cloneWithElementType(src.getType(), builder.getI16Type());
+  auto sixteen = createIntConstant(builder, loc, i32Ty, 16);
+  Value bits = builder.create<arith::BitcastOp>(loc, i32Ty, src);
+  Value lsb = builder.create<arith::AndIOp>(
+      loc, builder.create<arith::ShRUIOp>(loc, bits, sixteen),
+      createIntConstant(builder, loc, i32Ty, 1));
+  Value bias = builder.create<arith::AddIOp>(
+      loc, lsb, createIntConstant(builder, loc, i32Ty, 0x7FFF));
+  Value rounded = builder.create<arith::ShRUIOp>(
+      loc, builder.create<arith::AddIOp>(loc, bits, bias), sixteen);
+  Value isNaN =
+      builder.create<arith::CmpFOp>(loc, arith::CmpFPredicate::UNO, src, src);
+  rounded = builder.create<arith::SelectOp>(
+      loc, isNaN, createIntConstant(builder, loc, i32Ty, 0x7FC0), rounded);
+  Value res = builder.create<arith::TruncIOp>(loc, i16Ty, rounded);
+  op.replaceAllUsesWith(res);
+  op.erase();
+}
+
 struct BF16ToGPUPass : public imex::impl::BF16ToGPUBase<BF16ToGPUPass> {
 
 public:
+  using BF16ToGPUBase::BF16ToGPUBase;
+
+  // Returns true if the bf16 <-> f32 conversions of \p op are supported by
+  // the device and the SPIR-V target environment of \p op, if any.
+  bool hasNativeConversion(Operation *op) const {
+    if (!arch->hasNativeBF16Conversion())
+      return false;
+    auto targetAttr = spirv::lookupTargetEnv(op);
+    return !targetAttr ||
+           spirv::TargetEnv(targetAttr)
+               .allows(spirv::Extension::SPV_INTEL_bfloat16_conversion);
+  }
+
   void runOnOperation() override {
     auto mod = getOperation();
-    SymbolTable symbolTable(mod);
-    mlir::OpBuilder builder(mod);
+    bool archAware = !device.empty();
+    if (archAware)
+      arch = ::imex::getXeuArch(device);
+    if (archAware && !arch) {
+      mod.emitError() << "Invalid device: " << device;
+      return signalPassFailure();
+    }
+    imex::MissedOptRemarks missedOpts(getArgument(), remarks);
     // Part 1: gpu::GPUFuncOp
-    (void)mod.walk<WalkOrder::PreOrder>([&](gpu::GPUFuncOp op) -> WalkResult {
-      // 1-1: Create new FunctionType and replace old FunctionType
-      auto oftype = op.getFunctionType();
-      llvm::SmallVector<mlir::Type, 4> argTypes;
-      ArrayRef<Type> resultTypes;
-      for (Type t : oftype.getInputs()) {
-        MemRefType m = mlir::dyn_cast<MemRefType>(t);
-        if (m) {
-          Type et = m.getElementType();
-          if (et.isBF16()) {
-            if (m.hasStaticShape()) {
-              llvm::ArrayRef<int64_t> s = m.getShape();
-              auto i = MemRefType::get(s, builder.getI16Type());
-              argTypes.push_back(i);
+    // Rewriting a kernel updates the callees in its gpu.module; gpu.module
+    // ops are isolated from above, so they are rewritten in parallel.
+    SmallVector<gpu::GPUModuleOp> gpuMods(mod.getOps<gpu::GPUModuleOp>());
+    parallelForEach(&getContext(), gpuMods, [&](gpu::GPUModuleOp gpuMod) {
+      mlir::OpBuilder builder(gpuMod);
+      (void)gpuMod.walk<WalkOrder::PreOrder>([&](gpu::GPUFuncOp op)
+                                                 -> WalkResult {
+        bool emulateConversion = archAware && !hasNativeConversion(op);
+        // 1-1: Create new FunctionType and replace old FunctionType
+        auto oftype = op.getFunctionType();
+        llvm::SmallVector<mlir::Type, 4> argTypes;
+        ArrayRef<Type> resultTypes;
+        for (Type t : oftype.getInputs()) {
+          MemRefType m = mlir::dyn_cast<MemRefType>(t);
+          if (m) {
+            Type et = m.getElementType();
+            if (et.isBF16()) {
+              if (m.hasStaticShape()) {
+                llvm::ArrayRef<int64_t> s = m.getShape();
+                auto i = MemRefType::get(s, builder.getI16Type());
+                argTypes.push_back(i);
+              } else {
+                // TODO: Support dynamic shape
+                op.emitError(
+                    "Non static shape bf16 MemRefType in GPUFuncOp inputs");
+              }
             } else {
-              // TODO: Support dynamic shape
-              op.emitError(
-                  "Non static shape bf16 MemRefType in GPUFuncOp inputs");
+              argTypes.push_back(t);
             }
+          } else if (t.isBF16()) {
+            argTypes.push_back(builder.getI16Type());
           } else {
             argTypes.push_back(t);
           }
-        } else if (t.isBF16()) {
-          argTypes.push_back(builder.getI16Type());
-        } else {
-          argTypes.push_back(t);
         }
-      }
-      auto nftype =
-          dyn_cast<FunctionType>(op.cloneTypeWith(argTypes, resultTypes));
-      op.setFunctionType(nftype);
+        auto nftype =
+            dyn_cast<FunctionType>(op.cloneTypeWith(argTypes, resultTypes));
+        op.setFunctionType(nftype);
 
-      // 1-2: Collect ops that need bf16 widening and widen those ops
-      // Most ops in arith and math dialect that has bf16 operand will
-      // be widened to use f32 operand
-      SmallVector<Operation *, 8> widenOps;
-      (void)op.getRegion().walk<WalkOrder::PreOrder>(
-          [&](Operation *lop) -> WalkResult {
-            auto oname = lop->getName().getStringRef();
-            if (oname.starts_with("arith.") || oname.starts_with("math.") ||
-                oname.starts_with("scf.for") ||
-                oname.starts_with("scf.yield")) {
-              // Skip bitcast operation as we cannot change width of operand
-              if (!(oname.starts_with("arith.bitcast") ||
-                    oname.starts_with("arith.extf"))) {
-                bool needWidening = false;
-                for (const auto &oper : lop->getOperands()) {
-                  if (auto vecTy = mlir::dyn_cast<VectorType>(oper.getType())) {
-                    if (vecTy.getElementType().isBF16()) {
+        // 1-2: Collect ops that need bf16 widening and widen those ops
+        // Most ops in arith and math dialect that has bf16 operand will
+        // be widened to use f32 operand
+        SmallVector<Operation *, 8> widenOps;
+        (void)op.getRegion().walk<WalkOrder::PreOrder>(
+            [&](Operation *lop) -> WalkResult {
+              auto oname = lop->getName().getStringRef();
+              if (oname.starts_with("arith.") || oname.starts_with("math.") ||
+                  oname.starts_with("scf.for") ||
+                  oname.starts_with("scf.yield")) {
+                // Skip bitcast operation as we cannot change width of operand
+                // Selecting values does not need compute and works on the i16
+                // bits, if the device is known.
+                if (!(oname.starts_with("arith.bitcast") ||
+                      oname.starts_with("arith.extf") ||
+                      (archAware && isa<arith::SelectOp>(lop)))) {
+                  bool needWidening = false;
+                  for (const auto &oper : lop->getOperands()) {
+                    if (auto vecTy =
+                            mlir::dyn_cast<VectorType>(oper.getType())) {
+                      if (vecTy.getElementType().isBF16()) {
+                        needWidening = true;
+                      }
+                    } else if (oper.getType().isBF16()) {
                       needWidening = true;
                     }
-                  } else if (oper.getType().isBF16()) {
-                    needWidening = true;
                   }
-                }
-                if (needWidening) {
-                  widenOps.push_back(lop);
+                  if (needWidening) {
+                    widenOps.push_back(lop);
+                  }
                 }
               }
-            }
-            return WalkResult::advance();
-          });
-      for (Operation *o : widenOps) {
-        builder.setInsertionPoint(o);
-        unsigned int idx = 0;
-        for (const auto &oper : o->getOperands()) {
-          if (auto vecTy = mlir::dyn_cast<VectorType>(oper.getType())) {
-            if (vecTy.getElementType().isBF16()) {
-              auto newTy =
-                  VectorType::get(vecTy.getShape(), builder.getF32Type());
-              auto newOp =
-                  builder.create<arith::ExtFOp>(o->getLoc(), newTy, oper);
+              return WalkResult::advance();
+            });
+        for (Operation *o : widenOps) {
+          if (!isa<scf::ForOp, scf::YieldOp>(o))
+            missedOpts.emit(o, "EmulatedBF16", "bf16 compute emulated in f32");
+          builder.setInsertionPoint(o);
+          unsigned int idx = 0;
+          for (const auto &oper : o->getOperands()) {
+            if (auto vecTy = mlir::dyn_cast<VectorType>(oper.getType())) {
+              if (vecTy.getElementType().isBF16()) {
+                auto newTy =
+                    VectorType::get(vecTy.getShape(), builder.getF32Type());
+                auto newOp =
+                    builder.create<arith::ExtFOp>(o->getLoc(), newTy, oper);
+                o->setOperand(idx, newOp);
+              }
+            } else if (oper.getType().isBF16()) {
+              auto newOp = builder.create<arith::ExtFOp>(
+                  o->getLoc(), builder.getF32Type(), oper);
               o->setOperand(idx, newOp);
             }
-          } else if (oper.getType().isBF16()) {
-            auto newOp = builder.create<arith::ExtFOp>(
-                o->getLoc(), builder.getF32Type(), oper);
-            o->setOperand(idx, newOp);
+            idx++;
           }
-          idx++;
-        }
 
-        // handle conversion of bf16 loop iter args
-        if (auto forOp = dyn_cast<mlir::scf::ForOp>(o)) {
-          for (auto arg : forOp.getRegionIterArgs()) {
-            Type argt = arg.getType();
+          // handle conversion of bf16 loop iter args
+          if (auto forOp = dyn_cast<mlir::scf::ForOp>(o)) {
+            for (auto arg : forOp.getRegionIterArgs()) {
+              Type argt = arg.getType();
 
-            // Change bf16 iter arg types to f32 type
-            if (argt.isBF16()) {
-              arg.setType(builder.getF32Type());
-            } else if (llvm::isa<Float8E5M2Type>(argt) ||
-                       llvm::isa<Float8E4M3FNType>(argt)) {
-              // TODO: Handle loop fp8 type iter args
-              llvm_unreachable(
-                  "Unhandled case when loop iter arg is of f8 type");
+              // Change bf16 iter arg types to f32 type
+              if (argt.isBF16()) {
+                arg.setType(builder.getF32Type());
+              } else if (llvm::isa<Float8E5M2Type>(argt) ||
+                         llvm::isa<Float8E4M3FNType>(argt)) {
+                // TODO: Handle loop fp8 type iter args
+                llvm_unreachable(
+                    "Unhandled case when loop iter arg is of f8 type");
+              }
             }
           }
-        }
 
-        for (mlir::OpResult res : o->getResults()) {
-          if (auto vecTy = mlir::dyn_cast<VectorType>(res.getType())) {
-            if (vecTy.getElementType().isBF16()) {
-              auto resTy =
-                  VectorType::get(vecTy.getShape(), builder.getF32Type());
-              res.setType(resTy);
+          for (mlir::OpResult res : o->getResults()) {
+            if (auto vecTy = mlir::dyn_cast<VectorType>(res.getType())) {
+              if (vecTy.getElementType().isBF16()) {
+                auto resTy =
+                    VectorType::get(vecTy.getShape(), builder.getF32Type());
+                res.setType(resTy);
+                builder.setInsertionPointAfter(o);
+                auto newTy =
+                    VectorType::get(vecTy.getShape(), builder.getBF16Type());
+                auto newRes =
+                    builder.create<arith::TruncFOp>(o->getLoc(), newTy, res);
+                res.replaceAllUsesExcept(newRes, newRes);
+              }
+            } else if (res.getType().isBF16()) {
+              res.setType(builder.getF32Type());
               builder.setInsertionPointAfter(o);
-              auto newTy =
-                  VectorType::get(vecTy.getShape(), builder.getBF16Type());
-              auto newRes =
-                  builder.create<arith::TruncFOp>(o->getLoc(), newTy, res);
+              auto newRes = builder.create<arith::TruncFOp>(
+                  o->getLoc(), builder.getBF16Type(), res);
               res.replaceAllUsesExcept(newRes, newRes);
             }
-          } else if (res.getType().isBF16()) {
-            res.setType(builder.getF32Type());
-            builder.setInsertionPointAfter(o);
-            auto newRes = builder.create<arith::TruncFOp>(
-                o->getLoc(), builder.getBF16Type(), res);
-            res.replaceAllUsesExcept(newRes, newRes);
           }
         }
-      }
-      //  1-3: Change element type of entry block arguments
-      //  This step replaces all external sources of bf16 with i16
-      //  and the effect is propagated to the entire gpu.func
-      Block &eblock = op.getBlocks().front();
-      for (mlir::BlockArgument arg : eblock.getArguments()) {
-        Type argt = arg.getType();
-        MemRefType mt = dyn_cast<MemRefType>(argt);
-        if (mt) {
-          if (mt.getElementType().isBF16()) {
-            MemRefType newMt = dyn_cast<MemRefType>(
-                mt.cloneWith(mt.getShape(), builder.getI16Type()));
-            arg.setType(newMt);
+        //  1-3: Change element type of entry block arguments
+        //  This step replaces all external sources of bf16 with i16
+        //  and the effect is propagated to the entire gpu.func
+        Block &eblock = op.getBlocks().front();
+        for (mlir::BlockArgument arg : eblock.getArguments()) {
+          Type argt = arg.getType();
+          MemRefType mt = dyn_cast<MemRefType>(argt);
+          if (mt) {
+            if (mt.getElementType().isBF16()) {
+              MemRefType newMt = dyn_cast<MemRefType>(
+                  mt.cloneWith(mt.getShape(), builder.getI16Type()));
+              arg.setType(newMt);
+            }
+          } else if (argt.isBF16()) {
+            arg.setType(builder.getI16Type());
           }
-        } else if (argt.isBF16()) {
-          arg.setType(builder.getI16Type());
         }
-      }
-      // arith.constant is another source of bf16 values.
-      // replace them with same bit i16 values.
-      SmallVector<Operation *, 8> replacedConstantOps;
-      (void)op.getRegion().walk<WalkOrder::PreOrder>(
-          [&](Operation *lop) -> WalkResult {
-            if (auto constOp = dyn_cast<arith::ConstantOp>(lop)) {
-              if (auto vecTy = mlir::dyn_cast<VectorType>(constOp.getType())) {
-                if (vecTy.getElementType().isBF16()) {
-                  if (auto fval =
-                          dyn_cast<DenseElementsAttr>(constOp.getValue())) {
-                    auto ival = fval.bitcast(builder.getI16Type());
+        // arith.constant is another source of bf16 values.
+        // replace them with same bit i16 values.
+        SmallVector<Operation *, 8> replacedConstantOps;
+        (void)op.getRegion().walk<WalkOrder::PreOrder>(
+            [&](Operation *lop) -> WalkResult {
+              if (auto constOp = dyn_cast<arith::ConstantOp>(lop)) {
+                if (auto vecTy =
+                        mlir::dyn_cast<VectorType>(constOp.getType())) {
+                  if (vecTy.getElementType().isBF16()) {
+                    if (auto fval =
+                            dyn_cast<DenseElementsAttr>(constOp.getValue())) {
+                      auto ival = fval.bitcast(builder.getI16Type());
+                      builder.setInsertionPoint(lop);
+                      auto newTy =
+                          VectorType::get(vecTy.getShape(),
+                                          builder.getI16Type());
+                      auto newConst = builder.create<arith::ConstantOp>(
+                          lop->getLoc(), newTy, ival);
+                      lop->replaceAllUsesWith(newConst);
+                      replacedConstantOps.push_back(lop);
+                    } else {
+                      lop->emitError(
+                          "Expected DenseElementsAttr for vector bf16 "
+                          "constant.");
+                    }
+                  }
+                } else if (constOp.getType().isBF16()) {
+                  if (auto fval = dyn_cast<FloatAttr>(constOp.getValue())) {
+                    auto bf16val = fval.getValue();
+                    auto ival = bf16val.bitcastToAPInt();
+                    int64_t i64val = ival.getSExtValue();
+                    int16_t i16val = static_cast<int16_t>(i64val);
                     builder.setInsertionPoint(lop);
-                    auto newTy =
-                        VectorType::get(vecTy.getShape(), builder.getI16Type());
                     auto newConst = builder.create<arith::ConstantOp>(
-                        lop->getLoc(), newTy, ival);
+                        lop->getLoc(), builder.getI16Type(),
+                        builder.getI16IntegerAttr(i16val));
                     lop->replaceAllUsesWith(newConst);
                     replacedConstantOps.push_back(lop);
-                  } else {
-                    lop->emitError(
-                        "Expected DenseElementsAttr for vector bf16 constant.");
                   }
                 }
-              } else if (constOp.getType().isBF16()) {
-                if (auto fval = dyn_cast<FloatAttr>(constOp.getValue())) {
-                  auto bf16val = fval.getValue();
-                  auto ival = bf16val.bitcastToAPInt();
-                  int64_t i64val = ival.getSExtValue();
-                  int16_t i16val = static_cast<int16_t>(i64val);
-                  builder.setInsertionPoint(lop);
-                  auto newConst = builder.create<arith::ConstantOp>(
-                      lop->getLoc(), builder.getI16Type(),
-                      builder.getI16IntegerAttr(i16val));
-                  lop->replaceAllUsesWith(newConst);
-                  replacedConstantOps.push_back(lop);
-                }
               }
-            }
-            return WalkResult::advance();
-          });
-      for (auto cop : replacedConstantOps) {
-        cop->erase();
-      }
-      // Now that all primary bf16 are replaced with i16,
-      // some ops are invalid and need to be updated.
-      // 1) extf and truncf now needs an additional bitcast operation
-      // 2) function calls need callee function signature update.
-      // 3) propagate i16 type by changing bf16 result types of ops
-      //    to i16. skip arith.constant as it is a value source.
-      (void)op.getRegion().walk<WalkOrder::PreOrder>([&](Operation *lop)
-                                                         -> WalkResult {
-        if (dyn_cast<arith::ExtFOp>(lop)) {
-          auto src = lop->getOperand(0);
-          auto res = lop->getResult(0);
-          // if extf i16 -> f32 : "i16" is not a typo
-          auto srcTy = dyn_cast<VectorType>(src.getType());
-          auto resTy = dyn_cast<VectorType>(res.getType());
-          if (srcTy && resTy) {
-            if (srcTy.getElementType().isInteger(16) &&
-                resTy.getElementType().isF32()) {
+              return WalkResult::advance();
+            });
+        for (auto cop : replacedConstantOps) {
+          cop->erase();
+        }
+        // Now that all primary bf16 are replaced with i16,
+        // some ops are invalid and need to be updated.
+        // 1) extf and truncf now needs an additional bitcast operation
+        // 2) function calls need callee function signature update.
+        // 3) propagate i16 type by changing bf16 result types of ops
+        //    to i16. skip arith.constant as it is a value source.
+        // Conversions the device does not support are emulated afterwards.
+        SmallVector<arith::ExtFOp, 8> emulatedExtFOps;
+        SmallVector<arith::TruncFOp, 8> emulatedTruncFOps;
+        (void)op.getRegion().walk<WalkOrder::PreOrder>([&](Operation *lop)
+                                                           -> WalkResult {
+          if (dyn_cast<arith::ExtFOp>(lop)) {
+            auto src = lop->getOperand(0);
+            auto res = lop->getResult(0);
+            // if extf i16 -> f32 : "i16" is not a typo
+            auto srcTy = dyn_cast<VectorType>(src.getType());
+            auto resTy = dyn_cast<VectorType>(res.getType());
+            // The source is bf16 if it is a truncf, which is emulated first.
+            auto srcElemTy = getElementTypeOrSelf(src.getType());
+            if (emulateConversion &&
+                (srcElemTy.isInteger(16) || srcElemTy.isBF16()) &&
+                getElementTypeOrSelf(res.getType()).isF32()) {
+              emulatedExtFOps.push_back(cast<arith::ExtFOp>(lop));
+            } else if (srcTy && resTy) {
+              if (srcTy.getElementType().isInteger(16) &&
+                  resTy.getElementType().isF32()) {
+                builder.setInsertionPoint(lop);
+                auto newTy =
+                    VectorType::get(srcTy.getShape(), builder.getBF16Type());
+                auto bcast =
+                    builder.create<arith::BitcastOp>(lop->getLoc(), newTy, src);
+                lop->setOperand(0, bcast);
+              }
+            } else if (src.getType().isInteger(16) && res.getType().isF32()) {
               builder.setInsertionPoint(lop);
-              auto newTy =
-                  VectorType::get(srcTy.getShape(), builder.getBF16Type());
-              auto bcast =
-                  builder.create<arith::BitcastOp>(lop->getLoc(), newTy, src);
+              auto bcast = builder.create<arith::BitcastOp>(
+                  lop->getLoc(), builder.getBF16Type(), src);
               lop->setOperand(0, bcast);
             }
-          } else if (src.getType().isInteger(16) && res.getType().isF32()) {
-            builder.setInsertionPoint(lop);
-            auto bcast = builder.create<arith::BitcastOp>(
-                lop->getLoc(), builder.getBF16Type(), src);
-            lop->setOperand(0, bcast);
-          }
-        } else if (dyn_cast<arith::TruncFOp>(lop)) {
-          auto src = lop->getOperand(0);
-          auto res = lop->getResult(0);
-          // if truncf f32 -> bf16
-          auto srcTy = dyn_cast<VectorType>(src.getType());
-          auto resTy = dyn_cast<VectorType>(res.getType());
-          if (srcTy && resTy) {
-            if (srcTy.getElementType().isF32() &&
-                resTy.getElementType().isBF16()) {
+          } else if (dyn_cast<arith::TruncFOp>(lop)) {
+            auto src = lop->getOperand(0);
+            auto res = lop->getResult(0);
+            // if truncf f32 -> bf16
+            auto srcTy = dyn_cast<VectorType>(src.getType());
+            auto resTy = dyn_cast<VectorType>(res.getType());
+            if (emulateConversion &&
+                getElementTypeOrSelf(src.getType()).isF32() &&
+                getElementTypeOrSelf(res.getType()).isBF16()) {
+              emulatedTruncFOps.push_back(cast<arith::TruncFOp>(lop));
+            } else if (srcTy && resTy) {
+              if (srcTy.getElementType().isF32() &&
+                  resTy.getElementType().isBF16()) {
+                builder.setInsertionPointAfter(lop);
+                auto newTy =
+                    VectorType::get(resTy.getShape(), builder.getI16Type());
+                auto bcast =
+                    builder.create<arith::BitcastOp>(lop->getLoc(), newTy, res);
+                res.replaceAllUsesExcept(bcast, bcast);
+              }
+            } else if (src.getType().isF32() && res.getType().isBF16()) {
               builder.setInsertionPointAfter(lop);
-              auto newTy =
-                  VectorType::get(resTy.getShape(), builder.getI16Type());
-              auto bcast =
-                  builder.create<arith::BitcastOp>(lop->getLoc(), newTy, res);
+              auto bcast = builder.create<arith::BitcastOp>(
+                  lop->getLoc(), builder.getI16Type(), res);
               res.replaceAllUsesExcept(bcast, bcast);
             }
-          } else if (src.getType().isF32() && res.getType().isBF16()) {
-            builder.setInsertionPointAfter(lop);
-            auto bcast = builder.create<arith::BitcastOp>(
-                lop->getLoc(), builder.getI16Type(), res);
-            res.replaceAllUsesExcept(bcast, bcast);
-          }
-        } else {
-          if (auto callOp = dyn_cast<func::CallOp>(lop)) {
-            auto name = callOp.getCallee();
-            auto module = lop->getParentOfType<gpu::GPUModuleOp>();
-            if (!module)
-              op.emitError("Parent gpu module not found!");
-            auto result = SymbolRefAttr::get(module.getContext(), name);
-            auto func = module.lookupSymbol<func::FuncOp>(result.getAttr());
-            if (!func)
-              op.emitError("Callee not found!");
-            auto ftype = func.getFunctionType();
-            bool needFuncUpdate = false;
+          } else {
+            if (auto callOp = dyn_cast<func::CallOp>(lop)) {
+              auto name = callOp.getCallee();
+              auto module = lop->getParentOfType<gpu::GPUModuleOp>();
+              if (!module)
+                op.emitError("Parent gpu module not found!");
+              auto result = SymbolRefAttr::get(module.getContext(), name);
+              auto func = module.lookupSymbol<func::FuncOp>(result.getAttr());
+              if (!func)
+                op.emitError("Callee not found!");
+              auto ftype = func.getFunctionType();
+              bool needFuncUpdate = false;
 
-            auto convertBF16ToI16 = [&](TypeRange types) {
-              SmallVector<Type, 8> newTypes;
-              for (Type t : types) {
-                if (auto vecTy = dyn_cast<VectorType>(t)) {
-                  if (vecTy.getElementType().isBF16()) {
-                    auto newTy =
-                        vecTy.cloneWith(vecTy.getShape(), builder.getI16Type());
-                    newTypes.push_back(newTy);
+              auto convertBF16ToI16 = [&](TypeRange types) {
+                SmallVector<Type, 8> newTypes;
+                for (Type t : types) {
+                  if (auto vecTy = dyn_cast<VectorType>(t)) {
+                    if (vecTy.getElementType().isBF16()) {
+                      auto newTy =
+                          vecTy.cloneWith(vecTy.getShape(),
+                                          builder.getI16Type());
+                      newTypes.push_back(newTy);
+                      needFuncUpdate = true;
+                    } else {
+                      newTypes.push_back(t);
+                    }
+                  } else if (t.isBF16()) {
+                    newTypes.push_back(builder.getI16Type());
                     needFuncUpdate = true;
                   } else {
+                    // TODO: Can callee arg type be bf16 memref?
                     newTypes.push_back(t);
                   }
-                } else if (t.isBF16()) {
-                  newTypes.push_back(builder.getI16Type());
-                  needFuncUpdate = true;
-                } else {
-                  // TODO: Can callee arg type be bf16 memref?
-                  newTypes.push_back(t);
                 }
-              }
-              return newTypes;
-            };
+                return newTypes;
+              };
 
-            auto newArgTypes = convertBF16ToI16(ftype.getInputs());
-            auto newRetTypes = convertBF16ToI16(ftype.getResults());
+              auto newArgTypes = convertBF16ToI16(ftype.getInputs());
+              auto newRetTypes = convertBF16ToI16(ftype.getResults());
 
-            if (needFuncUpdate) {
-              auto nftype = dyn_cast<FunctionType>(
-                  func.cloneTypeWith(newArgTypes, newRetTypes));
-              func.setFunctionType(nftype);
+              if (needFuncUpdate) {
+                auto nftype = dyn_cast<FunctionType>(
+                    func.cloneTypeWith(newArgTypes, newRetTypes));
+                func.setFunctionType(nftype);
+              }
             }
-          }
-          if (lop->getNumResults() > 0 && !dyn_cast<arith::ConstantOp>(lop)) {
-            // Foreach result
-            //   if elemType is bf16, change it to i16
-            int i = 0;
-            for (Type t : lop->getResultTypes()) {
-              if (mlir::isa<mlir::VectorType>(t)) {
-                VectorType vt = mlir::cast<mlir::VectorType>(t);
-                if (vt.getElementType().isBF16()) {
-                  vt.get(vt.getShape(), builder.getI16Type());
-                  lop->getResult(i).setType(
-                      vt.get(vt.getShape(), builder.getI16Type()));
+            if (lop->getNumResults() > 0 && !dyn_cast<arith::ConstantOp>(lop)) {
+              // Foreach result
+              //   if elemType is bf16, change it to i16
+              int i = 0;
+              for (Type t : lop->getResultTypes()) {
+                if (mlir::isa<mlir::VectorType>(t)) {
+                  VectorType vt = mlir::cast<mlir::VectorType>(t);
+                  if (vt.getElementType().isBF16()) {
+                    vt.get(vt.getShape(), builder.getI16Type());
+                    lop->getResult(i).setType(
+                        vt.get(vt.getShape(), builder.getI16Type()));
+                  }
+                } else if (t.isBF16()) {
+                  lop->getResult(i).setType(builder.getI16Type());
                 }
-              } else if (t.isBF16()) {
-                lop->getResult(i).setType(builder.getI16Type());
+                i++;
               }
-              i++;
             }
           }
+          return WalkResult::advance();
+        });
+        for (auto truncfOp : emulatedTruncFOps) {
+          missedOpts.emit(truncfOp, "EmulatedBF16Conversion",
+                          "no native bf16 conversion, emulated with integer "
+                          "ops");
+          emulateTruncF(builder, truncfOp);
+        }
+        for (auto extfOp : emulatedExtFOps) {
+          missedOpts.emit(extfOp, "EmulatedBF16Conversion",
+                          "no native bf16 conversion, emulated with integer "
+                          "ops");
+          emulateExtF(builder, extfOp);
         }
         return WalkResult::advance();
       });
-      return WalkResult::advance();
     });
+    mlir::OpBuilder builder(mod);
     // Part 2: gpu::LaunchFuncOp and gpu::AllocOp
     SmallVector<Operation *, 8> replacedAllocOps;
     (void)mod.walk<WalkOrder::PreOrder>([&](gpu::LaunchFuncOp op)
@@ -587,6 +719,9 @@ public:
       alloc->erase();
     }
   }
+
+private:
+  std::shared_ptr<::imex::XeuArchInterface> arch;
 };
 } // namespace
 
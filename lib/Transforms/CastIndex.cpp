@@ -11,13 +11,22 @@
 /// This pass iterates gpu.func and replaces compute intensive arith ops using
 /// index dtype with i32 type. Index type is casted to and from i32 type.
 ///
+/// With range analysis, index arith ops are narrowed only if their operands
+/// and results provably fit in i32, and chains of narrowed ops use the i32
+/// values directly; casts are only inserted at the boundaries of the chains.
+///
 //===----------------------------------------------------------------------===//
 
 #include "imex/Transforms/Passes.h"
+#include "mlir/Analysis/DataFlow/DeadCodeAnalysis.h"
+#include "mlir/Analysis/DataFlow/IntegerRangeAnalysis.h"
+#include "mlir/Analysis/DataFlowFramework.h"
+#include "mlir/Dialect/Arith/IR/Arith.h"
 #include "mlir/Dialect/GPU/IR/GPUDialect.h"
 #include "mlir/Dialect/Index/IR/IndexDialect.h"
 #include "mlir/Dialect/Index/IR/IndexOps.h"
 #include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/Threading.h"
 #include "mlir/IR/TypeUtilities.h"
 
 namespace imex {
@@ -29,66 +38,176 @@ using namespace mlir;
 using namespace imex;
 
 namespace {
-struct CastIndexPass : public imex::impl::CastIndexBase<CastIndexPass> {
 
-public:
-  void runOnOperation() override {
-    auto mod = getOperation();
-    SymbolTable symbolTable(mod);
-    mlir::OpBuilder builder(mod);
-    // Visit gpu::GPUFuncOp
-    (void)mod.walk<WalkOrder::PreOrder>([&](gpu::GPUFuncOp op) -> WalkResult {
-      // Collect ops that need casting index to/from i32
-      SmallVector<Operation *, 8> opsToCast;
-      (void)op.getRegion().walk<WalkOrder::PreOrder>(
-          [&](Operation *lop) -> WalkResult {
-            auto oname = lop->getName().getStringRef();
-            if (oname.starts_with("arith.")) {
-              // Target ops to cast are hardcoded for now.
-              // Current focus is on slow compute intensive ops.
-              if (oname.starts_with("arith.div") ||
-                  oname.starts_with("arith.rem") ||
-                  oname.starts_with("arith.mul")) {
-                bool needCasting = false;
-                // Op must have an index type operand.
-                for (const auto &oper : lop->getOperands()) {
-                  if (oper.getType().isIndex()) {
-                    needCasting = true;
-                  }
-                }
-                if (needCasting) {
-                  opsToCast.push_back(lop);
-                }
+// Returns true if \p op is an index arith op that computes the same result in
+// i32 as long as its operands and result fit in i32.
+static bool isNarrowable(Operation *op) {
+  if (!isa<arith::AddIOp, arith::SubIOp, arith::MulIOp, arith::DivUIOp,
+           arith::DivSIOp, arith::RemUIOp, arith::RemSIOp, arith::CeilDivSIOp,
+           arith::FloorDivSIOp, arith::MaxSIOp, arith::MinSIOp, arith::MaxUIOp,
+           arith::MinUIOp, arith::AndIOp, arith::OrIOp, arith::XOrIOp,
+           arith::ShRUIOp, arith::ShRSIOp>(op))
+    return false;
+  return llvm::all_of(op->getOperandTypes(),
+                      [](Type type) { return type.isIndex(); }) &&
+         op->getResult(0).getType().isIndex();
+}
+
+// Returns true if the range of \p value is known to be within the
+// non-negative i32 range. Non-negative values have the same signed and
+// unsigned interpretation, such that signed and unsigned ops can be narrowed.
+static bool fitsInI32(DataFlowSolver &solver, Value value) {
+  auto *lattice = solver.lookupState<dataflow::IntegerValueRangeLattice>(value);
+  if (!lattice || lattice->getValue().isUninitialized())
+    return false;
+  const auto &range = lattice->getValue().getValue();
+  return range.smin().isNonNegative() &&
+         range.smax().sle(std::numeric_limits<int32_t>::max());
+}
+
+// Narrows the index arith ops of \p func that provably fit in i32.
+static void narrowIndexOps(gpu::GPUFuncOp func, DataFlowSolver &solver,
+                           OpBuilder &builder) {
+  llvm::SmallVector<Operation *> narrowOps;
+  llvm::SmallPtrSet<Operation *, 16> narrowSet;
+  func.walk<WalkOrder::PreOrder>([&](Operation *op) {
+    if (isNarrowable(op) && fitsInI32(solver, op->getResult(0)) &&
+        llvm::all_of(op->getOperands(),
+                     [&](Value oper) { return fitsInI32(solver, oper); })) {
+      narrowOps.push_back(op);
+      narrowSet.insert(op);
+    }
+  });
+
+  // The i32 values of index values used by narrowed ops, cast next to their
+  // definition.
+  DenseMap<Value, Value> narrowed;
+  auto getNarrowed = [&](Value value) -> Value {
+    if (auto it = narrowed.find(value); it != narrowed.end())
+      return it->second;
+    Value result;
+    if (auto cst = value.getDefiningOp<arith::ConstantIndexOp>()) {
+      builder.setInsertionPoint(cst);
+      result = builder.create<arith::ConstantIntOp>(cst.getLoc(), cst.value(),
+                                                    builder.getI32Type());
+    } else {
+      builder.setInsertionPointAfterValue(value);
+      result = builder.create<index::CastSOp>(value.getLoc(),
+                                              builder.getI32Type(), value);
+    }
+    narrowed[value] = result;
+    return result;
+  };
+
+  for (auto *op : narrowOps) {
+    for (auto &oper : op->getOpOperands()) {
+      auto *def = oper.get().getDefiningOp();
+      if (!def || !narrowSet.contains(def))
+        oper.set(getNarrowed(oper.get()));
+    }
+    op->getResult(0).setType(builder.getI32Type());
+  }
+
+  // Cast the results back to index for the users outside of the chains.
+  for (auto *op : narrowOps) {
+    auto res = op->getResult(0);
+    if (llvm::all_of(res.getUsers(),
+                     [&](Operation *user) { return narrowSet.contains(user); }))
+      continue;
+    builder.setInsertionPointAfter(op);
+    auto newRes = builder.create<index::CastSOp>(op->getLoc(),
+                                                 builder.getIndexType(), res);
+    res.replaceUsesWithIf(newRes, [&](OpOperand &use) {
+      return use.getOwner() != newRes && !narrowSet.contains(use.getOwner());
+    });
+  }
+}
+
+// Casts the index operands and results of the compute intensive arith ops of
+// \p op to and from i32.
+static void castIndexOps(gpu::GPUFuncOp op) {
+  mlir::OpBuilder builder(op);
+  // Collect ops that need casting index to/from i32
+  SmallVector<Operation *, 8> opsToCast;
+  (void)op.getRegion().walk<WalkOrder::PreOrder>(
+      [&](Operation *lop) -> WalkResult {
+        auto oname = lop->getName().getStringRef();
+        if (oname.starts_with("arith.")) {
+          // Target ops to cast are hardcoded for now.
+          // Current focus is on slow compute intensive ops.
+          if (oname.starts_with("arith.div") ||
+              oname.starts_with("arith.rem") ||
+              oname.starts_with("arith.mul")) {
+            bool needCasting = false;
+            // Op must have an index type operand.
+            for (const auto &oper : lop->getOperands()) {
+              if (oper.getType().isIndex()) {
+                needCasting = true;
               }
             }
-            return WalkResult::advance();
-          });
-      for (Operation *o : opsToCast) {
-        builder.setInsertionPoint(o);
-        for (auto [idx, oper] : llvm::enumerate(o->getOperands())) {
-          // Replace index type operands with cast op from
-          // index to i32 type.
-          if (oper.getType().isIndex()) {
-            auto newOp = builder.create<index::CastSOp>(
-                o->getLoc(), builder.getI32Type(), oper);
-            o->setOperand(idx, newOp);
-          }
-        }
-        for (mlir::OpResult res : o->getResults()) {
-          if (res.getType().isIndex()) {
-            // Replace index result type with i32 type
-            res.setType(builder.getI32Type());
-            builder.setInsertionPointAfter(o);
-            // Cast i32 type back to index type
-            auto newRes = builder.create<index::CastSOp>(
-                o->getLoc(), builder.getIndexType(), res);
-            // Replace all uase of result with new cast op
-            res.replaceAllUsesExcept(newRes, newRes);
+            if (needCasting) {
+              opsToCast.push_back(lop);
+            }
           }
         }
+        return WalkResult::advance();
+      });
+  for (Operation *o : opsToCast) {
+    builder.setInsertionPoint(o);
+    for (auto [idx, oper] : llvm::enumerate(o->getOperands())) {
+      // Replace index type operands with cast op from
+      // index to i32 type.
+      if (oper.getType().isIndex()) {
+        auto newOp = builder.create<index::CastSOp>(
+            o->getLoc(), builder.getI32Type(), oper);
+        o->setOperand(idx, newOp);
       }
-      return WalkResult::advance();
-    });
+    }
+    for (mlir::OpResult res : o->getResults()) {
+      if (res.getType().isIndex()) {
+        // Replace index result type with i32 type
+        res.setType(builder.getI32Type());
+        builder.setInsertionPointAfter(o);
+        // Cast i32 type back to index type
+        auto newRes = builder.create<index::CastSOp>(
+            o->getLoc(), builder.getIndexType(), res);
+        // Replace all uase of result with new cast op
+        res.replaceAllUsesExcept(newRes, newRes);
+      }
+    }
+  }
+}
+
+struct CastIndexPass : public imex::impl::CastIndexBase<CastIndexPass> {
+
+public:
+  void runOnOperation() override {
+    auto mod = getOperation();
+    // gpu.module and gpu.func ops are isolated from above, so they are
+    // rewritten in parallel.
+    if (useRangeAnalysis) {
+      // The analysis follows calls within a gpu.module.
+      llvm::SmallVector<gpu::GPUModuleOp> gpuMods(
+          mod.getOps<gpu::GPUModuleOp>());
+      if (failed(failableParallelForEach(
+              &getContext(), gpuMods, [](gpu::GPUModuleOp gpuMod) {
+                DataFlowSolver solver;
+                solver.load<dataflow::DeadCodeAnalysis>();
+                solver.load<dataflow::IntegerRangeAnalysis>();
+                if (failed(solver.initializeAndRun(gpuMod)))
+                  return failure();
+                mlir::OpBuilder builder(gpuMod);
+                gpuMod.walk([&](gpu::GPUFuncOp op) {
+                  narrowIndexOps(op, solver, builder);
+                });
+                return success();
+              })))
+        signalPassFailure();
+      return;
+    }
+    llvm::SmallVector<gpu::GPUFuncOp> funcs;
+    mod.walk([&](gpu::GPUFuncOp op) { funcs.push_back(op); });
+    parallelForEach(&getContext(), funcs, castIndexOps);
   }
 };
 } // namespace
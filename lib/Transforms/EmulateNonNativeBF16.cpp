@@ -15,9 +15,13 @@
 /// Emulate bf16 ops by extending them to f32 and truncate the result back to
 /// bf16 whose SPIR-V counterpart is not natively supported
 ///
+/// Optionally, chains of elementwise ops are computed in f32 as a whole, such
+/// that values are truncated only where they leave the chain.
+///
 //===----------------------------------------------------------------------===//
 
 #include "imex/Transforms/Passes.h"
+#include "imex/Utils/Remarks.h"
 #include "mlir/Dialect/Arith/IR/Arith.h"
 #include "mlir/Dialect/GPU/IR/GPUDialect.h"
 #include "mlir/IR/TypeUtilities.h"
@@ -35,6 +39,83 @@ using namespace mlir;
 using namespace imex;
 
 namespace {
+
+// Returns the f32 counterpart of a bf16 scalar or vector type.
+static Type getF32Type(Type type) {
+  auto f32Ty = Float32Type::get(type.getContext());
+  if (auto vecTy = mlir::dyn_cast<VectorType>(type))
+    return VectorType::get(vecTy.getShape(), f32Ty);
+  return f32Ty;
+}
+
+static bool isBF16Like(Type type) {
+  return getElementTypeOrSelf(type).isBF16();
+}
+
+// Returns the f32 value \p value is truncated from, or null.
+static Value getTruncatedValue(Value value) {
+  if (auto truncOp = value.getDefiningOp<arith::TruncFOp>()) {
+    auto in = truncOp.getIn();
+    if (in.getType() == getF32Type(value.getType()))
+      return in;
+  }
+  return nullptr;
+}
+
+// Computes natively supported elementwise ops in f32 if all of their bf16
+// operands are truncated from f32 values or are constants, and removes the
+// truncf/extf pairs between the widened ops.
+static void computeRegionsInF32(gpu::GPUFuncOp func, OpBuilder &builder) {
+  // Ops that compute, as opposed to bf16 conversions, and can be computed in
+  // f32 instead.
+  static const std::unordered_set<std::string> computeOps{
+      "arith.addf",    "arith.mulf",    "arith.subf", "arith.divf",
+      "arith.maximumf", "arith.minnumf", "arith.maxnumf", "math.absf",
+      "math.fma",      "math.tanh"};
+  func.walk([&](Operation *op) {
+    if (!computeOps.count(op->getName().getStringRef().str()) ||
+        op->getNumResults() != 1 || !isBF16Like(op->getResult(0).getType()))
+      return;
+    auto isProducedInF32 = [](Value oper) {
+      return !isBF16Like(oper.getType()) || getTruncatedValue(oper) ||
+             oper.getDefiningOp<arith::ConstantOp>();
+    };
+    auto fromF32 = [](Value oper) { return getTruncatedValue(oper); };
+    if (!llvm::all_of(op->getOperands(), isProducedInF32) ||
+        !llvm::any_of(op->getOperands(), fromF32))
+      return;
+    builder.setInsertionPoint(op);
+    for (auto &oper : op->getOpOperands()) {
+      if (!isBF16Like(oper.get().getType()))
+        continue;
+      auto widened = getTruncatedValue(oper.get());
+      if (!widened)
+        widened = builder.create<arith::ExtFOp>(
+            op->getLoc(), getF32Type(oper.get().getType()), oper.get());
+      oper.set(widened);
+    }
+    auto res = op->getResult(0);
+    auto bf16Ty = res.getType();
+    res.setType(getF32Type(bf16Ty));
+    builder.setInsertionPointAfter(op);
+    auto newRes = builder.create<arith::TruncFOp>(op->getLoc(), bf16Ty, res);
+    res.replaceAllUsesExcept(newRes, newRes);
+  });
+
+  // Fold extf(truncf(x)) into x and drop the truncations left unused.
+  func.walk([&](arith::ExtFOp extOp) {
+    auto in = getTruncatedValue(extOp.getIn());
+    if (in && in.getType() == extOp.getType()) {
+      extOp.replaceAllUsesWith(in);
+      extOp.erase();
+    }
+  });
+  func.walk([&](arith::TruncFOp truncOp) {
+    if (truncOp->use_empty() && isBF16Like(truncOp.getType()))
+      truncOp.erase();
+  });
+}
+
 struct EmulateNonNativeBF16Pass
     : public imex::impl::EmulateNonNativeBF16Base<EmulateNonNativeBF16Pass> {
 
@@ -43,6 +124,7 @@ public:
     auto mod = getOperation();
     SymbolTable symbolTable(mod);
     mlir::OpBuilder builder(mod);
+    imex::MissedOptRemarks missedOpts(getArgument(), remarks);
     // gpu::GPUFuncOp
     (void)mod.walk<WalkOrder::PreOrder>([&](gpu::GPUFuncOp op) -> WalkResult {
       // 1: Collect ops that need bf16 widening and widen those ops
@@ -97,6 +179,7 @@ public:
             return WalkResult::advance();
           });
       for (Operation *o : widenOps) {
+        missedOpts.emit(o, "EmulatedBF16", "bf16 compute emulated in f32");
         builder.setInsertionPoint(o);
         unsigned int idx = 0;
         for (const auto &oper : o->getOperands()) {
@@ -138,6 +221,8 @@ public:
         }
       }
 
+      if (emulateRegions)
+        computeRegionsInF32(op, builder);
       return WalkResult::advance();
     });
   }
@@ -0,0 +1,175 @@
+//===- EstimateKernelCost.cpp - EstimateKernelCost Pass ---------*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file attaches static estimates of the bytes moved and the floating
+/// point operations executed by one work item to each gpu kernel. Memory
+/// accesses (memref, vector and XeGPU loads and stores), xegpu.dpas and
+/// floating point arith and math ops are counted, and the bodies of scf.for
+/// loops with constant bounds are multiplied by their trip count. The
+/// runtime profiler multiplies the estimates with the launch size and
+/// combines them with the measured time to report the achieved bandwidth,
+/// FLOP rate and roofline efficiency of each kernel.
+///
+//===----------------------------------------------------------------------===//
+
+#include <imex/Transforms/Passes.h>
+#include <imex/Utils/GPUSerialize.h>
+
+#include <mlir/Dialect/Arith/IR/Arith.h>
+#include <mlir/Dialect/GPU/IR/GPUDialect.h>
+#include <mlir/Dialect/Math/IR/Math.h>
+#include <mlir/Dialect/MemRef/IR/MemRef.h>
+#include <mlir/Dialect/SCF/IR/SCF.h>
+#include <mlir/Dialect/Utils/StaticValueUtils.h>
+#include <mlir/Dialect/Vector/IR/VectorOps.h>
+#include <mlir/Dialect/XeGPU/IR/XeGPU.h>
+#include <mlir/IR/Builders.h>
+#include <mlir/Pass/Pass.h>
+
+#include <algorithm>
+
+namespace imex {
+#define GEN_PASS_DEF_ESTIMATEKERNELCOST
+#include "imex/Transforms/Passes.h.inc"
+} // namespace imex
+
+namespace {
+
+struct Cost {
+  int64_t bytes = 0;
+  int64_t flops = 0;
+
+  Cost &operator+=(const Cost &rhs) {
+    bytes += rhs.bytes;
+    flops += rhs.flops;
+    return *this;
+  }
+
+  Cost operator*(int64_t factor) const {
+    return {bytes * factor, flops * factor};
+  }
+};
+
+static int64_t getNumElements(mlir::Type type) {
+  if (auto shaped = mlir::dyn_cast<mlir::ShapedType>(type))
+    return shaped.hasStaticShape() ? shaped.getNumElements() : 1;
+  return 1;
+}
+
+static int64_t getNumBytes(mlir::Type type) {
+  auto elemTy = mlir::getElementTypeOrSelf(type);
+  // Index values are 64 bit on all supported devices.
+  auto bits = elemTy.isIntOrFloat() ? elemTy.getIntOrFloatBitWidth() : 64;
+  return getNumElements(type) * ((bits + 7) / 8);
+}
+
+// Cost of \p op itself, without the ops in its regions.
+static Cost getOpCost(mlir::Operation *op) {
+  if (mlir::isa<mlir::memref::LoadOp, mlir::vector::LoadOp,
+                mlir::vector::TransferReadOp, mlir::xegpu::LoadNdOp,
+                mlir::xegpu::LoadGatherOp>(op))
+    return {getNumBytes(op->getResult(0).getType()), 0};
+  // The stored value is the first operand of all of these.
+  if (mlir::isa<mlir::memref::StoreOp, mlir::vector::StoreOp,
+                mlir::vector::TransferWriteOp, mlir::xegpu::StoreNdOp,
+                mlir::xegpu::StoreScatterOp>(op))
+    return {getNumBytes(op->getOperand(0).getType()), 0};
+
+  if (auto dpas = mlir::dyn_cast<mlir::xegpu::DpasOp>(op)) {
+    // MxK times KxN, the operands may be in a packed (vnni) layout.
+    auto lhsTy = dpas.getLhsType();
+    auto m = lhsTy.getShape()[0];
+    auto n = getNumElements(dpas.getResultType()) / m;
+    return {0, 2 * lhsTy.getNumElements() * n};
+  }
+
+  if (op->getNumResults() != 1 ||
+      !mlir::isa<mlir::FloatType>(
+          mlir::getElementTypeOrSelf(op->getResult(0).getType())))
+    return {};
+  auto numElements = getNumElements(op->getResult(0).getType());
+  if (mlir::isa<mlir::math::FmaOp, mlir::vector::FMAOp>(op))
+    return {0, 2 * numElements};
+  if (mlir::isa<mlir::arith::AddFOp, mlir::arith::SubFOp, mlir::arith::MulFOp,
+                mlir::arith::DivFOp, mlir::arith::RemFOp,
+                mlir::arith::MaximumFOp, mlir::arith::MinimumFOp,
+                mlir::arith::MaxNumFOp, mlir::arith::MinNumFOp>(op) ||
+      mlir::isa_and_nonnull<mlir::math::MathDialect>(op->getDialect()))
+    return {0, numElements};
+  if (auto reduction = mlir::dyn_cast<mlir::vector::ReductionOp>(op))
+    return {0, getNumElements(reduction.getVector().getType())};
+  if (auto reduction = mlir::dyn_cast<mlir::vector::MultiDimReductionOp>(op))
+    return {0, getNumElements(reduction.getSource().getType())};
+  return {};
+}
+
+static Cost getBlockCost(mlir::Block &block);
+
+static Cost getRegionsCost(mlir::Operation *op) {
+  // Only one branch of an scf.if is executed, take the more expensive one.
+  if (auto ifOp = mlir::dyn_cast<mlir::scf::IfOp>(op)) {
+    auto thenCost = getBlockCost(ifOp.getThenRegion().front());
+    if (ifOp.getElseRegion().empty())
+      return thenCost;
+    auto elseCost = getBlockCost(ifOp.getElseRegion().front());
+    return thenCost.bytes + thenCost.flops >= elseCost.bytes + elseCost.flops
+               ? thenCost
+               : elseCost;
+  }
+
+  Cost cost;
+  for (auto &region : op->getRegions())
+    for (auto &block : region)
+      cost += getBlockCost(block);
+
+  // Loops with unknown trip count are counted once.
+  if (auto forOp = mlir::dyn_cast<mlir::scf::ForOp>(op)) {
+    auto lb = mlir::getConstantIntValue(forOp.getLowerBound());
+    auto ub = mlir::getConstantIntValue(forOp.getUpperBound());
+    auto step = mlir::getConstantIntValue(forOp.getStep());
+    if (lb && ub && step && *step > 0)
+      cost = cost * std::max<int64_t>((*ub - *lb + *step - 1) / *step, 0);
+  }
+  return cost;
+}
+
+static Cost getBlockCost(mlir::Block &block) {
+  Cost cost;
+  for (auto &op : block) {
+    cost += getOpCost(&op);
+    cost += getRegionsCost(&op);
+  }
+  return cost;
+}
+
+class EstimateKernelCostPass final
+    : public imex::impl::EstimateKernelCostBase<EstimateKernelCostPass> {
+public:
+  void runOnOperation() override {
+    mlir::OpBuilder builder(&getContext());
+    getOperation()->walk([&](mlir::gpu::GPUFuncOp func) {
+      if (!func.isKernel() || func.getBody().empty())
+        return;
+      auto cost = getRegionsCost(func);
+      func->setAttr(imex::gpuBytesPerItemAttrName,
+                    builder.getI64IntegerAttr(cost.bytes));
+      func->setAttr(imex::gpuFlopsPerItemAttrName,
+                    builder.getI64IntegerAttr(cost.flops));
+    });
+  }
+};
+
+} // namespace
+
+namespace imex {
+std::unique_ptr<mlir::Pass> createEstimateKernelCostPass() {
+  return std::make_unique<EstimateKernelCostPass>();
+}
+} // namespace imex
@@ -0,0 +1,71 @@
+//===- FillToMemset.cpp - FillToMemset Pass ---------------------*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file replaces linalg.fill ops on whole contiguous memrefs by
+/// gpu.memset, such as the zero initialization of the accumulators of
+/// matmuls. insert-gpu-allocs moves the filled buffers to the device, where
+/// the memset is a fill command of the runtime instead of a kernel launch.
+///
+//===----------------------------------------------------------------------===//
+
+#include <imex/Transforms/Passes.h>
+
+#include <mlir/Dialect/Func/IR/FuncOps.h>
+#include <mlir/Dialect/GPU/IR/GPUDialect.h>
+#include <mlir/Dialect/Linalg/IR/Linalg.h>
+#include <mlir/Pass/Pass.h>
+
+namespace imex {
+#define GEN_PASS_DEF_FILLTOMEMSET
+#include "imex/Transforms/Passes.h.inc"
+} // namespace imex
+
+namespace {
+
+// Returns true if \p op fills a whole contiguous host memref with a value
+// of its element type, which the runtime can fill as a pattern of bytes.
+static bool isMemsetCompatible(mlir::linalg::FillOp op) {
+  if (!op.hasPureBufferSemantics() ||
+      op->getParentOfType<mlir::gpu::LaunchOp>() ||
+      op->getParentOfType<mlir::gpu::GPUFuncOp>())
+    return false;
+  auto value = op.getDpsInputOperand(0)->get();
+  auto dst = op.getDpsInitOperand(0)->get();
+  auto type = mlir::dyn_cast<mlir::MemRefType>(dst.getType());
+  return type && type.getLayout().isIdentity() && !type.getMemorySpace() &&
+         value.getType() == type.getElementType() &&
+         type.getElementType().isIntOrFloat();
+}
+
+struct FillToMemsetPass final
+    : public imex::impl::FillToMemsetBase<FillToMemsetPass> {
+  void runOnOperation() override {
+    llvm::SmallVector<mlir::linalg::FillOp> fills;
+    getOperation().walk([&](mlir::linalg::FillOp op) {
+      if (isMemsetCompatible(op))
+        fills.push_back(op);
+    });
+    for (auto fill : fills) {
+      mlir::OpBuilder builder(fill);
+      builder.create<mlir::gpu::MemsetOp>(
+          fill.getLoc(), /*asyncToken*/ mlir::Type(),
+          /*asyncDependencies*/ mlir::ValueRange(),
+          fill.getDpsInitOperand(0)->get(), fill.getDpsInputOperand(0)->get());
+      fill->erase();
+    }
+  }
+};
+} // namespace
+
+namespace imex {
+std::unique_ptr<mlir::Pass> createFillToMemsetPass() {
+  return std::make_unique<FillToMemsetPass>();
+}
+} // namespace imex
@@ -0,0 +1,87 @@
+//===- FuseGenerators.cpp - FuseGenerators Pass -----------------*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file fuses generators into their elementwise consumers. A generator
+/// is a parallel linalg.generic without inputs, computing each element from
+/// its indices and captured scalars only, such as lowered ndarray.linspace
+/// and ndarray.create with a fill value. Recomputing the element in each
+/// consumer is cheaper than materializing the generated tensor, so unlike
+/// linalg-fuse-elementwise-ops generators get fused into all consumers, even
+/// if they have more than one.
+///
+//===----------------------------------------------------------------------===//
+
+#include <imex/Transforms/Passes.h>
+
+#include <mlir/Dialect/Linalg/IR/Linalg.h>
+#include <mlir/Dialect/Linalg/Transforms/Transforms.h>
+#include <mlir/IR/PatternMatch.h>
+#include <mlir/Pass/Pass.h>
+#include <mlir/Transforms/GreedyPatternRewriteDriver.h>
+
+namespace imex {
+#define GEN_PASS_DEF_FUSEGENERATORS
+#include "imex/Transforms/Passes.h.inc"
+} // namespace imex
+
+namespace {
+
+// Returns true if \p op is a generator with tensor semantics.
+static bool isGenerator(mlir::linalg::GenericOp op) {
+  return op.getNumDpsInputs() == 0 && op.getNumResults() == 1 &&
+         op.hasPureTensorSemantics() &&
+         op.getNumLoops() == op.getNumParallelLoops();
+}
+
+// Fuses the first generator operand of a linalg.generic into it.
+struct FuseGeneratorPattern
+    : public mlir::OpRewritePattern<mlir::linalg::GenericOp> {
+  using OpRewritePattern::OpRewritePattern;
+
+  mlir::LogicalResult
+  matchAndRewrite(mlir::linalg::GenericOp op,
+                  mlir::PatternRewriter &rewriter) const override {
+    for (auto *operand : op.getDpsInputOperands()) {
+      auto producer = operand->get().getDefiningOp<mlir::linalg::GenericOp>();
+      if (!producer || !isGenerator(producer) ||
+          !mlir::linalg::areElementwiseOpsFusable(operand))
+        continue;
+      auto fused = mlir::linalg::fuseElementwiseOps(rewriter, operand);
+      if (mlir::failed(fused))
+        continue;
+      // Other users keep using the generator, such that it gets fused into
+      // them as well. The copy of its result the fused op might preserve
+      // for them is unused and gets erased.
+      for (auto [orig, replacement] : fused->replacements)
+        if (orig.getDefiningOp() == op.getOperation())
+          rewriter.replaceAllUsesWith(orig, replacement);
+      rewriter.eraseOp(op);
+      return mlir::success();
+    }
+    return mlir::failure();
+  }
+};
+
+struct FuseGeneratorsPass final
+    : public imex::impl::FuseGeneratorsBase<FuseGeneratorsPass> {
+  void runOnOperation() override {
+    mlir::RewritePatternSet patterns(&getContext());
+    patterns.insert<FuseGeneratorPattern>(&getContext());
+    mlir::linalg::populateEraseUnusedOperandsAndResultsPatterns(patterns);
+    (void)mlir::applyPatternsGreedily(getOperation(), std::move(patterns));
+  }
+};
+} // namespace
+
+namespace imex {
+std::unique_ptr<mlir::Pass> createFuseGeneratorsPass() {
+  return std::make_unique<FuseGeneratorsPass>();
+}
+} // namespace imex
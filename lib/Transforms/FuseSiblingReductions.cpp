@@ -0,0 +1,174 @@
+//===- FuseSiblingReductions.cpp - FuseSiblingReductions Pass ---*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file fuses sibling linalg.generic reductions, which read a common
+/// input over the same iteration domain, into a single multi-result
+/// linalg.generic (input fusion). Such reductions, e.g. the sum and the sum
+/// of squares of an array, otherwise get lowered to separate loop nests and
+/// kernels, each re-reading the input.
+///
+//===----------------------------------------------------------------------===//
+
+#include <imex/Transforms/Passes.h>
+
+#include <mlir/Dialect/Linalg/IR/Linalg.h>
+#include <mlir/Dialect/Linalg/Transforms/Transforms.h>
+#include <mlir/IR/IRMapping.h>
+#include <mlir/IR/PatternMatch.h>
+#include <mlir/Pass/Pass.h>
+#include <mlir/Transforms/GreedyPatternRewriteDriver.h>
+
+namespace imex {
+#define GEN_PASS_DEF_FUSESIBLINGREDUCTIONS
+#include "imex/Transforms/Passes.h.inc"
+} // namespace imex
+
+namespace {
+
+// Returns true if \p a and \p b iterate over the same domain: they have the
+// same iterators and read a common input through the same permutation map,
+// which determines the sizes of all loops.
+static bool haveSameDomain(mlir::linalg::GenericOp a,
+                           mlir::linalg::GenericOp b) {
+  if (a.getIteratorTypesArray() != b.getIteratorTypesArray())
+    return false;
+  for (auto *aInput : a.getDpsInputOperands()) {
+    auto map = a.getMatchingIndexingMap(aInput);
+    if (!map.isPermutation())
+      continue;
+    for (auto *bInput : b.getDpsInputOperands())
+      if (aInput->get() == bInput->get() &&
+          b.getMatchingIndexingMap(bInput) == map)
+        return true;
+  }
+  return false;
+}
+
+// Returns true if \p a can be moved down to \p b, which follows it in the
+// same block: neither \p b nor anything in between uses the results of \p a.
+static bool canMoveTo(mlir::linalg::GenericOp a, mlir::linalg::GenericOp b) {
+  auto *block = b->getBlock();
+  for (auto *user : a->getUsers()) {
+    auto *op = block->findAncestorOpInBlock(*user);
+    if (!op || !b->isBeforeInBlock(op))
+      return false;
+  }
+  return true;
+}
+
+// Fuses a linalg.generic reduction with the closest preceding sibling that
+// reads a common input over the same iteration domain. The fused op takes
+// the place of the later one and computes the results of both.
+struct FuseSiblingReductionPattern
+    : public mlir::OpRewritePattern<mlir::linalg::GenericOp> {
+  using OpRewritePattern::OpRewritePattern;
+
+  mlir::LogicalResult
+  matchAndRewrite(mlir::linalg::GenericOp op,
+                  mlir::PatternRewriter &rewriter) const override {
+    if (!op.hasPureTensorSemantics() || op.getNumReductionLoops() == 0)
+      return mlir::failure();
+    for (auto *prev = op->getPrevNode(); prev; prev = prev->getPrevNode()) {
+      auto sibling = mlir::dyn_cast<mlir::linalg::GenericOp>(prev);
+      if (!sibling || !sibling.hasPureTensorSemantics() ||
+          !haveSameDomain(sibling, op) || !canMoveTo(sibling, op))
+        continue;
+      fuse(sibling, op, rewriter);
+      return mlir::success();
+    }
+    return mlir::failure();
+  }
+
+private:
+  static void fuse(mlir::linalg::GenericOp first,
+                   mlir::linalg::GenericOp second,
+                   mlir::PatternRewriter &rewriter) {
+    // Inputs read through the same map are passed once, all inits are kept.
+    llvm::SmallVector<mlir::Value> inputs, inits;
+    llvm::SmallVector<mlir::AffineMap> inputMaps, initMaps;
+    llvm::SmallVector<mlir::Type> resultTypes;
+    llvm::SmallVector<llvm::SmallVector<unsigned>> argIndices(2);
+    mlir::linalg::GenericOp ops[] = {first, second};
+    for (auto [idx, op] : llvm::enumerate(ops)) {
+      for (auto *operand : op.getDpsInputOperands()) {
+        auto map = op.getMatchingIndexingMap(operand);
+        unsigned pos = 0;
+        while (pos < inputs.size() &&
+               (inputs[pos] != operand->get() || inputMaps[pos] != map))
+          ++pos;
+        if (pos == inputs.size()) {
+          inputs.push_back(operand->get());
+          inputMaps.push_back(map);
+        }
+        argIndices[idx].push_back(pos);
+      }
+    }
+    for (auto [idx, op] : llvm::enumerate(ops)) {
+      for (auto &operand : op.getDpsInitsMutable()) {
+        argIndices[idx].push_back(inputs.size() + inits.size());
+        inits.push_back(operand.get());
+        initMaps.push_back(op.getMatchingIndexingMap(&operand));
+      }
+      resultTypes.append(op->result_type_begin(), op->result_type_end());
+    }
+    auto maps = llvm::to_vector(llvm::concat<mlir::AffineMap>(inputMaps,
+                                                             initMaps));
+
+    rewriter.setInsertionPoint(second);
+    auto fused = rewriter.create<mlir::linalg::GenericOp>(
+        rewriter.getFusedLoc({first.getLoc(), second.getLoc()}),
+        resultTypes, inputs, inits, maps, second.getIteratorTypesArray());
+
+    llvm::SmallVector<mlir::Type> argTypes;
+    llvm::SmallVector<mlir::Location> argLocs;
+    for (auto value : llvm::concat<mlir::Value>(inputs, inits)) {
+      argTypes.push_back(mlir::getElementTypeOrSelf(value.getType()));
+      argLocs.push_back(value.getLoc());
+    }
+    auto *block = rewriter.createBlock(&fused.getRegion(), {}, argTypes,
+                                       argLocs);
+
+    // The bodies are independent, so they are cloned one after the other.
+    llvm::SmallVector<mlir::Value> yielded;
+    for (auto [idx, op] : llvm::enumerate(ops)) {
+      mlir::IRMapping mapping;
+      for (auto [arg, pos] : llvm::zip(op.getBody()->getArguments(),
+                                       argIndices[idx]))
+        mapping.map(arg, block->getArgument(pos));
+      for (auto &bodyOp : op.getBody()->without_terminator())
+        rewriter.clone(bodyOp, mapping);
+      for (auto value : op.getBody()->getTerminator()->getOperands())
+        yielded.push_back(mapping.lookupOrDefault(value));
+    }
+    rewriter.create<mlir::linalg::YieldOp>(fused.getLoc(), yielded);
+
+    auto results = fused.getResults();
+    auto numFirst = first.getNumResults();
+    rewriter.replaceOp(first, results.take_front(numFirst));
+    rewriter.replaceOp(second, results.drop_front(numFirst));
+  }
+};
+
+struct FuseSiblingReductionsPass final
+    : public imex::impl::FuseSiblingReductionsBase<FuseSiblingReductionsPass> {
+  void runOnOperation() override {
+    mlir::RewritePatternSet patterns(&getContext());
+    patterns.insert<FuseSiblingReductionPattern>(&getContext());
+    mlir::linalg::populateEraseUnusedOperandsAndResultsPatterns(patterns);
+    (void)mlir::applyPatternsGreedily(getOperation(), std::move(patterns));
+  }
+};
+} // namespace
+
+namespace imex {
+std::unique_ptr<mlir::Pass> createFuseSiblingReductionsPass() {
+  return std::make_unique<FuseSiblingReductionsPass>();
+}
+} // namespace imex
@@ -0,0 +1,216 @@
+//===- GroupSizeAgnostic.cpp - GroupSizeAgnostic Pass -----------*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file rewrites gpu kernels whose work items do not cooperate within
+/// their workgroup to compute their original ids from their global id, and
+/// marks them as group size agnostic. The runtime may then launch them with
+/// any split of the same global size into groups.
+///
+//===----------------------------------------------------------------------===//
+
+#include <imex/Transforms/Passes.h>
+#include <imex/Utils/GPUSerialize.h>
+
+#include <mlir/Dialect/Arith/IR/Arith.h>
+#include <mlir/Dialect/GPU/IR/GPUDialect.h>
+#include <mlir/Dialect/Utils/StaticValueUtils.h>
+#include <mlir/IR/Builders.h>
+#include <mlir/IR/BuiltinOps.h>
+#include <mlir/IR/SymbolTable.h>
+#include <mlir/Pass/Pass.h>
+
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/SmallVector.h>
+
+#include <array>
+#include <optional>
+
+namespace imex {
+#define GEN_PASS_DEF_GROUPSIZEAGNOSTIC
+#include "imex/Transforms/Passes.h.inc"
+} // namespace imex
+
+namespace {
+
+// Workgroup memory is shared by the work items of a group.
+static bool isWorkgroupMemory(mlir::Type type) {
+  auto memref = mlir::dyn_cast<mlir::BaseMemRefType>(type);
+  return memref && mlir::gpu::GPUDialect::isWorkgroupMemoryAddressSpace(
+                       memref.getMemorySpace());
+}
+
+// Returns true if op only depends on the global position of the work item,
+// i.e. it neither synchronizes nor shares data with other work items of its
+// workgroup or subgroup.
+static bool isWorkItemLocal(mlir::Operation *op) {
+  if (mlir::isa<mlir::gpu::ThreadIdOp, mlir::gpu::BlockIdOp,
+                mlir::gpu::BlockDimOp, mlir::gpu::GridDimOp,
+                mlir::gpu::GlobalIdOp, mlir::gpu::ReturnOp,
+                mlir::gpu::PrintfOp>(op))
+    return true;
+  auto dialect = op->getDialect();
+  if (!dialect)
+    return false;
+  if (!llvm::is_contained({"affine", "arith", "cf", "complex", "index", "math",
+                           "memref", "scf", "vector"},
+                          dialect->getNamespace()))
+    return false;
+  return llvm::none_of(op->getOperandTypes(), isWorkgroupMemory) &&
+         llvm::none_of(op->getResultTypes(), isWorkgroupMemory);
+}
+
+static bool isGroupSizeAgnostic(mlir::gpu::GPUFuncOp func) {
+  if (!func.isKernel() || func.getBody().empty() ||
+      func.getNumWorkgroupAttributions() != 0 ||
+      func->hasAttr(imex::gpuVectorBackendAttrName))
+    return false;
+  if (llvm::any_of(func.getArgumentTypes(), isWorkgroupMemory))
+    return false;
+  return !func.getBody()
+              .walk([](mlir::Operation *op) {
+                return isWorkItemLocal(op) ? mlir::WalkResult::advance()
+                                           : mlir::WalkResult::interrupt();
+              })
+              .wasInterrupted();
+}
+
+// An original launch size of a kernel: constant if all launches agree on
+// it, otherwise a kernel argument. The constant is materialized in the
+// kernel on first use.
+struct LaunchSize {
+  std::optional<int64_t> constant;
+  mlir::Value arg;
+};
+
+class GroupSizeAgnosticPass final
+    : public imex::impl::GroupSizeAgnosticBase<GroupSizeAgnosticPass> {
+public:
+  void runOnOperation() override {
+    auto module = getOperation();
+    module->walk([&](mlir::gpu::GPUFuncOp func) {
+      if (func->hasAttr(imex::gpuGroupSizeAgnosticAttrName) ||
+          !isGroupSizeAgnostic(func))
+        return;
+      auto uses = mlir::SymbolTable::getSymbolUses(func, module);
+      if (!uses)
+        return;
+      llvm::SmallVector<mlir::gpu::LaunchFuncOp> launches;
+      for (auto &use : *uses) {
+        auto launch = mlir::dyn_cast<mlir::gpu::LaunchFuncOp>(use.getUser());
+        // Dynamic shared memory is shared by the work items of a group.
+        if (!launch || launch.getDynamicSharedMemorySize())
+          return;
+        launches.push_back(launch);
+      }
+      if (launches.empty())
+        return;
+      rewrite(func, launches);
+    });
+  }
+
+private:
+  // Replaces the ids of the work items of func by the ones computed from
+  // their global id and the original launch sizes, which are passed as
+  // arguments unless they are constant.
+  void rewrite(mlir::gpu::GPUFuncOp func,
+               llvm::ArrayRef<mlir::gpu::LaunchFuncOp> launches) {
+    auto loc = func.getLoc();
+    mlir::OpBuilder builder(func.getContext());
+    auto indexType = builder.getIndexType();
+
+    // The original block sizes come first, then the grid sizes.
+    std::array<LaunchSize, 6> sizes;
+    for (unsigned i = 0; i < sizes.size(); ++i) {
+      auto getValue = [i](mlir::gpu::LaunchFuncOp launch) {
+        auto dims = i < 3 ? launch.getBlockSizeOperandValues()
+                          : launch.getGridSizeOperandValues();
+        return std::array<mlir::Value, 3>{dims.x, dims.y, dims.z}[i % 3];
+      };
+      auto constant = mlir::getConstantIntValue(getValue(launches.front()));
+      if (constant &&
+          llvm::all_of(launches, [&](mlir::gpu::LaunchFuncOp launch) {
+            return mlir::getConstantIntValue(getValue(launch)) == constant;
+          })) {
+        sizes[i].constant = constant;
+        continue;
+      }
+      auto argIndex = func.getNumArguments();
+      func.insertArgument(argIndex, indexType, {}, loc);
+      sizes[i].arg = func.getArgument(argIndex);
+      for (auto launch : launches)
+        launch.getKernelOperandsMutable().append(getValue(launch));
+    }
+
+    llvm::SmallVector<mlir::Operation *> idOps;
+    func.walk([&](mlir::Operation *op) {
+      if (mlir::isa<mlir::gpu::ThreadIdOp, mlir::gpu::BlockIdOp,
+                    mlir::gpu::BlockDimOp, mlir::gpu::GridDimOp>(op))
+        idOps.push_back(op);
+    });
+
+    auto getSize = [&](unsigned i) {
+      if (!sizes[i].arg)
+        sizes[i].arg = builder.create<mlir::arith::ConstantIndexOp>(
+            loc, *sizes[i].constant);
+      return sizes[i].arg;
+    };
+    // Original block and thread ids of each dimension, created on first use.
+    std::array<mlir::Value, 3> blockIds, threadIds;
+    auto getIds = [&](mlir::gpu::Dimension dim) {
+      auto d = static_cast<unsigned>(dim);
+      if (!blockIds[d]) {
+        auto blockId = builder.create<mlir::gpu::BlockIdOp>(loc, dim);
+        auto blockDim = builder.create<mlir::gpu::BlockDimOp>(loc, dim);
+        auto threadId = builder.create<mlir::gpu::ThreadIdOp>(loc, dim);
+        mlir::Value globalId = builder.create<mlir::arith::AddIOp>(
+            loc, builder.create<mlir::arith::MulIOp>(loc, blockId, blockDim),
+            threadId);
+        auto size = getSize(d);
+        blockIds[d] =
+            builder.create<mlir::arith::DivUIOp>(loc, globalId, size);
+        threadIds[d] =
+            builder.create<mlir::arith::RemUIOp>(loc, globalId, size);
+      }
+      return std::make_pair(blockIds[d], threadIds[d]);
+    };
+
+    builder.setInsertionPointToStart(&func.getBody().front());
+    for (auto op : idOps) {
+      mlir::Value replacement;
+      if (auto threadId = mlir::dyn_cast<mlir::gpu::ThreadIdOp>(op))
+        replacement = getIds(threadId.getDimension()).second;
+      else if (auto blockId = mlir::dyn_cast<mlir::gpu::BlockIdOp>(op))
+        replacement = getIds(blockId.getDimension()).first;
+      else if (auto blockDim = mlir::dyn_cast<mlir::gpu::BlockDimOp>(op))
+        replacement =
+            getSize(static_cast<unsigned>(blockDim.getDimension()));
+      else
+        replacement = getSize(
+            3 + static_cast<unsigned>(
+                    mlir::cast<mlir::gpu::GridDimOp>(op).getDimension()));
+      op->getResult(0).replaceAllUsesWith(replacement);
+      op->erase();
+    }
+
+    // The launch sizes are no longer known at compile time.
+    for (auto name : {"known_block_size", "known_grid_size",
+                      "gpu.known_block_size", "gpu.known_grid_size"})
+      func->removeAttr(name);
+    func->setAttr(imex::gpuGroupSizeAgnosticAttrName, builder.getUnitAttr());
+  }
+};
+
+} // namespace
+
+namespace imex {
+std::unique_ptr<mlir::Pass> createGroupSizeAgnosticPass() {
+  return std::make_unique<GroupSizeAgnosticPass>();
+}
+} // namespace imex
@@ -0,0 +1,97 @@
+//===- HoistGPUAllocs.cpp - HoistGPUAllocs Pass  ---------*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file hoists gpu.allocs with loop invariant sizes, together with their
+/// gpu.deallocs, out of host loops. The buffer allocated before the loop is
+/// reused by all iterations and deallocated after the loop.
+///
+//===----------------------------------------------------------------------===//
+
+#include <imex/Transforms/Passes.h>
+
+#include <mlir/Dialect/Func/IR/FuncOps.h>
+#include <mlir/Dialect/GPU/IR/GPUDialect.h>
+#include <mlir/Interfaces/LoopLikeInterface.h>
+#include <mlir/Interfaces/ViewLikeInterface.h>
+#include <mlir/Pass/Pass.h>
+
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/SmallVector.h>
+
+namespace imex {
+#define GEN_PASS_DEF_HOISTGPUALLOCS
+#include "imex/Transforms/Passes.h.inc"
+} // namespace imex
+
+namespace {
+
+// Returns the only gpu.dealloc of the buffer allocated by \p alloc, if it is
+// in the block of the alloc and the buffer and its views do not escape the
+// block.
+static mlir::gpu::DeallocOp getLocalDealloc(mlir::gpu::AllocOp alloc) {
+  mlir::gpu::DeallocOp result;
+  auto *block = alloc->getBlock();
+  llvm::SmallVector<mlir::Value> worklist{alloc.getMemref()};
+  while (!worklist.empty()) {
+    auto current = worklist.pop_back_val();
+    for (auto *user : current.getUsers()) {
+      if (auto dealloc = llvm::dyn_cast<mlir::gpu::DeallocOp>(user)) {
+        if (result || dealloc->getBlock() != block ||
+            dealloc.getAsyncToken() || !alloc->isBeforeInBlock(dealloc))
+          return nullptr;
+        result = dealloc;
+        continue;
+      }
+      if (user->hasTrait<mlir::OpTrait::IsTerminator>() ||
+          !block->findAncestorOpInBlock(*user))
+        return nullptr;
+      if (auto view = llvm::dyn_cast<mlir::ViewLikeOpInterface>(user))
+        if (view.getViewSource() == current)
+          worklist.push_back(view->getResult(0));
+    }
+  }
+  return result;
+}
+
+class HoistGPUAllocsPass final
+    : public imex::impl::HoistGPUAllocsBase<HoistGPUAllocsPass> {
+public:
+  void runOnOperation() override {
+    // Inner loops are visited first, such that allocs are hoisted out of
+    // whole loop nests.
+    getOperation().walk([&](mlir::LoopLikeOpInterface loop) {
+      for (auto &region : loop->getRegions()) {
+        for (auto &block : region) {
+          for (auto alloc : llvm::make_early_inc_range(
+                   block.getOps<mlir::gpu::AllocOp>())) {
+            if (alloc.getAsyncToken() ||
+                !alloc.getAsyncDependencies().empty() ||
+                !llvm::all_of(alloc->getOperands(), [&](mlir::Value operand) {
+                  return loop.isDefinedOutsideOfLoop(operand);
+                }))
+              continue;
+            auto dealloc = getLocalDealloc(alloc);
+            if (!dealloc)
+              continue;
+            loop.moveOutOfLoop(alloc);
+            dealloc->moveAfter(loop);
+          }
+        }
+      }
+    });
+  }
+};
+} // namespace
+
+namespace imex {
+std::unique_ptr<mlir::Pass> createHoistGPUAllocsPass() {
+  return std::make_unique<HoistGPUAllocsPass>();
+}
+} // namespace imex
@@ -8,16 +8,22 @@
 //===----------------------------------------------------------------------===//
 ///
 /// \file
-/// This file contains HoistTranspose pass.
+/// This file contains HoistTranspose pass. Transposes are moved up through
+/// extract strided slice ops, elementwise ops and loop iter_args towards the
+/// load ops that can absorb them, and transpose pairs that cancel out are
+/// folded.
 ///
 //===----------------------------------------------------------------------===//
 
 #include "imex/Transforms/Passes.h"
+#include "mlir/Dialect/SCF/IR/SCF.h"
+#include "mlir/Dialect/Utils/IndexingUtils.h"
 #include "mlir/Dialect/Vector/IR/VectorOps.h"
 #include "mlir/Dialect/Vector/Transforms/LoweringPatterns.h"
 #include "mlir/Dialect/Vector/Transforms/VectorRewritePatterns.h"
 #include "mlir/Dialect/XeGPU/IR/XeGPU.h"
 #include "mlir/IR/BuiltinAttributes.h"
+#include "mlir/IR/Matchers.h"
 #include "mlir/IR/Operation.h"
 #include "mlir/IR/PatternMatch.h"
 #include "mlir/IR/Visitors.h"
@@ -115,6 +121,159 @@ struct HoistTransposeBeforeExtractStridedSliceOpPattern
   }
 };
 
+// Returns true if transposing the value does not need an in-register
+// transpose, i.e., it is a splat, a broadcasted scalar, or a transpose that
+// cancels out with the given permutation.
+static bool isFreeToTranspose(mlir::Value value,
+                              llvm::ArrayRef<int64_t> permutation) {
+  if (mlir::matchPattern(value, mlir::m_Constant())) {
+    mlir::DenseElementsAttr attr;
+    return mlir::matchPattern(value, mlir::m_Constant(&attr)) &&
+           attr.isSplat();
+  }
+  if (value.getDefiningOp<mlir::vector::SplatOp>())
+    return true;
+  if (auto broadcastOp = value.getDefiningOp<mlir::vector::BroadcastOp>())
+    return !mlir::isa<mlir::VectorType>(broadcastOp.getSourceType());
+  if (auto transposeOp = value.getDefiningOp<mlir::vector::TransposeOp>())
+    return mlir::isIdentityPermutation(mlir::applyPermutation(
+        transposeOp.getPermutation(), permutation));
+  return false;
+}
+
+// This pattern hoists transpose ops before elementwise ops, if at most one of
+// the operands needs an in-register transpose. The following code sequence:
+// clang-format off
+// %0 = load ...
+// %1 = arith.extf %0 ...
+// %2 = vector.transpose %1 ...
+// clang-format on
+// gets converted to:
+// clang-format off
+// %0 = load ...
+// %1 = vector.transpose %0 ...
+// %2 = arith.extf %1 ...
+// clang-format on
+struct HoistTransposeBeforeElementwiseOpPattern
+    : public mlir::OpRewritePattern<mlir::vector::TransposeOp> {
+  using OpRewritePattern<mlir::vector::TransposeOp>::OpRewritePattern;
+  mlir::LogicalResult
+  matchAndRewrite(mlir::vector::TransposeOp transposeOp,
+                  mlir::PatternRewriter &rewriter) const override {
+    auto *op = transposeOp.getVector().getDefiningOp();
+    if (!op || !mlir::OpTrait::hasElementwiseMappableTraits(op) ||
+        op->getNumResults() != 1 || !op->hasOneUse())
+      return mlir::failure();
+    auto permutation = transposeOp.getPermutation();
+    auto srcTy = transposeOp.getSourceVectorType();
+    unsigned nonFree = 0;
+    for (auto operand : op->getOperands()) {
+      auto vecTy = mlir::dyn_cast<mlir::VectorType>(operand.getType());
+      if (!vecTy)
+        continue;
+      if (vecTy.getShape() != srcTy.getShape())
+        return mlir::failure();
+      if (!isFreeToTranspose(operand, permutation))
+        ++nonFree;
+    }
+    if (nonFree > 1)
+      return rewriter.notifyMatchFailure(
+          transposeOp, "hoisting would need multiple transposes.");
+
+    llvm::SmallVector<mlir::Value> operands;
+    for (auto operand : op->getOperands()) {
+      if (mlir::isa<mlir::VectorType>(operand.getType()))
+        operand = rewriter.create<mlir::vector::TransposeOp>(
+            transposeOp.getLoc(), operand, permutation);
+      operands.push_back(operand);
+    }
+    auto *newOp = rewriter.create(
+        op->getLoc(), op->getName().getIdentifier(), operands,
+        {transposeOp.getResultVectorType()}, op->getAttrs());
+    rewriter.replaceOp(transposeOp, newOp->getResults());
+    rewriter.eraseOp(op);
+    return mlir::success();
+  }
+};
+
+// This pattern moves a transpose of a loop-carried value out of the loop, if
+// the value yielded in each iteration is loaded, such that transposes of the
+// init value and of the loaded values can be absorbed by the loads. The
+// following code sequence:
+// clang-format off
+// %0 = load ...
+// %r = scf.for ... iter_args(%arg = %0) {
+//   %1 = vector.transpose %arg ...
+//   ... uses of %1 ...
+//   %2 = load ...
+//   scf.yield %2
+// }
+// clang-format on
+// gets converted to:
+// clang-format off
+// %0 = load ...
+// %t = vector.transpose %0 ...
+// %r = scf.for ... iter_args(%arg = %t) {
+//   ... uses of %arg ...
+//   %2 = load ...
+//   %3 = vector.transpose %2 ...
+//   scf.yield %3
+// }
+// %4 = vector.transpose %r ... (only if %r is used)
+// clang-format on
+struct HoistTransposeOutOfLoopPattern
+    : public mlir::OpRewritePattern<mlir::scf::ForOp> {
+  using OpRewritePattern<mlir::scf::ForOp>::OpRewritePattern;
+  mlir::LogicalResult
+  matchAndRewrite(mlir::scf::ForOp forOp,
+                  mlir::PatternRewriter &rewriter) const override {
+    auto yieldOp = forOp.getBody()->getTerminator();
+    for (auto [i, iterArg] : llvm::enumerate(forOp.getRegionIterArgs())) {
+      if (!iterArg.hasOneUse())
+        continue;
+      auto transposeOp =
+          llvm::dyn_cast<mlir::vector::TransposeOp>(*iterArg.user_begin());
+      if (!transposeOp)
+        continue;
+      auto permutation = llvm::to_vector(transposeOp.getPermutation());
+      auto yielded = yieldOp->getOperand(i);
+      if (!yielded.getDefiningOp<mlir::xegpu::LoadNdOp>() &&
+          !isFreeToTranspose(yielded, permutation))
+        continue;
+
+      auto loc = transposeOp.getLoc();
+      auto &init = forOp.getInitArgsMutable()[i];
+      rewriter.setInsertionPoint(forOp);
+      auto newInit = rewriter.create<mlir::vector::TransposeOp>(
+          loc, init.get(), permutation);
+      rewriter.setInsertionPoint(yieldOp);
+      auto newYielded =
+          rewriter.create<mlir::vector::TransposeOp>(loc, yielded, permutation);
+      auto result = forOp.getResult(i);
+      auto newTy = transposeOp.getResultVectorType();
+      rewriter.modifyOpInPlace(forOp, [&]() {
+        init.set(newInit);
+        iterArg.setType(newTy);
+        result.setType(newTy);
+      });
+      rewriter.modifyOpInPlace(
+          yieldOp, [&]() { yieldOp->setOperand(i, newYielded); });
+      rewriter.replaceOp(transposeOp, iterArg);
+
+      // The uses of the loop result expect the original layout.
+      if (!result.use_empty()) {
+        rewriter.setInsertionPointAfter(forOp);
+        auto restored = rewriter.create<mlir::vector::TransposeOp>(
+            loc, result, mlir::invertPermutationVector(permutation));
+        rewriter.replaceAllUsesExcept(result, restored,
+                                      restored.getOperation());
+      }
+      return mlir::success();
+    }
+    return mlir::failure();
+  }
+};
+
 struct HoistTransposePass final
     : public imex::impl::HoistTransposeBase<HoistTransposePass> {
   void runOnOperation() override {
@@ -173,11 +332,12 @@ struct HoistTransposePass final
         mlir::GreedySimplifyRegionLevel::Disabled;
     config.useTopDownTraversal = true;
     config.strictMode = mlir::GreedyRewriteStrictness::ExistingAndNewOps;
-    // TODO: Currently we only support hoisting TransposeOps before
-    // ExtractStridedSliceOp. We may also want to support hoisting TransposeOps
-    // before element-wise ops.
     patterns.add<HoistTransposeBeforeExtractStridedSliceOpPattern>(
         context, transposeOps);
+    patterns.add<HoistTransposeBeforeElementwiseOpPattern,
+                 HoistTransposeOutOfLoopPattern>(context);
+    // Fold transpose pairs that cancel out, and transposes of splats.
+    mlir::vector::TransposeOp::getCanonicalizationPatterns(patterns, context);
     if (failed(applyPatternsGreedily(op, std::move(patterns), config))) {
       return signalPassFailure();
     }
@@ -23,6 +23,7 @@
 
 #include <imex/Dialect/Region/RegionUtils.h>
 #include <imex/Dialect/XeTile/IR/XeTileOps.h>
+#include <imex/Utils/GPUSerialize.h>
 #include <mlir/Dialect/Affine/IR/AffineOps.h>
 #include <mlir/Dialect/Bufferization/Transforms/BufferViewFlowAnalysis.h>
 #include <mlir/Dialect/Func/IR/FuncOps.h>
@@ -81,6 +82,23 @@ public:
 
     mlir::OpBuilder builder(func);
 
+    // Buffers of gpu.alloc, e.g. those of the copies of
+    // convert-ndarray-to-linalg, are released by gpu.dealloc.
+    ::mlir::SmallVector<::mlir::memref::DeallocOp> deallocsOfGpuAllocs;
+    func.walk([&](::mlir::memref::DeallocOp dealloc) {
+      auto memref = dealloc.getMemref();
+      while (auto view = memref.getDefiningOp<::mlir::ViewLikeOpInterface>())
+        memref = view.getViewSource();
+      if (memref.getDefiningOp<::mlir::gpu::AllocOp>())
+        deallocsOfGpuAllocs.emplace_back(dealloc);
+    });
+    for (auto dealloc : deallocsOfGpuAllocs) {
+      builder.setInsertionPoint(dealloc);
+      (void)builder.create<::mlir::gpu::DeallocOp>(
+          dealloc.getLoc(), std::nullopt /*async*/, dealloc.getMemref());
+      dealloc.erase();
+    }
+
     if (inRegions.getValue()) {
       // collecting alloc ops in GPU regions
       ::mlir::SmallVector<::mlir::memref::AllocOp> allocOpsInGpuRegion;
@@ -99,13 +117,49 @@ public:
         }
       });
 
+      // Checks if the buffer may be accessed outside of GPU regions, following
+      // views and values yielded by the regions. Buffers forwarded through
+      // other control flow are assumed to be accessed by the host.
+      auto isHostAccessed = [](::mlir::Value memref) {
+        ::mlir::SmallVector<::mlir::Value> worklist{memref};
+        while (!worklist.empty()) {
+          auto value = worklist.pop_back_val();
+          for (auto &use : value.getUses()) {
+            auto *user = use.getOwner();
+            if (::mlir::isa<::mlir::memref::DeallocOp>(user))
+              continue;
+            if (auto yield =
+                    ::mlir::dyn_cast<::imex::region::EnvironmentRegionYieldOp>(
+                        user)) {
+              worklist.push_back(
+                  yield->getParentOp()->getResult(use.getOperandNumber()));
+              continue;
+            }
+            if (auto view = ::mlir::dyn_cast<::mlir::ViewLikeOpInterface>(user);
+                view && view.getViewSource() == value) {
+              worklist.push_back(view->getResult(0));
+              continue;
+            }
+            if (!::imex::region::isInGpuRegion(user) ||
+                user->hasTrait<::mlir::OpTrait::IsTerminator>() ||
+                ::mlir::isa<::mlir::RegionBranchOpInterface>(user))
+              return true;
+          }
+        }
+        return false;
+      };
+
       // Now rudely replace allocs with gpu allocs
       for (auto alloc : allocOpsInGpuRegion) {
         builder.setInsertionPoint(alloc);
+        // In automatic mode, only buffers touched by the host are shared.
+        bool shared = autoHostShared.getValue()
+                          ? isHostAccessed(alloc.getResult())
+                          : hostShared.getValue();
         auto allocResult = builder.create<::mlir::gpu::AllocOp>(
             alloc.getLoc(), alloc.getType(), /*asyncToken*/ nullptr,
             /*asyncDependencies*/ std::nullopt, alloc.getDynamicSizes(),
-            alloc.getSymbolOperands(), /*hostShared*/ hostShared);
+            alloc.getSymbolOperands(), /*hostShared*/ shared);
         alloc.replaceAllUsesWith(allocResult);
         alloc.erase();
       }
@@ -162,6 +216,14 @@ public:
       } else if (auto init_xedesc =
                      mlir::dyn_cast<mlir::xegpu::CreateNdDescOp>(op)) {
         return {{init_xedesc.getSource()}};
+      } else if (auto mma_load =
+                     mlir::dyn_cast<mlir::gpu::SubgroupMmaLoadMatrixOp>(op)) {
+        return {{mma_load.getSrcMemref()}};
+      } else if (auto mma_store =
+                     mlir::dyn_cast<mlir::gpu::SubgroupMmaStoreMatrixOp>(op)) {
+        return {{mma_store.getDstMemref()}};
+      } else if (auto memset = mlir::dyn_cast<mlir::gpu::MemsetOp>(op)) {
+        return {{memset.getDst()}};
       } else {
         op->emitError("Uhhandled mem op in gpu region");
         return std::nullopt;
@@ -205,7 +267,10 @@ public:
               // Limitation is that this pass needs to be be run before the
               // kernel outlining since kernel outlinging with convert the
               // gpu.launch OP to gpu.launch_func.
-              if (!op->getParentOfType<mlir::gpu::LaunchOp>())
+              // gpu.memset, e.g. from imex-fill-to-memset, runs on the device
+              // as well.
+              if (!op->getParentOfType<mlir::gpu::LaunchOp>() &&
+                  !mlir::isa<mlir::gpu::MemsetOp>(op))
                 return mlir::WalkResult::advance();
 
               if (!isMemReadWriteOp(op))
@@ -231,6 +296,14 @@ public:
                     // ViewLikeOps for e.g memref.cast
                     if (mlir::isa<mlir::ViewLikeOpInterface>(op))
                       continue;
+                    // Allocations in kernels are workgroup memory, e.g. the
+                    // tiles of imex-transpose-to-gpu, and stay as they are.
+                    if (op->getParentOfType<mlir::gpu::LaunchOp>())
+                      continue;
+                    // Buffers allocated with gpu.alloc, e.g. by the copies
+                    // of convert-ndarray-to-linalg, are usable as they are.
+                    if (mlir::isa<mlir::gpu::AllocOp>(op))
+                      continue;
                     // Currently the pass only supports memref::AllocOp op and
                     // not its other vairants like memref::AllocaOp,
                     // memref::AllocaScopeOp & AllocaScopeReturnOp.
@@ -375,7 +448,8 @@ public:
 
           if (auto memInterface =
                   mlir::dyn_cast<mlir::MemoryEffectOpInterface>(user)) {
-            bool onDevice = user->getParentOfType<mlir::gpu::LaunchOp>();
+            bool onDevice = user->getParentOfType<mlir::gpu::LaunchOp>() ||
+                            mlir::isa<mlir::gpu::MemsetOp>(user);
             if (memInterface.hasEffect<mlir::MemoryEffects::Read>())
               (onDevice ? ret.deviceRead : ret.hostRead) = true;
 
@@ -522,6 +596,21 @@ public:
       }
     };
 
+    // With upload-constants, constant globals only read on the device get a
+    // device buffer marked with the global, which the runtime fills once per
+    // stream. There is no copy and no gpu.dealloc, the buffer lives as long
+    // as the stream.
+    auto isUploadedConstant = [&](mlir::memref::GetGlobalOp getGlobalOp,
+                                  const AccessType &access) {
+      if (!uploadConstants || m_clientAPI != "opencl" || access.hostRead ||
+          access.hostWrite || access.deviceWrite)
+        return false;
+      auto global = mlir::SymbolTable::lookupNearestSymbolFrom<
+          mlir::memref::GlobalOp>(getGlobalOp, getGlobalOp.getNameAttr());
+      return global && global.getConstant() && !global.isExternal() &&
+             global.getType().getLayout().isIdentity();
+    };
+
     // GetMemrefGlobal Op Case:
     // This is the case where the inputs are globals contants and accessed using
     // memref.get_global op. This code will add the IR for memory allocation on
@@ -531,6 +620,18 @@ public:
       if (isGpuAddrSpace(getGlobalOp))
         continue;
       auto access = getAccessType(getGlobalOp);
+      if (isUploadedConstant(getGlobalOp, access)) {
+        builder.setInsertionPointAfter(getGlobalOp);
+        auto gpuAlloc = builder.create<mlir::gpu::AllocOp>(
+            getGlobalOp.getLoc(), getGlobalOp.getType(),
+            /*asyncToken*/ nullptr, /*asyncDependencies*/ std::nullopt,
+            /*dynamicSizes*/ std::nullopt, /*symbolOperands*/ std::nullopt,
+            /*hostShared*/ false);
+        gpuAlloc->setAttr(imex::gpuConstantDataAttrName,
+                          getGlobalOp.getNameAttr());
+        getGlobalOp.getResult().replaceAllUsesWith(gpuAlloc.getMemref());
+        continue;
+      }
       access.hostRead = true;
       access.hostWrite = true;
       builder.setInsertionPointAfter(getGlobalOp);
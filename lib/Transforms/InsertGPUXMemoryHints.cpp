@@ -0,0 +1,126 @@
+//===- InsertGPUXMemoryHints.cpp - InsertGPUXMemoryHints Pass ---*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file inserts gpux.prefetch and gpux.mem_advise ops for host-shared
+/// gpux.alloc ops, so that kernels do not pay for page migration faults on
+/// the first touch of shared memory.
+///
+//===----------------------------------------------------------------------===//
+
+#include <imex/Dialect/GPUX/IR/GPUXOps.h>
+#include <imex/Transforms/Passes.h>
+
+#include <mlir/Dialect/Func/IR/FuncOps.h>
+#include <mlir/Dialect/GPU/IR/GPUDialect.h>
+#include <mlir/Dialect/MemRef/IR/MemRef.h>
+#include <mlir/Dialect/Vector/IR/VectorOps.h>
+#include <mlir/IR/Builders.h>
+#include <mlir/IR/SymbolTable.h>
+#include <mlir/Pass/Pass.h>
+
+namespace imex {
+#define GEN_PASS_DEF_INSERTGPUXMEMORYHINTS
+#include "imex/Transforms/Passes.h.inc"
+} // namespace imex
+
+namespace {
+
+// Returns true if the kernel only reads the memref argument \p arg.
+static bool isReadOnlyArg(mlir::BlockArgument arg) {
+  return llvm::all_of(arg.getUsers(), [&](mlir::Operation *user) {
+    if (auto load = mlir::dyn_cast<mlir::memref::LoadOp>(user))
+      return load.getMemref() == arg;
+    if (auto load = mlir::dyn_cast<mlir::vector::LoadOp>(user))
+      return load.getBase() == arg;
+    if (auto read = mlir::dyn_cast<mlir::vector::TransferReadOp>(user))
+      return read.getSource() == arg;
+    return false;
+  });
+}
+
+// Returns true if all uses of \p memref as a kernel operand of \p launch only
+// read it.
+static bool isReadOnlyIn(imex::gpux::LaunchFuncOp launch, mlir::Value memref) {
+  auto kernel =
+      mlir::SymbolTable::lookupNearestSymbolFrom<mlir::gpu::GPUFuncOp>(
+          launch, launch.getKernel());
+  if (!kernel)
+    return false;
+  for (auto [i, operand] : llvm::enumerate(launch.getKernelOperands())) {
+    if (operand != memref)
+      continue;
+    if (i >= kernel.getNumArguments() || !isReadOnlyArg(kernel.getArgument(i)))
+      return false;
+  }
+  return true;
+}
+
+class InsertGPUXMemoryHintsPass final
+    : public imex::impl::InsertGPUXMemoryHintsBase<InsertGPUXMemoryHintsPass> {
+public:
+  using InsertGPUXMemoryHintsBase::InsertGPUXMemoryHintsBase;
+
+  void runOnOperation() override {
+    llvm::SmallVector<imex::gpux::AllocOp> allocs;
+    getOperation().walk([&](imex::gpux::AllocOp alloc) {
+      if (alloc.getHostShared())
+        allocs.push_back(alloc);
+    });
+
+    mlir::OpBuilder builder(&getContext());
+    for (auto alloc : allocs) {
+      auto memref = alloc.getMemref();
+      auto *block = alloc->getBlock();
+
+      // Find the launches using the memref, and the op of the block of the
+      // alloc containing the first of them.
+      llvm::SmallVector<imex::gpux::LaunchFuncOp> launches;
+      mlir::Operation *firstUse = nullptr;
+      for (auto *user : memref.getUsers()) {
+        auto launch = mlir::dyn_cast<imex::gpux::LaunchFuncOp>(user);
+        if (!launch)
+          continue;
+        launches.push_back(launch);
+        auto *ancestor = block->findAncestorOpInBlock(*launch);
+        if (ancestor && (!firstUse || ancestor->isBeforeInBlock(firstUse)))
+          firstUse = ancestor;
+      }
+      if (!firstUse)
+        continue;
+
+      auto loc = alloc.getLoc();
+      auto stream = alloc.getGpuxStream();
+      if (readMostly && llvm::all_of(launches, [&](auto launch) {
+            return isReadOnlyIn(launch, memref);
+          })) {
+        builder.setInsertionPointAfter(alloc);
+        builder.create<imex::gpux::MemAdviseOp>(loc, stream, memref,
+                                                "read_mostly");
+      }
+
+      // The prefetch is placed after the host code initializing the memory
+      // and before the kernels touch it.
+      if (prefetch) {
+        builder.setInsertionPoint(firstUse);
+        builder.create<imex::gpux::PrefetchOp>(loc, /*asyncToken=*/mlir::Type(),
+                                               mlir::ValueRange{}, stream,
+                                               memref);
+      }
+    }
+  }
+};
+
+} // namespace
+
+namespace imex {
+std::unique_ptr<mlir::Pass> createInsertGPUXMemoryHintsPass() {
+  return std::make_unique<InsertGPUXMemoryHintsPass>();
+}
+} // namespace imex
@@ -0,0 +1,192 @@
+//===- LoadExternalGlobals.cpp - LoadExternalGlobals Pass -------*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file fills memref.global ops marked with `imex.external_data` from
+/// files at runtime instead of from dense attributes: the globals become
+/// uninitialized, and a function calling loadExternalData* of
+/// imex_runner_utils for each of them is called at the start of the entry
+/// point. The runtime maps the files and copies their contents, so weights
+/// of any size cost nothing to parse.
+///
+//===----------------------------------------------------------------------===//
+
+#include <imex/Transforms/Passes.h>
+
+#include <mlir/Dialect/Func/IR/FuncOps.h>
+#include <mlir/Dialect/MemRef/IR/MemRef.h>
+#include <mlir/IR/Builders.h>
+#include <mlir/IR/BuiltinOps.h>
+#include <mlir/IR/SymbolTable.h>
+#include <mlir/Pass/Pass.h>
+
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/Path.h>
+
+namespace imex {
+#define GEN_PASS_DEF_LOADEXTERNALGLOBALS
+#include "imex/Transforms/Passes.h.inc"
+} // namespace imex
+
+namespace {
+
+constexpr llvm::StringLiteral externalDataAttrName = "imex.external_data";
+constexpr llvm::StringLiteral loadFuncName = "__imex_load_external_globals";
+
+// Returns the suffix of the loadExternalData function for \p elemType, or an
+// empty string if it is not supported.
+static llvm::StringRef getTypeSuffix(mlir::Type elemType) {
+  if (elemType.isF32())
+    return "F32";
+  if (elemType.isF16())
+    return "F16";
+  if (elemType.isBF16())
+    return "BF16";
+  if (elemType.isInteger(32))
+    return "I32";
+  if (elemType.isInteger(8))
+    return "I8";
+  return "";
+}
+
+class LoadExternalGlobalsPass final
+    : public imex::impl::LoadExternalGlobalsBase<LoadExternalGlobalsPass> {
+public:
+  using LoadExternalGlobalsBase::LoadExternalGlobalsBase;
+
+  void runOnOperation() override {
+    auto module = getOperation();
+    llvm::SmallVector<mlir::memref::GlobalOp> globals;
+    for (auto global : module.getOps<mlir::memref::GlobalOp>())
+      if (global->hasAttr(externalDataAttrName))
+        globals.push_back(global);
+    if (globals.empty())
+      return;
+
+    auto entry = module.lookupSymbol<mlir::func::FuncOp>(entryPoint);
+    if (!entry || entry.isExternal()) {
+      module.emitError() << "entry point '" << entryPoint << "' not found";
+      return signalPassFailure();
+    }
+
+    mlir::SymbolTable symbolTable(module);
+    auto builder = mlir::OpBuilder::atBlockBegin(module.getBody());
+    auto loc = builder.getUnknownLoc();
+    auto loadFunc = builder.create<mlir::func::FuncOp>(
+        loc, loadFuncName, builder.getFunctionType({}, {}));
+    loadFunc.setPrivate();
+    symbolTable.insert(loadFunc);
+    mlir::OpBuilder bodyBuilder(loadFunc.addEntryBlock(),
+                                loadFunc.getBody().front().begin());
+
+    for (auto global : globals) {
+      auto pathAttr = llvm::dyn_cast<mlir::StringAttr>(
+          global->getAttr(externalDataAttrName));
+      auto type = global.getType();
+      auto suffix = getTypeSuffix(type.getElementType());
+      if (!pathAttr || suffix.empty() || !type.hasStaticShape() ||
+          !type.getLayout().isIdentity()) {
+        global.emitError() << externalDataAttrName
+                           << " requires a path and a static identity layout "
+                              "memref of f32, f16, bf16, i32 or i8";
+        return signalPassFailure();
+      }
+      if (global.getInitialValue() && !global.isUninitialized()) {
+        global.emitError() << "global with " << externalDataAttrName
+                           << " must not have an initial value";
+        return signalPassFailure();
+      }
+
+      global.setInitialValueAttr(builder.getUnitAttr());
+      global.setConstant(false);
+      global->removeAttr(externalDataAttrName);
+
+      // The path is stored as a zero terminated i8 global.
+      auto path = getPath(global, pathAttr.getValue());
+      llvm::SmallVector<int8_t> chars(path.begin(), path.end());
+      chars.push_back(0);
+      auto pathType = mlir::MemRefType::get(
+          {static_cast<int64_t>(chars.size())}, builder.getI8Type());
+      auto pathGlobal = builder.create<mlir::memref::GlobalOp>(
+          loc, (global.getSymName() + "_path").str(),
+          builder.getStringAttr("private"), pathType,
+          mlir::DenseElementsAttr::get(
+              mlir::RankedTensorType::get(pathType.getShape(),
+                                          builder.getI8Type()),
+              llvm::ArrayRef(chars)),
+          /*constant=*/true, /*alignment=*/mlir::IntegerAttr());
+      symbolTable.insert(pathGlobal);
+
+      auto callee = getLoadFunc(builder, symbolTable, type.getElementType(),
+                                suffix);
+      auto data = bodyBuilder.create<mlir::memref::GetGlobalOp>(
+          loc, type, global.getSymName());
+      auto pathData = bodyBuilder.create<mlir::memref::GetGlobalOp>(
+          loc, pathType, pathGlobal.getSymName());
+      mlir::Value args[] = {
+          bodyBuilder.create<mlir::memref::CastOp>(
+              loc, mlir::UnrankedMemRefType::get(type.getElementType(), 0),
+              data),
+          bodyBuilder.create<mlir::memref::CastOp>(
+              loc, mlir::UnrankedMemRefType::get(builder.getI8Type(), 0),
+              pathData)};
+      bodyBuilder.create<mlir::func::CallOp>(loc, callee, args);
+    }
+    bodyBuilder.create<mlir::func::ReturnOp>(loc);
+
+    mlir::OpBuilder entryBuilder(&entry.getBody().front(),
+                                 entry.getBody().front().begin());
+    entryBuilder.create<mlir::func::CallOp>(loc, loadFunc);
+  }
+
+private:
+  // Resolves a relative \p path against `data-dir`, or else against the
+  // directory of the file \p global was parsed from, if known.
+  std::string getPath(mlir::memref::GlobalOp global, llvm::StringRef path) {
+    if (llvm::sys::path::is_absolute(path))
+      return path.str();
+    llvm::SmallString<256> dir(dataDir);
+    if (dir.empty()) {
+      auto fileLoc = llvm::dyn_cast<mlir::FileLineColLoc>(global.getLoc());
+      if (!fileLoc)
+        return path.str();
+      dir = llvm::sys::path::parent_path(fileLoc.getFilename().getValue());
+    }
+    llvm::sys::path::append(dir, path);
+    return dir.str().str();
+  }
+
+  // Returns the declaration of loadExternalData<suffix>, creating it if
+  // needed.
+  mlir::func::FuncOp getLoadFunc(mlir::OpBuilder &builder,
+                                 mlir::SymbolTable &symbolTable,
+                                 mlir::Type elemType, llvm::StringRef suffix) {
+    auto name = ("loadExternalData" + suffix).str();
+    if (auto func = symbolTable.lookup<mlir::func::FuncOp>(name))
+      return func;
+    auto func = builder.create<mlir::func::FuncOp>(
+        builder.getUnknownLoc(), name,
+        builder.getFunctionType(
+            {mlir::UnrankedMemRefType::get(elemType, 0),
+             mlir::UnrankedMemRefType::get(builder.getI8Type(), 0)},
+            {}));
+    func.setPrivate();
+    func->setAttr("llvm.emit_c_interface", builder.getUnitAttr());
+    symbolTable.insert(func);
+    return func;
+  }
+};
+
+} // namespace
+
+namespace imex {
+std::unique_ptr<mlir::Pass> createLoadExternalGlobalsPass() {
+  return std::make_unique<LoadExternalGlobalsPass>();
+}
+} // namespace imex
@@ -11,14 +11,25 @@
 /// This pass lowers memref copyOp to linalg generic operations and enables
 /// simple memref copyOp canonicalization
 ///
+/// Optionally, copies between contiguous buffers are kept as memref.copy,
+/// which is lowered to a memcpy, or replaced by gpu.memcpy if one of the
+/// buffers is allocated on the device. Copies of buffers with contiguous rows
+/// become a loop nest of row memcpys. Only irregular views are lowered to
+/// linalg generic operations.
+///
 //===----------------------------------------------------------------------===//
 
 #include "imex/Transforms/Passes.h"
 
+#include "mlir/Dialect/Arith/IR/Arith.h"
 #include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/Dialect/GPU/IR/GPUDialect.h"
 #include "mlir/Dialect/Linalg/Utils/Utils.h"
 #include "mlir/Dialect/MemRef/IR/MemRef.h"
+#include "mlir/Dialect/MemRef/Utils/MemRefUtils.h"
+#include "mlir/Dialect/SCF/IR/SCF.h"
 #include "mlir/IR/Dominance.h"
+#include "mlir/Interfaces/ViewLikeInterface.h"
 #include "mlir/Pass/Pass.h"
 
 namespace imex {
@@ -30,8 +41,89 @@ using namespace mlir;
 using namespace imex;
 
 namespace {
+
+// Returns true if the elements of \p type are contiguous in memory.
+static bool isContiguous(MemRefType type) {
+  return type.getLayout().isIdentity() ||
+         memref::isStaticShapeAndContiguousRowMajor(type);
+}
+
+// Returns true if the innermost dimension of \p type is static and has unit
+// stride, such that each row of the buffer is contiguous.
+static bool hasContiguousRows(MemRefType type) {
+  SmallVector<int64_t> strides;
+  int64_t offset;
+  if (type.getRank() < 2 || ShapedType::isDynamic(type.getShape().back()) ||
+      failed(type.getStridesAndOffset(strides, offset)))
+    return false;
+  return strides.back() == 1;
+}
+
+// Returns true if \p value is a view of a buffer allocated on the device.
+static bool isDeviceBuffer(Value value) {
+  while (auto view = value.getDefiningOp<ViewLikeOpInterface>())
+    value = view.getViewSource();
+  return value.getDefiningOp<gpu::AllocOp>();
+}
+
+// Copies the rows of \p src to \p dst in a loop nest over the outer
+// dimensions. Each row copy is a contiguous memref.copy.
+static void makeRowCopies(OpBuilder &builder, Location loc, Value src,
+                          Value dst) {
+  auto type = cast<MemRefType>(src.getType());
+  auto rank = type.getRank();
+  auto zero = builder.create<arith::ConstantIndexOp>(loc, 0);
+  auto one = builder.create<arith::ConstantIndexOp>(loc, 1);
+  SmallVector<Value> lbs(rank - 1, zero), steps(rank - 1, one), ubs;
+  for (int64_t dim = 0; dim < rank - 1; ++dim)
+    ubs.push_back(builder.createOrFold<memref::DimOp>(loc, src, dim));
+  int64_t rowSize = type.getShape().back();
+  scf::buildLoopNest(
+      builder, loc, lbs, ubs, steps,
+      [&](OpBuilder &b, Location loc, ValueRange ivs) {
+        SmallVector<OpFoldResult> offsets(ivs.begin(), ivs.end());
+        offsets.push_back(b.getIndexAttr(0));
+        SmallVector<OpFoldResult> sizes(rank - 1, b.getIndexAttr(1));
+        sizes.push_back(b.getIndexAttr(rowSize));
+        SmallVector<OpFoldResult> strides(rank, b.getIndexAttr(1));
+        auto getRow = [&](Value buffer) -> Value {
+          auto rowType = cast<MemRefType>(
+              memref::SubViewOp::inferRankReducedResultType(
+                  {rowSize}, cast<MemRefType>(buffer.getType()), offsets,
+                  sizes, strides));
+          return b.create<memref::SubViewOp>(loc, rowType, buffer, offsets,
+                                             sizes, strides);
+        };
+        b.create<memref::CopyOp>(loc, getRow(src), getRow(dst));
+      });
+}
+
 struct LowerMemRefCopy
     : public imex::impl::LowerMemRefCopyBase<LowerMemRefCopy> {
+  using LowerMemRefCopyBase::LowerMemRefCopyBase;
+
+  // Lowers \p op to a memcpy if possible, or to linalg.generic otherwise.
+  // Returns false if \p op is kept as a contiguous memref.copy.
+  bool lowerCopy(memref::CopyOp op) {
+    OpBuilder builder(op);
+    auto src = op.getSource();
+    auto dst = op.getTarget();
+    auto srcType = cast<MemRefType>(src.getType());
+    auto dstType = cast<MemRefType>(dst.getType());
+    if (isContiguous(srcType) && isContiguous(dstType)) {
+      if (!isDeviceBuffer(src) && !isDeviceBuffer(dst))
+        return false;
+      builder.create<gpu::MemcpyOp>(
+          op.getLoc(), /*resultTypes*/ TypeRange{},
+          /*asyncDependencies*/ ValueRange{}, dst, src);
+    } else if (hasContiguousRows(srcType) && hasContiguousRows(dstType)) {
+      makeRowCopies(builder, op.getLoc(), src, dst);
+    } else {
+      linalg::makeMemRefCopyOp(builder, op.getLoc(), src, dst);
+    }
+    return true;
+  }
+
   void runOnOperation() override {
     auto &domInfo = getAnalysis<DominanceInfo>();
     auto func = getOperation();
@@ -44,13 +136,19 @@ struct LowerMemRefCopy
       // supposed to work on same memref type
       auto srcType = mlir::cast<MemRefType>(src.getType());
       auto dstType = mlir::cast<MemRefType>(dst.getType());
-      if (srcType != dstType)
+      if (srcType != dstType) {
+        if (useMemcpy && lowerCopy(op))
+          op.erase();
         return WalkResult::skip();
+      }
       // supposed to work on memref.alloc
       auto srcOp = src.getDefiningOp<memref::AllocOp>();
       auto dstOp = dst.getDefiningOp<memref::AllocOp>();
-      if (!srcOp || !dstOp)
+      if (!srcOp || !dstOp) {
+        if (useMemcpy && lowerCopy(op))
+          op.erase();
         return WalkResult::skip();
+      }
       // check use of src after this copyOp, being conservative
       // FIXME: handle dealloc of src and dst
       bool hasSubsequentUse = false;
@@ -66,8 +164,13 @@ struct LowerMemRefCopy
 
       // replace copy with linalg.generic
       if (hasSubsequentUse) {
-        OpBuilder builder(op);
-        linalg::makeMemRefCopyOp(builder, op.getLoc(), src, dst);
+        if (useMemcpy) {
+          if (!lowerCopy(op))
+            return WalkResult::skip();
+        } else {
+          OpBuilder builder(op);
+          linalg::makeMemRefCopyOp(builder, op.getLoc(), src, dst);
+        }
       } else {
         // coalesce buffer
         dst.replaceAllUsesWith(src);
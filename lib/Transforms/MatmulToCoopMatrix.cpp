@@ -0,0 +1,247 @@
+//===- MatmulToCoopMatrix.cpp - MatmulToCoopMatrix Pass ---------*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file lowers linalg.matmul and linalg.batch_matmul on memrefs to
+/// parallel loops of cooperative matrix operations (gpu.subgroup_mma_*), one
+/// subgroup per tile of the result. imex-convert-gpu-to-spirv lowers them to
+/// SPV_KHR_cooperative_matrix ops, which run on the matrix engines.
+///
+//===----------------------------------------------------------------------===//
+
+#include <imex/Transforms/Passes.h>
+#include <imex/Utils/XeArch.h>
+
+#include <mlir/Dialect/Arith/IR/Arith.h>
+#include <mlir/Dialect/Func/IR/FuncOps.h>
+#include <mlir/Dialect/GPU/IR/GPUDialect.h>
+#include <mlir/Dialect/GPU/Transforms/ParallelLoopMapper.h>
+#include <mlir/Dialect/Linalg/IR/Linalg.h>
+#include <mlir/Dialect/MemRef/IR/MemRef.h>
+#include <mlir/Dialect/SCF/IR/SCF.h>
+#include <mlir/IR/AffineMap.h>
+#include <mlir/Pass/Pass.h>
+
+namespace imex {
+#define GEN_PASS_DEF_MATMULTOCOOPMATRIX
+#include "imex/Transforms/Passes.h.inc"
+} // namespace imex
+
+namespace {
+
+// Returns the distance between the rows of the two innermost dimensions of
+// \p type if it is static and the rows are contiguous.
+static std::optional<int64_t> getLeadDimension(mlir::MemRefType type) {
+  llvm::SmallVector<int64_t> strides;
+  int64_t offset;
+  if (mlir::failed(type.getStridesAndOffset(strides, offset)) ||
+      strides.back() != 1 ||
+      mlir::ShapedType::isDynamic(strides[strides.size() - 2]))
+    return std::nullopt;
+  return strides[strides.size() - 2];
+}
+
+// Returns whether \p op computes C += A * B, possibly batched along the
+// outermost dimension, without transposed or broadcast operands.
+static bool hasDefaultIndexingMaps(mlir::linalg::LinalgOp op, bool batched) {
+  auto *context = op.getContext();
+  unsigned b = batched ? 1 : 0;
+  unsigned m = b, n = b + 1, k = b + 2;
+  auto getMap = [&](unsigned d0, unsigned d1) {
+    llvm::SmallVector<unsigned> targets;
+    if (batched)
+      targets.push_back(0);
+    targets.append({d0, d1});
+    return mlir::AffineMap::getMultiDimMapWithTargets(k + 1, targets, context);
+  };
+  return op.getIndexingMapsArray() ==
+         llvm::SmallVector<mlir::AffineMap>{getMap(m, k), getMap(k, n),
+                                            getMap(m, n)};
+}
+
+struct MatmulToCoopMatrixPass final
+    : public imex::impl::MatmulToCoopMatrixBase<MatmulToCoopMatrixPass> {
+  using MatmulToCoopMatrixBase::MatmulToCoopMatrixBase;
+
+  void runOnOperation() override {
+    // Cooperative matrices are only fast on devices with DPAS units.
+    if (device.empty())
+      return;
+    auto func = getOperation();
+    auto arch = imex::getXeuArch(device);
+    if (!arch) {
+      func.emitError() << "Invalid device: " << device;
+      return signalPassFailure();
+    }
+    // The tiles must map to single f16 dpas instructions.
+    auto dpas = arch->getDPASConfig(16, 16, 32, 32);
+    if (tileM < 1 || tileM > dpas.m || tileN != dpas.n || tileK != dpas.k) {
+      func.emitError() << "Tiles " << tileM << "x" << tileN << "x" << tileK
+                       << " do not fit the dpas shape " << dpas.m << "x"
+                       << dpas.n << "x" << dpas.k << " of " << device;
+      return signalPassFailure();
+    }
+    subgroupSize = arch->getSubgroupSize();
+
+    llvm::SmallVector<mlir::linalg::LinalgOp> matmuls;
+    func.walk([&](mlir::linalg::LinalgOp op) {
+      if (mlir::isa<mlir::linalg::MatmulOp, mlir::linalg::BatchMatmulOp>(op))
+        matmuls.push_back(op);
+    });
+    for (auto op : matmuls)
+      (void)convert(op);
+  }
+
+private:
+  // Replaces \p op by a parallel loop over the tileM x tileN tiles of C,
+  // mapped to the workgroups, and batches mapped to the z dimension of the
+  // grid. Each workgroup is one subgroup, which accumulates the products of
+  // the tiles of A and B along K in a cooperative matrix.
+  mlir::LogicalResult convert(mlir::linalg::LinalgOp op) {
+    bool batched = mlir::isa<mlir::linalg::BatchMatmulOp>(op);
+    if (!op.hasPureBufferSemantics() || !hasDefaultIndexingMaps(op, batched))
+      return mlir::failure();
+
+    auto a = op.getDpsInputOperand(0)->get();
+    auto b = op.getDpsInputOperand(1)->get();
+    auto c = op.getDpsInitOperand(0)->get();
+    auto aTy = mlir::cast<mlir::MemRefType>(a.getType());
+    auto bTy = mlir::cast<mlir::MemRefType>(b.getType());
+    auto cTy = mlir::cast<mlir::MemRefType>(c.getType());
+    if (!aTy.hasStaticShape() || !bTy.hasStaticShape() ||
+        !cTy.hasStaticShape())
+      return mlir::failure();
+
+    // The matrix engines multiply f16 matrices into f16 or f32 accumulators.
+    if (!aTy.getElementType().isF16() || !bTy.getElementType().isF16() ||
+        !(cTy.getElementType().isF16() || cTy.getElementType().isF32()))
+      return mlir::failure();
+
+    auto aLead = getLeadDimension(aTy);
+    auto bLead = getLeadDimension(bTy);
+    auto cLead = getLeadDimension(cTy);
+    if (!aLead || !bLead || !cLead)
+      return mlir::failure();
+
+    auto rank = cTy.getRank();
+    int64_t sizeM = cTy.getDimSize(rank - 2);
+    int64_t sizeN = cTy.getDimSize(rank - 1);
+    int64_t sizeK = aTy.getDimSize(rank - 1);
+    if (sizeM % tileM || sizeN % tileN || sizeK % tileK)
+      return mlir::failure();
+
+    auto *context = op.getContext();
+    auto loc = op.getLoc();
+    mlir::OpBuilder builder(op);
+    auto getIndex = [&](int64_t value) -> mlir::Value {
+      return builder.create<mlir::arith::ConstantIndexOp>(loc, value);
+    };
+    auto c0 = getIndex(0);
+    auto c1 = getIndex(1);
+    auto cTileM = getIndex(tileM);
+    auto cTileN = getIndex(tileN);
+    auto cTileK = getIndex(tileK);
+    auto cSizeK = getIndex(sizeK);
+    auto cSubgroupSize = getIndex(subgroupSize);
+
+    auto aMatTy = mlir::gpu::MMAMatrixType::get({tileM, tileK},
+                                                aTy.getElementType(), "AOp");
+    auto bMatTy = mlir::gpu::MMAMatrixType::get({tileK, tileN},
+                                                bTy.getElementType(), "BOp");
+    auto cMatTy = mlir::gpu::MMAMatrixType::get({tileM, tileN},
+                                                cTy.getElementType(), "COp");
+
+    llvm::SmallVector<mlir::Value> ubs;
+    llvm::SmallVector<mlir::gpu::Processor> processors;
+    if (batched) {
+      ubs.push_back(getIndex(cTy.getDimSize(0)));
+      processors.push_back(mlir::gpu::Processor::BlockZ);
+    }
+    ubs.push_back(getIndex(sizeM / tileM));
+    ubs.push_back(getIndex(sizeN / tileN));
+    processors.push_back(mlir::gpu::Processor::BlockX);
+    processors.push_back(mlir::gpu::Processor::BlockY);
+    llvm::SmallVector<mlir::Value> lbs(ubs.size(), c0);
+    llvm::SmallVector<mlir::Value> steps(ubs.size(), c1);
+
+    auto getIndices = [&](mlir::ValueRange batch, mlir::Value row,
+                          mlir::Value col) {
+      llvm::SmallVector<mlir::Value> indices(batch.begin(), batch.end());
+      indices.append({row, col});
+      return indices;
+    };
+    auto buildTile = [&](mlir::OpBuilder &builder, mlir::Location loc,
+                         mlir::ValueRange ivs) {
+      auto batch = ivs.drop_back(2);
+      mlir::Value m = builder.create<mlir::arith::MulIOp>(
+          loc, ivs[ivs.size() - 2], cTileM);
+      mlir::Value n =
+          builder.create<mlir::arith::MulIOp>(loc, ivs.back(), cTileN);
+      mlir::Value acc = builder.create<mlir::gpu::SubgroupMmaLoadMatrixOp>(
+          loc, cMatTy, c, getIndices(batch, m, n),
+          builder.getIndexAttr(*cLead), mlir::UnitAttr());
+      auto loop = builder.create<mlir::scf::ForOp>(
+          loc, c0, cSizeK, cTileK, acc,
+          [&](mlir::OpBuilder &builder, mlir::Location loc, mlir::Value k,
+              mlir::ValueRange iterArgs) {
+            auto aMat = builder.create<mlir::gpu::SubgroupMmaLoadMatrixOp>(
+                loc, aMatTy, a, getIndices(batch, m, k),
+                builder.getIndexAttr(*aLead), mlir::UnitAttr());
+            auto bMat = builder.create<mlir::gpu::SubgroupMmaLoadMatrixOp>(
+                loc, bMatTy, b, getIndices(batch, k, n),
+                builder.getIndexAttr(*bLead), mlir::UnitAttr());
+            mlir::Value res = builder.create<mlir::gpu::SubgroupMmaComputeOp>(
+                loc, cMatTy, aMat, bMat, iterArgs[0], mlir::UnitAttr(),
+                mlir::UnitAttr());
+            builder.create<mlir::scf::YieldOp>(loc, res);
+          });
+      builder.create<mlir::gpu::SubgroupMmaStoreMatrixOp>(
+          loc, loop.getResult(0), c, getIndices(batch, m, n),
+          builder.getIndexAttr(*cLead), mlir::UnitAttr());
+    };
+
+    auto getMapping = [&](mlir::gpu::Processor processor) {
+      auto identity = builder.getDimIdentityMap();
+      return mlir::gpu::ParallelLoopDimMappingAttr::get(context, processor,
+                                                        identity, identity);
+    };
+
+    // The lanes of the subgroup are the threads of the workgroup, which all
+    // execute the cooperative matrix ops of the tile.
+    auto tiles = builder.create<mlir::scf::ParallelOp>(
+        loc, lbs, ubs, steps,
+        [&](mlir::OpBuilder &builder, mlir::Location loc,
+            mlir::ValueRange ivs) {
+          auto lanes = builder.create<mlir::scf::ParallelOp>(
+              loc, mlir::ValueRange{c0}, mlir::ValueRange{cSubgroupSize},
+              mlir::ValueRange{c1},
+              [&](mlir::OpBuilder &builder, mlir::Location loc,
+                  mlir::ValueRange) { buildTile(builder, loc, ivs); });
+          (void)mlir::gpu::setMappingAttr(
+              lanes, {getMapping(mlir::gpu::Processor::ThreadX)});
+        });
+    llvm::SmallVector<mlir::gpu::ParallelLoopDimMappingAttr> mapping;
+    for (auto processor : processors)
+      mapping.push_back(getMapping(processor));
+    (void)mlir::gpu::setMappingAttr(tiles, mapping);
+
+    op->erase();
+    return mlir::success();
+  }
+
+  int64_t subgroupSize = 0;
+};
+
+} // namespace
+
+namespace imex {
+std::unique_ptr<mlir::Pass> createMatmulToCoopMatrixPass() {
+  return std::make_unique<MatmulToCoopMatrixPass>();
+}
+} // namespace imex
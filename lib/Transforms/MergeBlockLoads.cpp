@@ -0,0 +1,313 @@
+//===-- MergeBlockLoads.cpp - MergeBlockLoads Pass  --------------*- C++-*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains MergeBlockLoads pass. 2D block loads of horizontally
+/// adjacent blocks of the same height and width are merged into one load
+/// with array_length, whose result is split back with vector.extract:
+///
+/// clang-format off
+///   %t0 = xegpu.create_nd_tdesc %src[%y, 0] : ... -> tensor_desc<8x16xf16>
+///   %t1 = xegpu.create_nd_tdesc %src[%y, 16] : ... -> tensor_desc<8x16xf16>
+///   %v0 = xegpu.load_nd %t0 : ... -> vector<8x16xf16>
+///   %v1 = xegpu.load_nd %t1 : ... -> vector<8x16xf16>
+/// clang-format on
+/// becomes:
+/// clang-format off
+///   %t = xegpu.create_nd_tdesc %src[%y, 0]
+///       : ... -> tensor_desc<8x16xf16, block_tdesc_attr<array_length = 2>>
+///   %v = xegpu.load_nd %t : ... -> vector<2x8x16xf16>
+///   %v0 = vector.extract %v[0] : vector<8x16xf16> from vector<2x8x16xf16>
+///   %v1 = vector.extract %v[1] : vector<8x16xf16> from vector<2x8x16xf16>
+/// clang-format on
+///
+//===----------------------------------------------------------------------===//
+
+#include "imex/Transforms/Passes.h"
+#include "imex/Utils/XeArch.h"
+#include "mlir/Dialect/Arith/IR/Arith.h"
+#include "mlir/Dialect/Utils/StaticValueUtils.h"
+#include "mlir/Dialect/Vector/IR/VectorOps.h"
+#include "mlir/Dialect/XeGPU/IR/XeGPU.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/Dominance.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/Interfaces/SideEffectInterfaces.h"
+#include "mlir/Pass/Pass.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/Debug.h"
+
+#include <algorithm>
+#include <memory>
+#include <optional>
+#include <utility>
+
+namespace imex {
+#define GEN_PASS_DEF_MERGEBLOCKLOADS
+#include "imex/Transforms/Passes.h.inc"
+} // namespace imex
+
+#define DEBUG_TYPE "imex-xegpu-merge-block-loads"
+
+using namespace mlir;
+
+namespace mergeblockloads {
+
+// Splits offset \p ofr into a base value, which is null for constant
+// offsets, and a constant added to it.
+static std::pair<Value, int64_t> splitOffset(OpFoldResult ofr) {
+  if (auto cst = getConstantIntValue(ofr))
+    return {Value(), *cst};
+  auto value = llvm::cast<Value>(ofr);
+  if (auto add = value.getDefiningOp<arith::AddIOp>()) {
+    if (auto cst = getConstantIntValue(add.getRhs()))
+      return {add.getLhs(), *cst};
+    if (auto cst = getConstantIntValue(add.getLhs()))
+      return {add.getRhs(), *cst};
+  }
+  return {value, 0};
+}
+
+// Returns the distance from offset \p lhs to offset \p rhs if it is a
+// constant, i.e. both offsets are the same base plus constants.
+static std::optional<int64_t> getDistance(OpFoldResult lhs, OpFoldResult rhs) {
+  auto [lhsBase, lhsCst] = splitOffset(lhs);
+  auto [rhsBase, rhsCst] = splitOffset(rhs);
+  if (lhsBase != rhsBase)
+    return std::nullopt;
+  return rhsCst - lhsCst;
+}
+
+// Returns true if \p load is a plain 2D block load of a single block from
+// global memory, described by a create_nd_tdesc op.
+static bool isCandidate(xegpu::LoadNdOp load) {
+  auto desc = load.getTensorDesc().getDefiningOp<xegpu::CreateNdDescOp>();
+  auto tdescTy = load.getTensorDescType();
+  if (!desc || tdescTy.getRank() != 2 || tdescTy.getArrayLength() != 1 ||
+      tdescTy.getMemorySpace() != xegpu::MemorySpace::Global)
+    return false;
+  if (load.getPacked().value_or(false) || load.getTranspose())
+    return false;
+  return load.getType() ==
+         VectorType::get(tdescTy.getShape(), tdescTy.getElementType());
+}
+
+// Returns the distance in columns from the block loaded by \p lhs to the
+// block loaded by \p rhs, if both loads read the same rows of the same
+// source with the same descriptor type and cache hints.
+static std::optional<int64_t> getColumnDistance(xegpu::LoadNdOp lhs,
+                                                xegpu::LoadNdOp rhs) {
+  if (lhs.getTensorDescType() != rhs.getTensorDescType() ||
+      lhs.getL1HintAttr() != rhs.getL1HintAttr() ||
+      lhs.getL2HintAttr() != rhs.getL2HintAttr() ||
+      lhs.getL3HintAttr() != rhs.getL3HintAttr())
+    return std::nullopt;
+  auto lhsDesc = lhs.getTensorDesc().getDefiningOp<xegpu::CreateNdDescOp>();
+  auto rhsDesc = rhs.getTensorDesc().getDefiningOp<xegpu::CreateNdDescOp>();
+  if (lhsDesc.getSource() != rhsDesc.getSource() ||
+      !isEqualConstantIntOrValueArray(lhsDesc.getMixedSizes(),
+                                      rhsDesc.getMixedSizes()) ||
+      !isEqualConstantIntOrValueArray(lhsDesc.getMixedStrides(),
+                                      rhsDesc.getMixedStrides()))
+    return std::nullopt;
+  auto lhsOffsets = lhsDesc.getMixedOffsets();
+  auto rhsOffsets = rhsDesc.getMixedOffsets();
+  if (lhsOffsets.size() != rhsOffsets.size() ||
+      !isEqualConstantIntOrValueArray(ArrayRef(lhsOffsets).drop_back(),
+                                      ArrayRef(rhsOffsets).drop_back()))
+    return std::nullopt;
+  return getDistance(lhsOffsets.back(), rhsOffsets.back());
+}
+
+// Returns true if \p op may write memory, so loads cannot be moved across it.
+static bool mayWriteMemory(Operation *op) {
+  if (isa<xegpu::LoadNdOp>(op))
+    return false;
+  auto iface = dyn_cast<MemoryEffectOpInterface>(op);
+  if (!iface)
+    return !op->hasTrait<OpTrait::HasRecursiveMemoryEffects>() ||
+           llvm::any_of(op->getRegions(), [](Region &region) {
+             return llvm::any_of(region.getOps(), mayWriteMemory);
+           });
+  return iface.hasEffect<MemoryEffects::Write>();
+}
+
+struct MergeBlockLoadsPass final
+    : public imex::impl::MergeBlockLoadsBase<MergeBlockLoadsPass> {
+  MergeBlockLoadsPass() {
+    uArchInterface = std::make_shared<imex::XePVCuArch>();
+  }
+  MergeBlockLoadsPass(const llvm::StringRef deviceName) {
+    uArchInterface = imex::getXeuArch(deviceName);
+  }
+  LogicalResult initializeOptions(
+      StringRef options,
+      function_ref<LogicalResult(const llvm::Twine &)> errorHandler) override {
+    if (failed(Pass::initializeOptions(options, errorHandler)))
+      return failure();
+    uArchInterface = imex::getXeuArch(device);
+    if (!uArchInterface)
+      return errorHandler(llvm::Twine("Invalid device: ") + device);
+    return success();
+  }
+
+  void runOnOperation() override {
+    llvm::SmallVector<Block *> blocks;
+    getOperation()->walk([&](Block *block) { blocks.push_back(block); });
+    auto &domInfo = getAnalysis<DominanceInfo>();
+    for (auto *block : blocks)
+      mergeLoads(block, domInfo);
+  }
+
+private:
+  std::shared_ptr<imex::XeuArchInterface> uArchInterface = nullptr;
+
+  void mergeLoads(Block *block, DominanceInfo &domInfo);
+  void mergeGroup(llvm::ArrayRef<xegpu::LoadNdOp> group,
+                  DominanceInfo &domInfo);
+  void mergeRun(llvm::ArrayRef<xegpu::LoadNdOp> run, DominanceInfo &domInfo);
+};
+
+// Groups the candidate loads of \p block that read the same rows and have no
+// write to memory in between, and merges the adjacent loads of each group.
+void MergeBlockLoadsPass::mergeLoads(Block *block, DominanceInfo &domInfo) {
+  llvm::SmallVector<llvm::SmallVector<xegpu::LoadNdOp>> groups;
+  auto flush = [&]() {
+    for (auto &group : groups)
+      if (group.size() > 1)
+        mergeGroup(group, domInfo);
+    groups.clear();
+  };
+
+  for (auto &op : llvm::make_early_inc_range(*block)) {
+    auto load = dyn_cast<xegpu::LoadNdOp>(op);
+    if (!load) {
+      if (mayWriteMemory(&op))
+        flush();
+      continue;
+    }
+    if (!isCandidate(load))
+      continue;
+    auto it = llvm::find_if(groups, [&](auto &group) {
+      return getColumnDistance(group.front(), load).has_value();
+    });
+    if (it != groups.end())
+      it->push_back(load);
+    else
+      groups.push_back({load});
+  }
+  flush();
+}
+
+// Sorts the loads of \p group by column and merges each run of adjacent
+// blocks.
+void MergeBlockLoadsPass::mergeGroup(llvm::ArrayRef<xegpu::LoadNdOp> group,
+                                     DominanceInfo &domInfo) {
+  llvm::SmallVector<std::pair<int64_t, xegpu::LoadNdOp>> loads;
+  for (auto load : group)
+    loads.push_back({*getColumnDistance(group.front(), load), load});
+  llvm::stable_sort(loads, [](auto &lhs, auto &rhs) {
+    return lhs.first < rhs.first;
+  });
+
+  auto width = group.front().getTensorDescType().getShape()[1];
+  llvm::SmallVector<xegpu::LoadNdOp> run;
+  for (size_t i = 0; i < loads.size(); ++i) {
+    if (!run.empty() && loads[i].first != loads[i - 1].first + width) {
+      mergeRun(run, domInfo);
+      run.clear();
+    }
+    run.push_back(loads[i].second);
+  }
+  mergeRun(run, domInfo);
+}
+
+// Merges the loads of \p run, ordered by column, into loads with the largest
+// array length supported by the hardware.
+void MergeBlockLoadsPass::mergeRun(llvm::ArrayRef<xegpu::LoadNdOp> run,
+                                   DominanceInfo &domInfo) {
+  if (run.size() < 2)
+    return;
+  auto tdescTy = run.front().getTensorDescType();
+  auto elemTy = tdescTy.getElementType();
+  auto elemBitWidth = elemTy.getIntOrFloatBitWidth();
+  auto config = uArchInterface->get2DLoadConfig(run.front(), elemBitWidth,
+                                                /*vnni=*/false,
+                                                /*transpose=*/false);
+  if (failed(config))
+    return;
+
+  auto height = tdescTy.getShape()[0];
+  auto width = tdescTy.getShape()[1];
+  auto isLegalArrayLength = [&](int arrayLength) {
+    return arrayLength > 1 && width * arrayLength <= config->restriction &&
+           height * width * arrayLength * elemBitWidth / 8 <=
+               config->GRFDataSize.load;
+  };
+
+  for (size_t begin = 0; begin < run.size();) {
+    int arrayLength = 1;
+    for (auto length : config->array_length)
+      if (length <= static_cast<int>(run.size() - begin) &&
+          isLegalArrayLength(length))
+        arrayLength = std::max(arrayLength, length);
+    if (arrayLength == 1) {
+      ++begin;
+      continue;
+    }
+    auto loads = run.slice(begin, arrayLength);
+    begin += arrayLength;
+
+    // The merged load is placed at the first of the loads, so all
+    // descriptors must be defined before it.
+    auto first = *std::min_element(
+        loads.begin(), loads.end(), [](auto lhs, auto rhs) {
+          return lhs->isBeforeInBlock(rhs);
+        });
+    if (!llvm::all_of(loads, [&](xegpu::LoadNdOp load) {
+          return domInfo.properlyDominates(load.getTensorDesc(), first);
+        }))
+      continue;
+
+    LLVM_DEBUG(llvm::dbgs() << "Merging " << arrayLength << " loads at "
+                            << first << "\n");
+
+    OpBuilder builder(first);
+    auto loc = first.getLoc();
+    auto leader = loads.front();
+    auto desc = cast<xegpu::CreateNdDescOp>(
+        builder.clone(*leader.getTensorDesc().getDefiningOp()));
+    desc.getResult().setType(xegpu::TensorDescType::get(
+        tdescTy.getShape(), elemTy, arrayLength, tdescTy.getBoundaryCheck(),
+        tdescTy.getMemorySpace(), tdescTy.getSgMap()));
+    auto loadTy = VectorType::get({arrayLength, height, width}, elemTy);
+    auto merged = builder.create<xegpu::LoadNdOp>(
+        loc, loadTy, desc, leader.getPackedAttr(), leader.getTransposeAttr(),
+        leader.getTransposeBitWidthAttr(), leader.getL1HintAttr(),
+        leader.getL2HintAttr(), leader.getL3HintAttr());
+
+    for (auto [i, load] : llvm::enumerate(loads)) {
+      auto block = builder.create<vector::ExtractOp>(
+          load.getLoc(), merged, static_cast<int64_t>(i));
+      auto oldDesc = load.getTensorDesc().getDefiningOp();
+      load.getResult().replaceAllUsesWith(block.getResult());
+      load.erase();
+      if (oldDesc->use_empty())
+        oldDesc->erase();
+    }
+  }
+}
+
+} // namespace mergeblockloads
+
+std::unique_ptr<Pass>
+imex::createMergeBlockLoadsPass(const std::string &deviceName) {
+  return std::make_unique<mergeblockloads::MergeBlockLoadsPass>(deviceName);
+}
@@ -12,6 +12,7 @@
 ///
 //===----------------------------------------------------------------------===//
 
+#include "imex/Utils/Remarks.h"
 #include "imex/Utils/XeArch.h"
 #include "imex/Utils/XeCommon.h"
 #include "mlir/Dialect/Arith/IR/Arith.h"
@@ -116,6 +117,55 @@ struct PackedLayoutOpsMatcher : public PatternMatcherInterface {
   }
 };
 
+// Pattern for detecting packed layouts for DPAS B of slices of a low-precision
+// transpose result, e.g., when the transposed tile covers multiple DPAS B
+// tiles. All users of the transpose must be 2D unit-stride slices whose rows
+// start and end at multiples of the VNNI factor, each followed by the packed
+// layout op sequence:
+// clang-format off
+// %0 = vector.transpose %in
+// %1 = vector.extract_strided_slice %0
+// %2 = vector.shape_cast %1 {packed}
+// %3 = vector.shuffle %2, %2, %mask {packed}
+// %4 = vector.shape_cast %3 {packed}
+// clang-format on
+// The ops vector is updated with the slice followed by its packed layout ops,
+// for every slice.
+static bool matchSlicedPackedLayoutOps(
+    vector::TransposeOp transposeOp,
+    llvm::SmallVectorImpl<llvm::SmallVector<Operation *>> &slices) {
+  auto elemTy = transposeOp.getResultVectorType().getElementType();
+  if (!elemTy.isIntOrFloat() || elemTy.getIntOrFloatBitWidth() >= 32 ||
+      transposeOp.use_empty())
+    return false;
+  int64_t factor = 32 / elemTy.getIntOrFloatBitWidth();
+  llvm::SmallVector<llvm::SmallVector<Operation *>> found;
+  for (auto user : transposeOp->getUsers()) {
+    auto sliceOp = llvm::dyn_cast<vector::ExtractStridedSliceOp>(user);
+    if (!sliceOp || !sliceOp->hasOneUse() ||
+        sliceOp.getSourceVectorType().getRank() != 2)
+      return false;
+    auto offsets = llvm::to_vector(
+        sliceOp.getOffsets().getAsValueRange<IntegerAttr>());
+    auto sizes =
+        llvm::to_vector(sliceOp.getSizes().getAsValueRange<IntegerAttr>());
+    auto strides =
+        llvm::to_vector(sliceOp.getStrides().getAsValueRange<IntegerAttr>());
+    if (offsets.size() != 2 || sizes.size() != 2 ||
+        offsets[0].getSExtValue() % factor != 0 ||
+        sizes[0].getSExtValue() % factor != 0 ||
+        llvm::any_of(strides, [](const APInt &s) { return s != 1; }))
+      return false;
+    llvm::SmallVector<Operation *> ops({sliceOp});
+    PackedLayoutOpsMatcher patternMatcher;
+    if (!patternMatcher.match(*sliceOp->user_begin(), ops))
+      return false;
+    found.push_back(ops);
+  }
+  slices.append(found.begin(), found.end());
+  return true;
+}
+
 // Analysis to find LoadNd ops with DPAS B usage.
 struct LoadTransposeAnalysis {
 private:
@@ -211,8 +261,10 @@ private:
     // Check for packed layout pattern. shape_cast -> shuffle -> shape_cast.
     // Otherwise, skip.
     llvm::SmallVector<Operation *> packedLayoutOps;
+    llvm::SmallVector<llvm::SmallVector<Operation *>> slices;
     PackedLayoutOpsMatcher patternMatcher;
-    if (!patternMatcher.match(*transposeOp->user_begin(), packedLayoutOps))
+    if (!patternMatcher.match(*transposeOp->user_begin(), packedLayoutOps) &&
+        !matchSlicedPackedLayoutOps(transposeOp, slices))
       return;
 
     llvm::DenseSet<Operation *> worklist;
@@ -670,11 +722,21 @@ struct UpdateNdOffsetOpPattern final
 // clang-format on
 struct TransposeRewritePattern : public OpRewritePattern<vector::TransposeOp> {
   TransposeRewritePattern(MLIRContext *context, LoadTransposeAnalysis &analysis,
-                          std::shared_ptr<imex::XeuArchInterface> ptruArch)
+                          std::shared_ptr<imex::XeuArchInterface> ptruArch,
+                          llvm::DenseMap<Operation *, StringRef> &missed)
       : OpRewritePattern<vector::TransposeOp>(context), analysis(analysis),
-        uArchInterface(ptruArch) {}
+        uArchInterface(ptruArch), missedFusions(missed) {}
   LoadTransposeAnalysis &analysis;
   std::shared_ptr<imex::XeuArchInterface> uArchInterface;
+  // The reason each transpose of a load is not fused with it at the last
+  // attempt.
+  llvm::DenseMap<Operation *, StringRef> &missedFusions;
+
+  LogicalResult giveUp(vector::TransposeOp op, StringRef reason,
+                       PatternRewriter &rewriter) const {
+    missedFusions[op] = reason;
+    return rewriter.notifyMatchFailure(op, reason);
+  }
 
   // Check if the target HW allows doing the load+transpose together.
   bool canTranspose(xegpu::LoadNdOp loadOp,
@@ -733,8 +795,8 @@ struct TransposeRewritePattern : public OpRewritePattern<vector::TransposeOp> {
       // limite the total data size <= 512 bytes, which is maximum size
       // can be handled by a single load/store lsc intrinsic.
       if (bytes > 512)
-        return rewriter.notifyMatchFailure(
-            op, "total data size is larger than 512 bytes.");
+        return giveUp(op, "total data size is larger than 512 bytes.",
+                      rewriter);
 
       // Element type for SLM, all operations to slm are done in 32-bit
       // or 64-bit granularity.
@@ -758,7 +820,8 @@ struct TransposeRewritePattern : public OpRewritePattern<vector::TransposeOp> {
       auto validChunkSizes = imex::getSupportedChunkSizes(simdLanes);
       if (numElems % simdLanes != 0 ||
           !llvm::is_contained(validChunkSizes, chunkSize))
-        return failure();
+        return giveUp(op, "no supported chunk size for the SLM transpose.",
+                      rewriter);
 
       auto loc = loadOp.getLoc();
       auto data = loadOp.getResult();
@@ -799,31 +862,34 @@ struct TransposeRewritePattern : public OpRewritePattern<vector::TransposeOp> {
       // load.
       auto result = createBlockLoad(slm, offset, numElems, elemTy, opElementTy,
                                     opVectorType.getShape(), rewriter);
+      missedFusions.erase(op);
       rewriter.replaceOp(op, result);
       return success();
     }
 
     // trying to optimize the load+transpose+dpasB sequence.
 
-    // Check if the transpose has a single user and it has desired packed
-    // layout conversion op sequence.
-    if (!op->hasOneUse())
-      return failure();
-
     // If the element type if < 32 bits, we need to clean up the packed layout
     // conversion op sequence.
     if (opElementTy.getIntOrFloatBitWidth() < 32) {
       // Check if the HW can support the load+transpose together.
       // TODO: add support for NON_PACKED usage for low-precsion.
       if (!canTranspose(loadOp, TransposeUsageType::PACKED))
-        return failure();
+        return giveUp(op, "transposed load not supported by the device.",
+                      rewriter);
 
-      // Check for packed layout conversion op sequence.
+      // Check for packed layout conversion op sequence, either as the single
+      // user of the transpose or following each slice of the transpose, e.g.,
+      // when the transposed tile covers multiple DPAS B tiles.
+      llvm::SmallVector<llvm::SmallVector<Operation *>> slices;
       llvm::SmallVector<Operation *> packedLayoutOps;
       PackedLayoutOpsMatcher patternMatcher;
-      if (!patternMatcher.match(*op->user_begin(), packedLayoutOps)) {
-        return failure();
-      }
+      if (op->hasOneUse() &&
+          patternMatcher.match(*op->user_begin(), packedLayoutOps))
+        slices.push_back(packedLayoutOps);
+      else if (!matchSlicedPackedLayoutOps(op, slices))
+        return giveUp(op, "not used by a packed layout conversion.",
+                      rewriter);
 
       auto factor = 32 / opElementTy.getIntOrFloatBitWidth();
       // New output type has the transposed packed layout.
@@ -841,19 +907,42 @@ struct TransposeRewritePattern : public OpRewritePattern<vector::TransposeOp> {
           loadOp.getLoc(), newVectorTy, loadOp.getTensorDesc(), packedAttr,
           transposeAttr, transposeBitWidthAttr, loadOp.getL1HintAttr(),
           loadOp.getL2HintAttr(), loadOp.getL3HintAttr());
-      // Replace the uses of the packed layout conversion with new load.
-      rewriter.replaceAllUsesWith(packedLayoutOps.back()->getResult(0),
-                                  newLoadOp.getResult());
-      // Remove the packed layout conversion op sequence in reverse order.
-      for (auto packeLayoutOp : llvm::reverse(packedLayoutOps))
-        rewriter.eraseOp(packeLayoutOp);
+      for (auto &ops : slices) {
+        // Slices of the transpose become slices of the packed layout of the
+        // new load, with the rows divided by the vnni factor.
+        Value packed = newLoadOp.getResult();
+        if (auto sliceOp =
+                llvm::dyn_cast<vector::ExtractStridedSliceOp>(ops.front())) {
+          auto offsets = llvm::to_vector(
+              sliceOp.getOffsets().getAsValueRange<IntegerAttr>());
+          auto sizes = llvm::to_vector(
+              sliceOp.getSizes().getAsValueRange<IntegerAttr>());
+          rewriter.setInsertionPoint(sliceOp);
+          packed = rewriter.create<vector::ExtractStridedSliceOp>(
+              sliceOp.getLoc(), packed,
+              llvm::ArrayRef<int64_t>{offsets[0].getSExtValue() / factor,
+                                      offsets[1].getSExtValue(), 0},
+              llvm::ArrayRef<int64_t>{sizes[0].getSExtValue() / factor,
+                                      sizes[1].getSExtValue(), factor},
+              llvm::ArrayRef<int64_t>{1, 1, 1});
+        }
+        // Replace the uses of the packed layout conversion with new load.
+        rewriter.replaceAllUsesWith(ops.back()->getResult(0), packed);
+        // Remove the packed layout conversion op sequence in reverse order.
+        for (auto packeLayoutOp : llvm::reverse(ops))
+          rewriter.eraseOp(packeLayoutOp);
+      }
     }
     // If the element type is >= 32 bits, we can directly replace the
     // transpose.
     else {
+      // Check if the transpose has a single user.
+      if (!op->hasOneUse())
+        return giveUp(op, "transpose has multiple users.", rewriter);
       // Check if the HW can support the load+transpose together.
       if (!canTranspose(loadOp, TransposeUsageType::NON_PACKED))
-        return failure();
+        return giveUp(op, "transposed load not supported by the device.",
+                      rewriter);
       // New output type has the transposed shape.
       auto newVectorTy = VectorType::get(
           {opVectorType.getDimSize(0), opVectorType.getDimSize(1)},
@@ -869,6 +958,7 @@ struct TransposeRewritePattern : public OpRewritePattern<vector::TransposeOp> {
     }
 
     // Transpose op is dead. We can remove it.
+    missedFusions.erase(op);
     rewriter.eraseOp(op);
     // At this point, original load op is dead. We can remove it.
     if (loadOp->use_empty())
@@ -950,11 +1040,23 @@ private:
     config.enableRegionSimplification = GreedySimplifyRegionLevel::Disabled;
     config.useTopDownTraversal = true;
     config.strictMode = GreedyRewriteStrictness::ExistingAndNewOps;
-    patterns.add<TransposeRewritePattern>(context, analysis, uArchInterface);
+    llvm::DenseMap<Operation *, StringRef> missedFusions;
+    patterns.add<TransposeRewritePattern>(context, analysis, uArchInterface,
+                                          missedFusions);
     if (failed(applyPatternsGreedily(getOperation(), std::move(patterns),
                                      config))) {
       return signalPassFailure();
     }
+
+    imex::MissedOptRemarks missedOpts(getArgument(), remarks);
+    if (!missedOpts.isEnabled())
+      return;
+    getOperation()->walk([&](vector::TransposeOp op) {
+      auto it = missedFusions.find(op);
+      if (it != missedFusions.end())
+        missedOpts.emit(op, "UnfusedTranspose",
+                        "not fused with the load: " + it->second);
+    });
   }
 
 public:
@@ -975,18 +1077,15 @@ public:
     uArchInterface = std::make_shared<imex::XePVCuArch>();
   }
   OptimizeTransposePass(const llvm::StringRef deviceName) {
-    if (deviceName == "pvc") {
-      uArchInterface = std::make_shared<imex::XePVCuArch>();
-    }
+    uArchInterface = imex::getXeuArch(deviceName);
   }
   LogicalResult initializeOptions(
       StringRef options,
       function_ref<LogicalResult(const llvm::Twine &)> errorHandler) override {
     if (failed(Pass::initializeOptions(options, errorHandler)))
       return failure();
-    if (device == "pvc")
-      uArchInterface = std::make_shared<imex::XePVCuArch>();
-    else
+    uArchInterface = imex::getXeuArch(device);
+    if (!uArchInterface)
       return errorHandler(llvm::Twine("Invalid device: ") + device);
     return success();
   }
@@ -0,0 +1,236 @@
+//===- PackGPUAllocs.cpp - PackGPUAllocs Pass  -----------*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file packs the statically shaped gpu.allocs of a function into arenas.
+/// The live range of each buffer spans from its gpu.alloc to the last use of
+/// the buffer or one of its views in the function body. Buffers are assigned
+/// offsets in the arena first-fit by decreasing size, such that buffers with
+/// overlapping live ranges never overlap in memory. Each gpu.alloc is then
+/// replaced by a memref.view into the arena, and its gpu.dealloc is removed.
+///
+//===----------------------------------------------------------------------===//
+
+#include <imex/Transforms/Passes.h>
+
+#include <mlir/Dialect/Arith/IR/Arith.h>
+#include <mlir/Dialect/Func/IR/FuncOps.h>
+#include <mlir/Dialect/GPU/IR/GPUDialect.h>
+#include <mlir/Dialect/MemRef/IR/MemRef.h>
+#include <mlir/Interfaces/ViewLikeInterface.h>
+#include <mlir/Pass/Pass.h>
+
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Support/MathExtras.h>
+
+#include <algorithm>
+#include <optional>
+
+namespace imex {
+#define GEN_PASS_DEF_PACKGPUALLOCS
+#include "imex/Transforms/Passes.h.inc"
+} // namespace imex
+
+namespace {
+
+// A gpu.alloc that can be placed in an arena.
+struct Buffer {
+  mlir::gpu::AllocOp alloc;
+  llvm::SmallVector<mlir::gpu::DeallocOp> deallocs;
+  // Positions of the first and last op of the live range in the block.
+  unsigned begin;
+  unsigned end;
+  uint64_t size;
+  uint64_t offset = 0;
+};
+
+// Returns the size in bytes of the buffer allocated by \p alloc, if it is
+// statically known and the buffer can be viewed from an i8 arena.
+static std::optional<uint64_t> getStaticSize(mlir::gpu::AllocOp alloc) {
+  auto type = alloc.getType();
+  if (alloc.getAsyncToken() || !alloc.getAsyncDependencies().empty() ||
+      !alloc.getDynamicSizes().empty() || !alloc.getSymbolOperands().empty() ||
+      !type.hasStaticShape() || !type.getLayout().isIdentity() ||
+      type.getMemorySpace() || !type.getElementType().isIntOrFloat())
+    return std::nullopt;
+  auto bitWidth = type.getElementTypeBitWidth();
+  if (bitWidth % 8)
+    return std::nullopt;
+  return type.getNumElements() * (bitWidth / 8);
+}
+
+// Computes the position of the last op in \p block using \p value or one of
+// its views, and collects the deallocs of \p value. Returns std::nullopt if
+// the value escapes, e.g. it is returned or yielded.
+static std::optional<unsigned>
+getLastUse(mlir::Value value, mlir::Block &block,
+           const llvm::DenseMap<mlir::Operation *, unsigned> &positions,
+           llvm::SmallVectorImpl<mlir::gpu::DeallocOp> &deallocs) {
+  unsigned last = 0;
+  llvm::SmallVector<mlir::Value> worklist{value};
+  while (!worklist.empty()) {
+    auto current = worklist.pop_back_val();
+    for (auto *user : current.getUsers()) {
+      if (auto dealloc = llvm::dyn_cast<mlir::gpu::DeallocOp>(user)) {
+        if (dealloc->getBlock() != &block || dealloc.getAsyncToken())
+          return std::nullopt;
+        deallocs.push_back(dealloc);
+        continue;
+      }
+      if (user->hasTrait<mlir::OpTrait::IsTerminator>())
+        return std::nullopt;
+      auto *ancestor = block.findAncestorOpInBlock(*user);
+      if (!ancestor)
+        return std::nullopt;
+      last = std::max(last, positions.lookup(ancestor));
+      if (auto view = llvm::dyn_cast<mlir::ViewLikeOpInterface>(user))
+        if (view.getViewSource() == current)
+          worklist.push_back(view->getResult(0));
+    }
+  }
+  return last;
+}
+
+class PackGPUAllocsPass final
+    : public imex::impl::PackGPUAllocsBase<PackGPUAllocsPass> {
+public:
+  using PackGPUAllocsBase::PackGPUAllocsBase;
+
+  void runOnOperation() override {
+    auto func = getOperation();
+    if (func.getBody().empty())
+      return;
+    // Asynchronous gpu ops may use the buffers after their last use in
+    // program order.
+    bool isAsync = false;
+    func.walk([&](mlir::gpu::AsyncOpInterface op) {
+      if (op.getAsyncToken())
+        isAsync = true;
+    });
+    if (isAsync)
+      return;
+
+    for (auto &block : func.getBody())
+      packBlock(block);
+  }
+
+private:
+  void packBlock(mlir::Block &block) {
+    llvm::DenseMap<mlir::Operation *, unsigned> positions;
+    for (auto [idx, op] : llvm::enumerate(block))
+      positions[&op] = idx;
+
+    // Device and host shared buffers go to separate arenas.
+    llvm::SmallVector<Buffer> groups[2];
+    for (auto &op : block) {
+      auto alloc = llvm::dyn_cast<mlir::gpu::AllocOp>(op);
+      if (!alloc)
+        continue;
+      auto size = getStaticSize(alloc);
+      if (!size || *size == 0)
+        continue;
+      Buffer buffer{alloc, {}, positions[alloc], 0, *size};
+      auto last = getLastUse(alloc.getMemref(), block, positions,
+                             buffer.deallocs);
+      if (!last || buffer.deallocs.empty())
+        continue;
+      buffer.end = std::max(*last, buffer.begin);
+      groups[alloc.getHostShared()].push_back(std::move(buffer));
+    }
+
+    for (auto &buffers : groups)
+      if (buffers.size() > 1)
+        packBuffers(buffers);
+  }
+
+  // Assigns offsets to \p buffers and rewrites them as views of an arena.
+  void packBuffers(llvm::MutableArrayRef<Buffer> buffers) {
+    uint64_t align = std::max<uint64_t>(alignment, 1);
+    llvm::SmallVector<Buffer *> order;
+    for (auto &buffer : buffers)
+      order.push_back(&buffer);
+    llvm::stable_sort(order, [](const Buffer *lhs, const Buffer *rhs) {
+      return lhs->size > rhs->size;
+    });
+
+    uint64_t arenaSize = 0;
+    llvm::SmallVector<Buffer *> placed;
+    for (auto *buffer : order) {
+      // The memory ranges of placed buffers live at the same time, sorted by
+      // offset.
+      llvm::SmallVector<Buffer *> conflicts;
+      for (auto *other : placed)
+        if (other->begin <= buffer->end && buffer->begin <= other->end)
+          conflicts.push_back(other);
+      llvm::sort(conflicts, [](const Buffer *lhs, const Buffer *rhs) {
+        return lhs->offset < rhs->offset;
+      });
+      uint64_t offset = 0;
+      for (auto *other : conflicts) {
+        if (offset + buffer->size <= other->offset)
+          break;
+        offset = std::max(
+            offset, llvm::alignTo(other->offset + other->size, align));
+      }
+      buffer->offset = offset;
+      arenaSize = std::max(arenaSize, offset + buffer->size);
+      placed.push_back(buffer);
+    }
+
+    uint64_t totalSize = 0;
+    for (auto &buffer : buffers)
+      totalSize += llvm::alignTo(buffer.size, align);
+    if (arenaSize >= totalSize)
+      return;
+
+    auto first = llvm::min_element(buffers, [](auto &lhs, auto &rhs) {
+      return lhs.begin < rhs.begin;
+    });
+    auto firstAlloc = first->alloc;
+    auto loc = firstAlloc.getLoc();
+    mlir::OpBuilder builder(firstAlloc);
+    auto arenaType = mlir::MemRefType::get(
+        {static_cast<int64_t>(arenaSize)}, builder.getI8Type());
+    auto arena = builder.create<mlir::gpu::AllocOp>(
+        loc, arenaType, /*asyncToken*/ nullptr,
+        /*asyncDependencies*/ std::nullopt, /*dynamicSizes*/ std::nullopt,
+        /*symbolOperands*/ std::nullopt, firstAlloc.getHostShared());
+
+    mlir::Operation *lastDealloc = nullptr;
+    for (auto &buffer : buffers) {
+      builder.setInsertionPoint(buffer.alloc);
+      auto offset = builder.create<mlir::arith::ConstantIndexOp>(
+          buffer.alloc.getLoc(), buffer.offset);
+      auto view = builder.create<mlir::memref::ViewOp>(
+          buffer.alloc.getLoc(), buffer.alloc.getType(), arena.getMemref(),
+          offset, mlir::ValueRange());
+      buffer.alloc.getMemref().replaceAllUsesWith(view);
+      buffer.alloc.erase();
+      for (auto dealloc : buffer.deallocs) {
+        if (!lastDealloc || lastDealloc->isBeforeInBlock(dealloc))
+          lastDealloc = dealloc;
+      }
+    }
+    builder.setInsertionPoint(lastDealloc);
+    builder.create<mlir::gpu::DeallocOp>(lastDealloc->getLoc(), std::nullopt,
+                                         arena.getMemref());
+    for (auto &buffer : buffers)
+      for (auto dealloc : buffer.deallocs)
+        dealloc.erase();
+  }
+};
+} // namespace
+
+namespace imex {
+std::unique_ptr<mlir::Pass> createPackGPUAllocsPass() {
+  return std::make_unique<PackGPUAllocsPass>();
+}
+} // namespace imex
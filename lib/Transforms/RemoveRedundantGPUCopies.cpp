@@ -0,0 +1,181 @@
+//===- RemoveRedundantGPUCopies.cpp - RemoveRedundantGPUCopies Pass -------===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file removes memref.copy and gpu.memcpy ops between host and device
+/// buffers whose destination already holds the data of the source. After a
+/// copy, the source and destination are in sync until one of them may be
+/// written; copying between buffers in sync is redundant. Copies from device
+/// buffers are also sunk to the first op accessing one of the buffers, such
+/// that chains of kernels keep the data on the device and the download
+/// followed by an upload of the same data is removed.
+///
+//===----------------------------------------------------------------------===//
+
+#include <imex/Transforms/Passes.h>
+
+#include <mlir/Analysis/AliasAnalysis.h>
+#include <mlir/Dialect/Func/IR/FuncOps.h>
+#include <mlir/Dialect/GPU/IR/GPUDialect.h>
+#include <mlir/Dialect/MemRef/IR/MemRef.h>
+#include <mlir/Interfaces/SideEffectInterfaces.h>
+#include <mlir/Interfaces/ViewLikeInterface.h>
+#include <mlir/Pass/Pass.h>
+
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/SmallVector.h>
+
+#include <optional>
+#include <utility>
+
+namespace imex {
+#define GEN_PASS_DEF_REMOVEREDUNDANTGPUCOPIES
+#include "imex/Transforms/Passes.h.inc"
+} // namespace imex
+
+namespace {
+
+// Returns the source and target of a synchronous copy op.
+static std::optional<std::pair<mlir::Value, mlir::Value>>
+getCopyOperands(mlir::Operation *op) {
+  if (auto copy = llvm::dyn_cast<mlir::memref::CopyOp>(op))
+    return std::make_pair(copy.getSource(), copy.getTarget());
+  if (auto memcpy = llvm::dyn_cast<mlir::gpu::MemcpyOp>(op))
+    if (!memcpy.getAsyncToken() && memcpy.getAsyncDependencies().empty())
+      return std::make_pair(memcpy.getSrc(), memcpy.getDst());
+  return std::nullopt;
+}
+
+// Returns true if \p value is a view of a buffer allocated on the device.
+static bool isDeviceBuffer(mlir::Value value) {
+  while (auto view = value.getDefiningOp<mlir::ViewLikeOpInterface>())
+    value = view.getViewSource();
+  auto alloc = value.getDefiningOp<mlir::gpu::AllocOp>();
+  return alloc && !alloc.getHostShared();
+}
+
+class RemoveRedundantGPUCopiesPass final
+    : public imex::impl::RemoveRedundantGPUCopiesBase<
+          RemoveRedundantGPUCopiesPass> {
+public:
+  void runOnOperation() override {
+    aliasAnalysis = &getAnalysis<mlir::AliasAnalysis>();
+    llvm::SmallVector<mlir::Block *> blocks;
+    getOperation().walk([&](mlir::Block *block) { blocks.push_back(block); });
+    for (auto *block : blocks) {
+      bool changed = true;
+      while (changed) {
+        changed = sinkDeviceCopies(*block);
+        changed |= removeRedundantCopies(*block);
+      }
+    }
+  }
+
+private:
+  // Returns true if \p op may read (if \p writeOnly is false) or write the
+  // memory of \p buffer.
+  bool mayAccess(mlir::Operation *op, mlir::Value buffer, bool writeOnly) {
+    auto aliases = [&](mlir::Value value) {
+      return !aliasAnalysis->alias(value, buffer).isNo();
+    };
+    // Kernels access the buffers passed to them only.
+    if (auto launch = llvm::dyn_cast<mlir::gpu::LaunchFuncOp>(op))
+      return llvm::any_of(launch.getKernelOperands(), [&](mlir::Value operand) {
+        return mlir::isa<mlir::MemRefType>(operand.getType()) &&
+               aliases(operand);
+      });
+    if (auto effectOp = llvm::dyn_cast<mlir::MemoryEffectOpInterface>(op)) {
+      llvm::SmallVector<mlir::MemoryEffects::EffectInstance> effects;
+      effectOp.getEffects(effects);
+      for (auto &effect : effects) {
+        if (mlir::isa<mlir::MemoryEffects::Allocate>(effect.getEffect()) ||
+            (writeOnly &&
+             mlir::isa<mlir::MemoryEffects::Read>(effect.getEffect())))
+          continue;
+        if (!effect.getValue() || aliases(effect.getValue()))
+          return true;
+      }
+      if (!op->hasTrait<mlir::OpTrait::HasRecursiveMemoryEffects>())
+        return false;
+    } else if (!op->hasTrait<mlir::OpTrait::HasRecursiveMemoryEffects>()) {
+      // The effects of the op are unknown.
+      return true;
+    }
+    for (auto &region : op->getRegions())
+      for (auto &nested : region.getOps())
+        if (mayAccess(&nested, buffer, writeOnly))
+          return true;
+    return false;
+  }
+
+  // Returns true if \p op is a copy from a device buffer, which is sunk.
+  static bool isSinkableCopy(mlir::Operation *op) {
+    auto operands = getCopyOperands(op);
+    return operands && isDeviceBuffer(operands->first);
+  }
+
+  // Moves copies from device buffers down to the first op accessing one of
+  // the buffers, or writing the source. Copies are not sunk past each other,
+  // independent downloads would otherwise keep trading places.
+  bool sinkDeviceCopies(mlir::Block &block) {
+    bool changed = false;
+    for (auto &op : llvm::make_early_inc_range(llvm::reverse(block))) {
+      if (!isSinkableCopy(&op))
+        continue;
+      auto [source, target] = *getCopyOperands(&op);
+      mlir::Operation *next = op.getNextNode();
+      while (next && !next->hasTrait<mlir::OpTrait::IsTerminator>() &&
+             !isSinkableCopy(next) &&
+             !mayAccess(next, source, /*writeOnly=*/true) &&
+             !mayAccess(next, target, /*writeOnly=*/false))
+        next = next->getNextNode();
+      if (next && next != op.getNextNode()) {
+        op.moveBefore(next);
+        changed = true;
+      }
+    }
+    return changed;
+  }
+
+  // Removes copies between buffers that are in sync.
+  bool removeRedundantCopies(mlir::Block &block) {
+    bool changed = false;
+    llvm::SmallVector<std::pair<mlir::Value, mlir::Value>> inSync;
+    for (auto &op : llvm::make_early_inc_range(block)) {
+      auto operands = getCopyOperands(&op);
+      if (operands) {
+        auto [source, target] = *operands;
+        if (llvm::any_of(inSync, [&](const auto &pair) {
+              return (pair.first == source && pair.second == target) ||
+                     (pair.first == target && pair.second == source);
+            })) {
+          op.erase();
+          changed = true;
+          continue;
+        }
+      }
+      llvm::erase_if(inSync, [&](const auto &pair) {
+        return mayAccess(&op, pair.first, /*writeOnly=*/true) ||
+               mayAccess(&op, pair.second, /*writeOnly=*/true);
+      });
+      if (operands)
+        inSync.push_back(*operands);
+    }
+    return changed;
+  }
+
+  mlir::AliasAnalysis *aliasAnalysis = nullptr;
+};
+} // namespace
+
+namespace imex {
+std::unique_ptr<mlir::Pass> createRemoveRedundantGPUCopiesPass() {
+  return std::make_unique<RemoveRedundantGPUCopiesPass>();
+}
+} // namespace imex
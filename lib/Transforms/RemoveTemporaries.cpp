@@ -10,6 +10,13 @@
 /// \file
 /// This file implements the RemoveTemporaries transform.
 ///
+/// Writes to the temporary in nested regions, e.g. the body of a scf.for
+/// computing the temporary tile by tile, are checked for conflicts as well.
+/// A temporary allocated outside of the region of its copy is forwarded if it
+/// is a scratch buffer of the copy's block, e.g. the body of a scf.for or the
+/// branch of a scf.if. linalg ops reading the destination at the element they
+/// write update it in place, e.g. `a = a + b`.
+///
 //===----------------------------------------------------------------------===//
 
 #include "imex/Transforms/Passes.h"
@@ -17,6 +24,7 @@
 #include <imex/Utils/PassUtils.h>
 #include <mlir/Analysis/AliasAnalysis.h>
 #include <mlir/Dialect/Func/IR/FuncOps.h>
+#include <mlir/Dialect/Linalg/IR/Linalg.h>
 
 namespace imex {
 #define GEN_PASS_DEF_REMOVETEMPORARIES
@@ -133,8 +141,22 @@ static bool opHasWriteEffect(::mlir::Value val, ::mlir::Operation *op) {
   return true;
 }
 
+/// Appends `op` and the operations nested in its regions that satisfy
+/// `opHasProperty` to `foundOps`.
+static void collectNestedMatchingOps(
+    ::mlir::Operation *op, ::mlir::SmallVector<::mlir::Operation *> &foundOps,
+    std::function<bool(::mlir::Operation *)> opHasProperty) {
+  op->walk<::mlir::WalkOrder::PreOrder>([&](::mlir::Operation *nested) {
+    if (opHasProperty(nested)) {
+      DEBUG_OP("collectMatchingOps", "  found op", nested)
+      foundOps.emplace_back(nested);
+    }
+  });
+}
+
 /// Collect all operations between `startOp` and `endOp` that satisfies
-/// `opHasProperty`. If `endOp` is `nullptr` travers until the end of region.
+/// `opHasProperty`, including operations nested in their regions. If `endOp`
+/// is `nullptr` travers until the end of region.
 /// @return true if property checking succeeded
 bool collectMatchingOps(
     ::mlir::Operation *startOp, ::mlir::Operation *endOp,
@@ -161,10 +183,7 @@ bool collectMatchingOps(
     // Check ops in start block after startOp
     for (auto iter = ++startOp->getIterator(), end = startOpBlock->end();
          iter != end && (!endOp || (&*iter != endOp)); ++iter) {
-      if (opHasProperty(&*iter)) {
-        DEBUG_OP("collectMatchingOps", "  found op", (&*iter))
-        foundOps.emplace_back(&*iter);
-      }
+      collectNestedMatchingOps(&*iter, foundOps, opHasProperty);
     }
     // If endOp is not in start block, add successor blocks to check list.
     if (checkAllBlocks) {
@@ -186,9 +205,7 @@ bool collectMatchingOps(
       if (endOp && (&op == endOp)) {
         break;
       }
-      if (opHasProperty(&op)) {
-        foundOps.emplace_back(&op);
-      }
+      collectNestedMatchingOps(&op, foundOps, opHasProperty);
       if (&op == blk->getTerminator()) {
         for (::mlir::Block *succ : blk->getSuccessors()) {
           blocksToCheck.push_back(succ);
@@ -267,14 +284,67 @@ inferSubviewChainResultType(mlir::MemRefType srcType,
   return newType;
 }
 
+/// Check whether `readVal` is the same view as `writeVal` after replacing the
+/// root of `writeVal` by `newVal`, i.e. both are built by identical chains of
+/// subview ops from the same root value.
+bool isSameViewAfterReplacement(mlir::Value readVal, mlir::Value writeVal,
+                                mlir::Value newVal) {
+  ::mlir::SmallVector<::mlir::Operation *> readSVOps, writeSVOps;
+  auto readRoot = findSubviewRootValue(readVal, readSVOps);
+  findSubviewRootValue(writeVal, writeSVOps);
+  auto newRoot = findSubviewRootValue(newVal, writeSVOps);
+  if (readRoot != newRoot || readSVOps.size() != writeSVOps.size()) {
+    return false;
+  }
+  for (auto [readOp, writeOp] : llvm::zip(readSVOps, writeSVOps)) {
+    auto readSV = mlir::cast<mlir::memref::SubViewOp>(readOp);
+    auto writeSV = mlir::cast<mlir::memref::SubViewOp>(writeOp);
+    if (readSV.getMixedOffsets() != writeSV.getMixedOffsets() ||
+        readSV.getMixedSizes() != writeSV.getMixedSizes() ||
+        readSV.getMixedStrides() != writeSV.getMixedStrides()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/// Check whether the linalg op `op` reads `read` only at the elements it
+/// writes through its init operand `writeVal` in the same iteration, such that
+/// writing `read` in place of `writeVal` is safe.
+bool isInPlaceUpdate(mlir::Operation *op, mlir::OpOperand &read,
+                     mlir::Value writeVal, mlir::Value newVal) {
+  auto linalgOp = mlir::dyn_cast<mlir::linalg::LinalgOp>(op);
+  if (!linalgOp || linalgOp.getNumLoops() != linalgOp.getNumParallelLoops() ||
+      !linalgOp.isDpsInput(&read)) {
+    return false;
+  }
+  for (auto &init : linalgOp.getDpsInitsMutable()) {
+    if (init.get() != writeVal) {
+      continue;
+    }
+    auto writeMap = linalgOp.getMatchingIndexingMap(&init);
+    if (writeMap.isPermutation() &&
+        writeMap == linalgOp.getMatchingIndexingMap(&read) &&
+        isSameViewAfterReplacement(read.get(), writeVal, newVal)) {
+      return true;
+    }
+  }
+  return false;
+}
+
 /// Check whether replacing write destination `writeVal` by `newVal` in `op`
 /// would result in a RAW conflict
 /// @return true if potential conflict is found
 bool opHasRAWConflict(mlir::Operation *op, mlir::Value writeVal,
                       mlir::Value newVal, mlir::AliasAnalysis &mAlias) {
-  for (auto readVal : op->getOperands()) {
+  for (auto &read : op->getOpOperands()) {
+    auto readVal = read.get();
     auto aliasRes = mAlias.alias(readVal, newVal);
     if (aliasRes.isPartial() || aliasRes.isMust()) {
+      if (isInPlaceUpdate(op, read, writeVal, newVal)) {
+        DEBUG_OP("checkReadWriteConflict", "  in place update in", op)
+        continue;
+      }
       // After replacement we would read and write to the same memref
       // NOTE we accept MayAlias e.g. in the case of input args
       bool compatibleMemrefs = false;
@@ -456,6 +526,67 @@ bool moveAfterIfPossible(::mlir::Operation *op, ::mlir::Operation *markerOp,
   return false;
 }
 
+/// Check whether `op` overwrites all of `val` without reading it.
+static bool overwritesValue(::mlir::Operation *op, ::mlir::Value val) {
+  if (auto copy = ::mlir::dyn_cast<::mlir::CopyOpInterface>(op)) {
+    return copy.getTarget() == val && copy.getSource() != val;
+  }
+  auto linalgOp = ::mlir::dyn_cast<::mlir::linalg::LinalgOp>(op);
+  if (!linalgOp || linalgOp.getNumLoops() != linalgOp.getNumParallelLoops()) {
+    return false;
+  }
+  for (auto &init : linalgOp.getDpsInitsMutable()) {
+    if (init.get() == val &&
+        linalgOp.getMatchingIndexingMap(&init).isPermutation() &&
+        !linalgOp.payloadUsesValueFromOperand(&init) &&
+        !llvm::is_contained(linalgOp.getDpsInputs(), val)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/// Check whether `val` is a scratch buffer of the block of `op`: all uses of
+/// `val` and its views, except deallocs, are in the block and before `op`,
+/// and the first of them overwrites `val`, such that no data is carried
+/// across executions of the block, e.g. iterations of a loop.
+static bool isScratchOfBlock(::mlir::Value val, ::mlir::Operation *op) {
+  auto block = op->getBlock();
+  ::mlir::Operation *first = nullptr;
+  bool firstIsDirect = false;
+  ::mlir::SmallVector<::mlir::Value> worklist{val};
+  while (!worklist.empty()) {
+    auto current = worklist.pop_back_val();
+    for (auto user : current.getUsers()) {
+      if (user == op) {
+        continue;
+      }
+      if (auto effects =
+              ::mlir::dyn_cast<::mlir::MemoryEffectOpInterface>(user)) {
+        if (effects.hasEffect<::mlir::MemoryEffects::Free>()) {
+          continue;
+        }
+      }
+      auto ancestor = block->findAncestorOpInBlock(*user);
+      if (!ancestor || !ancestor->isBeforeInBlock(op)) {
+        return false;
+      }
+      if (::mlir::isa<::mlir::memref::SubViewOp, ::mlir::memref::CastOp>(
+              user)) {
+        worklist.push_back(user->getResult(0));
+        continue;
+      }
+      if (!first || ancestor->isBeforeInBlock(first)) {
+        first = ancestor;
+        firstIsDirect = user == ancestor && current == val;
+      } else if (ancestor == first) {
+        firstIsDirect = false;
+      }
+    }
+  }
+  return first && firstIsDirect && overwritesValue(first, val);
+}
+
 struct RemoveTemporaries
     : public imex::impl::RemoveTemporariesBase<RemoveTemporaries> {
   void runOnOperation() override {
@@ -503,10 +634,23 @@ private:
 
     bool srcIsReturned = findReturn(srcAllocOp->getResult(0));
 
+    // A temporary allocated in an enclosing region can be forwarded if it is
+    // a scratch buffer of the copy block and dst is available at all its uses.
+    bool isNested = false;
     if (copyOpParentReg != allocOpParentReg) {
-      DEBUG_MSG("RemoveTemporaries",
-                "alloc and copy are in different regions, skipping")
-      return;
+      auto &dom = getAnalysis<::mlir::DominanceInfo>();
+      auto srcVal = srcAllocOp->getResult(0);
+      isNested = allocOpParentReg->isProperAncestor(copyOpParentReg) &&
+                 !srcIsReturned && isScratchOfBlock(srcVal, op) &&
+                 llvm::all_of(srcVal.getUsers(), [&](::mlir::Operation *user) {
+                   return user == op || user == srcDeallocOp ||
+                          dom.properlyDominates(dst, user);
+                 });
+      if (!isNested) {
+        DEBUG_MSG("RemoveTemporaries",
+                  "alloc and copy are in different regions, skipping")
+        return;
+      }
     }
     if (dstDefOp) {
       // There is a dst defining op
@@ -532,7 +676,7 @@ private:
       // Move copy target right after src allocation
       // unless target is defined earlier
       auto &dom = getAnalysis<::mlir::DominanceInfo>();
-      if (!dom.dominates(dstDefOp, srcAllocOp) &&
+      if (!isNested && !dom.dominates(dstDefOp, srcAllocOp) &&
           !moveAfterIfPossible(dstDefOp, srcAllocOp, op, dom)) {
         DEBUG_MSG("RemoveTemporaries", "cannot move dst defining op, skipping")
         return;
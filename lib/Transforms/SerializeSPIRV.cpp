@@ -10,7 +10,9 @@
 /// \file
 /// This pass iterates all the SPIR-V modules in the top module and serializes
 /// each SPIR-V module to SPIR-V binary and then attachs the binary blob as a
-/// string attribute to the corresponding gpu module.
+/// string attribute to the corresponding gpu module. Modules are serialized in
+/// parallel. Optionally the SPIR-V is also compiled ahead of time to native
+/// binaries for a list of devices.
 ///
 //===----------------------------------------------------------------------===//
 #include "imex/Transforms/Passes.h"
@@ -18,7 +20,14 @@
 #include "mlir/Dialect/GPU/IR/GPUDialect.h"
 #include "mlir/Dialect/SPIRV/IR/SPIRVDialect.h"
 #include "mlir/Dialect/SPIRV/IR/SPIRVOps.h"
+#include "mlir/IR/Threading.h"
 #include "mlir/Target/SPIRV/Serialization.h"
+#include "llvm/ADT/ScopeExit.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Program.h"
 
 #include <fstream>
 
@@ -36,47 +45,74 @@ struct SerializeSPIRVPass
 public:
   void runOnOperation() override {
     auto mod = getOperation();
-    llvm::SmallVector<uint32_t, 0> spvBinary;
-    for (mlir::gpu::GPUModuleOp gpuMod : mod.getOps<gpu::GPUModuleOp>()) {
-      auto name = gpuMod.getName();
-      // check that the spv module has the same name with gpu module except the
-      // prefix "__spv__"
-      auto isSameMod = [&](spirv::ModuleOp spvMod) -> bool {
-        auto spvModName = spvMod.getName();
-        return spvModName->consume_front("__spv__") && spvModName == name;
-      };
-      auto spvMods = mod.getOps<spirv::ModuleOp>();
-      auto it = llvm::find_if(spvMods, isSameMod);
-      if (it == spvMods.end()) {
-        gpuMod.emitError() << "Unable to find corresponding SPIR-V module";
+    for (auto &device : aotDevices) {
+      uint32_t id;
+      if (llvm::StringRef(device).getAsInteger(0, id)) {
+        mod.emitError() << "invalid AOT device ID " << device;
         signalPassFailure();
         return;
       }
-      auto spvMod = *it;
+    }
 
-      spvBinary.clear();
-      // serialize the spv module to spv binary
-      if (mlir::failed(spirv::serialize(spvMod, spvBinary))) {
-        spvMod.emitError() << "Failed to serialize SPIR-V module";
+    // pair every gpu module with its spv module, which has the same name
+    // with the prefix "__spv__"
+    llvm::StringMap<spirv::ModuleOp> spvMods;
+    for (auto spvMod : mod.getOps<spirv::ModuleOp>()) {
+      auto spvModName = spvMod.getName();
+      if (spvModName && spvModName->consume_front("__spv__"))
+        spvMods[*spvModName] = spvMod;
+    }
+    llvm::SmallVector<std::pair<gpu::GPUModuleOp, spirv::ModuleOp>> modules;
+    for (auto gpuMod : mod.getOps<gpu::GPUModuleOp>()) {
+      auto spvMod = spvMods.lookup(gpuMod.getName());
+      if (!spvMod) {
+        gpuMod.emitError() << "Unable to find corresponding SPIR-V module";
         signalPassFailure();
         return;
       }
-      // attach the spv binary to the gpu module
+      modules.emplace_back(gpuMod, spvMod);
+    }
+
+    // serialize the spv modules to spv binaries in parallel
+    std::vector<llvm::SmallVector<uint32_t, 0>> spvBinaries(modules.size());
+    if (mlir::failed(mlir::failableParallelFor(
+            &getContext(), 0, modules.size(),
+            [&](size_t i) -> mlir::LogicalResult {
+              auto spvMod = modules[i].second;
+              if (mlir::failed(spirv::serialize(spvMod, spvBinaries[i])))
+                return spvMod.emitError()
+                       << "Failed to serialize SPIR-V module";
+              return mlir::success();
+            }))) {
+      signalPassFailure();
+      return;
+    }
+
+    // attach the spv binaries to the gpu modules; modules with the same
+    // binary share the attribute
+    for (auto [module, spvBinary] : llvm::zip(modules, spvBinaries)) {
       auto spvData =
           llvm::StringRef(reinterpret_cast<const char *>(spvBinary.data()),
                           spvBinary.size() * sizeof(uint32_t));
       auto spvAttr = mlir::StringAttr::get(&getContext(), spvData);
-      gpuMod->setAttr(imex::gpuBinaryAttrName, spvAttr);
+      module.first->setAttr(imex::gpuBinaryAttrName, spvAttr);
+    }
 
+    if (!aotDevices.empty() && mlir::failed(compileNativeBinaries(modules))) {
+      signalPassFailure();
+      return;
+    }
+
+    for (auto [gpuMod, spvMod] : modules) {
       // write the SPIR-V binary to a file
       // can be used to generate human readable SPIR-V code
       // @TODO: need to decide where would we want to write the binary to
       // currently writing to the present working directory
       if (getenv("IMEX_DUMP_SPIRV_BINARY")) {
-        auto spvModName = spvMod.getName();
-        // No need for extra check on spvModName, the check is done before
-        spvModName->consume_front("__spv__");
-        std::ofstream ofs(spvModName->str().append(".spv"),
+        auto spvData =
+            gpuMod->getAttrOfType<mlir::StringAttr>(imex::gpuBinaryAttrName)
+                .getValue();
+        std::ofstream ofs(gpuMod.getName().str().append(".spv"),
                           std::ofstream::binary);
         if (ofs) {
           ofs << spvData.str();
@@ -86,6 +122,139 @@ public:
       spvMod->erase();
     }
   }
+
+private:
+  // Compiles the SPIR-V of \p modules with ocloc for every device of
+  // aotDevices and attaches the binaries to the gpu modules. Modules with the
+  // same SPIR-V and build options get compiled once, and the compilations run
+  // in parallel.
+  mlir::LogicalResult compileNativeBinaries(
+      llvm::ArrayRef<std::pair<gpu::GPUModuleOp, spirv::ModuleOp>> modules) {
+    auto oclocPath = llvm::sys::findProgramByName(ocloc);
+    if (!oclocPath)
+      return getOperation().emitError()
+             << "cannot find " << ocloc << " to compile native binaries";
+
+    struct Compilation {
+      mlir::gpu::GPUModuleOp gpuMod;
+      mlir::StringAttr spvAttr;
+      mlir::StringAttr options;
+      mlir::DictionaryAttr binaries;
+    };
+    llvm::SmallVector<Compilation> compilations;
+    llvm::DenseMap<std::pair<mlir::Attribute, mlir::Attribute>, size_t>
+        compilationOf;
+    llvm::SmallVector<size_t> moduleCompilations;
+    for (auto [gpuMod, spvMod] : modules) {
+      auto spvAttr =
+          gpuMod->getAttrOfType<mlir::StringAttr>(imex::gpuBinaryAttrName);
+      auto options = getBuildOptions(gpuMod);
+      auto [it, inserted] = compilationOf.try_emplace(
+          std::make_pair(mlir::Attribute(spvAttr), mlir::Attribute(options)),
+          compilations.size());
+      if (inserted)
+        compilations.push_back({gpuMod, spvAttr, options, {}});
+      moduleCompilations.push_back(it->second);
+    }
+
+    if (mlir::failed(mlir::failableParallelForEach(
+            &getContext(), compilations, [&](Compilation &compilation) {
+              auto binaries = compile(*oclocPath, compilation.gpuMod,
+                                      compilation.spvAttr.getValue(),
+                                      compilation.options.getValue());
+              if (mlir::failed(binaries))
+                return mlir::failure();
+              compilation.binaries = *binaries;
+              return mlir::success();
+            })))
+      return mlir::failure();
+
+    for (auto [module, index] : llvm::zip(modules, moduleCompilations))
+      module.first->setAttr(imex::gpuNativeBinariesAttrName,
+                            compilations[index].binaries);
+    return mlir::success();
+  }
+
+  // Returns the build options for \p gpuMod: aotOptions, plus the large
+  // register file and the vector backend if one of its kernels requests them,
+  // as in the runtimes' gpuModuleLoad.
+  mlir::StringAttr getBuildOptions(mlir::gpu::GPUModuleOp gpuMod) {
+    bool largeGRF = false, vectorBackend = false;
+    for (auto func : gpuMod.getOps<mlir::gpu::GPUFuncOp>()) {
+      auto grfSize =
+          func->getAttrOfType<mlir::IntegerAttr>(imex::gpuGRFSizeAttrName);
+      largeGRF |= grfSize && grfSize.getInt() > 128;
+      vectorBackend |= func->hasAttr(imex::gpuVectorBackendAttrName);
+    }
+    std::string options = aotOptions;
+    if (vectorBackend)
+      options += " -vc-codegen";
+    if (largeGRF)
+      options += " -doubleGRF -Xfinalizer -noLocalSplit -Xfinalizer "
+                 "-DPASTokenReduction -Xfinalizer -SWSBDepReduction "
+                 "-Xfinalizer -enableBCR";
+    return mlir::StringAttr::get(&getContext(), options);
+  }
+
+  // Compiles \p spvData with \p oclocPath and \p options for every device of
+  // aotDevices and returns the binaries by device ID. Errors are reported at
+  // \p gpuMod.
+  mlir::FailureOr<mlir::DictionaryAttr>
+  compile(llvm::StringRef oclocPath, mlir::gpu::GPUModuleOp gpuMod,
+          llvm::StringRef spvData, llvm::StringRef options) {
+
+    llvm::SmallString<128> dir;
+    if (auto ec = llvm::sys::fs::createUniqueDirectory("imex-aot", dir)) {
+      gpuMod.emitError() << "cannot create a temporary directory: "
+                         << ec.message();
+      return mlir::failure();
+    }
+    auto removeDir = llvm::make_scope_exit(
+        [&]() { llvm::sys::fs::remove_directories(dir); });
+
+    llvm::SmallString<128> spvPath(dir);
+    llvm::sys::path::append(spvPath, "module.spv");
+    {
+      std::ofstream ofs(spvPath.c_str(), std::ofstream::binary);
+      ofs << spvData.str();
+      if (!ofs) {
+        gpuMod.emitError() << "cannot write " << spvPath;
+        return mlir::failure();
+      }
+    }
+
+    llvm::SmallVector<mlir::NamedAttribute> binaries;
+    for (auto &device : aotDevices) {
+      llvm::SmallVector<llvm::StringRef> args = {
+          oclocPath, "compile", "-spirv_input", "-file",  spvPath,
+          "-device", device,    "-out_dir",     dir,      "-output",
+          device,    "-output_no_suffix"};
+      if (!options.trim().empty()) {
+        args.push_back("-options");
+        args.push_back(options);
+      }
+      std::string errMsg;
+      if (llvm::sys::ExecuteAndWait(oclocPath, args, /*Env=*/std::nullopt,
+                                    /*Redirects=*/{}, /*SecondsToWait=*/0,
+                                    /*MemoryLimit=*/0, &errMsg) != 0) {
+        gpuMod.emitError() << "ocloc failed to compile for device " << device
+                           << (errMsg.empty() ? "" : ": ") << errMsg;
+        return mlir::failure();
+      }
+
+      llvm::SmallString<128> binPath(dir);
+      llvm::sys::path::append(binPath, device + ".bin");
+      auto binary = llvm::MemoryBuffer::getFile(binPath, /*IsText=*/false);
+      if (!binary) {
+        gpuMod.emitError() << "ocloc produced no binary for device " << device;
+        return mlir::failure();
+      }
+      binaries.emplace_back(
+          mlir::StringAttr::get(&getContext(), device),
+          mlir::StringAttr::get(&getContext(), (*binary)->getBuffer()));
+    }
+    return mlir::DictionaryAttr::get(&getContext(), binaries);
+  }
 };
 } // namespace
 
@@ -28,6 +28,27 @@ namespace imex {
 } // namespace imex
 
 namespace {
+// Returns the workgroup size \p func was outlined with if it allocates
+// workgroup memory. Such kernels share their tiles between the threads of
+// a workgroup and are only correct for that size, which therefore becomes
+// part of their ABI.
+static llvm::ArrayRef<int32_t>
+getFixedWorkgroupSize(mlir::gpu::GPUFuncOp func) {
+  auto blockSize =
+      func->getAttrOfType<mlir::DenseI32ArrayAttr>("known_block_size");
+  if (!blockSize)
+    return {};
+  // Memory space 3 maps to the Workgroup storage class in OpenCL.
+  auto result = func.walk([](mlir::memref::AllocOp alloc) {
+    auto space = mlir::dyn_cast_or_null<mlir::IntegerAttr>(
+        alloc.getType().getMemorySpace());
+    return space && space.getInt() == 3 ? mlir::WalkResult::interrupt()
+                                        : mlir::WalkResult::advance();
+  });
+  return result.wasInterrupted() ? blockSize.asArrayRef()
+                                 : llvm::ArrayRef<int32_t>();
+}
+
 class SetSPIRVAbiAttributePass
     : public imex::impl::SetSPIRVAbiAttributeBase<SetSPIRVAbiAttributePass> {
 public:
@@ -58,15 +79,16 @@ public:
     auto attrName =
         mlir::StringAttr::get(context, mlir::spirv::getEntryPointABIAttrName());
     if (m_clientAPI == "opencl") {
-      auto abi = mlir::spirv::getEntryPointABIAttr(context);
-      for (const auto &gpuFunc : gpuModule.getOps<mlir::gpu::GPUFuncOp>()) {
+      for (auto gpuFunc : gpuModule.getOps<mlir::gpu::GPUFuncOp>()) {
         if (!mlir::gpu::GPUDialect::isKernel(gpuFunc) ||
             gpuFunc->getAttr(attrName))
           continue;
 
         gpuFunc->setAttr("VectorComputeFunctionINTEL",
                          mlir::UnitAttr::get(context));
-        gpuFunc->setAttr(attrName, abi);
+        gpuFunc->setAttr(attrName,
+                         mlir::spirv::getEntryPointABIAttr(
+                             context, getFixedWorkgroupSize(gpuFunc)));
       }
     } else if (m_clientAPI == "vulkan") {
       auto abi = mlir::spirv::getEntryPointABIAttr(context, {1, 1, 1});
@@ -14,6 +14,7 @@
 //===----------------------------------------------------------------------===//
 
 #include <imex/Transforms/Passes.h>
+#include <imex/Utils/XeArch.h>
 
 #include "mlir/Dialect/GPU/IR/GPUDialect.h"
 #include "mlir/Dialect/SPIRV/IR/SPIRVDialect.h"
@@ -43,6 +44,8 @@ public:
 
     if (clientAPI != "vulkan" && clientAPI != "opencl")
       return errorHandler(llvm::Twine("Invalid clienAPI: ") + clientAPI);
+    if (!device.empty() && !imex::getXeuArch(device))
+      return errorHandler(llvm::Twine("Invalid device: ") + device);
     m_clientAPI = clientAPI;
 
     return mlir::success();
@@ -51,7 +54,7 @@ public:
   void runOnOperation() override {
     namespace spirv = mlir::spirv;
     auto context = &getContext();
-    spirv::Capability caps_opencl[] = {
+    llvm::SmallVector<spirv::Capability> caps_opencl = {
         // clang-format off
         spirv::Capability::Addresses,
         spirv::Capability::Bfloat16ConversionINTEL,
@@ -78,7 +81,7 @@ public:
         spirv::Capability::Shader,
         // clang-format on
     };
-    spirv::Extension exts_opencl[] = {
+    llvm::SmallVector<spirv::Extension> exts_opencl = {
         // clang-format off
         spirv::Extension::SPV_EXT_shader_atomic_float_add,
         spirv::Extension::SPV_KHR_bfloat16,
@@ -89,6 +92,11 @@ public:
     };
     spirv::Extension exts_vulkan[] = {
         spirv::Extension::SPV_KHR_storage_buffer_storage_class};
+    // Cooperative matrices run on the DPAS units of the device.
+    if (!device.empty()) {
+      caps_opencl.push_back(spirv::Capability::CooperativeMatrixKHR);
+      exts_opencl.push_back(spirv::Extension::SPV_KHR_cooperative_matrix);
+    }
     auto op = getOperation();
     op->walk([&](mlir::gpu::GPUModuleOp gmod) {
       auto oldAttr = gmod->getAttrOfType<mlir::spirv::TargetEnvAttr>(
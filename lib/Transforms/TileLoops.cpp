@@ -23,7 +23,9 @@
 
 #include "llvm/Support/Threading.h"
 #include <imex/Dialect/Region/RegionUtils.h>
+#include <imex/Dialect/XeTile/Transforms/BlockingTuning.h>
 #include <imex/Transforms/Passes.h>
+#include <imex/Utils/XeArch.h>
 
 namespace imex {
 #define GEN_PASS_DEF_TILELOOPS
@@ -75,6 +77,86 @@ getDefaultTileSizes(::mlir::linalg::LinalgOp linalgOp,
   return ::mlir::failure();
 }
 
+// Size in bytes of the memory accesses that are coalesced into one cache
+// line.
+static constexpr int64_t coalescedAccessBytes = 64;
+
+// Derives the tile sizes of the parallel loops of \p linalgOp from its static
+// loop bounds and the device. Tiles are halved, largest first, until there are
+// enough tiles to occupy every EU of the device. The innermost parallel tile
+// is kept a multiple of a subgroup of coalesced accesses. With \p tuner, the
+// tile sizes recorded in its database for the op are used instead.
+static ::mlir::FailureOr<::mlir::SmallVector<int64_t>>
+getAutoTileSizes(::mlir::linalg::LinalgOp linalgOp,
+                 const ::imex::XeuArchInterface &arch,
+                 ::imex::BlockingTuner *tuner) {
+  auto ranges = linalgOp.getStaticLoopRanges();
+  if (llvm::any_of(ranges, ::mlir::ShapedType::isDynamic))
+    return ::mlir::failure();
+  ::mlir::SmallVector<unsigned> parallelDims;
+  linalgOp.getParallelDims(parallelDims);
+  if (parallelDims.empty())
+    return ::mlir::failure();
+
+  int64_t elemBytes = 4;
+  if (linalgOp.getNumDpsInits() > 0) {
+    auto elemTy = ::mlir::getElementTypeOrSelf(
+        linalgOp.getDpsInitOperand(0)->get().getType());
+    if (elemTy.isIntOrFloat())
+      elemBytes = std::max<int64_t>(elemTy.getIntOrFloatBitWidth() / 8, 1);
+  }
+  int64_t innerMin = std::max<int64_t>(arch.getSubgroupSize(),
+                                       coalescedAccessBytes / elemBytes);
+  auto innerDim = parallelDims.back();
+
+  ::mlir::SmallVector<int64_t> tiles(ranges.size(), 0);
+  for (auto dim : parallelDims)
+    tiles[dim] = ranges[dim];
+  auto getNumTiles = [&]() {
+    int64_t numTiles = 1;
+    for (auto dim : parallelDims)
+      numTiles *= llvm::divideCeil(ranges[dim], tiles[dim]);
+    return numTiles;
+  };
+  auto canHalve = [&](unsigned dim, int64_t tile) {
+    return dim == innerDim ? tile >= 2 * innerMin : tile > 1;
+  };
+  auto halve = [&](unsigned dim, int64_t tile) {
+    tile = llvm::divideCeil(tile, 2);
+    return dim == innerDim ? llvm::alignTo(tile, innerMin) : tile;
+  };
+  int64_t numEUs = arch.getNumEUs();
+  while (getNumTiles() < numEUs) {
+    // The outer dimensions are halved first on ties, keeping the inner tile
+    // wide.
+    std::optional<unsigned> best;
+    for (auto dim : parallelDims)
+      if (canHalve(dim, tiles[dim]) && (!best || tiles[dim] > tiles[*best]))
+        best = dim;
+    if (!best)
+      break;
+    tiles[*best] = halve(*best, tiles[*best]);
+  }
+
+  if (tuner) {
+    auto sig = ::imex::BlockingTuner::getSignature(linalgOp.getOperation());
+    for (auto dim : parallelDims) {
+      ::mlir::SmallVector<int64_t> candidates{ranges[dim]};
+      while (canHalve(dim, candidates.back()))
+        candidates.push_back(halve(dim, candidates.back()));
+      tiles[dim] = tuner->select(sig, "tile" + std::to_string(dim),
+                                 candidates, tiles[dim],
+                                 [](int64_t) { return 0.0; });
+    }
+  }
+
+  // A tile covering the whole dimension does not need a loop.
+  for (auto dim : parallelDims)
+    if (tiles[dim] == ranges[dim])
+      tiles[dim] = 0;
+  return tiles;
+}
+
 struct TileLoops final : public imex::impl::TileLoopsBase<TileLoops> {
 
   using TileLoopsBase::TileLoopsBase;
@@ -83,6 +165,21 @@ struct TileLoops final : public imex::impl::TileLoopsBase<TileLoops> {
 
     ::mlir::func::FuncOp func = getOperation();
     ::mlir::IRRewriter rewriter(&getContext());
+    if (autoTileSizes) {
+      arch = ::imex::getXeuArch(device);
+      if (!arch) {
+        func.emitError() << "Invalid device: " << device;
+        return signalPassFailure();
+      }
+      if (!tuningDb.empty()) {
+        tuner = std::make_unique<::imex::BlockingTuner>(
+            device, ::imex::BlockingTuner::Mode::Database);
+        if (failed(tuner->load(tuningDb))) {
+          func.emitError() << "Failed to read tuning database " << tuningDb;
+          return signalPassFailure();
+        }
+      }
+    }
     transform(rewriter, func, this->tileSizes, this->minTileFactor);
 
     return;
@@ -102,34 +199,58 @@ private:
 
     for (auto op : allLinalgOps) {
       DEBUG_OP("tile-loops", "  Tiling op:", op);
-      auto tiles = getDefaultTileSizes(
-          ::llvm::cast<::mlir::linalg::LinalgOp>(op), tileSizes);
+      auto linalgOp = ::llvm::cast<::mlir::linalg::LinalgOp>(op);
+      if (autoTileSizes) {
+        // Ops with dynamic bounds, e.g. tiles of an already tiled op, are
+        // left to explicit tile sizes.
+        auto tiles = getAutoTileSizes(linalgOp, *arch, tuner.get());
+        if (failed(tiles) || llvm::all_of(*tiles, [](int64_t tile) {
+              return tile == 0;
+            })) {
+          DEBUG_MSG("tile-loops", "  No automatic tile sizes. Skipping.");
+          continue;
+        }
+        if (failed(tileOp(rewriter, op, *tiles)))
+          return;
+        continue;
+      }
+      auto tiles = getDefaultTileSizes(linalgOp, tileSizes);
       if (failed(tiles)) {
         DEBUG_MSG("tile-loops",
                   "  Failed to compute default tile sizes. Aborting.");
         return;
       }
-      DEBUG_MSG("tile-loops", "  tile sizes:");
-      LLVM_DEBUG(llvm::dbgs() << "tile-loops:    (");
-      LLVM_DEBUG(llvm::interleaveComma(*tiles, llvm::dbgs()));
-      LLVM_DEBUG(llvm::dbgs() << ")\n");
-
-      auto tilesRes =
-          ::mlir::getAsOpFoldResult(rewriter.getI64ArrayAttr(*tiles));
-      ::mlir::scf::SCFTilingOptions options;
-      options.setTileSizes(tilesRes);
-      options.setLoopType(::mlir::scf::SCFTilingOptions::LoopType::ForallOp);
-      auto tileOp = ::mlir::cast<::mlir::TilingInterface>(op);
-      ::mlir::FailureOr<::mlir::scf::SCFTilingResult> tilingResult =
-          mlir::scf::tileUsingSCF(rewriter, tileOp, options);
-      if (failed(tilingResult)) {
-        DEBUG_MSG("tile-loops", "  Failed to tile op. Aborting.");
+      if (failed(tileOp(rewriter, op, *tiles)))
         return;
-      }
-      DEBUG_MSG("tile-loops", "  Tiling applied successfully.");
-      rewriter.replaceOp(op, tilingResult->mergeResult.replacements);
     }
   }
+
+  ::mlir::LogicalResult tileOp(::mlir::RewriterBase &rewriter,
+                               ::mlir::Operation *op,
+                               ::mlir::ArrayRef<int64_t> tiles) {
+    DEBUG_MSG("tile-loops", "  tile sizes:");
+    LLVM_DEBUG(llvm::dbgs() << "tile-loops:    (");
+    LLVM_DEBUG(llvm::interleaveComma(tiles, llvm::dbgs()));
+    LLVM_DEBUG(llvm::dbgs() << ")\n");
+
+    auto tilesRes = ::mlir::getAsOpFoldResult(rewriter.getI64ArrayAttr(tiles));
+    ::mlir::scf::SCFTilingOptions options;
+    options.setTileSizes(tilesRes);
+    options.setLoopType(::mlir::scf::SCFTilingOptions::LoopType::ForallOp);
+    auto tileOp = ::mlir::cast<::mlir::TilingInterface>(op);
+    ::mlir::FailureOr<::mlir::scf::SCFTilingResult> tilingResult =
+        mlir::scf::tileUsingSCF(rewriter, tileOp, options);
+    if (failed(tilingResult)) {
+      DEBUG_MSG("tile-loops", "  Failed to tile op. Aborting.");
+      return ::mlir::failure();
+    }
+    DEBUG_MSG("tile-loops", "  Tiling applied successfully.");
+    rewriter.replaceOp(op, tilingResult->mergeResult.replacements);
+    return ::mlir::success();
+  }
+
+  std::shared_ptr<::imex::XeuArchInterface> arch;
+  std::unique_ptr<::imex::BlockingTuner> tuner;
 };
 
 } // end anonymous namespace
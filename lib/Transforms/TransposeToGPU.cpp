@@ -0,0 +1,251 @@
+//===- TransposeToGPU.cpp - TransposeToGPU Pass -----------------*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file lowers linalg.transpose and permuting linalg.generic ops on
+/// memrefs to kernels which transpose tiles through workgroup memory. Every
+/// workgroup reads a tile of the input along its contiguous dimension into
+/// shared local memory and writes it out along the contiguous dimension of
+/// the output, such that both global accesses are coalesced. The rows of the
+/// tile in workgroup memory are padded by one element, so the column-wise
+/// reads of a subgroup hit different banks.
+///
+//===----------------------------------------------------------------------===//
+
+#include <imex/Transforms/Passes.h>
+
+#include <mlir/Dialect/Arith/IR/Arith.h>
+#include <mlir/Dialect/Func/IR/FuncOps.h>
+#include <mlir/Dialect/GPU/IR/GPUDialect.h>
+#include <mlir/Dialect/Linalg/IR/Linalg.h>
+#include <mlir/Dialect/MemRef/IR/MemRef.h>
+#include <mlir/Dialect/SCF/IR/SCF.h>
+#include <mlir/IR/IRMapping.h>
+#include <mlir/Pass/Pass.h>
+
+namespace imex {
+#define GEN_PASS_DEF_TRANSPOSETOGPU
+#include "imex/Transforms/Passes.h.inc"
+} // namespace imex
+
+namespace {
+
+// The memory space of workgroup memory in the OpenCL storage class mapping.
+constexpr unsigned workgroupMemorySpace = 3;
+
+// Returns whether the innermost dimension of \p memref is contiguous.
+static bool hasContiguousRows(mlir::Value memref) {
+  auto type = mlir::dyn_cast<mlir::MemRefType>(memref.getType());
+  llvm::SmallVector<int64_t> strides;
+  int64_t offset;
+  return type &&
+         mlir::succeeded(type.getStridesAndOffset(strides, offset)) &&
+         !strides.empty() && strides.back() == 1;
+}
+
+// Returns the loops indexing the innermost dimensions of the input and the
+// output of \p op if it copies a permutation of its input, possibly
+// converting the elements, and the two differ.
+static std::optional<std::pair<unsigned, unsigned>>
+getTransposedLoops(mlir::linalg::LinalgOp op) {
+  if (!op.hasPureBufferSemantics() || op.getNumDpsInputs() != 1 ||
+      op.getNumDpsInits() != 1 || op.getNumLoops() < 2 ||
+      op.getNumLoops() != op.getNumParallelLoops())
+    return std::nullopt;
+  auto *input = op.getDpsInputOperand(0);
+  auto *init = op.getDpsInitOperand(0);
+  auto inputMap = op.getMatchingIndexingMap(input);
+  auto initMap = op.getMatchingIndexingMap(init);
+  if (!inputMap.isPermutation() || !initMap.isPermutation() ||
+      !hasContiguousRows(input->get()) || !hasContiguousRows(init->get()))
+    return std::nullopt;
+
+  // The elements only depend on the elements of the input.
+  auto *body = op.getBlock();
+  if (!body->getArgument(1).use_empty() ||
+      !body->getOps<mlir::linalg::IndexOp>().empty())
+    return std::nullopt;
+
+  auto last = op.getNumLoops() - 1;
+  unsigned inputLoop = inputMap.getDimPosition(last);
+  unsigned initLoop = initMap.getDimPosition(last);
+  if (inputLoop == initLoop)
+    return std::nullopt;
+  return std::make_pair(inputLoop, initLoop);
+}
+
+struct TransposeToGPUPass final
+    : public imex::impl::TransposeToGPUBase<TransposeToGPUPass> {
+  using TransposeToGPUBase::TransposeToGPUBase;
+
+  void runOnOperation() override {
+    auto func = getOperation();
+    if (tileSize <= 0 || blockRows <= 0 || tileSize % blockRows) {
+      func.emitError() << "tile-size must be a multiple of block-rows";
+      return signalPassFailure();
+    }
+
+    llvm::SmallVector<mlir::linalg::LinalgOp> transposes;
+    func.walk([&](mlir::linalg::LinalgOp op) {
+      if (mlir::isa<mlir::linalg::TransposeOp, mlir::linalg::GenericOp>(op) &&
+          !op->getParentOfType<mlir::gpu::LaunchOp>() &&
+          getTransposedLoops(op))
+        transposes.push_back(op);
+    });
+    for (auto op : transposes)
+      convert(op);
+  }
+
+private:
+  // Replaces \p op by a kernel with a workgroup of tileSize x blockRows
+  // threads per tileSize x tileSize tile of the loops indexing the innermost
+  // dimensions of the input and the output. The other loops are linearized
+  // into the z dimension of the grid.
+  void convert(mlir::linalg::LinalgOp op) {
+    auto loops = *getTransposedLoops(op);
+    auto inputLoop = loops.first;
+    auto initLoop = loops.second;
+    auto input = op.getDpsInputOperand(0)->get();
+    auto init = op.getDpsInitOperand(0)->get();
+    auto inputMap = op.getMatchingIndexingMap(op.getDpsInputOperand(0));
+    auto initMap = op.getMatchingIndexingMap(op.getDpsInitOperand(0));
+    auto elemType = mlir::cast<mlir::MemRefType>(init.getType())
+                        .getElementType();
+    auto numLoops = op.getNumLoops();
+
+    auto loc = op.getLoc();
+    mlir::OpBuilder builder(op);
+    auto getIndex = [&](int64_t value) -> mlir::Value {
+      return builder.create<mlir::arith::ConstantIndexOp>(loc, value);
+    };
+    auto c0 = getIndex(0);
+    auto c1 = getIndex(1);
+    auto cTileSize = getIndex(tileSize);
+    auto cBlockRows = getIndex(blockRows);
+
+    llvm::SmallVector<mlir::Value> sizes(numLoops);
+    for (unsigned i = 0; i < numLoops; ++i)
+      sizes[inputMap.getDimPosition(i)] =
+          builder.createOrFold<mlir::memref::DimOp>(loc, input, i);
+    auto isOuter = [&](unsigned loop) {
+      return loop != inputLoop && loop != initLoop;
+    };
+    mlir::Value gridZ = c1;
+    for (unsigned loop = 0; loop < numLoops; ++loop)
+      if (isOuter(loop))
+        gridZ = builder.createOrFold<mlir::arith::MulIOp>(loc, gridZ,
+                                                          sizes[loop]);
+    auto gridX = builder.createOrFold<mlir::arith::CeilDivUIOp>(
+        loc, sizes[inputLoop], cTileSize);
+    auto gridY = builder.createOrFold<mlir::arith::CeilDivUIOp>(
+        loc, sizes[initLoop], cTileSize);
+
+    auto launch = builder.create<mlir::gpu::LaunchOp>(
+        loc, gridX, gridY, gridZ, cTileSize, cBlockRows, c1);
+    builder.setInsertionPointToStart(&launch.getBody().front());
+    auto blockIds = launch.getBlockIds();
+    auto threadIds = launch.getThreadIds();
+
+    llvm::SmallVector<mlir::Value> ivs(numLoops);
+    mlir::Value linear = blockIds.z;
+    for (unsigned loop = numLoops; loop-- > 0;) {
+      if (!isOuter(loop))
+        continue;
+      ivs[loop] =
+          builder.create<mlir::arith::RemUIOp>(loc, linear, sizes[loop]);
+      linear = builder.create<mlir::arith::DivUIOp>(loc, linear, sizes[loop]);
+    }
+    auto inputBase =
+        builder.create<mlir::arith::MulIOp>(loc, blockIds.x, cTileSize);
+    auto initBase =
+        builder.create<mlir::arith::MulIOp>(loc, blockIds.y, cTileSize);
+
+    auto slmType = mlir::MemRefType::get({tileSize, tileSize + 1}, elemType,
+                                         {}, workgroupMemorySpace);
+    mlir::Value slm = builder.create<mlir::memref::AllocOp>(loc, slmType);
+
+    auto getIndices = [&](mlir::AffineMap map) {
+      llvm::SmallVector<mlir::Value> indices;
+      for (unsigned i = 0; i < numLoops; ++i)
+        indices.push_back(ivs[map.getDimPosition(i)]);
+      return indices;
+    };
+    // Calls \p body for the rows of the tile of the thread, which are
+    // blockRows apart, if the element of the thread in the row is in
+    // bounds. The thread handles the column of its x id.
+    auto forEachRow = [&](mlir::Value rowBase, mlir::Value colBase,
+                          unsigned rowLoop, unsigned colLoop,
+                          llvm::function_ref<void(mlir::OpBuilder &,
+                                                  mlir::Value, mlir::Value)>
+                              body) {
+      builder.create<mlir::scf::ForOp>(
+          loc, c0, cTileSize, cBlockRows, mlir::ValueRange(),
+          [&](mlir::OpBuilder &builder, mlir::Location loc, mlir::Value iv,
+              mlir::ValueRange) {
+            auto row = builder.create<mlir::arith::AddIOp>(loc, threadIds.y,
+                                                           iv);
+            ivs[rowLoop] =
+                builder.create<mlir::arith::AddIOp>(loc, rowBase, row);
+            ivs[colLoop] = builder.create<mlir::arith::AddIOp>(
+                loc, colBase, threadIds.x);
+            auto inRows = builder.create<mlir::arith::CmpIOp>(
+                loc, mlir::arith::CmpIPredicate::ult, ivs[rowLoop],
+                sizes[rowLoop]);
+            auto inCols = builder.create<mlir::arith::CmpIOp>(
+                loc, mlir::arith::CmpIPredicate::ult, ivs[colLoop],
+                sizes[colLoop]);
+            auto inBounds =
+                builder.create<mlir::arith::AndIOp>(loc, inRows, inCols);
+            builder.create<mlir::scf::IfOp>(
+                loc, inBounds,
+                [&](mlir::OpBuilder &builder, mlir::Location loc) {
+                  body(builder, row, threadIds.x);
+                  builder.create<mlir::scf::YieldOp>(loc);
+                });
+            builder.create<mlir::scf::YieldOp>(loc);
+          });
+    };
+
+    // Read the tile along the innermost dimension of the input, which is
+    // indexed by the x id, and compute the elements.
+    forEachRow(initBase, inputBase, initLoop, inputLoop,
+               [&](mlir::OpBuilder &builder, mlir::Value row, mlir::Value col) {
+                 mlir::Value value = builder.create<mlir::memref::LoadOp>(
+                     loc, input, getIndices(inputMap));
+                 mlir::IRMapping mapping;
+                 mapping.map(op.getBlock()->getArgument(0), value);
+                 for (auto &bodyOp : op.getBlock()->without_terminator())
+                   builder.clone(bodyOp, mapping);
+                 value = mapping.lookupOrDefault(
+                     op.getBlock()->getTerminator()->getOperand(0));
+                 builder.create<mlir::memref::StoreOp>(
+                     loc, value, slm, mlir::ValueRange{row, col});
+               });
+    builder.create<mlir::gpu::BarrierOp>(loc);
+    // Write the transposed tile along the innermost dimension of the output.
+    forEachRow(inputBase, initBase, inputLoop, initLoop,
+               [&](mlir::OpBuilder &builder, mlir::Value row, mlir::Value col) {
+                 auto value = builder.create<mlir::memref::LoadOp>(
+                     loc, slm, mlir::ValueRange{col, row});
+                 builder.create<mlir::memref::StoreOp>(loc, value, init,
+                                                       getIndices(initMap));
+               });
+    builder.create<mlir::gpu::TerminatorOp>(loc);
+
+    op->erase();
+  }
+};
+
+} // namespace
+
+namespace imex {
+std::unique_ptr<mlir::Pass> createTransposeToGPUPass() {
+  return std::make_unique<TransposeToGPUPass>();
+}
+} // namespace imex
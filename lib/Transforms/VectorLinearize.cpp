@@ -12,7 +12,9 @@
 ///
 //===----------------------------------------------------------------------===//
 
+#include "mlir/Dialect/MemRef/IR/MemRef.h"
 #include "mlir/Dialect/SCF/IR/SCF.h"
+#include "mlir/Dialect/Utils/StaticValueUtils.h"
 #include "mlir/Dialect/Vector/IR/VectorOps.h"
 #include "mlir/Dialect/Vector/Transforms/LoweringPatterns.h"
 #include "mlir/Dialect/Vector/Transforms/VectorRewritePatterns.h"
@@ -24,10 +26,13 @@
 #include "llvm/ADT/ArrayRef.h"
 
 #include "imex/Transforms/Passes.h"
+#include "imex/Utils/Remarks.h"
 #include "mlir/Transforms/GreedyPatternRewriteDriver.h"
 
 #include <cstdint>
+#include <cstdlib>
 #include <numeric>
+#include <optional>
 
 namespace imex {
 #define GEN_PASS_DEF_VECTORLINEARIZE
@@ -131,9 +136,102 @@ static void populateVectorLinearizeTypeConversionsAndLegality(
       typeConverter, patterns.getContext());
 }
 
+// Returns a known divisor of the index value, 0 for a zero index and 1 if
+// nothing is known.
+static int64_t getKnownDivisor(mlir::Value index) {
+  if (auto cst = mlir::getConstantIntValue(index))
+    return std::abs(*cst);
+  if (auto mul = index.getDefiningOp<mlir::arith::MulIOp>())
+    return getKnownDivisor(mul.getLhs()) * getKnownDivisor(mul.getRhs());
+  if (auto add = index.getDefiningOp<mlir::arith::AddIOp>())
+    return std::gcd(getKnownDivisor(add.getLhs()),
+                    getKnownDivisor(add.getRhs()));
+  return 1;
+}
+
+// A 2D vector access of a contiguous memref, split into an unaligned
+// prologue, an aligned body and an epilogue along the collapsed memref.
+struct BlockAccess {
+  mlir::Value memref;
+  mlir::Value offset;
+  int64_t prologue;
+  int64_t body;
+  int64_t epilogue;
+};
+
+// Plans the 1D block access of a 2D vector of type `vecType` at `indices` of
+// `memref`. An access is planned if the vector covers whole rows of a
+// contiguous 2D memref, and the body of alignment `alignment` bytes holds
+// at least one aligned block. The base of the memref is assumed to be aligned,
+// and the prologue can only be peeled off statically known offsets.
+static std::optional<BlockAccess>
+planBlockAccess(mlir::OpBuilder &builder, mlir::Location loc,
+                mlir::Value memref, mlir::ValueRange indices,
+                mlir::VectorType vecType, unsigned alignment) {
+  auto memrefTy = mlir::dyn_cast<mlir::MemRefType>(memref.getType());
+  auto elemTy = vecType.getElementType();
+  if (!memrefTy || memrefTy.getRank() != 2 ||
+      !memrefTy.getLayout().isIdentity() || !elemTy.isIntOrFloat() ||
+      elemTy.getIntOrFloatBitWidth() % 8 != 0)
+    return std::nullopt;
+  auto rowSize = vecType.getShape()[1];
+  if (memrefTy.getShape()[1] != rowSize)
+    return std::nullopt;
+
+  int64_t elemBytes = elemTy.getIntOrFloatBitWidth() / 8;
+  if (alignment == 0 || alignment % elemBytes != 0)
+    return std::nullopt;
+  int64_t alignElems = alignment / elemBytes;
+
+  // number of elements before the first aligned element.
+  int64_t prologue = 0;
+  auto row = mlir::getConstantIntValue(indices[0]);
+  auto col = mlir::getConstantIntValue(indices[1]);
+  if (row && col) {
+    auto offset = *row * rowSize + *col;
+    prologue = (alignElems - offset % alignElems) % alignElems;
+  } else {
+    auto divisor = std::gcd(getKnownDivisor(indices[0]) * rowSize,
+                            getKnownDivisor(indices[1]));
+    if (divisor % alignElems != 0)
+      return std::nullopt;
+  }
+
+  int64_t total = vecType.getNumElements();
+  if (prologue >= total)
+    return std::nullopt;
+  int64_t body = (total - prologue) / alignElems * alignElems;
+  if (body == 0)
+    return std::nullopt;
+
+  llvm::SmallVector<mlir::ReassociationIndices> reassociation = {{0, 1}};
+  auto flat = builder.create<mlir::memref::CollapseShapeOp>(loc, memref,
+                                                            reassociation);
+  auto stride = builder.create<mlir::arith::ConstantIndexOp>(loc, rowSize);
+  auto rowOffset =
+      builder.createOrFold<mlir::arith::MulIOp>(loc, indices[0], stride);
+  auto offset =
+      builder.createOrFold<mlir::arith::AddIOp>(loc, rowOffset, indices[1]);
+  return BlockAccess{flat, offset, prologue, body, total - prologue - body};
+}
+
+static mlir::Value getIndexAt(mlir::OpBuilder &builder, mlir::Location loc,
+                              mlir::Value base, int64_t i) {
+  if (i == 0)
+    return base;
+  auto increment = builder.create<mlir::arith::ConstantIndexOp>(loc, i);
+  return builder.createOrFold<mlir::arith::AddIOp>(loc, base, increment);
+}
+
 struct VectorLoadOpConversion final
     : public mlir::OpConversionPattern<mlir::vector::LoadOp> {
-  using mlir::OpConversionPattern<mlir::vector::LoadOp>::OpConversionPattern;
+  VectorLoadOpConversion(mlir::TypeConverter &typeConverter,
+                         mlir::MLIRContext *context,
+                         std::optional<unsigned> blockAlignment,
+                         const imex::MissedOptRemarks &remarks)
+      : OpConversionPattern(typeConverter, context),
+        blockAlignment(blockAlignment), remarks(remarks) {}
+
   mlir::LogicalResult
   matchAndRewrite(mlir::vector::LoadOp loadOp, OpAdaptor adaptor,
                   mlir::ConversionPatternRewriter &rewriter) const override {
@@ -144,6 +242,23 @@ struct VectorLoadOpConversion final
     if (shape.size() != 2) {
       return rewriter.notifyMatchFailure(loc, "Can only linearize 2D vectors.");
     }
+
+    if (blockAlignment) {
+      if (auto access =
+              planBlockAccess(rewriter, loc, adaptor.getBase(),
+                              adaptor.getIndices(), vecType, *blockAlignment)) {
+        if (access->prologue || access->epilogue)
+          remarks.emit(loadOp, "ScalarizedLoad",
+                       llvm::Twine(access->prologue + access->epilogue) +
+                           " unaligned elements loaded one by one");
+        rewriter.replaceOp(loadOp, createBlockLoad(rewriter, loc, *access,
+                                                   vecType));
+        return mlir::success();
+      }
+      remarks.emit(loadOp, "UnrolledLoad",
+                   "no aligned 1D block access, unrolled into " +
+                       llvm::Twine(shape[0]) + " row loads");
+    }
     auto unrollCount = shape[0];
     auto vecSize = shape[1];
     auto newVecType =
@@ -173,11 +288,56 @@ struct VectorLoadOpConversion final
     rewriter.replaceOp(loadOp, resultVec);
     return mlir::success();
   }
+
+private:
+  // Loads the prologue and epilogue element by element, and the body with a
+  // single 1D load.
+  static mlir::Value createBlockLoad(mlir::OpBuilder &builder,
+                                     mlir::Location loc,
+                                     const BlockAccess &access,
+                                     mlir::VectorType vecType) {
+    auto elemTy = vecType.getElementType();
+    auto flatTy = mlir::VectorType::get(vecType.getNumElements(), elemTy);
+    mlir::Value result = builder.create<mlir::arith::ConstantOp>(
+        loc, builder.getZeroAttr(flatTy));
+    auto loadElem = [&](int64_t i) {
+      auto index = getIndexAt(builder, loc, access.offset, i);
+      auto elem =
+          builder.create<mlir::memref::LoadOp>(loc, access.memref, index);
+      auto pos = builder.create<mlir::arith::ConstantOp>(
+          loc, builder.getI32IntegerAttr(i));
+      result = builder.create<mlir::vector::InsertElementOp>(loc, elem, result,
+                                                             pos);
+    };
+    for (int64_t i = 0; i < access.prologue; ++i)
+      loadElem(i);
+
+    auto bodyTy = mlir::VectorType::get(access.body, elemTy);
+    auto body = builder.create<mlir::vector::LoadOp>(
+        loc, bodyTy, access.memref,
+        getIndexAt(builder, loc, access.offset, access.prologue));
+    result = builder.create<mlir::vector::InsertStridedSliceOp>(
+        loc, body, result, access.prologue, 1);
+
+    auto epilogueStart = access.prologue + access.body;
+    for (int64_t i = 0; i < access.epilogue; ++i)
+      loadElem(epilogueStart + i);
+    return result;
+  }
+
+  std::optional<unsigned> blockAlignment;
+  const imex::MissedOptRemarks &remarks;
 };
 
 struct VectorStoreOpConversion final
     : public mlir::OpConversionPattern<mlir::vector::StoreOp> {
-  using mlir::OpConversionPattern<mlir::vector::StoreOp>::OpConversionPattern;
+  VectorStoreOpConversion(mlir::TypeConverter &typeConverter,
+                          mlir::MLIRContext *context,
+                          std::optional<unsigned> blockAlignment,
+                          const imex::MissedOptRemarks &remarks)
+      : OpConversionPattern(typeConverter, context),
+        blockAlignment(blockAlignment), remarks(remarks) {}
+
   mlir::LogicalResult
   matchAndRewrite(mlir::vector::StoreOp storeOp, OpAdaptor adaptor,
                   mlir::ConversionPatternRewriter &rewriter) const override {
@@ -189,6 +349,27 @@ struct VectorStoreOpConversion final
       return rewriter.notifyMatchFailure(loc, "Can only linearize 2D vectors.");
     }
 
+    if (blockAlignment) {
+      if (auto access =
+              planBlockAccess(rewriter, loc, adaptor.getBase(),
+                              adaptor.getIndices(), vecType, *blockAlignment)) {
+        if (access->prologue || access->epilogue)
+          remarks.emit(storeOp, "ScalarizedStore",
+                       llvm::Twine(access->prologue + access->epilogue) +
+                           " unaligned elements stored one by one");
+        auto flatTy = mlir::VectorType::get(vecType.getNumElements(),
+                                            vecType.getElementType());
+        auto value = rewriter.createOrFold<mlir::vector::ShapeCastOp>(
+            loc, flatTy, adaptor.getValueToStore());
+        createBlockStore(rewriter, loc, *access, value);
+        rewriter.eraseOp(storeOp);
+        return mlir::success();
+      }
+      remarks.emit(storeOp, "UnrolledStore",
+                   "no aligned 1D block access, unrolled into " +
+                       llvm::Twine(shape[0]) + " row stores");
+    }
+
     auto unrollCount = shape[0];
     llvm::SmallVector<mlir::Value, 4> indices = adaptor.getIndices();
     mlir::Value xBaseIndex = indices[0];
@@ -211,6 +392,36 @@ struct VectorStoreOpConversion final
     rewriter.eraseOp(storeOp);
     return mlir::success();
   }
+
+private:
+  // Stores the prologue and epilogue element by element, and the body with a
+  // single 1D store.
+  static void createBlockStore(mlir::OpBuilder &builder, mlir::Location loc,
+                               const BlockAccess &access, mlir::Value value) {
+    auto storeElem = [&](int64_t i) {
+      auto pos = builder.create<mlir::arith::ConstantOp>(
+          loc, builder.getI32IntegerAttr(i));
+      auto elem = builder.create<mlir::vector::ExtractElementOp>(loc, value,
+                                                                 pos);
+      auto index = getIndexAt(builder, loc, access.offset, i);
+      builder.create<mlir::memref::StoreOp>(loc, elem, access.memref, index);
+    };
+    for (int64_t i = 0; i < access.prologue; ++i)
+      storeElem(i);
+
+    auto body = builder.create<mlir::vector::ExtractStridedSliceOp>(
+        loc, value, access.prologue, access.body, 1);
+    builder.create<mlir::vector::StoreOp>(
+        loc, body, access.memref,
+        getIndexAt(builder, loc, access.offset, access.prologue));
+
+    auto epilogueStart = access.prologue + access.body;
+    for (int64_t i = 0; i < access.epilogue; ++i)
+      storeElem(epilogueStart + i);
+  }
+
+  std::optional<unsigned> blockAlignment;
+  const imex::MissedOptRemarks &remarks;
 };
 
 struct VectorExtractStridedSliceConversion final
@@ -750,10 +961,15 @@ struct VectorLinearizePass final
     patterns.add<VectorExtractStridedSliceConversion,
                  VectorInsertStridedSliceConversion, VectorShffleOpConversion,
                  VectorExtractOpConversion, VectorInsertOpConversion,
-                 VectorSplatOpConversion, VectorLoadOpConversion,
-                 VectorStoreOpConversion, VectorCreateMaskOpConversion,
+                 VectorSplatOpConversion, VectorCreateMaskOpConversion,
                  VectorBitCastOpConversion, LoopOpInterfaceConversion>(
         typeConverter, context);
+    std::optional<unsigned> alignment;
+    if (blockAccess)
+      alignment = blockAlignment;
+    imex::MissedOptRemarks missedOpts(getArgument(), remarks);
+    patterns.add<VectorLoadOpConversion, VectorStoreOpConversion>(
+        typeConverter, context, alignment, missedOpts);
 
     // Shuffle16x16 will fallback to Shuffle1D for non 16x16 sizes.
     mlir::vector::populateVectorTransposeLoweringPatterns(
@@ -15,9 +15,13 @@
 #include <mlir/Analysis/DataFlow/ConstantPropagationAnalysis.h>
 #include <mlir/Analysis/DataFlow/DeadCodeAnalysis.h>
 #include <mlir/Analysis/DataFlow/SparseAnalysis.h>
+#include <mlir/Dialect/SCF/IR/SCF.h>
 #include <mlir/Dialect/Vector/IR/VectorOps.h>
 #include <mlir/Dialect/XeGPU/IR/XeGPU.h>
 #include <mlir/IR/BuiltinTypes.h>
+#include <mlir/IR/SymbolTable.h>
+#include <mlir/Interfaces/CallInterfaces.h>
+#include <mlir/Interfaces/FunctionInterfaces.h>
 
 #include "imex/Transforms/Passes.h"
 #include "imex/Utils/XeCommon.h"
@@ -120,6 +124,15 @@ static bool isVNNIApplicable(mlir::Type type) {
   return factor > 1 && shape[0] % factor == 0;
 }
 
+// Attribute marking the casts inserted after loops to isolate the layout of
+// loop-carried values from the uses of the loop results.
+static constexpr llvm::StringLiteral loopBoundaryAttrName = "vnni_boundary";
+
+static bool isLoopBoundary(mlir::Operation *op) {
+  return mlir::isa<mlir::UnrealizedConversionCastOp>(op) &&
+         op->hasAttr(loopBoundaryAttrName);
+}
+
 // LayoutAnalysisImpl propagates layout info from SSA uses to defs.
 class LayoutAnalysisImpl
     : public mlir::dataflow::SparseBackwardDataFlowAnalysis<LayoutLattice> {
@@ -129,6 +142,11 @@ public:
   mlir::LogicalResult
   visitOperation(mlir::Operation *op, mlir::ArrayRef<LayoutLattice *> operands,
                  mlir::ArrayRef<const LayoutLattice *> results) override {
+    // the uses of loop results don't constrain the layout of the loop-carried
+    // values. The results are converted after the loop if needed.
+    if (isLoopBoundary(op))
+      return mlir::success();
+
     // the B operand of a dpas operation is always in vnni layout
     // and it is the start point of the layout propagation
     if (auto dpas = mlir::dyn_cast<mlir::xegpu::DpasOp>(op)) {
@@ -265,6 +283,46 @@ private:
 };
 } // namespace
 
+// Undo the VNNI transformation of the given value, e.g., convert
+// vector<8x16x2xf16> back to vector<16x16xf16>, using VectorShuffle
+// and shapecast operations.
+static std::pair<mlir::Value, mlir::Operation *>
+applyInverseVnniTransform(mlir::OpBuilder &builder,
+                          mlir::TypedValue<mlir::VectorType> value,
+                          mlir::VectorType plainTy) {
+  auto loc = value.getLoc();
+  auto elemTy = plainTy.getElementType();
+  auto linearVecTy = mlir::VectorType::get(plainTy.getNumElements(), elemTy);
+  auto root =
+      builder.create<mlir::vector::ShapeCastOp>(loc, linearVecTy, value);
+  // element [i * factor + k, j] of the plain layout is at [i, j, k] of the
+  // packed layout.
+  auto factor = getVnniFactor(elemTy);
+  auto cols = plainTy.getShape()[1];
+  llvm::SmallVector<int64_t> mask;
+  for (int64_t r = 0; r < plainTy.getShape()[0]; ++r) {
+    for (int64_t c = 0; c < cols; ++c)
+      mask.push_back((r / factor) * cols * factor + c * factor + r % factor);
+  }
+  auto shuffle = builder.create<mlir::vector::ShuffleOp>(loc, root, root, mask);
+  auto cast = builder.create<mlir::vector::ShapeCastOp>(loc, plainTy, shuffle);
+  return {cast, root};
+}
+
+// Convert the given value to the given type, which is either the vnni
+// packed type or the plain type of the value.
+static std::pair<mlir::Value, mlir::Operation *>
+convertLayout(mlir::OpBuilder &builder, mlir::Value value, mlir::Type type) {
+  if (value.getType() == type)
+    return {value, nullptr};
+  auto vec = mlir::cast<mlir::TypedValue<mlir::VectorType>>(value);
+  auto vecTy = mlir::cast<mlir::VectorType>(type);
+  if (getPackedType(vec.getType()) == vecTy)
+    return applyVnniTransform(builder, vec);
+  assert(getPackedType(vecTy) == vec.getType() && "unexpected layout");
+  return applyInverseVnniTransform(builder, vec, vecTy);
+}
+
 static void applyVnniTransformOnResults(mlir::OpBuilder &builder,
                                         mlir::Operation *op,
                                         LayoutAnalysis &analysis) {
@@ -287,6 +345,14 @@ static void updateUnknownOp(mlir::OpBuilder &builder, mlir::Operation &op,
   // Ignore ops that has packed attribute, since they are inserted by the pass.
   if (op.hasAttr("packed"))
     return;
+  // the casts after loops reveal the layout expected by the uses of the loop
+  // results. Their sources are converted once the loops are updated.
+  if (isLoopBoundary(&op)) {
+    auto res = op.getResult(0);
+    if (analysis.getLayout(res))
+      res.setType(getPackedType(mlir::cast<mlir::VectorType>(res.getType())));
+    return;
+  }
   applyVnniTransformOnResults(builder, &op, analysis);
 }
 
@@ -459,24 +525,59 @@ static void handleBranchOpInterface(mlir::OpBuilder &builder,
     mlir::OperandRange operands = branch.getEntrySuccessorOperands(successor);
     mlir::ValueRange inputs = successor.getSuccessorInputs();
 
-    for (auto [arg, input] : llvm::zip(operands, inputs)) {
+    for (auto [idx, arg, input] : llvm::enumerate(operands, inputs)) {
       if (analysis.getLayout(input)) {
         auto vecTy = mlir::cast<mlir::VectorType>(input.getType());
         auto packedTy = getPackedType(vecTy);
         input.setType(packedTy);
+        // only the region entry uses the packed value, the other uses of
+        // the initArg keep the plain layout.
         if (!analysis.getLayout(arg)) {
-          builder.setInsertionPointAfterValue(arg);
+          builder.setInsertionPoint(op);
           auto cast = mlir::cast<mlir::TypedValue<mlir::VectorType>>(arg);
           auto &&[newArg, root] = applyVnniTransform(builder, cast);
-          arg.replaceAllUsesExcept(newArg, root);
+          op->getOpOperand(operands.getBeginOperandIndex() + idx).set(newArg);
         }
       }
     }
   }
 }
 
+// Returns true if the given function is private and only used by calls, such
+// that its signature can be updated together with its call sites.
+static bool hasOnlyKnownCallers(mlir::FunctionOpInterface func) {
+  if (!func.isPrivate() || func.isExternal())
+    return false;
+  auto *symbolTableOp = mlir::SymbolTable::getNearestSymbolTable(
+      func->getParentOp() ? func->getParentOp() : func.getOperation());
+  auto uses = mlir::SymbolTable::getSymbolUses(func, symbolTableOp);
+  if (!uses)
+    return false;
+  return llvm::all_of(*uses, [](const mlir::SymbolTable::SymbolUse &use) {
+    return mlir::isa<mlir::CallOpInterface>(use.getUser());
+  });
+}
+
+static mlir::FunctionOpInterface getCallee(mlir::CallOpInterface call) {
+  return mlir::dyn_cast_if_present<mlir::FunctionOpInterface>(
+      call.resolveCallable());
+}
+
 static void updateBlockTypes(mlir::OpBuilder &builder, mlir::Block &block,
                              LayoutAnalysis &analysis) {
+  // the arguments of functions with known callers are passed in vnni layout,
+  // the call sites are updated accordingly.
+  auto func = mlir::dyn_cast<mlir::FunctionOpInterface>(block.getParentOp());
+  if (func && block.isEntryBlock() && hasOnlyKnownCallers(func)) {
+    for (auto &&arg : block.getArguments()) {
+      if (analysis.getLayout(arg)) {
+        auto vecTy = mlir::cast<mlir::VectorType>(arg.getType());
+        arg.setType(getPackedType(vecTy));
+      }
+    }
+    return;
+  }
+
   if (!mlir::isa<mlir::RegionBranchOpInterface>(block.getParentOp())) {
     builder.setInsertionPointToStart(&block);
     for (auto &&arg : block.getArguments()) {
@@ -489,6 +590,116 @@ static void updateBlockTypes(mlir::OpBuilder &builder, mlir::Block &block,
   }
 }
 
+// Insert a cast after each loop result that may be in vnni layout, such that
+// the uses of the result after the loop do not force the loop-carried value
+// into the plain layout, which would require a vnni transform in every
+// iteration.
+static void isolateLoopResults(mlir::OpBuilder &builder, mlir::Operation *op) {
+  op->walk([&](mlir::scf::ForOp forOp) {
+    builder.setInsertionPointAfter(forOp);
+    for (auto res : forOp.getResults()) {
+      if (res.use_empty() || !isVNNIApplicable(res.getType()))
+        continue;
+      auto cast = builder.create<mlir::UnrealizedConversionCastOp>(
+          forOp.getLoc(), res.getType(), res);
+      cast->setAttr(loopBoundaryAttrName, builder.getUnitAttr());
+      res.replaceAllUsesExcept(cast.getResult(0), cast);
+    }
+  });
+}
+
+// Update the result types of functions with known callers to the layout of
+// the returned values, and convert the operands and results of the calls to
+// the layout of the callee.
+static void updateCallBoundaries(mlir::OpBuilder &builder, mlir::Operation *op,
+                                 LayoutAnalysis &analysis) {
+  op->walk([&](mlir::FunctionOpInterface func) {
+    if (!hasOnlyKnownCallers(func))
+      return;
+    llvm::SmallVector<mlir::Type> resultTypes(func.getResultTypes());
+    llvm::SmallVector<mlir::Operation *> returns;
+    func.walk([&](mlir::Operation *ret) {
+      if (ret->hasTrait<mlir::OpTrait::ReturnLike>() &&
+          ret->getParentOp() == func.getOperation())
+        returns.push_back(ret);
+    });
+    // a result is returned in vnni layout only if all returned values are.
+    for (size_t i = 0; i < resultTypes.size(); ++i) {
+      bool vnni = !returns.empty() && llvm::all_of(returns, [&](auto *ret) {
+        return analysis.getLayout(ret->getOperand(i));
+      });
+      if (vnni)
+        resultTypes[i] = getPackedType(mlir::cast<mlir::VectorType>(
+            resultTypes[i]));
+    }
+    for (auto *ret : returns) {
+      builder.setInsertionPoint(ret);
+      for (auto &&[opr, type] : llvm::zip(ret->getOpOperands(), resultTypes))
+        opr.set(convertLayout(builder, opr.get(), type).first);
+    }
+    auto argTypes = func.getFunctionBody().front().getArgumentTypes();
+    func.setFunctionTypeAttr(mlir::TypeAttr::get(
+        builder.getFunctionType(argTypes, resultTypes)));
+  });
+
+  op->walk([&](mlir::CallOpInterface call) {
+    auto callee = getCallee(call);
+    if (!callee)
+      return;
+    builder.setInsertionPoint(call);
+    for (auto &&[opr, type] :
+         llvm::zip(call.getArgOperandsMutable(), callee.getArgumentTypes()))
+      opr.set(convertLayout(builder, opr.get(), type).first);
+
+    builder.setInsertionPointAfter(call);
+    for (auto &&[res, type] :
+         llvm::zip(call->getResults(), callee.getResultTypes())) {
+      // the uses of the result expect the layout given by the analysis.
+      auto plainTy = res.getType();
+      auto useTy = plainTy;
+      if (analysis.getLayout(res))
+        useTy = getPackedType(mlir::cast<mlir::VectorType>(plainTy));
+      res.setType(type);
+      auto &&[newRes, root] = convertLayout(builder, res, useTy);
+      if (root)
+        res.replaceAllUsesExcept(newRes, root);
+    }
+  });
+}
+
+// Make the layouts of the init args, yielded values and results of loops
+// match the layout of their region iter args, and convert the loop results
+// to the layout expected by their uses.
+static void updateLoopBoundaries(mlir::OpBuilder &builder,
+                                 mlir::Operation *op) {
+  op->walk([&](mlir::scf::ForOp forOp) {
+    auto yield = forOp.getBody()->getTerminator();
+    for (auto &&[iterArg, init, yielded, res] :
+         llvm::zip(forOp.getRegionIterArgs(), forOp.getInitArgsMutable(),
+                   yield->getOpOperands(), forOp.getResults())) {
+      auto type = iterArg.getType();
+      builder.setInsertionPoint(forOp);
+      init.set(convertLayout(builder, init.get(), type).first);
+      builder.setInsertionPoint(yield);
+      yielded.set(convertLayout(builder, yielded.get(), type).first);
+      res.setType(type);
+    }
+  });
+
+  llvm::SmallVector<mlir::Operation *> boundaries;
+  op->walk([&](mlir::UnrealizedConversionCastOp cast) {
+    if (isLoopBoundary(cast))
+      boundaries.push_back(cast);
+  });
+  for (auto *cast : boundaries) {
+    auto res = cast->getResult(0);
+    builder.setInsertionPoint(cast);
+    res.replaceAllUsesWith(
+        convertLayout(builder, cast->getOperand(0), res.getType()).first);
+    cast->erase();
+  }
+}
+
 namespace imex {
 
 struct VnniTransformationPass final
@@ -496,11 +707,13 @@ struct VnniTransformationPass final
 
   void runOnOperation() override {
     mlir::Operation *op = getOperation();
+    mlir::OpBuilder builder(&getContext());
+    isolateLoopResults(builder, op);
+
     LayoutAnalysis analysis;
     if (mlir::failed(analysis.run(op)))
       return signalPassFailure();
 
-    mlir::OpBuilder builder(&getContext());
     llvm::SmallVector<mlir::Type> operands;
     // process ops in post-order so that the layout info is
     // used before being destroyed.
@@ -518,6 +731,12 @@ struct VnniTransformationPass final
           continue;
         }
 
+        // calls are updated together with the signature of their callee.
+        if (auto call = mlir::dyn_cast<mlir::CallOpInterface>(op)) {
+          if (getCallee(call))
+            continue;
+        }
+
         if (auto dpas = mlir::dyn_cast<mlir::xegpu::DpasOp>(op)) {
           updateDpasOp(builder, dpas, analysis);
           continue;
@@ -550,6 +769,9 @@ struct VnniTransformationPass final
 
       updateBlockTypes(builder, *block, analysis);
     });
+
+    updateCallBoundaries(builder, op, analysis);
+    updateLoopBoundaries(builder, op);
   }
 };
 } // namespace imex
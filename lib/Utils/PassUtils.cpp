@@ -271,18 +271,21 @@ void dispatchIndexValues(::mlir::OpBuilder &builder, ::mlir::Location loc,
   // - dynamic always overwrites static sizes of other operands
   // - static sizes > 1 overwrite other static sizes
   // - static sizes == 1 remain only if all operands agree
+  // operands of lower rank are aligned with the trailing dimensions
   for (auto arg : operands) {
     auto shapedTy = mlir::cast<::mlir::ShapedType>(arg.getType());
+    auto off = resType.getRank() - shapedTy.getRank();
     for (int i = 0; i < shapedTy.getRank(); i++) {
+      auto r = off + i;
       if (shapedTy.isDynamicDim(i)) {
         auto dimOp = builder.create<::mlir::tensor::DimOp>(loc, arg, i);
-        dynamicSizes[i] = createIndexCast(loc, builder, dimOp);
-        staticSizes[i] = ::mlir::ShapedType::kDynamic;
+        dynamicSizes[r] = createIndexCast(loc, builder, dimOp);
+        staticSizes[r] = ::mlir::ShapedType::kDynamic;
       } else {
         auto v = shapedTy.getDimSize(i);
-        if (staticSizes[i] != ::mlir::ShapedType::kDynamic &&
-            (v > 1 || staticSizes[i] == 0)) {
-          staticSizes[i] = v;
+        if (staticSizes[r] != ::mlir::ShapedType::kDynamic &&
+            (v > 1 || staticSizes[r] == 0)) {
+          staticSizes[r] = v;
         }
       }
     }
@@ -0,0 +1,80 @@
+//===- Remarks.cpp - Missed Optimization Remarks ----------------*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file implements the reporting of missed optimizations as diagnostics
+/// or YAML optimization records.
+///
+//===----------------------------------------------------------------------===//
+
+#include "imex/Utils/Remarks.h"
+
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/raw_ostream.h>
+#include <mlir/IR/Location.h>
+#include <mlir/Interfaces/FunctionInterfaces.h>
+
+#include <mutex>
+
+namespace imex {
+
+// Prints str as a single-quoted YAML scalar.
+static void printQuoted(llvm::raw_ostream &os, llvm::StringRef str) {
+  os << '\'';
+  for (char c : str) {
+    if (c == '\'')
+      os << '\'';
+    os << c;
+  }
+  os << '\'';
+}
+
+void MissedOptRemarks::emit(mlir::Operation *op, llvm::StringRef name,
+                            const llvm::Twine &reason) const {
+  if (!isEnabled())
+    return;
+  if (output == "-") {
+    op->emitRemark() << passName << ": " << name << ": " << reason.str();
+    return;
+  }
+
+  std::string record;
+  llvm::raw_string_ostream os(record);
+  os << "--- !Missed\nPass:            ";
+  printQuoted(os, passName);
+  os << "\nName:            ";
+  printQuoted(os, name);
+  if (auto loc = op->getLoc()->findInstanceOf<mlir::FileLineColLoc>()) {
+    os << "\nDebugLoc:        { File: ";
+    printQuoted(os, loc.getFilename().getValue());
+    os << ", Line: " << loc.getLine() << ", Column: " << loc.getColumn()
+       << " }";
+  }
+  if (auto func = op->getParentOfType<mlir::FunctionOpInterface>()) {
+    os << "\nFunction:        ";
+    printQuoted(os, func.getName());
+  }
+  os << "\nArgs:\n  - String:          ";
+  printQuoted(os, reason.str());
+  os << "\n...\n";
+
+  // Passes running in parallel append to the same file.
+  static std::mutex mutex;
+  std::lock_guard<std::mutex> lock(mutex);
+  std::error_code ec;
+  llvm::raw_fd_ostream file(output, ec, llvm::sys::fs::OF_Append);
+  if (ec) {
+    op->emitWarning() << "cannot write remarks to '" << output
+                      << "': " << ec.message();
+    return;
+  }
+  file << record;
+}
+
+} // namespace imex
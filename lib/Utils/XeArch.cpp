@@ -17,6 +17,43 @@
 
 namespace imex {
 
+std::shared_ptr<XeuArchInterface> getXeuArch(mlir::StringRef device) {
+  if (device == "pvc")
+    return std::make_shared<XePVCuArch>();
+  // Arc 140V (Lunar Lake) and Arc B580 (Battlemage).
+  if (device == "lnl")
+    return std::make_shared<XeXe2uArch>("lnl", 8);
+  if (device == "bmg")
+    return std::make_shared<XeXe2uArch>("bmg", 20);
+  return nullptr;
+}
+
+bool XeuArchInterface::hasNativeAtomic(mlir::arith::AtomicRMWKind kind,
+                                       mlir::Type elemTy) const {
+  if (!elemTy.isIntOrFloat())
+    return false;
+  auto bits = elemTy.getIntOrFloatBitWidth();
+  switch (kind) {
+  case mlir::arith::AtomicRMWKind::assign:
+    return bits == 32 || bits == 64;
+  case mlir::arith::AtomicRMWKind::addi:
+  case mlir::arith::AtomicRMWKind::maxs:
+  case mlir::arith::AtomicRMWKind::maxu:
+  case mlir::arith::AtomicRMWKind::mins:
+  case mlir::arith::AtomicRMWKind::minu:
+  case mlir::arith::AtomicRMWKind::ori:
+  case mlir::arith::AtomicRMWKind::andi:
+    return elemTy.isInteger() && (bits == 32 || bits == 64);
+  // LSC fmin and fmax ignore NaN operands, as minnumf and maxnumf do.
+  case mlir::arith::AtomicRMWKind::addf:
+  case mlir::arith::AtomicRMWKind::maxnumf:
+  case mlir::arith::AtomicRMWKind::minnumf:
+    return elemTy.isF32() || (elemTy.isF16() && nativeF16Atomics);
+  default:
+    return false;
+  }
+}
+
 /// Checks Given A,B, C, D Matrix Data types to HW supported configs and
 /// verifies HW restrictions for supported combinations.
 mlir::LogicalResult XePVCuArch::checkSupportedDpasTypes(mlir::Operation *op,
@@ -56,9 +93,10 @@ mlir::LogicalResult XePVCuArch::checkSupportedDpasTypes(mlir::Operation *op,
              << "AType: " << AType << " BType: " << BType << " CType: " << CType
              << " DType: " << DType;
   } else if (!(AType.isInteger(2) || AType.isInteger(4) ||
-               AType.isInteger(8)) &&
+               AType.isInteger(8)) ||
              !(BType.isInteger(2) || BType.isInteger(4) ||
-               BType.isInteger(8))) {
+               BType.isInteger(8)) ||
+             (CType && !CType.isInteger(32)) || !DType.isInteger(32)) {
     return op->emitOpError()
            << "Unsupported dpas combinations of Dst, Acc, A and B matrices, "
            << "Supported types are:\n"
@@ -266,18 +266,18 @@ unsigned encodeOpcode(mlir::arith::AtomicRMWKind kind) {
   case mlir::arith::AtomicRMWKind::assign:
     encode = 10;
     break;
-  // case mlir::arith::AtomicRMWKind::maxf:
-  //   encode = 22;
-  //   break;
+  case mlir::arith::AtomicRMWKind::maxnumf:
+    encode = 22;
+    break;
   case mlir::arith::AtomicRMWKind::maxs:
     encode = 15;
     break;
   case mlir::arith::AtomicRMWKind::maxu:
     encode = 17;
     break;
-  // case mlir::arith::AtomicRMWKind::minf:
-  //   encode = 21;
-  //   break;
+  case mlir::arith::AtomicRMWKind::minnumf:
+    encode = 21;
+    break;
   case mlir::arith::AtomicRMWKind::mins:
     encode = 14;
     break;
@@ -10,5 +10,61 @@ module @arith_to_vc attributes {gpu.container_module} {
       %res1 = arith.maximumf %arg0, %arg1 : vector<16xf16>
       gpu.return
     }
+
+    // CHECK-LABEL: gpu.func @minimumf_f32
+    gpu.func @minimumf_f32(%arg0: vector<16xf32>, %arg1: vector<16xf32>) kernel attributes {VectorComputeFunctionINTEL, spirv.entry_point_abi = #spirv.entry_point_abi<>}{
+      // CHECK: %[[VC_RES:.*]] = func.call @llvm.genx.fmin.v16f32(%arg0, %arg1) : (vector<16xf32>, vector<16xf32>) -> vector<16xf32>
+      %res0 = arith.minimumf %arg0, %arg1 fastmath<nnan> : vector<16xf32>
+      // CHECK-NEXT: %[[UNCONVERTED_RES:.*]] = arith.minimumf %arg0, %arg1 : vector<16xf32>
+      %res1 = arith.minimumf %arg0, %arg1 : vector<16xf32>
+      gpu.return
+    }
+
+    // CHECK-LABEL: gpu.func @fma_f32
+    gpu.func @fma_f32(%arg0: vector<16xf32>, %arg1: vector<16xf32>, %arg2: vector<16xf32>) kernel attributes {VectorComputeFunctionINTEL, spirv.entry_point_abi = #spirv.entry_point_abi<>}{
+      // CHECK-NOT: arith.mulf %arg0, %arg1 fastmath<contract>
+      // CHECK: %[[FMA:.*]] = func.call @llvm.fma.v16f32(%arg0, %arg1, %arg2) : (vector<16xf32>, vector<16xf32>, vector<16xf32>) -> vector<16xf32>
+      %0 = arith.mulf %arg0, %arg1 fastmath<contract> : vector<16xf32>
+      %1 = arith.addf %arg2, %0 fastmath<contract> : vector<16xf32>
+      // CHECK-NEXT: %[[MUL:.*]] = arith.mulf %arg0, %arg1 : vector<16xf32>
+      // CHECK-NEXT: arith.addf %[[MUL]], %arg2 : vector<16xf32>
+      %2 = arith.mulf %arg0, %arg1 : vector<16xf32>
+      %3 = arith.addf %2, %arg2 : vector<16xf32>
+      gpu.return
+    }
+
+    // CHECK-LABEL: gpu.func @fptosi_sat
+    gpu.func @fptosi_sat(%arg0: vector<16xf32>) kernel attributes {VectorComputeFunctionINTEL, spirv.entry_point_abi = #spirv.entry_point_abi<>}{
+      // CHECK: func.call @llvm.genx.fptosi.sat.v16i8.v16f32(%arg0) : (vector<16xf32>) -> vector<16xi8>
+      %0 = arith.fptosi %arg0 : vector<16xf32> to vector<16xi8>
+      // CHECK: func.call @llvm.genx.fptoui.sat.v16i8.v16f32(%arg0) : (vector<16xf32>) -> vector<16xi8>
+      %1 = arith.fptoui %arg0 : vector<16xf32> to vector<16xi8>
+      gpu.return
+    }
+
+    // CHECK-LABEL: gpu.func @extf_bf16
+    gpu.func @extf_bf16(%arg0: vector<16xbf16>) kernel attributes {VectorComputeFunctionINTEL, spirv.entry_point_abi = #spirv.entry_point_abi<>}{
+      // CHECK: %[[C16:.*]] = arith.constant dense<16> : vector<16xi32>
+      // CHECK-NEXT: %[[BITS:.*]] = arith.bitcast %arg0 : vector<16xbf16> to vector<16xi16>
+      // CHECK-NEXT: %[[EXT:.*]] = arith.extui %[[BITS]] : vector<16xi16> to vector<16xi32>
+      // CHECK-NEXT: %[[SHL:.*]] = arith.shli %[[EXT]], %[[C16]] : vector<16xi32>
+      // CHECK-NEXT: arith.bitcast %[[SHL]] : vector<16xi32> to vector<16xf32>
+      %0 = arith.extf %arg0 : vector<16xbf16> to vector<16xf32>
+      gpu.return
+    }
+
+    // CHECK-LABEL: gpu.func @truncf_bf16
+    gpu.func @truncf_bf16(%arg0: vector<16xf32>) kernel attributes {VectorComputeFunctionINTEL, spirv.entry_point_abi = #spirv.entry_point_abi<>}{
+      // CHECK: %[[BITS:.*]] = arith.bitcast %arg0 : vector<16xf32> to vector<16xi32>
+      // CHECK: %[[ROUNDED:.*]] = arith.addi %[[BITS]], %{{.*}} : vector<16xi32>
+      // CHECK: %[[UPPER:.*]] = arith.shrui %[[ROUNDED]], %{{.*}} : vector<16xi32>
+      // CHECK: %[[NAN:.*]] = arith.cmpf uno, %arg0, %arg0 : vector<16xf32>
+      // CHECK: %[[QNAN:.*]] = arith.constant dense<32704> : vector<16xi32>
+      // CHECK: %[[RES:.*]] = arith.select %[[NAN]], %[[QNAN]], %[[UPPER]] : vector<16xi1>, vector<16xi32>
+      // CHECK: %[[TRUNC:.*]] = arith.trunci %[[RES]] : vector<16xi32> to vector<16xi16>
+      // CHECK: arith.bitcast %[[TRUNC]] : vector<16xi16> to vector<16xbf16>
+      %0 = arith.truncf %arg0 : vector<16xf32> to vector<16xbf16>
+      gpu.return
+    }
   }
 }
@@ -34,3 +34,60 @@ func.func @test_def_part2() -> (index, index, index, index, index, index, index,
 }
 // CHECK-LABEL: func.func @test_def_part2()
 // CHECK: return %c4, %c0, %c4, %c8, %c0, %c0, %c0, %c7
+
+// -----
+func.func @test_def_part_grid() -> (index, index, index, index, index, index, index, index) {
+    %c2 = arith.constant 2 : index
+    %c4 = arith.constant 4 : index
+    %c8 = arith.constant 8 : index
+    %c9 = arith.constant 9 : index
+    %o0:2, %s0:2 = "dist.default_partition"(%c4, %c2, %c8, %c8) {grid = array<i64: 2, 2>} : (index, index, index, index) -> (index, index, index, index)
+    %o1:2, %s1:2 = "dist.default_partition"(%c4, %c2, %c8, %c9) {grid = array<i64: 1, 4>} : (index, index, index, index) -> (index, index, index, index)
+    return %o0#0, %o0#1, %s0#0, %s0#1, %o1#0, %o1#1, %s1#0, %s1#1 : index, index, index, index, index, index, index, index
+}
+// CHECK-LABEL: func.func @test_def_part_grid()
+// CHECK: return %c4, %c0, %c4, %c4, %c0, %c4, %c8, %c2
+
+// -----
+func.func @test_def_part_grid_bb() -> (index, index, index, index) {
+    %c0 = arith.constant 0 : index
+    %c1 = arith.constant 1 : index
+    %c2 = arith.constant 2 : index
+    %c4 = arith.constant 4 : index
+    %c8 = arith.constant 8 : index
+    %o:2, %s:2 = "dist.default_partition"(%c4, %c2, %c8, %c8) {grid = array<i64: 2, 2>} : (index, index, index, index) -> (index, index, index, index)
+    // expected-error@+1 {{grid partitions are not supported}}
+    %bo:2, %bs:2 = dist.local_bounding_box false[%c0, %c0] [%c8, %c8] [%c1, %c1] [%o#0, %o#1] [%s#0, %s#1] : index, index, index, index
+    return %bo#0, %bo#1, %bs#0, %bs#1 : index, index, index, index
+}
+
+// -----
+func.func @test_def_part_grid_dim0() -> (index, index, index, index) {
+    %c0 = arith.constant 0 : index
+    %c1 = arith.constant 1 : index
+    %c2 = arith.constant 2 : index
+    %c4 = arith.constant 4 : index
+    %c8 = arith.constant 8 : index
+    %o:2, %s:2 = "dist.default_partition"(%c4, %c2, %c8, %c8) {grid = array<i64: 4, 1>} : (index, index, index, index) -> (index, index, index, index)
+    %bo:2, %bs:2 = dist.local_bounding_box false[%c0, %c0] [%c8, %c8] [%c1, %c1] [%o#0, %o#1] [%s#0, %s#1] : index, index, index, index
+    return %bo#0, %bo#1, %bs#0, %bs#1 : index, index, index, index
+}
+// CHECK-LABEL: func.func @test_def_part_grid_dim0()
+// CHECK: return %c4, %c0, %c2, %c8
+
+// -----
+func.func @test_weighted_part(%prank: index, %weights: memref<?xindex>) -> (index, index, index, index) {
+    %c8 = arith.constant 8 : index
+    %c16 = arith.constant 16 : index
+    %o:2, %s:2 = "dist.weighted_partition"(%prank, %weights, %c16, %c8) : (index, memref<?xindex>, index, index) -> (index, index, index, index)
+    return %o#0, %o#1, %s#0, %s#1 : index, index, index, index
+}
+// CHECK-LABEL: func.func @test_weighted_part
+// CHECK: memref.dim %arg1
+// CHECK: [[R:%.*]]:2 = scf.for
+// CHECK: memref.load %arg1
+// CHECK: scf.yield
+// CHECK: memref.load %arg1[%arg0]
+// CHECK: arith.muli
+// CHECK: arith.divsi
+// CHECK: return {{.*}}, %c0, {{.*}}, %c8
@@ -0,0 +1,17 @@
+// RUN: imex-opt --split-input-file --convert-dist-to-standard="nprocs=8 prank=7" -canonicalize %s -verify-diagnostics -o -| FileCheck %s
+// RUN: imex-opt --split-input-file --convert-dist-to-standard %s -verify-diagnostics -o -| FileCheck %s --check-prefix=DYN
+
+func.func @test_specialize() -> (index, index) {
+    %c33 = arith.constant 33 : index
+    %np = "distruntime.team_size"() <{team = 22 : i64}> : () -> index
+    %pr = "distruntime.team_member"() <{team = 22 : i64}> : () -> index
+    %o, %s = "dist.default_partition"(%np, %pr, %c33) : (index, index, index) -> (index, index)
+    return %o, %s : index, index
+}
+// CHECK-LABEL: func.func @test_specialize()
+// CHECK-NOT: distruntime.team_size
+// CHECK-NOT: distruntime.team_member
+// CHECK: return %c28, %c5
+// DYN-LABEL: func.func @test_specialize()
+// DYN: "distruntime.team_size"() <{team = 22 : i64}> : () -> index
+// DYN: "distruntime.team_member"() <{team = 22 : i64}> : () -> index
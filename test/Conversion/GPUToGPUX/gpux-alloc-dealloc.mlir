@@ -19,3 +19,12 @@ func.func @main() attributes {llvm.emit_c_interface} {
   // CHECK: "gpux.destroy_stream"(%[[STREAM]]) : (!gpux.StreamType) -> ()
   return
 }
+
+memref.global "private" constant @weights : memref<8xf32> = dense<1.000000e+00>
+
+// CHECK-LABEL: func.func @constant
+func.func @constant() {
+  // CHECK: "gpux.alloc"(%{{.*}}) <{operandSegmentSizes = array<i32: 0, 1, 0, 0>}> {imex.constant_data = @weights} : (!gpux.StreamType) -> memref<8xf32>
+  %memref = gpu.alloc () {imex.constant_data = @weights} : memref<8xf32>
+  return
+}
@@ -0,0 +1,15 @@
+// RUN: imex-opt --convert-gpu-to-gpux %s | FileCheck %s
+
+func.func @main() attributes {llvm.emit_c_interface} {
+  // CHECK: %[[STREAM:.*]] = "gpux.create_stream"() : () -> !gpux.StreamType
+  // CHECK: %[[T0:.*]] = "gpux.wait"(%[[STREAM]]) : (!gpux.StreamType) -> !gpu.async.token
+  %t0 = gpu.wait async
+  // CHECK: %[[ALLOC:.*]], %[[T1:.*]] = "gpux.alloc"(%[[T0]], %[[STREAM]]) <{operandSegmentSizes = array<i32: 1, 1, 0, 0>}> : (!gpu.async.token, !gpux.StreamType) -> (memref<8xf32>, !gpu.async.token)
+  %memref, %t1 = gpu.alloc async [%t0] () : memref<8xf32>
+  // CHECK: %[[T2:.*]] = "gpux.dealloc"(%[[T1]], %[[STREAM]], %[[ALLOC]]) : (!gpu.async.token, !gpux.StreamType, memref<8xf32>) -> !gpu.async.token
+  %t2 = gpu.dealloc async [%t1] %memref : memref<8xf32>
+  // CHECK: "gpux.wait"(%[[T2]], %[[STREAM]]) : (!gpu.async.token, !gpux.StreamType) -> ()
+  gpu.wait [%t2]
+  // CHECK: "gpux.destroy_stream"(%[[STREAM]]) : (!gpux.StreamType) -> ()
+  return
+}
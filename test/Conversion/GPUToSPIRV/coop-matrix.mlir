@@ -0,0 +1,35 @@
+// RUN: imex-opt --split-input-file -imex-convert-gpu-to-spirv -verify-diagnostics %s -o - | FileCheck %s
+
+module attributes {
+  gpu.container_module,
+  spirv.target_env = #spirv.target_env<#spirv.vce<v1.0,
+      [Addresses, Float16Buffer, Int64, Int16, Int8, Kernel, Linkage, Vector16, GenericPointer, Groups, Float16, Float64, AtomicFloat32AddEXT, ExpectAssumeKHR, CooperativeMatrixKHR],
+      [SPV_EXT_shader_atomic_float_add, SPV_KHR_cooperative_matrix, SPV_KHR_expect_assume]>, #spirv.resource_limits<>>
+} {
+  gpu.module @kernels {
+    // The kernel runs workgroups of one subgroup, its subgroup size is the
+    // size of its workgroups.
+    // CHECK-LABEL: spirv.func @matmul_tile
+    // CHECK-SAME: spirv.entry_point_abi = #spirv.entry_point_abi<subgroup_size = 16>
+    gpu.func @matmul_tile(%A: memref<8x32xf16>, %B: memref<32x16xf16>, %C: memref<8x16xf32>) kernel
+      attributes {known_block_size = array<i32: 16, 1, 1>, spirv.entry_point_abi = #spirv.entry_point_abi<>} {
+      %c0 = arith.constant 0 : index
+      %c16 = arith.constant 16 : index
+      %c32 = arith.constant 32 : index
+      // CHECK: spirv.KHR.CooperativeMatrixLoad %{{.*}}, %{{.*}}, <RowMajor> : !spirv.ptr<f32, CrossWorkgroup>, i32 -> !spirv.coopmatrix<8x16xf32, Subgroup, MatrixAcc>
+      %acc = gpu.subgroup_mma_load_matrix %C[%c0, %c0] {leadDimension = 16 : index} : memref<8x16xf32> -> !gpu.mma_matrix<8x16xf32, "COp">
+      %res = scf.for %k = %c0 to %c32 step %c16 iter_args(%iter = %acc) -> (!gpu.mma_matrix<8x16xf32, "COp">) {
+        // CHECK: spirv.KHR.CooperativeMatrixLoad %{{.*}}, %{{.*}}, <RowMajor> : !spirv.ptr<f16, CrossWorkgroup>, i32 -> !spirv.coopmatrix<8x16xf16, Subgroup, MatrixA>
+        // CHECK: spirv.KHR.CooperativeMatrixLoad %{{.*}}, %{{.*}}, <RowMajor> : !spirv.ptr<f16, CrossWorkgroup>, i32 -> !spirv.coopmatrix<16x16xf16, Subgroup, MatrixB>
+        // CHECK: spirv.KHR.CooperativeMatrixMulAdd %{{.*}}, %{{.*}}, %{{.*}} : !spirv.coopmatrix<8x16xf16, Subgroup, MatrixA>, !spirv.coopmatrix<16x16xf16, Subgroup, MatrixB> -> !spirv.coopmatrix<8x16xf32, Subgroup, MatrixAcc>
+        %a = gpu.subgroup_mma_load_matrix %A[%c0, %k] {leadDimension = 32 : index} : memref<8x32xf16> -> !gpu.mma_matrix<8x16xf16, "AOp">
+        %b = gpu.subgroup_mma_load_matrix %B[%k, %c0] {leadDimension = 16 : index} : memref<32x16xf16> -> !gpu.mma_matrix<16x16xf16, "BOp">
+        %new = gpu.subgroup_mma_compute %a, %b, %iter : !gpu.mma_matrix<8x16xf16, "AOp">, !gpu.mma_matrix<16x16xf16, "BOp"> -> !gpu.mma_matrix<8x16xf32, "COp">
+        scf.yield %new : !gpu.mma_matrix<8x16xf32, "COp">
+      }
+      // CHECK: spirv.KHR.CooperativeMatrixStore %{{.*}}, %{{.*}}, %{{.*}}, <RowMajor> : !spirv.ptr<f32, CrossWorkgroup>, !spirv.coopmatrix<8x16xf32, Subgroup, MatrixAcc>, i32
+      gpu.subgroup_mma_store_matrix %res, %C[%c0, %c0] {leadDimension = 16 : index} : !gpu.mma_matrix<8x16xf32, "COp">, memref<8x16xf32>
+      gpu.return
+    }
+  }
+}
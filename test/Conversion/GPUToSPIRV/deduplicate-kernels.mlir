@@ -0,0 +1,51 @@
+// RUN: imex-opt -imex-convert-gpu-to-spirv='deduplicate-kernels=1' %s -o - | FileCheck %s
+
+module attributes {
+  gpu.container_module,
+  spirv.target_env = #spirv.target_env<#spirv.vce<v1.0,
+      [Addresses, Float16Buffer, Int64, Int16, Int8, Kernel, Linkage, Vector16, GenericPointer, Groups, Float16, Float64, AtomicFloat32AddEXT, ExpectAssumeKHR],
+      [SPV_EXT_shader_atomic_float_add, SPV_KHR_expect_assume]>, #spirv.resource_limits<>>
+} {
+  // CHECK-LABEL: func.func @main
+  func.func @main(%arg0: memref<8xf32>, %arg1: memref<8xf32>) {
+    %c1 = arith.constant 1 : index
+    %c8 = arith.constant 8 : index
+    // CHECK: gpu.launch_func @main_kernel::@main_kernel
+    gpu.launch_func @main_kernel::@main_kernel blocks in (%c8, %c1, %c1) threads in (%c1, %c1, %c1) args(%arg0 : memref<8xf32>)
+    // CHECK: gpu.launch_func @main_kernel::@main_kernel
+    gpu.launch_func @main_kernel_0::@main_kernel_0 blocks in (%c8, %c1, %c1) threads in (%c1, %c1, %c1) args(%arg1 : memref<8xf32>)
+    // CHECK: gpu.launch_func @main_kernel_1::@main_kernel_1
+    gpu.launch_func @main_kernel_1::@main_kernel_1 blocks in (%c8, %c1, %c1) threads in (%c1, %c1, %c1) args(%arg1 : memref<8xf32>)
+    return
+  }
+
+  // CHECK: spirv.module @__spv__main_kernel
+  // CHECK: gpu.module @main_kernel
+  gpu.module @main_kernel {
+    gpu.func @main_kernel(%arg0: memref<8xf32>) kernel attributes {spirv.entry_point_abi = #spirv.entry_point_abi<>} {
+      %0 = gpu.block_id x
+      %cst = arith.constant 1.0 : f32
+      memref.store %cst, %arg0[%0] : memref<8xf32>
+      gpu.return
+    }
+  }
+  // CHECK-NOT: @main_kernel_0
+  gpu.module @main_kernel_0 {
+    gpu.func @main_kernel_0(%arg0: memref<8xf32>) kernel attributes {spirv.entry_point_abi = #spirv.entry_point_abi<>} {
+      %0 = gpu.block_id x
+      %cst = arith.constant 1.0 : f32
+      memref.store %cst, %arg0[%0] : memref<8xf32>
+      gpu.return
+    }
+  }
+  // CHECK: spirv.module @__spv__main_kernel_1
+  // CHECK: gpu.module @main_kernel_1
+  gpu.module @main_kernel_1 {
+    gpu.func @main_kernel_1(%arg0: memref<8xf32>) kernel attributes {spirv.entry_point_abi = #spirv.entry_point_abi<>} {
+      %0 = gpu.block_id x
+      %cst = arith.constant 2.0 : f32
+      memref.store %cst, %arg0[%0] : memref<8xf32>
+      gpu.return
+    }
+  }
+}
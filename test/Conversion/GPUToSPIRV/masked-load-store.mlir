@@ -0,0 +1,40 @@
+// RUN: imex-opt -imex-convert-gpu-to-spirv %s -o - | FileCheck %s
+
+module attributes {
+  gpu.container_module,
+  spirv.target_env = #spirv.target_env<#spirv.vce<v1.0,
+      [Addresses, Float16Buffer, Int64, Int16, Int8, Kernel, Linkage, Vector16, GenericPointer, Groups, Float16, Float64, AtomicFloat32AddEXT, ExpectAssumeKHR],
+      [SPV_EXT_shader_atomic_float_add, SPV_KHR_expect_assume]>, #spirv.resource_limits<>>
+} {
+  gpu.module @kernels {
+    gpu.func @masked_copy(%arg0: memref<?xf32>, %arg1: memref<?xf32>, %arg2: index) kernel attributes {spirv.entry_point_abi = #spirv.entry_point_abi<>} {
+      %c0 = arith.constant 0 : index
+      %pass = arith.constant dense<0.0> : vector<8xf32>
+      %mask = vector.create_mask %arg2 : vector<8xi1>
+      %v = vector.maskedload %arg0[%c0], %mask, %pass : memref<?xf32>, vector<8xi1>, vector<8xf32> into vector<8xf32>
+      vector.maskedstore %arg1[%c0], %mask, %v : memref<?xf32>, vector<8xi1>, vector<8xf32>
+      gpu.return
+    }
+  }
+}
+
+// The load: one vector load if all lanes are enabled, a load per enabled lane
+// otherwise.
+// CHECK-LABEL: spirv.func @masked_copy
+// CHECK: %[[MASK:.*]] = spirv.Bitcast %{{.*}} : i8 to vector<8xi1>
+// CHECK: %[[LO:.*]] = spirv.VectorShuffle [0 : i32, 1 : i32, 2 : i32, 3 : i32] %[[MASK]], %[[MASK]]
+// CHECK: %[[HI:.*]] = spirv.VectorShuffle [4 : i32, 5 : i32, 6 : i32, 7 : i32] %[[MASK]], %[[MASK]]
+// CHECK: spirv.LogicalAnd %[[LO]], %[[HI]] : vector<4xi1>
+// CHECK: spirv.LogicalAnd %{{.*}}, %{{.*}} : vector<2xi1>
+// CHECK: %[[ALL:.*]] = spirv.LogicalAnd %{{.*}}, %{{.*}} : i1
+// CHECK: spirv.BranchConditional %[[ALL]]
+// CHECK: spirv.Load "CrossWorkgroup" %{{.*}} : vector<8xf32>
+// CHECK-COUNT-8: spirv.BranchConditional
+// CHECK: spirv.Load "CrossWorkgroup" %{{.*}} : f32
+
+// The store, in the same way.
+// CHECK: spirv.BranchConditional
+// CHECK: spirv.Store "CrossWorkgroup" %{{.*}}, %{{.*}} : vector<8xf32>
+// CHECK-COUNT-8: spirv.BranchConditional
+// CHECK: spirv.Store "CrossWorkgroup" %{{.*}}, %{{.*}} : f32
+// CHECK: spirv.Return
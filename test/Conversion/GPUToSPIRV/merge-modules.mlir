@@ -0,0 +1,55 @@
+// RUN: imex-opt -imex-convert-gpu-to-spirv='merge-modules=1' %s -o - | FileCheck %s
+
+module attributes {
+  gpu.container_module,
+  spirv.target_env = #spirv.target_env<#spirv.vce<v1.0,
+      [Addresses, Float16Buffer, Int64, Int16, Int8, Kernel, Linkage, Vector16, GenericPointer, Groups, Float16, Float64, AtomicFloat32AddEXT, ExpectAssumeKHR],
+      [SPV_EXT_shader_atomic_float_add, SPV_KHR_expect_assume]>, #spirv.resource_limits<>>
+} {
+  // CHECK-LABEL: func.func @main
+  func.func @main(%arg0: memref<8xf32>, %arg1: memref<8xf32>) {
+    %c1 = arith.constant 1 : index
+    %c8 = arith.constant 8 : index
+    // CHECK: gpu.launch_func @fill_kernels::@fill
+    gpu.launch_func @fill_kernels::@fill blocks in (%c8, %c1, %c1) threads in (%c1, %c1, %c1) args(%arg0 : memref<8xf32>)
+    // CHECK: gpu.launch_func @fill_kernels::@scale
+    gpu.launch_func @scale_kernels::@scale blocks in (%c8, %c1, %c1) threads in (%c1, %c1, %c1) args(%arg1 : memref<8xf32>)
+    // CHECK: gpu.launch_func @fill_kernels::@fill_0
+    gpu.launch_func @fill_kernels_0::@fill blocks in (%c8, %c1, %c1) threads in (%c1, %c1, %c1) args(%arg1 : memref<8xf32>)
+    return
+  }
+
+  // CHECK: spirv.module @__spv__fill_kernels
+  // CHECK-DAG: spirv.func @fill(
+  // CHECK-DAG: spirv.func @scale(
+  // CHECK-DAG: spirv.func @fill_0(
+  // CHECK: gpu.module @fill_kernels
+  gpu.module @fill_kernels {
+    gpu.func @fill(%arg0: memref<8xf32>) kernel attributes {spirv.entry_point_abi = #spirv.entry_point_abi<>} {
+      %0 = gpu.block_id x
+      %cst = arith.constant 1.0 : f32
+      memref.store %cst, %arg0[%0] : memref<8xf32>
+      gpu.return
+    }
+  }
+  gpu.module @scale_kernels {
+    gpu.func @scale(%arg0: memref<8xf32>) kernel attributes {spirv.entry_point_abi = #spirv.entry_point_abi<>} {
+      %0 = gpu.block_id x
+      %cst = arith.constant 2.0 : f32
+      %1 = memref.load %arg0[%0] : memref<8xf32>
+      %2 = arith.mulf %1, %cst : f32
+      memref.store %2, %arg0[%0] : memref<8xf32>
+      gpu.return
+    }
+  }
+  gpu.module @fill_kernels_0 {
+    gpu.func @fill(%arg0: memref<8xf32>) kernel attributes {spirv.entry_point_abi = #spirv.entry_point_abi<>} {
+      %0 = gpu.block_id x
+      %cst = arith.constant 3.0 : f32
+      memref.store %cst, %arg0[%0] : memref<8xf32>
+      gpu.return
+    }
+  }
+  // CHECK-NOT: gpu.module @scale_kernels
+  // CHECK-NOT: gpu.module @fill_kernels_0
+}
@@ -0,0 +1,75 @@
+// RUN: imex-opt -imex-convert-gpu-to-spirv %s -o - | FileCheck %s
+// RUN: imex-opt -imex-convert-gpu-to-spirv='subgroup-size=32' %s -o - | FileCheck %s --check-prefix=OPTION
+
+module attributes {
+  gpu.container_module,
+  spirv.target_env = #spirv.target_env<#spirv.vce<v1.0,
+      [Addresses, Float16Buffer, Int64, Int16, Int8, Kernel, Linkage, Vector16, GenericPointer, Groups, Float16, Float64, AtomicFloat32AddEXT, ExpectAssumeKHR, SubgroupDispatch, VectorComputeINTEL, VectorAnyINTEL],
+      [SPV_EXT_shader_atomic_float_add, SPV_KHR_expect_assume, SPV_INTEL_vector_compute]>, #spirv.resource_limits<>>
+} {
+  // CHECK-LABEL: func.func @main
+  func.func @main(%arg0: memref<8xf32>) {
+    %c1 = arith.constant 1 : index
+    %c8 = arith.constant 8 : index
+    // CHECK: gpu.launch_func @kernels::@fill
+    gpu.launch_func @kernels::@fill blocks in (%c8, %c1, %c1) threads in (%c1, %c1, %c1) args(%arg0 : memref<8xf32>)
+    // CHECK: gpu.launch_func @kernels_0::@barrier
+    gpu.launch_func @kernels::@barrier blocks in (%c8, %c1, %c1) threads in (%c1, %c1, %c1)
+    // CHECK: gpu.launch_func @kernels::@copy
+    gpu.launch_func @kernels::@copy blocks in (%c8, %c1, %c1) threads in (%c1, %c1, %c1) args(%arg0 : memref<8xf32>)
+    return
+  }
+
+  // The kernels compiled with the scalar backend stay in @kernels, with their
+  // subgroup size in the entry point ABI.
+  // CHECK: spirv.module @__spv__kernels
+  // CHECK-NOT: spirv.func @barrier
+  // CHECK: spirv.func @fill
+  // CHECK-SAME: spirv.entry_point_abi = #spirv.entry_point_abi<subgroup_size = 16>
+  // CHECK: spirv.func @copy
+  // CHECK-SAME: spirv.entry_point_abi = #spirv.entry_point_abi<>
+  // CHECK: gpu.module @kernels
+  // CHECK-NOT: gpu.func @barrier
+  // CHECK: gpu.func @fill
+  // CHECK: gpu.func @copy
+
+  // The vector compute kernel gets a module of its own.
+  // CHECK: spirv.module @__spv__kernels_0
+  // CHECK-NOT: spirv.func @fill
+  // CHECK: spirv.func @barrier
+  // CHECK-SAME: spirv.entry_point_abi = #spirv.entry_point_abi<>
+  // CHECK: gpu.module @kernels_0
+  // CHECK-NOT: gpu.func @fill
+  // CHECK-NOT: gpu.func @copy
+  // CHECK: gpu.func @barrier
+  // CHECK-SAME: imex.vector_backend
+
+  // OPTION: spirv.func @fill
+  // OPTION-SAME: #spirv.entry_point_abi<subgroup_size = 16>
+  // OPTION: spirv.func @copy
+  // OPTION-SAME: #spirv.entry_point_abi<subgroup_size = 32>
+  // OPTION: spirv.func @barrier
+  // OPTION-SAME: #spirv.entry_point_abi<>
+  gpu.module @kernels {
+    func.func private @llvm.genx.nbarrier(i8, i8, i8) attributes {VectorComputeFunctionINTEL, linkage_attributes = #spirv.linkage_attributes<linkage_name = "llvm.genx.nbarrier", linkage_type = <Import>>}
+    gpu.func @fill(%arg0: memref<8xf32>) kernel attributes {imex.subgroup_size = 16 : i32, spirv.entry_point_abi = #spirv.entry_point_abi<>} {
+      %0 = gpu.block_id x
+      %cst = arith.constant 1.0 : f32
+      memref.store %cst, %arg0[%0] : memref<8xf32>
+      gpu.return
+    }
+    gpu.func @barrier() kernel attributes {VectorComputeFunctionINTEL, spirv.entry_point_abi = #spirv.entry_point_abi<>} {
+      %c0 = arith.constant 0 : i8
+      %c1 = arith.constant 1 : i8
+      func.call @llvm.genx.nbarrier(%c0, %c1, %c1) : (i8, i8, i8) -> ()
+      gpu.return
+    }
+    gpu.func @copy(%arg0: memref<8xf32>) kernel attributes {spirv.entry_point_abi = #spirv.entry_point_abi<>} {
+      %0 = gpu.block_id x
+      %c0 = arith.constant 0 : index
+      %1 = memref.load %arg0[%c0] : memref<8xf32>
+      memref.store %1, %arg0[%0] : memref<8xf32>
+      gpu.return
+    }
+  }
+}
@@ -0,0 +1,88 @@
+// RUN: imex-opt --split-input-file -imex-convert-gpu-to-spirv %s -o - | FileCheck %s
+
+module attributes {
+  gpu.container_module,
+  spirv.target_env = #spirv.target_env<#spirv.vce<v1.0,
+      [Addresses, Float16Buffer, Int64, Int16, Int8, Kernel, Linkage, Vector16, GenericPointer, Groups, GroupNonUniformArithmetic, Float16, Float64, AtomicFloat32AddEXT, ExpectAssumeKHR],
+      [SPV_EXT_shader_atomic_float_add, SPV_KHR_expect_assume]>, #spirv.resource_limits<>>
+} {
+  gpu.module @kernels {
+    gpu.func @reduce_add(%arg0: memref<8xf32>, %arg1: memref<1xf32>) kernel attributes {spirv.entry_point_abi = #spirv.entry_point_abi<>} {
+      %c0 = arith.constant 0 : index
+      %acc = arith.constant 1.0 : f32
+      %v = vector.load %arg0[%c0] : memref<8xf32>, vector<8xf32>
+      %r = vector.multi_reduction <add>, %v, %acc [0] : vector<8xf32> to f32
+      memref.store %r, %arg1[%c0] : memref<1xf32>
+      gpu.return
+    }
+  }
+}
+
+// CHECK-LABEL: spirv.func @reduce_add
+// CHECK: %[[ACC:.*]] = spirv.Constant 1.000000e+00 : f32
+// CHECK: %[[V:.*]] = spirv.Load "CrossWorkgroup" %{{.*}} : vector<8xf32>
+// CHECK: %[[LO4:.*]] = spirv.VectorShuffle [0 : i32, 1 : i32, 2 : i32, 3 : i32] %[[V]], %[[V]] : vector<8xf32>, vector<8xf32> -> vector<4xf32>
+// CHECK: %[[HI4:.*]] = spirv.VectorShuffle [4 : i32, 5 : i32, 6 : i32, 7 : i32] %[[V]], %[[V]] : vector<8xf32>, vector<8xf32> -> vector<4xf32>
+// CHECK: %[[S4:.*]] = spirv.FAdd %[[LO4]], %[[HI4]] : vector<4xf32>
+// CHECK: %[[LO2:.*]] = spirv.VectorShuffle [0 : i32, 1 : i32] %[[S4]], %[[S4]] : vector<4xf32>, vector<4xf32> -> vector<2xf32>
+// CHECK: %[[HI2:.*]] = spirv.VectorShuffle [2 : i32, 3 : i32] %[[S4]], %[[S4]] : vector<4xf32>, vector<4xf32> -> vector<2xf32>
+// CHECK: %[[S2:.*]] = spirv.FAdd %[[LO2]], %[[HI2]] : vector<2xf32>
+// CHECK: %[[E0:.*]] = spirv.CompositeExtract %[[S2]][0 : i32] : vector<2xf32>
+// CHECK: %[[E1:.*]] = spirv.CompositeExtract %[[S2]][1 : i32] : vector<2xf32>
+// CHECK: %[[S1:.*]] = spirv.FAdd %[[E0]], %[[E1]] : f32
+// CHECK: %[[R:.*]] = spirv.FAdd %[[S1]], %[[ACC]] : f32
+// CHECK: spirv.Store "CrossWorkgroup" %{{.*}}, %[[R]] : f32
+
+// -----
+
+module attributes {
+  gpu.container_module,
+  spirv.target_env = #spirv.target_env<#spirv.vce<v1.0,
+      [Addresses, Float16Buffer, Int64, Int16, Int8, Kernel, Linkage, Vector16, GenericPointer, Groups, GroupNonUniformArithmetic, Float16, Float64, AtomicFloat32AddEXT, ExpectAssumeKHR],
+      [SPV_EXT_shader_atomic_float_add, SPV_KHR_expect_assume]>, #spirv.resource_limits<>>
+} {
+  gpu.module @kernels {
+    gpu.func @reduce_max(%arg0: memref<16xi32>, %arg1: memref<1xi32>) kernel attributes {spirv.entry_point_abi = #spirv.entry_point_abi<>} {
+      %c0 = arith.constant 0 : index
+      %v = vector.load %arg0[%c0] : memref<16xi32>, vector<16xi32>
+      %r = vector.reduction <maxsi>, %v : vector<16xi32> into i32
+      memref.store %r, %arg1[%c0] : memref<1xi32>
+      gpu.return
+    }
+  }
+}
+
+// CHECK-LABEL: spirv.func @reduce_max
+// CHECK: spirv.CL.s_max %{{.*}}, %{{.*}} : vector<8xi32>
+// CHECK: spirv.CL.s_max %{{.*}}, %{{.*}} : vector<4xi32>
+// CHECK: spirv.CL.s_max %{{.*}}, %{{.*}} : vector<2xi32>
+// CHECK: spirv.CL.s_max %{{.*}}, %{{.*}} : i32
+// CHECK-NOT: spirv.CL.s_max
+// CHECK: spirv.Return
+
+// -----
+
+module attributes {
+  gpu.container_module,
+  spirv.target_env = #spirv.target_env<#spirv.vce<v1.0,
+      [Addresses, Float16Buffer, Int64, Int16, Int8, Kernel, Linkage, Vector16, GenericPointer, Groups, GroupNonUniformArithmetic, Float16, Float64, AtomicFloat32AddEXT, ExpectAssumeKHR],
+      [SPV_EXT_shader_atomic_float_add, SPV_KHR_expect_assume]>, #spirv.resource_limits<>>
+} {
+  gpu.module @kernels {
+    gpu.func @subgroup_reduce(%arg0: memref<2xf32>) kernel attributes {spirv.entry_point_abi = #spirv.entry_point_abi<>} {
+      %c0 = arith.constant 0 : index
+      %v = vector.load %arg0[%c0] : memref<2xf32>, vector<2xf32>
+      %r = gpu.subgroup_reduce add %v : (vector<2xf32>) -> vector<2xf32>
+      vector.store %r, %arg0[%c0] : memref<2xf32>, vector<2xf32>
+      gpu.return
+    }
+  }
+}
+
+// CHECK-LABEL: spirv.func @subgroup_reduce
+// CHECK: %[[E0:.*]] = spirv.CompositeExtract %{{.*}}[0 : i32] : vector<2xf32>
+// CHECK: %[[R0:.*]] = spirv.GroupNonUniformFAdd <Subgroup> <Reduce> %[[E0]] : f32
+// CHECK: %[[E1:.*]] = spirv.CompositeExtract %{{.*}}[1 : i32] : vector<2xf32>
+// CHECK: %[[R1:.*]] = spirv.GroupNonUniformFAdd <Subgroup> <Reduce> %[[E1]] : f32
+// CHECK: spirv.CompositeInsert %[[R0]]
+// CHECK: spirv.CompositeInsert %[[R1]]
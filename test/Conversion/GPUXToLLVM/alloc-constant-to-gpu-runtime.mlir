@@ -0,0 +1,19 @@
+// RUN: imex-opt -convert-func-to-llvm -convert-gpux-to-llvm %s | FileCheck %s
+
+module attributes {gpu.container_module}{
+  memref.global "private" constant @weights : memref<8xf32> = dense<1.000000e+00>
+
+  // CHECK-LABEL: llvm.func @main
+  func.func @main() attributes {llvm.emit_c_interface} {
+    %0 = "gpux.create_stream"() : () -> !gpux.StreamType
+    // CHECK: %[[GLOBAL:.*]] = memref.get_global @weights : memref<8xf32>
+    // CHECK: %[[INDEX:.*]] = memref.extract_aligned_pointer_as_index %[[GLOBAL]] : memref<8xf32> -> index
+    // CHECK: %[[INT:.*]] = builtin.unrealized_conversion_cast %[[INDEX]] : index to i64
+    // CHECK: %[[PTR:.*]] = llvm.inttoptr %[[INT]] : i64 to !llvm.ptr
+    // CHECK: llvm.call @gpuMemAllocConstant(%{{.*}}, %[[PTR]], %{{.*}}, %{{.*}}) : (!llvm.ptr, !llvm.ptr, i64, i64) -> !llvm.ptr
+    // CHECK-NOT: llvm.call @gpuMemAlloc(
+    %memref = "gpux.alloc"(%0) {operandSegmentSizes = array<i32: 0, 1, 0, 0>, imex.constant_data = @weights} : (!gpux.StreamType) -> memref<8xf32>
+    "gpux.destroy_stream"(%0) : (!gpux.StreamType) -> ()
+    return
+  }
+}
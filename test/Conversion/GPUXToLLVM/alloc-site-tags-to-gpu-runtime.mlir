@@ -0,0 +1,32 @@
+// RUN: imex-opt -convert-func-to-llvm -convert-gpux-to-llvm='alloc-site-tags=1' %s | FileCheck %s
+
+module attributes {gpu.container_module}{
+  // CHECK-DAG: llvm.mlir.global internal constant @main_alloc_site("main\00")
+  // CHECK-DAG: llvm.mlir.global internal constant @other_alloc_site("other\00")
+  // CHECK-LABEL: llvm.func @main
+  func.func @main() attributes {llvm.emit_c_interface} {
+    %0 = "gpux.create_stream"() : () -> !gpux.StreamType
+    // CHECK: llvm.mlir.addressof @main_alloc_site : !llvm.ptr
+    // CHECK: llvm.call @gpuMemAllocTagged(%{{.*}}, %{{.*}}, %{{.*}}, %{{.*}}, %{{.*}}) : (!llvm.ptr, i64, i64, i32, !llvm.ptr) -> !llvm.ptr
+    %memref = "gpux.alloc"(%0) {operandSegmentSizes = array<i32: 0, 1, 0, 0>} : (!gpux.StreamType) -> memref<8xf32>
+    // CHECK: llvm.mlir.addressof @main_alloc_site : !llvm.ptr
+    // CHECK: llvm.call @gpuMemAllocTagged
+    %memref2 = "gpux.alloc"(%0) {operandSegmentSizes = array<i32: 0, 1, 0, 0>, hostShared} : (!gpux.StreamType) -> memref<16xf32>
+    // CHECK-NOT: llvm.call @gpuMemAlloc(
+    "gpux.dealloc"(%0, %memref) : (!gpux.StreamType, memref<8xf32>) -> ()
+    "gpux.dealloc"(%0, %memref2) : (!gpux.StreamType, memref<16xf32>) -> ()
+    "gpux.destroy_stream"(%0) : (!gpux.StreamType) -> ()
+    return
+  }
+
+  // CHECK-LABEL: llvm.func @other
+  func.func @other() {
+    %0 = "gpux.create_stream"() : () -> !gpux.StreamType
+    // CHECK: llvm.mlir.addressof @other_alloc_site : !llvm.ptr
+    // CHECK: llvm.call @gpuMemAllocTagged
+    %memref = "gpux.alloc"(%0) {operandSegmentSizes = array<i32: 0, 1, 0, 0>} : (!gpux.StreamType) -> memref<8xf32>
+    "gpux.dealloc"(%0, %memref) : (!gpux.StreamType, memref<8xf32>) -> ()
+    "gpux.destroy_stream"(%0) : (!gpux.StreamType) -> ()
+    return
+  }
+}
@@ -0,0 +1,30 @@
+// RUN: imex-opt -convert-func-to-llvm -convert-gpux-to-llvm %s | FileCheck %s
+
+module attributes {gpu.container_module}{
+  // CHECK-LABEL: llvm.func @main
+  func.func @main(%value : f32) attributes {llvm.emit_c_interface} {
+    // CHECK: %[[STREAM:.*]] = llvm.call @gpuCreateStream
+    %0 = "gpux.create_stream"() : () -> !gpux.StreamType
+    // CHECK: llvm.call @gpuMemAlloc(%[[STREAM]]
+    // CHECK: %[[T0:.*]] = llvm.call @gpuBarrier(%[[STREAM]], %{{.*}}) : (!llvm.ptr, !llvm.ptr) -> !llvm.ptr
+    %src, %t0 = "gpux.alloc"(%0) {operandSegmentSizes = array<i32: 0, 1, 0, 0>} : (!gpux.StreamType) -> (memref<8xf32>, !gpu.async.token)
+    // CHECK: llvm.call @gpuMemAlloc(%[[STREAM]]
+    // CHECK-NOT: llvm.call @gpuBarrier
+    %dst, %t1 = "gpux.alloc"(%t0, %0) {operandSegmentSizes = array<i32: 1, 1, 0, 0>} : (!gpu.async.token, !gpux.StreamType) -> (memref<8xf32>, !gpu.async.token)
+    // CHECK: %[[T2:.*]] = llvm.call @gpuMemset(%[[STREAM]]
+    %t2 = "gpux.memset"(%t0, %0, %src, %value) : (!gpu.async.token, !gpux.StreamType, memref<8xf32>, f32) -> !gpu.async.token
+    // CHECK: %[[T3:.*]] = llvm.call @gpuBarrier(%[[STREAM]], %{{.*}}) : (!llvm.ptr, !llvm.ptr) -> !llvm.ptr
+    %t3 = "gpux.wait"(%t1, %t2, %0) : (!gpu.async.token, !gpu.async.token, !gpux.StreamType) -> !gpu.async.token
+    // CHECK: %[[T4:.*]] = llvm.call @gpuMemCopyAsync(%[[STREAM]]
+    %t4 = "gpux.memcpy"(%t3, %0, %dst, %src) : (!gpu.async.token, !gpux.StreamType, memref<8xf32>, memref<8xf32>) -> !gpu.async.token
+    // CHECK-NOT: llvm.call @gpuWaitEvents
+    // CHECK: llvm.call @gpuMemFreeAsync(%[[STREAM]], %{{.*}}, %{{.*}}) : (!llvm.ptr, !llvm.ptr, !llvm.ptr) -> ()
+    %t5 = "gpux.dealloc"(%t4, %0, %src) : (!gpu.async.token, !gpux.StreamType, memref<8xf32>) -> !gpu.async.token
+    // CHECK: llvm.call @gpuWait(%[[STREAM]]) : (!llvm.ptr) -> ()
+    "gpux.wait"(%t5, %0) : (!gpu.async.token, !gpux.StreamType) -> ()
+    // CHECK: llvm.call @gpuMemFree(%[[STREAM]]
+    "gpux.dealloc"(%0, %dst) : (!gpux.StreamType, memref<8xf32>) -> ()
+    "gpux.destroy_stream"(%0) : (!gpux.StreamType) -> ()
+    return
+  }
+}
@@ -11,4 +11,15 @@ module attributes {gpu.container_module}{
     "gpux.destroy_stream"(%0) : (!gpux.StreamType) -> ()
     return
   }
+
+  // CHECK-LABEL: llvm.func @substream
+  func.func @substream() {
+    // CHECK: %[[STREAM:.*]] = llvm.call @gpuCreateStream
+    %0 = "gpux.create_stream"() : () -> !gpux.StreamType
+    // CHECK: %[[INDEX:.*]] = llvm.mlir.constant(2 : i64) : i64
+    // CHECK: llvm.call @gpuStreamGetSubstream(%[[STREAM]], %[[INDEX]]) : (!llvm.ptr, i64) -> !llvm.ptr
+    %1 = "gpux.substream"(%0) {index = 2 : i64} : (!gpux.StreamType) -> !gpux.StreamType
+    "gpux.destroy_stream"(%0) : (!gpux.StreamType) -> ()
+    return
+  }
 }
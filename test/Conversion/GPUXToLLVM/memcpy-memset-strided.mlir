@@ -0,0 +1,41 @@
+// RUN: imex-opt -convert-func-to-llvm -convert-gpux-to-llvm %s -split-input-file -verify-diagnostics | FileCheck %s
+
+// Contiguous memrefs with an offset are copied from their first element.
+module attributes {gpu.container_module}{
+  // CHECK-LABEL: llvm.func @contiguous
+  func.func @contiguous(%src : memref<4x8xf32, strided<[8, 1], offset: 16>>, %dst : memref<4x8xf32>, %value : f32) {
+    %0 = "gpux.create_stream"() : () -> !gpux.StreamType
+    // CHECK: llvm.getelementptr %{{.*}}[%{{.*}}] : (!llvm.ptr, i64) -> !llvm.ptr, f32
+    // CHECK: llvm.call @gpuMemCopy
+    "gpux.memcpy"(%0, %dst, %src) : (!gpux.StreamType, memref<4x8xf32>, memref<4x8xf32, strided<[8, 1], offset: 16>>) -> ()
+    // CHECK: llvm.call @gpuMemset
+    "gpux.memset"(%0, %src, %value) : (!gpux.StreamType, memref<4x8xf32, strided<[8, 1], offset: 16>>, f32) -> ()
+    "gpux.destroy_stream"(%0) : (!gpux.StreamType) -> ()
+    return
+  }
+}
+
+// -----
+
+// A copy of a column of a row-major matrix would also copy the gaps.
+module attributes {gpu.container_module}{
+  func.func @strided_copy(%src : memref<4x1xf32, strided<[8, 1]>>, %dst : memref<4x1xf32>) {
+    %0 = "gpux.create_stream"() : () -> !gpux.StreamType
+    // expected-error@+1 {{failed to legalize operation 'gpux.memcpy'}}
+    "gpux.memcpy"(%0, %dst, %src) : (!gpux.StreamType, memref<4x1xf32>, memref<4x1xf32, strided<[8, 1]>>) -> ()
+    "gpux.destroy_stream"(%0) : (!gpux.StreamType) -> ()
+    return
+  }
+}
+
+// -----
+
+module attributes {gpu.container_module}{
+  func.func @strided_memset(%dst : memref<4x4xf32, strided<[8, 1]>>, %value : f32) {
+    %0 = "gpux.create_stream"() : () -> !gpux.StreamType
+    // expected-error@+1 {{failed to legalize operation 'gpux.memset'}}
+    "gpux.memset"(%0, %dst, %value) : (!gpux.StreamType, memref<4x4xf32, strided<[8, 1]>>, f32) -> ()
+    "gpux.destroy_stream"(%0) : (!gpux.StreamType) -> ()
+    return
+  }
+}
@@ -0,0 +1,33 @@
+// RUN: imex-opt -convert-func-to-llvm -convert-gpux-to-llvm %s | FileCheck %s
+
+module attributes {gpu.container_module}{
+  // CHECK-LABEL: llvm.func @main
+  func.func @main(%value : f32) attributes {llvm.emit_c_interface} {
+    // CHECK: %[[STREAM:.*]] = llvm.call @gpuCreateStream(%{{.*}}, %{{.*}}) : (!llvm.ptr, !llvm.ptr) -> !llvm.ptr
+    %0 = "gpux.create_stream"() : () -> !gpux.StreamType
+    %src = "gpux.alloc"(%0) {operandSegmentSizes = array<i32: 0, 1, 0, 0>, hostShared} : (!gpux.StreamType) -> memref<8xf32>
+    %dst = "gpux.alloc"(%0) {operandSegmentSizes = array<i32: 0, 1, 0, 0>} : (!gpux.StreamType) -> memref<8xf32>
+    // CHECK: llvm.call @gpuMemCopy(%[[STREAM]], %{{.*}}, %{{.*}}, %{{.*}}) : (!llvm.ptr, !llvm.ptr, !llvm.ptr, i64) -> ()
+    "gpux.memcpy"(%0, %dst, %src) : (!gpux.StreamType, memref<8xf32>, memref<8xf32>) -> ()
+    // CHECK: %[[COPY:.*]] = llvm.call @gpuMemCopyAsync(%[[STREAM]], %{{.*}}, %{{.*}}, %{{.*}}, %{{.*}}) : (!llvm.ptr, !llvm.ptr, !llvm.ptr, i64, !llvm.ptr) -> !llvm.ptr
+    %t0 = "gpux.memcpy"(%0, %src, %dst) : (!gpux.StreamType, memref<8xf32>, memref<8xf32>) -> !gpu.async.token
+    // CHECK: llvm.insertvalue %[[COPY]], %{{.*}}[0] : !llvm.struct<(ptr)>
+    // CHECK: llvm.store %{{.*}}, %{{.*}} : f32, !llvm.ptr
+    // CHECK: llvm.call @gpuMemset(%[[STREAM]], %{{.*}}, %{{.*}}, %{{.*}}, %{{.*}}, %{{.*}}) : (!llvm.ptr, !llvm.ptr, !llvm.ptr, i64, i64, !llvm.ptr) -> !llvm.ptr
+    // CHECK-NOT: llvm.call @gpuWait
+    %t1 = "gpux.memset"(%t0, %0, %dst, %value) : (!gpu.async.token, !gpux.StreamType, memref<8xf32>, f32) -> !gpu.async.token
+    // CHECK: llvm.call @gpuMemset(%[[STREAM]], %{{.*}}, %{{.*}}, %{{.*}}, %{{.*}}, %{{.*}}) : (!llvm.ptr, !llvm.ptr, !llvm.ptr, i64, i64, !llvm.ptr) -> !llvm.ptr
+    // CHECK-NEXT: llvm.call @gpuWait(%[[STREAM]]) : (!llvm.ptr) -> ()
+    "gpux.memset"(%0, %src, %value) : (!gpux.StreamType, memref<8xf32>, f32) -> ()
+    // Zeros are filled with a one byte pattern.
+    // CHECK: %[[BYTE:.*]] = llvm.mlir.constant(0 : i8) : i8
+    // CHECK: llvm.store %[[BYTE]], %{{.*}} : i8, !llvm.ptr
+    // CHECK: llvm.call @gpuMemset(%[[STREAM]], %{{.*}}, %{{.*}}, %{{.*}}, %{{.*}}, %{{.*}})
+    %zero = arith.constant 0.0 : f32
+    "gpux.memset"(%0, %dst, %zero) : (!gpux.StreamType, memref<8xf32>, f32) -> ()
+    "gpux.dealloc"(%0, %src) : (!gpux.StreamType, memref<8xf32>) -> ()
+    "gpux.dealloc"(%0, %dst) : (!gpux.StreamType, memref<8xf32>) -> ()
+    "gpux.destroy_stream"(%0) : (!gpux.StreamType) -> ()
+    return
+  }
+}
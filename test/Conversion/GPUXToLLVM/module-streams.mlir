@@ -0,0 +1,33 @@
+// RUN: imex-opt -convert-func-to-llvm -convert-gpux-to-llvm='module-streams=1' %s | FileCheck %s
+
+module attributes {gpu.container_module}{
+  // CHECK: llvm.mlir.global internal @gpux_module_stream() {{.*}} : !llvm.ptr
+  // CHECK-LABEL: llvm.func internal @gpux_get_module_stream() -> !llvm.ptr
+  // CHECK: %[[ADDR:.*]] = llvm.mlir.addressof @gpux_module_stream : !llvm.ptr
+  // CHECK: %[[CACHED:.*]] = llvm.load %[[ADDR]] atomic acquire
+  // CHECK: llvm.cond_br
+  // CHECK: %[[NEW:.*]] = llvm.call @gpuCreateStream
+  // CHECK: llvm.cmpxchg %[[ADDR]], %{{.*}}, %[[NEW]] acq_rel acquire
+  // CHECK: llvm.call @gpuStreamDestroy(%[[NEW]])
+  // CHECK: llvm.return
+  // CHECK-LABEL: llvm.func internal @gpux_destroy_module_stream()
+  // CHECK: llvm.call @gpuStreamDestroy
+  // CHECK: llvm.mlir.global_dtors {dtors = [@gpux_destroy_module_stream]
+  // CHECK-LABEL: llvm.func @main
+  func.func @main() attributes {llvm.emit_c_interface} {
+    // CHECK: %[[STREAM:.*]] = llvm.call @gpux_get_module_stream() : () -> !llvm.ptr
+    // CHECK-NOT: gpuCreateStream
+    %0 = "gpux.create_stream"() : () -> !gpux.StreamType
+    // CHECK-NOT: gpuStreamDestroy
+    "gpux.destroy_stream"(%0) : (!gpux.StreamType) -> ()
+    return
+  }
+
+  // CHECK-LABEL: llvm.func @other
+  func.func @other() {
+    // CHECK: llvm.call @gpux_get_module_stream() : () -> !llvm.ptr
+    %0 = "gpux.create_stream"() : () -> !gpux.StreamType
+    "gpux.destroy_stream"(%0) : (!gpux.StreamType) -> ()
+    return
+  }
+}
@@ -0,0 +1,27 @@
+// RUN: imex-opt -convert-func-to-llvm -convert-gpux-to-llvm %s | FileCheck %s
+
+module attributes {gpu.container_module}{
+  // CHECK-LABEL: llvm.func @main
+  func.func @main() attributes {llvm.emit_c_interface} {
+    // CHECK: %[[STREAM:.*]] = llvm.call @gpuCreateStream
+    %0 = "gpux.create_stream"() : () -> !gpux.StreamType
+    // CHECK: llvm.call @gpuMemAlloc
+    %weights = "gpux.alloc"(%0) {operandSegmentSizes = array<i32: 0, 1, 0, 0>, hostShared} : (!gpux.StreamType) -> memref<8xf32>
+    // CHECK: %[[ADVICE:.*]] = llvm.mlir.constant(0 : i32) : i32
+    // CHECK-NEXT: llvm.call @gpuMemAdvise(%[[STREAM]], %{{.*}}, %{{.*}}, %[[ADVICE]]) : (!llvm.ptr, !llvm.ptr, i64, i32) -> ()
+    "gpux.mem_advise"(%0, %weights) {advice = "read_mostly"} : (!gpux.StreamType, memref<8xf32>) -> ()
+    // CHECK: %[[LOCATION:.*]] = llvm.mlir.constant(1 : i32) : i32
+    // CHECK-NEXT: llvm.call @gpuMemAdvise(%[[STREAM]], %{{.*}}, %{{.*}}, %[[LOCATION]]) : (!llvm.ptr, !llvm.ptr, i64, i32) -> ()
+    "gpux.mem_advise"(%0, %weights) {advice = "preferred_location"} : (!gpux.StreamType, memref<8xf32>) -> ()
+    // CHECK: llvm.call @gpuMemPrefetch(%[[STREAM]], %{{.*}}, %{{.*}}, %{{.*}}) : (!llvm.ptr, !llvm.ptr, i64, !llvm.ptr) -> !llvm.ptr
+    // CHECK-NOT: llvm.call @gpuWait
+    "gpux.prefetch"(%0, %weights) : (!gpux.StreamType, memref<8xf32>) -> ()
+    // CHECK: %[[EVENT:.*]] = llvm.call @gpuMemPrefetch(%[[STREAM]], %{{.*}}, %{{.*}}, %{{.*}}) : (!llvm.ptr, !llvm.ptr, i64, !llvm.ptr) -> !llvm.ptr
+    %t0 = "gpux.prefetch"(%0, %weights) : (!gpux.StreamType, memref<8xf32>) -> !gpu.async.token
+    // CHECK: llvm.insertvalue %[[EVENT]], %{{.*}}[0] : !llvm.struct<(ptr)>
+    // CHECK: llvm.call @gpuMemFreeAsync
+    "gpux.dealloc"(%t0, %0, %weights) : (!gpu.async.token, !gpux.StreamType, memref<8xf32>) -> ()
+    "gpux.destroy_stream"(%0) : (!gpux.StreamType) -> ()
+    return
+  }
+}
@@ -0,0 +1,43 @@
+// RUN: imex-opt -convert-func-to-llvm -convert-gpux-to-llvm='preload-modules=1' %s | FileCheck %s
+
+module attributes {gpu.container_module} {
+  // CHECK-LABEL: llvm.func @main
+  func.func @main() attributes {llvm.emit_c_interface} {
+    %c1 = arith.constant 1 : index
+    %0 = "gpux.create_stream"() : () -> !gpux.StreamType
+    // CHECK: llvm.call @gpuModuleLoad
+    "gpux.launch_func"(%0, %c1, %c1, %c1, %c1, %c1, %c1) {kernel = @Kernels::@kernel_1, operandSegmentSizes = array<i32: 0, 1, 1, 1, 1, 1, 1, 1, 0, 0>} : (!gpux.StreamType, index, index, index, index, index, index) -> ()
+    // CHECK: llvm.call @gpuModuleLoad
+    "gpux.launch_func"(%0, %c1, %c1, %c1, %c1, %c1, %c1) {kernel = @Kernels::@kernel_1, operandSegmentSizes = array<i32: 0, 1, 1, 1, 1, 1, 1, 1, 0, 0>} : (!gpux.StreamType, index, index, index, index, index, index) -> ()
+    // CHECK: llvm.call @gpuModuleLoadWithGRFSize
+    "gpux.launch_func"(%0, %c1, %c1, %c1, %c1, %c1, %c1) {kernel = @LargeGRF::@kernel_2, operandSegmentSizes = array<i32: 0, 1, 1, 1, 1, 1, 1, 1, 0, 0>} : (!gpux.StreamType, index, index, index, index, index, index) -> ()
+    "gpux.destroy_stream"(%0) : (!gpux.StreamType) -> ()
+    return
+  }
+
+  // Each module is preloaded once, with the options of its load.
+  // CHECK-LABEL: llvm.func internal @gpux_preload_modules()
+  // CHECK: %[[DATA:.*]] = llvm.mlir.addressof @Kernels_spirv_binary : !llvm.ptr
+  // CHECK: %[[SIZE:.*]] = llvm.mlir.constant(4 : i64) : i64
+  // CHECK: %[[GRF:.*]] = llvm.mlir.constant(0 : i32) : i32
+  // CHECK: %[[VC:.*]] = llvm.mlir.constant(0 : i32) : i32
+  // CHECK: %[[NULL:.*]] = llvm.mlir.zero : !llvm.ptr
+  // CHECK: llvm.call @gpuModulePreload(%[[DATA]], %[[SIZE]], %[[GRF]], %[[VC]], %[[NULL]]) : (!llvm.ptr, i64, i32, i32, !llvm.ptr) -> ()
+  // CHECK: llvm.mlir.addressof @LargeGRF_spirv_binary : !llvm.ptr
+  // CHECK: llvm.mlir.constant(256 : i32) : i32
+  // CHECK: llvm.call @gpuModulePreload
+  // CHECK-NOT: llvm.call @gpuModulePreload
+  // CHECK: llvm.return
+  // CHECK: llvm.mlir.global_ctors {ctors = [@gpux_preload_modules], priorities = [65535 : i32]}
+
+  gpu.module @Kernels attributes {gpu.binary = "\03\02#\07"} {
+    gpu.func @kernel_1() kernel attributes {spirv.entry_point_abi = #spirv.entry_point_abi<>} {
+      gpu.return
+    }
+  }
+  gpu.module @LargeGRF attributes {gpu.binary = "\03\02#\07\00"} {
+    gpu.func @kernel_2() kernel attributes {imex.grf_size = 256 : i32, spirv.entry_point_abi = #spirv.entry_point_abi<>} {
+      gpu.return
+    }
+  }
+}
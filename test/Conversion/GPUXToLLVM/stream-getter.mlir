@@ -0,0 +1,15 @@
+// RUN: imex-opt -convert-func-to-llvm -convert-gpux-to-llvm='stream-getter=imexSessionGetStream module-streams=1' %s | FileCheck %s
+
+module attributes {gpu.container_module}{
+  // CHECK-NOT: gpux_module_stream
+  // CHECK-LABEL: llvm.func @main
+  func.func @main() attributes {llvm.emit_c_interface} {
+    // CHECK: %[[STREAM:.*]] = llvm.call @imexSessionGetStream() : () -> !llvm.ptr
+    // CHECK-NOT: gpuCreateStream
+    %0 = "gpux.create_stream"() : () -> !gpux.StreamType
+    // CHECK-NOT: gpuStreamDestroy
+    "gpux.destroy_stream"(%0) : (!gpux.StreamType) -> ()
+    return
+  }
+  // CHECK: llvm.func @imexSessionGetStream() -> !llvm.ptr
+}
@@ -76,3 +76,68 @@ module @gemm attributes {gpu.container_module} {
 }
 
 // -----
+
+module @activations attributes {gpu.container_module} {
+  gpu.module @math_to_vc {
+    // CHECK-LABEL: gpu.func @sqrt_f32
+    gpu.func @sqrt_f32(%arg0: vector<16xf32>) kernel attributes {VectorComputeFunctionINTEL, spirv.entry_point_abi = #spirv.entry_point_abi<>}{
+      // CHECK: func.call @llvm.genx.sqrt.v16f32(%arg0) : (vector<16xf32>) -> vector<16xf32>
+      %0 = math.sqrt %arg0 : vector<16xf32>
+      // CHECK: func.call @llvm.genx.sin.v16f32(%arg0) : (vector<16xf32>) -> vector<16xf32>
+      %1 = math.sin %arg0 : vector<16xf32>
+      // CHECK: func.call @llvm.genx.cos.v16f32(%arg0) : (vector<16xf32>) -> vector<16xf32>
+      %2 = math.cos %arg0 : vector<16xf32>
+      gpu.return
+    }
+
+    // CHECK-LABEL: gpu.func @rsqrt_f16
+    // HIGH_PRECISION-LABEL: gpu.func @rsqrt_f16
+    gpu.func @rsqrt_f16(%arg0: vector<16xf16>) kernel attributes {VectorComputeFunctionINTEL, spirv.entry_point_abi = #spirv.entry_point_abi<>}{
+      // CHECK: func.call @llvm.genx.rsqrt.v16f16(%arg0) : (vector<16xf16>) -> vector<16xf16>
+      // HIGH_PRECISION: %[[EXTF:.*]] = arith.extf %arg0 : vector<16xf16> to vector<16xf32>
+      // HIGH_PRECISION-NEXT: %[[RSQRT:.*]] = func.call @llvm.genx.rsqrt.v16f32(%[[EXTF]]) : (vector<16xf32>) -> vector<16xf32>
+      // HIGH_PRECISION-NEXT: arith.truncf %[[RSQRT]] : vector<16xf32> to vector<16xf16>
+      %0 = math.rsqrt %arg0 : vector<16xf16>
+      gpu.return
+    }
+
+    // CHECK-LABEL: gpu.func @log_f32
+    gpu.func @log_f32(%arg0: vector<16xf32>) kernel attributes {VectorComputeFunctionINTEL, spirv.entry_point_abi = #spirv.entry_point_abi<>}{
+      // CHECK: %[[LOG2:.*]] = func.call @llvm.genx.log.v16f32(%arg0) : (vector<16xf32>) -> vector<16xf32>
+      // CHECK-NEXT: %[[LN2:.*]] = arith.constant dense<0.693{{.*}}> : vector<16xf32>
+      // CHECK-NEXT: arith.mulf %[[LOG2]], %[[LN2]] : vector<16xf32>
+      %0 = math.log %arg0 : vector<16xf32>
+      // CHECK: func.call @llvm.genx.log.v16f32(%arg0) : (vector<16xf32>) -> vector<16xf32>
+      // CHECK-NOT: arith.mulf
+      %1 = math.log2 %arg0 : vector<16xf32>
+      gpu.return
+    }
+
+    // CHECK-LABEL: gpu.func @tanh_f32
+    gpu.func @tanh_f32(%arg0: vector<16xf32>) kernel attributes {VectorComputeFunctionINTEL, spirv.entry_point_abi = #spirv.entry_point_abi<>}{
+      // CHECK: %[[ABS:.*]] = math.absf %arg0 : vector<16xf32>
+      // CHECK: %[[X2:.*]] = arith.mulf %arg0, %arg0 : vector<16xf32>
+      // CHECK: %[[SMALL:.*]] = arith.addf %arg0, %{{.*}} : vector<16xf32>
+      // CHECK: %[[EXP:.*]] = func.call @llvm.genx.exp.v16f32(%{{.*}}) : (vector<16xf32>) -> vector<16xf32>
+      // CHECK: %[[LARGE:.*]] = arith.select %{{.*}}, %{{.*}}, %{{.*}} : vector<16xi1>, vector<16xf32>
+      // CHECK: %[[HALF:.*]] = arith.constant dense<5.000000e-01> : vector<16xf32>
+      // CHECK: %[[IS_SMALL:.*]] = arith.cmpf olt, %[[ABS]], %[[HALF]] : vector<16xf32>
+      // CHECK: arith.select %[[IS_SMALL]], %[[SMALL]], %[[LARGE]] : vector<16xi1>, vector<16xf32>
+      // CHECK-NOT: math.tanh
+      %0 = math.tanh %arg0 : vector<16xf32>
+      gpu.return
+    }
+
+    // CHECK-LABEL: gpu.func @erf_bf16
+    gpu.func @erf_bf16(%arg0: vector<16xbf16>) kernel attributes {VectorComputeFunctionINTEL, spirv.entry_point_abi = #spirv.entry_point_abi<>}{
+      // CHECK: %[[EXTF:.*]] = arith.extf %arg0 : vector<16xbf16> to vector<16xf32>
+      // CHECK: math.absf %[[EXTF]] : vector<16xf32>
+      // CHECK: func.call @llvm.genx.exp.v16f32(%{{.*}}) : (vector<16xf32>) -> vector<16xf32>
+      // CHECK: %[[ERF:.*]] = arith.select %{{.*}}, %{{.*}}, %{{.*}} : vector<16xi1>, vector<16xf32>
+      // CHECK-NEXT: arith.truncf %[[ERF]] : vector<16xf32> to vector<16xbf16>
+      // CHECK-NOT: math.erf
+      %0 = math.erf %arg0 : vector<16xbf16>
+      gpu.return
+    }
+  }
+}
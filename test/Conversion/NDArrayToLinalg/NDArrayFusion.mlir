@@ -19,7 +19,7 @@ func.func @test_binop_fusion_arith(%arg0: !ndarray.ndarray<?xi64>, %arg1: !ndarr
 // CHECK-NEXT: arith.muli
 // CHECK: return %{{[0-9]+}} : memref<?xi64, strided<[?], offset: ?>>
 
-// NOTE tosa ewbinop with dynamic shapes are broadcast-aware and thus do not fuse
+// NOTE bitwise ewbinops on integers are lowered like arithmetic ops and fuse
 func.func @test_binop_fusion_tosa(%arg0: !ndarray.ndarray<5xi64>, %arg1: !ndarray.ndarray<5xi64>) -> !ndarray.ndarray<5xi64> {
     %0 = ndarray.ewbin %arg0, %arg1 {op = 4 : i32} : (!ndarray.ndarray<5xi64>, !ndarray.ndarray<5xi64>) -> !ndarray.ndarray<5xi64>
     %1 = ndarray.ewbin %0, %arg0 {op = 2 : i32} : (!ndarray.ndarray<5xi64>, !ndarray.ndarray<5xi64>) -> !ndarray.ndarray<5xi64>
@@ -95,3 +95,36 @@ func.func @test_binop_fusion_bcast3(%arg0: !ndarray.ndarray<?xi64>, %arg1: !ndar
 // CHECK-NEXT: arith.muli
 // CHECK-NEXT: arith.addi
 // CHECK: return %{{[0-9]+}} : memref<?x?xi64, strided<[?, ?], offset: ?>>
+
+// bitwise ops on integers lower to linalg.generic and fuse with dynamic shapes
+func.func @test_binop_fusion_bitwise(%arg0: !ndarray.ndarray<?xi64>, %arg1: !ndarray.ndarray<?xi64>, %arg2: !ndarray.ndarray<?xi64>) -> !ndarray.ndarray<?xi64> {
+    %0 = ndarray.ewbin %arg0, %arg1 {op = 21 : i32} : (!ndarray.ndarray<?xi64>, !ndarray.ndarray<?xi64>) -> !ndarray.ndarray<?xi64>
+    %1 = ndarray.ewbin %0, %arg2 {op = 24 : i32} : (!ndarray.ndarray<?xi64>, !ndarray.ndarray<?xi64>) -> !ndarray.ndarray<?xi64>
+    %2 = ndarray.ewbin %1, %arg0 {op = 2 : i32} : (!ndarray.ndarray<?xi64>, !ndarray.ndarray<?xi64>) -> !ndarray.ndarray<?xi64>
+    %3 = ndarray.ewbin %2, %arg1 {op = 3 : i32} : (!ndarray.ndarray<?xi64>, !ndarray.ndarray<?xi64>) -> !ndarray.ndarray<?xi64>
+    return %3 : !ndarray.ndarray<?xi64>
+}
+// CHECK-LABEL: @test_binop_fusion_bitwise
+// CHECK: tensor.empty
+// CHECK-NEXT: linalg.generic
+// CHECK-NEXT: bb
+// CHECK-NEXT: arith.muli
+// CHECK-NEXT: arith.subi
+// CHECK-NEXT: arith.andi
+// CHECK-NEXT: arith.shli
+// CHECK-NOT: linalg.generic
+// CHECK: return %{{[0-9]+}} : memref<?xi64, strided<[?], offset: ?>>
+
+// logical ops on booleans fuse as well
+func.func @test_unyop_fusion_logical(%arg0: !ndarray.ndarray<?xi1>, %arg1: !ndarray.ndarray<?xi1>) -> !ndarray.ndarray<?xi1> {
+    %0 = ndarray.ewbin %arg0, %arg1 {op = 14 : i32} : (!ndarray.ndarray<?xi1>, !ndarray.ndarray<?xi1>) -> !ndarray.ndarray<?xi1>
+    %1 = "ndarray.ewuny"(%0) {op = 32 : i32} : (!ndarray.ndarray<?xi1>) -> !ndarray.ndarray<?xi1>
+    return %1 : !ndarray.ndarray<?xi1>
+}
+// CHECK-LABEL: @test_unyop_fusion_logical
+// CHECK: linalg.generic
+// CHECK-NEXT: bb
+// CHECK-NEXT: arith.andi
+// CHECK-NEXT: arith.xori
+// CHECK-NOT: linalg.generic
+// CHECK: return
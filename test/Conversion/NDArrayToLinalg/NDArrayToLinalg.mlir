@@ -113,6 +113,28 @@ func.func @test_reshape2(%arg0: index) -> !ndarray.ndarray<?x?xi64> {
 // CHECK: tensor.reshape
 // CHECK-SAME: -> tensor<?x?xi64>
 
+// -----
+func.func @test_reshape_expand(%arg0: !ndarray.ndarray<12xi64>) -> !ndarray.ndarray<3x4xi64> {
+    %c3 = arith.constant 3 : index
+    %c4 = arith.constant 4 : index
+    %0 = "ndarray.reshape"(%arg0, %c3, %c4) : (!ndarray.ndarray<12xi64>, index, index) -> !ndarray.ndarray<3x4xi64>
+    return %0 : !ndarray.ndarray<3x4xi64>
+}
+// CHECK-LABEL: @test_reshape_expand
+// CHECK-NOT: tensor.reshape
+// CHECK: tensor.expand_shape %{{.*}} {{\[}}[0, 1]] {{.*}}: tensor<12xi64> into tensor<3x4xi64>
+
+// -----
+func.func @test_reshape_collapse(%arg0: !ndarray.ndarray<2x3x4xi64>) -> !ndarray.ndarray<6x4xi64> {
+    %c6 = arith.constant 6 : index
+    %c4 = arith.constant 4 : index
+    %0 = "ndarray.reshape"(%arg0, %c6, %c4) : (!ndarray.ndarray<2x3x4xi64>, index, index) -> !ndarray.ndarray<6x4xi64>
+    return %0 : !ndarray.ndarray<6x4xi64>
+}
+// CHECK-LABEL: @test_reshape_collapse
+// CHECK-NOT: tensor.reshape
+// CHECK: tensor.collapse_shape %{{.*}} {{\[}}[0, 1], [2]] : tensor<2x3x4xi64> into tensor<6x4xi64>
+
 // -----
 func.func @test_ewbin(%arg0: !ndarray.ndarray<?xi64>) -> !ndarray.ndarray<?xi64> {
     %0 = ndarray.ewbin %arg0, %arg0 {op = 21 : i32} : (!ndarray.ndarray<?xi64>, !ndarray.ndarray<?xi64>) -> !ndarray.ndarray<?xi64>
@@ -146,6 +168,20 @@ func.func @test_ewbin_bcast(%arg0: !ndarray.ndarray<?x?xi64>, %arg1: !ndarray.nd
 // CHECK: [[V3:%.*]] = bufferization.to_memref
 // CHECK: return [[V3]] : memref<?x?xi64, strided<[?, ?], offset: ?>>
 
+// -----
+func.func @test_ewbin_bcast_row(%arg0: !ndarray.ndarray<?x?xi64>, %arg1: !ndarray.ndarray<?xi64>) -> !ndarray.ndarray<?x?xi64> {
+    %0 = ndarray.ewbin %arg0, %arg1 {op = 0 : i32} : (!ndarray.ndarray<?x?xi64>, !ndarray.ndarray<?xi64>) -> !ndarray.ndarray<?x?xi64>
+    return %0 : !ndarray.ndarray<?x?xi64>
+}
+// CHECK-LABEL: #map = affine_map<(d0, d1) -> (d0, d1)>
+// CHECK: #map1 = affine_map<(d0, d1) -> (d1)>
+// CHECK-LABEL: @test_ewbin_bcast_row
+// CHECK: tensor.empty
+// CHECK-SAME: tensor<?x?xi64>
+// CHECK: linalg.generic {indexing_maps = [#map, #map1, #map], iterator_types = ["parallel", "parallel"]}
+// CHECK-SAME: ins(%{{.*}}, %{{.*}} : tensor<?x?xi64>, tensor<?xi64>)
+// CHECK: arith.addi
+
 // -----
 func.func @test_ewbin_3d(%arg0: !ndarray.ndarray<?x?x?xi64>) -> !ndarray.ndarray<?x?x?xi64> {
     %0 = ndarray.ewbin %arg0, %arg0 {op = 0 : i32} : (!ndarray.ndarray<?x?x?xi64>, !ndarray.ndarray<?x?x?xi64>) -> !ndarray.ndarray<?x?x?xi64>
@@ -184,6 +220,31 @@ func.func @test_reduction_3d(%arg0: !ndarray.ndarray<?x?x?xi64>) -> i64 {
 // CHECK: linalg.generic{{.*}}["reduction", "reduction", "reduction"]}{{.*}}outs([[C0]]
 // CHECK: return %{{.}} : i64
 
+// -----
+func.func @test_reduction_dims(%arg0: !ndarray.ndarray<?x?x?xi64>) -> !ndarray.ndarray<?xi64> {
+    %0 = ndarray.reduction %arg0 {op = 4 : i32, dims = array<i64: 0, -1>} : !ndarray.ndarray<?x?x?xi64> -> !ndarray.ndarray<?xi64>
+    return %0 : !ndarray.ndarray<?xi64>
+}
+// CHECK: #[[MAP0:.*]] = affine_map<(d0, d1, d2) -> (d0, d1, d2)>
+// CHECK: #[[MAP1:.*]] = affine_map<(d0, d1, d2) -> (d1)>
+// CHECK-LABEL: @test_reduction_dims
+// CHECK: [[D1:%.*]] = {{.*}}dim %{{.*}}, %{{.*}}
+// CHECK: [[E:%.*]] = tensor.empty([[D1]]) : tensor<?xi64>
+// CHECK: [[C0:%.*]] = linalg.fill {{.*}} outs([[E]]
+// CHECK: linalg.generic {indexing_maps = [#[[MAP0]], #[[MAP1]]], iterator_types = ["reduction", "parallel", "reduction"]}{{.*}}outs([[C0]]
+
+// -----
+func.func @test_reduction_keepdims(%arg0: !ndarray.ndarray<4x5xi64>) -> !ndarray.ndarray<4x1xi64> {
+    %0 = ndarray.reduction %arg0 {op = 4 : i32, dims = array<i64: 1>, keepdims} : !ndarray.ndarray<4x5xi64> -> !ndarray.ndarray<4x1xi64>
+    return %0 : !ndarray.ndarray<4x1xi64>
+}
+// CHECK: #[[MAP0:.*]] = affine_map<(d0, d1) -> (d0, d1)>
+// CHECK: #[[MAP1:.*]] = affine_map<(d0, d1) -> (d0, 0)>
+// CHECK-LABEL: @test_reduction_keepdims
+// CHECK: [[E:%.*]] = tensor.empty() : tensor<4x1xi64>
+// CHECK: [[C0:%.*]] = linalg.fill {{.*}} outs([[E]]
+// CHECK: linalg.generic {indexing_maps = [#[[MAP0]], #[[MAP1]]], iterator_types = ["parallel", "reduction"]}{{.*}}outs([[C0]]
+
 // -----
 func.func @test_insert_slice(%arg0: !ndarray.ndarray<?xi64>, %arg1: !ndarray.ndarray<?xi64>) {
     %i0 = arith.constant 0 : index
@@ -239,6 +300,25 @@ func.func @test_immutable_insert_slice(%arg0: !ndarray.ndarray<?xi64>, %arg1: !n
 // CHECK-NEXT: [[V0:%.*]] = tensor.insert_slice [[A1]] into [[A0]][%c0] [%c3] [%c1] : tensor<?xi64> into tensor<?xi64>
 // CHECK-NEXT: [[V1:%.*]] = bufferization.to_memref [[V0]]
 
+// -----
+// The destination is a temporary without other users, the slice gets copied
+// in place.
+func.func @test_immutable_insert_slice_inplace(%arg0: index, %arg1: !ndarray.ndarray<?xi64>) -> !ndarray.ndarray<?xi64> {
+    %i0 = arith.constant 0 : index
+    %i1 = arith.constant 1 : index
+    %i3 = arith.constant 3 : index
+    %0 = ndarray.create %arg0 {dtype = 2 : i8} : (index) -> !ndarray.ndarray<?xi64>
+    %1 = ndarray.immutable_insert_slice %arg1 into %0[%i0] [%i3] [%i1] : !ndarray.ndarray<?xi64> into !ndarray.ndarray<?xi64>
+    return %1 : !ndarray.ndarray<?xi64>
+}
+// CHECK-LABEL: @test_immutable_insert_slice_inplace
+// CHECK: [[E:%.*]] = tensor.empty
+// CHECK-NOT: tensor.insert_slice
+// CHECK: [[D:%.*]] = bufferization.to_memref [[E]]
+// CHECK: [[SV:%.*]] = memref.subview [[D]]
+// CHECK: memref.copy %{{.*}}, [[SV]]
+// CHECK: bufferization.to_memref [[E]]
+
 // -----
 func.func @test_dim(%arg0: !ndarray.ndarray<?xi64>) -> index {
     %c0 = arith.constant 0 : index
@@ -363,23 +443,51 @@ func.func @test_copy(%a: !ndarray.ndarray<?xi64>) -> !ndarray.ndarray<?xi64> {
 // CHECK-NEXT: bufferization.to_memref
 // CHECK-NEXT: arith.constant 0 : index
 // CHECK-NEXT: tensor.dim
-// CHECK-NEXT: memref.alloc
-// CHECK-NEXT: bufferization.to_memref
-// CHECK-NEXT: region.env_region "gpu_copy_op"
-// CHECK-NEXT: memref.copy
-// CHECK-NEXT: }
-// CHECK-NEXT: bufferization.to_tensor
+// CHECK-NEXT: [[SRC:%.*]] = bufferization.to_memref
+// CHECK-NEXT: [[T0:%.*]] = gpu.wait async
+// CHECK-NEXT: [[DST:%[^,]*]], [[T1:%.*]] = gpu.alloc async {{\[}}[[T0]]{{\]}} host_shared
+// CHECK-NEXT: [[T2:%.*]] = gpu.memcpy async {{\[}}[[T1]]{{\]}} [[DST]], [[SRC]]
+// CHECK-NEXT: bufferization.to_tensor [[DST]]
+// The copy is waited for by its consumer, the next copy.
+// CHECK-NEXT: gpu.wait {{\[}}[[T2]]{{\]}}
 // CHECK-NEXT: arith.constant 0 : index
 // CHECK-NEXT: tensor.dim
-// CHECK-NEXT: memref.alloc
-// CHECK-NEXT: bufferization.to_memref
-// CHECK-NEXT: region.env_region "gpu_copy_op"
-// CHECK-NEXT: memref.copy
-// CHECK-NEXT: }
-// CHECK-NEXT: bufferization.to_tensor
+// CHECK-NEXT: [[SRC:%.*]] = bufferization.to_memref
+// CHECK-NEXT: [[T0:%.*]] = gpu.wait async
+// CHECK-NEXT: [[DST:%[^,]*]], [[T1:%.*]] = gpu.alloc async {{\[}}[[T0]]{{\]}} host_shared
+// CHECK-NEXT: [[T2:%.*]] = gpu.memcpy async {{\[}}[[T1]]{{\]}} [[DST]], [[SRC]]
+// CHECK-NEXT: bufferization.to_tensor [[DST]]
+// CHECK-NEXT: gpu.wait {{\[}}[[T2]]{{\]}}
 // CHECK-NEXT: return
 // CHECK-SAME: memref<?xi64, strided<[?], offset: ?>>
 
+// -----
+func.func @test_copy_overlap(%a: !ndarray.ndarray<16xi64>, %b: !ndarray.ndarray<16xi64>) -> (!ndarray.ndarray<16xi64, #region.gpu_env<device = "XeGPU">>, !ndarray.ndarray<16xi64, #region.gpu_env<device = "XeGPU">>) {
+    %0 = ndarray.copy %a: !ndarray.ndarray<16xi64> -> !ndarray.ndarray<16xi64, #region.gpu_env<device = "XeGPU">>
+    %1 = ndarray.copy %b: !ndarray.ndarray<16xi64> -> !ndarray.ndarray<16xi64, #region.gpu_env<device = "XeGPU">>
+    return %0, %1 : !ndarray.ndarray<16xi64, #region.gpu_env<device = "XeGPU">>, !ndarray.ndarray<16xi64, #region.gpu_env<device = "XeGPU">>
+}
+// Independent copies are both in flight until their results are used.
+// CHECK-LABEL: func.func @test_copy_overlap
+// CHECK: [[A:%.*]] = gpu.memcpy async
+// CHECK-NOT: gpu.wait {{\[}}
+// CHECK: [[B:%.*]] = gpu.memcpy async
+// CHECK-NOT: gpu.wait {{\[}}
+// CHECK: gpu.wait {{\[}}[[A]]{{\]}}
+// CHECK-NEXT: gpu.wait {{\[}}[[B]]{{\]}}
+// CHECK-NEXT: return
+
+// -----
+func.func @test_copy_strided(%a: !ndarray.ndarray<?xi64, #region.gpu_env<device = "XeGPU">>) -> !ndarray.ndarray<?xi64> {
+    %0 = ndarray.copy %a: !ndarray.ndarray<?xi64, #region.gpu_env<device = "XeGPU">> -> !ndarray.ndarray<?xi64>
+    return %0 : !ndarray.ndarray<?xi64>
+}
+// Copies from possibly strided views stay element-wise.
+// CHECK-LABEL: func.func @test_copy_strided
+// CHECK-NOT: gpu.memcpy
+// CHECK: region.env_region "gpu_copy_op"
+// CHECK-NEXT: memref.copy
+
 // -----
 func.func @test_delete(%arg0: !ndarray.ndarray<?xi64>) {
     ndarray.delete %arg0 : !ndarray.ndarray<?xi64>
@@ -413,6 +521,20 @@ func.func @test_cast_elemtype_f32f64(%arg0: !ndarray.ndarray<16xf32>) -> !ndarra
 // CHECK: arith.extf
 // CHECK: } -> tensor<16xf64>
 
+// -----
+func.func @test_ewbin_cast_elemtype(%arg0: !ndarray.ndarray<16xf32>, %arg1: !ndarray.ndarray<16xf64>) -> !ndarray.ndarray<16xf64> {
+    %0 = ndarray.cast_elemtype %arg0 : !ndarray.ndarray<16xf32> to !ndarray.ndarray<16xf64>
+    %1 = ndarray.ewbin %0, %arg1 {op = 0 : i32} : (!ndarray.ndarray<16xf64>, !ndarray.ndarray<16xf64>) -> !ndarray.ndarray<16xf64>
+    return %1 : !ndarray.ndarray<16xf64>
+  }
+// CHECK-LABEL: @test_ewbin_cast_elemtype
+// CHECK: linalg.generic {{.*}} ins(%{{.*}}, %{{.*}} : tensor<16xf32>, tensor<16xf64>)
+// CHECK-NEXT: ^bb0
+// CHECK-NEXT: arith.extf
+// CHECK-NEXT: arith.addf
+// CHECK-NEXT: linalg.yield
+// CHECK-NEXT: } -> tensor<16xf64>
+
 // -----
 func.func @test_cast_elemtype_i32f32(%arg0: !ndarray.ndarray<16xi32>) -> !ndarray.ndarray<16xf32> {
     %0 = ndarray.cast_elemtype %arg0 : !ndarray.ndarray<16xi32> to !ndarray.ndarray<16xf32>
@@ -67,3 +67,58 @@ func.func @test_convert_region_parloop_combined(%arg0 : index, %arg1 : index, %a
 // CHECK: region.env_region #region.gpu_env<device = "test">
 // CHECK: gpu.launch
 // CHECK: scf.parallel
+
+// -----
+func.func @test_convert_region_parloop_fused(%arg0 : index, %arg1 : index,
+                              %buf : memref<?xf32>,
+                              %tmp : memref<?xf32>,
+                              %res : memref<?xf32>) {
+  %c1 = arith.constant 1 : index
+  region.env_region #region.gpu_env<device = "test"> {
+    scf.parallel (%i) = (%arg0) to (%arg1) step (%c1) {
+      %val = memref.load %buf[%i] : memref<?xf32>
+      %neg = arith.negf %val : f32
+      memref.store %neg, %tmp[%i] : memref<?xf32>
+    } { mapping = [#gpu.loop_dim_map<processor = block_x, map = (d0) -> (d0), bound = (d0) -> (d0)>] }
+    scf.parallel (%i) = (%arg0) to (%arg1) step (%c1) {
+      %val = memref.load %tmp[%i] : memref<?xf32>
+      %exp = math.exp %val : f32
+      memref.store %exp, %res[%i] : memref<?xf32>
+    } { mapping = [#gpu.loop_dim_map<processor = block_x, map = (d0) -> (d0), bound = (d0) -> (d0)>] }
+    region.env_region_yield
+  }
+  return
+}
+// CHECK: test_convert_region_parloop_fused
+// CHECK: region.env_region #region.gpu_env<device = "test">
+// CHECK: gpu.launch
+// CHECK: arith.negf
+// CHECK: math.exp
+// CHECK: gpu.terminator
+// CHECK-NOT: gpu.launch
+// CHECK: return
+
+// -----
+func.func @test_convert_region_parloop_not_fused(%arg0 : index, %arg1 : index,
+                              %buf : memref<?xf32>,
+                              %tmp : memref<?xf32>,
+                              %res : memref<?xf32>) {
+  %c1 = arith.constant 1 : index
+  region.env_region #region.gpu_env<device = "test"> {
+    scf.parallel (%i) = (%arg0) to (%arg1) step (%c1) {
+      %val = memref.load %buf[%i] : memref<?xf32>
+      memref.store %val, %tmp[%i] : memref<?xf32>
+    } { mapping = [#gpu.loop_dim_map<processor = block_x, map = (d0) -> (d0), bound = (d0) -> (d0)>] }
+    // reads the neighbour written by another iteration of the first loop
+    scf.parallel (%i) = (%arg0) to (%arg1) step (%c1) {
+      %j = arith.addi %i, %c1 : index
+      %val = memref.load %tmp[%j] : memref<?xf32>
+      memref.store %val, %res[%i] : memref<?xf32>
+    } { mapping = [#gpu.loop_dim_map<processor = block_x, map = (d0) -> (d0), bound = (d0) -> (d0)>] }
+    region.env_region_yield
+  }
+  return
+}
+// CHECK: test_convert_region_parloop_not_fused
+// CHECK: gpu.launch
+// CHECK: gpu.launch
@@ -0,0 +1,53 @@
+// RUN: imex-opt -convert-xegpu-to-vc -cse  %s | FileCheck %s
+
+gpu.module @test_kernel {
+
+  // CHECK-LABEL: gpu.func @addf_f16
+  gpu.func @addf_f16(%arg0: memref<128xf16>, %value: vector<16xf16>) kernel {
+    %mask = arith.constant dense<true> : vector<16xi1>
+    %offsets = arith.constant dense<[0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15]> : vector<16xindex>
+    // CHECK-NOT: scf.while
+    // CHECK: %[[BITS:.*]] = vector.bitcast %{{.*}} : vector<16xf16> to vector<16xi16>
+    // CHECK: %[[SRC:.*]] = arith.extui %[[BITS]] : vector<16xi16> to vector<16xi32>
+    // CHECK: %[[OLD:.*]] = func.call @llvm.genx.lsc.xatomic.stateless.v16i32.v16i1.v16i64
+    // CHECK-SAME: %[[SRC]]
+    // CHECK: %[[TRUNC:.*]] = arith.trunci %[[OLD]] : vector<16xi32> to vector<16xi16>
+    // CHECK: vector.bitcast %[[TRUNC]] : vector<16xi16> to vector<16xf16>
+    %tdesc = xegpu.create_tdesc %arg0, %offsets : memref<128xf16>, vector<16xindex> -> !xegpu.tensor_desc<16xf16, #xegpu.scatter_tdesc_attr<>>
+    %old = xegpu.atomic_rmw "addf" %tdesc, %mask, %value : !xegpu.tensor_desc<16xf16, #xegpu.scatter_tdesc_attr<>>, vector<16xi1>, vector<16xf16> -> vector<16xf16>
+    gpu.return
+  }
+
+  // CHECK-LABEL: gpu.func @maxnumf_f32
+  gpu.func @maxnumf_f32(%arg0: memref<128xf32>, %value: vector<16xf32>) kernel {
+    %mask = arith.constant dense<true> : vector<16xi1>
+    %offsets = arith.constant dense<[0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15]> : vector<16xindex>
+    // CHECK-NOT: scf.while
+    // CHECK: %[[FMAX:.*]] = arith.constant 22 : i8
+    // CHECK: func.call @llvm.genx.lsc.xatomic.stateless.v16i32.v16i1.v16i64(%{{.*}}, %[[FMAX]],
+    %tdesc = xegpu.create_tdesc %arg0, %offsets : memref<128xf32>, vector<16xindex> -> !xegpu.tensor_desc<16xf32, #xegpu.scatter_tdesc_attr<>>
+    %old = xegpu.atomic_rmw "maxnumf" %tdesc, %mask, %value : !xegpu.tensor_desc<16xf32, #xegpu.scatter_tdesc_attr<>>, vector<16xi1>, vector<16xf32> -> vector<16xf32>
+    gpu.return
+  }
+
+  // CHECK-LABEL: gpu.func @addf_bf16
+  gpu.func @addf_bf16(%arg0: memref<128xbf16>, %value: vector<16xbf16>) kernel {
+    %mask = arith.constant dense<true> : vector<16xi1>
+    %offsets = arith.constant dense<[0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15]> : vector<16xindex>
+    // CHECK: %[[INIT:.*]] = func.call @llvm.genx.lsc.load.stateless.v16i32.v16i1.v16i64
+    // CHECK: %[[LOOP:.*]]:3 = scf.while (%[[ACTIVE:.*]] = %{{.*}}, %[[EXPECTED:.*]] = %{{.*}}, %[[RESULT:.*]] = %{{.*}})
+    // CHECK:   %[[ANY:.*]] = vector.reduction <or>, %[[ACTIVE]] : vector<16xi1> into i1
+    // CHECK:   scf.condition(%[[ANY]])
+    // CHECK: } do {
+    // CHECK:   %[[DESIRED:.*]] = arith.addf %{{.*}}, %{{.*}} : vector<16xbf16>
+    // CHECK:   %[[ICAS:.*]] = arith.constant 18 : i8
+    // CHECK:   func.call @llvm.genx.lsc.xatomic.stateless.v16i32.v16i1.v16i64(%{{.*}}, %[[ICAS]],
+    // CHECK:   arith.cmpi eq, %{{.*}}, %{{.*}} : vector<16xi16>
+    // CHECK:   arith.select
+    // CHECK:   scf.yield
+    // CHECK: }
+    %tdesc = xegpu.create_tdesc %arg0, %offsets : memref<128xbf16>, vector<16xindex> -> !xegpu.tensor_desc<16xbf16, #xegpu.scatter_tdesc_attr<>>
+    %old = xegpu.atomic_rmw "addf" %tdesc, %mask, %value : !xegpu.tensor_desc<16xbf16, #xegpu.scatter_tdesc_attr<>>, vector<16xi1>, vector<16xbf16> -> vector<16xbf16>
+    gpu.return
+  }
+}
@@ -27,5 +27,36 @@ module @gemm attributes {gpu.container_module} {
       //CHECK: gpu.return
       gpu.return
     }
+
+    // A producer of a barrier with 4 participants, 1 of them producers.
+    //CHECK-LABEL: gpu.func @producer
+    gpu.func @producer() kernel attributes {VectorComputeFunctionINTEL, spirv.entry_point_abi = #spirv.entry_point_abi<>} {
+      //CHECK-DAG: %[[c5_i8:.*]] = arith.constant 5 : i8
+      //CHECK-DAG: %[[c1_i8:.*]] = arith.constant 1 : i8
+      //CHECK-DAG: %[[c3_i8:.*]] = arith.constant 3 : i8
+      //CHECK: func.call @llvm.genx.nbarrier.arrive(%[[c5_i8]], %[[c1_i8]], %[[c1_i8]], %[[c3_i8]]) : (i8, i8, i8, i8) -> ()
+      %nbarrier_id = arith.constant 5 : i8
+      %num_participants = arith.constant 4 : i8
+      %payload = xegpu.init_nbarrier %nbarrier_id, %num_participants {nbarrier_role = 1 : i8, num_producers = 1 : i8} : i8, i8 -> !xegpu.nbarrier
+      xegpu.nbarrier_arrive %payload : !xegpu.nbarrier
+      gpu.return
+    }
+
+    // A consumer of the same barrier.
+    //CHECK-LABEL: gpu.func @consumer
+    gpu.func @consumer() kernel attributes {VectorComputeFunctionINTEL, spirv.entry_point_abi = #spirv.entry_point_abi<>} {
+      //CHECK-DAG: %[[c5_i8:.*]] = arith.constant 5 : i8
+      //CHECK-DAG: %[[c2_i8:.*]] = arith.constant 2 : i8
+      //CHECK-DAG: %[[c1_i8:.*]] = arith.constant 1 : i8
+      //CHECK-DAG: %[[c3_i8:.*]] = arith.constant 3 : i8
+      //CHECK: func.call @llvm.genx.nbarrier.arrive(%[[c5_i8]], %[[c2_i8]], %[[c1_i8]], %[[c3_i8]]) : (i8, i8, i8, i8) -> ()
+      //CHECK: func.call @llvm.genx.nbarrier(%{{.*}}, %[[c5_i8]], %{{.*}}) : (i8, i8, i8) -> ()
+      %nbarrier_id = arith.constant 5 : i8
+      %num_participants = arith.constant 4 : i8
+      %payload = xegpu.init_nbarrier %nbarrier_id, %num_participants {nbarrier_role = 2 : i8, num_producers = 1 : i8} : i8, i8 -> !xegpu.nbarrier
+      xegpu.nbarrier_arrive %payload : !xegpu.nbarrier
+      xegpu.nbarrier_wait %payload : !xegpu.nbarrier
+      gpu.return
+    }
   }
   }
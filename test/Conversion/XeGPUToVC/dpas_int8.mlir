@@ -0,0 +1,15 @@
+// RUN: imex-opt -convert-xegpu-to-vc -cse  %s | FileCheck %s
+
+gpu.module @test_kernel {
+  // CHECK-LABEL: gpu.func @dpas_s8_s8_s32
+  gpu.func @dpas_s8_s8_s32(%a: vector<8x32xi8>, %b: vector<8x16x4xi8>, %c: vector<8x16xi32>) kernel {
+    // CHECK: %[[A:.*]] = vector.bitcast %{{.*}} : vector<256xi8> to vector<64xi32>
+    // CHECK: %[[B:.*]] = vector.bitcast %{{.*}} : vector<512xi8> to vector<128xi32>
+    // CHECK: %[[S8:.*]] = arith.constant 8 : i32
+    // CHECK: %[[SIGNED:.*]] = arith.constant 1 : i32
+    // CHECK: func.call @llvm.genx.dpas2.v128i32.v128i32.v64i32(%{{.*}}, %[[B]], %[[A]], %[[S8]], %[[S8]], %[[S8]], %[[S8]], %[[SIGNED]], %[[SIGNED]])
+    // CHECK-SAME: -> vector<128xi32>
+    %d = xegpu.dpas %a, %b, %c : vector<8x32xi8>, vector<8x16x4xi8>, vector<8x16xi32> -> vector<8x16xi32>
+    gpu.return
+  }
+}
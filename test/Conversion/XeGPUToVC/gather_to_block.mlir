@@ -0,0 +1,93 @@
+// RUN: imex-opt -convert-xegpu-to-vc -cse  %s | FileCheck %s
+
+#scatter = #xegpu.scatter_tdesc_attr<memory_space=global>
+gpu.module @test_kernel {
+
+  // CHECK-LABEL: gpu.func @contiguous
+  gpu.func @contiguous(%a: memref<64xf32>, %b: memref<64xf32>) kernel {
+    %mask = arith.constant dense<1> : vector<16xi1>
+    %offsets = arith.constant dense<[16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31]> : vector<16xindex>
+    // CHECK-NOT: scf.if
+    // CHECK: %[[A:.*]] = vector.extract %{{.*}}[0] : i64 from vector<16xi64>
+    // CHECK: %[[A_PAYLOAD:.*]] = vector.broadcast %[[A]] : i64 to vector<1xi64>
+    // CHECK: %[[DATA:.*]] = func.call @llvm.genx.lsc.load.stateless.v16f32.v1i1.v1i64
+    // CHECK-SAME: %[[A_PAYLOAD]]
+    %a_tdesc = xegpu.create_tdesc %a, %offsets : memref<64xf32>, vector<16xindex> -> !xegpu.tensor_desc<16xf32, #scatter>
+    %data = xegpu.load %a_tdesc, %mask : !xegpu.tensor_desc<16xf32, #scatter>, vector<16xi1> -> vector<16xf32>
+    // CHECK: func.call @llvm.genx.lsc.store.stateless.v1i1.v1i64.v16f32
+    // CHECK-SAME: %[[DATA]]
+    %b_tdesc = xegpu.create_tdesc %b, %offsets : memref<64xf32>, vector<16xindex> -> !xegpu.tensor_desc<16xf32, #scatter>
+    xegpu.store %data, %b_tdesc, %mask : vector<16xf32>, !xegpu.tensor_desc<16xf32, #scatter>, vector<16xi1>
+    gpu.return
+  }
+
+  // CHECK-LABEL: gpu.func @lane_affine_with_tail
+  gpu.func @lane_affine_with_tail(%a: memref<64xf32>, %b: memref<64xf32>, %base: index, %size: index) kernel {
+    %step = vector.step : vector<16xindex>
+    %splat = vector.splat %base : vector<16xindex>
+    %offsets = arith.addi %step, %splat : vector<16xindex>
+    %bound = vector.splat %size : vector<16xindex>
+    %mask = arith.cmpi ult, %offsets, %bound : vector<16xindex>
+    %inc = arith.constant dense<16> : vector<16xindex>
+    // CHECK: %[[FULL:.*]] = vector.reduction <and>, %{{.*}} : vector<16xi1> into i1
+    // CHECK: %[[DATA:.*]] = scf.if %[[FULL]] -> (vector<16xf32>) {
+    // CHECK:   func.call @llvm.genx.lsc.load.stateless.v16f32.v1i1.v1i64
+    // CHECK: } else {
+    // CHECK:   func.call @llvm.genx.lsc.load.stateless.v16f32.v16i1.v16i64
+    // CHECK: }
+    %a_tdesc = xegpu.create_tdesc %a, %offsets : memref<64xf32>, vector<16xindex> -> !xegpu.tensor_desc<16xf32, #scatter>
+    %a_next = xegpu.update_offset %a_tdesc, %inc : !xegpu.tensor_desc<16xf32, #scatter>, vector<16xindex>
+    %data = xegpu.load %a_next, %mask : !xegpu.tensor_desc<16xf32, #scatter>, vector<16xi1> -> vector<16xf32>
+    // CHECK: scf.if %[[FULL]] {
+    // CHECK:   func.call @llvm.genx.lsc.store.stateless.v1i1.v1i64.v16f32
+    // CHECK: } else {
+    // CHECK:   func.call @llvm.genx.lsc.store.stateless.v16i1.v16i64.v16f32
+    // CHECK: }
+    %b_tdesc = xegpu.create_tdesc %b, %offsets : memref<64xf32>, vector<16xindex> -> !xegpu.tensor_desc<16xf32, #scatter>
+    xegpu.store %data, %b_tdesc, %mask : vector<16xf32>, !xegpu.tensor_desc<16xf32, #scatter>, vector<16xi1>
+    gpu.return
+  }
+
+  // CHECK-LABEL: gpu.func @uniform
+  gpu.func @uniform(%a: memref<64xf32>, %base: index) kernel {
+    %mask = arith.constant dense<1> : vector<16xi1>
+    %offsets = vector.splat %base : vector<16xindex>
+    // CHECK: %[[ELEM:.*]] = func.call @llvm.genx.lsc.load.stateless.v1f32.v1i1.v1i64
+    // CHECK: %[[SCALAR:.*]] = vector.extract %[[ELEM]][0] : f32 from vector<1xf32>
+    // CHECK: vector.broadcast %[[SCALAR]] : f32 to vector<16xf32>
+    %a_tdesc = xegpu.create_tdesc %a, %offsets : memref<64xf32>, vector<16xindex> -> !xegpu.tensor_desc<16xf32, #scatter>
+    %data = xegpu.load %a_tdesc, %mask : !xegpu.tensor_desc<16xf32, #scatter>, vector<16xi1> -> vector<16xf32>
+    gpu.return
+  }
+
+  // CHECK-LABEL: gpu.func @packed
+  gpu.func @packed(%a: memref<64xf16>, %base: index) kernel {
+    %mask = arith.constant dense<1> : vector<16xi1>
+    %step = vector.step : vector<16xindex>
+    %splat = vector.splat %base : vector<16xindex>
+    %offsets = arith.addi %step, %splat : vector<16xindex>
+    // CHECK: %[[REM:.*]] = arith.andi %{{.*}}, %{{.*}} : i64
+    // CHECK: %[[ALIGNED:.*]] = arith.cmpi eq, %[[REM]], %{{.*}} : i64
+    // CHECK: scf.if %[[ALIGNED]] -> (vector<16xf16>) {
+    // CHECK:   %[[WORDS:.*]] = func.call @llvm.genx.lsc.load.stateless.v8i32.v1i1.v1i64
+    // CHECK:   vector.bitcast %[[WORDS]] : vector<8xi32> to vector<16xf16>
+    // CHECK: } else {
+    // CHECK:   func.call @llvm.genx.lsc.load.stateless.v16i32.v16i1.v16i64
+    %a_tdesc = xegpu.create_tdesc %a, %offsets : memref<64xf16>, vector<16xindex> -> !xegpu.tensor_desc<16xf16, #scatter>
+    %data = xegpu.load %a_tdesc, %mask : !xegpu.tensor_desc<16xf16, #scatter>, vector<16xi1> -> vector<16xf16>
+    gpu.return
+  }
+
+  // CHECK-LABEL: gpu.func @strided
+  gpu.func @strided(%a: memref<64xf32>) kernel {
+    %mask = arith.constant dense<1> : vector<16xi1>
+    %step = vector.step : vector<16xindex>
+    %two = arith.constant dense<2> : vector<16xindex>
+    %offsets = arith.muli %step, %two : vector<16xindex>
+    // CHECK-NOT: v1i1.v1i64
+    // CHECK: func.call @llvm.genx.lsc.load.stateless.v16f32.v16i1.v16i64
+    %a_tdesc = xegpu.create_tdesc %a, %offsets : memref<64xf32>, vector<16xindex> -> !xegpu.tensor_desc<16xf32, #scatter>
+    %data = xegpu.load %a_tdesc, %mask : !xegpu.tensor_desc<16xf32, #scatter>, vector<16xi1> -> vector<16xf32>
+    gpu.return
+  }
+}
@@ -0,0 +1,29 @@
+// RUN: imex-opt --split-input-file --xetile-init-duplicate --xetile-blocking \
+// RUN: --convert-xetile-to-xegpu="schedule-dpas=true" %s -verify-diagnostics -o -| FileCheck %s
+gpu.module @test_kernel {
+  // The chains of the four 8x16 accumulators along K are interleaved, and
+  // the dpas ops sharing a B operand are issued back to back.
+  //CHECK-LABEL: gpu.func @test_schedule
+  gpu.func @test_schedule(%a: memref<1024x1024xf16>, %b: memref<1024x1024xf16>, %c: memref<1024x1024xf32>) {
+    %c0 = arith.constant 0 : index
+    %1 = xetile.init_tile %a[%c0, %c0] : memref<1024x1024xf16> -> !xetile.tile<16x32xf16>
+    %2 = xetile.load_tile %1 : !xetile.tile<16x32xf16> -> vector<16x32xf16>
+    %3 = xetile.init_tile %b[%c0, %c0] : memref<1024x1024xf16> -> !xetile.tile<32x32xf16>
+    %4 = xetile.load_tile %3 : !xetile.tile<32x32xf16> -> vector<32x32xf16>
+
+    //CHECK: %[[r0:.*]] = xegpu.dpas %[[a0:[a-zA-Z0-9]+]], %[[b0:[a-zA-Z0-9]+]] : vector<8x16xf16>, vector<16x16xf16> -> vector<8x16xf32>
+    //CHECK-NEXT: %[[r1:.*]] = xegpu.dpas %[[a1:[a-zA-Z0-9]+]], %[[b0]] : vector<8x16xf16>, vector<16x16xf16> -> vector<8x16xf32>
+    //CHECK-NEXT: %[[r2:.*]] = xegpu.dpas %[[a0]], %[[b1:[a-zA-Z0-9]+]] : vector<8x16xf16>, vector<16x16xf16> -> vector<8x16xf32>
+    //CHECK-NEXT: %[[r3:.*]] = xegpu.dpas %[[a1]], %[[b1]] : vector<8x16xf16>, vector<16x16xf16> -> vector<8x16xf32>
+    //CHECK-NEXT: %[[r4:.*]] = xegpu.dpas %[[a2:[a-zA-Z0-9]+]], %[[b2:[a-zA-Z0-9]+]], %[[r0]] : vector<8x16xf16>, vector<16x16xf16>, vector<8x16xf32> -> vector<8x16xf32>
+    //CHECK-NEXT: %[[r5:.*]] = xegpu.dpas %[[a3:[a-zA-Z0-9]+]], %[[b2]], %[[r1]] : vector<8x16xf16>, vector<16x16xf16>, vector<8x16xf32> -> vector<8x16xf32>
+    //CHECK-NEXT: %[[r6:.*]] = xegpu.dpas %[[a2]], %[[b3:[a-zA-Z0-9]+]], %[[r2]] : vector<8x16xf16>, vector<16x16xf16>, vector<8x16xf32> -> vector<8x16xf32>
+    //CHECK-NEXT: %[[r7:.*]] = xegpu.dpas %[[a3]], %[[b3]], %[[r3]] : vector<8x16xf16>, vector<16x16xf16>, vector<8x16xf32> -> vector<8x16xf32>
+    %5 = xetile.tile_mma %2, %4 : vector<16x32xf16>, vector<32x32xf16> -> vector<16x32xf32>
+
+    %6 = xetile.init_tile %c[%c0, %c0] : memref<1024x1024xf32> -> !xetile.tile<16x32xf32>
+    //CHECK-COUNT-4: xegpu.store_nd
+    xetile.store_tile %5, %6 : vector<16x32xf32>, !xetile.tile<16x32xf32>
+    gpu.return
+  }
+}
@@ -29,6 +29,14 @@ func.func @test_default_partition(%np : index, %prank: index, %shape: index) ->
 // CHECK-LABEL: func.func @test_default_partition(%arg0: index, %arg1: index, %arg2: index) -> (index, index) {
 // CHECK-NEXT: "dist.default_partition"(%arg0, %arg1, %arg2) {rank = 1 : i64} : (index, index, index) -> (index, index)
 
+// -----
+func.func @test_weighted_partition(%prank: index, %weights: memref<?xindex>, %shape: index) -> (index, index) {
+    %0, %1 = "dist.weighted_partition"(%prank, %weights, %shape) : (index, memref<?xindex>, index) -> (index, index)
+    return %0, %1 : index, index
+}
+// CHECK-LABEL: func.func @test_weighted_partition(%arg0: index, %arg1: memref<?xindex>, %arg2: index) -> (index, index) {
+// CHECK-NEXT: "dist.weighted_partition"(%arg0, %arg1, %arg2) : (index, memref<?xindex>, index) -> (index, index)
+
 // -----
 func.func @test_local_target_of_slice(%arg0: !ndarray.ndarray<?xi64, #dist.dist_env<team = 1 : i64 loffs = 0 lparts = ?,?,?>>) -> (index, index) {
     %c0 = arith.constant 0 : index
@@ -1,4 +1,6 @@
 // RUN: imex-opt --split-input-file --dist-coalesce %s -verify-diagnostics -o -| FileCheck %s
+// RUN: imex-opt --split-input-file --dist-coalesce="batch-exchanges=1" %s -verify-diagnostics -o -| FileCheck %s --check-prefix=BATCH
+// RUN: imex-opt --split-input-file --dist-coalesce="halo-depth=2" %s -verify-diagnostics -o -| FileCheck %s --check-prefix=DEEP
 
 module {
   func.func @test_coalesce1() -> (!ndarray.ndarray<?xi64, #dist.dist_env<team = 22 loffs = ? lparts = ?,?,?>>) {
@@ -68,3 +70,87 @@ module {
 // CHECK: dist.ewbin
 // CHECK: dist.ewbin
 // CHECK: ndarray.insert_slice
+
+// -----
+module {
+  func.func @test_batch() -> (!ndarray.ndarray<?xi64, #dist.dist_env<team = 22 loffs = 0 lparts = ?,?,?>>) {
+    %c0 = arith.constant 0 : index
+    %c1 = arith.constant 1 : index
+    %c5 = arith.constant 5 : index
+    %c10 = arith.constant 10 : index
+    %0 = ndarray.linspace %c0 %c10 %c10 false : (index, index, index) -> !ndarray.ndarray<?xi64>
+    %1 = dist.init_dist_array l_offset %c5 parts %0, %0, %0 : index, !ndarray.ndarray<?xi64>, !ndarray.ndarray<?xi64>, !ndarray.ndarray<?xi64> to !ndarray.ndarray<?xi64, #dist.dist_env<team = 22 loffs = 0 lparts = ?,?,?>>
+    %2 = dist.init_dist_array l_offset %c5 parts %0, %0, %0 : index, !ndarray.ndarray<?xi64>, !ndarray.ndarray<?xi64>, !ndarray.ndarray<?xi64> to !ndarray.ndarray<?xi64, #dist.dist_env<team = 22 loffs = 0 lparts = ?,?,?>>
+    %v1 = dist.subview %1[%c1] [%c5] [%c1] : !ndarray.ndarray<?xi64, #dist.dist_env<team = 22 loffs = 0 lparts = ?,?,?>> to !ndarray.ndarray<?xi64, #dist.dist_env<team = 22 loffs = 0 lparts = ?,?,?>>
+    %3 = dist.repartition %v1 : !ndarray.ndarray<?xi64, #dist.dist_env<team = 22 loffs = 0 lparts = ?,?,?>> to !ndarray.ndarray<?xi64, #dist.dist_env<team = 22 loffs = 0 lparts = ?,?,?>>
+    %4 = "dist.ewbin"(%3, %3) {op = 0 : i32} : (!ndarray.ndarray<?xi64, #dist.dist_env<team = 22 loffs = 0 lparts = ?,?,?>>, !ndarray.ndarray<?xi64, #dist.dist_env<team = 22 loffs = 0 lparts = ?,?,?>>) -> !ndarray.ndarray<?xi64, #dist.dist_env<team = 22 loffs = 0 lparts = ?,?,?>>
+    %v2 = dist.subview %2[%c1] [%c5] [%c1] : !ndarray.ndarray<?xi64, #dist.dist_env<team = 22 loffs = 0 lparts = ?,?,?>> to !ndarray.ndarray<?xi64, #dist.dist_env<team = 22 loffs = 0 lparts = ?,?,?>>
+    %5 = dist.repartition %v2 : !ndarray.ndarray<?xi64, #dist.dist_env<team = 22 loffs = 0 lparts = ?,?,?>> to !ndarray.ndarray<?xi64, #dist.dist_env<team = 22 loffs = 0 lparts = ?,?,?>>
+    %6 = "dist.ewbin"(%4, %5) {op = 0 : i32} : (!ndarray.ndarray<?xi64, #dist.dist_env<team = 22 loffs = 0 lparts = ?,?,?>>, !ndarray.ndarray<?xi64, #dist.dist_env<team = 22 loffs = 0 lparts = ?,?,?>>) -> !ndarray.ndarray<?xi64, #dist.dist_env<team = 22 loffs = 0 lparts = ?,?,?>>
+    return %6 : !ndarray.ndarray<?xi64, #dist.dist_env<team = 22 loffs = 0 lparts = ?,?,?>>
+  }
+}
+// BATCH-LABEL: func.func @test_batch()
+// BATCH: dist.repartition %{{.*}} loffs
+// BATCH-NOT: dist.ewbin
+// BATCH: dist.repartition %{{.*}} loffs
+// BATCH: dist.ewbin
+
+// -----
+module {
+  func.func @test_deep_halo() -> (!ndarray.ndarray<?xi64, #dist.dist_env<team = 22 loffs = 0 lparts = ?,?,?>>) {
+    %c0 = arith.constant 0 : index
+    %c1 = arith.constant 1 : index
+    %c2 = arith.constant 2 : index
+    %c3 = arith.constant 3 : index
+    %c5 = arith.constant 5 : index
+    %c10 = arith.constant 10 : index
+    %0 = ndarray.linspace %c0 %c10 %c10 false : (index, index, index) -> !ndarray.ndarray<?xi64>
+    %1 = dist.init_dist_array l_offset %c5 parts %0, %0, %0 : index, !ndarray.ndarray<?xi64>, !ndarray.ndarray<?xi64>, !ndarray.ndarray<?xi64> to !ndarray.ndarray<?xi64, #dist.dist_env<team = 22 loffs = 0 lparts = ?,?,?>>
+    %v1 = dist.subview %1[%c0] [%c5] [%c1] : !ndarray.ndarray<?xi64, #dist.dist_env<team = 22 loffs = 0 lparts = ?,?,?>> to !ndarray.ndarray<?xi64, #dist.dist_env<team = 22 loffs = 0 lparts = ?,?,?>>
+    %v2 = dist.subview %1[%c2] [%c5] [%c1] : !ndarray.ndarray<?xi64, #dist.dist_env<team = 22 loffs = 0 lparts = ?,?,?>> to !ndarray.ndarray<?xi64, #dist.dist_env<team = 22 loffs = 0 lparts = ?,?,?>>
+    %3 = dist.repartition %v1 : !ndarray.ndarray<?xi64, #dist.dist_env<team = 22 loffs = 0 lparts = ?,?,?>> to !ndarray.ndarray<?xi64, #dist.dist_env<team = 22 loffs = 0 lparts = ?,?,?>>
+    %4 = dist.repartition %v2 : !ndarray.ndarray<?xi64, #dist.dist_env<team = 22 loffs = 0 lparts = ?,?,?>> to !ndarray.ndarray<?xi64, #dist.dist_env<team = 22 loffs = 0 lparts = ?,?,?>>
+    %5 = "dist.ewbin"(%3, %4) {op = 0 : i32} : (!ndarray.ndarray<?xi64, #dist.dist_env<team = 22 loffs = 0 lparts = ?,?,?>>, !ndarray.ndarray<?xi64, #dist.dist_env<team = 22 loffs = 0 lparts = ?,?,?>>) -> !ndarray.ndarray<?xi64, #dist.dist_env<team = 22 loffs = 0 lparts = ?,?,?>>
+    %v3 = dist.subview %5[%c0] [%c3] [%c1] : !ndarray.ndarray<?xi64, #dist.dist_env<team = 22 loffs = 0 lparts = ?,?,?>> to !ndarray.ndarray<?xi64, #dist.dist_env<team = 22 loffs = 0 lparts = ?,?,?>>
+    %v4 = dist.subview %5[%c2] [%c3] [%c1] : !ndarray.ndarray<?xi64, #dist.dist_env<team = 22 loffs = 0 lparts = ?,?,?>> to !ndarray.ndarray<?xi64, #dist.dist_env<team = 22 loffs = 0 lparts = ?,?,?>>
+    %6 = dist.repartition %v3 : !ndarray.ndarray<?xi64, #dist.dist_env<team = 22 loffs = 0 lparts = ?,?,?>> to !ndarray.ndarray<?xi64, #dist.dist_env<team = 22 loffs = 0 lparts = ?,?,?>>
+    %7 = dist.repartition %v4 : !ndarray.ndarray<?xi64, #dist.dist_env<team = 22 loffs = 0 lparts = ?,?,?>> to !ndarray.ndarray<?xi64, #dist.dist_env<team = 22 loffs = 0 lparts = ?,?,?>>
+    %8 = "dist.ewbin"(%6, %7) {op = 0 : i32} : (!ndarray.ndarray<?xi64, #dist.dist_env<team = 22 loffs = 0 lparts = ?,?,?>>, !ndarray.ndarray<?xi64, #dist.dist_env<team = 22 loffs = 0 lparts = ?,?,?>>) -> !ndarray.ndarray<?xi64, #dist.dist_env<team = 22 loffs = 0 lparts = ?,?,?>>
+    %t_offsets, %t_sizes = dist.local_target_of_slice %1[%c1] [%c3] [%c1] : !ndarray.ndarray<?xi64, #dist.dist_env<team = 22 loffs = 0 lparts = ?,?,?>> to index, index
+    %10 = dist.repartition %8   loffs %t_offsets lsizes %t_sizes : !ndarray.ndarray<?xi64, #dist.dist_env<team = 22 loffs = 0 lparts = ?,?,?>>, index, index to !ndarray.ndarray<?xi64, #dist.dist_env<team = 22 loffs = 0 lparts = ?,?,?>>
+    ndarray.insert_slice %10 into %1[%c1] [%c3] [%c1] : !ndarray.ndarray<?xi64, #dist.dist_env<team = 22 loffs = 0 lparts = ?,?,?>> into !ndarray.ndarray<?xi64, #dist.dist_env<team = 22 loffs = 0 lparts = ?,?,?>>
+    return %1 : !ndarray.ndarray<?xi64, #dist.dist_env<team = 22 loffs = 0 lparts = ?,?,?>>
+  }
+}
+// DEEP-LABEL: func.func @test_deep_halo()
+// DEEP: dist.init_dist_array
+// DEEP: dist.local_target_of_slice
+// DEEP: dist.repartition
+// DEEP-NOT: dist.repartition
+// DEEP-COUNT-3: dist.ewbin
+// DEEP-NOT: dist.repartition
+// DEEP: ndarray.insert_slice
+
+// -----
+module {
+  func.func @test_aligned() -> (!ndarray.ndarray<16xi64, #dist.dist_env<team = 22>>) {
+    %c16 = arith.constant 16 : index
+    %c0 = arith.constant 0 : i64
+    %c1 = arith.constant 1 : i64
+    %0 = ndarray.create %c16 value %c0 {dtype = 2 : i8} : (index, i64) -> !ndarray.ndarray<16xi64, #dist.dist_env<team = 22>>
+    %1 = ndarray.create %c16 value %c1 {dtype = 2 : i8} : (index, i64) -> !ndarray.ndarray<16xi64, #dist.dist_env<team = 22>>
+    %2 = dist.repartition %0 : !ndarray.ndarray<16xi64, #dist.dist_env<team = 22>> to !ndarray.ndarray<?xi64, #dist.dist_env<team = 22>>
+    %3 = dist.repartition %1 : !ndarray.ndarray<16xi64, #dist.dist_env<team = 22>> to !ndarray.ndarray<?xi64, #dist.dist_env<team = 22>>
+    %4 = "dist.ewbin"(%2, %3) {op = 0 : i32} : (!ndarray.ndarray<?xi64, #dist.dist_env<team = 22>>, !ndarray.ndarray<?xi64, #dist.dist_env<team = 22>>) -> !ndarray.ndarray<16xi64, #dist.dist_env<team = 22>>
+    %5 = ndarray.copy %4 : !ndarray.ndarray<16xi64, #dist.dist_env<team = 22>> -> !ndarray.ndarray<16xi64, #dist.dist_env<team = 22>>
+    %6 = dist.repartition %5 : !ndarray.ndarray<16xi64, #dist.dist_env<team = 22>> to !ndarray.ndarray<?xi64, #dist.dist_env<team = 22>>
+    %7 = dist.repartition %0 : !ndarray.ndarray<16xi64, #dist.dist_env<team = 22>> to !ndarray.ndarray<?xi64, #dist.dist_env<team = 22>>
+    %8 = "dist.ewbin"(%6, %7) {op = 0 : i32} : (!ndarray.ndarray<?xi64, #dist.dist_env<team = 22>>, !ndarray.ndarray<?xi64, #dist.dist_env<team = 22>>) -> !ndarray.ndarray<16xi64, #dist.dist_env<team = 22>>
+    return %8 : !ndarray.ndarray<16xi64, #dist.dist_env<team = 22>>
+  }
+}
+// Default-partitioned operands of the same shape are aligned already.
+// CHECK-LABEL: func.func @test_aligned()
+// CHECK-NOT: dist.repartition
+// CHECK: return
@@ -22,11 +22,11 @@ func.func @test_prank() -> index {
 
 // -----
 func.func @test_allreduce(%arg0: memref<i64>) {
-    "distruntime.allreduce"(%arg0) <{op = 4 : i32}> : (memref<i64>) -> ()
+    %h, %r = "distruntime.allreduce"(%arg0) <{op = 4 : i32}> : (memref<i64>) -> (!distruntime.asynchandle, memref<i64>)
     return
 }
 // CHECK-LABEL: func.func @test_allreduce(%arg0: memref<i64>) {
-// CHECK-NEXT: "distruntime.allreduce"(%arg0) <{op = 4 : i32}> : (memref<i64>) -> ()
+// CHECK-NEXT: "distruntime.allreduce"(%arg0) <{op = 4 : i32}> : (memref<i64>) -> (!distruntime.asynchandle, memref<i64>)
 
 // -----
 func.func @test_copy_reshape(%arg0: !ndarray.ndarray<?x?xi64>) {
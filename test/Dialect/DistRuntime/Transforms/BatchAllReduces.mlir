@@ -0,0 +1,90 @@
+// RUN: imex-opt --split-input-file --batch-allreduces %s -verify-diagnostics -o -| FileCheck %s
+
+// -----
+module {
+    func.func @test_batch(%arg0: memref<f64>, %arg1: memref<f64>, %arg2: memref<f64>) -> (f64, f64, f64) {
+        %h0, %r0 = "distruntime.allreduce"(%arg0) {op = 4 : i32} : (memref<f64>) -> (!distruntime.asynchandle, memref<f64>)
+        %h1, %r1 = "distruntime.allreduce"(%arg1) {op = 4 : i32} : (memref<f64>) -> (!distruntime.asynchandle, memref<f64>)
+        %h2, %r2 = "distruntime.allreduce"(%arg2) {op = 4 : i32} : (memref<f64>) -> (!distruntime.asynchandle, memref<f64>)
+        "distruntime.wait"(%h0) : (!distruntime.asynchandle) -> ()
+        %v0 = memref.load %r0[] : memref<f64>
+        "distruntime.wait"(%h1) : (!distruntime.asynchandle) -> ()
+        %v1 = memref.load %r1[] : memref<f64>
+        "distruntime.wait"(%h2) : (!distruntime.asynchandle) -> ()
+        %v2 = memref.load %r2[] : memref<f64>
+        return %v0, %v1, %v2 : f64, f64, f64
+    }
+}
+// CHECK-LABEL: func.func @test_batch
+// CHECK: [[B:%.*]] = memref.alloc() : memref<3xf64>
+// CHECK: memref.load %arg0[]
+// CHECK: memref.store
+// CHECK: memref.load %arg1[]
+// CHECK: memref.store
+// CHECK: memref.load %arg2[]
+// CHECK: memref.store
+// CHECK: [[H:%.*]], {{.*}} = "distruntime.allreduce"([[B]])
+// CHECK-NOT: distruntime.allreduce
+// CHECK: "distruntime.wait"([[H]])
+// CHECK: memref.store {{.*}}, %arg0[]
+// CHECK: memref.store {{.*}}, %arg1[]
+// CHECK: memref.store {{.*}}, %arg2[]
+// CHECK: memref.dealloc [[B]]
+// CHECK-NOT: distruntime.wait
+// CHECK: return
+
+// -----
+module {
+    func.func @test_sequential(%arg0: !ndarray.ndarray<i64>, %arg1: !ndarray.ndarray<i64>) -> (!ndarray.ndarray<i64>, !ndarray.ndarray<i64>) {
+        %h0, %r0 = "distruntime.allreduce"(%arg0) {op = 4 : i32} : (!ndarray.ndarray<i64>) -> (!distruntime.asynchandle, !ndarray.ndarray<i64>)
+        "distruntime.wait"(%h0) : (!distruntime.asynchandle) -> ()
+        %h1, %r1 = "distruntime.allreduce"(%arg1) {op = 4 : i32} : (!ndarray.ndarray<i64>) -> (!distruntime.asynchandle, !ndarray.ndarray<i64>)
+        "distruntime.wait"(%h1) : (!distruntime.asynchandle) -> ()
+        return %r0, %r1 : !ndarray.ndarray<i64>, !ndarray.ndarray<i64>
+    }
+}
+// The first allreduce is waited for before the second starts.
+// CHECK-LABEL: func.func @test_sequential
+// CHECK-NOT: memref.alloc
+// CHECK: "distruntime.allreduce"(%arg0)
+// CHECK: "distruntime.wait"
+// CHECK: "distruntime.allreduce"(%arg1)
+// CHECK: "distruntime.wait"
+
+// -----
+module {
+    func.func @test_batch_ndarray(%arg0: !ndarray.ndarray<i64>, %arg1: !ndarray.ndarray<i64>) -> (!ndarray.ndarray<i64>, !ndarray.ndarray<i64>) {
+        %h0, %r0 = "distruntime.allreduce"(%arg0) {op = 4 : i32} : (!ndarray.ndarray<i64>) -> (!distruntime.asynchandle, !ndarray.ndarray<i64>)
+        %h1, %r1 = "distruntime.allreduce"(%arg1) {op = 4 : i32} : (!ndarray.ndarray<i64>) -> (!distruntime.asynchandle, !ndarray.ndarray<i64>)
+        "distruntime.wait"(%h0) : (!distruntime.asynchandle) -> ()
+        "distruntime.wait"(%h1) : (!distruntime.asynchandle) -> ()
+        return %r0, %r1 : !ndarray.ndarray<i64>, !ndarray.ndarray<i64>
+    }
+}
+// CHECK-LABEL: func.func @test_batch_ndarray
+// CHECK: [[B:%.*]] = memref.alloc() : memref<2xi64>
+// CHECK: ndarray.to_tensor %arg0
+// CHECK: ndarray.to_tensor %arg1
+// CHECK: [[H:%.*]], {{.*}} = "distruntime.allreduce"([[B]])
+// CHECK-NEXT: "distruntime.wait"([[H]])
+// CHECK-NOT: distruntime.wait
+// CHECK: return %arg0, %arg1
+
+// -----
+module {
+    func.func @test_mixed(%arg0: memref<f64>, %arg1: memref<f64>, %arg2: memref<i64>) {
+        %h0, %r0 = "distruntime.allreduce"(%arg0) {op = 4 : i32} : (memref<f64>) -> (!distruntime.asynchandle, memref<f64>)
+        %h1, %r1 = "distruntime.allreduce"(%arg1) {op = 2 : i32} : (memref<f64>) -> (!distruntime.asynchandle, memref<f64>)
+        %h2, %r2 = "distruntime.allreduce"(%arg2) {op = 4 : i32} : (memref<i64>) -> (!distruntime.asynchandle, memref<i64>)
+        "distruntime.wait"(%h0) : (!distruntime.asynchandle) -> ()
+        "distruntime.wait"(%h1) : (!distruntime.asynchandle) -> ()
+        "distruntime.wait"(%h2) : (!distruntime.asynchandle) -> ()
+        return
+    }
+}
+// Different reduction operations and element types are not batched.
+// CHECK-LABEL: func.func @test_mixed
+// CHECK-NOT: memref.alloc
+// CHECK: "distruntime.allreduce"(%arg0)
+// CHECK: "distruntime.allreduce"(%arg1)
+// CHECK: "distruntime.allreduce"(%arg2)
@@ -3,13 +3,16 @@
 // -----
 module {
     func.func @test_canonicalize(%arg0: index) {
+      %c0 = arith.constant 0 : index
       %c1 = arith.constant 1 : index
       %c2 = arith.constant 2 : index
       %c3 = arith.constant 3 : index
       %c4 = arith.constant 4 : index
       %9 = ndarray.create %c3, %c3, %c3 {dtype = 0 : i8} : (index, index, index) -> !ndarray.ndarray<?x?x?xf64>
-      // THe first should get all static shapes
+      // THe first is within the local data and gets folded to empty halos
       %handle, %lHalo, %rHalo    = "distruntime.get_halo"(%9, %c4, %c4, %c4, %c1, %c1, %c1, %c1, %c1, %c1, %c2, %c2, %c2) {team = 22} : (!ndarray.ndarray<?x?x?xf64>, index, index, index, index, index, index, index, index, index, index, index, index) -> (!distruntime.asynchandle, !ndarray.ndarray<?x?x?xf64>, !ndarray.ndarray<?x?x?xf64>)
+      // The next should get all static shapes
+      %handle0, %lHalo0, %rHalo0 = "distruntime.get_halo"(%9, %c4, %c4, %c4, %c1, %c1, %c1, %c0, %c1, %c1, %c2, %c2, %c2) {team = 22} : (!ndarray.ndarray<?x?x?xf64>, index, index, index, index, index, index, index, index, index, index, index, index) -> (!distruntime.asynchandle, !ndarray.ndarray<?x?x?xf64>, !ndarray.ndarray<?x?x?xf64>)
       // THe second has a unknown SSA values in shape so not we cannot infer full static shapes
       %handle1, %lHalo1, %rHalo1 = "distruntime.get_halo"(%9, %c4, %c4, %c4, %c1, %c1, %c1, %c1, %c1, %c1, %arg0, %c2, %c2) {team = 22} : (!ndarray.ndarray<?x?x?xf64>, index, index, index, index, index, index, index, index, index, index, index, index) -> (!distruntime.asynchandle, !ndarray.ndarray<?x?x?xf64>, !ndarray.ndarray<?x?x?xf64>)
       return
@@ -17,7 +20,7 @@ module {
 }
 // CHECK-LABEL: func.func @test_canonicalize
 // CHECK: "distruntime.get_halo"
-// CHECK-SAME: -> (!distruntime.asynchandle, !ndarray.ndarray<0x2x2xf64>, !ndarray.ndarray<0x2x2xf64>)
+// CHECK-SAME: -> (!distruntime.asynchandle, !ndarray.ndarray<1x2x2xf64>, !ndarray.ndarray<0x2x2xf64>)
 // CHECK: "distruntime.get_halo"
 // CHECK-SAME: -> (!distruntime.asynchandle, !ndarray.ndarray<?x2x2xf64>, !ndarray.ndarray<?x2x2xf64>)
 
@@ -41,3 +44,24 @@ module {
 // CHECK: distruntime.copy_reshape
 // CHECK-SAME: -> (!distruntime.asynchandle, !ndarray.ndarray<1x3x2xi32>)
 // CHECK: "distruntime.wait"
+
+// -----
+module {
+    func.func @test_local_halo(%arg0: !ndarray.ndarray<?x4xf64>, %arg1: index) -> (!ndarray.ndarray<?x4xf64>, !ndarray.ndarray<?x4xf64>) {
+      %c0 = arith.constant 0 : index
+      %c4 = arith.constant 4 : index
+      %c16 = arith.constant 16 : index
+      %size = ndarray.dim %arg0 %c0 : !ndarray.ndarray<?x4xf64> -> index
+      // The bounding box is exactly the local part, no data needs to be exchanged
+      %handle, %lHalo, %rHalo = "distruntime.get_halo"(%arg0, %c16, %c4, %arg1, %c0, %arg1, %c0, %size, %c4) {team = 22} : (!ndarray.ndarray<?x4xf64>, index, index, index, index, index, index, index, index) -> (!distruntime.asynchandle, !ndarray.ndarray<?x4xf64>, !ndarray.ndarray<?x4xf64>)
+      "distruntime.wait"(%handle) : (!distruntime.asynchandle) -> ()
+      return %lHalo, %rHalo : !ndarray.ndarray<?x4xf64>, !ndarray.ndarray<?x4xf64>
+    }
+}
+// CHECK-LABEL: func.func @test_local_halo
+// CHECK-NOT: distruntime.get_halo
+// CHECK-NOT: distruntime.wait
+// CHECK: ndarray.create %c0{{.*}}, %c4{{.*}} : (index, index) -> !ndarray.ndarray<0x4xf64>
+// CHECK: ndarray.cast
+// CHECK-SAME: to !ndarray.ndarray<?x4xf64>
+// CHECK: return
@@ -9,13 +9,13 @@ module {
 }
 // CHECK-LABEL: func.func private @_idtr_nprocs(i64) -> index
 // CHECK-LABEL: func.func private @_idtr_prank(i64) -> index
-// CHECK-NEXT: func.func private @_idtr_reduce_all_f64(memref<*xf64>, i32)
-// CHECK-NEXT: func.func private @_idtr_reduce_all_f32(memref<*xf32>, i32)
-// CHECK-NEXT: func.func private @_idtr_reduce_all_i64(memref<*xi64>, i32)
-// CHECK-NEXT: func.func private @_idtr_reduce_all_i32(memref<*xi32>, i32)
-// CHECK-NEXT: func.func private @_idtr_reduce_all_i16(memref<*xi16>, i32)
-// CHECK-NEXT: func.func private @_idtr_reduce_all_i8(memref<*xi8>, i32)
-// CHECK-NEXT: func.func private @_idtr_reduce_all_i1(memref<*xi1>, i32)
+// CHECK-NEXT: func.func private @_idtr_reduce_all_async_f64(memref<*xf64>, i32) -> i64
+// CHECK-NEXT: func.func private @_idtr_reduce_all_async_f32(memref<*xf32>, i32) -> i64
+// CHECK-NEXT: func.func private @_idtr_reduce_all_async_i64(memref<*xi64>, i32) -> i64
+// CHECK-NEXT: func.func private @_idtr_reduce_all_async_i32(memref<*xi32>, i32) -> i64
+// CHECK-NEXT: func.func private @_idtr_reduce_all_async_i16(memref<*xi16>, i32) -> i64
+// CHECK-NEXT: func.func private @_idtr_reduce_all_async_i8(memref<*xi8>, i32) -> i64
+// CHECK-NEXT: func.func private @_idtr_reduce_all_async_i1(memref<*xi1>, i32) -> i64
 // CHECK-NEXT: func.func private @_idtr_copy_reshape_f64(i64, memref<*xindex>, memref<*xindex>, memref<*xf64>, memref<*xindex>, memref<*xindex>, memref<*xf64>) -> i64
 // CHECK-NEXT: func.func private @_idtr_copy_reshape_f32(i64, memref<*xindex>, memref<*xindex>, memref<*xf32>, memref<*xindex>, memref<*xindex>, memref<*xf32>) -> i64
 // CHECK-NEXT: func.func private @_idtr_copy_reshape_i64(i64, memref<*xindex>, memref<*xindex>, memref<*xi64>, memref<*xindex>, memref<*xindex>, memref<*xi64>) -> i64
@@ -49,13 +49,15 @@ module {
 // -----
 module {
     func.func @test_allreduce(%arg0: memref<i64, strided<[], offset: ?>>) {
-        "distruntime.allreduce"(%arg0) {op = 4 : i32} : (memref<i64, strided<[], offset: ?>>) -> ()
+        %h, %r = "distruntime.allreduce"(%arg0) {op = 4 : i32} : (memref<i64, strided<[], offset: ?>>) -> (!distruntime.asynchandle, memref<i64, strided<[], offset: ?>>)
+        "distruntime.wait"(%h) : (!distruntime.asynchandle) -> ()
         return
     }
 }
 // CHECK-LABEL: func.func @test_allreduce(%arg0: memref<i64, strided<[], offset: ?>>) {
 // CHECK: memref.cast
-// CHECK: call @_idtr_reduce_all_i64
+// CHECK: [[H:%.*]] = call @_idtr_reduce_all_async_i64
+// CHECK: call @_idtr_wait([[H]])
 
 // -----
 module {
@@ -69,16 +71,21 @@ module {
         return
     }
 }
+// CHECK: memref.global "private" @_idtr_halo1_bbsizes : memref<1xindex> = uninitialized
+// CHECK: memref.global "private" @_idtr_halo1_bboffs : memref<1xindex> = uninitialized
+// CHECK: memref.global "private" @_idtr_halo1_loffs : memref<1xindex> = uninitialized
+// CHECK: memref.global "private" @_idtr_halo1_gshape : memref<1xindex> = uninitialized
 // CHECK-LABEL: func.func @test_wait(%arg0: !ndarray.ndarray<?xi64>) {
-// CHECK: memref.alloc()
-// CHECK: memref.alloc()
-// CHECK: ndarray.to_tensor
-// CHECK: memref.alloc()
-// CHECK: memref.alloc()
+// CHECK-NOT: memref.alloc()
+// CHECK: memref.get_global @_idtr_halo1_gshape
+// CHECK: memref.get_global @_idtr_halo1_loffs
+// CHECK: memref.get_global @_idtr_halo1_bboffs
+// CHECK: memref.get_global @_idtr_halo1_bbsizes
 // CHECK: ndarray.create
 // CHECK: ndarray.to_tensor
 // CHECK: ndarray.create
 // CHECK: ndarray.to_tensor
+// CHECK: ndarray.to_tensor
 // CHECK: [[handle:%.*]] = call @_idtr_update_halo_i64(
 // CHECK-SAME: : (i64, memref<*xindex>, memref<*xindex>, memref<*xi64>, memref<*xindex>, memref<*xindex>, memref<*xi64>, memref<*xi64>, i64) -> i64
 // CHECK: call @_idtr_wait([[handle]]) : (i64) -> ()
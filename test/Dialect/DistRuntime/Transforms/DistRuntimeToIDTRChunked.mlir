@@ -0,0 +1,25 @@
+// RUN: imex-opt --lower-distruntime-to-idtr="copy-chunk-size=4" %s -verify-diagnostics -o -| FileCheck %s
+
+module {
+  func.func @test_copy_permute(%arg0: !ndarray.ndarray<5x2xi64>) -> !ndarray.ndarray<2x5xi64> {
+    %c0 = arith.constant 0 : index
+    %c2 = arith.constant 2 : index
+    %c5 = arith.constant 5 : index
+    %h, %a = distruntime.copy_permute %arg0 g_shape %c5, %c2 l_offs %c0, %c0 to n_offs %c0, %c0 n_shape %c2, %c5 axes [1, 0] {team=22 : i64} : (!ndarray.ndarray<5x2xi64>, index, index, index, index, index, index, index, index) -> (!distruntime.asynchandle, !ndarray.ndarray<2x5xi64>)
+    "distruntime.wait"(%h) : (!distruntime.asynchandle) -> ()
+    return %a : !ndarray.ndarray<2x5xi64>
+  }
+}
+// CHECK-LABEL: func.func @test_copy_permute
+// CHECK: [[V0:%.*]] = ndarray.create %c2, %c5 : (index, index) -> !ndarray.ndarray<2x5xi64>
+// CHECK: memref.subview
+// CHECK: memref.subview
+// CHECK: [[H0:%.*]] = call @_idtr_copy_permute_i64
+// CHECK: [[H:%.*]] = scf.for {{.*}} iter_args([[P:%.*]] = [[H0]]) -> (i64) {
+// CHECK: memref.subview
+// CHECK: memref.subview
+// CHECK: [[HK:%.*]] = func.call @_idtr_copy_permute_i64
+// CHECK: func.call @_idtr_wait([[P]]) : (i64) -> ()
+// CHECK: scf.yield [[HK]] : i64
+// CHECK: call @_idtr_wait([[H]]) : (i64) -> ()
+// CHECK: return [[V0]] : !ndarray.ndarray<2x5xi64>
@@ -0,0 +1,35 @@
+// RUN: imex-opt --split-input-file --lower-distruntime-to-idtr="gpu-aware=1" %s -verify-diagnostics -o -| FileCheck %s
+
+// -----
+module {
+    func.func @test_get_halo(%arg0: !ndarray.ndarray<?xi64, #region.gpu_env<device = "XeGPU">>) {
+        %c0 = arith.constant 0 : index
+        %c4 = arith.constant 4 : index
+        %c12 = arith.constant 12 : index
+        %handle, %lHalo, %rHalo = "distruntime.get_halo"(%arg0, %c12, %c4, %c4, %c4) {team = 22}: (!ndarray.ndarray<?xi64, #region.gpu_env<device = "XeGPU">>, index, index, index, index) -> (!distruntime.asynchandle, !ndarray.ndarray<0xi64, #region.gpu_env<device = "XeGPU">>, !ndarray.ndarray<0xi64, #region.gpu_env<device = "XeGPU">>)
+        "distruntime.wait"(%handle) : (!distruntime.asynchandle) -> ()
+        return
+    }
+}
+// CHECK-LABEL: func.func @test_get_halo
+// CHECK: [[R:%.*]]:3 = region.env_region #region.gpu_env<device = "XeGPU"> -> (i64, !ndarray.ndarray<?xi64, #region.gpu_env<device = "XeGPU">>, !ndarray.ndarray<?xi64, #region.gpu_env<device = "XeGPU">>) {
+// CHECK: ndarray.create
+// CHECK: ndarray.create
+// CHECK: [[handle:%.*]] = func.call @_idtr_update_halo_i64(
+// CHECK: region.env_region_yield [[handle]]
+// CHECK: call @_idtr_wait([[R]]#0) : (i64) -> ()
+
+// -----
+module {
+  func.func @test_copy_reshape(%arg0: !ndarray.ndarray<?x?xi64>) -> !ndarray.ndarray<3xi64> {
+    %c1 = arith.constant 1 : index
+    %c3 = arith.constant 3 : index
+    %c9 = arith.constant 9 : index
+    %handle, %nlArray = distruntime.copy_reshape %arg0 g_shape %c3, %c3 l_offs %c1, %c1 to n_g_shape %c9 n_offs %c3 n_shape %c3 {team = 22 : i64} : (!ndarray.ndarray<?x?xi64>, index, index, index, index, index, index, index) -> (!distruntime.asynchandle, !ndarray.ndarray<3xi64>)
+    "distruntime.wait"(%handle) : (!distruntime.asynchandle) -> ()
+    return %nlArray : !ndarray.ndarray<3xi64>
+  }
+}
+// CHECK-LABEL: func.func @test_copy_reshape
+// CHECK-NOT: region.env_region
+// CHECK: call @_idtr_copy_reshape_i64
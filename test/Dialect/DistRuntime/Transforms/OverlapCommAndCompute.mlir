@@ -56,10 +56,12 @@ module {
 // CHECK-SAME: {op = 0 : i32} : (!ndarray.ndarray<30x96xf64>, !ndarray.ndarray<30x96xf64>) -> !ndarray.ndarray<30x96xf64>
 // CHECK: ndarray.ewbin
 // CHECK-SAME: {op = 0 : i32} : (!ndarray.ndarray<30x96xf64>, !ndarray.ndarray<30x96xf64>) -> !ndarray.ndarray<30x96xf64>
+// CHECK: ndarray.ewbin
+// CHECK-SAME: {op = 0 : i32} : (!ndarray.ndarray<2x96xf64>, !ndarray.ndarray<2x96xf64>) -> !ndarray.ndarray<2x96xf64>
 // CHECK: "distruntime.wait"([[handle]]) : (!distruntime.asynchandle) -> ()
 // CHECK-NEXT: ndarray.subview [[lHaloCast]]
 // CHECK: ndarray.ewbin
 // CHECK: ndarray.ewbin
-// CHECK: ndarray.ewbin
 // CHECK: ndarray.subview [[rHalo]]
 // CHECK: ndarray.ewbin
+// CHECK-NOT: ndarray.ewbin
@@ -0,0 +1,35 @@
+// RUN: imex-opt %s -overlap-comm-and-compute | FileCheck %s
+
+module {
+  func.func @test_gpu(%arg0: !ndarray.ndarray<34x96xf64, #region.gpu_env<device = "XeGPU">>, %arg1: !ndarray.ndarray<34x96xf64, #region.gpu_env<device = "XeGPU">>) {
+    %c0 = arith.constant 0 : index
+    %c32 = arith.constant 32 : index
+    %c34 = arith.constant 34 : index
+    %c36 = arith.constant 36 : index
+    %c96 = arith.constant 96 : index
+    %c100 = arith.constant 100 : index
+    %handle, %lHalo, %rHalo = "distruntime.get_halo"(%arg0, %c100, %c96, %c34, %c0, %c32, %c0, %c36, %c96) {team = 22} : (!ndarray.ndarray<34x96xf64, #region.gpu_env<device = "XeGPU">>, index, index, index, index, index, index, index, index) -> (!distruntime.asynchandle, !ndarray.ndarray<2x96xf64, #region.gpu_env<device = "XeGPU">>, !ndarray.ndarray<0x96xf64, #region.gpu_env<device = "XeGPU">>)
+    "distruntime.wait"(%handle) : (!distruntime.asynchandle) -> ()
+    %0 = region.env_region #region.gpu_env<device = "XeGPU"> -> !ndarray.ndarray<2x96xf64, #region.gpu_env<device = "XeGPU">> {
+      %1 = ndarray.ewbin %lHalo, %lHalo {op = 0 : i32} : (!ndarray.ndarray<2x96xf64, #region.gpu_env<device = "XeGPU">>, !ndarray.ndarray<2x96xf64, #region.gpu_env<device = "XeGPU">>) -> !ndarray.ndarray<2x96xf64, #region.gpu_env<device = "XeGPU">>
+      region.env_region_yield %1 : !ndarray.ndarray<2x96xf64, #region.gpu_env<device = "XeGPU">>
+    }
+    %2 = region.env_region #region.gpu_env<device = "XeGPU"> -> !ndarray.ndarray<34x96xf64, #region.gpu_env<device = "XeGPU">> {
+      %3 = ndarray.ewbin %arg0, %arg1 {op = 0 : i32} : (!ndarray.ndarray<34x96xf64, #region.gpu_env<device = "XeGPU">>, !ndarray.ndarray<34x96xf64, #region.gpu_env<device = "XeGPU">>) -> !ndarray.ndarray<34x96xf64, #region.gpu_env<device = "XeGPU">>
+      region.env_region_yield %3 : !ndarray.ndarray<34x96xf64, #region.gpu_env<device = "XeGPU">>
+    }
+    return
+  }
+}
+
+// The GPU region computing the interior is launched before the wait, the
+// one using the halo after it.
+// CHECK-LABEL: func.func @test_gpu
+// CHECK: [[handle:%.*]], [[lHalo:%.*]], [[rHalo:%.*]] = "distruntime.get_halo"
+// CHECK-NEXT: region.env_region #region.gpu_env<device = "XeGPU">
+// CHECK-NEXT: ndarray.ewbin %arg0, %arg1
+// CHECK-NEXT: region.env_region_yield
+// CHECK-NEXT: }
+// CHECK-NEXT: "distruntime.wait"([[handle]]) : (!distruntime.asynchandle) -> ()
+// CHECK-NEXT: region.env_region #region.gpu_env<device = "XeGPU">
+// CHECK-NEXT: ndarray.ewbin [[lHalo]], [[lHalo]]
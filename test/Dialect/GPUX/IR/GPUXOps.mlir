@@ -68,3 +68,35 @@ func.func @test_gpux_memset(%dst : memref<3x7xf32>, %value : f32) {
     "gpux.memset"(%0, %dst, %value) : (!gpux.StreamType, memref<3x7xf32>, f32) -> ()
     return
 }
+
+// CHECK-LABEL: @test_gpux_graph
+func.func @test_gpux_graph() {
+    %0 = "gpux.create_stream"() : () -> !gpux.StreamType
+    %cst = arith.constant 8 : index
+    %1 = "gpux.alloc"(%0) {operandSegmentSizes = array<i32: 0, 1, 0, 0>} : (!gpux.StreamType) -> memref<13xf32, 1>
+    // CHECK: "gpux.graph"
+    // CHECK: arith.muli
+    // CHECK: "gpux.launch_func"
+    "gpux.graph"(%0) ({
+      %2 = arith.muli %cst, %cst : index
+      "gpux.launch_func"(%0, %2, %cst, %cst, %cst, %cst, %cst, %1, %1) {kernel = @kernels::@kernel_1, operandSegmentSizes = array<i32: 0, 1, 1, 1, 1, 1, 1, 1, 0, 2>}
+                       : (!gpux.StreamType, index, index, index, index, index, index, memref<13xf32, 1>, memref<13xf32, 1>) -> ()
+    }) : (!gpux.StreamType) -> ()
+    return
+}
+
+// CHECK-LABEL: @test_gpux_prefetch
+func.func @test_gpux_prefetch(%arg : memref<3x7xf32>) {
+    %0 = "gpux.create_stream"() : () -> !gpux.StreamType
+    // CHECK: "gpux.prefetch"
+    "gpux.prefetch"(%0, %arg) : (!gpux.StreamType, memref<3x7xf32>) -> ()
+    return
+}
+
+// CHECK-LABEL: @test_gpux_mem_advise
+func.func @test_gpux_mem_advise(%arg : memref<3x7xf32>) {
+    %0 = "gpux.create_stream"() : () -> !gpux.StreamType
+    // CHECK: "gpux.mem_advise"(%{{.*}}, %{{.*}}) <{advice = "read_mostly"}>
+    "gpux.mem_advise"(%0, %arg) {advice = "read_mostly"} : (!gpux.StreamType, memref<3x7xf32>) -> ()
+    return
+}
@@ -0,0 +1,38 @@
+// RUN: imex-opt %s -split-input-file -verify-diagnostics
+
+gpu.module @kernels {
+  gpu.func @kernel_1() kernel {
+    gpu.return
+  }
+}
+
+// The launches of a graph only run at its end, so the host cannot read their
+// results inside of it.
+func.func @test_graph_host_load() -> f32 {
+    %0 = "gpux.create_stream"() : () -> !gpux.StreamType
+    %c0 = arith.constant 0 : index
+    %cst = arith.constant 8 : index
+    %1 = "gpux.alloc"(%0) {operandSegmentSizes = array<i32: 0, 1, 0, 0>} : (!gpux.StreamType) -> memref<13xf32>
+    %2 = memref.alloca() : memref<f32>
+    // expected-error@+1 {{'gpux.graph' op only kernel launches may access memory, found memref.load}}
+    "gpux.graph"(%0) ({
+      "gpux.launch_func"(%0, %cst, %cst, %cst, %cst, %cst, %cst, %1, %1) {kernel = @kernels::@kernel_1, operandSegmentSizes = array<i32: 0, 1, 1, 1, 1, 1, 1, 1, 0, 2>}
+                       : (!gpux.StreamType, index, index, index, index, index, index, memref<13xf32>, memref<13xf32>) -> ()
+      %3 = memref.load %1[%c0] : memref<13xf32>
+      memref.store %3, %2[] : memref<f32>
+    }) : (!gpux.StreamType) -> ()
+    %4 = memref.load %2[] : memref<f32>
+    return %4 : f32
+}
+
+// -----
+
+func.func @test_graph_other_op() {
+    %0 = "gpux.create_stream"() : () -> !gpux.StreamType
+    %1 = "gpux.alloc"(%0) {operandSegmentSizes = array<i32: 0, 1, 0, 0>} : (!gpux.StreamType) -> memref<13xf32, 1>
+    // expected-error@+1 {{'gpux.graph' op only kernel launches can be recorded, found gpux.dealloc}}
+    "gpux.graph"(%0) ({
+      "gpux.dealloc"(%0, %1) : (!gpux.StreamType, memref<13xf32, 1>) -> ()
+    }) : (!gpux.StreamType) -> ()
+    return
+}
@@ -1,4 +1,5 @@
 // RUN: imex-opt --split-input-file --add-gpu-regions %s -verify-diagnostics -o -| FileCheck %s
+// RUN: imex-opt --split-input-file --add-gpu-regions="min-gpu-elements=1024" %s -verify-diagnostics -o -| FileCheck %s --check-prefix=MIN
 
 func.func @test_region(%arg0: i64, %arg1: i64, %arg2: i64) -> i64 {
     %c0 = arith.constant 0 : index
@@ -80,3 +81,19 @@ func.func @test_copy() -> !ndarray.ndarray<33xi64> {
 // CHECK-SAME: !ndarray.ndarray<33xi64> -> !ndarray.ndarray<33xi64>
 // CHECK: return
 // CHECK-SAME: !ndarray.ndarray<33xi64>
+
+// -----
+func.func @test_min_elements(%arg0: !ndarray.ndarray<4xi64, #region.gpu_env<device = "XeGPU">>, %arg1: !ndarray.ndarray<4096xi64, #region.gpu_env<device = "XeGPU">>) -> (!ndarray.ndarray<4xi64, #region.gpu_env<device = "XeGPU">>, !ndarray.ndarray<4096xi64, #region.gpu_env<device = "XeGPU">>) {
+    %0 = ndarray.ewbin %arg0, %arg0 {op = 0 : i32} : (!ndarray.ndarray<4xi64, #region.gpu_env<device = "XeGPU">>, !ndarray.ndarray<4xi64, #region.gpu_env<device = "XeGPU">>) -> !ndarray.ndarray<4xi64, #region.gpu_env<device = "XeGPU">>
+    %1 = ndarray.ewbin %arg1, %arg1 {op = 0 : i32} : (!ndarray.ndarray<4096xi64, #region.gpu_env<device = "XeGPU">>, !ndarray.ndarray<4096xi64, #region.gpu_env<device = "XeGPU">>) -> !ndarray.ndarray<4096xi64, #region.gpu_env<device = "XeGPU">>
+    return %0, %1 : !ndarray.ndarray<4xi64, #region.gpu_env<device = "XeGPU">>, !ndarray.ndarray<4096xi64, #region.gpu_env<device = "XeGPU">>
+}
+// CHECK-LABEL: func.func @test_min_elements
+// CHECK: region.env_region
+// CHECK-NEXT: ndarray.ewbin %arg0
+// CHECK: region.env_region
+// CHECK-NEXT: ndarray.ewbin %arg1
+// MIN-LABEL: func.func @test_min_elements
+// MIN-NEXT: ndarray.ewbin %arg0
+// MIN-NEXT: region.env_region
+// MIN-NEXT: ndarray.ewbin %arg1
@@ -0,0 +1,55 @@
+// RUN: imex-opt --split-input-file --ndarray-early-delete %s -verify-diagnostics -o -| FileCheck %s
+
+func.func @test_view(%arg0: i64, %arg1: i64) -> i64 {
+    %c0 = arith.constant 0 : index
+    %c3 = arith.constant 3 : index
+    %c10 = arith.constant 10 : index
+    %c33 = arith.constant 33 : i64
+    %0 = ndarray.linspace %arg0 %arg1 %c33 false : (i64, i64, i64) -> !ndarray.ndarray<33xi64>
+    %1 = ndarray.subview %0[%c0][%c10][%c3] : !ndarray.ndarray<33xi64> to !ndarray.ndarray<?xi64>
+    %2 = ndarray.ewbin %1, %1 {op = 0 : i32} : (!ndarray.ndarray<?xi64>, !ndarray.ndarray<?xi64>) -> !ndarray.ndarray<?xi64>
+    %3 = ndarray.reduction %2 {op = 4 : i32} : !ndarray.ndarray<?xi64> -> !ndarray.ndarray<i64>
+    %4 = builtin.unrealized_conversion_cast %3 : !ndarray.ndarray<i64> to i64
+    return %4 : i64
+}
+// CHECK-LABEL: func.func @test_view
+// CHECK: [[V0:%.*]] = ndarray.linspace
+// CHECK-NEXT: [[V1:%.*]] = ndarray.subview [[V0]]
+// CHECK-NEXT: ndarray.ewbin [[V1]], [[V1]]
+// CHECK-NEXT: ndarray.delete [[V0]] : !ndarray.ndarray<33xi64>
+// CHECK-NEXT: ndarray.reduction
+// CHECK-NOT: ndarray.delete
+// CHECK: return
+
+// -----
+func.func @test_loop(%arg0: !ndarray.ndarray<?xi64>) {
+    %c0 = arith.constant 0 : index
+    %c1 = arith.constant 1 : index
+    %c3 = arith.constant 3 : index
+    %v = arith.constant 5 : i64
+    %0 = ndarray.create %c3 value %v {dtype = 2 : i8} : (index, i64) -> !ndarray.ndarray<?xi64>
+    scf.for %i = %c0 to %c3 step %c1 {
+      ndarray.insert_slice %0 into %arg0[%i] [%c3] [%c1] : !ndarray.ndarray<?xi64> into !ndarray.ndarray<?xi64>
+    }
+    return
+}
+// CHECK-LABEL: func.func @test_loop
+// CHECK: [[V0:%.*]] = ndarray.create
+// CHECK: scf.for
+// CHECK-NEXT: ndarray.insert_slice [[V0]]
+// CHECK-NEXT: }
+// CHECK-NEXT: ndarray.delete [[V0]] : !ndarray.ndarray<?xi64>
+// CHECK-NEXT: return
+
+// -----
+func.func @test_escape(%arg0: !ndarray.ndarray<5xi64>) -> !ndarray.ndarray<?xi64> {
+    %c0 = arith.constant 0 : index
+    %c1 = arith.constant 1 : index
+    %c3 = arith.constant 3 : index
+    %0 = ndarray.copy %arg0 : !ndarray.ndarray<5xi64> -> !ndarray.ndarray<5xi64>
+    %1 = ndarray.subview %0[%c0][%c3][%c1] : !ndarray.ndarray<5xi64> to !ndarray.ndarray<?xi64>
+    return %1 : !ndarray.ndarray<?xi64>
+}
+// CHECK-LABEL: func.func @test_escape
+// CHECK-NOT: ndarray.delete
+// CHECK: return
@@ -58,3 +58,13 @@ func.func @test_ewbin(%arg0: !ndarray.ndarray<11xf64, #dist.dist_env<team = 22 :
 // CHECK: [[V1:%.*]] = dist.repartition
 // CHECK: [[V2:%.*]] = dist.repartition
 // CHECK: "dist.ewbin"([[V1]], [[V2]])
+
+// -----
+func.func @test_ewbin_bcast(%arg0: !ndarray.ndarray<11x4xf64, #dist.dist_env<team = 22 : i64 loffs = 0,0 lparts = ?x4,?x4,?x4>>, %arg1: !ndarray.ndarray<4xf64, #dist.dist_env<team = 22 : i64 loffs = 0 lparts = ?,?,?>>) -> !ndarray.ndarray<?x4xf64, #dist.dist_env<team = 22 : i64 loffs = 0,0 lparts = ?x4,?x4,?x4>> {
+    %0 = ndarray.ewbin %arg0, %arg1 {op = 0 : i32} : (!ndarray.ndarray<11x4xf64, #dist.dist_env<team = 22 : i64 loffs = 0,0 lparts = ?x4,?x4,?x4>>, !ndarray.ndarray<4xf64, #dist.dist_env<team = 22 : i64 loffs = 0 lparts = ?,?,?>>) -> !ndarray.ndarray<?x4xf64, #dist.dist_env<team = 22 : i64 loffs = 0,0 lparts = ?x4,?x4,?x4>>
+    return %0 : !ndarray.ndarray<?x4xf64, #dist.dist_env<team = 22 : i64 loffs = 0,0 lparts = ?x4,?x4,?x4>>
+}
+// CHECK-LABEL: func.func @test_ewbin_bcast
+// CHECK: [[V1:%.*]] = dist.repartition %arg0 :
+// CHECK: [[V2:%.*]] = dist.repartition %arg1 loffs %{{.*}} lsizes %{{.*}} :
+// CHECK: "dist.ewbin"([[V1]], [[V2]])
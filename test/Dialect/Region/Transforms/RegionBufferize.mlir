@@ -19,3 +19,28 @@ module {
 // CHECK-NEXT: region.env_region_yield [[V1]] : memref<16xi64>
 // CHECK: [[V2:%.*]] = memref.cast [[R1]] : memref<16xi64> to memref<16xi64, strided<[?], offset: ?>>
 // CHECK-NEXT: return [[V2]] : memref<16xi64, strided<[?], offset: ?>>
+
+// -----
+
+// The fill updates the tensor defined above the region in place and the
+// result is that same buffer, without a copy.
+module {
+  func.func @test_inplace() -> memref<16xi64, strided<[?], offset: ?>> {
+    %c1_i64 = arith.constant 1 : i64
+    %0 = bufferization.alloc_tensor() : tensor<16xi64>
+    %1 = region.env_region #region.gpu_env<device = "gpu"> -> tensor<16xi64> {
+      %2 = linalg.fill ins(%c1_i64 : i64) outs(%0 : tensor<16xi64>) -> tensor<16xi64>
+      region.env_region_yield %2 : tensor<16xi64>
+    }
+    %3 = bufferization.to_memref %1 : tensor<16xi64> to memref<16xi64, strided<[?], offset: ?>>
+    return %3 : memref<16xi64, strided<[?], offset: ?>>
+  }
+}
+// CHECK-LABEL: func.func @test_inplace
+// CHECK: [[V0:%.*]] = memref.alloc() {alignment = 64 : i64} : memref<16xi64>
+// CHECK-NOT: memref.alloc
+// CHECK-NOT: memref.copy
+// CHECK: [[R1:%.*]] = region.env_region #region.gpu_env<device = "gpu"> -> memref<16xi64> {
+// CHECK-NEXT: linalg.fill ins(%{{.*}} : i64) outs([[V0]] : memref<16xi64>)
+// CHECK-NEXT: region.env_region_yield [[V0]] : memref<16xi64>
+// CHECK: memref.cast [[R1]]
@@ -65,3 +65,72 @@ func.func @test_merge_region1() {
 // CHECK-NEXT: "test.test3"() : () -> ()
 // CHECK-NEXT: }
 // CHECK-NEXT: return
+
+// -----
+func.func @test_merge_region_hoist_between(%arg0: index) -> index {
+  region.env_region "test" {
+    "test.test1"() : () -> ()
+  }
+  %0 = arith.addi %arg0, %arg0 : index
+  region.env_region "test" {
+    "test.test2"(%0) : (index) -> ()
+  }
+  return %0 : index
+}
+// CHECK-LABEL: func @test_merge_region_hoist_between
+// CHECK-NEXT: %[[ADD:.*]] = arith.addi
+// CHECK-NEXT: region.env_region "test" {
+// CHECK-NEXT: "test.test1"() : () -> ()
+// CHECK-NEXT: "test.test2"(%[[ADD]]) : (index) -> ()
+// CHECK-NEXT: }
+// CHECK-NEXT: return %[[ADD]]
+
+// -----
+func.func @test_no_merge_region_side_effect() {
+  region.env_region "test" {
+    "test.test1"() : () -> ()
+  }
+  "test.side_effect"() : () -> ()
+  region.env_region "test" {
+    "test.test2"() : () -> ()
+  }
+  return
+}
+// CHECK-LABEL: func @test_no_merge_region_side_effect
+// CHECK-NEXT: region.env_region "test" {
+// CHECK-NEXT: "test.test1"() : () -> ()
+// CHECK-NEXT: }
+// CHECK-NEXT: "test.side_effect"() : () -> ()
+// CHECK-NEXT: region.env_region "test" {
+// CHECK-NEXT: "test.test2"() : () -> ()
+// CHECK-NEXT: }
+
+// -----
+func.func @test_hoist_scalar_ops(%arg0: index) {
+  region.env_region "test" {
+    %0 = arith.muli %arg0, %arg0 : index
+    "test.test1"(%0) : (index) -> ()
+  }
+  return
+}
+// CHECK-LABEL: func @test_hoist_scalar_ops
+// CHECK-NEXT: %[[MUL:.*]] = arith.muli
+// CHECK-NEXT: region.env_region "test" {
+// CHECK-NEXT: "test.test1"(%[[MUL]]) : (index) -> ()
+// CHECK-NEXT: }
+
+// -----
+func.func @test_forward_yield(%arg0: tensor<16xf64>) -> (tensor<16xf64>, tensor<16xf64>) {
+  %0:2 = region.env_region "test" -> tensor<16xf64>, tensor<16xf64> {
+    %1 = "test.test1"() : () -> tensor<16xf64>
+    region.env_region_yield %arg0, %1 : tensor<16xf64>, tensor<16xf64>
+  }
+  return %0#0, %0#1 : tensor<16xf64>, tensor<16xf64>
+}
+// CHECK-LABEL: func @test_forward_yield
+// CHECK-SAME: (%[[ARG:.*]]: tensor<16xf64>)
+// CHECK-NEXT: %[[RES:.*]] = region.env_region "test" -> tensor<16xf64> {
+// CHECK-NEXT: %[[T:.*]] = "test.test1"() : () -> tensor<16xf64>
+// CHECK-NEXT: region.env_region_yield %[[T]] : tensor<16xf64>
+// CHECK-NEXT: }
+// CHECK-NEXT: return %[[ARG]], %[[RES]]
@@ -0,0 +1,36 @@
+// RUN: imex-opt --split-input-file --xetile-blocking="grf-mode=auto" %s -verify-diagnostics -o -| FileCheck %s --check-prefix=AUTO
+// RUN: imex-opt --split-input-file --xetile-blocking="grf-mode=small" %s -verify-diagnostics -o -| FileCheck %s --check-prefix=SMALL
+// RUN: imex-opt --split-input-file --xetile-blocking %s -verify-diagnostics -o -| FileCheck %s --check-prefix=NONE
+
+gpu.module @test_kernel {
+  // A 32x32xf32 tile occupies 64 GRFs and fits the default register file.
+  // AUTO-LABEL: gpu.func @small_kernel
+  // AUTO-SAME: kernel attributes {imex.grf_size = 128 : i32}
+  // SMALL-LABEL: gpu.func @small_kernel
+  // SMALL-SAME: kernel attributes {imex.grf_size = 128 : i32}
+  // NONE-NOT: imex.grf_size
+  gpu.func @small_kernel(%a: memref<1024x1024xf32>, %b: memref<1024x1024xf32>) kernel {
+    %c0 = arith.constant 0 : index
+    %a_tile = xetile.init_tile %a[%c0, %c0] : memref<1024x1024xf32> -> !xetile.tile<32x32xf32>
+    %a_value = xetile.load_tile %a_tile : !xetile.tile<32x32xf32> -> vector<32x32xf32>
+    %b_tile = xetile.init_tile %b[%c0, %c0] : memref<1024x1024xf32> -> !xetile.tile<32x32xf32>
+    xetile.store_tile %a_value, %b_tile : vector<32x32xf32>, !xetile.tile<32x32xf32>
+    gpu.return
+  }
+
+  // Two 64x32xf32 values, 128 GRFs each, are live at the addf.
+  // AUTO-LABEL: gpu.func @large_kernel
+  // AUTO-SAME: kernel attributes {imex.grf_size = 256 : i32}
+  // SMALL-LABEL: gpu.func @large_kernel
+  // SMALL-SAME: kernel attributes {imex.grf_size = 128 : i32}
+  gpu.func @large_kernel(%a: memref<1024x1024xf32>, %b: memref<1024x1024xf32>) kernel {
+    %c0 = arith.constant 0 : index
+    %a_tile = xetile.init_tile %a[%c0, %c0] : memref<1024x1024xf32> -> !xetile.tile<64x32xf32>
+    %a_value = xetile.load_tile %a_tile : !xetile.tile<64x32xf32> -> vector<64x32xf32>
+    %b_tile = xetile.init_tile %b[%c0, %c0] : memref<1024x1024xf32> -> !xetile.tile<64x32xf32>
+    %b_value = xetile.load_tile %b_tile : !xetile.tile<64x32xf32> -> vector<64x32xf32>
+    %sum = arith.addf %a_value, %b_value : vector<64x32xf32>
+    xetile.store_tile %sum, %b_tile : vector<64x32xf32>, !xetile.tile<64x32xf32>
+    gpu.return
+  }
+}
@@ -0,0 +1,35 @@
+// RUN: imex-opt --xetile-blocking="tuning-db=%S/Inputs/tuning.db" %s -o - | FileCheck %s
+// RUN: imex-opt --xetile-blocking %s -o - | FileCheck %s --check-prefix=DEFAULT
+// RUN: rm -f %t.db
+// RUN: imex-opt --xetile-blocking="tuning-mode=cost-model tuning-db=%t.db" %s -o /dev/null
+// RUN: FileCheck %s --check-prefix=DB < %t.db
+
+// DB-DAG: pvc{{[[:space:]]}}xetile.load_tile : (!xetile.tile<32x32xf16>) -> vector<32x32xf16> request [8, 16]{{[[:space:]]}}h=32
+// DB-DAG: pvc{{[[:space:]]}}xetile.load_tile : (!xetile.tile<32x32xf16>) -> vector<32x32xf16> request [16, 16]{{[[:space:]]}}h=32
+// DB-DAG: pvc{{[[:space:]]}}xetile.tile_mma : (vector<32x32xf16>, vector<32x32xf16>) -> vector<32x32xf32>{{[[:space:]]}}m=8
+
+gpu.module @test_kernel {
+  // The database selects 4-row DPAS and 8-row loads of A.
+  //CHECK: gpu.func @sg_tile_mma(%[[arg0:.*]]: memref<32x32xf16>, %[[arg1:.*]]: memref<32x32xf16>)
+  //CHECK-COUNT-8: xetile.init_tile %[[arg0]][{{.*}}] : memref<32x32xf16> -> !xetile.tile<8x16xf16>
+  //CHECK-COUNT-8: xetile.load_tile %{{.*}} : !xetile.tile<8x16xf16> -> vector<8x16xf16>
+  //CHECK-COUNT-2: xetile.init_tile %[[arg1]][{{.*}}] : memref<32x32xf16> -> !xetile.tile<32x16xf16>
+  //CHECK-COUNT-2: xetile.load_tile %{{.*}} : !xetile.tile<32x16xf16> -> vector<32x16xf16>
+  //CHECK-COUNT-16: vector.extract_strided_slice %{{.*}} {offsets = [{{.*}}], sizes = [4, 16], strides = [1, 1]} : vector<8x16xf16> to vector<4x16xf16>
+  //CHECK-COUNT-4: vector.extract_strided_slice %{{.*}} {offsets = [{{.*}}], sizes = [16, 16], strides = [1, 1]} : vector<32x16xf16> to vector<16x16xf16>
+  //CHECK-COUNT-32: xetile.tile_mma %{{.*}}, %{{.*}}{{.*}} : vector<4x16xf16>, vector<16x16xf16>{{.*}} -> vector<4x16xf32>
+
+  //DEFAULT: gpu.func @sg_tile_mma(%[[arg0:.*]]: memref<32x32xf16>, %[[arg1:.*]]: memref<32x32xf16>)
+  //DEFAULT-COUNT-2: xetile.init_tile %[[arg0]][{{.*}}] : memref<32x32xf16> -> !xetile.tile<32x16xf16>
+  //DEFAULT: xetile.init_tile %[[arg1]]
+  //DEFAULT-COUNT-16: xetile.tile_mma %{{.*}}, %{{.*}}{{.*}} : vector<8x16xf16>, vector<16x16xf16>{{.*}} -> vector<8x16xf32>
+  gpu.func @sg_tile_mma(%a: memref<32x32xf16>, %b: memref<32x32xf16>) {
+    %c0 = arith.constant 0 : index
+    %1 = xetile.init_tile %a[%c0, %c0] : memref<32x32xf16> -> !xetile.tile<32x32xf16>
+    %2 = xetile.load_tile %1 : !xetile.tile<32x32xf16> -> vector<32x32xf16>
+    %3 = xetile.init_tile %b[%c0, %c0] : memref<32x32xf16> -> !xetile.tile<32x32xf16>
+    %4 = xetile.load_tile %3 : !xetile.tile<32x32xf16> -> vector<32x32xf16>
+    %5 = xetile.tile_mma %2, %4: vector<32x32xf16>, vector<32x32xf16> -> vector<32x32xf32>
+    gpu.return
+  }
+}
@@ -54,4 +54,47 @@ gpu.module @test_convert_layout{
     %conv_layout = xetile.convert_layout %trans {wg_map_result = #xetile.wg_map<sg_layout = [2, 16], sg_data = [4, 8]>} : vector<8x128xf32>
     gpu.return
   }
+
+  //CHECK-LABEL: gpu.func @test_conv_layout_in_registers
+  gpu.func @test_conv_layout_in_registers() {
+    //CHECK: %[[CST:.*]] = arith.constant dense<0.000000e+00> : vector<32x64xf32>
+    //CHECK-NOT: memref.alloc
+    //CHECK: gpu.subgroup_id : index
+    //CHECK: %[[S3:.*]] = vector.extract_strided_slice %[[CST]] {offsets = [24, 0], sizes = [8, 64], strides = [1, 1]} : vector<32x64xf32> to vector<8x64xf32>
+    //CHECK: %[[S2:.*]] = vector.extract_strided_slice %[[CST]] {offsets = [16, 0], sizes = [8, 64], strides = [1, 1]} : vector<32x64xf32> to vector<8x64xf32>
+    //CHECK: %[[SEL2:.*]] = arith.select %{{.*}}, %[[S2]], %[[S3]] : vector<8x64xf32>
+    //CHECK: %[[S1:.*]] = vector.extract_strided_slice %[[CST]] {offsets = [8, 0], sizes = [8, 64], strides = [1, 1]} : vector<32x64xf32> to vector<8x64xf32>
+    //CHECK: %[[SEL1:.*]] = arith.select %{{.*}}, %[[S1]], %[[SEL2]] : vector<8x64xf32>
+    //CHECK: %[[S0:.*]] = vector.extract_strided_slice %[[CST]] {offsets = [0, 0], sizes = [8, 64], strides = [1, 1]} : vector<32x64xf32> to vector<8x64xf32>
+    //CHECK: %[[SEL0:.*]] = arith.select %{{.*}}, %[[S0]], %[[SEL1]] : vector<8x64xf32>
+    //CHECK-NOT: gpu.barrier
+    //CHECK: arith.addf %{{.*}}, %[[SEL0]] : vector<8x64xf32>
+    %cst = arith.constant {map = #xetile.wg_map<sg_layout = [1, 4], sg_data = [32, 64]>} dense<0.000000e+00> : vector<32x64xf32>
+    %cst_0 = arith.constant {map = #xetile.wg_map<sg_layout = [4, 1], sg_data = [8, 64]>} dense<1.000000e+00> : vector<32x64xf32>
+    %conv_layout = xetile.convert_layout %cst {wg_map_result = #xetile.wg_map<sg_layout = [4, 1], sg_data = [8, 64]>, wg_map_source = #xetile.wg_map<sg_layout = [1, 4], sg_data = [32, 64]>} : vector<32x64xf32>
+    %add = arith.addf %cst_0, %conv_layout {map = #xetile.wg_map<sg_layout = [4, 1], sg_data = [8, 64]>} : vector<32x64xf32>
+    gpu.return
+  }
+
+  //CHECK-LABEL: gpu.func @test_conv_layout_replicated_source
+  gpu.func @test_conv_layout_replicated_source() {
+    //CHECK: %[[SLM:.*]] = memref.view {{.*}} : memref<8192xi8, 3> to memref<32x64xf32, 3>
+    //CHECK: %[[SGID:.*]] = gpu.subgroup_id : index
+    //CHECK: %[[X:.*]] = index.divu %[[SGID]], %{{.*}}
+    //CHECK: %[[Y:.*]] = index.remu %[[SGID]], %{{.*}}
+    //CHECK: %[[CMPX:.*]] = arith.cmpi ult, %[[X]], %{{.*}} : index
+    //CHECK: %[[CMPY:.*]] = arith.cmpi ult, %[[Y]], %{{.*}} : index
+    //CHECK: %[[FIRST:.*]] = arith.andi %[[CMPX]], %[[CMPY]] : i1
+    //CHECK: scf.if %[[FIRST]] {
+    //CHECK:   %[[ST:.*]] = xetile.init_tile %[[SLM]]
+    //CHECK:   xetile.store_tile %{{.*}}, %[[ST]] : vector<16x64xf32>
+    //CHECK: }
+    //CHECK: gpu.barrier
+    //CHECK: xetile.load_tile %{{.*}} -> vector<32x16xf32>
+    %cst = arith.constant {map = #xetile.wg_map<sg_layout = [2, 2], sg_data = [16, 64]>} dense<0.000000e+00> : vector<32x64xf32>
+    %cst_0 = arith.constant {map = #xetile.wg_map<sg_layout = [1, 4], sg_data = [32, 16]>} dense<1.000000e+00> : vector<32x64xf32>
+    %conv_layout = xetile.convert_layout %cst {wg_map_result = #xetile.wg_map<sg_layout = [1, 4], sg_data = [32, 16]>, wg_map_source = #xetile.wg_map<sg_layout = [2, 2], sg_data = [16, 64]>} : vector<32x64xf32>
+    %add = arith.addf %cst_0, %conv_layout {map = #xetile.wg_map<sg_layout = [1, 4], sg_data = [32, 16]>} : vector<32x64xf32>
+    gpu.return
+  }
 }
@@ -0,0 +1,43 @@
+// RUN: imex-opt --split-input-file --xetile-wg-to-sg --cse %s -verify-diagnostics | FileCheck %s
+
+// The batch (head) dimension is mapped to the z dimension of the grid and
+// indexes the outer dimension of the memrefs. The decomposition only splits
+// the two innermost dimensions across subgroups, the batch offset is kept.
+
+#wg_map_a = #xetile.wg_map<sg_layout = [4, 4], sg_data = [32, 128]>
+#wg_map_b = #xetile.wg_map<sg_layout = [4, 4], sg_data = [128, 32]>
+#wg_map_c = #xetile.wg_map<sg_layout = [4, 4], sg_data = [32, 32]>
+
+gpu.module @test_batch_grid_z {
+  // CHECK-LABEL: gpu.func @batch_gemm
+  gpu.func @batch_gemm(%A: memref<12x256x128xf16>, %B: memref<12x128x256xf16>, %C: memref<?x?x?xf32>) kernel {
+    %c0 = arith.constant 0 : index
+    %c1 = arith.constant 1 : index
+    %c2 = arith.constant 2 : index
+    %c128 = arith.constant 128 : index
+    %cst = arith.constant {map = #wg_map_c} dense<0.000000e+00> : vector<128x128xf32>
+    // CHECK: %[[BATCH:.*]] = gpu.block_id z
+    %block_id_x = gpu.block_id x
+    %block_id_y = gpu.block_id y
+    %batch = gpu.block_id z
+    %m = arith.muli %block_id_x, %c128 : index
+    %n = arith.muli %block_id_y, %c128 : index
+    %H = memref.dim %C, %c0 : memref<?x?x?xf32>
+    %M = memref.dim %C, %c1 : memref<?x?x?xf32>
+    %N = memref.dim %C, %c2 : memref<?x?x?xf32>
+    %stride_h = arith.muli %M, %N : index
+    // CHECK: xetile.init_tile %{{.*}}[%[[BATCH]], %{{.*}}, %{{.*}}] : memref<12x256x128xf16> -> !xetile.tile<32x128xf16>
+    // CHECK: xetile.init_tile %{{.*}}[%[[BATCH]], %{{.*}}, %{{.*}}] : memref<12x128x256xf16> -> !xetile.tile<128x32xf16>
+    %a_tile = xetile.init_tile %A[%batch, %m, %c0] : memref<12x256x128xf16> -> !xetile.tile<128x128xf16, #xetile.tile_attr<wg_map = #wg_map_a>>
+    %b_tile = xetile.init_tile %B[%batch, %c0, %n] : memref<12x128x256xf16> -> !xetile.tile<128x128xf16, #xetile.tile_attr<wg_map = #wg_map_b>>
+    %a = xetile.load_tile %a_tile : !xetile.tile<128x128xf16, #xetile.tile_attr<wg_map = #wg_map_a>> -> vector<128x128xf16>
+    %b = xetile.load_tile %b_tile : !xetile.tile<128x128xf16, #xetile.tile_attr<wg_map = #wg_map_b>> -> vector<128x128xf16>
+    // CHECK: xetile.tile_mma {{.*}} : vector<32x128xf16>, vector<128x32xf16>, vector<32x32xf32> -> vector<32x32xf32>
+    %c = xetile.tile_mma %a, %b, %cst {wg_map_a = #wg_map_a, wg_map_b = #wg_map_b, wg_map_c = #wg_map_c} : vector<128x128xf16>, vector<128x128xf16>, vector<128x128xf32> -> vector<128x128xf32>
+    // CHECK: %[[C_TILE:.*]] = xetile.init_tile %{{.*}}[%[[BATCH]], %{{.*}}, %{{.*}}], [%{{.*}}, %{{.*}}, %{{.*}}], [%{{.*}}, %{{.*}}, %{{.*}}] : memref<?x?x?xf32> -> !xetile.tile<32x32xf32>
+    // CHECK: xetile.store_tile %{{.*}}, %[[C_TILE]] : vector<32x32xf32>, !xetile.tile<32x32xf32>
+    %c_tile = xetile.init_tile %C[%batch, %m, %n], [%H, %M, %N], [%stride_h, %N, %c1] : memref<?x?x?xf32> -> !xetile.tile<128x128xf32, #xetile.tile_attr<wg_map = #wg_map_c>>
+    xetile.store_tile %c, %c_tile : vector<128x128xf32>, !xetile.tile<128x128xf32, #xetile.tile_attr<wg_map = #wg_map_c>>
+    gpu.return
+  }
+}
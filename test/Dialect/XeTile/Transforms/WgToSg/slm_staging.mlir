@@ -0,0 +1,134 @@
+// RUN: imex-opt --split-input-file --xetile-wg-to-sg="slm-staging" --cse %s -verify-diagnostics | FileCheck %s
+
+#wg_map_a = #xetile.wg_map<sg_layout = [4, 4], sg_data = [32, 128]>
+#tile_attr_a = #xetile.tile_attr<wg_map = #wg_map_a>
+
+#wg_map_b = #xetile.wg_map<sg_layout = [4, 4], sg_data = [128, 32]>
+#tile_attr_b = #xetile.tile_attr<wg_map = #wg_map_b>
+
+#wg_map_c = #xetile.wg_map<sg_layout = [4, 4], sg_data = [32, 32]>
+#tile_attr_c = #xetile.tile_attr<wg_map = #wg_map_c>
+
+gpu.module @test_slm_staging  {
+    //CHECK-LABEL: gpu.func @test_kernel
+    // The SLM buffers are allocated once, outside of the loop.
+    //CHECK: memref.alloc() : memref<32768xi8, 3>
+    //CHECK: memref.alloc() : memref<32768xi8, 3>
+    gpu.func @test_kernel(%A: memref<1024x1024xf16>, %B: memref<1024x1024xf16>, %C: memref<1024x1024xf32>) {
+        %c0 = arith.constant 0 : index
+        %c128 = arith.constant 128 : index
+        %c1024 = arith.constant 1024 : index
+        %block_id_x = gpu.block_id x
+        %block_id_y = gpu.block_id y
+        %m = arith.muli %block_id_x, %c128 : index
+        %n = arith.muli %block_id_y, %c128 : index
+
+        // C is not replicated over the subgroups and is loaded directly.
+        //CHECK: %[[C_TILE:.*]] = xetile.init_tile %{{.*}} : memref<1024x1024xf32> -> !xetile.tile<32x32xf32>
+        //CHECK: xetile.load_tile %[[C_TILE]] : !xetile.tile<32x32xf32> -> vector<32x32xf32>
+        %c_init_tile = xetile.init_tile %C[%m, %n] : memref<1024x1024xf32>
+          -> !xetile.tile<128x128xf32, #tile_attr_c>
+        %c_init_value = xetile.load_tile %c_init_tile : !xetile.tile<128x128xf32, #tile_attr_c>
+          -> vector<128x128xf32>
+
+        // A and B are each shared by 4 subgroups. Every subgroup loads a
+        // disjoint 8x128 block of them instead.
+        //CHECK: %[[A_TILE:.*]] = xetile.init_tile %{{.*}} : memref<1024x1024xf16> -> !xetile.tile<8x128xf16>
+        %a_init_tile = xetile.init_tile %A[%m, %c0] : memref<1024x1024xf16>
+          -> !xetile.tile<128x128xf16, #tile_attr_a>
+        //CHECK: %[[B_TILE:.*]] = xetile.init_tile %{{.*}} : memref<1024x1024xf16> -> !xetile.tile<8x128xf16>
+        %b_init_tile = xetile.init_tile %B[%c0, %n] : memref<1024x1024xf16>
+          -> !xetile.tile<128x128xf16, #tile_attr_b>
+
+        //CHECK: scf.for
+        //CHECK-SAME: -> (!xetile.tile<8x128xf16>, !xetile.tile<8x128xf16>, vector<32x32xf32>)
+        %out:3 = scf.for %k = %c0 to %c1024 step %c128
+          iter_args(%a_tile = %a_init_tile, %b_tile = %b_init_tile, %c_value = %c_init_value)
+          -> (!xetile.tile<128x128xf16, #tile_attr_a>,
+              !xetile.tile<128x128xf16, #tile_attr_b>,
+              vector<128x128xf32>) {
+
+          // The barrier after the store of B waits for the reads of A in
+          // SLM, so A needs no barrier before its store, and vice versa.
+          //CHECK: %[[A_COOP:.*]] = xetile.load_tile %{{.*}} : !xetile.tile<8x128xf16> -> vector<8x128xf16>
+          //CHECK-NOT: memref.alloc
+          //CHECK-NOT: gpu.barrier
+          //CHECK: xetile.store_tile %[[A_COOP]], %{{.*}} : vector<8x128xf16>, !xetile.tile<8x128xf16, #xetile.tile_attr<memory_space = 3 : i32>>
+          //CHECK: gpu.barrier
+          //CHECK: %[[A_VALUE:.*]] = xetile.load_tile %{{.*}} : !xetile.tile<32x128xf16, #xetile.tile_attr<memory_space = 3 : i32>> -> vector<32x128xf16>
+          %a_value = xetile.load_tile %a_tile  : !xetile.tile<128x128xf16, #tile_attr_a>
+            -> vector<128x128xf16>
+
+          //CHECK: %[[B_COOP:.*]] = xetile.load_tile %{{.*}} : !xetile.tile<8x128xf16> -> vector<8x128xf16>
+          //CHECK-NOT: memref.alloc
+          //CHECK-NOT: gpu.barrier
+          //CHECK: xetile.store_tile %[[B_COOP]], %{{.*}} : vector<8x128xf16>, !xetile.tile<8x128xf16, #xetile.tile_attr<memory_space = 3 : i32>>
+          //CHECK: gpu.barrier
+          //CHECK: %[[B_VALUE:.*]] = xetile.load_tile %{{.*}} : !xetile.tile<128x32xf16, #xetile.tile_attr<memory_space = 3 : i32>> -> vector<128x32xf16>
+          %b_value = xetile.load_tile %b_tile : !xetile.tile<128x128xf16, #tile_attr_b>
+            -> vector<128x128xf16>
+
+          //CHECK: xetile.tile_mma %[[A_VALUE]], %[[B_VALUE]], %{{.*}} : vector<32x128xf16>, vector<128x32xf16>, vector<32x32xf32> -> vector<32x32xf32>
+          %c_new_value = xetile.tile_mma %a_value, %b_value, %c_value {wg_map_a = #wg_map_a, wg_map_b = #wg_map_b, wg_map_c = #wg_map_c}
+            : vector<128x128xf16>, vector<128x128xf16>, vector<128x128xf32> -> vector<128x128xf32>
+
+          //CHECK: xetile.update_tile_offset %{{.*}}, [%{{.*}}, %{{.*}}] : !xetile.tile<8x128xf16>
+          %a_next_tile = xetile.update_tile_offset %a_tile, [%c0, %c128] : !xetile.tile<128x128xf16, #tile_attr_a>
+          //CHECK: xetile.update_tile_offset %{{.*}}, [%{{.*}}, %{{.*}}] : !xetile.tile<8x128xf16>
+          %b_next_tile = xetile.update_tile_offset %b_tile, [%c128, %c0] : !xetile.tile<128x128xf16, #tile_attr_b>
+
+          scf.yield %a_next_tile, %b_next_tile, %c_new_value
+            : !xetile.tile<128x128xf16, #tile_attr_a>,
+            !xetile.tile<128x128xf16, #tile_attr_b>, vector<128x128xf32>
+        }
+        xetile.store_tile %out#2, %c_init_tile : vector<128x128xf32>,
+          !xetile.tile<128x128xf32, #tile_attr_c>
+        gpu.return
+    }
+}
+
+// -----
+
+#wg_map_a = #xetile.wg_map<sg_layout = [4, 4], sg_data = [32, 128]>
+#tile_attr_a = #xetile.tile_attr<wg_map = #wg_map_a>
+
+gpu.module @test_slm_staging_single  {
+    //CHECK-LABEL: gpu.func @test_kernel
+    //CHECK: memref.alloc() : memref<32768xi8, 3>
+    gpu.func @test_kernel(%A: memref<1024x1024xf16>, %B: memref<1024x1024xf16>) {
+        %c0 = arith.constant 0 : index
+        %c128 = arith.constant 128 : index
+        %c1024 = arith.constant 1024 : index
+        %block_id_x = gpu.block_id x
+        %m = arith.muli %block_id_x, %c128 : index
+
+        %a_init_tile = xetile.init_tile %A[%m, %c0] : memref<1024x1024xf16>
+          -> !xetile.tile<128x128xf16, #tile_attr_a>
+
+        //CHECK: scf.for
+        %out = scf.for %k = %c0 to %c1024 step %c128
+          iter_args(%a_tile = %a_init_tile)
+          -> (!xetile.tile<128x128xf16, #tile_attr_a>) {
+
+          // A is the only operand staged in the loop, so its store waits for
+          // the reads of the previous iteration.
+          //CHECK: %[[A_COOP:.*]] = xetile.load_tile %{{.*}} : !xetile.tile<8x128xf16> -> vector<8x128xf16>
+          //CHECK-NOT: memref.alloc
+          //CHECK: gpu.barrier
+          //CHECK: xetile.store_tile %[[A_COOP]], %{{.*}} : vector<8x128xf16>, !xetile.tile<8x128xf16, #xetile.tile_attr<memory_space = 3 : i32>>
+          //CHECK: gpu.barrier
+          //CHECK: xetile.load_tile %{{.*}} : !xetile.tile<32x128xf16, #xetile.tile_attr<memory_space = 3 : i32>> -> vector<32x128xf16>
+          %a_value = xetile.load_tile %a_tile  : !xetile.tile<128x128xf16, #tile_attr_a>
+            -> vector<128x128xf16>
+
+          %b_tile = xetile.init_tile %B[%m, %k] : memref<1024x1024xf16>
+            -> !xetile.tile<128x128xf16, #tile_attr_a>
+          xetile.store_tile %a_value, %b_tile : vector<128x128xf16>,
+            !xetile.tile<128x128xf16, #tile_attr_a>
+
+          %a_next_tile = xetile.update_tile_offset %a_tile, [%c0, %c128] : !xetile.tile<128x128xf16, #tile_attr_a>
+          scf.yield %a_next_tile : !xetile.tile<128x128xf16, #tile_attr_a>
+        }
+        gpu.return
+    }
+}
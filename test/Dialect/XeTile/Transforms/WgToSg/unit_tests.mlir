@@ -126,4 +126,13 @@ gpu.module @test_arith_extf {
         %create_mask = vector.create_mask %c128, %c100 {map = #xetile.wg_map<sg_layout = [4, 8], sg_data = [32, 32]>} : vector<128x32xi1>
         gpu.return
     }
+
+    gpu.func @test_atomic_rmw(%arg0: memref<128x32xf32>) {
+        %c0 = arith.constant 0 : index
+        %tile = xetile.init_tile %arg0[%c0, %c0] : memref<128x32xf32> -> !xetile.tile<128x32xf32, #xetile.tile_attr<wg_map = <sg_layout = [4, 8], sg_data = [32, 32]>>>
+        %cst = arith.constant {map = #xetile.wg_map<sg_layout = [4, 8], sg_data = [32, 32]>} dense<1.0> : vector<128x32xf32>
+        //CHECK: xetile.atomic_rmw addf {{%.*}}, {{%.*}} : vector<32x32xf32>, !xetile.tile<32x32xf32> -> vector<32x32xf32>
+        %rmw = xetile.atomic_rmw addf %cst, %tile : vector<128x32xf32>, !xetile.tile<128x32xf32, #xetile.tile_attr<wg_map = <sg_layout = [4, 8], sg_data = [32, 32]>>> -> vector<128x32xf32>
+        gpu.return
+    }
 }
@@ -0,0 +1,40 @@
+// RUN: imex-opt --xetile-wg-to-sg --cse %s -verify-diagnostics | FileCheck %s
+
+gpu.module @test_wg_reduction {
+  //CHECK-LABEL: gpu.func @test_row_max
+  gpu.func @test_row_max(%arg0 : memref<32x128xf32>) {
+    %c0 = arith.constant 0 : index
+    %tile = xetile.init_tile %arg0[%c0, %c0] : memref<32x128xf32> -> !xetile.tile<32x128xf32, #xetile.tile_attr<wg_map = <sg_layout = [1, 4], sg_data = [32, 32]>>>
+    %data = xetile.load_tile %tile : !xetile.tile<32x128xf32, #xetile.tile_attr<wg_map = <sg_layout = [1, 4], sg_data = [32, 32]>>> -> vector<32x128xf32>
+    %acc = arith.constant {map = #xetile.wg_map<sg_layout = [1, 4], sg_data = [32, 1]>} dense<0.000000e+00> : vector<32xf32>
+
+    //CHECK: %[[DATA:.*]] = xetile.load_tile {{.*}} -> vector<32x32xf32>
+    //CHECK: %[[ACC:.*]] = arith.constant dense<0.000000e+00> : vector<32xf32>
+    //CHECK: %[[PARTIAL:.*]] = vector.multi_reduction <maxnumf>, %[[DATA]], %{{.*}} [1] : vector<32x32xf32> to vector<32xf32>
+    //CHECK: memref.alloc() : memref<512xi8, 3>
+    //CHECK: %[[VIEW:.*]] = memref.view {{.*}} : memref<512xi8, 3> to memref<4x32xf32, 3>
+    //CHECK: %[[SGID:.*]] = gpu.subgroup_id : index
+    //CHECK: %[[IDX:.*]] = index.remu %[[SGID]], %{{.*}}
+    //CHECK: %[[ROW:.*]] = vector.shape_cast %[[PARTIAL]] : vector<32xf32> to vector<1x32xf32>
+    //CHECK: %[[ST:.*]] = xetile.init_tile %[[VIEW]][%[[IDX]], {{.*}}] : memref<4x32xf32, 3> -> !xetile.tile<1x32xf32, #xetile.tile_attr<memory_space = 3 : i32>>
+    //CHECK: xetile.store_tile %[[ROW]], %[[ST]]
+    //CHECK: gpu.barrier
+    //CHECK: %[[STEP1:.*]] = scf.if %{{.*}} -> (vector<32xf32>) {
+    //CHECK:   xetile.load_tile
+    //CHECK:   %[[MAX1:.*]] = arith.maxnumf %[[PARTIAL]], %{{.*}} : vector<32xf32>
+    //CHECK:   xetile.store_tile
+    //CHECK:   scf.yield %[[MAX1]] : vector<32xf32>
+    //CHECK: } else {
+    //CHECK:   scf.yield %[[PARTIAL]] : vector<32xf32>
+    //CHECK: }
+    //CHECK: gpu.barrier
+    //CHECK: scf.if %{{.*}} -> (vector<32xf32>) {
+    //CHECK:   arith.maxnumf %[[STEP1]], %{{.*}} : vector<32xf32>
+    //CHECK: gpu.barrier
+    //CHECK: %[[TOTAL:.*]] = xetile.load_tile
+    //CHECK: %[[TOTAL1D:.*]] = vector.shape_cast %[[TOTAL]] : vector<1x32xf32> to vector<32xf32>
+    //CHECK: arith.maxnumf %[[TOTAL1D]], %[[ACC]] : vector<32xf32>
+    %max = vector.multi_reduction <maxnumf>, %data, %acc {map = #xetile.wg_map<sg_layout = [1, 4], sg_data = [32, 1]>} [1] : vector<32x128xf32> to vector<32xf32>
+    gpu.return
+  }
+}
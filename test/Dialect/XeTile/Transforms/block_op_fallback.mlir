@@ -1,4 +1,5 @@
 // RUN: imex-opt --split-input-file --xetile-blockop-fallback=device=pvc %s -verify-diagnostics -o -| FileCheck %s
+// RUN: imex-opt --split-input-file --xetile-blockop-fallback=device=bmg %s -verify-diagnostics -o -| FileCheck %s
 
 gpu.module @test_module {
   // CHECK-LABEL: @test_pitch_not_multiple_of_tile_width
@@ -457,3 +458,64 @@ gpu.module @kernel {
     gpu.return
   }
 }
+
+// -----
+
+gpu.module @test_module {
+  // CHECK-LABEL: @test_runtime_pitch
+  gpu.func @test_runtime_pitch(%arg0: memref<?x?xf16>, %arg1: index, %arg2: index) {
+    // CHECK-DAG: %[[C2:.*]] = arith.constant 2 : index
+    // CHECK-DAG: %[[C64:.*]] = arith.constant 64 : index
+    // CHECK: %[[BYTES:.*]] = arith.muli %arg2, %[[C2]] : index
+    // CHECK: %[[MIN:.*]] = arith.cmpi uge, %[[BYTES]], %[[C64]] : index
+    // CHECK: %[[REM:.*]] = arith.remui %[[BYTES]], %{{.*}} : index
+    // CHECK: %[[ALIGNED:.*]] = arith.cmpi eq, %[[REM]], %{{.*}} : index
+    // CHECK: %[[COND:.*]] = arith.andi %{{.*}}, %[[ALIGNED]] : i1
+    // CHECK: scf.if %[[COND]] {
+    // CHECK:   %[[TILE:.*]] = xetile.init_tile %arg0[0, 0], [%arg1, %arg2], [%arg2, %{{.*}}] : memref<?x?xf16> -> !xetile.tile<8x32xf16>
+    // CHECK:   xetile.load_tile %[[TILE]] : !xetile.tile<8x32xf16> -> vector<8x32xf16>
+    // CHECK: } else {
+    // CHECK:   %[[CAST:.*]] = memref.reinterpret_cast %arg0 to offset: [0], sizes: [%{{.*}}], strides: [1] : memref<?x?xf16> to memref<?xf16>
+    // CHECK:   %[[STILE:.*]] = xetile.init_tile %[[CAST]], %{{.*}} : memref<?xf16>, vector<8x32xindex> -> !xetile.tile<8x32xf16, #xetile.tile_attr<memory_space = 0 : i32, scattered = true>>
+    // CHECK:   xetile.load %[[STILE]], %{{.*}} : !xetile.tile<8x32xf16, #xetile.tile_attr<memory_space = 0 : i32, scattered = true>>, vector<8x32xi1> -> vector<8x32xf16>
+    // CHECK: }
+    %c1 = arith.constant 1 : index
+    %0 = xetile.init_tile %arg0 [0, 0], [%arg1, %arg2], [%arg2, %c1] : memref<?x?xf16> -> !xetile.tile<8x32xf16>
+    %1 = xetile.load_tile %0 : !xetile.tile<8x32xf16> -> vector<8x32xf16>
+    gpu.return
+  }
+}
+
+// -----
+
+gpu.module @test_module {
+  // CHECK-LABEL: @test_strided_source
+  gpu.func @test_strided_source(%arg0: memref<?x?xf16, strided<[?, ?]>>, %arg1: index, %arg2: index, %arg3: index, %arg4: index) {
+    // CHECK-NOT: scf.if
+    // CHECK: %[[CAST:.*]] = memref.reinterpret_cast %arg0 to offset: [0], sizes: [%{{.*}}], strides: [1] : memref<?x?xf16, strided<[?, ?]>> to memref<?xf16>
+    // CHECK: %[[STRIDE0:.*]] = vector.splat %arg3 : vector<8x32xindex>
+    // CHECK: %[[ROWS:.*]] = arith.muli %{{.*}}, %[[STRIDE0]] : vector<8x32xindex>
+    // CHECK: %[[STRIDE1:.*]] = vector.splat %arg4 : vector<8x32xindex>
+    // CHECK: %[[COLS:.*]] = arith.muli %{{.*}}, %[[STRIDE1]] : vector<8x32xindex>
+    // CHECK: %[[INDICES:.*]] = arith.addi %[[ROWS]], %[[COLS]] : vector<8x32xindex>
+    // CHECK: %[[TILE:.*]] = xetile.init_tile %[[CAST]], %[[INDICES]] : memref<?xf16>, vector<8x32xindex> -> !xetile.tile<8x32xf16, #xetile.tile_attr<memory_space = 0 : i32, scattered = true>>
+    // CHECK: xetile.load %[[TILE]]
+    %0 = xetile.init_tile %arg0 [0, 0], [%arg1, %arg2], [%arg3, %arg4] : memref<?x?xf16, strided<[?, ?]>> -> !xetile.tile<8x32xf16>
+    %1 = xetile.load_tile %0 : !xetile.tile<8x32xf16> -> vector<8x32xf16>
+    gpu.return
+  }
+}
+
+// -----
+
+gpu.module @test_module {
+  // CHECK-LABEL: @test_col_major_pitch_too_small
+  gpu.func @test_col_major_pitch_too_small(%arg0: memref<8x512xf32, strided<[1, 8]>>) {
+    // CHECK: %[[CAST:.*]] = memref.reinterpret_cast %arg0 to offset: [0], sizes: [4096], strides: [1] : memref<8x512xf32, strided<[1, 8]>> to memref<4096xf32>
+    // CHECK: %[[TILE:.*]] = xetile.init_tile %[[CAST]], %{{.*}} : memref<4096xf32>, vector<8x16xindex> -> !xetile.tile<8x16xf32, #xetile.tile_attr<{{.*}}scattered = true>>
+    // CHECK: xetile.load %[[TILE]]
+    %0 = xetile.init_tile %arg0 [0, 0] : memref<8x512xf32, strided<[1, 8]>> -> !xetile.tile<8x16xf32, #xetile.tile_attr<order = [0, 1]>>
+    %1 = xetile.load_tile %0 : !xetile.tile<8x16xf32, #xetile.tile_attr<order = [0, 1]>> -> vector<8x16xf32>
+    gpu.return
+  }
+}
@@ -0,0 +1,32 @@
+// RUN: imex-opt --split-input-file --xetile-blockop-fallback="device=pvc remarks=-" %s -verify-diagnostics -o /dev/null
+
+gpu.module @test_module {
+  gpu.func @test_pitch_too_small(%arg0: memref<512x1xf32>) {
+    // expected-remark@+1 {{ScatteredTile: falling back to scattered ops: pitch of 4 bytes is less than}}
+    %0 = xetile.init_tile %arg0 [0, 0] : memref<512x1xf32> -> !xetile.tile<32x1xf32, #xetile.tile_attr<order = [1, 0]>>
+    %1 = xetile.load_tile %0 : !xetile.tile<32x1xf32, #xetile.tile_attr<order = [1, 0]>> -> vector<32x1xf32>
+    gpu.return
+  }
+}
+
+// -----
+
+gpu.module @test_module {
+  gpu.func @test_strided_source(%arg0: memref<?x?xf16, strided<[?, ?]>>, %arg1: index, %arg2: index, %arg3: index, %arg4: index) {
+    // expected-remark@+1 {{ScatteredTile: falling back to scattered ops: source is not contiguous in the inner dimension}}
+    %0 = xetile.init_tile %arg0 [0, 0], [%arg1, %arg2], [%arg3, %arg4] : memref<?x?xf16, strided<[?, ?]>> -> !xetile.tile<8x32xf16>
+    %1 = xetile.load_tile %0 : !xetile.tile<8x32xf16> -> vector<8x32xf16>
+    gpu.return
+  }
+}
+
+// -----
+
+// Tiles with a valid pitch keep block ops and are not reported.
+gpu.module @test_module {
+  gpu.func @test_block_tile(%arg0: memref<512x64xf32>) {
+    %0 = xetile.init_tile %arg0 [0, 0] : memref<512x64xf32> -> !xetile.tile<32x16xf32>
+    %1 = xetile.load_tile %0 : !xetile.tile<32x16xf32> -> vector<32x16xf32>
+    gpu.return
+  }
+}
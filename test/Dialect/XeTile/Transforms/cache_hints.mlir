@@ -0,0 +1,57 @@
+// RUN: imex-opt --split-input-file --xetile-cache-hints %s | FileCheck %s
+// RUN: imex-opt --split-input-file --xetile-cache-hints="streaming-input=uncached,uncached reused-input=cached,streaming output=write_back,write_back" %s | FileCheck %s --check-prefix=OVERRIDE
+
+gpu.module @test_module {
+  // A is streamed, B feeds the B operand of tile_mma through the loop and is
+  // cached, C is written back. Prefetches follow the loads of their source.
+  // CHECK-LABEL: gpu.func @test_gemm
+  // OVERRIDE-LABEL: gpu.func @test_gemm
+  gpu.func @test_gemm(%A: memref<128x128xf16>, %B: memref<128x128xf16>, %C: memref<128x128xf32>) {
+    %c0 = arith.constant 0 : index
+    %c32 = arith.constant 32 : index
+    %c128 = arith.constant 128 : index
+    %cst = arith.constant dense<0.000000e+00> : vector<32x32xf32>
+    %a_tile = xetile.init_tile %A[%c0, %c0] : memref<128x128xf16> -> !xetile.tile<32x32xf16>
+    %b_tile = xetile.init_tile %B[%c0, %c0] : memref<128x128xf16> -> !xetile.tile<32x32xf16>
+    // CHECK: xetile.prefetch_tile %{{.*}} {l1_hint = #xetile.cache_hint<streaming>, l3_hint = #xetile.cache_hint<uncached>} : !xetile.tile<32x32xf16>
+    // CHECK: xetile.prefetch_tile %{{.*}} {l1_hint = #xetile.cache_hint<cached>, l3_hint = #xetile.cache_hint<cached>} : !xetile.tile<32x32xf16>
+    xetile.prefetch_tile %a_tile : !xetile.tile<32x32xf16>
+    xetile.prefetch_tile %b_tile : !xetile.tile<32x32xf16>
+    %b_init = xetile.load_tile %b_tile : !xetile.tile<32x32xf16> -> vector<32x32xf16>
+    %out:4 = scf.for %k = %c0 to %c128 step %c32 iter_args(%a = %a_tile, %b = %b_tile, %b_value = %b_init, %acc = %cst)
+        -> (!xetile.tile<32x32xf16>, !xetile.tile<32x32xf16>, vector<32x32xf16>, vector<32x32xf32>) {
+      // CHECK: xetile.load_tile %{{.*}} {l1_hint = #xetile.cache_hint<streaming>, l3_hint = #xetile.cache_hint<uncached>} : !xetile.tile<32x32xf16> -> vector<32x32xf16>
+      // CHECK: xetile.load_tile %{{.*}} {l1_hint = #xetile.cache_hint<cached>, l3_hint = #xetile.cache_hint<cached>} : !xetile.tile<32x32xf16> -> vector<32x32xf16>
+      // OVERRIDE: xetile.load_tile %{{.*}} {l1_hint = #xetile.cache_hint<uncached>, l3_hint = #xetile.cache_hint<uncached>} : !xetile.tile<32x32xf16> -> vector<32x32xf16>
+      // OVERRIDE: xetile.load_tile %{{.*}} {l1_hint = #xetile.cache_hint<cached>, l3_hint = #xetile.cache_hint<streaming>} : !xetile.tile<32x32xf16> -> vector<32x32xf16>
+      %a_value = xetile.load_tile %a : !xetile.tile<32x32xf16> -> vector<32x32xf16>
+      %mma = xetile.tile_mma %a_value, %b_value, %acc : vector<32x32xf16>, vector<32x32xf16>, vector<32x32xf32> -> vector<32x32xf32>
+      %a_next = xetile.update_tile_offset %a, [%c0, %c32] : !xetile.tile<32x32xf16>
+      %b_next = xetile.update_tile_offset %b, [%c32, %c0] : !xetile.tile<32x32xf16>
+      %b_next_value = xetile.load_tile %b_next : !xetile.tile<32x32xf16> -> vector<32x32xf16>
+      scf.yield %a_next, %b_next, %b_next_value, %mma : !xetile.tile<32x32xf16>, !xetile.tile<32x32xf16>, vector<32x32xf16>, vector<32x32xf32>
+    }
+    %c_tile = xetile.init_tile %C[%c0, %c0] : memref<128x128xf32> -> !xetile.tile<32x32xf32>
+    // CHECK: xetile.store_tile %{{.*}}, %{{.*}} {l1_hint = #xetile.cache_hint<streaming>, l3_hint = #xetile.cache_hint<write_back>} : vector<32x32xf32>, !xetile.tile<32x32xf32>
+    // OVERRIDE: xetile.store_tile %{{.*}}, %{{.*}} {l1_hint = #xetile.cache_hint<write_back>, l3_hint = #xetile.cache_hint<write_back>} : vector<32x32xf32>, !xetile.tile<32x32xf32>
+    xetile.store_tile %out#3, %c_tile : vector<32x32xf32>, !xetile.tile<32x32xf32>
+    gpu.return
+  }
+}
+
+// -----
+
+gpu.module @test_module {
+  // Hints set by the frontend are kept.
+  // CHECK-LABEL: gpu.func @test_keep_hints
+  gpu.func @test_keep_hints(%A: memref<32x32xf16>, %B: memref<32x32xf16>) {
+    %c0 = arith.constant 0 : index
+    %a_tile = xetile.init_tile %A[%c0, %c0] : memref<32x32xf16> -> !xetile.tile<32x32xf16>
+    // CHECK: xetile.load_tile %{{.*}} {l1_hint = #xetile.cache_hint<cached>, l3_hint = #xetile.cache_hint<uncached>} : !xetile.tile<32x32xf16> -> vector<32x32xf16>
+    %a = xetile.load_tile %a_tile {l1_hint = #xetile.cache_hint<cached>} : !xetile.tile<32x32xf16> -> vector<32x32xf16>
+    %b_tile = xetile.init_tile %B[%c0, %c0] : memref<32x32xf16> -> !xetile.tile<32x32xf16>
+    // CHECK: xetile.store_tile %{{.*}}, %{{.*}} {l1_hint = #xetile.cache_hint<streaming>, l3_hint = #xetile.cache_hint<write_through>} : vector<32x32xf16>, !xetile.tile<32x32xf16>
+    xetile.store_tile %a, %b_tile {l3_hint = #xetile.cache_hint<write_through>} : vector<32x32xf16>, !xetile.tile<32x32xf16>
+    gpu.return
+  }
+}
@@ -344,3 +344,43 @@ gpu.module @test_module {
 //CHECK: %[[transpose:.*]] = memref.transpose %[[arg0]] (d0, d1) -> (d1, d0) : memref<512x128xf16, 3> to memref<128x512xf16, strided<[1, 128]>, 3>
 //CHECK: %[[r2:.*]] = xetile.init_tile %[[transpose]][16, 32] : memref<128x512xf16, strided<[1, 128]>, 3> -> !xetile.tile<16x32xf16, #xetile.tile_attr<order = [0, 1], memory_space = 3 : i64>>
 //CHECK: xetile.store_tile %[[r1]],  %[[r2]] : vector<16x32xf16>, !xetile.tile<16x32xf16, #xetile.tile_attr<order = [0, 1], memory_space = 3 : i64>>
+
+// -----
+gpu.module @test_module {
+  gpu.func @test_fold_transpose_into_order(%arg0 : memref<512x128xf16, strided<[1, 512], offset:0>>, %arg1 : vector<32x16xf16>, %arg2 : index, %arg3 : index) -> vector<32x16xf16> {
+    %0 = xetile.init_tile %arg0 [%arg2, %arg3] : memref<512x128xf16, strided<[1, 512], offset:0>> -> !xetile.tile<16x32xf16>
+    %1 = xetile.load_tile %0 : !xetile.tile<16x32xf16> -> vector<16x32xf16>
+    %2 = vector.transpose %1, [1, 0] : vector<16x32xf16> to vector<32x16xf16>
+    %3 = vector.transpose %arg1, [1, 0] : vector<32x16xf16> to vector<16x32xf16>
+    xetile.store_tile %3, %0 : vector<16x32xf16>, !xetile.tile<16x32xf16>
+    gpu.return %2 : vector<32x16xf16>
+  }
+}
+
+// CHECK-LABEL: @test_fold_transpose_into_order(
+// CHECK-SAME: %[[ARG0:[a-zA-Z0-9]+]]: memref<512x128xf16, strided<[1, 512]>>,
+// CHECK-SAME: %[[ARG1:[a-zA-Z0-9]+]]: vector<32x16xf16>
+// CHECK-SAME: %[[ARG2:[a-zA-Z0-9]+]]: index
+// CHECK-SAME: %[[ARG3:[a-zA-Z0-9]+]]: index
+// CHECK: %[[RCAST:.*]] = memref.reinterpret_cast %[[ARG0]] to offset: [0], sizes: [128, 512], strides: [512, 1] : memref<512x128xf16, strided<[1, 512]>> to memref<128x512xf16, strided<[512, 1]>>
+// CHECK: %[[T0:.*]] = xetile.init_tile %[[RCAST]][%[[ARG3]], %[[ARG2]]] : memref<128x512xf16, strided<[512, 1]>> -> !xetile.tile<32x16xf16, #xetile.tile_attr<>>
+// CHECK: %[[T1:.*]] = xetile.load_tile %[[T0]] : !xetile.tile<32x16xf16, #xetile.tile_attr<>> -> vector<32x16xf16>
+// CHECK-NOT: xetile.transpose
+// CHECK: xetile.store_tile %[[ARG1]],  %[[T0]] : vector<32x16xf16>, !xetile.tile<32x16xf16, #xetile.tile_attr<>>
+// CHECK: gpu.return %[[T1]] : vector<32x16xf16>
+
+// -----
+gpu.module @test_module {
+  gpu.func @test_no_fold_row_major(%arg0 : memref<128x512xf16>, %arg1 : index, %arg2 : index) -> vector<32x16xf16> {
+    %0 = xetile.init_tile %arg0 [%arg1, %arg2] : memref<128x512xf16> -> !xetile.tile<16x32xf16>
+    %1 = xetile.load_tile %0 : !xetile.tile<16x32xf16> -> vector<16x32xf16>
+    %2 = vector.transpose %1, [1, 0] : vector<16x32xf16> to vector<32x16xf16>
+    gpu.return %2 : vector<32x16xf16>
+  }
+}
+
+// The transpose of a row-major memref stays for the transposed block load.
+// CHECK-LABEL: @test_no_fold_row_major(
+// CHECK: %[[T0:.*]] = xetile.init_tile %{{.*}} : memref<128x512xf16> -> !xetile.tile<16x32xf16>
+// CHECK: %[[T1:.*]] = xetile.load_tile %[[T0]] : !xetile.tile<16x32xf16> -> vector<16x32xf16>
+// CHECK: xetile.transpose %[[T1]], [1, 0] : vector<16x32xf16> -> vector<32x16xf16>
@@ -0,0 +1,72 @@
+// RUN: imex-opt --split-input-file --xetile-epilogue-fusion %s | FileCheck %s
+
+gpu.module @test_module {
+  // Bias-add and relu are applied to the accumulator, C is written once.
+  // CHECK-LABEL: gpu.func @test_bias_relu
+  gpu.func @test_bias_relu(%A: memref<32x32xf16>, %B: memref<32x32xf16>, %C: memref<32x32xf32>, %bias: vector<32x32xf32>) {
+    %c0 = arith.constant 0 : index
+    %cst = arith.constant dense<0.000000e+00> : vector<32x32xf32>
+    %a_tile = xetile.init_tile %A[%c0, %c0] : memref<32x32xf16> -> !xetile.tile<32x32xf16>
+    %b_tile = xetile.init_tile %B[%c0, %c0] : memref<32x32xf16> -> !xetile.tile<32x32xf16>
+    %a = xetile.load_tile %a_tile : !xetile.tile<32x32xf16> -> vector<32x32xf16>
+    %b = xetile.load_tile %b_tile : !xetile.tile<32x32xf16> -> vector<32x32xf16>
+    // CHECK: %[[MMA:.*]] = xetile.tile_mma
+    %mma = xetile.tile_mma %a, %b, %cst : vector<32x32xf16>, vector<32x32xf16>, vector<32x32xf32> -> vector<32x32xf32>
+    %c_tile = xetile.init_tile %C[%c0, %c0] : memref<32x32xf32> -> !xetile.tile<32x32xf32>
+    // CHECK-NOT: xetile.store_tile
+    // CHECK-NOT: xetile.load_tile
+    // CHECK: %[[ADD:.*]] = arith.addf %[[MMA]], %{{.*}} : vector<32x32xf32>
+    // CHECK: %[[RELU:.*]] = arith.maximumf %[[ADD]], %{{.*}} : vector<32x32xf32>
+    // CHECK: xetile.store_tile %[[RELU]], %{{.*}} : vector<32x32xf32>, !xetile.tile<32x32xf32>
+    // CHECK-NOT: xetile.store_tile
+    xetile.store_tile %mma, %c_tile : vector<32x32xf32>, !xetile.tile<32x32xf32>
+    %c_tile_1 = xetile.init_tile %C[%c0, 0] : memref<32x32xf32> -> !xetile.tile<32x32xf32>
+    %c = xetile.load_tile %c_tile_1 : !xetile.tile<32x32xf32> -> vector<32x32xf32>
+    %add = arith.addf %c, %bias : vector<32x32xf32>
+    %relu = arith.maximumf %add, %cst : vector<32x32xf32>
+    xetile.store_tile %relu, %c_tile_1 : vector<32x32xf32>, !xetile.tile<32x32xf32>
+    gpu.return
+  }
+}
+
+// -----
+
+gpu.module @test_module {
+  // The cast result goes to another buffer: the f32 result is still stored,
+  // but not read back.
+  // CHECK-LABEL: gpu.func @test_cast
+  // CHECK-SAME: (%[[ACC:.*]]: vector<32x32xf32>
+  gpu.func @test_cast(%acc: vector<32x32xf32>, %C: memref<32x32xf32>, %D: memref<32x32xf16>) {
+    %c0 = arith.constant 0 : index
+    %c_tile = xetile.init_tile %C[%c0, %c0] : memref<32x32xf32> -> !xetile.tile<32x32xf32>
+    // CHECK: xetile.store_tile %[[ACC]]
+    // CHECK-NOT: xetile.load_tile
+    // CHECK: %[[TRUNC:.*]] = arith.truncf %[[ACC]] : vector<32x32xf32> to vector<32x32xf16>
+    // CHECK: xetile.store_tile %[[TRUNC]]
+    xetile.store_tile %acc, %c_tile : vector<32x32xf32>, !xetile.tile<32x32xf32>
+    %c = xetile.load_tile %c_tile : !xetile.tile<32x32xf32> -> vector<32x32xf32>
+    %trunc = arith.truncf %c : vector<32x32xf32> to vector<32x32xf16>
+    %d_tile = xetile.init_tile %D[%c0, %c0] : memref<32x32xf16> -> !xetile.tile<32x32xf16>
+    xetile.store_tile %trunc, %d_tile : vector<32x32xf16>, !xetile.tile<32x32xf16>
+    gpu.return
+  }
+}
+
+// -----
+
+gpu.module @test_module {
+  // The loaded value is reduced, so out-of-bounds elements may matter.
+  // CHECK-LABEL: gpu.func @test_not_elementwise
+  gpu.func @test_not_elementwise(%acc: vector<32x32xf32>, %C: memref<32x32xf32>, %D: memref<1x32xf32>) {
+    %c0 = arith.constant 0 : index
+    %c_tile = xetile.init_tile %C[%c0, %c0] : memref<32x32xf32> -> !xetile.tile<32x32xf32>
+    // CHECK: xetile.store_tile
+    // CHECK: xetile.load_tile
+    xetile.store_tile %acc, %c_tile : vector<32x32xf32>, !xetile.tile<32x32xf32>
+    %c = xetile.load_tile %c_tile : !xetile.tile<32x32xf32> -> vector<32x32xf32>
+    %sum = xetile.reduction <add>, %c [0] : vector<32x32xf32> -> vector<1x32xf32>
+    %d_tile = xetile.init_tile %D[%c0, %c0] : memref<1x32xf32> -> !xetile.tile<1x32xf32>
+    xetile.store_tile %sum, %d_tile : vector<1x32xf32>, !xetile.tile<1x32xf32>
+    gpu.return
+  }
+}
@@ -0,0 +1,168 @@
+// RUN: imex-opt --split-input-file --xetile-loop-pipelining %s -o - | FileCheck %s
+// RUN: imex-opt --split-input-file --xetile-loop-pipelining="stages=3 prefetch-distance=0" %s -o - | FileCheck %s --check-prefix=STAGES3
+
+gpu.module @test_kernel {
+  // CHECK-LABEL: gpu.func @sg_gemm
+  // CHECK-SAME: (%[[A:.*]]: memref<1024x1024xf16>, %[[B:.*]]: memref<1024x1024xf16>, %[[C:.*]]: memref<1024x1024xf32>)
+  // CHECK: %[[A_TILE:.*]] = xetile.init_tile %[[A]]
+  // CHECK: %[[B_TILE:.*]] = xetile.init_tile %[[B]]
+  // CHECK: %[[A_PF:.*]] = xetile.init_tile %[[A]]
+  // CHECK: xetile.prefetch_tile %[[A_PF]]
+  // CHECK: %[[A_PF1:.*]] = xetile.update_tile_offset %[[A_PF]]
+  // CHECK: xetile.prefetch_tile %[[A_PF1]]
+  // CHECK: %[[A_PF2:.*]] = xetile.update_tile_offset %[[A_PF1]]
+  // CHECK: %[[A0:.*]] = xetile.load_tile %[[A_TILE]]
+  // CHECK: %[[A1:.*]] = xetile.update_tile_offset %[[A_TILE]]
+  // CHECK: %[[B_PF:.*]] = xetile.init_tile %[[B]]
+  // CHECK-COUNT-2: xetile.prefetch_tile
+  // CHECK: %[[B0:.*]] = xetile.load_tile %[[B_TILE]]
+  // CHECK: %[[B1:.*]] = xetile.update_tile_offset %[[B_TILE]]
+  // CHECK: %[[UB:.*]] = arith.constant 992 : index
+  // CHECK: %[[R:.*]]:7 = scf.for %{{.*}} = %{{.*}} to %[[UB]] step %{{.*}} iter_args(%[[AT:.*]] = %[[A1]], %[[BT:.*]] = %[[B1]], %[[ACC:.*]] = %{{.*}}, %[[AV:.*]] = %[[A0]], %[[BV:.*]] = %[[B0]], %[[APF:.*]] = %[[A_PF2]], %[[BPF:.*]] = %{{.*}})
+  // CHECK:   xetile.prefetch_tile %[[APF]]
+  // CHECK:   %[[APF_NEXT:.*]] = xetile.update_tile_offset %[[APF]]
+  // CHECK:   %[[AV_NEXT:.*]] = xetile.load_tile %[[AT]]
+  // CHECK:   xetile.prefetch_tile %[[BPF]]
+  // CHECK:   %[[BPF_NEXT:.*]] = xetile.update_tile_offset %[[BPF]]
+  // CHECK:   %[[BV_NEXT:.*]] = xetile.load_tile %[[BT]]
+  // CHECK:   %[[MMA:.*]] = xetile.tile_mma %[[AV]], %[[BV]], %[[ACC]]
+  // CHECK:   %[[AT_NEXT:.*]] = xetile.update_tile_offset %[[AT]]
+  // CHECK:   %[[BT_NEXT:.*]] = xetile.update_tile_offset %[[BT]]
+  // CHECK:   scf.yield %[[AT_NEXT]], %[[BT_NEXT]], %[[MMA]], %[[AV_NEXT]], %[[BV_NEXT]], %[[APF_NEXT]], %[[BPF_NEXT]]
+  // CHECK: %[[LAST:.*]] = xetile.tile_mma %[[R]]#3, %[[R]]#4, %[[R]]#2
+  // CHECK: xetile.store_tile %[[LAST]]
+
+  // STAGES3-LABEL: gpu.func @sg_gemm
+  // STAGES3-NOT: xetile.prefetch_tile
+  // STAGES3: %[[UB:.*]] = arith.constant 960 : index
+  // STAGES3: %[[R:.*]]:7 = scf.for %{{.*}} = %{{.*}} to %[[UB]]
+  // STAGES3-COUNT-2: xetile.load_tile
+  // STAGES3: xetile.tile_mma
+  // STAGES3: scf.yield
+  // STAGES3: %[[MMA0:.*]] = xetile.tile_mma %[[R]]#3, %[[R]]#5, %[[R]]#2
+  // STAGES3: %[[MMA1:.*]] = xetile.tile_mma %[[R]]#4, %[[R]]#6, %[[MMA0]]
+  // STAGES3: xetile.store_tile %[[MMA1]]
+  gpu.func @sg_gemm(%A: memref<1024x1024xf16>, %B: memref<1024x1024xf16>, %C: memref<1024x1024xf32>) {
+    %c0 = arith.constant 0 : index
+    %c32 = arith.constant 32 : index
+    %c1024 = arith.constant 1024 : index
+    %a_init_tile = xetile.init_tile %A[%c0, %c0] : memref<1024x1024xf16> -> !xetile.tile<32x32xf16>
+    %b_init_tile = xetile.init_tile %B[%c0, %c0] : memref<1024x1024xf16> -> !xetile.tile<32x32xf16>
+    %c_init_value = arith.constant dense<0.0> : vector<32x32xf32>
+    %out:3 = scf.for %k = %c0 to %c1024 step %c32
+      iter_args(%a_tile = %a_init_tile, %b_tile = %b_init_tile, %c_value = %c_init_value)
+      -> (!xetile.tile<32x32xf16>, !xetile.tile<32x32xf16>, vector<32x32xf32>) {
+      %a_value = xetile.load_tile %a_tile : !xetile.tile<32x32xf16> -> vector<32x32xf16>
+      %b_value = xetile.load_tile %b_tile : !xetile.tile<32x32xf16> -> vector<32x32xf16>
+      %c_new_value = xetile.tile_mma %a_value, %b_value, %c_value : vector<32x32xf16>, vector<32x32xf16>, vector<32x32xf32> -> vector<32x32xf32>
+      %a_next_tile = xetile.update_tile_offset %a_tile, [%c0, %c32] : !xetile.tile<32x32xf16>
+      %b_next_tile = xetile.update_tile_offset %b_tile, [%c32, %c0] : !xetile.tile<32x32xf16>
+      scf.yield %a_next_tile, %b_next_tile, %c_new_value : !xetile.tile<32x32xf16>, !xetile.tile<32x32xf16>, vector<32x32xf32>
+    }
+    %c_tile = xetile.init_tile %C[%c0, %c0] : memref<1024x1024xf32> -> !xetile.tile<32x32xf32>
+    xetile.store_tile %out#2, %c_tile : vector<32x32xf32>, !xetile.tile<32x32xf32>
+    gpu.return
+  }
+}
+
+// -----
+
+gpu.module @test_kernel {
+  // Loops with dynamic bounds are left alone.
+  // CHECK-LABEL: gpu.func @dynamic_bounds
+  // CHECK-NOT: xetile.prefetch_tile
+  // CHECK: scf.for
+  // CHECK: xetile.load_tile
+  gpu.func @dynamic_bounds(%A: memref<1024x1024xf16>, %n: index) {
+    %c0 = arith.constant 0 : index
+    %c32 = arith.constant 32 : index
+    %a_init_tile = xetile.init_tile %A[%c0, %c0] : memref<1024x1024xf16> -> !xetile.tile<32x32xf16>
+    %c_init_value = arith.constant dense<0.0> : vector<32x32xf32>
+    %out:2 = scf.for %k = %c0 to %n step %c32
+      iter_args(%a_tile = %a_init_tile, %c_value = %c_init_value)
+      -> (!xetile.tile<32x32xf16>, vector<32x32xf32>) {
+      %a_value = xetile.load_tile %a_tile : !xetile.tile<32x32xf16> -> vector<32x32xf16>
+      %c_new_value = xetile.tile_mma %a_value, %a_value, %c_value : vector<32x32xf16>, vector<32x32xf16>, vector<32x32xf32> -> vector<32x32xf32>
+      %a_next_tile = xetile.update_tile_offset %a_tile, [%c0, %c32] : !xetile.tile<32x32xf16>
+      scf.yield %a_next_tile, %c_new_value : !xetile.tile<32x32xf16>, vector<32x32xf32>
+    }
+    gpu.return
+  }
+}
+
+// -----
+
+#slm = #xetile.tile_attr<memory_space = 3 : i32>
+gpu.module @test_kernel {
+  // Tiles in shared local memory are written by other work items, so their
+  // loads are not moved ahead.
+  // CHECK-LABEL: gpu.func @slm_tile
+  // CHECK-NOT: xetile.prefetch_tile
+  // CHECK: scf.for
+  // CHECK-NEXT: xetile.load_tile
+  gpu.func @slm_tile(%A: memref<32x1024xf16, 3>) {
+    %c0 = arith.constant 0 : index
+    %c32 = arith.constant 32 : index
+    %c1024 = arith.constant 1024 : index
+    %a_init_tile = xetile.init_tile %A[%c0, %c0] : memref<32x1024xf16, 3> -> !xetile.tile<32x32xf16, #slm>
+    %c_init_value = arith.constant dense<0.0> : vector<32x32xf32>
+    %out:2 = scf.for %k = %c0 to %c1024 step %c32
+      iter_args(%a_tile = %a_init_tile, %c_value = %c_init_value)
+      -> (!xetile.tile<32x32xf16, #slm>, vector<32x32xf32>) {
+      %a_value = xetile.load_tile %a_tile : !xetile.tile<32x32xf16, #slm> -> vector<32x32xf16>
+      %c_new_value = xetile.tile_mma %a_value, %a_value, %c_value : vector<32x32xf16>, vector<32x32xf16>, vector<32x32xf32> -> vector<32x32xf32>
+      %a_next_tile = xetile.update_tile_offset %a_tile, [%c0, %c32] : !xetile.tile<32x32xf16, #slm>
+      scf.yield %a_next_tile, %c_new_value : !xetile.tile<32x32xf16, #slm>, vector<32x32xf32>
+    }
+    gpu.return
+  }
+
+  // Loads are not moved across barriers.
+  // CHECK-LABEL: gpu.func @barrier
+  // CHECK-NOT: xetile.prefetch_tile
+  // CHECK: scf.for
+  // CHECK-NEXT: gpu.barrier
+  // CHECK-NEXT: xetile.load_tile
+  gpu.func @barrier(%A: memref<1024x1024xf16>) {
+    %c0 = arith.constant 0 : index
+    %c32 = arith.constant 32 : index
+    %c1024 = arith.constant 1024 : index
+    %a_init_tile = xetile.init_tile %A[%c0, %c0] : memref<1024x1024xf16> -> !xetile.tile<32x32xf16>
+    %c_init_value = arith.constant dense<0.0> : vector<32x32xf32>
+    %out:2 = scf.for %k = %c0 to %c1024 step %c32
+      iter_args(%a_tile = %a_init_tile, %c_value = %c_init_value)
+      -> (!xetile.tile<32x32xf16>, vector<32x32xf32>) {
+      gpu.barrier
+      %a_value = xetile.load_tile %a_tile : !xetile.tile<32x32xf16> -> vector<32x32xf16>
+      %c_new_value = xetile.tile_mma %a_value, %a_value, %c_value : vector<32x32xf16>, vector<32x32xf16>, vector<32x32xf32> -> vector<32x32xf32>
+      %a_next_tile = xetile.update_tile_offset %a_tile, [%c0, %c32] : !xetile.tile<32x32xf16>
+      scf.yield %a_next_tile, %c_new_value : !xetile.tile<32x32xf16>, vector<32x32xf32>
+    }
+    gpu.return
+  }
+
+  // Loads are not moved before stores to the same memory.
+  // CHECK-LABEL: gpu.func @aliasing_store
+  // CHECK-NOT: xetile.prefetch_tile
+  // CHECK: scf.for
+  // CHECK-NEXT: xetile.load_tile
+  // CHECK: xetile.store_tile
+  gpu.func @aliasing_store(%A: memref<1024x1024xf16>) {
+    %c0 = arith.constant 0 : index
+    %c32 = arith.constant 32 : index
+    %c1024 = arith.constant 1024 : index
+    %a_init_tile = xetile.init_tile %A[%c0, %c0] : memref<1024x1024xf16> -> !xetile.tile<32x32xf16>
+    %c_init_value = arith.constant dense<0.0> : vector<32x32xf32>
+    %out:2 = scf.for %k = %c0 to %c1024 step %c32
+      iter_args(%a_tile = %a_init_tile, %c_value = %c_init_value)
+      -> (!xetile.tile<32x32xf16>, vector<32x32xf32>) {
+      %a_value = xetile.load_tile %a_tile : !xetile.tile<32x32xf16> -> vector<32x32xf16>
+      %c_new_value = xetile.tile_mma %a_value, %a_value, %c_value : vector<32x32xf16>, vector<32x32xf16>, vector<32x32xf32> -> vector<32x32xf32>
+      %d_tile = xetile.init_tile %A[%k, %c0] : memref<1024x1024xf16> -> !xetile.tile<32x32xf16>
+      xetile.store_tile %a_value, %d_tile : vector<32x32xf16>, !xetile.tile<32x32xf16>
+      %a_next_tile = xetile.update_tile_offset %a_tile, [%c0, %c32] : !xetile.tile<32x32xf16>
+      scf.yield %a_next_tile, %c_new_value : !xetile.tile<32x32xf16>, vector<32x32xf32>
+    }
+    gpu.return
+  }
+}
@@ -0,0 +1,68 @@
+// RUN: imex-opt --xetile-persistent-kernel %s | FileCheck %s --check-prefixes=CHECK,CORES
+// RUN: imex-opt --xetile-persistent-kernel="num-workgroups=64" %s | FileCheck %s --check-prefixes=CHECK,WG64
+// RUN: imex-opt --xetile-persistent-kernel="device=bmg" %s | FileCheck %s --check-prefixes=CHECK,BMG
+
+#wg_map_a = #xetile.wg_map<sg_layout = [4, 4], sg_data = [32, 128]>
+#tile_attr_a = #xetile.tile_attr<wg_map = #wg_map_a>
+#wg_map_b = #xetile.wg_map<sg_layout = [4, 4], sg_data = [128, 32]>
+#tile_attr_b = #xetile.tile_attr<wg_map = #wg_map_b>
+#wg_map_c = #xetile.wg_map<sg_layout = [4, 4], sg_data = [32, 32]>
+#tile_attr_c = #xetile.tile_attr<wg_map = #wg_map_c>
+
+module attributes {gpu.container_module} {
+  // A 2304x2304 C has 18 x 18 = 324 tiles of 128x128, which is not a
+  // multiple of the number of workgroups.
+  // CHECK-LABEL: func.func @test_gemm
+  func.func @test_gemm(%A: memref<2304x128xf16>, %B: memref<128x2304xf16>, %C: memref<2304x2304xf32>) {
+    %c1 = arith.constant 1 : index
+    %c4 = arith.constant 4 : index
+    %c18 = arith.constant 18 : index
+    // CORES: %[[NUM_WG:.*]] = arith.constant 128 : index
+    // WG64: %[[NUM_WG:.*]] = arith.constant 64 : index
+    // BMG: %[[NUM_WG:.*]] = arith.constant 20 : index
+    // CHECK: gpu.launch_func @test_module::@test_kernel blocks in (%[[NUM_WG]], %{{.*}}, %{{.*}}) threads in (%{{.*}}, %{{.*}}, %{{.*}})
+    gpu.launch_func @test_module::@test_kernel blocks in (%c18, %c18, %c1) threads in (%c4, %c4, %c1) args(%A : memref<2304x128xf16>, %B : memref<128x2304xf16>, %C : memref<2304x2304xf32>)
+    return
+  }
+
+  gpu.module @test_module {
+    // CHECK-LABEL: gpu.func @test_kernel
+    // CORES-SAME: known_grid_size = array<i32: 128, 1, 1>
+    // WG64-SAME: known_grid_size = array<i32: 64, 1, 1>
+    // BMG-SAME: known_grid_size = array<i32: 20, 1, 1>
+    gpu.func @test_kernel(%A: memref<2304x128xf16>, %B: memref<128x2304xf16>, %C: memref<2304x2304xf32>) kernel attributes {known_block_size = array<i32: 4, 4, 1>, known_grid_size = array<i32: 18, 18, 1>} {
+      // CHECK: %[[ID:.*]] = gpu.block_id x
+      // CHECK: %[[NUM_TILES:.*]] = arith.constant 324 : index
+      // CORES: %[[STEP:.*]] = arith.constant 128 : index
+      // WG64: %[[STEP:.*]] = arith.constant 64 : index
+      // BMG: %[[STEP:.*]] = arith.constant 20 : index
+      // CHECK: scf.for %[[T:.*]] = %[[ID]] to %[[NUM_TILES]] step %[[STEP]] {
+      // CHECK: %[[C18:.*]] = arith.constant 18 : index
+      // CHECK: %[[X:.*]] = arith.remui %[[T]], %[[C18]] : index
+      // CHECK: %[[Y:.*]] = arith.divui %[[T]], %[[C18]] : index
+      // CHECK-NOT: gpu.block_id
+      // CHECK: %[[M:.*]] = arith.muli %[[X]], %{{.*}} : index
+      // CHECK: %[[N:.*]] = arith.muli %[[Y]], %{{.*}} : index
+      // CHECK: xetile.tile_mma
+      // CHECK: xetile.store_tile
+      // CHECK: }
+      // CHECK-NEXT: gpu.return
+      %c0 = arith.constant 0 : index
+      %c128 = arith.constant 128 : index
+      %block_id_x = gpu.block_id x
+      %block_id_y = gpu.block_id y
+      %m = arith.muli %block_id_x, %c128 : index
+      %n = arith.muli %block_id_y, %c128 : index
+      %a_tile = xetile.init_tile %A[%m, %c0] : memref<2304x128xf16> -> !xetile.tile<128x128xf16, #tile_attr_a>
+      %b_tile = xetile.init_tile %B[%c0, %n] : memref<128x2304xf16> -> !xetile.tile<128x128xf16, #tile_attr_b>
+      %c_tile = xetile.init_tile %C[%m, %n] : memref<2304x2304xf32> -> !xetile.tile<128x128xf32, #tile_attr_c>
+      %a_value = xetile.load_tile %a_tile : !xetile.tile<128x128xf16, #tile_attr_a> -> vector<128x128xf16>
+      %b_value = xetile.load_tile %b_tile : !xetile.tile<128x128xf16, #tile_attr_b> -> vector<128x128xf16>
+      %c_value = xetile.load_tile %c_tile : !xetile.tile<128x128xf32, #tile_attr_c> -> vector<128x128xf32>
+      %c_new_value = xetile.tile_mma %a_value, %b_value, %c_value {wg_map_a = #wg_map_a, wg_map_b = #wg_map_b, wg_map_c = #wg_map_c}
+        : vector<128x128xf16>, vector<128x128xf16>, vector<128x128xf32> -> vector<128x128xf32>
+      xetile.store_tile %c_new_value, %c_tile : vector<128x128xf32>, !xetile.tile<128x128xf32, #tile_attr_c>
+      gpu.return
+    }
+  }
+}
@@ -0,0 +1,99 @@
+// RUN: imex-opt --xetile-producer-consumer %s | FileCheck %s --check-prefixes=CHECK,STAGES2
+// RUN: imex-opt --xetile-producer-consumer="stages=4" %s | FileCheck %s --check-prefixes=CHECK,STAGES4
+
+module attributes {gpu.container_module} {
+  // CHECK-LABEL: func.func @test_gemm
+  func.func @test_gemm(%A: memref<1024x1024xf16>, %B: memref<1024x1024xf16>, %C: memref<1024x1024xf32>) {
+    %c1 = arith.constant 1 : index
+    %c32 = arith.constant 32 : index
+    %c64 = arith.constant 64 : index
+    // CHECK: %[[C2:.*]] = arith.constant 2 : index
+    // CHECK: gpu.launch_func @test_module::@test_kernel blocks in (%{{.*}}, %{{.*}}, %{{.*}}) threads in (%[[C2]], %{{.*}}, %{{.*}})
+    gpu.launch_func @test_module::@test_kernel blocks in (%c32, %c64, %c1) threads in (%c1, %c1, %c1) args(%A : memref<1024x1024xf16>, %B : memref<1024x1024xf16>, %C : memref<1024x1024xf32>)
+    return
+  }
+
+  gpu.module @test_module {
+    // CHECK-LABEL: gpu.func @test_kernel
+    // CHECK-SAME: known_block_size = array<i32: 2, 1, 1>
+    gpu.func @test_kernel(%A: memref<1024x1024xf16>, %B: memref<1024x1024xf16>, %C: memref<1024x1024xf32>) kernel attributes {known_block_size = array<i32: 1, 1, 1>} {
+      // STAGES2: xegpu.alloc_nbarrier 5
+      // STAGES4: xegpu.alloc_nbarrier 9
+      // STAGES2-COUNT-2: memref.view %{{.*}}[%{{.*}}][] : memref<4096xi8, 3> to memref<64x32xf16, 3>
+      // STAGES4-COUNT-2: memref.view %{{.*}}[%{{.*}}][] : memref<8192xi8, 3> to memref<128x32xf16, 3>
+      // CHECK: %[[SG:.*]] = gpu.thread_id x
+      // CHECK: %[[IS_PRODUCER:.*]] = arith.cmpi eq, %[[SG]], %{{.*}} : index
+      // CHECK: scf.if %[[IS_PRODUCER]] {
+
+      // The producer recomputes the global tiles and streams them to SLM.
+      // CHECK: gpu.block_id x
+      // CHECK: xetile.init_tile %{{.*}} : memref<1024x1024xf16> -> !xetile.tile<16x32xf16>
+      // CHECK: xetile.init_tile %{{.*}} : memref<1024x1024xf16> -> !xetile.tile<32x32xf16>
+      // CHECK-NOT: xetile.tile_mma
+      // CHECK: xegpu.init_nbarrier %{{.*}}, %{{.*}} {nbarrier_role = 1 : i8, num_producers = 1 : i8} : i8, i8 -> !xegpu.nbarrier
+      // CHECK: xegpu.init_nbarrier %{{.*}}, %{{.*}} {nbarrier_role = 2 : i8, num_producers = 1 : i8} : i8, i8 -> !xegpu.nbarrier
+      // CHECK: scf.for %[[ROUND:.*]] = %{{.*}} to %{{.*}} step %{{.*}} iter_args
+      // CHECK: %[[NOT_FIRST:.*]] = arith.cmpi ugt, %[[ROUND]], %{{.*}} : index
+      // CHECK: xetile.load_tile %{{.*}} : !xetile.tile<16x32xf16> -> vector<16x32xf16>
+      // CHECK: xetile.load_tile %{{.*}} : !xetile.tile<32x32xf16> -> vector<32x32xf16>
+      // CHECK: scf.if %[[NOT_FIRST]] {
+      // CHECK:   xegpu.nbarrier_arrive
+      // CHECK:   xegpu.nbarrier_wait
+      // CHECK: }
+      // CHECK: xetile.store_tile %{{.*}}, %{{.*}} : vector<16x32xf16>, !xetile.tile<16x32xf16, #xetile.tile_attr<memory_space = 3 : i32{{.*}}>>
+      // CHECK: xetile.store_tile %{{.*}}, %{{.*}} : vector<32x32xf16>, !xetile.tile<32x32xf16, #xetile.tile_attr<memory_space = 3 : i32{{.*}}>>
+      // CHECK: xegpu.fence memory_kind = slm, fence_scope = workgroup
+      // CHECK: xegpu.nbarrier_arrive
+      // CHECK-NOT: xetile.tile_mma
+      // CHECK: } else {
+
+      // The consumer runs the original kernel on the tiles in SLM.
+      // CHECK: xegpu.init_nbarrier %{{.*}}, %{{.*}} {nbarrier_role = 2 : i8, num_producers = 1 : i8} : i8, i8 -> !xegpu.nbarrier
+      // CHECK: xegpu.init_nbarrier %{{.*}}, %{{.*}} {nbarrier_role = 1 : i8, num_producers = 1 : i8} : i8, i8 -> !xegpu.nbarrier
+      // STAGES2: %[[STEP:.*]] = arith.constant 64 : index
+      // STAGES4: %[[STEP:.*]] = arith.constant 128 : index
+      // CHECK: scf.for %[[K:.*]] = %{{.*}} to %{{.*}} step %[[STEP]] iter_args
+      // CHECK: %[[NOT_LAST:.*]] = arith.cmpi ult, %[[K]], %{{.*}} : index
+      // CHECK: xegpu.nbarrier_arrive
+      // CHECK: xegpu.nbarrier_wait
+      // CHECK: xetile.load_tile %{{.*}} : !xetile.tile<16x32xf16, #xetile.tile_attr<memory_space = 3 : i32{{.*}}>> -> vector<16x32xf16>
+      // CHECK: xetile.load_tile %{{.*}} : !xetile.tile<32x32xf16, #xetile.tile_attr<memory_space = 3 : i32{{.*}}>> -> vector<32x32xf16>
+      // CHECK: scf.if %[[NOT_LAST]] {
+      // CHECK:   xegpu.fence memory_kind = slm, fence_scope = workgroup
+      // CHECK:   xegpu.nbarrier_arrive
+      // CHECK: }
+      // CHECK: xetile.tile_mma
+      // STAGES2-COUNT-1: xetile.tile_mma
+      // STAGES4-COUNT-3: xetile.tile_mma
+      // CHECK: xetile.store_tile %{{.*}}, %{{.*}} : vector<16x32xf32>, !xetile.tile<16x32xf32>
+      // CHECK: }
+      // CHECK-NEXT: gpu.return
+      %c0 = arith.constant 0 : index
+      %c16 = arith.constant 16 : index
+      %c32 = arith.constant 32 : index
+      %c1024 = arith.constant 1024 : index
+      %c_init_value = arith.constant dense<0.0> : vector<16x32xf32>
+      %block_id_x = gpu.block_id x
+      %block_id_y = gpu.block_id y
+      %m = arith.muli %block_id_x, %c16 : index
+      %n = arith.muli %block_id_y, %c32 : index
+      %a_init_tile = xetile.init_tile %A[%m, %c0] : memref<1024x1024xf16> -> !xetile.tile<16x32xf16>
+      %b_init_tile = xetile.init_tile %B[%c0, %n] : memref<1024x1024xf16> -> !xetile.tile<32x32xf16>
+      %out:3 = scf.for %k = %c0 to %c1024 step %c32
+        iter_args(%a_tile = %a_init_tile, %b_tile = %b_init_tile, %c_value = %c_init_value)
+        -> (!xetile.tile<16x32xf16>, !xetile.tile<32x32xf16>, vector<16x32xf32>) {
+        %a_value = xetile.load_tile %a_tile : !xetile.tile<16x32xf16> -> vector<16x32xf16>
+        %b_value = xetile.load_tile %b_tile : !xetile.tile<32x32xf16> -> vector<32x32xf16>
+        %c_new_value = xetile.tile_mma %a_value, %b_value, %c_value
+          : vector<16x32xf16>, vector<32x32xf16>, vector<16x32xf32> -> vector<16x32xf32>
+        %a_next_tile = xetile.update_tile_offset %a_tile, [%c0, %c32] : !xetile.tile<16x32xf16>
+        %b_next_tile = xetile.update_tile_offset %b_tile, [%c32, %c0] : !xetile.tile<32x32xf16>
+        scf.yield %a_next_tile, %b_next_tile, %c_new_value
+          : !xetile.tile<16x32xf16>, !xetile.tile<32x32xf16>, vector<16x32xf32>
+      }
+      %c_tile = xetile.init_tile %C[%m, %n] : memref<1024x1024xf32> -> !xetile.tile<16x32xf32>
+      xetile.store_tile %out#2, %c_tile : vector<16x32xf32>, !xetile.tile<16x32xf32>
+      gpu.return
+    }
+  }
+}
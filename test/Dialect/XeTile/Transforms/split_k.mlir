@@ -0,0 +1,74 @@
+// RUN: imex-opt --xetile-split-k %s | FileCheck %s --check-prefixes=CHECK,AUTO
+// RUN: imex-opt --xetile-split-k="split-k=2" %s | FileCheck %s --check-prefixes=CHECK,SPLIT2
+
+#wg_map_a = #xetile.wg_map<sg_layout = [4, 4], sg_data = [32, 128]>
+#tile_attr_a = #xetile.tile_attr<wg_map = #wg_map_a>
+#wg_map_b = #xetile.wg_map<sg_layout = [4, 4], sg_data = [128, 32]>
+#tile_attr_b = #xetile.tile_attr<wg_map = #wg_map_b>
+#wg_map_c = #xetile.wg_map<sg_layout = [4, 4], sg_data = [32, 32]>
+#tile_attr_c = #xetile.tile_attr<wg_map = #wg_map_c>
+
+module attributes {gpu.container_module} {
+  // A single 128x128 C tile with K = 1024 launches 16 subgroups. The K-loop
+  // of 8 iterations is split in 4 to keep 2 iterations per split.
+  // CHECK-LABEL: func.func @test_gemm
+  func.func @test_gemm(%A: memref<128x1024xf16>, %B: memref<1024x128xf16>, %C: memref<128x128xf32>) {
+    %c1 = arith.constant 1 : index
+    %c4 = arith.constant 4 : index
+    // AUTO: %[[SPLITS:.*]] = arith.constant 4 : index
+    // SPLIT2: %[[SPLITS:.*]] = arith.constant 2 : index
+    // CHECK: gpu.launch_func @test_module::@test_kernel blocks in (%{{.*}}, %{{.*}}, %[[SPLITS]]) threads in (%{{.*}}, %{{.*}}, %{{.*}})
+    gpu.launch_func @test_module::@test_kernel blocks in (%c1, %c1, %c1) threads in (%c4, %c4, %c1) args(%A : memref<128x1024xf16>, %B : memref<1024x128xf16>, %C : memref<128x128xf32>)
+    return
+  }
+
+  gpu.module @test_module {
+    // CHECK-LABEL: gpu.func @test_kernel
+    gpu.func @test_kernel(%A: memref<128x1024xf16>, %B: memref<1024x128xf16>, %C: memref<128x128xf32>) kernel {
+      // CHECK-DAG: %[[C0:.*]] = arith.constant 0 : index
+      // CHECK-DAG: %[[C128:.*]] = arith.constant 128 : index
+      %c0 = arith.constant 0 : index
+      %c128 = arith.constant 128 : index
+      %c1024 = arith.constant 1024 : index
+
+      // CHECK: %[[C_TILE:.*]] = xetile.init_tile %{{.*}}[%[[C0]], %[[C0]]] : memref<128x128xf32>
+      // CHECK-NOT: xetile.load_tile %[[C_TILE]]
+      %c_init_tile = xetile.init_tile %C[%c0, %c0] : memref<128x128xf32> -> !xetile.tile<128x128xf32, #tile_attr_c>
+      %c_init_value = xetile.load_tile %c_init_tile : !xetile.tile<128x128xf32, #tile_attr_c> -> vector<128x128xf32>
+      %a_init_tile = xetile.init_tile %A[%c0, %c0] : memref<128x1024xf16> -> !xetile.tile<128x128xf16, #tile_attr_a>
+      %b_init_tile = xetile.init_tile %B[%c0, %c0] : memref<1024x128xf16> -> !xetile.tile<128x128xf16, #tile_attr_b>
+
+      // CHECK: %[[Z:.*]] = gpu.block_id z
+      // AUTO: %[[CHUNK:.*]] = arith.constant 2 : index
+      // SPLIT2: %[[CHUNK:.*]] = arith.constant 4 : index
+      // CHECK: %[[SKIPPED:.*]] = arith.muli %[[Z]], %[[CHUNK]] : index
+      // CHECK: %[[AX:.*]] = arith.muli %[[C0]], %[[SKIPPED]] : index
+      // CHECK: %[[AY:.*]] = arith.muli %[[C128]], %[[SKIPPED]] : index
+      // CHECK: %[[A_TILE:.*]] = xetile.update_tile_offset %{{.*}}, [%[[AX]], %[[AY]]]
+      // CHECK: %[[BX:.*]] = arith.muli %[[C128]], %[[SKIPPED]] : index
+      // CHECK: %[[BY:.*]] = arith.muli %[[C0]], %[[SKIPPED]] : index
+      // CHECK: %[[B_TILE:.*]] = xetile.update_tile_offset %{{.*}}, [%[[BX]], %[[BY]]]
+      // CHECK: %[[ZERO:.*]] = arith.constant {map = #xetile.wg_map<sg_layout = [4, 4], sg_data = [32, 32]>} dense<0.000000e+00> : vector<128x128xf32>
+      // AUTO: %[[UB:.*]] = arith.constant 256 : index
+      // SPLIT2: %[[UB:.*]] = arith.constant 512 : index
+      // CHECK: %[[OUT:.*]]:3 = scf.for %{{.*}} = %[[C0]] to %[[UB]] step %[[C128]]
+      // CHECK-SAME: iter_args(%{{.*}} = %[[A_TILE]], %{{.*}} = %[[B_TILE]], %{{.*}} = %[[ZERO]])
+      %out:3 = scf.for %k = %c0 to %c1024 step %c128
+        iter_args(%a_tile = %a_init_tile, %b_tile = %b_init_tile, %c_value = %c_init_value)
+        -> (!xetile.tile<128x128xf16, #tile_attr_a>, !xetile.tile<128x128xf16, #tile_attr_b>, vector<128x128xf32>) {
+        %a_value = xetile.load_tile %a_tile : !xetile.tile<128x128xf16, #tile_attr_a> -> vector<128x128xf16>
+        %b_value = xetile.load_tile %b_tile : !xetile.tile<128x128xf16, #tile_attr_b> -> vector<128x128xf16>
+        %c_new_value = xetile.tile_mma %a_value, %b_value, %c_value {wg_map_a = #wg_map_a, wg_map_b = #wg_map_b, wg_map_c = #wg_map_c}
+          : vector<128x128xf16>, vector<128x128xf16>, vector<128x128xf32> -> vector<128x128xf32>
+        %a_next_tile = xetile.update_tile_offset %a_tile, [%c0, %c128] : !xetile.tile<128x128xf16, #tile_attr_a>
+        %b_next_tile = xetile.update_tile_offset %b_tile, [%c128, %c0] : !xetile.tile<128x128xf16, #tile_attr_b>
+        scf.yield %a_next_tile, %b_next_tile, %c_new_value
+          : !xetile.tile<128x128xf16, #tile_attr_a>, !xetile.tile<128x128xf16, #tile_attr_b>, vector<128x128xf32>
+      }
+      // CHECK: xetile.atomic_rmw addf %[[OUT]]#2, %[[C_TILE]] : vector<128x128xf32>
+      // CHECK-NOT: xetile.store_tile
+      xetile.store_tile %out#2, %c_init_tile : vector<128x128xf32>, !xetile.tile<128x128xf32, #tile_attr_c>
+      gpu.return
+    }
+  }
+}
@@ -5,6 +5,7 @@ builtin.module(
     func.func(tosa-to-linalg)
     func.func(tosa-to-tensor)
     canonicalize
+    imex-fuse-generators
     linalg-fuse-elementwise-ops
     arith-expand
     memref-expand
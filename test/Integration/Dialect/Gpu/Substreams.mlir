@@ -0,0 +1,77 @@
+// RUN: %python_executable %imex_runner --requires=l0-runtime -i %s --pass-pipeline-file=%p/gpu-substreams-to-llvm.pp \
+// RUN:                                       --runner imex-cpu-runner -e main \
+// RUN:                                       --entry-point-result=void \
+// RUN:                                       --shared-libs=%irunner_utils,%mlir_runner_utils,%mlir_c_runner_utils,%levelzero_runtime --filecheck
+// RUN: %python_executable %imex_runner --requires=sycl-runtime -i %s --pass-pipeline-file=%p/gpu-substreams-to-llvm.pp \
+// RUN:                                        --runner imex-cpu-runner -e main \
+// RUN:                                        --entry-point-result=void \
+// RUN:                                        --shared-libs=%irunner_utils,%mlir_runner_utils,%mlir_c_runner_utils,%sycl_runtime --filecheck
+// RUN: IMEX_SYCL_DISCARD_EVENTS=1 %python_executable %imex_runner --requires=sycl-runtime -i %s --pass-pipeline-file=%p/gpu-substreams-to-llvm.pp \
+// RUN:                                        --runner imex-cpu-runner -e main \
+// RUN:                                        --entry-point-result=void \
+// RUN:                                        --shared-libs=%irunner_utils,%mlir_runner_utils,%mlir_c_runner_utils,%sycl_runtime --filecheck
+module @substreams attributes {gpu.container_module} {
+  gpu.module @kernels attributes {spirv.target_env = #spirv.target_env<#spirv.vce<v1.4, [Addresses, Float16Buffer, Int64, Int16, Int8, Kernel, Linkage, Vector16, GenericPointer, Groups, Float16, Float64, AtomicFloat32AddEXT, ExpectAssumeKHR, SubgroupDispatch, VectorComputeINTEL, VectorAnyINTEL], [SPV_EXT_shader_atomic_float_add, SPV_KHR_expect_assume, SPV_INTEL_vector_compute]>, api=OpenCL, #spirv.resource_limits<>>} {
+    gpu.func @inc(%arg0: memref<4194304xf32>) kernel attributes {spirv.entry_point_abi = #spirv.entry_point_abi<>} {
+      %global_id_x = gpu.global_id x
+      %cst = arith.constant 1.0 : f32
+      %0 = memref.load %arg0[%global_id_x] : memref<4194304xf32>
+      %1 = arith.addf %0, %cst : f32
+      memref.store %1, %arg0[%global_id_x] : memref<4194304xf32>
+      gpu.return
+    }
+    gpu.func @add(%arg0: memref<4194304xf32>, %arg1: memref<4194304xf32>, %arg2: memref<4194304xf32>) kernel attributes {spirv.entry_point_abi = #spirv.entry_point_abi<>} {
+      %global_id_x = gpu.global_id x
+      %0 = memref.load %arg0[%global_id_x] : memref<4194304xf32>
+      %1 = memref.load %arg1[%global_id_x] : memref<4194304xf32>
+      %2 = arith.addf %0, %1 : f32
+      memref.store %2, %arg2[%global_id_x] : memref<4194304xf32>
+      gpu.return
+    }
+  }
+
+  // Two independent chains, the second one on a substream, joined by the
+  // last launch: %res = (%a + 1) + (%b + 2).
+  func.func @run(%a: memref<4194304xf32>, %b: memref<4194304xf32>, %res: memref<4194304xf32>) {
+    %c1 = arith.constant 1 : index
+    %c512 = arith.constant 512 : index
+    %c8192 = arith.constant 8192 : index
+    %a1 = gpu.launch_func async @kernels::@inc blocks in (%c8192, %c1, %c1) threads in (%c512, %c1, %c1) args(%a : memref<4194304xf32>)
+    %b1 = gpu.launch_func async @kernels::@inc blocks in (%c8192, %c1, %c1) threads in (%c512, %c1, %c1) args(%b : memref<4194304xf32>)
+    %b2 = gpu.launch_func async [%b1] @kernels::@inc blocks in (%c8192, %c1, %c1) threads in (%c512, %c1, %c1) args(%b : memref<4194304xf32>)
+    %j = gpu.launch_func async [%a1, %b2] @kernels::@add blocks in (%c8192, %c1, %c1) threads in (%c512, %c1, %c1) args(%a : memref<4194304xf32>, %b : memref<4194304xf32>, %res : memref<4194304xf32>)
+    gpu.wait [%j]
+    return
+  }
+
+  func.func @main() {
+    %c0 = arith.constant 0.0 : f32
+    %c3 = arith.constant 3.0 : f32
+    %a = gpu.alloc host_shared () : memref<4194304xf32>
+    %b = gpu.alloc host_shared () : memref<4194304xf32>
+    %res = gpu.alloc host_shared () : memref<4194304xf32>
+    %ref = memref.alloc() : memref<4194304xf32>
+    %cast_a = memref.cast %a : memref<4194304xf32> to memref<*xf32>
+    %cast_b = memref.cast %b : memref<4194304xf32> to memref<*xf32>
+    %cast_res = memref.cast %res : memref<4194304xf32> to memref<*xf32>
+    %cast_ref = memref.cast %ref : memref<4194304xf32> to memref<*xf32>
+    call @fillResource1DF32(%cast_a, %c0) : (memref<*xf32>, f32) -> ()
+    call @fillResource1DF32(%cast_b, %c0) : (memref<*xf32>, f32) -> ()
+    call @fillResource1DF32(%cast_res, %c0) : (memref<*xf32>, f32) -> ()
+    call @fillResource1DF32(%cast_ref, %c3) : (memref<*xf32>, f32) -> ()
+
+    call @run(%a, %b, %res) : (memref<4194304xf32>, memref<4194304xf32>, memref<4194304xf32>) -> ()
+
+    // CHECK: [ALLCLOSE: TRUE]
+    call @printAllcloseF32(%cast_res, %cast_ref) : (memref<*xf32>, memref<*xf32>) -> ()
+
+    memref.dealloc %ref : memref<4194304xf32>
+    gpu.dealloc %a : memref<4194304xf32>
+    gpu.dealloc %b : memref<4194304xf32>
+    gpu.dealloc %res : memref<4194304xf32>
+    return
+  }
+
+  func.func private @fillResource1DF32(memref<*xf32>, f32) attributes {llvm.emit_c_interface}
+  func.func private @printAllcloseF32(memref<*xf32>, memref<*xf32>) attributes {llvm.emit_c_interface}
+}
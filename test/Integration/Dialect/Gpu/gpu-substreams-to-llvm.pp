@@ -0,0 +1,33 @@
+// gpu dialect with intel intrinsic functions (func dialect) to
+// llvm dialect (for host code) and
+// spirv dialect (for device code) lowering pipeline.
+// Ready for imex runner starting from GPU dialect. Independent async launches
+// run on substreams.
+builtin.module(
+    imex-vector-linearize
+    cse
+    gpu.module(convert-math-to-vc{enable-high-precision-interim-calculation=true})
+    reconcile-unrealized-casts
+    bf16-to-gpu
+    imex-convert-gpu-to-spirv
+    spirv.module(spirv-lower-abi-attrs
+             spirv-update-vce)
+    func.func(llvm-request-c-wrappers)
+    serialize-spirv
+    convert-vector-to-scf
+    convert-gpu-to-gpux
+    func.func(assign-gpux-streams{num-streams=2})
+    convert-scf-to-cf
+    expand-strided-metadata
+    finalize-memref-to-llvm
+    convert-cf-to-llvm
+    convert-vector-to-llvm
+    convert-index-to-llvm
+    convert-arith-to-llvm
+    convert-func-to-llvm
+    convert-math-to-llvm
+    convert-gpux-to-llvm
+    convert-index-to-llvm
+    lower-affine
+    reconcile-unrealized-casts)
+// End
@@ -0,0 +1,35 @@
+// RUN: %python_executable %imex_runner --requires=l0-runtime -i %s --pass-pipeline-file=%p/linalg-to-gpux-opencl-coop.pp \
+// RUN:                                       --runner imex-cpu-runner -e main \
+// RUN:                                       --entry-point-result=void \
+// RUN:                                       --shared-libs=%irunner_utils,%mlir_runner_utils,%mlir_c_runner_utils,%levelzero_runtime --filecheck
+// RUN: %python_executable %imex_runner --requires=sycl-runtime -i %s --pass-pipeline-file=%p/linalg-to-gpux-opencl-coop.pp \
+// RUN:                                        --runner imex-cpu-runner -e main \
+// RUN:                                        --entry-point-result=void \
+// RUN:                                        --shared-libs=%irunner_utils,%mlir_runner_utils,%mlir_c_runner_utils,%sycl_runtime --filecheck
+
+// The f16 matmul is lowered by imex-matmul-to-coop-matrix to cooperative
+// matrix ops, one 8x16 tile of the result per subgroup.
+module {
+func.func @matmul(%arg0: tensor<32x64xf16>, %arg1: tensor<64x32xf16>) -> tensor<32x32xf32> {
+  %cst = arith.constant 0.0 : f32
+  %0 = tensor.empty() : tensor<32x32xf32>
+  %1 = linalg.fill ins(%cst : f32) outs(%0 : tensor<32x32xf32>) -> tensor<32x32xf32>
+  %2 = linalg.matmul ins(%arg0, %arg1 : tensor<32x64xf16>, tensor<64x32xf16>)
+                     outs(%1 : tensor<32x32xf32>) -> tensor<32x32xf32>
+  return %2 : tensor<32x32xf32>
+}
+
+func.func @main() {
+  %0 = arith.constant dense<1.0> : tensor<32x64xf16>
+  %1 = arith.constant dense<0.5> : tensor<64x32xf16>
+  %ref = arith.constant dense<32.0> : tensor<32x32xf32>
+  %2 = call @matmul(%0, %1) : (tensor<32x64xf16>, tensor<64x32xf16>) -> tensor<32x32xf32>
+  %unranked = tensor.cast %2 : tensor<32x32xf32> to tensor<*xf32>
+  %unranked_ref = tensor.cast %ref : tensor<32x32xf32> to tensor<*xf32>
+  // CHECK: [ALLCLOSE: TRUE]
+  call @printAllcloseF32(%unranked, %unranked_ref) : (tensor<*xf32>, tensor<*xf32>) -> ()
+  return
+}
+
+func.func private @printAllcloseF32(tensor<*xf32>, tensor<*xf32>) attributes {llvm.emit_c_interface}
+}
@@ -0,0 +1,196 @@
+// RUN: IMEX_ENABLE_LARGE_REG_FILE=1 %python_executable %imex_runner --requires=l0-runtime -i %s --pass-pipeline-file=%p/xetile-to-func-vc.pp \
+// RUN:                                       --runner imex-cpu-runner -e main \
+// RUN:                                       --entry-point-result=void \
+// RUN:                                       --shared-libs=%irunner_utils,%mlir_runner_utils,%mlir_c_runner_utils,%levelzero_runtime --filecheck
+// RUN: IMEX_ENABLE_LARGE_REG_FILE=1 %python_executable %imex_runner --requires=sycl-runtime -i %s --pass-pipeline-file=%p/xetile-to-func-vc.pp \
+// RUN:                                        --runner imex-cpu-runner -e main \
+// RUN:                                        --entry-point-result=void \
+// RUN:                                        --shared-libs=%irunner_utils,%mlir_runner_utils,%mlir_c_runner_utils,%sycl_runtime --filecheck
+
+// NOTES :
+// Fused attention forward, Out = softmax(Q * K^T * scale) * V, for a single
+// head with sequence length 1024 and head dimension 64. Each subgroup owns 16
+// rows of Q and walks K and V in blocks of 32 rows. The scores of a block are
+// computed with tile_mma, turned into probabilities with an online softmax
+// (running row max and row sum, see online_softmax_dim_1_fp32.mlir) and
+// immediately multiplied with the V block into the output accumulator, which
+// is rescaled whenever the row max grows. The 1024x1024 score matrix is never
+// written to memory.
+
+module @flash_attention attributes {gpu.container_module} {
+  func.func @test(%Q: memref<1024x64xf16>, %K: memref<1024x64xf16>, %V: memref<1024x64xf16>) -> memref<1024x64xf32> attributes {llvm.emit_c_interface} {
+    %c1 = arith.constant 1 : index
+    %c64 = arith.constant 64 : index
+    %Q_gpu = gpu.alloc  host_shared () : memref<1024x64xf16>
+    memref.copy %Q, %Q_gpu : memref<1024x64xf16> to memref<1024x64xf16>
+    %K_gpu = gpu.alloc  host_shared () : memref<1024x64xf16>
+    memref.copy %K, %K_gpu : memref<1024x64xf16> to memref<1024x64xf16>
+    %V_gpu = gpu.alloc  host_shared () : memref<1024x64xf16>
+    memref.copy %V, %V_gpu : memref<1024x64xf16> to memref<1024x64xf16>
+    %Out_gpu = gpu.alloc  host_shared () : memref<1024x64xf32>
+    gpu.launch_func  @test_kernel::@test_kernel blocks in (%c64, %c1, %c1) threads in (%c1, %c1, %c1) args(%Q_gpu : memref<1024x64xf16>, %K_gpu : memref<1024x64xf16>, %V_gpu : memref<1024x64xf16>, %Out_gpu : memref<1024x64xf32>)
+    gpu.dealloc  %Q_gpu : memref<1024x64xf16>
+    gpu.dealloc  %K_gpu : memref<1024x64xf16>
+    gpu.dealloc  %V_gpu : memref<1024x64xf16>
+    return %Out_gpu : memref<1024x64xf32>
+  }
+  gpu.module @test_kernel attributes {spirv.target_env = #spirv.target_env<#spirv.vce<v1.4, [Addresses, Float16Buffer, Int64, Int16, Int8, Kernel, Linkage, Vector16, GenericPointer, Groups, Float16, Float64, AtomicFloat32AddEXT, ExpectAssumeKHR, SubgroupDispatch, VectorComputeINTEL, VectorAnyINTEL], [SPV_EXT_shader_atomic_float_add, SPV_KHR_expect_assume, SPV_INTEL_vector_compute]>, api=OpenCL, #spirv.resource_limits<>>} {
+    gpu.func @test_kernel(%Q: memref<1024x64xf16>, %K: memref<1024x64xf16>, %V: memref<1024x64xf16>, %Out: memref<1024x64xf32>) kernel attributes {VectorComputeFunctionINTEL, spirv.entry_point_abi = #spirv.entry_point_abi<>} {
+      %c0 = arith.constant 0 : index
+      %c16 = arith.constant 16 : index
+      %c32 = arith.constant 32 : index
+      %c1024 = arith.constant 1024 : index
+      // 1 / sqrt(64)
+      %scale = arith.constant dense<0.125> : vector<16x32xf32>
+      %max_init = arith.constant dense<-3.40282347E+38> : vector<16x32xf32>
+      %sum_init = arith.constant dense<0.0> : vector<16x32xf32>
+      %acc_init = arith.constant dense<0.0> : vector<16x64xf32>
+      %block_id_x = gpu.block_id x
+      %m = arith.muli %block_id_x, %c16 : index
+      // the Q tile stays in registers for the whole loop
+      %q_tile = xetile.init_tile %Q[%m, %c0] : memref<1024x64xf16> -> !xetile.tile<16x64xf16>
+      %q_value = xetile.load_tile %q_tile : !xetile.tile<16x64xf16> -> vector<16x64xf16>
+      %k_init_tile = xetile.init_tile %K[%c0, %c0] : memref<1024x64xf16> -> !xetile.tile<32x64xf16>
+      %v_init_tile = xetile.init_tile %V[%c0, %c0] : memref<1024x64xf16> -> !xetile.tile<32x64xf16>
+      %out:5 = scf.for %n = %c0 to %c1024 step %c32
+        iter_args(%k_tile = %k_init_tile, %v_tile = %v_init_tile, %max = %max_init, %sum = %sum_init, %acc = %acc_init)
+        -> (!xetile.tile<32x64xf16>, !xetile.tile<32x64xf16>, vector<16x32xf32>, vector<16x32xf32>, vector<16x64xf32>) {
+        // scores of the block: S = Q * K^T * scale
+        %k_value = xetile.load_tile %k_tile : !xetile.tile<32x64xf16> -> vector<32x64xf16>
+        %k_trans = vector.transpose %k_value, [1, 0] : vector<32x64xf16> to vector<64x32xf16>
+        %qk = xetile.tile_mma %q_value, %k_trans
+          : vector<16x64xf16>, vector<64x32xf16> -> vector<16x32xf32>
+        %s = arith.mulf %qk, %scale : vector<16x32xf32>
+        // online softmax update of the running row max and row sum
+        %row_max = xetile.reduction <maxnumf>, %s [1] : vector<16x32xf32> -> vector<16x1xf32>
+        %row_max_b = xetile.broadcast %row_max [1] : vector<16x1xf32> -> vector<16x32xf32>
+        %new_max = arith.maxnumf %max, %row_max_b : vector<16x32xf32>
+        %max_diff = arith.subf %max, %new_max : vector<16x32xf32>
+        %alpha = math.exp %max_diff : vector<16x32xf32>
+        %s_shifted = arith.subf %s, %new_max : vector<16x32xf32>
+        %p = math.exp %s_shifted : vector<16x32xf32>
+        %row_sum = xetile.reduction <add>, %p [1] : vector<16x32xf32> -> vector<16x1xf32>
+        %row_sum_b = xetile.broadcast %row_sum [1] : vector<16x1xf32> -> vector<16x32xf32>
+        %scaled_sum = arith.mulf %sum, %alpha : vector<16x32xf32>
+        %new_sum = arith.addf %scaled_sum, %row_sum_b : vector<16x32xf32>
+        // rescale the accumulator to the new max and add P * V
+        %alpha_row = xetile.reduction <maxnumf>, %alpha [1] : vector<16x32xf32> -> vector<16x1xf32>
+        %alpha_acc = xetile.broadcast %alpha_row [1] : vector<16x1xf32> -> vector<16x64xf32>
+        %scaled_acc = arith.mulf %acc, %alpha_acc : vector<16x64xf32>
+        %p_f16 = arith.truncf %p : vector<16x32xf32> to vector<16x32xf16>
+        %v_value = xetile.load_tile %v_tile : !xetile.tile<32x64xf16> -> vector<32x64xf16>
+        %new_acc = xetile.tile_mma %p_f16, %v_value, %scaled_acc
+          : vector<16x32xf16>, vector<32x64xf16>, vector<16x64xf32> -> vector<16x64xf32>
+        %k_next_tile = xetile.update_tile_offset %k_tile, [%c32, %c0] : !xetile.tile<32x64xf16>
+        %v_next_tile = xetile.update_tile_offset %v_tile, [%c32, %c0] : !xetile.tile<32x64xf16>
+        scf.yield %k_next_tile, %v_next_tile, %new_max, %new_sum, %new_acc
+          : !xetile.tile<32x64xf16>, !xetile.tile<32x64xf16>, vector<16x32xf32>, vector<16x32xf32>, vector<16x64xf32>
+      }
+      // normalize by the row sum and store the output tile
+      %sum_row = xetile.reduction <maxnumf>, %out#3 [1] : vector<16x32xf32> -> vector<16x1xf32>
+      %sum_b = xetile.broadcast %sum_row [1] : vector<16x1xf32> -> vector<16x64xf32>
+      %result = arith.divf %out#4, %sum_b : vector<16x64xf32>
+      %out_tile = xetile.init_tile %Out[%m, %c0] : memref<1024x64xf32> -> !xetile.tile<16x64xf32>
+      xetile.store_tile %result, %out_tile : vector<16x64xf32>, !xetile.tile<16x64xf32>
+      gpu.return
+    }
+  }
+  func.func @main() attributes {llvm.emit_c_interface} {
+    %c0 = arith.constant 0 : index
+    %c1 = arith.constant 1 : index
+    %c2 = arith.constant 2 : index
+    %c8 = arith.constant 8 : index
+    %c16 = arith.constant 16 : index
+    %c64 = arith.constant 64 : index
+    %c1024 = arith.constant 1024 : index
+    %c0_f32 = arith.constant 0.0 : f32
+    %cmin_f32 = arith.constant -3.40282347E+38 : f32
+    %scale = arith.constant 0.125 : f32
+    %c16_f16 = arith.constant 16.0 : f16
+    %Q = memref.alloc() : memref<1024x64xf16>
+    %K = memref.alloc() : memref<1024x64xf16>
+    %V = memref.alloc() : memref<1024x64xf16>
+    %Out_ref = memref.alloc() : memref<1024x64xf32>
+    %S = memref.alloc() : memref<1024xf32>
+    // intialize Q, K and V ; Q[i, j] = ((i + j) % 8) / 16,
+    // K[i, j] = ((2i + j) % 8) / 16, V[i, j] = ((i + j) % 16) / 16
+    scf.for %i = %c0 to %c1024 step %c1 {
+      scf.for %j = %c0 to %c64 step %c1 {
+        %ij = arith.addi %i, %j : index
+        %q_r = arith.remui %ij, %c8 : index
+        %q_t = index.castu %q_r : index to i16
+        %q_u = arith.uitofp %q_t : i16 to f16
+        %q_val = arith.divf %q_u, %c16_f16 : f16
+        memref.store %q_val, %Q[%i, %j] : memref<1024x64xf16>
+        %i2 = arith.muli %i, %c2 : index
+        %i2j = arith.addi %i2, %j : index
+        %k_r = arith.remui %i2j, %c8 : index
+        %k_t = index.castu %k_r : index to i16
+        %k_u = arith.uitofp %k_t : i16 to f16
+        %k_val = arith.divf %k_u, %c16_f16 : f16
+        memref.store %k_val, %K[%i, %j] : memref<1024x64xf16>
+        %v_r = arith.remui %ij, %c16 : index
+        %v_t = index.castu %v_r : index to i16
+        %v_u = arith.uitofp %v_t : i16 to f16
+        %v_val = arith.divf %v_u, %c16_f16 : f16
+        memref.store %v_val, %V[%i, %j] : memref<1024x64xf16>
+      }
+    }
+    // compute Out for reference, materializing each row of the scores
+    scf.for %i = %c0 to %c1024 step %c1 {
+      %max = scf.for %n = %c0 to %c1024 step %c1 iter_args(%max_partial = %cmin_f32) -> f32 {
+        %dot = scf.for %k = %c0 to %c64 step %c1 iter_args(%dot_partial = %c0_f32) -> f32 {
+          %q_val = memref.load %Q[%i, %k] : memref<1024x64xf16>
+          %k_val = memref.load %K[%n, %k] : memref<1024x64xf16>
+          %q_ext = arith.extf %q_val : f16 to f32
+          %k_ext = arith.extf %k_val : f16 to f32
+          %t = arith.mulf %q_ext, %k_ext : f32
+          %dot_sum = arith.addf %t, %dot_partial : f32
+          scf.yield %dot_sum : f32
+        }
+        %s_val = arith.mulf %dot, %scale : f32
+        memref.store %s_val, %S[%n] : memref<1024xf32>
+        %max_new = arith.maxnumf %s_val, %max_partial : f32
+        scf.yield %max_new : f32
+      }
+      %sum = scf.for %n = %c0 to %c1024 step %c1 iter_args(%sum_partial = %c0_f32) -> f32 {
+        %s_val = memref.load %S[%n] : memref<1024xf32>
+        %shifted = arith.subf %s_val, %max : f32
+        %p = math.exp %shifted : f32
+        memref.store %p, %S[%n] : memref<1024xf32>
+        %sum_new = arith.addf %p, %sum_partial : f32
+        scf.yield %sum_new : f32
+      }
+      scf.for %j = %c0 to %c64 step %c1 {
+        %o = scf.for %n = %c0 to %c1024 step %c1 iter_args(%o_partial = %c0_f32) -> f32 {
+          %p = memref.load %S[%n] : memref<1024xf32>
+          %v_val = memref.load %V[%n, %j] : memref<1024x64xf16>
+          %v_ext = arith.extf %v_val : f16 to f32
+          %t = arith.mulf %p, %v_ext : f32
+          %o_sum = arith.addf %t, %o_partial : f32
+          scf.yield %o_sum : f32
+        }
+        %o_val = arith.divf %o, %sum : f32
+        memref.store %o_val, %Out_ref[%i, %j] : memref<1024x64xf32>
+      }
+    }
+    %2 = call @test(%Q, %K, %V) : (memref<1024x64xf16>, memref<1024x64xf16>, memref<1024x64xf16>) -> memref<1024x64xf32>
+    %cast_Out = memref.cast %2 : memref<1024x64xf32> to memref<*xf32>
+    %cast_Out_ref = memref.cast %Out_ref : memref<1024x64xf32> to memref<*xf32>
+    // call @printMemrefF32(%cast_Out) : (memref<*xf32>) -> ()
+    // call @printMemrefF32(%cast_Out_ref) : (memref<*xf32>) -> ()
+    // The probabilities are rounded to f16 before the multiplication with V.
+    // CHECK: [ALLCLOSE: TRUE]
+    %rtol = arith.constant 1.0e-02 : f32
+    %atol = arith.constant 1.0e-03 : f32
+    call @printAllcloseTolF32(%cast_Out, %cast_Out_ref, %rtol, %atol) : (memref<*xf32>, memref<*xf32>, f32, f32) -> ()
+    memref.dealloc %Q : memref<1024x64xf16>
+    memref.dealloc %K : memref<1024x64xf16>
+    memref.dealloc %V : memref<1024x64xf16>
+    memref.dealloc %Out_ref : memref<1024x64xf32>
+    memref.dealloc %S : memref<1024xf32>
+    return
+  }
+  func.func private @printMemrefF32(memref<*xf32>) attributes {llvm.emit_c_interface}
+  func.func private @printAllcloseTolF32(memref<*xf32>, memref<*xf32>, f32, f32) attributes {llvm.emit_c_interface}
+}
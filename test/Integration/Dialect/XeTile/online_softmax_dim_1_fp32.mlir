@@ -0,0 +1,145 @@
+// RUN: %python_executable %imex_runner --requires=l0-runtime -i %s --pass-pipeline-file=%p/xetile-to-func-vc.pp \
+// RUN:                                       --runner imex-cpu-runner -e main \
+// RUN:                                       --entry-point-result=void \
+// RUN:                                       --shared-libs=%irunner_utils,%mlir_runner_utils,%mlir_c_runner_utils,%levelzero_runtime --filecheck
+// RUN: %python_executable %imex_runner --requires=sycl-runtime -i %s --pass-pipeline-file=%p/xetile-to-func-vc.pp \
+// RUN:                                        --runner imex-cpu-runner -e main \
+// RUN:                                        --entry-point-result=void \
+// RUN:                                        --shared-libs=%irunner_utils,%mlir_runner_utils,%mlir_c_runner_utils,%sycl_runtime --filecheck
+
+// NOTES :
+// Softmax along dim-1 of whole 1024-element rows, with the max and the sum
+// computed online: a single pass over the row keeps a running max m and a
+// running sum l of exp(x - m) in registers, rescaling l by exp(m_old - m_new)
+// whenever the max grows. A second pass writes exp(x - m) / l. This reads the
+// input twice instead of three times and never writes the intermediates.
+// The running values are kept broadcast over the 16x32 block, so that all
+// the updates are plain elementwise ops.
+
+module @online_softmax attributes {gpu.container_module} {
+  func.func @online_softmax_test(%a: memref<1024x1024xf32>) -> memref<1024x1024xf32> attributes {llvm.emit_c_interface} {
+    %c1 = arith.constant 1 : index
+    %c64 = arith.constant 64 : index
+
+    %a_gpu = gpu.alloc host_shared () : memref<1024x1024xf32>
+    memref.copy %a, %a_gpu : memref<1024x1024xf32> to memref<1024x1024xf32>
+    %b_gpu = gpu.alloc  host_shared () : memref<1024x1024xf32>
+
+    gpu.launch_func @kernel::@online_softmax_dim_1 blocks in (%c64, %c1, %c1) threads in (%c1, %c1, %c1) args(%a_gpu : memref<1024x1024xf32>, %b_gpu : memref<1024x1024xf32>)
+
+    gpu.dealloc %a_gpu : memref<1024x1024xf32>
+    return %b_gpu : memref<1024x1024xf32>
+  }
+
+  gpu.module @kernel  attributes {spirv.target_env = #spirv.target_env<#spirv.vce<v1.4, [Addresses, Float16Buffer, Int64, Int16, Int8, Kernel, Linkage, Vector16, GenericPointer, Groups, Float16, Float64, AtomicFloat32AddEXT, ExpectAssumeKHR, SubgroupDispatch, VectorComputeINTEL, VectorAnyINTEL], [SPV_EXT_shader_atomic_float_add, SPV_KHR_expect_assume, SPV_INTEL_vector_compute]>, api=OpenCL, #spirv.resource_limits<>>} {
+    // each thread is assigned with 16 full rows, walked in 16x32 blocks.
+    gpu.func @online_softmax_dim_1(%a: memref<1024x1024xf32>, %b: memref<1024x1024xf32>)  kernel attributes {VectorComputeFunctionINTEL, spirv.entry_point_abi = #spirv.entry_point_abi<>} {
+      %c0 = arith.constant 0 : index
+      %c16 = arith.constant 16 : index
+      %c32 = arith.constant 32 : index
+      %c1024 = arith.constant 1024 : index
+      %max_init = arith.constant dense<-3.40282347E+38> : vector<16x32xf32>
+      %sum_init = arith.constant dense<0.0> : vector<16x32xf32>
+
+      %block_id_x = gpu.block_id x
+      %m = arith.muli %block_id_x, %c16 : index
+
+      // pass 1: running max and running sum of exp(x - max).
+      %a_init_tile = xetile.init_tile %a[%m, %c0] : memref<1024x1024xf32> -> !xetile.tile<16x32xf32>
+      %stats:3 = scf.for %k = %c0 to %c1024 step %c32
+        iter_args(%a_tile = %a_init_tile, %max = %max_init, %sum = %sum_init)
+        -> (!xetile.tile<16x32xf32>, vector<16x32xf32>, vector<16x32xf32>) {
+        %x = xetile.load_tile %a_tile : !xetile.tile<16x32xf32> -> vector<16x32xf32>
+        %row_max = xetile.reduction <maxnumf>, %x [1] : vector<16x32xf32> -> vector<16x1xf32>
+        %row_max_b = xetile.broadcast %row_max [1] : vector<16x1xf32> -> vector<16x32xf32>
+        %new_max = arith.maxnumf %max, %row_max_b : vector<16x32xf32>
+        // rescale the sum accumulated so far to the new max.
+        %max_diff = arith.subf %max, %new_max : vector<16x32xf32>
+        %alpha = math.exp %max_diff : vector<16x32xf32>
+        %scaled_sum = arith.mulf %sum, %alpha : vector<16x32xf32>
+        %x_shifted = arith.subf %x, %new_max : vector<16x32xf32>
+        %e = math.exp %x_shifted : vector<16x32xf32>
+        %row_sum = xetile.reduction <add>, %e [1] : vector<16x32xf32> -> vector<16x1xf32>
+        %row_sum_b = xetile.broadcast %row_sum [1] : vector<16x1xf32> -> vector<16x32xf32>
+        %new_sum = arith.addf %scaled_sum, %row_sum_b : vector<16x32xf32>
+        %a_next_tile = xetile.update_tile_offset %a_tile, [%c0, %c32] : !xetile.tile<16x32xf32>
+        scf.yield %a_next_tile, %new_max, %new_sum : !xetile.tile<16x32xf32>, vector<16x32xf32>, vector<16x32xf32>
+      }
+
+      // pass 2: normalize.
+      %b_init_tile = xetile.init_tile %b[%m, %c0] : memref<1024x1024xf32> -> !xetile.tile<16x32xf32>
+      %out:2 = scf.for %k = %c0 to %c1024 step %c32
+        iter_args(%a_tile = %a_init_tile, %b_tile = %b_init_tile)
+        -> (!xetile.tile<16x32xf32>, !xetile.tile<16x32xf32>) {
+        %x = xetile.load_tile %a_tile : !xetile.tile<16x32xf32> -> vector<16x32xf32>
+        %x_shifted = arith.subf %x, %stats#1 : vector<16x32xf32>
+        %e = math.exp %x_shifted : vector<16x32xf32>
+        %y = arith.divf %e, %stats#2 : vector<16x32xf32>
+        xetile.store_tile %y, %b_tile : vector<16x32xf32>, !xetile.tile<16x32xf32>
+        %a_next_tile = xetile.update_tile_offset %a_tile, [%c0, %c32] : !xetile.tile<16x32xf32>
+        %b_next_tile = xetile.update_tile_offset %b_tile, [%c0, %c32] : !xetile.tile<16x32xf32>
+        scf.yield %a_next_tile, %b_next_tile : !xetile.tile<16x32xf32>, !xetile.tile<16x32xf32>
+      }
+      gpu.return
+    }
+  }
+
+  func.func @main() attributes {llvm.emit_c_interface} {
+    %c0 = arith.constant 0 : index
+    %c1 = arith.constant 1 : index
+    %c32 = arith.constant 32 : index
+    %c1024 = arith.constant 1024 : index
+    %c0_f32 = arith.constant 0.0 : f32
+    %c8_f32 = arith.constant 8.0 : f32
+    %cmin_f32 = arith.constant -3.40282347E+38 : f32
+    %a = memref.alloc() : memref<1024x1024xf32>
+    %b_ref = memref.alloc() : memref<1024x1024xf32>
+
+    // intialize matrix A ; A[i, j] = ((i + j) % 32) / 8
+    scf.for %i = %c0 to %c1024 step %c1 {
+      scf.for %j = %c0 to %c1024 step %c1 {
+        %s = arith.addi %i, %j : index
+        %r = arith.remui %s, %c32 : index
+        %t = index.castu %r : index to i16
+        %u = arith.uitofp %t : i16 to f32
+        %v = arith.divf %u, %c8_f32 : f32
+        memref.store %v, %a[%i, %j] : memref<1024x1024xf32>
+      }
+    }
+
+    // compute b for reference, with separate max, exp-sum and normalize passes
+    scf.for %i = %c0 to %c1024 step %c1 {
+      %max = scf.for %j = %c0 to %c1024 step %c1 iter_args(%arg = %cmin_f32) -> (f32) {
+        %val = memref.load %a[%i, %j] : memref<1024x1024xf32>
+        %2 = arith.maxnumf %arg, %val : f32
+        scf.yield %2 : f32
+      }
+      %sum = scf.for %j = %c0 to %c1024 step %c1 iter_args(%arg = %c0_f32) -> (f32) {
+        %val = memref.load %a[%i, %j] : memref<1024x1024xf32>
+        %shifted = arith.subf %val, %max : f32
+        %exp = math.exp %shifted : f32
+        memref.store %exp, %b_ref[%i, %j] : memref<1024x1024xf32>
+        %2 = arith.addf %arg, %exp : f32
+        scf.yield %2 : f32
+      }
+      scf.for %j = %c0 to %c1024 step %c1 {
+        %val = memref.load %b_ref[%i, %j] : memref<1024x1024xf32>
+        %div = arith.divf %val, %sum : f32
+        memref.store %div, %b_ref[%i, %j] : memref<1024x1024xf32>
+      }
+    }
+
+    %b = call @online_softmax_test(%a) : (memref<1024x1024xf32>) -> memref<1024x1024xf32>
+    %cast_b = memref.cast %b : memref<1024x1024xf32> to memref<*xf32>
+    %cast_b_ref = memref.cast %b_ref : memref<1024x1024xf32> to memref<*xf32>
+    // call @printMemrefF32(%cast_b) : (memref<*xf32>) -> ()
+    // call @printMemrefF32(%cast_b_ref) : (memref<*xf32>) -> ()
+    // CHECK: [ALLCLOSE: TRUE]
+    call @printAllcloseF32(%cast_b, %cast_b_ref) : (memref<*xf32>, memref<*xf32>) -> ()
+    memref.dealloc %a : memref<1024x1024xf32>
+    memref.dealloc %b_ref : memref<1024x1024xf32>
+    return
+  }
+  func.func private @printMemrefF32(memref<*xf32>) attributes {llvm.emit_c_interface}
+  func.func private @printAllcloseF32(memref<*xf32>, memref<*xf32>) attributes {llvm.emit_c_interface}
+}
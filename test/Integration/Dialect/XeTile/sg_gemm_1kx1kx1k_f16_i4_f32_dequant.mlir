@@ -0,0 +1,211 @@
+// RUN: %python_executable %imex_runner --requires=l0-runtime -i %s --pass-pipeline-file=%p/xetile-to-func-vc.pp \
+// RUN:                                       --runner imex-cpu-runner -e main \
+// RUN:                                       --entry-point-result=void \
+// RUN:                                       --shared-libs=%irunner_utils,%mlir_runner_utils,%mlir_c_runner_utils,%levelzero_runtime --filecheck
+// RUN: %python_executable %imex_runner --requires=sycl-runtime -i %s --pass-pipeline-file=%p/xetile-to-func-vc.pp \
+// RUN:                                        --runner imex-cpu-runner -e main \
+// RUN:                                        --entry-point-result=void \
+// RUN:                                        --shared-libs=%irunner_utils,%mlir_runner_utils,%mlir_c_runner_utils,%sycl_runtime --filecheck
+
+// NOTES :
+// Weight-only quantized GEMM, C = A * dequant(B), with f16 activations A and
+// signed int4 weights B with one f16 scale per group of 32 rows of K and per
+// column. The weights are dequantized in registers and fed to f16 dpas, so
+// only half a byte per weight is read from memory.
+//
+// B is packed two weights per byte: in each block of 64 rows of K, byte row
+// i holds row i in its low nibble and row i + 32 in its high nibble. The two
+// nibbles of a 32x32 byte tile thus unpack with shifts alone into the two
+// 32x32 weight tiles of the block, which multiply the two 16x32 A tiles of
+// the block, without any shuffle.
+
+module @gemm attributes {gpu.container_module} {
+  func.func @test(%A: memref<1024x1024xf16>, %B: memref<512x1024xi8>, %S: memref<32x1024xf16>) -> memref<1024x1024xf32> attributes {llvm.emit_c_interface} {
+    %c1 = arith.constant 1 : index
+    %c32 = arith.constant 32 : index
+    %c64 = arith.constant 64 : index
+    %A_gpu = gpu.alloc  host_shared () : memref<1024x1024xf16>
+    memref.copy %A, %A_gpu : memref<1024x1024xf16> to memref<1024x1024xf16>
+    %B_gpu = gpu.alloc  host_shared () : memref<512x1024xi8>
+    memref.copy %B, %B_gpu : memref<512x1024xi8> to memref<512x1024xi8>
+    %S_gpu = gpu.alloc  host_shared () : memref<32x1024xf16>
+    memref.copy %S, %S_gpu : memref<32x1024xf16> to memref<32x1024xf16>
+    %C_gpu = gpu.alloc  host_shared () : memref<1024x1024xf32>
+    gpu.launch_func  @test_kernel::@test_kernel blocks in (%c64, %c32, %c1) threads in (%c1, %c1, %c1) args(%A_gpu : memref<1024x1024xf16>, %B_gpu : memref<512x1024xi8>, %S_gpu : memref<32x1024xf16>, %C_gpu : memref<1024x1024xf32>)
+    gpu.dealloc  %A_gpu : memref<1024x1024xf16>
+    gpu.dealloc  %B_gpu : memref<512x1024xi8>
+    gpu.dealloc  %S_gpu : memref<32x1024xf16>
+    return %C_gpu : memref<1024x1024xf32>
+  }
+  gpu.module @test_kernel attributes {spirv.target_env = #spirv.target_env<#spirv.vce<v1.4, [Addresses, Float16Buffer, Int64, Int16, Int8, Kernel, Linkage, Vector16, GenericPointer, Groups, Float16, Float64, AtomicFloat32AddEXT, ExpectAssumeKHR, SubgroupDispatch, VectorComputeINTEL, VectorAnyINTEL], [SPV_EXT_shader_atomic_float_add, SPV_KHR_expect_assume, SPV_INTEL_vector_compute]>, api=OpenCL, #spirv.resource_limits<>>} {
+    gpu.func @test_kernel(%A: memref<1024x1024xf16>, %B: memref<512x1024xi8>, %S: memref<32x1024xf16>, %C: memref<1024x1024xf32>) kernel attributes {VectorComputeFunctionINTEL, spirv.entry_point_abi = #spirv.entry_point_abi<>} {
+      %c0 = arith.constant 0 : index
+      %c1 = arith.constant 1 : index
+      %c2 = arith.constant 2 : index
+      %c16 = arith.constant 16 : index
+      %c32 = arith.constant 32 : index
+      %c64 = arith.constant 64 : index
+      %c1024 = arith.constant 1024 : index
+      %shift = arith.constant dense<4> : vector<32x32xi8>
+      %c_init_value = arith.constant dense<0.0> : vector<16x32xf32>
+      %block_id_x = gpu.block_id x
+      %block_id_y = gpu.block_id y
+      %m = arith.muli %block_id_x, %c16 : index
+      %n = arith.muli %block_id_y, %c32 : index
+      // initalize the A tiles of both halves of a 64-row block of K, the
+      // packed B tile and the scale rows of the two groups of the block
+      %a_lo_init_tile = xetile.init_tile %A[%m, %c0] : memref<1024x1024xf16> -> !xetile.tile<16x32xf16>
+      %a_hi_init_tile = xetile.init_tile %A[%m, %c32] : memref<1024x1024xf16> -> !xetile.tile<16x32xf16>
+      %b_init_tile = xetile.init_tile %B[%c0, %n] : memref<512x1024xi8> -> !xetile.tile<32x32xi8>
+      %s_lo_init_tile = xetile.init_tile %S[%c0, %n] : memref<32x1024xf16> -> !xetile.tile<1x32xf16>
+      %s_hi_init_tile = xetile.init_tile %S[%c1, %n] : memref<32x1024xf16> -> !xetile.tile<1x32xf16>
+      %out:6 = scf.for %k = %c0 to %c1024 step %c64
+        iter_args(%a_lo_tile = %a_lo_init_tile, %a_hi_tile = %a_hi_init_tile, %b_tile = %b_init_tile,
+                  %s_lo_tile = %s_lo_init_tile, %s_hi_tile = %s_hi_init_tile, %c_value = %c_init_value)
+        -> (!xetile.tile<16x32xf16>, !xetile.tile<16x32xf16>, !xetile.tile<32x32xi8>,
+            !xetile.tile<1x32xf16>, !xetile.tile<1x32xf16>, vector<16x32xf32>) {
+        // unpack the signed nibbles: the low one is sign extended by
+        // shifting it to the top first
+        %packed = xetile.load_tile %b_tile : !xetile.tile<32x32xi8> -> vector<32x32xi8>
+        %lo_top = arith.shli %packed, %shift : vector<32x32xi8>
+        %q_lo = arith.shrsi %lo_top, %shift : vector<32x32xi8>
+        %q_hi = arith.shrsi %packed, %shift : vector<32x32xi8>
+        // dequantize with the scales of the two groups
+        %s_lo = xetile.load_tile %s_lo_tile : !xetile.tile<1x32xf16> -> vector<1x32xf16>
+        %s_hi = xetile.load_tile %s_hi_tile : !xetile.tile<1x32xf16> -> vector<1x32xf16>
+        %s_lo_b = xetile.broadcast %s_lo [0] : vector<1x32xf16> -> vector<32x32xf16>
+        %s_hi_b = xetile.broadcast %s_hi [0] : vector<1x32xf16> -> vector<32x32xf16>
+        %q_lo_f = arith.sitofp %q_lo : vector<32x32xi8> to vector<32x32xf16>
+        %q_hi_f = arith.sitofp %q_hi : vector<32x32xi8> to vector<32x32xf16>
+        %w_lo = arith.mulf %q_lo_f, %s_lo_b : vector<32x32xf16>
+        %w_hi = arith.mulf %q_hi_f, %s_hi_b : vector<32x32xf16>
+        // perform dpas and accumulate
+        %a_lo = xetile.load_tile %a_lo_tile : !xetile.tile<16x32xf16> -> vector<16x32xf16>
+        %a_hi = xetile.load_tile %a_hi_tile : !xetile.tile<16x32xf16> -> vector<16x32xf16>
+        %c_lo_value = xetile.tile_mma %a_lo, %w_lo, %c_value
+          : vector<16x32xf16>, vector<32x32xf16>, vector<16x32xf32> -> vector<16x32xf32>
+        %c_new_value = xetile.tile_mma %a_hi, %w_hi, %c_lo_value
+          : vector<16x32xf16>, vector<32x32xf16>, vector<16x32xf32> -> vector<16x32xf32>
+        // update the offsets to the next block of K
+        %a_lo_next_tile = xetile.update_tile_offset %a_lo_tile, [%c0, %c64] : !xetile.tile<16x32xf16>
+        %a_hi_next_tile = xetile.update_tile_offset %a_hi_tile, [%c0, %c64] : !xetile.tile<16x32xf16>
+        %b_next_tile = xetile.update_tile_offset %b_tile, [%c32, %c0] : !xetile.tile<32x32xi8>
+        %s_lo_next_tile = xetile.update_tile_offset %s_lo_tile, [%c2, %c0] : !xetile.tile<1x32xf16>
+        %s_hi_next_tile = xetile.update_tile_offset %s_hi_tile, [%c2, %c0] : !xetile.tile<1x32xf16>
+        scf.yield %a_lo_next_tile, %a_hi_next_tile, %b_next_tile, %s_lo_next_tile, %s_hi_next_tile, %c_new_value
+          : !xetile.tile<16x32xf16>, !xetile.tile<16x32xf16>, !xetile.tile<32x32xi8>,
+            !xetile.tile<1x32xf16>, !xetile.tile<1x32xf16>, vector<16x32xf32>
+      }
+      // store the final accumulated C tile result back to memory
+      %c_tile = xetile.init_tile %C[%m, %n] : memref<1024x1024xf32> -> !xetile.tile<16x32xf32>
+      xetile.store_tile %out#5, %c_tile : vector<16x32xf32>, !xetile.tile<16x32xf32>
+      gpu.return
+    }
+  }
+  func.func @main() attributes {llvm.emit_c_interface} {
+    %c0 = arith.constant 0 : index
+    %c1 = arith.constant 1 : index
+    %c2 = arith.constant 2 : index
+    %c4 = arith.constant 4 : index
+    %c8 = arith.constant 8 : index
+    %c16 = arith.constant 16 : index
+    %c32 = arith.constant 32 : index
+    %c64 = arith.constant 64 : index
+    %c512 = arith.constant 512 : index
+    %c1024 = arith.constant 1024 : index
+    %c0_f32 = arith.constant 0.0 : f32
+    %c8_f16 = arith.constant 8.0 : f16
+    %c64_f16 = arith.constant 64.0 : f16
+    %c4_i8 = arith.constant 4 : i8
+    %c15_i8 = arith.constant 15 : i8
+    %A = memref.alloc() : memref<1024x1024xf16>
+    %B = memref.alloc() : memref<512x1024xi8>
+    %S = memref.alloc() : memref<32x1024xf16>
+    %Q = memref.alloc() : memref<1024x1024xi8>
+    %C_ref = memref.alloc() : memref<1024x1024xf32>
+    // intialize A ; A[i, j] = ((i + 2j) % 8) / 8
+    scf.for %i = %c0 to %c1024 step %c1 {
+      scf.for %j = %c0 to %c1024 step %c1 {
+        %j2 = arith.muli %j, %c2 : index
+        %s = arith.addi %i, %j2 : index
+        %r = arith.remui %s, %c8 : index
+        %t = index.castu %r : index to i16
+        %u = arith.uitofp %t : i16 to f16
+        %val = arith.divf %u, %c8_f16 : f16
+        memref.store %val, %A[%i, %j] : memref<1024x1024xf16>
+      }
+    }
+    // intialize the int4 weights ; Q[k, j] = ((k + j) % 16) - 8
+    scf.for %k = %c0 to %c1024 step %c1 {
+      scf.for %j = %c0 to %c1024 step %c1 {
+        %s = arith.addi %k, %j : index
+        %r = arith.remui %s, %c16 : index
+        %d = arith.subi %r, %c8 : index
+        %val = index.casts %d : index to i8
+        memref.store %val, %Q[%k, %j] : memref<1024x1024xi8>
+      }
+    }
+    // intialize the scales ; S[g, j] = ((g + j) % 4 + 1) / 64
+    scf.for %g = %c0 to %c32 step %c1 {
+      scf.for %j = %c0 to %c1024 step %c1 {
+        %s = arith.addi %g, %j : index
+        %r = arith.remui %s, %c4 : index
+        %r1 = arith.addi %r, %c1 : index
+        %t = index.castu %r1 : index to i16
+        %u = arith.uitofp %t : i16 to f16
+        %val = arith.divf %u, %c64_f16 : f16
+        memref.store %val, %S[%g, %j] : memref<32x1024xf16>
+      }
+    }
+    // pack the weights ; B[32b + i, j] = Q[64b + i, j] | Q[64b + 32 + i, j] << 4
+    scf.for %p = %c0 to %c512 step %c1 {
+      scf.for %j = %c0 to %c1024 step %c1 {
+        %blk = arith.divui %p, %c32 : index
+        %i = arith.remui %p, %c32 : index
+        %blk_row = arith.muli %blk, %c64 : index
+        %k_lo = arith.addi %blk_row, %i : index
+        %k_hi = arith.addi %k_lo, %c32 : index
+        %q_lo = memref.load %Q[%k_lo, %j] : memref<1024x1024xi8>
+        %q_hi = memref.load %Q[%k_hi, %j] : memref<1024x1024xi8>
+        %lo = arith.andi %q_lo, %c15_i8 : i8
+        %hi = arith.shli %q_hi, %c4_i8 : i8
+        %val = arith.ori %lo, %hi : i8
+        memref.store %val, %B[%p, %j] : memref<512x1024xi8>
+      }
+    }
+    // compute C for reference, dequantizing in f16 as the kernel does
+    scf.for %i = %c0 to %c1024 step %c1 {
+      scf.for %j = %c0 to %c1024 step %c1 {
+        %c_val = scf.for %k = %c0 to %c1024 step %c1 iter_args(%c_partial = %c0_f32) -> f32 {
+          %a_val = memref.load %A[%i, %k] : memref<1024x1024xf16>
+          %q_val = memref.load %Q[%k, %j] : memref<1024x1024xi8>
+          %g = arith.divui %k, %c32 : index
+          %s_val = memref.load %S[%g, %j] : memref<32x1024xf16>
+          %q_f = arith.sitofp %q_val : i8 to f16
+          %w_val = arith.mulf %q_f, %s_val : f16
+          %a_ext = arith.extf %a_val : f16 to f32
+          %w_ext = arith.extf %w_val : f16 to f32
+          %t = arith.mulf %a_ext, %w_ext : f32
+          %c_sum = arith.addf %t, %c_partial : f32
+          scf.yield %c_sum : f32
+        }
+        memref.store %c_val , %C_ref[%i, %j] : memref<1024x1024xf32>
+      }
+    }
+    %2 = call @test(%A, %B, %S) : (memref<1024x1024xf16>, memref<512x1024xi8>, memref<32x1024xf16>) -> memref<1024x1024xf32>
+    %cast_C = memref.cast %2 : memref<1024x1024xf32> to memref<*xf32>
+    %cast_C_ref = memref.cast %C_ref : memref<1024x1024xf32> to memref<*xf32>
+    // call @printMemrefF32(%cast_C) : (memref<*xf32>) -> ()
+    // call @printMemrefF32(%cast_C_ref) : (memref<*xf32>) -> ()
+    // CHECK: [ALLCLOSE: TRUE]
+    call @printAllcloseF32(%cast_C, %cast_C_ref) : (memref<*xf32>, memref<*xf32>) -> ()
+    memref.dealloc %A : memref<1024x1024xf16>
+    memref.dealloc %B : memref<512x1024xi8>
+    memref.dealloc %S : memref<32x1024xf16>
+    memref.dealloc %Q : memref<1024x1024xi8>
+    memref.dealloc %C_ref : memref<1024x1024xf32>
+    return
+  }
+  func.func private @printMemrefF32(memref<*xf32>) attributes {llvm.emit_c_interface}
+  func.func private @printAllcloseF32(memref<*xf32>, memref<*xf32>) attributes {llvm.emit_c_interface}
+}
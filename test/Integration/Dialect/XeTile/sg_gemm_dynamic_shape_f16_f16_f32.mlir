@@ -0,0 +1,142 @@
+// RUN: %python_executable %imex_runner --requires=l0-runtime -i %s --pass-pipeline-file=%p/xetile-to-func-vc.pp \
+// RUN:                                       --runner imex-cpu-runner -e main \
+// RUN:                                       --entry-point-result=void \
+// RUN:                                       --shared-libs=%irunner_utils,%mlir_runner_utils,%mlir_c_runner_utils,%levelzero_runtime --filecheck
+// RUN: %python_executable %imex_runner --requires=sycl-runtime -i %s --pass-pipeline-file=%p/xetile-to-func-vc.pp \
+// RUN:                                        --runner imex-cpu-runner -e main \
+// RUN:                                        --entry-point-result=void \
+// RUN:                                        --shared-libs=%irunner_utils,%mlir_runner_utils,%mlir_c_runner_utils,%sycl_runtime --filecheck
+
+// NOTES :
+// GEMM on dynamic shapes that are not multiples of the tile sizes, here
+// 1000x1000x1000, without any padding of the inputs. The kernel reads M, N
+// and K from its memrefs and the host computes the grid from them. The tiles
+// on the M, N and K edges rely on the boundary checks of the 2D block
+// messages: loads fill the out-of-bound part of A and B with zeros, so the
+// tail of K adds nothing to C, and stores drop the out-of-bound part of C.
+
+module @gemm attributes {gpu.container_module} {
+  func.func @test(%A: memref<?x?xf16>, %B: memref<?x?xf16>) -> memref<?x?xf32> attributes {llvm.emit_c_interface} {
+    %c0 = arith.constant 0 : index
+    %c1 = arith.constant 1 : index
+    %c16 = arith.constant 16 : index
+    %c32 = arith.constant 32 : index
+    %M = memref.dim %A, %c0 : memref<?x?xf16>
+    %K = memref.dim %A, %c1 : memref<?x?xf16>
+    %N = memref.dim %B, %c1 : memref<?x?xf16>
+    %A_gpu = gpu.alloc  host_shared (%M, %K) : memref<?x?xf16>
+    memref.copy %A, %A_gpu : memref<?x?xf16> to memref<?x?xf16>
+    %B_gpu = gpu.alloc  host_shared (%K, %N) : memref<?x?xf16>
+    memref.copy %B, %B_gpu : memref<?x?xf16> to memref<?x?xf16>
+    %C_gpu = gpu.alloc  host_shared (%M, %N) : memref<?x?xf32>
+    // one 16x32 tile of C per workgroup, the last ones partially in bounds
+    %grid_x = arith.ceildivui %M, %c16 : index
+    %grid_y = arith.ceildivui %N, %c32 : index
+    gpu.launch_func  @test_kernel::@test_kernel blocks in (%grid_x, %grid_y, %c1) threads in (%c1, %c1, %c1) args(%A_gpu : memref<?x?xf16>, %B_gpu : memref<?x?xf16>, %C_gpu : memref<?x?xf32>)
+    gpu.dealloc  %A_gpu : memref<?x?xf16>
+    gpu.dealloc  %B_gpu : memref<?x?xf16>
+    return %C_gpu : memref<?x?xf32>
+  }
+  gpu.module @test_kernel attributes {spirv.target_env = #spirv.target_env<#spirv.vce<v1.4, [Addresses, Float16Buffer, Int64, Int16, Int8, Kernel, Linkage, Vector16, GenericPointer, Groups, Float16, Float64, AtomicFloat32AddEXT, ExpectAssumeKHR, SubgroupDispatch, VectorComputeINTEL, VectorAnyINTEL], [SPV_EXT_shader_atomic_float_add, SPV_KHR_expect_assume, SPV_INTEL_vector_compute]>, api=OpenCL, #spirv.resource_limits<>>} {
+    gpu.func @test_kernel(%A: memref<?x?xf16>, %B: memref<?x?xf16>, %C: memref<?x?xf32>) kernel attributes {VectorComputeFunctionINTEL, spirv.entry_point_abi = #spirv.entry_point_abi<>} {
+      %c0 = arith.constant 0 : index
+      %c1 = arith.constant 1 : index
+      %c16 = arith.constant 16 : index
+      %c32 = arith.constant 32 : index
+      %c_init_value = arith.constant dense<0.0> : vector<16x32xf32>
+      %M = memref.dim %A, %c0 : memref<?x?xf16>
+      %K = memref.dim %A, %c1 : memref<?x?xf16>
+      %N = memref.dim %B, %c1 : memref<?x?xf16>
+      %block_id_x = gpu.block_id x
+      %block_id_y = gpu.block_id y
+      %m = arith.muli %block_id_x, %c16 : index
+      %n = arith.muli %block_id_y, %c32 : index
+      // initalize A and B tiles
+      %a_init_tile = xetile.init_tile %A[%m, %c0], [%M, %K], [%K, %c1] : memref<?x?xf16> -> !xetile.tile<16x32xf16>
+      %b_init_tile = xetile.init_tile %B[%c0, %n], [%K, %N], [%N, %c1] : memref<?x?xf16> -> !xetile.tile<32x32xf16>
+      // compute the value of C tile by iterating over tiles in k-dimension
+      // and doing dpas, the last iteration reads past K
+      %out:3 = scf.for %k = %c0 to %K step %c32
+        iter_args(%a_tile = %a_init_tile, %b_tile = %b_init_tile, %c_value = %c_init_value)
+        -> (!xetile.tile<16x32xf16>, !xetile.tile<32x32xf16>, vector<16x32xf32>) {
+
+        // load A and B tiles
+        %a_value = xetile.load_tile %a_tile  : !xetile.tile<16x32xf16> -> vector<16x32xf16>
+        %b_value = xetile.load_tile %b_tile  : !xetile.tile<32x32xf16> -> vector<32x32xf16>
+        // perform dpas and accumulate
+        %c_new_value = xetile.tile_mma %a_value, %b_value, %c_value
+          : vector<16x32xf16>, vector<32x32xf16>, vector<16x32xf32> -> vector<16x32xf32>
+        // update the offsets for A and B tiles
+        %a_next_tile = xetile.update_tile_offset %a_tile, [%c0, %c32]
+          : !xetile.tile<16x32xf16>
+        %b_next_tile = xetile.update_tile_offset %b_tile, [%c32, %c0]
+          :  !xetile.tile<32x32xf16>
+        // partial C tile result
+        scf.yield %a_next_tile, %b_next_tile, %c_new_value
+          : !xetile.tile<16x32xf16>, !xetile.tile<32x32xf16>, vector<16x32xf32>
+      }
+      // store the final accumulated C tile result back to memory
+      %c_tile = xetile.init_tile %C[%m, %n], [%M, %N], [%N, %c1] : memref<?x?xf32> -> !xetile.tile<16x32xf32>
+      xetile.store_tile %out#2, %c_tile: vector<16x32xf32>, !xetile.tile<16x32xf32>
+      gpu.return
+    }
+  }
+  func.func @main() attributes {llvm.emit_c_interface} {
+    %c0 = arith.constant 0 : index
+    %c1 = arith.constant 1 : index
+    %c4 = arith.constant 4 : index
+    %c8 = arith.constant 8 : index
+    %c1000 = arith.constant 1000 : index
+    %c0_f32 = arith.constant 0.0 : f32
+    %c4_f16 = arith.constant 4.0 : f16
+    %c8_f16 = arith.constant 8.0 : f16
+    %A = memref.alloc(%c1000, %c1000) : memref<?x?xf16>
+    %B = memref.alloc(%c1000, %c1000) : memref<?x?xf16>
+    %C_ref = memref.alloc(%c1000, %c1000) : memref<?x?xf32>
+    // intialize A and B ; A[i, j] = ((i + j) % 8) / 8, B[i, j] = ((i + 2j) % 4) / 4
+    scf.for %i = %c0 to %c1000 step %c1 {
+      scf.for %j = %c0 to %c1000 step %c1 {
+        %ij = arith.addi %i, %j : index
+        %a_r = arith.remui %ij, %c8 : index
+        %a_t = index.castu %a_r : index to i16
+        %a_u = arith.uitofp %a_t : i16 to f16
+        %a_val = arith.divf %a_u, %c8_f16 : f16
+        memref.store %a_val, %A[%i, %j] : memref<?x?xf16>
+        %ij2 = arith.addi %ij, %j : index
+        %b_r = arith.remui %ij2, %c4 : index
+        %b_t = index.castu %b_r : index to i16
+        %b_u = arith.uitofp %b_t : i16 to f16
+        %b_val = arith.divf %b_u, %c4_f16 : f16
+        memref.store %b_val, %B[%i, %j] : memref<?x?xf16>
+      }
+    }
+    // compute C for reference
+    scf.for %i = %c0 to %c1000 step %c1 {
+      scf.for %j = %c0 to %c1000 step %c1 {
+        %c_val = scf.for %k = %c0 to %c1000 step %c1 iter_args(%c_partial = %c0_f32) -> f32 {
+          %a_val = memref.load %A[%i, %k] : memref<?x?xf16>
+          %b_val = memref.load %B[%k, %j] : memref<?x?xf16>
+          %a_ext = arith.extf %a_val : f16 to f32
+          %b_ext = arith.extf %b_val : f16 to f32
+          %t = arith.mulf %a_ext, %b_ext : f32
+          %c_sum = arith.addf %t, %c_partial : f32
+          scf.yield %c_sum : f32
+        }
+        memref.store %c_val , %C_ref[%i, %j] : memref<?x?xf32>
+      }
+    }
+    %2 = call @test(%A, %B) : (memref<?x?xf16>, memref<?x?xf16>) -> memref<?x?xf32>
+    %cast_C = memref.cast %2 : memref<?x?xf32> to memref<*xf32>
+    %cast_C_ref = memref.cast %C_ref : memref<?x?xf32> to memref<*xf32>
+    // call @printMemrefF32(%cast_C) : (memref<*xf32>) -> ()
+    // call @printMemrefF32(%cast_C_ref) : (memref<*xf32>) -> ()
+    // CHECK: [ALLCLOSE: TRUE]
+    call @printAllcloseF32(%cast_C, %cast_C_ref) : (memref<*xf32>, memref<*xf32>) -> ()
+    memref.dealloc %A : memref<?x?xf16>
+    memref.dealloc %B : memref<?x?xf16>
+    memref.dealloc %C_ref : memref<?x?xf32>
+    return
+  }
+  func.func private @printMemrefF32(memref<*xf32>) attributes {llvm.emit_c_interface}
+  func.func private @printAllcloseF32(memref<*xf32>, memref<*xf32>) attributes {llvm.emit_c_interface}
+}
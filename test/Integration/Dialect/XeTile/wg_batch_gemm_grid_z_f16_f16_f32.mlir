@@ -0,0 +1,157 @@
+// RUN: %python_executable %imex_runner --requires=l0-runtime -i %s --pass-pipeline-file=%p/xetile-wg-to-func-vc.pp \
+// RUN:                                       --runner imex-cpu-runner -e main \
+// RUN:                                       --entry-point-result=void \
+// RUN:                                       --shared-libs=%irunner_utils,%mlir_runner_utils,%mlir_c_runner_utils,%levelzero_runtime --filecheck
+// RUN: %python_executable %imex_runner --requires=sycl-runtime -i %s --pass-pipeline-file=%p/xetile-wg-to-func-vc.pp \
+// RUN:                                        --runner imex-cpu-runner -e main \
+// RUN:                                        --entry-point-result=void \
+// RUN:                                        --shared-libs=%irunner_utils,%mlir_runner_utils,%mlir_c_runner_utils,%sycl_runtime --filecheck
+
+// NOTES :
+// Batched GEMM, e.g. the per-head projections of a multi-head attention,
+// done in a single launch: the batch dimension is mapped to the z dimension
+// of the grid and used as the leading offset of init_tile on the 3-D memrefs,
+// while x and y walk the 128x128 workgroup tiles of each 256x256 output.
+
+#wg_map_a = #xetile.wg_map<sg_layout = [4, 4], sg_data = [32, 128]>
+#tile_attr_a = #xetile.tile_attr<wg_map = #wg_map_a>
+
+#wg_map_b = #xetile.wg_map<sg_layout = [4, 4], sg_data = [128, 32]>
+#tile_attr_b = #xetile.tile_attr<wg_map = #wg_map_b>
+
+#wg_map_c = #xetile.wg_map<sg_layout = [4, 4], sg_data = [32, 32]>
+#tile_attr_c = #xetile.tile_attr<wg_map = #wg_map_c>
+
+module @gemm attributes {gpu.container_module} {
+  func.func @test(%A: memref<12x256x256xf16>, %B: memref<12x256x256xf16>) -> memref<12x256x256xf32> attributes {llvm.emit_c_interface} {
+    %c1 = arith.constant 1 : index
+    %c2 = arith.constant 2 : index
+    %c4 = arith.constant 4 : index
+    %c12 = arith.constant 12 : index
+    %A_gpu = gpu.alloc  host_shared () : memref<12x256x256xf16>
+    memref.copy %A, %A_gpu : memref<12x256x256xf16> to memref<12x256x256xf16>
+    %B_gpu = gpu.alloc  host_shared () : memref<12x256x256xf16>
+    memref.copy %B, %B_gpu : memref<12x256x256xf16> to memref<12x256x256xf16>
+    %C_gpu = gpu.alloc  host_shared () : memref<12x256x256xf32>
+    gpu.launch_func  @test_kernel::@test_kernel blocks in (%c2, %c2, %c12) threads in (%c4, %c4, %c1) args(%A_gpu : memref<12x256x256xf16>, %B_gpu : memref<12x256x256xf16>, %C_gpu : memref<12x256x256xf32>)
+    gpu.dealloc  %A_gpu : memref<12x256x256xf16>
+    gpu.dealloc  %B_gpu : memref<12x256x256xf16>
+    return %C_gpu : memref<12x256x256xf32>
+  }
+  gpu.module @test_kernel attributes {spirv.target_env = #spirv.target_env<#spirv.vce<v1.4, [Addresses, Float16Buffer, Int64, Int16, Int8, Kernel, Linkage, Vector16, GenericPointer, Groups, Float16, Float64, AtomicFloat32AddEXT, ExpectAssumeKHR, SubgroupDispatch, VectorComputeINTEL, VectorAnyINTEL], [SPV_EXT_shader_atomic_float_add, SPV_KHR_expect_assume, SPV_INTEL_vector_compute]>, api=OpenCL, #spirv.resource_limits<>>} {
+    gpu.func @test_kernel(%A: memref<12x256x256xf16>, %B: memref<12x256x256xf16>, %C: memref<12x256x256xf32>) kernel attributes {VectorComputeFunctionINTEL, spirv.entry_point_abi = #spirv.entry_point_abi<>} {
+        %c0 = arith.constant 0 : index
+        %c128 = arith.constant 128 : index
+        %c256 = arith.constant 256 : index
+        %c_init_value = arith.constant {map = #wg_map_c} dense<0.0> : vector<128x128xf32>
+
+        %block_id_x = gpu.block_id x
+        %block_id_y = gpu.block_id y
+        %batch = gpu.block_id z
+        %m = arith.muli %block_id_x, %c128 : index
+        %n = arith.muli %block_id_y, %c128 : index
+
+        %a_init_tile = xetile.init_tile %A[%batch, %m, %c0] : memref<12x256x256xf16>
+          -> !xetile.tile<128x128xf16, #tile_attr_a>
+
+        %b_init_tile = xetile.init_tile %B[%batch, %c0, %n] : memref<12x256x256xf16>
+          -> !xetile.tile<128x128xf16, #tile_attr_b>
+
+        // compute the value of C tile by iterating over tiles in k-dimension and doing dpas
+        %out:3 = scf.for %k = %c0 to %c256 step %c128
+          iter_args(%a_tile = %a_init_tile, %b_tile = %b_init_tile, %c_value = %c_init_value)
+          -> (!xetile.tile<128x128xf16, #tile_attr_a>,
+              !xetile.tile<128x128xf16, #tile_attr_b>,
+              vector<128x128xf32>) {
+
+          // load A and B tiles
+          %a_value = xetile.load_tile %a_tile  : !xetile.tile<128x128xf16, #tile_attr_a>
+            -> vector<128x128xf16>
+
+          %b_value = xetile.load_tile %b_tile : !xetile.tile<128x128xf16, #tile_attr_b>
+            -> vector<128x128xf16>
+
+          // perform dpas and accumulate
+          %c_new_value = xetile.tile_mma %a_value, %b_value, %c_value {wg_map_a = #wg_map_a, wg_map_b = #wg_map_b, wg_map_c = #wg_map_c}
+            : vector<128x128xf16>, vector<128x128xf16>, vector<128x128xf32> -> vector<128x128xf32>
+
+          // update the offsets for A and B tiles
+          %a_next_tile = xetile.update_tile_offset %a_tile, [%c0, %c128] : !xetile.tile<128x128xf16, #tile_attr_a>
+          %b_next_tile = xetile.update_tile_offset %b_tile, [%c128, %c0] : !xetile.tile<128x128xf16, #tile_attr_b>
+          // partial C tile result
+          scf.yield %a_next_tile, %b_next_tile, %c_new_value
+            : !xetile.tile<128x128xf16, #tile_attr_a>,
+            !xetile.tile<128x128xf16, #tile_attr_b>, vector<128x128xf32>
+        }
+        // store the final accumulated C tile result back to memory
+        %c_tile = xetile.init_tile %C[%batch, %m, %n] : memref<12x256x256xf32>
+          -> !xetile.tile<128x128xf32, #tile_attr_c>
+        xetile.store_tile %out#2, %c_tile : vector<128x128xf32>,
+          !xetile.tile<128x128xf32, #tile_attr_c>
+        gpu.return
+    }
+    }
+  func.func @main() attributes {llvm.emit_c_interface} {
+    %c0 = arith.constant 0 : index
+    %c1 = arith.constant 1 : index
+    %c4 = arith.constant 4 : index
+    %c8 = arith.constant 8 : index
+    %c12 = arith.constant 12 : index
+    %c256 = arith.constant 256 : index
+    %c0_f32 = arith.constant 0.0 : f32
+    %c4_f16 = arith.constant 4.0 : f16
+    %c8_f16 = arith.constant 8.0 : f16
+    %A = memref.alloc() : memref<12x256x256xf16>
+    %B = memref.alloc() : memref<12x256x256xf16>
+    %C_ref = memref.alloc() : memref<12x256x256xf32>
+    // intialize A and B, different for every batch;
+    // A[h, i, j] = ((h + i + j) % 8) / 8, B[h, i, j] = ((h + i + 2j) % 4) / 4
+    scf.for %h = %c0 to %c12 step %c1 {
+      scf.for %i = %c0 to %c256 step %c1 {
+        scf.for %j = %c0 to %c256 step %c1 {
+          %hi = arith.addi %h, %i : index
+          %hij = arith.addi %hi, %j : index
+          %a_r = arith.remui %hij, %c8 : index
+          %a_t = index.castu %a_r : index to i16
+          %a_u = arith.uitofp %a_t : i16 to f16
+          %a_val = arith.divf %a_u, %c8_f16 : f16
+          memref.store %a_val, %A[%h, %i, %j] : memref<12x256x256xf16>
+          %hij2 = arith.addi %hij, %j : index
+          %b_r = arith.remui %hij2, %c4 : index
+          %b_t = index.castu %b_r : index to i16
+          %b_u = arith.uitofp %b_t : i16 to f16
+          %b_val = arith.divf %b_u, %c4_f16 : f16
+          memref.store %b_val, %B[%h, %i, %j] : memref<12x256x256xf16>
+        }
+      }
+    }
+    // compute C for reference
+    scf.for %h = %c0 to %c12 step %c1 {
+      scf.for %i = %c0 to %c256 step %c1 {
+        scf.for %j = %c0 to %c256 step %c1 {
+          %c_val = scf.for %k = %c0 to %c256 step %c1 iter_args(%c_partial = %c0_f32) -> f32 {
+            %a_val = memref.load %A[%h, %i, %k] : memref<12x256x256xf16>
+            %b_val = memref.load %B[%h, %k, %j] : memref<12x256x256xf16>
+            %a_ext = arith.extf %a_val : f16 to f32
+            %b_ext = arith.extf %b_val : f16 to f32
+            %t = arith.mulf %a_ext, %b_ext : f32
+            %c_sum = arith.addf %t, %c_partial : f32
+            scf.yield %c_sum : f32
+          }
+          memref.store %c_val, %C_ref[%h, %i, %j] : memref<12x256x256xf32>
+        }
+      }
+    }
+    %2 = call @test(%A, %B) : (memref<12x256x256xf16>, memref<12x256x256xf16>) -> memref<12x256x256xf32>
+    %cast_C = memref.cast %2 : memref<12x256x256xf32> to memref<*xf32>
+    %cast_C_ref = memref.cast %C_ref : memref<12x256x256xf32> to memref<*xf32>
+    // CHECK: [ALLCLOSE: TRUE]
+    call @printAllcloseF32(%cast_C, %cast_C_ref) : (memref<*xf32>, memref<*xf32>) -> ()
+    memref.dealloc %A : memref<12x256x256xf16>
+    memref.dealloc %B : memref<12x256x256xf16>
+    memref.dealloc %C_ref : memref<12x256x256xf32>
+    return
+  }
+  func.func private @printMemrefF32(memref<*xf32>) attributes {llvm.emit_c_interface}
+  func.func private @printAllcloseF32(memref<*xf32>, memref<*xf32>) attributes {llvm.emit_c_interface}
+}
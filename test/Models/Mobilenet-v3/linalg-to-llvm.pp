@@ -29,6 +29,7 @@ builtin.module(convert-tensor-to-linalg
     func.func(llvm-request-c-wrappers)
     serialize-spirv
     convert-gpu-to-gpux
+    func.func(insert-gpux-memory-hints)
     convert-func-to-llvm
     convert-math-to-llvm
     convert-gpux-to-llvm
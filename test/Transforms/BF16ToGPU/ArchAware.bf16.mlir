@@ -0,0 +1,46 @@
+// RUN: imex-opt %s --bf16-to-gpu="device=pvc" | FileCheck %s
+
+module @bf16_arch_aware {
+  // PVC converts between bf16 and f32 in hardware, selects work on the bits.
+  gpu.module @native_kernel {
+    // CHECK-LABEL: gpu.func @native_kernel
+    gpu.func @native_kernel(%arg0: memref<16xbf16>, %arg1: memref<16xbf16>, %arg2: memref<16xi1>, %arg3: memref<16xf32>) kernel {
+      %c0 = arith.constant 0 : index
+      // CHECK: %[[A:.*]] = vector.load %arg0[%c0] : memref<16xi16>, vector<16xi16>
+      // CHECK: %[[B:.*]] = vector.load %arg1[%c0] : memref<16xi16>, vector<16xi16>
+      // CHECK: %[[SEL:.*]] = arith.select %{{.*}}, %[[A]], %[[B]] : vector<16xi1>, vector<16xi16>
+      // CHECK: %[[BCAST:.*]] = arith.bitcast %[[SEL]] : vector<16xi16> to vector<16xbf16>
+      // CHECK: arith.extf %[[BCAST]] : vector<16xbf16> to vector<16xf32>
+      %a = vector.load %arg0[%c0] : memref<16xbf16>, vector<16xbf16>
+      %b = vector.load %arg1[%c0] : memref<16xbf16>, vector<16xbf16>
+      %m = vector.load %arg2[%c0] : memref<16xi1>, vector<16xi1>
+      %s = arith.select %m, %a, %b : vector<16xi1>, vector<16xbf16>
+      %e = arith.extf %s : vector<16xbf16> to vector<16xf32>
+      vector.store %e, %arg3[%c0] : memref<16xf32>, vector<16xf32>
+      gpu.return
+    }
+  }
+
+  // Without SPV_INTEL_bfloat16_conversion, conversions are emulated.
+  gpu.module @emulated_kernel attributes {spirv.target_env = #spirv.target_env<#spirv.vce<v1.0, [Addresses, Int16, Int64, Kernel], []>, api=OpenCL, #spirv.resource_limits<>>} {
+    // CHECK-LABEL: gpu.func @emulated_kernel
+    gpu.func @emulated_kernel(%arg0: memref<16xbf16>, %arg1: memref<16xbf16>) kernel {
+      %c0 = arith.constant 0 : index
+      // CHECK: %[[A:.*]] = vector.load %arg0[%c0] : memref<16xi16>, vector<16xi16>
+      // CHECK: %[[EXT:.*]] = arith.extui %[[A]] : vector<16xi16> to vector<16xi32>
+      // CHECK: %[[SHL:.*]] = arith.shli %[[EXT]], %{{.*}} : vector<16xi32>
+      // CHECK: %[[F:.*]] = arith.bitcast %[[SHL]] : vector<16xi32> to vector<16xf32>
+      // CHECK: %[[ADD:.*]] = arith.addf %[[F]], %{{.*}} : vector<16xf32>
+      // CHECK: %[[BITS:.*]] = arith.bitcast %[[ADD]] : vector<16xf32> to vector<16xi32>
+      // CHECK: arith.cmpf uno, %[[ADD]], %[[ADD]] : vector<16xf32>
+      // CHECK: %[[RES:.*]] = arith.trunci %{{.*}} : vector<16xi32> to vector<16xi16>
+      // CHECK: vector.store %[[RES]], %arg1[%c0] : memref<16xi16>, vector<16xi16>
+      // CHECK-NOT: arith.extf
+      // CHECK-NOT: arith.truncf
+      %a = vector.load %arg0[%c0] : memref<16xbf16>, vector<16xbf16>
+      %s = arith.addf %a, %a : vector<16xbf16>
+      vector.store %s, %arg1[%c0] : memref<16xbf16>, vector<16xbf16>
+      gpu.return
+    }
+  }
+}
@@ -0,0 +1,34 @@
+// RUN: imex-opt %s --bf16-to-gpu="device=pvc remarks=-" -verify-diagnostics -o /dev/null
+
+module @bf16_remarks {
+  // Selects work on the bits and conversions are native, nothing is reported.
+  gpu.module @native_kernel {
+    gpu.func @native_kernel(%arg0: memref<16xbf16>, %arg1: memref<16xbf16>, %arg2: memref<16xi1>, %arg3: memref<16xf32>) kernel {
+      %c0 = arith.constant 0 : index
+      %a = vector.load %arg0[%c0] : memref<16xbf16>, vector<16xbf16>
+      %b = vector.load %arg1[%c0] : memref<16xbf16>, vector<16xbf16>
+      %m = vector.load %arg2[%c0] : memref<16xi1>, vector<16xi1>
+      %s = arith.select %m, %a, %b : vector<16xi1>, vector<16xbf16>
+      %e = arith.extf %s : vector<16xbf16> to vector<16xf32>
+      vector.store %e, %arg3[%c0] : memref<16xf32>, vector<16xf32>
+      gpu.return
+    }
+  }
+
+  // The add is computed in f32, and without SPV_INTEL_bfloat16_conversion
+  // the extensions of its operands and the truncation of its result are
+  // emulated.
+  gpu.module @emulated_kernel attributes {spirv.target_env = #spirv.target_env<#spirv.vce<v1.0, [Addresses, Int16, Int64, Kernel], []>, api=OpenCL, #spirv.resource_limits<>>} {
+    gpu.func @emulated_kernel(%arg0: memref<16xbf16>, %arg1: memref<16xbf16>) kernel {
+      %c0 = arith.constant 0 : index
+      %a = vector.load %arg0[%c0] : memref<16xbf16>, vector<16xbf16>
+      // expected-remark@+4 {{EmulatedBF16: bf16 compute emulated in f32}}
+      // expected-remark@+3 {{EmulatedBF16Conversion: no native bf16 conversion, emulated with integer ops}}
+      // expected-remark@+2 {{EmulatedBF16Conversion: no native bf16 conversion, emulated with integer ops}}
+      // expected-remark@+1 {{EmulatedBF16Conversion: no native bf16 conversion, emulated with integer ops}}
+      %s = arith.addf %a, %a : vector<16xbf16>
+      vector.store %s, %arg1[%c0] : memref<16xbf16>, vector<16xbf16>
+      gpu.return
+    }
+  }
+}
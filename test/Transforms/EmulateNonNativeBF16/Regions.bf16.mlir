@@ -0,0 +1,39 @@
+// RUN: imex-opt %s --imex-emulate-non-native-bf16="emulate-regions=true" | FileCheck %s
+
+module @bf16_regions {
+  gpu.module @test_kernel attributes {} {
+    // The chain of exp, mulf and sqrt is computed in f32 and only truncated
+    // before the store.
+    // CHECK-LABEL: gpu.func @test_kernel
+    gpu.func @test_kernel(%arg0: memref<16xbf16>, %arg1: memref<16xbf16>) kernel attributes {} {
+      %c0 = arith.constant 0 : index
+      %cst = arith.constant dense<2.000000e+00> : vector<16xbf16>
+      // CHECK: %[[LOAD:.*]] = vector.load %arg0[%{{.*}}] : memref<16xbf16>, vector<16xbf16>
+      // CHECK: %[[EXT:.*]] = arith.extf %[[LOAD]] : vector<16xbf16> to vector<16xf32>
+      // CHECK: %[[EXP:.*]] = math.exp %[[EXT]] : vector<16xf32>
+      // CHECK: %[[CST:.*]] = arith.extf %{{.*}} : vector<16xbf16> to vector<16xf32>
+      // CHECK: %[[MUL:.*]] = arith.mulf %[[EXP]], %[[CST]] : vector<16xf32>
+      // CHECK-NOT: arith.truncf
+      // CHECK: %[[SQRT:.*]] = math.sqrt %[[MUL]] : vector<16xf32>
+      // CHECK: %[[TRUNC:.*]] = arith.truncf %[[SQRT]] : vector<16xf32> to vector<16xbf16>
+      // CHECK: vector.store %[[TRUNC]], %arg1[%{{.*}}] : memref<16xbf16>, vector<16xbf16>
+      %0 = vector.load %arg0[%c0] : memref<16xbf16>, vector<16xbf16>
+      %1 = math.exp %0 : vector<16xbf16>
+      %2 = arith.mulf %1, %cst : vector<16xbf16>
+      %3 = math.sqrt %2 : vector<16xbf16>
+      vector.store %3, %arg1[%c0] : memref<16xbf16>, vector<16xbf16>
+      gpu.return
+    }
+
+    // Natively supported ops of loaded values are kept in bf16.
+    // CHECK-LABEL: gpu.func @test_native
+    // CHECK: arith.addf %{{.*}}, %{{.*}} : vector<16xbf16>
+    gpu.func @test_native(%arg0: memref<16xbf16>, %arg1: memref<16xbf16>) kernel attributes {} {
+      %c0 = arith.constant 0 : index
+      %0 = vector.load %arg0[%c0] : memref<16xbf16>, vector<16xbf16>
+      %1 = arith.addf %0, %0 : vector<16xbf16>
+      vector.store %1, %arg1[%c0] : memref<16xbf16>, vector<16xbf16>
+      gpu.return
+    }
+  }
+}
@@ -0,0 +1,16 @@
+// RUN: imex-opt %s --imex-emulate-non-native-bf16="remarks=-" -verify-diagnostics -o /dev/null
+
+module @bf16_remarks {
+  gpu.module @test_kernel {
+    gpu.func @test_kernel(%arg0: memref<16xbf16>) kernel {
+      %c0 = arith.constant 0 : index
+      %a = vector.load %arg0[%c0] : memref<16xbf16>, vector<16xbf16>
+      // The add is native and not reported.
+      %b = arith.addf %a, %a : vector<16xbf16>
+      // expected-remark@+1 {{EmulatedBF16: bf16 compute emulated in f32}}
+      %c = math.exp %b : vector<16xbf16>
+      vector.store %c, %arg0[%c0] : memref<16xbf16>, vector<16xbf16>
+      gpu.return
+    }
+  }
+}
@@ -0,0 +1,27 @@
+// RUN: imex-opt --insert-gpu-allocs='client-api=opencl' %s | FileCheck %s
+
+// Buffers already allocated with gpu.alloc, e.g. by the copies of
+// convert-ndarray-to-linalg, are used as they are and released by gpu.dealloc.
+func.func @main(%arg0: memref<8xf32>) {
+  %c8 = arith.constant 8 : index
+  %c1 = arith.constant 1 : index
+  %t0 = gpu.wait async
+  %0, %t1 = gpu.alloc async [%t0] host_shared () : memref<8xf32>
+  %t2 = gpu.memcpy async [%t1] %0, %arg0 : memref<8xf32>, memref<8xf32>
+  gpu.wait [%t2]
+  // CHECK: %[[MEMREF:.*]], %{{.*}} = gpu.alloc async
+  // CHECK-NOT: gpu.alloc
+  // CHECK: gpu.launch
+  gpu.launch blocks(%arg1, %arg2, %arg3) in (%arg7 = %c8, %arg8 = %c1, %arg9 = %c1) threads(%arg4, %arg5, %arg6) in (%arg10 = %c1, %arg11 = %c1, %arg12 = %c1) {
+    %1 = gpu.block_id  x
+    // CHECK: memref.load %[[MEMREF]]
+    %2 = memref.load %0[%1] : memref<8xf32>
+    %3 = arith.addf %2, %2 : f32
+    memref.store %3, %0[%1] : memref<8xf32>
+    gpu.terminator
+  }
+  // CHECK: gpu.dealloc %[[MEMREF]]
+  // CHECK-NOT: memref.dealloc
+  memref.dealloc %0 : memref<8xf32>
+  return
+}
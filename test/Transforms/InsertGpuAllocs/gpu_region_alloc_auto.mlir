@@ -0,0 +1,26 @@
+// RUN: imex-opt --insert-gpu-allocs='in-regions=1 auto-host-shared=1' %s | FileCheck %s
+
+// %1 is only used in GPU regions and gets device memory, while %3 is read by
+// the host and gets shared memory.
+func.func @test_region_alloc_auto() -> f32 {
+  %c0 = arith.constant 0 : index
+  %1 = region.env_region #region.gpu_env<device = "XeGPU"> -> memref<2x5xf32> {
+    %2 = memref.alloc() {alignment = 128 : i64} : memref<2x5xf32>
+    region.env_region_yield %2 : memref<2x5xf32>
+  }
+  %3 = region.env_region #region.gpu_env<device = "XeGPU"> -> memref<2x5xf32> {
+    %4 = memref.alloc() {alignment = 128 : i64} : memref<2x5xf32>
+    memref.copy %1, %4 : memref<2x5xf32> to memref<2x5xf32>
+    region.env_region_yield %4 : memref<2x5xf32>
+  }
+  %5 = memref.load %3[%c0, %c0] : memref<2x5xf32>
+  region.env_region #region.gpu_env<device = "XeGPU"> {
+    memref.dealloc %1 : memref<2x5xf32>
+    memref.dealloc %3 : memref<2x5xf32>
+    region.env_region_yield
+  }
+  return %5 : f32
+}
+// CHECK-LABEL: func.func @test_region_alloc_auto
+// CHECK: gpu.alloc () : memref<2x5xf32>
+// CHECK: gpu.alloc host_shared () : memref<2x5xf32>
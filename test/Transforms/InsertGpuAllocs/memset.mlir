@@ -0,0 +1,16 @@
+// RUN: imex-opt --insert-gpu-allocs='client-api=opencl' %s | FileCheck %s
+
+// A memset writes its buffer on the device.
+// CHECK-LABEL: func.func @memset
+func.func @memset(%arg0: memref<8xf32>) -> memref<8xf32> {
+  %cst = arith.constant 1.0 : f32
+  // CHECK: %[[ARG:.*]] = gpu.alloc host_shared () : memref<8xf32>
+  // CHECK: %[[BUF:.*]] = gpu.alloc host_shared () : memref<8xf32>
+  %0 = memref.alloc() : memref<8xf32>
+  // CHECK: gpu.memset %[[ARG]], %{{.*}} : memref<8xf32>, f32
+  gpu.memset %arg0, %cst : memref<8xf32>, f32
+  // CHECK: gpu.memset %[[BUF]], %{{.*}} : memref<8xf32>, f32
+  gpu.memset %0, %cst : memref<8xf32>, f32
+  // CHECK: memref.copy %[[ARG]], %arg0 : memref<8xf32> to memref<8xf32>
+  return %0 : memref<8xf32>
+}
@@ -0,0 +1,51 @@
+// RUN: imex-opt --insert-gpu-allocs='client-api=opencl upload-constants=1' %s | FileCheck %s
+
+module {
+  memref.global "private" constant @weights : memref<4xf32> = dense_resource<weights_blob>
+  memref.global "private" constant @bias : memref<4xf32> = dense<1.000000e+00>
+  memref.global "private" @state : memref<4xf32> = dense<0.000000e+00>
+
+  // CHECK-LABEL: func.func @predict
+  func.func @predict(%out: memref<4xf32>) {
+    %c1 = arith.constant 1 : index
+    %c4 = arith.constant 4 : index
+    // CHECK: memref.get_global @weights
+    // CHECK-NEXT: %[[WEIGHTS:.*]] = gpu.alloc () {imex.constant_data = @weights} : memref<4xf32>
+    // CHECK-NOT: memref.copy
+    %0 = memref.get_global @weights : memref<4xf32>
+    // Read on the host as well, so it is copied.
+    // CHECK: %[[BIAS_HOST:.*]] = memref.get_global @bias
+    // CHECK-NEXT: %[[BIAS:.*]] = gpu.alloc host_shared () : memref<4xf32>
+    // CHECK-NEXT: memref.copy %[[BIAS_HOST]], %[[BIAS]]
+    %1 = memref.get_global @bias : memref<4xf32>
+    // Not constant.
+    // CHECK: %[[STATE_HOST:.*]] = memref.get_global @state
+    // CHECK-NEXT: %[[STATE:.*]] = gpu.alloc host_shared () : memref<4xf32>
+    // CHECK-NEXT: memref.copy %[[STATE_HOST]], %[[STATE]]
+    %2 = memref.get_global @state : memref<4xf32>
+    %b = memref.load %1[%c1] : memref<4xf32>
+    gpu.launch blocks(%bx, %by, %bz) in (%gx = %c4, %gy = %c1, %gz = %c1) threads(%tx, %ty, %tz) in (%sx = %c1, %sy = %c1, %sz = %c1) {
+      // CHECK: memref.load %[[WEIGHTS]]
+      %w = memref.load %0[%bx] : memref<4xf32>
+      // CHECK: memref.load %[[BIAS]]
+      %v = memref.load %1[%bx] : memref<4xf32>
+      // CHECK: memref.load %[[STATE]]
+      %s = memref.load %2[%bx] : memref<4xf32>
+      %t = arith.addf %w, %v : f32
+      %u = arith.addf %t, %s : f32
+      memref.store %u, %out[%bx] : memref<4xf32>
+      gpu.terminator
+    }
+    // CHECK-NOT: gpu.dealloc %[[WEIGHTS]]
+    // CHECK: return
+    return
+  }
+}
+
+{-#
+  dialect_resources: {
+    builtin: {
+      weights_blob: "0x040000000000803F000000400000404000008040"
+    }
+  }
+#-}
@@ -0,0 +1,26 @@
+// RUN: imex-opt --insert-gpu-allocs='client-api=opencl' %s | FileCheck %s
+
+// Allocations in kernels are workgroup memory and are not moved to the
+// device heap.
+// CHECK-LABEL: func.func @transpose
+func.func @transpose(%arg0: memref<32x32xf32>) -> memref<32x32xf32> {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %c32 = arith.constant 32 : index
+  // CHECK: %[[OUT:.*]] = gpu.alloc host_shared () : memref<32x32xf32>
+  %0 = memref.alloc() : memref<32x32xf32>
+  // CHECK: gpu.launch
+  gpu.launch blocks(%bx, %by, %bz) in (%gx = %c1, %gy = %c1, %gz = %c1) threads(%tx, %ty, %tz) in (%sx = %c32, %sy = %c32, %sz = %c1) {
+    // CHECK: %[[SLM:.*]] = memref.alloc() : memref<32x33xf32, 3>
+    // CHECK-NOT: gpu.alloc
+    %slm = memref.alloc() : memref<32x33xf32, 3>
+    %v = memref.load %arg0[%ty, %tx] : memref<32x32xf32>
+    memref.store %v, %slm[%ty, %tx] : memref<32x33xf32, 3>
+    gpu.barrier
+    %w = memref.load %slm[%tx, %ty] : memref<32x33xf32, 3>
+    // CHECK: memref.store %{{.*}}, %[[OUT]][%{{.*}}, %{{.*}}] : memref<32x32xf32>
+    memref.store %w, %0[%ty, %tx] : memref<32x32xf32>
+    gpu.terminator
+  }
+  return %0 : memref<32x32xf32>
+}
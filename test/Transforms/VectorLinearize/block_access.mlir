@@ -0,0 +1,59 @@
+// RUN: imex-opt %s -split-input-file -imex-vector-linearize="block-access=true" | FileCheck %s
+
+// CHECK-LABEL: test_block_load_store_aligned
+// CHECK-SAME: (%[[ARG0:.*]]: memref<4x8xf32>)
+// CHECK: %[[FLAT:.*]] = memref.collapse_shape %[[ARG0]] {{\[}}[0, 1]] : memref<4x8xf32> into memref<32xf32>
+// CHECK: %[[LOAD:.*]] = vector.load %[[FLAT]][%{{.*}}] : memref<32xf32>, vector<32xf32>
+// CHECK-NOT: memref.load
+// CHECK: %[[FLAT2:.*]] = memref.collapse_shape %[[ARG0]] {{\[}}[0, 1]] : memref<4x8xf32> into memref<32xf32>
+// CHECK: vector.store %{{.*}}, %[[FLAT2]][%{{.*}}] : memref<32xf32>, vector<32xf32>
+// CHECK-NOT: memref.store
+func.func @test_block_load_store_aligned(%buffer: memref<4x8xf32>) {
+  %c0 = arith.constant 0 : index
+  %0 = vector.load %buffer[%c0, %c0] : memref<4x8xf32>, vector<4x8xf32>
+  vector.store %0, %buffer[%c0, %c0] : memref<4x8xf32>, vector<4x8xf32>
+  return
+}
+
+// -----
+
+// Offset 6 of f16 is 12 bytes, the first two elements are loaded before the
+// 16 byte aligned body of 8 elements, and the last two after it.
+// CHECK-LABEL: test_block_load_unaligned
+// CHECK-SAME: (%[[ARG0:.*]]: memref<4x6xf16>)
+// CHECK: %[[FLAT:.*]] = memref.collapse_shape %[[ARG0]] {{\[}}[0, 1]] : memref<4x6xf16> into memref<24xf16>
+// CHECK-COUNT-2: memref.load %[[FLAT]][%{{.*}}] : memref<24xf16>
+// CHECK: %[[BODY:.*]] = vector.load %[[FLAT]][%{{.*}}] : memref<24xf16>, vector<8xf16>
+// CHECK: vector.insert_strided_slice %[[BODY]], %{{.*}} {offsets = [2], strides = [1]} : vector<8xf16> into vector<12xf16>
+// CHECK-COUNT-2: memref.load %[[FLAT]][%{{.*}}] : memref<24xf16>
+func.func @test_block_load_unaligned(%buffer: memref<4x6xf16>) -> vector<2x6xf16> {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %0 = vector.load %buffer[%c1, %c0] : memref<4x6xf16>, vector<2x6xf16>
+  return %0 : vector<2x6xf16>
+}
+
+// -----
+
+// Dynamic offsets of unknown alignment keep per-row accesses.
+// CHECK-LABEL: test_block_load_unknown_alignment
+// CHECK-NOT: memref.collapse_shape
+// CHECK-COUNT-2: vector.load %{{.*}}[%{{.*}}, %{{.*}}] : memref<?x6xf16>, vector<6xf16>
+func.func @test_block_load_unknown_alignment(%buffer: memref<?x6xf16>, %i: index) -> vector<2x6xf16> {
+  %c0 = arith.constant 0 : index
+  %0 = vector.load %buffer[%i, %c0] : memref<?x6xf16>, vector<2x6xf16>
+  return %0 : vector<2x6xf16>
+}
+
+// -----
+
+// Rows of 8 f32 elements are 32 bytes, such that dynamic row offsets are
+// aligned.
+// CHECK-LABEL: test_block_store_dynamic
+// CHECK: %[[FLAT:.*]] = memref.collapse_shape %{{.*}} {{\[}}[0, 1]] : memref<?x8xf32> into memref<?xf32>
+// CHECK: vector.store %{{.*}}, %[[FLAT]][%{{.*}}] : memref<?xf32>, vector<16xf32>
+func.func @test_block_store_dynamic(%buffer: memref<?x8xf32>, %i: index, %v: vector<2x8xf32>) {
+  %c0 = arith.constant 0 : index
+  vector.store %v, %buffer[%i, %c0] : memref<?x8xf32>, vector<2x8xf32>
+  return
+}
@@ -0,0 +1,31 @@
+// RUN: imex-opt %s -imex-vector-linearize="block-access=true remarks=-" -verify-diagnostics -o /dev/null
+// RUN: rm -f %t.yaml
+// RUN: imex-opt %s -imex-vector-linearize="block-access=true remarks=%t.yaml" -o /dev/null
+// RUN: FileCheck %s --input-file=%t.yaml
+
+func.func @test_remarks(%arg0: memref<4x6xf16>, %arg1: memref<?x6xf16>, %i: index) -> (vector<2x6xf16>, vector<2x6xf16>) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  // expected-remark@+1 {{ScalarizedLoad: 4 unaligned elements loaded one by one}}
+  %0 = vector.load %arg0[%c1, %c0] : memref<4x6xf16>, vector<2x6xf16>
+  // expected-remark@+1 {{UnrolledLoad: no aligned 1D block access, unrolled into 2 row loads}}
+  %1 = vector.load %arg1[%i, %c0] : memref<?x6xf16>, vector<2x6xf16>
+  return %0, %1 : vector<2x6xf16>, vector<2x6xf16>
+}
+
+// CHECK:      --- !Missed
+// CHECK-NEXT: Pass: 'imex-vector-linearize'
+// CHECK-NEXT: Name: 'ScalarizedLoad'
+// CHECK-NEXT: DebugLoc: { File: '{{.*}}remarks.mlir', Line: 10, Column: 8 }
+// CHECK-NEXT: Function: 'test_remarks'
+// CHECK-NEXT: Args:
+// CHECK-NEXT:   - String: '4 unaligned elements loaded one by one'
+// CHECK-NEXT: ...
+// CHECK-NEXT: --- !Missed
+// CHECK-NEXT: Pass: 'imex-vector-linearize'
+// CHECK-NEXT: Name: 'UnrolledLoad'
+// CHECK-NEXT: DebugLoc: { File: '{{.*}}remarks.mlir', Line: 12, Column: 8 }
+// CHECK-NEXT: Function: 'test_remarks'
+// CHECK-NEXT: Args:
+// CHECK-NEXT:   - String: 'no aligned 1D block access, unrolled into 2 row loads'
+// CHECK-NEXT: ...
@@ -405,3 +405,64 @@ func.func @test(%arg1 : !xegpu.tensor_desc<8x16xf16>, %arg2 : !xegpu.tensor_desc
   //CHECK: return %[[r4]] : vector<8x16xf32>
   return %1 : vector<8x16xf32>
 }
+
+// -----
+
+// The loop-carried B operand is packed once before the loop, although the
+// loop result is used in the plain layout. It is converted back after the loop.
+// CHECK-LABEL: @test
+//  CHECK-SAME: (%[[ARG1:.*]]: !xegpu.tensor_desc<8x16xf16>, %[[ARG2:.*]]: !xegpu.tensor_desc<16x16xf16>, %{{.*}}: index)
+//       CHECK:  %[[A:.*]] = xegpu.load_nd %[[ARG1]]  : !xegpu.tensor_desc<8x16xf16> -> vector<8x16xf16>
+//       CHECK:  %[[B:.*]] = xegpu.load_nd %[[ARG2]] <{packed}> : !xegpu.tensor_desc<16x16xf16> -> vector<8x16x2xf16>
+//       CHECK:  %[[RES:.*]]:2 = scf.for %{{.*}} = %{{.*}} to %{{.*}} step %{{.*}} iter_args(%[[ITER1:.*]] = %[[B]], %[[ITER2:.*]] = %{{.*}}) -> (vector<8x16x2xf16>, vector<8x16xf32>) {
+//   CHECK-NOT:  vector.shuffle
+//       CHECK:  %[[B1:.*]] = xegpu.load_nd %[[ARG2]] <{packed}> : !xegpu.tensor_desc<16x16xf16> -> vector<8x16x2xf16>
+//       CHECK:  %[[B2:.*]] = arith.addf %[[ITER1]], %[[B1]] : vector<8x16x2xf16>
+//       CHECK:  %[[RES1:.*]] = xegpu.dpas %[[A]], %[[B2]], %[[ITER2]] : vector<8x16xf16>, vector<8x16x2xf16>, vector<8x16xf32> -> vector<8x16xf32>
+//       CHECK:  scf.yield %[[B2]], %[[RES1]] : vector<8x16x2xf16>, vector<8x16xf32>
+//       CHECK:  }
+//       CHECK:  %[[C0:.*]] = vector.shape_cast %[[RES]]#0 : vector<8x16x2xf16> to vector<256xf16>
+//       CHECK:  %[[C1:.*]] = vector.shuffle %[[C0]], %[[C0]]
+//       CHECK:  %[[C2:.*]] = vector.shape_cast %[[C1]] : vector<256xf16> to vector<16x16xf16>
+//       CHECK:  return %[[RES]]#1, %[[C2]] : vector<8x16xf32>, vector<16x16xf16>
+
+func.func @test(%arg1 : !xegpu.tensor_desc<8x16xf16>, %arg2 : !xegpu.tensor_desc<16x16xf16>, %arg3 : index) -> (vector<8x16xf32>, vector<16x16xf16>) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %cst = arith.constant dense<0.000000e+00> : vector<8x16xf32>
+  %0 = xegpu.load_nd %arg1 : !xegpu.tensor_desc<8x16xf16> -> vector<8x16xf16>
+  %1 = xegpu.load_nd %arg2 : !xegpu.tensor_desc<16x16xf16> -> vector<16x16xf16>
+  %2:2 = scf.for %i = %c0 to %arg3 step %c1 iter_args(%iter = %1, %res = %cst) -> (vector<16x16xf16>, vector<8x16xf32>) {
+    %3 = xegpu.load_nd %arg2 : !xegpu.tensor_desc<16x16xf16> -> vector<16x16xf16>
+    %4 = arith.addf %iter, %3 : vector<16x16xf16>
+    %5 = xegpu.dpas %0, %4, %res : vector<8x16xf16>, vector<16x16xf16>, vector<8x16xf32> -> vector<8x16xf32>
+    scf.yield %4, %5: vector<16x16xf16>, vector<8x16xf32>
+  }
+  return %2#1, %2#0 : vector<8x16xf32>, vector<16x16xf16>
+}
+
+// -----
+
+// The B operand is passed to a private function in vnni layout, such that it
+// is loaded in vnni layout by the caller.
+// CHECK-LABEL: func.func private @callee
+//  CHECK-SAME: (%[[A:.*]]: vector<8x16xf16>, %[[B:.*]]: vector<8x16x2xf16>) -> vector<8x16xf32>
+//   CHECK-NOT:  vector.shuffle
+//       CHECK:  xegpu.dpas %[[A]], %[[B]] : vector<8x16xf16>, vector<8x16x2xf16> -> vector<8x16xf32>
+// CHECK-LABEL: @test
+//       CHECK:  %[[A:.*]] = xegpu.load_nd %{{.*}}  : !xegpu.tensor_desc<8x16xf16> -> vector<8x16xf16>
+//       CHECK:  %[[B:.*]] = xegpu.load_nd %{{.*}} <{packed}> : !xegpu.tensor_desc<16x16xf16> -> vector<8x16x2xf16>
+//   CHECK-NOT:  vector.shuffle
+//       CHECK:  call @callee(%[[A]], %[[B]]) : (vector<8x16xf16>, vector<8x16x2xf16>) -> vector<8x16xf32>
+
+func.func private @callee(%a : vector<8x16xf16>, %b : vector<16x16xf16>) -> vector<8x16xf32> {
+  %0 = xegpu.dpas %a, %b : vector<8x16xf16>, vector<16x16xf16> -> vector<8x16xf32>
+  return %0 : vector<8x16xf32>
+}
+
+func.func @test(%arg1 : !xegpu.tensor_desc<8x16xf16>, %arg2 : !xegpu.tensor_desc<16x16xf16>) -> vector<8x16xf32> {
+  %0 = xegpu.load_nd %arg1 : !xegpu.tensor_desc<8x16xf16> -> vector<8x16xf16>
+  %1 = xegpu.load_nd %arg2 : !xegpu.tensor_desc<16x16xf16> -> vector<16x16xf16>
+  %2 = func.call @callee(%0, %1) : (vector<8x16xf16>, vector<16x16xf16>) -> vector<8x16xf32>
+  return %2 : vector<8x16xf32>
+}
@@ -0,0 +1,49 @@
+// RUN: imex-opt --imex-add-outer-parallel-loop='promote=true' %s | FileCheck %s
+
+func.func @promote_nest(%arg0: memref<10x20xf32>) {
+  // CHECK-LABEL: func @promote_nest
+  // CHECK-SAME: (%[[ARG0:.*]]: memref<10x20xf32>)
+  // CHECK: %[[ALLOC:.*]] = memref.alloc() : memref<20x10xf32>
+  %c0 = arith.constant 0 : index
+  %c10 = arith.constant 10 : index
+  %c1 = arith.constant 1 : index
+  %c20 = arith.constant 20 : index
+  // CHECK: scf.parallel (%[[I:.*]], %[[J:.*]]) = (%{{.*}}, %{{.*}}) to (%{{.*}}, %{{.*}}) step (%{{.*}}, %{{.*}}) {
+  // CHECK-NEXT: %[[V0:.*]] = memref.load %[[ALLOC]][%[[J]], %[[I]]] : memref<20x10xf32>
+  // CHECK-NEXT: %[[V1:.*]] = memref.load %[[ARG0]][%[[I]], %[[J]]] : memref<10x20xf32>
+  // CHECK-NEXT: %[[V2:.*]] = arith.addf %[[V0]], %[[V1]] : f32
+  // CHECK-NEXT: memref.store %[[V2]], %[[ARG0]][%[[I]], %[[J]]] : memref<10x20xf32>
+  // CHECK-NEXT: scf.reduce
+  // CHECK-NOT: scf.for
+  %alloc = memref.alloc() : memref<20x10xf32>
+  scf.for %arg2 = %c0 to %c10 step %c1 {
+    scf.for %arg3 = %c0 to %c20 step %c1 {
+      %0 = memref.load %alloc[%arg3, %arg2] : memref<20x10xf32>
+      %1 = memref.load %arg0[%arg2, %arg3] : memref<10x20xf32>
+      %2 = arith.addf %0, %1 : f32
+      memref.store %2, %arg0[%arg2, %arg3] : memref<10x20xf32>
+    }
+  }
+  return
+}
+
+func.func @no_promote_dependent(%arg0: memref<10x20xf32>) {
+  // The elements stored are read by other iterations, the nest is wrapped in
+  // a single iteration parallel loop.
+  // CHECK-LABEL: func @no_promote_dependent
+  // CHECK: scf.parallel
+  // CHECK-NEXT: scf.for
+  // CHECK-NEXT: scf.for
+  %c0 = arith.constant 0 : index
+  %c10 = arith.constant 10 : index
+  %c1 = arith.constant 1 : index
+  %c19 = arith.constant 19 : index
+  scf.for %arg1 = %c0 to %c10 step %c1 {
+    scf.for %arg2 = %c0 to %c19 step %c1 {
+      %0 = memref.load %arg0[%arg1, %arg2] : memref<10x20xf32>
+      %1 = arith.addi %arg2, %c1 : index
+      memref.store %0, %arg0[%arg1, %1] : memref<10x20xf32>
+    }
+  }
+  return
+}
@@ -0,0 +1,48 @@
+// RUN: imex-opt --assign-gpux-streams='num-streams=2' %s | FileCheck %s
+
+module attributes {gpu.container_module} {
+  // CHECK-LABEL: func.func @branches
+  func.func @branches(%a : memref<8xf32>, %b : memref<8xf32>) {
+    %c1 = arith.constant 1 : index
+    %c8 = arith.constant 8 : index
+    // CHECK: %[[STREAM:.*]] = "gpux.create_stream"
+    // CHECK-NEXT: %[[SUB:.*]] = "gpux.substream"(%[[STREAM]]) <{index = 1 : i64}>
+    // CHECK-NOT: "gpux.substream"
+    %0 = "gpux.create_stream"() : () -> !gpux.StreamType
+    // CHECK: %[[A1:.*]] = "gpux.launch_func"(%[[STREAM]],
+    %a1 = "gpux.launch_func"(%0, %c8, %c1, %c1, %c1, %c1, %c1, %a) {kernel = @Kernels::@kernel, operandSegmentSizes = array<i32: 0, 1, 1, 1, 1, 1, 1, 1, 0, 1>} : (!gpux.StreamType, index, index, index, index, index, index, memref<8xf32>) -> !gpu.async.token
+    // CHECK: %[[B1:.*]] = "gpux.launch_func"(%[[SUB]],
+    %b1 = "gpux.launch_func"(%0, %c8, %c1, %c1, %c1, %c1, %c1, %b) {kernel = @Kernels::@kernel, operandSegmentSizes = array<i32: 0, 1, 1, 1, 1, 1, 1, 1, 0, 1>} : (!gpux.StreamType, index, index, index, index, index, index, memref<8xf32>) -> !gpu.async.token
+    // CHECK: %[[A2:.*]] = "gpux.launch_func"(%[[A1]], %[[STREAM]],
+    %a2 = "gpux.launch_func"(%a1, %0, %c8, %c1, %c1, %c1, %c1, %c1, %a) {kernel = @Kernels::@kernel, operandSegmentSizes = array<i32: 1, 1, 1, 1, 1, 1, 1, 1, 0, 1>} : (!gpu.async.token, !gpux.StreamType, index, index, index, index, index, index, memref<8xf32>) -> !gpu.async.token
+    // CHECK: %[[B2:.*]] = "gpux.launch_func"(%[[B1]], %[[SUB]],
+    %b2 = "gpux.launch_func"(%b1, %0, %c8, %c1, %c1, %c1, %c1, %c1, %b) {kernel = @Kernels::@kernel, operandSegmentSizes = array<i32: 1, 1, 1, 1, 1, 1, 1, 1, 0, 1>} : (!gpu.async.token, !gpux.StreamType, index, index, index, index, index, index, memref<8xf32>) -> !gpu.async.token
+    // CHECK: %[[JOIN:.*]] = "gpux.launch_func"(%[[A2]], %[[B2]], %[[STREAM]],
+    %j = "gpux.launch_func"(%a2, %b2, %0, %c8, %c1, %c1, %c1, %c1, %c1, %a) {kernel = @Kernels::@kernel, operandSegmentSizes = array<i32: 2, 1, 1, 1, 1, 1, 1, 1, 0, 1>} : (!gpu.async.token, !gpu.async.token, !gpux.StreamType, index, index, index, index, index, index, memref<8xf32>) -> !gpu.async.token
+    // CHECK: "gpux.wait"(%[[JOIN]], %[[STREAM]])
+    "gpux.wait"(%j, %0) : (!gpu.async.token, !gpux.StreamType) -> ()
+    "gpux.destroy_stream"(%0) : (!gpux.StreamType) -> ()
+    return
+  }
+
+  // CHECK-LABEL: func.func @sync_launch
+  func.func @sync_launch(%a : memref<8xf32>, %b : memref<8xf32>) {
+    %c1 = arith.constant 1 : index
+    %c8 = arith.constant 8 : index
+    // CHECK-NOT: "gpux.substream"
+    %0 = "gpux.create_stream"() : () -> !gpux.StreamType
+    %a1 = "gpux.launch_func"(%0, %c8, %c1, %c1, %c1, %c1, %c1, %a) {kernel = @Kernels::@kernel, operandSegmentSizes = array<i32: 0, 1, 1, 1, 1, 1, 1, 1, 0, 1>} : (!gpux.StreamType, index, index, index, index, index, index, memref<8xf32>) -> !gpu.async.token
+    %b1 = "gpux.launch_func"(%0, %c8, %c1, %c1, %c1, %c1, %c1, %b) {kernel = @Kernels::@kernel, operandSegmentSizes = array<i32: 0, 1, 1, 1, 1, 1, 1, 1, 0, 1>} : (!gpux.StreamType, index, index, index, index, index, index, memref<8xf32>) -> !gpu.async.token
+    // The synchronous launch relies on the order of the stream.
+    "gpux.launch_func"(%0, %c8, %c1, %c1, %c1, %c1, %c1, %a) {kernel = @Kernels::@kernel, operandSegmentSizes = array<i32: 0, 1, 1, 1, 1, 1, 1, 1, 0, 1>} : (!gpux.StreamType, index, index, index, index, index, index, memref<8xf32>) -> ()
+    "gpux.wait"(%a1, %b1, %0) : (!gpu.async.token, !gpu.async.token, !gpux.StreamType) -> ()
+    "gpux.destroy_stream"(%0) : (!gpux.StreamType) -> ()
+    return
+  }
+
+  gpu.module @Kernels {
+    gpu.func @kernel(%arg0: memref<8xf32>) kernel {
+      gpu.return
+    }
+  }
+}
@@ -0,0 +1,40 @@
+// RUN: imex-opt -cast-index="use-range-analysis=true" %s | FileCheck %s
+
+module @castindex attributes {gpu.container_module} {
+  gpu.module @test_kernel {
+    // The linear id is bounded by the known launch sizes, the chain computing
+    // it is narrowed to i32 with a cast back to index for the load only.
+    // CHECK-LABEL: gpu.func @test_chain
+    gpu.func @test_chain(%arg0: memref<4096xf32>) kernel attributes {gpu.known_block_size = array<i32: 64, 1, 1>, gpu.known_grid_size = array<i32: 64, 1, 1>} {
+      // CHECK: %[[C64:.*]] = arith.constant 64 : i32
+      // CHECK: %[[BID:.*]] = gpu.block_id  x
+      // CHECK: %[[BID_I32:.*]] = index.casts %[[BID]] : index to i32
+      // CHECK: %[[TID:.*]] = gpu.thread_id  x
+      // CHECK: %[[TID_I32:.*]] = index.casts %[[TID]] : index to i32
+      // CHECK: %[[MUL:.*]] = arith.muli %[[BID_I32]], %[[C64]] : i32
+      // CHECK: %[[ADD:.*]] = arith.addi %[[MUL]], %[[TID_I32]] : i32
+      // CHECK: %[[IDX:.*]] = index.casts %[[ADD]] : i32 to index
+      // CHECK: memref.load %arg0[%[[IDX]]] : memref<4096xf32>
+      %c64 = arith.constant 64 : index
+      %0 = gpu.block_id  x
+      %1 = gpu.thread_id  x
+      %2 = arith.muli %0, %c64 : index
+      %3 = arith.addi %2, %1 : index
+      %4 = memref.load %arg0[%3] : memref<4096xf32>
+      gpu.return
+    }
+
+    // Offsets of large buffers may not fit in i32 and stay index.
+    // CHECK-LABEL: gpu.func @test_large
+    gpu.func @test_large(%arg0: memref<?xf32>, %arg1: index) kernel attributes {gpu.known_block_size = array<i32: 64, 1, 1>} {
+      // CHECK-NOT: index.casts
+      // CHECK: arith.muli %{{.*}}, %{{.*}} : index
+      // CHECK: arith.addi %{{.*}}, %{{.*}} : index
+      %0 = gpu.thread_id  x
+      %1 = arith.muli %arg1, %arg1 : index
+      %2 = arith.addi %1, %0 : index
+      %3 = memref.load %arg0[%2] : memref<?xf32>
+      gpu.return
+    }
+  }
+}
@@ -0,0 +1,71 @@
+// RUN: imex-opt %s -split-input-file -imex-estimate-kernel-cost | FileCheck %s
+
+// Two f32 loads and one f32 store, one addf per work item.
+// CHECK-LABEL: gpu.func @add
+// CHECK-SAME: imex.bytes_per_item = 12 : i64, imex.flops_per_item = 1 : i64
+gpu.module @kernels {
+  gpu.func @add(%arg0: memref<8xf32>, %arg1: memref<8xf32>, %arg2: memref<8xf32>) kernel {
+    %0 = gpu.block_id  x
+    %1 = memref.load %arg0[%0] : memref<8xf32>
+    %2 = memref.load %arg1[%0] : memref<8xf32>
+    %3 = arith.addf %1, %2 : f32
+    memref.store %3, %arg2[%0] : memref<8xf32>
+    gpu.return
+  }
+}
+
+// -----
+
+// The body of the loop with constant bounds runs 4 times, the one with
+// dynamic bounds is counted once: (4 + 1) * (16 bytes, 2 flops).
+// CHECK-LABEL: gpu.func @loops
+// CHECK-SAME: imex.bytes_per_item = 80 : i64, imex.flops_per_item = 10 : i64
+gpu.module @kernels {
+  gpu.func @loops(%arg0: memref<64xf32>, %arg1: index) kernel {
+    %c0 = arith.constant 0 : index
+    %c1 = arith.constant 1 : index
+    %c4 = arith.constant 4 : index
+    scf.for %i = %c0 to %c4 step %c1 {
+      %0 = vector.load %arg0[%i] : memref<64xf32>, vector<2xf32>
+      %1 = math.exp %0 : vector<2xf32>
+      vector.store %1, %arg0[%i] : memref<64xf32>, vector<2xf32>
+    }
+    scf.for %i = %c0 to %arg1 step %c1 {
+      %0 = vector.load %arg0[%i] : memref<64xf32>, vector<2xf32>
+      %1 = math.exp %0 : vector<2xf32>
+      vector.store %1, %arg0[%i] : memref<64xf32>, vector<2xf32>
+    }
+    gpu.return
+  }
+}
+
+// -----
+
+// A 8x16x16 dpas is 2 * 8 * 16 * 16 flops, the loads and the store move
+// 8x16xf16, 16x16xf16 and 8x16xf32.
+// CHECK-LABEL: gpu.func @dpas
+// CHECK-SAME: imex.bytes_per_item = 1280 : i64, imex.flops_per_item = 4096 : i64
+gpu.module @kernels {
+  gpu.func @dpas(%a: memref<8x16xf16>, %b: memref<16x16xf16>, %c: memref<8x16xf32>) kernel {
+    %c0 = arith.constant 0 : index
+    %0 = xegpu.create_nd_tdesc %a[%c0, %c0] : memref<8x16xf16> -> !xegpu.tensor_desc<8x16xf16>
+    %1 = xegpu.create_nd_tdesc %b[%c0, %c0] : memref<16x16xf16> -> !xegpu.tensor_desc<16x16xf16>
+    %2 = xegpu.create_nd_tdesc %c[%c0, %c0] : memref<8x16xf32> -> !xegpu.tensor_desc<8x16xf32>
+    %3 = xegpu.load_nd %0 : !xegpu.tensor_desc<8x16xf16> -> vector<8x16xf16>
+    %4 = xegpu.load_nd %1 <{packed}> : !xegpu.tensor_desc<16x16xf16> -> vector<8x16x2xf16>
+    %5 = xegpu.dpas %3, %4 : vector<8x16xf16>, vector<8x16x2xf16> -> vector<8x16xf32>
+    xegpu.store_nd %5, %2 : vector<8x16xf32>, !xegpu.tensor_desc<8x16xf32>
+    gpu.return
+  }
+}
+
+// -----
+
+// Device functions are not annotated.
+// CHECK-LABEL: gpu.func @helper
+// CHECK-NOT: imex.bytes_per_item
+gpu.module @kernels {
+  gpu.func @helper(%arg0: memref<8xf32>) {
+    gpu.return
+  }
+}
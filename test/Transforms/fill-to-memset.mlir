@@ -0,0 +1,31 @@
+// RUN: imex-opt --split-input-file --imex-fill-to-memset %s | FileCheck %s
+
+// The zero initialization of the accumulator becomes a memset.
+// CHECK-LABEL: func.func @matmul
+// CHECK-SAME: (%[[A:.*]]: memref<64x128xf16>, %[[B:.*]]: memref<128x32xf16>)
+// CHECK: %[[ZERO:.*]] = arith.constant 0.000000e+00 : f32
+// CHECK: %[[C:.*]] = memref.alloc() : memref<64x32xf32>
+// CHECK: gpu.memset %[[C]], %[[ZERO]] : memref<64x32xf32>, f32
+// CHECK-NOT: linalg.fill
+// CHECK: linalg.matmul ins(%[[A]], %[[B]] : memref<64x128xf16>, memref<128x32xf16>) outs(%[[C]] : memref<64x32xf32>)
+func.func @matmul(%A: memref<64x128xf16>, %B: memref<128x32xf16>) -> memref<64x32xf32> {
+  %zero = arith.constant 0.0 : f32
+  %C = memref.alloc() : memref<64x32xf32>
+  linalg.fill ins(%zero : f32) outs(%C : memref<64x32xf32>)
+  linalg.matmul ins(%A, %B : memref<64x128xf16>, memref<128x32xf16>) outs(%C : memref<64x32xf32>)
+  return %C : memref<64x32xf32>
+}
+
+// -----
+
+// Fills of strided views and of workgroup memory stay fills.
+// CHECK-LABEL: func.func @not_converted
+// CHECK-NOT: gpu.memset
+// CHECK: linalg.fill
+// CHECK: linalg.fill
+func.func @not_converted(%arg0: memref<16x16xi32, strided<[32, 1]>>, %arg1: memref<16xi32, 3>) {
+  %c1 = arith.constant 1 : i32
+  linalg.fill ins(%c1 : i32) outs(%arg0 : memref<16x16xi32, strided<[32, 1]>>)
+  linalg.fill ins(%c1 : i32) outs(%arg1 : memref<16xi32, 3>)
+  return
+}
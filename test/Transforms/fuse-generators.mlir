@@ -0,0 +1,61 @@
+// RUN: imex-opt --split-input-file --imex-fuse-generators %s | FileCheck %s
+
+#map = affine_map<(d0) -> (d0)>
+
+// The generator feeds two consumers and gets fused into both of them.
+// CHECK-LABEL: func.func @test_linspace
+// CHECK: %[[R0:.*]] = linalg.generic {{.*}} iterator_types = ["parallel"]} outs(
+// CHECK: linalg.index 0
+// CHECK: math.sin
+// CHECK: %[[R1:.*]] = linalg.generic {{.*}} iterator_types = ["parallel"]} outs(
+// CHECK: linalg.index 0
+// CHECK: math.cos
+// CHECK: return %[[R0]], %[[R1]]
+func.func @test_linspace(%start: f32, %step: f32) -> (tensor<16xf32>, tensor<16xf32>) {
+  %0 = tensor.empty() : tensor<16xf32>
+  %1 = linalg.generic {indexing_maps = [#map], iterator_types = ["parallel"]} outs(%0 : tensor<16xf32>) {
+  ^bb0(%out: f32):
+    %i = linalg.index 0 : index
+    %ii = arith.index_cast %i : index to i32
+    %f = arith.sitofp %ii : i32 to f32
+    %m = arith.mulf %step, %f : f32
+    %v = arith.addf %m, %start : f32
+    linalg.yield %v : f32
+  } -> tensor<16xf32>
+  %2 = linalg.generic {indexing_maps = [#map, #map], iterator_types = ["parallel"]} ins(%1 : tensor<16xf32>) outs(%0 : tensor<16xf32>) {
+  ^bb0(%in: f32, %out: f32):
+    %s = math.sin %in : f32
+    linalg.yield %s : f32
+  } -> tensor<16xf32>
+  %3 = linalg.generic {indexing_maps = [#map, #map], iterator_types = ["parallel"]} ins(%1 : tensor<16xf32>) outs(%0 : tensor<16xf32>) {
+  ^bb0(%in: f32, %out: f32):
+    %c = math.cos %in : f32
+    linalg.yield %c : f32
+  } -> tensor<16xf32>
+  return %2, %3 : tensor<16xf32>, tensor<16xf32>
+}
+
+// -----
+
+#map = affine_map<(d0) -> (d0)>
+
+// Producers with inputs are left to linalg-fuse-elementwise-ops.
+// CHECK-LABEL: func.func @test_not_generator
+// CHECK: linalg.generic {{.*}} ins(%arg0
+// CHECK: math.exp
+// CHECK: linalg.generic {{.*}} ins(%{{.*}} : tensor<16xf32>)
+// CHECK: math.sin
+func.func @test_not_generator(%arg0: tensor<16xf32>) -> (tensor<16xf32>, tensor<16xf32>) {
+  %0 = tensor.empty() : tensor<16xf32>
+  %1 = linalg.generic {indexing_maps = [#map, #map], iterator_types = ["parallel"]} ins(%arg0 : tensor<16xf32>) outs(%0 : tensor<16xf32>) {
+  ^bb0(%in: f32, %out: f32):
+    %e = math.exp %in : f32
+    linalg.yield %e : f32
+  } -> tensor<16xf32>
+  %2 = linalg.generic {indexing_maps = [#map, #map], iterator_types = ["parallel"]} ins(%1 : tensor<16xf32>) outs(%0 : tensor<16xf32>) {
+  ^bb0(%in: f32, %out: f32):
+    %s = math.sin %in : f32
+    linalg.yield %s : f32
+  } -> tensor<16xf32>
+  return %1, %2 : tensor<16xf32>, tensor<16xf32>
+}
@@ -0,0 +1,86 @@
+// RUN: imex-opt --split-input-file --imex-fuse-sibling-reductions %s | FileCheck %s
+
+#map = affine_map<(d0, d1) -> (d0, d1)>
+#map1 = affine_map<(d0, d1) -> (d0)>
+
+// The sum and the sum of squares read the input once.
+// CHECK-LABEL: func.func @test_sum_and_squares
+// CHECK-SAME: %[[ARG:.*]]: tensor<64x128xf32>
+// CHECK: %[[R:.*]]:2 = linalg.generic
+// CHECK-SAME: iterator_types = ["parallel", "reduction"]
+// CHECK-SAME: ins(%[[ARG]] : tensor<64x128xf32>)
+// CHECK: ^bb0(%[[IN:.*]]: f32, %[[OUT0:.*]]: f32, %[[OUT1:.*]]: f32):
+// CHECK: %[[SUM:.*]] = arith.addf %[[IN]], %[[OUT0]] : f32
+// CHECK: %[[SQ:.*]] = arith.mulf %[[IN]], %[[IN]] : f32
+// CHECK: %[[SUMSQ:.*]] = arith.addf %[[SQ]], %[[OUT1]] : f32
+// CHECK: linalg.yield %[[SUM]], %[[SUMSQ]] : f32, f32
+// CHECK-NOT: linalg.generic
+// CHECK: return %[[R]]#0, %[[R]]#1
+func.func @test_sum_and_squares(%arg0: tensor<64x128xf32>) -> (tensor<64xf32>, tensor<64xf32>) {
+  %cst = arith.constant 0.000000e+00 : f32
+  %0 = tensor.empty() : tensor<64xf32>
+  %1 = linalg.fill ins(%cst : f32) outs(%0 : tensor<64xf32>) -> tensor<64xf32>
+  %2 = linalg.generic {indexing_maps = [#map, #map1], iterator_types = ["parallel", "reduction"]} ins(%arg0 : tensor<64x128xf32>) outs(%1 : tensor<64xf32>) {
+  ^bb0(%in: f32, %out: f32):
+    %s = arith.addf %in, %out : f32
+    linalg.yield %s : f32
+  } -> tensor<64xf32>
+  %3 = tensor.empty() : tensor<64xf32>
+  %4 = linalg.fill ins(%cst : f32) outs(%3 : tensor<64xf32>) -> tensor<64xf32>
+  %5 = linalg.generic {indexing_maps = [#map, #map1], iterator_types = ["parallel", "reduction"]} ins(%arg0 : tensor<64x128xf32>) outs(%4 : tensor<64xf32>) {
+  ^bb0(%in: f32, %out: f32):
+    %m = arith.mulf %in, %in : f32
+    %s = arith.addf %m, %out : f32
+    linalg.yield %s : f32
+  } -> tensor<64xf32>
+  return %2, %5 : tensor<64xf32>, tensor<64xf32>
+}
+
+// -----
+
+#map = affine_map<(d0, d1) -> (d0, d1)>
+#map1 = affine_map<(d0, d1) -> (d0)>
+
+// The variance needs the mean, so the reductions stay separate.
+// CHECK-LABEL: func.func @test_dependent
+// CHECK: linalg.generic
+// CHECK: linalg.generic
+func.func @test_dependent(%arg0: tensor<64x128xf32>, %init: tensor<64xf32>) -> tensor<64xf32> {
+  %0 = linalg.generic {indexing_maps = [#map, #map1], iterator_types = ["parallel", "reduction"]} ins(%arg0 : tensor<64x128xf32>) outs(%init : tensor<64xf32>) {
+  ^bb0(%in: f32, %out: f32):
+    %s = arith.addf %in, %out : f32
+    linalg.yield %s : f32
+  } -> tensor<64xf32>
+  %1 = linalg.generic {indexing_maps = [#map, #map1, #map1], iterator_types = ["parallel", "reduction"]} ins(%arg0, %0 : tensor<64x128xf32>, tensor<64xf32>) outs(%init : tensor<64xf32>) {
+  ^bb0(%in: f32, %mean: f32, %out: f32):
+    %d = arith.subf %in, %mean : f32
+    %m = arith.mulf %d, %d : f32
+    %s = arith.addf %m, %out : f32
+    linalg.yield %s : f32
+  } -> tensor<64xf32>
+  return %1 : tensor<64xf32>
+}
+
+// -----
+
+#map = affine_map<(d0, d1) -> (d0, d1)>
+#map1 = affine_map<(d0, d1) -> (d1, d0)>
+#map2 = affine_map<(d0, d1) -> (d0)>
+
+// Reading the input through different maps iterates over different domains.
+// CHECK-LABEL: func.func @test_different_maps
+// CHECK: linalg.generic
+// CHECK: linalg.generic
+func.func @test_different_maps(%arg0: tensor<64x64xf32>, %init: tensor<64xf32>) -> (tensor<64xf32>, tensor<64xf32>) {
+  %0 = linalg.generic {indexing_maps = [#map, #map2], iterator_types = ["parallel", "reduction"]} ins(%arg0 : tensor<64x64xf32>) outs(%init : tensor<64xf32>) {
+  ^bb0(%in: f32, %out: f32):
+    %s = arith.addf %in, %out : f32
+    linalg.yield %s : f32
+  } -> tensor<64xf32>
+  %1 = linalg.generic {indexing_maps = [#map1, #map2], iterator_types = ["parallel", "reduction"]} ins(%arg0 : tensor<64x64xf32>) outs(%init : tensor<64xf32>) {
+  ^bb0(%in: f32, %out: f32):
+    %s = arith.addf %in, %out : f32
+    linalg.yield %s : f32
+  } -> tensor<64xf32>
+  return %0, %1 : tensor<64xf32>, tensor<64xf32>
+}
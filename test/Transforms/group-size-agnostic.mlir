@@ -0,0 +1,109 @@
+// RUN: imex-opt %s -split-input-file -imex-group-size-agnostic | FileCheck %s
+
+// The ids are computed from the global id and the constant block size.
+// CHECK-LABEL: gpu.func @add
+// CHECK-SAME: (%{{.*}}: memref<128xf32>, %{{.*}}: memref<128xf32>) kernel
+// CHECK-SAME: imex.group_size_agnostic
+// CHECK: %[[BID:.*]] = gpu.block_id x
+// CHECK: %[[BDIM:.*]] = gpu.block_dim x
+// CHECK: %[[TID:.*]] = gpu.thread_id x
+// CHECK: %[[MUL:.*]] = arith.muli %[[BID]], %[[BDIM]] : index
+// CHECK: %[[GID:.*]] = arith.addi %[[MUL]], %[[TID]] : index
+// CHECK: %[[C16:.*]] = arith.constant 16 : index
+// CHECK: %[[B:.*]] = arith.divui %[[GID]], %[[C16]] : index
+// CHECK: %[[T:.*]] = arith.remui %[[GID]], %[[C16]] : index
+// CHECK-NOT: gpu.block_id
+// CHECK-NOT: gpu.thread_id
+// CHECK: %[[I:.*]] = arith.muli %[[B]], %[[C16]] : index
+// CHECK: arith.addi %[[I]], %[[T]] : index
+module attributes {gpu.container_module} {
+  gpu.module @kernels {
+    gpu.func @add(%arg0: memref<128xf32>, %arg1: memref<128xf32>) kernel {
+      %0 = gpu.block_id x
+      %1 = gpu.block_dim x
+      %2 = gpu.thread_id x
+      %3 = arith.muli %0, %1 : index
+      %4 = arith.addi %3, %2 : index
+      %5 = memref.load %arg0[%4] : memref<128xf32>
+      memref.store %5, %arg1[%4] : memref<128xf32>
+      gpu.return
+    }
+  }
+  func.func @main(%arg0: memref<128xf32>, %arg1: memref<128xf32>) {
+    %c1 = arith.constant 1 : index
+    %c8 = arith.constant 8 : index
+    %c16 = arith.constant 16 : index
+    gpu.launch_func @kernels::@add blocks in (%c8, %c1, %c1) threads in (%c16, %c1, %c1) args(%arg0 : memref<128xf32>, %arg1 : memref<128xf32>)
+    return
+  }
+}
+
+// -----
+
+// Block sizes differing between launches are passed as kernel arguments.
+// CHECK-LABEL: gpu.func @copy
+// CHECK-SAME: (%{{.*}}: memref<?x?xf32>, %[[BX:.*]]: index) kernel
+// CHECK: %[[GID:.*]] = arith.addi
+// CHECK: arith.divui %[[GID]], %[[BX]] : index
+// CHECK: arith.remui %[[GID]], %[[BX]] : index
+// CHECK: %[[GID1:.*]] = arith.addi
+// CHECK: %[[C4:.*]] = arith.constant 4 : index
+// CHECK: arith.divui %[[GID1]], %[[C4]] : index
+// CHECK: arith.remui %[[GID1]], %[[C4]] : index
+// CHECK-LABEL: func.func @main
+// CHECK: gpu.launch_func @kernels::@copy {{.*}} args(%{{.*}} : memref<?x?xf32>, %arg1 : index)
+// CHECK: gpu.launch_func @kernels::@copy {{.*}} args(%{{.*}} : memref<?x?xf32>, %arg2 : index)
+module attributes {gpu.container_module} {
+  gpu.module @kernels {
+    gpu.func @copy(%arg0: memref<?x?xf32>) kernel {
+      %0 = gpu.thread_id x
+      %1 = gpu.thread_id y
+      %2 = memref.load %arg0[%1, %0] : memref<?x?xf32>
+      %3 = arith.addf %2, %2 : f32
+      memref.store %3, %arg0[%1, %0] : memref<?x?xf32>
+      gpu.return
+    }
+  }
+  func.func @main(%arg0: memref<?x?xf32>, %arg1: index, %arg2: index) {
+    %c1 = arith.constant 1 : index
+    %c4 = arith.constant 4 : index
+    gpu.launch_func @kernels::@copy blocks in (%c1, %c1, %c1) threads in (%arg1, %c4, %c1) args(%arg0 : memref<?x?xf32>)
+    gpu.launch_func @kernels::@copy blocks in (%c1, %c1, %c1) threads in (%arg2, %c4, %c1) args(%arg0 : memref<?x?xf32>)
+    return
+  }
+}
+
+// -----
+
+// Work items synchronizing or sharing workgroup memory depend on the group
+// size.
+// CHECK-LABEL: gpu.func @barrier
+// CHECK-NOT: imex.group_size_agnostic
+// CHECK: gpu.thread_id x
+// CHECK-LABEL: gpu.func @shared
+// CHECK-NOT: imex.group_size_agnostic
+// CHECK: gpu.thread_id x
+module attributes {gpu.container_module} {
+  gpu.module @kernels {
+    gpu.func @barrier(%arg0: memref<16xf32>) kernel {
+      %0 = gpu.thread_id x
+      %1 = memref.load %arg0[%0] : memref<16xf32>
+      gpu.barrier
+      memref.store %1, %arg0[%0] : memref<16xf32>
+      gpu.return
+    }
+    gpu.func @shared(%arg0: memref<16xf32>) workgroup(%arg1 : memref<16xf32, #gpu.address_space<workgroup>>) kernel {
+      %0 = gpu.thread_id x
+      %1 = memref.load %arg0[%0] : memref<16xf32>
+      memref.store %1, %arg1[%0] : memref<16xf32, #gpu.address_space<workgroup>>
+      gpu.return
+    }
+  }
+  func.func @main(%arg0: memref<16xf32>) {
+    %c1 = arith.constant 1 : index
+    %c16 = arith.constant 16 : index
+    gpu.launch_func @kernels::@barrier blocks in (%c1, %c1, %c1) threads in (%c16, %c1, %c1) args(%arg0 : memref<16xf32>)
+    gpu.launch_func @kernels::@shared blocks in (%c1, %c1, %c1) threads in (%c16, %c1, %c1) args(%arg0 : memref<16xf32>)
+    return
+  }
+}
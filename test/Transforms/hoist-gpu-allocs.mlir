@@ -0,0 +1,50 @@
+// RUN: imex-opt --split-input-file --hoist-gpu-allocs %s | FileCheck %s
+
+// The buffer is allocated once before the loop nest and freed after it.
+// CHECK-LABEL: func.func @test_hoist
+// CHECK-SAME: (%[[ARG0:.*]]: memref<?xf32>, %[[ARG1:.*]]: index)
+// CHECK: %[[BUF:.*]] = gpu.alloc (%[[ARG1]]) : memref<?xf32>
+// CHECK-NEXT: scf.for
+// CHECK-NEXT: scf.for
+// CHECK-NOT: gpu.alloc
+// CHECK-NOT: gpu.dealloc
+// CHECK: }
+// CHECK: }
+// CHECK-NEXT: gpu.dealloc %[[BUF]] : memref<?xf32>
+func.func @test_hoist(%arg0: memref<?xf32>, %arg1: index) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %c10 = arith.constant 10 : index
+  scf.for %i = %c0 to %c10 step %c1 {
+    scf.for %j = %c0 to %c10 step %c1 {
+      %0 = gpu.alloc (%arg1) : memref<?xf32>
+      memref.copy %arg0, %0 : memref<?xf32> to memref<?xf32>
+      memref.copy %0, %arg0 : memref<?xf32> to memref<?xf32>
+      gpu.dealloc %0 : memref<?xf32>
+    }
+  }
+  return
+}
+
+// -----
+
+// Buffers sized in the loop or yielded from it stay in the loop.
+// CHECK-LABEL: func.func @test_no_hoist
+// CHECK: scf.for
+// CHECK: gpu.alloc
+// CHECK: gpu.dealloc
+// CHECK: gpu.alloc
+// CHECK: scf.yield
+func.func @test_no_hoist(%arg0: memref<16xf32>) -> memref<16xf32> {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %c10 = arith.constant 10 : index
+  %r = scf.for %i = %c0 to %c10 step %c1 iter_args(%buf = %arg0) -> (memref<16xf32>) {
+    %0 = gpu.alloc (%i) : memref<?xf32>
+    gpu.dealloc %0 : memref<?xf32>
+    %1 = gpu.alloc () : memref<16xf32>
+    memref.copy %buf, %1 : memref<16xf32> to memref<16xf32>
+    scf.yield %1 : memref<16xf32>
+  }
+  return %r : memref<16xf32>
+}
@@ -0,0 +1,47 @@
+// RUN: imex-opt --insert-gpux-memory-hints %s | FileCheck %s
+
+module attributes {gpu.container_module} {
+  // CHECK-LABEL: func.func @main
+  func.func @main(%value : f32) {
+    %c0 = arith.constant 0 : index
+    %c1 = arith.constant 1 : index
+    %c8 = arith.constant 8 : index
+    // CHECK: %[[STREAM:.*]] = "gpux.create_stream"
+    %0 = "gpux.create_stream"() : () -> !gpux.StreamType
+    // CHECK: %[[WEIGHTS:.*]] = "gpux.alloc"
+    // CHECK-NEXT: "gpux.mem_advise"(%[[STREAM]], %[[WEIGHTS]]) <{advice = "read_mostly"}>
+    %weights = "gpux.alloc"(%0) {hostShared, operandSegmentSizes = array<i32: 0, 1, 0, 0>} : (!gpux.StreamType) -> memref<8xf32>
+    // CHECK: %[[OUT:.*]] = "gpux.alloc"
+    // CHECK-NOT: "gpux.mem_advise"
+    %out = "gpux.alloc"(%0) {hostShared, operandSegmentSizes = array<i32: 0, 1, 0, 0>} : (!gpux.StreamType) -> memref<8xf32>
+    // CHECK: %[[DEVICE:.*]] = "gpux.alloc"
+    %device = "gpux.alloc"(%0) {operandSegmentSizes = array<i32: 0, 1, 0, 0>} : (!gpux.StreamType) -> memref<8xf32>
+    // CHECK: memref.store
+    memref.store %value, %weights[%c0] : memref<8xf32>
+    // CHECK-NEXT: "gpux.prefetch"(%[[STREAM]], %[[WEIGHTS]])
+    // CHECK-NEXT: "gpux.prefetch"(%[[STREAM]], %[[OUT]])
+    // CHECK-NEXT: scf.for
+    scf.for %i = %c0 to %c8 step %c1 {
+      // CHECK-NOT: "gpux.prefetch"
+      // CHECK: "gpux.launch_func"
+      "gpux.launch_func"(%0, %c8, %c1, %c1, %c1, %c1, %c1, %weights, %out, %device) {kernel = @Kernels::@kernel, operandSegmentSizes = array<i32: 0, 1, 1, 1, 1, 1, 1, 1, 0, 3>} : (!gpux.StreamType, index, index, index, index, index, index, memref<8xf32>, memref<8xf32>, memref<8xf32>) -> ()
+    }
+    // CHECK-NOT: "gpux.prefetch"
+    "gpux.launch_func"(%0, %c8, %c1, %c1, %c1, %c1, %c1, %weights, %out, %device) {kernel = @Kernels::@kernel, operandSegmentSizes = array<i32: 0, 1, 1, 1, 1, 1, 1, 1, 0, 3>} : (!gpux.StreamType, index, index, index, index, index, index, memref<8xf32>, memref<8xf32>, memref<8xf32>) -> ()
+    "gpux.dealloc"(%0, %weights) : (!gpux.StreamType, memref<8xf32>) -> ()
+    "gpux.dealloc"(%0, %out) : (!gpux.StreamType, memref<8xf32>) -> ()
+    "gpux.dealloc"(%0, %device) : (!gpux.StreamType, memref<8xf32>) -> ()
+    "gpux.destroy_stream"(%0) : (!gpux.StreamType) -> ()
+    return
+  }
+  gpu.module @Kernels {
+    gpu.func @kernel(%arg0: memref<8xf32>, %arg1: memref<8xf32>, %arg2: memref<8xf32>) kernel {
+      %0 = gpu.block_id  x
+      %1 = memref.load %arg0[%0] : memref<8xf32>
+      %2 = memref.load %arg2[%0] : memref<8xf32>
+      %3 = arith.addf %1, %2 : f32
+      memref.store %3, %arg1[%0] : memref<8xf32>
+      gpu.return
+    }
+  }
+}
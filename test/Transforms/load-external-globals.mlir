@@ -0,0 +1,45 @@
+// RUN: imex-opt %s -split-input-file -imex-load-external-globals="data-dir=/data" -verify-diagnostics | FileCheck %s
+
+// CHECK-LABEL: func.func private @__imex_load_external_globals() {
+// CHECK:   %[[W:.*]] = memref.get_global @w : memref<2x3xf32>
+// CHECK:   %[[WP:.*]] = memref.get_global @w_path : memref<12xi8>
+// CHECK:   %[[WC:.*]] = memref.cast %[[W]] : memref<2x3xf32> to memref<*xf32>
+// CHECK:   %[[WPC:.*]] = memref.cast %[[WP]] : memref<12xi8> to memref<*xi8>
+// CHECK:   call @loadExternalDataF32(%[[WC]], %[[WPC]])
+// CHECK:   %[[B:.*]] = memref.get_global @b : memref<8xf16>
+// CHECK:   call @loadExternalDataF16(
+// CHECK:   return
+// CHECK: memref.global "private" constant @w_path : memref<12xi8> = dense<[47, 100, 97, 116, 97, 47, 119, 46, 110, 112, 121, 0]>
+// CHECK: func.func private @loadExternalDataF32(memref<*xf32>, memref<*xi8>) attributes {llvm.emit_c_interface}
+// CHECK: memref.global "private" constant @b_path : memref<12xi8> = dense<[47, 100, 97, 116, 97, 47, 98, 46, 98, 105, 110, 0]>
+// CHECK: func.func private @loadExternalDataF16(memref<*xf16>, memref<*xi8>) attributes {llvm.emit_c_interface}
+// CHECK-NOT: imex.external_data
+// CHECK: memref.global "private" @w : memref<2x3xf32> = uninitialized
+// CHECK: memref.global "private" @b : memref<8xf16> = uninitialized
+// CHECK: memref.global "private" constant @c : memref<2xf32> = dense<1.000000e+00>
+// CHECK-LABEL: func.func @main()
+// CHECK-NEXT: call @__imex_load_external_globals() : () -> ()
+memref.global "private" constant @w : memref<2x3xf32> {imex.external_data = "w.npy"}
+memref.global "private" @b : memref<8xf16> = uninitialized {imex.external_data = "/data/b.bin"}
+memref.global "private" constant @c : memref<2xf32> = dense<1.0>
+func.func @main() {
+  %0 = memref.get_global @w : memref<2x3xf32>
+  %1 = memref.get_global @b : memref<8xf16>
+  %2 = memref.get_global @c : memref<2xf32>
+  return
+}
+
+// -----
+
+// expected-error @below {{global with imex.external_data must not have an initial value}}
+memref.global "private" constant @w : memref<2xf32> = dense<1.0> {imex.external_data = "w.npy"}
+func.func @main() {
+  return
+}
+
+// -----
+
+// expected-error @below {{entry point 'main' not found}}
+module {
+  memref.global "private" constant @w : memref<2xf32> {imex.external_data = "w.npy"}
+}
@@ -0,0 +1,48 @@
+// RUN: imex-opt -imex-lower-memref-copy="use-memcpy=true" -allow-unregistered-dialect %s | FileCheck %s
+
+// Contiguous host copies are kept as memref.copy, which lowers to a memcpy.
+// CHECK-LABEL: func @copy_contiguous
+// CHECK: memref.copy %{{.*}}, %{{.*}} : memref<10x20xf32> to memref<10x20xf32>
+// CHECK-NOT: linalg.generic
+func.func @copy_contiguous(%arg0: memref<10x20xf32>) {
+  %alloc = memref.alloc() : memref<10x20xf32>
+  %alloc_0 = memref.alloc() : memref<10x20xf32>
+  memref.copy %alloc, %alloc_0 : memref<10x20xf32> to memref<10x20xf32>
+  "some_use" (%alloc) {} : (memref<10x20xf32>) -> ()
+  "some_use" (%alloc_0) {} : (memref<10x20xf32>) -> ()
+  return
+}
+
+// Copies to device buffers use the device runtime.
+// CHECK-LABEL: func @copy_device
+// CHECK: gpu.memcpy %{{.*}}, %{{.*}} : memref<10x20xf32>, memref<10x20xf32>
+// CHECK-NOT: memref.copy
+func.func @copy_device(%arg0: memref<10x20xf32>) {
+  %0 = gpu.alloc () : memref<10x20xf32>
+  memref.copy %arg0, %0 : memref<10x20xf32> to memref<10x20xf32>
+  "some_use" (%0) {} : (memref<10x20xf32>) -> ()
+  return
+}
+
+// Strided views with contiguous rows are copied row by row.
+// CHECK-LABEL: func @copy_rows
+// CHECK: scf.for %[[I:.*]] = %{{.*}} to %{{.*}} step %{{.*}} {
+// CHECK: %[[SRC:.*]] = memref.subview %{{.*}}[%[[I]], 0] [1, 8] [1, 1] : memref<4x8xf32, strided<[20, 1], offset: ?>> to memref<8xf32, strided<[1], offset: ?>>
+// CHECK: %[[DST:.*]] = memref.subview %{{.*}}[%[[I]], 0] [1, 8] [1, 1] : memref<4x8xf32> to memref<8xf32, strided<[1], offset: ?>>
+// CHECK: memref.copy %[[SRC]], %[[DST]]
+// CHECK-NOT: linalg.generic
+func.func @copy_rows(%arg0: memref<10x20xf32>, %arg1: memref<4x8xf32>) {
+  %0 = memref.subview %arg0[2, 4] [4, 8] [1, 1] : memref<10x20xf32> to memref<4x8xf32, strided<[20, 1], offset: ?>>
+  memref.copy %0, %arg1 : memref<4x8xf32, strided<[20, 1], offset: ?>> to memref<4x8xf32>
+  return
+}
+
+// Irregular views keep the generic lowering.
+// CHECK-LABEL: func @copy_irregular
+// CHECK: linalg.generic
+// CHECK-NOT: memref.copy
+func.func @copy_irregular(%arg0: memref<10x20xf32>, %arg1: memref<4x8xf32>) {
+  %0 = memref.subview %arg0[0, 0] [4, 8] [2, 2] : memref<10x20xf32> to memref<4x8xf32, strided<[40, 2]>>
+  memref.copy %0, %arg1 : memref<4x8xf32, strided<[40, 2]>> to memref<4x8xf32>
+  return
+}
@@ -0,0 +1,63 @@
+// RUN: imex-opt --split-input-file --imex-matmul-to-coop-matrix=device=pvc --cse %s | FileCheck %s
+// RUN: imex-opt --split-input-file --imex-matmul-to-coop-matrix --cse %s | FileCheck %s --check-prefix=NODEV
+
+// Without a device with DPAS units the matmuls are left to the loop lowering.
+// NODEV-NOT: gpu.subgroup_mma
+
+// CHECK-LABEL: func.func @matmul
+// CHECK-SAME: (%[[A:.*]]: memref<64x128xf16>, %[[B:.*]]: memref<128x32xf16>, %[[C:.*]]: memref<64x32xf32>)
+func.func @matmul(%A: memref<64x128xf16>, %B: memref<128x32xf16>, %C: memref<64x32xf32>) {
+  // CHECK-DAG: %[[C0:.*]] = arith.constant 0 : index
+  // CHECK-DAG: %[[C1:.*]] = arith.constant 1 : index
+  // CHECK-DAG: %[[C8:.*]] = arith.constant 8 : index
+  // CHECK-DAG: %[[C16:.*]] = arith.constant 16 : index
+  // CHECK-DAG: %[[C128:.*]] = arith.constant 128 : index
+  // CHECK-DAG: %[[C2:.*]] = arith.constant 2 : index
+  // CHECK: scf.parallel (%[[I:.*]], %[[J:.*]]) = (%[[C0]], %[[C0]]) to (%[[C8]], %[[C2]]) step (%[[C1]], %[[C1]]) {
+  // CHECK:   scf.parallel (%{{.*}}) = (%[[C0]]) to (%[[C16]]) step (%[[C1]]) {
+  // CHECK:     %[[M:.*]] = arith.muli %[[I]], %[[C8]] : index
+  // CHECK:     %[[N:.*]] = arith.muli %[[J]], %[[C16]] : index
+  // CHECK:     %[[ACC:.*]] = gpu.subgroup_mma_load_matrix %[[C]][%[[M]], %[[N]]] {leadDimension = 32 : index} : memref<64x32xf32> -> !gpu.mma_matrix<8x16xf32, "COp">
+  // CHECK:     %[[RES:.*]] = scf.for %[[K:.*]] = %[[C0]] to %[[C128]] step %[[C16]] iter_args(%[[ITER:.*]] = %[[ACC]])
+  // CHECK:       %[[AM:.*]] = gpu.subgroup_mma_load_matrix %[[A]][%[[M]], %[[K]]] {leadDimension = 128 : index} : memref<64x128xf16> -> !gpu.mma_matrix<8x16xf16, "AOp">
+  // CHECK:       %[[BM:.*]] = gpu.subgroup_mma_load_matrix %[[B]][%[[K]], %[[N]]] {leadDimension = 32 : index} : memref<128x32xf16> -> !gpu.mma_matrix<16x16xf16, "BOp">
+  // CHECK:       %[[NEW:.*]] = gpu.subgroup_mma_compute %[[AM]], %[[BM]], %[[ITER]] : !gpu.mma_matrix<8x16xf16, "AOp">, !gpu.mma_matrix<16x16xf16, "BOp"> -> !gpu.mma_matrix<8x16xf32, "COp">
+  // CHECK:       scf.yield %[[NEW]]
+  // CHECK:     gpu.subgroup_mma_store_matrix %[[RES]], %[[C]][%[[M]], %[[N]]] {leadDimension = 32 : index} : !gpu.mma_matrix<8x16xf32, "COp">, memref<64x32xf32>
+  // CHECK:   } {mapping = [#gpu.loop_dim_map<processor = thread_x, map = (d0) -> (d0), bound = (d0) -> (d0)>]}
+  // CHECK: } {mapping = [#gpu.loop_dim_map<processor = block_x, map = (d0) -> (d0), bound = (d0) -> (d0)>, #gpu.loop_dim_map<processor = block_y, map = (d0) -> (d0), bound = (d0) -> (d0)>]}
+  // CHECK-NOT: linalg.matmul
+  linalg.matmul ins(%A, %B : memref<64x128xf16>, memref<128x32xf16>) outs(%C : memref<64x32xf32>)
+  return
+}
+
+// -----
+
+// The batch is mapped to the z dimension of the grid.
+// CHECK-LABEL: func.func @batch_matmul
+// CHECK-SAME: (%[[A:.*]]: memref<4x16x32xf16>, %[[B:.*]]: memref<4x32x16xf16>, %[[C:.*]]: memref<4x16x16xf16>)
+func.func @batch_matmul(%A: memref<4x16x32xf16>, %B: memref<4x32x16xf16>, %C: memref<4x16x16xf16>) {
+  // CHECK: scf.parallel (%[[H:.*]], %{{.*}}, %{{.*}}) =
+  // CHECK: gpu.subgroup_mma_load_matrix %[[C]][%[[H]], %{{.*}}, %{{.*}}] {leadDimension = 16 : index} : memref<4x16x16xf16> -> !gpu.mma_matrix<8x16xf16, "COp">
+  // CHECK: gpu.subgroup_mma_load_matrix %[[A]][%[[H]], %{{.*}}, %{{.*}}] {leadDimension = 32 : index} : memref<4x16x32xf16> -> !gpu.mma_matrix<8x16xf16, "AOp">
+  // CHECK: gpu.subgroup_mma_load_matrix %[[B]][%[[H]], %{{.*}}, %{{.*}}] {leadDimension = 16 : index} : memref<4x32x16xf16> -> !gpu.mma_matrix<16x16xf16, "BOp">
+  // CHECK: gpu.subgroup_mma_store_matrix %{{.*}}, %[[C]][%[[H]], %{{.*}}, %{{.*}}] {leadDimension = 16 : index}
+  // CHECK: {mapping = [#gpu.loop_dim_map<processor = block_z, map = (d0) -> (d0), bound = (d0) -> (d0)>, #gpu.loop_dim_map<processor = block_x, map = (d0) -> (d0), bound = (d0) -> (d0)>, #gpu.loop_dim_map<processor = block_y, map = (d0) -> (d0), bound = (d0) -> (d0)>]}
+  linalg.batch_matmul ins(%A, %B : memref<4x16x32xf16>, memref<4x32x16xf16>) outs(%C : memref<4x16x16xf16>)
+  return
+}
+
+// -----
+
+// Matmuls on f32, or whose sizes are not multiples of the tiles, are left to
+// the loop lowering.
+// CHECK-LABEL: func.func @not_converted
+func.func @not_converted(%A: memref<64x128xf32>, %B: memref<128x32xf32>, %C: memref<64x32xf32>,
+                         %D: memref<12x128xf16>, %E: memref<128x32xf16>, %F: memref<12x32xf32>) {
+  // CHECK-NOT: gpu.subgroup_mma
+  // CHECK: linalg.matmul
+  // CHECK: linalg.matmul
+  linalg.matmul ins(%A, %B : memref<64x128xf32>, memref<128x32xf32>) outs(%C : memref<64x32xf32>)
+  linalg.matmul ins(%D, %E : memref<12x128xf16>, memref<128x32xf16>) outs(%F : memref<12x32xf32>)
+  return
+}
@@ -0,0 +1,51 @@
+// RUN: imex-opt --split-input-file --pack-gpu-allocs %s | FileCheck %s
+
+// %0 is dead once %1 is allocated, such that %1 reuses its memory, while %2
+// lives at the same time as %1 and is placed after it.
+// CHECK-LABEL: func.func @test_pack
+// CHECK: %[[ARENA:.*]] = gpu.alloc () : memref<2048xi8>
+// CHECK: %[[C0:.*]] = arith.constant 0 : index
+// CHECK: %[[V0:.*]] = memref.view %[[ARENA]][%[[C0]]][] : memref<2048xi8> to memref<256xf32>
+// CHECK: %[[C1:.*]] = arith.constant 0 : index
+// CHECK: %[[V1:.*]] = memref.view %[[ARENA]][%[[C1]]][] : memref<2048xi8> to memref<256xf32>
+// CHECK: %[[C2:.*]] = arith.constant 1024 : index
+// CHECK: %[[V2:.*]] = memref.view %[[ARENA]][%[[C2]]][] : memref<2048xi8> to memref<16x16xf32>
+// CHECK-NOT: gpu.alloc
+// CHECK: gpu.dealloc %[[ARENA]] : memref<2048xi8>
+// CHECK-NOT: gpu.dealloc
+func.func @test_pack(%arg0: memref<256xf32>) {
+  %c0 = arith.constant 0 : index
+  %cst = arith.constant 1.000000e+00 : f32
+  %0 = gpu.alloc () : memref<256xf32>
+  memref.store %cst, %0[%c0] : memref<256xf32>
+  memref.copy %0, %arg0 : memref<256xf32> to memref<256xf32>
+  %1 = gpu.alloc () : memref<256xf32>
+  %2 = gpu.alloc () : memref<16x16xf32>
+  memref.store %cst, %1[%c0] : memref<256xf32>
+  %3 = memref.collapse_shape %2 [[0, 1]] : memref<16x16xf32> into memref<256xf32>
+  memref.copy %1, %3 : memref<256xf32> to memref<256xf32>
+  memref.copy %3, %arg0 : memref<256xf32> to memref<256xf32>
+  gpu.dealloc %2 : memref<16x16xf32>
+  gpu.dealloc %1 : memref<256xf32>
+  gpu.dealloc %0 : memref<256xf32>
+  return
+}
+
+// -----
+
+// Buffers that escape or are dynamically sized are not packed.
+// CHECK-LABEL: func.func @test_no_pack
+// CHECK-NOT: memref.view
+// CHECK-COUNT-3: gpu.alloc
+func.func @test_no_pack(%arg0: index) -> memref<256xf32> {
+  %c0 = arith.constant 0 : index
+  %cst = arith.constant 1.000000e+00 : f32
+  %0 = gpu.alloc () : memref<256xf32>
+  %1 = gpu.alloc (%arg0) : memref<?xf32>
+  %2 = gpu.alloc () : memref<256xf32>
+  memref.store %cst, %1[%c0] : memref<?xf32>
+  memref.copy %2, %0 : memref<256xf32> to memref<256xf32>
+  gpu.dealloc %1 : memref<?xf32>
+  gpu.dealloc %2 : memref<256xf32>
+  return %0 : memref<256xf32>
+}
@@ -0,0 +1,72 @@
+// RUN: imex-opt --split-input-file --remove-redundant-gpu-copies %s | FileCheck %s
+
+module attributes {gpu.container_module} {
+  gpu.module @kernels {
+    gpu.func @kernel(%arg0: memref<8xf32>) kernel {
+      gpu.return
+    }
+  }
+
+  // The upload following the download of the same buffer is removed.
+  // CHECK-LABEL: func.func @test_download_upload
+  // CHECK-SAME: (%[[ARG0:.*]]: memref<8xf32>)
+  // CHECK: %[[BUF:.*]] = gpu.alloc () : memref<8xf32>
+  // CHECK-NEXT: memref.copy %[[ARG0]], %[[BUF]]
+  // CHECK-NEXT: gpu.launch_func {{.*}}@kernels::@kernel {{.*}} args(%[[BUF]] : memref<8xf32>)
+  // CHECK-NEXT: gpu.memcpy %[[ARG0]], %[[BUF]]
+  // CHECK-NEXT: gpu.launch_func {{.*}}@kernels::@kernel {{.*}} args(%[[BUF]] : memref<8xf32>)
+  // CHECK-NEXT: memref.copy %[[BUF]], %[[ARG0]]
+  // CHECK-NEXT: gpu.dealloc %[[BUF]]
+  func.func @test_download_upload(%arg0: memref<8xf32>) {
+    %c1 = arith.constant 1 : index
+    %0 = gpu.alloc () : memref<8xf32>
+    memref.copy %arg0, %0 : memref<8xf32> to memref<8xf32>
+    gpu.launch_func @kernels::@kernel blocks in (%c1, %c1, %c1) threads in (%c1, %c1, %c1) args(%0 : memref<8xf32>)
+    gpu.memcpy %arg0, %0 : memref<8xf32>, memref<8xf32>
+    memref.copy %arg0, %0 : memref<8xf32> to memref<8xf32>
+    gpu.launch_func @kernels::@kernel blocks in (%c1, %c1, %c1) threads in (%c1, %c1, %c1) args(%0 : memref<8xf32>)
+    memref.copy %0, %arg0 : memref<8xf32> to memref<8xf32>
+    gpu.dealloc %0 : memref<8xf32>
+    return
+  }
+
+  // The download is sunk past the kernel using another buffer, down to the
+  // host read.
+  // CHECK-LABEL: func.func @test_sink
+  // CHECK-SAME: (%[[ARG0:.*]]: memref<8xf32>)
+  // CHECK: %[[BUF0:.*]] = gpu.alloc () : memref<8xf32>
+  // CHECK: %[[BUF1:.*]] = gpu.alloc () : memref<8xf32>
+  // CHECK-NEXT: gpu.launch_func {{.*}}@kernels::@kernel {{.*}} args(%[[BUF0]] : memref<8xf32>)
+  // CHECK-NEXT: gpu.launch_func {{.*}}@kernels::@kernel {{.*}} args(%[[BUF1]] : memref<8xf32>)
+  // CHECK-NEXT: memref.copy %[[BUF0]], %[[ARG0]]
+  // CHECK-NEXT: memref.load %[[ARG0]]
+  func.func @test_sink(%arg0: memref<8xf32>) -> f32 {
+    %c0 = arith.constant 0 : index
+    %c1 = arith.constant 1 : index
+    %0 = gpu.alloc () : memref<8xf32>
+    %1 = gpu.alloc () : memref<8xf32>
+    gpu.launch_func @kernels::@kernel blocks in (%c1, %c1, %c1) threads in (%c1, %c1, %c1) args(%0 : memref<8xf32>)
+    memref.copy %0, %arg0 : memref<8xf32> to memref<8xf32>
+    gpu.launch_func @kernels::@kernel blocks in (%c1, %c1, %c1) threads in (%c1, %c1, %c1) args(%1 : memref<8xf32>)
+    %2 = memref.load %arg0[%c0] : memref<8xf32>
+    gpu.dealloc %1 : memref<8xf32>
+    gpu.dealloc %0 : memref<8xf32>
+    return %2 : f32
+  }
+
+  // Independent downloads before the return keep their order.
+  // CHECK-LABEL: func.func @test_two_downloads
+  // CHECK-SAME: (%[[ARG0:.*]]: memref<8xf32>, %[[ARG1:.*]]: memref<8xf32>)
+  // CHECK: %[[BUF0:.*]] = gpu.alloc () : memref<8xf32>
+  // CHECK: %[[BUF1:.*]] = gpu.alloc () : memref<8xf32>
+  // CHECK-NEXT: memref.copy %[[BUF0]], %[[ARG0]]
+  // CHECK-NEXT: memref.copy %[[BUF1]], %[[ARG1]]
+  // CHECK-NEXT: return
+  func.func @test_two_downloads(%arg0: memref<8xf32>, %arg1: memref<8xf32>) {
+    %0 = gpu.alloc () : memref<8xf32>
+    %1 = gpu.alloc () : memref<8xf32>
+    memref.copy %0, %arg0 : memref<8xf32> to memref<8xf32>
+    memref.copy %1, %arg1 : memref<8xf32> to memref<8xf32>
+    return
+  }
+}
@@ -299,4 +299,44 @@ module {
     // CHECK-NEXT:  }
     // CHECK-NEXT:  memref.copy
   }
+  func.func @ewbinop_loop_scratch(%arg0: memref<64xi64>, %arg1: memref<64xi64>, %arg2: memref<64xi64>) {
+    %c0 = arith.constant 0 : index
+    %c1 = arith.constant 1 : index
+    %c4 = arith.constant 4 : index
+    %alloc = memref.alloc() {alignment = 64 : i64} : memref<64xi64>
+    scf.for %i = %c0 to %c4 step %c1 {
+      linalg.generic {indexing_maps = [#map, #map, #map], iterator_types = ["parallel"]} ins(%arg0, %arg1 : memref<64xi64>, memref<64xi64>) outs(%alloc : memref<64xi64>) {
+      ^bb0(%in: i64, %in_0: i64, %out: i64):
+        %0 = arith.addi %in, %in_0 : i64
+        linalg.yield %0 : i64
+      }
+      memref.copy %alloc, %arg2 : memref<64xi64> to memref<64xi64>
+    }
+    memref.dealloc %alloc : memref<64xi64>
+    return
+    // NOTE: alloc is a scratch buffer of the loop body, copy can be removed
+    // CHECK-LABEL: func @ewbinop_loop_scratch
+    // CHECK-NOT:   memref.alloc
+    // CHECK:       scf.for
+    // CHECK-NEXT:  linalg.generic {{.*}} outs(%arg2 : memref<64xi64>)
+    // CHECK-NOT:   memref.copy
+    // CHECK-NOT:   memref.dealloc
+  }
+  func.func @ewbinop_inplace_dynamic(%arg0: memref<128xi64>, %arg1: memref<64xi64>, %arg2: index) {
+    %subview = memref.subview %arg0[%arg2] [64] [1] : memref<128xi64> to memref<64xi64, strided<[1], offset: ?>>
+    %alloc = memref.alloc() {alignment = 64 : i64} : memref<64xi64>
+    linalg.generic {indexing_maps = [#map, #map, #map], iterator_types = ["parallel"]} ins(%subview, %arg1 : memref<64xi64, strided<[1], offset: ?>>, memref<64xi64>) outs(%alloc : memref<64xi64>) {
+    ^bb0(%in: i64, %in_0: i64, %out: i64):
+      %0 = arith.addi %in, %in_0 : i64
+      linalg.yield %0 : i64
+    }
+    memref.copy %alloc, %subview : memref<64xi64> to memref<64xi64, strided<[1], offset: ?>>
+    memref.dealloc %alloc : memref<64xi64>
+    return
+    // NOTE: a = a + b reads the elements it writes, copy can be removed
+    // CHECK-LABEL: func @ewbinop_inplace_dynamic
+    // CHECK-NEXT:  %[[SV:.*]] = memref.subview
+    // CHECK-NEXT:  linalg.generic {{.*}} ins(%[[SV]], %arg1 : {{.*}}) outs(%[[SV]] : memref<64xi64, strided<[1], offset: ?>>)
+    // CHECK-NOT:   memref.copy
+  }
 }
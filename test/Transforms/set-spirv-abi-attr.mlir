@@ -17,3 +17,13 @@ gpu.module @main_kernel {
     gpu.return
   }
 }
+
+// Kernels allocating workgroup memory are fixed to their workgroup size.
+gpu.module @slm_kernel {
+  // OPENCL: gpu.func @slm_kernel() kernel attributes {VectorComputeFunctionINTEL, known_block_size = array<i32: 32, 8, 1>, spirv.entry_point_abi = #spirv.entry_point_abi<workgroup_size = [32, 8, 1]>} {
+  gpu.func @slm_kernel() kernel attributes {known_block_size = array<i32: 32, 8, 1>} {
+    %0 = memref.alloc() : memref<32x33xf32, 3>
+    gpu.barrier
+    gpu.return
+  }
+}
@@ -0,0 +1,33 @@
+// RUN: imex-opt --split-input-file -tile-loops='auto-tile-sizes=true' %s -verify-diagnostics -o -| FileCheck %s
+
+// The tiles are halved until the 1024 EUs of the device get one each.
+#map = affine_map<(d0, d1) -> (d0, d1)>
+module {
+  func.func @add_2d(%arg0: tensor<1024x1024xf32>, %arg1: tensor<1024x1024xf32>) -> tensor<1024x1024xf32> {
+    %0 = linalg.generic {indexing_maps = [#map, #map], iterator_types = ["parallel", "parallel"]} ins(%arg0 : tensor<1024x1024xf32>) outs(%arg1 : tensor<1024x1024xf32>) {
+    ^bb0(%in: f32, %out: f32):
+      %1 = arith.addf %in, %out : f32
+      linalg.yield %1 : f32
+    } -> tensor<1024x1024xf32>
+    return %0 : tensor<1024x1024xf32>
+  }
+}
+// CHECK-LABEL: func.func @add_2d
+// CHECK-NEXT: scf.forall ({{.*}}) = (0, 0) to (1024, 1024) step (32, 32)
+
+// -----
+
+// The innermost tile keeps a whole subgroup of 16 elements.
+#map = affine_map<(d0) -> (d0)>
+module {
+  func.func @add_1d(%arg0: tensor<129xf32>, %arg1: tensor<129xf32>) -> tensor<129xf32> {
+    %0 = linalg.generic {indexing_maps = [#map, #map], iterator_types = ["parallel"]} ins(%arg0 : tensor<129xf32>) outs(%arg1 : tensor<129xf32>) {
+    ^bb0(%in: f32, %out: f32):
+      %1 = arith.addf %in, %out : f32
+      linalg.yield %1 : f32
+    } -> tensor<129xf32>
+    return %0 : tensor<129xf32>
+  }
+}
+// CHECK-LABEL: func.func @add_1d
+// CHECK-NEXT: scf.forall ({{.*}}) = (0) to (129) step (16)
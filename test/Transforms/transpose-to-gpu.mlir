@@ -0,0 +1,92 @@
+// RUN: imex-opt --split-input-file --imex-transpose-to-gpu %s | FileCheck %s
+
+#map = affine_map<(d0, d1) -> (d0, d1)>
+#map1 = affine_map<(d0, d1) -> (d1, d0)>
+
+// The input is read along rows and the output written along rows through a
+// padded tile in workgroup memory.
+// CHECK-LABEL: func.func @transpose_2d
+// CHECK-SAME: (%[[IN:.*]]: memref<128x136xf32>, %[[OUT:.*]]: memref<136x128xf32>)
+// CHECK-DAG: %[[C1:.*]] = arith.constant 1 : index
+// CHECK-DAG: %[[C32:.*]] = arith.constant 32 : index
+// CHECK-DAG: %[[C8:.*]] = arith.constant 8 : index
+// CHECK-DAG: %[[C5:.*]] = arith.constant 5 : index
+// CHECK-DAG: %[[C4:.*]] = arith.constant 4 : index
+// CHECK: gpu.launch blocks(%{{.*}}, %{{.*}}, %{{.*}}) in (%{{.*}} = %[[C5]], %{{.*}} = %[[C4]], %{{.*}} = %[[C1]]) threads(%[[TX:.*]], %{{.*}}, %{{.*}}) in (%{{.*}} = %[[C32]], %{{.*}} = %[[C8]], %{{.*}} = %[[C1]])
+// CHECK: %[[SLM:.*]] = memref.alloc() : memref<32x33xf32, 3>
+// CHECK: scf.for
+// CHECK: scf.if
+// CHECK: %[[V:.*]] = memref.load %[[IN]][%{{.*}}, %{{.*}}] : memref<128x136xf32>
+// CHECK: memref.store %[[V]], %[[SLM]][%{{.*}}, %[[TX]]] : memref<32x33xf32, 3>
+// CHECK: gpu.barrier
+// CHECK: scf.for
+// CHECK: scf.if
+// CHECK: %[[W:.*]] = memref.load %[[SLM]][%[[TX]], %{{.*}}] : memref<32x33xf32, 3>
+// CHECK: memref.store %[[W]], %[[OUT]][%{{.*}}, %{{.*}}] : memref<136x128xf32>
+// CHECK: gpu.terminator
+// CHECK-NOT: linalg.generic
+func.func @transpose_2d(%in: memref<128x136xf32>, %out: memref<136x128xf32>) {
+  linalg.generic {indexing_maps = [#map, #map1], iterator_types = ["parallel", "parallel"]} ins(%in : memref<128x136xf32>) outs(%out : memref<136x128xf32>) {
+  ^bb0(%a: f32, %b: f32):
+    linalg.yield %a : f32
+  }
+  return
+}
+
+// -----
+
+// Dimensions other than the transposed ones are linearized into the z
+// dimension of the grid.
+// CHECK-LABEL: func.func @transpose_3d
+// CHECK-DAG: %[[C3:.*]] = arith.constant 3 : index
+// CHECK-DAG: %[[C7:.*]] = arith.constant 7 : index
+// CHECK: gpu.launch blocks(%{{.*}}, %{{.*}}, %[[BZ:.*]]) in (%{{.*}} = %[[C3]], %{{.*}} = %{{.*}}, %{{.*}} = %[[C7]])
+// CHECK: arith.remui %[[BZ]], %[[C7]] : index
+// CHECK: memref.alloc() : memref<32x33xf16, 3>
+// CHECK: gpu.barrier
+// CHECK-NOT: linalg.transpose
+func.func @transpose_3d(%in: memref<16x7x96xf16>, %out: memref<96x7x16xf16>) {
+  linalg.transpose ins(%in : memref<16x7x96xf16>) outs(%out : memref<96x7x16xf16>) permutation = [2, 1, 0]
+  return
+}
+
+// -----
+
+#map = affine_map<(d0, d1) -> (d0, d1)>
+#map1 = affine_map<(d0, d1) -> (d1, d0)>
+
+// The elements are computed before they are stored to workgroup memory,
+// which has the element type of the output.
+// CHECK-LABEL: func.func @transpose_extf
+// CHECK-SAME: (%[[IN:.*]]: memref<?x?xf16>, %[[OUT:.*]]: memref<?x?xf32>)
+// CHECK: %[[D0:.*]] = memref.dim %[[IN]], %{{.*}} : memref<?x?xf16>
+// CHECK: %[[D1:.*]] = memref.dim %[[IN]], %{{.*}} : memref<?x?xf16>
+// CHECK: %[[GX:.*]] = arith.ceildivui %[[D1]], %{{.*}} : index
+// CHECK: %[[GY:.*]] = arith.ceildivui %[[D0]], %{{.*}} : index
+// CHECK: gpu.launch blocks(%{{.*}}, %{{.*}}, %{{.*}}) in (%{{.*}} = %[[GX]], %{{.*}} = %[[GY]], %{{.*}} = %{{.*}})
+// CHECK: %[[SLM:.*]] = memref.alloc() : memref<32x33xf32, 3>
+// CHECK: arith.cmpi ult, %{{.*}}, %[[D0]] : index
+// CHECK: arith.cmpi ult, %{{.*}}, %[[D1]] : index
+// CHECK: %[[V:.*]] = memref.load %[[IN]]
+// CHECK: %[[E:.*]] = arith.extf %[[V]] : f16 to f32
+// CHECK: memref.store %[[E]], %[[SLM]]
+func.func @transpose_extf(%in: memref<?x?xf16>, %out: memref<?x?xf32>) {
+  linalg.generic {indexing_maps = [#map, #map1], iterator_types = ["parallel", "parallel"]} ins(%in : memref<?x?xf16>) outs(%out : memref<?x?xf32>) {
+  ^bb0(%a: f16, %b: f32):
+    %e = arith.extf %a : f16 to f32
+    linalg.yield %e : f32
+  }
+  return
+}
+
+// -----
+
+// Permutations keeping the innermost dimension are left to the loop
+// lowering.
+// CHECK-LABEL: func.func @not_converted
+// CHECK-NOT: gpu.launch
+// CHECK: linalg.transpose
+func.func @not_converted(%in: memref<16x7x96xf32>, %out: memref<7x16x96xf32>) {
+  linalg.transpose ins(%in : memref<16x7x96xf32>) outs(%out : memref<7x16x96xf32>) permutation = [1, 0, 2]
+  return
+}
@@ -50,3 +50,67 @@ func.func @test_hoist_transpose_1(%arg0: memref<64x64xf16>) -> vector<16x16xf16>
   %14 = arith.addf %12, %13 : vector<16x16xf16>
   return %14 : vector<16x16xf16>
 }
+
+// -----
+// CHECK-LABEL: func.func @test_hoist_transpose_elementwise(
+// CHECK: %[[T1:.*]] = xegpu.load_nd %{{.*}} : !xegpu.tensor_desc<16x32xf16> -> vector<16x32xf16>
+// CHECK-NEXT: %[[T2:.*]] = vector.transpose %[[T1]], [1, 0] : vector<16x32xf16> to vector<32x16xf16>
+// CHECK-NEXT: %[[T3:.*]] = arith.extf %[[T2]] : vector<32x16xf16> to vector<32x16xf32>
+// CHECK-NEXT: %[[T4:.*]] = arith.mulf %[[T3]], %{{.*}} : vector<32x16xf32>
+// CHECK-NEXT: return %[[T4]] : vector<32x16xf32>
+func.func @test_hoist_transpose_elementwise(%arg0: memref<64x64xf16>) -> vector<32x16xf32> {
+  %c0 = arith.constant 0 : index
+  %cst = arith.constant dense<2.000000e+00> : vector<16x32xf32>
+  %0 = xegpu.create_nd_tdesc %arg0[%c0, %c0] : memref<64x64xf16> -> !xegpu.tensor_desc<16x32xf16>
+  %1 = xegpu.load_nd %0 : !xegpu.tensor_desc<16x32xf16> -> vector<16x32xf16>
+  %2 = arith.extf %1 : vector<16x32xf16> to vector<16x32xf32>
+  %3 = arith.mulf %2, %cst : vector<16x32xf32>
+  %4 = vector.transpose %3, [1, 0] : vector<16x32xf32> to vector<32x16xf32>
+  return %4 : vector<32x16xf32>
+}
+
+// -----
+// Transposes are not hoisted if both operands need one, and cancelling pairs
+// are folded.
+// CHECK-LABEL: func.func @test_no_hoist_transpose_elementwise(
+// CHECK-SAME: %[[ARG0:[0-9a-zA-Z]+]]: vector<16x32xf16>, %[[ARG1:[0-9a-zA-Z]+]]: vector<16x32xf16>)
+// CHECK: %[[T0:.*]] = arith.addf %[[ARG0]], %[[ARG1]] : vector<16x32xf16>
+// CHECK-NEXT: %[[T1:.*]] = vector.transpose %[[T0]], [1, 0] : vector<16x32xf16> to vector<32x16xf16>
+// CHECK-NEXT: return %[[T1]], %[[ARG0]] : vector<32x16xf16>, vector<16x32xf16>
+func.func @test_no_hoist_transpose_elementwise(%arg0: vector<16x32xf16>, %arg1: vector<16x32xf16>) -> (vector<32x16xf16>, vector<16x32xf16>) {
+  %0 = arith.addf %arg0, %arg1 : vector<16x32xf16>
+  %1 = vector.transpose %0, [1, 0] : vector<16x32xf16> to vector<32x16xf16>
+  %2 = vector.transpose %arg0, [1, 0] : vector<16x32xf16> to vector<32x16xf16>
+  %3 = vector.transpose %2, [1, 0] : vector<32x16xf16> to vector<16x32xf16>
+  return %1, %3 : vector<32x16xf16>, vector<16x32xf16>
+}
+
+// -----
+// The transpose of the loop-carried B is moved out of the loop, next to the
+// loads producing the init and yielded values.
+// CHECK-LABEL: func.func @test_hoist_transpose_loop(
+// CHECK: %[[T1:.*]] = xegpu.load_nd %{{.*}} : !xegpu.tensor_desc<16x16xf16> -> vector<16x16xf16>
+// CHECK: %[[T2:.*]] = vector.transpose %[[T1]], [1, 0] : vector<16x16xf16> to vector<16x16xf16>
+// CHECK: %[[R:.*]]:3 = scf.for {{.*}} iter_args(%{{.*}} = %{{.*}}, %[[B:.*]] = %[[T2]], %[[ACC:.*]] = %{{.*}})
+// CHECK-NOT: vector.transpose
+// CHECK: xegpu.dpas %{{.*}}, %[[B]], %[[ACC]]
+// CHECK: %[[T3:.*]] = xegpu.load_nd %{{.*}} : !xegpu.tensor_desc<16x16xf16> -> vector<16x16xf16>
+// CHECK: %[[T4:.*]] = vector.transpose %[[T3]], [1, 0] : vector<16x16xf16> to vector<16x16xf16>
+// CHECK: scf.yield %{{.*}}, %[[T4]], %{{.*}}
+// CHECK: return %[[R]]#2 : vector<8x16xf32>
+func.func @test_hoist_transpose_loop(%arg0: memref<64x64xf16>, %a: vector<8x16xf16>) -> vector<8x16xf32> {
+  %c0 = arith.constant 0 : index
+  %c16 = arith.constant 16 : index
+  %c64 = arith.constant 64 : index
+  %cst = arith.constant dense<0.000000e+00> : vector<8x16xf32>
+  %0 = xegpu.create_nd_tdesc %arg0[%c0, %c0] : memref<64x64xf16> -> !xegpu.tensor_desc<16x16xf16>
+  %1 = xegpu.load_nd %0 : !xegpu.tensor_desc<16x16xf16> -> vector<16x16xf16>
+  %2:3 = scf.for %k = %c0 to %c64 step %c16 iter_args(%t = %0, %b = %1, %acc = %cst) -> (!xegpu.tensor_desc<16x16xf16>, vector<16x16xf16>, vector<8x16xf32>) {
+    %3 = vector.transpose %b, [1, 0] : vector<16x16xf16> to vector<16x16xf16>
+    %4 = xegpu.dpas %a, %3, %acc : vector<8x16xf16>, vector<16x16xf16>, vector<8x16xf32> -> vector<8x16xf32>
+    %5 = xegpu.update_nd_offset %t, [%c16, %c0] : !xegpu.tensor_desc<16x16xf16>
+    %6 = xegpu.load_nd %5 : !xegpu.tensor_desc<16x16xf16> -> vector<16x16xf16>
+    scf.yield %5, %6, %4 : !xegpu.tensor_desc<16x16xf16>, vector<16x16xf16>, vector<8x16xf32>
+  }
+  return %2#2 : vector<8x16xf32>
+}
@@ -0,0 +1,78 @@
+// RUN: imex-opt %s -split-input-file -imex-xegpu-merge-block-loads | FileCheck %s
+
+// CHECK-LABEL: @test_merge_two
+// CHECK-SAME: (%[[ARG0:[a-zA-Z0-9]+]]: memref<64x64xf16>)
+// CHECK: %[[T0:.*]] = xegpu.create_nd_tdesc %[[ARG0]][%{{.*}}, %{{.*}}] : memref<64x64xf16> -> !xegpu.tensor_desc<8x16xf16, #xegpu.block_tdesc_attr<array_length = 2 : i64>>
+// CHECK: %[[T1:.*]] = xegpu.load_nd %[[T0]] : !xegpu.tensor_desc<8x16xf16, #xegpu.block_tdesc_attr<array_length = 2 : i64>> -> vector<2x8x16xf16>
+// CHECK: %[[T2:.*]] = vector.extract %[[T1]][0] : vector<8x16xf16> from vector<2x8x16xf16>
+// CHECK: %[[T3:.*]] = vector.extract %[[T1]][1] : vector<8x16xf16> from vector<2x8x16xf16>
+// CHECK-NOT: xegpu.load_nd
+// CHECK: arith.addf %[[T2]], %[[T3]] : vector<8x16xf16>
+func.func @test_merge_two(%arg0: memref<64x64xf16>) -> vector<8x16xf16> {
+  %c0 = arith.constant 0 : index
+  %c16 = arith.constant 16 : index
+  %0 = xegpu.create_nd_tdesc %arg0[%c0, %c0] : memref<64x64xf16> -> !xegpu.tensor_desc<8x16xf16>
+  %1 = xegpu.create_nd_tdesc %arg0[%c0, %c16] : memref<64x64xf16> -> !xegpu.tensor_desc<8x16xf16>
+  %2 = xegpu.load_nd %0 : !xegpu.tensor_desc<8x16xf16> -> vector<8x16xf16>
+  %3 = xegpu.load_nd %1 : !xegpu.tensor_desc<8x16xf16> -> vector<8x16xf16>
+  %4 = arith.addf %2, %3 : vector<8x16xf16>
+  return %4 : vector<8x16xf16>
+}
+
+// -----
+
+// The width restriction of f16 loads allows 32 columns, so four 8 wide
+// blocks at dynamic offsets are merged into one load.
+// CHECK-LABEL: @test_merge_four_dynamic
+// CHECK-SAME: (%[[ARG0:[a-zA-Z0-9]+]]: memref<64x64xf16>, %[[ARG1:[a-zA-Z0-9]+]]: index, %[[ARG2:[a-zA-Z0-9]+]]: index)
+// CHECK: %[[T0:.*]] = xegpu.create_nd_tdesc %[[ARG0]][%[[ARG1]], %[[ARG2]]] : memref<64x64xf16> -> !xegpu.tensor_desc<16x8xf16, #xegpu.block_tdesc_attr<array_length = 4 : i64>>
+// CHECK: %[[T1:.*]] = xegpu.load_nd %[[T0]] <{l1_hint = #xegpu.cache_hint<cached>}> : !xegpu.tensor_desc<16x8xf16, #xegpu.block_tdesc_attr<array_length = 4 : i64>> -> vector<4x16x8xf16>
+// CHECK-COUNT-4: vector.extract %[[T1]][{{.*}}] : vector<16x8xf16> from vector<4x16x8xf16>
+// CHECK-NOT: xegpu.load_nd
+func.func @test_merge_four_dynamic(%arg0: memref<64x64xf16>, %arg1: index, %arg2: index) -> (vector<16x8xf16>, vector<16x8xf16>, vector<16x8xf16>, vector<16x8xf16>) {
+  %c8 = arith.constant 8 : index
+  %c16 = arith.constant 16 : index
+  %c24 = arith.constant 24 : index
+  %y1 = arith.addi %arg2, %c8 : index
+  %y2 = arith.addi %arg2, %c16 : index
+  %y3 = arith.addi %arg2, %c24 : index
+  %0 = xegpu.create_nd_tdesc %arg0[%arg1, %y2] : memref<64x64xf16> -> !xegpu.tensor_desc<16x8xf16>
+  %1 = xegpu.create_nd_tdesc %arg0[%arg1, %arg2] : memref<64x64xf16> -> !xegpu.tensor_desc<16x8xf16>
+  %2 = xegpu.create_nd_tdesc %arg0[%arg1, %y3] : memref<64x64xf16> -> !xegpu.tensor_desc<16x8xf16>
+  %3 = xegpu.create_nd_tdesc %arg0[%arg1, %y1] : memref<64x64xf16> -> !xegpu.tensor_desc<16x8xf16>
+  %4 = xegpu.load_nd %0 <{l1_hint = #xegpu.cache_hint<cached>}> : !xegpu.tensor_desc<16x8xf16> -> vector<16x8xf16>
+  %5 = xegpu.load_nd %1 <{l1_hint = #xegpu.cache_hint<cached>}> : !xegpu.tensor_desc<16x8xf16> -> vector<16x8xf16>
+  %6 = xegpu.load_nd %2 <{l1_hint = #xegpu.cache_hint<cached>}> : !xegpu.tensor_desc<16x8xf16> -> vector<16x8xf16>
+  %7 = xegpu.load_nd %3 <{l1_hint = #xegpu.cache_hint<cached>}> : !xegpu.tensor_desc<16x8xf16> -> vector<16x8xf16>
+  return %4, %5, %6, %7 : vector<16x8xf16>, vector<16x8xf16>, vector<16x8xf16>, vector<16x8xf16>
+}
+
+// -----
+
+// Blocks that are not adjacent, loads of other rows, packed loads and loads
+// separated by a store are not merged.
+// CHECK-LABEL: @test_no_merge
+// CHECK-COUNT-8: xegpu.load_nd {{.*}}-> vector<{{.*}}>
+// CHECK-NOT: array_length
+func.func @test_no_merge(%arg0: memref<64x64xf16>, %arg1: vector<8x16xf16>) {
+  %c0 = arith.constant 0 : index
+  %c8 = arith.constant 8 : index
+  %c16 = arith.constant 16 : index
+  %c32 = arith.constant 32 : index
+  %0 = xegpu.create_nd_tdesc %arg0[%c0, %c0] : memref<64x64xf16> -> !xegpu.tensor_desc<8x16xf16>
+  %1 = xegpu.create_nd_tdesc %arg0[%c0, %c32] : memref<64x64xf16> -> !xegpu.tensor_desc<8x16xf16>
+  %2 = xegpu.create_nd_tdesc %arg0[%c8, %c16] : memref<64x64xf16> -> !xegpu.tensor_desc<8x16xf16>
+  %3 = xegpu.create_nd_tdesc %arg0[%c0, %c16] : memref<64x64xf16> -> !xegpu.tensor_desc<8x16xf16>
+  %4 = xegpu.load_nd %0 : !xegpu.tensor_desc<8x16xf16> -> vector<8x16xf16>
+  %5 = xegpu.load_nd %1 : !xegpu.tensor_desc<8x16xf16> -> vector<8x16xf16>
+  %6 = xegpu.load_nd %2 : !xegpu.tensor_desc<8x16xf16> -> vector<8x16xf16>
+  xegpu.store_nd %arg1, %0 : vector<8x16xf16>, !xegpu.tensor_desc<8x16xf16>
+  %7 = xegpu.load_nd %3 : !xegpu.tensor_desc<8x16xf16> -> vector<8x16xf16>
+  %8 = xegpu.load_nd %0 <{packed}> : !xegpu.tensor_desc<8x16xf16> -> vector<4x16x2xf16>
+  %9 = xegpu.load_nd %3 <{packed}> : !xegpu.tensor_desc<8x16xf16> -> vector<4x16x2xf16>
+  xegpu.store_nd %arg1, %0 : vector<8x16xf16>, !xegpu.tensor_desc<8x16xf16>
+  %10 = xegpu.load_nd %0 : !xegpu.tensor_desc<8x16xf16> -> vector<8x16xf16>
+  gpu.barrier
+  %11 = xegpu.load_nd %3 : !xegpu.tensor_desc<8x16xf16> -> vector<8x16xf16>
+  return
+}
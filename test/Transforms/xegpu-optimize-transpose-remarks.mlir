@@ -0,0 +1,11 @@
+// RUN: imex-opt %s -imex-xegpu-optimize-transpose="remarks=-" -verify-diagnostics -o /dev/null
+
+// A 16x16xf32 transpose can neither be done by the load nor through SLM.
+func.func @test_too_large(%arg0 : memref<64x64xf32>) -> vector<16x16xf32> {
+  %c0 = arith.constant 0 : index
+  %0 = xegpu.create_nd_tdesc %arg0[%c0, %c0] : memref<64x64xf32> -> !xegpu.tensor_desc<16x16xf32, #xegpu.block_tdesc_attr<array_length = 1 : i64>>
+  %1 = xegpu.load_nd %0 : !xegpu.tensor_desc<16x16xf32, #xegpu.block_tdesc_attr<array_length = 1 : i64>> -> vector<16x16xf32>
+  // expected-remark@+1 {{UnfusedTranspose: not fused with the load: total data size is larger than 512 bytes.}}
+  %2 = vector.transpose %1, [1, 0] : vector<16x16xf32> to vector<16x16xf32>
+  return %2 : vector<16x16xf32>
+}
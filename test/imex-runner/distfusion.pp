@@ -7,6 +7,7 @@ builtin.module(
     convert-dist-to-standard
     canonicalize
     overlap-comm-and-compute
+    batch-allreduces
     add-comm-cache-keys
     lower-distruntime-to-idtr
     convert-ndarray-to-linalg
@@ -0,0 +1,19 @@
+// RUN: rm -rf %t
+// RUN: %python_executable %imex_runner -i %s -p "builtin.module(convert-func-to-llvm,reconcile-unrealized-casts)" -e main --entry-point-result=i32 --object-cache-dir=%t | FileCheck %s
+// RUN: ls %t | FileCheck %s --check-prefix=CACHE
+// The second run loads the cached object.
+// RUN: %python_executable %imex_runner -i %s -p "builtin.module(convert-func-to-llvm,reconcile-unrealized-casts)" -e main --entry-point-result=i32 --object-cache-dir=%t | FileCheck %s
+// RUN: ls %t | FileCheck %s --check-prefix=CACHE
+
+module {
+  func.func @main() -> i32 {
+    %c40 = arith.constant 40 : i32
+    %c2 = arith.constant 2 : i32
+    %0 = arith.addi %c40, %c2 : i32
+    return %0 : i32
+  }
+}
+
+// CHECK: 42
+// CACHE: {{^[0-9a-f]+}}.o
+// CACHE-NOT: .o
@@ -26,15 +26,324 @@
 //
 //===----------------------------------------------------------------------===//
 
-// This file is copied from upstream mlir-cpu-runner
+// This file started as a copy of upstream mlir-cpu-runner
 // https://github.com/llvm/llvm-project/blob/main/mlir/tools/mlir-cpu-runner/mlir-cpu-runner.cpp
+//
+// Instead of mlir::JitRunnerMain it drives an ORC LLJIT itself, so that the
+// compiled objects can be kept in a persistent object cache: with
+// --object-cache-dir (or IMEX_CPU_RUNNER_CACHE_DIR) the object of a module is
+// stored on disk, keyed by a hash of the input IR, the optimization level, the
+// target and the LLVM version, and later runs of the same input skip the
+// translation to LLVM IR, the optimization and the code generation.
+//
+// Global constructors of cached objects are not run; MLIR modules have none
+// unless they define llvm.mlir.global_ctors.
 
-#include "mlir/ExecutionEngine/JitRunner.h"
+#include "mlir/Dialect/LLVMIR/LLVMDialect.h"
+#include "mlir/ExecutionEngine/ExecutionEngine.h"
+#include "mlir/ExecutionEngine/OptUtils.h"
+#include "mlir/IR/BuiltinOps.h"
 #include "mlir/IR/Dialect.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/Parser/Parser.h"
 #include "mlir/Target/LLVMIR/Dialect/All.h"
+#include "mlir/Target/LLVMIR/Export.h"
 
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/ExecutionEngine/ObjectCache.h"
+#include "llvm/ExecutionEngine/Orc/CompileUtils.h"
+#include "llvm/ExecutionEngine/Orc/ExecutionUtils.h"
+#include "llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h"
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/DynamicLibrary.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/SHA256.h"
+#include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <cstdlib>
+#include <optional>
+
+namespace cl = llvm::cl;
+
+static cl::opt<std::string> inputFilename(cl::Positional,
+                                          cl::desc("<input file>"),
+                                          cl::init("-"));
+static cl::opt<std::string>
+    mainFuncName("e", cl::desc("The function to be called"),
+                 cl::value_desc("<function name>"), cl::init("main"));
+static cl::opt<std::string> mainFuncType(
+    "entry-point-result",
+    cl::desc("Textual description of the function type to be called"),
+    cl::value_desc("f32 | i32 | i64 | void"), cl::init("f32"));
+
+static cl::OptionCategory optFlags("opt-like flags");
+static cl::opt<bool> optO0("O0", cl::desc("Run opt passes and codegen at O0"),
+                           cl::cat(optFlags));
+static cl::opt<bool> optO1("O1", cl::desc("Run opt passes and codegen at O1"),
+                           cl::cat(optFlags));
+static cl::opt<bool> optO2("O2", cl::desc("Run opt passes and codegen at O2"),
+                           cl::cat(optFlags));
+static cl::opt<bool> optO3("O3", cl::desc("Run opt passes and codegen at O3"),
+                           cl::cat(optFlags));
+
+static cl::OptionCategory clOptionsCategory("linking options");
+static cl::list<std::string>
+    clSharedLibs("shared-libs", cl::desc("Libraries to link dynamically"),
+                 cl::MiscFlags::CommaSeparated, cl::cat(clOptionsCategory));
+
+static cl::opt<std::string> objectCacheDir(
+    "object-cache-dir",
+    cl::desc("Directory to keep the compiled objects in across runs "
+             "(default: $IMEX_CPU_RUNNER_CACHE_DIR, no cache if unset)"),
+    cl::init(""));
+
+namespace {
+
+/// Stores the objects compiled by the JIT in a directory, one file per
+/// module named by the module identifier, which is the cache key.
+class PersistentObjectCache : public llvm::ObjectCache {
+public:
+  explicit PersistentObjectCache(llvm::StringRef dir) : dir(dir) {}
+
+  void notifyObjectCompiled(const llvm::Module *module,
+                            llvm::MemoryBufferRef object) override {
+    if (auto err = llvm::writeToOutput(
+            getPath(module->getModuleIdentifier()),
+            [&](llvm::raw_ostream &os) {
+              os << object.getBuffer();
+              return llvm::Error::success();
+            }))
+      llvm::errs() << "Cannot write to the object cache: "
+                   << llvm::toString(std::move(err)) << "\n";
+  }
+
+  std::unique_ptr<llvm::MemoryBuffer>
+  getObject(const llvm::Module *module) override {
+    return lookup(module->getModuleIdentifier());
+  }
+
+  std::unique_ptr<llvm::MemoryBuffer> lookup(llvm::StringRef key) {
+    auto buffer = llvm::MemoryBuffer::getFile(getPath(key));
+    return buffer ? std::move(*buffer) : nullptr;
+  }
+
+private:
+  std::string getPath(llvm::StringRef key) {
+    llvm::SmallString<128> path(dir);
+    llvm::sys::path::append(path, key + ".o");
+    return std::string(path);
+  }
+
+  std::string dir;
+};
+
+using LibraryInitFn = void (*)(llvm::StringMap<void *> &);
+using LibraryDestroyFn = void (*)();
+
+} // namespace
+
+static std::optional<unsigned> getOptLevel() {
+  cl::opt<bool> *flags[] = {&optO0, &optO1, &optO2, &optO3};
+  std::optional<unsigned> optLevel;
+  for (auto [level, flag] : llvm::enumerate(flags))
+    if (*flag)
+      optLevel = level;
+  return optLevel;
+}
+
+/// Returns the cache key of \p input compiled for \p jtmb at \p optLevel.
+static std::string getCacheKey(llvm::StringRef input,
+                               std::optional<unsigned> optLevel,
+                               const llvm::orc::JITTargetMachineBuilder &jtmb) {
+  llvm::SHA256 hasher;
+  hasher.update(input);
+  auto update = [&](llvm::StringRef str) {
+    hasher.update(str);
+    hasher.update(llvm::StringRef("\0", 1));
+  };
+  update(optLevel ? std::to_string(*optLevel) : "none");
+  update(jtmb.getTargetTriple().str());
+  update(jtmb.getCPU());
+  update(jtmb.getFeatures().getString());
+  update(LLVM_VERSION_STRING);
+  return llvm::toHex(hasher.final(), /*LowerCase=*/true);
+}
+
+/// Checks that the entry point exists and matches --entry-point-result.
+static llvm::Error checkEntryPoint(mlir::ModuleOp module) {
+  auto func = module.lookupSymbol<mlir::LLVM::LLVMFuncOp>(mainFuncName);
+  if (!func || func.isExternal())
+    return llvm::createStringError("entry point not found");
+  auto funcType = func.getFunctionType();
+  if (funcType.getNumParams() != 0)
+    return llvm::createStringError(
+        "JIT can't invoke a main function expecting arguments");
+  auto resultType = funcType.getReturnType();
+  bool matches =
+      mainFuncType == "void"
+          ? llvm::isa<mlir::LLVM::LLVMVoidType>(resultType)
+      : mainFuncType == "i32" ? resultType.isInteger(32)
+      : mainFuncType == "i64" ? resultType.isInteger(64)
+      : mainFuncType == "f32" ? resultType.isF32()
+                              : false;
+  if (!matches)
+    return llvm::createStringError("the entry point does not return " +
+                                   mainFuncType);
+  return llvm::Error::success();
+}
+
+static llvm::Error compileAndExecute(mlir::DialectRegistry &registry) {
+  auto input = llvm::MemoryBuffer::getFileOrSTDIN(inputFilename);
+  if (!input)
+    return llvm::createStringError(input.getError(),
+                                   "cannot open " + inputFilename);
+  llvm::StringRef inputText = (*input)->getBuffer();
+
+  mlir::MLIRContext context(registry);
+  llvm::SourceMgr sourceMgr;
+  sourceMgr.AddNewSourceBuffer(std::move(*input), llvm::SMLoc());
+  auto module = mlir::parseSourceFile<mlir::ModuleOp>(sourceMgr, &context);
+  if (!module)
+    return llvm::createStringError("could not parse the input IR");
+  if (auto err = checkEntryPoint(*module))
+    return err;
+
+  auto jtmb = llvm::orc::JITTargetMachineBuilder::detectHost();
+  if (!jtmb)
+    return jtmb.takeError();
+  auto optLevel = getOptLevel();
+  if (optLevel)
+    jtmb->setCodeGenOptLevel(static_cast<llvm::CodeGenOptLevel>(*optLevel));
+
+  std::unique_ptr<PersistentObjectCache> cache;
+  std::string cacheDir = objectCacheDir;
+  if (cacheDir.empty())
+    if (auto env = getenv("IMEX_CPU_RUNNER_CACHE_DIR"))
+      cacheDir = env;
+  if (!cacheDir.empty()) {
+    if (auto ec = llvm::sys::fs::create_directories(cacheDir))
+      return llvm::createStringError(ec, "cannot create " + cacheDir);
+    cache = std::make_unique<PersistentObjectCache>(cacheDir);
+  }
+
+  auto jit =
+      llvm::orc::LLJITBuilder()
+          .setJITTargetMachineBuilder(*jtmb)
+          .setCompileFunctionCreator(
+              [&](llvm::orc::JITTargetMachineBuilder builder)
+                  -> llvm::Expected<
+                      std::unique_ptr<llvm::orc::IRCompileLayer::IRCompiler>> {
+                auto tm = builder.createTargetMachine();
+                if (!tm)
+                  return tm.takeError();
+                return std::make_unique<llvm::orc::TMOwningSimpleCompiler>(
+                    std::move(*tm), cache.get());
+              })
+          .create();
+  if (!jit)
+    return jit.takeError();
+  auto &mainJD = (*jit)->getMainJITDylib();
+  char prefix = (*jit)->getDataLayout().getGlobalPrefix();
+  auto processSymbols =
+      llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(prefix);
+  if (!processSymbols)
+    return processSymbols.takeError();
+  mainJD.addGenerator(std::move(*processSymbols));
+
+  // Libraries exporting __mlir_execution_engine_init register their symbols
+  // themselves, the others are searched like the process.
+  llvm::SmallVector<LibraryDestroyFn> destroyFns;
+  llvm::orc::MangleAndInterner interner((*jit)->getExecutionSession(),
+                                        (*jit)->getDataLayout());
+  for (auto &libPath : clSharedLibs) {
+    std::string err;
+    auto lib =
+        llvm::sys::DynamicLibrary::getPermanentLibrary(libPath.c_str(), &err);
+    if (!lib.isValid())
+      return llvm::createStringError("cannot load " + libPath + ": " + err);
+    auto initFn = reinterpret_cast<LibraryInitFn>(
+        lib.getAddressOfSymbol("__mlir_execution_engine_init"));
+    auto destroyFn = reinterpret_cast<LibraryDestroyFn>(
+        lib.getAddressOfSymbol("__mlir_execution_engine_destroy"));
+    if (!initFn || !destroyFn) {
+      auto generator =
+          llvm::orc::DynamicLibrarySearchGenerator::Load(libPath.c_str(),
+                                                         prefix);
+      if (!generator)
+        return generator.takeError();
+      mainJD.addGenerator(std::move(*generator));
+      continue;
+    }
+    llvm::StringMap<void *> exported;
+    initFn(exported);
+    llvm::orc::SymbolMap symbols;
+    for (auto &entry : exported)
+      symbols[interner(entry.getKey())] = {
+          llvm::orc::ExecutorAddr::fromPtr(entry.getValue()),
+          llvm::JITSymbolFlags::Exported};
+    if (auto err = mainJD.define(llvm::orc::absoluteSymbols(symbols)))
+      return err;
+    destroyFns.push_back(destroyFn);
+  }
+
+  auto key = getCacheKey(inputText, optLevel, *jtmb);
+  if (auto object = cache ? cache->lookup(key) : nullptr) {
+    if (auto err = (*jit)->addObjectFile(std::move(object)))
+      return err;
+  } else {
+    auto llvmContext = std::make_unique<llvm::LLVMContext>();
+    auto llvmModule = mlir::translateModuleToLLVMIR(*module, *llvmContext);
+    if (!llvmModule)
+      return llvm::createStringError("could not translate MLIR to LLVM IR");
+    auto tm = jtmb->createTargetMachine();
+    if (!tm)
+      return tm.takeError();
+    mlir::ExecutionEngine::setupTargetTripleAndDataLayout(llvmModule.get(),
+                                                          tm->get());
+    auto transformer = mlir::makeOptimizingTransformer(optLevel.value_or(0),
+                                                       /*sizeLevel=*/0,
+                                                       tm->get());
+    if (auto err = transformer(llvmModule.get()))
+      return err;
+    // The compile layer stores the object under the module identifier.
+    llvmModule->setModuleIdentifier(key);
+    if (auto err = (*jit)->addIRModule(llvm::orc::ThreadSafeModule(
+            std::move(llvmModule), std::move(llvmContext))))
+      return err;
+  }
+
+  if (auto err = (*jit)->initialize(mainJD))
+    return err;
+  auto entry = (*jit)->lookup(mainFuncName);
+  if (!entry)
+    return entry.takeError();
+  if (mainFuncType == "void") {
+    entry->toPtr<void()>()();
+  } else if (mainFuncType == "i32") {
+    llvm::outs() << entry->toPtr<int32_t()>()() << '\n';
+  } else if (mainFuncType == "i64") {
+    llvm::outs() << entry->toPtr<int64_t()>()() << '\n';
+  } else {
+    llvm::outs() << entry->toPtr<float()>()() << '\n';
+  }
+  llvm::outs().flush();
+  if (auto err = (*jit)->deinitialize(mainJD))
+    return err;
+
+  for (auto destroyFn : destroyFns)
+    destroyFn();
+  return llvm::Error::success();
+}
 
 int main(int argc, char **argv) {
   llvm::InitLLVM y(argc, argv);
@@ -45,5 +354,10 @@ int main(int argc, char **argv) {
   mlir::DialectRegistry registry;
   mlir::registerAllToLLVMIRTranslations(registry);
 
-  return mlir::JitRunnerMain(argc, argv, registry);
+  cl::ParseCommandLineOptions(argc, argv, "IMEX CPU execution driver\n");
+  if (auto err = compileAndExecute(registry)) {
+    llvm::logAllUnhandledErrors(std::move(err), llvm::errs(), "Error: ");
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
 }
@@ -0,0 +1,56 @@
+//===- l0-device-probe.cpp --------------------------------------*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines a utility printing the capabilities of the GPU the
+// runtime would use as "key=value" lines, see DeviceProbe.h. With a key as
+// argument only the value of that key is printed. Returns 1 if there is no
+// GPU.
+//
+//===----------------------------------------------------------------------===//
+
+#include "imex/ExecutionEngine/DeviceProbe.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+
+int main(int argc, char **argv) {
+  imex::DeviceCapabilities caps;
+  try {
+    caps = imex::probeDefaultDevice();
+  } catch (const std::exception &e) {
+    fprintf(stderr, "l0-device-probe: %s\n", e.what());
+    return 1;
+  }
+
+  if (argc < 2) {
+    imex::printDeviceCapabilities(stdout, caps);
+    return 0;
+  }
+
+  // Print the value of the requested key only.
+  char *buffer = nullptr;
+  size_t size = 0;
+  auto stream = open_memstream(&buffer, &size);
+  imex::printDeviceCapabilities(stream, caps);
+  fclose(stream);
+  auto keyLen = strlen(argv[1]);
+  int ret = 1;
+  for (auto line = strtok(buffer, "\n"); line; line = strtok(nullptr, "\n")) {
+    if (!strncmp(line, argv[1], keyLen) && line[keyLen] == '=') {
+      printf("%s\n", line + keyLen + 1);
+      ret = 0;
+    }
+  }
+  free(buffer);
+  if (ret)
+    fprintf(stderr, "l0-device-probe: unknown key %s\n", argv[1]);
+  return ret;
+}
@@ -0,0 +1,165 @@
+//===- GraphCacheTest.cpp - Tests of the deferred execution mode ----------===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "imex/ExecutionEngine/GraphCache.h"
+
+#include <imex/Dialect/NDArray/IR/NDArrayOps.h>
+
+#include <mlir/Conversion/ArithToLLVM/ArithToLLVM.h>
+#include <mlir/Conversion/FuncToLLVM/ConvertFuncToLLVMPass.h>
+#include <mlir/Conversion/ReconcileUnrealizedCasts/ReconcileUnrealizedCasts.h>
+#include <mlir/Dialect/Arith/IR/Arith.h>
+#include <mlir/Dialect/LLVMIR/LLVMDialect.h>
+#include <mlir/Pass/PassManager.h>
+
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <cstdint>
+
+using namespace imex;
+
+namespace {
+
+class GraphCacheTest : public ::testing::Test {
+protected:
+  GraphCacheTest(size_t maxGraphs = 64)
+      : cache(getOptions(), maxGraphs), recorder(context, cache) {
+    context.loadDialect<mlir::arith::ArithDialect, mlir::func::FuncDialect,
+                        mlir::LLVM::LLVMDialect>();
+  }
+
+  SessionOptions getOptions() {
+    SessionOptions options;
+    options.buildPipeline = [this](mlir::OpPassManager &pm) {
+      ++compilations;
+      pm.addPass(mlir::createArithToLLVMConversionPass());
+      pm.addPass(mlir::createConvertFuncToLLVMPass());
+      pm.addPass(mlir::createReconcileUnrealizedCastsPass());
+    };
+    return options;
+  }
+
+  // Records a * b + a on i64 inputs, with the multiplication replaced by a
+  // subtraction if \p sub is set.
+  CompiledGraph record(bool sub = false) {
+    auto &builder = recorder.getBuilder();
+    auto loc = builder.getUnknownLoc();
+    auto a = recorder.addInput(builder.getI64Type());
+    auto b = recorder.addInput(builder.getI64Type());
+    mlir::Value x =
+        sub ? builder.create<mlir::arith::SubIOp>(loc, a, b).getResult()
+            : builder.create<mlir::arith::MulIOp>(loc, a, b).getResult();
+    auto y = builder.create<mlir::arith::AddIOp>(loc, x, a);
+    recorder.markHostVisible(y);
+    return llvm::cantFail(recorder.flush());
+  }
+
+  static int64_t call(const CompiledGraph &fn, int64_t a, int64_t b) {
+    int64_t result = 0;
+    void *args[] = {&a, &b, &result};
+    fn.invoke(args);
+    return result;
+  }
+
+  mlir::MLIRContext context;
+  std::atomic<unsigned> compilations{0};
+  GraphCache cache;
+  GraphRecorder recorder;
+};
+
+class SmallGraphCacheTest : public GraphCacheTest {
+protected:
+  SmallGraphCacheTest() : GraphCacheTest(/*maxGraphs=*/1) {}
+};
+
+TEST_F(GraphCacheTest, KeyIgnoresLocations) {
+  auto build = [&](mlir::Location loc, mlir::Type type) {
+    mlir::OpBuilder builder(&context);
+    auto func = builder.create<mlir::func::FuncOp>(
+        loc, "graph", builder.getFunctionType({type}, {type}));
+    builder.setInsertionPointToEnd(func.addEntryBlock());
+    auto arg = func.getArgument(0);
+    builder.create<mlir::func::ReturnOp>(
+        loc, builder.create<mlir::arith::AddIOp>(loc, arg, arg).getResult());
+    auto key = getGraphKey(func);
+    func->erase();
+    return key;
+  };
+  auto i64 = mlir::IntegerType::get(&context, 64);
+  auto i32 = mlir::IntegerType::get(&context, 32);
+  auto key = build(mlir::UnknownLoc::get(&context), i64);
+  EXPECT_EQ(build(mlir::FileLineColLoc::get(&context, "a.py", 1, 2), i64),
+            key);
+  EXPECT_NE(build(mlir::UnknownLoc::get(&context), i32), key);
+}
+
+TEST_F(GraphCacheTest, RecordedGraphIsCompiledOnce) {
+  auto fn = record();
+  EXPECT_EQ(call(fn, 3, 4), 15);
+  EXPECT_EQ(cache.size(), 1u);
+
+  // Recording the same operations again hits the cache.
+  auto again = record();
+  EXPECT_EQ(call(again, 5, 6), 35);
+  EXPECT_EQ(cache.size(), 1u);
+  EXPECT_EQ(compilations, 1u);
+
+  auto other = record(/*sub=*/true);
+  EXPECT_EQ(call(other, 5, 6), 4);
+  EXPECT_EQ(cache.size(), 2u);
+  EXPECT_EQ(compilations, 2u);
+}
+
+TEST_F(GraphCacheTest, FailedCompilationIsNotCached) {
+  auto &builder = recorder.getBuilder();
+  // Unregistered ops cannot be lowered.
+  mlir::OperationState state(builder.getUnknownLoc(), "test.unknown");
+  state.addTypes(builder.getI64Type());
+  context.allowUnregisteredDialects();
+  auto op = builder.create(state);
+  recorder.markHostVisible(op->getResult(0));
+  auto fn = recorder.flush();
+  EXPECT_FALSE(static_cast<bool>(fn));
+  llvm::consumeError(fn.takeError());
+  EXPECT_EQ(cache.size(), 0u);
+}
+
+TEST_F(SmallGraphCacheTest, LeastRecentlyUsedGraphIsEvicted) {
+  auto fn = record();
+  auto other = record(/*sub=*/true);
+  EXPECT_EQ(cache.size(), 1u);
+  // The evicted graph stays callable.
+  EXPECT_EQ(call(fn, 3, 4), 15);
+  EXPECT_EQ(call(other, 5, 6), 4);
+
+  // Recording it again compiles it again.
+  record();
+  EXPECT_EQ(cache.size(), 1u);
+  EXPECT_EQ(compilations, 3u);
+}
+
+TEST_F(GraphCacheTest, ArrayReadsAreHostVisible) {
+  auto &builder = recorder.getBuilder();
+  auto loc = builder.getUnknownLoc();
+  auto type = ndarray::NDArrayType::get({8}, builder.getI64Type());
+  auto a = recorder.addInput(type);
+  auto b = builder.create<ndarray::CopyOp>(loc, type, a).getResult();
+  auto c = builder.create<ndarray::CopyOp>(loc, type, b).getResult();
+  EXPECT_FALSE(recorder.needsFlush());
+  EXPECT_EQ(recorder.getResults(), (llvm::SmallVector<mlir::Value>{b, c}));
+
+  auto dim = builder.create<ndarray::DimOp>(loc, c, 0).getResult();
+  EXPECT_TRUE(recorder.needsFlush());
+  // Host visible values come first, released arrays are dropped.
+  recorder.release(b);
+  EXPECT_EQ(recorder.getResults(), (llvm::SmallVector<mlir::Value>{dim, c}));
+}
+
+} // namespace
@@ -0,0 +1,104 @@
+//===- ModuleCacheTest.cpp - Tests of the GPU module cache ----------------===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "imex/ExecutionEngine/ModuleCache.h"
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+using namespace imex;
+
+namespace {
+
+struct FakeModule {
+  void *module = nullptr;
+};
+
+// Loads modules into a cache, handing out the address of a new int for every
+// module built.
+class ModuleCacheTest : public ::testing::Test {
+protected:
+  void *load(const std::vector<char> &binary,
+             const std::string &buildFlags = "") {
+    return cache.getOrCreate(&context, &device, binary.data(), binary.size(),
+                             buildFlags, [&]() {
+                               modules.push_back(std::make_unique<int>());
+                               return static_cast<void *>(
+                                   modules.back().get());
+                             });
+  }
+
+  int context = 0;
+  int device = 0;
+  std::vector<std::unique_ptr<int>> modules;
+  ModuleCache<FakeModule> cache;
+};
+
+TEST_F(ModuleCacheTest, SameAddressIsCached) {
+  std::vector<char> binary(4096, 'a');
+  auto module = load(binary);
+  EXPECT_EQ(load(binary), module);
+  EXPECT_EQ(modules.size(), 1u);
+}
+
+TEST_F(ModuleCacheTest, SameContentIsShared) {
+  std::vector<char> binary(4096, 'a');
+  std::vector<char> copy = binary;
+  EXPECT_EQ(load(copy), load(binary));
+  EXPECT_EQ(modules.size(), 1u);
+}
+
+TEST_F(ModuleCacheTest, BuildFlagsAreKeyed) {
+  std::vector<char> binary(4096, 'a');
+  EXPECT_NE(load(binary, "-a"), load(binary, "-b"));
+  EXPECT_EQ(modules.size(), 2u);
+}
+
+// The memory of a binary may be reused for another one of the same size.
+TEST_F(ModuleCacheTest, AddressReuseWithDifferentContent) {
+  for (size_t size : {100u, 4096u, 1u << 20}) {
+    std::vector<char> binary(size, 'a');
+    auto data = binary.data();
+    auto first = load(binary);
+    std::fill(binary.begin(), binary.end(), 'b');
+    ASSERT_EQ(binary.data(), data);
+    auto second = load(binary);
+    EXPECT_NE(second, first);
+    EXPECT_EQ(load(binary), second);
+
+    // The first binary is still cached by content.
+    std::vector<char> other(size, 'a');
+    EXPECT_EQ(load(other), first);
+  }
+  EXPECT_EQ(modules.size(), 6u);
+}
+
+TEST_F(ModuleCacheTest, EvictDropsAliases) {
+  std::vector<char> binary(4096, 'a');
+  auto module = load(binary);
+  EXPECT_NE(cache.lookup(module), nullptr);
+  cache.evict(module);
+  EXPECT_EQ(cache.lookup(module), nullptr);
+  EXPECT_NE(load(binary), module);
+  EXPECT_EQ(modules.size(), 2u);
+}
+
+// Changes anywhere in the content are noticed, not only near the ends.
+TEST_F(ModuleCacheTest, AddressReuseWithChangedMiddle) {
+  std::vector<char> binary(1 << 20, 'a');
+  auto first = load(binary);
+  binary[binary.size() / 2 + 1] = 'b';
+  EXPECT_NE(load(binary), first);
+  EXPECT_EQ(modules.size(), 2u);
+}
+
+} // namespace
@@ -0,0 +1,217 @@
+//===- SessionTest.cpp - Tests of the session API -------------------------===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "imex/ExecutionEngine/Session.h"
+
+#include <mlir/Conversion/ArithToLLVM/ArithToLLVM.h>
+#include <mlir/Conversion/FuncToLLVM/ConvertFuncToLLVMPass.h>
+#include <mlir/Conversion/MemRefToLLVM/MemRefToLLVM.h>
+#include <mlir/Conversion/ReconcileUnrealizedCasts/ReconcileUnrealizedCasts.h>
+#include <mlir/Dialect/Arith/IR/Arith.h>
+#include <mlir/Dialect/Func/IR/FuncOps.h>
+#include <mlir/Dialect/LLVMIR/LLVMDialect.h>
+#include <mlir/Dialect/MemRef/IR/MemRef.h>
+#include <mlir/ExecutionEngine/CRunnerUtils.h>
+#include <mlir/Parser/Parser.h>
+#include <mlir/Pass/Pass.h>
+#include <mlir/Pass/PassManager.h>
+
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <vector>
+
+using namespace imex;
+
+namespace {
+
+// Stores 1 at the start of its argument. Specializations store 2, see
+// MarkPass.
+constexpr const char *source = R"mlir(
+func.func @f(%arg0: memref<?xi64>) {
+  %c0 = arith.constant 0 : index
+  %marker = arith.constant 1 : i64
+  memref.store %marker, %arg0[%c0] : memref<?xi64>
+  return
+}
+)mlir";
+
+// Makes the specializations observable by replacing the stored marker.
+struct MarkPass
+    : public mlir::PassWrapper<MarkPass, mlir::OperationPass<mlir::ModuleOp>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(MarkPass)
+
+  void runOnOperation() override {
+    getOperation().walk([](mlir::arith::ConstantOp op) {
+      auto value = mlir::dyn_cast<mlir::IntegerAttr>(op.getValue());
+      if (value && value.getType().isInteger(64) && value.getInt() == 1)
+        op.setValueAttr(mlir::IntegerAttr::get(value.getType(), 2));
+    });
+  }
+};
+
+struct FailPass
+    : public mlir::PassWrapper<FailPass, mlir::OperationPass<mlir::ModuleOp>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(FailPass)
+
+  explicit FailPass(std::atomic<unsigned> &failures) : failures(failures) {}
+
+  void runOnOperation() override {
+    ++failures;
+    signalPassFailure();
+  }
+
+  std::atomic<unsigned> &failures;
+};
+
+class SessionTest : public ::testing::Test {
+protected:
+  SessionTest() : mainThread(std::this_thread::get_id()) {
+    // The specializations are parsed in contexts created from the registry.
+    mlir::DialectRegistry registry;
+    registry.insert<mlir::arith::ArithDialect, mlir::func::FuncDialect,
+                    mlir::LLVM::LLVMDialect, mlir::memref::MemRefDialect>();
+    context.appendDialectRegistry(registry);
+  }
+
+  // Creates a session of the source module with up to \p maxSpecializations
+  // per function. The specializations are compiled on other threads, they
+  // wait for \p release if it is valid and fail if \p fail is set.
+  std::unique_ptr<Session> create(unsigned maxSpecializations) {
+    auto module = mlir::parseSourceString<mlir::ModuleOp>(source, &context);
+    SessionOptions options;
+    options.maxSpecializations = maxSpecializations;
+    options.buildPipeline = [this](mlir::OpPassManager &pm) {
+      if (std::this_thread::get_id() != mainThread) {
+        ++specializations;
+        if (release.valid())
+          release.wait();
+        if (fail)
+          pm.addPass(std::make_unique<FailPass>(failures));
+        pm.addPass(std::make_unique<MarkPass>());
+        pipelineDone = true;
+      }
+      pm.addPass(mlir::createFinalizeMemRefToLLVMConversionPass());
+      pm.addPass(mlir::createArithToLLVMConversionPass());
+      pm.addPass(mlir::createConvertFuncToLLVMPass());
+      pm.addPass(mlir::createReconcileUnrealizedCastsPass());
+    };
+    return llvm::cantFail(Session::create(*module, options));
+  }
+
+  // Calls \p fn on a buffer of \p size elements and returns the marker it
+  // stored.
+  static int64_t call(const Session::Function &fn, int64_t size) {
+    std::vector<int64_t> buffer(size, 0);
+    StridedMemRefType<int64_t, 1> arg{buffer.data(), buffer.data(), 0,
+                                      {size}, {1}};
+    void *args[] = {&arg.basePtr, &arg.data, &arg.offset, &arg.sizes[0],
+                    &arg.strides[0]};
+    fn.invoke(args);
+    return buffer[0];
+  }
+
+  // Calls \p fn until the specialization for \p size is used, for at most a
+  // minute.
+  static bool waitForSpecialization(const Session::Function &fn,
+                                    int64_t size) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::minutes(1);
+    while (call(fn, size) != 2) {
+      if (std::chrono::steady_clock::now() > deadline)
+        return false;
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return true;
+  }
+
+  mlir::MLIRContext context;
+  std::thread::id mainThread;
+  std::shared_future<void> release;
+  bool fail = false;
+  std::atomic<unsigned> specializations{0};
+  std::atomic<unsigned> failures{0};
+  std::atomic<bool> pipelineDone{false};
+};
+
+TEST_F(SessionTest, NoSpecializationByDefault) {
+  auto session = create(/*maxSpecializations=*/0);
+  auto fn = llvm::cantFail(session->lookup("f"));
+  EXPECT_EQ(call(fn, 4), 1);
+  EXPECT_EQ(call(fn, 4), 1);
+  EXPECT_EQ(specializations, 0u);
+}
+
+TEST_F(SessionTest, RepeatedSignatureHitsCache) {
+  auto session = create(/*maxSpecializations=*/4);
+  auto fn = llvm::cantFail(session->lookup("f"));
+  ASSERT_TRUE(waitForSpecialization(fn, 4));
+  for (int i = 0; i < 10; ++i)
+    EXPECT_EQ(call(fn, 4), 2);
+  EXPECT_EQ(specializations, 1u);
+}
+
+TEST_F(SessionTest, FallbackWhilePending) {
+  std::promise<void> promise;
+  release = promise.get_future().share();
+  auto session = create(/*maxSpecializations=*/4);
+  auto fn = llvm::cantFail(session->lookup("f"));
+  // The generic function runs while the specialization is compiled.
+  EXPECT_EQ(call(fn, 4), 1);
+  EXPECT_EQ(call(fn, 4), 1);
+  promise.set_value();
+  ASSERT_TRUE(waitForSpecialization(fn, 4));
+  EXPECT_EQ(specializations, 1u);
+}
+
+TEST_F(SessionTest, FallbackOnFailure) {
+  fail = true;
+  auto session = create(/*maxSpecializations=*/4);
+  auto fn = llvm::cantFail(session->lookup("f"));
+  EXPECT_EQ(call(fn, 4), 1);
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::minutes(1);
+  while (!failures && std::chrono::steady_clock::now() < deadline)
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  ASSERT_EQ(failures, 1u);
+  // The failed signature is not compiled again.
+  for (int i = 0; i < 10; ++i)
+    EXPECT_EQ(call(fn, 4), 1);
+  EXPECT_EQ(specializations, 1u);
+}
+
+TEST_F(SessionTest, MaxSpecializationsIsEnforced) {
+  auto session = create(/*maxSpecializations=*/2);
+  auto fn = llvm::cantFail(session->lookup("f"));
+  EXPECT_EQ(call(fn, 1), 1);
+  EXPECT_EQ(call(fn, 2), 1);
+  EXPECT_EQ(call(fn, 3), 1);
+  ASSERT_TRUE(waitForSpecialization(fn, 1));
+  ASSERT_TRUE(waitForSpecialization(fn, 2));
+  EXPECT_EQ(call(fn, 3), 1);
+  EXPECT_EQ(specializations, 2u);
+}
+
+TEST_F(SessionTest, DestructionJoinsCompilations) {
+  std::promise<void> promise;
+  release = promise.get_future().share();
+  auto session = create(/*maxSpecializations=*/4);
+  auto fn = llvm::cantFail(session->lookup("f"));
+  EXPECT_EQ(call(fn, 4), 1);
+  std::thread releaser([&]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    promise.set_value();
+  });
+  session.reset();
+  EXPECT_TRUE(pipelineDone);
+  releaser.join();
+}
+
+} // namespace